@@ -14,6 +14,9 @@ in int vertexData;
 
 out vec2 fragmentTextureCoordinate;
 flat out int fragmentTextureIndex;
+flat out int fragmentTextureLayer;
+flat out int fragmentDistanceField;
+flat out int fragmentColorTransform;
 out vec4 fragmentColor;
 
 void main() {
@@ -31,5 +34,9 @@ void main() {
     fragmentTextureCoordinate = vertexTextureCoordinate / textureSize0;
 
   fragmentTextureIndex = vertexTextureIndex;
+  // Textures in a texture array carry their layer, everything else -1
+  fragmentTextureLayer = ((vertexData >> 17) & 0x1) == 1 ? (vertexData >> 18) & 0xff : -1;
+  fragmentDistanceField = (vertexData >> 26) & 0x1;
+  fragmentColorTransform = (vertexData >> 5) & 0xfff;
   fragmentColor = vertexColor;
 }
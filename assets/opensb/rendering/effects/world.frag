@@ -4,6 +4,11 @@ uniform sampler2D texture0;
 uniform sampler2D texture1;
 uniform sampler2D texture2;
 uniform sampler2D texture3;
+uniform sampler2DArray textureArray0;
+uniform sampler2DArray textureArray1;
+uniform sampler2DArray textureArray2;
+uniform sampler2DArray textureArray3;
+uniform sampler2D colorTransforms;
 uniform bool lightMapEnabled;
 uniform vec2 lightMapSize;
 uniform sampler2D lightMap;
@@ -11,12 +16,65 @@ uniform float lightMapMultiplier;
 
 in vec2 fragmentTextureCoordinate;
 flat in int fragmentTextureIndex;
+flat in int fragmentTextureLayer;
+flat in int fragmentDistanceField;
+flat in int fragmentColorTransform;
 in vec4 fragmentColor;
 in float fragmentLightMapMultiplier;
 in vec2 fragmentLightMapCoordinate;
 
 out vec4 outColor;
 
+vec3 rgbToHsv(vec3 c) {
+  vec4 k = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
+  vec4 p = mix(vec4(c.bg, k.wz), vec4(c.gb, k.xy), step(c.b, c.g));
+  vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
+  float d = q.x - min(q.w, q.y);
+  return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + 1.0e-10)), d / (q.x + 1.0e-10), q.x);
+}
+
+vec3 hsvToRgb(vec3 c) {
+  vec4 k = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+  vec3 p = abs(fract(c.xxx + k.xyz) * 6.0 - k.www);
+  return c.z * mix(k.xxx, clamp(p - k.xxx, 0.0, 1.0), c.y);
+}
+
+vec3 srgbToLinear(vec3 c) {
+  return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+vec3 linearToSrgb(vec3 c) {
+  return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+}
+
+vec4 applyColorTransform(vec4 color, int row) {
+  if (row == 0)
+    return color;
+
+  vec4 shifts = texelFetch(colorTransforms, ivec2(0, row), 0);
+  vec4 fade = texelFetch(colorTransforms, ivec2(1, row), 0);
+  int replaceCount = int(fade.a);
+  for (int i = 0; i < replaceCount; ++i) {
+    if (all(lessThan(abs(color - texelFetch(colorTransforms, ivec2(2 + i * 2, row), 0)), vec4(0.5 / 255.0)))) {
+      color = texelFetch(colorTransforms, ivec2(3 + i * 2, row), 0);
+      break;
+    }
+  }
+
+  if (shifts.x != 0.0 || shifts.y != 0.0 || shifts.z != 1.0) {
+    vec3 hsv = rgbToHsv(color.rgb);
+    hsv.x = fract(hsv.x + shifts.x);
+    hsv.y = clamp(hsv.y + shifts.y, 0.0, 1.0);
+    hsv.z = clamp(hsv.z * shifts.z, 0.0, 1.0);
+    color.rgb = hsvToRgb(hsv);
+  }
+
+  if (shifts.w > 0.0)
+    color.rgb = linearToSrgb(mix(srgbToLinear(color.rgb), fade.rgb, shifts.w));
+
+  return color;
+}
+
 vec4 cubic(float v) {
   vec4 n = vec4(1.0, 2.0, 3.0, 4.0) - v;
   vec4 s = n * n * n;
@@ -66,7 +124,17 @@ vec3 sampleLight(vec2 coord, vec2 scale) {
 
 void main() {
   vec4 texColor;
-  if (fragmentTextureIndex == 3)
+  if (fragmentTextureLayer >= 0) {
+    vec3 arrayCoordinate = vec3(fragmentTextureCoordinate, float(fragmentTextureLayer));
+    if (fragmentTextureIndex == 3)
+      texColor = texture(textureArray3, arrayCoordinate);
+    else if (fragmentTextureIndex == 2)
+      texColor = texture(textureArray2, arrayCoordinate);
+    else if (fragmentTextureIndex == 1)
+      texColor = texture(textureArray1, arrayCoordinate);
+    else
+      texColor = texture(textureArray0, arrayCoordinate);
+  } else if (fragmentTextureIndex == 3)
     texColor = texture(texture3, fragmentTextureCoordinate);
   else if (fragmentTextureIndex == 2)
     texColor = texture(texture2, fragmentTextureCoordinate);
@@ -75,6 +143,12 @@ void main() {
   else
     texColor = texture(texture0, fragmentTextureCoordinate);
 
+  if (fragmentDistanceField == 1) {
+    float edgeWidth = max(fwidth(texColor.a) * 0.5, 1.0e-4);
+    texColor = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - edgeWidth, 0.5 + edgeWidth, texColor.a));
+  }
+
+  texColor = applyColorTransform(texColor, fragmentColorTransform);
   if (texColor.a <= 0.0)
     discard;
 
@@ -18,6 +18,9 @@ in int vertexData;
 
 out vec2 fragmentTextureCoordinate;
 flat out int fragmentTextureIndex;
+flat out int fragmentTextureLayer;
+flat out int fragmentDistanceField;
+flat out int fragmentColorTransform;
 out vec4 fragmentColor;
 out float fragmentLightMapMultiplier;
 out vec2 fragmentLightMapCoordinate;
@@ -45,6 +48,10 @@ void main() {
     fragmentTextureCoordinate = vertexTextureCoordinate / textureSize0;
 
   fragmentTextureIndex = vertexTextureIndex;
+  // Textures in a texture array carry their layer, everything else -1
+  fragmentTextureLayer = ((vertexData >> 17) & 0x1) == 1 ? (vertexData >> 18) & 0xff : -1;
+  fragmentDistanceField = (vertexData >> 26) & 0x1;
+  fragmentColorTransform = (vertexData >> 5) & 0xfff;
   fragmentColor = vertexColor;
   gl_Position = vec4(screenPosition / screenSize * 2.0 - 1.0, 0.0, 1.0);
 }
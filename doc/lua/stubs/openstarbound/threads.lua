@@ -12,7 +12,7 @@ function thread.stop() end
 ---@class threads
 threads = {}
 
---- Creates a thread using the given parameters, and returns the thread's name. Here's an example that uses all available parameters: ```lua threads.create({ name="example", -- this is the thread name you'll use to index the thread scripts={ main={"/scripts/examplethread.lua"}, -- a list of scripts for each context, similarly to how other scripts work other={"/scripts/examplesecondthreadscript.lua"}, -- threads can have multiple contexts }, instructionLimit=100000000, -- optional, threads are allowed to change their own instruction limit (as they have nothing else to block if stuck) tickRate=60, -- optional, how many ticks per second the thread runs at, defaults to 60 but can be any number updateMeasureWindow=0.5, -- optional, defaults to 0.5, changing this is unnecessary unless you really care about an accurate tickrate for some reason someParameter="scungus" -- parameters for the scripts, all parameters are accessible using config.getParameter in the scripts }), ``` ---
+--- Creates a thread using the given parameters, and returns the thread's name. Here's an example that uses all available parameters: ```lua threads.create({ name="example", -- this is the thread name you'll use to index the thread scripts={ main={"/scripts/examplethread.lua"}, -- a list of scripts for each context, similarly to how other scripts work other={"/scripts/examplesecondthreadscript.lua"}, -- threads can have multiple contexts }, instructionLimit=100000000, -- optional, threads are allowed to change their own instruction limit (as they have nothing else to block if stuck) tickRate=60, -- optional, how many ticks per second the thread runs at, defaults to 60 but can be any number updateMeasureWindow=0.5, -- optional, defaults to 0.5, changing this is unnecessary unless you really care about an accurate tickrate for some reason pooled=false, -- optional, runs the thread on a shared worker pool instead of its own thread, and only while it has messages or a context is due for an update someParameter="scungus" -- parameters for the scripts, all parameters are accessible using config.getParameter in the scripts }), ``` ---
 ---@param parameters Json
 ---@return string
 function threads.create(parameters) end
@@ -12,3 +12,9 @@ function script.setUpdateDelta(dt) end
 --- Returns the duration in seconds between periodic updates to the script.
 ---@return number
 function script.updateDt() end
+
+--- Runs the given function as a coroutine. Yielding an RpcPromise suspends it until the promise finishes, after which it is resumed with the promise's result and error. Yielding anything else resumes it on the next update. ---
+---@param f function
+---@param ... any
+---@return void
+function script.spawn(f, ...) end
@@ -400,7 +400,7 @@ function world.placeMaterial(position, layerName, materialName, hueShift, allowO
 ---@return boolean
 function world.placeMod(position, layerName, modName, hueShift, allowOverlap) end
 
---- Queries for entities in a specified area of the world and returns a list of their entity ids. Area can be specified either as the `Vec2F` lower left and upper right positions of a rectangle, or as the `Vec2F` center and `float` radius of a circular area. The following additional parameters can be specified in options: * __withoutEntityId__ - Specifies an `EntityId` that will be excluded from the returned results * __includedTypes__ - Specifies a list of one or more `String` entity types that the query will return. In addition to standard entity type names, this list can include "mobile" for all mobile entity types or "creature" for players, monsters and NPCs. * __boundMode__ - Specifies the bounding mode for determining whether entities fall within the query area. Valid options are "position", "collisionarea", "metaboundbox". Defaults to "collisionarea" if unspecified. * __order__ - A `String` used to specify how the results will be ordered. If this is set to "nearest" the entities will be sorted by ascending distance from the first positional argument. If this is set to "random" the list of results will be shuffled. * __callScript__ - Specifies a `String` name of a function that should be called in the script context of all scripted entities matching the query. * __callScriptArgs__ - Specifies a list of arguments that will be passed to the function called by callScript. * __callScriptResult__ - Specifies a `LuaValue` that the function called by callScript must return; entities whose script calls do not return this value will be excluded from the results. Defaults to `true`. ---
+--- Queries for entities in a specified area of the world and returns a list of their entity ids. Area can be specified either as the `Vec2F` lower left and upper right positions of a rectangle, or as the `Vec2F` center and `float` radius of a circular area. The following additional parameters can be specified in options: * __withoutEntityId__ - Specifies an `EntityId` that will be excluded from the returned results * __includedTypes__ - Specifies a list of one or more `String` entity types that the query will return. In addition to standard entity type names, this list can include "mobile" for all mobile entity types or "creature" for players, monsters and NPCs. * __boundMode__ - Specifies the bounding mode for determining whether entities fall within the query area. Valid options are "position", "collisionarea", "metaboundbox". Defaults to "collisionarea" if unspecified. * __order__ - A `String` used to specify how the results will be ordered. If this is set to "nearest" the entities will be sorted by ascending distance from the first positional argument. If this is set to "random" the list of results will be shuffled. * __maxResults__ - An `unsigned` limit on the number of results returned. When combined with "nearest" ordering, the nearest entities are returned. * __callScript__ - Specifies a `String` name of a function that should be called in the script context of all scripted entities matching the query. * __callScriptArgs__ - Specifies a list of arguments that will be passed to the function called by callScript. * __callScriptResult__ - Specifies a `LuaValue` that the function called by callScript must return; entities whose script calls do not return this value will be excluded from the results. Defaults to `true`. ---
 ---@param position Vec2F
 ---@param options Json
 ---@return List<EntityId>
@@ -733,6 +733,13 @@ function world.callScriptedEntity(entityId, functionName, args) end
 ---@return RpcPromise<Json>
 function world.sendEntityMessage(messageType, args) end
 
+--- Sends the same asynchronous message to each of the specified entities and returns a single `RpcPromise` that finishes once every entity has responded. Its result is a list holding the response of each entity in the order given, with `nil` for entities that did not handle the message or could not be reached. ---
+---@param entityIds (EntityId|string)[]
+---@param messageType string
+---@param args LuaValue
+---@return RpcPromise<Json>
+function world.sendEntityMessages(entityIds, messageType, args) end
+
 --- Attempts to find an entity on the server by unique id and returns an `RpcPromise` that can be used to get the position of that entity if successful. ---
 ---@param uniqueId string
 ---@return RpcPromise<Vec2F>
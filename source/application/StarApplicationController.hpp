@@ -33,6 +33,10 @@ public:
   // Maximum number of calls to update() that can occur before we force
   // 'render()' to be called, even if we are still behind on our update rate.
   virtual void setMaxFrameSkip(unsigned maxFrameSkip) = 0;
+  // When enabled, render() is called once per presented frame (paced by
+  // VSync) instead of after every batch of updates, and update() only runs
+  // when a fixed timestep is due, so a frame may see zero updates.
+  virtual void setDecoupledRendering(bool decoupledRendering) = 0;
 
   virtual void setApplicationTitle(String title) = 0;
   virtual void setFullscreenWindow(Vec2U fullScreenResolution) = 0;
@@ -2,6 +2,7 @@
 #include "StarLogging.hpp"
 #include "StarSignalHandler.hpp"
 #include "StarTickRateMonitor.hpp"
+#include "StarArena.hpp"
 #include "StarRenderer_opengl.hpp"
 #include "StarTtlCache.hpp"
 #include "StarImage.hpp"
@@ -728,6 +729,8 @@ public:
       bool quit = false;
       while (true) {
         cleanup();
+        // Scratch allocations made on this thread only live for one frame
+        Arena::threadArena().reset();
 
 
         for (auto const& event : processEvents())
@@ -745,7 +748,9 @@ public:
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL3_NewFrame();
 
-        int updatesBehind = max<int>(round(m_updateTicker.ticksBehind()), 1);
+        // With decoupled rendering a frame may be presented without any
+        // update having become due, otherwise at least one update runs per frame
+        int updatesBehind = max<int>(round(m_updateTicker.ticksBehind()), m_decoupledRendering ? 0 : 1);
         updatesBehind = min<int>(updatesBehind, m_maxFrameSkip + 1);
         for (int i = 0; i < updatesBehind; ++i) {
           //since frame-skipping is a thing, we have to begin a new ImGui frame here to prevent duplicate elements made by updates
@@ -755,6 +760,8 @@ public:
           m_application->update();
           m_updateRate = m_updateTicker.tick();
         }
+        if (updatesBehind == 0)
+          ImGui::NewFrame();
 
         m_renderer->startFrame();
         m_application->render();
@@ -780,9 +787,13 @@ public:
           break;
         }
 
-        int64_t spareMilliseconds = round(m_updateTicker.spareTime() * 1000);
-        if (spareMilliseconds > 0)
-          Thread::sleepPrecise(spareMilliseconds);
+        // Buffer swaps pace decoupled rendering, sleeping here as well would
+        // make presented frames uneven on displays faster than the update rate
+        if (!m_decoupledRendering || !m_windowVSync) {
+          int64_t spareMilliseconds = round(m_updateTicker.spareTime() * 1000);
+          if (spareMilliseconds > 0)
+            Thread::sleepPrecise(spareMilliseconds);
+        }
       }
     } catch (std::exception const& e) {
       Logger::error("Application: exception thrown!");
@@ -975,6 +986,10 @@ private:
       parent->m_maxFrameSkip = maxFrameSkip;
     }
 
+    void setDecoupledRendering(bool decoupledRendering) override {
+      parent->m_decoupledRendering = decoupledRendering;
+    }
+
     void setCursorVisible(bool cursorVisible) override {
       parent->m_cursorVisible = cursorVisible;
     }
@@ -1354,6 +1369,7 @@ private:
   String m_windowTitle = "Starbound";
   bool m_windowVSync = true;
   unsigned m_maxFrameSkip = 5;
+  bool m_decoupledRendering = false;
   bool m_cursorVisible = true;
   bool m_cursorHardware = true;
   bool m_acceptingTextInput = false;
@@ -1363,7 +1379,7 @@ private:
   const char* m_videoDriver;
   const char* m_audioDriver;
 
-  OpenGlRendererPtr m_renderer;
+  RendererPtr m_renderer;
   ApplicationUPtr m_application;
   PcPlatformServicesUPtr m_platformServices;
 };
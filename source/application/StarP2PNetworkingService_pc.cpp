@@ -8,9 +8,18 @@
 
 namespace Star {
 
+#ifdef STAR_ENABLE_STEAM_INTEGRATION
+
+// SendP2PPacket limits for each send type
+size_t const SteamMaxReliableMessageSize = 1024 * 1024;
+size_t const SteamMaxUnreliableMessageSize = 1200;
+
+#endif
+
 #ifdef STAR_ENABLE_DISCORD_INTEGRATION
 
 discord::NetworkChannelId const DiscordMainNetworkChannel = 0;
+size_t const DiscordMaxMessageSize = 1024 * 1024;
 
 #endif
 
@@ -274,12 +283,12 @@ bool PcP2PNetworkingService::SteamP2PSocket::isOpen() {
   return connected;
 }
 
-bool PcP2PNetworkingService::SteamP2PSocket::sendMessage(ByteArray const& message) {
+bool PcP2PNetworkingService::SteamP2PSocket::sendMessage(ByteArray const& message, bool reliable) {
   MutexLocker socketLocker(mutex);
   if (!connected)
     return false;
 
-  if (!SteamNetworking()->SendP2PPacket(steamId, message.ptr(), message.size(), k_EP2PSendReliable))
+  if (!SteamNetworking()->SendP2PPacket(steamId, message.ptr(), message.size(), reliable ? k_EP2PSendReliable : k_EP2PSendUnreliable))
     throw ApplicationException("SteamNetworking::SendP2PPacket unexpectedly returned false");
   return true;
 }
@@ -304,6 +313,10 @@ Maybe<ByteArray> PcP2PNetworkingService::SteamP2PSocket::receiveMessage() {
   return {};
 }
 
+size_t PcP2PNetworkingService::SteamP2PSocket::maxMessageSize(bool reliable) {
+  return reliable ? SteamMaxReliableMessageSize : SteamMaxUnreliableMessageSize;
+}
+
 auto PcP2PNetworkingService::createSteamP2PSocket(CSteamID steamId) -> unique_ptr<SteamP2PSocket> {
   if (auto oldSocket = m_steamOpenSockets.value(steamId.ConvertToUint64())) {
     MutexLocker socketLocker(oldSocket->mutex);
@@ -388,7 +401,7 @@ bool PcP2PNetworkingService::DiscordP2PSocket::isOpen() {
   return mode != DiscordSocketMode::Disconnected;
 }
 
-bool PcP2PNetworkingService::DiscordP2PSocket::sendMessage(ByteArray const& message) {
+bool PcP2PNetworkingService::DiscordP2PSocket::sendMessage(ByteArray const& message, bool) {
   MutexLocker discordLocker(parent->m_state->discordMutex);
   MutexLocker socketLocker(mutex);
   if (mode != DiscordSocketMode::Connected)
@@ -409,6 +422,11 @@ Maybe<ByteArray> PcP2PNetworkingService::DiscordP2PSocket::receiveMessage() {
     return {};
 }
 
+size_t PcP2PNetworkingService::DiscordP2PSocket::maxMessageSize(bool reliable) {
+  // Only the reliable main channel is opened
+  return reliable ? DiscordMaxMessageSize : 0;
+}
+
 void PcP2PNetworkingService::discordCloseSocket(DiscordP2PSocket* socket) {
   if (socket->mode != DiscordSocketMode::Disconnected) {
     m_discordOpenSockets.remove(socket->remoteUserId);
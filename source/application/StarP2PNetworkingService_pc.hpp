@@ -46,8 +46,9 @@ private:
     ~SteamP2PSocket();
 
     bool isOpen() override;
-    bool sendMessage(ByteArray const& message) override;
+    bool sendMessage(ByteArray const& message, bool reliable) override;
     Maybe<ByteArray> receiveMessage() override;
+    size_t maxMessageSize(bool reliable) override;
 
     Mutex mutex;
     PcP2PNetworkingService* parent = nullptr;
@@ -80,8 +81,9 @@ private:
     ~DiscordP2PSocket();
 
     bool isOpen() override;
-    bool sendMessage(ByteArray const& message) override;
+    bool sendMessage(ByteArray const& message, bool reliable) override;
     Maybe<ByteArray> receiveMessage() override;
+    size_t maxMessageSize(bool reliable) override;
 
     Mutex mutex;
     PcP2PNetworkingService* parent = nullptr;
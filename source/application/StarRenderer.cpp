@@ -9,7 +9,8 @@ EnumMap<TextureAddressing> const TextureAddressingNames{
 
 EnumMap<TextureFiltering> const TextureFilteringNames{
   {TextureFiltering::Nearest, "Nearest"},
-  {TextureFiltering::Linear, "Linear"}
+  {TextureFiltering::Linear, "Linear"},
+  {TextureFiltering::DistanceField, "DistanceField"}
 };
 
 RenderQuad::RenderQuad(Vec2F posA, Vec2F posB, Vec2F posC, Vec2F posD, Vec4B color, float param1) : texture() {
@@ -6,6 +6,7 @@
 #include "StarJson.hpp"
 #include "StarBiMap.hpp"
 #include "StarRefPtr.hpp"
+#include "StarImageProcessing.hpp"
 
 namespace Star {
 
@@ -14,6 +15,9 @@ STAR_EXCEPTION(RendererException, StarException);
 class Texture;
 typedef RefPtr<Texture> TexturePtr;
 
+class RenderColorTransform;
+typedef RefPtr<RenderColorTransform> RenderColorTransformPtr;
+
 STAR_CLASS(TextureGroup);
 STAR_CLASS(RenderBuffer);
 STAR_CLASS(Renderer);
@@ -26,7 +30,11 @@ extern EnumMap<TextureAddressing> const TextureAddressingNames;
 
 enum class TextureFiltering {
   Nearest,
-  Linear
+  Linear,
+  // Linearly filtered, with the alpha holding the distance to the nearest
+  // edge of a shape, 0.5 being the edge itself.  Drawn as a sharp white shape
+  // at any scale, tinted by the vertex color.
+  DistanceField
 };
 extern EnumMap<TextureFiltering> const TextureFilteringNames;
 
@@ -59,6 +67,26 @@ public:
   RenderVertex a, b, c;
 };
 
+// Color operations that a renderer can apply to a textured quad while drawing
+// it, rather than them being baked into a processed copy of its texture.  The
+// color replacement is applied first, then the hue, saturation and brightness
+// changes, then the fade.
+struct RenderColorOperations {
+  ColorReplaceMap colorReplace;
+  float hueShift = 0.0f;
+  float saturationShift = 0.0f;
+  float brightnessMultiply = 1.0f;
+  Vec3B fadeColor;
+  float fadeAmount = 0.0f;
+};
+
+// Renderer side copy of a RenderColorOperations, which any number of quads
+// may be drawn with.
+class RenderColorTransform : public RefCounter {
+public:
+  virtual ~RenderColorTransform() = default;
+};
+
 class RenderQuad {
 public:
   RenderQuad() = default;
@@ -71,6 +99,7 @@ public:
 
   TexturePtr texture;
   RenderVertex a, b, c, d;
+  RenderColorTransformPtr colorTransform;
 };
 
 class RenderPoly {
@@ -109,6 +138,11 @@ public:
 
   virtual TextureFiltering filtering() const = 0;
   virtual TexturePtr create(Image const& texture) = 0;
+
+  // Returns false once the renderer has spent its time budget for uploading
+  // new textures this frame.  Textures can still be created, but callers
+  // that are able to wait a frame for one should do so.
+  virtual bool uploadBudgetAvailable() const = 0;
 };
 
 class RenderBuffer {
@@ -118,10 +152,52 @@ public:
   // Transforms the given primitives into a form suitable for the underlying
   // graphics system and stores it for fast replaying.
   virtual void set(List<RenderPrimitive>& primitives) = 0;
+
+  // Keeps a copy of the data last handed to the graphics system, so that
+  // set only uploads the range of it that changed.  Worth it for long lived
+  // buffers that are rebuilt with small differences.
+  virtual void setRetainVertexData(bool retain) = 0;
 };
 
 typedef Variant<float, int, Vec4F, Vec3F, Vec2F, bool> RenderEffectParameter;
 
+struct RenderPointLight {
+  Vec2F position;
+  Vec3F light;
+  float beam;
+  float beamAngle;
+  float beamAmbience;
+  bool asSpread;
+};
+
+// A cellular lighting calculation for the renderer to finish, with the spread
+// lights already applied, calculated the same way as CellularLightingCalculator.
+struct RenderLightmap {
+  // Size of the whole calculation area
+  Vec2U size;
+  // Light in rgb and 1 in alpha for obstacles, in rows
+  List<Vec4F> cells;
+  // The part of the calculation area that becomes the lightmap
+  RectU region;
+  List<RenderPointLight> pointLights;
+  // How many cells the brightest cell can spread light to
+  unsigned spreadSteps;
+  // The "lighting" config
+  Json parameters;
+  // Optional, per lightmap cell, the bottom light mix of the liquid drawn
+  // there in rgb and its draw level in alpha, which darken the light the way
+  // TilePainter::adjustLighting does.
+  List<Vec4F> liquidLightMix;
+};
+
+// Work a renderer has handed to the GPU over one frame
+struct RenderStatistics {
+  size_t drawCalls = 0;
+  size_t triangles = 0;
+  size_t textureUploads = 0;
+  size_t textureUploadBytes = 0;
+};
+
 class Renderer {
 public:
   virtual ~Renderer() = default;
@@ -145,6 +221,10 @@ public:
   virtual Maybe<RenderEffectParameter> getEffectScriptableParameter(String const& effectName, String const& parameterName) = 0;
   virtual Maybe<VariantTypeIndex> getEffectScriptableParameterType(String const& effectName, String const& parameterName) = 0;
   virtual void setEffectTexture(String const& textureName, ImageView const& image) = 0;
+  // Calculates the lightmap into the named effect texture without it ever
+  // being on the CPU, if lightmapCalculationSupported()
+  virtual bool lightmapCalculationSupported() const = 0;
+  virtual void setEffectLightmap(String const& textureName, RenderLightmap const& lightmap) = 0;
   virtual bool switchEffectConfig(String const& name) = 0;
 
   // Any further rendering will be scissored based on this rect, specified in
@@ -161,11 +241,27 @@ public:
   virtual TextureGroupPtr createTextureGroup(TextureGroupSize size = TextureGroupSize::Medium, TextureFiltering filtering = TextureFiltering::Nearest) = 0;
   virtual RenderBufferPtr createRenderBuffer() = 0;
 
+  // Whether quads drawn with the current effect apply their color transform.
+  virtual bool colorTransformsSupported() const = 0;
+  // Returns nullptr if the operations cannot be expressed by the renderer,
+  // in which case they must be applied to the texture instead.
+  virtual RenderColorTransformPtr createColorTransform(RenderColorOperations const& operations) = 0;
+
   virtual List<RenderPrimitive>& immediatePrimitives() = 0;
   virtual void render(RenderPrimitive primitive) = 0;
   virtual void renderBuffer(RenderBufferPtr const& renderBuffer, Mat3F const& transformation = Mat3F::identity()) = 0;
 
   virtual void flush(Mat3F const& transformation = Mat3F::identity()) = 0;
+
+  // Called by the platform layer, which owns the window the renderer draws
+  // into.  Everything rendered between startFrame and finishFrame makes up
+  // one frame, which the platform then presents.
+  virtual void setScreenSize(Vec2U screenSize) = 0;
+  virtual void startFrame() = 0;
+  virtual void finishFrame() = 0;
+
+  // Statistics of the last frame finished with finishFrame
+  virtual RenderStatistics lastFrameStatistics() const = 0;
 };
 
 }
@@ -2,10 +2,25 @@
 #include "StarJsonExtra.hpp"
 #include "StarCasting.hpp"
 #include "StarLogging.hpp"
+#include "StarTime.hpp"
+#include "StarColor.hpp"
+#include "StarImageScaling.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
 size_t const MultiTextureCount = 4;
+// Texture array samplers take the units after the vertex buffer textures
+size_t const TextureArrayUnitOffset = MultiTextureCount;
+// The packed vertex data has room for this many texture array layers
+unsigned const MaxTextureArrayLayers = 256;
+size_t const PixelBufferCount = 4;
+unsigned const ColorTransformTableWidth = 64;
+unsigned const ColorTransformTableHeight = 4096;
+// Kept clear of the vertex buffer and effect texture units
+unsigned const ColorTransformTextureUnit = 15;
+// Smaller copies are cheaper to hand to glTexSubImage2D directly
+size_t const PixelBufferMinimumSize = 4096;
 
 char const* DefaultVertexShader = R"SHADER(
 #version 150
@@ -24,6 +39,9 @@ in int vertexData;
 
 out vec2 fragmentTextureCoordinate;
 flat out int fragmentTextureIndex;
+flat out int fragmentTextureLayer;
+flat out int fragmentDistanceField;
+flat out int fragmentColorTransform;
 out vec4 fragmentColor;
 
 void main() {
@@ -44,6 +62,10 @@ void main() {
     fragmentTextureCoordinate = vertexTextureCoordinate / textureSize0;
 
   fragmentTextureIndex = vertexTextureIndex;
+  // Textures in a texture array carry their layer, everything else -1
+  fragmentTextureLayer = ((vertexData >> 17) & 0x1) == 1 ? (vertexData >> 18) & 0xff : -1;
+  fragmentDistanceField = (vertexData >> 26) & 0x1;
+  fragmentColorTransform = (vertexData >> 5) & 0xfff;
   fragmentColor = vertexColor;
 }
 )SHADER";
@@ -55,16 +77,84 @@ uniform sampler2D texture0;
 uniform sampler2D texture1;
 uniform sampler2D texture2;
 uniform sampler2D texture3;
+uniform sampler2DArray textureArray0;
+uniform sampler2DArray textureArray1;
+uniform sampler2DArray textureArray2;
+uniform sampler2DArray textureArray3;
+uniform sampler2D colorTransforms;
 
 in vec2 fragmentTextureCoordinate;
 flat in int fragmentTextureIndex;
+flat in int fragmentTextureLayer;
+flat in int fragmentDistanceField;
+flat in int fragmentColorTransform;
 in vec4 fragmentColor;
 
 out vec4 outColor;
 
+vec3 rgbToHsv(vec3 c) {
+  vec4 k = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
+  vec4 p = mix(vec4(c.bg, k.wz), vec4(c.gb, k.xy), step(c.b, c.g));
+  vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
+  float d = q.x - min(q.w, q.y);
+  return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + 1.0e-10)), d / (q.x + 1.0e-10), q.x);
+}
+
+vec3 hsvToRgb(vec3 c) {
+  vec4 k = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+  vec3 p = abs(fract(c.xxx + k.xyz) * 6.0 - k.www);
+  return c.z * mix(k.xxx, clamp(p - k.xxx, 0.0, 1.0), c.y);
+}
+
+vec3 srgbToLinear(vec3 c) {
+  return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+vec3 linearToSrgb(vec3 c) {
+  return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+}
+
+vec4 applyColorTransform(vec4 color, int row) {
+  if (row == 0)
+    return color;
+
+  vec4 shifts = texelFetch(colorTransforms, ivec2(0, row), 0);
+  vec4 fade = texelFetch(colorTransforms, ivec2(1, row), 0);
+  int replaceCount = int(fade.a);
+  for (int i = 0; i < replaceCount; ++i) {
+    if (all(lessThan(abs(color - texelFetch(colorTransforms, ivec2(2 + i * 2, row), 0)), vec4(0.5 / 255.0)))) {
+      color = texelFetch(colorTransforms, ivec2(3 + i * 2, row), 0);
+      break;
+    }
+  }
+
+  if (shifts.x != 0.0 || shifts.y != 0.0 || shifts.z != 1.0) {
+    vec3 hsv = rgbToHsv(color.rgb);
+    hsv.x = fract(hsv.x + shifts.x);
+    hsv.y = clamp(hsv.y + shifts.y, 0.0, 1.0);
+    hsv.z = clamp(hsv.z * shifts.z, 0.0, 1.0);
+    color.rgb = hsvToRgb(hsv);
+  }
+
+  if (shifts.w > 0.0)
+    color.rgb = linearToSrgb(mix(srgbToLinear(color.rgb), fade.rgb, shifts.w));
+
+  return color;
+}
+
 void main() {
   vec4 texColor;
-  if (fragmentTextureIndex == 3)
+  if (fragmentTextureLayer >= 0) {
+    vec3 arrayCoordinate = vec3(fragmentTextureCoordinate, float(fragmentTextureLayer));
+    if (fragmentTextureIndex == 3)
+      texColor = texture(textureArray3, arrayCoordinate);
+    else if (fragmentTextureIndex == 2)
+      texColor = texture(textureArray2, arrayCoordinate);
+    else if (fragmentTextureIndex == 1)
+      texColor = texture(textureArray1, arrayCoordinate);
+    else
+      texColor = texture(textureArray0, arrayCoordinate);
+  } else if (fragmentTextureIndex == 3)
     texColor = texture(texture3, fragmentTextureCoordinate);
   else if (fragmentTextureIndex == 2)
     texColor = texture(texture2, fragmentTextureCoordinate);
@@ -73,6 +163,12 @@ void main() {
   else
     texColor = texture(texture0, fragmentTextureCoordinate);
 
+  if (fragmentDistanceField == 1) {
+    float edgeWidth = max(fwidth(texColor.a) * 0.5, 1.0e-4);
+    texColor = vec4(1.0, 1.0, 1.0, smoothstep(0.5 - edgeWidth, 0.5 + edgeWidth, texColor.a));
+  }
+
+  texColor = applyColorTransform(texColor, fragmentColorTransform);
   if (texColor.a <= 0.0)
     discard;
 
@@ -80,6 +176,234 @@ void main() {
 }
 )SHADER";
 
+// Draws a single triangle covering the whole render target
+char const* LightmapVertexShader = R"SHADER(
+#version 150
+
+void main() {
+  vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)SHADER";
+
+// One step of cellular light spread, gathering into each cell what the sweeps
+// in CellularLightArray would spread into it from its eight neighbors.
+char const* LightmapSpreadShader = R"SHADER(
+#version 150
+
+uniform sampler2D cells;
+uniform float dropoffAir;
+uniform float dropoffObstacle;
+
+out vec4 outColor;
+
+vec3 spread(vec3 source, vec3 dest, float drop) {
+  float maxChannel = max(source.r, max(source.g, source.b));
+  if (maxChannel <= 0.0)
+    return dest;
+  drop /= maxChannel;
+  return max(source - source * drop, dest);
+}
+
+void main() {
+  ivec2 size = textureSize(cells, 0);
+  ivec2 position = ivec2(gl_FragCoord.xy);
+  vec4 cell = texelFetch(cells, position, 0);
+  vec3 light = cell.rgb;
+  for (int dx = -1; dx <= 1; ++dx) {
+    for (int dy = -1; dy <= 1; ++dy) {
+      ivec2 neighbor = position + ivec2(dx, dy);
+      // Like the sweeps, cells on the edge only receive light
+      if ((dx == 0 && dy == 0) || neighbor.x <= 0 || neighbor.y <= 0 || neighbor.x >= size.x - 1 || neighbor.y >= size.y - 1)
+        continue;
+      vec4 source = texelFetch(cells, neighbor, 0);
+      float drop = source.a > 0.5 ? dropoffObstacle : dropoffAir;
+      if (dx != 0 && dy != 0)
+        drop *= 1.41421356;
+      light = spread(source.rgb, light, drop);
+    }
+  }
+  outColor = vec4(light, cell.a);
+}
+)SHADER";
+
+// Point lighting, the brightness limit and the liquid light mix for each
+// lightmap cell, the same as CellularLightArray does on the CPU.
+char const* LightmapPointShader = R"SHADER(
+#version 150
+
+uniform sampler2D cells;
+uniform sampler2D lights;
+uniform sampler2D lightMix;
+uniform int lightCount;
+uniform bool lightMixEnabled;
+uniform ivec2 regionMin;
+uniform float spreadMaxAir;
+uniform float spreadMaxObstacle;
+uniform float pointMaxAir;
+uniform float pointMaxObstacle;
+uniform float pointObstacleBoost;
+uniform bool pointAdditive;
+uniform float brightnessLimit;
+
+out vec4 outColor;
+
+bool obstacle(bool steep, int major, int minor) {
+  ivec2 position = steep ? ivec2(minor, major) : ivec2(major, minor);
+  return texelFetch(cells, clamp(position, ivec2(0), textureSize(cells, 0) - 1), 0).a > 0.5;
+}
+
+float fpart(float f) {
+  return f - floor(f);
+}
+
+float roundAway(float f) {
+  return f < 0.0 ? -floor(-f + 0.5) : floor(f + 0.5);
+}
+
+// Xiaolin Wu's line from start to end summing obstacles, with the steep case
+// run with x and y swapped
+float lineAttenuation(vec2 start, vec2 end, float perObstacleAttenuation, float maxAttenuation) {
+  vec2 p1 = start - 0.5;
+  vec2 p2 = end - 0.5;
+  bool steep = abs(p2.x - p1.x) < abs(p2.y - p1.y);
+  if (steep) {
+    p1 = p1.yx;
+    p2 = p2.yx;
+  }
+  if (p2.x < p1.x) {
+    vec2 p = p1;
+    p1 = p2;
+    p2 = p;
+  }
+
+  float gradient = (p2.y - p1.y) / (p2.x - p1.x);
+  float obstacleAttenuation = 0.0;
+
+  float xend = roundAway(p1.x);
+  float yend = p1.y + gradient * (xend - p1.x);
+  float xgap = 1.0 - fpart(p1.x + 0.5);
+  int xpxl1 = int(xend);
+  int ypxl1 = int(floor(yend));
+  if (obstacle(steep, xpxl1, ypxl1))
+    obstacleAttenuation += (1.0 - fpart(yend)) * xgap * perObstacleAttenuation;
+  if (obstacle(steep, xpxl1, ypxl1 + 1))
+    obstacleAttenuation += fpart(yend) * xgap * perObstacleAttenuation;
+  if (obstacleAttenuation >= maxAttenuation)
+    return maxAttenuation;
+
+  float intery = yend + gradient;
+
+  xend = roundAway(p2.x);
+  yend = p2.y + gradient * (xend - p2.x);
+  xgap = fpart(p2.x + 0.5);
+  int xpxl2 = int(xend);
+  int ypxl2 = int(floor(yend));
+  if (obstacle(steep, xpxl2, ypxl2))
+    obstacleAttenuation += (1.0 - fpart(yend)) * xgap * perObstacleAttenuation;
+  if (obstacle(steep, xpxl2, ypxl2 + 1))
+    obstacleAttenuation += fpart(yend) * xgap * perObstacleAttenuation;
+  if (obstacleAttenuation >= maxAttenuation)
+    return maxAttenuation;
+
+  for (int x = xpxl1 + 1; x < xpxl2; ++x) {
+    int interyIpart = int(floor(intery));
+    float interyFpart = intery - float(interyIpart);
+    if (obstacle(steep, x, interyIpart))
+      obstacleAttenuation += (1.0 - interyFpart) * perObstacleAttenuation;
+    if (obstacle(steep, x, interyIpart + 1))
+      obstacleAttenuation += interyFpart * perObstacleAttenuation;
+    if (obstacleAttenuation >= maxAttenuation)
+      return maxAttenuation;
+    intery += gradient;
+  }
+
+  return min(obstacleAttenuation, maxAttenuation);
+}
+
+vec3 subtractLight(vec3 light, float drop) {
+  float maxChannel = max(light.r, max(light.g, light.b));
+  if (maxChannel <= 0.0)
+    return light;
+  return max(light - light * (drop / maxChannel), vec3(0.0));
+}
+
+void main() {
+  ivec2 size = textureSize(cells, 0);
+  ivec2 position = ivec2(gl_FragCoord.xy) + regionMin;
+  vec2 blockPosition = vec2(position) + 0.5;
+  vec3 light = texelFetch(cells, position, 0).rgb;
+
+  for (int i = 0; i < lightCount; ++i) {
+    // Position, beam and beam angle, then the light and beam ambience, then
+    // whether it is spread like a spread light
+    vec4 placement = texelFetch(lights, ivec2(0, i), 0);
+    vec4 value = texelFetch(lights, ivec2(1, i), 0);
+    bool asSpread = texelFetch(lights, ivec2(2, i), 0).r > 0.5;
+
+    vec2 lightPosition = placement.xy;
+    if (lightPosition.x < 0.0 || lightPosition.x > float(size.x - 1) || lightPosition.y < 0.0 || lightPosition.y > float(size.y - 1))
+      continue;
+
+    float maxIntensity = max(value.r, max(value.g, value.b));
+    float maxRange = maxIntensity * (asSpread ? spreadMaxAir : pointMaxAir);
+    if (float(position.x) < floor(lightPosition.x - maxRange) || float(position.x) >= ceil(lightPosition.x + maxRange)
+        || float(position.y) < floor(lightPosition.y - maxRange) || float(position.y) >= ceil(lightPosition.y + maxRange))
+      continue;
+
+    vec2 relativeLightPosition = blockPosition - lightPosition;
+    float distance = length(relativeLightPosition);
+    if (distance == 0.0) {
+      light += value.rgb;
+      continue;
+    }
+
+    float attenuation = distance / (asSpread ? spreadMaxAir : pointMaxAir);
+    if (attenuation >= 1.0)
+      continue;
+
+    vec2 direction = relativeLightPosition / distance;
+    if (placement.z > 0.0) {
+      vec2 beamDirection = vec2(cos(placement.w), sin(placement.w));
+      attenuation += (1.0 - value.a) * clamp(placement.z * (1.0 - dot(direction, beamDirection)), 0.0, 1.0);
+      if (attenuation >= 1.0)
+        continue;
+    }
+
+    float remainingAttenuation = maxIntensity - attenuation;
+    if (remainingAttenuation <= 0.0)
+      continue;
+
+    float perBlockObstacleAttenuation = 1.0 / (asSpread ? spreadMaxObstacle : pointMaxObstacle);
+    float circularizedPerBlockObstacleAttenuation = perBlockObstacleAttenuation / max(abs(direction.x), abs(direction.y));
+    float blockAttenuation = lineAttenuation(blockPosition, lightPosition, circularizedPerBlockObstacleAttenuation, remainingAttenuation);
+    attenuation += blockAttenuation;
+    if (!asSpread)
+      attenuation += min(blockAttenuation, circularizedPerBlockObstacleAttenuation) * pointObstacleBoost;
+
+    if (attenuation < 1.0) {
+      vec3 newLight = subtractLight(value.rgb, attenuation);
+      if (!pointAdditive)
+        light = max(newLight, light);
+      else if (max(newLight.r, max(newLight.g, newLight.b)) > 0.0001)
+        light += asSpread ? newLight * 0.15 : newLight;
+    }
+  }
+
+  float intensity = max(light.r, max(light.g, light.b));
+  if (intensity > brightnessLimit)
+    light *= brightnessLimit / intensity;
+
+  if (lightMixEnabled) {
+    vec4 mix = texelFetch(lightMix, ivec2(gl_FragCoord.xy), 0);
+    float darknessLevel = (1.0 - (light.r + light.g + light.b) / 3.0) * mix.a;
+    light *= vec3(1.0 - darknessLevel) + mix.rgb * darknessLevel;
+  }
+
+  outColor = vec4(light, 1.0);
+}
+)SHADER";
+
 /*
 static void GLAPIENTRY GlMessageCallback(GLenum, GLenum type, GLuint, GLenum, GLsizei, const GLchar* message, const void* renderer) {
   if (type == GL_DEBUG_TYPE_ERROR) {
@@ -130,6 +454,8 @@ OpenGlRenderer::OpenGlRenderer() {
       TextureAddressing::Clamp,
       TextureFiltering::Nearest);
   m_immediateRenderBuffer = createGlRenderBuffer();
+  m_textureUploader = make_shared<GlTextureUploader>();
+  m_colorTransformTable = make_shared<GlColorTransformTable>();
 
   loadEffectConfig("internal", JsonObject(), {{"vertex", DefaultVertexShader}, {"fragment", DefaultFragmentShader}});
 
@@ -137,6 +463,8 @@ OpenGlRenderer::OpenGlRenderer() {
   m_useMultiTexturing = true;
   m_multiSampling = false;
   m_hdrSetting = true;
+  m_textureArraySetting = false;
+  m_atlasMipLevels = 0;
 
   logGlErrorSummary("OpenGL errors during renderer initialization");
 }
@@ -145,6 +473,8 @@ OpenGlRenderer::~OpenGlRenderer() {
   for (auto& effect : m_effects)
     glDeleteProgram(effect.second.program);
 
+  m_lightmapCalculation.reset();
+
   m_frameBuffers.clear();
   logGlErrorSummary("OpenGL errors during shutdown");
 }
@@ -324,6 +654,10 @@ void OpenGlRenderer::loadConfig(Json const& config) {
 
   }
   setScreenSize(m_screenSize);
+  m_textureUploader->usePixelBuffers = config.getBool("pixelBufferUploads", true);
+  m_textureUploader->frameBudget = config.getDouble("textureUploadBudget", 0.004);
+  m_textureArraySetting = config.getBool("textureArrays", false);
+  m_atlasMipLevels = min<unsigned>(config.getUInt("atlasMipLevels", 0), 4);
   m_config = config;
 }
 
@@ -394,6 +728,10 @@ void OpenGlRenderer::loadEffectConfig(String const& name, Json const& effectConf
   effect.program = m_program;
   effect.config = effectConfig;
   effect.includeVBTextures = effectConfig.getBool("includeVBTextures",true);
+  effect.colorTransforms = glGetUniformLocation(m_program, "colorTransforms") != -1;
+  effect.textureArrays = glGetUniformLocation(m_program, "textureArray0") != -1;
+  if (m_useTextureArrays.value(false) && effect.includeVBTextures && !effect.textureArrays)
+    Logger::warn("OpenGL effect '{}' does not declare textureArray samplers, but texture groups are using texture arrays", name);
   m_currentEffect = &effect;
   setupGlUniforms(effect, m_screenSize);
 
@@ -460,9 +798,12 @@ void OpenGlRenderer::loadEffectConfig(String const& name, Json const& effectConf
   }
 
   // Assign each texture parameter a texture unit starting with MultiTextureCount, the first
-  // few texture units are used by the primary textures being drawn.  Currently,
-  // maximum texture units are not checked.
-  unsigned parameterTextureUnit = effect.includeVBTextures ? MultiTextureCount : 0;
+  // few texture units are used by the primary textures being drawn, followed by
+  // the texture arrays if the effect samples them.  Currently, maximum texture
+  // units are not checked.
+  unsigned parameterTextureUnit = 0;
+  if (effect.includeVBTextures)
+    parameterTextureUnit = effect.textureArrays ? TextureArrayUnitOffset + MultiTextureCount : MultiTextureCount;
 
   for (auto const& p : effectConfig.getObject("effectTextures", {})) {
     EffectTexture effectTexture;
@@ -586,6 +927,11 @@ void OpenGlRenderer::setEffectTexture(String const& textureName, ImageView const
 
   flushImmediatePrimitives();
 
+  // Uploading changes the format of a texture that was calculated into
+  if (m_lightmapCalculation && ptr->textureValue && ptr->textureValue->textureId == m_lightmapCalculation->outputTexture)
+    m_lightmapCalculation->outputTexture = 0;
+
+  m_textureUploader->countUpload((size_t)image.size[0] * image.size[1] * bytesPerPixel(image.format));
   if (!ptr->textureValue || ptr->textureValue->textureId == 0) {
     ptr->textureValue = createGlTexture(image, ptr->textureAddressing, ptr->textureFiltering);
   } else {
@@ -600,6 +946,143 @@ void OpenGlRenderer::setEffectTexture(String const& textureName, ImageView const
   }
 }
 
+bool OpenGlRenderer::lightmapCalculationSupported() const {
+  // Float textures are core since OpenGL 3.0, so every context calculates them
+  return true;
+}
+
+void OpenGlRenderer::setEffectLightmap(String const& textureName, RenderLightmap const& lightmap) {
+  auto ptr = m_currentEffect->textures.ptr(textureName);
+  if (!ptr || lightmap.cells.empty())
+    return;
+
+  flushImmediatePrimitives();
+
+  if (!m_lightmapCalculation)
+    m_lightmapCalculation = make_unique<GlLightmapCalculation>();
+  auto& calculation = *m_lightmapCalculation;
+
+  GLint previousViewport[4];
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  GLint previousFrameBuffer = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFrameBuffer);
+  GLint previousVertexArray = 0;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+  GLint previousActiveTexture = 0;
+  glGetIntegerv(GL_ACTIVE_TEXTURE, &previousActiveTexture);
+  bool blend = glIsEnabled(GL_BLEND);
+  bool scissor = glIsEnabled(GL_SCISSOR_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_SCISSOR_TEST);
+  glBindVertexArray(calculation.vertexArray);
+
+  Vec2U size = lightmap.size;
+  if (calculation.cellSize != size) {
+    for (size_t i = 0; i < 2; ++i) {
+      glBindTexture(GL_TEXTURE_2D, calculation.cellTextures[i]);
+      uploadTextureImage(PixelFormat::RGBA_F, size, nullptr);
+    }
+    calculation.cellSize = size;
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, calculation.cellTextures[0]);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size[0], size[1], GL_RGBA, GL_FLOAT, lightmap.cells.ptr());
+  m_textureUploader->countUpload((size_t)size[0] * size[1] * sizeof(Vec4F));
+
+  auto const& parameters = lightmap.parameters;
+  float spreadMaxAir = parameters.getFloat("spreadMaxAir");
+  float spreadMaxObstacle = parameters.getFloat("spreadMaxObstacle");
+
+  glUseProgram(calculation.spreadProgram);
+  glUniform1i(glGetUniformLocation(calculation.spreadProgram, "cells"), 0);
+  glUniform1f(glGetUniformLocation(calculation.spreadProgram, "dropoffAir"), 1.0f / spreadMaxAir);
+  glUniform1f(glGetUniformLocation(calculation.spreadProgram, "dropoffObstacle"), 1.0f / spreadMaxObstacle);
+  glViewport(0, 0, size[0], size[1]);
+  size_t current = 0;
+  for (unsigned step = 0; step < lightmap.spreadSteps; ++step) {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, calculation.cellFrameBuffers[1 - current]);
+    glBindTexture(GL_TEXTURE_2D, calculation.cellTextures[current]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    ++m_frameStatistics.drawCalls;
+    ++m_frameStatistics.triangles;
+    current = 1 - current;
+  }
+
+  GLint maxTextureSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+  size_t lightCount = min<size_t>(lightmap.pointLights.size(), maxTextureSize);
+  List<Vec4F> lightData;
+  lightData.reserve(max<size_t>(lightCount, 1) * 3);
+  for (size_t i = 0; i < lightCount; ++i) {
+    auto const& light = lightmap.pointLights[i];
+    lightData.append(Vec4F(light.position[0], light.position[1], light.beam, light.beamAngle));
+    lightData.append(Vec4F(light.light[0], light.light[1], light.light[2], light.beamAmbience));
+    lightData.append(Vec4F(light.asSpread ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f));
+  }
+  if (lightData.empty())
+    lightData.resize(3, Vec4F());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, calculation.lightTexture);
+  uploadTextureImage(PixelFormat::RGBA_F, Vec2U(3, lightData.size() / 3), (uint8_t const*)lightData.ptr());
+
+  Vec2U outputSize = lightmap.region.size();
+  bool lightMixEnabled = lightmap.liquidLightMix.size() == outputSize[0] * outputSize[1];
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, calculation.lightMixTexture);
+  if (lightMixEnabled)
+    uploadTextureImage(PixelFormat::RGBA_F, outputSize, (uint8_t const*)lightmap.liquidLightMix.ptr());
+
+  // The effect texture becomes the float texture the output is drawn into
+  if (!ptr->textureValue || ptr->textureValue->textureId != calculation.outputTexture || calculation.outputSize != outputSize) {
+    if (!ptr->textureValue || ptr->textureValue->textureId != calculation.outputTexture)
+      ptr->textureValue = createGlTexture(ImageView(), ptr->textureAddressing, ptr->textureFiltering);
+    glBindTexture(GL_TEXTURE_2D, ptr->textureValue->textureId);
+    uploadTextureImage(PixelFormat::RGBA_F, outputSize, nullptr);
+    ptr->textureValue->textureSize = outputSize;
+    calculation.outputTexture = ptr->textureValue->textureId;
+    calculation.outputSize = outputSize;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, calculation.outputFrameBuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, calculation.outputTexture, 0);
+  }
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, calculation.cellTextures[current]);
+
+  GLuint program = calculation.pointProgram;
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "cells"), 0);
+  glUniform1i(glGetUniformLocation(program, "lights"), 1);
+  glUniform1i(glGetUniformLocation(program, "lightMix"), 2);
+  glUniform1i(glGetUniformLocation(program, "lightCount"), lightCount);
+  glUniform1i(glGetUniformLocation(program, "lightMixEnabled"), lightMixEnabled);
+  glUniform2i(glGetUniformLocation(program, "regionMin"), lightmap.region.xMin(), lightmap.region.yMin());
+  glUniform1f(glGetUniformLocation(program, "spreadMaxAir"), spreadMaxAir);
+  glUniform1f(glGetUniformLocation(program, "spreadMaxObstacle"), spreadMaxObstacle);
+  glUniform1f(glGetUniformLocation(program, "pointMaxAir"), parameters.getFloat("pointMaxAir"));
+  glUniform1f(glGetUniformLocation(program, "pointMaxObstacle"), parameters.getFloat("pointMaxObstacle"));
+  glUniform1f(glGetUniformLocation(program, "pointObstacleBoost"), parameters.getFloat("pointObstacleBoost"));
+  glUniform1i(glGetUniformLocation(program, "pointAdditive"), parameters.getBool("pointAdditive", false));
+  glUniform1f(glGetUniformLocation(program, "brightnessLimit"), parameters.getFloat("brightnessLimit"));
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, calculation.outputFrameBuffer);
+  glViewport(0, 0, outputSize[0], outputSize[1]);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  ++m_frameStatistics.drawCalls;
+  ++m_frameStatistics.triangles;
+
+  glUseProgram(m_program);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFrameBuffer);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+  glBindVertexArray(previousVertexArray);
+  glActiveTexture(previousActiveTexture);
+  if (blend)
+    glEnable(GL_BLEND);
+  if (scissor)
+    glEnable(GL_SCISSOR_TEST);
+
+  if (ptr->textureSizeUniform != -1)
+    glUniform2f(ptr->textureSizeUniform, outputSize[0], outputSize[1]);
+}
+
 bool OpenGlRenderer::switchEffectConfig(String const& name) {
   flushImmediatePrimitives();
   auto find = m_effects.find(name);
@@ -678,6 +1161,7 @@ void OpenGlRenderer::setScissorRect(Maybe<RectI> const& scissorRect) {
 }
 
 TexturePtr OpenGlRenderer::createTexture(Image const& texture, TextureAddressing addressing, TextureFiltering filtering) {
+  m_textureUploader->countUpload((size_t)texture.width() * texture.height() * texture.bytesPerPixel());
   return createGlTexture(texture, addressing, filtering);
 }
 
@@ -732,8 +1216,28 @@ TextureGroupPtr OpenGlRenderer::createTextureGroup(TextureGroupSize textureSize,
 
   Logger::info("detected supported OpenGL texture size {}, using atlasNumCells {}", maxTextureSize, atlasNumCells);
 
+  if (!m_useTextureArrays) {
+    // Every effect drawing vertex buffer textures must be able to sample
+    // texture arrays before atlases can be put in them
+    m_useTextureArrays = m_textureArraySetting;
+    for (auto const& effect : m_effects) {
+      if (effect.second.includeVBTextures && !effect.second.textureArrays)
+        m_useTextureArrays = false;
+    }
+    Logger::info("OpenGL texture arrays {}", *m_useTextureArrays ? "enabled" : "disabled");
+  }
+
   auto glTextureGroup = make_shared<GlTextureGroup>(atlasNumCells);
   glTextureGroup->textureAtlasSet.textureFiltering = filtering;
+  if (*m_useTextureArrays) {
+    GLint maxArrayLayers;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxArrayLayers);
+    glTextureGroup->textureAtlasSet.maxArrayLayers = min<unsigned>(maxArrayLayers, MaxTextureArrayLayers);
+  }
+  glTextureGroup->textureAtlasSet.uploader = m_textureUploader;
+  // Only large groups hold world sprites that are drawn zoomed out
+  if (textureSize == TextureGroupSize::Large && filtering != TextureFiltering::DistanceField)
+    glTextureGroup->textureAtlasSet.mipLevels = m_atlasMipLevels;
   m_liveTextureGroups.append(glTextureGroup);
   return glTextureGroup;
 }
@@ -742,6 +1246,50 @@ RenderBufferPtr OpenGlRenderer::createRenderBuffer() {
   return createGlRenderBuffer();
 }
 
+bool OpenGlRenderer::colorTransformsSupported() const {
+  return m_currentEffect && m_currentEffect->colorTransforms;
+}
+
+RenderColorTransformPtr OpenGlRenderer::createColorTransform(RenderColorOperations const& operations) {
+  if (2 + operations.colorReplace.size() * 2 > ColorTransformTableWidth)
+    return {};
+
+  if (!m_colorTransformTable->texture) {
+    glGenTextures(1, &m_colorTransformTable->texture);
+    if (m_colorTransformTable->texture == 0)
+      throw RendererException("Could not generate texture in OpenGlRenderer::createColorTransform()");
+    glActiveTexture(GL_TEXTURE0 + ColorTransformTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_colorTransformTable->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, ColorTransformTableWidth, ColorTransformTableHeight, 0, GL_RGBA, GL_FLOAT, nullptr);
+  }
+
+  auto row = m_colorTransformTable->allocateRow();
+  if (!row)
+    return {};
+
+  auto toVec4F = [](Vec4B const& color) { return Vec4F(color) / 255.0f; };
+  auto fadeColor = Color::rgb(operations.fadeColor).toLinear().toRgbaF();
+
+  List<Vec4F> texels;
+  texels.append(Vec4F(operations.hueShift, operations.saturationShift, operations.brightnessMultiply, operations.fadeAmount));
+  texels.append(Vec4F(fadeColor[0], fadeColor[1], fadeColor[2], operations.colorReplace.size()));
+  for (auto const& p : operations.colorReplace) {
+    texels.append(toVec4F(p.first));
+    texels.append(toVec4F(p.second));
+  }
+
+  glActiveTexture(GL_TEXTURE0 + ColorTransformTextureUnit);
+  glBindTexture(GL_TEXTURE_2D, m_colorTransformTable->texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, *row, texels.size(), 1, GL_RGBA, GL_FLOAT, texels.ptr());
+
+  auto colorTransform = make_ref<GlColorTransform>();
+  colorTransform->table = m_colorTransformTable;
+  colorTransform->row = *row;
+  return colorTransform;
+}
+
 List<RenderPrimitive>& OpenGlRenderer::immediatePrimitives() {
   return m_immediatePrimitives;
 }
@@ -756,6 +1304,7 @@ void OpenGlRenderer::renderBuffer(RenderBufferPtr const& renderBuffer, Mat3F con
 }
 
 void OpenGlRenderer::flush(Mat3F const& transformation) {
+  STAR_PROFILE_SCOPE("OpenGlRenderer::flush");
   flushImmediatePrimitives(transformation);
 }
 
@@ -797,6 +1346,8 @@ void OpenGlRenderer::setScreenSize(Vec2U screenSize) {
 }
 
 void OpenGlRenderer::startFrame() {
+  m_textureUploader->frameTime = 0.0;
+
   if (m_scissorRect)
     glDisable(GL_SCISSOR_TEST);
   
@@ -823,6 +1374,7 @@ void OpenGlRenderer::startFrame() {
 }
 
 void OpenGlRenderer::finishFrame() {
+  STAR_PROFILE_SCOPE("OpenGlRenderer::finishFrame");
   flushImmediatePrimitives();
   // Make sure that the immediate render buffer doesn't needlessly lock texutres
   // from being compressed.
@@ -845,12 +1397,31 @@ void OpenGlRenderer::finishFrame() {
 
   if (DebugEnabled)
     logGlErrorSummary("OpenGL errors this frame");
+
+  m_lastFrameStatistics = take(m_frameStatistics);
+  m_lastFrameStatistics.textureUploads = take(m_textureUploader->frameUploads);
+  m_lastFrameStatistics.textureUploadBytes = take(m_textureUploader->frameUploadBytes);
+}
+
+RenderStatistics OpenGlRenderer::lastFrameStatistics() const {
+  return m_lastFrameStatistics;
 }
 
 OpenGlRenderer::GlTextureAtlasSet::GlTextureAtlasSet(unsigned atlasNumCells)
   : TextureAtlasSet(16, atlasNumCells) {}
 
-GLuint OpenGlRenderer::GlTextureAtlasSet::createAtlasTexture(Vec2U const& size, PixelFormat pixelFormat) {
+OpenGlRenderer::GlTextureAtlasSet::~GlTextureAtlasSet() {
+  if (arrayTexture)
+    glDeleteTextures(1, &arrayTexture);
+}
+
+auto OpenGlRenderer::GlTextureAtlasSet::createAtlasTexture(Vec2U const& size, PixelFormat pixelFormat) -> GlAtlasTexture {
+  if (pixelFormat == PixelFormat::RGBA32 && (!freeArrayLayers.empty() || arrayLayers < maxArrayLayers)) {
+    if (freeArrayLayers.empty())
+      growTextureArray(size);
+    return GlAtlasTexture{0, freeArrayLayers.takeLast()};
+  }
+
   GLuint glTextureId;
   glGenTextures(1, &glTextureId);
   if (glTextureId == 0)
@@ -860,26 +1431,28 @@ GLuint OpenGlRenderer::GlTextureAtlasSet::createAtlasTexture(Vec2U const& size,
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, textureFiltering == TextureFiltering::Nearest ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels);
 
-  if (textureFiltering == TextureFiltering::Nearest) {
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  } else {
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  }
-
-  uploadTextureImage(pixelFormat, size, nullptr);
-  return glTextureId;
+  for (unsigned level = 0; level <= mipLevels; ++level)
+    uploadTextureImage(pixelFormat, Vec2U(size[0] >> level, size[1] >> level), nullptr, level);
+  return GlAtlasTexture{glTextureId, 0};
 }
 
-void OpenGlRenderer::GlTextureAtlasSet::destroyAtlasTexture(GLuint const& glTexture) {
-  glDeleteTextures(1, &glTexture);
+void OpenGlRenderer::GlTextureAtlasSet::destroyAtlasTexture(GlAtlasTexture const& atlasTexture) {
+  if (atlasTexture.texture)
+    glDeleteTextures(1, &atlasTexture.texture);
+  else
+    freeArrayLayers.append(atlasTexture.layer);
 }
 
 void OpenGlRenderer::GlTextureAtlasSet::copyAtlasPixels(
-    GLuint const& glTexture, Vec2U const& bottomLeft, Image const& image) {
-  glBindTexture(GL_TEXTURE_2D, glTexture);
+    GlAtlasTexture const& atlasTexture, Vec2U const& bottomLeft, Image const& image) {
+  if (atlasTexture.texture)
+    glBindTexture(GL_TEXTURE_2D, atlasTexture.texture);
+  else
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
 
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   GLenum format;
@@ -895,7 +1468,153 @@ void OpenGlRenderer::GlTextureAtlasSet::copyAtlasPixels(
   else
     throw RendererException("Unsupported texture format in OpenGlRenderer::TextureGroup::copyAtlasPixels");
 
-  glTexSubImage2D(GL_TEXTURE_2D, 0, bottomLeft[0], bottomLeft[1], image.width(), image.height(), format, GL_UNSIGNED_BYTE, image.data());
+  Maybe<unsigned> layer;
+  if (!atlasTexture.texture)
+    layer = atlasTexture.layer;
+  uploader->copyPixels(bottomLeft, image, format, layer);
+
+  if (mipLevels == 0)
+    return;
+
+  // Textures are placed on 16 pixel cells, so each level can be made from
+  // only the cells the image takes.  Those are filled out with the image's
+  // edge pixels first, so smaller levels never average in whatever was left
+  // in the atlas around it.
+  unsigned alignment = 1 << mipLevels;
+  Image mip(Vec2U((image.width() + alignment - 1) / alignment * alignment, (image.height() + alignment - 1) / alignment * alignment));
+  for (unsigned y = 0; y < mip.height(); ++y) {
+    for (unsigned x = 0; x < mip.width(); ++x)
+      mip.set(x, y, image.clamp(x, y));
+  }
+
+  for (unsigned level = 1; level <= mipLevels; ++level) {
+    mip = scaleHalf(mip);
+    uploader->copyPixels(Vec2U(bottomLeft[0] >> level, bottomLeft[1] >> level), mip, GL_RGBA, layer, level);
+  }
+}
+
+GLint OpenGlRenderer::GlTextureAtlasSet::minFilter() const {
+  if (textureFiltering == TextureFiltering::Nearest)
+    return mipLevels ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST;
+  else
+    return mipLevels ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+}
+
+void OpenGlRenderer::GlTextureAtlasSet::growTextureArray(Vec2U const& size) {
+  unsigned newLayers = min(max(arrayLayers * 2, 1u), maxArrayLayers);
+
+  GLuint newArrayTexture;
+  glGenTextures(1, &newArrayTexture);
+  if (newArrayTexture == 0)
+    throw RendererException("Could not generate texture array in OpenGlRenderer::TextureGroup::growTextureArray()");
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, newArrayTexture);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter());
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, textureFiltering == TextureFiltering::Nearest ? GL_NEAREST : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipLevels);
+  for (unsigned level = 0; level <= mipLevels; ++level)
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size[0] >> level, size[1] >> level, newLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+  if (arrayTexture) {
+    // Atlases may be created in the middle of drawing a frame, so the read
+    // framebuffer has to be put back afterwards
+    GLint previousReadFrameBuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFrameBuffer);
+    GLuint copyFrameBuffer;
+    glGenFramebuffers(1, &copyFrameBuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFrameBuffer);
+    for (unsigned layer = 0; layer < arrayLayers; ++layer) {
+      for (unsigned level = 0; level <= mipLevels; ++level) {
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, arrayTexture, level, layer);
+        glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, 0, 0, size[0] >> level, size[1] >> level);
+      }
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFrameBuffer);
+    glDeleteFramebuffers(1, &copyFrameBuffer);
+    glDeleteTextures(1, &arrayTexture);
+  }
+
+  // Lowest layers are handed out first
+  for (unsigned layer = newLayers; layer > arrayLayers; --layer)
+    freeArrayLayers.append(layer - 1);
+
+  arrayTexture = newArrayTexture;
+  arrayLayers = newLayers;
+}
+
+OpenGlRenderer::GlTextureUploader::~GlTextureUploader() {
+  if (!pixelBuffers.empty())
+    glDeleteBuffers(pixelBuffers.size(), pixelBuffers.ptr());
+}
+
+void OpenGlRenderer::GlTextureUploader::copyPixels(Vec2U const& bottomLeft, Image const& image, GLenum format, Maybe<unsigned> layer, GLint level) {
+  auto texSubImage = [&](void const* data) {
+    if (layer)
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, bottomLeft[0], bottomLeft[1], *layer, image.width(), image.height(), 1, format, GL_UNSIGNED_BYTE, data);
+    else
+      glTexSubImage2D(GL_TEXTURE_2D, level, bottomLeft[0], bottomLeft[1], image.width(), image.height(), format, GL_UNSIGNED_BYTE, data);
+  };
+
+  size_t size = (size_t)image.width() * image.height() * image.bytesPerPixel();
+  countUpload(size);
+  if (usePixelBuffers && size >= PixelBufferMinimumSize) {
+    if (pixelBuffers.empty()) {
+      pixelBuffers.resize(PixelBufferCount);
+      glGenBuffers(pixelBuffers.size(), pixelBuffers.ptr());
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextPixelBuffer]);
+    nextPixelBuffer = (nextPixelBuffer + 1) % pixelBuffers.size();
+
+    // Orphan the previous storage, which the driver keeps alive for as long
+    // as an earlier upload is still reading from it.
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    bool uploaded = false;
+    if (void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)) {
+      memcpy(mapped, image.data(), size);
+      if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+        texSubImage(nullptr);
+        uploaded = true;
+      }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (uploaded)
+      return;
+  }
+
+  texSubImage(image.data());
+}
+
+bool OpenGlRenderer::GlTextureUploader::budgetAvailable() const {
+  return frameTime < frameBudget;
+}
+
+void OpenGlRenderer::GlTextureUploader::countUpload(size_t bytes) {
+  ++frameUploads;
+  frameUploadBytes += bytes;
+}
+
+OpenGlRenderer::GlColorTransformTable::~GlColorTransformTable() {
+  if (texture)
+    glDeleteTextures(1, &texture);
+}
+
+Maybe<unsigned> OpenGlRenderer::GlColorTransformTable::allocateRow() {
+  if (!freeRows.empty())
+    return freeRows.takeLast();
+  if (nextRow < ColorTransformTableHeight)
+    return nextRow++;
+  return {};
+}
+
+void OpenGlRenderer::GlColorTransformTable::freeRow(unsigned row) {
+  freeRows.append(row);
+}
+
+OpenGlRenderer::GlColorTransform::~GlColorTransform() {
+  table->freeRow(row);
 }
 
 OpenGlRenderer::GlTextureGroup::GlTextureGroup(unsigned atlasNumCells)
@@ -910,17 +1629,28 @@ TextureFiltering OpenGlRenderer::GlTextureGroup::filtering() const {
 }
 
 TexturePtr OpenGlRenderer::GlTextureGroup::create(Image const& texture) {
+  auto startSeconds = Time::monotonicTime();
+
+  TexturePtr created;
   // If the image is empty, or would not fit in the texture atlas with border
   // pixels, just create a regular texture
   Vec2U atlasTextureSize = textureAtlasSet.atlasTextureSize();
-  if (texture.empty() || texture.width() + 2 > atlasTextureSize[0] || texture.height() + 2 > atlasTextureSize[1])
-    return createGlTexture(texture, TextureAddressing::Clamp, textureAtlasSet.textureFiltering);
+  if (texture.empty() || texture.width() + 2 > atlasTextureSize[0] || texture.height() + 2 > atlasTextureSize[1]) {
+    textureAtlasSet.uploader->countUpload((size_t)texture.width() * texture.height() * texture.bytesPerPixel());
+    created = createGlTexture(texture, TextureAddressing::Clamp, textureAtlasSet.textureFiltering);
+  } else {
+    auto glGroupedTexture = make_ref<GlGroupedTexture>();
+    glGroupedTexture->parentGroup = shared_from_this();
+    glGroupedTexture->parentAtlasTexture = textureAtlasSet.addTexture(texture);
+    created = glGroupedTexture;
+  }
 
-  auto glGroupedTexture = make_ref<GlGroupedTexture>();
-  glGroupedTexture->parentGroup = shared_from_this();
-  glGroupedTexture->parentAtlasTexture = textureAtlasSet.addTexture(texture);
+  textureAtlasSet.uploader->frameTime += Time::monotonicTime() - startSeconds;
+  return created;
+}
 
-  return glGroupedTexture;
+bool OpenGlRenderer::GlTextureGroup::uploadBudgetAvailable() const {
+  return textureAtlasSet.uploader->budgetAvailable();
 }
 
 OpenGlRenderer::GlGroupedTexture::~GlGroupedTexture() {
@@ -941,7 +1671,8 @@ TextureAddressing OpenGlRenderer::GlGroupedTexture::addressing() const {
 }
 
 GLuint OpenGlRenderer::GlGroupedTexture::glTextureId() const {
-  return parentAtlasTexture->atlasTexture();
+  auto const& atlasTexture = parentAtlasTexture->atlasTexture();
+  return atlasTexture.texture ? atlasTexture.texture : parentGroup->textureAtlasSet.arrayTexture;
 }
 
 Vec2U OpenGlRenderer::GlGroupedTexture::glTextureSize() const {
@@ -952,6 +1683,16 @@ Vec2U OpenGlRenderer::GlGroupedTexture::glTextureCoordinateOffset() const {
   return parentAtlasTexture->atlasTextureCoordinates().min();
 }
 
+auto OpenGlRenderer::GlGroupedTexture::glTextureArraySet() const -> GlTextureAtlasSet const* {
+  if (parentAtlasTexture->atlasTexture().texture)
+    return nullptr;
+  return &parentGroup->textureAtlasSet;
+}
+
+unsigned OpenGlRenderer::GlGroupedTexture::glTextureLayer() const {
+  return parentAtlasTexture->atlasTexture().layer;
+}
+
 void OpenGlRenderer::GlGroupedTexture::incrementBufferUseCount() {
   if (bufferUseCount == 0)
     parentAtlasTexture->setLocked(true);
@@ -965,6 +1706,14 @@ void OpenGlRenderer::GlGroupedTexture::decrementBufferUseCount() {
   --bufferUseCount;
 }
 
+auto OpenGlRenderer::GlTexture::glTextureArraySet() const -> GlTextureAtlasSet const* {
+  return nullptr;
+}
+
+unsigned OpenGlRenderer::GlTexture::glTextureLayer() const {
+  return 0;
+}
+
 OpenGlRenderer::GlLoneTexture::~GlLoneTexture() {
   if (textureId != 0)
     glDeleteTextures(1, &textureId);
@@ -1008,56 +1757,87 @@ OpenGlRenderer::GlRenderBuffer::~GlRenderBuffer() {
   glDeleteVertexArrays(1, &vertexArray);
 }
 
+void OpenGlRenderer::GlRenderBuffer::setRetainVertexData(bool retain) {
+  retainVertexData = retain;
+  if (!retain) {
+    for (auto& vb : vertexBuffers)
+      vb.vertexData.clear();
+  }
+}
+
 void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
   for (auto const& texture : usedTextures) {
     if (auto gt = as<GlGroupedTexture>(texture.get()))
       gt->decrementBufferUseCount();
   }
   usedTextures.clear();
+  usedColorTransforms.clear();
 
   auto oldVertexBuffers = take(vertexBuffers);
 
   List<GLuint> currentTextures;
   List<Vec2U> currentTextureSizes;
+  List<GlTextureAtlasSet const*> currentTextureArraySets;
   size_t currentVertexCount = 0;
   glBindVertexArray(vertexArray);
   auto finishCurrentBuffer = [&]() {
     if (currentVertexCount > 0) {
       GlVertexBuffer vb;
       for (size_t i = 0; i < currentTextures.size(); ++i) {
-        vb.textures.append(GlVertexBufferTexture{currentTextures[i], currentTextureSizes[i]});
+        vb.textures.append(GlVertexBufferTexture{currentTextures[i], currentTextureSizes[i], currentTextureArraySets[i]});
       }
       vb.vertexCount = currentVertexCount;
       if (!oldVertexBuffers.empty()) {
-        auto oldVb = oldVertexBuffers.takeLast();
+        // Old buffers are reused in the same order, so that retained data
+        // lines up with what is being replaced.
+        auto oldVb = oldVertexBuffers.takeAt(0);
         vb.vertexBuffer = oldVb.vertexBuffer;
         glBindBuffer(GL_ARRAY_BUFFER, vb.vertexBuffer);
-        if (oldVb.vertexCount >= vb.vertexCount)
-          glBufferSubData(GL_ARRAY_BUFFER, 0, accumulationBuffer.size(), accumulationBuffer.ptr());
-        else
+        if (oldVb.vertexCount >= vb.vertexCount) {
+          size_t begin = 0;
+          size_t end = accumulationBuffer.size();
+          if (retainVertexData && !oldVb.vertexData.empty()) {
+            auto const& oldData = oldVb.vertexData;
+            while (begin < end && begin < oldData.size() && oldData[begin] == accumulationBuffer[begin])
+              ++begin;
+            if (oldData.size() == accumulationBuffer.size()) {
+              while (end > begin && oldData[end - 1] == accumulationBuffer[end - 1])
+                --end;
+            }
+          }
+          if (begin < end)
+            glBufferSubData(GL_ARRAY_BUFFER, begin, end - begin, accumulationBuffer.ptr() + begin);
+        } else {
           glBufferData(GL_ARRAY_BUFFER, accumulationBuffer.size(), accumulationBuffer.ptr(), GL_STREAM_DRAW);
+        }
       } else {
         glGenBuffers(1, &vb.vertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, vb.vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, accumulationBuffer.size(), accumulationBuffer.ptr(), GL_STREAM_DRAW);
       }
 
+      if (retainVertexData)
+        vb.vertexData = accumulationBuffer;
       vertexBuffers.emplace_back(std::move(vb));
 
       currentTextures.clear();
       currentTextureSizes.clear();
+      currentTextureArraySets.clear();
       accumulationBuffer.clear();
       currentVertexCount = 0;
     }
   };
 
   auto textureCount = useMultiTexturing ? MultiTextureCount : 1;
-  auto addCurrentTexture = [&](TexturePtr texture) -> pair<uint8_t, Vec2F> {
+  // Every atlas that lives in a texture array shares the array's texture id,
+  // so those only take up one texture slot between them
+  auto addCurrentTexture = [&](TexturePtr texture) -> tuple<uint8_t, Vec2F, Maybe<unsigned>, bool> {
     if (!texture)
       texture = whiteTexture;
 
     auto glTexture = as<GlTexture>(texture.get());
     GLuint glTextureId = glTexture->glTextureId();
+    auto arraySet = glTexture->glTextureArraySet();
 
     auto textureIndex = currentTextures.indexOf(glTextureId);
     if (textureIndex == NPos) {
@@ -1067,15 +1847,24 @@ void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
       textureIndex = currentTextures.size();
       currentTextures.append(glTextureId);
       currentTextureSizes.append(glTexture->glTextureSize());
+      currentTextureArraySets.append(arraySet);
     }
 
+    Maybe<unsigned> textureLayer;
+    if (arraySet)
+      textureLayer = glTexture->glTextureLayer();
+    bool distanceField = texture->filtering() == TextureFiltering::DistanceField;
+
     if (auto gt = as<GlGroupedTexture>(texture.get()))
       gt->incrementBufferUseCount();
     usedTextures.add(std::move(texture));
 
-    return {float(textureIndex), Vec2F(glTexture->glTextureCoordinateOffset())};
+    return {float(textureIndex), Vec2F(glTexture->glTextureCoordinateOffset()), textureLayer, distanceField};
   };
 
+  unsigned colorTransformRow = 0;
+  Maybe<unsigned> textureLayer;
+  bool distanceField = false;
   auto appendBufferVertex = [&](RenderVertex const& v, uint8_t textureIndex, Vec2F textureCoordinateOffset, RenderVertex const& prev, RenderVertex const& next) {
     size_t off = accumulationBuffer.size();
     accumulationBuffer.resize(accumulationBuffer.size() + sizeof(GlRenderVertex));
@@ -1090,6 +1879,10 @@ void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
     // it'd cause slight visual issues with sprites rotating around a point.
     glv.pack.vars.rX = min(abs(glv.pos.x() - prev.screenCoordinate.x()), abs(glv.pos.x() - next.screenCoordinate.x())) < 0.001f;
     glv.pack.vars.rY = min(abs(glv.pos.y() - prev.screenCoordinate.y()), abs(glv.pos.y() - next.screenCoordinate.y())) < 0.001f;
+    glv.pack.vars.colorTransform = colorTransformRow;
+    glv.pack.vars.textureArray = textureLayer.isValid();
+    glv.pack.vars.textureLayer = textureLayer.value();
+    glv.pack.vars.distanceField = distanceField;
     glv.pack.vars.unused = 0;
     ++currentVertexCount;
     return glv;
@@ -1098,15 +1891,20 @@ void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
   uint8_t textureIndex = 0;
   Vec2F textureOffset = {};
   for (auto& primitive : primitives) {
+    colorTransformRow = 0;
     if (auto tri = primitive.ptr<RenderTriangle>()) {
-      tie(textureIndex, textureOffset) = addCurrentTexture(std::move(tri->texture));
+      tie(textureIndex, textureOffset, textureLayer, distanceField) = addCurrentTexture(std::move(tri->texture));
 
       appendBufferVertex(tri->a, textureIndex, textureOffset, tri->c, tri->b);
       appendBufferVertex(tri->b, textureIndex, textureOffset, tri->a, tri->c);
       appendBufferVertex(tri->c, textureIndex, textureOffset, tri->b, tri->a);
 
     } else if (auto quad = primitive.ptr<RenderQuad>()) {
-      tie(textureIndex, textureOffset) = addCurrentTexture(std::move(quad->texture));
+      tie(textureIndex, textureOffset, textureLayer, distanceField) = addCurrentTexture(std::move(quad->texture));
+      if (auto colorTransform = as<GlColorTransform>(quad->colorTransform.get())) {
+        colorTransformRow = colorTransform->row;
+        usedColorTransforms.append(std::move(quad->colorTransform));
+      }
 
       // = prev and next are altered - the diagonal across the quad is bad for the rounding check
       appendBufferVertex(quad->a, textureIndex, textureOffset, quad->d, quad->b);
@@ -1119,7 +1917,7 @@ void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
 
     } else if (auto poly = primitive.ptr<RenderPoly>()) {
       if (poly->vertexes.size() > 2) {
-        tie(textureIndex, textureOffset) = addCurrentTexture(std::move(poly->texture));
+        tie(textureIndex, textureOffset, textureLayer, distanceField) = addCurrentTexture(std::move(poly->texture));
 
         for (size_t i = 1; i < poly->vertexes.size() - 1; ++i) {
             RenderVertex const& a = poly->vertexes[0],
@@ -1140,6 +1938,92 @@ void OpenGlRenderer::GlRenderBuffer::set(List<RenderPrimitive>& primitives) {
     glDeleteBuffers(1, &vb.vertexBuffer);
 }
 
+OpenGlRenderer::GlLightmapCalculation::GlLightmapCalculation() {
+  spreadProgram = compileGlProgram(LightmapVertexShader, LightmapSpreadShader);
+  pointProgram = compileGlProgram(LightmapVertexShader, LightmapPointShader);
+  glGenVertexArrays(1, &vertexArray);
+
+  auto createTexture = [](GLuint& texture) {
+    glGenTextures(1, &texture);
+    if (texture == 0)
+      throw RendererException("Could not generate OpenGL texture for lightmap calculation");
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  };
+
+  for (size_t i = 0; i < 2; ++i) {
+    createTexture(cellTextures[i]);
+    uploadTextureImage(PixelFormat::RGBA_F, Vec2U(1, 1), nullptr);
+    glGenFramebuffers(1, &cellFrameBuffers[i]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, cellFrameBuffers[i]);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cellTextures[i], 0);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      throw RendererException("OpenGL lightmap framebuffer is not complete!");
+  }
+  cellSize = Vec2U(1, 1);
+
+  createTexture(lightTexture);
+  createTexture(lightMixTexture);
+  glGenFramebuffers(1, &outputFrameBuffer);
+}
+
+OpenGlRenderer::GlLightmapCalculation::~GlLightmapCalculation() {
+  glDeleteFramebuffers(2, cellFrameBuffers);
+  glDeleteFramebuffers(1, &outputFrameBuffer);
+  glDeleteTextures(2, cellTextures);
+  glDeleteTextures(1, &lightTexture);
+  glDeleteTextures(1, &lightMixTexture);
+  glDeleteVertexArrays(1, &vertexArray);
+  glDeleteProgram(spreadProgram);
+  glDeleteProgram(pointProgram);
+}
+
+GLuint OpenGlRenderer::compileGlProgram(char const* vertexSource, char const* fragmentSource) {
+  GLint status = 0;
+  char logBuffer[1024];
+
+  auto compileShader = [&](GLenum type, char const* source) -> GLuint {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+      glGetShaderInfoLog(shader, sizeof(logBuffer), NULL, logBuffer);
+      glDeleteShader(shader);
+      throw RendererException(strf("Failed to compile shader: {}\n", logBuffer));
+    }
+    return shader;
+  };
+
+  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+  GLuint fragmentShader;
+  try {
+    fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+  } catch (...) {
+    glDeleteShader(vertexShader);
+    throw;
+  }
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glLinkProgram(program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (!status) {
+    glGetProgramInfoLog(program, sizeof(logBuffer), NULL, logBuffer);
+    glDeleteProgram(program);
+    throw RendererException(strf("Failed to link program: {}\n", logBuffer));
+  }
+  return program;
+}
+
 bool OpenGlRenderer::logGlErrorSummary(String prefix) {
   if (GLenum error = glGetError()) {
     Logger::error("{}: ", prefix);
@@ -1167,7 +2051,7 @@ bool OpenGlRenderer::logGlErrorSummary(String prefix) {
   return false;
 }
 
-void OpenGlRenderer::uploadTextureImage(PixelFormat pixelFormat, Vec2U size, uint8_t const* data) {
+void OpenGlRenderer::uploadTextureImage(PixelFormat pixelFormat, Vec2U size, uint8_t const* data, GLint level) {
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
   Maybe<GLenum> internalFormat;
@@ -1193,7 +2077,7 @@ void OpenGlRenderer::uploadTextureImage(PixelFormat pixelFormat, Vec2U size, uin
       throw RendererException("Unsupported texture format in OpenGlRenderer::uploadTextureImage");
   }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat.value(format), size[0], size[1], 0, format, type, data);
+  glTexImage2D(GL_TEXTURE_2D, level, internalFormat.value(format), size[0], size[1], 0, format, type, data);
 }
 
 void OpenGlRenderer::flushImmediatePrimitives(Mat3F const& transformation) {
@@ -1249,14 +2133,24 @@ auto OpenGlRenderer::createGlRenderBuffer() -> shared_ptr<GlRenderBuffer> {
 }
 
 void OpenGlRenderer::renderGlBuffer(GlRenderBuffer const& renderBuffer, Mat3F const& transformation) {
+  if (m_currentEffect->colorTransforms && m_colorTransformTable->texture) {
+    glActiveTexture(GL_TEXTURE0 + ColorTransformTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_colorTransformTable->texture);
+  }
+
   for (auto const& vb : renderBuffer.vertexBuffers) {
     glUniformMatrix3fv(m_vertexTransformUniform, 1, GL_TRUE, transformation.ptr());
 
     if (m_currentEffect->includeVBTextures) {
       for (size_t i = 0; i < vb.textures.size(); ++i) {
         glUniform2f(m_textureSizeUniforms[i], vb.textures[i].size[0], vb.textures[i].size[1]);
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, vb.textures[i].texture);
+        if (auto arraySet = vb.textures[i].arraySet) {
+          glActiveTexture(GL_TEXTURE0 + TextureArrayUnitOffset + i);
+          glBindTexture(GL_TEXTURE_2D_ARRAY, arraySet->arrayTexture);
+        } else {
+          glActiveTexture(GL_TEXTURE0 + i);
+          glBindTexture(GL_TEXTURE_2D, vb.textures[i].texture);
+        }
       }
     }
 
@@ -1280,6 +2174,8 @@ void OpenGlRenderer::renderGlBuffer(GlRenderBuffer const& renderBuffer, Mat3F co
     glVertexAttribIPointer(m_dataAttribute, 1, GL_INT, sizeof(GlRenderVertex), (GLvoid*)offsetof(GlRenderVertex, pack));
 
     glDrawArrays(GL_TRIANGLES, 0, vb.vertexCount);
+    ++m_frameStatistics.drawCalls;
+    m_frameStatistics.triangles += vb.vertexCount / 3;
   }
 }
 
@@ -1292,18 +2188,25 @@ void OpenGlRenderer::setupGlUniforms(Effect& effect, Vec2U screenSize) {
 
   m_textureUniforms.clear();
   m_textureSizeUniforms.clear();
+  m_textureArrayUniforms.clear();
   if (effect.includeVBTextures) {
     for (size_t i = 0; i < MultiTextureCount; ++i) {
       m_textureUniforms.append(effect.getUniform(strf("texture{}", i).c_str()));
       m_textureSizeUniforms.append(effect.getUniform(strf("textureSize{}", i).c_str()));
+      if (effect.textureArrays)
+        m_textureArrayUniforms.append(effect.getUniform(strf("textureArray{}", i).c_str()));
     }
   }
   m_screenSizeUniform = effect.getUniform("screenSize");
   m_vertexTransformUniform = effect.getUniform("vertexTransform");
+  if (effect.colorTransforms)
+    glUniform1i(effect.getUniform("colorTransforms"), ColorTransformTextureUnit);
 
   if (effect.includeVBTextures) {
     for (size_t i = 0; i < MultiTextureCount; ++i)
       glUniform1i(m_textureUniforms[i], i);
+    for (size_t i = 0; i < m_textureArrayUniforms.size(); ++i)
+      glUniform1i(m_textureArrayUniforms[i], TextureArrayUnitOffset + i);
   }
 
   glUniform2f(m_screenSizeUniform, screenSize[0], screenSize[1]);
@@ -39,6 +39,8 @@ public:
   Maybe<RenderEffectParameter> getEffectScriptableParameter(String const& effectName, String const& parameterName) override;
   Maybe<VariantTypeIndex> getEffectScriptableParameterType(String const& effectName, String const& parameterName) override;
   void setEffectTexture(String const& textureName, ImageView const& image) override;
+  bool lightmapCalculationSupported() const override;
+  void setEffectLightmap(String const& textureName, RenderLightmap const& lightmap) override;
 
   void setScissorRect(Maybe<RectI> const& scissorRect) override;
 
@@ -52,27 +54,84 @@ public:
   TextureGroupPtr createTextureGroup(TextureGroupSize size, TextureFiltering filtering) override;
   RenderBufferPtr createRenderBuffer() override;
 
+  bool colorTransformsSupported() const override;
+  RenderColorTransformPtr createColorTransform(RenderColorOperations const& operations) override;
+
   List<RenderPrimitive>& immediatePrimitives() override;
   void render(RenderPrimitive primitive) override;
   void renderBuffer(RenderBufferPtr const& renderBuffer, Mat3F const& transformation) override;
 
   void flush(Mat3F const& transformation) override;
 
-  void setScreenSize(Vec2U screenSize);
+  void setScreenSize(Vec2U screenSize) override;
+  void startFrame() override;
+  void finishFrame() override;
 
-  void startFrame();
-  void finishFrame();
+  RenderStatistics lastFrameStatistics() const override;
 
 private:
-  struct GlTextureAtlasSet : public TextureAtlasSet<GLuint> {
+  // Shared between the renderer and its texture groups.  Streams texture
+  // pixels through a ring of pixel unpack buffers, so that updating an atlas
+  // the GPU is still drawing from does not stall until that drawing is done,
+  // and keeps track of the time spent creating textures this frame.
+  struct GlTextureUploader {
+    ~GlTextureUploader();
+
+    // Copies the image into the currently bound texture at the given offset,
+    // or into the given layer of the currently bound texture array
+    void copyPixels(Vec2U const& bottomLeft, Image const& image, GLenum format, Maybe<unsigned> layer = {}, GLint level = 0);
+
+    bool budgetAvailable() const;
+
+    void countUpload(size_t bytes);
+
+    bool usePixelBuffers = true;
+    double frameBudget = 0.004;
+    double frameTime = 0.0;
+    size_t frameUploads = 0;
+    size_t frameUploadBytes = 0;
+
+    List<GLuint> pixelBuffers;
+    size_t nextPixelBuffer = 0;
+  };
+  typedef shared_ptr<GlTextureUploader> GlTextureUploaderPtr;
+
+  // An atlas is either a texture of its own, or a layer of the texture array
+  // of its atlas set if texture is 0.
+  struct GlAtlasTexture {
+    GLuint texture = 0;
+    unsigned layer = 0;
+  };
+
+  struct GlTextureAtlasSet : public TextureAtlasSet<GlAtlasTexture> {
   public:
     GlTextureAtlasSet(unsigned atlasNumCells);
+    ~GlTextureAtlasSet();
 
-    GLuint createAtlasTexture(Vec2U const& size, PixelFormat pixelFormat) override;
-    void destroyAtlasTexture(GLuint const& glTexture) override;
-    void copyAtlasPixels(GLuint const& glTexture, Vec2U const& bottomLeft, Image const& image) override;
+    GlAtlasTexture createAtlasTexture(Vec2U const& size, PixelFormat pixelFormat) override;
+    void destroyAtlasTexture(GlAtlasTexture const& atlasTexture) override;
+    void copyAtlasPixels(GlAtlasTexture const& atlasTexture, Vec2U const& bottomLeft, Image const& image) override;
+
+    // Doubles the number of layers in the texture array, copying the existing
+    // layers over on the GPU.
+    void growTextureArray(Vec2U const& size);
+
+    GLint minFilter() const;
 
     TextureFiltering textureFiltering;
+    GlTextureUploaderPtr uploader;
+    // Levels of mipmaps below the full size atlas, at most four so that every
+    // atlas cell still covers at least one pixel on the smallest level.
+    unsigned mipLevels = 0;
+
+    // With texture arrays, every atlas in the set shares one texture, so a
+    // render buffer can draw sprites from all of them without breaking the
+    // batch.  The array is replaced when it grows, so draws look it up through
+    // the atlas set rather than keeping the texture id.
+    unsigned maxArrayLayers = 0;
+    GLuint arrayTexture = 0;
+    unsigned arrayLayers = 0;
+    List<unsigned> freeArrayLayers;
   };
 
   struct GlTextureGroup : enable_shared_from_this<GlTextureGroup>, public TextureGroup {
@@ -81,6 +140,7 @@ private:
 
     TextureFiltering filtering() const override;
     TexturePtr create(Image const& texture) override;
+    bool uploadBudgetAvailable() const override;
 
     GlTextureAtlasSet textureAtlasSet;
   };
@@ -89,6 +149,9 @@ private:
     virtual GLuint glTextureId() const = 0;
     virtual Vec2U glTextureSize() const = 0;
     virtual Vec2U glTextureCoordinateOffset() const = 0;
+    // The atlas set whose texture array holds this texture, if any
+    virtual GlTextureAtlasSet const* glTextureArraySet() const;
+    virtual unsigned glTextureLayer() const;
   };
 
   struct GlGroupedTexture : public GlTexture {
@@ -101,6 +164,8 @@ private:
     GLuint glTextureId() const override;
     Vec2U glTextureSize() const override;
     Vec2U glTextureCoordinateOffset() const override;
+    GlTextureAtlasSet const* glTextureArraySet() const override;
+    unsigned glTextureLayer() const override;
 
     void incrementBufferUseCount();
     void decrementBufferUseCount();
@@ -127,12 +192,39 @@ private:
     TextureFiltering textureFiltering = TextureFiltering::Nearest;
   };
 
+  // One row of a float texture per color transform, holding the hue,
+  // saturation and brightness changes and fade amount, then the fade color and
+  // number of replaced colors, then each replaced color followed by its
+  // replacement.  Row 0 is never handed out, and means no transform.
+  struct GlColorTransformTable {
+    ~GlColorTransformTable();
+
+    Maybe<unsigned> allocateRow();
+    void freeRow(unsigned row);
+
+    GLuint texture = 0;
+    unsigned nextRow = 1;
+    List<unsigned> freeRows;
+  };
+  typedef shared_ptr<GlColorTransformTable> GlColorTransformTablePtr;
+
+  struct GlColorTransform : public RenderColorTransform {
+    ~GlColorTransform();
+
+    GlColorTransformTablePtr table;
+    unsigned row = 0;
+  };
+
   struct GlPackedVertexData {
     uint32_t textureIndex : 2;
     uint32_t fullbright : 1;
     uint32_t rX : 1;
     uint32_t rY : 1;
-    uint32_t unused : 27;
+    uint32_t colorTransform : 12;
+    uint32_t textureArray : 1;
+    uint32_t textureLayer : 8;
+    uint32_t distanceField : 1;
+    uint32_t unused : 5;
   };
 
   struct GlRenderVertex {
@@ -149,27 +241,33 @@ private:
     struct GlVertexBufferTexture {
       GLuint texture;
       Vec2U size;
+      GlTextureAtlasSet const* arraySet;
     };
 
     struct GlVertexBuffer {
       List<GlVertexBufferTexture> textures;
       GLuint vertexBuffer = 0;
       size_t vertexCount = 0;
+      // Copy of the uploaded vertices, only kept with retainVertexData
+      ByteArray vertexData;
     };
 
     GlRenderBuffer();
     ~GlRenderBuffer();
 
+    void setRetainVertexData(bool retain) override;
     void set(List<RenderPrimitive>& primitives) override;
 
     RefPtr<GlTexture> whiteTexture;
     ByteArray accumulationBuffer;
 
     HashSet<TexturePtr> usedTextures;
+    List<RenderColorTransformPtr> usedColorTransforms;
     List<GlVertexBuffer> vertexBuffers;
     GLuint vertexArray = 0;
 
     bool useMultiTexturing{true};
+    bool retainVertexData{false};
   };
 
   struct EffectParameter {
@@ -228,10 +326,36 @@ private:
     GLuint getUniform(String const& name);
     bool includeVBTextures;
     bool doubleBuffered = false;
+    // Whether the shaders declare the colorTransforms table
+    bool colorTransforms = false;
+    // Whether the shaders declare the textureArray samplers
+    bool textureArrays = false;
   };
 
+  // Programs, textures and framebuffers for calculating lightmaps.  The cells
+  // are spread one step per pass between the two cell textures, and the
+  // point lights are added while drawing the result into the lightmap.
+  struct GlLightmapCalculation {
+    GlLightmapCalculation();
+    ~GlLightmapCalculation();
+
+    GLuint spreadProgram = 0;
+    GLuint pointProgram = 0;
+    GLuint vertexArray = 0;
+    GLuint cellTextures[2] = {0, 0};
+    GLuint cellFrameBuffers[2] = {0, 0};
+    GLuint lightTexture = 0;
+    GLuint lightMixTexture = 0;
+    GLuint outputFrameBuffer = 0;
+    GLuint outputTexture = 0;
+    Vec2U cellSize;
+    Vec2U outputSize;
+  };
+
+  static GLuint compileGlProgram(char const* vertexSource, char const* fragmentSource);
+
   static bool logGlErrorSummary(String prefix);
-  static void uploadTextureImage(PixelFormat pixelFormat, Vec2U size, uint8_t const* data);
+  static void uploadTextureImage(PixelFormat pixelFormat, Vec2U size, uint8_t const* data, GLint level = 0);
 
   
   static RefPtr<GlLoneTexture> createGlTexture(ImageView const& image, TextureAddressing addressing, TextureFiltering filtering);
@@ -258,6 +382,7 @@ private:
   GLint m_dataAttribute = -1;
   List<GLint> m_textureUniforms = {};
   List<GLint> m_textureSizeUniforms = {};
+  List<GLint> m_textureArrayUniforms = {};
   GLint m_screenSizeUniform = -1;
   GLint m_vertexTransformUniform = -1;
 
@@ -277,10 +402,22 @@ private:
   bool m_useMultiTexturing;
   unsigned m_multiSampling; // if non-zero, is enabled and acts as sample count
   bool m_hdrSetting;
+  bool m_textureArraySetting;
+  unsigned m_atlasMipLevels;
+  // Decided when the first texture group is created, as atlases cannot move
+  // in or out of texture arrays afterwards
+  Maybe<bool> m_useTextureArrays;
   List<shared_ptr<GlTextureGroup>> m_liveTextureGroups;
+  GlTextureUploaderPtr m_textureUploader;
+  // Texture uploads are counted by the uploader
+  RenderStatistics m_frameStatistics;
+  RenderStatistics m_lastFrameStatistics;
+  GlColorTransformTablePtr m_colorTransformTable;
 
   List<RenderPrimitive> m_immediatePrimitives;
   shared_ptr<GlRenderBuffer> m_immediateRenderBuffer;
+
+  unique_ptr<GlLightmapCalculation> m_lightmapCalculation;
 };
 
 }
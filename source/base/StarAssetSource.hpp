@@ -27,6 +27,19 @@ public:
 
   // Read the entirety of the given path into a buffer.
   virtual ByteArray read(String const& path) = 0;
+
+  // The size in bytes of the given path, sources that know it without
+  // opening the path should say so.
+  virtual StreamOffset size(String const& path) {
+    return open(path)->size();
+  }
+
+  // If the source holds the given path in memory for as long as it exists,
+  // returns its bytes in place so they can be decoded without a copy.
+  virtual Maybe<pair<char const*, size_t>> view(String const& path) {
+    _unused(path);
+    return {};
+  }
 };
 
 }
@@ -0,0 +1,76 @@
+#include "StarAssetTrace.hpp"
+#include "StarDataStreamDevices.hpp"
+
+namespace Star {
+
+static char const* const AssetTraceMagic = "SBAssetTrace0001";
+static size_t const AssetTraceMagicSize = 16;
+
+void writeAssetTrace(IODevicePtr const& device, List<AssetTraceEvent> const& events) {
+  DataStreamIODevice ds(device);
+  ds.writeData(AssetTraceMagic, AssetTraceMagicSize);
+  ds.writeVlqU(events.size());
+
+  // A string that has not been seen yet is written as the next index followed
+  // by the string itself.
+  HashMap<String, size_t> strings;
+  auto writeString = [&](String const& string) {
+    if (auto index = strings.ptr(string)) {
+      ds.writeVlqU(*index);
+    } else {
+      size_t newIndex = strings.size();
+      strings[string] = newIndex;
+      ds.writeVlqU(newIndex);
+      ds.write(string);
+    }
+  };
+
+  int64_t lastTime = 0;
+  for (auto const& event : events) {
+    ds.writeVlqI(event.time - lastTime);
+    lastTime = event.time;
+    writeString(event.type);
+    writeString(event.path);
+    ds.write<bool>(event.cacheHit);
+    ds.writeVlqI(event.latency);
+    ds.writeVlqU(event.thread);
+    ds.writeVlqU(event.fileSize);
+    ds.writeVlqU(event.loadedSize);
+  }
+}
+
+List<AssetTraceEvent> readAssetTrace(IODevicePtr const& device) {
+  DataStreamIODevice ds(device);
+  if (ds.readBytes(AssetTraceMagicSize) != ByteArray(AssetTraceMagic, AssetTraceMagicSize))
+    throw AssetTraceException("Not an asset trace file");
+
+  List<String> strings;
+  auto readString = [&]() -> String {
+    size_t index = ds.readVlqU();
+    if (index == strings.size())
+      strings.append(ds.read<String>());
+    else if (index > strings.size())
+      throw AssetTraceException("Invalid string index in asset trace");
+    return strings[index];
+  };
+
+  List<AssetTraceEvent> events;
+  size_t count = ds.readVlqU();
+  int64_t lastTime = 0;
+  for (size_t i = 0; i < count; ++i) {
+    AssetTraceEvent event;
+    lastTime += ds.readVlqI();
+    event.time = lastTime;
+    event.type = readString();
+    event.path = readString();
+    event.cacheHit = ds.read<bool>();
+    event.latency = ds.readVlqI();
+    event.thread = ds.readVlqU();
+    event.fileSize = ds.readVlqU();
+    event.loadedSize = ds.readVlqU();
+    events.append(std::move(event));
+  }
+  return events;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "StarIODevice.hpp"
+
+namespace Star {
+
+STAR_EXCEPTION(AssetTraceException, IOException);
+
+// One asset request seen by Assets while tracing.  A request is either
+// served from the cache, or is a load that parsed or decoded the asset.
+struct AssetTraceEvent {
+  // Microseconds since tracing started, when the request began
+  int64_t time = 0;
+  String type;
+  String path;
+  bool cacheHit = false;
+  // Microseconds taken, including any time waiting on the assets lock
+  int64_t latency = 0;
+  // Threads are numbered in the order they first requested an asset
+  unsigned thread = 0;
+  // Size of the asset's file, and of the loaded asset in memory when that
+  // is known, otherwise zero.
+  uint64_t fileSize = 0;
+  uint64_t loadedSize = 0;
+};
+
+// The trace is stored compactly, with each type and path written once and
+// referred to by index after that.
+void writeAssetTrace(IODevicePtr const& device, List<AssetTraceEvent> const& events);
+List<AssetTraceEvent> readAssetTrace(IODevicePtr const& device);
+
+}
@@ -17,14 +17,44 @@
 #include "StarCasting.hpp"
 #include "StarLexicalCast.hpp"
 #include "StarSha256.hpp"
+#include "StarWorkerPool.hpp"
 #include "StarDataStreamDevices.hpp"
+#include "StarCompression.hpp"
+#include "StarXXHash.hpp"
 #include "StarLua.hpp"
 #include "StarImageLuaBindings.hpp"
 #include "StarUtilityLuaBindings.hpp"
+#include "StarTraceProfiler.hpp"
+
+#include <thread>
 
 namespace Star {
 
 // if a ptr is returned, can be optionally used to format an error
+// Innermost recorder of asset dependencies on this thread
+static thread_local Assets::Dependencies* s_dependencies = nullptr;
+static thread_local List<Assets::Dependencies*> s_outerDependencies;
+
+static void recordDependency(String const& path) {
+  if (s_dependencies)
+    s_dependencies->paths.add(path);
+}
+
+static void recordScanDependency(String const& suffix) {
+  if (s_dependencies)
+    s_dependencies->suffixes.add(suffix.toLower());
+}
+
+// Identifies the patch cache file format
+static char const* const PatchCacheMagic = "SBPatchCache0002";
+static size_t const PatchCacheMagicSize = 16;
+static char const* const ImageCacheMagic = "SBImageCache0001";
+static size_t const ImageCacheMagicSize = 16;
+
+// Set while applying patches that referenced another asset, whose result
+// depends on more than the patch chain and so is not cached.
+static thread_local bool s_patchReferencedAsset = false;
+
 static const char* validateBasePath(std::string_view const& basePath) {
   if (basePath.empty() || basePath[0] != '/')
     return "Path '{}' must be absolute";
@@ -147,6 +177,7 @@ Assets::Assets(Settings settings, StringList assetSources) {
 
   m_settings = std::move(settings);
   m_stopThreads = false;
+  m_traceStartTime = Time::monotonicMicroseconds();
   m_assetSources = std::move(assetSources);
 
   auto luaEngine = LuaEngine::create();
@@ -372,13 +403,24 @@ Assets::Assets(Settings settings, StringList assetSources) {
 
   List<pair<String, AssetSourcePtr>> sources;
 
+  // Opening a source scans its directory or reads its index, which does not
+  // depend on any other source, so they are all opened in parallel.  They are
+  // still added and have their scripts run in the given order.
+  WorkerPool scanPool("Assets::scan", clamp<unsigned>(m_assetSources.size(), 1, Thread::numberOfProcessors()));
+  List<WorkerPoolPromise<AssetSourcePtr>> openedSources;
   for (auto& sourcePath : m_assetSources) {
+    openedSources.append(scanPool.addProducer<AssetSourcePtr>([this, sourcePath]() -> AssetSourcePtr {
+      if (File::isDirectory(sourcePath))
+        return std::make_shared<DirectoryAssetSource>(sourcePath, m_settings.pathIgnore);
+      else
+        return std::make_shared<PackedAssetSource>(sourcePath);
+    }));
+  }
+
+  for (size_t i = 0; i < m_assetSources.size(); ++i) {
+    auto& sourcePath = m_assetSources[i];
     Logger::info("Loading assets from: '{}'", sourcePath);
-    AssetSourcePtr source;
-    if (File::isDirectory(sourcePath))
-      source = std::make_shared<DirectoryAssetSource>(sourcePath, m_settings.pathIgnore);
-    else
-      source = std::make_shared<PackedAssetSource>(sourcePath);
+    AssetSourcePtr source = openedSources[i].get();
 
     addSource(sourcePath, source);
     sources.append(make_pair(sourcePath, source));
@@ -389,31 +431,58 @@ Assets::Assets(Settings settings, StringList assetSources) {
   for (auto& pair : sources)
     runLoadScripts("postLoad", pair.first, pair.second);
 
-  Sha256Hasher digest;
-
-  for (auto const& assetPath : m_files.keys().transformed([](String const& s) {
-        return s.toLower();
-      }).sorted()) {
-    bool digestFile = true;
-    for (auto const& pattern : m_settings.digestIgnore) {
-      if (assetPath.regexMatch(pattern, false, false)) {
-        digestFile = false;
-        break;
+  // Each file's contribution to the digest needs its size, which may mean
+  // asking the filesystem for it, so contiguous ranges of the sorted paths are done in
+  // parallel.  The ranges are pushed to the digest in order, so it is the
+  // same as if every file had been pushed one after another.
+  auto digestPaths = m_files.keys().transformed([](String const& s) {
+      return s.toLower();
+    }).sorted();
+
+  auto digestRange = [this, &digestPaths](size_t begin, size_t end) -> ByteArray {
+    ByteArray contribution;
+    for (size_t i = begin; i < end; ++i) {
+      auto const& assetPath = digestPaths[i];
+      bool digestFile = true;
+      for (auto const& pattern : m_settings.digestIgnore) {
+        if (assetPath.regexMatch(pattern, false, false)) {
+          digestFile = false;
+          break;
+        }
       }
-    }
 
-    auto const& descriptor = m_files.get(assetPath);
+      auto const& descriptor = m_files.get(assetPath);
 
-    if (digestFile) {
-      digest.push(assetPath);
-      digest.push(DataStreamBuffer::serialize(descriptor.source->open(descriptor.sourceName)->size()));
-      for (auto const& pair : descriptor.patchSources)
-        digest.push(DataStreamBuffer::serialize(pair.second->open(AssetPath::removeSubPath(pair.first))->size()));
+      if (digestFile) {
+        contribution.append(ByteArray(assetPath.utf8Ptr(), assetPath.utf8Size()));
+        contribution.append(DataStreamBuffer::serialize(descriptor.source->size(descriptor.sourceName)));
+        for (auto const& pair : descriptor.patchSources)
+          contribution.append(DataStreamBuffer::serialize(pair.second->size(AssetPath::removeSubPath(pair.first))));
+      }
     }
+    return contribution;
+  };
+
+  size_t digestRanges = scanPool.getWorkerCount() * 4;
+  List<WorkerPoolPromise<ByteArray>> digestContributions;
+  for (size_t i = 0; i < digestRanges; ++i) {
+    size_t begin = digestPaths.size() * i / digestRanges;
+    size_t end = digestPaths.size() * (i + 1) / digestRanges;
+    digestContributions.append(scanPool.addProducer<ByteArray>(bind(digestRange, begin, end)));
   }
 
+  Sha256Hasher digest;
+  for (auto& contribution : digestContributions)
+    digest.push(contribution.get());
+  scanPool.finish();
+
   m_digest = digest.compute();
 
+  if (m_settings.patchCacheFile)
+    openPatchCache();
+  if (m_settings.imageCacheFile)
+    openImageCache();
+
   int workerPoolSize = m_settings.workerPoolSize;
   for (int i = 0; i < workerPoolSize; i++)
     m_workerThreads.append(Thread::invoke("Assets::workerMain", mem_fn(&Assets::workerMain), this));
@@ -445,6 +514,14 @@ Assets::~Assets() {
 
   // Join them all
   m_workerThreads.clear();
+
+  if (m_settings.patchCacheFile)
+    writePatchCache();
+  if (m_settings.imageCacheFile)
+    writeImageCache();
+
+  if (m_settings.traceFile)
+    writeTrace();
 }
 
 void Assets::hotReload() const {
@@ -469,7 +546,27 @@ ByteArray Assets::digest() const {
   return m_digest;
 }
 
+bool Assets::Dependencies::dependsOn(String const& path) const {
+  if (paths.contains(path))
+    return true;
+  for (auto const& suffix : suffixes) {
+    if (path.endsWith(suffix, String::CaseInsensitive))
+      return true;
+  }
+  return false;
+}
+
+Assets::DependencyRecorder::DependencyRecorder(Dependencies& dependencies) {
+  s_outerDependencies.append(s_dependencies);
+  s_dependencies = &dependencies;
+}
+
+Assets::DependencyRecorder::~DependencyRecorder() {
+  s_dependencies = s_outerDependencies.takeLast();
+}
+
 bool Assets::assetExists(String const& path) const {
+  recordDependency(path);
   MutexLocker assetsLocker(m_assetsMutex);
   return m_files.contains(path);
 }
@@ -479,6 +576,37 @@ Maybe<Assets::AssetFileDescriptor> Assets::assetDescriptor(String const& path) c
   return m_files.maybe(path);
 }
 
+StringSet Assets::differingFiles(Assets const& other) const {
+  // Sources are compared by their paths, since each Assets opens its own
+  typedef tuple<String, String, List<pair<String, String>>> FileOrigin;
+  auto fileOrigins = [](Assets const& assets) {
+    MutexLocker assetsLocker(assets.m_assetsMutex);
+    StringMap<FileOrigin> origins;
+    for (auto const& p : assets.m_files) {
+      FileOrigin origin{assets.m_assetSourcePaths.getLeft(p.second.source), p.second.sourceName, {}};
+      for (auto const& patch : p.second.patchSources)
+        get<2>(origin).append({patch.first, assets.m_assetSourcePaths.getLeft(patch.second)});
+      origins[p.first] = std::move(origin);
+    }
+    return origins;
+  };
+
+  auto origins = fileOrigins(*this);
+  auto otherOrigins = fileOrigins(other);
+
+  StringSet differing;
+  for (auto const& p : origins) {
+    auto otherOrigin = otherOrigins.ptr(p.first);
+    if (!otherOrigin || *otherOrigin != p.second)
+      differing.add(p.first);
+  }
+  for (auto const& p : otherOrigins) {
+    if (!origins.contains(p.first))
+      differing.add(p.first);
+  }
+  return differing;
+}
+
 String Assets::assetSource(String const& path) const {
   MutexLocker assetsLocker(m_assetsMutex);
   if (auto p = m_files.ptr(path))
@@ -492,6 +620,7 @@ Maybe<String> Assets::assetSourcePath(AssetSourcePtr const& source) const {
 }
 
 StringList Assets::scan(String const& suffix) const {
+  recordScanDependency(suffix);
   if (suffix.beginsWith(".") && !suffix.substr(1).hasChar('.')) {
     return scanExtension(suffix).values();
   } else if (suffix.empty()) {
@@ -509,6 +638,7 @@ StringList Assets::scan(String const& suffix) const {
 }
 
 StringList Assets::scan(String const& prefix, String const& suffix) const {
+  recordScanDependency(suffix);
   StringList result;
   if (suffix.beginsWith(".") && !suffix.substr(1).hasChar('.')) {
     auto& filesWithExtension = scanExtension(suffix);
@@ -529,6 +659,7 @@ StringList Assets::scan(String const& prefix, String const& suffix) const {
 const CaseInsensitiveStringSet NullExtensionScan;
 
 CaseInsensitiveStringSet const& Assets::scanExtension(String const& extension) const {
+  recordScanDependency(extension.beginsWith(".") ? extension : "." + extension);
   auto find = m_filesByExtension.find(extension.beginsWith(".") ? extension.substr(1) : extension);
   return find != m_filesByExtension.end() ? find->second : NullExtensionScan;
 }
@@ -556,6 +687,25 @@ void Assets::queueJsons(StringList const& paths) const {
   }));
 }
 
+void Assets::persistJson(String const& path) const {
+  auto components = AssetPath::split(path);
+  validatePath(components, true, false);
+
+  auto asset = getAsset(AssetId{AssetType::Json, std::move(components)});
+  MutexLocker assetsLocker(m_assetsMutex);
+  asset->forcePersist = true;
+}
+
+void Assets::setRecordJsonLoads(bool recordJsonLoads) const {
+  MutexLocker assetsLocker(m_assetsMutex);
+  m_recordJsonLoads = recordJsonLoads;
+}
+
+StringList Assets::recordedJsonLoads() const {
+  MutexLocker assetsLocker(m_assetsMutex);
+  return m_recordedJsonLoads.values();
+}
+
 void Assets::queueJsons(CaseInsensitiveStringSet const& paths) const {
   MutexLocker assetsLocker(m_assetsMutex);
   for (String const& path : paths) {
@@ -691,6 +841,56 @@ void Assets::cleanup() {
       }
     }
   }
+
+  size_t memoryUsage = 0;
+  List<tuple<CachePriority, double, AssetId>> evictable;
+  for (auto const& pair : m_assetsCache) {
+    auto const& asset = pair.second;
+    if (!asset)
+      continue;
+    if (!asset->accounted) {
+      asset->accounted = true;
+      asset->memoryUsage = asset->memorySize();
+      asset->cachePriority = cachePriority(pair.first);
+    }
+    memoryUsage += asset->memoryUsage;
+
+    if (m_settings.cacheMemoryLimit && asset->memoryUsage && asset->cachePriority != CachePriority::NeverEvict
+        && !m_queue.contains(pair.first) && !asset->shouldPersist())
+      evictable.append(make_tuple(asset->cachePriority, asset->time, pair.first));
+  }
+
+  if (m_settings.cacheMemoryLimit && memoryUsage > m_settings.cacheMemoryLimit) {
+    evictable.sort([](auto const& a, auto const& b) {
+        return tie(get<0>(a), get<1>(a)) < tie(get<0>(b), get<1>(b));
+      });
+    for (auto const& entry : evictable) {
+      if (memoryUsage <= m_settings.cacheMemoryLimit)
+        break;
+      memoryUsage -= m_assetsCache.take(get<2>(entry))->memoryUsage;
+      ++m_memoryEvictions;
+    }
+  }
+
+  if (m_settings.cacheMemoryLimit)
+    LogMap::set("assets_cache_memory", strf("{:.1f} / {:.1f} MiB", memoryUsage / 1048576.0, m_settings.cacheMemoryLimit / 1048576.0));
+  else
+    LogMap::set("assets_cache_memory", strf("{:.1f} MiB", memoryUsage / 1048576.0));
+  LogMap::set("assets_cache_evictions", m_memoryEvictions);
+}
+
+Assets::CachePriority Assets::cachePriority(AssetId const& id) const {
+  if (id.type == AssetType::Font)
+    return CachePriority::NeverEvict;
+  for (auto const& pattern : m_settings.neverEvict) {
+    if (id.path.basePath.regexMatch(pattern, false, false))
+      return CachePriority::NeverEvict;
+  }
+  for (auto const& pattern : m_settings.evictFirst) {
+    if (id.path.basePath.regexMatch(pattern, false, false))
+      return CachePriority::EvictFirst;
+  }
+  return CachePriority::Normal;
 }
 
 bool Assets::AssetId::operator==(AssetId const& assetId) const {
@@ -701,6 +901,10 @@ size_t Assets::AssetIdHash::operator()(AssetId const& id) const {
   return hashOf(id.type, id.path.basePath, id.path.subPath, id.path.directives);
 }
 
+size_t Assets::AssetData::memorySize() const {
+  return 0;
+}
+
 bool Assets::JsonData::shouldPersist() const {
   return forcePersist || !json.unique();
 }
@@ -709,10 +913,24 @@ bool Assets::ImageData::shouldPersist() const {
   return forcePersist || (!alias && !image.unique());
 }
 
+size_t Assets::ImageData::memorySize() const {
+  // Aliases share the image of the entry they alias
+  if (alias || !image)
+    return 0;
+  return (size_t)image->width() * image->height() * image->bytesPerPixel();
+}
+
 bool Assets::AudioData::shouldPersist() const {
   return forcePersist || !audio.unique();
 }
 
+size_t Assets::AudioData::memorySize() const {
+  // Compressed audio is streamed from its file as it plays
+  if (!audio || audio->compressed())
+    return 0;
+  return audio->totalSamples() * audio->channels() * sizeof(int16_t);
+}
+
 bool Assets::FontData::shouldPersist() const {
   return forcePersist || !font.unique();
 }
@@ -721,6 +939,10 @@ bool Assets::BytesData::shouldPersist() const {
   return forcePersist || !bytes.unique();
 }
 
+size_t Assets::BytesData::memorySize() const {
+  return bytes ? bytes->size() : 0;
+}
+
 FramesSpecification Assets::parseFramesSpecification(Json const& frameConfig, String path) {
   FramesSpecification framesSpecification;
 
@@ -857,19 +1079,27 @@ shared_ptr<Assets::AssetData> Assets::tryAsset(AssetId const& id) const {
 }
 
 shared_ptr<Assets::AssetData> Assets::getAsset(AssetId const& id) const {
+  recordDependency(id.path.basePath);
+  int64_t traceStartTime = m_settings.traceFile ? Time::monotonicMicroseconds() : 0;
   MutexLocker assetsLocker(m_assetsMutex);
 
+  // Loads are traced by loadAsset, so only requests that never needed one
+  // are traced as cache hits here.
+  bool missed = false;
   while (true) {
     auto j = m_assetsCache.find(id);
     if (j != m_assetsCache.end()) {
       if (j->second) {
         auto asset = j->second;
         freshen(asset);
+        if (m_settings.traceFile && !missed)
+          traceRequest(id, true, traceStartTime, asset);
         return asset;
       } else {
         throw AssetException::format("Error loading asset {}", id.path);
       }
     } else {
+      missed = true;
       // Try to load the asset in-thread, if we cannot, then the asset has been
       // queued so wait for a worker thread to finish it.
       if (!doLoad(id))
@@ -1088,6 +1318,7 @@ Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, J
         } catch (...) {
           throw JsonPatchTestFail(strf("Unable to load reference asset: {}", patch.toString()));
         }
+        s_patchReferencedAsset = true;
         break;
       default:
         throw JsonPatchException(strf("Patch data is wrong type: {}", Json::typeName(patch.type())));
@@ -1098,14 +1329,363 @@ Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, J
 }
 
 Json Assets::readJson(String const& path) const {
-  ByteArray streamData = read(path);
+  auto descriptor = m_files.ptr(path);
+  if (!descriptor)
+    throw AssetException(strf("No such asset '{}'", path));
+  auto const& patchSources = descriptor->patchSources;
+
+  // Parsed in place when the source has the file in memory
+  ByteArray streamData;
+  auto bytes = descriptor->source->view(descriptor->sourceName);
+  if (!bytes) {
+    streamData = descriptor->source->read(descriptor->sourceName);
+    bytes = make_pair<char const*, size_t>(streamData.ptr(), streamData.size());
+  }
+  char const* begin = bytes->first;
+  char const* end = bytes->first + bytes->second;
+
+  Maybe<ByteArray> chainHash;
+  if (m_settings.patchCacheFile && !patchSources.empty()) {
+    chainHash = patchChainHash(path, bytes->first, bytes->second, patchSources);
+    if (chainHash) {
+      if (auto entry = m_patchCache.ptr(path)) {
+        if (entry->chainHash == *chainHash) {
+          try {
+            DataStreamExternalBuffer ds(m_patchCacheMapping->data() + entry->offset, entry->size);
+            return ds.read<Json>();
+          } catch (std::exception const& e) {
+            Logger::warn("Could not read cached patched json for {}: {}", path, outputException(e, false));
+          }
+        }
+      }
+    }
+  }
+
   try {
-    return applyJsonPatches(inputUtf8Json(streamData.begin(), streamData.end(), JsonParseType::Top), path, m_files.get(path).patchSources);
+    bool referencedAsset = take(s_patchReferencedAsset);
+    // Asset documents are built in one go and kept for as long as they are
+    // cached, so their nodes are packed into an arena sized to the source.
+    auto arena = make_shared<JsonArena>(clamp<size_t>(end - begin, 1024, 1024 * 1024));
+    Json result = applyJsonPatches(inputUtf8Json(begin, end, JsonParseType::Top, std::move(arena)), path, patchSources);
+    if (chainHash && !s_patchReferencedAsset) {
+      MutexLocker cacheLocker(m_patchCacheMutex);
+      m_newPatchCacheEntries[path] = {std::move(*chainHash), DataStreamBuffer::serialize(result)};
+    }
+    s_patchReferencedAsset = referencedAsset;
+    return result;
   } catch (std::exception const& e) {
     throw JsonParsingException(strf("Cannot parse json file: {}", path), e);
   }
 }
 
+Maybe<ByteArray> Assets::patchChainHash(String const& path, char const* data, size_t size, List<pair<String, AssetSourcePtr>> const& patches) const {
+  XXHash128 hasher;
+  hasher.push(DataStreamBuffer::serialize(path));
+  DataStreamBuffer sizeBuffer;
+  sizeBuffer.writeVlqU(size);
+  hasher.push(sizeBuffer.data());
+  hasher.push(data, size);
+  for (auto const& pair : patches) {
+    auto patchBasePath = AssetPath::removeSubPath(pair.first);
+    if (patchBasePath.endsWith(".lua"))
+      return {};
+    hasher.push(DataStreamBuffer::serialize(pair.first));
+    hasher.push(DataStreamBuffer::serialize(pair.second->read(patchBasePath)));
+  }
+  return hasher.digest();
+}
+
+void Assets::traceRequest(AssetId const& id, bool cacheHit, int64_t startTime, shared_ptr<AssetData> const& asset) const {
+  int64_t endTime = Time::monotonicMicroseconds();
+
+  AssetTraceEvent event;
+  event.time = startTime - m_traceStartTime;
+  event.type = AssetTypeNames.getRight(id.type);
+  event.path = AssetPath::join(id.path);
+  event.cacheHit = cacheHit;
+  event.latency = endTime - startTime;
+
+  size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+  if (auto thread = m_traceThreads.ptr(threadHash)) {
+    event.thread = *thread;
+  } else {
+    event.thread = m_traceThreads.size();
+    m_traceThreads[threadHash] = event.thread;
+  }
+
+  if (!cacheHit) {
+    // Opening the file just for its size only happens while tracing
+    if (auto descriptor = m_files.ptr(id.path.basePath)) {
+      try {
+        event.fileSize = descriptor->source->open(descriptor->sourceName)->size();
+      } catch (std::exception const&) {}
+    }
+  }
+
+  if (auto imageData = as<ImageData>(asset)) {
+    if (imageData->image && !imageData->alias)
+      event.loadedSize = imageData->image->width() * imageData->image->height() * imageData->image->bytesPerPixel();
+  } else if (auto bytesData = as<BytesData>(asset)) {
+    if (bytesData->bytes)
+      event.loadedSize = bytesData->bytes->size();
+  }
+
+  m_traceEvents.append(std::move(event));
+}
+
+void Assets::writeTrace() const {
+  MutexLocker assetsLocker(m_assetsMutex);
+  String const& traceFile = *m_settings.traceFile;
+  try {
+    writeAssetTrace(File::open(traceFile, IOMode::Write | IOMode::Truncate), m_traceEvents);
+    Logger::info("Wrote {} asset trace events to '{}'", m_traceEvents.size(), traceFile);
+  } catch (std::exception const& e) {
+    Logger::warn("Could not write asset trace '{}': {}", traceFile, outputException(e, false));
+  }
+}
+
+void Assets::openPatchCache() {
+  String const& cacheFile = *m_settings.patchCacheFile;
+  if (!File::isFile(cacheFile))
+    return;
+
+  try {
+    auto file = File::open(cacheFile, IOMode::Read);
+    size_t size = file->size();
+    if (size < PatchCacheMagicSize)
+      return;
+    m_patchCacheMapping = file->mapReadOnly(size);
+
+    DataStreamExternalBuffer ds(m_patchCacheMapping->data(), size);
+    if (ByteArray(ds.readBytes(PatchCacheMagicSize)) != ByteArray(PatchCacheMagic, PatchCacheMagicSize)) {
+      m_patchCacheMapping.reset();
+      return;
+    }
+
+    // Entry offsets are relative to the Json data following the index
+    HashMap<String, PatchCacheEntry> entries;
+    size_t count = ds.readVlqU();
+    for (size_t i = 0; i < count; ++i) {
+      String path = ds.read<String>();
+      PatchCacheEntry entry;
+      entry.chainHash = ds.read<ByteArray>();
+      entry.offset = ds.readVlqU();
+      entry.size = ds.readVlqU();
+      entries[std::move(path)] = std::move(entry);
+    }
+
+    size_t dataStart = ds.pos();
+    for (auto& p : entries) {
+      p.second.offset += dataStart;
+      if (p.second.offset + p.second.size > size)
+        throw IOException("Patch cache entry out of bounds");
+    }
+    m_patchCache = std::move(entries);
+    Logger::info("Loaded {} patched json files from patch cache", m_patchCache.size());
+  } catch (std::exception const& e) {
+    Logger::warn("Could not load patch cache '{}', ignoring it: {}", cacheFile, outputException(e, false));
+    m_patchCache.clear();
+    m_patchCacheMapping.reset();
+  }
+}
+
+void Assets::writePatchCache() {
+  MutexLocker cacheLocker(m_patchCacheMutex);
+  if (m_newPatchCacheEntries.empty())
+    return;
+
+  // Entries from earlier runs are kept if their file is still there, newer
+  // ones replace them.
+  HashMap<String, pair<ByteArray, ByteArray>> entries = take(m_newPatchCacheEntries);
+  for (auto const& p : m_patchCache) {
+    if (!entries.contains(p.first) && m_files.contains(p.first))
+      entries[p.first] = {p.second.chainHash, ByteArray(m_patchCacheMapping->data() + p.second.offset, p.second.size)};
+  }
+  m_patchCache.clear();
+  m_patchCacheMapping.reset();
+
+  DataStreamBuffer index;
+  ByteArray data;
+  index.writeData(PatchCacheMagic, PatchCacheMagicSize);
+  index.writeVlqU(entries.size());
+  for (auto const& p : entries) {
+    index.write(p.first);
+    index.write(p.second.first);
+    index.writeVlqU(data.size());
+    index.writeVlqU(p.second.second.size());
+    data.append(p.second.second);
+  }
+
+  // Written beside the cache and moved over it, so that a process reading
+  // the old one at the same time is not affected.
+  String const& cacheFile = *m_settings.patchCacheFile;
+  String tempFile = cacheFile + ".tmp";
+  try {
+    auto file = File::open(tempFile, IOMode::Write | IOMode::Truncate);
+    file->writeFull(index.ptr(), index.size());
+    file->writeFull(data.ptr(), data.size());
+    file->close();
+    File::rename(tempFile, cacheFile);
+  } catch (std::exception const& e) {
+    Logger::warn("Could not write patch cache '{}': {}", cacheFile, outputException(e, false));
+  }
+}
+
+void Assets::openImageCache() {
+  String const& cacheFile = *m_settings.imageCacheFile;
+  if (!File::isFile(cacheFile))
+    return;
+
+  try {
+    auto file = File::open(cacheFile, IOMode::Read);
+    size_t size = file->size();
+    if (size < ImageCacheMagicSize)
+      return;
+    m_imageCacheMapping = file->mapReadOnly(size);
+
+    DataStreamExternalBuffer ds(m_imageCacheMapping->data(), size);
+    if (ByteArray(ds.readBytes(ImageCacheMagicSize)) != ByteArray(ImageCacheMagic, ImageCacheMagicSize)) {
+      m_imageCacheMapping.reset();
+      return;
+    }
+
+    // Entry offsets are relative to the image data following the index
+    uint64_t run = ds.readVlqU();
+    HashMap<ImageCacheKey, ImageCacheEntry> entries;
+    size_t count = ds.readVlqU();
+    for (size_t i = 0; i < count; ++i) {
+      ImageCacheKey key;
+      key.first = ds.read<uint64_t>();
+      key.second = ds.read<uint64_t>();
+      ImageCacheEntry entry;
+      entry.lastUsed = ds.readVlqU();
+      entry.offset = ds.readVlqU();
+      entry.size = ds.readVlqU();
+      entries[key] = entry;
+    }
+
+    size_t dataStart = ds.pos();
+    for (auto& p : entries) {
+      p.second.offset += dataStart;
+      if (p.second.offset + p.second.size > size)
+        throw IOException("Image cache entry out of bounds");
+    }
+    m_imageCacheRun = run;
+    m_imageCache = std::move(entries);
+    Logger::info("Loaded {} processed images from image cache", m_imageCache.size());
+  } catch (std::exception const& e) {
+    Logger::warn("Could not load image cache '{}', ignoring it: {}", cacheFile, outputException(e, false));
+    m_imageCache.clear();
+    m_imageCacheMapping.reset();
+  }
+}
+
+void Assets::writeImageCache() {
+  MutexLocker cacheLocker(m_imageCacheMutex);
+  if (m_newImageCacheEntries.empty() && m_usedImageCacheEntries.empty())
+    return;
+
+  struct Entry {
+    ImageCacheKey key;
+    uint64_t lastUsed;
+    ByteArray data;
+  };
+
+  // Pixels are stored as they are in the processed image, ready for upload
+  // once decompressed.
+  uint64_t run = m_imageCacheRun + 1;
+  List<Entry> entries;
+  for (auto const& p : take(m_newImageCacheEntries)) {
+    Image const& image = *p.second;
+    DataStreamBuffer ds;
+    ds.writeVlqU(image.width());
+    ds.writeVlqU(image.height());
+    ds.write<uint8_t>((uint8_t)image.pixelFormat());
+    ds.write(compressData(ByteArray((char const*)image.data(), image.width() * image.height() * image.bytesPerPixel()), LowCompression));
+    entries.append({p.first, run, ds.takeData()});
+  }
+  for (auto const& p : m_imageCache) {
+    uint64_t lastUsed = m_usedImageCacheEntries.contains(p.first) ? run : p.second.lastUsed;
+    entries.append({p.first, lastUsed, ByteArray((char const*)m_imageCacheMapping->data() + p.second.offset, p.second.size)});
+  }
+  m_usedImageCacheEntries.clear();
+  m_imageCache.clear();
+  m_imageCacheMapping.reset();
+
+  // The most recently used entries are kept until the size limit is reached
+  sort(entries, [](Entry const& a, Entry const& b) { return a.lastUsed > b.lastUsed; });
+  size_t totalSize = 0;
+  size_t keep = 0;
+  while (keep < entries.size() && totalSize + entries[keep].data.size() <= m_settings.imageCacheSizeLimit)
+    totalSize += entries[keep++].data.size();
+  entries.resize(keep);
+
+  DataStreamBuffer index;
+  ByteArray data;
+  index.writeData(ImageCacheMagic, ImageCacheMagicSize);
+  index.writeVlqU(run);
+  index.writeVlqU(entries.size());
+  for (auto const& entry : entries) {
+    index.write<uint64_t>(entry.key.first);
+    index.write<uint64_t>(entry.key.second);
+    index.writeVlqU(entry.lastUsed);
+    index.writeVlqU(data.size());
+    index.writeVlqU(entry.data.size());
+    data.append(entry.data);
+  }
+
+  String const& cacheFile = *m_settings.imageCacheFile;
+  String tempFile = cacheFile + ".tmp";
+  try {
+    auto file = File::open(tempFile, IOMode::Write | IOMode::Truncate);
+    file->writeFull(index.ptr(), index.size());
+    file->writeFull(data.ptr(), data.size());
+    file->close();
+    File::rename(tempFile, cacheFile);
+  } catch (std::exception const& e) {
+    Logger::warn("Could not write image cache '{}': {}", cacheFile, outputException(e, false));
+  }
+}
+
+ImageConstPtr Assets::readCachedImage(ImageCacheKey const& key) const {
+  auto entry = m_imageCache.ptr(key);
+  if (!entry)
+    return {};
+
+  try {
+    DataStreamExternalBuffer ds((char const*)m_imageCacheMapping->data() + entry->offset, entry->size);
+    unsigned width = ds.readVlqU();
+    unsigned height = ds.readVlqU();
+    auto pixelFormat = (PixelFormat)ds.read<uint8_t>();
+    if (pixelFormat > PixelFormat::RGBA_F)
+      throw IOException("Cached image has an invalid pixel format");
+    auto image = make_shared<Image>(width, height, pixelFormat);
+    size_t imageSize = width * height * image->bytesPerPixel();
+    ByteArray pixels = uncompressData(ds.read<ByteArray>(), imageSize);
+    if (pixels.size() != imageSize)
+      throw IOException("Cached image has the wrong size");
+    memcpy(image->data(), pixels.ptr(), imageSize);
+
+    MutexLocker cacheLocker(m_imageCacheMutex);
+    m_usedImageCacheEntries.add(key);
+    return image;
+  } catch (std::exception const& e) {
+    Logger::warn("Could not read cached processed image: {}", outputException(e, false));
+    return {};
+  }
+}
+
+void Assets::cacheProcessedImage(ImageCacheKey const& key, ImageConstPtr const& image) const {
+  // Pending images are held in memory until the cache is written, so no more
+  // are kept than the cache could hold uncompressed.
+  size_t imageSize = image->width() * image->height() * image->bytesPerPixel();
+  MutexLocker cacheLocker(m_imageCacheMutex);
+  if (m_newImageCacheBytes + imageSize > m_settings.imageCacheSizeLimit || m_newImageCacheEntries.contains(key))
+    return;
+  m_newImageCacheEntries[key] = image;
+  m_newImageCacheBytes += imageSize;
+}
+
 Json Assets::applyJsonPatches(Json const& input, String const& path, List<pair<String, AssetSourcePtr>> patches) const {
   Json result = input;
   for (auto const& pair : patches) {
@@ -1200,8 +1780,11 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id) const {
     return {};
 
   try {
+    STAR_PROFILE_SCOPE("Assets::loadAsset");
+    MemoryTagScope memoryTag(MemoryTag::Assets);
     m_queue[id] = QueuePriority::Working;
     shared_ptr<AssetData> assetData;
+    int64_t traceStartTime = m_settings.traceFile ? Time::monotonicMicroseconds() : 0;
 
     try {
       if (id.type == AssetType::Json) {
@@ -1229,6 +1812,9 @@ shared_ptr<Assets::AssetData> Assets::loadAsset(AssetId const& id) const {
     }
 
     if (assetData) {
+      if (m_settings.traceFile)
+        traceRequest(id, false, traceStartTime, assetData);
+
       if (assetData->needsPostProcessing)
         m_queue[id] = QueuePriority::PostProcess;
       else
@@ -1273,6 +1859,8 @@ shared_ptr<Assets::AssetData> Assets::loadJson(AssetPath const& path) const {
       throw AssetException(strf("Could not read JSON value {}", path), e);
     }
   } else {
+    if (m_recordJsonLoads)
+      m_recordedJsonLoads.add(path.basePath);
     return unlockDuring([&]() {
       try {
         auto newData = make_shared<JsonData>();
@@ -1314,8 +1902,26 @@ shared_ptr<Assets::AssetData> Assets::loadImage(AssetPath const& path) const {
 
     return unlockDuring([&]() {
       auto newData = make_shared<ImageData>();
+
+      // Images built from references are not cached, their key would have
+      // to cover every referenced image too.
+      Maybe<ImageCacheKey> cacheKey;
+      if (m_settings.imageCacheFile && referencePaths.empty()) {
+        Image const& sourceImage = *source->image;
+        XXHash3 sourceHash;
+        xxHash3Push(sourceHash, sourceImage.width());
+        xxHash3Push(sourceHash, sourceImage.height());
+        xxHash3Push(sourceHash, (uint8_t)sourceImage.pixelFormat());
+        sourceHash.push((char const*)sourceImage.data(), sourceImage.width() * sourceImage.height() * sourceImage.bytesPerPixel());
+        cacheKey = ImageCacheKey(sourceHash.digest(), path.directives.hash());
+        if ((newData->image = readCachedImage(*cacheKey)))
+          return newData;
+      }
+
       auto newImage = path.directives.applyNewImage(*source->image, [&](String const& ref) { return references.get(ref).get(); });
       newData->image = make_shared<Image>(std::move(newImage));
+      if (cacheKey)
+        cacheProcessedImage(*cacheKey, newData->image);
       return newData;
     });
 
@@ -6,11 +6,13 @@
 #include "StarBiMap.hpp"
 #include "StarThread.hpp"
 #include "StarAssetSource.hpp"
+#include "StarAssetTrace.hpp"
 #include "StarAssetPath.hpp"
 #include "StarRefPtr.hpp"
 
 namespace Star {
 
+STAR_CLASS(FileMapping);
 STAR_CLASS(Font);
 STAR_CLASS(Audio);
 STAR_CLASS(Image);
@@ -49,6 +51,19 @@ public:
     // TTL for cached assets
     float assetTimeToLive;
 
+    // If non-zero, whenever the cached assets use more than this many bytes,
+    // unused ones are evicted early until they fit, least recently used
+    // first.  Only images, audio, and bytes are counted.
+    size_t cacheMemoryLimit;
+
+    // Assets whose paths match any of these patterns are evicted before all
+    // others to meet the memory limit.
+    StringList evictFirst;
+
+    // Assets whose paths match any of these patterns are never evicted to
+    // meet the memory limit, and neither are fonts.
+    StringList neverEvict;
+
     // Audio under this length will be automatically decompressed
     float audioDecompressLimit;
 
@@ -69,6 +84,44 @@ public:
     // Same, but only ignores the file for the purposes of calculating the
     // digest.
     StringList digestIgnore;
+
+    // If given, patched Json files are kept in this file after their patches
+    // are applied, and read back from it while the file and its patches are
+    // unchanged.
+    Maybe<String> patchCacheFile;
+
+    // If given, images produced by applying directives are kept compressed
+    // in this file between runs, keyed by a hash of their source image and
+    // their directives.  The least recently used ones are dropped whenever
+    // the file would grow past imageCacheSizeLimit bytes.
+    Maybe<String> imageCacheFile;
+    size_t imageCacheSizeLimit;
+
+    // If set, every asset request is traced, and the trace is written to
+    // this file when the assets are destroyed.
+    Maybe<String> traceFile;
+  };
+
+  // The asset paths requested and the suffixes scanned for by one thread
+  // while it is being recorded, used to work out what needs to be reloaded
+  // when asset files change.
+  struct Dependencies {
+    bool dependsOn(String const& path) const;
+
+    StringSet paths;
+    StringSet suffixes;
+  };
+
+  // Records the current thread's asset requests into the given Dependencies
+  // for as long as it exists.  Only the most recently created recorder on a
+  // thread receives them.
+  class DependencyRecorder {
+  public:
+    DependencyRecorder(Dependencies& dependencies);
+    ~DependencyRecorder();
+
+    DependencyRecorder(DependencyRecorder const&) = delete;
+    DependencyRecorder& operator=(DependencyRecorder const&) = delete;
   };
 
   enum class QueuePriority {
@@ -97,6 +150,12 @@ public:
     size_t operator()(AssetId const& id) const;
   };
 
+  enum class CachePriority {
+    EvictFirst,
+    Normal,
+    NeverEvict
+  };
+
   struct AssetData {
     virtual ~AssetData() = default;
 
@@ -105,9 +164,17 @@ public:
     // the cache.
     virtual bool shouldPersist() const = 0;
 
+    // Bytes held by this asset that evicting it could free.
+    virtual size_t memorySize() const;
+
     double time = 0.0;
     bool needsPostProcessing = false;
     bool forcePersist = false;
+
+    // Worked out by the first cleanup to see this asset
+    bool accounted = false;
+    size_t memoryUsage = 0;
+    CachePriority cachePriority = CachePriority::Normal;
   };
 
   struct JsonData : AssetData {
@@ -119,6 +186,7 @@ public:
   // Image data for an image, sub-frame, or post-processed image.
   struct ImageData : AssetData {
     bool shouldPersist() const override;
+    size_t memorySize() const override;
 
     ImageConstPtr image;
 
@@ -134,6 +202,7 @@ public:
 
   struct AudioData : AssetData {
     bool shouldPersist() const override;
+    size_t memorySize() const override;
 
     AudioConstPtr audio;
   };
@@ -146,6 +215,7 @@ public:
 
   struct BytesData : AssetData {
     bool shouldPersist() const override;
+    size_t memorySize() const override;
 
     ByteArrayConstPtr bytes;
   };
@@ -181,6 +251,10 @@ public:
 
   Maybe<AssetFileDescriptor> assetDescriptor(String const& path) const;
 
+  // Paths that exist in only one of these and the given assets, or that come
+  // from a different source or have different patches in each.
+  StringSet differingFiles(Assets const& other) const;
+
   // The name of the asset source within which the path exists.
   String assetSource(String const& path) const;
 
@@ -210,6 +284,14 @@ public:
   void queueJsons(StringList const& paths) const;
   void queueJsons(CaseInsensitiveStringSet const& paths) const;
 
+  // Loads the given json and keeps it loaded until the assets are reloaded.
+  void persistJson(String const& path) const;
+
+  // While enabled, remembers every json file that is loaded, so that a later
+  // run can load the same files up front.
+  void setRecordJsonLoads(bool recordJsonLoads) const;
+  StringList recordedJsonLoads() const;
+
   // Returns *either* an image asset or a sub-frame.  Frame files are JSON
   // descriptor files that reference a particular image and label separate
   // sub-rects of the image.  If the given path has a ':' sub-path, then the
@@ -291,6 +373,26 @@ private:
   ImageConstPtr applyImagePatches(ImageConstPtr image, String const& path, List<pair<String, AssetSourcePtr>> patches) const;
 
   Json readJson(String const& basePath) const;
+  // Hash of a Json file's contents and of every patch applied to it, or
+  // nothing if any of its patches is a Lua script, whose result cannot be
+  // known without running it.
+  Maybe<ByteArray> patchChainHash(String const& path, char const* data, size_t size, List<pair<String, AssetSourcePtr>> const& patches) const;
+  void openPatchCache();
+  void writePatchCache();
+
+  // Hash of the source image and of the directives applied to it
+  typedef pair<uint64_t, uint64_t> ImageCacheKey;
+
+  void openImageCache();
+  void writeImageCache();
+  ImageConstPtr readCachedImage(ImageCacheKey const& key) const;
+  void cacheProcessedImage(ImageCacheKey const& key, ImageConstPtr const& image) const;
+
+  CachePriority cachePriority(AssetId const& id) const;
+
+  // Must be called with m_assetsMutex held
+  void traceRequest(AssetId const& id, bool cacheHit, int64_t startTime, shared_ptr<AssetData> const& asset) const;
+  void writeTrace() const;
   Json applyJsonPatches(Json const& input, String const& path, List<pair<String, AssetSourcePtr>> patches) const;
   Json checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData, Maybe<Json> const external) const;
 
@@ -321,6 +423,15 @@ private:
   Settings m_settings;
 
   mutable Mutex m_assetsMutex;
+  mutable bool m_recordJsonLoads = false;
+  mutable StringSet m_recordedJsonLoads;
+
+  // Assets evicted early to meet the cache memory limit, since startup
+  mutable uint64_t m_memoryEvictions = 0;
+
+  int64_t m_traceStartTime = 0;
+  mutable List<AssetTraceEvent> m_traceEvents;
+  mutable HashMap<size_t, unsigned> m_traceThreads;
 
   mutable ConditionVariable m_assetsQueued;
   mutable OrderedHashMap<AssetId, QueuePriority, AssetIdHash> m_queue;
@@ -349,6 +460,39 @@ private:
 
   ByteArray m_digest;
 
+  struct PatchCacheEntry {
+    ByteArray chainHash;
+    size_t offset;
+    size_t size;
+  };
+
+  // Entries of the patch cache file as it was at startup, their Json is read
+  // from the mapped file on first use.
+  FileMappingPtr m_patchCacheMapping;
+  HashMap<String, PatchCacheEntry> m_patchCache;
+  // Files patched during this run, with their chain hash and serialized Json
+  mutable Mutex m_patchCacheMutex;
+  mutable HashMap<String, pair<ByteArray, ByteArray>> m_newPatchCacheEntries;
+
+  struct ImageCacheEntry {
+    // Run in which the entry was last used, counted up by each run that
+    // writes the cache.
+    uint64_t lastUsed;
+    size_t offset;
+    size_t size;
+  };
+
+  // Entries of the image cache file as it was at startup, which is never
+  // changed until it is written back on destruction.
+  FileMappingPtr m_imageCacheMapping;
+  HashMap<ImageCacheKey, ImageCacheEntry> m_imageCache;
+  uint64_t m_imageCacheRun = 0;
+  // Entries used or produced during this run
+  mutable Mutex m_imageCacheMutex;
+  mutable HashSet<ImageCacheKey> m_usedImageCacheEntries;
+  mutable HashMap<ImageCacheKey, ImageConstPtr> m_newImageCacheEntries;
+  mutable size_t m_newImageCacheBytes = 0;
+
   List<ThreadFunction<void>> m_workerThreads;
   atomic<bool> m_stopThreads;
 };
@@ -1,5 +1,8 @@
 #include "StarCellularLightArray.hpp"
 #include "StarInterpolation.hpp"
+
+#include <cstring>
+#include <limits>
 // just specializing these in a cpp file so I can iterate on them without recompiling like 40 files!!
 
 namespace Star {
@@ -150,4 +153,257 @@ void CellularLightArray<ColoredLightTraits>::calculatePointLighting(size_t xmin,
   }
 }
 
-}
\ No newline at end of file
+// Colored spread lighting is swept over bands of SpreadLanes columns at once,
+// with each color channel in its own plane.  A cell spreads along its own
+// column and into three cells of the next column in the sweep, so once the
+// rows of each column in a band are skewed by two against the column before
+// it, the cells in the same skewed row are independent of each other and are
+// spread together.  The sweep left and down goes through the same skewed
+// rows in reverse.  Each spread is a per channel max, so the order light
+// arrives in a cell does not change the result.  Compilers without vector
+// extensions use the per cell sweeps.
+
+#if defined STAR_COMPILER_GNU || defined STAR_COMPILER_CLANG
+#define STAR_VECTORIZED_LIGHT_SPREAD
+#endif
+
+#if defined STAR_VECTORIZED_LIGHT_SPREAD && defined STAR_ARCHITECTURE_X86_64 && defined STAR_SYSTEM_LINUX
+// Picks the widest instruction set the CPU supports when first called
+#define STAR_LIGHT_SPREAD_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define STAR_LIGHT_SPREAD_KERNEL
+#endif
+
+#ifdef STAR_VECTORIZED_LIGHT_SPREAD
+
+namespace {
+  size_t const SpreadLanes = 8;
+  // Neighboring bands share a column, the last lane of one band is the first
+  // of the next.  It is spread from in one direction and into in the other.
+  size_t const SpreadBandStride = SpreadLanes + 1;
+
+  // Compiled to whatever vector registers the target has, two SSE registers
+  // or a single AVX one on x86
+  typedef float SpreadFloats __attribute__((vector_size(SpreadLanes * sizeof(float))));
+
+  // Spread light from a cell without any, below any real spread result so it
+  // never wins a max
+  float const NoSpread = std::numeric_limits<float>::lowest();
+
+  // Row j of lane k holds the cell at y = j - 2 * k of the k'th column
+  struct SpreadBand {
+    float* red;
+    float* green;
+    float* blue;
+    // Straight drop of the cells that spread light, 0 for the cells that only
+    // receive it
+    float* drop;
+  };
+
+  struct SpreadDrops {
+    float obstacle;
+    float airDiag;
+    float obstacleDiag;
+  };
+
+  // Vectors are only ever passed by reference, passing them by value would
+  // depend on the instruction set of the caller.
+  inline void loadLanes(SpreadFloats& lanes, float const* values) {
+    memcpy(&lanes, values, sizeof(lanes));
+  }
+
+  inline void spreadInto(float* values, SpreadFloats const& light) {
+    SpreadFloats lanes;
+    loadLanes(lanes, values);
+    lanes = lanes > light ? lanes : light;
+    memcpy(values, &lanes, sizeof(lanes));
+  }
+
+  // Spreads count rows starting at the given one, stepping by rowStep.  Up
+  // and right a row step is +SpreadBandStride, light is spread from lanes
+  // [0, SpreadLanes) into the lanes one higher.  Down and left it is
+  // -SpreadBandStride and the lanes are the other way around.
+  STAR_LIGHT_SPREAD_KERNEL void spreadBandRows(SpreadBand band, SpreadDrops drops, size_t row, ptrdiff_t rowStep,
+      size_t count, size_t sourceLane, size_t targetLane) {
+    SpreadFloats const zero = {};
+    SpreadFloats const noSpread = zero + NoSpread;
+    SpreadFloats const obstacleDrop = zero + drops.obstacle;
+    SpreadFloats const airDiagDrop = zero + drops.airDiag;
+    SpreadFloats const obstacleDiagDrop = zero + drops.obstacleDiag;
+
+    for (size_t n = 0; n < count; ++n, row += rowStep) {
+      size_t source = row + sourceLane;
+      SpreadFloats red, green, blue, straightDrop;
+      loadLanes(red, band.red + source);
+      loadLanes(green, band.green + source);
+      loadLanes(blue, band.blue + source);
+      loadLanes(straightDrop, band.drop + source);
+
+      SpreadFloats maxChannel = red > green ? red : green;
+      maxChannel = maxChannel > blue ? maxChannel : blue;
+      auto lit = (maxChannel > zero) & (straightDrop > zero);
+      // Most rows in dark areas spread nothing at all
+      bool anyLit = false;
+      for (size_t k = 0; k < SpreadLanes; ++k)
+        anyLit |= lit[k] != 0;
+      if (!anyLit)
+        continue;
+
+      SpreadFloats diagDrop = straightDrop == obstacleDrop ? obstacleDiagDrop : airDiagDrop;
+      straightDrop /= maxChannel;
+      diagDrop /= maxChannel;
+
+      SpreadFloats straightRed = lit ? red - red * straightDrop : noSpread;
+      SpreadFloats straightGreen = lit ? green - green * straightDrop : noSpread;
+      SpreadFloats straightBlue = lit ? blue - blue * straightDrop : noSpread;
+      SpreadFloats diagRed = lit ? red - red * diagDrop : noSpread;
+      SpreadFloats diagGreen = lit ? green - green * diagDrop : noSpread;
+      SpreadFloats diagBlue = lit ? blue - blue * diagDrop : noSpread;
+
+      // Along the same column
+      size_t along = source + rowStep;
+      spreadInto(band.red + along, straightRed);
+      spreadInto(band.green + along, straightGreen);
+      spreadInto(band.blue + along, straightBlue);
+
+      // Straight across into the next column, and diagonally to either side
+      size_t across = row + 2 * rowStep + targetLane;
+      spreadInto(band.red + across, straightRed);
+      spreadInto(band.green + across, straightGreen);
+      spreadInto(band.blue + across, straightBlue);
+
+      size_t diagBehind = row + rowStep + targetLane;
+      spreadInto(band.red + diagBehind, diagRed);
+      spreadInto(band.green + diagBehind, diagGreen);
+      spreadInto(band.blue + diagBehind, diagBlue);
+
+      size_t diagAhead = row + 3 * rowStep + targetLane;
+      spreadInto(band.red + diagAhead, diagRed);
+      spreadInto(band.green + diagAhead, diagGreen);
+      spreadInto(band.blue + diagAhead, diagBlue);
+    }
+  }
+}
+
+#endif
+
+template <>
+void CellularLightArray<ColoredLightTraits>::spreadLight(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
+#ifdef STAR_VECTORIZED_LIGHT_SPREAD
+  if (!m_vectorizedSpread) {
+    spreadLightCells(cells, xMin, yMin, xMax, yMax);
+    return;
+  }
+
+  if (xMax < xMin + 3 || yMax < yMin + 3)
+    return;
+
+  float dropoffAir = 1.0f / m_spreadMaxAir;
+  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
+  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
+  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
+
+  size_t width = xMax - xMin;
+  size_t height = yMax - yMin;
+  // Band b holds the columns [b * SpreadLanes, (b + 1) * SpreadLanes]
+  size_t bandCount = (width - 2) / SpreadLanes + 1;
+  // Enough for the skew of the last lane and the rows spread into beyond it
+  size_t rows = height + 2 * SpreadLanes;
+  size_t planeSize = rows * SpreadBandStride;
+
+  // Reused between calculations, and there is one per thread since stripes
+  // of the same array are spread at the same time
+  thread_local List<float> planes;
+  planes.resize(bandCount * planeSize * 4);
+  List<SpreadBand> bands(bandCount);
+  for (size_t b = 0; b < bandCount; ++b) {
+    float* plane = planes.ptr() + b * planeSize * 4;
+    bands[b] = SpreadBand{plane, plane + planeSize, plane + planeSize * 2, plane + planeSize * 3};
+  }
+  SpreadDrops drops{dropoffObstacle, dropoffAirDiag, dropoffObstacleDiag};
+
+  auto laneIndex = [](size_t lane, size_t y) {
+    return (y + 2 * lane) * SpreadBandStride + lane;
+  };
+
+  for (size_t b = 0; b < bandCount; ++b) {
+    auto const& band = bands[b];
+    for (size_t k = 0; k < SpreadBandStride; ++k) {
+      size_t x = b * SpreadLanes + k;
+      // Cells outside of the region stay dark and never spread
+      auto clear = [&](size_t rowBegin, size_t rowEnd) {
+        for (size_t j = rowBegin; j < rowEnd; ++j) {
+          size_t i = j * SpreadBandStride + k;
+          band.red[i] = band.green[i] = band.blue[i] = band.drop[i] = 0.0f;
+        }
+      };
+      if (x >= width) {
+        clear(0, rows);
+        continue;
+      }
+      clear(0, 2 * k);
+      clear(2 * k + height, rows);
+
+      Cell const* column = cells + (xMin + x) * m_height + yMin;
+      bool sourceColumn = x > 0 && x < width - 1;
+      for (size_t y = 0; y < height; ++y) {
+        size_t i = laneIndex(k, y);
+        band.red[i] = column[y].light[0];
+        band.green[i] = column[y].light[1];
+        band.blue[i] = column[y].light[2];
+        if (sourceColumn && y > 0 && y < height - 1)
+          band.drop[i] = column[y].obstacle ? dropoffObstacle : dropoffAir;
+        else
+          band.drop[i] = 0.0f;
+      }
+    }
+  }
+
+  // The light a band spread into its last or first lane carries over into
+  // the band sharing that column, before that band spreads from it
+  auto carryLane = [&](SpreadBand const& from, size_t fromLane, SpreadBand const& to, size_t toLane) {
+    for (size_t y = 0; y < height; ++y) {
+      size_t i = laneIndex(fromLane, y);
+      size_t j = laneIndex(toLane, y);
+      to.red[j] = from.red[i];
+      to.green[j] = from.green[i];
+      to.blue[j] = from.blue[i];
+    }
+  };
+
+  // Every skewed row with a source cell in it, [1, height - 1) of lane 0 to
+  // the same of lane SpreadLanes - 1, or lane SpreadLanes going back
+  size_t sweepRows = height - 2 + 2 * (SpreadLanes - 1);
+  for (unsigned p = 0; p < m_spreadPasses; ++p) {
+    // Spread right and up and diag up right / diag down right
+    for (size_t b = 0; b < bandCount; ++b) {
+      if (b > 0)
+        carryLane(bands[b - 1], SpreadLanes, bands[b], 0);
+      spreadBandRows(bands[b], drops, SpreadBandStride, SpreadBandStride, sweepRows, 0, 1);
+    }
+
+    // Spread left and down and diag up left / diag down left
+    for (size_t b = bandCount; b-- > 0;) {
+      if (b + 1 < bandCount)
+        carryLane(bands[b + 1], 0, bands[b], SpreadLanes);
+      spreadBandRows(bands[b], drops, (height - 2 + 2 * SpreadLanes) * SpreadBandStride, -(ptrdiff_t)SpreadBandStride, sweepRows, 1, 0);
+    }
+  }
+
+  // After sweeping back, a shared column is last up to date as the last lane
+  for (size_t b = 0; b < bandCount; ++b) {
+    auto const& band = bands[b];
+    for (size_t k = b == 0 ? 0 : 1; k < SpreadBandStride && b * SpreadLanes + k < width; ++k) {
+      Cell* column = cells + (xMin + b * SpreadLanes + k) * m_height + yMin;
+      for (size_t y = 0; y < height; ++y) {
+        size_t i = laneIndex(k, y);
+        column[y].light = Vec3F(band.red[i], band.green[i], band.blue[i]);
+      }
+    }
+  }
+#else
+  spreadLightCells(cells, xMin, yMin, xMax, yMax);
+#endif
+}
+
+}
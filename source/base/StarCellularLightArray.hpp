@@ -2,6 +2,7 @@
 
 #include "StarList.hpp"
 #include "StarVector.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -98,15 +99,37 @@ public:
   // lighting, and initial lighting must be given for the ambient border this
   // given rect, and the array size must be at least that large.  xMax / yMax
   // are not inclusive, the range is [xMin, xMax) and [yMin, yMax).
-  void calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax);
+  //
+  // If a worker pool is given, the work is split into column stripes run on
+  // the pool and the calling thread.  Point lighting is computed per cell,
+  // and spread lighting runs each stripe on a private copy overlapping its
+  // neighbors by the furthest any light can spread, which gives the same
+  // result for scalar light.  Colored light can carry a faint channel along
+  // with a brighter one past that, so faint colors near the edges of stripes
+  // can come out slightly differently.
+  void calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax, WorkerPool* workerPool = nullptr);
+
+  // Colored lighting spreads with a kernel that sweeps whole columns of
+  // separate color channels, on by default.  Turning it off falls back to the
+  // per cell sweeps, which calculate the same light up to float rounding,
+  // for comparison.
+  void setVectorizedSpread(bool vectorizedSpread);
+  bool vectorizedSpread() const;
 
-private:
   // Set 4 points based on interpolated light position and free space
-  // attenuation.
+  // attenuation.  This is the first step of 'calculate', public along with
+  // the point lights for finishing a calculation somewhere else.
   void setSpreadLightingPoints();
+  List<PointLight> const& pointLights() const;
+
+private:
 
   // Spreads light out in an octagonal based cellular automata
-  void calculateLightSpread(size_t xmin, size_t ymin, size_t xmax, size_t ymax);
+  void calculateLightSpread(size_t xmin, size_t ymin, size_t xmax, size_t ymax, WorkerPool* workerPool);
+  // Runs the spread passes over the given range of cells, laid out in columns
+  // of m_height starting at the given pointer
+  void spreadLight(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax);
+  void spreadLightCells(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax);
 
   // Loops through each light and adds light strength based on distance and
   // obstacle attenuation.  Calculates within the given sub-rect
@@ -117,11 +140,17 @@ private:
   // circularized.
   float lineAttenuation(Vec2F const& start, Vec2F const& end, float perObstacleAttenuation, float maxAttenuation);
 
+  // Calls the given function with every stripe index, spread over the worker
+  // pool and the calling thread, and waits for all of them.
+  template <typename Function>
+  void forEachStripe(WorkerPool* workerPool, size_t stripes, Function function);
+
   size_t m_width;
   size_t m_height;
   unique_ptr<Cell[]> m_cells;
   List<SpreadLight> m_spreadLights;
   List<PointLight> m_pointLights;
+  List<List<Cell>> m_stripeCells;
 
   unsigned m_spreadPasses;
   float m_spreadMaxAir;
@@ -130,11 +159,15 @@ private:
   float m_pointMaxObstacle;
   float m_pointObstacleBoost;
   bool m_pointAdditive;
+  bool m_vectorizedSpread = true;
 };
 
 typedef CellularLightArray<ColoredLightTraits> ColoredCellularLightArray;
 typedef CellularLightArray<ScalarLightTraits> ScalarCellularLightArray;
 
+template <>
+void CellularLightArray<ColoredLightTraits>::spreadLight(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax);
+
 inline float ScalarLightTraits::spread(float source, float dest, float drop) {
   return std::max(source - drop, dest);
 }
@@ -292,10 +325,48 @@ auto CellularLightArray<LightTraits>::cellAtIndex(size_t index) -> Cell & {
 }
 
 template <typename LightTraits>
-void CellularLightArray<LightTraits>::calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
+void CellularLightArray<LightTraits>::calculate(size_t xMin, size_t yMin, size_t xMax, size_t yMax, WorkerPool* workerPool) {
   setSpreadLightingPoints();
-  calculateLightSpread(xMin, yMin, xMax, yMax);
-  calculatePointLighting(xMin, yMin, xMax, yMax);
+  calculateLightSpread(xMin, yMin, xMax, yMax, workerPool);
+
+  size_t stripes = workerPool ? min(workerPool->getWorkerCount() + 1, xMax - xMin) : 1;
+  if (stripes <= 1) {
+    calculatePointLighting(xMin, yMin, xMax, yMax);
+  } else {
+    size_t stripeWidth = (xMax - xMin + stripes - 1) / stripes;
+    forEachStripe(workerPool, stripes, [&](size_t stripe) {
+        size_t stripeMin = xMin + stripe * stripeWidth;
+        if (stripeMin < xMax)
+          calculatePointLighting(stripeMin, yMin, min(xMax, stripeMin + stripeWidth), yMax);
+      });
+  }
+}
+
+template <typename LightTraits>
+template <typename Function>
+void CellularLightArray<LightTraits>::forEachStripe(WorkerPool* workerPool, size_t stripes, Function function) {
+  List<WorkerPoolHandle> handles;
+  for (size_t stripe = 1; stripe < stripes; ++stripe)
+    handles.append(workerPool->addWork([&function, stripe]() { function(stripe); }));
+
+  // The work refers to this frame, so it must all be finished before leaving
+  // even if something throws.
+  std::exception_ptr error;
+  try {
+    function(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  for (auto const& handle : handles) {
+    try {
+      handle.finish();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+  if (error)
+    std::rethrow_exception(error);
 }
 
 template <typename LightTraits>
@@ -337,13 +408,13 @@ void CellularLightArray<LightTraits>::setSpreadLightingPoints() {
 }
 
 template <typename LightTraits>
-void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
-  starAssert(m_width > 0 && m_height > 0);
+auto CellularLightArray<LightTraits>::pointLights() const -> List<PointLight> const& {
+  return m_pointLights;
+}
 
-  float dropoffAir = 1.0f / m_spreadMaxAir;
-  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
-  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
-  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t yMin, size_t xMax, size_t yMax, WorkerPool* workerPool) {
+  starAssert(m_width > 0 && m_height > 0);
 
   // enlarge x/y min/max taking into ambient spread of light
   xMin = xMin - min(xMin, (size_t)ceil(m_spreadMaxAir));
@@ -351,6 +422,74 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
   xMax = min(m_width, xMax + (size_t)ceil(m_spreadMaxAir));
   yMax = min(m_height, yMax + (size_t)ceil(m_spreadMaxAir));
 
+  size_t stripes = workerPool ? workerPool->getWorkerCount() + 1 : 1;
+  size_t overlap = 0;
+  if (stripes > 1) {
+    // Light can not spread further than the overlap, so a stripe only needs
+    // the cells within it to arrive at the same values for its own columns.
+    float maxIntensity = 1.0f;
+    for (size_t i = xMin * m_height; i < xMax * m_height; ++i)
+      maxIntensity = std::max(maxIntensity, LightTraits::maxIntensity(m_cells[i].light));
+    overlap = (size_t)ceil(m_spreadMaxAir * maxIntensity) + 1;
+    stripes = min(stripes, (xMax - xMin) / (overlap * 2));
+  }
+
+  if (stripes <= 1) {
+    spreadLight(m_cells.get(), xMin, yMin, xMax, yMax);
+    return;
+  }
+
+  size_t stripeWidth = (xMax - xMin + stripes - 1) / stripes;
+  m_stripeCells.resize(stripes);
+  forEachStripe(workerPool, stripes, [&](size_t stripe) {
+      size_t stripeMin = xMin + stripe * stripeWidth;
+      if (stripeMin >= xMax)
+        return;
+      size_t copyMin = stripeMin - min(stripeMin - xMin, overlap);
+      size_t copyMax = min(xMax, stripeMin + stripeWidth + overlap);
+
+      auto& cells = m_stripeCells[stripe];
+      cells.resize((copyMax - copyMin) * m_height);
+      std::copy(m_cells.get() + copyMin * m_height, m_cells.get() + copyMax * m_height, cells.ptr());
+      spreadLight(cells.ptr(), 0, yMin, copyMax - copyMin, yMax);
+    });
+
+  // Only copy back once every stripe is done reading its overlap
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    size_t stripeMin = xMin + stripe * stripeWidth;
+    if (stripeMin >= xMax)
+      break;
+    size_t stripeMax = min(xMax, stripeMin + stripeWidth);
+    size_t copyMin = stripeMin - min(stripeMin - xMin, overlap);
+
+    auto const& cells = m_stripeCells[stripe];
+    auto begin = cells.ptr() + (stripeMin - copyMin) * m_height;
+    std::copy(begin, begin + (stripeMax - stripeMin) * m_height, m_cells.get() + stripeMin * m_height);
+  }
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::setVectorizedSpread(bool vectorizedSpread) {
+  m_vectorizedSpread = vectorizedSpread;
+}
+
+template <typename LightTraits>
+bool CellularLightArray<LightTraits>::vectorizedSpread() const {
+  return m_vectorizedSpread;
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::spreadLight(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
+  spreadLightCells(cells, xMin, yMin, xMax, yMax);
+}
+
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::spreadLightCells(Cell* cells, size_t xMin, size_t yMin, size_t xMax, size_t yMax) {
+  float dropoffAir = 1.0f / m_spreadMaxAir;
+  float dropoffObstacle = 1.0f / m_spreadMaxObstacle;
+  float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
+  float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
+
   for (unsigned p = 0; p < m_spreadPasses; ++p) {
     // Spread right and up and diag up right / diag down right
     for (size_t x = xMin + 1; x < xMax - 1; ++x) {
@@ -358,11 +497,11 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
       size_t xRightCellOffset = (x + 1) * m_height;
 
       for (size_t y = yMin + 1; y < yMax - 1; ++y) {
-        auto cell = cellAtIndex(xCellOffset + y);
-        auto& cellRight = cellAtIndex(xRightCellOffset + y);
-        auto& cellUp = cellAtIndex(xCellOffset + y + 1);
-        auto& cellRightUp = cellAtIndex(xRightCellOffset + y + 1);
-        auto& cellRightDown = cellAtIndex(xRightCellOffset + y - 1);
+        auto cell = cells[xCellOffset + y];
+        auto& cellRight = cells[xRightCellOffset + y];
+        auto& cellUp = cells[xCellOffset + y + 1];
+        auto& cellRightUp = cells[xRightCellOffset + y + 1];
+        auto& cellRightDown = cells[xRightCellOffset + y - 1];
 
         float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
         float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
@@ -381,11 +520,11 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
       size_t xLeftCellOffset = (x - 1) * m_height;
 
       for (size_t y = yMax - 2; y > yMin; --y) {
-        auto cell = cellAtIndex(xCellOffset + y);
-        auto& cellLeft = cellAtIndex(xLeftCellOffset + y);
-        auto& cellDown = cellAtIndex(xCellOffset + y - 1);
-        auto& cellLeftUp = cellAtIndex(xLeftCellOffset + y + 1);
-        auto& cellLeftDown = cellAtIndex(xLeftCellOffset + y - 1);
+        auto cell = cells[xCellOffset + y];
+        auto& cellLeft = cells[xLeftCellOffset + y];
+        auto& cellDown = cells[xCellOffset + y - 1];
+        auto& cellLeftUp = cells[xLeftCellOffset + y + 1];
+        auto& cellLeftDown = cells[xLeftCellOffset + y - 1];
 
         float straightDropoff = cell.obstacle ? dropoffObstacle : dropoffAir;
         float diagDropoff = cell.obstacle ? dropoffObstacleDiag : dropoffAirDiag;
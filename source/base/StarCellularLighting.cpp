@@ -2,6 +2,14 @@
 
 namespace Star {
 
+namespace {
+  // Granularity that incremental calculation tracks changes at
+  int const IncrementalBlockSize = 8;
+  // Past this fraction of the query region changed, incremental calculation
+  // falls back to calculating everything.
+  float const IncrementalMaxChangedFraction = 0.5f;
+}
+
 Lightmap::Lightmap() : m_width(0), m_height(0) {}
 
 Lightmap::Lightmap(unsigned width, unsigned height) : m_width(width), m_height(height) {
@@ -21,7 +29,7 @@ Lightmap& Lightmap::operator=(Lightmap const& lightMap) {
   m_height = lightMap.m_height;
   if (lightMap.m_data) {
     m_data = std::make_unique<float[]>(len());
-    memcpy(m_data.get(), lightMap.m_data.get(), len());
+    memcpy(m_data.get(), lightMap.m_data.get(), len() * sizeof(float));
   }
   return *this;
 }
@@ -42,7 +50,7 @@ Lightmap::operator ImageView() {
 }
 
 CellularLightingCalculator::CellularLightingCalculator(bool monochrome)
-    : m_monochrome(monochrome)
+    : m_monochrome(monochrome), m_incremental(false)
 {
     if (monochrome)
         m_lightArray.setRight(ScalarCellularLightArray());
@@ -55,6 +63,7 @@ void CellularLightingCalculator::setMonochrome(bool monochrome) {
     return;
 
   m_monochrome = monochrome;
+  resetIncrementalState();
   if (monochrome)
     m_lightArray.setRight(ScalarCellularLightArray());
   else
@@ -65,7 +74,21 @@ void CellularLightingCalculator::setMonochrome(bool monochrome) {
 }
 
 void CellularLightingCalculator::setParameters(Json const& config) {
+  if (config != m_config)
+    resetIncrementalState();
   m_config = config;
+  m_incremental = config.getBool("incrementalCalculation", false);
+  if (!m_incremental)
+    resetIncrementalState();
+
+  // Counts the calling thread, so 1 calculates everything on it
+  size_t threads = max<size_t>(config.getUInt("calculationThreads", 1), 1);
+  if ((m_workerPool ? m_workerPool->getWorkerCount() + 1 : 1) != threads) {
+    if (threads > 1)
+      m_workerPool = make_unique<WorkerPool>("CellularLightingCalculator", threads - 1);
+    else
+      m_workerPool.reset();
+  }
   if (m_monochrome)
     m_lightArray.right().setParameters(
         config.getInt("spreadPasses"),
@@ -97,6 +120,12 @@ void CellularLightingCalculator::begin(RectI const& queryRegion) {
     m_calculationRegion = RectI(queryRegion).padded((int)m_lightArray.left().borderCells());
     m_lightArray.left().begin(m_calculationRegion.width(), m_calculationRegion.height());
   }
+
+  if (m_incremental) {
+    m_cellInputs.clear();
+    m_cellInputs.resize(m_calculationRegion.width() * m_calculationRegion.height(), Cell{Vec3F(), false});
+    m_lightInputs.clear();
+  }
 }
 
 RectI CellularLightingCalculator::calculationRegion() const {
@@ -104,6 +133,8 @@ RectI CellularLightingCalculator::calculationRegion() const {
 }
 
 void CellularLightingCalculator::addSpreadLight(Vec2F const& position, Vec3F const& light) {
+  if (m_incremental)
+    m_lightInputs.append(LightInput{position, light, 0.0f, 0.0f, 0.0f, false, false});
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   if (m_monochrome)
     m_lightArray.right().addSpreadLight({arrayPosition, light.max()});
@@ -112,6 +143,8 @@ void CellularLightingCalculator::addSpreadLight(Vec2F const& position, Vec3F con
 }
 
 void CellularLightingCalculator::addPointLight(Vec2F const& position, Vec3F const& light, float beam, float beamAngle, float beamAmbience, bool asSpread) {
+  if (m_incremental)
+    m_lightInputs.append(LightInput{position, light, beam, beamAngle, beamAmbience, true, asSpread});
   Vec2F arrayPosition = position - Vec2F(m_calculationRegion.min());
   if (m_monochrome)
     m_lightArray.right().addPointLight({arrayPosition, light.max(), beam, beamAngle, beamAmbience, asSpread});
@@ -124,9 +157,9 @@ void CellularLightingCalculator::calculate(Image& output) {
   Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
 
   if (m_monochrome)
-    m_lightArray.right().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+    m_lightArray.right().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1], m_workerPool.get());
   else
-    m_lightArray.left().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+    m_lightArray.left().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1], m_workerPool.get());
 
   output.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], PixelFormat::RGB24);
 
@@ -146,36 +179,63 @@ void CellularLightingCalculator::calculate(Image& output) {
 }
 
 void CellularLightingCalculator::calculate(Lightmap& output) {
+  if (m_incremental && calculateIncremental(output)) {
+    keepIncrementalState(output);
+    return;
+  }
+
   Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
   Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
 
-  if (m_monochrome)
-    m_lightArray.right().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
-  else
-    m_lightArray.left().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+  calculateArray(arrayMin, arrayMax);
 
   output = Lightmap(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1]);
 
   float brightnessLimit = m_config.getFloat("brightnessLimit");
+  for (size_t x = arrayMin[0]; x < arrayMax[0]; ++x) {
+    for (size_t y = arrayMin[1]; y < arrayMax[1]; ++y)
+      output.set(x - arrayMin[0], y - arrayMin[1], outputLight(x, y, brightnessLimit));
+  }
+
+  if (m_incremental)
+    keepIncrementalState(output);
+}
 
+void CellularLightingCalculator::calculate(CellularLightingInput& output) {
+  Vec2U size = Vec2U(m_calculationRegion.size());
+  output.size = size;
+  output.queryRegion = RectU(m_queryRegion.translated(-m_calculationRegion.min()));
+  output.cells.resize(size[0] * size[1]);
+  output.pointLights.clear();
+  output.parameters = m_config;
+
+  float maxIntensity = 0.0f;
   if (m_monochrome) {
-    for (size_t x = arrayMin[0]; x < arrayMax[0]; ++x) {
-      for (size_t y = arrayMin[1]; y < arrayMax[1]; ++y) {
-        auto light = min(m_lightArray.right().getLight(x, y), brightnessLimit);
-        output.set(x - arrayMin[0], y - arrayMin[1], light);
+    auto& lightArray = m_lightArray.right();
+    lightArray.setSpreadLightingPoints();
+    for (size_t x = 0; x < size[0]; ++x) {
+      for (size_t y = 0; y < size[1]; ++y) {
+        auto const& cell = lightArray.cell(x, y);
+        output.cells[y * size[0] + x] = Vec4F(cell.light, cell.light, cell.light, cell.obstacle ? 1.0f : 0.0f);
+        maxIntensity = std::max(maxIntensity, cell.light);
       }
     }
+    for (auto const& light : lightArray.pointLights())
+      output.pointLights.append({light.position, Vec3F::filled(light.value), light.beam, light.beamAngle, light.beamAmbience, light.asSpread});
   } else {
-    for (size_t x = arrayMin[0]; x < arrayMax[0]; ++x) {
-      for (size_t y = arrayMin[1]; y < arrayMax[1]; ++y) {
-        auto light = m_lightArray.left().getLight(x, y);
-        float intensity = ColoredLightTraits::maxIntensity(light);
-        if (intensity > brightnessLimit)
-          light *= brightnessLimit / intensity;
-        output.set(x - arrayMin[0], y - arrayMin[1], light);
+    auto& lightArray = m_lightArray.left();
+    lightArray.setSpreadLightingPoints();
+    for (size_t x = 0; x < size[0]; ++x) {
+      for (size_t y = 0; y < size[1]; ++y) {
+        auto const& cell = lightArray.cell(x, y);
+        output.cells[y * size[0] + x] = Vec4F(cell.light[0], cell.light[1], cell.light[2], cell.obstacle ? 1.0f : 0.0f);
+        maxIntensity = std::max(maxIntensity, cell.light.max());
       }
     }
+    output.pointLights.appendAll(lightArray.pointLights());
   }
+
+  output.spreadSteps = (unsigned)ceil(m_config.getFloat("spreadMaxAir") * maxIntensity);
 }
 
 void CellularLightingCalculator::setupImage(Image& image, PixelFormat format) const {
@@ -185,6 +245,234 @@ void CellularLightingCalculator::setupImage(Image& image, PixelFormat format) co
   image.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], format);
 }
 
+bool CellularLightingCalculator::LightInput::operator<(LightInput const& rhs) const {
+  return tie(position, light, beam, beamAngle, beamAmbience, point, asSpread)
+      < tie(rhs.position, rhs.light, rhs.beam, rhs.beamAngle, rhs.beamAmbience, rhs.point, rhs.asSpread);
+}
+
+void CellularLightingCalculator::calculateArray(Vec2S const& min, Vec2S const& max) {
+  if (m_monochrome)
+    m_lightArray.right().calculate(min[0], min[1], max[0], max[1], m_workerPool.get());
+  else
+    m_lightArray.left().calculate(min[0], min[1], max[0], max[1], m_workerPool.get());
+}
+
+Vec3F CellularLightingCalculator::outputLight(size_t x, size_t y, float brightnessLimit) const {
+  if (m_monochrome) {
+    float light = min(m_lightArray.right().getLight(x, y), brightnessLimit);
+    return Vec3F::filled(light);
+  }
+
+  auto light = m_lightArray.left().getLight(x, y);
+  float intensity = ColoredLightTraits::maxIntensity(light);
+  if (intensity > brightnessLimit)
+    light *= brightnessLimit / intensity;
+  return light;
+}
+
+bool CellularLightingCalculator::calculateIncremental(Lightmap& output) {
+  Vec2I size = m_calculationRegion.size();
+  Vec2I offset = m_calculationRegion.min() - m_previousCalculationRegion.min();
+  if (m_previousLightmap.empty() || m_previousCalculationRegion.size() != size
+      || abs(offset[0]) >= size[0] || abs(offset[1]) >= size[1])
+    return false;
+
+  // A change to a cell only affects cells within reach of light passing
+  // through it, and a light source only the cells within its own reach.
+  float spreadMaxAir = m_config.getFloat("spreadMaxAir");
+  float pointMaxAir = m_config.getFloat("pointMaxAir");
+  float maxIntensity = 1.0f;
+  float pointReach = 0.0f;
+  for (auto const& cell : m_cellInputs)
+    maxIntensity = std::max(maxIntensity, cell.light.max());
+  for (auto const& cell : m_previousCellInputs)
+    maxIntensity = std::max(maxIntensity, cell.light.max());
+  for (auto const& inputs : {&m_lightInputs, &m_previousLightInputs}) {
+    for (auto const& light : *inputs) {
+      if (light.point)
+        pointReach = std::max(pointReach, light.light.max() * (light.asSpread ? spreadMaxAir : pointMaxAir));
+      else
+        maxIntensity = std::max(maxIntensity, light.light.max());
+    }
+  }
+  int spreadReach = (int)ceil(spreadMaxAir * maxIntensity) + 1;
+  int reach = std::max(spreadReach, (int)ceil(pointReach) + 1);
+
+  int blocksWidth = (size[0] + IncrementalBlockSize - 1) / IncrementalBlockSize;
+  int blocksHeight = (size[1] + IncrementalBlockSize - 1) / IncrementalBlockSize;
+  List<uint8_t> changed(blocksWidth * blocksHeight, 0);
+  auto markChanged = [&](Vec2I const& position) {
+    int bx = clamp(position[0], 0, size[0] - 1) / IncrementalBlockSize;
+    int by = clamp(position[1], 0, size[1] - 1) / IncrementalBlockSize;
+    changed[bx * blocksHeight + by] = 1;
+  };
+
+  for (int x = 0; x < size[0]; ++x) {
+    int px = x + offset[0];
+    for (int y = 0; y < size[1]; ++y) {
+      int py = y + offset[1];
+      if (px < 0 || py < 0 || px >= size[0] || py >= size[1]) {
+        markChanged({x, y});
+        continue;
+      }
+      auto const& cell = m_cellInputs[x * size[1] + y];
+      auto const& previous = m_previousCellInputs[px * size[1] + py];
+      if (cell.obstacle != previous.obstacle || cell.light != previous.light)
+        markChanged({x, y});
+    }
+  }
+
+  // Cells that are no longer in the region changed the light at its edge
+  for (int y = 0; y < size[1]; ++y) {
+    if (offset[0] != 0)
+      markChanged({offset[0] > 0 ? 0 : size[0] - 1, y});
+  }
+  for (int x = 0; x < size[0]; ++x) {
+    if (offset[1] != 0)
+      markChanged({x, offset[1] > 0 ? 0 : size[1] - 1});
+  }
+
+  // Lights that were added, removed or changed in any way
+  sort(m_lightInputs);
+  Vec2F regionMin = Vec2F(m_calculationRegion.min());
+  auto markLight = [&](LightInput const& light) {
+    markChanged(Vec2I((light.position - regionMin).floor()));
+  };
+  auto current = m_lightInputs.begin();
+  auto previous = m_previousLightInputs.begin();
+  while (current != m_lightInputs.end() || previous != m_previousLightInputs.end()) {
+    if (previous == m_previousLightInputs.end() || (current != m_lightInputs.end() && *current < *previous)) {
+      markLight(*current++);
+    } else if (current == m_lightInputs.end() || *previous < *current) {
+      markLight(*previous++);
+    } else {
+      ++current;
+      ++previous;
+    }
+  }
+
+  // Spread the changes by the reach, and add everything the previous query
+  // region did not cover
+  int blockReach = (reach + IncrementalBlockSize - 1) / IncrementalBlockSize;
+  List<uint8_t> dirty(blocksWidth * blocksHeight, 0);
+  for (int bx = 0; bx < blocksWidth; ++bx) {
+    for (int by = 0; by < blocksHeight; ++by) {
+      if (!changed[bx * blocksHeight + by])
+        continue;
+      for (int dx = std::max(bx - blockReach, 0); dx <= std::min(bx + blockReach, blocksWidth - 1); ++dx) {
+        for (int dy = std::max(by - blockReach, 0); dy <= std::min(by + blockReach, blocksHeight - 1); ++dy)
+          dirty[dx * blocksHeight + dy] = 1;
+      }
+    }
+  }
+
+  RectI query = m_queryRegion.translated(-m_calculationRegion.min());
+  RectI previousQuery = m_previousQueryRegion.translated(-m_calculationRegion.min());
+  for (int x = query.xMin(); x < query.xMax(); ++x) {
+    for (int y = query.yMin(); y < query.yMax(); ++y) {
+      if (!previousQuery.belongs(Vec2I(x, y)))
+        dirty[(x / IncrementalBlockSize) * blocksHeight + y / IncrementalBlockSize] = 1;
+    }
+  }
+
+  // Gather the dirty blocks inside the query region into rects, joining runs
+  // in each block row with the same run in the row below.
+  List<RectI> rects;
+  size_t dirtyArea = 0;
+  List<size_t> openRects;
+  int blockYMin = query.yMin() / IncrementalBlockSize;
+  int blockYMax = (query.yMax() + IncrementalBlockSize - 1) / IncrementalBlockSize;
+  int blockXMin = query.xMin() / IncrementalBlockSize;
+  int blockXMax = (query.xMax() + IncrementalBlockSize - 1) / IncrementalBlockSize;
+  for (int by = blockYMin; by < blockYMax; ++by) {
+    List<size_t> nextOpenRects;
+    int bx = blockXMin;
+    while (bx < blockXMax) {
+      if (!dirty[bx * blocksHeight + by]) {
+        ++bx;
+        continue;
+      }
+      int runStart = bx;
+      while (bx < blockXMax && dirty[bx * blocksHeight + by])
+        ++bx;
+
+      RectI run = RectI(runStart, by, bx, by + 1).scaled(IncrementalBlockSize).limited(query);
+      dirtyArea += run.volume();
+      auto open = openRects.filtered([&](size_t i) {
+          return rects[i].xMin() == run.xMin() && rects[i].xMax() == run.xMax();
+        });
+      if (!open.empty()) {
+        rects[open.first()].combine(run);
+        nextOpenRects.append(open.first());
+      } else {
+        nextOpenRects.append(rects.size());
+        rects.append(run);
+      }
+    }
+    openRects = std::move(nextOpenRects);
+  }
+
+  if (dirtyArea > query.volume() * IncrementalMaxChangedFraction)
+    return false;
+
+  output = Lightmap(query.width(), query.height());
+  Vec2I previousOffset = m_queryRegion.min() - m_previousQueryRegion.min();
+  for (int x = query.xMin(); x < query.xMax(); ++x) {
+    for (int y = query.yMin(); y < query.yMax(); ++y) {
+      if (previousQuery.belongs(Vec2I(x, y)))
+        output.set(x - query.xMin(), y - query.yMin(),
+            m_previousLightmap.get(x - query.xMin() + previousOffset[0], y - query.yMin() + previousOffset[1]));
+    }
+  }
+
+  // Spread light is only spread ceil(spreadMaxAir) cells into each
+  // calculated rect, so pad them for brighter light.  Every rect starts from
+  // the original cell inputs, not light already calculated by another rect.
+  RectI arrayRect = RectI::withSize(Vec2I(), size);
+  int spreadPad = std::max(spreadReach - (int)ceil(spreadMaxAir), 0);
+  float brightnessLimit = m_config.getFloat("brightnessLimit");
+  for (auto const& rect : rects) {
+    RectI calculated = rect.padded(spreadPad).limited(arrayRect);
+    RectI spread = calculated.padded((int)ceil(spreadMaxAir)).limited(arrayRect);
+    for (int x = spread.xMin(); x < spread.xMax(); ++x) {
+      for (int y = spread.yMin(); y < spread.yMax(); ++y) {
+        size_t index = x * size[1] + y;
+        auto const& cell = m_cellInputs[index];
+        if (m_monochrome)
+          m_lightArray.right().cellAtIndex(index) = ScalarCellularLightArray::Cell{cell.light.sum() / 3, cell.obstacle};
+        else
+          m_lightArray.left().cellAtIndex(index) = cell;
+      }
+    }
+
+    calculateArray(Vec2S(calculated.min()), Vec2S(calculated.max()));
+    for (int x = rect.xMin(); x < rect.xMax(); ++x) {
+      for (int y = rect.yMin(); y < rect.yMax(); ++y)
+        output.set(x - query.xMin(), y - query.yMin(), outputLight(x, y, brightnessLimit));
+    }
+  }
+
+  return true;
+}
+
+void CellularLightingCalculator::keepIncrementalState(Lightmap const& output) {
+  if (!is_sorted(m_lightInputs.begin(), m_lightInputs.end()))
+    sort(m_lightInputs);
+  m_previousQueryRegion = m_queryRegion;
+  m_previousCalculationRegion = m_calculationRegion;
+  swap(m_previousCellInputs, m_cellInputs);
+  swap(m_previousLightInputs, m_lightInputs);
+  m_previousLightmap = output;
+}
+
+void CellularLightingCalculator::resetIncrementalState() {
+  m_cellInputs.clear();
+  m_lightInputs.clear();
+  m_previousCellInputs.clear();
+  m_previousLightInputs.clear();
+  m_previousLightmap = Lightmap();
+}
+
 void CellularLightIntensityCalculator::setParameters(Json const& config) {
   m_lightArray.setParameters(
       config.getInt("spreadPasses"),
@@ -205,10 +493,22 @@ void CellularLightIntensityCalculator::begin(Vec2F const& queryPosition) {
   m_lightArray.begin(m_calculationRegion.width(), m_calculationRegion.height());
 }
 
+void CellularLightIntensityCalculator::begin(RectI const& queryRegion) {
+  m_queryPosition = Vec2F(queryRegion.center());
+  m_queryRegion = queryRegion;
+  m_calculationRegion = RectI(m_queryRegion).padded((int)m_lightArray.borderCells());
+
+  m_lightArray.begin(m_calculationRegion.width(), m_calculationRegion.height());
+}
+
 RectI CellularLightIntensityCalculator::calculationRegion() const {
   return m_calculationRegion;
 }
 
+size_t CellularLightIntensityCalculator::borderCells() const {
+  return m_lightArray.borderCells();
+}
+
 void CellularLightIntensityCalculator::setCell(Vec2I const& position, Cell const& cell) {
   setCellColumn(position, &cell, 1);
 }
@@ -249,4 +549,18 @@ float CellularLightIntensityCalculator::calculate() {
   return lerp(yl, lerp(xl, ll, lr), lerp(xl, ul, ur));
 }
 
+void CellularLightIntensityCalculator::calculate(List<float>& output) {
+  Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
+  Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
+
+  m_lightArray.calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+
+  size_t height = m_queryRegion.height();
+  output.resize(m_queryRegion.width() * height);
+  for (size_t x = 0; x < (size_t)m_queryRegion.width(); ++x) {
+    for (size_t y = 0; y < height; ++y)
+      output[x * height + y] = m_lightArray.getLight(arrayMin[0] + x, arrayMin[1] + y);
+  }
+}
+
 }
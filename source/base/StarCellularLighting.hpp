@@ -110,6 +110,27 @@ inline size_t Lightmap::len() const {
   return m_width * m_height * 3;
 }
 
+// The inputs of a CellularLightingCalculator calculation with the spread
+// lights already applied to the cells, for doing the spread and point
+// lighting somewhere else (such as on the GPU).
+struct CellularLightingInput {
+  bool empty() const;
+
+  // Size of the calculation region
+  Vec2U size;
+  // Light in rgb and 1 in alpha for obstacles, in rows of the calculation
+  // region
+  List<Vec4F> cells;
+  // The part of the calculation region the result is for
+  RectU queryRegion;
+  // In the same space as the cells
+  List<ColoredCellularLightArray::PointLight> pointLights;
+  // How many cells the brightest cell can spread light to
+  unsigned spreadSteps = 0;
+  // The lighting config the calculation was set up with
+  Json parameters;
+};
+
 // Produce lighting values from an integral cellular grid.  Allows for floating
 // positional point and cellular light sources, as well as pre-lighting cells
 // individually.
@@ -142,16 +163,57 @@ public:
   // output image.  The image will be reset to the size of the region given in
   // the call to 'begin', and formatted as RGB24.
   void calculate(Image& output);
-  // Same as above, but the color data in a float buffer instead.
+  // Same as above, but the color data in a float buffer instead.  With
+  // "incrementalCalculation" set, this keeps its inputs and result, and the
+  // next call only recalculates the blocks near whatever changed since (cells,
+  // lights, or edges newly exposed by moving the region).  The limited
+  // spread passes can route light around obstacles slightly differently in a
+  // recalculated block than in a full calculation.
   void calculate(Lightmap& output);
+  // Only applies the spread lights, and leaves the rest of the calculation
+  // to whatever 'output' is given to.
+  void calculate(CellularLightingInput& output);
 
   void setupImage(Image& image, PixelFormat format = PixelFormat::RGB24) const;
 private:
+  // Everything given to the calculator for one light source, in world space
+  struct LightInput {
+    bool operator<(LightInput const& rhs) const;
+
+    Vec2F position;
+    Vec3F light;
+    float beam;
+    float beamAngle;
+    float beamAmbience;
+    bool point;
+    bool asSpread;
+  };
+
+  void calculateArray(Vec2S const& min, Vec2S const& max);
+  Vec3F outputLight(size_t x, size_t y, float brightnessLimit) const;
+
+  // Reuses the previous Lightmap, only recalculating blocks that something
+  // changed within lighting range of.  Returns false if too much changed, or
+  // the previous calculation is unusable, and nothing has been calculated.
+  bool calculateIncremental(Lightmap& output);
+  void keepIncrementalState(Lightmap const& output);
+  void resetIncrementalState();
+
   Json m_config;
   bool m_monochrome;
   Either<ColoredCellularLightArray, ScalarCellularLightArray> m_lightArray;
+  unique_ptr<WorkerPool> m_workerPool;
   RectI m_queryRegion;
   RectI m_calculationRegion;
+
+  bool m_incremental;
+  List<Cell> m_cellInputs;
+  List<LightInput> m_lightInputs;
+  RectI m_previousQueryRegion;
+  RectI m_previousCalculationRegion;
+  List<Cell> m_previousCellInputs;
+  List<LightInput> m_previousLightInputs;
+  Lightmap m_previousLightmap;
 };
 
 // Produce light intensity values using the same algorithm as
@@ -164,8 +226,13 @@ public:
   void setParameters(Json const& config);
 
   void begin(Vec2F const& queryPosition);
+  // Calculates every cell of the given region at once instead of a single
+  // position.  Finish with calculate(List<float>&).
+  void begin(RectI const& queryRegion);
 
   RectI calculationRegion() const;
+  // How far beyond the query region cells and lights can affect the result
+  size_t borderCells() const;
 
   void setCell(Vec2I const& position, Cell const& cell);
   void setCellColumn(Vec2I const& position, Cell const* cells, size_t count);
@@ -174,6 +241,8 @@ public:
   void addPointLight(Vec2F const& position, float light, float beam, float beamAngle, float beamAmbience);
 
   float calculate();
+  // Light of each cell in the query region, in column major order
+  void calculate(List<float>& output);
 
 private:
   ScalarCellularLightArray m_lightArray;
@@ -182,11 +251,17 @@ private:
   RectI m_calculationRegion;
 };
 
+inline bool CellularLightingInput::empty() const {
+  return cells.empty();
+}
+
 inline size_t CellularLightingCalculator::baseIndexFor(Vec2I const& position) {
   return (position[0] - m_calculationRegion.xMin()) * m_calculationRegion.height() + position[1] - m_calculationRegion.yMin();
 }
 
 inline void CellularLightingCalculator::setCellIndex(size_t cellIndex, Vec3F const& light, bool obstacle) {
+  if (m_incremental)
+    m_cellInputs[cellIndex] = Cell{light, obstacle};
   if (m_monochrome)
     m_lightArray.right().cellAtIndex(cellIndex) = ScalarCellularLightArray::Cell{light.sum() / 3, obstacle};
   else
@@ -7,6 +7,9 @@
 #include "StarOrderedSet.hpp"
 #include "StarRandom.hpp"
 #include "StarBlockAllocator.hpp"
+#include "StarArray.hpp"
+#include "StarStaticRandom.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -37,7 +40,8 @@ struct CellularLiquidWorld {
   virtual CellularLiquidCell<LiquidId> cell(Vec2I const& location) const = 0;
 
   // Should return an amount between 0.0 and 1.0 as a percentage of liquid
-  // drain at this position
+  // drain at this position.  With an engine thread count above 1, this may be
+  // called from several threads at once.
   virtual float drainLevel(Vec2I const& location) const;
 
   // Will be called only on cells which for which the cell method returned a
@@ -66,6 +70,12 @@ struct LiquidCellEngineParameters {
   float minimumLivenLevelChange;
   float minimumLiquidLevel;
   float interactTransformationLevel;
+  // A cell whose level and pressure both change by less than this for
+  // equilibriumTicks updates in a row falls asleep.  Sleeping cells only
+  // wake when visited, or when a neighboring cell that is not asleep
+  // changes.  0 disables sleeping.
+  float equilibriumChangeThreshold;
+  unsigned equilibriumTicks;
 };
 
 template <typename LiquidId>
@@ -80,6 +90,15 @@ public:
 
   void setProcessingLimit(Maybe<unsigned> processingLimit);
 
+  // With a thread count of 0 (the default) every active cell is simulated in
+  // one pass on the calling thread.  Otherwise, active cells are split into
+  // square tiles which are scheduled so that no two tiles touching the same
+  // cells ever run together, and the tiles are spread over the given number
+  // of threads, including the calling one.  The tiled simulation produces the
+  // same results for any non-zero thread count.
+  unsigned threadCount() const;
+  void setThreadCount(unsigned threadCount);
+
   List<RectI> noProcessingLimitRegions() const;
   void setNoProcessingLimitRegions(List<RectI> noProcessingLimitRegions);
 
@@ -91,6 +110,7 @@ public:
   size_t activeCells() const;
   size_t activeCells(LiquidId liquid) const;
   bool isActive(Vec2I const& pos) const;
+  bool isAsleep(Vec2I const& pos) const;
 
 private:
   enum class Adjacency {
@@ -106,7 +126,12 @@ private:
     bool sourceCell;
     float level;
     float pressure;
+    float initialLevel;
+    float initialPressure;
 
+    // Set once all four adjacent cells have been looked up, at which point a
+    // null adjacent cell means there is no cell there.
+    bool linked;
     WorkingCell* leftCell;
     WorkingCell* rightCell;
     WorkingCell* topCell;
@@ -122,23 +147,55 @@ private:
   template <typename Value>
   using BAOrderedHashSet = OrderedHashSet<Value, hash<Value>, std::equal_to<Value>, BlockAllocator<Value, 4096>>;
 
+  // A group of active cells simulated together, along with everything the
+  // simulation of those cells produces, so that tiles can run in parallel.
+  struct WorkingTile {
+    List<WorkingCell*> cells;
+    BAHashSet<Vec2I> nextActiveCells;
+    BAHashSet<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> liquidInteractions;
+    BAHashSet<tuple<Vec2I, LiquidId, Vec2I>> liquidCollisions;
+  };
+
+  static int const TileSize = 32;
+
+  enum class ChunkCellState : uint8_t {
+    Unvisited,
+    Empty,
+    Present
+  };
+
+  // Working cells are stored densely in square chunks the size of a tile,
+  // so looking a cell up is one hash lookup per chunk rather than per cell,
+  // and cells that are processed together are close together in memory.
+  struct WorkingChunk {
+    Array<ChunkCellState, TileSize * TileSize> states;
+    Array<WorkingCell, TileSize * TileSize> cells;
+  };
+
+  static Vec2I tileCoordinate(Vec2I const& position);
+
   void setup();
-  void applyPressure();
-  void spreadPressure();
-  void limitPressure();
-  void pressureMove();
-  void spreadOverfill();
-  void levelMove();
-  void findInteractions();
+  void setupTiles(List<WorkingCell*> activeCells);
+  void runPhase(void (LiquidCellEngine::*phase)(WorkingTile&));
+  void applyPressure(WorkingTile& tile);
+  void spreadPressure(WorkingTile& tile);
+  void limitPressure(WorkingTile& tile);
+  void pressureMove(WorkingTile& tile);
+  void spreadOverfill(WorkingTile& tile);
+  void levelMove(WorkingTile& tile);
+  void findInteractions(WorkingTile& tile);
   void finish();
 
+  void clearWorkingCells();
+  WorkingChunk* workingChunk(Vec2I const& chunkPosition);
   WorkingCell* workingCell(Vec2I p);
   WorkingCell* adjacentCell(WorkingCell* cell, Adjacency adjacency);
+  bool randomDirection(WorkingCell const& cell, uint32_t salt);
 
-  void setPressure(float pressure, WorkingCell& cell);
-  void transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void transferLevel(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void setLevel(float level, WorkingCell& cell);
+  void setPressure(float pressure, WorkingCell& cell, WorkingTile& tile);
+  void transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingTile& tile);
+  void transferLevel(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingTile& tile);
+  void setLevel(float level, WorkingCell& cell, WorkingTile& tile);
 
   RandomSource m_random;
   LiquidCellEngineParameters m_engineParameters;
@@ -150,11 +207,22 @@ private:
   List<RectI> m_noProcessingLimitRegions;
   uint64_t m_step;
 
-  BAHashMap<Vec2I, Maybe<WorkingCell>> m_workingCells;
-  List<WorkingCell*> m_currentActiveCells;
+  unsigned m_threadCount;
+  unique_ptr<WorkerPool> m_workerPool;
+
+  // Chunks are kept allocated between updates and handed out in order
+  BAHashMap<Vec2I, WorkingChunk*> m_workingChunks;
+  List<unique_ptr<WorkingChunk>> m_chunkPool;
+  size_t m_chunksUsed;
+  Maybe<pair<Vec2I, WorkingChunk*>> m_lastChunk;
+  // Tiles are grouped so that the tiles in each group can be simulated in
+  // any order, the groups themselves run one after another.
+  List<WorkingTile> m_workingTiles;
+  List<List<WorkingTile*>> m_tileGroups;
   BAHashSet<Vec2I> m_nextActiveCells;
-  BAHashSet<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> m_liquidInteractions;
-  BAHashSet<tuple<Vec2I, LiquidId, Vec2I>> m_liquidCollisions;
+  // Consecutive updates each recently processed cell has been in
+  // equilibrium for, up to equilibriumTicks
+  BAHashMap<Vec2I, unsigned> m_equilibriumTicks;
 };
 
 template <typename LiquidId>
@@ -178,7 +246,7 @@ void CellularLiquidWorld<LiquidId>::liquidCollision(Vec2I const&, LiquidId, Vec2
 
 template <typename LiquidId>
 LiquidCellEngine<LiquidId>::LiquidCellEngine(LiquidCellEngineParameters parameters, CellularLiquidWorldPtr cellWorld)
-  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0) {}
+  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0), m_threadCount(0), m_chunksUsed(0) {}
 
 template <typename LiquidId>
 unsigned LiquidCellEngine<LiquidId>::liquidTickDelta(LiquidId liquid) {
@@ -195,6 +263,20 @@ void LiquidCellEngine<LiquidId>::setProcessingLimit(Maybe<unsigned> processingLi
   m_processingLimit = processingLimit;
 }
 
+template <typename LiquidId>
+unsigned LiquidCellEngine<LiquidId>::threadCount() const {
+  return m_threadCount;
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setThreadCount(unsigned threadCount) {
+  m_threadCount = threadCount;
+  if (m_threadCount > 1)
+    m_workerPool = make_unique<WorkerPool>("LiquidCellEngine", m_threadCount - 1);
+  else
+    m_workerPool.reset();
+}
+
 template <typename LiquidId>
 List<RectI> LiquidCellEngine<LiquidId>::noProcessingLimitRegions() const {
   return m_noProcessingLimitRegions;
@@ -221,13 +303,13 @@ void LiquidCellEngine<LiquidId>::visitRegion(RectI const& region) {
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::update() {
   setup();
-  applyPressure();
-  spreadPressure();
-  limitPressure();
-  pressureMove();
-  spreadOverfill();
-  levelMove();
-  findInteractions();
+  runPhase(&LiquidCellEngine::applyPressure);
+  runPhase(&LiquidCellEngine::spreadPressure);
+  runPhase(&LiquidCellEngine::limitPressure);
+  runPhase(&LiquidCellEngine::pressureMove);
+  runPhase(&LiquidCellEngine::spreadOverfill);
+  runPhase(&LiquidCellEngine::levelMove);
+  runPhase(&LiquidCellEngine::findInteractions);
   finish();
 
   ++m_step;
@@ -255,12 +337,22 @@ bool LiquidCellEngine<LiquidId>::isActive(Vec2I const& pos) const {
   return false;
 }
 
+template <typename LiquidId>
+bool LiquidCellEngine<LiquidId>::isAsleep(Vec2I const& pos) const {
+  if (m_engineParameters.equilibriumChangeThreshold <= 0.0f)
+    return false;
+  return m_equilibriumTicks.value(m_cellWorld->uniqueLocation(pos)) >= m_engineParameters.equilibriumTicks && !isActive(pos);
+}
+
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::setup() {
   // In case an exception occurred during the last update, clear potentially
   // stale data here
-  m_workingCells.clear();
-  m_currentActiveCells.clear();
+  clearWorkingCells();
+  m_tileGroups.clear();
+  m_workingTiles.clear();
+
+  List<WorkingCell*> currentActiveCells;
 
   for (auto& activeCellsPair : m_activeCells) {
     unsigned tickDelta = liquidTickDelta(activeCellsPair.first);
@@ -290,42 +382,159 @@ void LiquidCellEngine<LiquidId>::setup() {
       if (!cell || cell->liquid != activeCellsPair.first) {
         activeCellsPair.second.remove(pos);
       } else {
-        m_currentActiveCells.append(cell);
+        currentActiveCells.append(cell);
         activeCellsPair.second.remove(pos);
       }
     }
   }
 
-  sort(m_currentActiveCells, [](WorkingCell* lhs, WorkingCell* rhs) {
+  if (m_threadCount != 0)
+    return setupTiles(std::move(currentActiveCells));
+
+  sort(currentActiveCells, [](WorkingCell* lhs, WorkingCell* rhs) {
       return lhs->position[1] < rhs->position[1];
     });
+
+  m_workingTiles.resize(1);
+  m_workingTiles[0].cells = std::move(currentActiveCells);
+  m_tileGroups.append({&m_workingTiles[0]});
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::applyPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::setupTiles(List<WorkingCell*> activeCells) {
+  // Look up every adjacent cell now, the phases may run on worker threads
+  // which must not touch the working chunks or the cell world.
+  for (auto cell : activeCells) {
+    for (auto adjacency : {Adjacency::Left, Adjacency::Right, Adjacency::Bottom, Adjacency::Top})
+      adjacentCell(cell, adjacency);
+    cell->linked = true;
+  }
+
+  // Order cells by tile and then bottom to top within each tile, so that the
+  // result does not depend on the order cells were activated in.
+  sort(activeCells, [&](WorkingCell* lhs, WorkingCell* rhs) {
+      Vec2I lhsTile = tileCoordinate(lhs->position);
+      Vec2I rhsTile = tileCoordinate(rhs->position);
+      return tie(lhsTile[1], lhsTile[0], lhs->position[1], lhs->position[0])
+          < tie(rhsTile[1], rhsTile[0], rhs->position[1], rhs->position[0]);
+    });
+
+  Maybe<Vec2I> lastTile;
+  for (auto cell : activeCells) {
+    Vec2I tile = tileCoordinate(cell->position);
+    if (!lastTile || tile != *lastTile) {
+      m_workingTiles.append(WorkingTile());
+      lastTile = tile;
+    }
+    m_workingTiles.last().cells.append(cell);
+  }
+
+  // Two tiles conflict if any cell is touched by both of them, either as an
+  // active cell or as one of their neighbors.  Positions are already made
+  // unique by the cell world, so this also catches tiles which are adjacent
+  // across a wrapping world edge.
+  StableHashMap<Vec2I, List<size_t>> cellTiles;
+  List<HashSet<size_t>> conflicts(m_workingTiles.size());
+  for (size_t i = 0; i < m_workingTiles.size(); ++i) {
+    auto touch = [&](WorkingCell const* cell) {
+      if (!cell)
+        return;
+      auto& tiles = cellTiles[cell->position];
+      if (!tiles.empty() && tiles.last() == i)
+        return;
+      for (auto other : tiles) {
+        conflicts[i].add(other);
+        conflicts[other].add(i);
+      }
+      tiles.append(i);
+    };
+
+    for (auto cell : m_workingTiles[i].cells) {
+      touch(cell);
+      touch(cell->leftCell);
+      touch(cell->rightCell);
+      touch(cell->bottomCell);
+      touch(cell->topCell);
+    }
+  }
+
+  List<size_t> tileGroup(m_workingTiles.size(), NPos);
+  for (size_t i = 0; i < m_workingTiles.size(); ++i) {
+    size_t group = 0;
+    while (any(conflicts[i], [&](size_t other) { return tileGroup[other] == group; }))
+      ++group;
+    tileGroup[i] = group;
+    if (group >= m_tileGroups.size())
+      m_tileGroups.resize(group + 1);
+    m_tileGroups[group].append(&m_workingTiles[i]);
+  }
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::runPhase(void (LiquidCellEngine::*phase)(WorkingTile&)) {
+  for (auto const& tiles : m_tileGroups) {
+    if (!m_workerPool || tiles.size() == 1) {
+      for (auto tile : tiles)
+        (this->*phase)(*tile);
+      continue;
+    }
+
+    size_t stride = min<size_t>(m_threadCount, tiles.size());
+    auto runTiles = [this, phase, &tiles, stride](size_t offset) {
+      for (size_t i = offset; i < tiles.size(); i += stride)
+        (this->*phase)(*tiles[i]);
+    };
+
+    List<WorkerPoolHandle> handles;
+    for (size_t offset = 1; offset < stride; ++offset)
+      handles.append(m_workerPool->addWork(bind(runTiles, offset)));
+
+    // Every handle must be finished before leaving, even on error, as the
+    // work refers to this frame.
+    std::exception_ptr error;
+    try {
+      runTiles(0);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    for (auto const& handle : handles) {
+      try {
+        handle.finish();
+      } catch (...) {
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::applyPressure(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
     if (topCell && selfCell->liquid == topCell->liquid)
-      setPressure(max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell);
+      setPressure(max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell, tile);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadPressure(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid)
       continue;
 
     auto spreadPressure = [&](Adjacency adjacency, float bias) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell && !targetCell->sourceCell)
-        transferPressure((selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true);
+        transferPressure((selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true, tile);
     };
 
-    if (m_random.randb()) {
+    if (randomDirection(*selfCell, 1)) {
       spreadPressure(Adjacency::Left, 0.0f);
       spreadPressure(Adjacency::Right, 0.0f);
     } else {
@@ -339,23 +548,23 @@ void LiquidCellEngine<LiquidId>::spreadPressure() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::limitPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::limitPressure(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     float level = min(selfCell->level, 1.0f);
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
 
     // Force the pressure to the cell level if there is empty space above,
     // otherwise simply make sure the pressure is at least the level
     if (topCell && !topCell->liquid)
-      setPressure(level, *selfCell);
+      setPressure(level, *selfCell, tile);
     else
-      setPressure(max(selfCell->pressure, level), *selfCell);
+      setPressure(max(selfCell->pressure, level), *selfCell, tile);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::pressureMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::pressureMove(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid)
       continue;
 
@@ -365,11 +574,11 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
         float amount = (selfCell->pressure - targetCell->pressure) * m_engineParameters.pressureMoveFactor;
         amount = min(amount, selfCell->level - (1.0f - m_engineParameters.maximumPressureLevelImbalance));
         amount = min(amount, (1.0f + m_engineParameters.maximumPressureLevelImbalance) - targetCell->level);
-        transferLevel(amount, *selfCell, *targetCell, false);
+        transferLevel(amount, *selfCell, *targetCell, false, tile);
       }
     };
 
-    if (m_random.randb()) {
+    if (randomDirection(*selfCell, 2)) {
       pressureMove(Adjacency::Left);
       pressureMove(Adjacency::Right);
     } else {
@@ -380,8 +589,8 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadOverfill() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadOverfill(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
@@ -390,13 +599,13 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
       if (overfill > 0.0f) {
         auto targetCell = adjacentCell(selfCell, adjacency);
         if (targetCell)
-          transferLevel(min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false);
+          transferLevel(min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false, tile);
       }
     };
 
     spreadOverfill(Adjacency::Top, m_engineParameters.spreadOverfillUpFactor);
 
-    if (m_random.randb()) {
+    if (randomDirection(*selfCell, 3)) {
       spreadOverfill(Adjacency::Left, m_engineParameters.spreadOverfillLateralFactor);
       spreadOverfill(Adjacency::Right, m_engineParameters.spreadOverfillLateralFactor);
     } else {
@@ -409,24 +618,24 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::levelMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::levelMove(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid)
       continue;
 
     auto belowCell = adjacentCell(selfCell, Adjacency::Bottom);
     if (belowCell)
-      transferLevel(min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false);
+      transferLevel(min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false, tile);
 
-    setLevel(selfCell->level * (1.0f - m_cellWorld->drainLevel(selfCell->position)), *selfCell);
+    setLevel(selfCell->level * (1.0f - m_cellWorld->drainLevel(selfCell->position)), *selfCell, tile);
 
     auto lateralMove = [&](Adjacency adjacency) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell)
-        transferLevel((selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false);
+        transferLevel((selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false, tile);
     };
 
-    if (m_random.randb()) {
+    if (randomDirection(*selfCell, 4)) {
       lateralMove(Adjacency::Left);
       lateralMove(Adjacency::Right);
     } else {
@@ -437,8 +646,8 @@ void LiquidCellEngine<LiquidId>::levelMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::findInteractions() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::findInteractions(WorkingTile& tile) {
+  for (auto const& selfCell : tile.cells) {
     if (!selfCell->liquid)
       continue;
 
@@ -454,7 +663,7 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
           adjacentPos += Vec2I(0, -1);
         else if (adjacency == Adjacency::Top)
           adjacentPos += Vec2I(0, 1);
-        m_liquidCollisions.add(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
+        tile.liquidCollisions.add(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
 
       } else if (targetCell->liquid && *targetCell->liquid != *selfCell->liquid) {
         if (targetCell->level <= m_engineParameters.interactTransformationLevel
@@ -465,11 +674,11 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
             selfCell->liquid = targetCell->liquid;
         } else {
           // Make sure to add the point pair in a predictable order so that any
-          // combination of Vec2I points will be unique in m_liquidInteractions
+          // combination of Vec2I points will be unique in the interaction set
           if (selfCell->position < targetCell->position)
-            m_liquidInteractions.add(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
+            tile.liquidInteractions.add(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
           else
-            m_liquidInteractions.add(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
+            tile.liquidInteractions.add(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
         }
       }
     }
@@ -478,31 +687,74 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
 
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::finish() {
-  m_currentActiveCells.clear();
+  m_tileGroups.clear();
+
+  BAHashSet<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> liquidInteractions;
+  BAHashSet<tuple<Vec2I, LiquidId, Vec2I>> liquidCollisions;
+  auto visitedCells = take(m_nextActiveCells);
+
+  float threshold = m_engineParameters.equilibriumChangeThreshold;
+  if (threshold > 0.0f) {
+    for (auto const& tile : m_workingTiles) {
+      for (auto cell : tile.cells) {
+        if (cell->liquid && !cell->sourceCell
+            && fabs(cell->level - cell->initialLevel) < threshold
+            && fabs(cell->pressure - cell->initialPressure) < threshold) {
+          auto& ticks = m_equilibriumTicks[cell->position];
+          if (ticks < m_engineParameters.equilibriumTicks)
+            ++ticks;
+        } else {
+          m_equilibriumTicks.remove(cell->position);
+        }
+      }
+    }
+
+    // A visit is always fresh activity, so the cell has to settle again
+    // before it can sleep.
+    for (auto const& p : visitedCells)
+      m_equilibriumTicks.remove(m_cellWorld->uniqueLocation(p));
+  }
 
-  for (auto& workingCellPair : take(m_workingCells)) {
-    if (workingCellPair.second && !workingCellPair.second->sourceCell) {
-      if (workingCellPair.second->liquid) {
-        if (workingCellPair.second->level < m_engineParameters.minimumLiquidLevel)
-          workingCellPair.second->level = 0.0f;
+  // Changes involving only sleeping cells do not wake anything, they would
+  // otherwise keep a settled body of liquid awake indefinitely.
+  m_nextActiveCells = std::move(visitedCells);
+  for (auto& tile : take(m_workingTiles)) {
+    for (auto const& p : tile.nextActiveCells) {
+      if (threshold <= 0.0f || m_equilibriumTicks.value(p) < m_engineParameters.equilibriumTicks)
+        m_nextActiveCells.add(p);
+    }
+    liquidInteractions.addAll(tile.liquidInteractions);
+    liquidCollisions.addAll(tile.liquidCollisions);
+  }
+
+  for (size_t c = 0; c < m_chunksUsed; ++c) {
+    auto& chunk = *m_chunkPool[c];
+    for (size_t i = 0; i < chunk.cells.size(); ++i) {
+      auto& cell = chunk.cells[i];
+      if (chunk.states[i] != ChunkCellState::Present || cell.sourceCell)
+        continue;
+
+      if (cell.liquid) {
+        if (cell.level < m_engineParameters.minimumLiquidLevel)
+          cell.level = 0.0f;
       } else {
-        workingCellPair.second->level = 0.0f;
+        cell.level = 0.0f;
       }
 
-      if (workingCellPair.second->level == 0.0f) {
-        workingCellPair.second->liquid = {};
-        workingCellPair.second->pressure = 0.0f;
+      if (cell.level == 0.0f) {
+        cell.liquid = {};
+        cell.pressure = 0.0f;
       }
 
-      m_cellWorld->setFlow(workingCellPair.second->position, CellularLiquidFlowCell<LiquidId>{
-          workingCellPair.second->liquid, workingCellPair.second->level, workingCellPair.second->pressure});
+      m_cellWorld->setFlow(cell.position, CellularLiquidFlowCell<LiquidId>{cell.liquid, cell.level, cell.pressure});
     }
   }
+  clearWorkingCells();
 
-  for (auto const& interaction : take(m_liquidInteractions))
+  for (auto const& interaction : liquidInteractions)
     m_cellWorld->liquidInteraction(get<0>(interaction), get<1>(interaction), get<2>(interaction), get<3>(interaction));
 
-  for (auto const& interaction : take(m_liquidCollisions))
+  for (auto const& interaction : liquidCollisions)
     m_cellWorld->liquidCollision(get<0>(interaction), get<1>(interaction), get<2>(interaction));
 
   for (auto const& c : take(m_nextActiveCells)) {
@@ -525,26 +777,68 @@ void LiquidCellEngine<LiquidId>::finish() {
     });
 }
 
+template <typename LiquidId>
+Vec2I LiquidCellEngine<LiquidId>::tileCoordinate(Vec2I const& position) {
+  auto coordinate = [](int v) {
+    return v >= 0 ? v / TileSize : (v + 1) / TileSize - 1;
+  };
+  return Vec2I(coordinate(position[0]), coordinate(position[1]));
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::clearWorkingCells() {
+  m_workingChunks.clear();
+  m_chunksUsed = 0;
+  m_lastChunk.reset();
+}
+
+template <typename LiquidId>
+typename LiquidCellEngine<LiquidId>::WorkingChunk* LiquidCellEngine<LiquidId>::workingChunk(Vec2I const& chunkPosition) {
+  if (m_lastChunk && m_lastChunk->first == chunkPosition)
+    return m_lastChunk->second;
+
+  auto res = m_workingChunks.insert(make_pair(chunkPosition, nullptr));
+  if (res.second) {
+    if (m_chunksUsed == m_chunkPool.size())
+      m_chunkPool.append(make_unique<WorkingChunk>());
+    res.first->second = m_chunkPool[m_chunksUsed++].get();
+    res.first->second->states.fill(ChunkCellState::Unvisited);
+  }
+
+  m_lastChunk = make_pair(chunkPosition, res.first->second);
+  return res.first->second;
+}
+
 template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::workingCell(Vec2I p) {
   p = m_cellWorld->uniqueLocation(p);
 
-  auto res = m_workingCells.insert(make_pair(p, Maybe<WorkingCell>()));
-  if (res.second) {
+  Vec2I chunkPosition = tileCoordinate(p);
+  auto chunk = workingChunk(chunkPosition);
+  size_t index = (p[0] - chunkPosition[0] * TileSize) + (p[1] - chunkPosition[1] * TileSize) * TileSize;
+
+  auto& state = chunk->states[index];
+  auto& cell = chunk->cells[index];
+  if (state == ChunkCellState::Unvisited) {
+    state = ChunkCellState::Empty;
     auto cellData = m_cellWorld->cell(p);
-    if (auto flowCell = cellData.template ptr<CellularLiquidFlowCell<LiquidId>>())
-      res.first->second = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, nullptr, nullptr, nullptr, nullptr};
-    else if (auto sourceCell = cellData.template ptr<CellularLiquidSourceCell<LiquidId>>())
-      res.first->second = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, nullptr, nullptr, nullptr, nullptr};
+    if (auto flowCell = cellData.template ptr<CellularLiquidFlowCell<LiquidId>>()) {
+      cell = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, flowCell->level, flowCell->pressure, false, nullptr, nullptr, nullptr, nullptr};
+      state = ChunkCellState::Present;
+    } else if (auto sourceCell = cellData.template ptr<CellularLiquidSourceCell<LiquidId>>()) {
+      cell = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, 1.0f, sourceCell->pressure, false, nullptr, nullptr, nullptr, nullptr};
+      state = ChunkCellState::Present;
+    }
   }
-  return res.first->second.ptr();
+
+  return state == ChunkCellState::Present ? &cell : nullptr;
 }
 
 template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::adjacentCell(
     WorkingCell* cell, Adjacency adjacency) {
-  auto getCell = [this](WorkingCell*& cellptr, Vec2I cellPos) {
-    if (cellptr)
+  auto getCell = [this, cell](WorkingCell*& cellptr, Vec2I cellPos) {
+    if (cellptr || cell->linked)
       return cellptr;
     cellptr = workingCell(cellPos);
     return cellptr;
@@ -563,19 +857,28 @@ typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::ad
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setPressure(float pressure, WorkingCell& cell) {
+bool LiquidCellEngine<LiquidId>::randomDirection(WorkingCell const& cell, uint32_t salt) {
+  // The tiled simulation may process cells in any order across threads, so it
+  // can not share a random sequence.
+  if (m_threadCount == 0)
+    return m_random.randb();
+  return staticRandomU32(m_step, cell.position[0], cell.position[1], salt) & 1;
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setPressure(float pressure, WorkingCell& cell, WorkingTile& tile) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.pressure - pressure) > m_engineParameters.minimumLivenPressureChange)
-    m_nextActiveCells.add(cell.position);
+    tile.nextActiveCells.add(cell.position);
   cell.pressure = pressure;
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingTile& tile) {
   if (amount < 0.0f && allowReverse) {
-    return transferPressure(-amount, dest, source, false);
+    return transferPressure(-amount, dest, source, false, tile);
   } else if (amount > 0.0f) {
     if (!source.liquid)
       return;
@@ -595,19 +898,19 @@ void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& sou
       dest.pressure += amount;
 
     if (amount > m_engineParameters.minimumLivenPressureChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      tile.nextActiveCells.add(source.position);
+      tile.nextActiveCells.add(dest.position);
     }
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
+void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell, WorkingTile& tile) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.level - level) > m_engineParameters.minimumLivenLevelChange)
-    m_nextActiveCells.add(cell.position);
+    tile.nextActiveCells.add(cell.position);
 
   cell.level = level;
 
@@ -619,9 +922,9 @@ void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
 
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::transferLevel(
-    float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+    float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingTile& tile) {
   if (amount < 0.0f && allowReverse) {
-    transferLevel(-amount, dest, source, false);
+    transferLevel(-amount, dest, source, false, tile);
 
   } else if (amount > 0.0f) {
     if (!source.liquid)
@@ -646,8 +949,8 @@ void LiquidCellEngine<LiquidId>::transferLevel(
       source.liquid = {};
 
     if (amount > m_engineParameters.minimumLivenLevelChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      tile.nextActiveCells.add(source.position);
+      tile.nextActiveCells.add(dest.position);
     }
   }
 }
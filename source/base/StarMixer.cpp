@@ -7,6 +7,12 @@
 namespace Star {
 
 namespace {
+  // How far ahead of playback compressed audio is decoded, and how often the
+  // decode thread checks whether streams need topping up.
+  float const StreamBufferTime = 0.5f;
+  unsigned const StreamDecodeInterval = 10;
+  size_t const StreamDecodeChunkSize = 4096;
+
   float rateOfChangeFromRampTime(float rampTime) {
     static const float MaxRate = 10000.0f;
 
@@ -23,8 +29,36 @@ extern EnumMap<MixerGroup> const MixerGroupNames = {
   {MixerGroup::Instruments, "Instruments"}
 };
 
+size_t AudioInstance::StreamBuffer::available() const {
+  return samples.size() - readPosition;
+}
+
+size_t AudioInstance::StreamBuffer::take(int16_t* buffer, size_t bufferSize) {
+  size_t amount = min(bufferSize, available());
+  std::copy(samples.begin() + readPosition, samples.begin() + readPosition + amount, buffer);
+  readPosition += amount;
+  return amount;
+}
+
+void AudioInstance::StreamBuffer::append(int16_t const* buffer, size_t bufferSize) {
+  if (readPosition > samples.size() / 2) {
+    samples.erase(samples.begin(), samples.begin() + readPosition);
+    readPosition = 0;
+  }
+  samples.appendAll(List<int16_t>(buffer, buffer + bufferSize));
+}
+
+void AudioInstance::StreamBuffer::clear() {
+  samples.clear();
+  readPosition = 0;
+  endOfStream = false;
+}
+
 AudioInstance::AudioInstance(Audio const& audio)
   : m_audio(audio) {
+  if (m_audio.compressed())
+    m_stream = make_shared<StreamBuffer>();
+
   m_mixerGroup = MixerGroup::Effects;
 
   m_volume = {1.0f, 1.0f, 0};
@@ -115,16 +149,37 @@ void AudioInstance::setLoops(int loops) {
 }
 
 double AudioInstance::currentTime() const {
+  if (m_stream) {
+    // The decoder runs ahead of playback by whatever is still buffered
+    MutexLocker decodeLocker(m_stream->decodeMutex);
+    MutexLocker locker(m_stream->mutex);
+    double buffered = (double)m_stream->available() / (m_audio.channels() * m_audio.sampleRate());
+    return max(m_audio.currentTime() - buffered, 0.0);
+  }
+
   MutexLocker locker(m_mutex);
   return m_audio.currentTime();
 }
 
 double AudioInstance::totalTime() const {
+  if (m_stream) {
+    MutexLocker decodeLocker(m_stream->decodeMutex);
+    return m_audio.totalTime();
+  }
+
   MutexLocker locker(m_mutex);
   return m_audio.totalTime();
 }
 
 void AudioInstance::seekTime(double time) {
+  if (m_stream) {
+    MutexLocker decodeLocker(m_stream->decodeMutex);
+    m_audio.seekTime(time);
+    MutexLocker locker(m_stream->mutex);
+    m_stream->clear();
+    return;
+  }
+
   MutexLocker locker(m_mutex);
   m_audio.seekTime(time);
 }
@@ -184,6 +239,20 @@ Mixer::Mixer(unsigned sampleRate, unsigned channels) {
   m_groupVolumes[MixerGroup::Instruments] = {1.0f, 1.0f, 0};
 
   m_speed = 1.0f;
+  m_maxVoices = 0;
+
+  m_decodeBuffer.resize(StreamDecodeChunkSize);
+  m_stopDecodeThread = false;
+  m_decodeThread = Thread::invoke("Mixer::decodeMain", mem_fn(&Mixer::decodeMain), this);
+}
+
+Mixer::~Mixer() {
+  {
+    MutexLocker locker(m_decodeMutex);
+    m_stopDecodeThread = true;
+    m_decodeCond.signal();
+  }
+  m_decodeThread.finish();
 }
 
 unsigned Mixer::sampleRate() const {
@@ -225,7 +294,17 @@ void Mixer::setVolume(float volume, float rampTime) {
   m_volume.velocity = rateOfChangeFromRampTime(rampTime);
 }
 
+void Mixer::setMaxVoices(unsigned maxVoices) {
+  m_maxVoices = maxVoices;
+}
+
 void Mixer::play(AudioInstancePtr sample) {
+  if (sample->m_stream) {
+    MutexLocker locker(m_decodeMutex);
+    m_streamedAudios.append(sample);
+    m_decodeCond.signal();
+  }
+
   MutexLocker locker(m_queueMutex);
   m_audios.add(std::move(sample), AudioState{List<float>(m_channels, 1.0f)});
 }
@@ -274,11 +353,38 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
   unsigned millisecondsInBuffer = (bufferSize * 1000) / (channels * sampleRate);
   auto sampleEndTime = sampleStartTime + millisecondsInBuffer;
 
-  for (size_t i = 0; i < bufferSize; ++i)
-    outBuffer[i] = 0;
+  m_accumulateBuffer.resize(bufferSize);
+  std::fill(m_accumulateBuffer.begin(), m_accumulateBuffer.end(), 0.0f);
 
   {
     MutexLocker locker(m_queueMutex);
+
+    // Past the voice limit, only the most audible effect sounds are mixed,
+    // everything else is advanced silently so it stays in time.
+    m_culledVoices.clear();
+    unsigned maxVoices = m_maxVoices;
+    if (maxVoices != 0) {
+      m_voiceAudibility.clear();
+      for (auto& p : m_audios) {
+        auto& audioInstance = p.first;
+        if (audioInstance->m_finished)
+          continue;
+        if (audioInstance->m_mixerGroup != MixerGroup::Effects && audioInstance->m_mixerGroup != MixerGroup::Instruments)
+          continue;
+        float positionalVolume = 0.0f;
+        for (float channelVolume : p.second.positionalChannelVolumes)
+          positionalVolume = max(positionalVolume, channelVolume);
+        float audibility = audioInstance->m_volume.value * groupVolumes[audioInstance->m_mixerGroup].value * positionalVolume;
+        m_voiceAudibility.append({audibility, audioInstance.get()});
+      }
+      if (m_voiceAudibility.size() > maxVoices) {
+        std::nth_element(m_voiceAudibility.begin(), m_voiceAudibility.begin() + maxVoices, m_voiceAudibility.end(),
+            [](auto const& a, auto const& b) { return a.first > b.first; });
+        for (size_t i = maxVoices; i < m_voiceAudibility.size(); ++i)
+          m_culledVoices.add(m_voiceAudibility[i].second);
+      }
+    }
+
     // Mix all active sounds
     for (auto& p : m_audios) {
       auto& audioInstance = p.first;
@@ -312,6 +418,20 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
       if (audioStopVolEnd == 0.0f && audioInstance->m_stopping)
         finished = true;
 
+      if (m_culledVoices.contains(audioInstance.get())) {
+        try {
+          finished |= skipAudio(*audioInstance, frameCount, pitchMultiplier);
+        } catch (Star::AudioException const& e) {
+          Logger::error("Error reading audio '{}': {}", audioInstance->m_audio.name(), e.what());
+          finished = true;
+        }
+        if (audioInstance->m_clockStop && sampleEndTime > *audioInstance->m_clockStop + audioInstance->m_clockStopFadeOut)
+          finished = true;
+        audioInstance->m_volume.value = audioStopVolEnd;
+        audioInstance->m_finished = finished;
+        continue;
+      }
+
       size_t ramt = 0;
       if (audioInstance->m_clockStart && *audioInstance->m_clockStart > sampleStartTime) {
         int silentSamples = (*audioInstance->m_clockStart - sampleStartTime) * sampleRate / 1000;
@@ -320,8 +440,18 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
         ramt += silentSamples * channels;
       }
       try {
-        ramt += audioInstance->m_audio.resample(channels, sampleRate, m_mixBuffer.ptr() + ramt, bufferSize - ramt, pitchMultiplier);
-        while (ramt != bufferSize && !finished) {
+        if (auto stream = audioInstance->m_stream.get()) {
+          // Looping is handled by the decode thread, and running out of
+          // decoded samples before the end of the stream just leaves silence.
+          MutexLocker streamLocker(stream->mutex);
+          ramt += audioInstance->m_audio.resample(channels, sampleRate, m_mixBuffer.ptr() + ramt, bufferSize - ramt, pitchMultiplier,
+              [stream](int16_t* buffer, size_t bufferSize) { return stream->take(buffer, bufferSize); });
+          if (ramt != bufferSize && stream->endOfStream && stream->available() == 0)
+            finished = true;
+        } else {
+          ramt += audioInstance->m_audio.resample(channels, sampleRate, m_mixBuffer.ptr() + ramt, bufferSize - ramt, pitchMultiplier);
+        }
+        while (ramt != bufferSize && !finished && !audioInstance->m_stream) {
           // Only seek back to the beginning and read more data if loops is < 0
           // (loop forever), or we have more loops to go, otherwise, the sample is
           // finished.
@@ -356,12 +486,27 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
             finished = true;
         }
 
-        for (size_t s = 0; s < ramt / channels; ++s) {
-          float vol = lerp((float)s / frameCount, beginVolume * groupVolume * audioStopVolBegin, endVolume * groupEndVolume * audioStopVolEnd);
-          for (size_t c = 0; c < channels; ++c) {
-            float sample = m_mixBuffer[s * channels + c] * vol * audioState.positionalChannelVolumes[c] * audioInstance->m_volume.value;
-            int16_t& outSample = outBuffer[s * channels + c];
-            outSample = clamp(sample + outSample, -32767.0f, 32767.0f);
+        // Accumulate in float with a linear volume ramp, and only clamp the
+        // final mix, this keeps the inner loops branch free.
+        float instanceVolume = audioInstance->m_volume.value;
+        float volumeBegin = beginVolume * groupVolume * audioStopVolBegin * instanceVolume;
+        float volumeStep = (endVolume * groupEndVolume * audioStopVolEnd * instanceVolume - volumeBegin) / frameCount;
+        int16_t const* source = m_mixBuffer.ptr();
+        float* destination = m_accumulateBuffer.ptr();
+        size_t frames = ramt / channels;
+        if (channels == 2) {
+          float leftVolume = audioState.positionalChannelVolumes[0];
+          float rightVolume = audioState.positionalChannelVolumes[1];
+          for (size_t s = 0; s < frames; ++s) {
+            float vol = volumeBegin + volumeStep * s;
+            destination[s * 2] += source[s * 2] * vol * leftVolume;
+            destination[s * 2 + 1] += source[s * 2 + 1] * vol * rightVolume;
+          }
+        } else {
+          for (size_t s = 0; s < frames; ++s) {
+            float vol = volumeBegin + volumeStep * s;
+            for (size_t c = 0; c < channels; ++c)
+              destination[s * channels + c] += source[s * channels + c] * vol * audioState.positionalChannelVolumes[c];
           }
         }
       } catch (Star::AudioException const& e) {
@@ -374,6 +519,9 @@ void Mixer::read(int16_t* outBuffer, size_t frameCount, ExtraMixFunction extraMi
     }
   }
 
+  for (size_t i = 0; i < bufferSize; ++i)
+    outBuffer[i] = (int16_t)clamp(m_accumulateBuffer[i], -32767.0f, 32767.0f);
+
   if (extraMixFunction)
     extraMixFunction(outBuffer, frameCount, channels);
 
@@ -487,6 +635,98 @@ void Mixer::setGroupVolume(MixerGroup group, float targetValue, float rampTime)
   }
 }
 
+bool Mixer::skipAudio(AudioInstance& audioInstance, size_t frameCount, double velocity) {
+  auto& audio = audioInstance.m_audio;
+  uint64_t sourceFrames = (uint64_t)(frameCount * velocity * audio.sampleRate() / m_sampleRate);
+
+  if (auto stream = audioInstance.m_stream.get()) {
+    MutexLocker streamLocker(stream->mutex);
+    size_t skipSamples = min<size_t>(sourceFrames * audio.channels(), stream->available());
+    stream->readPosition += skipSamples;
+    return stream->endOfStream && stream->available() == 0;
+  }
+
+  uint64_t totalFrames = audio.totalSamples();
+  uint64_t position = audio.currentSample() + sourceFrames;
+  while (position >= totalFrames) {
+    if (audioInstance.m_loops == 0 || totalFrames == 0)
+      return true;
+    position -= totalFrames;
+    if (audioInstance.m_loops > 0)
+      --audioInstance.m_loops;
+  }
+  audio.seekSample(position);
+  return false;
+}
+
+void Mixer::decodeMain() {
+  MutexLocker locker(m_decodeMutex);
+  while (!m_stopDecodeThread) {
+    eraseWhere(m_streamedAudios, [](AudioInstancePtr const& audioInstance) {
+        return audioInstance->m_finished;
+      });
+    auto streamedAudios = m_streamedAudios;
+
+    locker.unlock();
+    for (auto const& audioInstance : streamedAudios)
+      decodeAhead(*audioInstance);
+    locker.lock();
+
+    if (!m_stopDecodeThread)
+      m_decodeCond.wait(m_decodeMutex, StreamDecodeInterval);
+  }
+}
+
+void Mixer::decodeAhead(AudioInstance& audioInstance) {
+  auto& stream = *audioInstance.m_stream;
+  MutexLocker decodeLocker(stream.decodeMutex);
+
+  try {
+    size_t targetSamples = audioInstance.m_audio.channels() * audioInstance.m_audio.sampleRate() * StreamBufferTime;
+    bool rewound = false;
+    while (true) {
+      {
+        MutexLocker locker(stream.mutex);
+        if (stream.endOfStream || stream.available() >= targetSamples)
+          return;
+      }
+
+      size_t ramt = audioInstance.m_audio.read(m_decodeBuffer.ptr(), m_decodeBuffer.size());
+      if (ramt == 0) {
+        // Loops are consumed here rather than in Mixer::read, slightly ahead
+        // of playback.  An empty stream is never looped more than once.
+        bool loop = false;
+        if (!rewound) {
+          MutexLocker locker(audioInstance.m_mutex);
+          if (audioInstance.m_loops != 0 && !audioInstance.m_stopping) {
+            loop = true;
+            if (audioInstance.m_loops > 0)
+              --audioInstance.m_loops;
+          }
+        }
+
+        if (loop) {
+          audioInstance.m_audio.seekSample(0);
+          rewound = true;
+          continue;
+        }
+
+        MutexLocker locker(stream.mutex);
+        stream.endOfStream = true;
+        return;
+      }
+
+      rewound = false;
+      MutexLocker locker(stream.mutex);
+      stream.append(m_decodeBuffer.ptr(), ramt);
+    }
+  } catch (AudioException const& e) {
+    Logger::error("Error decoding audio '{}': {}", audioInstance.m_audio.name(), e.what());
+    MutexLocker locker(stream.mutex);
+    stream.endOfStream = true;
+  }
+}
+
 void Mixer::update(float, PositionalAttenuationFunction positionalAttenuationFunction) {
   {
     MutexLocker locker(m_queueMutex);
@@ -70,9 +70,28 @@ public:
 private:
   friend class Mixer;
 
+  // Compressed audio is decoded ahead of playback on the mixer's decode
+  // thread, so that Mixer::read only ever copies out already decoded samples.
+  struct StreamBuffer {
+    size_t available() const;
+    size_t take(int16_t* buffer, size_t bufferSize);
+    void append(int16_t const* buffer, size_t bufferSize);
+    void clear();
+
+    // Held while decoding from or seeking m_audio, which is only touched under
+    // this mutex once the stream buffer exists.
+    Mutex decodeMutex;
+
+    Mutex mutex;
+    List<int16_t> samples;
+    size_t readPosition = 0;
+    bool endOfStream = false;
+  };
+
   mutable Mutex m_mutex;
 
   Audio m_audio;
+  shared_ptr<StreamBuffer> m_stream;
 
   MixerGroup m_mixerGroup;
 
@@ -102,6 +121,7 @@ public:
   typedef function<float(unsigned, Vec2F, float)> PositionalAttenuationFunction;
 
   Mixer(unsigned sampleRate, unsigned channels);
+  ~Mixer();
 
   unsigned sampleRate() const;
   unsigned channels() const;
@@ -126,6 +146,11 @@ public:
   // per mixer group volume
   void setGroupVolume(MixerGroup group, float targetValue, float rampTime = 0.0f);
 
+  // Limits how many Effects and Instruments group sounds are mixed at once,
+  // the quietest ones past the limit keep advancing silently.  Zero means no
+  // limit.
+  void setMaxVoices(unsigned maxVoices);
+
   void play(AudioInstancePtr sample);
 
   void stopAll(float rampTime);
@@ -150,6 +175,13 @@ private:
     List<float> positionalChannelVolumes;
   };
 
+  // Advances a culled sound by the given number of output frames without
+  // mixing it, returns whether it has finished.
+  bool skipAudio(AudioInstance& audioInstance, size_t frameCount, double velocity);
+
+  void decodeMain();
+  void decodeAhead(AudioInstance& audioInstance);
+
   Mutex m_mutex;
   unsigned m_sampleRate;
   unsigned m_channels;
@@ -164,9 +196,20 @@ private:
   StringMap<shared_ptr<EffectInfo>> m_effects;
 
   List<int16_t> m_mixBuffer;
+  List<float> m_accumulateBuffer;
+  List<pair<float, AudioInstance*>> m_voiceAudibility;
+  HashSet<AudioInstance*> m_culledVoices;
+  atomic<unsigned> m_maxVoices;
 
   Map<MixerGroup, RampedValue> m_groupVolumes;
   atomic<float> m_speed;
+
+  Mutex m_decodeMutex;
+  ConditionVariable m_decodeCond;
+  List<AudioInstancePtr> m_streamedAudios;
+  List<int16_t> m_decodeBuffer;
+  bool m_stopDecodeThread;
+  ThreadFunction<void> m_decodeThread;
 };
 
 }
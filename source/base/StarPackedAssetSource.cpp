@@ -5,11 +5,15 @@
 #include "StarDataStreamExtra.hpp"
 #include "StarSha256.hpp"
 #include "StarFile.hpp"
+#include "StarLogging.hpp"
+#include "StarImage.hpp"
+#include "StarBuffer.hpp"
+#include "StarXXHash.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
-void PackedAssetSource::build(DirectoryAssetSource& directorySource, String const& targetPackedFile,
-    StringList const& extensionSorting, BuildProgressCallback progressCallback) {
+void PackedAssetSource::build(DirectoryAssetSource& directorySource, String const& targetPackedFile, BuildSettings const& settings) {
   FilePtr file = File::open(targetPackedFile, IOMode::ReadWrite | IOMode::Truncate);
 
   DataStreamIODevice ds(file);
@@ -21,9 +25,10 @@ void PackedAssetSource::build(DirectoryAssetSource& directorySource, String cons
   // Insert every found entry into the packed file, and also simultaneously
   // compute the full index.
   StringMap<pair<uint64_t, uint64_t>> index;
+  StringMap<ImageMetadata> imageMetadata;
 
   OrderedHashSet<String> extensionOrdering;
-  for (auto const& str : extensionSorting)
+  for (auto const& str : settings.extensionSorting)
     extensionOrdering.add(str.toLower());
 
   StringList assetPaths = directorySource.assetPaths();
@@ -49,21 +54,117 @@ void PackedAssetSource::build(DirectoryAssetSource& directorySource, String cons
       return getOrderingValue(a) < getOrderingValue(b);
     });
 
+  if (!settings.accessOrder.empty()) {
+    // Assets in the access order go first, in the order they were accessed,
+    // paths that are not in this source are skipped.
+    StringSet present = StringSet::from(assetPaths);
+    OrderedHashSet<String> ordered;
+    for (auto const& path : settings.accessOrder) {
+      if (present.contains(path))
+        ordered.add(path);
+    }
+    for (auto const& path : assetPaths)
+      ordered.add(path);
+    assetPaths = StringList::from(ordered);
+  }
+
+  struct PackedFile {
+    ByteArray contents;
+    ByteArray hash;
+    Maybe<ImageMetadata> imageMetadata;
+  };
+
+  auto readFile = [&directorySource, &settings](String const& assetPath) -> PackedFile {
+    PackedFile packed;
+    packed.contents = directorySource.read(assetPath);
+
+    if (settings.deduplicate) {
+      XXHash128 hasher;
+      hasher.push(packed.contents);
+      packed.hash = hasher.digest();
+    }
+
+    if (settings.includeImageMetadata && assetPath.endsWith(".png", String::CaseInsensitive)) {
+      try {
+        Image image = Image::readPng(make_shared<Buffer>(packed.contents));
+        RectU region = RectU::null();
+        image.forEachPixel([&region](unsigned x, unsigned y, Vec4B const& pixel) {
+            if (pixel[3] > 0)
+              region.combine(RectU::withSize({x, y}, {1, 1}));
+          });
+        packed.imageMetadata = ImageMetadata{image.size(), region};
+      } catch (ImageException const& e) {
+        Logger::warn("Not including metadata for unreadable image '{}': {}", assetPath, outputException(e, false));
+      }
+    }
+
+    return packed;
+  };
+
+  // Files are read and decoded ahead on the pool, but only a bounded number
+  // at a time so that a large asset folder is never held in memory at once,
+  // and they are written strictly in order so the output is deterministic.
+  unsigned threads = settings.threads ? settings.threads : Thread::numberOfProcessors();
+  WorkerPool pool("PackedAssetSourceBuild", max(threads, 1u));
+  size_t const window = max<size_t>(threads, 1) * 4;
+  Deque<WorkerPoolPromise<PackedFile>> pending;
+  size_t nextQueued = 0;
+
+  // The offset of the first copy of every content hash and size written
+  HashMap<pair<ByteArray, uint64_t>, uint64_t> written;
+  size_t deduplicated = 0;
+
   for (size_t i = 0; i < assetPaths.size(); ++i) {
+    while (nextQueued < assetPaths.size() && pending.size() < window) {
+      String assetPath = assetPaths[nextQueued++];
+      pending.append(pool.addProducer<PackedFile>([&readFile, assetPath]() { return readFile(assetPath); }));
+    }
+
     String const& assetPath = assetPaths[i];
-    ByteArray contents = directorySource.read(assetPath);
+    PackedFile packed = std::move(pending.takeFirst().get());
+
+    if (settings.progressCallback)
+      settings.progressCallback(i, assetPaths.size(), directorySource.toFilesystem(assetPath), assetPath);
+
+    uint64_t size = packed.contents.size();
+    Maybe<uint64_t> existing;
+    if (settings.deduplicate)
+      existing = written.maybe({packed.hash, size});
 
-    if (progressCallback)
-      progressCallback(i, assetPaths.size(), directorySource.toFilesystem(assetPath), assetPath);
-    index.add(assetPath, {ds.pos(), contents.size()});
-    ds.writeBytes(contents);
+    if (existing) {
+      index.add(assetPath, {*existing, size});
+      ++deduplicated;
+    } else {
+      uint64_t offset = ds.pos();
+      index.add(assetPath, {offset, size});
+      ds.writeBytes(packed.contents);
+      if (settings.deduplicate)
+        written.add({std::move(packed.hash), size}, offset);
+    }
+
+    if (packed.imageMetadata)
+      imageMetadata.add(assetPath, packed.imageMetadata.take());
   }
 
+  if (deduplicated != 0)
+    Logger::info("Packed {} duplicate assets as references to identical contents", deduplicated);
+
   uint64_t indexStart = ds.pos();
   ds.writeData("INDEX", 5);
   ds.write(directorySource.metadata());
   ds.write(index);
 
+  // Older readers stop after the index, so this section is ignored by them
+  if (settings.includeImageMetadata) {
+    ds.writeData("IMAGE", 5);
+    ds.writeVlqU(imageMetadata.size());
+    for (auto const& p : imageMetadata) {
+      ds.write(p.first);
+      ds.write(p.second.size);
+      ds.write(p.second.nonEmptyRegion);
+    }
+  }
+
   ds.seek(8);
   ds.write(indexStart);
 }
@@ -83,6 +184,27 @@ PackedAssetSource::PackedAssetSource(String const& filename) {
     throw AssetSourceException("No index header found!");
   ds.read(m_metadata);
   ds.read(m_index);
+
+  if (!ds.atEnd() && ds.readBytes(5) == ByteArray("IMAGE", 5)) {
+    size_t count = ds.readVlqU();
+    for (size_t i = 0; i < count; ++i) {
+      String path = ds.read<String>();
+      ImageMetadata& metadata = m_imageMetadata[std::move(path)];
+      ds.read(metadata.size);
+      ds.read(metadata.nonEmptyRegion);
+    }
+  }
+
+  try {
+    size_t fileSize = m_packedFile->size();
+    for (auto const& p : m_index) {
+      if (p.second.first + p.second.second > fileSize)
+        throw AssetSourceException::format("Packed asset '{}' extends past the end of the file", p.first);
+    }
+    m_mapping = m_packedFile->mapReadOnly(fileSize);
+  } catch (IOException const& e) {
+    Logger::warn("Could not map packed assets file '{}', reading it normally: {}", filename, outputException(e, false));
+  }
 }
 
 JsonObject PackedAssetSource::metadata() const {
@@ -95,14 +217,17 @@ StringList PackedAssetSource::assetPaths() const {
 
 IODevicePtr PackedAssetSource::open(String const& path) {
   struct AssetReader : public IODevice {
-    AssetReader(FilePtr file, String path, StreamOffset offset, StreamOffset size)
-      : file(file), path(path), fileOffset(offset), assetSize(size), assetPos(0) {
+    AssetReader(FilePtr file, FileMappingPtr mapping, String path, StreamOffset offset, StreamOffset size)
+      : file(file), mapping(mapping), path(path), fileOffset(offset), assetSize(size), assetPos(0) {
       setMode(IOMode::Read);
     }
 
     size_t read(char* data, size_t len) override {
       len = min<StreamOffset>(len, assetSize - assetPos);
-      file->readFullAbsolute(fileOffset + assetPos, data, len);
+      if (mapping)
+        memcpy(data, mapping->data() + fileOffset + assetPos, len);
+      else
+        file->readFullAbsolute(fileOffset + assetPos, data, len);
       assetPos += len;
       return len;
     }
@@ -137,12 +262,13 @@ IODevicePtr PackedAssetSource::open(String const& path) {
     }
 
     IODevicePtr clone() override {
-      auto cloned = make_shared<AssetReader>(file, path, fileOffset, assetSize);
+      auto cloned = make_shared<AssetReader>(file, mapping, path, fileOffset, assetSize);
       cloned->assetPos = assetPos;
       return cloned;
     }
 
     FilePtr file;
+    FileMappingPtr mapping;
     String path;
     StreamOffset fileOffset;
     StreamOffset assetSize;
@@ -153,7 +279,14 @@ IODevicePtr PackedAssetSource::open(String const& path) {
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
-  return make_shared<AssetReader>(m_packedFile, path, p->first, p->second);
+  return make_shared<AssetReader>(m_packedFile, m_mapping, path, p->first, p->second);
+}
+
+StreamOffset PackedAssetSource::size(String const& path) {
+  auto p = m_index.ptr(path);
+  if (!p)
+    throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
+  return p->second;
 }
 
 ByteArray PackedAssetSource::read(String const& path) {
@@ -161,9 +294,26 @@ ByteArray PackedAssetSource::read(String const& path) {
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
+  if (m_mapping)
+    return ByteArray(m_mapping->data() + p->first, p->second);
+
   ByteArray data(p->second, 0);
   m_packedFile->readFullAbsolute(p->first, data.ptr(), p->second);
   return data;
 }
 
+Maybe<PackedAssetSource::ImageMetadata> PackedAssetSource::imageMetadata(String const& path) const {
+  return m_imageMetadata.maybe(path);
+}
+
+Maybe<pair<char const*, size_t>> PackedAssetSource::view(String const& path) {
+  if (!m_mapping)
+    return {};
+
+  auto p = m_index.ptr(path);
+  if (!p)
+    throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
+  return make_pair(m_mapping->data() + p->first, (size_t)p->second);
+}
+
 }
@@ -2,6 +2,7 @@
 
 #include "StarOrderedMap.hpp"
 #include "StarFile.hpp"
+#include "StarRect.hpp"
 #include "StarDirectoryAssetSource.hpp"
 
 namespace Star {
@@ -12,18 +13,45 @@ class PackedAssetSource : public AssetSource {
 public:
   typedef function<void(size_t, size_t, String, String)> BuildProgressCallback;
 
-  // Build a packed asset file from the given DirectoryAssetSource.
-  //
-  // 'extensionSorting' sorts the packed file with file extensions that case
-  // insensitive match the given extensions in the order they are given.  If a
-  // file has an extension that doesn't match any in this list, it goes after
-  // all other files.  All files are sorted secondarily by case insensitive
-  // alphabetical order.
-  //
-  // If given, 'progressCallback' will be called with the total number of
-  // files, the current file number, the file name, and the asset path.
-  static void build(DirectoryAssetSource& directorySource, String const& targetPackedFile,
-      StringList const& extensionSorting = {}, BuildProgressCallback progressCallback = {});
+  // Facts about a PNG image that are expensive to find out without the
+  // packed file, because they need the image decoded.
+  struct ImageMetadata {
+    Vec2U size;
+    RectU nonEmptyRegion;
+  };
+
+  struct BuildSettings {
+    // Sorts the packed file with file extensions that case insensitive match
+    // the given extensions in the order they are given.  If a file has an
+    // extension that doesn't match any in this list, it goes after all other
+    // files.  All files are sorted secondarily by case insensitive
+    // alphabetical order.
+    StringList extensionSorting;
+
+    // Asset paths to pack before all others, in the given order, such as the
+    // order an asset trace first requested them in, so that loading reads
+    // the packed file in long sequential runs.
+    StringList accessOrder;
+
+    // If given, will be called with the current file number, the total
+    // number of files, the file name, and the asset path.
+    BuildProgressCallback progressCallback;
+
+    // If true, every PNG image is decoded and its ImageMetadata is stored
+    // after the index.
+    bool includeImageMetadata = false;
+
+    // If true, files with identical contents are stored once, and the index
+    // entries of every one of them point at the same data.
+    bool deduplicate = false;
+
+    // Threads reading files and decoding images, zero for one per processor.
+    unsigned threads = 0;
+  };
+
+  // Build a packed asset file from the given DirectoryAssetSource.  Files are
+  // read in parallel but always written in the same order.
+  static void build(DirectoryAssetSource& directorySource, String const& targetPackedFile, BuildSettings const& settings);
 
   PackedAssetSource(String const& packedFileName);
 
@@ -32,11 +60,21 @@ public:
 
   IODevicePtr open(String const& path) override;
   ByteArray read(String const& path) override;
+  StreamOffset size(String const& path) override;
+  Maybe<pair<char const*, size_t>> view(String const& path) override;
+
+  // The prebaked metadata of the given image, if the packed file has any.
+  // This describes the image in this source only, without any patches.
+  Maybe<ImageMetadata> imageMetadata(String const& path) const;
 
 private:
   FilePtr m_packedFile;
+  // The whole packed file, if it could be mapped, which reads are then
+  // served from instead of the File.
+  FileMappingPtr m_mapping;
   JsonObject m_metadata;
   OrderedHashMap<String, pair<uint64_t, uint64_t>> m_index;
+  HashMap<String, ImageMetadata> m_imageMetadata;
 };
 
 }
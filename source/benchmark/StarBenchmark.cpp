@@ -0,0 +1,149 @@
+#include "StarBenchmark.hpp"
+#include "StarTime.hpp"
+#include "StarAlgorithm.hpp"
+#include "StarJsonExtra.hpp"
+
+namespace Star {
+
+namespace {
+  struct RegisteredBenchmark {
+    String name;
+    BenchmarkFunction function;
+    Maybe<int64_t> argument;
+  };
+
+  // Constructed on first use, benchmarks register from static initializers
+  List<RegisteredBenchmark>& registeredBenchmarks() {
+    static List<RegisteredBenchmark> benchmarks;
+    return benchmarks;
+  }
+
+  // No more than this many iterations are run at once while calibrating
+  uint64_t const MaxIterations = 1000000000;
+}
+
+BenchmarkState::BenchmarkState(uint64_t iterations, Maybe<int64_t> argument)
+  : m_iterations(iterations), m_remaining(iterations), m_argument(argument), m_started(false),
+    m_start(0.0), m_elapsed(0.0), m_bytesProcessed(0), m_itemsProcessed(0) {}
+
+bool BenchmarkState::keepRunning() {
+  if (!m_started) {
+    m_started = true;
+    m_start = Time::monotonicTime();
+  }
+
+  if (m_remaining == 0) {
+    m_elapsed += Time::monotonicTime() - m_start;
+    return false;
+  }
+  --m_remaining;
+  return true;
+}
+
+int64_t BenchmarkState::argument() const {
+  if (!m_argument)
+    throw BenchmarkException("Benchmark was not registered with any arguments");
+  return *m_argument;
+}
+
+void BenchmarkState::pauseTiming() {
+  m_elapsed += Time::monotonicTime() - m_start;
+}
+
+void BenchmarkState::resumeTiming() {
+  m_start = Time::monotonicTime();
+}
+
+void BenchmarkState::setBytesProcessed(uint64_t bytes) {
+  m_bytesProcessed = bytes;
+}
+
+void BenchmarkState::setItemsProcessed(uint64_t items) {
+  m_itemsProcessed = items;
+}
+
+uint64_t BenchmarkState::iterations() const {
+  return m_iterations;
+}
+
+double BenchmarkState::elapsed() const {
+  return m_elapsed;
+}
+
+uint64_t BenchmarkState::bytesProcessed() const {
+  return m_bytesProcessed;
+}
+
+uint64_t BenchmarkState::itemsProcessed() const {
+  return m_itemsProcessed;
+}
+
+bool registerBenchmark(String name, BenchmarkFunction function, List<int64_t> arguments) {
+  if (arguments.empty()) {
+    registeredBenchmarks().append({std::move(name), std::move(function), {}});
+  } else {
+    for (auto argument : arguments)
+      registeredBenchmarks().append({strf("{}/{}", name, argument), function, argument});
+  }
+  return true;
+}
+
+Json BenchmarkResult::toJson() const {
+  return JsonObject{
+    {"name", name},
+    {"iterations", iterations},
+    {"nanoseconds", nanoseconds},
+    {"minNanoseconds", minNanoseconds},
+    {"maxNanoseconds", maxNanoseconds},
+    {"bytesPerSecond", jsonFromMaybe(bytesPerSecond)},
+    {"itemsPerSecond", jsonFromMaybe(itemsPerSecond)}
+  };
+}
+
+void runBenchmarks(BenchmarkSettings const& settings, function<void(BenchmarkResult const&)> const& resultCallback) {
+  auto benchmarks = registeredBenchmarks();
+  sort(benchmarks, [](RegisteredBenchmark const& a, RegisteredBenchmark const& b) { return a.name < b.name; });
+
+  for (auto const& benchmark : benchmarks) {
+    if (!benchmark.name.contains(settings.filter))
+      continue;
+
+    // Grow the iteration count until a run is long enough to time
+    uint64_t iterations = 1;
+    while (true) {
+      BenchmarkState state(iterations, benchmark.argument);
+      benchmark.function(state);
+      if (state.elapsed() >= settings.minimumTime || iterations >= MaxIterations)
+        break;
+      double scale = state.elapsed() > 0.0 ? settings.minimumTime * 1.4 / state.elapsed() : 10.0;
+      iterations = min<uint64_t>(MaxIterations, max<uint64_t>(iterations + 1, iterations * clamp(scale, 1.0, 10.0)));
+    }
+
+    List<double> times;
+    uint64_t bytesProcessed = 0;
+    uint64_t itemsProcessed = 0;
+    for (unsigned i = 0; i < max(settings.repetitions, 1u); ++i) {
+      BenchmarkState state(iterations, benchmark.argument);
+      benchmark.function(state);
+      times.append(state.elapsed() / iterations);
+      bytesProcessed = state.bytesProcessed();
+      itemsProcessed = state.itemsProcessed();
+    }
+    sort(times);
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    double median = times[times.size() / 2];
+    result.nanoseconds = median * 1e9;
+    result.minNanoseconds = times.first() * 1e9;
+    result.maxNanoseconds = times.last() * 1e9;
+    if (bytesProcessed && median > 0.0)
+      result.bytesPerSecond = bytesProcessed / median;
+    if (itemsProcessed && median > 0.0)
+      result.itemsPerSecond = itemsProcessed / median;
+    resultCallback(result);
+  }
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "StarString.hpp"
+#include "StarJson.hpp"
+
+namespace Star {
+
+STAR_EXCEPTION(BenchmarkException, StarException);
+
+// Passed to every benchmark, which times the body of a loop over it:
+//
+//   while (state.keepRunning()) { ... }
+//
+// The runner calls the benchmark with an increasing number of iterations
+// until one run takes long enough to time reliably, then repeats the run and
+// reports the median time per iteration.
+class BenchmarkState {
+public:
+  BenchmarkState(uint64_t iterations, Maybe<int64_t> argument);
+
+  bool keepRunning();
+
+  // The argument the benchmark was registered with, if any
+  int64_t argument() const;
+
+  // Excludes work done between pause and resume from the timing, for setup
+  // that has to be redone every iteration.
+  void pauseTiming();
+  void resumeTiming();
+
+  // Reports throughput along with the time, per iteration
+  void setBytesProcessed(uint64_t bytes);
+  void setItemsProcessed(uint64_t items);
+
+  uint64_t iterations() const;
+  double elapsed() const;
+  uint64_t bytesProcessed() const;
+  uint64_t itemsProcessed() const;
+
+private:
+  uint64_t m_iterations;
+  uint64_t m_remaining;
+  Maybe<int64_t> m_argument;
+  bool m_started;
+  double m_start;
+  double m_elapsed;
+  uint64_t m_bytesProcessed;
+  uint64_t m_itemsProcessed;
+};
+
+typedef function<void(BenchmarkState&)> BenchmarkFunction;
+
+// Registers a benchmark to be run once with each argument, or once with no
+// argument if none are given.  Returns true, so that it can initialize a
+// static.
+bool registerBenchmark(String name, BenchmarkFunction function, List<int64_t> arguments = {});
+
+struct BenchmarkSettings {
+  // Only benchmarks whose names contain this are run
+  String filter;
+  // A run of a benchmark must take at least this long to count
+  double minimumTime = 0.25;
+  unsigned repetitions = 5;
+};
+
+struct BenchmarkResult {
+  String name;
+  uint64_t iterations;
+  // Median, fastest and slowest time per iteration of each repetition
+  double nanoseconds;
+  double minNanoseconds;
+  double maxNanoseconds;
+  // Per second, at the median time
+  Maybe<double> bytesPerSecond;
+  Maybe<double> itemsPerSecond;
+
+  Json toJson() const;
+};
+
+// Runs every registered benchmark matching the settings, calling the given
+// function with each result as it is completed.
+void runBenchmarks(BenchmarkSettings const& settings, function<void(BenchmarkResult const&)> const& resultCallback);
+
+// Keeps the compiler from optimizing away the computation of a value that is
+// otherwise unused.
+template <typename T>
+void benchmarkKeep(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static char const volatile* sink;
+  sink = reinterpret_cast<char const volatile*>(&value);
+#endif
+}
+
+#define STAR_BENCHMARK(name, ...)                                                                      \
+  static void name(::Star::BenchmarkState& state);                                                    \
+  static bool const name##Registered = ::Star::registerBenchmark(#name, name, {__VA_ARGS__}); \
+  static void name(::Star::BenchmarkState& state)
+
+}
@@ -0,0 +1,75 @@
+#include "StarBenchmark.hpp"
+#include "StarFile.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+int main(int argc, char** argv) {
+  try {
+    VersionOptionParser optParse;
+    optParse.setSummary("Runs microbenchmarks of core data structures and algorithms");
+    optParse.addParameter("filter", "substring", OptionParser::Optional, "only run benchmarks whose names contain this");
+    optParse.addParameter("mintime", "seconds", OptionParser::Optional, "minimum time of each timed run, default 0.25");
+    optParse.addParameter("repetitions", "count", OptionParser::Optional, "timed runs of each benchmark, the median is reported, default 5");
+    optParse.addParameter("format", "format", OptionParser::Optional, "output format, text, json or csv, default text");
+    optParse.addParameter("output", "file", OptionParser::Optional, "file to write the results to instead of stdout");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+    auto parameter = [&](String const& name, String const& def) {
+      if (auto p = opts.parameters.maybe(name))
+        return p->first();
+      return def;
+    };
+
+    BenchmarkSettings settings;
+    settings.filter = parameter("filter", "");
+    settings.minimumTime = lexicalCast<double>(parameter("mintime", "0.25"));
+    settings.repetitions = lexicalCast<unsigned>(parameter("repetitions", "5"));
+
+    String format = parameter("format", "text");
+    if (format != "text" && format != "json" && format != "csv")
+      throw BenchmarkException::format("Unknown output format '{}'", format);
+
+    String output;
+    JsonArray results;
+    if (format == "csv")
+      output += "name,iterations,nanoseconds,min_nanoseconds,max_nanoseconds,bytes_per_second,items_per_second\n";
+
+    runBenchmarks(settings, [&](BenchmarkResult const& result) {
+        if (format == "text") {
+          String throughput;
+          if (result.bytesPerSecond)
+            throughput += strf(" {:10.1f} MB/s", *result.bytesPerSecond / (1024 * 1024));
+          if (result.itemsPerSecond)
+            throughput += strf(" {:12.0f} items/s", *result.itemsPerSecond);
+          // Progress is shown as results come in when writing to stdout
+          String line = strf("{:<40} {:>14.1f} ns {:>12} iterations{}\n", result.name, result.nanoseconds, result.iterations, throughput);
+          if (opts.parameters.contains("output"))
+            output += line;
+          else
+            coutf("{}", line);
+        } else if (format == "json") {
+          results.append(result.toJson());
+        } else {
+          output += strf("{},{},{:.3f},{:.3f},{:.3f},{},{}\n", result.name, result.iterations,
+              result.nanoseconds, result.minNanoseconds, result.maxNanoseconds,
+              result.bytesPerSecond ? strf("{:.1f}", *result.bytesPerSecond) : "",
+              result.itemsPerSecond ? strf("{:.1f}", *result.itemsPerSecond) : "");
+        }
+      });
+
+    if (format == "json")
+      output = Json(JsonObject{{"benchmarks", std::move(results)}}).printJson(2) + "\n";
+
+    if (opts.parameters.contains("output"))
+      File::writeFile(output, opts.parameters.get("output").first());
+    else
+      coutf("{}", output);
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
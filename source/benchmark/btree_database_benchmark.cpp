@@ -0,0 +1,64 @@
+#include "StarBenchmark.hpp"
+#include "StarBTreeDatabase.hpp"
+#include "StarBuffer.hpp"
+#include "StarRandom.hpp"
+
+using namespace Star;
+
+namespace {
+  ByteArray keyFor(uint32_t k) {
+    k = toBigEndian(k);
+    return ByteArray((char*)&k, sizeof(k));
+  }
+
+  // In memory, so that the tree and not the disk is measured
+  shared_ptr<BTreeDatabase> openDatabase() {
+    auto db = make_shared<BTreeDatabase>("Benchmark", 4);
+    db->setAutoCommit(false);
+    db->setBlockSize(2048);
+    db->setIODevice(make_shared<Buffer>());
+    db->open();
+    return db;
+  }
+
+  List<uint32_t> shuffledKeys(size_t count) {
+    List<uint32_t> keys;
+    for (uint32_t i = 0; i < count; ++i)
+      keys.append(i);
+    RandomSource random(1);
+    random.shuffle(keys);
+    return keys;
+  }
+}
+
+STAR_BENCHMARK(BTreeDatabaseInsert, 1000, 20000) {
+  auto keys = shuffledKeys(state.argument());
+  ByteArray value(200, 'v');
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    auto db = openDatabase();
+    state.resumeTiming();
+
+    for (auto k : keys)
+      db->insert(keyFor(k), value);
+    db->commit();
+  }
+  state.setItemsProcessed(keys.size());
+}
+
+STAR_BENCHMARK(BTreeDatabaseFind, 1000, 20000) {
+  auto keys = shuffledKeys(state.argument());
+  auto db = openDatabase();
+  ByteArray value(200, 'v');
+  for (auto k : keys)
+    db->insert(keyFor(k), value);
+  db->commit();
+
+  while (state.keepRunning()) {
+    size_t found = 0;
+    for (auto k : keys)
+      found += db->find(keyFor(k)).isValid();
+    benchmarkKeep(found);
+  }
+  state.setItemsProcessed(keys.size());
+}
@@ -0,0 +1,40 @@
+#include "StarBenchmark.hpp"
+#include "StarCellularLightArray.hpp"
+#include "StarRandom.hpp"
+
+using namespace Star;
+
+namespace {
+  // Scattered obstacles, lit cells and spread lights, like an underground
+  // area lit by torches
+  void setupLightArray(ColoredCellularLightArray& lightArray, size_t size) {
+    RandomSource random(1);
+    lightArray.begin(size, size);
+    for (size_t x = 0; x < size; ++x) {
+      for (size_t y = 0; y < size; ++y) {
+        lightArray.setObstacle(x, y, random.randu32() % 4 == 0);
+        if (random.randu32() % 50 == 0)
+          lightArray.setLight(x, y, Vec3F(random.randf(), random.randf(), 0.0f));
+      }
+    }
+    for (size_t i = 0; i < size / 4; ++i) {
+      Vec2F position(random.randf() * size, random.randf() * size);
+      lightArray.addSpreadLight({position, Vec3F(random.randf(), random.randf(), random.randf())});
+    }
+  }
+}
+
+STAR_BENCHMARK(CellularLightArrayCalculate, 64, 160) {
+  size_t size = state.argument();
+  ColoredCellularLightArray lightArray;
+  lightArray.setParameters(3, 8.0f, 1.5f, 12.0f, 2.0f, 0.5f, true);
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    setupLightArray(lightArray, size);
+    state.resumeTiming();
+
+    lightArray.calculate(0, 0, size, size);
+    benchmarkKeep(lightArray.getLight(size / 2, size / 2));
+  }
+  state.setItemsProcessed(size * size);
+}
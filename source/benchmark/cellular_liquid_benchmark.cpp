@@ -0,0 +1,79 @@
+#include "StarBenchmark.hpp"
+#include "StarCellularLiquid.hpp"
+
+using namespace Star;
+
+namespace {
+  // A cave wrapping horizontally, with scattered rock and the upper half of
+  // the left side flooded, which keeps nearly every liquid cell active.
+  struct CaveLiquidWorld : CellularLiquidWorld<uint8_t> {
+    CaveLiquidWorld(int width, int height) : width(width), height(height) {
+      cells.resize(width * height);
+      solid.resize(width * height);
+      for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+          size_t i = x + y * width;
+          solid[i] = y == 0 || y == height - 1 || staticRandomU32(x / 3, y / 3, "rock") % 9 == 0;
+          cells[i] = CellularLiquidFlowCell<uint8_t>{{}, 0.0f, 0.0f};
+          if (!solid[i] && x < width / 2 && y > height / 2)
+            cells[i] = CellularLiquidFlowCell<uint8_t>{uint8_t(1), 1.0f, 0.0f};
+        }
+      }
+    }
+
+    Vec2I uniqueLocation(Vec2I const& location) const override {
+      return Vec2I(pmod(location[0], width), location[1]);
+    }
+
+    CellularLiquidCell<uint8_t> cell(Vec2I const& location) const override {
+      if (location[1] < 0 || location[1] >= height)
+        return CellularLiquidCollisionCell();
+      size_t i = location[0] + location[1] * width;
+      if (solid[i])
+        return CellularLiquidCollisionCell();
+      return cells[i];
+    }
+
+    void setFlow(Vec2I const& location, CellularLiquidFlowCell<uint8_t> const& flow) override {
+      cells[location[0] + location[1] * width] = flow;
+    }
+
+    int width;
+    int height;
+    List<CellularLiquidFlowCell<uint8_t>> cells;
+    List<bool> solid;
+  };
+
+  LiquidCellEngineParameters engineParameters() {
+    LiquidCellEngineParameters parameters;
+    parameters.lateralMoveFactor = 0.5f;
+    parameters.spreadOverfillUpFactor = 0.25f;
+    parameters.spreadOverfillLateralFactor = 0.75f;
+    parameters.spreadOverfillDownFactor = 0.25f;
+    parameters.pressureEqualizeFactor = 0.5f;
+    parameters.pressureMoveFactor = 0.5f;
+    parameters.maximumPressureLevelImbalance = 0.05f;
+    parameters.minimumLivenPressureChange = 0.0001f;
+    parameters.minimumLivenLevelChange = 0.0001f;
+    parameters.minimumLiquidLevel = 0.0f;
+    parameters.interactTransformationLevel = 0.1f;
+    parameters.equilibriumChangeThreshold = 0.0f;
+    parameters.equilibriumTicks = 0;
+    return parameters;
+  }
+}
+
+STAR_BENCHMARK(LiquidCellEngineUpdate, 100, 300) {
+  int size = state.argument();
+  auto world = make_shared<CaveLiquidWorld>(size * 2, size);
+  LiquidCellEngine<uint8_t> engine(engineParameters(), world);
+  engine.setThreadCount(0);
+  engine.visitRegion(RectI(0, 0, world->width, world->height));
+
+  size_t activeCells = 0;
+  while (state.keepRunning()) {
+    engine.update();
+    activeCells = engine.activeCells();
+  }
+  state.setItemsProcessed(activeCells);
+}
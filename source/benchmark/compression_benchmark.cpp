@@ -0,0 +1,43 @@
+#include "StarBenchmark.hpp"
+#include "StarCompression.hpp"
+#include "StarRandom.hpp"
+
+using namespace Star;
+
+namespace {
+  // Runs of repeated bytes broken up by noise, roughly as compressible as
+  // serialized world sectors
+  ByteArray testData(size_t size) {
+    RandomSource random(1);
+    ByteArray data;
+    while (data.size() < size) {
+      char byte = random.randu32() % 16;
+      data.append(ByteArray(random.randu32() % 32 + 1, byte));
+      data.appendByte((char)random.randu32());
+    }
+    data.resize(size);
+    return data;
+  }
+}
+
+STAR_BENCHMARK(CompressDataLow, 65536) {
+  ByteArray data = testData(state.argument());
+  while (state.keepRunning())
+    benchmarkKeep(compressData(data, LowCompression));
+  state.setBytesProcessed(data.size());
+}
+
+STAR_BENCHMARK(CompressDataMedium, 65536) {
+  ByteArray data = testData(state.argument());
+  while (state.keepRunning())
+    benchmarkKeep(compressData(data, MediumCompression));
+  state.setBytesProcessed(data.size());
+}
+
+STAR_BENCHMARK(UncompressData, 65536) {
+  ByteArray data = testData(state.argument());
+  ByteArray compressed = compressData(data);
+  while (state.keepRunning())
+    benchmarkKeep(uncompressData(compressed));
+  state.setBytesProcessed(data.size());
+}
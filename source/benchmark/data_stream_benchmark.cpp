@@ -0,0 +1,72 @@
+#include "StarBenchmark.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarDataStreamExtra.hpp"
+#include "StarVector.hpp"
+
+using namespace Star;
+
+namespace {
+  struct TestRecord {
+    Vec2I position;
+    String name;
+    uint64_t id;
+    List<float> values;
+  };
+
+  DataStream& operator<<(DataStream& ds, TestRecord const& record) {
+    ds << record.position;
+    ds << record.name;
+    ds.writeVlqU(record.id);
+    ds << record.values;
+    return ds;
+  }
+
+  DataStream& operator>>(DataStream& ds, TestRecord& record) {
+    ds >> record.position;
+    ds >> record.name;
+    record.id = ds.readVlqU();
+    ds >> record.values;
+    return ds;
+  }
+
+  List<TestRecord> testRecords(size_t count) {
+    List<TestRecord> records;
+    for (size_t i = 0; i < count; ++i)
+      records.append({Vec2I(i, -(int)i), strf("record{}", i), i * 7919, {1.0f, 2.5f, (float)i}});
+    return records;
+  }
+}
+
+STAR_BENCHMARK(DataStreamWriteRecords, 1000) {
+  auto records = testRecords(state.argument());
+  size_t bytes = 0;
+  while (state.keepRunning()) {
+    DataStreamBuffer ds;
+    ds.writeContainer(records);
+    bytes = ds.size();
+    benchmarkKeep(ds.data());
+  }
+  state.setBytesProcessed(bytes);
+}
+
+STAR_BENCHMARK(DataStreamReadRecords, 1000) {
+  ByteArray data = DataStreamBuffer::serializeContainer(testRecords(state.argument()));
+  while (state.keepRunning())
+    benchmarkKeep(DataStreamBuffer::deserializeContainer<List<TestRecord>>(data));
+  state.setBytesProcessed(data.size());
+}
+
+STAR_BENCHMARK(DataStreamVlq, 10000) {
+  int64_t count = state.argument();
+  while (state.keepRunning()) {
+    DataStreamBuffer ds;
+    for (int64_t i = 0; i < count; ++i)
+      ds.writeVlqI(i * 37 - count);
+    ds.seek(0);
+    int64_t sum = 0;
+    for (int64_t i = 0; i < count; ++i)
+      sum += ds.readVlqI();
+    benchmarkKeep(sum);
+  }
+  state.setItemsProcessed(count);
+}
@@ -0,0 +1,74 @@
+#include "StarBenchmark.hpp"
+#include "StarFlatHashMap.hpp"
+#include "StarRandom.hpp"
+
+using namespace Star;
+
+namespace {
+  List<uint64_t> randomKeys(size_t count) {
+    RandomSource random(1);
+    List<uint64_t> keys;
+    for (size_t i = 0; i < count; ++i)
+      keys.append(random.randu64());
+    return keys;
+  }
+}
+
+STAR_BENCHMARK(FlatHashMapInsert, 1000, 100000) {
+  auto keys = randomKeys(state.argument());
+  while (state.keepRunning()) {
+    FlatHashMap<uint64_t, uint64_t> map;
+    for (auto key : keys)
+      map.insert({key, key});
+    benchmarkKeep(map.size());
+  }
+  state.setItemsProcessed(keys.size());
+}
+
+STAR_BENCHMARK(FlatHashMapFind, 1000, 100000) {
+  auto keys = randomKeys(state.argument());
+  FlatHashMap<uint64_t, uint64_t> map;
+  for (auto key : keys)
+    map.insert({key, key});
+
+  while (state.keepRunning()) {
+    uint64_t sum = 0;
+    for (auto key : keys)
+      sum += map.find(key)->second;
+    benchmarkKeep(sum);
+  }
+  state.setItemsProcessed(keys.size());
+}
+
+STAR_BENCHMARK(FlatHashMapFindMissing, 1000, 100000) {
+  auto keys = randomKeys(state.argument());
+  FlatHashMap<uint64_t, uint64_t> map;
+  for (auto key : keys)
+    map.insert({key, key});
+  auto missing = randomKeys(state.argument() * 2).slice(state.argument());
+
+  while (state.keepRunning()) {
+    size_t found = 0;
+    for (auto key : missing)
+      found += map.find(key) != map.end();
+    benchmarkKeep(found);
+  }
+  state.setItemsProcessed(missing.size());
+}
+
+STAR_BENCHMARK(FlatHashMapStringKeys, 1000) {
+  List<String> keys;
+  for (auto key : randomKeys(state.argument()))
+    keys.append(toString(key));
+  FlatHashMap<String, size_t> map;
+  for (size_t i = 0; i < keys.size(); ++i)
+    map.insert({keys[i], i});
+
+  while (state.keepRunning()) {
+    size_t sum = 0;
+    for (auto const& key : keys)
+      sum += map.find(key)->second;
+    benchmarkKeep(sum);
+  }
+  state.setItemsProcessed(keys.size());
+}
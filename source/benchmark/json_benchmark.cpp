@@ -0,0 +1,57 @@
+#include "StarBenchmark.hpp"
+#include "StarJson.hpp"
+
+using namespace Star;
+
+namespace {
+  // An asset-like document of nested objects and arrays
+  String testDocument(int64_t entries) {
+    JsonArray items;
+    for (int64_t i = 0; i < entries; ++i) {
+      items.append(JsonObject{
+          {"name", strf("item{}", i)},
+          {"rarity", i % 3 == 0 ? "common" : "rare"},
+          {"price", i * 10},
+          {"scale", 0.5 + i * 0.25},
+          {"tags", JsonArray{"weapon", "melee", strf("tier{}", i % 6)}},
+          {"offset", JsonArray{i, -i}}
+        });
+    }
+    return Json(JsonObject{{"items", items}, {"version", 3}}).printJson(2);
+  }
+}
+
+STAR_BENCHMARK(JsonParse, 10, 1000) {
+  String document = testDocument(state.argument());
+  while (state.keepRunning())
+    benchmarkKeep(Json::parseJson(document));
+  state.setBytesProcessed(document.utf8Size());
+}
+
+STAR_BENCHMARK(JsonPrint, 10, 1000) {
+  Json json = Json::parseJson(testDocument(state.argument()));
+  while (state.keepRunning())
+    benchmarkKeep(json.printJson());
+}
+
+STAR_BENCHMARK(JsonObjectGet) {
+  Json json = Json::parseJson(testDocument(1)).get("items").get(0);
+  while (state.keepRunning()) {
+    benchmarkKeep(json.getString("name"));
+    benchmarkKeep(json.getInt("price"));
+    benchmarkKeep(json.getFloat("scale"));
+  }
+  state.setItemsProcessed(3);
+}
+
+STAR_BENCHMARK(JsonQuery) {
+  Json json = Json::parseJson(testDocument(100));
+  while (state.keepRunning())
+    benchmarkKeep(json.query("items[50].tags[2]"));
+}
+
+STAR_BENCHMARK(JsonSetCopyOnWrite) {
+  Json json = Json::parseJson(testDocument(1)).get("items").get(0);
+  while (state.keepRunning())
+    benchmarkKeep(json.set("price", 20));
+}
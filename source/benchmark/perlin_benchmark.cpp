@@ -0,0 +1,46 @@
+#include "StarBenchmark.hpp"
+#include "StarPerlin.hpp"
+
+using namespace Star;
+
+namespace {
+  void benchmarkPerlin(BenchmarkState& state, PerlinType type) {
+    PerlinF perlin(type, 6, 0.05f, 1.0f, 0.0f, 2.0f, 2.0f, 1234);
+    while (state.keepRunning()) {
+      float sum = 0.0f;
+      for (int x = 0; x < 32; ++x) {
+        for (int y = 0; y < 32; ++y)
+          sum += perlin.get(x * 1.3f, y * 0.7f);
+      }
+      benchmarkKeep(sum);
+    }
+    state.setItemsProcessed(32 * 32);
+  }
+}
+
+STAR_BENCHMARK(PerlinNoise2D) {
+  benchmarkPerlin(state, PerlinType::Perlin);
+}
+
+STAR_BENCHMARK(PerlinBillow2D) {
+  benchmarkPerlin(state, PerlinType::Billow);
+}
+
+STAR_BENCHMARK(PerlinRidgedMulti2D) {
+  benchmarkPerlin(state, PerlinType::RidgedMulti);
+}
+
+STAR_BENCHMARK(PerlinNoise3D) {
+  PerlinF perlin(PerlinType::Perlin, 6, 0.05f, 1.0f, 0.0f, 2.0f, 2.0f, 1234);
+  while (state.keepRunning()) {
+    float sum = 0.0f;
+    for (int x = 0; x < 16; ++x) {
+      for (int y = 0; y < 16; ++y) {
+        for (int z = 0; z < 4; ++z)
+          sum += perlin.get(x * 1.3f, y * 0.7f, z * 0.9f);
+      }
+    }
+    benchmarkKeep(sum);
+  }
+  state.setItemsProcessed(16 * 16 * 4);
+}
@@ -0,0 +1,66 @@
+#include "StarBenchmark.hpp"
+#include "StarString.hpp"
+
+using namespace Star;
+
+namespace {
+  String const Sentence = "The quick brown fox jumps over the lazy dog, ^orange;while the Ünïcödé cat naps.";
+}
+
+STAR_BENCHMARK(StringConstruct) {
+  while (state.keepRunning())
+    benchmarkKeep(String(Sentence.utf8Ptr()));
+}
+
+STAR_BENCHMARK(StringAppend, 16, 1024) {
+  int64_t count = state.argument();
+  while (state.keepRunning()) {
+    String result;
+    for (int64_t i = 0; i < count; ++i)
+      result.append("word ");
+    benchmarkKeep(result);
+  }
+  state.setItemsProcessed(count);
+}
+
+STAR_BENCHMARK(StringSplit) {
+  while (state.keepRunning())
+    benchmarkKeep(Sentence.splitAny(" ,."));
+}
+
+STAR_BENCHMARK(StringReplace) {
+  while (state.keepRunning())
+    benchmarkKeep(Sentence.replace("the", "a"));
+}
+
+STAR_BENCHMARK(StringToLower) {
+  while (state.keepRunning())
+    benchmarkKeep(Sentence.toLower());
+}
+
+STAR_BENCHMARK(StringFind) {
+  while (state.keepRunning())
+    benchmarkKeep(Sentence.find("naps"));
+}
+
+STAR_BENCHMARK(StringCodepointIterate) {
+  while (state.keepRunning()) {
+    size_t count = 0;
+    for (auto c : Sentence)
+      count += c;
+    benchmarkKeep(count);
+  }
+  state.setItemsProcessed(Sentence.size());
+}
+
+STAR_BENCHMARK(StringFormat) {
+  while (state.keepRunning())
+    benchmarkKeep(strf("{} at {:.2f}, {} ({})", "player", 12.5f, 42, Sentence));
+}
+
+STAR_BENCHMARK(StringHash) {
+  hash<String> hasher;
+  while (state.keepRunning())
+    benchmarkKeep(hasher(Sentence));
+  state.setBytesProcessed(Sentence.utf8Size());
+}
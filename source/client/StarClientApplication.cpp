@@ -18,6 +18,8 @@
 #include "StarVoice.hpp"
 #include "StarCurve25519.hpp"
 #include "StarInterpolation.hpp"
+#include "StarTraceProfiler.hpp"
+#include "StarHttpClient.hpp"
 
 #include "StarCameraLuaBindings.hpp"
 #include "StarCelestialLuaBindings.hpp"
@@ -228,6 +230,7 @@ void ClientApplication::applicationInit(ApplicationControllerPtr appController)
 
   appController->setTargetUpdateRate(updateRate);
   appController->setVSyncEnabled(vsync);
+  appController->setDecoupledRendering(configuration->get("decoupledRendering").optBool().value(false));
   appController->setCursorHardware(configuration->get("hardwareCursor").optBool().value(true));
 
   // Must be called before anything that can invoke an asset load.
@@ -373,6 +376,7 @@ void ClientApplication::processInput(InputEvent const& event) {
 }
 
 void ClientApplication::update() {
+  STAR_PROFILE_SCOPE("ClientApplication::update");
   float dt = GlobalTimestep * GlobalTimescale;
   auto& app = appController();
   if (m_state >= MainAppState::Title) {
@@ -421,6 +425,16 @@ void ClientApplication::update() {
     m_voice->send(ext);
   } // TODO: directly disable encoding at menu so we don't have to do this
 
+  if (m_input->bindDown("opensb", "traceCapture")) {
+    if (TraceProfiler::capturing()) {
+      String path = TraceProfiler::stopCaptureToFile(m_root->toStoragePath("traces"));
+      Logger::info("Wrote trace capture to {}", path);
+    } else {
+      TraceProfiler::startCapture();
+      Logger::info("Started trace capture");
+    }
+  }
+
   m_guiContext->cleanup();
   m_edgeKeyEvents.clear();
   m_input->update();
@@ -428,6 +442,7 @@ void ClientApplication::update() {
 }
 
 void ClientApplication::render() {
+  STAR_PROFILE_SCOPE("ClientApplication::render");
   m_framesSkipped = 0;
   auto config = m_root->configuration();
   auto assets = m_root->assets();
@@ -457,6 +472,7 @@ void ClientApplication::render() {
       auto totalStart = Time::monotonicMicroseconds();
       renderer->switchEffectConfig("world");
       auto clientStart = totalStart;
+      worldClient->setRendererLightingSupported(renderer->lightmapCalculationSupported());
       worldClient->render(m_renderData, TilePainter::BorderTileSize);
       LogMap::set("client_render_world_client", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - clientStart));
 
@@ -467,6 +483,7 @@ void ClientApplication::render() {
       LogMap::set("client_render_world_painter", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - paintStart));
       LogMap::set("client_render_world_total", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - totalStart));
       
+      STAR_PROFILE_SCOPE("ClientApplication::postProcess");
       auto size = Vec2F(renderer->screenSize());
       auto quad = renderFlatRect(RectF::withSize(size / -2, size), Vec4B::filled(0), 0.0f);
       for (auto& layer : m_postProcessLayers) {
@@ -674,6 +691,14 @@ void ClientApplication::changeState(MainAppState newState) {
     Json alwaysAllow = m_root->configuration()->getPath("safe.alwaysAllowClipboard");
     m_universeClient->setLuaCallbacks("clipboard", LuaBindings::makeClipboardCallbacks(app, alwaysAllow && alwaysAllow.toBool()));
     const bool luaHttpEnabled = m_root->configuration()->getPath("safe.luaHttp.enabled").optBool().value(false);
+    if (luaHttpEnabled) {
+      Json luaHttpConfig = m_root->configuration()->getPath("safe.luaHttp");
+      HttpClientConfig httpConfig;
+      httpConfig.threads = luaHttpConfig.getUInt("threads", httpConfig.threads);
+      httpConfig.maxRequestsPerDomain = luaHttpConfig.getUInt("maxRequestsPerDomain", httpConfig.maxRequestsPerDomain);
+      httpConfig.maxResponseSize = luaHttpConfig.getUInt("maxResponseSize", httpConfig.maxResponseSize);
+      HttpClient::configure(httpConfig);
+    }
 
     m_universeClient->setLuaCallbacks("http", LuaBindings::makeHttpCallbacks(luaHttpEnabled));
 
@@ -783,6 +808,15 @@ void ClientApplication::changeState(MainAppState newState) {
         }
       }
 
+      // Sessions over TCP are resumed by connecting to the same address again
+      if (auto address = multiPlayerConnection.server.ptr<HostAddressWithPort>()) {
+        m_universeClient->setReconnectFunction([address = *address]() -> PacketSocketUPtr {
+            return TcpPacketSocket::open(TcpSocket::connectTo(address));
+          });
+      } else {
+        m_universeClient->setReconnectFunction({});
+      }
+
       bool allowAssetsMismatch = m_root->configuration()->get("allowAssetsMismatch").toBool();
       if (auto errorMessage = m_universeClient->connect(UniverseConnection(std::move(packetSocket)), allowAssetsMismatch,
             multiPlayerConnection.account, multiPlayerConnection.password, multiPlayerConnection.forceLegacy)) {
@@ -806,6 +840,7 @@ void ClientApplication::changeState(MainAppState newState) {
         }
       }
 
+      m_universeClient->setReconnectFunction({});
       if (auto errorMessage = m_universeClient->connect(m_universeServer->addLocalClient(), "", "")) {
         setError(strf("Error connecting locally: {}", *errorMessage));
         return;
@@ -1314,6 +1349,7 @@ void ClientApplication::updateRunning(float dt) {
       LogMap::set("tile_liquid_level", toString(world->liquidLevel(aim).level));
       LogMap::set("tile_dungeon_id", world->isTileProtected(aim) ? strf("^red;{}", world->dungeonId(aim)) : toString(world->dungeonId(aim)));
     }
+    updateMemoryLog();
 
     if (m_mainInterface->currentState() == MainInterface::ReturnToTitle)
       changeState(MainAppState::Title);
@@ -1323,6 +1359,33 @@ void ClientApplication::updateRunning(float dt) {
   }
 }
 
+void ClientApplication::updateMemoryLog() {
+  if (!threadMemoryStatistics().counted)
+    return;
+
+  if (m_memoryLogValues.empty()) {
+    for (size_t i = 0; i < MemoryTagCount; ++i) {
+      m_memoryLogValues.append(LogMap::Value(strf("memory_{}", memoryTagName((MemoryTag)i)), "{:.2f} MiB live, {:.2f} MiB/s"));
+      m_memoryLogAllocatedBytes[i] = memoryTagStatistics((MemoryTag)i).allocatedBytes;
+      m_memoryLogRates.append(0.0);
+    }
+    m_memoryLogTime = Time::monotonicTime();
+  }
+
+  double now = Time::monotonicTime();
+  bool updateRates = now - m_memoryLogTime >= 1.0;
+  for (size_t i = 0; i < MemoryTagCount; ++i) {
+    auto stats = memoryTagStatistics((MemoryTag)i);
+    if (updateRates) {
+      m_memoryLogRates[i] = (stats.allocatedBytes - m_memoryLogAllocatedBytes[i]) / 1048576.0 / (now - m_memoryLogTime);
+      m_memoryLogAllocatedBytes[i] = stats.allocatedBytes;
+    }
+    m_memoryLogValues[i].set(stats.liveBytes / 1048576.0, m_memoryLogRates[i]);
+  }
+  if (updateRates)
+    m_memoryLogTime = now;
+}
+
 bool ClientApplication::isActionTaken(InterfaceAction action) const {
   for (auto keyEvent : m_heldKeyEvents) {
     if (m_guiContext->actions(keyEvent).contains(action))
@@ -86,6 +86,7 @@ private:
   void updateError(float dt);
   void updateTitle(float dt);
   void updateRunning(float dt);
+  void updateMemoryLog();
 
   bool isActionTaken(InterfaceAction action) const;
   bool isActionTakenEdge(InterfaceAction action) const;
@@ -153,6 +154,13 @@ private:
   ByteArray m_immediateFont;
 
   bool m_loggedUGCCheck;
+
+  // Memory by tag in the debug overlay, only registered when memory
+  // statistics are counted.  Allocation rates are over the last second.
+  List<LogMap::Value> m_memoryLogValues;
+  Array<uint64_t, MemoryTagCount> m_memoryLogAllocatedBytes;
+  List<double> m_memoryLogRates;
+  double m_memoryLogTime = 0.0;
 };
 
 }
@@ -0,0 +1,45 @@
+#include "StarArena.hpp"
+
+namespace Star {
+
+Arena& Arena::threadArena() {
+  thread_local Arena arena;
+  return arena;
+}
+
+Arena::Arena(size_t blockSize)
+  : m_blockSize(blockSize), m_currentBlock(0), m_currentOffset(0), m_bytesUsed(0) {}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  while (true) {
+    if (m_currentBlock < m_blocks.size()) {
+      auto& block = m_blocks[m_currentBlock];
+      size_t address = (size_t)block.data.get() + m_currentOffset;
+      size_t offset = m_currentOffset + (alignment - address % alignment) % alignment;
+      if (offset + size <= block.size) {
+        m_currentOffset = offset + size;
+        m_bytesUsed += size;
+        return block.data.get() + offset;
+      }
+      ++m_currentBlock;
+      m_currentOffset = 0;
+    } else {
+      // Allocations larger than the block size get a block of their own size
+      size_t blockSize = max(m_blockSize, size + alignment);
+      m_blocks.append(Block{unique_ptr<char[]>(new char[blockSize]), blockSize});
+    }
+  }
+}
+
+void Arena::reset() {
+  m_blocks.resize(min(m_blocks.size(), m_currentBlock + 1));
+  m_currentBlock = 0;
+  m_currentOffset = 0;
+  m_bytesUsed = 0;
+}
+
+size_t Arena::bytesUsed() const {
+  return m_bytesUsed;
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "StarList.hpp"
+
+namespace Star {
+
+// Bump allocator handing out memory from a list of large blocks, for
+// transient allocations that all die together.  Deallocating individual
+// allocations does nothing, instead reset() makes all of the blocks available
+// again at once.  Not thread safe.
+class Arena {
+public:
+  // Arena used for scratch allocations on the current thread, reset once per
+  // tick or frame by the loop that owns the thread.  Nothing allocated from
+  // it may outlive that tick or frame.
+  static Arena& threadArena();
+
+  Arena(size_t blockSize = 65536);
+
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+
+  void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Invalidates everything allocated so far.  Blocks that were reached since
+  // the last reset are kept for reuse, any others are released.
+  void reset();
+
+  // Total bytes handed out since the last reset.
+  size_t bytesUsed() const;
+
+private:
+  struct Block {
+    unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  size_t m_blockSize;
+  List<Block> m_blocks;
+  size_t m_currentBlock;
+  size_t m_currentOffset;
+  size_t m_bytesUsed;
+};
+
+// STL compatible allocator over an Arena, so that List, HashMap, HashSet etc.
+// may draw their storage from it.  Deallocation is a no-op, storage is
+// reclaimed when the Arena is reset, so containers using it must not outlive
+// the next reset.
+template <typename T>
+class ArenaAllocator {
+public:
+  typedef T value_type;
+
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  template <class U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  // Allocates from Arena::threadArena() by default
+  ArenaAllocator();
+  ArenaAllocator(Arena& arena);
+  template <class U>
+  ArenaAllocator(ArenaAllocator<U> const& other);
+
+  T* allocate(size_t n);
+  void deallocate(T* p, size_t n);
+
+  template <class U>
+  bool operator==(ArenaAllocator<U> const& rhs) const;
+  template <class U>
+  bool operator!=(ArenaAllocator<U> const& rhs) const;
+
+private:
+  template <typename OtherT>
+  friend class ArenaAllocator;
+
+  Arena* m_arena;
+};
+
+template <typename T>
+using ArenaList = List<T, ArenaAllocator<T>>;
+
+template <typename T>
+ArenaAllocator<T>::ArenaAllocator()
+  : m_arena(&Arena::threadArena()) {}
+
+template <typename T>
+ArenaAllocator<T>::ArenaAllocator(Arena& arena)
+  : m_arena(&arena) {}
+
+template <typename T>
+template <class U>
+ArenaAllocator<T>::ArenaAllocator(ArenaAllocator<U> const& other)
+  : m_arena(other.m_arena) {}
+
+template <typename T>
+T* ArenaAllocator<T>::allocate(size_t n) {
+  return (T*)m_arena->allocate(n * sizeof(T), alignof(T));
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T*, size_t) {}
+
+template <typename T>
+template <class U>
+bool ArenaAllocator<T>::operator==(ArenaAllocator<U> const& rhs) const {
+  return m_arena == rhs.m_arena;
+}
+
+template <typename T>
+template <class U>
+bool ArenaAllocator<T>::operator!=(ArenaAllocator<U> const& rhs) const {
+  return m_arena != rhs.m_arena;
+}
+
+}
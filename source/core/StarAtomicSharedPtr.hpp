@@ -1,12 +1,17 @@
 #pragma once
 
-#include "StarThread.hpp"
+#include "StarHazardPointer.hpp"
 
 namespace Star {
 
 // Thread safe shared_ptr such that is is possible to safely access the
 // contents of the shared_ptr while other threads might be updating it.  Makes
 // it possible to safely do Read Copy Update.
+//
+// Lock free, the shared_ptr lives in a separately allocated holder that is
+// swapped atomically on store, and readers protect the holder with a hazard
+// pointer while copying out of it, so a replaced holder is only deleted once
+// no reader is still copying from it.
 template <typename T>
 class AtomicSharedPtr {
 public:
@@ -17,6 +22,7 @@ public:
   AtomicSharedPtr(AtomicSharedPtr const& p);
   AtomicSharedPtr(AtomicSharedPtr&& p);
   AtomicSharedPtr(SharedPtr p);
+  ~AtomicSharedPtr();
 
   SharedPtr load() const;
   WeakPtr weak() const;
@@ -33,86 +39,111 @@ public:
   AtomicSharedPtr& operator=(SharedPtr p);
 
 private:
-  SharedPtr m_ptr;
-  mutable SpinLock m_lock;
+  static SharedPtr* makeHolder(SharedPtr p);
+
+  // Calls the given function with the current holder, which may be null,
+  // while it is protected from deletion.
+  template <typename Function>
+  decltype(auto) withHolder(Function&& function) const;
+
+  atomic<SharedPtr*> m_holder;
 };
 
 template <typename T>
-AtomicSharedPtr<T>::AtomicSharedPtr() {}
+AtomicSharedPtr<T>::AtomicSharedPtr()
+  : m_holder(nullptr) {}
 
 template <typename T>
 AtomicSharedPtr<T>::AtomicSharedPtr(AtomicSharedPtr const& p)
-  : m_ptr(p.load()) {}
+  : m_holder(makeHolder(p.load())) {}
 
 template <typename T>
 AtomicSharedPtr<T>::AtomicSharedPtr(AtomicSharedPtr&& p)
-  : m_ptr(std::move(p.m_ptr)) {}
+  : m_holder(p.m_holder.exchange(nullptr)) {}
 
 template <typename T>
 AtomicSharedPtr<T>::AtomicSharedPtr(SharedPtr p)
-  : m_ptr(std::move(p)) {}
+  : m_holder(makeHolder(std::move(p))) {}
+
+template <typename T>
+AtomicSharedPtr<T>::~AtomicSharedPtr() {
+  HazardPointer::retire(m_holder.exchange(nullptr));
+}
 
 template <typename T>
 auto AtomicSharedPtr<T>::load() const -> SharedPtr {
-  SpinLocker locker(m_lock);
-  return m_ptr;
+  return withHolder([](SharedPtr const* holder) {
+      return holder ? *holder : SharedPtr();
+    });
 }
 
 template <typename T>
 auto AtomicSharedPtr<T>::weak() const -> WeakPtr {
-  SpinLocker locker(m_lock);
-  return WeakPtr(m_ptr);
+  return withHolder([](SharedPtr const* holder) {
+      return holder ? WeakPtr(*holder) : WeakPtr();
+    });
 }
 
 template <typename T>
 void AtomicSharedPtr<T>::store(SharedPtr p) {
-  SpinLocker locker(m_lock);
-  m_ptr = std::move(p);
+  HazardPointer::retire(m_holder.exchange(makeHolder(std::move(p))));
 }
 
 template <typename T>
 void AtomicSharedPtr<T>::reset() {
-  SpinLocker locker(m_lock);
-  m_ptr.reset();
+  HazardPointer::retire(m_holder.exchange(nullptr));
 }
 
 template <typename T>
 AtomicSharedPtr<T>::operator bool() const {
-  SpinLocker locker(m_lock);
-  return (bool)m_ptr;
+  // Empty shared_ptrs are never given a holder
+  return m_holder.load() != nullptr;
 }
 
 template <typename T>
 bool AtomicSharedPtr<T>::unique() const {
-  SpinLocker locker(m_lock);
-  return m_ptr.unique();
+  return withHolder([](SharedPtr const* holder) {
+      return holder && holder->use_count() == 1;
+    });
 }
 
 template <typename T>
 auto AtomicSharedPtr<T>::operator-> () const -> SharedPtr {
-  SpinLocker locker(m_lock);
-  return m_ptr;
+  return load();
 }
 
 template <typename T>
 AtomicSharedPtr<T>& AtomicSharedPtr<T>::operator=(AtomicSharedPtr const& p) {
-  SpinLocker locker(m_lock);
-  m_ptr = p.load();
+  store(p.load());
   return *this;
 }
 
 template <typename T>
 AtomicSharedPtr<T>& AtomicSharedPtr<T>::operator=(AtomicSharedPtr&& p) {
-  SpinLocker locker(m_lock);
-  m_ptr = std::move(p.m_ptr);
+  HazardPointer::retire(m_holder.exchange(p.m_holder.exchange(nullptr)));
   return *this;
 }
 
 template <typename T>
 AtomicSharedPtr<T>& AtomicSharedPtr<T>::operator=(SharedPtr p) {
-  SpinLocker locker(m_lock);
-  m_ptr = std::move(p);
+  store(std::move(p));
   return *this;
 }
 
+template <typename T>
+auto AtomicSharedPtr<T>::makeHolder(SharedPtr p) -> SharedPtr* {
+  if (!p)
+    return nullptr;
+  return new SharedPtr(std::move(p));
+}
+
+template <typename T>
+template <typename Function>
+decltype(auto) AtomicSharedPtr<T>::withHolder(Function&& function) const {
+  auto& hazard = HazardPointer::threadHazard();
+  auto result = function(hazard.protect(m_holder));
+  hazard.clear();
+  return result;
+}
+
 }
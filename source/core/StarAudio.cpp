@@ -652,6 +652,12 @@ size_t Audio::read(int16_t* buffer, size_t bufferSize) {
 }
 
 size_t Audio::resample(unsigned destinationChannels, unsigned destinationSampleRate, int16_t* destinationBuffer, size_t destinationBufferSize, double velocity) {
+  return resample(destinationChannels, destinationSampleRate, destinationBuffer, destinationBufferSize, velocity,
+      [this](int16_t* buffer, size_t bufferSize) { return read(buffer, bufferSize); });
+}
+
+size_t Audio::resample(unsigned destinationChannels, unsigned destinationSampleRate, int16_t* destinationBuffer, size_t destinationBufferSize,
+    double velocity, ReadFunction const& readFunction) {
   unsigned destinationSamples = destinationBufferSize / destinationChannels;
   if (destinationSamples == 0)
     return 0;
@@ -666,7 +672,7 @@ size_t Audio::resample(unsigned destinationChannels, unsigned destinationSampleR
     // If the destination and source channel count and sample rate are the
     // same, this is the same as a read.
 
-    return read(destinationBuffer, destinationBufferSize);
+    return readFunction(destinationBuffer, destinationBufferSize);
 
   } else if (destinationSampleRate == sourceSampleRate) {
     // If the destination and source sample rate are the same, then we can skip
@@ -677,7 +683,7 @@ size_t Audio::resample(unsigned destinationChannels, unsigned destinationSampleR
     m_workingBuffer.resize(sourceBufferSize * sizeof(int16_t));
     int16_t* sourceBuffer = (int16_t*)m_workingBuffer.ptr();
 
-    unsigned readSamples = read(sourceBuffer, sourceBufferSize) / sourceChannels;
+    unsigned readSamples = readFunction(sourceBuffer, sourceBufferSize) / sourceChannels;
 
     for (unsigned sample = 0; sample < readSamples; ++sample) {
       unsigned sourceBufferIndex = sample * sourceChannels;
@@ -703,7 +709,7 @@ size_t Audio::resample(unsigned destinationChannels, unsigned destinationSampleR
     m_workingBuffer.resize(sourceBufferSize * sizeof(int16_t));
     int16_t* sourceBuffer = (int16_t*)m_workingBuffer.ptr();
 
-    unsigned readSamples = read(sourceBuffer, sourceBufferSize) / sourceChannels;
+    unsigned readSamples = readFunction(sourceBuffer, sourceBufferSize) / sourceChannels;
 
     if (readSamples == 0)
       return 0;
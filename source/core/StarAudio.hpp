@@ -91,6 +91,15 @@ public:
       int16_t* destinationBuffer, size_t destinationBufferSize,
       double velocity = 1.0);
 
+  // Same as resample, but source samples are pulled from the given function
+  // rather than read from this Audio.  The function must produce whole
+  // frames in this Audio's channel layout and sample rate, and may return
+  // fewer samples than requested.
+  typedef function<size_t(int16_t* buffer, size_t bufferSize)> ReadFunction;
+  size_t resample(unsigned destinationChannels, unsigned destinationSampleRate,
+      int16_t* destinationBuffer, size_t destinationBufferSize,
+      double velocity, ReadFunction const& readFunction);
+
   String const& name() const;
   void setName(String name);
 
@@ -129,11 +129,38 @@ public:
   template <typename Visitor, typename ErrorHandler>
   void recoverAll(Visitor&& visitor, ErrorHandler&& error);
 
+  // The two halves of recoverAll, so that leaves can be recovered separately.
+  // recoverLeafPointers walks only the index nodes and returns every leaf
+  // pointer it can reach in key order, and recoverLeaf visits everything
+  // readable in one of those leaves.  Errors are reported the same way as in
+  // recoverAll.
+  template <typename ErrorHandler>
+  List<Pointer> recoverLeafPointers(ErrorHandler&& error);
+  template <typename Visitor, typename ErrorHandler>
+  void recoverLeaf(Pointer leafPointer, Visitor&& visitor, ErrorHandler&& error);
+
   // Visitor is called either as visitor(Index const&) or visitor(Leaf const&).
   // Return false to halt traversal, true to continue.
   template <typename Visitor>
   void forAllNodes(Visitor&& visitor);
 
+  // Path from the root down to a leaf, as every index passed through along
+  // with the position of the pointer taken in it.  Used for stepping through
+  // leaves in order without relying on nextLeaf pointers.
+  typedef List<pair<Index, size_t>> LeafPath;
+
+  // Finds the leaf that would contain the given key and fills in the path to
+  // it.  Returns the leaf and the position of the first key >= k within it.
+  pair<Leaf, size_t> findLeaf(Key const& k, LeafPath& path);
+
+  // Advances the path to the following leaf and returns its pointer, or
+  // nothing if the path was already at the last leaf.
+  Maybe<Pointer> nextLeafPointer(LeafPath& path);
+
+  // The pointer that nextLeafPointer would return if it can be found without
+  // loading any index nodes, otherwise nothing.
+  Maybe<Pointer> peekNextLeafPointer(LeafPath const& path);
+
   // returns true if old value overwritten.
   bool insert(Key k, Data data);
 
@@ -239,6 +266,8 @@ private:
   void recoverAll(Index const& index, Visitor&& o, ErrorHandler&& error);
   template <typename Visitor, typename ErrorHandler>
   void recoverAll(Leaf const& leaf, Visitor&& o, ErrorHandler&& error);
+  template <typename ErrorHandler>
+  void recoverLeafPointers(Index const& index, List<Pointer>& pointers, ErrorHandler&& error);
 
   // Variable size values mean that merges can happen on inserts, so can't
   // split up into insert / remove methods
@@ -273,6 +302,48 @@ auto BTreeMixin<Base>::find(Key const& k) -> Maybe<Data> {
     return find(Base::loadIndex(Base::rootPointer()), k);
 }
 
+template <typename Base>
+auto BTreeMixin<Base>::findLeaf(Key const& k, LeafPath& path) -> pair<Leaf, size_t> {
+  path.clear();
+  if (Base::rootIsLeaf()) {
+    Leaf leaf = Base::loadLeaf(Base::rootPointer());
+    return {leaf, leafFind(leaf, k).first};
+  }
+
+  Index index = Base::loadIndex(Base::rootPointer());
+  while (true) {
+    size_t i = indexFind(index, k);
+    path.append({index, i});
+    if (Base::indexLevel(index) == 0) {
+      Leaf leaf = Base::loadLeaf(Base::indexPointer(index, i));
+      return {leaf, leafFind(leaf, k).first};
+    }
+    index = Base::loadIndex(Base::indexPointer(index, i));
+  }
+}
+
+template <typename Base>
+auto BTreeMixin<Base>::nextLeafPointer(LeafPath& path) -> Maybe<Pointer> {
+  while (!path.empty() && path.last().second + 1 >= Base::indexPointerCount(path.last().first))
+    path.removeLast();
+  if (path.empty())
+    return {};
+
+  ++path.last().second;
+  while (Base::indexLevel(path.last().first) != 0) {
+    Index child = Base::loadIndex(Base::indexPointer(path.last().first, path.last().second));
+    path.append({child, 0});
+  }
+  return Base::indexPointer(path.last().first, path.last().second);
+}
+
+template <typename Base>
+auto BTreeMixin<Base>::peekNextLeafPointer(LeafPath const& path) -> Maybe<Pointer> {
+  if (path.empty() || path.last().second + 1 >= Base::indexPointerCount(path.last().first))
+    return {};
+  return Base::indexPointer(path.last().first, path.last().second + 1);
+}
+
 template <typename Base>
 auto BTreeMixin<Base>::find(Key const& lower, Key const& upper) -> List<pair<Key, Data>> {
   DataCollector collector;
@@ -311,6 +382,31 @@ void BTreeMixin<Base>::recoverAll(Visitor&& visitor, ErrorHandler&& error) {
   }
 }
 
+template <typename Base>
+template <typename ErrorHandler>
+auto BTreeMixin<Base>::recoverLeafPointers(ErrorHandler&& error) -> List<Pointer> {
+  List<Pointer> pointers;
+  try {
+    if (Base::rootIsLeaf())
+      pointers.append(Base::rootPointer());
+    else
+      recoverLeafPointers(Base::loadIndex(Base::rootPointer()), pointers, std::forward<ErrorHandler>(error));
+  } catch (std::exception const& e) {
+    error("Error loading root index or leaf node", e);
+  }
+  return pointers;
+}
+
+template <typename Base>
+template <typename Visitor, typename ErrorHandler>
+void BTreeMixin<Base>::recoverLeaf(Pointer leafPointer, Visitor&& visitor, ErrorHandler&& error) {
+  try {
+    recoverAll(Base::loadLeaf(leafPointer), std::forward<Visitor>(visitor), std::forward<ErrorHandler>(error));
+  } catch (std::exception const& e) {
+    error("Error loading leaf node", e);
+  }
+}
+
 template <typename Base>
 template <typename Visitor>
 void BTreeMixin<Base>::forAllNodes(Visitor&& visitor) {
@@ -579,6 +675,26 @@ void BTreeMixin<Base>::recoverAll(Index const& index, Visitor&& visitor, ErrorHa
   }
 }
 
+template <typename Base>
+template <typename ErrorHandler>
+void BTreeMixin<Base>::recoverLeafPointers(Index const& index, List<Pointer>& pointers, ErrorHandler&& error) {
+  try {
+    for (size_t i = 0; i < Base::indexPointerCount(index); ++i) {
+      if (Base::indexLevel(index) == 0) {
+        pointers.append(Base::indexPointer(index, i));
+      } else {
+        try {
+          recoverLeafPointers(Base::loadIndex(Base::indexPointer(index, i)), pointers, std::forward<ErrorHandler>(error));
+        } catch (std::exception const& e) {
+          error("Error loading index node", e);
+        }
+      }
+    }
+  } catch (std::exception const& e) {
+    error("Error reading index node", e);
+  }
+}
+
 template <typename Base>
 template <typename Visitor, typename ErrorHandler>
 void BTreeMixin<Base>::recoverAll(Leaf const& leaf, Visitor&& visitor, ErrorHandler&& error) {
@@ -2,9 +2,33 @@
 #include "StarSha256.hpp"
 #include "StarVlqEncoding.hpp"
 #include "StarLogging.hpp"
+#include "StarMetrics.hpp"
+#include "StarCasting.hpp"
+#include "StarXXHash.hpp"
+#include "StarVariant.hpp"
 
 namespace Star {
 
+void BTreeDatabase::WriteBatch::insert(ByteArray key, ByteArray data) {
+  m_operations[std::move(key)] = std::move(data);
+}
+
+void BTreeDatabase::WriteBatch::remove(ByteArray key) {
+  m_operations[std::move(key)] = {};
+}
+
+size_t BTreeDatabase::WriteBatch::size() const {
+  return m_operations.size();
+}
+
+bool BTreeDatabase::WriteBatch::empty() const {
+  return m_operations.empty();
+}
+
+void BTreeDatabase::WriteBatch::clear() {
+  m_operations.clear();
+}
+
 BTreeDatabase::BTreeDatabase() {
   m_impl.parent = this;
   m_open = false;
@@ -13,10 +37,17 @@ BTreeDatabase::BTreeDatabase() {
   m_headFreeIndexBlock = InvalidBlockIndex;
   m_keySize = 0;
   m_autoCommit = true;
+  m_memoryMapped = false;
   m_indexCache.setMaxSize(64);
+  m_leafCache.setMaxSize(std::numeric_limits<size_t>::max());
+  m_leafCacheMaxSize = 0;
+  m_leafCacheSize = 0;
   m_root = InvalidBlockIndex;
   m_rootIsLeaf = false;
   m_usingAltRoot = false;
+  m_compacting = false;
+  m_bloomFilter = false;
+  m_bloomFilterKeys = 0;
 }
 
 BTreeDatabase::BTreeDatabase(String const& contentIdentifier, size_t keySize)
@@ -72,6 +103,17 @@ void BTreeDatabase::setIndexCacheSize(uint32_t indexCacheSize) {
   m_indexCache.setMaxSize(indexCacheSize);
 }
 
+size_t BTreeDatabase::leafCacheSize() const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  return m_leafCacheMaxSize;
+}
+
+void BTreeDatabase::setLeafCacheSize(size_t leafCacheSize) {
+  SpinLocker lock(m_leafCacheSpinLock);
+  m_leafCacheMaxSize = leafCacheSize;
+  trimLeafCache(m_leafCacheMaxSize);
+}
+
 bool BTreeDatabase::autoCommit() const {
   ReadLocker readLocker(m_lock);
   return m_autoCommit;
@@ -84,6 +126,34 @@ void BTreeDatabase::setAutoCommit(bool autoCommit) {
     doCommit();
 }
 
+bool BTreeDatabase::memoryMapped() const {
+  ReadLocker readLocker(m_lock);
+  return m_memoryMapped;
+}
+
+void BTreeDatabase::setMemoryMapped(bool memoryMapped) {
+  WriteLocker writeLocker(m_lock);
+  m_memoryMapped = memoryMapped;
+  updateMapping();
+}
+
+bool BTreeDatabase::bloomFilter() const {
+  ReadLocker readLocker(m_lock);
+  return m_bloomFilter;
+}
+
+void BTreeDatabase::setBloomFilter(bool bloomFilter) {
+  WriteLocker writeLocker(m_lock);
+  if (m_bloomFilter == bloomFilter)
+    return;
+
+  m_bloomFilter = bloomFilter;
+  if (m_bloomFilter && m_open)
+    rebuildBloomFilter();
+  else
+    m_bloomFilterBits.clear();
+}
+
 IODevicePtr BTreeDatabase::ioDevice() const {
   ReadLocker readLocker(m_lock);
   return m_device;
@@ -133,6 +203,9 @@ bool BTreeDatabase::open() {
     if (m_device->isWritable())
       m_device->resize(m_deviceSize);
 
+    updateMapping();
+    if (m_bloomFilter)
+      rebuildBloomFilter();
     return false;
 
   } else {
@@ -161,6 +234,8 @@ bool BTreeDatabase::open() {
 
     m_impl.createNewRoot();
     doCommit();
+    if (m_bloomFilter)
+      rebuildBloomFilter();
 
     return true;
   }
@@ -169,12 +244,16 @@ bool BTreeDatabase::open() {
 bool BTreeDatabase::contains(ByteArray const& k) {
   ReadLocker readLocker(m_lock);
   checkKeySize(k);
+  if (!bloomFilterMayContain(k))
+    return false;
   return m_impl.contains(k);
 }
 
 Maybe<ByteArray> BTreeDatabase::find(ByteArray const& k) {
   ReadLocker readLocker(m_lock);
   checkKeySize(k);
+  if (!bloomFilterMayContain(k))
+    return {};
   return m_impl.find(k);
 }
 
@@ -197,14 +276,77 @@ void BTreeDatabase::forAll(function<void(ByteArray, ByteArray)> v) {
   m_impl.forAll(std::move(v));
 }
 
-void BTreeDatabase::recoverAll(function<void(ByteArray, ByteArray)> v, function<void(String const&, std::exception const&)> e) {
+BTreeDatabase::Cursor BTreeDatabase::scan(ByteArray const& lower, ByteArray const& upper, bool prefetch) {
+  checkKeySize(lower);
+  checkKeySize(upper);
+  return Cursor(this, lower, upper, prefetch);
+}
+
+BTreeDatabase::Cursor BTreeDatabase::scanAll(bool prefetch) {
+  return Cursor(this, ByteArray(), {}, prefetch);
+}
+
+void BTreeDatabase::recoverAll(function<void(ByteArray, ByteArray)> v, function<void(String const&, std::exception const&)> e, unsigned threadCount) {
   ReadLocker readLocker(m_lock);
-  m_impl.recoverAll(std::move(v), std::move(e));
+  if (threadCount <= 1) {
+    m_impl.recoverAll(std::move(v), std::move(e));
+    return;
+  }
+
+  // Records and errors from a run of leaves, kept in the order they were
+  // found so they can be replayed on this thread.
+  typedef MVariant<pair<ByteArray, ByteArray>, pair<String, std::exception_ptr>> RecoveredItem;
+  typedef List<RecoveredItem> RecoveredItems;
+
+  List<BlockIndex> leafPointers = m_impl.recoverLeafPointers(e);
+
+  WorkerPool workerPool("BTreeDatabase::recoverAll", threadCount);
+  Deque<WorkerPoolPromise<RecoveredItems>> pending;
+  auto replay = [&](RecoveredItems& items) {
+    for (auto& item : items) {
+      if (auto record = item.ptr<pair<ByteArray, ByteArray>>()) {
+        v(std::move(record->first), std::move(record->second));
+      } else {
+        auto& error = item.get<pair<String, std::exception_ptr>>();
+        try {
+          std::rethrow_exception(error.second);
+        } catch (std::exception const& exception) {
+          e(error.first, exception);
+        }
+      }
+    }
+  };
+
+  // Bound how far the workers can get ahead so that a large database is never
+  // held in memory all at once.
+  size_t maxPending = threadCount * 4;
+  for (size_t i = 0; i < leafPointers.size(); i += RecoveryLeavesPerTask) {
+    List<BlockIndex> taskPointers = leafPointers.slice(i, i + RecoveryLeavesPerTask);
+    pending.append(workerPool.addProducer<RecoveredItems>([this, taskPointers = std::move(taskPointers)]() {
+        RecoveredItems items;
+        auto visitor = [&](ByteArray key, ByteArray data) {
+          items.append(make_pair(std::move(key), std::move(data)));
+        };
+        auto errorHandler = [&](String const& error, std::exception const&) {
+          items.append(make_pair(error, std::current_exception()));
+        };
+        for (auto pointer : taskPointers)
+          m_impl.recoverLeaf(pointer, visitor, errorHandler);
+        return items;
+      }));
+
+    if (pending.size() >= maxPending)
+      replay(pending.takeFirst().get());
+  }
+
+  while (!pending.empty())
+    replay(pending.takeFirst().get());
 }
 
 bool BTreeDatabase::insert(ByteArray const& k, ByteArray const& data) {
   WriteLocker writeLocker(m_lock);
   checkKeySize(k);
+  bloomFilterAdd(k);
   return m_impl.insert(k, data);
 }
 
@@ -214,6 +356,28 @@ bool BTreeDatabase::remove(ByteArray const& k) {
   return m_impl.remove(k);
 }
 
+void BTreeDatabase::writeBatch(WriteBatch batch) {
+  WriteLocker writeLocker(m_lock);
+  for (auto const& p : batch.m_operations)
+    checkKeySize(p.first);
+
+  bool autoCommit = m_autoCommit;
+  m_autoCommit = false;
+  auto restoreAutoCommit = finally([&]() { m_autoCommit = autoCommit; });
+
+  for (auto& p : batch.m_operations) {
+    if (p.second) {
+      bloomFilterAdd(p.first);
+      m_impl.insert(p.first, p.second.take());
+    }
+    else
+      m_impl.remove(p.first);
+  }
+
+  if (autoCommit)
+    doCommit();
+}
+
 uint64_t BTreeDatabase::recordCount() {
   ReadLocker readLocker(m_lock);
   return m_impl.recordCount();
@@ -291,16 +455,169 @@ void BTreeDatabase::commit() {
 
 void BTreeDatabase::rollback() {
   WriteLocker writeLocker(m_lock);
+  doRollback();
+}
+
+uint32_t BTreeDatabase::compact(uint32_t blockBudget) {
+  WriteLocker writeLocker(m_lock);
+  checkIfOpen("compact", true);
+  if (!m_device->isWritable() || blockBudget == 0)
+    return 0;
+
+  doCommit();
+
+  // Gather the whole free chain, every listed block is free under the current
+  // root but the chain blocks themselves must not be written until the new
+  // root is.
+  List<BlockIndex> chainBlocks;
+  Set<BlockIndex> listedBlocks;
+  for (BlockIndex indexBlockIndex = m_headFreeIndexBlock; indexBlockIndex != InvalidBlockIndex;) {
+    FreeIndexBlock indexBlock = readFreeIndexBlock(indexBlockIndex);
+    chainBlocks.append(indexBlockIndex);
+    for (auto b : indexBlock.freeBlocks)
+      listedBlocks.add(b);
+    indexBlockIndex = indexBlock.nextFreeBlock;
+  }
+
+  BlockIndex blockCount = (m_deviceSize - HeaderSize) / m_blockSize;
+  BlockIndex liveEnd = blockCount - chainBlocks.size() - listedBlocks.size();
+  if (liveEnd == blockCount)
+    return 0;
+
+  BlockIndex headFreeIndexBlock = m_headFreeIndexBlock;
+  // Keeps reserveBlock from pulling the chain in, if the listed blocks run out
+  // it will extend the device instead.
+  m_headFreeIndexBlock = InvalidBlockIndex;
+  for (auto b : listedBlocks) {
+    if (b < liveEnd)
+      m_availableBlocks.add(b);
+  }
+
+  uint32_t relocated = 0;
+  try {
+    m_compacting = true;
+    auto compactingGuard = finally([this]() { m_compacting = false; });
+
+    uint32_t budget = blockBudget;
+    if (m_rootIsLeaf) {
+      auto tailBlocks = leafTailBlocks(m_root);
+      if (m_root >= liveEnd || any(tailBlocks, [&](BlockIndex b) { return b >= liveEnd; })) {
+        auto leaf = m_impl.loadLeaf(m_root);
+        m_impl.deleteLeaf(leaf);
+        leaf->self = InvalidBlockIndex;
+        m_root = m_impl.storeLeaf(leaf);
+        budget -= min<uint32_t>(budget, 1 + tailBlocks.size());
+      }
+    } else {
+      auto index = m_impl.loadIndex(m_root);
+      if (compactVisitor(index, liveEnd, budget)) {
+        m_impl.deleteIndex(index);
+        index->self = InvalidBlockIndex;
+        m_root = m_impl.storeIndex(index);
+        budget -= min<uint32_t>(budget, 1);
+      }
+    }
+    relocated = blockBudget - budget;
+
+    if (relocated == 0 && !listedBlocks.contains(blockCount - 1) && !chainBlocks.contains(blockCount - 1)) {
+      m_availableBlocks.clear();
+      m_uncommitted.clear();
+      m_headFreeIndexBlock = headFreeIndexBlock;
+      return 0;
+    }
+
+    // Relocation may have extended the device
+    blockCount = (m_deviceSize - HeaderSize) / m_blockSize;
 
+    Set<BlockIndex> freeBlocks = m_availableBlocks;
+    freeBlocks.addAll(chainBlocks);
+    freeBlocks.addAll(m_compactedBlocks);
+    for (auto b : listedBlocks) {
+      if (!m_uncommitted.contains(b))
+        freeBlocks.add(b);
+    }
+
+    // Only blocks that were already free under the current root and were not
+    // part of its chain may hold the new chain.
+    List<BlockIndex> safeBlocks;
+    for (auto b : freeBlocks) {
+      if (m_availableBlocks.contains(b) || (listedBlocks.contains(b) && !m_uncommitted.contains(b)
+          && !m_compactedBlocks.contains(b) && !chainBlocks.contains(b)))
+        safeBlocks.append(b);
+    }
+
+    BlockIndex newEnd = blockCount;
+    while (newEnd > 0 && freeBlocks.contains(newEnd - 1))
+      --newEnd;
+
+    // If the chain has to reach into the free tail, the tail is only trimmed
+    // up to the last chain block.
+    List<BlockIndex> entries;
+    size_t newChainSize;
+    while (true) {
+      entries.clear();
+      for (auto b : freeBlocks) {
+        if (b >= newEnd)
+          break;
+        entries.append(b);
+      }
+
+      newChainSize = 0;
+      while (entries.size() - min(entries.size(), newChainSize) > newChainSize * maxFreeIndexLength())
+        ++newChainSize;
+      if (newChainSize > safeBlocks.size())
+        throw DBException("Not enough free blocks to write compacted free index");
+      if (newChainSize == 0 || safeBlocks[newChainSize - 1] < newEnd)
+        break;
+      newEnd = safeBlocks[newChainSize - 1] + 1;
+    }
+
+    List<BlockIndex> newChain = safeBlocks.slice(0, newChainSize);
+    eraseWhere(entries, [&](BlockIndex b) { return newChain.contains(b); });
+    for (size_t i = 0; i < newChain.size(); ++i) {
+      FreeIndexBlock indexBlock;
+      indexBlock.nextFreeBlock = i + 1 < newChain.size() ? newChain[i + 1] : InvalidBlockIndex;
+      indexBlock.freeBlocks = entries.slice(i * maxFreeIndexLength(), (i + 1) * maxFreeIndexLength());
+      writeFreeIndexBlock(newChain[i], indexBlock);
+    }
+
+    m_headFreeIndexBlock = newChain.empty() ? InvalidBlockIndex : newChain.first();
+    m_deviceSize = HeaderSize + newEnd * (StreamOffset)m_blockSize;
+    m_availableBlocks.clear();
+    m_compactedBlocks.clear();
+
+    commitWrites();
+    writeRoot();
+    m_uncommitted.clear();
+
+    // Only shrink once the new root no longer references the tail
+    m_mapping.reset();
+    m_device->resize(m_deviceSize);
+    updateMapping();
+
+  } catch (...) {
+    m_compactedBlocks.clear();
+    doRollback();
+    throw;
+  }
+
+  return relocated;
+}
+
+void BTreeDatabase::doRollback() {
   m_availableBlocks.clear();
   m_indexCache.clear();
+  clearLeafCache();
   m_uncommittedWrites.clear();
   m_uncommitted.clear();
+  m_mapping.reset();
 
   readRoot();
 
   if (m_device->isWritable())
     m_device->resize(m_deviceSize);
+
+  updateMapping();
 }
 
 void BTreeDatabase::close(bool closeDevice) {
@@ -310,6 +627,9 @@ void BTreeDatabase::close(bool closeDevice) {
       doCommit();
 
     m_indexCache.clear();
+    clearLeafCache();
+    m_mapping.reset();
+    m_bloomFilterBits.clear();
 
     m_open = false;
     if (closeDevice && m_device && m_device->isOpen())
@@ -317,6 +637,106 @@ void BTreeDatabase::close(bool closeDevice) {
   }
 }
 
+BTreeDatabase::Cursor::Cursor(BTreeDatabase* database, ByteArray const& lower, Maybe<ByteArray> upper, bool prefetch)
+  : m_database(database), m_upper(std::move(upper)), m_position(0), m_started(false), m_prefetchPointer(InvalidBlockIndex) {
+  m_database->m_lock.readLock();
+  try {
+    tie(m_leaf, m_position) = m_database->m_impl.findLeaf(lower, m_path);
+    if (prefetch) {
+      m_prefetchPool = make_unique<WorkerPool>("BTreeDatabase::Cursor", 1);
+      startPrefetch();
+    }
+  } catch (...) {
+    m_database->m_lock.readUnlock();
+    throw;
+  }
+}
+
+BTreeDatabase::Cursor::Cursor(Cursor&& cursor)
+  : m_database(take(cursor.m_database)),
+    m_upper(std::move(cursor.m_upper)),
+    m_path(std::move(cursor.m_path)),
+    m_leaf(std::move(cursor.m_leaf)),
+    m_position(cursor.m_position),
+    m_started(cursor.m_started),
+    m_prefetchPool(std::move(cursor.m_prefetchPool)),
+    m_prefetchPointer(cursor.m_prefetchPointer),
+    m_prefetchLeaf(std::move(cursor.m_prefetchLeaf)) {}
+
+BTreeDatabase::Cursor::~Cursor() {
+  if (!m_database)
+    return;
+
+  // The worker reads under this cursor's read lock, so it has to be done
+  // before the lock is released.
+  if (m_prefetchPool)
+    m_prefetchPool->finish();
+  m_prefetchLeaf.reset();
+  m_prefetchPool.reset();
+  m_database->m_lock.readUnlock();
+}
+
+bool BTreeDatabase::Cursor::next() {
+  if (!m_leaf)
+    return false;
+
+  if (m_started)
+    ++m_position;
+  m_started = true;
+
+  while (m_position >= m_leaf->count()) {
+    auto pointer = m_database->m_impl.nextLeafPointer(m_path);
+    if (!pointer) {
+      m_leaf.reset();
+      return false;
+    }
+
+    auto prefetchLeaf = take(m_prefetchLeaf);
+    if (prefetchLeaf && m_prefetchPointer == *pointer)
+      m_leaf = prefetchLeaf->get();
+    else
+      m_leaf = m_database->m_impl.loadLeaf(*pointer);
+    m_position = 0;
+    startPrefetch();
+  }
+
+  if (m_upper && !(m_leaf->key(m_position) < *m_upper)) {
+    m_leaf.reset();
+    return false;
+  }
+
+  return true;
+}
+
+ByteArray const& BTreeDatabase::Cursor::key() const {
+  return m_leaf->key(m_position);
+}
+
+ByteArray const& BTreeDatabase::Cursor::value() const {
+  return m_leaf->data(m_position);
+}
+
+void BTreeDatabase::Cursor::startPrefetch() {
+  if (!m_prefetchPool || m_prefetchLeaf)
+    return;
+
+  // Only leaves that share the current leaf's parent, anything further needs
+  // index nodes loaded first and just falls back to a direct load.
+  if (auto pointer = m_database->m_impl.peekNextLeafPointer(m_path)) {
+    BTreeDatabase* database = m_database;
+    BlockIndex leafPointer = *pointer;
+    m_prefetchPointer = leafPointer;
+    m_prefetchLeaf = m_prefetchPool->addProducer<BTreeImpl::Leaf>([database, leafPointer]() {
+        return database->m_impl.loadLeaf(leafPointer);
+      });
+  }
+}
+
+atomic<uint64_t> BTreeDatabase::s_leafCacheHits(0);
+atomic<uint64_t> BTreeDatabase::s_leafCacheMisses(0);
+atomic<uint64_t> BTreeDatabase::s_leafCacheEvictions(0);
+atomic<int64_t> BTreeDatabase::s_leafCacheLastReport(0);
+
 BTreeDatabase::BlockIndex const BTreeDatabase::InvalidBlockIndex;
 uint32_t const BTreeDatabase::HeaderSize;
 char const* const BTreeDatabase::VersionMagic = "BTreeDB5";
@@ -327,6 +747,9 @@ char const* const BTreeDatabase::FreeIndexMagic = "FF";
 size_t const BTreeDatabase::BTreeRootSelectorBit;
 size_t const BTreeDatabase::BTreeRootInfoStart;
 size_t const BTreeDatabase::BTreeRootInfoSize;
+size_t const BTreeDatabase::RecoveryLeavesPerTask;
+uint32_t const BTreeDatabase::BloomFilterBitsPerKey;
+uint32_t const BTreeDatabase::BloomFilterHashCount;
 
 size_t BTreeDatabase::IndexNode::pointerCount() const {
   // If no begin pointer is set then the index is simply uninitialized.
@@ -525,7 +948,8 @@ auto BTreeDatabase::BTreeImpl::loadIndex(Pointer pointer) -> Index {
 
   auto index = make_shared<IndexNode>();
 
-  DataStreamBuffer buffer(parent->readBlock(pointer));
+  ByteArray blockBuffer;
+  DataStreamExternalBuffer buffer(parent->blockData(pointer, blockBuffer), parent->m_blockSize);
 
   if (buffer.readBytes(2) != ByteArray(IndexMagic, 2))
     throw DBException("Error, incorrect index block signature.");
@@ -620,13 +1044,15 @@ auto BTreeDatabase::BTreeImpl::createLeaf() -> Leaf {
 }
 
 auto BTreeDatabase::BTreeImpl::loadLeaf(Pointer pointer) -> Leaf {
+  if (auto leaf = parent->cachedLeaf(pointer))
+    return leaf;
+
   auto leaf = make_shared<LeafNode>();
   leaf->self = pointer;
 
   BlockIndex currentLeafBlock = leaf->self;
-  DataStreamBuffer leafBuffer;
-  leafBuffer.reset(parent->m_blockSize);
-  parent->readBlock(currentLeafBlock, 0, leafBuffer.ptr(), parent->m_blockSize);
+  ByteArray blockBuffer;
+  DataStreamExternalBuffer leafBuffer(parent->blockData(currentLeafBlock, blockBuffer), parent->m_blockSize);
 
   if (leafBuffer.readBytes(2) != ByteArray(LeafMagic, 2))
     throw DBException("Error, incorrect leaf block signature.");
@@ -650,8 +1076,7 @@ auto BTreeDatabase::BTreeImpl::loadLeaf(Pointer pointer) -> Leaf {
         if (leafBuffer.pos() == (parent->m_blockSize - sizeof(BlockIndex)) && left > 0) {
           currentLeafBlock = leafBuffer.read<BlockIndex>();
           if (currentLeafBlock != InvalidBlockIndex) {
-            leafBuffer.reset(parent->m_blockSize);
-            parent->readBlock(currentLeafBlock, 0, leafBuffer.ptr(), parent->m_blockSize);
+            leafBuffer.reset(parent->blockData(currentLeafBlock, blockBuffer), parent->m_blockSize);
 
             if (leafBuffer.readBytes(2) != ByteArray(LeafMagic, 2))
               throw DBException("Error, incorrect leaf block signature.");
@@ -673,6 +1098,7 @@ auto BTreeDatabase::BTreeImpl::loadLeaf(Pointer pointer) -> Leaf {
     element.data = leafInput.read<ByteArray>();
   }
 
+  parent->cacheLeaf(leaf);
   return leaf;
 }
 
@@ -802,6 +1228,7 @@ auto BTreeDatabase::BTreeImpl::storeLeaf(Leaf leaf) -> Pointer {
   leafBuffer.write<BlockIndex>(InvalidBlockIndex);
   parent->updateBlock(currentLeafBlock, leafBuffer.data());
 
+  parent->cacheLeaf(leaf);
   return leaf->self;
 }
 
@@ -891,6 +1318,18 @@ void BTreeDatabase::updateBlock(BlockIndex blockIndex, ByteArray const& block) {
   rawWriteBlock(blockIndex, 0, block.ptr(), block.size());
 }
 
+char const* BTreeDatabase::blockData(BlockIndex blockIndex, ByteArray& buffer) const {
+  checkBlockIndex(blockIndex);
+
+  StreamOffset blockStart = HeaderSize + blockIndex * (StreamOffset)m_blockSize;
+  if (m_mapping && blockStart + m_blockSize <= m_mapping->size() && !m_uncommittedWrites.contains(blockIndex))
+    return m_mapping->data() + blockStart;
+
+  buffer.resize(m_blockSize);
+  rawReadBlock(blockIndex, 0, buffer.ptr(), m_blockSize);
+  return buffer.ptr();
+}
+
 void BTreeDatabase::rawReadBlock(BlockIndex blockIndex, size_t blockOffset, char* block, size_t size) const {
   if (blockOffset > m_blockSize || size > m_blockSize - blockOffset)
     throw DBException::format("Read past end of block, offset: {} size {}", blockOffset, size);
@@ -898,10 +1337,13 @@ void BTreeDatabase::rawReadBlock(BlockIndex blockIndex, size_t blockOffset, char
   if (size <= 0)
     return;
 
+  StreamOffset readStart = HeaderSize + blockIndex * (StreamOffset)m_blockSize + blockOffset;
   if (auto buffer = m_uncommittedWrites.ptr(blockIndex))
     buffer->copyTo(block, blockOffset, size);
+  else if (m_mapping && readStart + size <= m_mapping->size())
+    memcpy(block, m_mapping->data() + readStart, size);
   else
-    m_device->readFullAbsolute(HeaderSize + blockIndex * (StreamOffset)m_blockSize + blockOffset, block, size);
+    m_device->readFullAbsolute(readStart, block, size);
 }
 
 void BTreeDatabase::rawWriteBlock(BlockIndex blockIndex, size_t blockOffset, char const* block, size_t size) {
@@ -1000,12 +1442,92 @@ auto BTreeDatabase::leafTailBlocks(BlockIndex leafPointer) -> List<BlockIndex> {
   return tailBlocks;
 }
 
+shared_ptr<BTreeDatabase::LeafNode> BTreeDatabase::cachedLeaf(BlockIndex blockIndex) const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  if (m_leafCacheMaxSize == 0)
+    return {};
+
+  if (auto cached = m_leafCache.ptr(blockIndex)) {
+    ++s_leafCacheHits;
+    return cached->leaf;
+  }
+
+  lock.unlock();
+  ++s_leafCacheMisses;
+  reportLeafCacheStats();
+  return {};
+}
+
+void BTreeDatabase::cacheLeaf(shared_ptr<LeafNode> const& leaf) const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  if (m_leafCacheMaxSize == 0)
+    return;
+
+  size_t size = leafSize(leaf);
+  if (auto cached = m_leafCache.ptr(leaf->self))
+    m_leafCacheSize -= cached->size;
+  if (size > m_leafCacheMaxSize) {
+    m_leafCache.remove(leaf->self);
+    return;
+  }
+
+  trimLeafCache(m_leafCacheMaxSize - size);
+  m_leafCache.set(leaf->self, CachedLeaf{leaf, size});
+  m_leafCacheSize += size;
+}
+
+void BTreeDatabase::uncacheLeaf(BlockIndex blockIndex) const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  if (auto cached = m_leafCache.ptr(blockIndex)) {
+    m_leafCacheSize -= cached->size;
+    m_leafCache.remove(blockIndex);
+  }
+}
+
+void BTreeDatabase::clearLeafCache() const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  m_leafCache.clear();
+  m_leafCacheSize = 0;
+}
+
+void BTreeDatabase::trimLeafCache(size_t maxSize) const {
+  while (m_leafCacheSize > maxSize) {
+    auto evicted = m_leafCache.takeLeastRecent();
+    if (!evicted)
+      break;
+    m_leafCacheSize -= evicted->second.size;
+    ++s_leafCacheEvictions;
+  }
+}
+
+void BTreeDatabase::reportLeafCacheStats() {
+  int64_t now = Time::monotonicMilliseconds();
+  int64_t lastReport = s_leafCacheLastReport;
+  if (now - lastReport < 1000 || !s_leafCacheLastReport.compare_exchange_strong(lastReport, now))
+    return;
+
+  uint64_t hits = s_leafCacheHits;
+  uint64_t misses = s_leafCacheMisses;
+  uint64_t evictions = s_leafCacheEvictions;
+  LogMap::set("btree_leaf_cache", strf("{:.1f}% hit rate ({} hits, {} misses), {} evictions",
+      hits + misses ? 100.0 * hits / (hits + misses) : 0.0, hits, misses, evictions));
+  Metrics::setCounter("starbound_btree_leaf_cache_hits_total", {}, hits);
+  Metrics::setCounter("starbound_btree_leaf_cache_misses_total", {}, misses);
+  Metrics::setCounter("starbound_btree_leaf_cache_evictions_total", {}, evictions);
+}
+
 void BTreeDatabase::freeBlock(BlockIndex b) {
-  if (m_uncommitted.contains(b))
-    m_uncommitted.remove(b);
+  uncacheLeaf(b);
   if (m_uncommittedWrites.contains(b))
     m_uncommittedWrites.remove(b);
 
+  if (m_uncommitted.contains(b)) {
+    m_uncommitted.remove(b);
+  } else if (m_compacting) {
+    m_compactedBlocks.add(b);
+    return;
+  }
+
   m_availableBlocks.add(b);
 }
 
@@ -1062,6 +1584,78 @@ void BTreeDatabase::writeRoot() {
   m_device->sync();
 }
 
+void BTreeDatabase::updateMapping() {
+  auto file = as<File>(m_device);
+  if (!m_open || !m_memoryMapped || !file || !file->isOpen()) {
+    m_mapping.reset();
+    return;
+  }
+
+  if (m_mapping && m_mapping->size() == (size_t)m_deviceSize)
+    return;
+
+  m_mapping.reset();
+  try {
+    m_mapping = file->mapReadOnly(m_deviceSize);
+  } catch (IOException const& e) {
+    Logger::warn("[BTreeDatabase] Could not memory map '{}', falling back to device reads: {}", m_device->deviceName(), outputException(e, false));
+    m_memoryMapped = false;
+  }
+}
+
+void BTreeDatabase::rebuildBloomFilter() {
+  List<uint64_t> hashes;
+  m_impl.forAll([&](ByteArray const& k, ByteArray const&) {
+      hashes.append(xxHash3(k));
+    });
+
+  // Sized for twice the current key count so that inserts don't immediately
+  // trigger another scan.
+  size_t words = 1;
+  while (words * 64 < max<size_t>(hashes.size(), 1024) * 2 * BloomFilterBitsPerKey)
+    words *= 2;
+
+  m_bloomFilterBits = List<uint64_t>(words, 0);
+  m_bloomFilterKeys = 0;
+  for (auto hash : hashes)
+    bloomFilterAddHash(hash);
+}
+
+void BTreeDatabase::bloomFilterAdd(ByteArray const& k) {
+  if (m_bloomFilterBits.empty())
+    return;
+
+  if ((m_bloomFilterKeys + 1) * BloomFilterBitsPerKey > m_bloomFilterBits.size() * 64)
+    rebuildBloomFilter();
+  bloomFilterAddHash(xxHash3(k));
+}
+
+void BTreeDatabase::bloomFilterAddHash(uint64_t hash) {
+  // Double hashing, the step is forced odd so that every probe is distinct
+  uint64_t mask = m_bloomFilterBits.size() * 64 - 1;
+  uint64_t step = (hash >> 32) | 1;
+  for (uint32_t i = 0; i < BloomFilterHashCount; ++i) {
+    uint64_t bit = (hash + i * step) & mask;
+    m_bloomFilterBits[bit / 64] |= (uint64_t)1 << (bit % 64);
+  }
+  ++m_bloomFilterKeys;
+}
+
+bool BTreeDatabase::bloomFilterMayContain(ByteArray const& k) const {
+  if (m_bloomFilterBits.empty())
+    return true;
+
+  uint64_t hash = xxHash3(k);
+  uint64_t mask = m_bloomFilterBits.size() * 64 - 1;
+  uint64_t step = (hash >> 32) | 1;
+  for (uint32_t i = 0; i < BloomFilterHashCount; ++i) {
+    uint64_t bit = (hash + i * step) & mask;
+    if (!(m_bloomFilterBits[bit / 64] & ((uint64_t)1 << (bit % 64))))
+      return false;
+  }
+  return true;
+}
+
 void BTreeDatabase::readRoot() {
   DataStreamIODevice ds(m_device);
   ds.seek(BTreeRootSelectorBit);
@@ -1125,6 +1719,7 @@ void BTreeDatabase::doCommit() {
   commitWrites(); 
   writeRoot();
   m_uncommitted.clear();
+  updateMapping();
 }
 
 void BTreeDatabase::commitWrites() {
@@ -1181,12 +1776,15 @@ bool BTreeDatabase::tryFlatten() {
   }
 
   m_availableBlocks.clear();
+  m_mapping.reset();
   m_device->resize(m_deviceSize = HeaderSize + (StreamOffset)m_blockSize * count);
 
   m_indexCache.clear();
+  clearLeafCache();
   commitWrites();
   writeRoot();
   m_uncommitted.clear();
+  updateMapping();
 
   Logger::info("[BTreeDatabase] Finished flattening '{}' in {:.2f} milliseconds", m_device->deviceName(), (Time::monotonicTime() - start) * 1000.f);
   return true;
@@ -1237,6 +1835,39 @@ bool BTreeDatabase::flattenVisitor(BTreeImpl::Index& index, BlockIndex& count) {
   return needsStore || (canStore && m_availableBlocks.first() < index->self);
 }
 
+bool BTreeDatabase::compactVisitor(BTreeImpl::Index& index, BlockIndex end, uint32_t& budget) {
+  bool needsStore = false;
+  for (size_t i = 0; budget != 0 && i != index->pointerCount(); ++i) {
+    if (m_impl.indexLevel(index) == 0) {
+      auto leafPointer = index->pointer(i);
+      auto tailBlocks = leafTailBlocks(leafPointer);
+      if (leafPointer < end && !any(tailBlocks, [&](BlockIndex b) { return b >= end; }))
+        continue;
+      // Stop once the blocks below the end would run out, otherwise the copied
+      // path would just be written past the end again.
+      if (m_availableBlocks.size() < 1 + tailBlocks.size() + MaxCompactionDepth)
+        break;
+
+      auto leaf = m_impl.loadLeaf(leafPointer);
+      m_impl.deleteLeaf(leaf);
+      leaf->self = InvalidBlockIndex;
+      index->updatePointer(i, m_impl.storeLeaf(leaf));
+      budget -= min<uint32_t>(budget, 1 + tailBlocks.size());
+      needsStore = true;
+    } else {
+      auto childIndex = m_impl.loadIndex(index->pointer(i));
+      if (compactVisitor(childIndex, end, budget)) {
+        m_impl.deleteIndex(childIndex);
+        childIndex->self = InvalidBlockIndex;
+        index->updatePointer(i, m_impl.storeIndex(childIndex));
+        budget -= min<uint32_t>(budget, 1);
+        needsStore = true;
+      }
+    }
+  }
+  return needsStore || (index->self >= end && !m_availableBlocks.empty());
+}
+
 void BTreeDatabase::checkIfOpen(char const* methodName, bool shouldBeOpen) const {
   if (shouldBeOpen && !m_open)
     throw DBException::format("BTreeDatabase method '{}' called when not open, must be open.", methodName);
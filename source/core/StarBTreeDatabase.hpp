@@ -5,6 +5,8 @@
 #include "StarLruCache.hpp"
 #include "StarDataStreamDevices.hpp"
 #include "StarThread.hpp"
+#include "StarFile.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -14,6 +16,25 @@ class BTreeDatabase {
 public:
   uint32_t const ContentIdentifierStringSize = 16;
 
+  // A set of inserts and removes to be applied together by writeBatch.  A
+  // later operation on the same key replaces an earlier one.
+  class WriteBatch {
+  public:
+    void insert(ByteArray key, ByteArray data);
+    void remove(ByteArray key);
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+  private:
+    friend class BTreeDatabase;
+
+    Map<ByteArray, Maybe<ByteArray>> m_operations;
+  };
+
+  class Cursor;
+
   BTreeDatabase();
   BTreeDatabase(String const& contentIdentifier, size_t keySize);
   ~BTreeDatabase();
@@ -41,11 +62,32 @@ public:
   uint32_t indexCacheSize() const;
   void setIndexCacheSize(uint32_t indexCacheSize);
 
+  // Cache size in bytes for leaf nodes, measured by their serialized size.
+  // Defaults to 0, which disables the leaf cache.  Hits, misses and evictions
+  // across all databases are reported to the LogMap as 'btree_leaf_cache'.
+  size_t leafCacheSize() const;
+  void setLeafCacheSize(size_t leafCacheSize);
+
   // If true, very write operation will immediately result in a commit.
   // Defaults to true.
   bool autoCommit() const;
   void setAutoCommit(bool autoCommit);
 
+  // If true and the IODevice is a File, committed blocks are read straight
+  // out of a read-only memory mapping of the file rather than copied through
+  // the device.  Defaults to false.
+  bool memoryMapped() const;
+  void setMemoryMapped(bool memoryMapped);
+
+  // If true, keeps an in memory Bloom filter of every key so that contains
+  // and find on missing keys can usually return without walking the index.
+  // The filter is built by scanning every leaf when the database is opened
+  // (or when enabled while open), and is grown by another scan once inserts
+  // fill it.  Removed keys stay in the filter until the next rebuild.
+  // Defaults to false.
+  bool bloomFilter() const;
+  void setBloomFilter(bool bloomFilter);
+
   IODevicePtr ioDevice() const;
   void setIODevice(IODevicePtr device);
 
@@ -64,7 +106,17 @@ public:
 
   void forEach(ByteArray const& lower, ByteArray const& upper, function<void(ByteArray, ByteArray)> v);
   void forAll(function<void(ByteArray, ByteArray)> v);
-  void recoverAll(function<void(ByteArray, ByteArray)> v, function<void(String const&, std::exception const&)> e);
+
+  // Pull style alternatives to forEach and forAll, see Cursor.  If prefetch is
+  // true, the cursor loads the following leaf on a worker thread while the
+  // records of the current one are being read.
+  Cursor scan(ByteArray const& lower, ByteArray const& upper, bool prefetch = false);
+  Cursor scanAll(bool prefetch = false);
+  // Visits every record that can still be read, reporting unreadable nodes
+  // to e rather than throwing.  With a threadCount above 1, leaves are loaded
+  // and parsed on a WorkerPool of that many threads, records are still
+  // visited in key order on the calling thread.
+  void recoverAll(function<void(ByteArray, ByteArray)> v, function<void(String const&, std::exception const&)> e, unsigned threadCount = 1);
 
   // Returns true if a value was overwritten
   bool insert(ByteArray const& k, ByteArray const& data);
@@ -72,6 +124,12 @@ public:
   // Returns true if the element was found and removed
   bool remove(ByteArray const& k);
 
+  // Applies every operation in the batch in key order under a single write
+  // lock, so that consecutive keys reuse the same uncommitted leaf and index
+  // blocks.  If autoCommit is set, commits once at the end rather than on
+  // every changed root.  All keys are checked before anything is applied.
+  void writeBatch(WriteBatch batch);
+
   // Remove all elements in the given range, returns keys removed.
   List<ByteArray> remove(ByteArray const& lower, ByteArray const& upper);
 
@@ -88,6 +146,15 @@ public:
   void commit();
   void rollback();
 
+  // Incrementally compacts the database by relocating up to blockBudget
+  // blocks of live nodes from the end of the device into free blocks nearer
+  // the front, then truncating whatever free space is left at the end.
+  // Pending changes are committed first, and the result is committed through
+  // the alternate root like any other change, so no block referenced by the
+  // previous root is overwritten.  Returns the number of blocks relocated.
+  // Does nothing on a read only device.
+  uint32_t compact(uint32_t blockBudget);
+
   void close(bool closeDevice = false);
 
 private:
@@ -106,6 +173,12 @@ private:
   static size_t const BTreeRootSelectorBit = 32;
   static size_t const BTreeRootInfoStart = 33;
   static size_t const BTreeRootInfoSize = 17;
+  // Leaves handed to each worker by a parallel recoverAll
+  static size_t const RecoveryLeavesPerTask = 64;
+  static uint32_t const BloomFilterBitsPerKey = 10;
+  static uint32_t const BloomFilterHashCount = 7;
+  // Free blocks compaction keeps back for copying the path to a relocated leaf
+  static size_t const MaxCompactionDepth = 16;
 
   struct FreeIndexBlock {
     BlockIndex nextFreeBlock;
@@ -228,6 +301,9 @@ private:
   void readBlock(BlockIndex blockIndex, size_t blockOffset, char* block, size_t size) const;
   ByteArray readBlock(BlockIndex blockIndex) const;
   void updateBlock(BlockIndex blockIndex, ByteArray const& block);
+  // Returns the committed block straight from the mapping if possible,
+  // otherwise reads the block into the given buffer and returns that.
+  char const* blockData(BlockIndex blockIndex, ByteArray& buffer) const;
 
   void rawReadBlock(BlockIndex blockIndex, size_t blockOffset, char* block, size_t size) const;
   void rawWriteBlock(BlockIndex blockIndex, size_t blockOffset, char const* block, size_t size);
@@ -243,10 +319,28 @@ private:
   uint32_t dataSize(ByteArray const& d) const;
   List<BlockIndex> leafTailBlocks(BlockIndex leafPointer);
 
+  // Looks up a leaf in the leaf cache, counting the hit or miss.
+  shared_ptr<LeafNode> cachedLeaf(BlockIndex blockIndex) const;
+  void cacheLeaf(shared_ptr<LeafNode> const& leaf) const;
+  void uncacheLeaf(BlockIndex blockIndex) const;
+  void clearLeafCache() const;
+  // Must be called while holding m_leafCacheSpinLock
+  void trimLeafCache(size_t maxSize) const;
+  static void reportLeafCacheStats();
+
   void freeBlock(BlockIndex b);
   BlockIndex reserveBlock();
   BlockIndex makeEndBlock();
 
+  // Maps the committed portion of the device, or drops the mapping if memory
+  // mapping is disabled or unavailable.
+  void updateMapping();
+
+  void rebuildBloomFilter();
+  void bloomFilterAdd(ByteArray const& k);
+  void bloomFilterAddHash(uint64_t hash);
+  bool bloomFilterMayContain(ByteArray const& k) const;
+
   void dirty();
   void writeRoot();
   void readRoot();
@@ -254,6 +348,10 @@ private:
   void commitWrites();
   bool tryFlatten();
   bool flattenVisitor(BTreeImpl::Index& index, BlockIndex& count);
+  void doRollback();
+  // Moves nodes with any block at or past 'end' into available blocks,
+  // returns true if the given index itself needs to be stored.
+  bool compactVisitor(BTreeImpl::Index& index, BlockIndex end, uint32_t& budget);
 
   void checkIfOpen(char const* methodName, bool shouldBeOpen) const;
   void checkBlockIndex(size_t blockIndex) const;
@@ -272,6 +370,10 @@ private:
   uint32_t m_keySize;
 
   bool m_autoCommit;
+  bool m_memoryMapped;
+
+  // Must be reset before the device is shrunk.
+  FileMappingPtr m_mapping;
 
   // Reading values can mutate the index cache, so the index cache is kept
   // using a different lock.  It is only necessary to acquire this lock when
@@ -280,6 +382,30 @@ private:
   mutable SpinLock m_indexCacheSpinLock;
   LruCache<BlockIndex, shared_ptr<IndexNode>> m_indexCache;
 
+  // The leaf cache follows the same locking rules as the index cache.  Leaves
+  // are updated in place before being stored, so each entry records the byte
+  // size it was accounted with.
+  struct CachedLeaf {
+    shared_ptr<LeafNode> leaf;
+    size_t size;
+  };
+
+  mutable SpinLock m_leafCacheSpinLock;
+  mutable HashLruCache<BlockIndex, CachedLeaf> m_leafCache;
+  size_t m_leafCacheMaxSize;
+  mutable size_t m_leafCacheSize;
+
+  static atomic<uint64_t> s_leafCacheHits;
+  static atomic<uint64_t> s_leafCacheMisses;
+  static atomic<uint64_t> s_leafCacheEvictions;
+  static atomic<int64_t> s_leafCacheLastReport;
+
+  // Bit array for the Bloom filter, a power of two in size, and the number of
+  // keys added to it since it was last built.
+  bool m_bloomFilter;
+  List<uint64_t> m_bloomFilterBits;
+  uint64_t m_bloomFilterKeys;
+
   BlockIndex m_headFreeIndexBlock;
   StreamOffset m_deviceSize;
   BlockIndex m_root;
@@ -294,10 +420,56 @@ private:
   // Blocks that have been written in uncommitted portions of the tree.
   Set<BlockIndex> m_uncommitted;
 
+  // While compacting, committed blocks that are freed are held here rather
+  // than made available, so they are not overwritten before the new root is
+  // written.
+  bool m_compacting;
+  Set<BlockIndex> m_compactedBlocks;
+
   // Temporarily holds written data so that it can be rolled back.
   mutable Map<BlockIndex, ByteArray> m_uncommittedWrites;
 };
 
+// Steps through the records of a BTreeDatabase in key order.  The key and
+// value references point into the current leaf and stay valid only until the
+// next call to next().  A cursor holds the database read lock for as long as
+// it exists, so no writes may be made from the same thread until it is
+// destroyed.
+class BTreeDatabase::Cursor {
+public:
+  Cursor(Cursor&& cursor);
+  ~Cursor();
+
+  Cursor(Cursor const&) = delete;
+  Cursor& operator=(Cursor const&) = delete;
+  Cursor& operator=(Cursor&&) = delete;
+
+  // Moves to the first record on the first call, and to the following record
+  // afterwards.  Returns false once past the end of the range.
+  bool next();
+
+  ByteArray const& key() const;
+  ByteArray const& value() const;
+
+private:
+  friend class BTreeDatabase;
+
+  Cursor(BTreeDatabase* database, ByteArray const& lower, Maybe<ByteArray> upper, bool prefetch);
+
+  void startPrefetch();
+
+  BTreeDatabase* m_database;
+  Maybe<ByteArray> m_upper;
+  BTreeMixin<BTreeImpl>::LeafPath m_path;
+  BTreeImpl::Leaf m_leaf;
+  size_t m_position;
+  bool m_started;
+
+  unique_ptr<WorkerPool> m_prefetchPool;
+  BlockIndex m_prefetchPointer;
+  Maybe<WorkerPoolPromise<BTreeImpl::Leaf>> m_prefetchLeaf;
+};
+
 // Version of BTreeDatabase that hashes keys with SHA-256 to produce a unique
 // constant size key.
 class BTreeSha256Database : private BTreeDatabase {
@@ -325,8 +497,14 @@ public:
   using BTreeDatabase::setContentIdentifier;
   using BTreeDatabase::indexCacheSize;
   using BTreeDatabase::setIndexCacheSize;
+  using BTreeDatabase::leafCacheSize;
+  using BTreeDatabase::setLeafCacheSize;
   using BTreeDatabase::autoCommit;
   using BTreeDatabase::setAutoCommit;
+  using BTreeDatabase::memoryMapped;
+  using BTreeDatabase::setMemoryMapped;
+  using BTreeDatabase::bloomFilter;
+  using BTreeDatabase::setBloomFilter;
   using BTreeDatabase::ioDevice;
   using BTreeDatabase::setIODevice;
   using BTreeDatabase::open;
@@ -339,6 +517,7 @@ public:
   using BTreeDatabase::leafBlockCount;
   using BTreeDatabase::commit;
   using BTreeDatabase::rollback;
+  using BTreeDatabase::compact;
   using BTreeDatabase::close;
 };
 
@@ -0,0 +1,234 @@
+#include "StarCompactJson.hpp"
+#include "StarDataStreamDevices.hpp"
+
+namespace Star {
+
+namespace {
+  uint8_t const CompactJsonVersion = 1;
+
+  enum class CompactTag : uint8_t {
+    Null = 0,
+    False = 1,
+    True = 2,
+    Int = 3,
+    Double = 4,
+    Float = 5,
+    String = 6,
+    Array = 7,
+    Object = 8,
+    IntArray = 9,
+    DoubleArray = 10,
+    FloatArray = 11
+  };
+
+  bool floatExact(double d) {
+    return (double)(float)d == d;
+  }
+
+  struct CompactJsonWriter {
+    void collectKeys(Json const& json) {
+      if (json.type() == Json::Type::Array) {
+        for (auto const& v : json.toArray())
+          collectKeys(v);
+      } else if (json.type() == Json::Type::Object) {
+        for (auto const& p : json.toObject()) {
+          if (!keyIndexes.contains(p.first)) {
+            keyIndexes.add(p.first, keys.size());
+            keys.append(p.first);
+          }
+          collectKeys(p.second);
+        }
+      }
+    }
+
+    void writeArray(DataStream& ds, JsonArray const& array) {
+      bool allInts = !array.empty();
+      bool allFloats = !array.empty();
+      bool allExact = true;
+      for (auto const& v : array) {
+        allInts = allInts && v.type() == Json::Type::Int;
+        allFloats = allFloats && v.type() == Json::Type::Float;
+        if (!allInts && !allFloats)
+          break;
+        if (allFloats)
+          allExact = allExact && floatExact(v.toDouble());
+      }
+
+      if (allInts) {
+        ds.write(CompactTag::IntArray);
+        ds.writeVlqU(array.size());
+        for (auto const& v : array)
+          ds.writeVlqI(v.toInt());
+      } else if (allFloats && allExact) {
+        ds.write(CompactTag::FloatArray);
+        ds.writeVlqU(array.size());
+        for (auto const& v : array)
+          ds.write<float>(v.toDouble());
+      } else if (allFloats) {
+        ds.write(CompactTag::DoubleArray);
+        ds.writeVlqU(array.size());
+        for (auto const& v : array)
+          ds.write<double>(v.toDouble());
+      } else {
+        ds.write(CompactTag::Array);
+        ds.writeVlqU(array.size());
+        for (auto const& v : array)
+          write(ds, v);
+      }
+    }
+
+    void write(DataStream& ds, Json const& json) {
+      switch (json.type()) {
+        case Json::Type::Null:
+          ds.write(CompactTag::Null);
+          break;
+        case Json::Type::Bool:
+          ds.write(json.toBool() ? CompactTag::True : CompactTag::False);
+          break;
+        case Json::Type::Int:
+          ds.write(CompactTag::Int);
+          ds.writeVlqI(json.toInt());
+          break;
+        case Json::Type::Float:
+          if (floatExact(json.toDouble())) {
+            ds.write(CompactTag::Float);
+            ds.write<float>(json.toDouble());
+          } else {
+            ds.write(CompactTag::Double);
+            ds.write<double>(json.toDouble());
+          }
+          break;
+        case Json::Type::String:
+          ds.write(CompactTag::String);
+          ds.write(*json.stringPtr());
+          break;
+        case Json::Type::Array:
+          writeArray(ds, json.toArray());
+          break;
+        case Json::Type::Object: {
+          auto const& object = json.toObject();
+          ds.write(CompactTag::Object);
+          ds.writeVlqU(object.size());
+          for (auto const& p : object) {
+            ds.writeVlqU(keyIndexes.get(p.first));
+            write(ds, p.second);
+          }
+          break;
+        }
+      }
+    }
+
+    StringMap<size_t> keyIndexes;
+    StringList keys;
+  };
+
+  struct CompactJsonReader {
+    Json read(DataStream& ds) {
+      auto tag = ds.read<CompactTag>();
+      switch (tag) {
+        case CompactTag::Null:
+          return Json();
+        case CompactTag::False:
+          return Json(false);
+        case CompactTag::True:
+          return Json(true);
+        case CompactTag::Int:
+          return Json(ds.readVlqI());
+        case CompactTag::Double:
+          return Json(ds.read<double>());
+        case CompactTag::Float:
+          return Json((double)ds.read<float>());
+        case CompactTag::String:
+          return Json(ds.read<String>());
+        case CompactTag::Array: {
+          size_t size = ds.readVlqU();
+          JsonArray array;
+          array.reserve(size);
+          for (size_t i = 0; i < size; ++i)
+            array.append(read(ds));
+          return array;
+        }
+        case CompactTag::Object: {
+          size_t size = ds.readVlqU();
+          JsonObject object;
+          for (size_t i = 0; i < size; ++i) {
+            size_t keyIndex = ds.readVlqU();
+            if (keyIndex >= keys.size())
+              throw JsonException::format("Compact Json key index {} out of range", keyIndex);
+            object[keys[keyIndex]] = read(ds);
+          }
+          return object;
+        }
+        case CompactTag::IntArray: {
+          size_t size = ds.readVlqU();
+          JsonArray array;
+          array.reserve(size);
+          for (size_t i = 0; i < size; ++i)
+            array.append(Json(ds.readVlqI()));
+          return array;
+        }
+        case CompactTag::DoubleArray: {
+          size_t size = ds.readVlqU();
+          JsonArray array;
+          array.reserve(size);
+          for (size_t i = 0; i < size; ++i)
+            array.append(Json(ds.read<double>()));
+          return array;
+        }
+        case CompactTag::FloatArray: {
+          size_t size = ds.readVlqU();
+          JsonArray array;
+          array.reserve(size);
+          for (size_t i = 0; i < size; ++i)
+            array.append(Json((double)ds.read<float>()));
+          return array;
+        }
+      }
+      throw JsonException::format("Unknown compact Json tag {}", (unsigned)tag);
+    }
+
+    StringList keys;
+  };
+}
+
+ByteArray compactJsonEncode(Json const& json) {
+  CompactJsonWriter writer;
+  writer.collectKeys(json);
+
+  DataStreamBuffer ds;
+  ds.write(CompactJsonVersion);
+  ds.writeVlqU(writer.keys.size());
+  for (auto const& key : writer.keys)
+    ds.write(key);
+  writer.write(ds, json);
+  return ds.takeData();
+}
+
+Json compactJsonDecode(char const* data, size_t size) {
+  DataStreamExternalBuffer ds(data, size);
+  auto version = ds.read<uint8_t>();
+  if (version != CompactJsonVersion)
+    throw JsonException::format("Unsupported compact Json version {}", version);
+
+  CompactJsonReader reader;
+  size_t keyCount = ds.readVlqU();
+  reader.keys.reserve(keyCount);
+  for (size_t i = 0; i < keyCount; ++i)
+    reader.keys.append(ds.read<String>());
+  return reader.read(ds);
+}
+
+Json compactJsonDecode(ByteArray const& data) {
+  return compactJsonDecode(data.ptr(), data.size());
+}
+
+void writeCompactJson(DataStream& ds, Json const& json) {
+  ds.write(CompactJsonStreamTag);
+  ds.write(compactJsonEncode(json));
+}
+
+Json readCompactJson(DataStream& ds) {
+  return compactJsonDecode(ds.read<ByteArray>());
+}
+
+}
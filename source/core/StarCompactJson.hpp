@@ -0,0 +1,27 @@
+#pragma once
+
+#include "StarJson.hpp"
+
+namespace Star {
+
+// Schema-less binary encoding of Json meant for storage.  Every object key is
+// written once in a table at the front and afterwards referenced by index,
+// integers and lengths are VLQ encoded, and arrays holding only ints or only
+// floats are packed without per element type tags (as 32 bit floats when that
+// is lossless).  Decoding reproduces the exact same Json, including the
+// distinction between int and float values.
+ByteArray compactJsonEncode(Json const& json);
+Json compactJsonDecode(char const* data, size_t size);
+Json compactJsonDecode(ByteArray const& data);
+
+// Never a valid type tag in the regular Json DataStream serialization, marks
+// a length prefixed compact encoding in its place.  The regular Json
+// operator>> understands this, so anything read with it also reads Json
+// written by writeCompactJson.
+uint8_t const CompactJsonStreamTag = 0x40;
+
+void writeCompactJson(DataStream& ds, Json const& json);
+// Reads the encoding that follows a CompactJsonStreamTag
+Json readCompactJson(DataStream& ds);
+
+}
@@ -6,7 +6,7 @@
 
 namespace Star {
 
-unsigned const CurrentStreamVersion = 14; // update OpenProtocolVersion too!
+unsigned const CurrentStreamVersion = 21; // update OpenProtocolVersion too!
 
 DataStream::DataStream()
   : m_byteOrder(ByteOrder::BigEndian),
@@ -191,11 +191,17 @@ DataStream& DataStream::operator>>(double& d) {
 }
 
 size_t DataStream::writeVlqU(uint64_t i) {
-  return Star::writeVlqU(i, makeFunctionOutputIterator([this](uint8_t b) { *this << b; }));
+  char buffer[10];
+  size_t size = Star::writeVlqU(i, buffer);
+  writeData(buffer, size);
+  return size;
 }
 
 size_t DataStream::writeVlqI(int64_t i) {
-  return Star::writeVlqI(i, makeFunctionOutputIterator([this](uint8_t b) { *this << b; }));
+  char buffer[10];
+  size_t size = Star::writeVlqI(i, buffer);
+  writeData(buffer, size);
+  return size;
 }
 
 size_t DataStream::writeVlqS(size_t i) {
@@ -304,6 +310,53 @@ DataStream& DataStream::operator>>(String& s) {
   return *this;
 }
 
+// Swaps the byte order of each of count scalars, with the scalar size known
+// at compile time so that each swap compiles down to a single instruction.
+template <size_t ScalarSize>
+static void swapScalars(char* dest, char const* src, size_t count) {
+  if (dest == src) {
+    for (size_t i = 0; i < count; ++i)
+      swapByteOrder(dest + i * ScalarSize, ScalarSize);
+  } else {
+    for (size_t i = 0; i < count; ++i)
+      swapByteOrder(dest + i * ScalarSize, src + i * ScalarSize, ScalarSize);
+  }
+}
+
+static void swapScalars(char* dest, char const* src, size_t count, size_t scalarSize) {
+  if (scalarSize == 2)
+    swapScalars<2>(dest, src, count);
+  else if (scalarSize == 4)
+    swapScalars<4>(dest, src, count);
+  else if (scalarSize == 8)
+    swapScalars<8>(dest, src, count);
+  else if (scalarSize != 1)
+    throw DataStreamException::format("Cannot swap byte order of {} byte values", scalarSize);
+}
+
+void DataStream::readBulkData(char* data, size_t scalarCount, size_t scalarSize) {
+  readData(data, scalarCount * scalarSize);
+  if (scalarSize > 1 && m_byteOrder != ByteOrder::NoConversion && m_byteOrder != platformByteOrder())
+    swapScalars(data, data, scalarCount, scalarSize);
+}
+
+void DataStream::writeBulkData(char const* data, size_t scalarCount, size_t scalarSize) {
+  if (scalarSize == 1 || m_byteOrder == ByteOrder::NoConversion || m_byteOrder == platformByteOrder()) {
+    writeData(data, scalarCount * scalarSize);
+    return;
+  }
+
+  char buffer[4096];
+  size_t bufferScalars = sizeof(buffer) / scalarSize;
+  while (scalarCount != 0) {
+    size_t count = min(scalarCount, bufferScalars);
+    swapScalars(buffer, data, count, scalarSize);
+    writeData(buffer, count * scalarSize);
+    data += count * scalarSize;
+    scalarCount -= count;
+  }
+}
+
 void DataStream::writeStringData(char const* data, size_t len) {
   if (m_nullTerminatedStrings) {
     writeData(data, len);
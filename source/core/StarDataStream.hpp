@@ -8,6 +8,37 @@ namespace Star {
 STAR_EXCEPTION(DataStreamException, IOException);
 extern unsigned const CurrentStreamVersion;
 
+template <typename ElementT, size_t SizeN>
+class Array;
+
+template <typename T, size_t N>
+class Vector;
+
+// Types whose DataStream encoding is nothing but their bytes, made of Scalar
+// values each in the stream's byte order.  Contiguous runs of them can be
+// read and written in bulk rather than an element at a time.
+template <typename T>
+struct DataStreamBulkType {
+  typedef T Scalar;
+  static bool const value = ((std::is_integral<T>::value && !std::is_same<T, bool>::value) || std::is_same<T, float>::value || std::is_same<T, double>::value)
+      && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+};
+
+template <typename ElementT, size_t SizeN>
+struct DataStreamBulkType<Array<ElementT, SizeN>> : DataStreamBulkType<ElementT> {};
+
+template <typename T, size_t N>
+struct DataStreamBulkType<Vector<T, N>> : DataStreamBulkType<T> {};
+
+// Lists and vectors of DataStreamBulkType elements
+template <typename Container, typename = void>
+struct DataStreamBulkContainer : std::false_type {};
+
+template <typename Container>
+struct DataStreamBulkContainer<Container, typename std::enable_if<
+    std::is_base_of<std::vector<typename Container::value_type, typename Container::allocator_type>, Container>::value
+    && DataStreamBulkType<typename Container::value_type>::value>::type> : std::true_type {};
+
 // Writes complex types to bytes in a portable big-endian fashion.
 class DataStream {
 public:
@@ -151,6 +182,15 @@ public:
   template <typename FloatType>
   void vfwrite(FloatType const& data, FloatType base);
 
+  // Reads / writes the same as each element in turn, but as a single read or
+  // write unless the byte order of each element has to be swapped.
+
+  template <typename T>
+  void readBulk(T* data, size_t count);
+
+  template <typename T>
+  void writeBulk(T const* data, size_t count);
+
   // Read a shared / unique ptr, and store whether the pointer is initialized.
 
   template <typename PointerType, typename ReadFunction>
@@ -196,6 +236,19 @@ public:
 private:
   void writeStringData(char const* data, size_t len);
 
+  void readBulkData(char* data, size_t scalarCount, size_t scalarSize);
+  void writeBulkData(char const* data, size_t scalarCount, size_t scalarSize);
+
+  template <typename Container>
+  void writeContainerImpl(Container const& container, std::true_type bulk);
+  template <typename Container>
+  void writeContainerImpl(Container const& container, std::false_type bulk);
+
+  template <typename Container>
+  void readContainerImpl(Container& container, std::true_type bulk);
+  template <typename Container>
+  void readContainerImpl(Container& container, std::false_type bulk);
+
   ByteOrder m_byteOrder;
   bool m_nullTerminatedStrings;
   unsigned m_streamCompatibilityVersion;
@@ -289,6 +342,20 @@ void DataStream::vfwrite(FloatType const& data, FloatType base) {
   writeVlqI((int64_t)round(data / base));
 }
 
+template <typename T>
+void DataStream::readBulk(T* data, size_t count) {
+  typedef typename DataStreamBulkType<T>::Scalar Scalar;
+  static_assert(DataStreamBulkType<T>::value && sizeof(T) % sizeof(Scalar) == 0, "readBulk of a type that is not a DataStreamBulkType");
+  readBulkData((char*)data, count * (sizeof(T) / sizeof(Scalar)), sizeof(Scalar));
+}
+
+template <typename T>
+void DataStream::writeBulk(T const* data, size_t count) {
+  typedef typename DataStreamBulkType<T>::Scalar Scalar;
+  static_assert(DataStreamBulkType<T>::value && sizeof(T) % sizeof(Scalar) == 0, "writeBulk of a type that is not a DataStreamBulkType");
+  writeBulkData((char const*)data, count * (sizeof(T) / sizeof(Scalar)), sizeof(Scalar));
+}
+
 template <typename PointerType, typename ReadFunction>
 void DataStream::pread(PointerType& pointer, ReadFunction readFunction) {
   bool initialized = read<bool>();
@@ -364,11 +431,43 @@ void DataStream::readMapContainer(Container& map, ReadFunction function) {
 
 template <typename Container>
 void DataStream::writeContainer(Container const& container) {
-  writeContainer(container, [](DataStream& ds, typename Container::value_type const& element) { ds << element; });
+  writeContainerImpl(container, std::integral_constant<bool, DataStreamBulkContainer<Container>::value>());
 }
 
 template <typename Container>
 void DataStream::readContainer(Container& container) {
+  readContainerImpl(container, std::integral_constant<bool, DataStreamBulkContainer<Container>::value>());
+}
+
+template <typename Container>
+void DataStream::writeContainerImpl(Container const& container, std::true_type) {
+  writeVlqU(container.size());
+  writeBulk(container.data(), container.size());
+}
+
+template <typename Container>
+void DataStream::writeContainerImpl(Container const& container, std::false_type) {
+  writeContainer(container, [](DataStream& ds, typename Container::value_type const& element) { ds << element; });
+}
+
+template <typename Container>
+void DataStream::readContainerImpl(Container& container, std::true_type) {
+  // Grows as the data is read, so that a corrupt size runs out of data
+  // rather than allocating the whole of it up front
+  size_t const ChunkSize = max<size_t>(65536 / sizeof(typename Container::value_type), 1);
+
+  container.clear();
+  size_t size = readVlqU();
+  while (container.size() < size) {
+    size_t start = container.size();
+    size_t count = min(size - start, ChunkSize);
+    container.resize(start + count);
+    readBulk(container.data() + start, count);
+  }
+}
+
+template <typename Container>
+void DataStream::readContainerImpl(Container& container, std::false_type) {
   readContainer(container, [](DataStream& ds, typename Container::value_type& element) { ds >> element; });
 }
 
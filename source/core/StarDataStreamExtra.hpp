@@ -54,29 +54,47 @@ DataStream& operator>>(DataStream& ds, Array<ElementT, SizeN>& array) {
 }
 
 template <typename ElementT, size_t RankN>
-DataStream& operator<<(DataStream& ds, MultiArray<ElementT, RankN> const& array) {
-  auto size = array.size();
-  for (size_t i = 0; i < RankN; ++i)
-    ds.writeVlqU(size[i]);
+void writeMultiArrayElements(DataStream& ds, MultiArray<ElementT, RankN> const& array, std::true_type) {
+  ds.writeBulk(array.data(), array.count());
+}
 
+template <typename ElementT, size_t RankN>
+void writeMultiArrayElements(DataStream& ds, MultiArray<ElementT, RankN> const& array, std::false_type) {
   size_t count = array.count();
   for (size_t i = 0; i < count; ++i)
     ds << array.atIndex(i);
+}
+
+template <typename ElementT, size_t RankN>
+void readMultiArrayElements(DataStream& ds, MultiArray<ElementT, RankN>& array, std::true_type) {
+  ds.readBulk(array.data(), array.count());
+}
+
+template <typename ElementT, size_t RankN>
+void readMultiArrayElements(DataStream& ds, MultiArray<ElementT, RankN>& array, std::false_type) {
+  size_t count = array.count();
+  for (size_t i = 0; i < count; ++i)
+    ds >> array.atIndex(i);
+}
 
+template <typename ElementT, size_t RankN>
+DataStream& operator<<(DataStream& ds, MultiArray<ElementT, RankN> const& array) {
+  auto size = array.size();
+  for (size_t i = 0; i < RankN; ++i)
+    ds.writeVlqU(size[i]);
+
+  writeMultiArrayElements(ds, array, std::integral_constant<bool, DataStreamBulkType<ElementT>::value>());
   return ds;
 }
 
 template <typename ElementT, size_t RankN>
 DataStream& operator>>(DataStream& ds, MultiArray<ElementT, RankN>& array) {
-  typename MultiArray<ElementT, RankN>::SizeList size;
+  typename MultiArray<ElementT, RankN>::SizeArray size;
   for (size_t i = 0; i < RankN; ++i)
     size[i] = ds.readVlqU();
 
   array.setSize(size);
-  size_t count = array.count();
-  for (size_t i = 0; i < count; ++i)
-    ds >> array.atIndex(i);
-
+  readMultiArrayElements(ds, array, std::integral_constant<bool, DataStreamBulkType<ElementT>::value>());
   return ds;
 }
 
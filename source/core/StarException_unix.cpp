@@ -159,6 +159,7 @@ void fatalError(char const* message, bool showStackTrace) {
   else
     Logger::error("Fatal Error: {}", message);
 
+  Logger::flush();
   std::abort();
 }
 
@@ -172,6 +173,7 @@ void fatalException(std::exception const& e, bool showStackTrace) {
   else
     Logger::error("Fatal Exception caught: {}", outputException(e, showStackTrace));
 
+  Logger::flush();
   std::abort();
 }
 
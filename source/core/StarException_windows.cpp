@@ -248,6 +248,7 @@ void fatalError(char const* message, bool showStackTrace) {
     ss << outputStack(captureStack());
 
   Logger::log(LogLevel::Error, ss.str().c_str());
+  Logger::flush();
   MessageBoxW(NULL, stringToUtf16(ss.str()).get(), stringToUtf16("Error").get(), MB_OK | MB_ICONERROR | MB_SYSTEMMODAL);
 
   std::abort();
@@ -261,6 +262,7 @@ void fatalException(std::exception const& e, bool showStackTrace) {
     ss << "Caught at:" << std::endl << outputStack(captureStack());
 
   Logger::log(LogLevel::Error, ss.str().c_str());
+  Logger::flush();
   MessageBoxW(NULL, stringToUtf16(ss.str()).get(), stringToUtf16("Error").get(), MB_OK | MB_ICONERROR | MB_SYSTEMMODAL);
 
   std::abort();
@@ -77,10 +77,6 @@ String File::readFileString(String const& filename) {
   return str;
 }
 
-StreamOffset File::fileSize(String const& filename) {
-  return File::open(filename, IOMode::Read)->size();
-}
-
 void File::writeFile(char const* data, size_t len, String const& filename) {
   FilePtr file = File::open(filename, IOMode::Write | IOMode::Truncate);
   file->writeFull(data, len);
@@ -229,6 +225,17 @@ void File::open(IOMode m) {
   setMode(m);
 }
 
+FileMappingPtr File::mapReadOnly(size_t size) {
+  if (!m_file)
+    throw IOException("mapReadOnly called on closed File");
+  if (size == 0)
+    throw IOException("mapReadOnly called with zero size");
+
+  void* handle = nullptr;
+  void* address = fmap(m_file, size, handle);
+  return FileMappingPtr(new FileMapping(address, size, handle));
+}
+
 void File::close() {
   if (m_file)
     fclose(m_file);
@@ -254,4 +261,19 @@ IODevicePtr File::clone() {
   return cloned;
 }
 
+FileMapping::FileMapping(void* address, size_t size, void* handle)
+  : m_address(address), m_size(size), m_handle(handle) {}
+
+FileMapping::~FileMapping() {
+  File::funmap(m_address, m_size, m_handle);
+}
+
+char const* FileMapping::data() const {
+  return (char const*)m_address;
+}
+
+size_t FileMapping::size() const {
+  return m_size;
+}
+
 }
@@ -6,6 +6,30 @@
 namespace Star {
 
 STAR_CLASS(File);
+STAR_CLASS(FileMapping);
+
+// A read-only view of the start of a file mapped into memory.  The view stays
+// valid after the File is closed, but must be released before the file is
+// shrunk below its size.
+class FileMapping {
+public:
+  ~FileMapping();
+
+  FileMapping(FileMapping const&) = delete;
+  FileMapping& operator=(FileMapping const&) = delete;
+
+  char const* data() const;
+  size_t size() const;
+
+private:
+  friend class File;
+
+  FileMapping(void* address, size_t size, void* handle);
+
+  void* m_address;
+  size_t m_size;
+  void* m_handle;
+};
 
 // All file methods are thread safe.
 class File : public IODevice {
@@ -125,11 +149,17 @@ public:
 
   void sync() override;
 
+  // Maps the first 'size' bytes of the open file into memory for reading.
+  // Writes made through the File afterwards are visible through the mapping.
+  FileMappingPtr mapReadOnly(size_t size);
+
   String deviceName() const override;
 
   IODevicePtr clone() override;
 
 private:
+  friend class FileMapping;
+
   static void* fopen(char const* filename, IOMode mode);
   static void fseek(void* file, StreamOffset offset, IOSeek seek);
   static StreamOffset ftell(void* file);
@@ -141,6 +171,8 @@ private:
   static size_t pread(void* file, char* data, size_t len, StreamOffset absPosition);
   static size_t pwrite(void* file, char const* data, size_t len, StreamOffset absPosition);
   static void resize(void* file, StreamOffset size);
+  static void* fmap(void* file, size_t size, void*& mappingHandle);
+  static void funmap(void* address, size_t size, void* mappingHandle);
 
   String m_filename;
   void* m_file;
@@ -12,6 +12,7 @@
 #include <libgen.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #ifdef STAR_SYSTEM_MACOSX
 #include <mach-o/dyld.h>
@@ -164,6 +165,13 @@ bool File::isFile(String const& path) {
   return S_ISREG(st_buf.st_mode);
 }
 
+StreamOffset File::fileSize(String const& filename) {
+  struct stat st_buf;
+  if (stat(filename.utf8Ptr(), &st_buf) != 0)
+    throw IOException::format("Could not stat file '{}': {}", filename, strerror(errno));
+  return st_buf.st_size;
+}
+
 bool File::isDirectory(String const& path) {
   struct stat st_buf;
   int status = stat(path.utf8Ptr(), &st_buf);
@@ -296,4 +304,15 @@ void File::resize(void* f, StreamOffset size) {
     throw IOException::format("resize error: {}", strerror(errno));
 }
 
+void* File::fmap(void* file, size_t size, void*&) {
+  void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fdFromHandle(file), 0);
+  if (address == MAP_FAILED)
+    throw IOException::format("mmap error: {}", strerror(errno));
+  return address;
+}
+
+void File::funmap(void* address, size_t size, void*) {
+  ::munmap(address, size);
+}
+
 }
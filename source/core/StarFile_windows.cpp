@@ -68,6 +68,13 @@ bool File::isFile(String const& path) {
   return (FILE_ATTRIBUTE_DIRECTORY & findFileData.dwFileAttributes) == 0;
 }
 
+StreamOffset File::fileSize(String const& filename) {
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExW(stringToUtf16(filename).get(), GetFileExInfoStandard, &attributes))
+    throw IOException::format("Could not get attributes of file '{}': {}", filename, GetLastError());
+  return ((StreamOffset)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+}
+
 bool File::isDirectory(String const& path) {
   DWORD attribs = GetFileAttributesW(stringToUtf16(path.trimEnd("\\/")).get());
   if (attribs == INVALID_FILE_ATTRIBUTES)
@@ -409,4 +416,26 @@ void File::resize(void* f, StreamOffset size) {
   SetEndOfFile(file);
 }
 
+void* File::fmap(void* f, size_t size, void*& mappingHandle) {
+  HANDLE file = (HANDLE)f;
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+    throw IOException::format("could not create file mapping {}", GetLastError());
+
+  void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+  if (address == NULL) {
+    auto err = GetLastError();
+    CloseHandle(mapping);
+    throw IOException::format("could not map view of file {}", err);
+  }
+
+  mappingHandle = mapping;
+  return address;
+}
+
+void File::funmap(void* address, size_t, void* mappingHandle) {
+  UnmapViewOfFile(address);
+  CloseHandle((HANDLE)mappingHandle);
+}
+
 }
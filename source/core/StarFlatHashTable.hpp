@@ -107,6 +107,11 @@ private:
   size_t bucketError(size_t current, size_t target) const;
   void checkCapacity(size_t additionalCapacity);
 
+  // Robin Hood placement of a value whose key is known not to be present yet,
+  // starting at the given bucket and probe distance from the value's home
+  // bucket.  Skips all key comparisons, so rehashing never calls Equals.
+  void placeNew(size_t currentBucket, size_t distance, size_t hash, Value value);
+
   Buckets m_buckets;
   size_t m_filledCount;
 
@@ -345,38 +350,27 @@ auto FlatHashTable<Value, Key, GetKey, Hash, Equals, Allocator>::insert(Value va
     checkCapacity(1);
 
   size_t hash = m_hash(m_getKey(value)) | FilledHashBit;
-  size_t targetBucket = hashBucket(hash);
-  size_t currentBucket = targetBucket;
-  size_t insertedBucket = NPos;
+  size_t currentBucket = hashBucket(hash);
+  size_t distance = 0;
 
+  // Same early out as find, once we reach an entry closer to its home bucket
+  // than we are to ours the key cannot be present further on, and that is
+  // exactly where the new value belongs.
   while (true) {
     auto& target = m_buckets[currentBucket];
-    if (auto entryValue = target.valuePtr()) {
-      if (target.hash == hash && m_equals(m_getKey(*entryValue), m_getKey(value)))
-        return make_pair(iterator{m_buckets.data() + currentBucket}, false);
-
-      size_t entryTargetBucket = hashBucket(target.hash);
-      size_t entryError = bucketError(currentBucket, entryTargetBucket);
-      size_t addError = bucketError(currentBucket, targetBucket);
-      if (addError > entryError) {
-        if (insertedBucket == NPos)
-          insertedBucket = currentBucket;
+    auto entryValue = target.valuePtr();
+    if (!entryValue || bucketError(currentBucket, target.hash) < distance)
+      break;
 
-        swap(value, *entryValue);
-        swap(hash, target.hash);
-        targetBucket = entryTargetBucket;
-      }
-      currentBucket = hashBucket(currentBucket + 1);
+    if (target.hash == hash && m_equals(m_getKey(*entryValue), m_getKey(value)))
+      return make_pair(iterator{m_buckets.data() + currentBucket}, false);
 
-    } else {
-      target.setFilled(hash, std::move(value));
-      ++m_filledCount;
-      if (insertedBucket == NPos)
-        insertedBucket = currentBucket;
-
-      return make_pair(iterator{m_buckets.data() + insertedBucket}, true);
-    }
+    currentBucket = hashBucket(currentBucket + 1);
+    ++distance;
   }
+
+  placeNew(currentBucket, distance, hash, std::move(value));
+  return make_pair(iterator{m_buckets.data() + currentBucket}, true);
 }
 
 template <typename Value, typename Key, typename GetKey, typename Hash, typename Equals, typename Allocator>
@@ -426,25 +420,19 @@ auto FlatHashTable<Value, Key, GetKey, Hash, Equals, Allocator>::find(Key const&
     return end();
 
   size_t hash = m_hash(key) | FilledHashBit;
-  size_t targetBucket = hashBucket(hash);
-  size_t currentBucket = targetBucket;
+  size_t currentBucket = hashBucket(hash);
+  size_t distance = 0;
   while (true) {
     auto& bucket = m_buckets[currentBucket];
-    if (auto value = bucket.valuePtr()) {
-      if (bucket.hash == hash && m_equals(m_getKey(*value), key))
-        return iterator{m_buckets.data() + currentBucket};
-
-      size_t entryError = bucketError(currentBucket, bucket.hash);
-      size_t findError = bucketError(currentBucket, targetBucket);
-
-      if (findError > entryError)
-        return end();
+    auto value = bucket.valuePtr();
+    if (!value || bucketError(currentBucket, bucket.hash) < distance)
+      return end();
 
-      currentBucket = hashBucket(currentBucket + 1);
+    if (bucket.hash == hash && m_equals(m_getKey(*value), key))
+      return iterator{m_buckets.data() + currentBucket};
 
-    } else {
-      return end();
-    }
+    currentBucket = hashBucket(currentBucket + 1);
+    ++distance;
   }
 }
 
@@ -547,7 +535,29 @@ void FlatHashTable<Value, Key, GetKey, Hash, Equals, Allocator>::checkCapacity(s
 
   for (auto& entry : oldBuckets) {
     if (auto ptr = entry.valuePtr())
-      insert(std::move(*ptr));
+      placeNew(hashBucket(entry.hash), 0, entry.hash, std::move(*ptr));
+  }
+}
+
+template <typename Value, typename Key, typename GetKey, typename Hash, typename Equals, typename Allocator>
+void FlatHashTable<Value, Key, GetKey, Hash, Equals, Allocator>::placeNew(size_t currentBucket, size_t distance, size_t hash, Value value) {
+  while (true) {
+    auto& target = m_buckets[currentBucket];
+    if (auto entryValue = target.valuePtr()) {
+      size_t entryDistance = bucketError(currentBucket, target.hash);
+      if (entryDistance < distance) {
+        swap(value, *entryValue);
+        swap(hash, target.hash);
+        distance = entryDistance;
+      }
+      currentBucket = hashBucket(currentBucket + 1);
+      ++distance;
+
+    } else {
+      target.setFilled(hash, std::move(value));
+      ++m_filledCount;
+      return;
+    }
   }
 }
 
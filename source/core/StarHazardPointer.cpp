@@ -0,0 +1,91 @@
+#include "StarHazardPointer.hpp"
+#include "StarList.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+struct HazardPointer::Record {
+  atomic<void*> pointer;
+  atomic<bool> active;
+  Record* next;
+};
+
+atomic<HazardPointer::Record*> HazardPointer::s_records{nullptr};
+
+namespace {
+  struct RetiredPointers {
+    Mutex mutex;
+    List<pair<void*, HazardPointer::Deleter>> pointers;
+  };
+
+  // Never destroyed, pointers may be retired by static destructors.
+  RetiredPointers& retiredPointers() {
+    static RetiredPointers* retired = new RetiredPointers;
+    return *retired;
+  }
+}
+
+HazardPointer& HazardPointer::threadHazard() {
+  thread_local HazardPointer hazard;
+  return hazard;
+}
+
+HazardPointer::HazardPointer() {
+  for (Record* record = s_records.load(); record; record = record->next) {
+    bool inactive = false;
+    if (!record->active.load(std::memory_order_relaxed) && record->active.compare_exchange_strong(inactive, true)) {
+      m_record = record;
+      return;
+    }
+  }
+
+  m_record = new Record;
+  m_record->pointer = nullptr;
+  m_record->active = true;
+  m_record->next = s_records.load();
+  while (!s_records.compare_exchange_weak(m_record->next, m_record)) {}
+}
+
+HazardPointer::~HazardPointer() {
+  clear();
+  m_record->active.store(false, std::memory_order_release);
+}
+
+void HazardPointer::clear() {
+  m_record->pointer.store(nullptr, std::memory_order_release);
+}
+
+void HazardPointer::retire(void* ptr, Deleter deleter) {
+  if (!ptr)
+    return;
+
+  List<pair<void*, Deleter>> reclaimable;
+  {
+    auto& retired = retiredPointers();
+    MutexLocker locker(retired.mutex);
+    retired.pointers.append({ptr, deleter});
+
+    List<void*> hazards;
+    for (Record* record = s_records.load(); record; record = record->next) {
+      if (void* hazard = record->pointer.load())
+        hazards.append(hazard);
+    }
+
+    retired.pointers.filter([&](pair<void*, Deleter> const& pointer) {
+      if (hazards.contains(pointer.first))
+        return true;
+      reclaimable.append(pointer);
+      return false;
+    });
+  }
+
+  // Deleting may run arbitrary destructors, which may themselves retire.
+  for (auto const& pointer : reclaimable)
+    pointer.second(pointer.first);
+}
+
+void HazardPointer::set(void* ptr) {
+  m_record->pointer.store(ptr);
+}
+
+}
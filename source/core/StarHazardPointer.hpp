@@ -0,0 +1,74 @@
+#pragma once
+
+#include "StarConfig.hpp"
+
+namespace Star {
+
+// Hazard pointers, for reading through a pointer that other threads may swap
+// out and delete at any time without taking a lock.  A reader publishes the
+// pointer it is about to use in a HazardPointer, and a writer that has swapped
+// a pointer out retires it rather than deleting it, which defers the deletion
+// until no HazardPointer is protecting it.
+class HazardPointer {
+public:
+  typedef void (*Deleter)(void*);
+
+  // HazardPointer for the current thread, for short non-nested reads that can
+  // not call back into anything else using it.
+  static HazardPointer& threadHazard();
+
+  // Acquires a hazard slot, slots are reused once released so there is no
+  // limit on the number of threads or HazardPointers.
+  HazardPointer();
+  ~HazardPointer();
+
+  HazardPointer(HazardPointer const&) = delete;
+  HazardPointer& operator=(HazardPointer const&) = delete;
+
+  // Loads the pointer from source and protects it, so that it may be
+  // dereferenced until clear() is called or another pointer is protected.
+  template <typename T>
+  T* protect(atomic<T*> const& source);
+
+  void clear();
+
+  // Deletes the given pointer with the given deleter once no HazardPointer is
+  // protecting it.  The pointer must already be unreachable for new readers.
+  static void retire(void* ptr, Deleter deleter);
+
+  template <typename T>
+  static void retire(T* ptr);
+
+private:
+  struct Record;
+
+  // Records are never freed, only released and reused, so the list can be
+  // walked at any time without locking.
+  static atomic<Record*> s_records;
+
+  void set(void* ptr);
+
+  Record* m_record;
+};
+
+template <typename T>
+T* HazardPointer::protect(atomic<T*> const& source) {
+  // The source must still hold the pointer after it has been published,
+  // otherwise a writer may have retired it without seeing the hazard.
+  T* ptr = source.load(std::memory_order_acquire);
+  while (true) {
+    set(ptr);
+    T* current = source.load();
+    if (current == ptr)
+      return ptr;
+    ptr = current;
+  }
+}
+
+template <typename T>
+void HazardPointer::retire(T* ptr) {
+  if (ptr)
+    retire(ptr, [](void* p) { delete (T*)p; });
+}
+
+}
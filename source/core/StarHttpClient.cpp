@@ -6,64 +6,82 @@
 
 namespace Star {
 
-WorkerPool& HttpClient::workerPool() {
-  static WorkerPool pool("HttpClient", 4);
-  return pool;
+namespace {
+
+struct PendingHttpRequest {
+  HttpRequest request;
+  HttpClient::Callback callback;
+};
+
+struct HttpClientState {
+  HttpClientState() : workerPool("HttpClient", config.threads) {}
+
+  Mutex mutex;
+  HttpClientConfig config;
+  StringMap<Deque<PendingHttpRequest>> waiting;
+  StringMap<unsigned> active;
+  WorkerPool workerPool;
+};
+
+HttpClientState& httpClientState() {
+  static HttpClientState state;
+  return state;
 }
 
-HttpClient::HttpClient() = default;
-
-HttpClient::~HttpClient() = default;
+HttpResponse performRequest(HttpRequest const& req, size_t maxResponseSize) {
+  // Sessions are kept per thread so that their connections stay alive between
+  // requests.  cpr sessions never forget that a body was set, so requests
+  // without one use a session that has never had one.
+  thread_local cpr::Session bodySession;
+  thread_local cpr::Session bodylessSession;
 
-static HttpResponse performRequest(HttpRequest const& req) {
   HttpResponse response;
 
   try {
+    bool hasBody = req.method == "POST" || req.method == "PUT" || req.method == "PATCH";
+    if (!hasBody && req.method != "GET" && req.method != "DELETE") {
+      response.error = strf("Unsupported HTTP method: {}", req.method);
+      return response;
+    }
+    cpr::Session& session = hasBody ? bodySession : bodylessSession;
+
     // CPR has in own header object
     cpr::Header cprHeaders;
     for (const auto& [fst, snd] : req.headers) {
       cprHeaders[fst.utf8()] = snd.utf8();
     }
 
-    cpr::Timeout timeout{req.timeout * 1000}; // ms
+    session.SetUrl(cpr::Url{req.url.utf8()});
+    session.SetHeader(cprHeaders);
+    session.SetTimeout(cpr::Timeout{req.timeout * 1000}); // ms
+    if (hasBody)
+      session.SetBody(cpr::Body{req.body.utf8()});
+
+    std::string body;
+    bool tooLarge = false;
+    session.SetWriteCallback(cpr::WriteCallback{[&](auto const& data, intptr_t) -> bool {
+      if (maxResponseSize && body.size() + data.size() > maxResponseSize) {
+        tooLarge = true;
+        return false;
+      }
+      body.append(data.data(), data.size());
+      return true;
+    }});
 
     cpr::Response r;
-
-    if (req.method == "GET") {
-      r = cpr::Get(
-        cpr::Url{req.url.utf8()},
-        cprHeaders,
-        timeout
-      );
-    } else if (req.method == "POST") {
-      r = cpr::Post(
-        cpr::Url{req.url.utf8()},
-        cprHeaders,
-        cpr::Body{req.body.utf8()},
-        timeout
-      );
-    } else if (req.method == "PUT") {
-      r = cpr::Put(
-        cpr::Url{req.url.utf8()},
-        cprHeaders,
-        cpr::Body{req.body.utf8()},
-        timeout
-      );
-    } else if (req.method == "DELETE") {
-      r = cpr::Delete(
-        cpr::Url{req.url.utf8()},
-        cprHeaders,
-        timeout
-      );
-    } else if (req.method == "PATCH") {
-      r = cpr::Patch(
-        cpr::Url{req.url.utf8()},
-        cprHeaders,
-        cpr::Body{req.body.utf8()},
-        timeout
-      );
-    } else {
-      response.error = strf("Unsupported HTTP method: {}", req.method);
+    if (req.method == "GET")
+      r = session.Get();
+    else if (req.method == "POST")
+      r = session.Post();
+    else if (req.method == "PUT")
+      r = session.Put();
+    else if (req.method == "DELETE")
+      r = session.Delete();
+    else
+      r = session.Patch();
+
+    if (tooLarge) {
+      response.error = strf("HTTP response exceeds {} bytes", maxResponseSize);
       return response;
     }
 
@@ -73,7 +91,7 @@ static HttpResponse performRequest(HttpRequest const& req) {
     }
 
     response.statusCode = static_cast<int>(r.status_code);
-    response.body = String(r.text);
+    response.body = String(std::move(body));
 
     for (auto const& pair : r.header) {
       response.headers[String(pair.first)] = String(pair.second);
@@ -86,11 +104,85 @@ static HttpResponse performRequest(HttpRequest const& req) {
   return response;
 }
 
-WorkerPoolPromise<HttpResponse> HttpClient::requestAsync(HttpRequest const& request) {
-  return workerPool().addProducer<HttpResponse>([request]() {
-    return performRequest(request);
-  });
+// Starts as many of the requests waiting on the domain as its limit allows,
+// must be called with the state mutex held.
+void dispatchRequests(HttpClientState& state, String const& domain) {
+  auto waiting = state.waiting.ptr(domain);
+  if (!waiting)
+    return;
+
+  unsigned& active = state.active[domain];
+  while (!waiting->empty() && active < max(1u, state.config.maxRequestsPerDomain)) {
+    ++active;
+    state.workerPool.addWork([&state, domain, pending = waiting->takeFirst(), maxResponseSize = state.config.maxResponseSize]() {
+      HttpResponse response = performRequest(pending.request, maxResponseSize);
+      {
+        MutexLocker locker(state.mutex);
+        if (--state.active[domain] == 0)
+          state.active.remove(domain);
+        dispatchRequests(state, domain);
+      }
+
+      try {
+        pending.callback(std::move(response));
+      } catch (std::exception const& e) {
+        Logger::error("Exception in HttpClient request callback: {}", outputException(e, true));
+      }
+    });
+  }
+
+  if (waiting->empty())
+    state.waiting.remove(domain);
+}
+
+}
+
+HttpClient::HttpClient() = default;
+
+HttpClient::~HttpClient() = default;
+
+void HttpClient::configure(HttpClientConfig const& config) {
+  auto& state = httpClientState();
+  MutexLocker locker(state.mutex);
+  if (config.threads != state.config.threads)
+    state.workerPool.start(max(1u, config.threads));
+  state.config = config;
+}
+
+HttpClientConfig HttpClient::config() {
+  auto& state = httpClientState();
+  MutexLocker locker(state.mutex);
+  return state.config;
 }
 
+void HttpClient::requestAsync(HttpRequest request, Callback callback) {
+  auto& state = httpClientState();
+  String domain = urlDomain(request.url);
+  MutexLocker locker(state.mutex);
+  state.waiting[domain].append({std::move(request), std::move(callback)});
+  dispatchRequests(state, domain);
 }
 
+String HttpClient::urlDomain(String const& url) {
+  const size_t end = url.find("://");
+  if (end == NPos)
+    return url;
+
+  const size_t domainStart = end + 3;
+  const size_t pathStart = url.find('/', domainStart);
+  const size_t portStart = url.find(':', domainStart);
+
+  size_t domainEnd = NPos;
+  if (pathStart != NPos && portStart != NPos)
+    domainEnd = std::min(pathStart, portStart);
+  else if (pathStart != NPos)
+    domainEnd = pathStart;
+  else if (portStart != NPos)
+    domainEnd = portStart;
+
+  if (domainEnd == NPos)
+    return url.substr(domainStart);
+  return url.substr(domainStart, domainEnd - domainStart);
+}
+
+}
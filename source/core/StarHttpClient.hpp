@@ -3,7 +3,6 @@
 #include "StarString.hpp"
 #include "StarMap.hpp"
 #include "StarMaybe.hpp"
-#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -23,22 +22,35 @@ struct HttpResponse {
   String error;
 };
 
+struct HttpClientConfig {
+  unsigned threads = 2;
+  // Requests to a domain beyond this many wait for an earlier one to finish.
+  unsigned maxRequestsPerDomain = 2;
+  // Responses with a larger body fail instead, 0 for no limit.
+  size_t maxResponseSize = 4 << 20;
+};
+
+// Performs HTTP requests on a small shared pool of threads.  Every thread
+// keeps its own sessions, so connections are kept alive and reused between
+// requests to the same host.  Requests waiting on their domain's limit do
+// not hold a thread.
 class HttpClient {
 public:
+  typedef function<void(HttpResponse)> Callback;
+
   HttpClient();
   ~HttpClient();
 
-  static WorkerPoolPromise<HttpResponse> requestAsync(HttpRequest const& request);
+  // Applies to requests started after it is called.
+  static void configure(HttpClientConfig const& config);
+  static HttpClientConfig config();
 
-  static WorkerPoolPromise<HttpResponse> getAsync(String const& url, StringMap<String> const& headers = {});
-  static WorkerPoolPromise<HttpResponse> postAsync(String const& url, String const& body, StringMap<String> const& headers = {});
-  static WorkerPoolPromise<HttpResponse> putAsync(String const& url, String const& body, StringMap<String> const& headers = {});
-  static WorkerPoolPromise<HttpResponse> deleteAsync(String const& url, StringMap<String> const& headers = {});
-  static WorkerPoolPromise<HttpResponse> patchAsync(String const& url, String const& body, StringMap<String> const& headers = {});
+  // Calls the callback from a pool thread once the request is complete.  A
+  // request that could not be completed has the response error set.
+  static void requestAsync(HttpRequest request, Callback callback);
 
-private:
-  static WorkerPool& workerPool();
+  // The host part of the given url, without the scheme, port or path.
+  static String urlDomain(String const& url);
 };
 
 }
-
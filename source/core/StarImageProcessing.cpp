@@ -354,31 +354,160 @@ StringList imageOperationReferences(List<ImageOperation> const& operations) {
   return references;
 }
 
+static atomic<bool> s_imageOperationKernelsEnabled = true;
+
+void setImageOperationKernelsEnabled(bool enabled) {
+  s_imageOperationKernelsEnabled = enabled;
+}
+
+// Pixels of RGBA32 images are handled as 32 bit words in memory order, so
+// colors compared against them are packed the same way.
+static uint32_t packPixel(Vec4B const& pixel) {
+  uint32_t packed;
+  memcpy(&packed, pixel.ptr(), sizeof(packed));
+  return packed;
+}
+
+static Vec4B unpackPixel(uint32_t packed) {
+  Vec4B pixel;
+  memcpy(pixel.ptr(), &packed, sizeof(packed));
+  return pixel;
+}
+
+static bool imageOperationKernelApplies(Image const& image) {
+  return s_imageOperationKernelsEnabled && image.pixelFormat() == PixelFormat::RGBA32;
+}
+
+// Applies a per pixel function directly to RGBA32 pixel data, remembering the
+// most recent results in a small direct mapped table.  Sprites use very few
+// distinct colors, so the expensive color space conversions behind hue,
+// saturation, brightness and palette swap operations run roughly once per
+// color instead of once per pixel.
+template <typename Function>
+static void transformPixelsMemoized(Image& image, Function&& function) {
+  unsigned const MemoBits = 6;
+  uint32_t keys[1 << MemoBits];
+  uint32_t values[1 << MemoBits];
+  bool filled[1 << MemoBits] = {};
+
+  uint8_t* data = image.data();
+  size_t count = (size_t)image.width() * image.height();
+  for (size_t i = 0; i < count; ++i, data += 4) {
+    uint32_t pixel;
+    memcpy(&pixel, data, sizeof(pixel));
+    size_t slot = (pixel * 2654435761u) >> (32 - MemoBits);
+    if (!filled[slot] || keys[slot] != pixel) {
+      keys[slot] = pixel;
+      values[slot] = function(pixel);
+      filled[slot] = true;
+    }
+    memcpy(data, &values[slot], sizeof(pixel));
+  }
+}
+
 #ifdef STAR_COMPILER_GNU
 #pragma GCC push_options
 #pragma GCC optimize("-fno-fast-math", "-fassociative-math", "-freciprocal-math")
 #endif
-static void processSaturationShift(Image& image, SaturationShiftImageOperation const* op) {
-  image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-    if (pixel[3] != 0) {
-      Color color = Color::rgba(pixel);
-      color.setSaturation(clamp(color.saturation() + op->saturationShiftAmount, 0.0f, 1.0f));
-      pixel = color.toRgba();
-    }
-  });
+static Vec4B saturationShiftPixel(Vec4B const& pixel, float amount) {
+  Color color = Color::rgba(pixel);
+  color.setSaturation(clamp(color.saturation() + amount, 0.0f, 1.0f));
+  return color.toRgba();
 }
 #ifdef STAR_COMPILER_GNU
 #pragma GCC pop_options
 #endif
 
+static Vec4B brightnessMultiplyPixel(Vec4B const& pixel, float multiply) {
+  Color color = Color::rgba(pixel);
+  color.setValue(clamp(color.value() * multiply, 0.0f, 1.0f));
+  return color.toRgba();
+}
 
+// Replaces colors through a flat key / value list when the palette is small
+// enough that scanning it beats hashing the pixel.
+static void processColorReplace(Image& image, ColorReplaceMap const& colorReplaceMap) {
+  size_t const LinearScanLimit = 16;
+  if (colorReplaceMap.empty())
+    return;
+
+  if (colorReplaceMap.size() <= LinearScanLimit) {
+    uint32_t keys[LinearScanLimit];
+    uint32_t values[LinearScanLimit];
+    size_t count = 0;
+    for (auto const& pair : colorReplaceMap) {
+      keys[count] = packPixel(pair.first);
+      values[count] = packPixel(pair.second);
+      ++count;
+    }
+
+    transformPixelsMemoized(image, [&](uint32_t pixel) {
+      for (size_t i = 0; i < count; ++i) {
+        if (keys[i] == pixel)
+          return values[i];
+      }
+      return pixel;
+    });
+  } else {
+    transformPixelsMemoized(image, [&](uint32_t pixel) {
+      if (auto replacement = colorReplaceMap.ptr(unpackPixel(pixel)))
+        return packPixel(*replacement);
+      return pixel;
+    });
+  }
+}
+
+static void processFadeTables(uint8_t* data, size_t count,
+    Array<uint8_t, 256> const& rTable, Array<uint8_t, 256> const& gTable, Array<uint8_t, 256> const& bTable) {
+  for (size_t i = 0; i < count; ++i, data += 4) {
+    data[0] = rTable[data[0]];
+    data[1] = gTable[data[1]];
+    data[2] = bTable[data[2]];
+  }
+}
+
+static void processMultiply(Image& image, Vec4B const& color) {
+  // Written over plain bytes so the loop auto-vectorizes.
+  uint8_t* data = image.data();
+  size_t count = (size_t)image.width() * image.height();
+  unsigned r = color[0], g = color[1], b = color[2], a = color[3];
+  for (size_t i = 0; i < count; ++i, data += 4) {
+    data[0] = (uint8_t)((data[0] * r) / 255);
+    data[1] = (uint8_t)((data[1] * g) / 255);
+    data[2] = (uint8_t)((data[2] * b) / 255);
+    data[3] = (uint8_t)((data[3] * a) / 255);
+  }
+}
+
+static void processSaturationShift(Image& image, SaturationShiftImageOperation const* op) {
+  if (imageOperationKernelApplies(image)) {
+    transformPixelsMemoized(image, [&op](uint32_t pixel) {
+      Vec4B rgba = unpackPixel(pixel);
+      return rgba[3] != 0 ? packPixel(saturationShiftPixel(rgba, op->saturationShiftAmount)) : pixel;
+    });
+    return;
+  }
+
+  image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
+    if (pixel[3] != 0)
+      pixel = saturationShiftPixel(pixel, op->saturationShiftAmount);
+  });
+}
 
 void processImageOperation(ImageOperation const& operation, Image& image, ImageReferenceCallback refCallback) {
   if (image.bytesPerPixel() == 3) {
     // Convert to an image format that has alpha so certain operations function properly
     image = image.convert(image.pixelFormat() == PixelFormat::BGR24 ? PixelFormat::BGRA32 : PixelFormat::RGBA32);
   }
+  bool kernel = imageOperationKernelApplies(image);
   if (auto op = operation.ptr<HueShiftImageOperation>()) {
+    if (kernel) {
+      transformPixelsMemoized(image, [&op](uint32_t pixel) {
+        Vec4B rgba = unpackPixel(pixel);
+        return rgba[3] != 0 ? packPixel(Color::hueShiftVec4B(rgba, op->hueShiftAmount)) : pixel;
+      });
+      return;
+    }
     image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
       if (pixel[3] != 0)
         pixel = Color::hueShiftVec4B(pixel, op->hueShiftAmount);
@@ -386,14 +515,22 @@ void processImageOperation(ImageOperation const& operation, Image& image, ImageR
   } else if (auto op = operation.ptr<SaturationShiftImageOperation>()) {
     processSaturationShift(image, op);
   } else if (auto op = operation.ptr<BrightnessMultiplyImageOperation>()) {
+    if (kernel) {
+      transformPixelsMemoized(image, [&op](uint32_t pixel) {
+        Vec4B rgba = unpackPixel(pixel);
+        return rgba[3] != 0 ? packPixel(brightnessMultiplyPixel(rgba, op->brightnessMultiply)) : pixel;
+      });
+      return;
+    }
     image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
-      if (pixel[3] != 0) {
-        Color color = Color::rgba(pixel);
-        color.setValue(clamp(color.value() * op->brightnessMultiply, 0.0f, 1.0f));
-        pixel = color.toRgba();
-      }
+      if (pixel[3] != 0)
+        pixel = brightnessMultiplyPixel(pixel, op->brightnessMultiply);
     });
   } else if (auto op = operation.ptr<FadeToColorImageOperation>()) {
+    if (kernel) {
+      processFadeTables(image.data(), (size_t)image.width() * image.height(), op->rTable, op->gTable, op->bTable);
+      return;
+    }
     image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
       pixel[0] = op->rTable[pixel[0]];
       pixel[1] = op->gTable[pixel[1]];
@@ -418,6 +555,10 @@ void processImageOperation(ImageOperation const& operation, Image& image, ImageR
       pixel[2] = op->color[2];
     });
   } else if (auto op = operation.ptr<ColorReplaceImageOperation>()) {
+    if (kernel) {
+      processColorReplace(image, op->colorReplaceMap);
+      return;
+    }
     image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
       if (auto m = op->colorReplaceMap.maybe(pixel))
         pixel = *m;
@@ -482,6 +623,10 @@ void processImageOperation(ImageOperation const& operation, Image& image, ImageR
     });
 
   } else if (auto op = operation.ptr<MultiplyImageOperation>()) {
+    if (kernel) {
+      processMultiply(image, op->color);
+      return;
+    }
     image.forEachPixel([&op](unsigned, unsigned, Vec4B& pixel) {
       pixel = pixel.combine(op->color, [](uint8_t a, uint8_t b) -> uint8_t {
           return (uint8_t)(((int)a * (int)b) / 255);
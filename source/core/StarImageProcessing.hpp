@@ -156,6 +156,11 @@ typedef function<Image const*(String const& refName)> ImageReferenceCallback;
 
 void processImageOperation(ImageOperation const& operation, Image& input, ImageReferenceCallback refCallback = {});
 
+// Enables the direct RGBA32 kernels used for the common color operations,
+// which are on by default.  Other pixel formats always take the generic
+// per pixel path; disabling the kernels is mostly useful for comparison.
+void setImageOperationKernelsEnabled(bool enabled);
+
 Image processImageOperations(List<ImageOperation> const& operations, Image input, ImageReferenceCallback refCallback = {});
 
 }
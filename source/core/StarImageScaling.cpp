@@ -94,4 +94,28 @@ Image scaleBicubic(Image const& srcImage, Vec2F const& scale) {
   return destImage;
 }
 
+Image scaleHalf(Image const& srcImage) {
+  Vec2U destSize((srcImage.width() + 1) / 2, (srcImage.height() + 1) / 2);
+  Image destImage(destSize, srcImage.pixelFormat());
+
+  for (unsigned y = 0; y < destSize[1]; ++y) {
+    for (unsigned x = 0; x < destSize[0]; ++x) {
+      Vec3U color;
+      unsigned alpha = 0;
+      for (unsigned i = 0; i < 4; ++i) {
+        Vec4B pixel = srcImage.clamp(x * 2 + i % 2, y * 2 + i / 2);
+        color += Vec3U(pixel[0], pixel[1], pixel[2]) * pixel[3];
+        alpha += pixel[3];
+      }
+
+      if (alpha == 0)
+        destImage.set(x, y, Vec4B());
+      else
+        destImage.set(x, y, Vec4B(color[0] / alpha, color[1] / alpha, color[2] / alpha, (alpha + 2) / 4));
+    }
+  }
+
+  return destImage;
+}
+
 }
\ No newline at end of file
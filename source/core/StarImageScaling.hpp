@@ -6,5 +6,9 @@ STAR_CLASS(Image);
 Image scaleNearest(Image const& srcImage, Vec2F const& scale);
 Image scaleBilinear(Image const& srcImage, Vec2F const& scale);
 Image scaleBicubic(Image const& srcImage, Vec2F const& scale);
+// Averages every 2x2 block of pixels into one, weighting colors by their
+// alpha so transparent pixels do not darken the edges.  Odd sizes round up,
+// repeating the last row or column.
+Image scaleHalf(Image const& srcImage);
 
 }
\ No newline at end of file
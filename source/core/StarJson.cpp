@@ -1,6 +1,7 @@
 #include "StarJson.hpp"
 #include "StarJsonBuilder.hpp"
 #include "StarJsonPath.hpp"
+#include "StarCompactJson.hpp"
 #include "StarFormat.hpp"
 #include "StarLexicalCast.hpp"
 #include "StarIterator.hpp"
@@ -8,6 +9,13 @@
 
 namespace Star {
 
+JsonArena::JsonArena(size_t blockSize)
+  : m_arena(blockSize) {}
+
+void* JsonArena::allocate(size_t size, size_t alignment) {
+  return m_arena.allocate(size, alignment);
+}
+
 Json::Type Json::typeFromName(String const& t) {
   if (t == "float")
     return Type::Float;
@@ -178,6 +186,18 @@ Json::Json(JsonObject m) {
   m_data = make_shared<JsonObject const>(std::move(m));
 }
 
+Json::Json(String s, JsonArenaPtr const& arena) {
+  m_data = StringConstPtr(std::allocate_shared<String>(JsonArenaAllocator<String>(arena), std::move(s)));
+}
+
+Json::Json(JsonArray l, JsonArenaPtr const& arena) {
+  m_data = JsonArrayConstPtr(std::allocate_shared<JsonArray>(JsonArenaAllocator<JsonArray>(arena), std::move(l)));
+}
+
+Json::Json(JsonObject m, JsonArenaPtr const& arena) {
+  m_data = JsonObjectConstPtr(std::allocate_shared<JsonObject>(JsonArenaAllocator<JsonObject>(arena), std::move(m)));
+}
+
 double Json::toDouble() const {
   if (type() == Type::Float)
     return m_data.get<double>();
@@ -918,6 +938,10 @@ DataStream& operator>>(DataStream& os, Json& v) {
   // Compatibility with old serialization, 0 was INVALID but INVALID is no
   // longer used.
   uint8_t typeIndex = os.read<uint8_t>();
+  if (typeIndex == CompactJsonStreamTag) {
+    v = readCompactJson(os);
+    return os;
+  }
   if (typeIndex > 0)
     typeIndex -= 1;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "StarArena.hpp"
 #include "StarDataStream.hpp"
 #include "StarVariant.hpp"
 #include "StarString.hpp"
@@ -11,6 +12,7 @@ STAR_EXCEPTION(JsonException, StarException);
 STAR_EXCEPTION(JsonParsingException, StarException);
 
 STAR_CLASS(Json);
+STAR_CLASS(JsonArena);
 
 typedef List<Json> JsonArray;
 typedef shared_ptr<JsonArray const> JsonArrayConstPtr;
@@ -18,6 +20,45 @@ typedef shared_ptr<JsonArray const> JsonArrayConstPtr;
 typedef StringMap<Json> JsonObject;
 typedef shared_ptr<JsonObject const> JsonObjectConstPtr;
 
+// Bump allocator for the nodes of a Json document that is built all at once,
+// such as a parsed asset.  Nodes allocated from it are packed together in a
+// few large blocks rather than each being its own heap allocation.  Memory is
+// never reused, the blocks are all freed once the last node allocated from
+// the arena is gone.  Only the thread building the document may allocate.
+class JsonArena {
+public:
+  JsonArena(size_t blockSize = 16384);
+
+  void* allocate(size_t size, size_t alignment);
+
+private:
+  Arena m_arena;
+};
+
+template <typename T>
+class JsonArenaAllocator {
+public:
+  typedef T value_type;
+
+  JsonArenaAllocator(JsonArenaPtr arena);
+  template <typename U>
+  JsonArenaAllocator(JsonArenaAllocator<U> const& other);
+
+  T* allocate(size_t n);
+  void deallocate(T*, size_t);
+
+  template <typename U>
+  bool operator==(JsonArenaAllocator<U> const& other) const;
+  template <typename U>
+  bool operator!=(JsonArenaAllocator<U> const& other) const;
+
+private:
+  template <typename U>
+  friend class JsonArenaAllocator;
+
+  JsonArenaPtr m_arena;
+};
+
 // Class for holding representation of JSON data.  Immutable and implicitly
 // shared.
 class Json {
@@ -77,6 +118,11 @@ public:
   Json(JsonArray);
   Json(JsonObject);
 
+  // Allocates the shared storage for the value from the given arena
+  Json(String, JsonArenaPtr const& arena);
+  Json(JsonArray, JsonArenaPtr const& arena);
+  Json(JsonObject, JsonArenaPtr const& arena);
+
   // Float and Int types are convertible between each other.  toDouble,
   // toFloat, toInt, toUInt may be called on either an Int or a Float.  For a
   // Float this is simply a C style cast from double, and for an Int it is
@@ -317,6 +363,35 @@ struct hash<Json> {
   size_t operator()(Json const& v) const;
 };
 
+template <typename T>
+JsonArenaAllocator<T>::JsonArenaAllocator(JsonArenaPtr arena)
+  : m_arena(std::move(arena)) {}
+
+template <typename T>
+template <typename U>
+JsonArenaAllocator<T>::JsonArenaAllocator(JsonArenaAllocator<U> const& other)
+  : m_arena(other.m_arena) {}
+
+template <typename T>
+T* JsonArenaAllocator<T>::allocate(size_t n) {
+  return (T*)m_arena->allocate(n * sizeof(T), alignof(T));
+}
+
+template <typename T>
+void JsonArenaAllocator<T>::deallocate(T*, size_t) {}
+
+template <typename T>
+template <typename U>
+bool JsonArenaAllocator<T>::operator==(JsonArenaAllocator<U> const& other) const {
+  return m_arena == other.m_arena;
+}
+
+template <typename T>
+template <typename U>
+bool JsonArenaAllocator<T>::operator!=(JsonArenaAllocator<U> const& other) const {
+  return m_arena != other.m_arena;
+}
+
 template <typename Container>
 auto Json::IteratorWrapper<Container>::begin() const -> const_iterator {
   return ptr->begin();
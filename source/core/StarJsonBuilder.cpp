@@ -3,6 +3,9 @@
 
 namespace Star {
 
+JsonBuilderStream::JsonBuilderStream(JsonArenaPtr arena)
+  : m_arena(std::move(arena)) {}
+
 void JsonBuilderStream::beginObject() {
   pushSentry();
 }
@@ -12,18 +15,19 @@ void JsonBuilderStream::objectKey(char32_t const* s, size_t len) {
 }
 
 void JsonBuilderStream::endObject() {
+  // Keys and values alternate above the sentry, build the object from them
+  // in place rather than popping them one at a time.
+  size_t sentry = sentryIndex();
   JsonObject object;
-  while (true) {
-    if (isSentry()) {
-      set(Json(std::move(object)));
-      return;
-    } else {
-      Json v = pop();
-      String k = pop().toString();
-      if (!object.insert(k, std::move(v)).second)
-        throw JsonParsingException(strf("Json object contains a duplicate entry for key '{}'", k));
-    }
+  object.reserve((m_stack.size() - sentry - 1) / 2);
+  for (size_t i = sentry + 1; i + 1 < m_stack.size(); i += 2) {
+    String k = m_stack[i]->toString();
+    if (object.contains(k))
+      throw JsonParsingException(strf("Json object contains a duplicate entry for key '{}'", k));
+    object.insert(std::move(k), m_stack[i + 1].take());
   }
+  m_stack.resize(sentry + 1);
+  set(m_arena ? Json(std::move(object), m_arena) : Json(std::move(object)));
 }
 
 void JsonBuilderStream::beginArray() {
@@ -31,28 +35,37 @@ void JsonBuilderStream::beginArray() {
 }
 
 void JsonBuilderStream::endArray() {
+  size_t sentry = sentryIndex();
   JsonArray array;
-  while (true) {
-    if (isSentry()) {
-      array.reverse();
-      set(Json(std::move(array)));
-      return;
-    } else {
-      array.append(pop());
-    }
-  }
+  array.reserve(m_stack.size() - sentry - 1);
+  for (size_t i = sentry + 1; i < m_stack.size(); ++i)
+    array.append(m_stack[i].take());
+  m_stack.resize(sentry + 1);
+  set(m_arena ? Json(std::move(array), m_arena) : Json(std::move(array)));
 }
 
 void JsonBuilderStream::putString(char32_t const* s, size_t len) {
-  push(Json(s, len));
+  push(m_arena ? Json(String(s, len), m_arena) : Json(s, len));
+}
+
+// Numbers are always ASCII, so they can be narrowed onto the stack and parsed
+// directly instead of going through a String.
+template <typename Type>
+static Type castJsonNumber(char32_t const* s, size_t len) {
+  char buffer[64];
+  if (len > sizeof(buffer))
+    return lexicalCast<Type>(String(s, len));
+  for (size_t i = 0; i < len; ++i)
+    buffer[i] = (char)s[i];
+  return lexicalCast<Type>(buffer, buffer + len);
 }
 
 void JsonBuilderStream::putDouble(char32_t const* s, size_t len) {
-  push(Json(lexicalCast<double>(String(s, len))));
+  push(Json(castJsonNumber<double>(s, len)));
 }
 
 void JsonBuilderStream::putInteger(char32_t const* s, size_t len) {
-  push(Json(lexicalCast<long long>(String(s, len))));
+  push(Json(castJsonNumber<long long>(s, len)));
 }
 
 void JsonBuilderStream::putBoolean(bool b) {
@@ -69,6 +82,10 @@ void JsonBuilderStream::putColon() {}
 
 void JsonBuilderStream::putComma() {}
 
+bool JsonBuilderStream::keepsWhitespace() const {
+  return false;
+}
+
 size_t JsonBuilderStream::stackSize() {
   return m_stack.size();
 }
@@ -100,6 +117,14 @@ bool JsonBuilderStream::isSentry() {
   return !m_stack.empty() && !m_stack.last();
 }
 
+size_t JsonBuilderStream::sentryIndex() {
+  for (size_t i = m_stack.size(); i != 0; --i) {
+    if (!m_stack[i - 1])
+      return i - 1;
+  }
+  throw JsonParsingException("Json builder stack has no open container");
+}
+
 void JsonStreamer<Json>::toJsonStream(Json const& val, JsonStream& stream, bool sort) {
   Json::Type type = val.type();
   if (type == Json::Type::Null) {
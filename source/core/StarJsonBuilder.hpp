@@ -7,6 +7,9 @@ namespace Star {
 
 class JsonBuilderStream : public JsonStream {
 public:
+  // If given an arena, strings, arrays and objects are allocated from it
+  JsonBuilderStream(JsonArenaPtr arena = {});
+
   virtual void beginObject();
   virtual void objectKey(char32_t const* s, size_t len);
   virtual void endObject();
@@ -23,6 +26,7 @@ public:
   virtual void putWhitespace(char32_t const* s, size_t len);
   virtual void putColon();
   virtual void putComma();
+  virtual bool keepsWhitespace() const;
 
   size_t stackSize();
   Json takeTop();
@@ -33,7 +37,10 @@ private:
   void set(Json v);
   void pushSentry();
   bool isSentry();
+  // Index of the innermost sentry on the stack
+  size_t sentryIndex();
 
+  JsonArenaPtr m_arena;
   List<Maybe<Json>> m_stack;
 };
 
@@ -50,11 +57,11 @@ public:
 };
 
 template <typename InputIterator>
-Json inputUtf8Json(InputIterator begin, InputIterator end, JsonParseType parseType) {
+Json inputUtf8Json(InputIterator begin, InputIterator end, JsonParseType parseType, JsonArenaPtr arena = {}) {
   typedef U8ToU32Iterator<InputIterator> Utf32Input;
   typedef JsonParser<Utf32Input> Parser;
 
-  JsonBuilderStream stream;
+  JsonBuilderStream stream(std::move(arena));
   Parser parser(stream);
   Utf32Input wbegin(begin);
   Utf32Input wend(end);
@@ -25,6 +25,10 @@ struct JsonStream {
   virtual void putWhitespace(char32_t const*, size_t) = 0;
   virtual void putColon() = 0;
   virtual void putComma() = 0;
+
+  // Streams that discard whitespace and comments can return false here, so
+  // the parser skips over them without collecting them for putWhitespace.
+  virtual bool keepsWhitespace() const { return true; }
 };
 
 enum class JsonParseType : uint8_t {
@@ -39,7 +43,7 @@ template <typename InputIterator>
 class JsonParser {
 public:
   JsonParser(JsonStream& stream)
-    : m_line(0), m_column(0), m_error(nullptr), m_stream(stream) {}
+    : m_line(0), m_column(0), m_error(nullptr), m_stream(stream), m_keepWhitespace(stream.keepsWhitespace()) {}
   virtual ~JsonParser() {}
 
   // Does not throw.  On error, returned iterator will not be equal to end, and
@@ -483,36 +487,28 @@ private:
       if (m_char == '/') {
         // Always consume '/' found in whitespace, because that is never valid
         // JSON (other than comments)
-        buffer += m_char;
-        next();
+        nextWhite(buffer);
         if (m_current != m_end && m_char == '/') {
           // eat "/"
-          buffer += m_char;
-          next();
+          nextWhite(buffer);
 
           // Read '//' style comments up until eol/eof.
-          while (m_current != m_end && m_char != '\n') {
-            buffer += m_char;
-            next();
-          }
+          while (m_current != m_end && m_char != '\n')
+            nextWhite(buffer);
         } else if (m_current != m_end && m_char == '*') {
           // eat "*"
-          buffer += m_char;
-          next();
+          nextWhite(buffer);
 
           // Read '/*' style comments up until '*/'.
           while (m_current != m_end) {
             if (m_char == '*') {
-              buffer += m_char;
-              next();
+              nextWhite(buffer);
               if (m_char == '/') {
-                buffer += m_char;
-                next();
+                nextWhite(buffer);
                 break;
               }
             } else {
-              buffer += m_char;
-              next();
+              nextWhite(buffer);
               if (m_current == m_end)
                 error("/* comment has no matching */");
             }
@@ -523,8 +519,7 @@ private:
           return;
         }
       } else if (isSpace(m_char)) {
-        buffer += m_char;
-        next();
+        nextWhite(buffer);
       } else {
         break;
       }
@@ -533,6 +528,14 @@ private:
       m_stream.putWhitespace(buffer.c_str(), buffer.length());
   }
 
+  // Consumes a whitespace or comment character, only recording it if the
+  // stream wants it.
+  void nextWhite(CharArray& buffer) {
+    if (m_keepWhitespace)
+      buffer += m_char;
+    next();
+  }
+
   void error(const char* msg) {
     m_error = msg;
     throw ParsingException();
@@ -554,6 +557,7 @@ private:
   size_t m_column;
   const char* m_error;
   JsonStream& m_stream;
+  bool m_keepWhitespace;
 };
 
 // Write JSON through JsonStream interface.
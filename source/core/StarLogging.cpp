@@ -14,6 +14,8 @@ LogSink::LogSink()
 
 LogSink::~LogSink() {}
 
+void LogSink::flush() {}
+
 void LogSink::setLevel(LogLevel level) {
   m_level = level;
   Logger::refreshLoggable();
@@ -42,6 +44,156 @@ void FileLogSink::log(char const* msg, LogLevel level) {
   m_output->write(line.data(), line.size());
 }
 
+// Set on the writer threads of AsyncLogSinks, so that a flush from a sink they
+// write to does not wait on itself.
+static thread_local bool s_asyncLogWriter = false;
+
+AsyncLogSink::AsyncLogSink(LogSinkPtr target, size_t capacity)
+  : m_target(std::move(target)),
+    m_pushPosition(0),
+    m_popPosition(0),
+    m_pushed(0),
+    m_dropped(0),
+    m_reportedDropped(0),
+    m_writerSleeping(false),
+    m_stop(false),
+    m_written(0) {
+  capacity = max<size_t>(capacity, 2);
+  size_t size = 1;
+  while (size < capacity)
+    size *= 2;
+  m_mask = size - 1;
+  m_cells.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i)
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+  setLevel(m_target->level());
+  m_writer = Thread::invoke("AsyncLogSink::writerMain", mem_fn(&AsyncLogSink::writerMain), this);
+}
+
+AsyncLogSink::~AsyncLogSink() {
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_wakeCondition.signal();
+  }
+  m_writer.finish();
+}
+
+void AsyncLogSink::log(char const* msg, LogLevel level) {
+  if (!push(msg, level)) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  m_pushed.fetch_add(1);
+  if (m_writerSleeping.load()) {
+    MutexLocker locker(m_mutex);
+    m_wakeCondition.signal();
+  }
+}
+
+void AsyncLogSink::flush() {
+  if (!s_asyncLogWriter) {
+    uint64_t pushed = m_pushed.load(std::memory_order_acquire);
+    MutexLocker locker(m_mutex);
+    m_wakeCondition.signal();
+    while (m_written < pushed && !m_stop)
+      m_writtenCondition.wait(m_mutex);
+  }
+  m_target->flush();
+}
+
+LogSinkPtr const& AsyncLogSink::target() const {
+  return m_target;
+}
+
+uint64_t AsyncLogSink::dropped() const {
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+bool AsyncLogSink::push(char const* msg, LogLevel level) {
+  // Bounded multi producer queue, each cell's sequence tells which lap of the
+  // ring it is ready to be written or read on.
+  size_t position = m_pushPosition.load(std::memory_order_relaxed);
+  Cell* cell;
+  while (true) {
+    cell = &m_cells[position & m_mask];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+    if (diff == 0) {
+      if (m_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;
+    } else {
+      position = m_pushPosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->message = msg;
+  cell->level = level;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+void AsyncLogSink::writerMain() {
+  s_asyncLogWriter = true;
+  while (true) {
+    uint64_t written = 0;
+    while (true) {
+      Cell& cell = m_cells[m_popPosition & m_mask];
+      if (cell.sequence.load(std::memory_order_acquire) != m_popPosition + 1)
+        break;
+
+      std::string message = take(cell.message);
+      LogLevel level = cell.level;
+      cell.sequence.store(m_popPosition + m_mask + 1, std::memory_order_release);
+      ++m_popPosition;
+
+      try {
+        m_target->log(message.c_str(), level);
+      } catch (std::exception const&) {
+        // Nowhere left to report a sink failing to write
+      }
+      ++written;
+    }
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped) {
+      m_target->log(strf("Log queue full, dropped {} messages", dropped - m_reportedDropped).c_str(), LogLevel::Warn);
+      m_reportedDropped = dropped;
+    }
+
+    MutexLocker locker(m_mutex);
+    if (written != 0) {
+      m_written += written;
+      m_writtenCondition.broadcast();
+    }
+
+    // A message can be counted as pushed before the ones pushed just ahead
+    // of it are in the ring, so pending messages may not be readable yet.
+    if (m_pushed.load() != m_popPosition) {
+      if (written == 0) {
+        locker.unlock();
+        Thread::yield();
+      }
+      continue;
+    }
+    if (m_stop)
+      break;
+
+    // Pairs with the pushed count being incremented before the writer is
+    // checked for sleeping in log(), so either side sees the other.
+    m_writerSleeping.store(true);
+    if (m_pushed.load() == m_popPosition)
+      m_wakeCondition.wait(m_mutex);
+    m_writerSleeping.store(false);
+  }
+
+  m_writtenCondition.broadcast();
+}
+
 void Logger::addSink(LogSinkPtr s) {
   MutexLocker locker(s_mutex);
   s_sinks.insert(s);
@@ -66,19 +218,62 @@ void Logger::removeStdoutSink() {
 }
 
 void Logger::log(LogLevel level, char const* msg) {
-  if (loggable(level)) {
-    MutexLocker locker(s_mutex);
-    for (auto const& l : s_sinks) {
-      if (l->level() <= level)
-        l->log(msg, level);
-    }
-  }
+  if (loggable(level))
+    logSinks(level, msg);
+}
+
+void Logger::flush() {
+  MutexLocker locker(s_mutex);
+  for (auto const& l : s_sinks)
+    l->flush();
+}
+
+void Logger::setRateLimit(unsigned messagesPerSecond) {
+  s_rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
 }
 
 bool Logger::loggable(LogLevel level) {
   return s_loggable[(int)level];
 }
 
+bool Logger::rateLimitAllows(char const* msg, size_t& suppressed) {
+  struct RateLimit {
+    int64_t windowStart = 0;
+    unsigned count = 0;
+    size_t suppressed = 0;
+  };
+  // Format strings are nearly always literals, so there are usually only as
+  // many of these as there are logging call sites.
+  static thread_local HashMap<char const*, RateLimit> rateLimits;
+  // Unless they are not, then forget them all rather than grow forever
+  if (rateLimits.size() > 4096)
+    rateLimits.clear();
+
+  auto& rateLimit = rateLimits[msg];
+  int64_t now = Time::monotonicMilliseconds();
+  if (now - rateLimit.windowStart >= 1000) {
+    rateLimit.windowStart = now;
+    rateLimit.count = 0;
+  }
+
+  if (rateLimit.count >= s_rateLimit.load(std::memory_order_relaxed)) {
+    ++rateLimit.suppressed;
+    return false;
+  }
+
+  ++rateLimit.count;
+  suppressed = take(rateLimit.suppressed);
+  return true;
+}
+
+void Logger::logSinks(LogLevel level, char const* msg) {
+  MutexLocker locker(s_mutex);
+  for (auto const& l : s_sinks) {
+    if (l->level() <= level)
+      l->log(msg, level);
+  }
+}
+
 void Logger::refreshLoggable() {
   s_loggable = Array<bool, 4>::filled(false);
   for (auto const& l : s_sinks) {
@@ -91,9 +286,74 @@ shared_ptr<StdoutLogSink> Logger::s_stdoutSink = make_shared<StdoutLogSink>();
 HashSet<LogSinkPtr> Logger::s_sinks{s_stdoutSink};
 Array<bool, 4> Logger::s_loggable = Array<bool, 4>{false, true, true, true};
 Mutex Logger::s_mutex;
+atomic<unsigned> Logger::s_rateLimit(0);
+
+LogMap::Value::Value() {}
+
+LogMap::Value::Value(String key, String format) {
+  m_slot = make_shared<Slot>();
+  m_slot->key = std::move(key);
+  m_slot->format = std::move(format);
+  m_slot->fieldCount = 0;
+  for (auto& field : m_slot->fields)
+    field = 0.0;
+
+  MutexLocker locker(s_logMapMutex);
+  s_logMapValues[m_slot->key] = m_slot;
+}
+
+LogMap::Value::~Value() {
+  if (!m_slot)
+    return;
+
+  MutexLocker locker(s_logMapMutex);
+  auto i = s_logMapValues.find(m_slot->key);
+  // Another Value may have since been registered under the same key
+  if (i != s_logMapValues.end() && i->second == m_slot)
+    s_logMapValues.erase(i);
+}
+
+LogMap::Value::Value(Value&& value)
+  : m_slot(std::move(value.m_slot)) {
+  value.m_slot.reset();
+}
+
+LogMap::Value& LogMap::Value::operator=(Value&& value) {
+  if (this != &value) {
+    Value old(std::move(*this));
+    m_slot = std::move(value.m_slot);
+    value.m_slot.reset();
+  }
+  return *this;
+}
+
+String LogMap::Value::format(SlotPtr const& slot) {
+  size_t fieldCount = slot->fieldCount.load(std::memory_order_acquire);
+  Array<double, MaxFields> f;
+  for (size_t i = 0; i < MaxFields; ++i)
+    f[i] = slot->fields[i].load(std::memory_order_relaxed);
+
+  auto format = fmt::runtime(slot->format.utf8());
+  try {
+    if (fieldCount <= 1)
+      return fmt::format(format, f[0]);
+    else if (fieldCount == 2)
+      return fmt::format(format, f[0], f[1]);
+    else if (fieldCount == 3)
+      return fmt::format(format, f[0], f[1], f[2]);
+    else
+      return fmt::format(format, f[0], f[1], f[2], f[3]);
+  } catch (std::exception const& e) {
+    return strf("<bad format: {}>", e.what());
+  }
+}
 
 String LogMap::getValue(String const& key) {
   MutexLocker locker(s_logMapMutex);
+  if (auto slot = s_logMapValues.value(key)) {
+    if (slot->fieldCount.load(std::memory_order_acquire) != 0)
+      return Value::format(slot);
+  }
   return s_logMap.value(key);
 }
 
@@ -104,15 +364,23 @@ void LogMap::setValue(String const& key, String const& value) {
 
 Map<String, String> LogMap::getValues() {
   MutexLocker locker(s_logMapMutex);
-  return Map<String, String>::from(s_logMap);
+  auto values = Map<String, String>::from(s_logMap);
+  for (auto const& pair : s_logMapValues) {
+    if (pair.second->fieldCount.load(std::memory_order_acquire) != 0)
+      values[pair.first] = Value::format(pair.second);
+  }
+  return values;
 }
 
 void LogMap::clear() {
   MutexLocker locker(s_logMapMutex);
   s_logMap.clear();
+  for (auto const& pair : s_logMapValues)
+    pair.second->fieldCount.store(0, std::memory_order_relaxed);
 }
 
 HashMap<String, String> LogMap::s_logMap;
+HashMap<String, LogMap::Value::SlotPtr> LogMap::s_logMapValues;
 Mutex LogMap::s_logMapMutex;
 
 size_t const SpatialLogger::MaximumLines;
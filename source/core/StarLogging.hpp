@@ -19,6 +19,7 @@ enum class LogLevel {
 extern EnumMap<LogLevel> const LogLevelNames;
 
 STAR_CLASS(LogSink);
+STAR_CLASS(AsyncLogSink);
 
 // A sink for Logger messages.
 class LogSink {
@@ -27,6 +28,9 @@ public:
   virtual ~LogSink();
 
   virtual void log(char const* msg, LogLevel level) = 0;
+  // Blocks until everything already logged has been written out, for sinks
+  // that do not write immediately.
+  virtual void flush();
 
   void setLevel(LogLevel level);
   LogLevel level();
@@ -54,6 +58,53 @@ private:
   Mutex m_logMutex;
 };
 
+// Writes to another sink from a dedicated writer thread, so logging never
+// waits on the other sink's I/O.  Messages are queued in a fixed size lock-free
+// ring, when it is full new messages are dropped and counted, and the count
+// is logged once there is room again.  Takes the level of the other sink at
+// construction.  Destroying it writes out any messages still queued.
+class AsyncLogSink : public LogSink {
+public:
+  AsyncLogSink(LogSinkPtr target, size_t capacity = 4096);
+  ~AsyncLogSink();
+
+  virtual void log(char const* msg, LogLevel level);
+  virtual void flush();
+
+  LogSinkPtr const& target() const;
+  // Total messages dropped because the queue was full
+  uint64_t dropped() const;
+
+private:
+  struct Cell {
+    atomic<size_t> sequence;
+    std::string message;
+    LogLevel level;
+  };
+
+  bool push(char const* msg, LogLevel level);
+  void writerMain();
+
+  LogSinkPtr m_target;
+  size_t m_mask;
+  unique_ptr<Cell[]> m_cells;
+  atomic<size_t> m_pushPosition;
+  // Owned by the writer thread
+  size_t m_popPosition;
+
+  atomic<uint64_t> m_pushed;
+  atomic<uint64_t> m_dropped;
+  uint64_t m_reportedDropped;
+
+  Mutex m_mutex;
+  ConditionVariable m_wakeCondition;
+  ConditionVariable m_writtenCondition;
+  atomic<bool> m_writerSleeping;
+  bool m_stop;
+  uint64_t m_written;
+  ThreadFunction<void> m_writer;
+};
+
 // A basic loging system that logs to multiple streams.  Can log at Debug,
 // Info, Warn, and Error logging levels.  By default logs to stdout.
 class Logger {
@@ -80,9 +131,24 @@ public:
   template <typename... Args>
   static void error(char const* msg, Args const&... args);
 
+  // Flushes every sink, e.g. before the process aborts.
+  static void flush();
+
+  // Limits how many messages logged through each logf format string are
+  // written per second on each thread, the rest are dropped and their count
+  // logged with the next message from that format string that is written.
+  // Zero disables the limit, which is the default.
+  static void setRateLimit(unsigned messagesPerSecond);
+
   static bool loggable(LogLevel level);
   static void refreshLoggable();
 private:
+  // Returns false if a message using this format string should be dropped,
+  // otherwise sets suppressed to how many were dropped since the last one.
+  static bool rateLimitAllows(char const* msg, size_t& suppressed);
+  static void logSinks(LogLevel level, char const* msg);
+
+  static atomic<unsigned> s_rateLimit;
 
   static shared_ptr<StdoutLogSink> s_stdoutSink;
   static HashSet<LogSinkPtr> s_sinks;
@@ -94,6 +160,45 @@ private:
 // be displayed every frame, or in a debug output window, etc.
 class LogMap {
 public:
+  // A numeric LogMap entry registered once under its key, for values that
+  // are updated often.  Setting it stores its fields atomically without
+  // formatting or locking, they are only formatted into a string when the
+  // LogMap is read.  Unregistered when destroyed.
+  class Value {
+  public:
+    static size_t const MaxFields = 4;
+
+    Value();
+    // The format is given each field in order, e.g. "{} in {} sectors"
+    Value(String key, String format = "{}");
+    ~Value();
+
+    Value(Value&& value);
+    Value& operator=(Value&& value);
+
+    Value(Value const&) = delete;
+    Value& operator=(Value const&) = delete;
+
+    // Sets the first fields, does nothing if the value was never registered
+    template <typename... T>
+    void set(T... fields);
+
+  private:
+    friend class LogMap;
+
+    struct Slot {
+      String key;
+      String format;
+      atomic<size_t> fieldCount;
+      Array<atomic<double>, MaxFields> fields;
+    };
+    typedef shared_ptr<Slot> SlotPtr;
+
+    static String format(SlotPtr const& slot);
+
+    SlotPtr m_slot;
+  };
+
   static String getValue(String const& key);
   static void setValue(String const& key, String const& value);
 
@@ -102,10 +207,12 @@ public:
   static void set(String const& key, T const& t);
 
   static Map<String, String> getValues();
+  // Also hides every Value until it is next set
   static void clear();
 
 private:
   static HashMap<String, String> s_logMap;
+  static HashMap<String, Value::SlotPtr> s_logMapValues;
   static Mutex s_logMapMutex;
 };
 
@@ -160,13 +267,14 @@ private:
 template <typename... Args>
 void Logger::logf(LogLevel level, char const* msg, Args const&... args) {
   if (loggable(level)) {
+    size_t suppressed = 0;
+    if (s_rateLimit.load(std::memory_order_relaxed) != 0 && !rateLimitAllows(msg, suppressed))
+      return;
+
     std::string output = strf(msg, args...);
-    MutexLocker locker(s_mutex);
-    for (auto const& l : s_sinks) {
-      if (l->level() <= level) {
-        l->log(output.c_str(), level);
-      }
-    }
+    if (suppressed != 0)
+      output += strf(" ({} similar messages suppressed)", suppressed);
+    logSinks(level, output.c_str());
   }
 }
 
@@ -195,4 +303,14 @@ void LogMap::set(String const& key, T const& t) {
   setValue(key, toString(t));
 }
 
+template <typename... T>
+void LogMap::Value::set(T... fields) {
+  static_assert(sizeof...(T) <= MaxFields, "too many LogMap::Value fields");
+  if (!m_slot)
+    return;
+  size_t i = 0;
+  ((m_slot->fields[i++].store((double)fields, std::memory_order_relaxed)), ...);
+  m_slot->fieldCount.store(sizeof...(T), std::memory_order_release);
+}
+
 }
@@ -29,7 +29,8 @@ public:
   // accessed, otherwise returns nullptr.
   Value* ptr(Key const& key);
 
-  // Put the given value into the cache.
+  // Put the given value into the cache, evicting the least recently accessed
+  // entries if it is full.
   void set(Key const& key, Value value);
   // Removes the given value from the cache.  If found and removed, returns
   // true.
@@ -38,6 +39,9 @@ public:
   // Remove all key / value pairs matching a filter.
   void removeWhere(function<bool(Key const&, Value&)> filter);
 
+  // Removes and returns the least recently accessed entry, if there is one.
+  Maybe<pair<Key, Value>> takeLeastRecent();
+
   // If the value for the key is not found in the cache, produce it with the
   // given producer.  Producer shold take the key as an argument and return the
   // value.
@@ -104,6 +108,8 @@ template <typename OrderedMapType>
 void LruCacheBase<OrderedMapType>::set(Key const& key, Value value) {
   auto i = m_map.find(key);
   if (i == m_map.end()) {
+    while (m_map.size() > m_maxSize - 1)
+      m_map.removeFirst();
     m_map.add(key, std::move(value));
   } else {
     i->second = std::move(value);
@@ -123,6 +129,14 @@ void LruCacheBase<OrderedMapType>::removeWhere(function<bool(Key const&, Value&)
     });
 }
 
+template <typename OrderedMapType>
+auto LruCacheBase<OrderedMapType>::takeLeastRecent() -> Maybe<pair<Key, Value>> {
+  if (m_map.empty())
+    return {};
+  auto p = m_map.takeFirst();
+  return pair<Key, Value>(std::move(p.first), std::move(p.second));
+}
+
 template <typename OrderedMapType>
 template <typename Producer>
 auto LruCacheBase<OrderedMapType>::get(Key const& key, Producer producer) -> Value & {
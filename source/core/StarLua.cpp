@@ -3,6 +3,12 @@
 #include "StarTime.hpp"
 #include "imgui_lua_bindings.hpp"
 
+// An external engine (STAR_LUA_EXTERNAL) must provide the same C API as the
+// bundled Lua, including integer subtypes and the per-state extra space that
+// holds the owning LuaEngine.
+static_assert(LUA_VERSION_NUM == 503, "LuaEngine requires a Lua 5.3 compatible C API");
+static_assert(LUA_EXTRASPACE >= sizeof(void*), "LuaEngine requires Lua state extra space for a pointer");
+
 namespace Star {
 
 std::ostream& operator<<(std::ostream& os, LuaValue const& value) {
@@ -219,9 +225,11 @@ LuaEnginePtr LuaEngine::create(bool safe) {
   self->m_profilingEnabled = false;
   self->m_instructionMeasureInterval = 1000;
   self->m_instructionCount = 0;
+  self->m_instructionsExecuted = 0;
   self->m_recursionLevel = 0;
   self->m_recursionLimit = 0;
   self->m_nullTerminated = 0;
+  self->m_tracebackRequested = false;
 
   if (!self->m_state)
     throw LuaException("Failed to initialize Lua");
@@ -440,6 +448,26 @@ unsigned LuaEngine::instructionMeasureInterval() const {
   return m_instructionMeasureInterval;
 }
 
+uint64_t LuaEngine::instructionsExecuted() const {
+  return m_instructionsExecuted;
+}
+
+void LuaEngine::requestTraceback() {
+  {
+    MutexLocker locker(m_requestedTracebackMutex);
+    m_requestedTraceback.reset();
+  }
+  m_tracebackRequested = true;
+  // Lua allows hooks to be set from other threads, the change is seen at the
+  // next instruction.
+  lua_sethook(m_state, &LuaEngine::countHook, LUA_MASKCOUNT, 1);
+}
+
+Maybe<String> LuaEngine::takeRequestedTraceback() {
+  MutexLocker locker(m_requestedTracebackMutex);
+  return take(m_requestedTraceback);
+}
+
 void LuaEngine::setRecursionLimit(unsigned recursionLimit) {
   m_recursionLimit = recursionLimit;
 }
@@ -507,6 +535,14 @@ LuaTable LuaEngine::createTable(int narr, int nrec) {
   return LuaTable(LuaDetail::LuaHandle(RefPtr<LuaEngine>(this), popHandle(m_state)));
 }
 
+LuaTable LuaEngine::createJsonContainer(Json const& container) {
+  if (!container.isType(Json::Type::Array) && !container.isType(Json::Type::Object))
+    throw LuaException("createJsonContainer called on improper json type");
+
+  pushJson(m_state, container);
+  return LuaTable(LuaDetail::LuaHandle(RefPtr<LuaEngine>(this), popHandle(m_state)));
+}
+
 LuaThread LuaEngine::createThread() {
   lua_checkstack(m_state, 1);
 
@@ -560,20 +596,20 @@ LuaContext LuaEngine::createContext() {
   return context;
 }
 
-void LuaEngine::collectGarbage(Maybe<unsigned> steps) {
+bool LuaEngine::collectGarbage(Maybe<unsigned> steps) {
   for (auto handleIndex : take(m_handleFree)) {
     lua_pushnil(m_handleThread);
     lua_replace(m_handleThread, handleIndex);
   }
 
   if (steps)
-    lua_gc(m_state, LUA_GCSTEP, *steps);
-  else
-    lua_gc(m_state, LUA_GCCOLLECT, 0);
+    return lua_gc(m_state, LUA_GCSTEP, *steps) == 1;
+  lua_gc(m_state, LUA_GCCOLLECT, 0);
+  return true;
 }
 
 void LuaEngine::setAutoGarbageCollection(bool autoGarbageColleciton) {
-  lua_gc(m_state, LUA_GCSTOP, autoGarbageColleciton ? 1 : 0);
+  lua_gc(m_state, autoGarbageColleciton ? LUA_GCRESTART : LUA_GCSTOP, 0);
 }
 
 void LuaEngine::tuneAutoGarbageCollection(float pause, float stepMultiplier) {
@@ -613,15 +649,31 @@ void LuaEngine::countHook(lua_State* state, lua_Debug* ar) {
 
   auto self = luaEnginePtr(state);
 
+  // The hook runs every instruction while a traceback is requested, and is
+  // restored once it is captured or the request is taken back.
+  if (self->m_tracebackRequested.load(std::memory_order_relaxed) || lua_gethookcount(state) != (int)self->m_instructionMeasureInterval) {
+    if (self->m_tracebackRequested.exchange(false)) {
+      luaL_traceback(state, state, nullptr, 0);
+      MutexLocker locker(self->m_requestedTracebackMutex);
+      self->m_requestedTraceback = String(lua_tostring(state, -1));
+      lua_pop(state, 1);
+    }
+    self->updateCountHook();
+    return;
+  }
+
   // If the instruction count is 0, that means in this sequence of calls,
   // we have not hit a debug hook yet.  Since we don't know the state of
   // the internal lua instruction counter at the start, we don't know how
   // many instructions have been executed, only that it is >= 1 and <=
   // m_instructionMeasureInterval, so we pick the low estimate.
-  if (self->m_instructionCount == 0)
+  if (self->m_instructionCount == 0) {
     self->m_instructionCount = 1;
-  else
+    self->m_instructionsExecuted += 1;
+  } else {
     self->m_instructionCount += self->m_instructionMeasureInterval;
+    self->m_instructionsExecuted += self->m_instructionMeasureInterval;
+  }
 
   if (self->m_instructionLimit != 0 && self->m_instructionCount > self->m_instructionLimit) {
     lua_pushlightuserdata(state, &s_luaInstructionLimitExceptionKey);
@@ -674,6 +726,7 @@ void LuaEngine::countHook(lua_State* state, lua_Debug* ar) {
 }
 
 void* LuaEngine::allocate(void*, void* ptr, size_t oldSize, size_t newSize) {
+  MemoryTagScope memoryTag(MemoryTag::Lua);
   if (newSize == 0) {
     Star::free(ptr, oldSize);
     return nullptr;
@@ -1223,6 +1276,99 @@ void LuaEngine::pushLuaValue(lua_State* state, LuaValue const& luaValue) {
   luaValue.call(Pusher{this, state});
 }
 
+void LuaEngine::pushJson(lua_State* state, Json const& json) {
+  switch (json.type()) {
+    case Json::Type::Null:
+      lua_checkstack(state, 1);
+      lua_pushnil(state);
+      return;
+    case Json::Type::Float:
+      lua_checkstack(state, 1);
+      lua_pushnumber(state, json.toDouble());
+      return;
+    case Json::Type::Bool:
+      lua_checkstack(state, 1);
+      lua_pushboolean(state, json.toBool());
+      return;
+    case Json::Type::Int:
+      lua_checkstack(state, 1);
+      lua_pushinteger(state, json.toInt());
+      return;
+    case Json::Type::String: {
+      lua_checkstack(state, 1);
+      auto const& str = json.stringPtr()->utf8();
+      if (m_nullTerminated > 0)
+        lua_pushstring(state, str.data());
+      else
+        lua_pushlstring(state, str.data(), str.size());
+      return;
+    }
+    default:
+      break;
+  }
+
+  // The table, its nils table, and a key and value
+  lua_checkstack(state, 4);
+
+  int tableIndex;
+  int nilsIndex = 0;
+  auto addNil = [&]() {
+    // Created below the key that is on top of the stack
+    if (nilsIndex == 0) {
+      lua_newtable(state);
+      lua_insert(state, -2);
+      nilsIndex = lua_gettop(state) - 1;
+    }
+    lua_pushinteger(state, 0);
+    lua_rawset(state, nilsIndex);
+  };
+
+  if (json.isType(Json::Type::Array)) {
+    auto const& array = *json.arrayPtr();
+    lua_createtable(state, array.size(), 0);
+    tableIndex = lua_gettop(state);
+    for (size_t i = 0; i < array.size(); ++i) {
+      if (array[i]) {
+        pushJson(state, array[i]);
+        lua_rawseti(state, tableIndex, i + 1);
+      } else {
+        lua_pushinteger(state, i + 1);
+        addNil();
+      }
+    }
+  } else {
+    auto const& object = *json.objectPtr();
+    lua_createtable(state, 0, object.size());
+    tableIndex = lua_gettop(state);
+    for (auto const& pair : object) {
+      auto const& key = pair.first.utf8();
+      if (m_nullTerminated > 0)
+        lua_pushstring(state, key.data());
+      else
+        lua_pushlstring(state, key.data(), key.size());
+      if (pair.second) {
+        pushJson(state, pair.second);
+        lua_rawset(state, tableIndex);
+      } else {
+        addNil();
+      }
+    }
+  }
+
+  lua_createtable(state, 0, 3);
+  if (nilsIndex != 0) {
+    lua_pushvalue(state, nilsIndex);
+    LuaDetail::rawSetField(state, -2, "__nils");
+  }
+  lua_pushcfunction(state, LuaDetail::jsonContainerNewIndex);
+  LuaDetail::rawSetField(state, -2, "__newindex");
+  lua_pushinteger(state, json.isType(Json::Type::Array) ? 1 : 2);
+  LuaDetail::rawSetField(state, -2, "__typehint");
+  lua_setmetatable(state, tableIndex);
+
+  lua_settop(state, tableIndex);
+}
+
 LuaValue LuaEngine::popLuaValue(lua_State* state) {
   lua_checkstack(state, 1);
 
@@ -1348,25 +1494,41 @@ void LuaDetail::shallowCopy(lua_State* state, int sourceIndex, int targetIndex)
   }
 }
 
-LuaTable LuaDetail::insertJsonMetatable(LuaEngine& engine, LuaTable const& table, Json::Type type) {
-  auto newIndexMetaMethod = [](LuaTable const& table, LuaValue const& key, LuaValue const& value) {
-    auto mt = table.getMetatable();
-    auto nils = mt->rawGet<LuaTable>("__nils");
+int LuaDetail::jsonContainerNewIndex(lua_State* state) {
+  // table, key, value, metatable, nils
+  lua_settop(state, 3);
+  if (lua_getmetatable(state, 1)) {
+    rawGetField(state, 4, "__nils");
+    if (!lua_istable(state, 5) && lua_isnil(state, 3)) {
+      lua_pop(state, 1);
+      lua_newtable(state);
+      lua_pushvalue(state, -1);
+      rawSetField(state, 4, "__nils");
+    }
 
     // If we are setting an entry to nil, need to add a bogus integer entry
     // to the __nils table, otherwise need to set the entry *in* the __nils
     // table to nil and remove it.
-    if (value == LuaNil)
-      nils.rawSet(key, 0);
-    else
-      nils.rawSet(key, LuaNil);
-    table.rawSet(key, value);
-  };
+    if (lua_istable(state, 5)) {
+      lua_pushvalue(state, 2);
+      if (lua_isnil(state, 3))
+        lua_pushinteger(state, 0);
+      else
+        lua_pushnil(state);
+      lua_rawset(state, 5);
+    }
+    lua_settop(state, 3);
+  }
 
+  lua_rawset(state, 1);
+  return 0;
+}
+
+LuaTable LuaDetail::insertJsonMetatable(LuaEngine& engine, LuaTable const& table, Json::Type type) {
   auto mt = engine.createTable();
   auto nils = engine.createTable();
   mt.rawSet("__nils", nils);
-  mt.rawSet("__newindex", engine.createFunction(newIndexMetaMethod));
+  mt.rawSet("__newindex", engine.createRawFunction(jsonContainerNewIndex));
   mt.rawSet("__typehint", type == Json::Type::Array ? 1 : 2);
   table.setMetatable(mt);
   return nils;
@@ -1376,28 +1538,7 @@ LuaTable LuaDetail::jsonContainerToTable(LuaEngine& engine, Json const& containe
   if (!container.isType(Json::Type::Array) && !container.isType(Json::Type::Object))
     throw LuaException("jsonContainerToTable called on improper json type");
 
-  auto table = engine.createTable();
-  auto nils = insertJsonMetatable(engine, table, container.type());
-
-  if (container.isType(Json::Type::Array)) {
-    auto vlist = container.arrayPtr();
-    for (size_t i = 0; i < vlist->size(); ++i) {
-      auto const& val = (*vlist)[i];
-      if (val)
-        table.rawSet(i + 1, val);
-      else
-        nils.rawSet(i + 1, 0);
-    }
-  } else {
-    for (auto const& pair : *container.objectPtr()) {
-      if (pair.second)
-        table.rawSet(pair.first, pair.second);
-      else
-        nils.rawSet(pair.first, 0);
-    }
-  }
-
-  return table;
+  return engine.createJsonContainer(container);
 }
 
 Maybe<Json> LuaDetail::tableToJsonContainer(LuaTable const& table) {
@@ -509,6 +509,20 @@ public:
   void setInstructionMeasureInterval(unsigned measureInterval = 1000);
   unsigned instructionMeasureInterval() const;
 
+  // Total of every instruction count measurement since the engine was
+  // created, never reset.  Only counts while an instruction limit is set or
+  // profiling is enabled.
+  uint64_t instructionsExecuted() const;
+
+  // May be called from any thread.  Asks for a traceback of whatever script
+  // the engine is running, which is captured by the thread running it at the
+  // next instruction it executes on the main Lua thread.
+  void requestTraceback();
+  // Returns the requested traceback once it has been captured.  A request
+  // that is never captured is left pending, and is harmlessly captured the
+  // next time the engine runs Lua.
+  Maybe<String> takeRequestedTraceback();
+
   // Sets the LuaEngine recursion limit, limiting the number of times a
   // LuaEngine call may directly or inderectly trigger a call back into the
   // LuaEngine, preventing a C++ stack overflow.  0 disables the limit.
@@ -558,6 +572,11 @@ public:
   template <typename Container>
   LuaTable createArrayTable(Container const& array);
 
+  // Creates a json container table (see LuaDetail::jsonContainerToTable) from
+  // a JsonArray or JsonObject.  Nested values are pushed directly onto the
+  // stack rather than going through intermediate references.
+  LuaTable createJsonContainer(Json const& container);
+
   // Creates a function and deduces the signature of the function using
   // FunctionTraits.  As a convenience, the given function may optionally take
   // a LuaEngine& parameter as the first parameter, and if it does, when called
@@ -597,8 +616,9 @@ public:
   template <typename T>
   void setGlobal(char const* key, T value);
 
-  // Perform either a full or incremental garbage collection.
-  void collectGarbage(Maybe<unsigned> steps = {});
+  // Perform either a full or incremental garbage collection.  Returns true if
+  // a collection cycle finished.
+  bool collectGarbage(Maybe<unsigned> steps = {});
 
   // Stop / start automatic garbage collection
   void setAutoGarbageCollection(bool autoGarbageColleciton);
@@ -701,6 +721,9 @@ private:
   void pushLuaValue(lua_State* state, LuaValue const& luaValue);
   LuaValue popLuaValue(lua_State* state);
 
+  // Pushes a Json value, with containers as json container tables.
+  void pushJson(lua_State* state, Json const& json);
+
   template <typename T>
   size_t pushArgument(lua_State* state, T const& arg);
 
@@ -740,10 +763,14 @@ private:
   bool m_profilingEnabled;
   unsigned m_instructionMeasureInterval;
   uint64_t m_instructionCount;
+  uint64_t m_instructionsExecuted;
   unsigned m_recursionLevel;
   unsigned m_recursionLimit;
   int m_nullTerminated;
   HashMap<tuple<String, unsigned>, shared_ptr<LuaProfileEntry>> m_profileEntries;
+  atomic<bool> m_tracebackRequested;
+  Mutex m_requestedTracebackMutex;
+  Maybe<String> m_requestedTraceback;
   lua_Debug m_debugInfo;
 };
 
@@ -1481,6 +1508,10 @@ namespace LuaDetail {
   // index.
   void shallowCopy(lua_State* state, int sourceIndex, int targetIndex);
 
+  // __newindex of the json container metatable, keeps the __nils table up to
+  // date, creating it on the first nil assignment if the table has none.
+  int jsonContainerNewIndex(lua_State* state);
+
   LuaTable insertJsonMetatable(LuaEngine& engine, LuaTable const& table, Json::Type type);
 
   // Creates a custom lua table from a JsonArray or JsonObject that has
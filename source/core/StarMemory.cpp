@@ -20,89 +20,218 @@ namespace Star {
 
 #ifdef STAR_USE_JEMALLOC
 #ifdef STAR_JEMALLOC_IS_PREFIXED
-  void* malloc(size_t size) {
+  static void* rawMalloc(size_t size) {
     return je_malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* rawRealloc(void* ptr, size_t size) {
     return je_realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void rawFree(void* ptr) {
     je_free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void rawFree(void* ptr, size_t size) {
     if (ptr)
       je_sdallocx(ptr, size, 0);
   }
 #else
-  void* malloc(size_t size) {
+  static void* rawMalloc(size_t size) {
     return ::malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* rawRealloc(void* ptr, size_t size) {
     return ::realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void rawFree(void* ptr) {
     ::free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void rawFree(void* ptr, size_t size) {
     ::free(ptr);
   }
 #endif
 #elif STAR_USE_MIMALLOC
-  void* malloc(size_t size) {
+  static void* rawMalloc(size_t size) {
   return mi_malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* rawRealloc(void* ptr, size_t size) {
     return mi_realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void rawFree(void* ptr) {
     return mi_free(ptr);
   }
 
-  void free(void* ptr, size_t size) {
+  static void rawFree(void* ptr, size_t size) {
     return mi_free_size(ptr, size);
   }
 #elif STAR_USE_RPMALLOC
-  void* malloc(size_t size) {
+  static void* rawMalloc(size_t size) {
     return rpmalloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* rawRealloc(void* ptr, size_t size) {
     return rprealloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void rawFree(void* ptr) {
     return rpfree(ptr);
   }
 
-  void free(void* ptr, size_t) {
+  static void rawFree(void* ptr, size_t) {
     return rpfree(ptr);
   }
 #else
-  void* malloc(size_t size) {
+  static void* rawMalloc(size_t size) {
     return ::malloc(size);
   }
 
-  void* realloc(void* ptr, size_t size) {
+  static void* rawRealloc(void* ptr, size_t size) {
     return ::realloc(ptr, size);
   }
 
-  void free(void* ptr) {
+  static void rawFree(void* ptr) {
     return ::free(ptr);
   }
 
-  void free(void* ptr, size_t) {
+  static void rawFree(void* ptr, size_t) {
     return ::free(ptr);
   }
 #endif
 
+#ifdef STAR_MEMORY_STATISTICS
+// Allocations are prefixed with their size and tag, so that freeing them
+// can take them off the live bytes of the tag they were made under.
+struct alignas(std::max_align_t) AllocationHeader {
+  size_t size;
+  MemoryTag tag;
+};
+
+struct TagCounters {
+  atomic<int64_t> liveBytes;
+  atomic<uint64_t> allocations;
+  atomic<uint64_t> allocatedBytes;
+};
+
+static TagCounters s_tagCounters[MemoryTagCount];
+
+thread_local MemoryTag t_memoryTag = MemoryTag::Untagged;
+// Kept per thread so that counting never contends between threads
+static thread_local uint64_t t_allocations = 0;
+static thread_local uint64_t t_allocatedBytes = 0;
+
+static inline void* track(void* raw, size_t size, MemoryTag tag) {
+  if (!raw)
+    return nullptr;
+
+  auto header = (AllocationHeader*)raw;
+  header->size = size;
+  header->tag = tag;
+
+  auto& counters = s_tagCounters[(size_t)tag];
+  counters.liveBytes.fetch_add(size, std::memory_order_relaxed);
+  counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  ++t_allocations;
+  t_allocatedBytes += size;
+
+  return header + 1;
+}
+
+static inline AllocationHeader* untrack(void* ptr) {
+  auto header = (AllocationHeader*)ptr - 1;
+  s_tagCounters[(size_t)header->tag].liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+  return header;
+}
+
+void* malloc(size_t size) {
+  return track(rawMalloc(size + sizeof(AllocationHeader)), size, t_memoryTag);
+}
+
+void* realloc(void* ptr, size_t size) {
+  if (!ptr)
+    return malloc(size);
+
+  // Reallocated memory stays with the tag it was first allocated under
+  MemoryTag tag = ((AllocationHeader*)ptr - 1)->tag;
+  auto header = untrack(ptr);
+  if (auto raw = rawRealloc(header, size + sizeof(AllocationHeader)))
+    return track(raw, size, tag);
+
+  // The original allocation is still valid
+  s_tagCounters[(size_t)tag].liveBytes.fetch_add(header->size, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void free(void* ptr) {
+  if (ptr)
+    rawFree(untrack(ptr));
+}
+
+void free(void* ptr, size_t) {
+  if (ptr) {
+    auto header = untrack(ptr);
+    rawFree(header, header->size + sizeof(AllocationHeader));
+  }
+}
+
+MemoryStatistics threadMemoryStatistics() {
+  return {true, t_allocations, t_allocatedBytes};
+}
+
+MemoryTagStatistics memoryTagStatistics(MemoryTag tag) {
+  auto const& counters = s_tagCounters[(size_t)tag];
+  return {
+    counters.liveBytes.load(std::memory_order_relaxed),
+    counters.allocations.load(std::memory_order_relaxed),
+    counters.allocatedBytes.load(std::memory_order_relaxed)
+  };
+}
+#else
+void* malloc(size_t size) {
+  return rawMalloc(size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  return rawRealloc(ptr, size);
+}
+
+void free(void* ptr) {
+  rawFree(ptr);
+}
+
+void free(void* ptr, size_t size) {
+  rawFree(ptr, size);
+}
+
+MemoryStatistics threadMemoryStatistics() {
+  return {false, 0, 0};
+}
+
+MemoryTagStatistics memoryTagStatistics(MemoryTag) {
+  return {0, 0, 0};
+}
+#endif
+
+char const* memoryTagName(MemoryTag tag) {
+  switch (tag) {
+    case MemoryTag::Assets:
+      return "assets";
+    case MemoryTag::Lua:
+      return "lua";
+    case MemoryTag::Tiles:
+      return "tiles";
+    case MemoryTag::Network:
+      return "network";
+    default:
+      return "untagged";
+  }
+}
+
 }
 
 #ifndef  STAR_USE_RPMALLOC
@@ -14,4 +14,74 @@ void* realloc(void* ptr, size_t size);
 void free(void* ptr);
 void free(void* ptr, size_t size);
 
+struct MemoryStatistics {
+  // False unless built with STAR_MEMORY_STATISTICS, as counting adds to the
+  // cost of every allocation.
+  bool counted;
+  // Calls to malloc and realloc, and the bytes they asked for.
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+};
+
+// Allocations made by the calling thread since it started.
+MemoryStatistics threadMemoryStatistics();
+
+// Subsystems that allocations can be attributed to with MemoryTagScope
+enum class MemoryTag : uint8_t {
+  Untagged,
+  Assets,
+  Lua,
+  Tiles,
+  Network
+};
+size_t const MemoryTagCount = 5;
+
+char const* memoryTagName(MemoryTag tag);
+
+// Attributes allocations the current thread makes during the lifetime of the
+// scope to the given tag, until another scope is nested inside it.  Does
+// nothing unless built with STAR_MEMORY_STATISTICS.
+class MemoryTagScope {
+public:
+  MemoryTagScope(MemoryTag tag);
+  ~MemoryTagScope();
+
+  MemoryTagScope(MemoryTagScope const&) = delete;
+  MemoryTagScope& operator=(MemoryTagScope const&) = delete;
+
+#ifdef STAR_MEMORY_STATISTICS
+private:
+  MemoryTag m_previous;
+#endif
+};
+
+struct MemoryTagStatistics {
+  // Bytes allocated under the tag that have not been freed yet
+  int64_t liveBytes;
+  // Allocations made under the tag since startup, and the bytes they asked
+  // for, for finding allocation rates.
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+};
+
+// Allocations attributed to the given tag by every thread, always zero unless
+// built with STAR_MEMORY_STATISTICS.
+MemoryTagStatistics memoryTagStatistics(MemoryTag tag);
+
+#ifdef STAR_MEMORY_STATISTICS
+extern thread_local MemoryTag t_memoryTag;
+
+inline MemoryTagScope::MemoryTagScope(MemoryTag tag) : m_previous(t_memoryTag) {
+  t_memoryTag = tag;
+}
+
+inline MemoryTagScope::~MemoryTagScope() {
+  t_memoryTag = m_previous;
+}
+#else
+inline MemoryTagScope::MemoryTagScope(MemoryTag) {}
+
+inline MemoryTagScope::~MemoryTagScope() {}
+#endif
+
 }
@@ -0,0 +1,163 @@
+#include "StarMetrics.hpp"
+
+namespace Star {
+
+namespace {
+  String escapeLabelValue(String const& value) {
+    String escaped;
+    for (auto c : value) {
+      if (c == '\\')
+        escaped += "\\\\";
+      else if (c == '"')
+        escaped += "\\\"";
+      else if (c == '\n')
+        escaped += "\\n";
+      else
+        escaped += c;
+    }
+    return escaped;
+  }
+
+  String printLabels(Metrics::Labels const& labels, Maybe<String> const& le = {}) {
+    if (labels.empty() && !le)
+      return "";
+
+    StringList parts;
+    for (auto const& label : labels)
+      parts.append(strf("{}=\"{}\"", label.first, escapeLabelValue(label.second)));
+    if (le)
+      parts.append(strf("le=\"{}\"", *le));
+    return strf("{{{}}}", parts.join(","));
+  }
+
+  String printValue(double value) {
+    if (std::isnan(value))
+      return "NaN";
+    if (std::isinf(value))
+      return value > 0 ? "+Inf" : "-Inf";
+    return strf("{}", value);
+  }
+
+  char const* typeName(Metrics::Type type) {
+    if (type == Metrics::Type::Counter)
+      return "counter";
+    else if (type == Metrics::Type::Gauge)
+      return "gauge";
+    else
+      return "histogram";
+  }
+}
+
+List<double> const Metrics::DefaultBuckets = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+Mutex Metrics::s_mutex;
+Map<String, Metrics::Metric> Metrics::s_metrics;
+
+void Metrics::describe(String const& name, Type type, String const& help, List<double> buckets) {
+  MutexLocker locker(s_mutex);
+  if (auto metric = s_metrics.ptr(name)) {
+    if (metric->type != type)
+      throw MetricsException::format("Metric '{}' described as a {} but already used as a {}", name, typeName(type), typeName(metric->type));
+    metric->help = help;
+    return;
+  }
+
+  if (type == Type::Histogram && buckets.empty())
+    buckets = DefaultBuckets;
+  s_metrics.add(name, Metric{type, help, buckets.sorted(), {}});
+}
+
+void Metrics::setGauge(String const& name, Labels const& labels, double value) {
+  MutexLocker locker(s_mutex);
+  series(name, Type::Gauge, labels).value = value;
+}
+
+void Metrics::addCounter(String const& name, Labels const& labels, double value) {
+  MutexLocker locker(s_mutex);
+  series(name, Type::Counter, labels).value += value;
+}
+
+void Metrics::setCounter(String const& name, Labels const& labels, double value) {
+  MutexLocker locker(s_mutex);
+  series(name, Type::Counter, labels).value = value;
+}
+
+void Metrics::observe(String const& name, Labels const& labels, double value) {
+  MutexLocker locker(s_mutex);
+  auto& s = series(name, Type::Histogram, labels);
+  auto const& buckets = s_metrics.get(name).buckets;
+  size_t bucket = 0;
+  while (bucket < buckets.size() && value > buckets[bucket])
+    ++bucket;
+  ++s.bucketCounts[bucket];
+  ++s.count;
+  s.value += value;
+}
+
+void Metrics::removeSeries(String const& labelName, String const& labelValue) {
+  MutexLocker locker(s_mutex);
+  for (auto& metric : s_metrics) {
+    eraseWhere(metric.second.series, [&](auto const& p) {
+        return p.second.labels.contains(make_pair(labelName, labelValue));
+      });
+  }
+}
+
+String Metrics::exposition() {
+  MutexLocker locker(s_mutex);
+  String output;
+  for (auto const& metricPair : s_metrics) {
+    auto const& name = metricPair.first;
+    auto const& metric = metricPair.second;
+    if (metric.series.empty())
+      continue;
+
+    if (!metric.help.empty())
+      output += strf("# HELP {} {}\n", name, metric.help.replace("\\", "\\\\").replace("\n", "\\n"));
+    output += strf("# TYPE {} {}\n", name, typeName(metric.type));
+
+    for (auto const& seriesPair : metric.series) {
+      auto const& s = seriesPair.second;
+      if (metric.type != Type::Histogram) {
+        output += strf("{}{} {}\n", name, seriesPair.first, printValue(s.value));
+        continue;
+      }
+
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i <= metric.buckets.size(); ++i) {
+        cumulative += s.bucketCounts[i];
+        String le = i < metric.buckets.size() ? printValue(metric.buckets[i]) : "+Inf";
+        output += strf("{}_bucket{} {}\n", name, printLabels(s.labels, le), cumulative);
+      }
+      output += strf("{}_sum{} {}\n", name, seriesPair.first, printValue(s.value));
+      output += strf("{}_count{} {}\n", name, seriesPair.first, s.count);
+    }
+  }
+  return output;
+}
+
+void Metrics::clear() {
+  MutexLocker locker(s_mutex);
+  s_metrics.clear();
+}
+
+auto Metrics::series(String const& name, Type type, Labels const& labels) -> Series& {
+  auto metric = s_metrics.ptr(name);
+  if (!metric) {
+    metric = &s_metrics.add(name, Metric{type, {}, type == Type::Histogram ? DefaultBuckets : List<double>(), {}});
+  } else if (metric->type != type) {
+    throw MetricsException::format("Metric '{}' used as a {} but it is a {}", name, typeName(type), typeName(metric->type));
+  }
+
+  String key = printLabels(labels);
+  auto s = metric->series.ptr(key);
+  if (!s) {
+    s = &metric->series[key];
+    s->labels = labels;
+    if (type == Type::Histogram)
+      s->bucketCounts.resize(metric->buckets.size() + 1, 0);
+  }
+  return *s;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "StarMap.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_EXCEPTION(MetricsException, StarException);
+
+// Process wide registry of numeric metrics, for scraping and alerting on
+// rather than reading by eye like LogMap.  Each metric has a name and any
+// number of series told apart by their labels, e.g. the world a value
+// belongs to.  Exported in the Prometheus text exposition format.
+class Metrics {
+public:
+  enum class Type {
+    Counter,
+    Gauge,
+    Histogram
+  };
+
+  typedef List<pair<String, String>> Labels;
+
+  // Bucket upper bounds used for histograms that are not given any.
+  static List<double> const DefaultBuckets;
+
+  // Sets the help text of a metric and, for histograms, its bucket upper
+  // bounds.  Optional, metrics are otherwise created on first use with the
+  // type they are used as.
+  static void describe(String const& name, Type type, String const& help, List<double> buckets = {});
+
+  static void setGauge(String const& name, Labels const& labels, double value);
+  static void addCounter(String const& name, Labels const& labels, double value = 1.0);
+  // For counters that are already accumulated elsewhere
+  static void setCounter(String const& name, Labels const& labels, double value);
+  static void observe(String const& name, Labels const& labels, double value);
+
+  // Removes every series of every metric with the given label value, for
+  // when the thing being measured goes away.
+  static void removeSeries(String const& labelName, String const& labelValue);
+
+  static String exposition();
+
+  static void clear();
+
+private:
+  struct Series {
+    Labels labels;
+    double value = 0.0;
+    // Non cumulative counts of each histogram bucket, the last being +Inf
+    List<uint64_t> bucketCounts;
+    uint64_t count = 0;
+  };
+
+  struct Metric {
+    Type type;
+    String help;
+    List<double> buckets;
+    Map<String, Series> series;
+  };
+
+  static Series& series(String const& name, Type type, Labels const& labels);
+
+  static Mutex s_mutex;
+  static Map<String, Metric> s_metrics;
+};
+
+}
@@ -271,6 +271,9 @@ void NetElementDynamicGroup<Element>::readNetDelta(DataStream& ds, float interpo
           DataStreamBuffer storeBuffer(std::move(get<1>(*addition)));
           element->netLoad(storeBuffer, rules);
           readyElement(element);
+          // Deltas written from an acknowledged version may repeat additions
+          // that were already read, the newer addition replaces the element.
+          m_idMap.remove(get<0>(*addition));
           m_idMap.add(get<0>(*addition), std::move(element));
         } else if (auto removal = changeUpdate.template ptr<ElementRemoval>()) {
           m_idMap.remove(*removal);
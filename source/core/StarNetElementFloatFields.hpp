@@ -28,6 +28,19 @@ public:
   // functions at all.
   void setInterpolator(function<T(T, T, T)> interpolator);
 
+  // If set, once interpolation runs past the last data point, the value is
+  // dead reckoned from that point with the last received value of the given
+  // rate (in units per second), rather than continuing the line through the
+  // last two data points.  Extrapolation is still limited by the
+  // extrapolationHint.
+  void setExtrapolationRate(NetElementFloating const* rate);
+
+  // If set, when a new data point moves the value away from where
+  // extrapolation had taken it, the difference is smoothed out with the given
+  // time constant in seconds instead of jumping.  Differences larger than
+  // maxCorrection are treated as discontinuities and jump as before.
+  void setCorrectionSmoothing(float correctionTime, T maxCorrection);
+
   void initNetVersion(NetElementVersion const* version = nullptr) override;
 
   // Values are never interpolated, but they will be delayed for the given
@@ -48,6 +61,11 @@ private:
   T readValue(DataStream& ds) const;
 
   T interpolate() const;
+  T latestValue() const;
+  // Sets m_value to the interpolated value plus any remaining correction,
+  // first carrying over the difference from the old value if correcting is
+  // true.
+  void updateInterpolatedValue(bool correcting);
 
   Maybe<T> m_fixedPointBase;
   NetElementVersion const* m_netVersion = nullptr;
@@ -56,6 +74,10 @@ private:
 
   function<T(T, T, T)> m_interpolator;
   float m_extrapolation = 0.0f;
+  NetElementFloating const* m_extrapolationRate = nullptr;
+  float m_correctionTime = 0.0f;
+  T m_maxCorrection = T();
+  T m_correction = T();
   Maybe<Deque<pair<float, T>>> m_interpolationDataPoints;
 };
 
@@ -76,6 +98,7 @@ void NetElementFloating<T>::set(T value) {
       m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
 
     m_value = value;
+    m_correction = T();
 
     if (m_interpolationDataPoints) {
       m_interpolationDataPoints->clear();
@@ -94,6 +117,17 @@ void NetElementFloating<T>::setInterpolator(function<T(T, T, T)> interpolator) {
   m_interpolator = std::move(interpolator);
 }
 
+template <typename T>
+void NetElementFloating<T>::setExtrapolationRate(NetElementFloating const* rate) {
+  m_extrapolationRate = rate;
+}
+
+template <typename T>
+void NetElementFloating<T>::setCorrectionSmoothing(float correctionTime, T maxCorrection) {
+  m_correctionTime = correctionTime;
+  m_maxCorrection = maxCorrection;
+}
+
 template <typename T>
 void NetElementFloating<T>::initNetVersion(NetElementVersion const* version) {
   m_netVersion = version;
@@ -114,6 +148,7 @@ void NetElementFloating<T>::disableNetInterpolation() {
   if (m_interpolationDataPoints) {
     m_value = m_interpolationDataPoints->last().second;
     m_interpolationDataPoints.reset();
+    m_correction = T();
   }
 }
 
@@ -126,7 +161,9 @@ void NetElementFloating<T>::tickNetInterpolation(float dt) {
     while (m_interpolationDataPoints->size() > 2 && (*m_interpolationDataPoints)[1].first <= 0.0f)
       m_interpolationDataPoints->removeFirst();
 
-    m_value = interpolate();
+    if (m_correction != T())
+      m_correction *= std::exp(-dt / m_correctionTime);
+    updateInterpolatedValue(false);
   }
 }
 
@@ -143,6 +180,7 @@ template <typename T>
 void NetElementFloating<T>::netLoad(DataStream& ds, NetCompatibilityRules rules) {
   if (!checkWithRules(rules)) return;
   m_value = readValue(ds);
+  m_correction = T();
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
   if (m_interpolationDataPoints) {
     m_interpolationDataPoints->clear();
@@ -174,7 +212,7 @@ void NetElementFloating<T>::readNetDelta(DataStream& ds, float interpolationTime
     if (interpolationTime < m_interpolationDataPoints->last().first)
       m_interpolationDataPoints->clear();
     m_interpolationDataPoints->append({interpolationTime, t});
-    m_value = interpolate();
+    updateInterpolatedValue(true);
   } else {
     m_value = t;
   }
@@ -191,7 +229,7 @@ void NetElementFloating<T>::blankNetDelta(float interpolationTime) {
     else
       m_interpolationDataPoints->append(lastPoint);
 
-    m_value = interpolate();
+    updateInterpolatedValue(true);
   }
 }
 
@@ -225,6 +263,15 @@ T NetElementFloating<T>::interpolate() const {
       });
   auto bound = getBound2(ipos, dataPoints.size(), BoundMode::Extrapolate);
 
+  auto const& lastPoint = dataPoints.last();
+  if (m_extrapolationRate && m_interpolator && lastPoint.first < 0.0f) {
+    // Allowed as far past the last point as the line through the last two
+    // would have been.
+    float stepDist = dataPoints.size() > 1 ? lastPoint.first - dataPoints[dataPoints.size() - 2].first : 0.0f;
+    float extrapolationTime = min(-lastPoint.first, m_extrapolation * clamp(stepDist, 0.0f, 1.0f));
+    return lastPoint.second + m_extrapolationRate->latestValue() * extrapolationTime;
+  }
+
   if (m_interpolator) {
     auto const& minPoint = dataPoints[bound.i0];
     auto const& maxPoint = dataPoints[bound.i1];
@@ -244,4 +291,22 @@ T NetElementFloating<T>::interpolate() const {
   }
 }
 
+template <typename T>
+T NetElementFloating<T>::latestValue() const {
+  if (m_interpolationDataPoints)
+    return m_interpolationDataPoints->last().second;
+  return m_value;
+}
+
+template <typename T>
+void NetElementFloating<T>::updateInterpolatedValue(bool correcting) {
+  T value = interpolate();
+  if (correcting && m_correctionTime > 0.0f) {
+    m_correction = m_value - value;
+    if (std::fabs(m_correction) > m_maxCorrection)
+      m_correction = T();
+  }
+  m_value = value + m_correction;
+}
+
 }
@@ -2,6 +2,8 @@
 
 namespace Star {
 
+static thread_local List<size_t>* t_fieldBytes = nullptr;
+
 void NetElementGroup::addNetElement(NetElement* element, bool propagateInterpolation) {
   starAssert(!m_elements.any([element](auto p) { return p.first == element; }));
 
@@ -70,21 +72,69 @@ void NetElementGroup::tickNetInterpolation(float dt) {
 bool NetElementGroup::writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCompatibilityRules rules) const {
   if (!checkWithRules(rules)) return false;
 
+  List<size_t>* fieldBytes = t_fieldBytes;
+  if (fieldBytes)
+    t_fieldBytes = nullptr;
+  auto restoreFieldBytes = finally([fieldBytes]() {
+      if (fieldBytes)
+        t_fieldBytes = fieldBytes;
+    });
+  auto countField = [fieldBytes](size_t field, size_t bytes) {
+    if (fieldBytes->size() <= field)
+      fieldBytes->resize(field + 1, 0);
+    (*fieldBytes)[field] += bytes;
+  };
+
   auto expectedSize = m_elementCounts.maybe(rules.version()).value(m_elements.size());
 
   if (expectedSize == 0) {
     return false;
   } else if (expectedSize == 1) {
-    for (auto& element : m_elements) {
+    for (size_t field = 0; field < m_elements.size(); ++field) {
+      auto& element = m_elements[field];
       if (element.first->checkWithRules(rules)) {
-        return element.first->writeNetDelta(ds, fromVersion, rules);
+        if (!fieldBytes)
+          return element.first->writeNetDelta(ds, fromVersion, rules);
+
+        m_buffer.clear();
+        m_buffer.setStreamCompatibilityVersion(rules);
+        bool deltaWritten = element.first->writeNetDelta(m_buffer, fromVersion, rules);
+        countField(field, m_buffer.size());
+        ds.writeBytes(m_buffer.data());
+        m_buffer.clear();
+        return deltaWritten;
       }
     }
+  } else if (rules.version() >= 17 && expectedSize <= 64) {
+    // Changed elements are flagged in a VLQ bitmask ahead of their deltas,
+    // rather than each delta being preceded by its index.
+    uint64_t changedMask = 0;
+    uint64_t i = 0;
+    m_buffer.clear();
+    m_buffer.setStreamCompatibilityVersion(rules);
+    for (size_t field = 0; field < m_elements.size(); ++field) {
+      auto& element = m_elements[field];
+      if (!element.first->checkWithRules(rules))
+        continue;
+      size_t startSize = m_buffer.size();
+      if (element.first->writeNetDelta(m_buffer, fromVersion, rules))
+        changedMask |= (uint64_t)1 << i;
+      if (fieldBytes)
+        countField(field, m_buffer.size() - startSize);
+      ++i;
+    }
+    if (changedMask == 0)
+      return false;
+    ds.writeVlqU(changedMask);
+    ds.writeBytes(m_buffer.data());
+    m_buffer.clear();
+    return true;
   } else {
     bool deltaWritten = false;
     uint64_t i = 0;
     m_buffer.setStreamCompatibilityVersion(rules);
-    for (auto& element : m_elements) {
+    for (size_t field = 0; field < m_elements.size(); ++field) {
+      auto& element = m_elements[field];
       if (i > expectedSize)
         break;
       if (!element.first->checkWithRules(rules))
@@ -93,6 +143,8 @@ bool NetElementGroup::writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCom
 
       if (element.first->writeNetDelta(m_buffer, fromVersion, rules)) {
         deltaWritten = true;
+        if (fieldBytes)
+          countField(field, m_buffer.size());
         ds.writeVlqU(i);
         ds.writeBytes(m_buffer.data());
         m_buffer.clear();
@@ -105,6 +157,10 @@ bool NetElementGroup::writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCom
   return false;
 }
 
+void NetElementGroup::setThreadFieldBytes(List<size_t>* fieldBytes) {
+  t_fieldBytes = fieldBytes;
+}
+
 void NetElementGroup::readNetDelta(DataStream& ds, float interpolationTime, NetCompatibilityRules rules) {
   if (!checkWithRules(rules))
     return;
@@ -119,6 +175,18 @@ void NetElementGroup::readNetDelta(DataStream& ds, float interpolationTime, NetC
         element.first->readNetDelta(ds, interpolationTime, rules);
         break;
       }
+  } else if (rules.version() >= 17 && expectedSize <= 64) {
+    uint64_t changedMask = ds.readVlqU();
+    uint64_t i = 0;
+    for (auto& element : m_elements) {
+      if (!element.first->checkWithRules(rules))
+        continue;
+      if (changedMask & ((uint64_t)1 << i))
+        element.first->readNetDelta(ds, interpolationTime, rules);
+      else if (m_interpolationEnabled)
+        element.first->blankNetDelta(interpolationTime);
+      ++i;
+    }
   } else {
     uint64_t readIndex = ds.readVlqU();
     uint64_t i = 0;
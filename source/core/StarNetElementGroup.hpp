@@ -32,6 +32,11 @@ public:
   void tickNetInterpolation(float dt) override;
 
   bool writeNetDelta(DataStream& ds, uint64_t fromVersion, NetCompatibilityRules rules = {}) const override;
+  // While a list is set here, the outermost group to write a delta on this
+  // thread adds the bytes each of its elements wrote to the entry at the
+  // element's index, for finding out which fields are costly to network.
+  // Nested groups are counted as a single field of the outermost group.
+  static void setThreadFieldBytes(List<size_t>* fieldBytes);
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0f, NetCompatibilityRules rules = {}) override;
   void blankNetDelta(float interpolationTime) override;
 
@@ -41,6 +41,7 @@ private:
   bool m_netInterpolationEnabled = false;
   Deque<SignalEntry> m_signals;
   Deque<pair<float, Signal>> m_pendingSignals;
+  uint64_t m_lastReadVersion = 0;
 };
 
 template <typename Signal>
@@ -96,8 +97,11 @@ bool NetElementSignal<Signal>::writeNetDelta(DataStream& ds, uint64_t fromVersio
   ds.writeVlqU(numToWrite);
 
   for (auto const& p : m_signals) {
-    if (p.version >= fromVersion)
+    if (p.version >= fromVersion) {
+      if (rules.version() >= 18)
+        ds.writeVlqU(p.version);
       ds.write(p.signal);
+    }
   }
 
   return true;
@@ -107,9 +111,18 @@ template <typename Signal>
 void NetElementSignal<Signal>::readNetDelta(DataStream& ds, float interpolationTime, NetCompatibilityRules rules) {
   if (!checkWithRules(rules)) return;
   size_t numToRead = ds.readVlqU();
+  uint64_t lastReadVersion = m_lastReadVersion;
   for (size_t i = 0; i < numToRead; ++i) {
+    // Signals carry the sender's version, so that signals already read are
+    // skipped when a delta is written again from an older version.
+    uint64_t version = rules.version() >= 18 ? ds.readVlqU() : 0;
     Signal s;
     ds.read(s);
+    if (version != 0) {
+      lastReadVersion = max(lastReadVersion, version);
+      if (version <= m_lastReadVersion)
+        continue;
+    }
     if (m_netInterpolationEnabled && interpolationTime > 0.0f) {
       if (!m_pendingSignals.empty() && m_pendingSignals.last().first > interpolationTime) {
         for (auto& p : take(m_pendingSignals))
@@ -120,6 +133,7 @@ void NetElementSignal<Signal>::readNetDelta(DataStream& ds, float interpolationT
       send(std::move(s));
     }
   }
+  m_lastReadVersion = lastReadVersion;
 }
 
 template <typename Signal>
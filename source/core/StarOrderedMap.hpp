@@ -535,10 +535,8 @@ auto OrderedMapWrapper<Map, Key, Value, Allocator, MapArgs...>::takeFirst() -> v
   if (empty())
     throw MapException("OrderedMap::takeFirst() called on empty OrderedMap");
 
-  iterator i = m_order.begin();
-  m_map.remove(i->first);
-  value_type v = *i;
-  m_order.erase(i);
+  value_type v = std::move(*m_order.begin());
+  erase(begin());
   return v;
 }
 
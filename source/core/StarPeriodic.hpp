@@ -30,6 +30,12 @@ public:
     return m_everyXSteps != 0 && m_counter == 0;
   }
 
+  // How many calls to tick() will return false before one returns true, only
+  // meaningful if the step count is not 0.
+  unsigned stepsUntilReady() const {
+    return m_counter;
+  }
+
   bool tick() {
     if (m_everyXSteps == 0)
       return false;
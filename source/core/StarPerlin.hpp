@@ -40,6 +40,11 @@ public:
   Float get(Float x, Float y) const;
   Float get(Float x, Float y, Float z) const;
 
+  // Evaluates count points at once, writing get(xs[i], ys[i]) to out[i], for
+  // callers that need a whole row or block of samples.  Dispatches on the
+  // noise type once for the batch rather than once per point.
+  void get(Float const* xs, Float const* ys, Float* out, size_t count) const;
+
   PerlinType type() const;
 
   unsigned octaves() const;
@@ -310,6 +315,26 @@ Float Perlin<Float>::get(Float x, Float y, Float z) const {
   }
 }
 
+template <typename Float>
+void Perlin<Float>::get(Float const* xs, Float const* ys, Float* out, size_t count) const {
+  switch (m_type) {
+    case PerlinType::Perlin:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = perlin(xs[i], ys[i]);
+      break;
+    case PerlinType::Billow:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = billow(xs[i], ys[i]);
+      break;
+    case PerlinType::RidgedMulti:
+      for (size_t i = 0; i < count; ++i)
+        out[i] = ridgedMulti(xs[i], ys[i]);
+      break;
+    default:
+      throw PerlinException("::get called on uninitialized Perlin");
+  }
+}
+
 template <typename Float>
 PerlinType Perlin<Float>::type() const {
   return m_type;
@@ -130,6 +130,14 @@ public:
   // Normal SAT intersection finding the shortest separation of two convex
   // polys.
   IntersectResult satIntersection(Polygon const& p) const;
+  // The same intersection with the side normals of both polys already
+  // calculated by sideNormals(), for polys that are tested many times.
+  // Normals are unaffected by translating a poly.
+  IntersectResult satIntersection(Polygon const& p, VertexList const& normals, VertexList const& pNormals) const;
+
+  // The normals of every side with a non-zero length, the axes tested by
+  // satIntersection.
+  VertexList sideNormals() const;
 
   // A directional version of a SAT intersection that will only separate
   // parallel to the given direction.  If choseSign is true, then the
@@ -148,6 +156,12 @@ private:
   // i must be between 0 and m_vertexes.size() - 1
   Line sideAt(size_t i) const;
 
+  // "Accumulates" the shortest separating distance and axis of this poly and
+  // the given poly, after projecting all the vertexes of each poly onto a
+  // given axis.  Used by SAT intersection, meant to be called with each tested
+  // axis.
+  void accumSeparator(Polygon const& p, Vertex const& axis, DataType& shortestOverlap, Vertex& finalSepDir) const;
+
   VertexList m_vertexes;
 };
 
@@ -538,33 +552,6 @@ bool Polygon<DataType>::contains(Vertex const& p) const {
 
 template <typename DataType>
 typename Polygon<DataType>::IntersectResult Polygon<DataType>::satIntersection(Polygon const& p) const {
-  // "Accumulates" the shortest separating distance and axis of this poly and
-  // the given poly, after projecting all the vertexes of each poly onto a
-  // given axis.  Used by SAT intersection, meant to be called with each tested
-  // axis.
-  auto accumSeparator = [this](Polygon const& p, Vertex const& axis, DataType& shortestOverlap, Vertex& finalSepDir) {
-    DataType myProjectionLow = std::numeric_limits<DataType>::max();
-    DataType targetProjectionHigh = std::numeric_limits<DataType>::lowest();
-
-    for (auto const& v : m_vertexes) {
-      DataType p = axis[0] * v[0] + axis[1] * v[1];
-      if (p < myProjectionLow)
-        myProjectionLow = p;
-    }
-
-    for (auto const& v : p.m_vertexes) {
-      DataType p = axis[0] * v[0] + axis[1] * v[1];
-      if (p > targetProjectionHigh)
-        targetProjectionHigh = p;
-    }
-
-    float overlap = targetProjectionHigh - myProjectionLow;
-    if (overlap < shortestOverlap) {
-      shortestOverlap = overlap;
-      finalSepDir = axis;
-    }
-  };
-
   DataType overlap = std::numeric_limits<DataType>::max();
   Vertex separatingDir = Vertex();
 
@@ -599,6 +586,41 @@ typename Polygon<DataType>::IntersectResult Polygon<DataType>::satIntersection(P
   return isect;
 }
 
+template <typename DataType>
+typename Polygon<DataType>::IntersectResult Polygon<DataType>::satIntersection(
+    Polygon const& p, VertexList const& normals, VertexList const& pNormals) const {
+  DataType overlap = std::numeric_limits<DataType>::max();
+  Vertex separatingDir = Vertex();
+
+  for (auto const& sideNormal : normals)
+    accumSeparator(p, -sideNormal, overlap, separatingDir);
+
+  for (auto const& sideNormal : pNormals)
+    accumSeparator(p, sideNormal, overlap, separatingDir);
+
+  IntersectResult isect;
+  isect.intersects = (overlap > 0);
+  isect.overlap = separatingDir * overlap;
+
+  return isect;
+}
+
+template <typename DataType>
+auto Polygon<DataType>::sideNormals() const -> VertexList {
+  VertexList normals;
+  if (!m_vertexes.empty()) {
+    normals.reserve(m_vertexes.size());
+    Vertex pv = m_vertexes[m_vertexes.size() - 1];
+    for (auto const& v : m_vertexes) {
+      Vertex sideNormal = pv - v;
+      if (sideNormal != Vertex())
+        normals.append(sideNormal.rot90().normalized());
+      pv = v;
+    }
+  }
+  return normals;
+}
+
 template <typename DataType>
 typename Polygon<DataType>::IntersectResult Polygon<DataType>::directionalSatIntersection(
     Polygon const& p, Vertex const& direction, bool chooseSign) const {
@@ -724,6 +746,30 @@ bool Polygon<DataType>::intersects(Line const& l) const {
   return false;
 }
 
+template <typename DataType>
+void Polygon<DataType>::accumSeparator(Polygon const& p, Vertex const& axis, DataType& shortestOverlap, Vertex& finalSepDir) const {
+  DataType myProjectionLow = std::numeric_limits<DataType>::max();
+  DataType targetProjectionHigh = std::numeric_limits<DataType>::lowest();
+
+  for (auto const& v : m_vertexes) {
+    DataType p = axis[0] * v[0] + axis[1] * v[1];
+    if (p < myProjectionLow)
+      myProjectionLow = p;
+  }
+
+  for (auto const& v : p.m_vertexes) {
+    DataType p = axis[0] * v[0] + axis[1] * v[1];
+    if (p > targetProjectionHigh)
+      targetProjectionHigh = p;
+  }
+
+  float overlap = targetProjectionHigh - myProjectionLow;
+  if (overlap < shortestOverlap) {
+    shortestOverlap = overlap;
+    finalSepDir = axis;
+  }
+}
+
 template <typename DataType>
 auto Polygon<DataType>::sideAt(size_t i) const -> Line {
   if (i == m_vertexes.size() - 1)
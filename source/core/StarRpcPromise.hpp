@@ -32,6 +32,9 @@ public:
   static pair<RpcPromise, RpcPromiseKeeper<Result, Error>> createPair();
   static RpcPromise createFulfilled(Result result);
   static RpcPromise createFailed(Error error);
+  // A promise that succeeds once all of the given promises have finished,
+  // with the result of each one in order, or nothing for those that failed.
+  static RpcPromise<List<Maybe<Result>>, Error> all(List<RpcPromise> promises);
 
   // Has the respoonse either failed or succeeded?
   bool finished() const;
@@ -53,6 +56,12 @@ public:
   template <typename Function>
   decltype(auto) wrap(Function function);
 
+  // Calls onResult or onError once this promise finishes, instead of having
+  // to poll finished().  If the promise is already finished, the matching
+  // function is called immediately, otherwise it is called from inside the
+  // fulfill or fail call on the keeper side, on the same thread.
+  void then(function<void(Result const&)> onResult, function<void(Error const&)> onError = {});
+
 private:
   template <typename ResultT, typename ErrorT>
   friend class RpcPromise;
@@ -60,11 +69,15 @@ private:
   struct Value {
     Maybe<Result> result;
     Maybe<Error> error;
+    List<function<void()>> onFinished;
   };
 
   RpcPromise() = default;
 
   function<Value const*()> m_getValue;
+  // Calls the given function once the promise is finished, immediately if it
+  // already is.
+  function<void(function<void()>)> m_onFinished;
 };
 
 template <typename Result, typename Error>
@@ -85,17 +98,27 @@ pair<RpcPromise<Result, Error>, RpcPromiseKeeper<Result, Error>> RpcPromise<Resu
   promise.m_getValue = [valuePtr]() {
     return valuePtr.get();
   };
+  promise.m_onFinished = [valuePtr](function<void()> onFinished) {
+    if (valuePtr->result || valuePtr->error)
+      onFinished();
+    else
+      valuePtr->onFinished.append(std::move(onFinished));
+  };
 
   RpcPromiseKeeper<Result, Error> keeper;
   keeper.m_fulfill = [valuePtr](Result result) {
     if (valuePtr->result || valuePtr->error)
       throw RpcPromiseException("fulfill called on already finished RpcPromise");
     valuePtr->result = std::move(result);
+    for (auto& onFinished : take(valuePtr->onFinished))
+      onFinished();
   };
   keeper.m_fail = [valuePtr](Error error) {
     if (valuePtr->result || valuePtr->error)
       throw RpcPromiseException("fail called on already finished RpcPromise");
     valuePtr->error = std::move(error);
+    for (auto& onFinished : take(valuePtr->onFinished))
+      onFinished();
   };
 
   return {std::move(promise), std::move(keeper)};
@@ -110,6 +133,9 @@ RpcPromise<Result, Error> RpcPromise<Result, Error>::createFulfilled(Result resu
   promise.m_getValue = [valuePtr]() {
     return valuePtr.get();
   };
+  promise.m_onFinished = [](function<void()> onFinished) {
+    onFinished();
+  };
   return promise;
 }
 
@@ -122,9 +148,45 @@ RpcPromise<Result, Error> RpcPromise<Result, Error>::createFailed(Error error) {
   promise.m_getValue = [valuePtr]() {
     return valuePtr.get();
   };
+  promise.m_onFinished = [](function<void()> onFinished) {
+    onFinished();
+  };
   return promise;
 }
 
+template <typename Result, typename Error>
+RpcPromise<List<Maybe<Result>>, Error> RpcPromise<Result, Error>::all(List<RpcPromise> promises) {
+  typedef RpcPromise<List<Maybe<Result>>, Error> AllPromise;
+  AllPromise allPromise;
+  allPromise.m_onFinished = [promises](function<void()> onFinished) {
+    // Count down the promises still unfinished, plus one for the registration
+    // itself, so that onFinished runs exactly once whether they finish now or
+    // later.
+    auto remaining = make_shared<size_t>(promises.size() + 1);
+    auto countDown = [remaining, onFinished = std::move(onFinished)]() {
+      if (--*remaining == 0)
+        onFinished();
+    };
+    for (auto const& promise : promises)
+      promise.m_onFinished(countDown);
+    countDown();
+  };
+  allPromise.m_getValue = [promises = std::move(promises), finishedCount = size_t(0), valuePtr = std::make_shared<typename AllPromise::Value>()]() mutable {
+    if (!valuePtr->result) {
+      // Promises never become unfinished again, so only check from the first
+      // one that was unfinished last time
+      while (finishedCount < promises.size() && promises[finishedCount].finished())
+        ++finishedCount;
+      if (finishedCount == promises.size()) {
+        valuePtr->result = promises.transformed([](RpcPromise const& promise) { return promise.result(); });
+        promises.clear();
+      }
+    }
+    return valuePtr.get();
+  };
+  return allPromise;
+}
+
 template <typename Result, typename Error>
 bool RpcPromise<Result, Error>::finished() const {
   auto val = m_getValue();
@@ -166,7 +228,24 @@ decltype(auto) RpcPromise<Result, Error>::wrap(Function function) {
     }
     return valuePtr.get();
   };
+  // The wrapped value is computed on demand, so it is finished exactly when
+  // this promise is.
+  wrappedPromise.m_onFinished = m_onFinished;
   return wrappedPromise;
 }
 
+template <typename Result, typename Error>
+void RpcPromise<Result, Error>::then(function<void(Result const&)> onResult, function<void(Error const&)> onError) {
+  m_onFinished([getValue = m_getValue, onResult = std::move(onResult), onError = std::move(onError)]() {
+    auto value = getValue();
+    if (value->result) {
+      if (onResult)
+        onResult(*value->result);
+    } else if (value->error) {
+      if (onError)
+        onError(*value->error);
+    }
+  });
+}
+
 }
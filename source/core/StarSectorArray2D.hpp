@@ -418,24 +418,20 @@ bool SectorArray2D<ElementT, SectorSize>::evalColumnsPrivPar(
   size_t minYSector = minY / SectorSize;
   size_t maxYSector = (maxY - 1) / SectorSize;
 
-  size_t sectorCount = maxXSector - minXSector + 1;
+  // Each sector column is a separate chunk, the calling thread works on them
+  // too rather than blocking until they are finished.
+  getWorkerPool().parallelFor(minXSector, maxXSector + 1, 1, [&](size_t xSectorBegin, size_t xSectorEnd) {
+    for (size_t xSector = xSectorBegin; xSector < xSectorEnd; ++xSector) {
+      size_t minXi = 0;
+      if (xSector == minXSector)
+        minXi = minX % SectorSize;
 
-  auto& workerPool = getWorkerPool();
-  std::vector<WorkerPoolHandle> futures;
-  futures.reserve(sectorCount);
+      size_t maxXi = SectorSize - 1;
+      if (xSector == maxXSector)
+        maxXi = (maxX - 1) % SectorSize;
 
-  for (size_t xSector = minXSector; xSector <= maxXSector; ++xSector) {
-    size_t minXi = 0;
-    if (xSector == minXSector)
-      minXi = minX % SectorSize;
-
-    size_t maxXi = SectorSize - 1;
-    if (xSector == maxXSector)
-      maxXi = (maxX - 1) % SectorSize;
+      size_t x_ = xSector * SectorSize;
 
-    size_t x_ = xSector * SectorSize;
-
-    futures.push_back(workerPool.addWork([=, &function]() {
       for (size_t ySector = minYSector; ySector <= maxYSector; ++ySector) {
         Array* array = m_sectors(xSector, ySector).get();
 
@@ -455,21 +451,17 @@ bool SectorArray2D<ElementT, SectorSize>::evalColumnsPrivPar(
         if (!array) {
           for (size_t xi = minXi; xi <= maxXi; ++xi) {
             if (!function(xi + x_, minYi + y_, nullptr, maxYi - minYi + 1))
-              return false;
+              return;
           }
         } else {
           for (size_t xi = minXi; xi <= maxXi; ++xi) {
             if (!function(xi + x_, minYi + y_, &array->elements[xi * SectorSize + minYi], maxYi - minYi + 1))
-              return false;
+              return;
           }
         }
       }
-      return true;
-      }));
-  }
-  for (const auto& f : futures) {
-    f.finish();
-  }
+    }
+  });
 
   return true;
 }
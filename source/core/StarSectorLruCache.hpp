@@ -0,0 +1,132 @@
+#pragma once
+
+#include <bitset>
+
+#include "StarLruCache.hpp"
+#include "StarArray.hpp"
+#include "StarVector.hpp"
+
+namespace Star {
+
+// Cache of values for integral 2d positions, stored and evicted in square
+// sectors of SectorSize tiles rather than per tile, so that lookups of
+// neighbouring tiles touch the same sector and the cache size can be given as
+// a memory budget.  Values within a sector are still only present once set,
+// a sector is not filled in all at once.  Not thread safe.
+template <typename Value, int SectorSize = 32>
+class SectorLruCache {
+public:
+  // Bytes taken up by one cached sector
+  static size_t const SectorBytes;
+
+  SectorLruCache(size_t memoryBudget = 0);
+
+  // Bytes of sectors to keep cached, at least one sector is always kept.
+  size_t memoryBudget() const;
+  void setMemoryBudget(size_t memoryBudget);
+
+  size_t memoryUsage() const;
+
+  // If the value is cached returns a pointer to it, valid until the next
+  // call to set, and marks its sector as accessed.  Otherwise returns
+  // nullptr.
+  Value const* ptr(Vec2I const& position);
+
+  // Caches the given value, evicting the least recently accessed sectors if
+  // the budget is used up.
+  void set(Vec2I const& position, Value value);
+
+  template <typename Producer>
+  Value get(Vec2I const& position, Producer producer);
+
+  void clear();
+
+private:
+  struct Sector {
+    Array<Value, SectorSize * SectorSize> values;
+    std::bitset<SectorSize * SectorSize> present;
+  };
+
+  static Vec2I sectorFor(Vec2I const& position);
+  static size_t indexFor(Vec2I const& position);
+
+  size_t m_memoryBudget;
+  HashLruCache<Vec2I, shared_ptr<Sector>> m_sectors;
+};
+
+template <typename Value, int SectorSize>
+size_t const SectorLruCache<Value, SectorSize>::SectorBytes = sizeof(Sector);
+
+template <typename Value, int SectorSize>
+SectorLruCache<Value, SectorSize>::SectorLruCache(size_t memoryBudget) {
+  setMemoryBudget(memoryBudget);
+}
+
+template <typename Value, int SectorSize>
+size_t SectorLruCache<Value, SectorSize>::memoryBudget() const {
+  return m_memoryBudget;
+}
+
+template <typename Value, int SectorSize>
+void SectorLruCache<Value, SectorSize>::setMemoryBudget(size_t memoryBudget) {
+  m_memoryBudget = memoryBudget;
+  m_sectors.setMaxSize(memoryBudget / SectorBytes);
+}
+
+template <typename Value, int SectorSize>
+size_t SectorLruCache<Value, SectorSize>::memoryUsage() const {
+  return m_sectors.currentSize() * SectorBytes;
+}
+
+template <typename Value, int SectorSize>
+Value const* SectorLruCache<Value, SectorSize>::ptr(Vec2I const& position) {
+  auto sector = m_sectors.ptr(sectorFor(position));
+  if (!sector)
+    return nullptr;
+
+  size_t index = indexFor(position);
+  if (!(*sector)->present[index])
+    return nullptr;
+  return &(*sector)->values[index];
+}
+
+template <typename Value, int SectorSize>
+void SectorLruCache<Value, SectorSize>::set(Vec2I const& position, Value value) {
+  Vec2I sectorKey = sectorFor(position);
+  auto sector = m_sectors.ptr(sectorKey);
+  if (!sector) {
+    m_sectors.set(sectorKey, make_shared<Sector>());
+    sector = m_sectors.ptr(sectorKey);
+  }
+
+  size_t index = indexFor(position);
+  (*sector)->values[index] = std::move(value);
+  (*sector)->present[index] = true;
+}
+
+template <typename Value, int SectorSize>
+template <typename Producer>
+Value SectorLruCache<Value, SectorSize>::get(Vec2I const& position, Producer producer) {
+  if (auto value = ptr(position))
+    return *value;
+  Value value = producer(position);
+  set(position, value);
+  return value;
+}
+
+template <typename Value, int SectorSize>
+void SectorLruCache<Value, SectorSize>::clear() {
+  m_sectors.clear();
+}
+
+template <typename Value, int SectorSize>
+Vec2I SectorLruCache<Value, SectorSize>::sectorFor(Vec2I const& position) {
+  return Vec2I(position[0] - pmod(position[0], SectorSize), position[1] - pmod(position[1], SectorSize));
+}
+
+template <typename Value, int SectorSize>
+size_t SectorLruCache<Value, SectorSize>::indexFor(Vec2I const& position) {
+  return pmod(position[0], SectorSize) + pmod(position[1], SectorSize) * SectorSize;
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "StarTtlCache.hpp"
+#include "StarThread.hpp"
+#include "StarArray.hpp"
+
+namespace Star {
+
+struct CacheStatistics {
+  uint64_t hits;
+  uint64_t misses;
+  size_t size;
+};
+
+// A HashTtlCache split into shards by key hash, each behind its own lock, so
+// threads looking up different keys rarely wait on each other.  Values are
+// returned by copy, as another thread may evict an entry as soon as its shard
+// is unlocked, so they should be cheap to copy like shared pointers.
+template <typename Key, typename Value, typename Hash = Star::hash<Key>, size_t ShardCount = 16>
+class ShardedTtlCache {
+public:
+  ShardedTtlCache(int64_t timeToLive = 10000, int timeSmear = 1000);
+
+  // Returns the cached value for the key and refreshes its time to live, or
+  // nothing if it is not cached.
+  Maybe<Value> value(Key const& key);
+  // Caches the value unless a value is already cached for the key, and
+  // returns whichever value ends up cached.
+  Value insert(Key const& key, Value value);
+
+  // Returns the cached value for the key, or caches one made by the producer.
+  // The producer runs with no shard locked, so threads that miss the same key
+  // at once may each produce a value, and the first to finish is cached.
+  template <typename Producer>
+  Value get(Key const& key, Producer&& producer);
+
+  void cleanup(function<bool(Key const&, Value const&)> refreshFilter = {});
+  void clear();
+
+  // Hits and misses of value() and get() since the cache was created
+  CacheStatistics statistics() const;
+
+private:
+  struct Shard {
+    mutable Mutex mutex;
+    HashTtlCache<Key, Value, Hash> cache;
+  };
+
+  Shard& shard(Key const& key);
+
+  Hash m_hash;
+  Array<Shard, ShardCount> m_shards;
+  atomic<uint64_t> m_hits;
+  atomic<uint64_t> m_misses;
+};
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+ShardedTtlCache<Key, Value, Hash, ShardCount>::ShardedTtlCache(int64_t timeToLive, int timeSmear)
+  : m_hits(0), m_misses(0) {
+  for (auto& shard : m_shards) {
+    shard.cache.setTimeToLive(timeToLive);
+    shard.cache.setTimeSmear(timeSmear);
+  }
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+auto ShardedTtlCache<Key, Value, Hash, ShardCount>::value(Key const& key) -> Maybe<Value> {
+  auto& s = shard(key);
+  MutexLocker locker(s.mutex);
+  if (Value* value = s.cache.ptr(key)) {
+    ++m_hits;
+    return *value;
+  }
+  ++m_misses;
+  return {};
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+Value ShardedTtlCache<Key, Value, Hash, ShardCount>::insert(Key const& key, Value value) {
+  auto& s = shard(key);
+  MutexLocker locker(s.mutex);
+  return s.cache.get(key, [&](Key const&) -> Value { return std::move(value); });
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+template <typename Producer>
+Value ShardedTtlCache<Key, Value, Hash, ShardCount>::get(Key const& key, Producer&& producer) {
+  if (auto cached = value(key))
+    return take(*cached);
+  return insert(key, producer(key));
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+void ShardedTtlCache<Key, Value, Hash, ShardCount>::cleanup(function<bool(Key const&, Value const&)> refreshFilter) {
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    shard.cache.cleanup(refreshFilter);
+  }
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+void ShardedTtlCache<Key, Value, Hash, ShardCount>::clear() {
+  for (auto& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    shard.cache.clear();
+  }
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+CacheStatistics ShardedTtlCache<Key, Value, Hash, ShardCount>::statistics() const {
+  size_t size = 0;
+  for (auto const& shard : m_shards) {
+    MutexLocker locker(shard.mutex);
+    size += shard.cache.currentSize();
+  }
+  return {m_hits.load(), m_misses.load(), size};
+}
+
+template <typename Key, typename Value, typename Hash, size_t ShardCount>
+auto ShardedTtlCache<Key, Value, Hash, ShardCount>::shard(Key const& key) -> Shard& {
+  // Each shard's own table buckets by the low bits of the same hash, so the
+  // shard is picked from mixed bits to keep every shard's buckets in use.
+  size_t h = m_hash(key);
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return m_shards[h % ShardCount];
+}
+
+}
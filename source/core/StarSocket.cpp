@@ -2,6 +2,11 @@
 #include "StarLogging.hpp"
 #include "StarNetImpl.hpp"
 
+#ifdef STAR_SYSTEM_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 namespace Star {
 
 Maybe<SocketPollResult> Socket::poll(SocketPollQuery const& query, unsigned timeout) {
@@ -269,4 +274,164 @@ void Socket::doClose() {
   }
 }
 
+SocketPoller::SocketPoller()
+  : m_nextEntryId(1), m_epollDesc(-1), m_wakeDesc(-1), m_woken(false) {
+#ifdef STAR_SYSTEM_LINUX
+  m_epollDesc = ::epoll_create1(EPOLL_CLOEXEC);
+  if (m_epollDesc < 0)
+    throw NetworkException::format("Cannot create epoll descriptor: {}", netErrorString());
+
+  m_wakeDesc = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_wakeDesc < 0) {
+    ::close(m_epollDesc);
+    throw NetworkException::format("Cannot create eventfd descriptor: {}", netErrorString());
+  }
+
+  // Entry id 0 is reserved for the wake descriptor
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = 0;
+  ::epoll_ctl(m_epollDesc, EPOLL_CTL_ADD, m_wakeDesc, &event);
+#endif
+}
+
+SocketPoller::~SocketPoller() {
+#ifdef STAR_SYSTEM_LINUX
+  ::close(m_wakeDesc);
+  ::close(m_epollDesc);
+#endif
+}
+
+void SocketPoller::set(SocketPtr const& socket, SocketPollQueryEntry query) {
+  uint64_t id;
+  bool added = false;
+  if (auto existingId = m_entryIds.maybe(socket.get())) {
+    id = *existingId;
+    auto& entry = m_entries.get(id);
+    if (entry.query.readable == query.readable && entry.query.writable == query.writable)
+      return;
+    entry.query = query;
+  } else {
+    id = m_nextEntryId++;
+    m_entries.add(id, Entry{socket, query});
+    m_entryIds.add(socket.get(), id);
+    added = true;
+  }
+
+#ifdef STAR_SYSTEM_LINUX
+  // A closed socket is reported as an exception by wait without needing to be
+  // in the epoll set, and closing removes it from the epoll set already.
+  ReadLocker locker(socket->m_mutex);
+  if (!socket->isOpen())
+    return;
+
+  epoll_event event = {};
+  if (query.readable)
+    event.events |= EPOLLIN;
+  if (query.writable)
+    event.events |= EPOLLOUT;
+  event.data.u64 = id;
+  if (::epoll_ctl(m_epollDesc, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, socket->m_impl->socketDesc, &event) != 0)
+    throw NetworkException::format("Cannot add socket to epoll set: {}", netErrorString());
+#else
+  _unused(added);
+#endif
+}
+
+void SocketPoller::remove(SocketPtr const& socket) {
+  auto id = m_entryIds.maybeTake(socket.get());
+  if (!id)
+    return;
+  m_entries.remove(*id);
+
+#ifdef STAR_SYSTEM_LINUX
+  // Only remove open sockets, the descriptor of a closed socket may already
+  // belong to another socket.
+  ReadLocker locker(socket->m_mutex);
+  if (socket->isOpen())
+    ::epoll_ctl(m_epollDesc, EPOLL_CTL_DEL, socket->m_impl->socketDesc, nullptr);
+#endif
+}
+
+bool SocketPoller::contains(SocketPtr const& socket) const {
+  return m_entryIds.contains(socket.get());
+}
+
+size_t SocketPoller::size() const {
+  return m_entries.size();
+}
+
+Maybe<SocketPollResult> SocketPoller::wait(unsigned timeout) {
+  SocketPollResult result;
+  for (auto const& p : m_entries) {
+    if (!p.second.socket->isOpen()) {
+      result[p.second.socket].exception = true;
+      timeout = 0;
+    }
+  }
+
+#ifdef STAR_SYSTEM_LINUX
+  epoll_event events[64];
+  int ret = ::epoll_wait(m_epollDesc, events, 64, timeout);
+  if (ret < 0 && errno != EINTR)
+    throw NetworkException::format("Error during call to epoll_wait, '{}'", netErrorString());
+
+  for (int i = 0; i < ret; ++i) {
+    if (events[i].data.u64 == 0) {
+      uint64_t count;
+      while (::read(m_wakeDesc, &count, sizeof(count)) > 0) {}
+      continue;
+    }
+
+    auto entry = m_entries.ptr(events[i].data.u64);
+    if (!entry)
+      continue;
+
+    ReadLocker locker(entry->socket->m_mutex);
+    if (!entry->socket->isOpen())
+      continue;
+
+    auto& r = result[entry->socket];
+    r.readable = events[i].events & EPOLLIN;
+    r.writable = events[i].events & EPOLLOUT;
+    r.exception = events[i].events & (EPOLLHUP | EPOLLERR);
+    if (events[i].events & EPOLLHUP)
+      entry->socket->doShutdown();
+  }
+#else
+  // Without a way to interrupt Socket::poll, never wait for longer than a
+  // millisecond so that wake() is still seen promptly.
+  if (m_woken.exchange(false))
+    timeout = 0;
+  timeout = min(timeout, 1u);
+
+  SocketPollQuery query;
+  for (auto const& p : m_entries) {
+    if (p.second.socket->isOpen())
+      query.add(p.second.socket, p.second.query);
+  }
+
+  if (query.empty()) {
+    if (timeout > 0)
+      Thread::sleep(timeout);
+  } else if (auto polled = Socket::poll(query, timeout)) {
+    for (auto& p : *polled)
+      result[p.first] = p.second;
+  }
+#endif
+
+  if (result.empty())
+    return {};
+  return result;
+}
+
+void SocketPoller::wake() {
+#ifdef STAR_SYSTEM_LINUX
+  uint64_t count = 1;
+  if (::write(m_wakeDesc, &count, sizeof(count)) < 0) {}
+#else
+  m_woken = true;
+#endif
+}
+
 }
@@ -2,6 +2,7 @@
 
 #include "StarHostAddress.hpp"
 #include "StarThread.hpp"
+#include "StarMap.hpp"
 
 namespace Star {
 
@@ -11,6 +12,7 @@ STAR_EXCEPTION(SocketClosedException, NetworkException);
 
 STAR_STRUCT(SocketImpl);
 STAR_CLASS(Socket);
+STAR_CLASS(SocketPoller);
 
 enum class SocketMode {
   Closed,
@@ -73,6 +75,8 @@ public:
   void close();
 
 protected:
+  friend class SocketPoller;
+
   enum class SocketType {
     Tcp,
     Udp
@@ -92,4 +96,50 @@ protected:
   HostAddressWithPort m_localAddress;
 };
 
+// Waits on a persistent set of sockets, rather than taking the whole query on
+// every call like Socket::poll.  On Linux this uses epoll, so the cost of a
+// wait depends only on the sockets that are actually ready, elsewhere it
+// falls back to Socket::poll over every added socket.
+//
+// Only wake() may be called concurrently with the other methods.
+class SocketPoller {
+public:
+  SocketPoller();
+  ~SocketPoller();
+
+  SocketPoller(SocketPoller const&) = delete;
+  SocketPoller& operator=(SocketPoller const&) = delete;
+
+  // Adds the socket, or changes what is queried for it if it was already
+  // added.
+  void set(SocketPtr const& socket, SocketPollQueryEntry query);
+  void remove(SocketPtr const& socket);
+  bool contains(SocketPtr const& socket) const;
+  size_t size() const;
+
+  // Waits up to the given timeout for any added socket to be ready for I/O,
+  // with the same results as Socket::poll.  May return nothing before the
+  // timeout is reached if wake() is called, or at any time when not using
+  // epoll.
+  Maybe<SocketPollResult> wait(unsigned timeout);
+
+  // Makes the current or next call to wait return immediately.
+  void wake();
+
+private:
+  struct Entry {
+    SocketPtr socket;
+    SocketPollQueryEntry query;
+  };
+
+  HashMap<uint64_t, Entry> m_entries;
+  HashMap<Socket*, uint64_t> m_entryIds;
+  uint64_t m_nextEntryId;
+
+  // epoll and eventfd descriptors, unused when not on Linux
+  int m_epollDesc;
+  int m_wakeDesc;
+  atomic<bool> m_woken;
+};
+
 }
@@ -10,6 +10,12 @@ namespace Star {
 // Dual-map based on key and 2 dimensional bounding rectangle.  Implements a 2d
 // spatial hash for fast bounding box queries.  Each entry may have more than
 // one bounding rectangle.
+//
+// Rects that span more than CoarseSectorSpan sectors in either dimension are
+// kept in a second, coarser grid of sectors CoarseSectorFactor times as large,
+// so huge entries are not added to and removed from a great many sectors.
+// Queries that cover more sectors than are occupied go through the occupied
+// sectors instead, so very large queries cost no more than the whole map.
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT = int, size_t AllocatorBlockSize = 4096>
 class SpatialHash2D {
 public:
@@ -28,6 +34,9 @@ public:
 
   typedef StableHashMap<Key, Entry, hash<Key>, std::equal_to<Key>, BlockAllocator<pair<Key const, Entry>, AllocatorBlockSize>> EntryMap;
 
+  static IntT const CoarseSectorSpan = 4;
+  static IntT const CoarseSectorFactor = 8;
+
   SpatialHash2D(Scalar const& sectorSize);
 
   List<Key> keys() const;
@@ -80,7 +89,12 @@ private:
   typedef HashSet<Entry const*, hash<Entry const*>, std::equal_to<Entry const*>> SectorEntrySet;
   typedef HashMap<Sector, SectorEntrySet> SectorMap;
 
-  SectorRange getSectors(Rect const& r) const;
+  SectorRange getSectors(Rect const& r, Scalar const& sectorSize) const;
+  // The sector map a rect is kept in, and its sectors in that map
+  pair<SectorMap*, SectorRange> rectSectors(Rect const& r);
+
+  template <typename FoundEntries>
+  static void findEntries(SectorMap const& sectorMap, SectorRange const& sectors, Rect const& rect, FoundEntries& foundEntries);
 
   void addSpatial(Entry const* entry);
   void removeSpatial(Entry const* entry);
@@ -91,6 +105,7 @@ private:
   Scalar m_sectorSize;
   EntryMap m_entryMap;
   SectorMap m_sectorMap;
+  SectorMap m_coarseSectorMap;
 };
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
@@ -183,23 +198,9 @@ void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::forEach(Rec
     if (rect.isNull())
       continue;
 
-    auto sectorResult = getSectors(rect);
-
-    for (IntT x = sectorResult.xMin(); x < sectorResult.xMax(); ++x) {
-      for (IntT y = sectorResult.yMin(); y < sectorResult.yMax(); ++y) {
-        auto i = m_sectorMap.find(Sector{x, y});
-        if (i != m_sectorMap.end()) {
-          for (auto e : i->second) {
-            for (Rect const& r : e->rects) {
-              if (r.intersects(rect)) {
-                foundEntries.append(e);
-                break;
-              }
-            }
-          }
-        }
-      }
-    }
+    findEntries(m_sectorMap, getSectors(rect, m_sectorSize), rect, foundEntries);
+    if (!m_coarseSectorMap.empty())
+      findEntries(m_coarseSectorMap, getSectors(rect, m_sectorSize * CoarseSectorFactor), rect, foundEntries);
   }
 
   // Rather than keep a Set of keys to avoid duplication in found entries, it
@@ -222,12 +223,12 @@ void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::forEach(Rec
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
 void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::set(Key const& key, Coord const& pos) {
-  set(key, {Rect(pos, pos)});
+  set(key, initializer_list<Rect>{Rect(pos, pos)});
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
 void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::set(Key const& key, Rect const& rect) {
-  set(key, {rect});
+  set(key, initializer_list<Rect>{rect});
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
@@ -238,12 +239,12 @@ void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::set(Key con
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
 void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::set(Key const& key, Coord const& pos, Value value) {
-  set(key, {Rect(pos, pos)}, std::move(value));
+  set(key, initializer_list<Rect>{Rect(pos, pos)}, std::move(value));
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
 void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::set(Key const& key, Rect const& rect, Value value) {
-  set(key, {rect}, std::move(value));
+  set(key, initializer_list<Rect>{rect}, std::move(value));
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
@@ -270,17 +271,58 @@ template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_
 void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::setSectorSize(Scalar const& sectorSize) {
   m_sectorSize = sectorSize;
   m_sectorMap.clear();
+  m_coarseSectorMap.clear();
   for (auto const& pair : m_entryMap)
-    addSpatial(pair.first, pair.second);
+    addSpatial(&pair.second);
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
-typename SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::SectorRange SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::getSectors(Rect const& r) const {
+typename SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::SectorRange SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::getSectors(Rect const& r, Scalar const& sectorSize) const {
   return SectorRange(
-      floor(r.xMin() / m_sectorSize),
-      floor(r.yMin() / m_sectorSize),
-      ceil(r.xMax() / m_sectorSize),
-      ceil(r.yMax() / m_sectorSize));
+      floor(r.xMin() / sectorSize),
+      floor(r.yMin() / sectorSize),
+      ceil(r.xMax() / sectorSize),
+      ceil(r.yMax() / sectorSize));
+}
+
+template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
+auto SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::rectSectors(Rect const& r) -> pair<SectorMap*, SectorRange> {
+  auto sectors = getSectors(r, m_sectorSize);
+  if (sectors.width() > CoarseSectorSpan || sectors.height() > CoarseSectorSpan)
+    return {&m_coarseSectorMap, getSectors(r, m_sectorSize * CoarseSectorFactor)};
+  return {&m_sectorMap, sectors};
+}
+
+template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
+template <typename FoundEntries>
+void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::findEntries(
+    SectorMap const& sectorMap, SectorRange const& sectors, Rect const& rect, FoundEntries& foundEntries) {
+  auto findInSector = [&](SectorEntrySet const& sectorEntries) {
+    for (auto e : sectorEntries) {
+      for (Rect const& r : e->rects) {
+        if (r.intersects(rect)) {
+          foundEntries.append(e);
+          break;
+        }
+      }
+    }
+  };
+
+  if ((int64_t)sectors.width() * sectors.height() > (int64_t)sectorMap.size()) {
+    for (auto const& pair : sectorMap) {
+      Sector const& sector = pair.first;
+      if (sector[0] >= sectors.xMin() && sector[0] < sectors.xMax() && sector[1] >= sectors.yMin() && sector[1] < sectors.yMax())
+        findInSector(pair.second);
+    }
+  } else {
+    for (IntT x = sectors.xMin(); x < sectors.xMax(); ++x) {
+      for (IntT y = sectors.yMin(); y < sectors.yMax(); ++y) {
+        auto i = sectorMap.find(Sector{x, y});
+        if (i != sectorMap.end())
+          findInSector(i->second);
+      }
+    }
+  }
 }
 
 template <typename KeyT, typename ScalarT, typename ValueT, typename IntT, size_t AllocatorBlockSize>
@@ -289,13 +331,14 @@ void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::addSpatial(
     if (rect.isNull())
       continue;
 
-    auto sectorResult = getSectors(rect);
-    for (IntT x = sectorResult.xMin(); x < sectorResult.xMax(); ++x) {
-      for (IntT y = sectorResult.yMin(); y < sectorResult.yMax(); ++y) {
+    auto sectorResult = rectSectors(rect);
+    auto& sectorMap = *sectorResult.first;
+    for (IntT x = sectorResult.second.xMin(); x < sectorResult.second.xMax(); ++x) {
+      for (IntT y = sectorResult.second.yMin(); y < sectorResult.second.yMax(); ++y) {
         Sector sector(x, y);
-        SectorEntrySet* p = m_sectorMap.ptr(sector);
+        SectorEntrySet* p = sectorMap.ptr(sector);
         if (!p)
-          p = &m_sectorMap.add(sector, SectorEntrySet());
+          p = &sectorMap.add(sector, SectorEntrySet());
         p->add(entry);
       }
     }
@@ -308,14 +351,15 @@ void SpatialHash2D<KeyT, ScalarT, ValueT, IntT, AllocatorBlockSize>::removeSpati
     if (rect.isNull())
       continue;
 
-    auto sectorResult = getSectors(rect);
-    for (IntT x = sectorResult.xMin(); x < sectorResult.xMax(); ++x) {
-      for (IntT y = sectorResult.yMin(); y < sectorResult.yMax(); ++y) {
-        auto i = m_sectorMap.find(Sector{x, y});
-        if (i != m_sectorMap.end()) {
+    auto sectorResult = rectSectors(rect);
+    auto& sectorMap = *sectorResult.first;
+    for (IntT x = sectorResult.second.xMin(); x < sectorResult.second.xMax(); ++x) {
+      for (IntT y = sectorResult.second.yMin(); y < sectorResult.second.yMax(); ++y) {
+        auto i = sectorMap.find(Sector{x, y});
+        if (i != sectorMap.end()) {
           i->second.remove(entry);
           if (i->second.empty())
-            m_sectorMap.erase(i);
+            sectorMap.erase(i);
         }
       }
     }
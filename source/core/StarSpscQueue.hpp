@@ -0,0 +1,139 @@
+#pragma once
+
+#include "StarList.hpp"
+#include "StarMaybe.hpp"
+
+namespace Star {
+
+// Unbounded lock-free queue for exactly one producer thread and one consumer
+// thread at a time.  Values are stored in linked blocks of BlockSize slots,
+// so pushing only allocates once per block, and neither side ever waits on
+// the other.  Producers (or consumers) may change threads only if something
+// else orders the handoff, such as a mutex held by each of them.  T must be
+// default constructible.
+template <typename T, size_t BlockSize = 64>
+class SpscQueue {
+public:
+  SpscQueue();
+  ~SpscQueue();
+
+  SpscQueue(SpscQueue const&) = delete;
+  SpscQueue& operator=(SpscQueue const&) = delete;
+
+  // Producer only
+  void push(T value);
+  void pushAll(List<T> values);
+
+  // Consumer only
+  Maybe<T> pop();
+  List<T> takeAll();
+
+  // Safe from any thread, but may be out of date by the time it returns.
+  bool empty() const;
+  size_t size() const;
+
+private:
+  struct Block {
+    Block();
+
+    T slots[BlockSize];
+    // Slots published by the producer
+    atomic<size_t> written;
+    atomic<Block*> next;
+  };
+
+  // Owned by the consumer
+  Block* m_head;
+  size_t m_readIndex;
+
+  // Owned by the producer
+  Block* m_tail;
+
+  atomic<size_t> m_size;
+};
+
+template <typename T, size_t BlockSize>
+SpscQueue<T, BlockSize>::Block::Block()
+  : written(0), next(nullptr) {}
+
+template <typename T, size_t BlockSize>
+SpscQueue<T, BlockSize>::SpscQueue()
+  : m_head(new Block), m_readIndex(0), m_size(0) {
+  m_tail = m_head;
+}
+
+template <typename T, size_t BlockSize>
+SpscQueue<T, BlockSize>::~SpscQueue() {
+  while (m_head) {
+    Block* next = m_head->next.load(std::memory_order_relaxed);
+    delete m_head;
+    m_head = next;
+  }
+}
+
+template <typename T, size_t BlockSize>
+void SpscQueue<T, BlockSize>::push(T value) {
+  size_t index = m_tail->written.load(std::memory_order_relaxed);
+  if (index == BlockSize) {
+    // The consumer frees the full block once it has read past it and seen
+    // the next one, after which it is no longer touched here.
+    Block* block = new Block;
+    block->slots[0] = std::move(value);
+    block->written.store(1, std::memory_order_relaxed);
+    m_tail->next.store(block, std::memory_order_release);
+    m_tail = block;
+  } else {
+    m_tail->slots[index] = std::move(value);
+    m_tail->written.store(index + 1, std::memory_order_release);
+  }
+  m_size.fetch_add(1, std::memory_order_release);
+}
+
+template <typename T, size_t BlockSize>
+void SpscQueue<T, BlockSize>::pushAll(List<T> values) {
+  for (auto& value : values)
+    push(std::move(value));
+}
+
+template <typename T, size_t BlockSize>
+Maybe<T> SpscQueue<T, BlockSize>::pop() {
+  while (true) {
+    if (m_readIndex < m_head->written.load(std::memory_order_acquire)) {
+      T value = std::move(m_head->slots[m_readIndex]);
+      m_head->slots[m_readIndex++] = T();
+      m_size.fetch_sub(1, std::memory_order_release);
+      return value;
+    }
+
+    if (m_readIndex < BlockSize)
+      return {};
+
+    Block* next = m_head->next.load(std::memory_order_acquire);
+    if (!next)
+      return {};
+    delete m_head;
+    m_head = next;
+    m_readIndex = 0;
+  }
+}
+
+template <typename T, size_t BlockSize>
+List<T> SpscQueue<T, BlockSize>::takeAll() {
+  List<T> values;
+  values.reserve(size());
+  while (auto value = pop())
+    values.append(std::move(*value));
+  return values;
+}
+
+template <typename T, size_t BlockSize>
+bool SpscQueue<T, BlockSize>::empty() const {
+  return m_size.load(std::memory_order_acquire) == 0;
+}
+
+template <typename T, size_t BlockSize>
+size_t SpscQueue<T, BlockSize>::size() const {
+  return m_size.load(std::memory_order_acquire);
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "StarString.hpp"
+#include "StarMaybe.hpp"
+
+namespace Star {
+
+// Captures the native call stack of another thread, for finding out what a
+// thread that is stuck or running slowly is doing.  The sampled thread is
+// briefly interrupted, with a signal on unix or by suspending it on windows.
+class StackSampler {
+public:
+  typedef uint64_t ThreadId;
+
+  // Identifies the calling thread, so that other threads can sample it.
+  static ThreadId currentThread();
+
+  // Returns the symbolized stack of the given thread, or nothing if it could
+  // not be sampled within the timeout.  Samples are taken one at a time.
+  static Maybe<String> sample(ThreadId thread, unsigned timeoutMillis = 100);
+};
+
+}
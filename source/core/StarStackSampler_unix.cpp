@@ -0,0 +1,100 @@
+#include "StarStackSampler.hpp"
+#include "StarArray.hpp"
+#include "StarThread.hpp"
+#include "StarTime.hpp"
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+
+namespace Star {
+
+static_assert(sizeof(pthread_t) <= sizeof(StackSampler::ThreadId), "pthread_t must fit in a StackSampler::ThreadId");
+
+// Ignored by default and not otherwise used, so a sample signal that arrives
+// late does no harm.
+static int const SampleSignal = SIGURG;
+static size_t const SampleStackLimit = 128;
+
+struct StackSample {
+  Array<void*, SampleStackLimit> frames;
+  atomic<int> frameCount;
+  atomic<bool> requested;
+  atomic<bool> done;
+};
+
+static Mutex s_sampleMutex;
+static bool s_handlerInstalled = false;
+static StackSample s_sample;
+
+static void sampleSignalHandler(int) {
+  int savedErrno = errno;
+  // A signal for a sample that already timed out is dropped
+  if (s_sample.requested.exchange(false)) {
+    s_sample.frameCount.store(backtrace(s_sample.frames.ptr(), SampleStackLimit), std::memory_order_relaxed);
+    s_sample.done.store(true, std::memory_order_release);
+  }
+  errno = savedErrno;
+}
+
+StackSampler::ThreadId StackSampler::currentThread() {
+  pthread_t self = pthread_self();
+  ThreadId thread = 0;
+  memcpy(&thread, &self, sizeof(self));
+  return thread;
+}
+
+Maybe<String> StackSampler::sample(ThreadId thread, unsigned timeoutMillis) {
+  MutexLocker locker(s_sampleMutex);
+  if (!s_handlerInstalled) {
+    // backtrace may allocate the first time it is called, which must not
+    // happen inside the signal handler.
+    void* primeFrames[1];
+    backtrace(primeFrames, 1);
+
+    struct sigaction action = {};
+    action.sa_handler = sampleSignalHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SampleSignal, &action, nullptr) != 0)
+      return {};
+    s_handlerInstalled = true;
+  }
+
+  pthread_t target;
+  memcpy(&target, &thread, sizeof(target));
+
+  s_sample.done = false;
+  s_sample.requested = true;
+  if (pthread_kill(target, SampleSignal) != 0) {
+    s_sample.requested = false;
+    return {};
+  }
+
+  int64_t deadline = Time::monotonicMilliseconds() + timeoutMillis;
+  while (!s_sample.done.load(std::memory_order_acquire)) {
+    if (Time::monotonicMilliseconds() >= deadline) {
+      s_sample.requested = false;
+      return {};
+    }
+    Thread::sleep(1);
+  }
+
+  int frameCount = s_sample.frameCount.load(std::memory_order_relaxed);
+  char** symbols = backtrace_symbols(s_sample.frames.ptr(), frameCount);
+  if (!symbols)
+    return {};
+
+  // The first frames are the signal handler itself
+  String stack;
+  for (int i = 2; i < frameCount; ++i) {
+    if (!stack.empty())
+      stack += "\n";
+    stack += symbols[i];
+  }
+  ::free(symbols);
+  return stack;
+}
+
+}
@@ -0,0 +1,79 @@
+#include "StarStackSampler.hpp"
+#include "StarArray.hpp"
+#include "StarThread.hpp"
+
+#include <windows.h>
+#include <DbgHelp.h>
+
+namespace Star {
+
+static size_t const SampleStackLimit = 128;
+
+static Mutex s_sampleMutex;
+
+StackSampler::ThreadId StackSampler::currentThread() {
+  return GetCurrentThreadId();
+}
+
+Maybe<String> StackSampler::sample(ThreadId thread, unsigned) {
+  MutexLocker locker(s_sampleMutex);
+  HANDLE process = GetCurrentProcess();
+  HANDLE handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, (DWORD)thread);
+  if (!handle)
+    return {};
+
+  // Nothing may be allocated while the thread is suspended, it may be holding
+  // the heap lock.
+  Array<DWORD64, SampleStackLimit> frames;
+  size_t frameCount = 0;
+  if (SuspendThread(handle) != (DWORD)-1) {
+    CONTEXT context;
+    memset(&context, 0, sizeof(CONTEXT));
+    context.ContextFlags = CONTEXT_FULL;
+    if (GetThreadContext(handle, &context)) {
+      STACKFRAME64 stackFrame;
+      ZeroMemory(&stackFrame, sizeof(STACKFRAME64));
+      stackFrame.AddrPC.Mode = AddrModeFlat;
+      stackFrame.AddrFrame.Mode = AddrModeFlat;
+      stackFrame.AddrStack.Mode = AddrModeFlat;
+#ifdef STAR_ARCHITECTURE_I386
+      DWORD image = IMAGE_FILE_MACHINE_I386;
+      stackFrame.AddrPC.Offset = context.Eip;
+      stackFrame.AddrFrame.Offset = context.Ebp;
+      stackFrame.AddrStack.Offset = context.Esp;
+#else
+      DWORD image = IMAGE_FILE_MACHINE_AMD64;
+      stackFrame.AddrPC.Offset = context.Rip;
+      stackFrame.AddrFrame.Offset = context.Rbp;
+      stackFrame.AddrStack.Offset = context.Rsp;
+#endif
+      while (frameCount < SampleStackLimit
+          && StackWalk64(image, process, handle, &stackFrame, &context, NULL, SymFunctionTableAccess64, SymGetModuleBase64, NULL)
+          && stackFrame.AddrPC.Offset != 0)
+        frames[frameCount++] = stackFrame.AddrPC.Offset;
+    }
+    ResumeThread(handle);
+  }
+  CloseHandle(handle);
+
+  if (frameCount == 0)
+    return {};
+
+  char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR)];
+  PSYMBOL_INFO symbol = (PSYMBOL_INFO)symbolBuffer;
+  String stack;
+  for (size_t i = 0; i < frameCount; ++i) {
+    memset(symbolBuffer, 0, sizeof(symbolBuffer));
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
+    if (!stack.empty())
+      stack += "\n";
+    if (SymFromAddr(process, frames[i], NULL, symbol))
+      stack += strf("[{}] {}", i, symbol->Name);
+    else
+      stack += strf("[{}] {:#x}", i, frames[i]);
+  }
+  return stack;
+}
+
+}
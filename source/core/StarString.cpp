@@ -2,6 +2,7 @@
 #include "StarStringView.hpp"
 #include "StarBytes.hpp"
 #include "StarFormat.hpp"
+#include "StarXXHash.hpp"
 
 #include <cctype>
 #include <re2/re2.h>
@@ -148,6 +149,8 @@ String::const_iterator String::end() const {
 }
 
 size_t String::size() const {
+  if (utf8IsAscii(m_string.data(), m_string.size()))
+    return m_string.size();
   return utf8Length(m_string.c_str(), m_string.size());
 }
 
@@ -168,12 +171,22 @@ bool String::empty() const {
 }
 
 String::Char String::operator[](size_t index) const {
+  // If everything up to the index is ASCII, the byte offset is the index
+  if (index < m_string.size() && utf8IsAscii(m_string.data(), index + 1))
+    return (Char)m_string[index];
+
   auto it = begin();
   for (size_t i = 0; i < index; ++i)
     ++it;
   return *it;
 }
 
+size_t hash<String>::operator()(String const& s) const {
+  // Hash tables mask off the low bits of this, so it needs to mix every byte
+  // of the key into them, and it is run on every config and asset lookup.
+  return xxHash3(s.utf8Ptr(), s.utf8Size());
+}
+
 size_t CaseInsensitiveStringHash::operator()(String const& s) const {
   PLHasher hash;
   for (auto c : s)
@@ -465,6 +478,9 @@ String String::trim(String const& pattern) const {
 }
 
 size_t String::find(Char c, size_t pos, CaseSensitivity cs) const {
+  if (cs == CaseSensitive && c < 0x80 && utf8IsAscii(m_string.data(), m_string.size()))
+    return m_string.find((char)c, pos);
+
   auto it = begin();
   for (size_t i = 0; i < pos; ++i) {
     if (it == end())
@@ -486,6 +502,9 @@ size_t String::find(String const& str, size_t pos, CaseSensitivity cs) const {
   if (str.empty())
     return 0;
 
+  if (cs == CaseSensitive && utf8IsAscii(m_string.data(), m_string.size()))
+    return m_string.find(str.m_string, pos);
+
   auto it = begin();
   for (size_t i = 0; i < pos; ++i) {
     if (it == end())
@@ -515,6 +534,9 @@ size_t String::find(String const& str, size_t pos, CaseSensitivity cs) const {
 }
 
 size_t String::findLast(Char c, CaseSensitivity cs) const {
+  if (cs == CaseSensitive && c < 0x80 && utf8IsAscii(m_string.data(), m_string.size()))
+    return m_string.rfind((char)c);
+
   auto it = begin();
 
   size_t found = NPos;
@@ -533,6 +555,9 @@ size_t String::findLast(String const& str, CaseSensitivity cs) const {
   if (str.empty())
     return 0;
 
+  if (cs == CaseSensitive && utf8IsAscii(m_string.data(), m_string.size()))
+    return m_string.rfind(str.m_string);
+
   size_t pos = 0;
   auto it = begin();
   size_t result = NPos;
@@ -744,6 +769,9 @@ String String::substr(size_t position, size_t n) const {
   if (position == 0 && n >= len)
     return *this;
 
+  if (len == m_string.size())
+    return String(m_string.substr(position, n));
+
   String ret;
   ret.reserve(std::min(n, len - position));
 
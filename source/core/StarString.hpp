@@ -492,13 +492,6 @@ String String::replaceTags(MapType const& tags, bool replaceWithDefault, String
   });
 }
 
-inline size_t hash<String>::operator()(String const& s) const {
-  PLHasher hash;
-  for (auto c : s.utf8())
-    hash.put(c);
-  return hash.hash();
-}
-
 template <typename Container>
 StringList StringList::from(Container const& m) {
   return StringList(m.begin(), m.end());
@@ -0,0 +1,198 @@
+#include "StarTraceProfiler.hpp"
+#include "StarFile.hpp"
+#include "StarTime.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+struct TraceProfiler::Zone {
+  char const* name;
+  double start;
+  double end;
+};
+
+struct TraceProfiler::ThreadBuffer {
+  uint64_t threadId;
+  // Total zones ever recorded, only written by the owning thread.  Zones are
+  // written before the count is published, so every zone below the count is
+  // complete unless the thread has since wrapped around and overwritten it.
+  atomic<uint64_t> recorded;
+  unique_ptr<Zone[]> zones;
+  // Set under the registry lock once the owning thread has exited
+  bool finished;
+};
+
+struct TraceProfiler::ThreadBufferHolder {
+  ~ThreadBufferHolder();
+
+  ThreadBuffer* buffer = nullptr;
+};
+
+struct TraceProfiler::Registry {
+  Mutex mutex;
+  List<ThreadBuffer*> buffers;
+  uint64_t nextThreadId = 1;
+  double captureStart = 0.0;
+
+  Mutex namesMutex;
+  StringMap<String const*> names;
+};
+
+atomic<bool> TraceProfiler::s_capturing(false);
+
+TraceProfiler::Scope::Scope(char const* name) {
+  m_name = name;
+  m_start = TraceProfiler::capturing() ? Time::monotonicTime() : -1.0;
+}
+
+TraceProfiler::Scope::~Scope() {
+  if (m_start >= 0.0)
+    TraceProfiler::record(m_name, m_start, Time::monotonicTime());
+}
+
+bool TraceProfiler::capturing() {
+  return s_capturing.load(std::memory_order_relaxed);
+}
+
+void TraceProfiler::startCapture() {
+  auto& reg = registry();
+  MutexLocker locker(reg.mutex);
+  reg.buffers.filter([](ThreadBuffer* buffer) {
+      if (!buffer->finished)
+        return true;
+      delete buffer;
+      return false;
+    });
+  reg.captureStart = Time::monotonicTime();
+  s_capturing = true;
+}
+
+Json TraceProfiler::stopCapture() {
+  auto& reg = registry();
+  MutexLocker locker(reg.mutex);
+  s_capturing = false;
+
+  JsonArray events;
+  for (ThreadBuffer* buffer : reg.buffers) {
+    uint64_t end = buffer->recorded.load(std::memory_order_acquire);
+    uint64_t begin = end > ThreadBufferSize ? end - ThreadBufferSize : 0;
+
+    List<Zone> zones;
+    zones.reserve(end - begin);
+    for (uint64_t i = begin; i < end; ++i)
+      zones.append(buffer->zones[i % ThreadBufferSize]);
+
+    // Zones from scopes that were still open when capturing stopped may have
+    // overwritten the oldest ones while they were being copied.
+    uint64_t after = buffer->recorded.load(std::memory_order_acquire);
+    uint64_t overwritten = after > ThreadBufferSize ? after - ThreadBufferSize : 0;
+    size_t skip = overwritten > begin ? min<uint64_t>(overwritten - begin, zones.size()) : 0;
+
+    bool threadRecorded = false;
+    for (size_t i = skip; i < zones.size(); ++i) {
+      auto const& zone = zones[i];
+      if (zone.start < reg.captureStart)
+        continue;
+      threadRecorded = true;
+      events.append(JsonObject{
+          {"name", zone.name},
+          {"ph", "X"},
+          {"ts", (zone.start - reg.captureStart) * 1000000.0},
+          {"dur", (zone.end - zone.start) * 1000000.0},
+          {"pid", 1},
+          {"tid", buffer->threadId}
+        });
+    }
+
+    if (threadRecorded) {
+      events.append(JsonObject{
+          {"name", "thread_name"},
+          {"ph", "M"},
+          {"pid", 1},
+          {"tid", buffer->threadId},
+          {"args", JsonObject{{"name", strf("Thread {}", buffer->threadId)}}}
+        });
+    }
+  }
+
+  return JsonObject{
+      {"traceEvents", std::move(events)},
+      {"displayTimeUnit", "ms"}
+    };
+}
+
+String TraceProfiler::stopCaptureToFile(String const& directory) {
+  Json trace = stopCapture();
+
+  if (!File::isDirectory(directory))
+    File::makeDirectory(directory);
+
+  String filename = strf("{}.trace.json", Time::printCurrentDateAndTime("<year>-<month>-<day>-<hours>-<minutes>-<seconds>-<millis>"));
+  String path = File::relativeTo(directory, filename);
+  File::writeFile(trace.printJson(), path);
+  return path;
+}
+
+void TraceProfiler::record(char const* name, double start, double end) {
+  if (!capturing())
+    return;
+
+  auto& buffer = threadBuffer();
+  uint64_t index = buffer.recorded.load(std::memory_order_relaxed);
+  buffer.zones[index % ThreadBufferSize] = Zone{name, start, end};
+  buffer.recorded.store(index + 1, std::memory_order_release);
+}
+
+char const* TraceProfiler::internName(String const& name) {
+  thread_local StringMap<char const*> threadNames;
+  if (auto interned = threadNames.maybe(name))
+    return *interned;
+
+  auto& reg = registry();
+  MutexLocker locker(reg.namesMutex);
+  String const*& interned = reg.names[name];
+  if (!interned)
+    interned = new String(name);
+  threadNames[name] = interned->utf8Ptr();
+  return interned->utf8Ptr();
+}
+
+TraceProfiler::ThreadBufferHolder::~ThreadBufferHolder() {
+  if (!buffer)
+    return;
+
+  // Keep the zones of threads that exit during a capture until the next one
+  auto& reg = registry();
+  MutexLocker locker(reg.mutex);
+  if (TraceProfiler::capturing()) {
+    buffer->finished = true;
+  } else {
+    reg.buffers.remove(buffer);
+    delete buffer;
+  }
+}
+
+TraceProfiler::Registry& TraceProfiler::registry() {
+  // Never destroyed, threads may exit after static destructors have run.
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+TraceProfiler::ThreadBuffer& TraceProfiler::threadBuffer() {
+  thread_local ThreadBufferHolder holder;
+  if (!holder.buffer) {
+    auto buffer = new ThreadBuffer;
+    buffer->recorded = 0;
+    buffer->zones.reset(new Zone[ThreadBufferSize]);
+    buffer->finished = false;
+
+    auto& reg = registry();
+    MutexLocker locker(reg.mutex);
+    buffer->threadId = reg.nextThreadId++;
+    reg.buffers.append(buffer);
+    holder.buffer = buffer;
+  }
+  return *holder.buffer;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "StarJson.hpp"
+
+namespace Star {
+
+// Records timed zones from every thread while a capture is running, and
+// exports them as a Chrome trace event document that can be opened in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Each thread records into its own ring buffer, so recording a zone never
+// takes a lock, and when no capture is running a zone costs only a check of
+// the capturing flag.  Zone names are kept by pointer, so they must be string
+// literals or come from internName.
+class TraceProfiler {
+public:
+  // Zones kept per thread, once a thread has recorded more than this during a
+  // capture its oldest zones are overwritten.
+  static size_t const ThreadBufferSize = 65536;
+
+  // Records a zone covering its own lifetime, if a capture was running when
+  // it was created.
+  class Scope {
+  public:
+    Scope(char const* name);
+    ~Scope();
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+
+  private:
+    char const* m_name;
+    double m_start;
+  };
+
+  static bool capturing();
+
+  // Starts a new capture, zones recorded before this are not exported.
+  static void startCapture();
+  // Stops the capture and returns every zone recorded during it as Chrome
+  // trace Json.  Threads that exited during the capture are included.
+  static Json stopCapture();
+  // Stops the capture and writes it to a new time stamped file in the given
+  // directory, returning the path of the file.
+  static String stopCaptureToFile(String const& directory);
+
+  // Records a zone with the given Time::monotonicTime() start and end, does
+  // nothing if no capture is running.
+  static void record(char const* name, double start, double end);
+
+  // Returns a pointer to a copy of the given name that lives for the rest of
+  // the program, for zones whose names are not literals.  Only the first use
+  // of a name on each thread locks.
+  static char const* internName(String const& name);
+
+private:
+  struct Zone;
+  struct ThreadBuffer;
+  struct ThreadBufferHolder;
+  struct Registry;
+
+  static Registry& registry();
+  static ThreadBuffer& threadBuffer();
+
+  static atomic<bool> s_capturing;
+};
+
+#define STAR_PROFILE_SCOPE_NAME2(line) starProfileScope##line
+#define STAR_PROFILE_SCOPE_NAME(line) STAR_PROFILE_SCOPE_NAME2(line)
+// Records the rest of the enclosing scope as a zone with the given name
+#define STAR_PROFILE_SCOPE(name) ::Star::TraceProfiler::Scope STAR_PROFILE_SCOPE_NAME(__LINE__)(name)
+
+}
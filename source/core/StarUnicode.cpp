@@ -15,6 +15,19 @@ void throwInvalidUtf32CodePoint(Utf32Type val) {
   throw UnicodeException::format("Invalid UTF-32 code point {} encountered while trying to encode UTF-8", (int32_t)val);
 }
 
+bool utf8IsAscii(Utf8Type const* utf8, size_t size) {
+  size_t i = 0;
+  uint64_t high = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, utf8 + i, 8);
+    high |= word;
+  }
+  for (; i < size; ++i)
+    high |= (uint8_t)utf8[i];
+  return (high & 0x8080808080808080ull) == 0;
+}
+
 size_t utf8Length(const Utf8Type* utf8, size_t remain) {
   bool stopOnNull = remain == NPos;
   size_t length = 0;
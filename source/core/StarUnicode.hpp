@@ -19,6 +19,9 @@ void throwInvalidUtf32CodePoint(Utf32Type val);
 // If passed NPos as a size, assumes modified UTF-8 and stops on NULL byte.
 // Otherwise, ignores NULL.
 size_t utf8Length(Utf8Type const* utf8, size_t size = NPos);
+// Whether the given bytes are all 7-bit ASCII, where every byte is exactly
+// one code point.  Checks a machine word at a time.
+bool utf8IsAscii(Utf8Type const* utf8, size_t size);
 // Encode up to six utf8 bytes into a utf32 character.  If passed NPos as len,
 // assumes modified UTF-8 and stops on NULL, otherwise ignores.
 size_t utf8DecodeChar(Utf8Type const* utf8, Utf32Type* utf32, size_t len = NPos);
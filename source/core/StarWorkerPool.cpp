@@ -41,7 +41,68 @@ WorkerPoolHandle::Impl::Impl() : done(false) {}
 
 WorkerPoolHandle::WorkerPoolHandle(shared_ptr<Impl> impl) : m_impl(std::move(impl)) {}
 
-WorkerPool::WorkerPool(String name) : m_name(std::move(name)) {}
+void CompletionQueue::post(function<void()> callback) {
+  MutexLocker locker(m_mutex);
+  m_callbacks.append(std::move(callback));
+}
+
+size_t CompletionQueue::run() {
+  // Take callbacks one at a time, so that any left behind by a callback that
+  // throws are still run by the next call, and callbacks posted while running
+  // wait for the next call.
+  MutexLocker locker(m_mutex);
+  size_t count = m_callbacks.size();
+  for (size_t i = 0; i < count; ++i) {
+    auto callback = m_callbacks.takeFirst();
+    locker.unlock();
+    callback();
+    locker.lock();
+  }
+  return count;
+}
+
+WorkerPoolGroup::WorkerPoolGroup(WorkerPool& workerPool)
+  : m_workerPool(&workerPool), m_pending(0) {}
+
+WorkerPoolGroup::~WorkerPoolGroup() {
+  waitForPending();
+}
+
+void WorkerPoolGroup::add(function<void()> work) {
+  ++m_pending;
+  m_workerPool->queueWork([this, work = std::move(work)]() {
+    try {
+      work();
+    } catch (...) {
+      MutexLocker exceptionLocker(m_exceptionMutex);
+      if (!m_exception)
+        m_exception = std::current_exception();
+    }
+    --m_pending;
+  });
+}
+
+void WorkerPoolGroup::wait() {
+  waitForPending();
+
+  MutexLocker exceptionLocker(m_exceptionMutex);
+  if (auto exception = take(m_exception))
+    std::rethrow_exception(exception);
+}
+
+void WorkerPoolGroup::waitForPending() {
+  // Rather than blocking, run whatever work is pending in the pool, which may
+  // or may not belong to this group.  If there is nothing left to take, the
+  // remaining work is already running on other threads.
+  while (m_pending != 0) {
+    if (!m_workerPool->runPendingWork())
+      Thread::yield();
+  }
+}
+
+thread_local WorkerPool::WorkerThread* WorkerPool::s_currentWorker = nullptr;
+
+WorkerPool::WorkerPool(String name) : m_name(std::move(name)), m_queuedWork(0), m_idleWorkers(0) {}
 
 WorkerPool::WorkerPool(String name, unsigned threadCount) : WorkerPool(std::move(name)) {
   start(threadCount);
@@ -51,53 +112,28 @@ WorkerPool::~WorkerPool() {
   stop();
 }
 
-WorkerPool::WorkerPool(WorkerPool&&) = default;
-WorkerPool& WorkerPool::operator=(WorkerPool&&) = default;
-
 void WorkerPool::start(unsigned threadCount) {
   MutexLocker threadLock(m_threadMutex);
 
-  for (auto const& workerThread : m_workerThreads)
-    workerThread->shouldStop = true;
-
-  m_workCondition.broadcast();
-  m_workerThreads.clear();
+  stopWorkers();
 
-  for (size_t i = m_workerThreads.size(); i < threadCount; ++i)
-    m_workerThreads.append(make_unique<WorkerThread>(this));
+  for (size_t i = 0; i < threadCount; ++i)
+    m_workerThreads.append(make_unique<WorkerThread>(this, i));
 }
 
 void WorkerPool::stop() {
   MutexLocker threadLock(m_threadMutex);
-  for (auto const& workerThread : m_workerThreads)
-    workerThread->shouldStop = true;
-
-  {
-    // Must hold the work lock while broadcasting to ensure that any worker
-    // threads that might wait without stopping actually get the signal.
-    MutexLocker workLock(m_workMutex);
-    m_workCondition.broadcast();
-  }
-
-  m_workerThreads.clear();
+  stopWorkers();
 }
 
 void WorkerPool::finish() {
   // This is kind of a weird way to "wait" until all the pending work is
   // finished.  In order for the currently active worker threads to
-  // cooperatively complete the remaining work, the work lock must not be held
-  // the entire time (then just this thread would be the one finishing the
-  // work).  Instead, the calling thread joins in on the action and tries to
-  // finish work while yielding to the other threads after each completed job.
-  MutexLocker workMutex(m_workMutex);
-  while (!m_pendingWork.empty()) {
-    auto firstWork = m_pendingWork.takeFirst();
-    workMutex.unlock();
-    firstWork();
+  // cooperatively complete the remaining work, the calling thread joins in on
+  // the action and tries to finish work while yielding to the other threads
+  // after each completed job.
+  while (runPendingWork())
     Thread::yield();
-    workMutex.lock();
-  }
-  workMutex.unlock();
 
   stop();
 }
@@ -124,13 +160,50 @@ WorkerPoolHandle WorkerPool::addWork(function<void()> work) {
   return workerPoolHandleImpl;
 }
 
+void WorkerPool::parallelFor(size_t begin, size_t end, size_t grainSize, function<void(size_t, size_t)> const& function) {
+  if (begin >= end)
+    return;
+
+  grainSize = max<size_t>(grainSize, 1);
+  WorkerPoolGroup group(*this);
+  // Keep the first chunk for the calling thread, it would only be waiting
+  // otherwise.
+  size_t firstEnd = min(begin + grainSize, end);
+  for (size_t chunkBegin = firstEnd; chunkBegin < end; chunkBegin += grainSize) {
+    size_t chunkEnd = min(chunkBegin + grainSize, end);
+    group.add([&function, chunkBegin, chunkEnd]() {
+      function(chunkBegin, chunkEnd);
+    });
+  }
+
+  std::exception_ptr exception;
+  try {
+    function(begin, firstEnd);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  // Every chunk references the function, so they must all be finished before
+  // returning even if the first one threw.
+  try {
+    group.wait();
+  } catch (...) {
+    if (!exception)
+      exception = std::current_exception();
+  }
+
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
 size_t WorkerPool::getWorkerCount() const {
   return m_workerThreads.size();
 }
 
-WorkerPool::WorkerThread::WorkerThread(WorkerPool* parent)
+WorkerPool::WorkerThread::WorkerThread(WorkerPool* parent, size_t index)
   : Thread(strf("WorkerThread for WorkerPool '{}'", parent->m_name)),
     parent(parent),
+    index(index),
     shouldStop(false),
     waiting(false) {
   start();
@@ -141,30 +214,119 @@ WorkerPool::WorkerThread::~WorkerThread() {
 }
 
 void WorkerPool::WorkerThread::run() {
-  MutexLocker workLock(parent->m_workMutex);
-  while (true) {
-    if (shouldStop)
-      break;
+  s_currentWorker = this;
+
+  while (!shouldStop) {
+    if (auto work = parent->takeWork(this)) {
+      work();
+      continue;
+    }
 
-    if (parent->m_pendingWork.empty()) {
+    // Register as idle before checking for work, queueWork checks in the
+    // opposite order, so one side or the other always sees the other.
+    MutexLocker workLock(parent->m_workMutex);
+    ++parent->m_idleWorkers;
+    if (!shouldStop && parent->m_queuedWork == 0) {
       waiting = true;
       parent->m_workCondition.wait(parent->m_workMutex);
       waiting = false;
     }
+    --parent->m_idleWorkers;
+  }
 
-    if (!parent->m_pendingWork.empty()) {
-      auto work = parent->m_pendingWork.takeFirst();
-      workLock.unlock();
-      work();
-      workLock.lock();
+  s_currentWorker = nullptr;
+}
+
+void WorkerPool::queueWork(function<void()> work) {
+  auto worker = s_currentWorker;
+  if (worker && worker->parent == this) {
+    {
+      MutexLocker queueLock(worker->queueMutex);
+      worker->queue.append(std::move(work));
     }
+    ++m_queuedWork;
+    if (m_idleWorkers != 0) {
+      MutexLocker workLock(m_workMutex);
+      m_workCondition.signal();
+    }
+
+  } else {
+    MutexLocker workLock(m_workMutex);
+    m_pendingWork.append(std::move(work));
+    ++m_queuedWork;
+    m_workCondition.signal();
   }
 }
 
-void WorkerPool::queueWork(function<void()> work) {
+function<void()> WorkerPool::takeWork(WorkerThread* worker) {
+  if (m_queuedWork == 0)
+    return {};
+
+  if (worker) {
+    MutexLocker queueLock(worker->queueMutex);
+    if (!worker->queue.empty()) {
+      --m_queuedWork;
+      return worker->queue.takeLast();
+    }
+  }
+
+  {
+    MutexLocker workLock(m_workMutex);
+    if (!m_pendingWork.empty()) {
+      --m_queuedWork;
+      return m_pendingWork.takeFirst();
+    }
+  }
+
+  size_t workerCount = m_workerThreads.size();
+  size_t first = worker ? worker->index + 1 : 0;
+  for (size_t i = 0; i < workerCount; ++i) {
+    auto victim = m_workerThreads[(first + i) % workerCount].get();
+    if (victim == worker)
+      continue;
+
+    MutexLocker queueLock(victim->queueMutex);
+    if (!victim->queue.empty()) {
+      --m_queuedWork;
+      return victim->queue.takeFirst();
+    }
+  }
+
+  return {};
+}
+
+bool WorkerPool::runPendingWork() {
+  auto worker = s_currentWorker;
+  if (auto work = takeWork(worker && worker->parent == this ? worker : nullptr)) {
+    work();
+    return true;
+  }
+  return false;
+}
+
+void WorkerPool::stopWorkers() {
+  for (auto const& workerThread : m_workerThreads)
+    workerThread->shouldStop = true;
+
+  {
+    // Must hold the work lock while broadcasting to ensure that any worker
+    // threads that might wait without stopping actually get the signal.
+    MutexLocker workLock(m_workMutex);
+    m_workCondition.broadcast();
+  }
+
+  // Every worker must be joined before any is destroyed, since running
+  // workers may be stealing from any other worker's queue.
+  for (auto const& workerThread : m_workerThreads)
+    workerThread->join();
+
   MutexLocker workLock(m_workMutex);
-  m_pendingWork.append(std::move(work));
-  m_workCondition.signal();
+  for (auto const& workerThread : m_workerThreads) {
+    while (!workerThread->queue.empty())
+      m_pendingWork.append(workerThread->queue.takeFirst());
+  }
+
+  m_workerThreads.clear();
 }
 
 }
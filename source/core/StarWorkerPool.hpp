@@ -7,6 +7,23 @@ namespace Star {
 STAR_EXCEPTION(WorkerPoolException, StarException);
 
 STAR_CLASS(WorkerPool);
+STAR_CLASS(CompletionQueue);
+
+// Queue of callbacks that any thread may post to, but that are only run by the
+// thread that owns the queue, so that work finished in the background can be
+// continued on the thread that requested it.
+class CompletionQueue {
+public:
+  void post(function<void()> callback);
+
+  // Runs every callback posted so far, in the order they were posted, on the
+  // calling thread.  Returns the number of callbacks run.
+  size_t run();
+
+private:
+  Mutex m_mutex;
+  Deque<function<void()>> m_callbacks;
+};
 
 // Shareable handle for a WorkerPool computation that does not produce any
 // value.
@@ -69,6 +86,12 @@ public:
   ResultType& get();
   ResultType const& get() const;
 
+  // Once the work is done, posts a call to the given continuation with the
+  // result to the completion queue, rather than requiring the owning thread
+  // to poll.  If the producer threw, the exception is instead re-thrown from
+  // CompletionQueue::run.  Only one continuation may be set per promise.
+  void then(CompletionQueuePtr queue, function<void(ResultType&)> continuation);
+
 private:
   friend WorkerPool;
 
@@ -77,6 +100,7 @@ private:
     ConditionVariable condition;
     Maybe<ResultType> result;
     std::exception_ptr exception;
+    function<void()> onDone;
   };
 
   WorkerPoolPromise(shared_ptr<Impl> impl);
@@ -84,6 +108,40 @@ private:
   shared_ptr<Impl> m_impl;
 };
 
+// A group of work added to a WorkerPool that is waited on as a whole.
+// Waiting on a group does not block, the waiting thread helps run pending work
+// from the pool until the group is done, so groups may be waited on from
+// inside work that is itself running on the pool, and waiting on a group from
+// a stopped pool simply runs its work on the waiting thread.
+class WorkerPoolGroup {
+public:
+  WorkerPoolGroup(WorkerPool& workerPool);
+  // Waits for any unfinished work, but does not re-throw.
+  ~WorkerPoolGroup();
+
+  WorkerPoolGroup(WorkerPoolGroup const&) = delete;
+  WorkerPoolGroup& operator=(WorkerPoolGroup const&) = delete;
+
+  void add(function<void()> work);
+
+  // Returns once all of the work added so far is complete.  If any of it
+  // threw, the first exception is re-thrown here.
+  void wait();
+
+private:
+  void waitForPending();
+
+  WorkerPool* m_workerPool;
+  atomic<size_t> m_pending;
+  Mutex m_exceptionMutex;
+  std::exception_ptr m_exception;
+};
+
+// Thread pool where every worker thread has its own work queue.  Work added
+// from a worker thread goes to that thread's queue and is taken newest first,
+// work added from anywhere else goes to a shared queue, and idle workers steal
+// the oldest work from other workers' queues.  Groups and parallelFor must
+// not be used while the pool is being started or stopped.
 class WorkerPool {
 public:
   // Creates a stopped pool
@@ -92,8 +150,9 @@ public:
   WorkerPool(String name, unsigned threadCount);
   ~WorkerPool();
 
-  WorkerPool(WorkerPool&&);
-  WorkerPool& operator=(WorkerPool&&);
+  // Worker threads hold a pointer to their pool, so it must stay put.
+  WorkerPool(WorkerPool const&) = delete;
+  WorkerPool& operator=(WorkerPool const&) = delete;
 
   // Start the thread pool with the given thread count range, or if it is
   // already started, reconfigure the thread counts.
@@ -121,25 +180,52 @@ public:
   template <typename ResultType>
   WorkerPoolPromise<ResultType> addProducer(function<ResultType()> producer);
 
+  // Splits the range [begin, end) into chunks of at most grainSize and calls
+  // the given function with the bounds of every chunk, spread across the pool
+  // and the calling thread.  Returns once every chunk is done, re-throwing the
+  // first exception if any chunk threw.  Safe to call from inside pool work.
+  void parallelFor(size_t begin, size_t end, size_t grainSize, function<void(size_t, size_t)> const& function);
+
   // Returns the current number of worker threads.
   size_t getWorkerCount() const;
 
 private:
+  friend WorkerPoolGroup;
+
   class WorkerThread : public Thread {
   public:
     // Starts automatically
-    WorkerThread(WorkerPool* parent);
+    WorkerThread(WorkerPool* parent, size_t index);
     ~WorkerThread();
 
     void run() override;
 
     WorkerPool* parent;
+    size_t index;
     atomic<bool> shouldStop;
     atomic<bool> waiting;
+
+    Mutex queueMutex;
+    Deque<function<void()>> queue;
   };
 
+  static thread_local WorkerThread* s_currentWorker;
+
   void queueWork(function<void()> work);
 
+  // Takes the next piece of work for the given worker, or for a thread
+  // outside the pool if worker is null, stealing from other workers if there
+  // is nothing closer.  Returns an empty function if there is no work at all.
+  function<void()> takeWork(WorkerThread* worker);
+
+  // Runs one piece of pending work on the calling thread, returns false if
+  // there was none.
+  bool runPendingWork();
+
+  // Stops and joins every worker, moving any work left in their queues back to
+  // the shared queue.  m_threadMutex must be held.
+  void stopWorkers();
+
   String m_name;
   Mutex m_threadMutex;
   List<unique_ptr<WorkerThread>> m_workerThreads;
@@ -147,6 +233,10 @@ private:
   Mutex m_workMutex;
   ConditionVariable m_workCondition;
   Deque<function<void()>> m_pendingWork;
+
+  // Work waiting in any queue, and workers waiting on m_workCondition.
+  atomic<size_t> m_queuedWork;
+  atomic<size_t> m_idleWorkers;
 };
 
 template <typename ResultType>
@@ -194,6 +284,26 @@ ResultType const& WorkerPoolPromise<ResultType>::get() const {
   return const_cast<WorkerPoolPromise*>(this)->get();
 }
 
+template <typename ResultType>
+void WorkerPoolPromise<ResultType>::then(CompletionQueuePtr queue, function<void(ResultType&)> continuation) {
+  auto postContinuation = [impl = m_impl, queue = std::move(queue), continuation = std::move(continuation)]() {
+    queue->post([impl, continuation]() {
+        continuation(WorkerPoolPromise(impl).get());
+      });
+  };
+
+  MutexLocker locker(m_impl->mutex);
+  if (m_impl->onDone)
+    throw WorkerPoolException("then called more than once on WorkerPoolPromise");
+
+  if (m_impl->result || m_impl->exception) {
+    locker.unlock();
+    postContinuation();
+  } else {
+    m_impl->onDone = std::move(postContinuation);
+  }
+}
+
 template <typename ResultType>
 WorkerPoolPromise<ResultType>::WorkerPoolPromise(shared_ptr<Impl> impl)
   : m_impl(std::move(impl)) {}
@@ -204,16 +314,21 @@ WorkerPoolPromise<ResultType> WorkerPool::addProducer(function<ResultType()> pro
   // promise when finished.
   auto workerPoolPromiseImpl = make_shared<typename WorkerPoolPromise<ResultType>::Impl>();
   queueWork([workerPoolPromiseImpl, producer]() {
+    function<void()> onDone;
     try {
       auto result = producer();
       MutexLocker promiseLocker(workerPoolPromiseImpl->mutex);
       workerPoolPromiseImpl->result = std::move(result);
       workerPoolPromiseImpl->condition.broadcast();
+      onDone = take(workerPoolPromiseImpl->onDone);
     } catch (...) {
       MutexLocker promiseLocker(workerPoolPromiseImpl->mutex);
       workerPoolPromiseImpl->exception = std::current_exception();
       workerPoolPromiseImpl->condition.broadcast();
+      onDone = take(workerPoolPromiseImpl->onDone);
     }
+    if (onDone)
+      onDone();
   });
 
   return workerPoolPromiseImpl;
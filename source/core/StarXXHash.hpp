@@ -43,6 +43,20 @@ private:
   XXH3_state_s state;
 };
 
+// 128 bit XXH3, for keys that need to be unlikely to collide but not secure.
+// The digest is 16 bytes in canonical (big endian) order.
+class XXHash128 {
+public:
+  XXHash128();
+
+  void push(char const* data, size_t length);
+  void push(ByteArray const& data);
+  ByteArray digest();
+
+private:
+  XXH3_state_s state;
+};
+
 
 uint32_t xxHash32(char const* source, size_t length);
 uint32_t xxHash32(ByteArray const& in);
@@ -167,6 +181,24 @@ inline uint64_t XXHash3::digest() {
   return XXH3_64bits_digest(&state);
 }
 
+inline XXHash128::XXHash128() {
+  XXH3_128bits_reset(&state);
+}
+
+inline void XXHash128::push(char const* data, size_t length) {
+  XXH3_128bits_update(&state, data, length);
+}
+
+inline void XXHash128::push(ByteArray const& data) {
+  push(data.ptr(), data.size());
+}
+
+inline ByteArray XXHash128::digest() {
+  XXH128_canonical_t canonical;
+  XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(&state));
+  return ByteArray((char const*)canonical.digest, sizeof(canonical.digest));
+}
+
 inline uint32_t xxHash32(char const* source, size_t length) {
   return XXH32(source, length, 0);
 }
@@ -1,17 +1,31 @@
 #include "StarZSTDCompression.hpp"
 #include <zstd.h>
+#include <zdict.h>
 
 namespace Star {
 
-CompressionStream::CompressionStream() : m_cStream(ZSTD_createCStream()) {
+CompressionStream::CompressionStream()
+  : m_cStream(ZSTD_createCStream()), m_compressionLevel(2), m_compressionLevelChanged(false) {
   ZSTD_CCtx_setParameter(m_cStream, ZSTD_c_enableLongDistanceMatching, 1);
   ZSTD_CCtx_setParameter(m_cStream, ZSTD_c_windowLog, 24);
-  ZSTD_initCStream(m_cStream, 2);
+  ZSTD_initCStream(m_cStream, m_compressionLevel);
 }
 
 CompressionStream::~CompressionStream() { ZSTD_freeCStream(m_cStream); }
 
 void CompressionStream::compress(const char* in, size_t inLen, ByteArray& out) {
+  if (m_compressionLevelChanged) {
+    // The level of a frame is fixed once it has started
+    compressStream(nullptr, 0, out, true);
+    size_t ret = ZSTD_CCtx_setParameter(m_cStream, ZSTD_c_compressionLevel, m_compressionLevel);
+    if (ZSTD_isError(ret))
+      throw IOException(strf("ZSTD compression error {}", ZSTD_getErrorName(ret)));
+    m_compressionLevelChanged = false;
+  }
+  compressStream(in, inLen, out, false);
+}
+
+void CompressionStream::compressStream(const char* in, size_t inLen, ByteArray& out, bool endFrame) {
   size_t const cOutSize = ZSTD_CStreamOutSize();
   ZSTD_inBuffer inBuffer = {in, inLen, 0};
   size_t written = out.size();
@@ -19,7 +33,7 @@ void CompressionStream::compress(const char* in, size_t inLen, ByteArray& out) {
   bool finished = false;
   do {
     ZSTD_outBuffer outBuffer = {out.ptr() + written, min(cOutSize, out.size() - written), 0};
-    size_t ret = ZSTD_compressStream2(m_cStream, &outBuffer, &inBuffer, ZSTD_e_flush);
+    size_t ret = ZSTD_compressStream2(m_cStream, &outBuffer, &inBuffer, endFrame ? ZSTD_e_end : ZSTD_e_flush);
     if (ZSTD_isError(ret)) {
       throw IOException(strf("ZSTD compression error {}", ZSTD_getErrorName(ret)));
       break;
@@ -54,6 +68,17 @@ ByteArray CompressionStream::compress(ByteArray const& in) {
   return out;
 }
 
+void CompressionStream::setCompressionLevel(int compressionLevel) {
+  if (compressionLevel != m_compressionLevel) {
+    m_compressionLevel = compressionLevel;
+    m_compressionLevelChanged = true;
+  }
+}
+
+int CompressionStream::compressionLevel() const {
+  return m_compressionLevel;
+}
+
 DecompressionStream::DecompressionStream() : m_dStream(ZSTD_createDStream()) {
   ZSTD_DCtx_setParameter(m_dStream, ZSTD_d_windowLogMax, 25);
   ZSTD_initDStream(m_dStream);
@@ -161,4 +186,116 @@ void ZstdCompression::decompress(ByteArray const& in, ByteArray& out) {
   out = decompress(in);
 }
 
+bool ZstdCompression::isFrame(const char* in, size_t inLen) {
+  if (inLen < 4)
+    return false;
+  auto bytes = (unsigned char const*)in;
+  uint32_t magic = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+  return magic == ZSTD_MAGICNUMBER;
+}
+
+bool ZstdCompression::isFrame(ByteArray const& in) {
+  return isFrame(in.ptr(), in.size());
+}
+
+unsigned ZstdCompression::frameDictionaryId(const char* in, size_t inLen) {
+  return ZSTD_getDictID_fromFrame(in, inLen);
+}
+
+unsigned ZstdCompression::frameDictionaryId(ByteArray const& in) {
+  return frameDictionaryId(in.ptr(), in.size());
+}
+
+namespace {
+  // Compression contexts are not thread safe but are expensive to create, so
+  // keep one around per thread for dictionary use.
+  struct ZstdThreadContexts {
+    ZstdThreadContexts() : cCtx(ZSTD_createCCtx()), dCtx(ZSTD_createDCtx()) {}
+    ~ZstdThreadContexts() {
+      ZSTD_freeCCtx(cCtx);
+      ZSTD_freeDCtx(dCtx);
+    }
+
+    ZSTD_CCtx* cCtx;
+    ZSTD_DCtx* dCtx;
+  };
+
+  ZstdThreadContexts& zstdThreadContexts() {
+    thread_local ZstdThreadContexts contexts;
+    return contexts;
+  }
+}
+
+ByteArray ZstdDictionary::train(List<ByteArray> const& samples, size_t maxDictionarySize) {
+  ByteArray sampleBuffer;
+  List<size_t> sampleSizes;
+  for (auto const& sample : samples) {
+    if (sample.empty())
+      continue;
+    sampleBuffer.append(sample);
+    sampleSizes.append(sample.size());
+  }
+
+  ByteArray dictionary(maxDictionarySize, 0);
+  size_t dictionarySize = ZDICT_trainFromBuffer(dictionary.ptr(), maxDictionarySize,
+      sampleBuffer.ptr(), sampleSizes.ptr(), (unsigned)sampleSizes.size());
+  if (ZDICT_isError(dictionarySize))
+    throw IOException(strf("ZSTD dictionary training error {}", ZDICT_getErrorName(dictionarySize)));
+
+  dictionary.resize(dictionarySize);
+  return dictionary;
+}
+
+ZstdDictionary::ZstdDictionary(ByteArray const& dictionary, int compressionLevel) {
+  m_cDict = ZSTD_createCDict(dictionary.ptr(), dictionary.size(), compressionLevel);
+  m_dDict = ZSTD_createDDict(dictionary.ptr(), dictionary.size());
+  if (!m_cDict || !m_dDict) {
+    ZSTD_freeCDict(m_cDict);
+    ZSTD_freeDDict(m_dDict);
+    throw IOException("Could not load ZSTD dictionary");
+  }
+  m_id = ZSTD_getDictID_fromDDict(m_dDict);
+}
+
+ZstdDictionary::~ZstdDictionary() {
+  ZSTD_freeCDict(m_cDict);
+  ZSTD_freeDDict(m_dDict);
+}
+
+unsigned ZstdDictionary::id() const {
+  return m_id;
+}
+
+ByteArray ZstdDictionary::compress(const char* in, size_t inLen) const {
+  ByteArray out(ZSTD_compressBound(inLen), 0);
+  size_t compressedSize = ZSTD_compress_usingCDict(zstdThreadContexts().cCtx, out.ptr(), out.size(), in, inLen, m_cDict);
+  if (ZSTD_isError(compressedSize))
+    throw IOException(strf("ZSTD compression error {}", ZSTD_getErrorName(compressedSize)));
+
+  out.resize(compressedSize);
+  return out;
+}
+
+ByteArray ZstdDictionary::compress(ByteArray const& in) const {
+  return compress(in.ptr(), in.size());
+}
+
+ByteArray ZstdDictionary::decompress(const char* in, size_t inLen) const {
+  unsigned long long const frameContentSize = ZSTD_getFrameContentSize(in, inLen);
+  if (frameContentSize == ZSTD_CONTENTSIZE_ERROR || frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+    throw IOException("Cannot determine ZSTD decompressed size");
+
+  ByteArray out(frameContentSize, 0);
+  size_t result = ZSTD_decompress_usingDDict(zstdThreadContexts().dCtx, out.ptr(), out.size(), in, inLen, m_dDict);
+  if (ZSTD_isError(result))
+    throw IOException(strf("ZSTD decompression error {}", ZSTD_getErrorName(result)));
+
+  out.resize(result);
+  return out;
+}
+
+ByteArray ZstdDictionary::decompress(ByteArray const& in) const {
+  return decompress(in.ptr(), in.size());
+}
+
 }
@@ -6,9 +6,13 @@ typedef struct ZSTD_CCtx_s ZSTD_CCtx;
 typedef struct ZSTD_DCtx_s ZSTD_DCtx;
 typedef ZSTD_DCtx ZSTD_DStream;
 typedef ZSTD_CCtx ZSTD_CStream;
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
 
 namespace Star {
 
+STAR_CLASS(ZstdDictionary);
+
 class CompressionStream {
 public:
   CompressionStream();
@@ -19,8 +23,18 @@ public:
   ByteArray compress(const char* in, size_t inLen);
   ByteArray compress(ByteArray const& in);
 
+  // Takes effect from the next call to compress, which first ends the current
+  // frame so that the new level applies to the next one.  Data compressed
+  // across a frame boundary cannot refer to data before it.
+  void setCompressionLevel(int compressionLevel);
+  int compressionLevel() const;
+
 private:
+  void compressStream(const char* in, size_t inLen, ByteArray& out, bool endFrame);
+
   ZSTD_CStream* m_cStream;
+  int m_compressionLevel;
+  bool m_compressionLevelChanged;
 };
 
 class DecompressionStream {
@@ -48,6 +62,40 @@ public:
   static void decompress(ByteArray const& in, ByteArray& out);
   static ByteArray decompress(const char* in, size_t inLen);
   static ByteArray decompress(ByteArray const& in);
+
+  // True if the data begins with a ZSTD frame header
+  static bool isFrame(const char* in, size_t inLen);
+  static bool isFrame(ByteArray const& in);
+  // The id of the dictionary the frame was compressed with, or 0 if none
+  static unsigned frameDictionaryId(const char* in, size_t inLen);
+  static unsigned frameDictionaryId(ByteArray const& in);
+};
+
+// A pre-digested ZSTD dictionary, safe to use from multiple threads at once.
+class ZstdDictionary {
+public:
+  // Trains a dictionary of at most maxDictionarySize bytes from the given
+  // samples, throws IOException if there is not enough sample data.
+  static ByteArray train(List<ByteArray> const& samples, size_t maxDictionarySize);
+
+  ZstdDictionary(ByteArray const& dictionary, int compressionLevel = 3);
+  ~ZstdDictionary();
+
+  ZstdDictionary(ZstdDictionary const&) = delete;
+  ZstdDictionary& operator=(ZstdDictionary const&) = delete;
+
+  unsigned id() const;
+
+  ByteArray compress(const char* in, size_t inLen) const;
+  ByteArray compress(ByteArray const& in) const;
+
+  ByteArray decompress(const char* in, size_t inLen) const;
+  ByteArray decompress(ByteArray const& in) const;
+
+private:
+  ZSTD_CDict* m_cDict;
+  ZSTD_DDict* m_dDict;
+  unsigned m_id;
 };
 
 }
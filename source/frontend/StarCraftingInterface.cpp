@@ -105,6 +105,10 @@ CraftingPane::CraftingPane(WorldClientPtr worldClient, PlayerPtr player, Json co
   }
 
   m_guiList = fetchChild<ListWidget>("scrollArea.itemList");
+  m_guiList->setItemPresenter([this](WidgetPtr const& widget) {
+      if (auto recipe = m_recipesWidgetMap.maybeLeft(widget))
+        setupWidget(widget, *recipe, m_normalizedBag);
+    });
   m_textBox = fetchChild<TextBoxWidget>("tbSpinCount");
 
   m_filterHaveMaterials = fetchChild<ButtonWidget>("btnFilterHaveMaterials");
@@ -279,7 +283,9 @@ void CraftingPane::update(float dt) {
       currentRecipeIcon->setItem(nullptr);
     } else {
       auto single = recipe.output.singular();
-      ItemPtr item = m_itemCache[single];
+      ItemPtr& item = m_itemCache[single];
+      if (!item)
+        item = Root::singleton().itemDatabase()->itemShared(single);
       currentRecipeIcon->setItem(item);
 
       if (m_crafting)
@@ -302,6 +308,15 @@ void CraftingPane::update(float dt) {
   Pane::update(dt);
 }
 
+HashSet<ItemRecipe> CraftingPane::availableRecipes(HashSet<ItemRecipe> const& offeredRecipes) {
+  // The recipes a pane offers do not change while it is open, so only the
+  // recipes using items that changed since the last refresh are rechecked.
+  if (!m_recipeAvailability)
+    m_recipeAvailability.emplace(offeredRecipes, m_filter);
+  m_recipeAvailability->update(m_player->inventory()->availableItems(), m_player->inventory()->availableCurrencies());
+  return m_recipeAvailability->available();
+}
+
 void CraftingPane::updateCraftButtons() {
   auto normalizedBag = m_player->inventory()->availableItems();
   auto availableCurrencies = m_player->inventory()->availableCurrencies();
@@ -357,27 +372,30 @@ void CraftingPane::updateAvailableRecipes() {
   if (m_guiList->selectedWidget())
     selectedRecipe = m_recipesWidgetMap.getLeft(m_guiList->selectedWidget());
 
-  HashMap<ItemDescriptor, uint64_t> normalizedBag = m_player->inventory()->availableItems();
-
-  m_guiList->clear();
+  m_normalizedBag = m_player->inventory()->availableItems();
 
+  // Rows are only configured by the list's presenter once they scroll into
+  // view, so refreshing a large recipe list only touches the visible widgets.
+  List<WidgetPtr> widgets;
+  widgets.reserve(m_recipes.size());
+  Maybe<size_t> selectedOffset;
   for (auto const& recipe : m_recipes) {
     auto widget = m_recipesWidgetMap.valueRight(recipe);
-    if (widget) {
-      m_guiList->addItem(widget);
-    } else {
-      widget = m_guiList->addItem();
+    if (!widget) {
+      widget = m_guiList->constructWidget();
       m_recipesWidgetMap.add(recipe, widget);
     }
+    widgets.append(widget);
 
-    setupWidget(widget, recipe, normalizedBag);
-
-    if (selectedRecipe == recipe) {
-      m_guiList->setSelected(currentOffset);
-    }
+    if (selectedRecipe == recipe)
+      selectedOffset = currentOffset;
 
     currentOffset++;
   }
+
+  m_guiList->setItems(widgets);
+  if (selectedOffset)
+    m_guiList->setSelected(*selectedOffset);
 }
 
 void CraftingPane::setupWidget(WidgetPtr const& widget, ItemRecipe const& recipe, HashMap<ItemDescriptor, uint64_t> const& normalizedBag) {
@@ -690,10 +708,10 @@ List<ItemRecipe> CraftingPane::determineRecipes() {
     }
 
     if (filterHaveMaterials)
-      recipes.addAll(itemDb->recipesFromSubset(m_player->inventory()->availableItems(), m_player->inventory()->availableCurrencies(), take(recipes), m_filter));
+      recipes = availableRecipes(recipes);
   } else {
     if (filterHaveMaterials)
-      recipes.addAll(itemDb->recipesFromBagContents(m_player->inventory()->availableItems(), m_player->inventory()->availableCurrencies(), m_filter));
+      recipes = availableRecipes(itemDb->allRecipes());
     else
       recipes.addAll(itemDb->allRecipes(m_filter));
   }
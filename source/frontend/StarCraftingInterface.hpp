@@ -2,7 +2,7 @@
 
 #include "StarWorldPainter.hpp"
 #include "StarWorldClient.hpp"
-#include "StarItemRecipe.hpp"
+#include "StarRecipeAvailability.hpp"
 #include "StarPane.hpp"
 
 namespace Star {
@@ -32,6 +32,9 @@ private:
   void upgradeTable();
 
   List<ItemRecipe> determineRecipes();
+  // The recipes out of those the pane offers that the player has the
+  // materials for
+  HashSet<ItemRecipe> availableRecipes(HashSet<ItemRecipe> const& offeredRecipes);
 
   virtual void update(float dt) override;
   void updateCraftButtons();
@@ -72,6 +75,7 @@ private:
   int m_maxSpinCount;
 
   int m_recipeAutorefreshCooldown;
+  HashMap<ItemDescriptor, uint64_t> m_normalizedBag;
 
   HashMap<ItemDescriptor, ItemPtr> m_itemCache;
 
@@ -79,6 +83,8 @@ private:
   Json m_settings;
 
   Maybe<ItemRecipe> m_upgradeRecipe;
+
+  Maybe<RecipeAvailability> m_recipeAvailability;
 };
 
 }
@@ -60,6 +60,7 @@
 #include "StarChatBubbleManager.hpp"
 #include "StarNpc.hpp"
 #include "StarCharSelection.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
@@ -856,6 +857,7 @@ void MainInterface::renderInWorldElements() {
 }
 
 void MainInterface::render() {
+  STAR_PROFILE_SCOPE("MainInterface::render");
   if (m_disableHud)
     return;
 
@@ -75,6 +75,8 @@ void MainMixer::update(float dt, bool muteSfx, bool muteMusic) {
         m_mixer->removeEffect("echo", 0.5f);
     }
 
+    m_mixer->setMaxVoices(assets->json("/sfx.config").getUInt("maxVoices", 0));
+
     float baseMaxDistance = assets->json("/sfx.config:baseMaxDistance").toFloat();
     Vec2F stereoAdjustmentRange = jsonToVec2F(assets->json("/sfx.config:stereoAdjustmentRange"));
     float attenuationGamma = assets->json("/sfx.config:attenuationGamma").toFloat();
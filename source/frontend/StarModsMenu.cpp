@@ -19,16 +19,19 @@ ModsMenu::ModsMenu() {
 
   m_assetsSources = assets->assetSources();
   m_modList = fetchChild<ListWidget>("mods.list");
+  List<WidgetPtr> listItems;
   for (auto const& assetsSource : m_assetsSources) {
     auto metadata = assets->assetSourceMetadata(assetsSource);
-    auto listItem = m_modList->addItem();
+    auto listItem = m_modList->constructWidget();
     auto modName = listItem->fetchChild<LabelWidget>("name");
     modName->setText(bestModName(metadata, assetsSource));
     if (auto iconImage = metadata.ptr("icon")) {
       auto modIcon = listItem->fetchChild<ImageWidget>("icon");
       modIcon->setImage(iconImage->toString());
     }
+    listItems.append(listItem);
   }
+  m_modList->setItems(listItems);
 
   m_modName = findChild<LabelWidget>("modname");
   m_modAuthor = findChild<LabelWidget>("modauthor");
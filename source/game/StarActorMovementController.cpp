@@ -1102,6 +1102,7 @@ void PathController::reset() {
   m_targetPosition = {};
   m_controlFace = {};
   m_pathFinder = {};
+  m_pathRequest = {};
   m_path = {};
   m_edgeIndex = 0;
   m_edgeTimer = 0.0;
@@ -1136,7 +1137,7 @@ Maybe<bool> PathController::findPath(ActorMovementController& movementController
   }
 
   // starting a new path, or the target position moved by more than 2 blocks
-  if (!m_targetPosition || (!m_path && !m_pathFinder) || m_world->geometry().diff(*m_targetPosition, targetPosition).magnitude() > 2.0) {
+  if (!m_targetPosition || (!m_path && !searching()) || m_world->geometry().diff(*m_targetPosition, targetPosition).magnitude() > 2.0) {
     auto grounded = movementController.onGround();
     if (m_path) {
       // if already moving on a path, collision will be disabled and we can't use MovementController::onGround() to check for ground collision
@@ -1148,20 +1149,22 @@ Maybe<bool> PathController::findPath(ActorMovementController& movementController
     }
     m_startPosition = movementController.position();
     m_targetPosition = targetPosition;
-    m_pathFinder = make_shared<PathFinder>(m_world, movementController.position(), *m_targetPosition, movementController.baseParameters(), m_parameters);
+    m_pathFinder = {};
+    m_pathRequest = {};
+    if (auto service = PathFinderService::singleton())
+      m_pathRequest = service->findPath(m_world, movementController.position(), *m_targetPosition, movementController.baseParameters(), m_parameters);
+    else
+      m_pathFinder = make_shared<PathFinder>(m_world, movementController.position(), *m_targetPosition, movementController.baseParameters(), m_parameters);
   }
 
-  if (!m_pathFinder && m_path && m_edgeIndex == m_path->size())
+  if (!searching() && m_path && m_edgeIndex == m_path->size())
     return true; // Reached goal
 
-  if (m_pathFinder) {
-    auto explored = m_pathFinder->explore(movementController.baseParameters().pathExploreRate.value(100.0));
+  if (searching()) {
+    auto explored = exploreSearch(movementController);
     if (explored) {
-      auto pathfinder = m_pathFinder;
-      m_pathFinder = {};
-
       if (*explored) {
-        auto path = *pathfinder->result();
+        auto path = explored->take();
 
         float newEdgeTimer = 0.0;
         float newEdgeIndex = 0.0;
@@ -1249,7 +1252,7 @@ Maybe<bool> PathController::move(ActorMovementController& movementController, Ac
   using namespace PlatformerAStar;
 
   // pathfind to a new target position in the background while moving on the current path
-  if (m_pathFinder && m_targetPosition)
+  if (searching() && m_targetPosition)
     findPath(movementController, *m_targetPosition);
 
   if (!m_path)
@@ -1349,12 +1352,38 @@ Maybe<bool> PathController::move(ActorMovementController& movementController, Ac
   }
 
   // reached the end of the path, success unless we're also currently pathfinding to a new position
-  if (m_pathFinder)
+  if (searching())
     return {};
   else
     return true;
 }
 
+bool PathController::searching() const {
+  return m_pathFinder || m_pathRequest;
+}
+
+Maybe<Maybe<PlatformerAStar::Path>> PathController::exploreSearch(ActorMovementController& movementController) {
+  using namespace PlatformerAStar;
+
+  if (m_pathRequest) {
+    if (!m_pathRequest->done())
+      return {};
+    // The result may be shared with other identical searches
+    Maybe<Path> path = m_pathRequest->get();
+    m_pathRequest = {};
+    return Maybe<Maybe<Path>>(std::move(path));
+  }
+
+  auto explored = m_pathFinder->explore(movementController.baseParameters().pathExploreRate.value(100.0));
+  if (!explored)
+    return {};
+
+  auto pathFinder = take(m_pathFinder);
+  if (*explored)
+    return Maybe<Maybe<Path>>(*pathFinder->result());
+  return Maybe<Maybe<Path>>(Maybe<Path>());
+}
+
 bool PathController::validateEdge(ActorMovementController& movementController, PlatformerAStar::Edge const& edge) {
   using namespace PlatformerAStar;
 
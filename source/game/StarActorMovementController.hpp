@@ -4,6 +4,7 @@
 #include "StarPlatformerAStarTypes.hpp"
 #include "StarAnchorableEntity.hpp"
 #include "StarGameTimers.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -337,6 +338,11 @@ public:
   Maybe<bool> findPath(ActorMovementController& movementController, Vec2F const& targetPosition);
   Maybe<bool> move(ActorMovementController& movementController, ActorMovementParameters const& parameters, ActorMovementModifiers const& modifiers, bool run, float dt);
 private:
+  bool searching() const;
+  // Advances the current path search.  Returns nothing while it is still
+  // running, otherwise the path found, or nothing in that if the search failed.
+  Maybe<Maybe<PlatformerAStar::Path>> exploreSearch(ActorMovementController& movementController);
+
   bool validateEdge(ActorMovementController& movementController, PlatformerAStar::Edge const& edge);
   bool movingCollision(ActorMovementController& movementController, PolyF const& collisionPoly);
 
@@ -348,7 +354,10 @@ private:
 
   Maybe<Vec2F> m_startPosition;
   Maybe<Vec2F> m_targetPosition;
+  // Searches run either on the world thread in m_pathFinder, or in the
+  // background through the PathFinderService in m_pathRequest
   PlatformerAStar::PathFinderPtr m_pathFinder;
+  Maybe<WorkerPoolPromise<Maybe<PlatformerAStar::Path>>> m_pathRequest;
 
   Maybe<Direction> m_controlFace;
 
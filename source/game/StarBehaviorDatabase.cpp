@@ -73,6 +73,12 @@ EnumMap<CompositeType> const CompositeTypeNames {
   {CompositeType::Randomize, "Randomize"}
 };
 
+EnumMap<NativeDecoratorType> const NativeDecoratorTypeNames {
+  {NativeDecoratorType::Inverter, "inverter"},
+  {NativeDecoratorType::Succeeder, "succeeder"},
+  {NativeDecoratorType::Failer, "failer"}
+};
+
 void applyTreeParameters(StringMap<NodeParameter>& nodeParameters, StringMap<NodeParameterValue> const& treeParameters) {
   for (auto& p : nodeParameters) {
     NodeParameter& parameter = p.second;
@@ -126,8 +132,8 @@ void parseNodeParameters(JsonObject& parameters) {
 ActionNode::ActionNode(String name, StringMap<NodeParameter> parameters, StringMap<NodeOutput> output)
   : name(std::move(name)), parameters(std::move(parameters)), output(std::move(output)) { }
 
-DecoratorNode::DecoratorNode(String const& name, StringMap<NodeParameter> parameters, BehaviorNodeConstPtr child)
-  : name(name), parameters(parameters), child(child) { }
+DecoratorNode::DecoratorNode(String const& name, StringMap<NodeParameter> parameters, BehaviorNodeConstPtr child, Maybe<NativeDecoratorType> native)
+  : name(name), parameters(parameters), child(child), native(native) { }
 
 SequenceNode::SequenceNode(List<BehaviorNodeConstPtr> children) : children(children) { }
 
@@ -148,6 +154,69 @@ RandomizeNode::RandomizeNode(List<BehaviorNodeConstPtr> children) : children(chi
 BehaviorTree::BehaviorTree(String const& name, StringSet scripts, JsonObject const& parameters)
   : name(name), scripts(scripts), parameters(parameters) { }
 
+static uint32_t compileBehaviorNode(BehaviorTree& tree, BehaviorNode const& node) {
+  uint32_t index = tree.compiledNodes.size();
+  CompiledBehaviorNode compiled = {};
+  compiled.node = &node;
+
+  List<BehaviorNodeConstPtr> const* children = nullptr;
+  List<BehaviorNodeConstPtr> decoratorChild;
+  if (node.is<ActionNode>()) {
+    compiled.type = CompiledNodeType::Action;
+  } else if (auto decorator = node.ptr<DecoratorNode>()) {
+    if (decorator->native) {
+      compiled.type = CompiledNodeType::NativeDecorator;
+      compiled.decorator = *decorator->native;
+    } else {
+      compiled.type = CompiledNodeType::Decorator;
+    }
+    decoratorChild.append(decorator->child);
+    children = &decoratorChild;
+  } else if (auto composite = node.ptr<CompositeNode>()) {
+    if (auto sequence = composite->ptr<SequenceNode>()) {
+      compiled.type = CompiledNodeType::Sequence;
+      children = &sequence->children;
+    } else if (auto selector = composite->ptr<SelectorNode>()) {
+      compiled.type = CompiledNodeType::Selector;
+      children = &selector->children;
+    } else if (auto parallel = composite->ptr<ParallelNode>()) {
+      compiled.type = CompiledNodeType::Parallel;
+      compiled.succeed = parallel->succeed;
+      compiled.fail = parallel->fail;
+      children = &parallel->children;
+    } else if (auto dynamic = composite->ptr<DynamicNode>()) {
+      compiled.type = CompiledNodeType::Dynamic;
+      children = &dynamic->children;
+    } else if (auto randomize = composite->ptr<RandomizeNode>()) {
+      compiled.type = CompiledNodeType::Randomize;
+      children = &randomize->children;
+    }
+  } else {
+    throw StarException(strf("Unable to compile behavior node with variant type index {} in behavior {}", node.typeIndex(), tree.name));
+  }
+  tree.compiledNodes.append(compiled);
+
+  List<uint32_t> childIndices;
+  if (children) {
+    for (auto const& child : *children)
+      childIndices.append(compileBehaviorNode(tree, *child));
+  }
+
+  auto& result = tree.compiledNodes[index];
+  result.childrenBegin = tree.compiledChildren.size();
+  tree.compiledChildren.appendAll(childIndices);
+  result.childrenEnd = tree.compiledChildren.size();
+  result.end = tree.compiledNodes.size();
+  return index;
+}
+
+void BehaviorTree::compile() {
+  compiledNodes.clear();
+  compiledChildren.clear();
+  if (root)
+    compileBehaviorNode(*this, *root);
+}
+
 BehaviorDatabase::BehaviorDatabase() {
   auto assets = Root::singleton().assets();
 
@@ -168,6 +237,9 @@ BehaviorDatabase::BehaviorDatabase() {
           output.set(p.first, jsonToNodeOutput(p.second));
 
         m_nodeOutput.set(node.first, output);
+
+        if (auto native = node.second.optString("native"))
+          m_nativeDecorators.set(node.first, NativeDecoratorTypeNames.getLeft(*native));
       }
     } catch (StarException const& e) {
       throw StarException(strf("Could not load nodes file \'{}\'", file), e);
@@ -214,6 +286,7 @@ BehaviorTreeConstPtr BehaviorDatabase::buildTree(Json const& config, StringMap<N
     parameters.set(p.first, p.second);
   BehaviorNodeConstPtr root = behaviorNode(config.get("root"), parameters, tree);
   tree.root = root;
+  tree.compile();
   return std::make_shared<BehaviorTree>(std::move(tree));
 }
 
@@ -284,9 +357,11 @@ BehaviorNodeConstPtr BehaviorDatabase::behaviorNode(Json const& json, StringMap<
 
     return make_shared<BehaviorNode>(ActionNode(name, parameters, output));
   } else if (type == BehaviorNodeType::Decorator) {
-    tree.functions.add(name);
+    auto native = m_nativeDecorators.maybe(name);
+    if (!native)
+      tree.functions.add(name);
     BehaviorNodeConstPtr child = behaviorNode(json.get("child"), treeParameters, tree);
-    return make_shared<BehaviorNode>(DecoratorNode(name, parameters, child));
+    return make_shared<BehaviorNode>(DecoratorNode(name, parameters, child, native));
   } else if (type == BehaviorNodeType::Composite) {
     return make_shared<BehaviorNode>(compositeNode(json, parameters, treeParameters, tree));
   }
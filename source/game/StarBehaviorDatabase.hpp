@@ -62,6 +62,15 @@ enum class CompositeType : uint16_t {
 };
 extern EnumMap<CompositeType> const CompositeTypeNames;
 
+// Decorators that run in C++ instead of calling a Lua function, chosen by a
+// "native" entry in the decorator's node definition
+enum class NativeDecoratorType : uint8_t {
+  Inverter,
+  Succeeder,
+  Failer
+};
+extern EnumMap<NativeDecoratorType> const NativeDecoratorTypeNames;
+
 // replaces global tags in nodeParameters in place
 NodeParameterValue replaceBehaviorTag(NodeParameterValue const& parameter, StringMap<NodeParameterValue> const& treeParameters);
 Maybe<String> replaceOutputBehaviorTag(Maybe<String> const& output, StringMap<NodeParameterValue> const& treeParameters);
@@ -76,11 +85,12 @@ struct ActionNode {
 };
 
 struct DecoratorNode {
-  DecoratorNode(String const& name, StringMap<NodeParameter> parameters, BehaviorNodeConstPtr child);
+  DecoratorNode(String const& name, StringMap<NodeParameter> parameters, BehaviorNodeConstPtr child, Maybe<NativeDecoratorType> native = {});
 
   String name;
   StringMap<NodeParameter> parameters;
   BehaviorNodeConstPtr child;
+  Maybe<NativeDecoratorType> native;
 };
 
 struct SequenceNode {
@@ -115,15 +125,51 @@ struct RandomizeNode {
   List<BehaviorNodeConstPtr> children;
 };
 
+enum class CompiledNodeType : uint8_t {
+  Action,
+  Decorator,
+  NativeDecorator,
+  Sequence,
+  Selector,
+  Parallel,
+  Dynamic,
+  Randomize
+};
+
+// A behavior node flattened into BehaviorTree::compiledNodes in depth first
+// order, so the descendants of the node at index i are exactly the nodes in
+// (i, end).
+struct CompiledBehaviorNode {
+  CompiledNodeType type;
+  // The node this was compiled from, used by Lua leaves
+  BehaviorNode const* node;
+  // Range of BehaviorTree::compiledChildren holding this node's children
+  uint32_t childrenBegin;
+  uint32_t childrenEnd;
+  uint32_t end;
+
+  // Parallel nodes only
+  int succeed;
+  int fail;
+  // Native decorators only
+  NativeDecoratorType decorator;
+};
+
 struct BehaviorTree {
   BehaviorTree(String const& name, StringSet scripts, JsonObject const& parameters);
 
+  // Flattens the nodes under root into compiledNodes
+  void compile();
+
   String name;
   StringSet scripts;
   StringSet functions;
   JsonObject parameters;
 
   BehaviorNodeConstPtr root;
+
+  List<CompiledBehaviorNode> compiledNodes;
+  List<uint32_t> compiledChildren;
 };
 
 typedef std::shared_ptr<const BehaviorNode> BehaviorNodeConstPtr;
@@ -141,6 +187,7 @@ private:
   StringMap<BehaviorTreeConstPtr> m_behaviors;
   StringMap<StringMap<NodeParameter>> m_nodeParameters;
   StringMap<StringMap<NodeOutput>> m_nodeOutput;
+  StringMap<NativeDecoratorType> m_nativeDecorators;
 
   void loadTree(String const& name);
 
@@ -118,20 +118,9 @@ void Blackboard::clearEphemerals(Set<pair<NodeParameterType, String>> ephemerals
   }
 }
 
-DecoratorState::DecoratorState(LuaThread thread) : thread(std::move(thread)) {
-  child = std::make_shared<NodeState>();
-}
-
-CompositeState::CompositeState(size_t childCount) : index() {
-  for (size_t i = 0; i < childCount; i++)
-    children.append(std::make_shared<NodeState>());
-}
-
-CompositeState::CompositeState(size_t childCount, size_t begin) : CompositeState(childCount) {
-  index = begin;
-}
-
 BehaviorState::BehaviorState(BehaviorTreeConstPtr tree, LuaTable context, Maybe<BlackboardWeakPtr> blackboard) : m_tree(tree), m_luaContext(std::move(context)) {
+  m_states.resize(m_tree->compiledNodes.size());
+
   if (blackboard)
     m_board = *blackboard;
   else
@@ -151,7 +140,7 @@ NodeStatus BehaviorState::run(float dt) {
 
   auto ephemeral = m_board.maybe<BlackboardPtr>().apply([](auto const& b) { return b->takeEphemerals(); });
 
-  status = runNode(*m_tree->root, m_rootState);
+  status = runNode(0);
 
   if (ephemeral)
     m_board.get<BlackboardPtr>()->clearEphemerals(*ephemeral);
@@ -160,7 +149,8 @@ NodeStatus BehaviorState::run(float dt) {
 }
 
 void BehaviorState::clear() {
-  m_rootState.reset();
+  for (auto& state : m_states)
+    state = NodeState();
 }
 
 BlackboardWeakPtr BehaviorState::blackboardPtr() {
@@ -183,28 +173,61 @@ LuaThread BehaviorState::nodeLuaThread(String const& funcName) {
   return thread;
 }
 
-NodeStatus BehaviorState::runNode(BehaviorNode const& node, NodeState& state) {
+void BehaviorState::resetNodes(CompiledBehaviorNode const& node, uint32_t index) {
+  for (uint32_t i = index; i < node.end; ++i)
+    m_states[i] = NodeState();
+}
+
+NodeStatus BehaviorState::runNode(uint32_t index) {
+  CompiledBehaviorNode const& node = m_tree->compiledNodes[index];
+  NodeState& state = m_states[index];
+
   NodeStatus status = NodeStatus::Invalid;
-  if (node.is<ActionNode>())
-    status = runAction(node.get<ActionNode>(), state);
-  else if(node.is<DecoratorNode>())
-    status = runDecorator(node.get<DecoratorNode>(), state);
-  else if(node.is<CompositeNode>())
-    status = runComposite(node.get<CompositeNode>(), state);
-  else
-    StarException("Unidentified behavior node type");
+  switch (node.type) {
+    case CompiledNodeType::Action:
+      status = runAction(node, state);
+      break;
+    case CompiledNodeType::Decorator:
+      status = runDecorator(node, state);
+      break;
+    case CompiledNodeType::NativeDecorator:
+      status = runNativeDecorator(node);
+      break;
+    case CompiledNodeType::Sequence:
+      status = runSequence(node, state);
+      break;
+    case CompiledNodeType::Selector:
+      status = runSelector(node, state);
+      break;
+    case CompiledNodeType::Parallel:
+      status = runParallel(node);
+      break;
+    case CompiledNodeType::Dynamic:
+      status = runDynamic(node, state);
+      break;
+    case CompiledNodeType::Randomize:
+      status = runRandomize(node, state);
+      break;
+  }
 
-  if (status != NodeStatus::Running)
-    state.reset();
+  if (status != NodeStatus::Running) {
+    // Parallel and dynamic nodes can finish while children are still running,
+    // every other node only finishes once its children have.
+    if (node.type == CompiledNodeType::Parallel || node.type == CompiledNodeType::Dynamic)
+      resetNodes(node, index);
+    else
+      state = NodeState();
+  }
 
   return status;
 }
 
-NodeStatus BehaviorState::runAction(ActionNode const& node, NodeState& state) {
+NodeStatus BehaviorState::runAction(CompiledBehaviorNode const& compiled, NodeState& state) {
+  ActionNode const& node = compiled.node->get<ActionNode>();
   uint64_t id = (uint64_t)&node;
 
   auto result = ActionReturn(NodeStatus::Invalid, LuaNil);
-  if (state.isNothing()) {
+  if (!state.active) {
     LuaTable parameters = board()->parameters(node.parameters, id);
     LuaThread thread = nodeLuaThread(node.name);
     try {
@@ -214,10 +237,12 @@ NodeStatus BehaviorState::runAction(ActionNode const& node, NodeState& state) {
     }
 
     auto status = get<0>(result);
-    if (status != NodeStatus::Success && status != NodeStatus::Failure)
-      state.set(ActionState{thread});
+    if (status != NodeStatus::Success && status != NodeStatus::Failure) {
+      state.active = true;
+      state.thread = std::move(thread);
+    }
   } else {
-    LuaThread const& thread = state->get<ActionState>().thread;
+    LuaThread const& thread = *state.thread;
 
     try {
       result = thread.resume<ActionReturn>(m_lastDt).value(ActionReturn(NodeStatus::Invalid, LuaNil));
@@ -236,10 +261,11 @@ NodeStatus BehaviorState::runAction(ActionNode const& node, NodeState& state) {
   return get<0>(result);
 }
 
-NodeStatus BehaviorState::runDecorator(DecoratorNode const& node, NodeState& state) {
+NodeStatus BehaviorState::runDecorator(CompiledBehaviorNode const& compiled, NodeState& state) {
+  DecoratorNode const& node = compiled.node->get<DecoratorNode>();
   uint64_t id = (uint64_t)&node;
   NodeStatus status = NodeStatus::Running;
-  if (state.isNothing()) {
+  if (!state.active) {
     auto parameters = board()->parameters(node.parameters, id);
 
     LuaThread thread = nodeLuaThread(node.name);
@@ -251,16 +277,17 @@ NodeStatus BehaviorState::runDecorator(DecoratorNode const& node, NodeState& sta
     if (status == NodeStatus::Success || status == NodeStatus::Failure)
       return status;
 
-    state.set(DecoratorState(thread));
+    state.active = true;
+    state.thread = std::move(thread);
   }
 
-  DecoratorState& decorator = state->get<DecoratorState>();
+  uint32_t child = m_tree->compiledChildren[compiled.childrenBegin];
   // decorator runs its child on yield and is resumed with the child's status on success or failure
   while (status == NodeStatus::Running) {
-    auto childStatus = runNode(*node.child, *decorator.child);
+    auto childStatus = runNode(child);
     if (childStatus == NodeStatus::Success || childStatus == NodeStatus::Failure) {
       try {
-        status = decorator.thread.resume<NodeStatus>(childStatus).value(NodeStatus::Invalid);
+        status = state.thread->resume<NodeStatus>(childStatus).value(NodeStatus::Invalid);
       } catch (LuaException const& e) {
         throw StarException(strf("Lua Exception caught resuming decorator node {} in behavior {}: {}", node.name, m_tree->name, outputException(e, false)));
       }
@@ -269,74 +296,65 @@ NodeStatus BehaviorState::runDecorator(DecoratorNode const& node, NodeState& sta
     }
   }
 
-  m_threads.append(decorator.thread);
+  m_threads.append(*state.thread);
 
   return status;
 }
 
-NodeStatus BehaviorState::runComposite(CompositeNode const& node, NodeState& state) {
-  NodeStatus status;
-  if (node.is<SequenceNode>())
-    status =  runSequence(node.get<SequenceNode>(), state);
-  else if (node.is<SelectorNode>())
-    status = runSelector(node.get<SelectorNode>(), state);
-  else if (node.is<ParallelNode>())
-    status = runParallel(node.get<ParallelNode>(), state);
-  else if (node.is<DynamicNode>())
-    status = runDynamic(node.get<DynamicNode>(), state);
-  else if (node.is<RandomizeNode>())
-    status = runRandomize(node.get<RandomizeNode>(), state);
-  else
-    throw StarException(strf("Unable to run composite node type with variant type index {}", node.typeIndex()));
+NodeStatus BehaviorState::runNativeDecorator(CompiledBehaviorNode const& node) {
+  auto childStatus = runNode(m_tree->compiledChildren[node.childrenBegin]);
+  if (childStatus != NodeStatus::Success && childStatus != NodeStatus::Failure)
+    return NodeStatus::Running;
+
+  switch (node.decorator) {
+    case NativeDecoratorType::Inverter:
+      return childStatus == NodeStatus::Success ? NodeStatus::Failure : NodeStatus::Success;
+    case NativeDecoratorType::Succeeder:
+      return NodeStatus::Success;
+    case NativeDecoratorType::Failer:
+      return NodeStatus::Failure;
+  }
 
-  return status;
+  return NodeStatus::Invalid;
 }
 
-NodeStatus BehaviorState::runSequence(SequenceNode const& node, NodeState& state) {
-  if (state.isNothing())
-    state.set(CompositeState(node.children.size()));
+NodeStatus BehaviorState::runSequence(CompiledBehaviorNode const& node, NodeState& state) {
+  state.active = true;
 
-  CompositeState& composite = state->get<CompositeState>();
-  while (composite.index < node.children.size()) {
-    auto child = node.children.get(composite.index);
-    NodeStatus childStatus = runNode(*child, *composite.children[composite.index]);
+  size_t childCount = node.childrenEnd - node.childrenBegin;
+  while (state.index < childCount) {
+    NodeStatus childStatus = runNode(m_tree->compiledChildren[node.childrenBegin + state.index]);
 
     if (childStatus == NodeStatus::Failure || childStatus == NodeStatus::Running)
       return childStatus;
     else
-      composite.index++;
+      state.index++;
   }
 
   return NodeStatus::Success;
 }
 
-NodeStatus BehaviorState::runSelector(SelectorNode const& node, NodeState& state) {
-  if (state.isNothing())
-    state.set(CompositeState(node.children.size()));
+NodeStatus BehaviorState::runSelector(CompiledBehaviorNode const& node, NodeState& state) {
+  state.active = true;
 
-  CompositeState& composite = state->get<CompositeState>();
-  while (composite.index < node.children.size()) {
-    NodeStatus childStatus = runNode(*node.children[composite.index], *composite.children[composite.index]);
+  size_t childCount = node.childrenEnd - node.childrenBegin;
+  while (state.index < childCount) {
+    NodeStatus childStatus = runNode(m_tree->compiledChildren[node.childrenBegin + state.index]);
 
     if (childStatus == NodeStatus::Success || childStatus == NodeStatus::Running)
       return childStatus;
     else
-      composite.index++;
+      state.index++;
   }
 
   return NodeStatus::Failure;
 }
 
-NodeStatus BehaviorState::runParallel(ParallelNode const& node, NodeState& state) {
-  if (state.isNothing())
-    state.set(CompositeState(node.children.size()));
-
-  CompositeState& composite = state->get<CompositeState>();
-
+NodeStatus BehaviorState::runParallel(CompiledBehaviorNode const& node) {
   int failed = 0;
   int succeeded = 0;
-  for (size_t i = 0; i < node.children.size(); i++) {
-    NodeStatus status = runNode(*node.children[i], *composite.children[i]);
+  for (uint32_t i = node.childrenBegin; i < node.childrenEnd; i++) {
+    NodeStatus status = runNode(m_tree->compiledChildren[i]);
     if (status == NodeStatus::Success)
       succeeded++;
     else if (status == NodeStatus::Failure)
@@ -350,23 +368,22 @@ NodeStatus BehaviorState::runParallel(ParallelNode const& node, NodeState& state
   return NodeStatus::Running;
 }
 
-NodeStatus BehaviorState::runDynamic(DynamicNode const& node, NodeState& state) {
-  if (state.isNothing())
-    state.set(CompositeState(node.children.size()));
+NodeStatus BehaviorState::runDynamic(CompiledBehaviorNode const& node, NodeState& state) {
+  state.active = true;
 
-  CompositeState& composite = state->get<CompositeState>();
-  for (size_t i = 0; i <= composite.index; i++) {
-    auto child = node.children.get(i);
-    auto status = runNode(*child, *composite.children.get(i));
-    if (status == NodeStatus::Failure && i == composite.index)
-      composite.index++;
+  size_t childCount = node.childrenEnd - node.childrenBegin;
+  for (size_t i = 0; i <= state.index; i++) {
+    auto status = runNode(m_tree->compiledChildren[node.childrenBegin + i]);
+    if (status == NodeStatus::Failure && i == state.index)
+      state.index++;
 
-    if (i < composite.index && (status == NodeStatus::Success || status == NodeStatus::Running)) {
-      composite.children[composite.index]->reset();
-      composite.index = i;
+    if (i < state.index && (status == NodeStatus::Success || status == NodeStatus::Running)) {
+      uint32_t running = m_tree->compiledChildren[node.childrenBegin + state.index];
+      resetNodes(m_tree->compiledNodes[running], running);
+      state.index = i;
     }
 
-    if (status == NodeStatus::Success || composite.index >= node.children.size()) {
+    if (status == NodeStatus::Success || state.index >= childCount) {
       return status;
     }
   }
@@ -374,14 +391,14 @@ NodeStatus BehaviorState::runDynamic(DynamicNode const& node, NodeState& state)
   return NodeStatus::Running;
 }
 
-NodeStatus BehaviorState::runRandomize(RandomizeNode const& node, NodeState& state) {
-  if (state.isNothing())
-    state.set(CompositeState(node.children.size(), Random::randUInt(node.children.size() - 1)));
+NodeStatus BehaviorState::runRandomize(CompiledBehaviorNode const& node, NodeState& state) {
+  size_t childCount = node.childrenEnd - node.childrenBegin;
+  if (!state.active) {
+    state.active = true;
+    state.index = Random::randUInt(childCount - 1);
+  }
 
-  CompositeState& composite = state->get<CompositeState>();
-  auto child = node.children.get(composite.index);
-  NodeStatus status = runNode(*child, *composite.children[composite.index]);
-  return status;
+  return runNode(m_tree->compiledChildren[node.childrenBegin + state.index]);
 }
 
 }
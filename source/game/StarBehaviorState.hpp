@@ -7,9 +7,6 @@ namespace Star {
 
 STAR_CLASS(Blackboard);
 STAR_CLASS(BehaviorState);
-STAR_STRUCT(ActionState);
-STAR_STRUCT(DecoratorState);
-STAR_STRUCT(CompositeState);
 
 STAR_EXCEPTION(BehaviorException, StarException);
 
@@ -42,9 +39,6 @@ private:
   Set<pair<NodeParameterType, String>> m_ephemeral;
 };
 
-typedef Maybe<Variant<ActionState,DecoratorState,CompositeState>> NodeState;
-typedef shared_ptr<NodeState> NodeStatePtr;
-
 typedef pair<LuaFunction, LuaThread> Coroutine;
 
 enum class NodeStatus {
@@ -55,22 +49,14 @@ enum class NodeStatus {
 };
 
 typedef LuaTupleReturn<NodeStatus, LuaValue> ActionReturn;
-struct ActionState {
-  LuaThread thread;
-};
-
-struct DecoratorState {
-  DecoratorState(LuaThread thread);
-  LuaThread thread;
-  NodeStatePtr child;
-};
-
-struct CompositeState {
-  CompositeState(size_t children);
-  CompositeState(size_t children, size_t index);
 
-  size_t index;
-  List<NodeStatePtr> children;
+// Running state of one compiled node, stored at the node's index
+struct NodeState {
+  bool active = false;
+  // Current child for composites
+  size_t index = 0;
+  // Suspended Lua function for actions and decorators
+  Maybe<LuaThread> thread;
 };
 
 class BehaviorState {
@@ -86,20 +72,24 @@ private:
 
   LuaThread nodeLuaThread(String const& funcName);
 
-  NodeStatus runNode(BehaviorNode const& node, NodeState& state);
+  // Clears the state of the node at index and all of its descendants
+  void resetNodes(CompiledBehaviorNode const& node, uint32_t index);
+
+  NodeStatus runNode(uint32_t index);
 
-  NodeStatus runAction(ActionNode const& node, NodeState& state);
-  NodeStatus runDecorator(DecoratorNode const& node, NodeState& state);
+  NodeStatus runAction(CompiledBehaviorNode const& node, NodeState& state);
+  NodeStatus runDecorator(CompiledBehaviorNode const& node, NodeState& state);
+  NodeStatus runNativeDecorator(CompiledBehaviorNode const& node);
 
-  NodeStatus runComposite(CompositeNode const& node, NodeState& state);
-  NodeStatus runSequence(SequenceNode const& node, NodeState& state);
-  NodeStatus runSelector(SelectorNode const& node, NodeState& state);
-  NodeStatus runParallel(ParallelNode const& node, NodeState& state);
-  NodeStatus runDynamic(DynamicNode const& node, NodeState& state);
-  NodeStatus runRandomize(RandomizeNode const& node, NodeState& state);
+  NodeStatus runSequence(CompiledBehaviorNode const& node, NodeState& state);
+  NodeStatus runSelector(CompiledBehaviorNode const& node, NodeState& state);
+  NodeStatus runParallel(CompiledBehaviorNode const& node);
+  NodeStatus runDynamic(CompiledBehaviorNode const& node, NodeState& state);
+  NodeStatus runRandomize(CompiledBehaviorNode const& node, NodeState& state);
 
   BehaviorTreeConstPtr m_tree;
-  NodeState m_rootState;
+  // One entry per node in m_tree->compiledNodes
+  List<NodeState> m_states;
 
   LuaTable m_luaContext;
 
@@ -54,7 +54,8 @@ RectI CelestialDatabase::chunkRegion(Vec2I const& chunkIndex) const {
   return RectI(chunkIndex * m_baseInformation.chunkSize, (chunkIndex + Vec2I(1, 1)) * m_baseInformation.chunkSize);
 }
 
-CelestialMasterDatabase::CelestialMasterDatabase(Maybe<String> databaseFile) {
+CelestialMasterDatabase::CelestialMasterDatabase(Maybe<String> databaseFile)
+  : m_chunkGenerationPool("CelestialChunkGeneration") {
   auto assets = Root::singleton().assets();
 
   auto config = assets->json("/celestial.config");
@@ -134,6 +135,8 @@ CelestialMasterDatabase::CelestialMasterDatabase(Maybe<String> databaseFile) {
 
   if (databaseFile) {
     m_database.setContentIdentifier("Celestial2");
+    m_database.setMemoryMapped(config.getBool("memoryMappedReads", false));
+    m_database.setLeafCacheSize(config.getUInt("leafCacheSize", 0));
     m_database.setIODevice(File::open(*databaseFile, IOMode::ReadWrite));
     m_database.open();
     if (m_database.contentIdentifier() != "Celestial2") {
@@ -148,6 +151,14 @@ CelestialMasterDatabase::CelestialMasterDatabase(Maybe<String> databaseFile) {
 
   m_commitInterval = config.getFloat("commitInterval");
   m_commitTimer.restart(m_commitInterval);
+  m_compactionFreeRatio = config.getFloat("compactionFreeRatio", 0.0f);
+  m_compactionBlockBudget = config.getUInt("compactionBlockBudget", 256);
+
+  m_chunkPrefetchRadius = config.getInt("chunkPrefetchRadius", 1);
+  unsigned generationThreads = config.getUInt("chunkGenerationThreads", 2);
+  if (generationThreads == 0)
+    generationThreads = max<unsigned>(Thread::numberOfProcessors(), 2) - 1;
+  m_chunkGenerationPool.start(generationThreads);
 }
 
 CelestialBaseInformation CelestialMasterDatabase::baseInformation() const {
@@ -157,13 +168,19 @@ CelestialBaseInformation CelestialMasterDatabase::baseInformation() const {
 CelestialResponse CelestialMasterDatabase::respondToRequest(CelestialRequest const& request) {
   RecursiveMutexLocker locker(m_mutex);
 
+  auto unlockDuring = [&](std::function<void()>&& func) {
+    locker.unlock();
+    func();
+    locker.lock();
+  };
+
   if (auto chunkLocation = request.maybeLeft()) {
-    auto chunk = getChunk(*chunkLocation);
+    auto chunk = getChunk(*chunkLocation, unlockDuring);
     // System objects are sent by separate system requests.
     chunk.systemObjects.clear();
     return makeLeft(std::move(chunk));
   } else if (auto systemLocation = request.maybeRight()) {
-    auto const& chunk = getChunk(chunkIndexFor(*systemLocation));
+    auto const& chunk = getChunk(chunkIndexFor(*systemLocation), unlockDuring);
     CelestialSystemObjects systemObjects = {*systemLocation, chunk.systemObjects.get(*systemLocation)};
     return makeRight(std::move(systemObjects));
   } else {
@@ -173,10 +190,29 @@ CelestialResponse CelestialMasterDatabase::respondToRequest(CelestialRequest con
 
 void CelestialMasterDatabase::cleanupAndCommit() {
   RecursiveMutexLocker locker(m_mutex);
+
+  // Keep prefetched chunks that nothing has asked for yet
+  for (auto const& chunkIndex : m_pendingChunks.keys()) {
+    if (!m_pendingChunks.get(chunkIndex).done())
+      continue;
+    auto promise = m_pendingChunks.take(chunkIndex);
+    try {
+      adoptChunk(chunkIndex, std::move(promise.get()));
+    } catch (std::exception const& e) {
+      Logger::error("CelestialMasterDatabase failed to generate chunk {}: {}", chunkIndex, outputException(e, false));
+    }
+  }
+
   m_chunkCache.cleanup();
   if (m_database.isOpen() && m_commitTimer.timeUp()) {
     m_database.commit();
     m_commitTimer.restart(m_commitInterval);
+
+    if (m_compactionFreeRatio > 0.0f) {
+      uint32_t totalBlocks = m_database.totalBlockCount();
+      if (totalBlocks != 0 && m_database.freeBlockCount() >= totalBlocks * m_compactionFreeRatio)
+        m_database.compact(m_compactionBlockBudget);
+    }
   }
 }
 
@@ -295,14 +331,17 @@ List<int> CelestialMasterDatabase::childOrbits(CelestialCoordinate const& coordi
 List<CelestialCoordinate> CelestialMasterDatabase::scanSystems(RectI const& region, Maybe<StringSet> const& includedTypes) {
   RecursiveMutexLocker locker(m_mutex);
 
+  auto chunkLocations = chunkIndexesFor(region);
+  for (auto const& chunkLocation : chunkLocations)
+    startChunk(chunkLocation);
+
   List<CelestialCoordinate> systems;
-  for (auto const& chunkLocation : chunkIndexesFor(region)) {
+  for (auto const& chunkLocation : chunkLocations) {
     auto const& chunkData = getChunk(chunkLocation, [&](std::function<void()>&& func) {
       locker.unlock();
       func();
       locker.lock();
     });
-    locker.unlock();
     for (auto const& pair : chunkData.systemParameters) {
       Vec3I systemLocation = pair.first;
       if (region.contains(systemLocation.vec2())) {
@@ -314,7 +353,6 @@ List<CelestialCoordinate> CelestialMasterDatabase::scanSystems(RectI const& regi
         systems.append(CelestialCoordinate(systemLocation));
       }
     }
-    locker.lock();
   }
   return systems;
 }
@@ -322,9 +360,17 @@ List<CelestialCoordinate> CelestialMasterDatabase::scanSystems(RectI const& regi
 List<pair<Vec2I, Vec2I>> CelestialMasterDatabase::scanConstellationLines(RectI const& region) {
   RecursiveMutexLocker locker(m_mutex);
 
+  auto chunkLocations = chunkIndexesFor(region);
+  for (auto const& chunkLocation : chunkLocations)
+    startChunk(chunkLocation);
+
   List<pair<Vec2I, Vec2I>> lines;
-  for (auto const& chunkLocation : chunkIndexesFor(region)) {
-    auto const& chunkData = getChunk(chunkLocation);
+  for (auto const& chunkLocation : chunkLocations) {
+    auto const& chunkData = getChunk(chunkLocation, [&](std::function<void()>&& func) {
+      locker.unlock();
+      func();
+      locker.lock();
+    });
     for (auto const& constellation : chunkData.constellations) {
       for (auto const& line : constellation) {
         if (region.intersects(Line2I(line.first, line.second)))
@@ -360,13 +406,7 @@ void CelestialMasterDatabase::updateParameters(CelestialCoordinate const& coordi
   }
 
   if (updated && m_database.isOpen()) {
-    auto versioningDatabase = Root::singleton().versioningDatabase();
-    auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", chunk.toJson());
-    DataStreamBuffer ds;
-    ds.write(versionedChunk);
-    VersionedJson::writeSubVersioning(ds, versionedChunk);
-    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(ds.data()));
-
+    storeChunk(chunkIndex, chunk);
     m_chunkCache.remove(chunkIndex);
   } else {
     updated = false;
@@ -386,39 +426,87 @@ Maybe<CelestialOrbitRegion> CelestialMasterDatabase::orbitRegion(
 }
 
 CelestialChunk const& CelestialMasterDatabase::getChunk(Vec2I const& chunkIndex, UnlockDuringFunction unlockDuring) {
-  return m_chunkCache.get(chunkIndex, [&](Vec2I const& chunkIndex) -> CelestialChunk {
-      auto versioningDatabase = Root::singleton().versioningDatabase();
-
-      if (m_database.isOpen()) {
-        if (auto chunkData = m_database.find(DataStreamBuffer::serialize(chunkIndex))) {
-          auto versionedChunk = DataStreamBuffer::deserialize<VersionedJson>(uncompressData(chunkData.take()));
-          if (!versioningDatabase->versionedJsonCurrent(versionedChunk)) {
-            versionedChunk = versioningDatabase->updateVersionedJson(versionedChunk);
-            DataStreamBuffer ds;
-            ds.write(versionedChunk);
-            VersionedJson::writeSubVersioning(ds, versionedChunk);
-            m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(ds.data()));
-          }
-          return CelestialChunk(versionedChunk.content);
-        }
-      }
+  if (auto chunk = m_chunkCache.ptr(chunkIndex))
+    return *chunk;
 
-      CelestialChunk newChunk;
-      auto producer = [&]() { newChunk = produceChunk(chunkIndex); };
-      if (unlockDuring)
-        unlockDuring(producer);
-      else
-        producer();
-      if (m_database.isOpen()) {
-        auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", newChunk.toJson());
-        DataStreamBuffer ds;
-        ds.write(versionedChunk);
-        VersionedJson::writeSubVersioning(ds, versionedChunk);
-        m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(ds.data()));
-      }
+  if (!m_pendingChunks.contains(chunkIndex)) {
+    if (auto chunk = loadChunk(chunkIndex)) {
+      m_chunkCache.set(chunkIndex, chunk.take());
+      return *m_chunkCache.ptr(chunkIndex);
+    }
+    startChunk(chunkIndex);
+  }
+  prefetchChunksAround(chunkIndex);
+
+  auto promise = m_pendingChunks.get(chunkIndex);
+  // Failures are re-thrown once relocked, below.
+  if (unlockDuring)
+    unlockDuring([&]() {
+        try {
+          promise.get();
+        } catch (...) {}
+      });
+
+  // While unlocked, another caller may have already adopted the chunk.
+  if (auto chunk = m_chunkCache.ptr(chunkIndex))
+    return *chunk;
+  if (auto pending = m_pendingChunks.maybeTake(chunkIndex))
+    return adoptChunk(chunkIndex, std::move(pending->get()));
+  return getChunk(chunkIndex);
+}
+
+void CelestialMasterDatabase::startChunk(Vec2I const& chunkIndex) {
+  if (m_chunkCache.ptr(chunkIndex) || m_pendingChunks.contains(chunkIndex))
+    return;
+  if (m_database.isOpen() && m_database.contains(DataStreamBuffer::serialize(chunkIndex)))
+    return;
+
+  m_pendingChunks.add(chunkIndex, m_chunkGenerationPool.addProducer<CelestialChunk>([this, chunkIndex]() {
+      return produceChunk(chunkIndex);
+    }));
+}
+
+void CelestialMasterDatabase::prefetchChunksAround(Vec2I const& chunkIndex) {
+  for (int x = -m_chunkPrefetchRadius; x <= m_chunkPrefetchRadius; ++x) {
+    for (int y = -m_chunkPrefetchRadius; y <= m_chunkPrefetchRadius; ++y)
+      startChunk(chunkIndex + Vec2I(x, y));
+  }
+}
 
-      return newChunk;
-    });
+CelestialChunk const& CelestialMasterDatabase::adoptChunk(Vec2I const& chunkIndex, CelestialChunk chunk) {
+  if (m_database.isOpen())
+    storeChunk(chunkIndex, chunk);
+  m_chunkCache.set(chunkIndex, std::move(chunk));
+  return *m_chunkCache.ptr(chunkIndex);
+}
+
+Maybe<CelestialChunk> CelestialMasterDatabase::loadChunk(Vec2I const& chunkIndex) {
+  if (!m_database.isOpen())
+    return {};
+
+  auto chunkData = m_database.find(DataStreamBuffer::serialize(chunkIndex));
+  if (!chunkData)
+    return {};
+
+  auto versioningDatabase = Root::singleton().versioningDatabase();
+  auto versionedChunk = DataStreamBuffer::deserialize<VersionedJson>(uncompressData(chunkData.take()));
+  if (!versioningDatabase->versionedJsonCurrent(versionedChunk)) {
+    versionedChunk = versioningDatabase->updateVersionedJson(versionedChunk);
+    DataStreamBuffer ds;
+    ds.write(versionedChunk);
+    VersionedJson::writeSubVersioning(ds, versionedChunk);
+    m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(ds.data()));
+  }
+  return CelestialChunk(versionedChunk.content);
+}
+
+void CelestialMasterDatabase::storeChunk(Vec2I const& chunkIndex, CelestialChunk const& chunk) {
+  auto versioningDatabase = Root::singleton().versioningDatabase();
+  auto versionedChunk = versioningDatabase->makeCurrentVersionedJson("CelestialChunk", chunk.toJson());
+  DataStreamBuffer ds;
+  ds.write(versionedChunk);
+  VersionedJson::writeSubVersioning(ds, versionedChunk);
+  m_database.insert(DataStreamBuffer::serialize(chunkIndex), compressData(ds.data()));
 }
 
 CelestialChunk CelestialMasterDatabase::produceChunk(Vec2I const& chunkIndex) const {
@@ -4,6 +4,7 @@
 #include "StarTtlCache.hpp"
 #include "StarWeightedPool.hpp"
 #include "StarThread.hpp"
+#include "StarWorkerPool.hpp"
 #include "StarBTreeDatabase.hpp"
 #include "StarCelestialTypes.hpp"
 #include "StarPerlin.hpp"
@@ -162,8 +163,20 @@ protected:
       List<CelestialOrbitRegion> const& orbitRegions, int planetaryOrbitNumber);
 
   typedef std::function<void(std::function<void()>&&)>&& UnlockDuringFunction;
+  // If the chunk has to be generated, waits for it inside unlockDuring, and
+  // starts generating the chunks around it as well.
   CelestialChunk const& getChunk(Vec2I const& chunkLocation, UnlockDuringFunction unlockDuring = {});
 
+  // Starts generating the given chunk on the generation pool, unless it is
+  // already cached, stored, or being generated.
+  void startChunk(Vec2I const& chunkLocation);
+  void prefetchChunksAround(Vec2I const& chunkLocation);
+  // Stores and caches a chunk that has finished generating.
+  CelestialChunk const& adoptChunk(Vec2I const& chunkLocation, CelestialChunk chunk);
+
+  Maybe<CelestialChunk> loadChunk(Vec2I const& chunkLocation);
+  void storeChunk(Vec2I const& chunkLocation, CelestialChunk const& chunk);
+
   CelestialChunk produceChunk(Vec2I const& chunkLocation) const;
   Maybe<pair<CelestialParameters, HashMap<int, CelestialPlanet>>> produceSystem(
       RandomSource& random, Vec3I const& location) const;
@@ -178,7 +191,14 @@ protected:
   BTreeSha256Database m_database;
 
   float m_commitInterval;
+  float m_compactionFreeRatio;
+  unsigned m_compactionBlockBudget;
   Timer m_commitTimer;
+
+  int m_chunkPrefetchRadius;
+  HashMap<Vec2I, WorkerPoolPromise<CelestialChunk>> m_pendingChunks;
+  // Last, so that it is stopped before anything generation reads is destroyed.
+  WorkerPool m_chunkGenerationPool;
 };
 
 class CelestialSlaveDatabase : public CelestialDatabase {
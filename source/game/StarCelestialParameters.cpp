@@ -128,4 +128,91 @@ void CelestialParameters::setVisitableParameters(VisitableWorldParametersPtr con
   m_visitableParameters = newVisitableParameters;
 }
 
+CelestialParametersNetCoder::CelestialParametersNetCoder() : m_lastLocation() {}
+
+void CelestialParametersNetCoder::write(DataStream& ds, CelestialParameters const& parameters) {
+  auto const& coordinate = parameters.m_coordinate;
+  Vec3I location = coordinate.location();
+  for (size_t i = 0; i < 3; ++i)
+    ds.viwrite(location[i] - m_lastLocation[i]);
+  m_lastLocation = location;
+  ds.viwrite(coordinate.isPlanetaryBody() || coordinate.isSatelliteBody() ? coordinate.planet().orbitNumber() : 0);
+  ds.viwrite(coordinate.isSatelliteBody() ? coordinate.orbitNumber() : 0);
+
+  ds.vuwrite(parameters.m_seed);
+  ds.write(parameters.m_name);
+
+  if (parameters.m_parameters.isType(Json::Type::Object)) {
+    auto const& object = parameters.m_parameters.toObject();
+    ds.vuwrite(object.size() + 1);
+    for (auto const& pair : object) {
+      writeValue(ds, pair.first);
+      writeValue(ds, pair.second);
+    }
+  } else {
+    ds.vuwrite(0);
+    writeValue(ds, parameters.m_parameters);
+  }
+
+  ds.write(netStoreVisitableWorldParameters(parameters.m_visitableParameters));
+}
+
+CelestialParameters CelestialParametersNetCoder::read(DataStream& ds) {
+  CelestialParameters parameters;
+
+  Vec3I location;
+  for (size_t i = 0; i < 3; ++i) {
+    int delta;
+    ds.viread(delta);
+    location[i] = m_lastLocation[i] + delta;
+  }
+  m_lastLocation = location;
+  int planetaryOrbitNumber;
+  int satelliteOrbitNumber;
+  ds.viread(planetaryOrbitNumber);
+  ds.viread(satelliteOrbitNumber);
+  parameters.m_coordinate = CelestialCoordinate(location, planetaryOrbitNumber, satelliteOrbitNumber);
+
+  ds.vuread(parameters.m_seed);
+  ds.read(parameters.m_name);
+
+  size_t objectSize;
+  ds.vuread(objectSize);
+  if (objectSize != 0) {
+    JsonObject object;
+    for (size_t i = 0; i < objectSize - 1; ++i) {
+      String key = readValue(ds).toString();
+      object[std::move(key)] = readValue(ds);
+    }
+    parameters.m_parameters = std::move(object);
+  } else {
+    parameters.m_parameters = readValue(ds);
+  }
+
+  parameters.m_visitableParameters = netLoadVisitableWorldParameters(ds.read<ByteArray>());
+  return parameters;
+}
+
+void CelestialParametersNetCoder::writeValue(DataStream& ds, Json const& value) {
+  if (auto index = m_valueIndexes.maybe(value)) {
+    ds.vuwrite(*index + 1);
+  } else {
+    ds.vuwrite(0);
+    ds.write(value);
+    m_valueIndexes.add(value, m_valueIndexes.size());
+  }
+}
+
+Json CelestialParametersNetCoder::readValue(DataStream& ds) {
+  size_t index;
+  ds.vuread(index);
+  if (index != 0) {
+    if (index > m_values.size())
+      throw CelestialException("CelestialParametersNetCoder value index out of range");
+    return m_values[index - 1];
+  }
+  m_values.append(ds.read<Json>());
+  return m_values.last();
+}
+
 }
@@ -6,6 +6,7 @@
 namespace Star {
 
 STAR_CLASS(CelestialParameters);
+STAR_CLASS(CelestialParametersNetCoder);
 
 class CelestialParameters {
 public:
@@ -39,6 +40,8 @@ public:
   void setVisitableParameters(VisitableWorldParametersPtr const& newVisitableParameters);
 
 private:
+  friend CelestialParametersNetCoder;
+
   CelestialCoordinate m_coordinate;
   uint64_t m_seed;
   String m_name;
@@ -46,4 +49,26 @@ private:
   VisitableWorldParametersConstPtr m_visitableParameters;
 };
 
+// Compact network form of every CelestialParameters in a single message.  The
+// keys and values of the parameters Json are dictionary coded, so that values
+// repeated between parameters, such as the base parameters shared by every
+// planet of a type, are sent once and then referenced by index.  Coordinates
+// are delta coded against the previous coordinate.  The same coder must be
+// used for everything in the message, in the same order on both ends.
+class CelestialParametersNetCoder {
+public:
+  CelestialParametersNetCoder();
+
+  void write(DataStream& ds, CelestialParameters const& parameters);
+  CelestialParameters read(DataStream& ds);
+
+private:
+  void writeValue(DataStream& ds, Json const& value);
+  Json readValue(DataStream& ds);
+
+  HashMap<Json, size_t> m_valueIndexes;
+  List<Json> m_values;
+  Vec3I m_lastLocation;
+};
+
 }
@@ -129,6 +129,83 @@ DataStream& operator<<(DataStream& ds, CelestialChunk const& chunk) {
   return ds;
 }
 
+static void writeCompactPlanets(DataStream& ds, HashMap<int, CelestialPlanet> const& planets, CelestialParametersNetCoder& coder) {
+  ds.writeMapContainer(planets, [&](DataStream& ds, int orbit, CelestialPlanet const& planet) {
+      ds.viwrite(orbit);
+      coder.write(ds, planet.planetParameters);
+      ds.writeMapContainer(planet.satelliteParameters, [&](DataStream& ds, int orbit, CelestialParameters const& parameters) {
+          ds.viwrite(orbit);
+          coder.write(ds, parameters);
+        });
+    });
+}
+
+static HashMap<int, CelestialPlanet> readCompactPlanets(DataStream& ds, CelestialParametersNetCoder& coder) {
+  HashMap<int, CelestialPlanet> planets;
+  ds.readMapContainer(planets, [&](DataStream& ds, int& orbit, CelestialPlanet& planet) {
+      ds.viread(orbit);
+      planet.planetParameters = coder.read(ds);
+      ds.readMapContainer(planet.satelliteParameters, [&](DataStream& ds, int& orbit, CelestialParameters& parameters) {
+          ds.viread(orbit);
+          parameters = coder.read(ds);
+        });
+    });
+  return planets;
+}
+
+void writeCompactCelestialResponses(DataStream& ds, List<CelestialResponse> const& responses) {
+  CelestialParametersNetCoder coder;
+  ds.writeContainer(responses, [&](DataStream& ds, CelestialResponse const& response) {
+      if (auto chunk = response.leftPtr()) {
+        ds.write<uint8_t>(1);
+        ds.write(chunk->chunkIndex);
+        ds.write(chunk->constellations);
+        ds.writeMapContainer(chunk->systemParameters, [&](DataStream& ds, Vec3I const&, CelestialParameters const& parameters) {
+            // The system location is the location of its parameters' coordinate
+            coder.write(ds, parameters);
+          });
+        ds.writeMapContainer(chunk->systemObjects, [&](DataStream& ds, Vec3I const& location, HashMap<int, CelestialPlanet> const& planets) {
+            ds.write(location);
+            writeCompactPlanets(ds, planets, coder);
+          });
+      } else if (auto systemObjects = response.rightPtr()) {
+        ds.write<uint8_t>(2);
+        ds.write(systemObjects->systemLocation);
+        writeCompactPlanets(ds, systemObjects->planets, coder);
+      } else {
+        ds.write<uint8_t>(0);
+      }
+    });
+}
+
+List<CelestialResponse> readCompactCelestialResponses(DataStream& ds) {
+  CelestialParametersNetCoder coder;
+  List<CelestialResponse> responses;
+  ds.readContainer(responses, [&](DataStream& ds, CelestialResponse& response) {
+      uint8_t type = ds.read<uint8_t>();
+      if (type == 1) {
+        CelestialChunk chunk;
+        ds.read(chunk.chunkIndex);
+        ds.read(chunk.constellations);
+        ds.readMapContainer(chunk.systemParameters, [&](DataStream& ds, Vec3I& location, CelestialParameters& parameters) {
+            parameters = coder.read(ds);
+            location = parameters.coordinate().location();
+          });
+        ds.readMapContainer(chunk.systemObjects, [&](DataStream& ds, Vec3I& location, HashMap<int, CelestialPlanet>& planets) {
+            ds.read(location);
+            planets = readCompactPlanets(ds, coder);
+          });
+        response = makeLeft(std::move(chunk));
+      } else if (type == 2) {
+        CelestialSystemObjects systemObjects;
+        ds.read(systemObjects.systemLocation);
+        systemObjects.planets = readCompactPlanets(ds, coder);
+        response = makeRight(std::move(systemObjects));
+      }
+    });
+  return responses;
+}
+
 DataStream& operator>>(DataStream& ds, CelestialBaseInformation& celestialInformation) {
   ds.read(celestialInformation.planetOrbitalLevels);
   ds.read(celestialInformation.satelliteOrbitalLevels);
@@ -56,6 +56,11 @@ DataStream& operator<<(DataStream& ds, CelestialChunk const& chunk);
 typedef Either<Vec2I, Vec3I> CelestialRequest;
 typedef Either<CelestialChunk, CelestialSystemObjects> CelestialResponse;
 
+// Compact network form of a list of responses, with every CelestialParameters
+// in them written through a single CelestialParametersNetCoder.
+void writeCompactCelestialResponses(DataStream& ds, List<CelestialResponse> const& responses);
+List<CelestialResponse> readCompactCelestialResponses(DataStream& ds);
+
 struct CelestialBaseInformation {
   int planetOrbitalLevels;
   int satelliteOrbitalLevels;
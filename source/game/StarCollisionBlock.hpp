@@ -77,6 +77,8 @@ struct CollisionBlock {
   Vec2I space;
   PolyF poly;
   RectF polyBounds;
+  // Side normals of the poly, precalculated for SAT tests
+  PolyF::VertexList polyNormals;
 };
 
 inline CollisionSet::CollisionSet()
@@ -128,6 +130,7 @@ inline CollisionBlock CollisionBlock::nullBlock(Vec2I const& space) {
     Vec2F(space) + Vec2F(0, 1)
   };
   block.polyBounds = RectF::withSize(Vec2F(space), Vec2F(1, 1));
+  block.polyNormals = block.poly.sideNormals();
   return block;
 }
 
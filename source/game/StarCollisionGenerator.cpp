@@ -35,6 +35,8 @@ void CollisionGenerator::getBlocksPlatforms(List<CollisionBlock>& list, RectI co
           block.kind = kind;
           block.poly = PolyF(std::move(vertices));
           block.polyBounds = block.poly.boundBox();
+    block.polyNormals = block.poly.sideNormals();
+          block.polyNormals = block.poly.sideNormals();
           list.append(std::move(block));
         };
 
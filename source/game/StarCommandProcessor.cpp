@@ -21,12 +21,14 @@
 #include "StarAssets.hpp"
 #include "StarWorldLuaBindings.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
+#include "StarLuaScriptProfiler.hpp"
+#include "StarTraceProfiler.hpp"
 #include "StarString.hpp"
 
 namespace Star {
 
 CommandProcessor::CommandProcessor(UniverseServer* universe, LuaRootPtr luaRoot)
-  : m_universe(universe) {
+  : m_universe(universe), m_memoryStatsAllocatedBytes(Array<uint64_t, MemoryTagCount>::filled(0)), m_memoryStatsTime(0.0) {
   auto assets = Root::singleton().assets();
   m_scriptComponent.addCallbacks("universe", LuaBindings::makeUniverseServerCallbacks(m_universe));
   m_scriptComponent.addCallbacks("CommandProcessor", makeCommandCallbacks());
@@ -956,6 +958,170 @@ String CommandProcessor::setEnvironmentBiome(ConnectionId connectionId, String c
   return done ? "set environment biome for world layer" : "failed to set environment biome";
 }
 
+String CommandProcessor::luaProfile(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "profile lua scripts"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? "" : arguments[0].toLower();
+  if (action == "start") {
+    LuaScriptProfiler::setEnabled(true);
+    return "Lua script profiling started";
+  } else if (action == "stop") {
+    LuaScriptProfiler::setEnabled(false);
+    return "Lua script profiling stopped";
+  } else if (action == "clear") {
+    LuaScriptProfiler::clear();
+    return "Lua script profile cleared";
+  }
+
+  size_t count = 10;
+  if (!action.empty()) {
+    if (auto c = maybeLexicalCast<size_t>(action))
+      count = *c;
+    else
+      return strf("Invalid argument '{}' to /luaprofile, expected start, stop, clear or a count", action);
+  }
+
+  if (!LuaScriptProfiler::enabled())
+    return "Lua script profiling is not running, start it with /luaprofile start";
+
+  double sampleTime = max(LuaScriptProfiler::sampleTime(), 0.001);
+  auto describe = [&](String const& title, List<LuaScriptProfiler::Entry> const& entries) {
+      String res = strf("{}:", title);
+      for (auto const& entry : entries)
+        res += strf("\n  {:.2f}ms/s, {} calls, {} instructions - {}",
+            entry.time * 1000.0 / sampleTime, entry.calls, entry.instructions, entry.name);
+      return res;
+    };
+
+  return strf("Lua script time over the last {:.1f}s\n{}\n{}", sampleTime,
+      describe("By entity type", LuaScriptProfiler::topCategories(count)),
+      describe("By script", LuaScriptProfiler::topScripts(count)));
+}
+
+String CommandProcessor::traceProfile(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "capture a trace profile"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? "" : arguments[0].toLower();
+  if (action == "start") {
+    TraceProfiler::startCapture();
+    return "Trace capture started";
+  } else if (action == "stop") {
+    if (!TraceProfiler::capturing())
+      return "Trace capture is not running, start it with /traceprofile start";
+    String path = TraceProfiler::stopCaptureToFile(Root::singleton().toStoragePath("traces"));
+    return strf("Trace capture written to {}", path);
+  }
+
+  return strf("Invalid argument '{}' to /traceprofile, expected start or stop", action);
+}
+
+String CommandProcessor::packetCapture(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "capture client packets"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  String action = arguments.empty() ? "" : arguments[0].toLower();
+  if (action == "start") {
+    String directory = Root::singleton().toStoragePath("captures");
+    if (!File::isDirectory(directory))
+      File::makeDirectory(directory);
+    String filename = strf("{}.sbcapture", Time::printCurrentDateAndTime("<year>-<month>-<day>-<hours>-<minutes>-<seconds>-<millis>"));
+    m_universe->startPacketCapture(File::relativeTo(directory, filename));
+    return "Packet capture started, clients that connect from now on are recorded";
+  } else if (action == "stop") {
+    if (auto path = m_universe->stopPacketCapture())
+      return strf("Packet capture written to {}", *path);
+    return "Packet capture is not running, start it with /packetcapture start";
+  }
+
+  return strf("Invalid argument '{}' to /packetcapture, expected start or stop", action);
+}
+
+String CommandProcessor::memoryStats(ConnectionId connectionId, String const&) {
+  if (auto errorMsg = adminCheck(connectionId, "view memory statistics"))
+    return *errorMsg;
+
+  if (!threadMemoryStatistics().counted)
+    return "Memory statistics are not counted, the server must be built with STAR_MEMORY_STATISTICS";
+
+  double now = Time::monotonicTime();
+  double elapsed = now - m_memoryStatsTime;
+  bool hasRate = m_memoryStatsTime != 0.0;
+  m_memoryStatsTime = now;
+
+  String result = hasRate ? strf("Memory by tag, allocation rates over the last {:.1f}s:", elapsed) : String("Memory by tag:");
+  for (size_t i = 0; i < MemoryTagCount; ++i) {
+    auto tag = (MemoryTag)i;
+    auto stats = memoryTagStatistics(tag);
+    result += strf("\n{}: {:.2f} MiB live, {} allocations", memoryTagName(tag), stats.liveBytes / 1048576.0, stats.allocations);
+    if (hasRate)
+      result += strf(", {:.2f} MiB/s allocated", (stats.allocatedBytes - m_memoryStatsAllocatedBytes[i]) / 1048576.0 / elapsed);
+    m_memoryStatsAllocatedBytes[i] = stats.allocatedBytes;
+  }
+  return result;
+}
+
+String CommandProcessor::netStats(ConnectionId connectionId, String const& argumentString) {
+  if (auto errorMsg = adminCheck(connectionId, "view network statistics"))
+    return *errorMsg;
+
+  auto arguments = m_parser.tokenizeToStringList(argumentString);
+  if (!arguments.empty()) {
+    if (arguments.size() != 2 || arguments[0] != "fields" || (arguments[1] != "on" && arguments[1] != "off"))
+      return "Invalid arguments to /netstats. Use /netstats [fields on|off]";
+
+    bool enabled = arguments[1] == "on";
+    if (!m_universe->executeForClient(connectionId, [enabled](WorldServer* world, PlayerPtr const&) {
+        world->setNetFieldAccounting(enabled);
+      }))
+      return "Invalid client state";
+    return enabled ? "Now counting entity update bytes by field on this world" : "No longer counting entity update bytes by field on this world";
+  }
+
+  WorldServer::EntityNetStats stats;
+  if (!m_universe->executeForClient(connectionId, [&](WorldServer* world, PlayerPtr const&) {
+      stats = world->takeEntityNetStats();
+    }))
+    return "Invalid client state";
+
+  double duration = max(stats.duration, 0.001);
+  auto types = stats.types.pairs();
+  sortByComputedValue(types, [](auto const& pair) {
+      return -(double)(pair.second.updateBytes + pair.second.createBytes);
+    });
+
+  String result = strf("Entity net state sent by this world over the last {:.1f}s:", duration);
+  for (auto const& pair : types) {
+    result += strf("\n{}: {} updates {:.2f} KiB/s, {} creates {:.2f} KiB/s", EntityTypeNames.getRight(pair.first),
+        pair.second.updates, pair.second.updateBytes / 1024.0 / duration,
+        pair.second.creates, pair.second.createBytes / 1024.0 / duration);
+  }
+
+  if (!stats.fieldBytes.empty()) {
+    auto fields = stats.fieldBytes.pairs();
+    sortByComputedValue(fields, [](auto const& pair) { return -(double)pair.second; });
+    result += "\nCostliest entity fields, by index in the entity's net group:";
+    for (auto const& pair : fields.slice(0, 10))
+      result += strf("\n{} field {}: {:.2f} KiB/s", EntityTypeNames.getRight(pair.first.first), pair.first.second, pair.second / 1024.0 / duration);
+  }
+
+  if (auto outgoing = m_universe->clientOutgoingStats(connectionId)) {
+    auto packetTypes = outgoing->packetBytesPerSecond.pairs();
+    sortByComputedValue(packetTypes, [](auto const& pair) { return -pair.second; });
+    result += strf("\nSent to you over the last second, {:.2f} KiB/s:", outgoing->bytesPerSecond / 1024.0);
+    for (auto const& pair : packetTypes) {
+      if (pair.second > 0.0f)
+        result += strf("\n{}: {:.2f} KiB/s", PacketTypeNames.getRight(pair.first), pair.second / 1024.0);
+    }
+  }
+
+  return result;
+}
+
 Maybe<ConnectionId> CommandProcessor::playerCidFromCommand(String const& player, UniverseServer* universe) {
   char const* const UsernamePrefix = "@";
   char const* const CidPrefix = "$";
@@ -1030,6 +1196,11 @@ const StringMap<std::function<String(CommandProcessor*, ConnectionId, String)>>
   add("updateplanettype", &CommandProcessor::updatePlanetType);
   add("setweather", &CommandProcessor::setWeather);
   add("setenvironmentbiome", &CommandProcessor::setEnvironmentBiome);
+  add("luaprofile", &CommandProcessor::luaProfile);
+  add("traceprofile", &CommandProcessor::traceProfile);
+  add("packetcapture", &CommandProcessor::packetCapture);
+  add("memorystats", &CommandProcessor::memoryStats);
+  add("netstats", &CommandProcessor::netStats);
 
   return map;
 }();
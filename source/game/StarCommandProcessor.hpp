@@ -60,6 +60,11 @@ private:
   String updatePlanetType(ConnectionId connectionId, String const& argumentString);
   String setWeather(ConnectionId connectionId, String const& argumentString);
   String setEnvironmentBiome(ConnectionId connectionId, String const& argumentString);
+  String luaProfile(ConnectionId connectionId, String const& argumentString);
+  String traceProfile(ConnectionId connectionId, String const& argumentString);
+  String packetCapture(ConnectionId connectionId, String const& argumentString);
+  String memoryStats(ConnectionId connectionId, String const& argumentString);
+  String netStats(ConnectionId connectionId, String const& argumentString);
 
   static const StringMap<std::function<String(CommandProcessor*, ConnectionId, String)>> s_commandMap;
 
@@ -74,6 +79,11 @@ private:
   ShellParser m_parser;
 
   LuaBaseComponent m_scriptComponent;
+
+  // Allocated bytes per memory tag when /memorystats was last run, to give
+  // allocation rates since then
+  Array<uint64_t, MemoryTagCount> m_memoryStatsAllocatedBytes;
+  double m_memoryStatsTime;
 };
 
 }
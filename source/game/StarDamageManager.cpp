@@ -56,6 +56,8 @@ DataStream& operator>>(DataStream& ds, RemoteDamageNotification& damageNotificat
   return ds;
 }
 
+float const DamageManager::TargetSpatialHashSectorSize = 16.0f;
+
 DamageManager::DamageManager(World* world, ConnectionId connectionId) : m_world(world), m_connectionId(connectionId) {}
 
 void DamageManager::update(float dt) {
@@ -76,8 +78,24 @@ void DamageManager::update(float dt) {
       damageIt.remove();
   }
 
+  // Gather every damage source up front, so that the hittable entities only
+  // need to be indexed once per update rather than queried from the world
+  // once per damage source.
+  List<pair<EntityPtr, List<DamageSource>>> causingEntities;
+  bool anyDamageSources = false;
   m_world->forAllEntities([&](EntityPtr const& causingEntity) {
-    for (auto& damageSource : causingEntity->damageSources()) {
+      auto damageSources = causingEntity->damageSources();
+      anyDamageSources = anyDamageSources || !damageSources.empty();
+      causingEntities.append({causingEntity, std::move(damageSources)});
+    });
+
+  TargetSpatialHash targets(TargetSpatialHashSectorSize);
+  if (anyDamageSources)
+    buildTargetSpatialHash(targets);
+
+  for (auto& causingPair : causingEntities) {
+    auto const& causingEntity = causingPair.first;
+    for (auto& damageSource : causingPair.second) {
       if (damageSource.trackSourceEntity)
         damageSource.translate(causingEntity->position());
 
@@ -86,8 +104,8 @@ void DamageManager::update(float dt) {
       else if (auto line = damageSource.damageArea.ptr<Line2F>())
         SpatialLogger::logLine("world", *line, Color::Orange.toRgba());
 
-      for (auto const& hitResultPair : queryHit(damageSource, causingEntity->entityId())) {
-        auto targetEntity = m_world->entity(hitResultPair.first);
+      for (auto const& hitResultPair : queryHit(damageSource, causingEntity->entityId(), targets)) {
+        auto const& targetEntity = targets.get(hitResultPair.first);
         if (!isAuthoritative(causingEntity, targetEntity))
           continue;
 
@@ -124,7 +142,7 @@ void DamageManager::update(float dt) {
 
     for (auto const& damageNotification : causingEntity->selfDamageNotifications())
       addDamageNotification({causingEntity->entityId(), damageNotification});
-  });
+  }
 }
 
 void DamageManager::pushRemoteHitRequest(RemoteHitRequest const& remoteHitRequest) {
@@ -174,7 +192,19 @@ List<DamageNotification> DamageManager::pullPendingNotifications() {
   return take(m_pendingNotifications);
 }
 
-SmallList<pair<EntityId, HitType>, 4> DamageManager::queryHit(DamageSource const& source, EntityId causingId) const {
+void DamageManager::buildTargetSpatialHash(TargetSpatialHash& targets) const {
+  // Only entities with a hit poly can ever respond to queryHit, so things
+  // like projectiles and item drops never need to be considered as targets.
+  // Entries use the meta bound box, the same bounds the world entity map
+  // uses, so that shield hits outside of the hit poly are still found.
+  auto const& geometry = m_world->geometry();
+  m_world->forAllEntities([&](EntityPtr const& entity) {
+      if (entity->hitPoly())
+        targets.set(entity->entityId(), geometry.splitRect(entity->metaBoundBox(), entity->position()), entity);
+    });
+}
+
+SmallList<pair<EntityId, HitType>, 4> DamageManager::queryHit(DamageSource const& source, EntityId causingId, TargetSpatialHash const& targets) const {
   SmallList<pair<EntityId, HitType>, 4> resultList;
   auto doQueryHit = [&source, &resultList, causingId, this](EntityPtr const& targetEntity) {
     if (targetEntity->entityId() == causingId)
@@ -206,10 +236,15 @@ SmallList<pair<EntityId, HitType>, 4> DamageManager::queryHit(DamageSource const
     return;
   };
 
-  if (auto poly = source.damageArea.ptr<PolyF>())
-    m_world->forEachEntity(poly->boundBox(), doQueryHit);
-  else if (auto line = source.damageArea.ptr<Line2F>())
-    m_world->forEachEntityLine(line->min(), line->max(), doQueryHit);
+  auto const& geometry = m_world->geometry();
+  if (auto poly = source.damageArea.ptr<PolyF>()) {
+    targets.forEach(geometry.splitRect(poly->boundBox()), doQueryHit);
+  } else if (auto line = source.damageArea.ptr<Line2F>()) {
+    targets.forEach(geometry.splitRect(RectF::boundBoxOf(line->min(), line->max())), [&](EntityPtr const& targetEntity) {
+        if (geometry.lineIntersectsRect(*line, targetEntity->metaBoundBox().translated(targetEntity->position())))
+          doQueryHit(targetEntity);
+      });
+  }
 
   return resultList;
 }
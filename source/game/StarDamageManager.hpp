@@ -2,6 +2,7 @@
 
 #include "StarDamage.hpp"
 #include "StarDamageTypes.hpp"
+#include "StarSpatialHash2D.hpp"
 
 namespace Star {
 
@@ -70,9 +71,17 @@ private:
     float timeout;
   };
 
+  // Broadphase of every entity that can be hit by a damage source, rebuilt
+  // once per update and only when there are damage sources to test.
+  typedef SpatialHash2D<EntityId, float, EntityPtr> TargetSpatialHash;
+
+  static float const TargetSpatialHashSectorSize;
+
+  void buildTargetSpatialHash(TargetSpatialHash& targets) const;
+
   // Searches for and queries for hit to any entity within range of the
   // damage source.  Skips over source.sourceEntityId, if set.
-  SmallList<pair<EntityId, HitType>, 4> queryHit(DamageSource const& source, EntityId causingId) const;
+  SmallList<pair<EntityId, HitType>, 4> queryHit(DamageSource const& source, EntityId causingId, TargetSpatialHash const& targets) const;
 
   bool isAuthoritative(EntityPtr const& causingEntity, EntityPtr const& targetEntity);
 
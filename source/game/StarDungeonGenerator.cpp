@@ -10,11 +10,27 @@
 #include "StarLiquidsDatabase.hpp"
 #include "StarDungeonImagePart.hpp"
 #include "StarDungeonTMXPart.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
 size_t const DefinitionsCacheSize = 20;
 
+void DungeonGeneratorWorldFacade::readTileStates(RectI const& region, DungeonTileState* out) {
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      Vec2I position(x, y);
+      out->foregroundSolid = checkSolid(position, TileLayer::Foreground);
+      out->foregroundOpen = checkOpen(position, TileLayer::Foreground);
+      out->backgroundSolid = checkSolid(position, TileLayer::Background);
+      out->backgroundOpen = checkOpen(position, TileLayer::Background);
+      out->oceanLiquid = checkOceanLiquid(position);
+      out->otherDungeon = getDungeonIdAt(position) != NoDungeonId;
+      ++out;
+    }
+  }
+}
+
 namespace Dungeon {
 
   EnumMap<Dungeon::Direction> const DungeonDirectionNames{
@@ -55,6 +71,38 @@ namespace Dungeon {
     return Biome5MaterialId;
   }
 
+  TerrainSnapshot::TerrainSnapshot(RectI const& region, List<DungeonTileState> tiles)
+    : m_region(region), m_tiles(std::move(tiles)) {
+    starAssert(m_tiles.size() == (size_t)(region.width() * region.height()));
+  }
+
+  RectI const& TerrainSnapshot::region() const {
+    return m_region;
+  }
+
+  bool TerrainSnapshot::checkSolid(Vec2I const& position, TileLayer layer) const {
+    auto const& state = tile(position);
+    return layer == TileLayer::Foreground ? state.foregroundSolid : state.backgroundSolid;
+  }
+
+  bool TerrainSnapshot::checkOpen(Vec2I const& position, TileLayer layer) const {
+    auto const& state = tile(position);
+    return layer == TileLayer::Foreground ? state.foregroundOpen : state.backgroundOpen;
+  }
+
+  bool TerrainSnapshot::checkLiquid(Vec2I const& position) const {
+    return tile(position).oceanLiquid;
+  }
+
+  bool TerrainSnapshot::otherDungeonPresent(Vec2I const& position) const {
+    return tile(position).otherDungeon;
+  }
+
+  DungeonTileState const& TerrainSnapshot::tile(Vec2I const& position) const {
+    starAssert(m_region.contains(position));
+    return m_tiles[(position[0] - m_region.xMin()) + (position[1] - m_region.yMin()) * m_region.width()];
+  }
+
   ConnectorConstPtr chooseOption(List<ConnectorConstPtr>& options, RandomSource& rnd) {
     float distribution = 0;
     for (size_t i = 0; i < options.size(); i++)
@@ -118,6 +166,10 @@ namespace Dungeon {
     return Maybe<RuleConstPtr>();
   }
 
+  bool Rule::checkTileCanPlace(Vec2I, TerrainSnapshot const&) const {
+    return true;
+  }
+
   bool Rule::checkTileCanPlace(Vec2I, DungeonGeneratorWriter*) const {
     return true;
   }
@@ -521,6 +573,17 @@ namespace Dungeon {
     return true;
   }
 
+  bool Tile::canPlace(Vec2I position, TerrainSnapshot const& terrain) const {
+    if (terrain.otherDungeonPresent(position))
+      return false;
+    else if (position[1] < 0)
+      return false;
+    for (size_t i = 0; i < rules.size(); i++)
+      if (!rules[i]->checkTileCanPlace(position, terrain))
+        return false;
+    return true;
+  }
+
   void Tile::place(Vec2I position, Phase phase, DungeonGeneratorWriter* writer) const {
     for (size_t i = 0; i < brushes.size(); i++) {
       brushes[i]->paint(position, phase, writer);
@@ -565,6 +628,40 @@ namespace Dungeon {
     return false;
   }
 
+  CompiledPartReader::CompiledPartReader(PartReaderPtr source)
+    : m_source(std::move(source)) {
+    compile();
+  }
+
+  void CompiledPartReader::readAsset(String const& asset) {
+    m_source->readAsset(asset);
+    compile();
+  }
+
+  Vec2U CompiledPartReader::size() const {
+    return m_size;
+  }
+
+  void CompiledPartReader::forEachTile(TileCallback const& callback) const {
+    for (auto const& p : m_tiles) {
+      if (callback(p.first, *p.second))
+        return;
+    }
+  }
+
+  void CompiledPartReader::forEachTileAt(Vec2I pos, TileCallback const& callback) const {
+    m_source->forEachTileAt(pos, callback);
+  }
+
+  void CompiledPartReader::compile() {
+    m_size = m_source->size();
+    m_tiles.clear();
+    m_source->forEachTile([this](Vec2I pos, Tile const& tile) {
+        m_tiles.append({pos, &tile});
+        return false;
+      });
+  }
+
   PartConstPtr parsePart(DungeonDefinition* dungeon, Json const& definition, Maybe<ImageTilesetConstPtr> tileset) {
     String kind = definition.get("def").getString(0);
     if (kind == "image") {
@@ -589,7 +686,6 @@ namespace Dungeon {
     m_maximumThreatLevel = part.optFloat("maximumThreatLevel");
     m_clearAnchoredObjects = part.getBool("clearAnchoredObjects", true);
 
-    m_reader = reader;
     Json const& def = part.get("def");
     if (def.get(1).type() == Json::Type::String) {
       reader->readAsset(AssetPath::relativeTo(dungeon->directory(), def.get(1).toString()));
@@ -597,6 +693,7 @@ namespace Dungeon {
       for (auto const& asset : def.get(1).iterateArray())
         reader->readAsset(AssetPath::relativeTo(dungeon->directory(), asset.toString()));
     }
+    m_reader = make_shared<CompiledPartReader>(std::move(reader));
     m_size = m_reader->size();
     scanConnectors();
     scanAnchor();
@@ -733,6 +830,22 @@ namespace Dungeon {
     return result;
   }
 
+  bool Part::canPlace(Vec2I pos, TerrainSnapshot const& terrain) const {
+    if (m_overrideAllowAlways)
+      return true;
+
+    bool result = true;
+    m_reader->forEachTile([&result, pos, &terrain](Vec2I tilePos, Tile const& tile) -> bool {
+      if (!tile.canPlace(pos + tilePos, terrain)) {
+        result = false;
+        return true;
+      }
+      return false;
+    });
+
+    return result;
+  }
+
   void Part::place(Vec2I pos, Set<Vec2I> const& places, DungeonGeneratorWriter* writer) const {
     placePhase(pos, Phase::ClearPhase, places, writer);
     placePhase(pos, Phase::WallPhase, places, writer);
@@ -917,6 +1030,22 @@ namespace Dungeon {
     return !writer->checkLiquid(position);
   }
 
+  bool WorldGenMustContainSolidRule::checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const {
+    return terrain.checkSolid(position, layer);
+  }
+
+  bool WorldGenMustContainAirRule::checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const {
+    return terrain.checkOpen(position, layer);
+  }
+
+  bool WorldGenMustContainLiquidRule::checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const {
+    return terrain.checkLiquid(position);
+  }
+
+  bool WorldGenMustNotContainLiquidRule::checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const {
+    return !terrain.checkLiquid(position);
+  }
+
   Connector::Connector(Part* part, String value, bool forwardOnly, Direction direction, Vec2I offset)
     : m_value(value), m_forwardOnly(forwardOnly), m_direction(direction), m_offset(offset), m_part(part) {}
 
@@ -1093,6 +1222,25 @@ namespace Dungeon {
     return m_facade->getDungeonIdAt(position) != NoDungeonId;
   }
 
+  TerrainSnapshot DungeonGeneratorWriter::terrainSnapshot(RectI const& region) {
+    List<DungeonTileState> tiles(region.width() * region.height());
+    m_facade->readTileStates(region, tiles.ptr());
+
+    if (m_terrainMarkingSurfaceLevel) {
+      auto tile = tiles.begin();
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        bool solid = y < *m_terrainMarkingSurfaceLevel;
+        for (int x = region.xMin(); x < region.xMax(); ++x) {
+          tile->foregroundSolid = tile->backgroundSolid = solid;
+          tile->foregroundOpen = tile->backgroundOpen = !solid;
+          ++tile;
+        }
+      }
+    }
+
+    return TerrainSnapshot(region, std::move(tiles));
+  }
+
   void DungeonGeneratorWriter::setDungeonId(Vec2I const& pos, DungeonId dungeonId) {
     m_dungeonIds[pos] = dungeonId;
   }
@@ -1515,6 +1663,12 @@ pair<List<RectI>, Set<Vec2I>> DungeonGenerator::buildDungeon(Dungeon::PartConstP
       if (closedConnectors.contains(connectorPos))
         continue;
       List<Dungeon::ConnectorConstPtr> options = findConnectablePart(connector);
+      // Nothing is written to the world until the dungeon is flushed, so
+      // whether each option can be placed here does not change while trying
+      // them in turn, and can be worked out for all of them up front.
+      HashMap<Dungeon::Connector const*, bool> canPlace;
+      if (!forcePlacement)
+        canPlace = checkCanPlace(options, connectorPos, writer);
       while (options.size()) {
         Dungeon::ConnectorConstPtr option = chooseOption(options, m_rand);
         Logger::debug("Trying part {}", option->part()->name());
@@ -1549,7 +1703,7 @@ pair<List<RectI>, Set<Vec2I>> DungeonGenerator::buildDungeon(Dungeon::PartConstP
           Logger::debug("part failed in maximumThreatLevel");
           continue;
         }
-        if (forcePlacement || option->part()->canPlace(partPos, writer)) {
+        if (forcePlacement || canPlace.get(option.get())) {
           placePart(option->part(), partPos);
           closedConnectors.add(connectorPos);
           closedConnectors.add(optionPos);
@@ -1568,6 +1722,34 @@ pair<List<RectI>, Set<Vec2I>> DungeonGenerator::buildDungeon(Dungeon::PartConstP
   return {writer->boundingBoxes(), modifiedTiles};
 }
 
+HashMap<Dungeon::Connector const*, bool> DungeonGenerator::checkCanPlace(
+    List<Dungeon::ConnectorConstPtr> const& options, Vec2I connectorPos, Dungeon::DungeonGeneratorWriter* writer) const {
+  static WorkerPool pool("DungeonGenerator", max<unsigned>(Thread::numberOfProcessors(), 2) - 1);
+
+  List<pair<Dungeon::Part const*, Vec2I>> placements;
+  RectI bounds = RectI::null();
+  for (auto const& option : options) {
+    Vec2I partPos = connectorPos - option->offset() + option->positionAdjustment();
+    placements.append({option->part(), partPos});
+    bounds.combine(RectI::withSize(partPos, Vec2I(option->part()->size())));
+  }
+
+  // Not List<bool>, each result is written from a different thread
+  List<uint8_t> results(options.size(), false);
+  if (!bounds.isNull()) {
+    auto terrain = writer->terrainSnapshot(bounds);
+    pool.parallelFor(0, placements.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          results[i] = placements[i].first->canPlace(placements[i].second, terrain);
+      });
+  }
+
+  HashMap<Dungeon::Connector const*, bool> canPlace;
+  for (size_t i = 0; i < options.size(); ++i)
+    canPlace[options[i].get()] = results[i];
+  return canPlace;
+}
+
 Dungeon::PartConstPtr DungeonGenerator::pickAnchor() {
   auto validAnchors = m_def->anchors().filtered([this](String const& anchorName) {
     auto anchorPart = m_def->parts().get(anchorName);
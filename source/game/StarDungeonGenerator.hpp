@@ -17,6 +17,16 @@ STAR_CLASS(DungeonGeneratorWorldFacade);
 STAR_CLASS(DungeonDefinition);
 STAR_CLASS(DungeonDefinitions);
 
+// The state of a tile that dungeon placement rules check.
+struct DungeonTileState {
+  bool foregroundSolid = false;
+  bool foregroundOpen = false;
+  bool backgroundSolid = false;
+  bool backgroundOpen = false;
+  bool oceanLiquid = false;
+  bool otherDungeon = false;
+};
+
 class DungeonGeneratorWorldFacade {
 public:
   virtual ~DungeonGeneratorWorldFacade() {}
@@ -47,6 +57,9 @@ public:
   virtual bool checkOpen(Vec2I const& position, TileLayer layer) = 0;
   virtual bool checkOceanLiquid(Vec2I const& position) = 0;
   virtual DungeonId getDungeonIdAt(Vec2I const& position) = 0;
+  // Reads the tile state of every tile in the region into out, row by row.
+  // The default goes through the checks above a tile at a time.
+  virtual void readTileStates(RectI const& region, DungeonTileState* out);
   virtual void setDungeonIdAt(Vec2I const& position, DungeonId dungeonId) = 0;
   virtual void clearTileEntities(RectI const& bounds, Set<Vec2I> const& positions, bool clearAnchoredObjects) = 0;
 
@@ -64,6 +77,28 @@ namespace Dungeon {
   STAR_STRUCT(Tile);
   STAR_CLASS(Connector);
 
+  // Read only copy of the tile states over a region, so that the placement
+  // rules for several candidate parts can be checked concurrently, without
+  // going through the world facade.
+  class TerrainSnapshot {
+  public:
+    TerrainSnapshot(RectI const& region, List<DungeonTileState> tiles);
+
+    RectI const& region() const;
+
+    // Positions must be inside the snapshot region.
+    bool checkSolid(Vec2I const& position, TileLayer layer) const;
+    bool checkOpen(Vec2I const& position, TileLayer layer) const;
+    bool checkLiquid(Vec2I const& position) const;
+    bool otherDungeonPresent(Vec2I const& position) const;
+
+  private:
+    DungeonTileState const& tile(Vec2I const& position) const;
+
+    RectI m_region;
+    List<DungeonTileState> m_tiles;
+  };
+
   class DungeonGeneratorWriter {
   public:
     DungeonGeneratorWriter(DungeonGeneratorWorldFacadePtr facade, Maybe<int> terrainMarkingSurfaceLevel, Maybe<int> terrainSurfaceSpaceExtends);
@@ -93,6 +128,8 @@ namespace Dungeon {
     bool checkOpen(Vec2I position, TileLayer layer);
     bool checkLiquid(Vec2I const& position);
     bool otherDungeonPresent(Vec2I position);
+    // Snapshot of the same state the checks above read, over the region.
+    TerrainSnapshot terrainSnapshot(RectI const& region);
     void setDungeonId(Vec2I const& pos, DungeonId dungeonId);
     void markPosition(Vec2F const& pos);
     void markPosition(Vec2I const& pos);
@@ -168,6 +205,8 @@ namespace Dungeon {
     virtual ~Rule() {}
 
     virtual bool checkTileCanPlace(Vec2I position, DungeonGeneratorWriter* writer) const;
+    // Must agree with checkTileCanPlace given a writer over the same terrain
+    virtual bool checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const;
 
     virtual bool overdrawable() const;
     virtual bool ignorePartMaximum() const;
@@ -189,6 +228,7 @@ namespace Dungeon {
     WorldGenMustContainAirRule(TileLayer layer) : layer(layer) {}
 
     virtual bool checkTileCanPlace(Vec2I position, DungeonGeneratorWriter* writer) const override;
+    virtual bool checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const override;
 
     virtual bool requiresOpen() const override {
       return true;
@@ -202,6 +242,7 @@ namespace Dungeon {
     WorldGenMustContainSolidRule(TileLayer layer) : layer(layer) {}
 
     virtual bool checkTileCanPlace(Vec2I position, DungeonGeneratorWriter* writer) const override;
+    virtual bool checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const override;
 
     virtual bool requiresSolid() const override {
       return true;
@@ -215,6 +256,7 @@ namespace Dungeon {
     WorldGenMustContainLiquidRule() {}
 
     virtual bool checkTileCanPlace(Vec2I position, DungeonGeneratorWriter* writer) const override;
+    virtual bool checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const override;
     
     virtual bool requiresLiquid() const override {
       return true;
@@ -226,6 +268,7 @@ namespace Dungeon {
     WorldGenMustNotContainLiquidRule() {}
 
     virtual bool checkTileCanPlace(Vec2I position, DungeonGeneratorWriter* writer) const override;
+    virtual bool checkTileCanPlace(Vec2I position, TerrainSnapshot const& terrain) const override;
   };
 
   class AllowOverdrawingRule : public Rule {
@@ -559,6 +602,29 @@ namespace Dungeon {
     PartReader() {}
   };
 
+  // Flattens the tiles of another reader into a single array once, so that
+  // iterating over a part's tiles no longer decodes image colors or walks TMX
+  // layers and objects every time.  The source reader owns the tiles, and
+  // still answers forEachTileAt.
+  class CompiledPartReader : public PartReader {
+  public:
+    CompiledPartReader(PartReaderPtr source);
+
+    virtual void readAsset(String const& asset) override;
+
+    virtual Vec2U size() const override;
+
+    virtual void forEachTile(TileCallback const& callback) const override;
+    virtual void forEachTileAt(Vec2I pos, TileCallback const& callback) const override;
+
+  private:
+    void compile();
+
+    PartReaderPtr m_source;
+    Vec2U m_size;
+    List<pair<Vec2I, Tile const*>> m_tiles;
+  };
+
   class Part {
   public:
     Part(DungeonDefinition* dungeon, Json const& part, PartReaderPtr reader);
@@ -580,6 +646,8 @@ namespace Dungeon {
     bool collidesWithPlaces(Vec2I pos, Set<Vec2I>& places) const;
 
     bool canPlace(Vec2I pos, DungeonGeneratorWriter* writer) const;
+    // The terrain snapshot must cover the whole part at the given position
+    bool canPlace(Vec2I pos, TerrainSnapshot const& terrain) const;
 
     void place(Vec2I pos, Set<Vec2I> const& places, DungeonGeneratorWriter* writer) const;
 
@@ -618,6 +686,7 @@ namespace Dungeon {
 
   struct Tile {
     bool canPlace(Vec2I position, DungeonGeneratorWriter* writer) const;
+    bool canPlace(Vec2I position, TerrainSnapshot const& terrain) const;
     void place(Vec2I position, Phase phase, DungeonGeneratorWriter* writer) const;
     bool usesPlaces() const;
     bool modifiesPlaces() const;
@@ -701,6 +770,10 @@ public:
   DungeonDefinitionConstPtr definition() const;
 
 private:
+  // Checks canPlace for each of the options against the connector at
+  // connectorPos, all against one terrain snapshot and in parallel.
+  HashMap<Dungeon::Connector const*, bool> checkCanPlace(List<Dungeon::ConnectorConstPtr> const& options, Vec2I connectorPos, Dungeon::DungeonGeneratorWriter* writer) const;
+
   DungeonDefinitionConstPtr m_def;
 
   RandomSource m_rand;
@@ -170,4 +170,8 @@ VersionedJson EntityFactory::storeVersionedEntity(EntityPtr const& entityPtr) co
   return storeVersionedJson(entityPtr->entityType(), diskStoreEntity(entityPtr));
 }
 
+Maybe<EntityType> EntityFactory::versionedEntityType(VersionedJson const& versionedJson) const {
+  return EntityStorageIdentifiers.maybeLeft(versionedJson.identifier);
+}
+
 }
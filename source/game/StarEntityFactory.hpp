@@ -34,6 +34,9 @@ public:
   // forward to match the current version.
   EntityPtr loadVersionedEntity(VersionedJson const& versionedJson) const;
   VersionedJson storeVersionedEntity(EntityPtr const& entityPtr) const;
+  // The type of entity held in a store written by storeVersionedEntity, if
+  // the store identifier is recognized.
+  Maybe<EntityType> versionedEntityType(VersionedJson const& versionedJson) const;
 
 private:
   static EnumMap<EntityType> const EntityStorageIdentifiers;
@@ -90,56 +90,65 @@ List<EntityId> EntityMap::entityIds() const {
 }
 
 void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder) {
-  auto updateEntityInfo = [&](SpatialMap::Entry const& entry) {
-    auto const& entity = entry.value;
+  fillEntrySortBuffer(sortOrder);
 
-    auto position = entity->position();
-    auto boundBox = entity->metaBoundBox();
+  for (auto entry : m_entrySortBuffer) {
+    if (callback)
+      callback(entry->value);
+    updateEntityInfo(*entry);
+  }
+}
 
-    if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
-      throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
-          entity->entityId(), (int)entity->entityType());
+void EntityMap::updateAllEntitiesParallel(WorkerPool& workerPool, EntityFilter const& parallelFilter, EntityCallback const& parallelCallback,
+    EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder) {
+  fillEntrySortBuffer(sortOrder);
+
+  auto runPhase = [&](size_t begin, size_t end) {
+    m_serialEntryBuffer.clear();
+    m_parallelEntryBatches.clear();
+    for (size_t i = begin; i < end; ++i) {
+      auto entry = m_entrySortBuffer[i];
+      if (parallelFilter(entry->value))
+        m_parallelEntryBatches[Vec2I::floor(entry->value->position() / EntityMapSpatialHashSectorSize)].append(entry);
+      else
+        m_serialEntryBuffer.append(entry);
     }
 
-    auto entityId = entity->entityId();
-    if (entityId == NullEntityId)
-      throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
-
-    auto rects = m_geometry.splitRect(boundBox, position);
-    if (!containersEqual(rects, entry.rects))
-      m_spatialMap.set(entityId, rects);
-
-    auto uniqueId = entity->uniqueId();
-    if (uniqueId) {
-      if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
-        if (entityId != *existingEntityId)
-          throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
-      } else {
-        m_uniqueMap.removeRight(entityId);
-        m_uniqueMap.add(*uniqueId, entityId);
+    if (!m_parallelEntryBatches.empty()) {
+      // Every batch must be finished before leaving the phase, even if one of
+      // them threw, since they all reference the phase's entries.  Waiting on
+      // the group guarantees that, and this thread runs batches meanwhile.
+      WorkerPoolGroup group(workerPool);
+      for (auto const& batch : m_parallelEntryBatches) {
+        group.add([&parallelCallback, &entries = batch.second]() {
+            for (auto entry : entries)
+              parallelCallback(entry->value);
+          });
       }
-    } else {
-      m_uniqueMap.removeRight(entityId);
-    }
-  };
+      group.wait();
 
-  // Even if there is no sort order, we still copy pointers to a temporary
-  // list, so that it is safe to call addEntity from the callback.
-  m_entrySortBuffer.clear();
-  for (auto const& entry : m_spatialMap.entries())
-    m_entrySortBuffer.append(&entry.second);
+      for (auto const& batch : m_parallelEntryBatches) {
+        for (auto entry : batch.second)
+          updateEntityInfo(*entry);
+      }
+    }
 
-  if (sortOrder) {
-    m_entrySortBuffer.sort([&sortOrder](auto a, auto b) {
-        return sortOrder(a->value, b->value);
-      });
-  }
+    for (auto entry : m_serialEntryBuffer) {
+      if (callback)
+        callback(entry->value);
+      updateEntityInfo(*entry);
+    }
+  };
 
-  for (auto entry : m_entrySortBuffer) {
-    if (callback)
-      callback(entry->value);
-    updateEntityInfo(*entry);
+  size_t phaseBegin = 0;
+  for (size_t i = 1; i < m_entrySortBuffer.size(); ++i) {
+    if (sortOrder && sortOrder(m_entrySortBuffer[phaseBegin]->value, m_entrySortBuffer[i]->value)) {
+      runPhase(phaseBegin, i);
+      phaseBegin = i;
+    }
   }
+  if (phaseBegin < m_entrySortBuffer.size())
+    runPhase(phaseBegin, m_entrySortBuffer.size());
 }
 
 EntityId EntityMap::uniqueEntityId(String const& uniqueId) const {
@@ -187,6 +196,13 @@ void EntityMap::forEachEntity(RectF const& boundBox, EntityCallback const& callb
   m_spatialMap.forEach(m_geometry.splitRect(boundBox), callback);
 }
 
+void EntityMap::forEachEntity(List<RectF> const& regions, EntityCallback const& callback) const {
+  SmallList<RectF, 8> rects;
+  for (auto const& region : regions)
+    rects.appendAll(m_geometry.splitRect(region));
+  m_spatialMap.forEach(rects, callback);
+}
+
 void EntityMap::forEachEntityLine(Vec2F const& begin, Vec2F const& end, EntityCallback const& callback) const {
   return m_spatialMap.forEach(m_geometry.splitRect(RectF::boundBoxOf(begin, end)), [&](EntityPtr const& entity) {
       if (m_geometry.lineIntersectsRect({begin, end}, entity->metaBoundBox().translated(entity->position())))
@@ -364,4 +380,51 @@ bool EntityMap::spaceIsOccupied(RectF const& rect, bool includesEphemeral) const
   return false;
 }
 
+void EntityMap::updateEntityInfo(SpatialMap::Entry const& entry) {
+  auto const& entity = entry.value;
+
+  auto position = entity->position();
+  auto boundBox = entity->metaBoundBox();
+
+  if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
+    throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
+        entity->entityId(), (int)entity->entityType());
+  }
+
+  auto entityId = entity->entityId();
+  if (entityId == NullEntityId)
+    throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
+
+  auto rects = m_geometry.splitRect(boundBox, position);
+  if (!containersEqual(rects, entry.rects))
+    m_spatialMap.set(entityId, rects);
+
+  auto uniqueId = entity->uniqueId();
+  if (uniqueId) {
+    if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
+      if (entityId != *existingEntityId)
+        throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
+    } else {
+      m_uniqueMap.removeRight(entityId);
+      m_uniqueMap.add(*uniqueId, entityId);
+    }
+  } else {
+    m_uniqueMap.removeRight(entityId);
+  }
+}
+
+void EntityMap::fillEntrySortBuffer(function<bool(EntityPtr const&, EntityPtr const&)> const& sortOrder) {
+  // Even if there is no sort order, we still copy pointers to a temporary
+  // list, so that it is safe to call addEntity from the callback.
+  m_entrySortBuffer.clear();
+  for (auto const& entry : m_spatialMap.entries())
+    m_entrySortBuffer.append(&entry.second);
+
+  if (sortOrder) {
+    m_entrySortBuffer.sort([&sortOrder](auto a, auto b) {
+        return sortOrder(a->value, b->value);
+      });
+  }
+}
+
 }
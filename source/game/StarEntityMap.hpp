@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarSpatialHash2D.hpp"
+#include "StarWorkerPool.hpp"
 #include "StarEntity.hpp"
 
 namespace Star {
@@ -46,6 +47,17 @@ public:
   // the spatial information for each entity along the way.
   void updateAllEntities(EntityCallback const& callback = {}, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder = {});
 
+  // Like updateAllEntities, but entities matching parallelFilter are passed to
+  // parallelCallback concurrently on the given worker pool, batched by the
+  // spatial sector their position lies in.  All other entities are passed to
+  // callback on the calling thread.  Entities that compare equal under the
+  // sort order form a phase, and every entity in a phase is updated before any
+  // entity in the next phase starts.  Adding entities is not safe from
+  // parallelCallback, and spatial information for the parallel entities is
+  // only updated once their whole phase has finished.
+  void updateAllEntitiesParallel(WorkerPool& workerPool, EntityFilter const& parallelFilter, EntityCallback const& parallelCallback,
+      EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder = {});
+
   // If the given unique entity is in this map, then return its entity id
   EntityId uniqueEntityId(String const& uniqueId) const;
 
@@ -66,6 +78,9 @@ public:
 
   // Callback versions of query functions.
   void forEachEntity(RectF const& boundBox, EntityCallback const& callback) const;
+  // Calls the callback exactly once for every entity that intersects any of
+  // the given regions.
+  void forEachEntity(List<RectF> const& regions, EntityCallback const& callback) const;
   void forEachEntityLine(Vec2F const& begin, Vec2F const& end, EntityCallback const& callback) const;
   // Returns tile-based entities that occupy the given tile position.
   void forEachEntityAtTile(Vec2I const& pos, EntityCallbackOf<TileEntity> const& callback) const;
@@ -118,6 +133,9 @@ public:
 private:
   typedef SpatialHash2D<EntityId, float, EntityPtr> SpatialMap;
 
+  void updateEntityInfo(SpatialMap::Entry const& entry);
+  void fillEntrySortBuffer(function<bool(EntityPtr const&, EntityPtr const&)> const& sortOrder);
+
   WorldGeometry m_geometry;
 
   SpatialMap m_spatialMap;
@@ -128,6 +146,8 @@ private:
   EntityId m_endIdSpace;
 
   List<SpatialMap::Entry const*> m_entrySortBuffer;
+  List<SpatialMap::Entry const*> m_serialEntryBuffer;
+  HashMap<Vec2I, List<SpatialMap::Entry const*>> m_parallelEntryBatches;
 };
 
 template <typename EntityT>
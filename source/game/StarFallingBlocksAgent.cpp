@@ -4,65 +4,87 @@
 
 namespace Star {
 
+void FallingBlocksFacade::beginColumn(RectI const&) {}
+
+void FallingBlocksFacade::endColumn() {}
+
 FallingBlocksAgent::FallingBlocksAgent(FallingBlocksFacadePtr worldFacade)
   : m_facade(std::move(worldFacade)) {
   m_immediateUpwardPropagateProbability = Root::singleton().assets()->json("/worldserver.config:fallingBlocksImmediateUpwardPropogateProbability").toFloat();
 }
 
+void FallingBlocksAgent::setProcessingBudget(Maybe<size_t> processingBudget) {
+  m_processingBudget = processingBudget;
+}
+
 void FallingBlocksAgent::update() {
-  HashSet<Vec2I> processing = take(m_pending);
+  ColumnPositions processing = take(m_pending);
+  size_t processed = 0;
 
   while (!processing.empty()) {
-    List<Vec2I> positions;
-    for (auto const& pos : take(processing))
-      positions.append(pos);
-
-    m_random.shuffle(positions);
-
-    positions.sort([](auto const& a, auto const& b) {
-        return a[1] < b[1];
-      });
-
-    for (auto const& pos : positions) {
-      Vec2I belowPos = pos + Vec2I(0, -1);
-      Vec2I belowLeftPos = pos + Vec2I(-1, -1);
-      Vec2I belowRightPos = pos + Vec2I(1, -1);
-
-      FallingBlockType thisBlock = m_facade->blockType(pos);
-      FallingBlockType belowBlock = m_facade->blockType(belowPos);
-
-      Maybe<Vec2I> moveTo;
-
-      if (thisBlock == FallingBlockType::Falling) {
-        if (belowBlock == FallingBlockType::Open)
-          moveTo = belowPos;
-      } else if (thisBlock == FallingBlockType::Cascading) {
-        if (belowBlock == FallingBlockType::Open) {
-          moveTo = belowPos;
-        } else {
-          FallingBlockType belowLeftBlock = m_facade->blockType(belowLeftPos);
-          FallingBlockType belowRightBlock = m_facade->blockType(belowRightPos);
-
-          if (belowLeftBlock == FallingBlockType::Open && belowRightBlock == FallingBlockType::Open)
-            moveTo = m_random.randb() ? belowLeftPos : belowRightPos;
-          else if (belowLeftBlock == FallingBlockType::Open)
-            moveTo = belowLeftPos;
-          else if (belowRightBlock == FallingBlockType::Open)
-            moveTo = belowRightPos;
-        }
-      }
+    List<pair<int, List<int>>> columns;
+    for (auto const& pair : take(processing))
+      columns.append({pair.first, pair.second.values()});
 
-      if (moveTo) {
-        m_facade->moveBlock(pos, *moveTo);
-        if (m_random.randf() < m_immediateUpwardPropagateProbability) {
-          processing.add(pos + Vec2I(0, 1));
-          processing.add(pos + Vec2I(-1, 1));
-          processing.add(pos + Vec2I(1, 1));
+    m_random.shuffle(columns);
+
+    for (auto& column : columns) {
+      int x = column.first;
+      auto& ys = column.second;
+
+      if (m_processingBudget && processed >= *m_processingBudget) {
+        m_pending[x].addAll(ys);
+        continue;
+      }
+      processed += ys.size();
+
+      sort(ys);
+      m_facade->beginColumn(RectI(x - 1, ys.first() - 1, x + 2, ys.last() + 1));
+
+      for (int y : ys) {
+        Vec2I pos(x, y);
+        Vec2I belowPos = pos + Vec2I(0, -1);
+        Vec2I belowLeftPos = pos + Vec2I(-1, -1);
+        Vec2I belowRightPos = pos + Vec2I(1, -1);
+
+        FallingBlockType thisBlock = m_facade->blockType(pos);
+        FallingBlockType belowBlock = m_facade->blockType(belowPos);
+
+        Maybe<Vec2I> moveTo;
+
+        if (thisBlock == FallingBlockType::Falling) {
+          if (belowBlock == FallingBlockType::Open)
+            moveTo = belowPos;
+        } else if (thisBlock == FallingBlockType::Cascading) {
+          if (belowBlock == FallingBlockType::Open) {
+            moveTo = belowPos;
+          } else {
+            FallingBlockType belowLeftBlock = m_facade->blockType(belowLeftPos);
+            FallingBlockType belowRightBlock = m_facade->blockType(belowRightPos);
+
+            if (belowLeftBlock == FallingBlockType::Open && belowRightBlock == FallingBlockType::Open)
+              moveTo = m_random.randb() ? belowLeftPos : belowRightPos;
+            else if (belowLeftBlock == FallingBlockType::Open)
+              moveTo = belowLeftPos;
+            else if (belowRightBlock == FallingBlockType::Open)
+              moveTo = belowRightPos;
+          }
         }
 
-        visitLocation(pos);
-        visitLocation(*moveTo);
+        if (moveTo) {
+          m_facade->moveBlock(pos, *moveTo);
+          if (m_random.randf() < m_immediateUpwardPropagateProbability) {
+            processing[x - 1].add(y + 1);
+            processing[x].add(y + 1);
+            processing[x + 1].add(y + 1);
+          }
+
+          visitLocation(pos);
+          visitLocation(*moveTo);
+        }
       }
+
+      m_facade->endColumn();
     }
   }
 }
@@ -73,8 +95,9 @@ void FallingBlocksAgent::visitLocation(Vec2I const& location) {
 
 void FallingBlocksAgent::visitRegion(RectI const& region) {
   for (int x = region.xMin() - 1; x <= region.xMax(); ++x) {
-    for (int y = region.yMin(); y <= region.yMax(); ++y) 
-      m_pending.add({x, y});
+    auto& column = m_pending[x];
+    for (int y = region.yMin(); y <= region.yMax(); ++y)
+      column.add(y);
   }
 }
 
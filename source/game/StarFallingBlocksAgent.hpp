@@ -6,6 +6,7 @@
 #include "StarRandom.hpp"
 #include "StarGameTypes.hpp"
 #include "StarWorldTiles.hpp"
+#include "StarRect.hpp"
 
 namespace Star {
 
@@ -26,21 +27,36 @@ public:
 
   virtual FallingBlockType blockType(Vec2I const& pos) = 0;
   virtual void moveBlock(Vec2I const& from, Vec2I const& to) = 0;
+
+  // Blocks are examined and moved a column at a time, and every position
+  // read or written while a column is processed lies within the region given
+  // here, so the facade can prepare it once rather than for each block.
+  virtual void beginColumn(RectI const& region);
+  virtual void endColumn();
 };
 
 class FallingBlocksAgent {
 public:
   FallingBlocksAgent(FallingBlocksFacadePtr worldFacade);
 
+  // Limits how many positions are examined per update, any past the budget
+  // are examined on the following updates so that large collapses are spread
+  // out.  Unlimited by default.
+  void setProcessingBudget(Maybe<size_t> processingBudget);
+
   void update();
 
   void visitLocation(Vec2I const& location);
   void visitRegion(RectI const& region);
 
 private:
+  // Positions to examine, by column
+  typedef HashMap<int, HashSet<int>> ColumnPositions;
+
   FallingBlocksFacadePtr m_facade;
   float m_immediateUpwardPropagateProbability;
-  HashSet<Vec2I> m_pending;
+  Maybe<size_t> m_processingBudget;
+  ColumnPositions m_pending;
   RandomSource m_random;
 };
 
@@ -288,6 +288,7 @@ Humanoid::Humanoid() {
 
   m_primaryHand.angle = 0;
   m_animationTimer = m_emoteAnimationTimer = m_danceTimer = 0.0f;
+  m_renderVersion = 0;
 }
 
 Humanoid::Humanoid(Json const& config) : Humanoid() {
@@ -306,6 +307,7 @@ Humanoid::Humanoid(HumanoidIdentity const& identity, JsonObject parameters, Json
 
 void Humanoid::setIdentity(HumanoidIdentity const& identity) {
   m_identity = identity;
+  ++m_renderVersion;
   m_headFrameset = getHeadFromIdentity();
   m_bodyFrameset = getBodyFromIdentity();
   m_emoteFrameset = getFacialEmotesFromIdentity();
@@ -366,6 +368,8 @@ bool Humanoid::loadConfig(Json merger, bool forceRefresh) {
   if (m_mergeConfig == merger && !forceRefresh)
     return false;
 
+  ++m_renderVersion;
+
   auto config = jsonMerge(m_baseConfig, merger);
   m_timing = HumanoidTiming(config.getObject("humanoidTiming"));
 
@@ -650,6 +654,8 @@ void Humanoid::refreshWearables(Fashion& fashion) {
   if (!wornHeadsChanged && !wornChestsLegsChanged && !wornBacksChanged && !helmetMasksChanged)
     return;
 
+  ++m_renderVersion;
+
   if (wornHeadsChanged)
     fashion.wornHeads.fill(0);
   if (wornChestsLegsChanged)
@@ -770,6 +776,8 @@ String const& Humanoid::backArmorFrameset() const {
 };
 
 void Humanoid::setBodyHidden(bool hidden) {
+  if (m_bodyHidden != hidden)
+    ++m_renderVersion;
   m_bodyHidden = hidden;
 }
 
@@ -884,10 +892,16 @@ void Humanoid::setHandFrameOverrides(ToolHand hand, StringView back, StringView
   Directives frontDirectives = frontEnd == NPos ? Directives() : Directives(front.utf8().substr(frontEnd));
   if ( backEnd != NPos)  back =  back.utf8().substr(0,  backEnd);
   if (frontEnd != NPos) front = front.utf8().substr(0, frontEnd);
-  handInfo. backFrame = ! back.empty() ? std::move( back) : "rotation";
-  handInfo.frontFrame = !front.empty() ? std::move(front) : "rotation";
-  handInfo. backDirectives = ! backDirectives.empty() ? std::move( backDirectives) : Directives();
-  handInfo.frontDirectives = !frontDirectives.empty() ? std::move(frontDirectives) : Directives();
+  if ( back.empty())  back = "rotation";
+  if (front.empty()) front = "rotation";
+  if (handInfo.backFrame == back.utf8() && handInfo.frontFrame == front.utf8()
+      && handInfo.backDirectives.hash() == backDirectives.hash() && handInfo.frontDirectives.hash() == frontDirectives.hash())
+    return;
+  handInfo. backFrame =  back;
+  handInfo.frontFrame = front;
+  handInfo. backDirectives = std::move( backDirectives);
+  handInfo.frontDirectives = std::move(frontDirectives);
+  ++m_renderVersion;
 }
 
 void Humanoid::setHandDrawables(ToolHand hand, List<Drawable> drawables) {
@@ -939,11 +953,14 @@ List<Drawable> Humanoid::render(bool withItems, bool withRotationAndScale) {
   float bobYOffset = getBobYOffset();
   Maybe<DancePtr> dance = getDance();
   Maybe<DanceStep> danceStep = {};
+  int danceStepIndex = -1;
   if (dance.isValid()) {
-    if (!(*dance)->states.contains(StateNames.getRight(m_state)))
+    if (!(*dance)->states.contains(StateNames.getRight(m_state))) {
       dance = {};
-    else
-      danceStep = (*dance)->steps[m_timing.danceSeq(m_danceTimer, *dance)];
+    } else {
+      danceStepIndex = m_timing.danceSeq(m_danceTimer, *dance);
+      danceStep = (*dance)->steps[danceStepIndex];
+    }
   }
 
   auto frontHand = (m_facingDirection == Direction::Left || m_twoHanded) ? m_primaryHand : m_altHand;
@@ -1084,6 +1101,39 @@ List<Drawable> Humanoid::render(bool withItems, bool withRotationAndScale) {
     drawables.appendAll(animatorDrawables);
     Drawable::rebaseAll(drawables);
   } else {
+    // Held item drawables are handed over fresh every frame, so only cache
+    // the composition when there are none to draw.
+    bool cacheable = !withItems
+        || (m_primaryHand.itemDrawables.empty() && m_primaryHand.nonRotatedDrawables.empty()
+            && m_altHand.itemDrawables.empty() && m_altHand.nonRotatedDrawables.empty());
+    RenderCacheKey cacheKey;
+    if (cacheable) {
+      cacheKey.version = m_renderVersion;
+      cacheKey.withItems = withItems;
+      cacheKey.withRotationAndScale = withRotationAndScale;
+      cacheKey.state = m_state;
+      cacheKey.emoteState = m_emoteState;
+      cacheKey.facingDirection = m_facingDirection;
+      cacheKey.movingBackwards = m_movingBackwards;
+      cacheKey.twoHanded = m_twoHanded;
+      cacheKey.bodyStateSeq = bodyStateSeq;
+      cacheKey.armStateSeq = armStateSeq;
+      cacheKey.emoteStateSeq = emoteStateSeq;
+      cacheKey.danceStep = danceStepIndex;
+      cacheKey.vaporTrailFrame = m_drawVaporTrail ? m_timing.genericSeq(m_animationTimer, m_vaporTrailCycle, m_vaporTrailFrames, true) : -1;
+      cacheKey.bobYOffset = bobYOffset;
+      cacheKey.headRotation = m_headRotation;
+      cacheKey.rotation = m_rotation;
+      cacheKey.scale = m_scale;
+      cacheKey.holdingItem = {m_primaryHand.holdingItem, m_altHand.holdingItem};
+      cacheKey.recoil = {m_primaryHand.recoil, m_altHand.recoil};
+      cacheKey.outsideOfHand = {m_primaryHand.outsideOfHand, m_altHand.outsideOfHand};
+      cacheKey.angle = {m_primaryHand.angle, m_altHand.angle};
+      cacheKey.itemAngle = {m_primaryHand.itemAngle, m_altHand.itemAngle};
+      if (m_renderCache && m_renderCache->first == cacheKey)
+        return m_renderCache->second;
+    }
+
     auto addDrawable = [&](Drawable drawable, bool forceFullbright = false) -> Drawable& {
       if (m_facingDirection == Direction::Left)
         drawable.scale(Vec2F(-1, 1));
@@ -1457,6 +1507,11 @@ List<Drawable> Humanoid::render(bool withItems, bool withRotationAndScale) {
       }
       drawable.rebase();
     }
+
+    if (cacheable)
+      m_renderCache = make_pair(cacheKey, drawables);
+    else
+      m_renderCache.reset();
   }
 
   return drawables;
@@ -1525,6 +1580,10 @@ List<Drawable> Humanoid::renderPortrait(PortraitMode mode) const {
     Drawable::scaleAll(drawables, TilePixels);
   } else {
     int emoteStateSeq = m_timing.emoteStateSeq(m_emoteAnimationTimer, m_emoteState);
+    if (auto cached = m_portraitCache.ptr(mode)) {
+      if (get<0>(*cached) == m_renderVersion && get<1>(*cached) == m_emoteState && get<2>(*cached) == emoteStateSeq)
+        return get<3>(*cached);
+    }
 
     auto addDrawable = [&](Drawable&& drawable) -> Drawable& {
       if (mode != PortraitMode::Full && mode != PortraitMode::FullNeutral
@@ -1687,6 +1746,8 @@ List<Drawable> Humanoid::renderPortrait(PortraitMode mode) const {
         }
       }
     }
+
+    m_portraitCache[mode] = make_tuple(m_renderVersion, m_emoteState, emoteStateSeq, drawables);
   }
 
   return drawables;
@@ -1917,6 +1978,16 @@ Vec2F Humanoid::altHandOffset(Direction facingDirection) const {
     return m_frontHandPosition - m_frontArmRotationCenter;
 }
 
+bool Humanoid::RenderCacheKey::operator==(RenderCacheKey const& rhs) const {
+  return tie(version, withItems, withRotationAndScale, state, emoteState, facingDirection, movingBackwards, twoHanded,
+             bodyStateSeq, armStateSeq, emoteStateSeq, danceStep, vaporTrailFrame, bobYOffset, headRotation, rotation,
+             scale, holdingItem, recoil, outsideOfHand, angle, itemAngle)
+      == tie(rhs.version, rhs.withItems, rhs.withRotationAndScale, rhs.state, rhs.emoteState, rhs.facingDirection,
+             rhs.movingBackwards, rhs.twoHanded, rhs.bodyStateSeq, rhs.armStateSeq, rhs.emoteStateSeq, rhs.danceStep,
+             rhs.vaporTrailFrame, rhs.bobYOffset, rhs.headRotation, rhs.rotation, rhs.scale, rhs.holdingItem, rhs.recoil,
+             rhs.outsideOfHand, rhs.angle, rhs.itemAngle);
+}
+
 Humanoid::HandDrawingInfo const& Humanoid::getHand(ToolHand hand) const {
   return hand == ToolHand::Primary ? m_primaryHand : m_altHand;
 }
@@ -340,6 +340,36 @@ private:
     bool outsideOfHand = false;
   };
 
+  // Everything the non-animator render path reads per frame.  Appearance
+  // (identity, config, wearables, frame overrides) is covered by version,
+  // which is bumped whenever one of those changes.
+  struct RenderCacheKey {
+    uint64_t version;
+    bool withItems;
+    bool withRotationAndScale;
+    State state;
+    HumanoidEmote emoteState;
+    Direction facingDirection;
+    bool movingBackwards;
+    bool twoHanded;
+    int bodyStateSeq;
+    int armStateSeq;
+    int emoteStateSeq;
+    int danceStep;
+    int vaporTrailFrame;
+    float bobYOffset;
+    float headRotation;
+    float rotation;
+    Vec2F scale;
+    Array<bool, 2> holdingItem;
+    Array<bool, 2> recoil;
+    Array<bool, 2> outsideOfHand;
+    Array<float, 2> angle;
+    Array<float, 2> itemAngle;
+
+    bool operator==(RenderCacheKey const& rhs) const;
+  };
+
   HandDrawingInfo const& getHand(ToolHand hand) const;
 
   void wearableRemoved(Wearable const& wearable);
@@ -440,6 +470,12 @@ private:
   HumanoidIdentity m_identity;
   HumanoidTiming m_timing;
 
+  uint64_t m_renderVersion;
+  Maybe<pair<RenderCacheKey, List<Drawable>>> m_renderCache;
+  // Keyed by portrait mode; holds the appearance version and emote frame the
+  // portrait was composed for.
+  mutable HashMap<PortraitMode, tuple<uint64_t, HumanoidEmote, int, List<Drawable>>> m_portraitCache;
+
   float m_animationTimer;
   float m_emoteAnimationTimer;
   float m_danceTimer;
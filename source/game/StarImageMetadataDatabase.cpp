@@ -7,9 +7,24 @@
 #include "StarGameTypes.hpp"
 #include "StarRoot.hpp"
 #include "StarAssets.hpp"
+#include "StarPackedAssetSource.hpp"
+#include "StarCasting.hpp"
 
 namespace Star {
 
+// Metadata prebaked into the packed file the image comes from, which only
+// applies while no patches or other sources change the image.
+static Maybe<PackedAssetSource::ImageMetadata> prebakedImageMetadata(AssetPath const& path) {
+  if (path.subPath || !path.directives.empty())
+    return {};
+  auto descriptor = Root::singleton().assets()->assetDescriptor(path.basePath);
+  if (!descriptor || !descriptor->patchSources.empty())
+    return {};
+  if (auto packedSource = as<PackedAssetSource>(descriptor->source))
+    return packedSource->imageMetadata(descriptor->sourceName);
+  return {};
+}
+
 ImageMetadataDatabase::ImageMetadataDatabase() {
   MutexLocker locker(m_mutex);
   int timeSmear = 2000;
@@ -110,12 +125,16 @@ RectU ImageMetadataDatabase::nonEmptyRegion(AssetPath const& path) const {
   }
 
   locker.unlock();
-  auto image = Root::singleton().assets()->image(filteredPath);
   RectU region = RectU::null();
-  image->forEachPixel([&region](unsigned x, unsigned y, Vec4B const& pixel) {
-    if (pixel[3] > 0)
-      region.combine(RectU::withSize({x, y}, {1, 1}));
-  });
+  if (auto metadata = prebakedImageMetadata(filteredPath)) {
+    region = metadata->nonEmptyRegion;
+  } else {
+    auto image = Root::singleton().assets()->image(filteredPath);
+    image->forEachPixel([&region](unsigned x, unsigned y, Vec4B const& pixel) {
+      if (pixel[3] > 0)
+        region.combine(RectU::withSize({x, y}, {1, 1}));
+    });
+  }
 
   locker.lock();
   m_regionCache.set(path, region);
@@ -189,11 +208,15 @@ Vec2U ImageMetadataDatabase::calculateImageSize(AssetPath const& path) const {
       imageSize = *size;
     } else {
       locker.unlock();
-      auto file = assets->openFile(path.basePath);
-      if (Image::isPng(file))
-        imageSize = get<0>(Image::readPngMetadata(file));
-      else
-        imageSize = fallback();
+      if (auto metadata = prebakedImageMetadata(AssetPath(path.basePath))) {
+        imageSize = metadata->size;
+      } else {
+        auto file = assets->openFile(path.basePath);
+        if (Image::isPng(file))
+          imageSize = get<0>(Image::readPngMetadata(file));
+        else
+          imageSize = fallback();
+      }
       locker.lock();
       m_sizeCache.set(path.basePath, imageSize);
     }
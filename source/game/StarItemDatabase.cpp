@@ -103,7 +103,7 @@ HashSet<ItemRecipe> ItemDatabase::recipesFromSubset(HashMap<ItemDescriptor, uint
   HashSet<ItemRecipe> res;
   for (auto const& recipe : subset) {
     // is it the right kind of recipe for this check ?
-    if (recipe.groups.hasIntersection(allowedTypes) || allowedTypes.empty() || recipe.groups.empty()) {
+    if (recipeAllowed(recipe, allowedTypes)) {
       // do we have the ingredients to make it.
       if (canMakeRecipe(recipe, normalizedBag, availableCurrencies)) {
         res.add(recipe);
@@ -114,6 +114,10 @@ HashSet<ItemRecipe> ItemDatabase::recipesFromSubset(HashMap<ItemDescriptor, uint
   return res;
 }
 
+bool ItemDatabase::recipeAllowed(ItemRecipe const& recipe, StringSet const& allowedTypes) {
+  return recipe.groups.hasIntersection(allowedTypes) || allowedTypes.empty() || recipe.groups.empty();
+}
+
 String ItemDatabase::guiFilterString(ItemPtr const& item) {
   return (item->name() + item->friendlyName() + item->description()).toLower().splitAny(" ,.?*\\+/|\t").join("");
 }
@@ -134,21 +138,28 @@ bool ItemDatabase::canMakeRecipe(ItemRecipe const& recipe, HashMap<ItemDescripto
 }
 
 ItemDatabase::ItemDatabase()
-  : m_luaRoot(make_shared<LuaRoot>()), m_rebuilder(make_shared<Rebuilder>("item")) {
+  : m_luaRoot(make_shared<LuaRoot>()), m_rebuilder(make_shared<Rebuilder>("item")), m_recordConfigLoads(false) {
   scanItems();
   addObjectItems();
   addCodexes();
   scanRecipes();
   addBlueprints();
+  indexRecipes();
 }
 
 void ItemDatabase::cleanup() {
-  {
-    MutexLocker locker(m_cacheMutex);
-    m_itemCache.cleanup([](ItemCacheEntry const&, ItemPtr const& item) {
+  m_itemCache.cleanup([](ItemCacheEntry const&, ItemPtr const& item) {
       return !item.unique();
     });
-  }
+  m_itemPrototypes.cleanup();
+}
+
+CacheStatistics ItemDatabase::itemCacheStatistics() const {
+  return m_itemCache.statistics();
+}
+
+CacheStatistics ItemDatabase::itemPrototypeCacheStatistics() const {
+  return m_itemPrototypes.statistics();
 }
 
 ItemPtr ItemDatabase::diskLoad(Json const& diskStore) const {
@@ -196,6 +207,11 @@ StringSet ItemDatabase::itemTags(String const& itemName) const {
 ItemDatabase::ItemConfig ItemDatabase::itemConfig(String const& itemName, Json parameters, Maybe<float> level, Maybe<uint64_t> seed) const {
   auto const& data = itemData(itemName);
 
+  if (m_recordConfigLoads) {
+    MutexLocker locker(m_cacheMutex);
+    m_recordedConfigLoads.add(itemName);
+  }
+
   ItemConfig itemConfig;
   if (data.assetsConfig)
     itemConfig.config = Root::singleton().assets()->json(*data.assetsConfig);
@@ -215,6 +231,15 @@ ItemDatabase::ItemConfig ItemDatabase::itemConfig(String const& itemName, Json p
   return itemConfig;
 }
 
+void ItemDatabase::setRecordConfigLoads(bool recordConfigLoads) const {
+  m_recordConfigLoads = recordConfigLoads;
+}
+
+StringList ItemDatabase::recordedConfigLoads() const {
+  MutexLocker locker(m_cacheMutex);
+  return m_recordedConfigLoads.values();
+}
+
 Maybe<String> ItemDatabase::itemFile(String const& itemName) const {
   if (!hasItem(itemName)) {
     return {};
@@ -228,25 +253,34 @@ ItemPtr ItemDatabase::itemShared(ItemDescriptor descriptor, Maybe<float> level,
     return {};
 
   ItemCacheEntry entry{ descriptor, level, seed };
-  MutexLocker locker(m_cacheMutex);
-  if (ItemPtr* cached = m_itemCache.ptr(entry))
+  if (auto cached = m_itemCache.value(entry))
     return *cached;
-  else {
-    locker.unlock();
-
-    ItemPtr item = tryCreateItem(descriptor, level, seed);
-    get<2>(entry) = item->parameters().optUInt("seed"); // Seed could've been changed by the buildscript
 
-    locker.lock();
-    return m_itemCache.get(entry, [&](ItemCacheEntry const&) -> ItemPtr { return std::move(item); });
-  }
+  ItemPtr item = tryCreateItem(descriptor, level, seed);
+  get<2>(entry) = item->parameters().optUInt("seed"); // Seed could've been changed by the buildscript
+  return m_itemCache.insert(entry, std::move(item));
 }
 
 ItemPtr ItemDatabase::item(ItemDescriptor descriptor, Maybe<float> level, Maybe<uint64_t> seed, bool ignoreInvalid) const {
   if (!descriptor)
     return {};
-  else
-    return tryCreateItem(descriptor, level, seed, ignoreInvalid);
+
+  // Level and seed are only given to builder scripts, and built items are
+  // never prototypes, so prototypes are shared by every level and seed
+  ItemDescriptor singular = descriptor.singular();
+  if (auto prototype = m_itemPrototypes.value(singular)) {
+    ItemPtr item = (*prototype)->clone();
+    item->setCount(descriptor.count());
+    return item;
+  }
+
+  ItemPtr item = tryCreateItem(descriptor, level, seed, ignoreInvalid);
+  // Built items may come out differently each time, and items that had to be
+  // rebuilt or replaced no longer match their descriptor, so neither can be
+  // shared.
+  if (!item->config().contains("builder") && item->name() == descriptor.name() && item->parameters() == descriptor.parameters())
+    m_itemPrototypes.insert(singular, item->clone());
+  return item;
 }
 
 bool ItemDatabase::hasRecipeToMake(ItemDescriptor const& item) const {
@@ -281,7 +315,12 @@ HashSet<ItemRecipe> ItemDatabase::recipesFromBagContents(List<ItemPtr> const& ba
 }
 
 HashSet<ItemRecipe> ItemDatabase::recipesFromBagContents(HashMap<ItemDescriptor, uint64_t> const& bag, StringMap<uint64_t> const& availableCurrencies) const {
-  return recipesFromSubset(bag, availableCurrencies, m_recipes);
+  HashSet<ItemRecipe> res;
+  forEachRecipeFromBag(bag, [&](ItemRecipe const& recipe) {
+      if (canMakeRecipe(recipe, bag, availableCurrencies))
+        res.add(recipe);
+    });
+  return res;
 }
 
 HashSet<ItemRecipe> ItemDatabase::recipesFromBagContents(List<ItemPtr> const& bag, StringMap<uint64_t> const& availableCurrencies, StringSet const& allowedTypes) const {
@@ -290,7 +329,12 @@ HashSet<ItemRecipe> ItemDatabase::recipesFromBagContents(List<ItemPtr> const& ba
 }
 
 HashSet<ItemRecipe> ItemDatabase::recipesFromBagContents(HashMap<ItemDescriptor, uint64_t> const& bag, StringMap<uint64_t> const& availableCurrencies, StringSet const& allowedTypes) const {
-  return recipesFromSubset(bag, availableCurrencies, m_recipes, allowedTypes);
+  HashSet<ItemRecipe> res;
+  forEachRecipeFromBag(bag, [&](ItemRecipe const& recipe) {
+      if (recipeAllowed(recipe, allowedTypes) && canMakeRecipe(recipe, bag, availableCurrencies))
+        res.add(recipe);
+    });
+  return res;
 }
 
 uint64_t ItemDatabase::maxCraftableInBag(List<ItemPtr> const& bag, StringMap<uint64_t> const& availableCurrencies, ItemRecipe const& recipe) const {
@@ -695,6 +739,34 @@ void ItemDatabase::scanRecipes() {
   }
 }
 
+void ItemDatabase::indexRecipes() {
+  for (auto const& recipe : m_recipes) {
+    auto firstIngredient = recipe.inputs.filtered([](ItemDescriptor const& input) { return input.count() > 0; }).maybeFirst();
+    if (firstIngredient)
+      m_recipesByFirstIngredient[firstIngredient->name()].append(&recipe);
+    else
+      m_recipesWithoutIngredients.append(&recipe);
+  }
+}
+
+template <typename Function>
+void ItemDatabase::forEachRecipeFromBag(HashMap<ItemDescriptor, uint64_t> const& bag, Function&& function) const {
+  for (auto recipe : m_recipesWithoutIngredients)
+    function(*recipe);
+
+  // A recipe can only be made if the bag has some of the first item it needs,
+  // so only the recipes of items in the bag are visited.  Every item in a
+  // normalized bag is counted under its name without parameters.
+  for (auto const& pair : bag) {
+    if (pair.second == 0 || !pair.first.parameters().toObject().empty())
+      continue;
+    if (auto recipes = m_recipesByFirstIngredient.ptr(pair.first.name())) {
+      for (auto recipe : *recipes)
+        function(*recipe);
+    }
+  }
+}
+
 void ItemDatabase::addBlueprints() {
   auto assets = Root::singleton().assets();
 
@@ -4,7 +4,7 @@
 #include "StarItemRecipe.hpp"
 #include "StarItem.hpp"
 #include "StarCasting.hpp"
-#include "StarTtlCache.hpp"
+#include "StarShardedTtlCache.hpp"
 
 namespace Star {
 
@@ -71,11 +71,16 @@ public:
   static bool canMakeRecipe(ItemRecipe const& recipe, HashMap<ItemDescriptor, uint64_t> const& availableIngredients, StringMap<uint64_t> const& availableCurrencies);
   static HashSet<ItemRecipe> recipesFromSubset(HashMap<ItemDescriptor, uint64_t> const& normalizedBag, StringMap<uint64_t> const& availableCurrencies, HashSet<ItemRecipe> const& subset);
   static HashSet<ItemRecipe> recipesFromSubset(HashMap<ItemDescriptor, uint64_t> const& normalizedBag, StringMap<uint64_t> const& availableCurrencies, HashSet<ItemRecipe> const& subset, StringSet const& allowedTypes);
+  // Whether the recipe is of a kind allowed by the given types, which allow
+  // every recipe if empty
+  static bool recipeAllowed(ItemRecipe const& recipe, StringSet const& allowedTypes);
   static String guiFilterString(ItemPtr const& item);
 
   ItemDatabase();
 
   void cleanup();
+  CacheStatistics itemCacheStatistics() const;
+  CacheStatistics itemPrototypeCacheStatistics() const;
 
   // Load an item based on item descriptor.  If loadItem is called with a
   // live ptr, and the ptr matches the descriptor read, then no new item is
@@ -110,6 +115,11 @@ public:
   // of the unique item data or may be ignored.
   ItemConfig itemConfig(String const& itemName, Json parameters, Maybe<float> level = {}, Maybe<uint64_t> seed = {}) const;
 
+  // While enabled, remembers every item that an item config is generated
+  // for, so that a later run can run their builder scripts up front.
+  void setRecordConfigLoads(bool recordConfigLoads) const;
+  StringList recordedConfigLoads() const;
+
   // Returns the path to the item's json file in the assets.
   Maybe<String> itemFile(String const& itemName) const;
 
@@ -119,7 +129,9 @@ public:
   // ItemDescriptor, it will return a null pointer.
   // The returned item pointer will be shared. Either call ->clone() or use item() instead for a copy.
   ItemPtr itemShared(ItemDescriptor descriptor, Maybe<float> level = {}, Maybe<uint64_t> seed = {}) const;
-  // Same as itemShared, but makes a copy instead. Does not cache.
+  // Same as itemShared, but makes a copy instead.  Items that are not built by
+  // a script are copied from a cached prototype, so identical items share
+  // their config and parameters rather than each loading their own.
   ItemPtr item(ItemDescriptor descriptor, Maybe<float> level = {}, Maybe<uint64_t> seed = {}, bool ignoreInvalid = false) const;
 
 
@@ -176,9 +188,19 @@ private:
   void scanRecipes();
   void addBlueprints();
   void addCodexes();
+  void indexRecipes();
+
+  // Calls the function with every recipe that could be made from the bag,
+  // skipping those that need an item the bag has none of
+  template <typename Function>
+  void forEachRecipeFromBag(HashMap<ItemDescriptor, uint64_t> const& bag, Function&& function) const;
 
   StringMap<ItemData> m_items;
   HashSet<ItemRecipe> m_recipes;
+  // Recipes by the name of the first item they need, and the recipes that
+  // need no items.  Points into m_recipes, which does not change once loaded.
+  StringMap<List<ItemRecipe const*>> m_recipesByFirstIngredient;
+  List<ItemRecipe const*> m_recipesWithoutIngredients;
 
   mutable RecursiveMutex m_luaMutex;
   LuaRootPtr m_luaRoot;
@@ -186,8 +208,14 @@ private:
 
   typedef tuple<ItemDescriptor, Maybe<float>, Maybe<uint64_t>> ItemCacheEntry;
 
+  // Guards m_recordedConfigLoads
   mutable Mutex m_cacheMutex;
-  mutable HashTtlCache<ItemCacheEntry, ItemPtr> m_itemCache;
+  mutable ShardedTtlCache<ItemCacheEntry, ItemPtr> m_itemCache;
+  // Never handed out, keyed by singular descriptors and only cloned from
+  mutable ShardedTtlCache<ItemDescriptor, ItemConstPtr> m_itemPrototypes;
+
+  mutable atomic<bool> m_recordConfigLoads;
+  mutable StringSet m_recordedConfigLoads;
 };
 
 template <typename ItemT>
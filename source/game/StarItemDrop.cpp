@@ -237,28 +237,15 @@ void ItemDrop::update(float dt, uint64_t) {
     if (m_owningEntity.get() != NullEntityId) {
       updateTaken(true);
     } else {
-      // Rarely, check for other drops near us and combine with them if possible.
+      // Rarely, check for other drops near us and combine with them if
+      // possible.  Combining touches the other drop, so it is done as a world
+      // action rather than from within this update.
       if (canTake() && m_mode.get() == Mode::Available && Random::randf() < m_combineChance) {
-        world()->findEntity(RectF::withCenter(position(), Vec2F::filled(m_combineRadius)), [&](EntityPtr const& entity) {
-            if (auto closeDrop = as<ItemDrop>(entity)) {
-              // Make sure not to try to merge with ourselves here.
-              if (closeDrop.get() != this && closeDrop->canTake()
-                  && vmag(position() - closeDrop->position()) < m_combineRadius
-                  && closeDrop->isMaster()) {
-                if (m_item->couldStack(closeDrop->item()) == closeDrop->item()->count()) {
-                  m_item->stackWith(closeDrop->take());
-                  m_dropAge.setElapsedTime(min(m_dropAge.elapsedTime(), closeDrop->m_dropAge.elapsedTime()));
-
-                  // Average the position and velocity of the drop we merged
-                  // with
-                  m_movementController.setPosition(m_movementController.position()
-                      + world()->geometry().diff(closeDrop->position(), m_movementController.position()) / 2.0f);
-                  m_movementController.setVelocity((m_movementController.velocity() + closeDrop->velocity()) / 2.0f);
-                  return true;
-                }
-              }
+        world()->timer(0.0f, [entityId = entityId()](World* world) {
+            if (auto itemDrop = as<ItemDrop>(world->entity(entityId))) {
+              if (itemDrop->canTake() && itemDrop->m_mode.get() == Mode::Available)
+                itemDrop->combineWithNearbyDrop();
             }
-            return false;
           });
       }
 
@@ -508,6 +495,36 @@ void ItemDrop::updateCollisionPoly() {
 }
 
 
+bool ItemDrop::independentUpdate() const {
+  // Without scripts, an item drop only moves against tile collision and reads
+  // the position of the entity taking it.
+  return !m_scriptComponent.initialized();
+}
+
+void ItemDrop::combineWithNearbyDrop() {
+  world()->findEntity(RectF::withCenter(position(), Vec2F::filled(m_combineRadius)), [&](EntityPtr const& entity) {
+      if (auto closeDrop = as<ItemDrop>(entity)) {
+        // Make sure not to try to merge with ourselves here.
+        if (closeDrop.get() != this && closeDrop->canTake()
+            && vmag(position() - closeDrop->position()) < m_combineRadius
+            && closeDrop->isMaster()) {
+          if (m_item->couldStack(closeDrop->item()) == closeDrop->item()->count()) {
+            m_item->stackWith(closeDrop->take());
+            m_dropAge.setElapsedTime(min(m_dropAge.elapsedTime(), closeDrop->m_dropAge.elapsedTime()));
+
+            // Average the position and velocity of the drop we merged
+            // with
+            m_movementController.setPosition(m_movementController.position()
+                + world()->geometry().diff(closeDrop->position(), m_movementController.position()) / 2.0f);
+            m_movementController.setVelocity((m_movementController.velocity() + closeDrop->velocity()) / 2.0f);
+            return true;
+          }
+        }
+      }
+      return false;
+    });
+}
+
 void ItemDrop::updateTaken(bool master) {
   if (auto owningEntity = world()->entity(m_owningEntity.get())) {
     Vec2F position = m_movementController.position();
@@ -56,6 +56,7 @@ public:
   RectF collisionArea() const override;
 
   void update(float dt, uint64_t currentStep) override;
+  bool independentUpdate() const override;
 
   bool shouldDestroy() const override;
 
@@ -104,6 +105,9 @@ private:
   void updateCollisionPoly();
 
   void updateTaken(bool master);
+
+  // Merges this drop with a nearby compatible drop, if there is one.
+  void combineWithNearbyDrop();
   
   LuaCallbacks makeItemDropCallbacks();
 
@@ -27,6 +27,8 @@ LiquidsDatabase::LiquidsDatabase() {
   m_liquidEngineParameters.minimumLivenLevelChange = liquidEngineParameters.getFloat("minimumLivenLevelChange");
   m_liquidEngineParameters.minimumLiquidLevel = liquidEngineParameters.getFloat("minimumLiquidLevel");
   m_liquidEngineParameters.interactTransformationLevel = liquidEngineParameters.getFloat("interactTransformationLevel");
+  m_liquidEngineParameters.equilibriumChangeThreshold = liquidEngineParameters.getFloat("equilibriumChangeThreshold", 0.0f);
+  m_liquidEngineParameters.equilibriumTicks = liquidEngineParameters.getUInt("equilibriumTicks", 0);
 
   m_backgroundDrain = config.getFloat("backgroundDrain");
 
@@ -143,10 +143,13 @@ MonsterDatabase::MonsterDatabase() : m_rebuilder(make_shared<Rebuilder>("monster
 }
 
 void MonsterDatabase::cleanup() {
-  MutexLocker locker(m_cacheMutex);
   m_monsterCache.cleanup();
 }
 
+CacheStatistics MonsterDatabase::monsterCacheStatistics() const {
+  return m_monsterCache.statistics();
+}
+
 StringList MonsterDatabase::monsterTypes() const {
   return m_monsterTypes.keys();
 }
@@ -167,7 +170,6 @@ MonsterVariant MonsterDatabase::randomMonster(String const& typeName, Json const
 }
 
 MonsterVariant MonsterDatabase::monsterVariant(String const& typeName, uint64_t seed, Json const& uniqueParameters) const {
-  MutexLocker locker(m_cacheMutex);
   return m_monsterCache.get(make_tuple(typeName, seed, uniqueParameters), [this](tuple<String, uint64_t, Json> const& key) {
       return produceMonster(get<0>(key), get<1>(key), get<2>(key));
     });
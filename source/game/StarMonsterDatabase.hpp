@@ -2,7 +2,7 @@
 
 #include "StarNetworkedAnimator.hpp"
 #include "StarActorMovementController.hpp"
-#include "StarTtlCache.hpp"
+#include "StarShardedTtlCache.hpp"
 #include "StarDamageTypes.hpp"
 #include "StarStatusTypes.hpp"
 #include "StarImageProcessing.hpp"
@@ -92,6 +92,7 @@ public:
   MonsterDatabase();
 
   void cleanup();
+  CacheStatistics monsterCacheStatistics() const;
 
   StringList monsterTypes() const;
 
@@ -195,12 +196,10 @@ private:
   StringMap<MonsterSkill> m_skills;
   StringMap<List<ColorReplaceMap>> m_colorSwaps;
 
-  mutable Mutex m_cacheMutex;
-
   RebuilderPtr m_rebuilder;
 
   // Key here is the type name, seed, and the serialized unique parameters JSON
-  mutable HashTtlCache<tuple<String, uint64_t, Json>, MonsterVariant> m_monsterCache;
+  mutable ShardedTtlCache<tuple<String, uint64_t, Json>, MonsterVariant> m_monsterCache;
 };
 
 }
@@ -8,6 +8,11 @@
 
 namespace Star {
 
+// Seconds over which a slave's position eases back to where a net update put
+// it, and the largest difference in tiles eased rather than jumped.
+float const NetPositionCorrectionTime = 0.1f;
+float const NetMaxPositionCorrection = 2.0f;
+
 MovementParameters MovementParameters::sensibleDefaults() {
   return MovementParameters(Root::singleton().assets()->json("/default_movement.config").toObject());
 }
@@ -189,6 +194,13 @@ MovementController::MovementController(MovementParameters const& parameters) {
   m_xRelativeSurfaceMovingCollisionPosition.setInterpolator(lerp<float, float>);
   m_yRelativeSurfaceMovingCollisionPosition.setInterpolator(lerp<float, float>);
 
+  // Remote controllers are carried along by their velocity between updates,
+  // and drift back to where updates put them rather than snapping there.
+  m_xPosition.setExtrapolationRate(&m_xVelocity);
+  m_yPosition.setExtrapolationRate(&m_yVelocity);
+  m_xPosition.setCorrectionSmoothing(NetPositionCorrectionTime, NetMaxPositionCorrection);
+  m_yPosition.setCorrectionSmoothing(NetPositionCorrectionTime, NetMaxPositionCorrection);
+
   addNetElement(&m_collisionPoly);
   addNetElement(&m_mass);
   addNetElement(&m_xPosition);
@@ -461,6 +473,7 @@ void MovementController::approachYVelocity(float targetYVelocity, float maxContr
 
 void MovementController::init(World* world) {
   m_world = world;
+  m_restCollisionGeneration.reset();
   setPosition(position());
   updatePositionInterpolators();
 }
@@ -500,7 +513,7 @@ void MovementController::tickMaster(float dt) {
 
   if (m_resting) {
     m_restTicks -= 1;
-    if (m_restTicks < 0) {
+    if (m_restTicks < 0 && !keepSleeping()) {
       m_resting = false;
     }
   }
@@ -667,6 +680,16 @@ void MovementController::tickMaster(float dt) {
       abs(originalMovement[1] + m_collisionCorrection[1]) < 0.0001) {
     m_resting = true;
     m_restTicks = m_parameters.restDuration.value(0);
+
+    // Bodies with a rest duration fall asleep at the end of it, until the
+    // collision around them changes
+    if (m_restTicks > 0) {
+      m_restRegion = RectI::integral(collisionBody().boundBox().padded(*m_parameters.maximumCorrection + 1));
+      m_restCollisionGeneration = world()->collisionGeneration(m_restRegion);
+      m_restLiquidPercentage = m_liquidPercentage;
+    } else {
+      m_restCollisionGeneration.reset();
+    }
   }
 
   if (*m_parameters.frictionEnabled) {
@@ -801,6 +824,21 @@ void MovementController::updateForceRegions(float) {
   handleForceRegions(world()->forceRegions());
 }
 
+bool MovementController::keepSleeping() {
+  if (!m_restCollisionGeneration || m_appliedForceRegion || m_liquidPercentage != m_restLiquidPercentage)
+    return false;
+
+  if (world()->collisionGeneration(m_restRegion) != *m_restCollisionGeneration)
+    return false;
+
+  for (auto const& physicsEntity : world()->query<PhysicsEntity>(RectF(m_restRegion))) {
+    if (physicsEntity->movingCollisionCount() > 0 && !m_ignorePhysicsEntities.contains(physicsEntity->entityId()))
+      return false;
+  }
+
+  return true;
+}
+
 void MovementController::updateLiquidPercentage() {
   auto pos = position();
   auto body = collisionBody();
@@ -1004,6 +1042,7 @@ MovementController::CollisionSeparation MovementController::collisionSeparate(Li
 
   PolyF::IntersectResult intersectResult;
   PolyF correctedPoly = poly;
+  PolyF::VertexList correctedNormals = poly.sideNormals();
   RectF correctedBoundBox = correctedPoly.boundBox();
   for (auto const& cp : collisionPolys) {
     if ((ignorePlatforms && cp.collisionKind == CollisionKind::Platform) || !correctedBoundBox.intersects(cp.polyBounds, false))
@@ -1014,7 +1053,7 @@ MovementController::CollisionSeparation MovementController::collisionSeparate(Li
     else if (cp.collisionKind == CollisionKind::Platform)
       intersectResult = correctedPoly.directionalSatIntersection(cp.poly, Vec2F(0, 1), true);
     else
-      intersectResult = correctedPoly.satIntersection(cp.poly);
+      intersectResult = correctedPoly.satIntersection(cp.poly, correctedNormals, cp.polyNormals);
 
     if (cp.collisionKind == CollisionKind::Platform && intersectResult.intersects) {
       if (intersectResult.overlap[1] <= 0 || intersectResult.overlap[1] > maximumPlatformCorrection)
@@ -1039,7 +1078,7 @@ MovementController::CollisionSeparation MovementController::collisionSeparate(Li
       if (cp.collisionKind == CollisionKind::Platform || !correctedBoundBox.intersects(cp.polyBounds, false))
         continue;
 
-      intersectResult = correctedPoly.satIntersection(cp.poly);
+      intersectResult = correctedPoly.satIntersection(cp.poly, correctedNormals, cp.polyNormals);
       if (intersectResult.intersects && intersectResult.overlap.magnitudeSquared() > separationToleranceSquared) {
         separation.collisionKind = maxOrNullCollision(separation.collisionKind, cp.collisionKind);
         separation.solutionFound = false;
@@ -1067,15 +1106,15 @@ void MovementController::updatePositionInterpolators() {
 }
 
 void MovementController::queryCollisions(RectF const& region) {
+  // Keep the vertex and normal buffers of previous collisions around to
+  // avoid reallocating them
   while (!m_workingCollisions.empty()) {
-    m_collisionBuffers.append(m_workingCollisions.takeLast().poly);
+    m_collisionBuffers.append(m_workingCollisions.takeLast());
   }
 
   auto newCollisionPoly = [this]() -> CollisionPoly& {
     if (!m_collisionBuffers.empty())
-      return m_workingCollisions.emplaceAppend(CollisionPoly{
-          m_collisionBuffers.takeLast(), {}, {}, {}, {}, {}
-        });
+      return m_workingCollisions.emplaceAppend(m_collisionBuffers.takeLast());
     else
       return m_workingCollisions.emplaceAppend(CollisionPoly{});
   };
@@ -1094,6 +1133,7 @@ void MovementController::queryCollisions(RectF const& region) {
           collisionPoly.poly = block.poly;
           collisionPoly.poly.translate(nearTranslation);
           collisionPoly.polyBounds = polyBounds;
+          collisionPoly.polyNormals = block.polyNormals;
           collisionPoly.sortPosition = centerOfTile(block.space);
           collisionPoly.movingCollisionId = {};
           collisionPoly.collisionKind = block.kind;
@@ -1105,6 +1145,7 @@ void MovementController::queryCollisions(RectF const& region) {
     CollisionPoly& collisionPoly = newCollisionPoly();
     collisionPoly.poly = std::move(poly);
     collisionPoly.polyBounds = bounds;
+    collisionPoly.polyNormals = collisionPoly.poly.sideNormals();
     collisionPoly.sortPosition = collisionPoly.poly.center();
     collisionPoly.movingCollisionId = id;
     collisionPoly.collisionKind = mc.collisionKind;
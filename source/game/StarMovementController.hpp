@@ -234,6 +234,7 @@ private:
   struct CollisionPoly {
     PolyF poly;
     RectF polyBounds;
+    PolyF::VertexList polyNormals;
     Vec2F sortPosition;
     Maybe<MovingCollisionId> movingCollisionId;
     CollisionKind collisionKind;
@@ -251,6 +252,10 @@ private:
 
   void queryCollisions(RectF const& region);
 
+  // Whether a body past its rest duration can stay at rest, nothing that
+  // could move it may have changed since it came to rest.
+  bool keepSleeping();
+
   float gravity();
 
   MovementParameters m_parameters;
@@ -290,10 +295,13 @@ private:
 
   bool m_resting;
   int m_restTicks;
+  RectI m_restRegion;
+  Maybe<uint64_t> m_restCollisionGeneration;
+  float m_restLiquidPercentage;
   float m_timeStep;
 
   List<CollisionPoly> m_workingCollisions;
-  List<PolyF> m_collisionBuffers;
+  List<CollisionPoly> m_collisionBuffers;
 };
 
 }
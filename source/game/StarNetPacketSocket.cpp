@@ -2,11 +2,52 @@
 #include "StarIterator.hpp"
 #include "StarCompression.hpp"
 #include "StarLogging.hpp"
+#include "StarVlqEncoding.hpp"
 
 namespace Star {
 
+// Appends the packet type and the signed vlq size (negative when compressed)
+// that precede packet data on the wire.
+static void appendPacketHeader(ByteArray& buffer, PacketType type, int64_t size) {
+  char header[11];
+  header[0] = (char)type;
+  size_t headerSize = 1 + writeVlqI(size, header + 1);
+  buffer.append(header, headerSize);
+}
+
+// Peers from this protocol version understand batched, fragmented and
+// sequenced P2P messages.
+static VersionNumber const P2PMessageFramingVersion = 21;
+
+// The first byte of every P2P message is either the packet type of the single
+// packet group it contains, or one of these markers, which no packet type
+// reaches.
+static uint8_t const P2PBatchMarker = 0xFF;
+static uint8_t const P2PFragmentMarker = 0xFE;
+static uint8_t const P2PSequencedMarker = 0xFD;
+
+// Room left in each message for the compression stream expanding
+// incompressible data.
+static size_t p2pMessageOverhead(size_t maxMessageSize) {
+  return maxMessageSize / 64 + 64;
+}
+
+bool packetIsSuperseded(Packet const& packet) {
+  // Entity deltas are normally relative to the last delta sent, so
+  // EntityUpdateSet can only be lost when it is relative to the last
+  // acknowledged snapshot instead.
+  if (packet.type() == PacketType::StepUpdate)
+    return true;
+  if (auto entityUpdateSet = as<EntityUpdateSetPacket>(&packet))
+    return entityUpdateSet->snapshot != 0;
+  return false;
+}
+
 PacketStatCollector::PacketStatCollector(float calculationWindow)
-  : m_calculationWindow(calculationWindow), m_stats(), m_totalBytes(0), m_lastMixTime(0) {}
+  : m_calculationWindow(calculationWindow), m_stats(), m_totalBytes(0), m_lastMixTime(0),
+    m_totalQueueLatency(0), m_worstQueueLatency(0), m_queueLatencyCount(0),
+    m_uncompressedBytes(0), m_compressedBytes(0), m_compressionTime(0),
+    m_messages(0), m_unreliableMessages(0) {}
 
 void PacketStatCollector::mix(size_t size) {
   calculate();
@@ -29,6 +70,33 @@ void PacketStatCollector::mix(HashMap<PacketType, size_t> const& sizes, bool add
   }
 }
 
+void PacketStatCollector::mixQueueLatency(float latency) {
+  calculate();
+  m_totalQueueLatency += latency;
+  m_worstQueueLatency = max(m_worstQueueLatency, latency);
+  ++m_queueLatencyCount;
+}
+
+void PacketStatCollector::setQueuedPackets(size_t queuedPackets) {
+  m_stats.queuedPackets = queuedPackets;
+}
+
+void PacketStatCollector::mixCompression(int level, size_t uncompressedSize, size_t compressedSize, float time) {
+  calculate();
+  m_stats.compressionLevel = level;
+  m_uncompressedBytes += uncompressedSize;
+  m_compressedBytes += compressedSize;
+  m_compressionTime += time;
+}
+
+void PacketStatCollector::mixMessage(size_t size, bool reliable) {
+  calculate();
+  m_totalBytes += size;
+  ++m_messages;
+  if (!reliable)
+    ++m_unreliableMessages;
+}
+
 PacketStats PacketStatCollector::stats() const {
   const_cast<PacketStatCollector*>(this)->calculate();
   return m_stats;
@@ -52,9 +120,34 @@ void PacketStatCollector::calculate() {
     m_stats.bytesPerSecond = round(float(m_totalBytes) / elapsedTime);
     m_totalBytes = 0;
     m_unmixed.clear();
+
+    m_stats.averageQueueLatency = m_queueLatencyCount ? m_totalQueueLatency / m_queueLatencyCount : 0.0f;
+    m_stats.worstQueueLatency = m_worstQueueLatency;
+    m_totalQueueLatency = 0;
+    m_worstQueueLatency = 0;
+    m_queueLatencyCount = 0;
+
+    m_stats.compressionRatio = m_uncompressedBytes ? (float)m_compressedBytes / m_uncompressedBytes : 0.0f;
+    m_stats.compressionTime = m_compressionTime / elapsedTime;
+    m_uncompressedBytes = 0;
+    m_compressedBytes = 0;
+    m_compressionTime = 0;
+
+    m_stats.messagesPerSecond = round(m_messages / elapsedTime);
+    m_stats.unreliableMessagesPerSecond = round(m_unreliableMessages / elapsedTime);
+    m_messages = 0;
+    m_unreliableMessages = 0;
   }
 }
 
+SocketPtr PacketSocket::pollSocket() const {
+  return {};
+}
+
+size_t PacketSocket::sentPacketsPendingSize() const {
+  return 0;
+}
+
 Maybe<PacketStats> PacketSocket::incomingStats() const {
   return {};
 }
@@ -65,9 +158,78 @@ Maybe<PacketStats> PacketSocket::outgoingStats() const {
 void PacketSocket::setNetRules(NetCompatibilityRules netRules) { m_netRules = netRules; }
 NetCompatibilityRules PacketSocket::netRules() const { return m_netRules; }
 
+AdaptiveCompressionConfig::AdaptiveCompressionConfig()
+  : AdaptiveCompressionConfig(JsonObject()) {}
+
+AdaptiveCompressionConfig::AdaptiveCompressionConfig(Json const& config) {
+  minLevel = config.getInt("minLevel", -5);
+  maxLevel = config.getInt("maxLevel", 9);
+  baseLevel = clamp<int>(config.getInt("baseLevel", 2), minLevel, maxLevel);
+  interval = config.getFloat("interval", 1.0f);
+  cpuBudget = config.getFloat("cpuBudget", 0.02f);
+  incompressibleRatio = config.getFloat("incompressibleRatio", 0.95f);
+}
+
 void CompressedPacketSocket::setCompressionStreamEnabled(bool enabled) { m_useCompressionStream = enabled; }
 bool CompressedPacketSocket::compressionStreamEnabled() const { return m_useCompressionStream; }
 
+void CompressedPacketSocket::setAdaptiveCompression(Maybe<AdaptiveCompressionConfig> config) {
+  m_adaptiveCompression = std::move(config);
+  if (m_adaptiveCompression)
+    m_compressionStream.setCompressionLevel(m_adaptiveCompression->baseLevel);
+  m_compressionWindowStart = Time::monotonicMilliseconds();
+}
+
+int CompressedPacketSocket::compressionLevel() const {
+  return m_compressionStream.compressionLevel();
+}
+
+void CompressedPacketSocket::compressStream(char const* data, size_t size, ByteArray& out, PacketStatCollector& stats, bool backlogged) {
+  int64_t startTime = Time::monotonicMicroseconds();
+  size_t startSize = out.size();
+  m_compressionStream.compress(data, size, out);
+  float time = (Time::monotonicMicroseconds() - startTime) / 1000000.0f;
+  size_t compressedSize = out.size() - startSize;
+  stats.mixCompression(m_compressionStream.compressionLevel(), size, compressedSize, time);
+
+  if (!m_adaptiveCompression)
+    return;
+
+  m_compressionWindowUncompressed += size;
+  m_compressionWindowCompressed += compressedSize;
+  m_compressionWindowTime += time;
+  ++m_compressionWindowSamples;
+  if (backlogged)
+    ++m_compressionWindowBacklogged;
+
+  int64_t currentTime = Time::monotonicMilliseconds();
+  float elapsed = (currentTime - m_compressionWindowStart) / 1000.0f;
+  auto const& config = *m_adaptiveCompression;
+  if (elapsed < config.interval)
+    return;
+
+  // A connection that keeps data waiting to be sent is limited by its link
+  // rather than by the time spent compressing for it.
+  int level = m_compressionStream.compressionLevel();
+  float ratio = m_compressionWindowUncompressed ? (float)m_compressionWindowCompressed / m_compressionWindowUncompressed : 0.0f;
+  if (ratio >= config.incompressibleRatio)
+    level = config.minLevel;
+  else if (m_compressionWindowTime / elapsed > config.cpuBudget)
+    --level;
+  else if (m_compressionWindowBacklogged * 2 > m_compressionWindowSamples)
+    ++level;
+  else if (level != config.baseLevel)
+    level += level < config.baseLevel ? 1 : -1;
+  m_compressionStream.setCompressionLevel(clamp(level, config.minLevel, config.maxLevel));
+
+  m_compressionWindowStart = currentTime;
+  m_compressionWindowUncompressed = 0;
+  m_compressionWindowCompressed = 0;
+  m_compressionWindowTime = 0;
+  m_compressionWindowSamples = 0;
+  m_compressionWindowBacklogged = 0;
+}
+
 pair<LocalPacketSocketUPtr, LocalPacketSocketUPtr> LocalPacketSocket::openPair() {
   auto lhsIncomingPipe = make_shared<Pipe>();
   auto rhsIncomingPipe = make_shared<Pipe>();
@@ -147,62 +309,60 @@ void TcpPacketSocket::close() {
 }
 
 void TcpPacketSocket::sendPackets(List<PacketPtr> packets) {
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  // Packets are written into a scratch buffer that keeps its capacity between
+  // calls, and from there appended once to the output buffer behind a header
+  // written in place, so that sending allocates nothing in the steady state.
   auto it = makeSMutableIterator(packets);
   if (compressionStreamEnabled()) {
-    DataStreamBuffer outBuffer;
     while (it.hasNext()) {
       PacketPtr& packet = it.next();
       auto packetType = packet->type();
-      DataStreamBuffer packetBuffer;
-      packetBuffer.setStreamCompatibilityVersion(netRules());
-      packet->write(packetBuffer, netRules());
-      outBuffer.write(packetType);
-      outBuffer.writeVlqI((int)packetBuffer.size());
-      outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
-      m_outgoingStats.mix(packetType, packetBuffer.size(), false);
+      m_packetBuffer.clear();
+      m_packetBuffer.setStreamCompatibilityVersion(netRules());
+      packet->writeCached(m_packetBuffer, netRules());
+      appendPacketHeader(m_outputBuffer, packetType, (int64_t)m_packetBuffer.size());
+      m_outputBuffer.append(m_packetBuffer.ptr(), m_packetBuffer.size());
+      m_outgoingStats.mix(packetType, m_packetBuffer.size(), false);
     }
-    m_outputBuffer.append(outBuffer.ptr(), outBuffer.size());
   } else {
     while (it.hasNext()) {
       PacketType currentType = it.peekNext()->type();
       PacketCompressionMode currentCompressionMode = it.peekNext()->compressionMode();
 
-      DataStreamBuffer packetBuffer;
-      packetBuffer.setStreamCompatibilityVersion(netRules());
+      m_packetBuffer.clear();
+      m_packetBuffer.setStreamCompatibilityVersion(netRules());
       while (it.hasNext()
              && it.peekNext()->type() == currentType
              && it.peekNext()->compressionMode() == currentCompressionMode) {
-          it.next()->write(packetBuffer, netRules());
+          it.next()->writeCached(m_packetBuffer, netRules());
       }
 
       // Packets must read and write actual data, because this is used to
       // determine packet count
-      starAssert(!packetBuffer.empty());
+      starAssert(!m_packetBuffer.empty());
 
-      ByteArray compressedPackets;
+      m_compressionBuffer.clear();
       bool mustCompress = currentCompressionMode == PacketCompressionMode::Enabled;
-      bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && packetBuffer.size() > 64;
+      bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && m_packetBuffer.size() > 64;
       if (mustCompress || perhapsCompress)
-        compressedPackets = compressData(packetBuffer.data());
-
-      DataStreamBuffer outBuffer;
-      outBuffer.write(currentType);
+        compressData(m_packetBuffer.data(), m_compressionBuffer);
 
-      if (!compressedPackets.empty() && (mustCompress || compressedPackets.size() < packetBuffer.size())) {
-        outBuffer.writeVlqI(-(int)(compressedPackets.size()));
-        outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
-        m_outgoingStats.mix(currentType, compressedPackets.size());
+      if (!m_compressionBuffer.empty() && (mustCompress || m_compressionBuffer.size() < m_packetBuffer.size())) {
+        appendPacketHeader(m_outputBuffer, currentType, -(int64_t)m_compressionBuffer.size());
+        m_outputBuffer.append(m_compressionBuffer);
+        m_outgoingStats.mix(currentType, m_compressionBuffer.size());
       } else {
-        outBuffer.writeVlqI((int)(packetBuffer.size()));
-        outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
-        m_outgoingStats.mix(currentType, packetBuffer.size());
+        appendPacketHeader(m_outputBuffer, currentType, (int64_t)m_packetBuffer.size());
+        m_outputBuffer.append(m_packetBuffer.ptr(), m_packetBuffer.size());
+        m_outgoingStats.mix(currentType, m_packetBuffer.size());
       }
-      m_outputBuffer.append(outBuffer.takeData());
     }
   }
 }
 
 List<PacketPtr> TcpPacketSocket::receivePackets() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   // How large can uncompressed packets be
   // this limit is now also used during decompression
   uint64_t const PacketSizeLimit = 64 << 20;
@@ -269,39 +429,52 @@ List<PacketPtr> TcpPacketSocket::receivePackets() {
 }
 
 bool TcpPacketSocket::sentPacketsPending() const {
-  return !m_outputBuffer.empty() || (compressionStreamEnabled() && !m_compressedOutputBuffer.empty());
+  return m_outputPosition < m_outputBuffer.size() || m_compressedOutputPosition < m_compressedOutputBuffer.size();
+}
+
+size_t TcpPacketSocket::sentPacketsPendingSize() const {
+  return (m_outputBuffer.size() - m_outputPosition) + (m_compressedOutputBuffer.size() - m_compressedOutputPosition);
 }
 
 bool TcpPacketSocket::writeData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   if (!isOpen())
     return false;
 
   bool dataSent = false;
   try {
-    if (!m_outputBuffer.empty() || !m_compressedOutputBuffer.empty()) {
-      if (compressionStreamEnabled()) {
-        if (!m_outputBuffer.empty()) {
-          m_compressionStream.compress(m_outputBuffer, m_compressedOutputBuffer);
-          m_outputBuffer.clear();
-        }
-        do {
-          size_t written = m_socket->send(m_compressedOutputBuffer.ptr(), m_compressedOutputBuffer.size());
-          if (written == 0)
-            break;
-          dataSent = true;
-          m_compressedOutputBuffer.trimLeft(written);
+    if (compressionStreamEnabled() && m_outputPosition < m_outputBuffer.size()) {
+      compressStream(m_outputBuffer.ptr() + m_outputPosition, m_outputBuffer.size() - m_outputPosition,
+          m_compressedOutputBuffer, m_outgoingStats, m_compressedOutputPosition < m_compressedOutputBuffer.size());
+      m_outputBuffer.clear();
+      m_outputPosition = 0;
+    }
+
+    // Written data is only skipped over rather than trimmed, the buffers are
+    // cleared (keeping their capacity) once fully written, and compacted if
+    // the written part grows past half of the buffer.
+    auto sendBuffer = [&](ByteArray& buffer, size_t& position, bool compressed) {
+      while (position < buffer.size()) {
+        size_t written = m_socket->send(buffer.ptr() + position, buffer.size() - position);
+        if (written == 0)
+          break;
+        dataSent = true;
+        position += written;
+        if (compressed)
           m_outgoingStats.mix(written);
-        } while (!m_compressedOutputBuffer.empty());
-      } else {
-        do {
-          size_t written = m_socket->send(m_outputBuffer.ptr(), m_outputBuffer.size());
-          if (written == 0)
-            break;
-          dataSent = true;
-          m_outputBuffer.trimLeft(written);
-        } while (!m_outputBuffer.empty());
       }
-    }
+      if (position == buffer.size()) {
+        buffer.clear();
+        position = 0;
+      } else if (position > buffer.size() / 2) {
+        buffer.trimLeft(position);
+        position = 0;
+      }
+    };
+
+    sendBuffer(m_compressedOutputBuffer, m_compressedOutputPosition, true);
+    if (!compressionStreamEnabled())
+      sendBuffer(m_outputBuffer, m_outputPosition, false);
   } catch (SocketClosedException const& e) {
     Logger::debug("TcpPacketSocket socket closed: {}", outputException(e, false));
   } catch (IOException const& e) {
@@ -312,6 +485,7 @@ bool TcpPacketSocket::writeData() {
 }
 
 bool TcpPacketSocket::readData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   bool dataReceived = false;
   try {
     char readBuffer[1024];
@@ -336,6 +510,10 @@ bool TcpPacketSocket::readData() {
   return dataReceived;
 }
 
+SocketPtr TcpPacketSocket::pollSocket() const {
+  return m_socket;
+}
+
 Maybe<PacketStats> TcpPacketSocket::incomingStats() const {
   return m_incomingStats.stats();
 }
@@ -344,7 +522,12 @@ Maybe<PacketStats> TcpPacketSocket::outgoingStats() const {
   return m_outgoingStats.stats();
 }
 
-TcpPacketSocket::TcpPacketSocket(TcpSocketPtr socket) : m_socket(std::move(socket)) {}
+HostAddressWithPort TcpPacketSocket::remoteAddress() const {
+  return m_socket->remoteAddress();
+}
+
+TcpPacketSocket::TcpPacketSocket(TcpSocketPtr socket)
+  : m_socket(std::move(socket)), m_outputPosition(0), m_compressedOutputPosition(0) {}
 
 P2PPacketSocketUPtr P2PPacketSocket::open(P2PSocketUPtr socket) {
   return P2PPacketSocketUPtr(new P2PPacketSocket(std::move(socket)));
@@ -359,87 +542,109 @@ void P2PPacketSocket::close() {
 }
 
 void P2PPacketSocket::sendPackets(List<PacketPtr> packets) {
-  auto it = makeSMutableIterator(packets);
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  if (!m_socket)
+    return;
 
-  if (compressionStreamEnabled()) {
-    DataStreamBuffer outBuffer;
-    while (it.hasNext()) {
-      PacketType currentType = it.peekNext()->type();
-      DataStreamBuffer packetBuffer;
-      packetBuffer.setStreamCompatibilityVersion(netRules());
-      while (it.hasNext() && it.peekNext()->type() == currentType)
-        it.next()->write(packetBuffer, netRules());
-      outBuffer.write(currentType);
-      outBuffer.write<bool>(false);
-      outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
-      m_outgoingStats.mix(currentType, packetBuffer.size(), false);
-      m_outputMessages.append(m_compressionStream.compress(outBuffer.takeData()));
+  bool framing = netRules().version() >= P2PMessageFramingVersion;
+  size_t maxReliableSize = framing ? m_socket->maxMessageSize(true) : 0;
+  size_t maxUnreliableSize = framing && !compressionStreamEnabled() ? m_socket->maxMessageSize(false) : 0;
+  if (maxReliableSize)
+    maxReliableSize -= p2pMessageOverhead(maxReliableSize);
+  if (maxUnreliableSize)
+    maxUnreliableSize -= p2pMessageOverhead(maxUnreliableSize);
+
+  // Packet groups waiting to be sent together in one reliable message
+  List<ByteArray> batch;
+  size_t batchSize = 1;
+  auto flushBatch = [&]() {
+    if (batch.size() == 1) {
+      queueMessage(std::move(batch.first()), true, maxReliableSize);
+    } else if (!batch.empty()) {
+      DataStreamBuffer batchBuffer;
+      batchBuffer.reserve(batchSize);
+      batchBuffer.write(P2PBatchMarker);
+      for (auto const& group : batch) {
+        batchBuffer.writeData(group.ptr(), 2);
+        batchBuffer.writeVlqU(group.size() - 2);
+        batchBuffer.writeData(group.ptr() + 2, group.size() - 2);
+      }
+      queueMessage(batchBuffer.takeData(), true, maxReliableSize);
     }
-  } else {
-    while (it.hasNext()) {
-      PacketType currentType = it.peekNext()->type();
-      PacketCompressionMode currentCompressionMode = it.peekNext()->compressionMode();
+    batch.clear();
+    batchSize = 1;
+  };
 
-      DataStreamBuffer packetBuffer;
-      packetBuffer.setStreamCompatibilityVersion(netRules());
-      while (it.hasNext()
-             && it.peekNext()->type() == currentType
-             && it.peekNext()->compressionMode() == currentCompressionMode) {
-          it.next()->write(packetBuffer, netRules());
-      }
+  auto it = makeSMutableIterator(packets);
+  while (it.hasNext()) {
+    PacketType currentType = it.peekNext()->type();
+    PacketCompressionMode currentCompressionMode = it.peekNext()->compressionMode();
+    bool currentSuperseded = packetIsSuperseded(*it.peekNext());
+
+    DataStreamBuffer packetBuffer;
+    packetBuffer.setStreamCompatibilityVersion(netRules());
+    while (it.hasNext()
+           && it.peekNext()->type() == currentType
+           && it.peekNext()->compressionMode() == currentCompressionMode
+           && packetIsSuperseded(*it.peekNext()) == currentSuperseded) {
+        it.next()->writeCached(packetBuffer, netRules());
+    }
 
-      // Packets must read and write actual data, because this is used to
-      // determine packet count
-      starAssert(!packetBuffer.empty());
+    // Packets must read and write actual data, because this is used to
+    // determine packet count
+    starAssert(!packetBuffer.empty());
 
-      ByteArray compressedPackets;
+    // Packet groups are compressed individually only when the whole
+    // connection is not.
+    ByteArray compressedPackets;
+    if (!compressionStreamEnabled()) {
       bool mustCompress = currentCompressionMode == PacketCompressionMode::Enabled;
       bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && packetBuffer.size() > 64;
       if (mustCompress || perhapsCompress)
         compressedPackets = compressData(packetBuffer.data());
+      if (!compressedPackets.empty() && !mustCompress && compressedPackets.size() >= packetBuffer.size())
+        compressedPackets.clear();
+    }
 
-      DataStreamBuffer outBuffer;
-      outBuffer.write(currentType);
+    DataStreamBuffer outBuffer;
+    outBuffer.write(currentType);
+    if (!compressedPackets.empty()) {
+      outBuffer.write<bool>(true);
+      outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
+      m_outgoingStats.mix(currentType, compressedPackets.size(), false);
+    } else {
+      outBuffer.write<bool>(false);
+      outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
+      m_outgoingStats.mix(currentType, packetBuffer.size(), false);
+    }
 
-      if (!compressedPackets.empty() && (mustCompress || compressedPackets.size() < packetBuffer.size())) {
-        outBuffer.write<bool>(true);
-        outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
-        m_outgoingStats.mix(currentType, compressedPackets.size());
-      } else {
-        outBuffer.write<bool>(false);
-        outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
-        m_outgoingStats.mix(currentType, packetBuffer.size());
-      }
-      m_outputMessages.append(outBuffer.takeData());
+    if (currentSuperseded && maxUnreliableSize && outBuffer.size() + 9 <= maxUnreliableSize) {
+      DataStreamBuffer sequencedBuffer;
+      sequencedBuffer.reserve(outBuffer.size() + 9);
+      sequencedBuffer.write(P2PSequencedMarker);
+      sequencedBuffer.write<uint64_t>(m_nextUnreliableSequence++);
+      sequencedBuffer.writeData(outBuffer.ptr(), outBuffer.size());
+      queueMessage(sequencedBuffer.takeData(), false, maxUnreliableSize);
+    } else if (maxReliableSize) {
+      // A group is framed with up to 9 more bytes for its size in a batch
+      size_t groupSize = outBuffer.size() + 9;
+      if (batchSize + groupSize > maxReliableSize)
+        flushBatch();
+      batch.append(outBuffer.takeData());
+      batchSize += groupSize;
+    } else {
+      queueMessage(outBuffer.takeData(), true, 0);
     }
   }
+  flushBatch();
 }
 
 List<PacketPtr> P2PPacketSocket::receivePackets() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   List<PacketPtr> packets;
   try {
-    for (auto& inputMessage : take(m_inputMessages)) {
-      DataStreamBuffer ds(std::move(inputMessage));
-
-      PacketType packetType = ds.read<PacketType>();
-      bool packetCompressed = ds.read<bool>();
-      size_t packetSize = ds.size() - ds.pos();
-
-      ByteArray packetBytes = ds.readBytes(packetSize);
-      if (packetCompressed)
-        packetBytes = uncompressData(packetBytes);
-
-      m_incomingStats.mix(packetType, packetSize, !compressionStreamEnabled());
-
-      DataStreamExternalBuffer packetStream(packetBytes);
-      packetStream.setStreamCompatibilityVersion(netRules());
-      do {
-        PacketPtr packet = createPacket(packetType);
-        packet->setCompressionMode(packetCompressed ? PacketCompressionMode::Enabled : PacketCompressionMode::Disabled);
-        packet->read(packetStream, netRules());
-        packets.append(std::move(packet));
-      } while (!packetStream.atEnd());
-    }
+    for (auto& inputMessage : take(m_inputMessages))
+      readMessage(inputMessage.ptr(), inputMessage.size(), packets);
   } catch (IOException const& e) {
     Logger::warn("I/O error in P2PPacketSocket::receivePackets, closing: {}", outputException(e, false));
     m_socket.reset();
@@ -451,14 +656,23 @@ bool P2PPacketSocket::sentPacketsPending() const {
   return !m_outputMessages.empty();
 }
 
+size_t P2PPacketSocket::sentPacketsPendingSize() const {
+  size_t size = 0;
+  for (auto const& message : m_outputMessages)
+    size += message.data.size();
+  return size;
+}
+
 bool P2PPacketSocket::writeData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   bool workDone = false;
 
   if (m_socket) {
     try {
       while (!m_outputMessages.empty()) {
-        if (m_socket->sendMessage(m_outputMessages.first())) {
-          m_outgoingStats.mix(m_outputMessages.first().size());
+        auto const& message = m_outputMessages.first();
+        if (m_socket->sendMessage(message.data, message.reliable)) {
+          m_outgoingStats.mixMessage(message.data.size(), message.reliable);
           m_outputMessages.removeFirst();
           workDone = true;
         } else {
@@ -475,12 +689,13 @@ bool P2PPacketSocket::writeData() {
 }
 
 bool P2PPacketSocket::readData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
   bool workDone = false;
 
   if (m_socket) {
     try {
       while (auto message = m_socket->receiveMessage()) {
-        m_incomingStats.mix(message->size());
+        m_incomingStats.mixMessage(message->size(), true);
         m_inputMessages.append(compressionStreamEnabled()
           ? m_decompressionStream.decompress(*message)
           : *message);
@@ -504,6 +719,80 @@ Maybe<PacketStats> P2PPacketSocket::outgoingStats() const {
 }
 
 P2PPacketSocket::P2PPacketSocket(P2PSocketPtr socket)
-  : m_socket(std::move(socket)) {}
+  : m_socket(std::move(socket)), m_nextUnreliableSequence(0) {}
+
+void P2PPacketSocket::queueMessage(ByteArray message, bool reliable, size_t maxSize) {
+  auto queue = [&](char const* data, size_t size) {
+    ByteArray out;
+    if (compressionStreamEnabled())
+      compressStream(data, size, out, m_outgoingStats, !m_outputMessages.empty());
+    else
+      out.append(data, size);
+    m_outputMessages.append({std::move(out), reliable});
+  };
+
+  if (!maxSize || message.size() <= maxSize) {
+    queue(message.ptr(), message.size());
+    return;
+  }
+
+  size_t fragmentSize = maxSize - 2;
+  for (size_t pos = 0; pos < message.size(); pos += fragmentSize) {
+    size_t size = min(fragmentSize, message.size() - pos);
+    DataStreamBuffer fragment;
+    fragment.reserve(size + 2);
+    fragment.write(P2PFragmentMarker);
+    fragment.write<bool>(pos + size == message.size());
+    fragment.writeData(message.ptr() + pos, size);
+    queue(fragment.ptr(), fragment.size());
+  }
+}
+
+void P2PPacketSocket::readMessage(char const* data, size_t size, List<PacketPtr>& packets) {
+  DataStreamExternalBuffer ds(data, size);
+  uint8_t marker = ds.read<uint8_t>();
+  if (marker == P2PBatchMarker) {
+    while (!ds.atEnd()) {
+      PacketType packetType = ds.read<PacketType>();
+      bool packetCompressed = ds.read<bool>();
+      size_t packetSize = ds.readVlqU();
+      if (packetSize > ds.remaining())
+        throw IOException("P2P message batch is truncated");
+      readPacketGroup(packetType, packetCompressed, data + ds.pos(), packetSize, packets);
+      ds.seek(packetSize, IOSeek::Relative);
+    }
+  } else if (marker == P2PFragmentMarker) {
+    bool last = ds.read<bool>();
+    m_inputFragments.append(data + ds.pos(), ds.remaining());
+    if (last) {
+      ByteArray message = take(m_inputFragments);
+      readMessage(message.ptr(), message.size(), packets);
+    }
+  } else if (marker == P2PSequencedMarker) {
+    uint64_t sequence = ds.read<uint64_t>();
+    // Unreliable messages that arrive after a newer one are stale
+    if (m_lastUnreliableSequence && sequence <= *m_lastUnreliableSequence)
+      return;
+    m_lastUnreliableSequence = sequence;
+    readMessage(data + ds.pos(), ds.remaining(), packets);
+  } else {
+    bool packetCompressed = ds.read<bool>();
+    readPacketGroup((PacketType)marker, packetCompressed, data + ds.pos(), ds.remaining(), packets);
+  }
+}
+
+void P2PPacketSocket::readPacketGroup(PacketType type, bool compressed, char const* data, size_t size, List<PacketPtr>& packets) {
+  ByteArray packetBytes = compressed ? uncompressData(data, size) : ByteArray(data, size);
+  m_incomingStats.mix(type, size, false);
+
+  DataStreamExternalBuffer packetStream(packetBytes);
+  packetStream.setStreamCompatibilityVersion(netRules());
+  do {
+    PacketPtr packet = createPacket(type);
+    packet->setCompressionMode(compressed ? PacketCompressionMode::Enabled : PacketCompressionMode::Disabled);
+    packet->read(packetStream, netRules());
+    packets.append(std::move(packet));
+  } while (!packetStream.atEnd());
+}
 
 }
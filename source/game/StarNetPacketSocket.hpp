@@ -19,8 +19,29 @@ struct PacketStats {
   float bytesPerSecond;
   PacketType worstPacketType;
   size_t worstPacketSize;
+
+  // Only reported when outgoing packets are queued before being sent.
+  size_t queuedPackets = 0;
+  float averageQueueLatency = 0.0f;
+  float worstQueueLatency = 0.0f;
+
+  // Only reported when a compression stream is used.  The ratio is the
+  // compressed over the uncompressed size, and the time is the fraction of
+  // time spent compressing.
+  int compressionLevel = 0;
+  float compressionRatio = 0.0f;
+  float compressionTime = 0.0f;
+
+  // Only reported by sockets over transports that send discrete messages.
+  float messagesPerSecond = 0.0f;
+  float unreliableMessagesPerSecond = 0.0f;
 };
 
+// Whether a packet only ever carries the latest state of something, so that
+// a lost one is made up for by the next of its type and it may be sent
+// unreliably.
+bool packetIsSuperseded(Packet const& packet);
+
 // Collects PacketStats over a given window of time.
 class PacketStatCollector {
 public:
@@ -30,6 +51,17 @@ public:
   void mix(PacketType type, size_t size, bool addToTotal = true);
   void mix(HashMap<PacketType, size_t> const& sizes, bool addToTotal = true);
 
+  // Records how many seconds a packet waited in a queue before being sent.
+  void mixQueueLatency(float latency);
+  void setQueuedPackets(size_t queuedPackets);
+
+  // Records data passed through a compression stream at the given level, and
+  // the seconds spent compressing it.
+  void mixCompression(int level, size_t uncompressedSize, size_t compressedSize, float time);
+
+  // Records a message sent or received over a message based transport.
+  void mixMessage(size_t size, bool reliable);
+
   // Should always return packet statistics for the most recent completed
   // window of time
   PacketStats stats() const;
@@ -42,6 +74,14 @@ private:
   Map<PacketType, float> m_unmixed;
   size_t m_totalBytes;
   int64_t m_lastMixTime;
+  float m_totalQueueLatency;
+  float m_worstQueueLatency;
+  size_t m_queueLatencyCount;
+  size_t m_uncompressedBytes;
+  size_t m_compressedBytes;
+  float m_compressionTime;
+  size_t m_messages;
+  size_t m_unreliableMessages;
 };
 
 // Interface for bidirectional communication using NetPackets, based around a
@@ -63,6 +103,9 @@ public:
   // Returns true if any sent packets on the queue are still not completely
   // written.
   virtual bool sentPacketsPending() const = 0;
+  // How many bytes of sent packets are still not written, if known.  Default
+  // returns 0.
+  virtual size_t sentPacketsPendingSize() const;
 
   // Write all data possible without blocking, returns true if any data was
   // actually written.
@@ -71,6 +114,11 @@ public:
   // actually received.
   virtual bool readData() = 0;
 
+  // The socket whose readiness (see SocketPoller) tells when readData or
+  // writeData can make progress, if there is one.  Sockets that return null
+  // must be polled by calling readData / writeData.  Default returns null.
+  virtual SocketPtr pollSocket() const;
+
   // Should return incoming / outgoing packet stats, if they are tracked.
   // Default implementations return nothing.
   virtual Maybe<PacketStats> incomingStats() const;
@@ -83,15 +131,57 @@ private:
   NetCompatibilityRules m_netRules;
 };
 
+// Bounds for a CompressedPacketSocket to adapt its compression stream level
+// within.  Levels are zstd levels, negative levels trade ratio for speed.
+struct AdaptiveCompressionConfig {
+  AdaptiveCompressionConfig();
+  AdaptiveCompressionConfig(Json const& config);
+
+  int minLevel;
+  int maxLevel;
+  // Level the connection is brought back to while neither of the limits
+  // below applies.
+  int baseLevel;
+  // Seconds between level adjustments
+  float interval;
+  // Fraction of time a connection may spend compressing before its level is
+  // lowered.
+  float cpuBudget;
+  // Compressed over uncompressed size from which data is considered
+  // incompressible and sent at the minimum level.
+  float incompressibleRatio;
+};
+
 class CompressedPacketSocket : public PacketSocket {
 public:
   virtual ~CompressedPacketSocket() = default;
 
   virtual void setCompressionStreamEnabled(bool enabled);
   virtual bool compressionStreamEnabled() const;
+
+  // When set, the compression stream level is raised while sent data backs
+  // up in the socket, and lowered when compressing takes more than the CPU
+  // budget or the data does not compress.  Otherwise the level is fixed.
+  void setAdaptiveCompression(Maybe<AdaptiveCompressionConfig> config);
+  int compressionLevel() const;
+
 private:
   bool m_useCompressionStream = false;
+
+  Maybe<AdaptiveCompressionConfig> m_adaptiveCompression;
+  int64_t m_compressionWindowStart = 0;
+  size_t m_compressionWindowUncompressed = 0;
+  size_t m_compressionWindowCompressed = 0;
+  float m_compressionWindowTime = 0.0f;
+  unsigned m_compressionWindowSamples = 0;
+  unsigned m_compressionWindowBacklogged = 0;
+
 protected:
+  // Appends the data to out through the compression stream, recording it in
+  // the given stats.  backlogged should be true if previously compressed data
+  // is still waiting to be sent.
+  void compressStream(char const* data, size_t size, ByteArray& out, PacketStatCollector& stats, bool backlogged);
+
   CompressionStream m_compressionStream;
   DecompressionStream m_decompressionStream;
 };
@@ -138,12 +228,17 @@ public:
   List<PacketPtr> receivePackets() override;
 
   bool sentPacketsPending() const override;
+  size_t sentPacketsPendingSize() const override;
 
   bool writeData() override;
   bool readData() override;
 
+  SocketPtr pollSocket() const override;
+
   Maybe<PacketStats> incomingStats() const override;
   Maybe<PacketStats> outgoingStats() const override;
+
+  HostAddressWithPort remoteAddress() const;
 private:
   TcpPacketSocket(TcpSocketPtr socket);
 
@@ -152,11 +247,23 @@ private:
   PacketStatCollector m_incomingStats;
   PacketStatCollector m_outgoingStats;
   ByteArray m_outputBuffer;
+  size_t m_outputPosition;
   ByteArray m_inputBuffer;
   ByteArray m_compressedOutputBuffer;
+  size_t m_compressedOutputPosition;
+
+  // Scratch space reused by every sendPackets call
+  DataStreamBuffer m_packetBuffer;
+  ByteArray m_compressionBuffer;
 };
 
-// Wraps a P2PSocket into a PacketSocket
+// Wraps a P2PSocket into a PacketSocket.  Peers that support it are sent as
+// few messages as the transport's message size allows: small packet groups
+// are batched into one message, groups too large for a message are split
+// into fragments, and without the compression stream, packets superseded by
+// the next of their type are sent unreliably.  Everything received is
+// understood regardless, so older peers are simply sent one packet group
+// per message.
 class P2PPacketSocket : public CompressedPacketSocket {
 public:
   static P2PPacketSocketUPtr open(P2PSocketUPtr socket);
@@ -168,6 +275,7 @@ public:
   List<PacketPtr> receivePackets() override;
 
   bool sentPacketsPending() const override;
+  size_t sentPacketsPendingSize() const override;
 
   bool writeData() override;
   bool readData() override;
@@ -176,14 +284,29 @@ public:
   Maybe<PacketStats> outgoingStats() const override;
 
 private:
+  struct OutputMessage {
+    ByteArray data;
+    bool reliable;
+  };
+
   P2PPacketSocket(P2PSocketPtr socket);
 
+  // Queues a message to be sent, through the compression stream if enabled,
+  // splitting it into fragments if it is larger than a non-zero maxSize.
+  void queueMessage(ByteArray message, bool reliable, size_t maxSize);
+  void readMessage(char const* data, size_t size, List<PacketPtr>& packets);
+  void readPacketGroup(PacketType type, bool compressed, char const* data, size_t size, List<PacketPtr>& packets);
+
   P2PSocketPtr m_socket;
 
   PacketStatCollector m_incomingStats;
   PacketStatCollector m_outgoingStats;
-  Deque<ByteArray> m_outputMessages;
+  Deque<OutputMessage> m_outputMessages;
   Deque<ByteArray> m_inputMessages;
+
+  uint64_t m_nextUnreliableSequence;
+  Maybe<uint64_t> m_lastUnreliableSequence;
+  ByteArray m_inputFragments;
 };
 
 }
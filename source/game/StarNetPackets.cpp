@@ -78,7 +78,11 @@ EnumMap<PacketType> const PacketTypeNames{
   {PacketType::SystemObjectSpawn, "SystemObjectSpawn"},
   // OpenStarbound packets
   {PacketType::ReplaceTileList, "ReplaceTileList"},
-  {PacketType::UpdateWorldTemplate, "UpdateWorldTemplate"}
+  {PacketType::UpdateWorldTemplate, "UpdateWorldTemplate"},
+  {PacketType::TileUpdateBatch, "TileUpdateBatch"},
+  {PacketType::EntityMessageBatch, "EntityMessageBatch"},
+  {PacketType::SessionAcknowledge, "SessionAcknowledge"},
+  {PacketType::SessionResume, "SessionResume"}
 };
 
 EnumMap<NetCompressionMode> const NetCompressionModeNames {
@@ -98,6 +102,36 @@ Json Packet::writeJson() const  { return JsonObject{}; }
 PacketCompressionMode Packet::compressionMode() const { return m_compressionMode; }
 void Packet::setCompressionMode(PacketCompressionMode compressionMode) { m_compressionMode = compressionMode; }
 
+struct Packet::SerializationCache {
+  Mutex mutex;
+  List<pair<NetCompatibilityRules, ByteArray>> serialized;
+};
+
+void Packet::setBroadcast() {
+  if (!m_serializationCache)
+    m_serializationCache = make_shared<SerializationCache>();
+}
+
+bool Packet::isBroadcast() const { return (bool)m_serializationCache; }
+
+void Packet::writeCached(DataStream& ds, NetCompatibilityRules netRules) const {
+  if (!m_serializationCache)
+    return write(ds, netRules);
+
+  // Broadcast packets are written from every connection's worker thread
+  MutexLocker locker(m_serializationCache->mutex);
+  for (auto const& p : m_serializationCache->serialized) {
+    if (p.first == netRules)
+      return ds.writeData(p.second.ptr(), p.second.size());
+  }
+
+  DataStreamBuffer buffer;
+  buffer.setStreamCompatibilityVersion(netRules);
+  write(buffer, netRules);
+  ds.writeData(buffer.ptr(), buffer.size());
+  m_serializationCache->serialized.append({netRules, buffer.takeData()});
+}
+
 PacketPtr createPacket(PacketType type) {
   switch (type) {
     case PacketType::ProtocolRequest: return make_shared<ProtocolRequestPacket>();
@@ -172,6 +206,10 @@ PacketPtr createPacket(PacketType type) {
     // OpenStarbound
     case PacketType::ReplaceTileList: return make_shared<ReplaceTileListPacket>();
     case PacketType::UpdateWorldTemplate: return make_shared<UpdateWorldTemplatePacket>();
+    case PacketType::TileUpdateBatch: return make_shared<TileUpdateBatchPacket>();
+    case PacketType::EntityMessageBatch: return make_shared<EntityMessageBatchPacket>();
+    case PacketType::SessionAcknowledge: return make_shared<SessionAcknowledgePacket>();
+    case PacketType::SessionResume: return make_shared<SessionResumePacket>();
     default:
       throw StarPacketException(strf("Unrecognized packet type {}", (unsigned int)type));
   }
@@ -303,11 +341,17 @@ CelestialResponsePacket::CelestialResponsePacket() {}
 CelestialResponsePacket::CelestialResponsePacket(List<CelestialResponse> responses) : responses(std::move(responses)) {}
 
 void CelestialResponsePacket::read(DataStream& ds) {
-  ds.read(responses);
+  if (ds.streamCompatibilityVersion() >= 20)
+    responses = readCompactCelestialResponses(ds);
+  else
+    ds.read(responses);
 }
 
 void CelestialResponsePacket::write(DataStream& ds) const {
-  ds.write(responses);
+  if (ds.streamCompatibilityVersion() >= 20)
+    writeCompactCelestialResponses(ds, responses);
+  else
+    ds.write(responses);
 }
 
 PlayerWarpResultPacket::PlayerWarpResultPacket() : warpActionInvalid(false) {}
@@ -538,7 +582,7 @@ void ClientContextUpdatePacket::write(DataStream& ds) const {
   ds.write(updateData);
 }
 
-WorldStartPacket::WorldStartPacket() : clientId(), localInterpolationMode() {}
+WorldStartPacket::WorldStartPacket() : clientId(), localInterpolationMode(), firstEntitySnapshot() {}
 
 void WorldStartPacket::read(DataStream& ds) {
   ds.read(templateData);
@@ -553,6 +597,8 @@ void WorldStartPacket::read(DataStream& ds) {
   ds.read(protectedDungeonIds);
   ds.read(clientId);
   ds.read(localInterpolationMode);
+  if (ds.streamCompatibilityVersion() >= 18)
+    ds.vuread(firstEntitySnapshot);
 }
 
 void WorldStartPacket::write(DataStream& ds) const {
@@ -568,6 +614,8 @@ void WorldStartPacket::write(DataStream& ds) const {
   ds.write(protectedDungeonIds);
   ds.write(clientId);
   ds.write(localInterpolationMode);
+  if (ds.streamCompatibilityVersion() >= 18)
+    ds.vuwrite(firstEntitySnapshot);
 }
 
 WorldStopPacket::WorldStopPacket() {}
@@ -628,9 +676,26 @@ void TileArrayUpdatePacket::read(DataStream& ds) {
   ds.vuread(width);
   ds.vuread(height);
   array.resize(width, height);
-  for (size_t y = 0; y < height; ++y) {
-    for (size_t x = 0; x < width; ++x)
-      ds.read(array(x, y));
+
+  if (ds.streamCompatibilityVersion() >= 15) {
+    List<NetTile> palette;
+    ds.readContainer(palette);
+
+    size_t i = 0;
+    size_t count = width * height;
+    while (i < count) {
+      NetTile const& tile = palette.at(ds.readVlqU());
+      size_t runEnd = i + ds.readVlqU();
+      if (runEnd > count)
+        throw StarPacketException("TileArrayUpdatePacket run exceeds array size");
+      for (; i < runEnd; ++i)
+        array(i % width, i / width) = tile;
+    }
+  } else {
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < width; ++x)
+        ds.read(array(x, y));
+    }
   }
 }
 
@@ -639,9 +704,36 @@ void TileArrayUpdatePacket::write(DataStream& ds) const {
   ds.viwrite(min[1]);
   ds.vuwrite(array.size(0));
   ds.vuwrite(array.size(1));
-  for (size_t y = 0; y < array.size(1); ++y) {
-    for (size_t x = 0; x < array.size(0); ++x)
-      ds.write(array(x, y));
+
+  if (ds.streamCompatibilityVersion() >= 15) {
+    HashMap<NetTile, size_t> paletteIndexes;
+    List<NetTile> palette;
+    List<pair<size_t, size_t>> runs;
+    for (size_t y = 0; y < array.size(1); ++y) {
+      for (size_t x = 0; x < array.size(0); ++x) {
+        NetTile const& tile = array(x, y);
+        if (!runs.empty() && palette[runs.last().first] == tile) {
+          ++runs.last().second;
+          continue;
+        }
+
+        auto insertResult = paletteIndexes.insert(tile, palette.size());
+        if (insertResult.second)
+          palette.append(tile);
+        runs.append({insertResult.first->second, 1});
+      }
+    }
+
+    ds.writeContainer(palette);
+    for (auto const& run : runs) {
+      ds.writeVlqU(run.first);
+      ds.writeVlqU(run.second);
+    }
+  } else {
+    for (size_t y = 0; y < array.size(1); ++y) {
+      for (size_t x = 0; x < array.size(0); ++x)
+        ds.write(array(x, y));
+    }
   }
 }
 
@@ -882,6 +974,7 @@ void EntityInteractResultPacket::write(DataStream& ds) const {
 
 EntityCreatePacket::EntityCreatePacket() {
   entityId = NullEntityId;
+  netVersion = 0;
 }
 
 ServerDisconnectPacket::ServerDisconnectPacket() {}
@@ -988,14 +1081,16 @@ void PingPacket::write(DataStream& ds, NetCompatibilityRules netRules) const {
   }
 }
 
-EntityCreatePacket::EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId)
-  : entityType(entityType), storeData(std::move(storeData)), firstNetState(std::move(firstNetState)), entityId(entityId) {}
+EntityCreatePacket::EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId, uint64_t netVersion)
+  : entityType(entityType), storeData(std::move(storeData)), firstNetState(std::move(firstNetState)), entityId(entityId), netVersion(netVersion) {}
 
 void EntityCreatePacket::read(DataStream& ds) {
   ds.read(entityType);
   ds.read(storeData);
   ds.read(firstNetState);
   ds.viread(entityId);
+  if (ds.streamCompatibilityVersion() >= 18)
+    ds.vuread(netVersion);
 }
 
 void EntityCreatePacket::write(DataStream& ds) const {
@@ -1003,25 +1098,71 @@ void EntityCreatePacket::write(DataStream& ds) const {
   ds.write(storeData);
   ds.write(firstNetState);
   ds.viwrite(entityId);
+  if (ds.streamCompatibilityVersion() >= 18)
+    ds.vuwrite(netVersion);
 }
 
-EntityUpdateSetPacket::EntityUpdateSetPacket(ConnectionId forConnection) : forConnection(forConnection) {}
+EntityUpdateSetPacket::EntityUpdateSetPacket(ConnectionId forConnection)
+  : forConnection(forConnection), snapshot(0), updateCount(0) {}
 
 void EntityUpdateSetPacket::read(DataStream& ds) {
   ds.vuread(forConnection);
   ds.readMapContainer(deltas,
-      [](DataStream& ds, EntityId& entityId, ByteArray& delta) {
+      [](DataStream& ds, EntityId& entityId, ByteArrayConstPtr& delta) {
         ds.viread(entityId);
-        ds.read(delta);
+        delta = make_shared<ByteArray const>(ds.read<ByteArray>());
       });
+  if (ds.streamCompatibilityVersion() >= 18) {
+    ds.vuread(snapshot);
+    if (snapshot != 0) {
+      ds.readMapContainer(netVersions, [](DataStream& ds, EntityId& entityId, uint64_t& netVersion) {
+          ds.viread(entityId);
+          ds.vuread(netVersion);
+        });
+    }
+  }
+  if (ds.streamCompatibilityVersion() >= 19) {
+    ds.vuread(updateCount);
+    ds.readMapContainer(updateIntervals, [](DataStream& ds, EntityId& entityId, unsigned& interval) {
+        ds.viread(entityId);
+        ds.vuread(interval);
+      });
+  }
 }
 
 void EntityUpdateSetPacket::write(DataStream& ds) const {
   ds.vuwrite(forConnection);
-  ds.writeMapContainer(deltas, [](DataStream& ds, EntityId const& entityId, ByteArray const& delta) {
+  ds.writeMapContainer(deltas, [](DataStream& ds, EntityId const& entityId, ByteArrayConstPtr const& delta) {
       ds.viwrite(entityId);
-      ds.write(delta);
+      ds.write(*delta);
     });
+  if (ds.streamCompatibilityVersion() >= 18) {
+    ds.vuwrite(snapshot);
+    if (snapshot != 0) {
+      ds.writeMapContainer(netVersions, [](DataStream& ds, EntityId const& entityId, uint64_t const& netVersion) {
+          ds.viwrite(entityId);
+          ds.vuwrite(netVersion);
+        });
+    }
+  }
+  if (ds.streamCompatibilityVersion() >= 19) {
+    ds.vuwrite(updateCount);
+    ds.writeMapContainer(updateIntervals, [](DataStream& ds, EntityId const& entityId, unsigned const& interval) {
+        ds.viwrite(entityId);
+        ds.vuwrite(interval);
+      });
+  }
+}
+
+ByteArray EntityUpdateSetPacket::delta(EntityId entityId) const {
+  if (auto delta = deltas.value(entityId))
+    return *delta;
+  return {};
+}
+
+bool EntityUpdateSetPacket::deferred(EntityId entityId) const {
+  unsigned interval = updateIntervals.value(entityId, 1);
+  return interval > 1 && (updateCount + entityId) % interval != 0;
 }
 
 EntityDestroyPacket::EntityDestroyPacket() {
@@ -1322,6 +1463,11 @@ void StepUpdatePacket::read(DataStream& ds, NetCompatibilityRules netRules) {
   } else {
     ds.read(remoteTime);
   }
+  if (netRules.version() >= 18) {
+    acknowledgedSnapshots.resize(ds.readVlqU());
+    for (auto& snapshot : acknowledgedSnapshots)
+      snapshot = ds.readVlqU();
+  }
 }
 
 void StepUpdatePacket::write(DataStream& ds, NetCompatibilityRules netRules) const {
@@ -1330,6 +1476,11 @@ void StepUpdatePacket::write(DataStream& ds, NetCompatibilityRules netRules) con
   } else {
     ds.write(remoteTime);
   }
+  if (netRules.version() >= 18) {
+    ds.writeVlqU(acknowledgedSnapshots.size());
+    for (auto snapshot : acknowledgedSnapshots)
+      ds.writeVlqU(snapshot);
+  }
 }
 
 SystemWorldStartPacket::SystemWorldStartPacket() {}
@@ -1445,4 +1596,225 @@ void UpdateWorldTemplatePacket::write(DataStream& ds) const {
   ds.write(templateData);
 }
 
+List<pair<Vec2I, size_t>> TileUpdateBatchPacket::positionRuns(List<Vec2I> positions) {
+  positions.sort([](Vec2I const& a, Vec2I const& b) {
+      return tie(a[1], a[0]) < tie(b[1], b[0]);
+    });
+
+  List<pair<Vec2I, size_t>> runs;
+  for (auto const& pos : positions) {
+    if (!runs.empty()) {
+      auto& run = runs.last();
+      if (run.first[1] == pos[1] && run.first[0] + (int)run.second == pos[0]) {
+        ++run.second;
+        continue;
+      }
+    }
+    runs.append({pos, 1});
+  }
+  return runs;
+}
+
+TileUpdateBatchPacket::TileUpdateBatchPacket() {}
+
+static Vec2I readPositionDelta(DataStream& ds, Vec2I& last) {
+  last[0] += ds.readVlqI();
+  last[1] += ds.readVlqI();
+  return last;
+}
+
+static void writePositionDelta(DataStream& ds, Vec2I& last, Vec2I const& position) {
+  ds.writeVlqI(position[0] - last[0]);
+  ds.writeVlqI(position[1] - last[1]);
+  last = position;
+}
+
+void TileUpdateBatchPacket::read(DataStream& ds) {
+  Vec2I last;
+  tiles.resize(ds.readVlqU());
+  for (auto& run : tiles) {
+    run.position = readPositionDelta(ds, last);
+    run.values.resize(ds.readVlqU());
+    for (auto& tile : run.values)
+      ds.read(tile);
+  }
+
+  last = Vec2I();
+  liquids.resize(ds.readVlqU());
+  for (auto& run : liquids) {
+    run.position = readPositionDelta(ds, last);
+    run.values.resize(ds.readVlqU());
+    for (auto& liquid : run.values) {
+      ds.read(liquid.liquid);
+      ds.read(liquid.level);
+    }
+  }
+
+  last = Vec2I();
+  damage.resize(ds.readVlqU());
+  for (auto& update : damage) {
+    update.position = readPositionDelta(ds, last);
+    ds.read(update.layer);
+    ds.read(update.tileDamage);
+  }
+}
+
+void TileUpdateBatchPacket::write(DataStream& ds) const {
+  Vec2I last;
+  ds.writeVlqU(tiles.size());
+  for (auto const& run : tiles) {
+    writePositionDelta(ds, last, run.position);
+    ds.writeVlqU(run.values.size());
+    for (auto const& tile : run.values)
+      ds.write(tile);
+  }
+
+  last = Vec2I();
+  ds.writeVlqU(liquids.size());
+  for (auto const& run : liquids) {
+    writePositionDelta(ds, last, run.position);
+    ds.writeVlqU(run.values.size());
+    for (auto const& liquid : run.values) {
+      ds.write(liquid.liquid);
+      ds.write(liquid.level);
+    }
+  }
+
+  last = Vec2I();
+  ds.writeVlqU(damage.size());
+  for (auto const& update : damage) {
+    writePositionDelta(ds, last, update.position);
+    ds.write(update.layer);
+    ds.write(update.tileDamage);
+  }
+}
+
+void EntityMessageBatchPacket::batchPackets(List<PacketPtr>& packets) {
+  auto batchable = [](PacketPtr const& packet) {
+    return packet->type() == PacketType::EntityMessage || packet->type() == PacketType::EntityMessageResponse;
+  };
+
+  size_t runs = 0;
+  for (size_t i = 0; i + 1 < packets.size(); ++i) {
+    if (batchable(packets[i]) && batchable(packets[i + 1]))
+      ++runs;
+  }
+  if (runs == 0)
+    return;
+
+  List<PacketPtr> batched;
+  batched.reserve(packets.size() - runs);
+  for (size_t i = 0; i < packets.size();) {
+    size_t end = i;
+    while (end < packets.size() && batchable(packets[end]))
+      ++end;
+
+    if (end - i > 1) {
+      batched.append(make_shared<EntityMessageBatchPacket>(packets.slice(i, end)));
+      i = end;
+    } else {
+      batched.append(std::move(packets[i++]));
+    }
+  }
+  packets = std::move(batched);
+}
+
+List<PacketPtr> EntityMessageBatchPacket::unbatchPackets(List<PacketPtr> packets) {
+  if (!packets.any([](PacketPtr const& packet) { return packet->type() == PacketType::EntityMessageBatch; }))
+    return packets;
+
+  List<PacketPtr> unbatched;
+  for (auto& packet : packets) {
+    if (auto batch = as<EntityMessageBatchPacket>(packet))
+      unbatched.appendAll(std::move(batch->packets));
+    else
+      unbatched.append(std::move(packet));
+  }
+  return unbatched;
+}
+
+EntityMessageBatchPacket::EntityMessageBatchPacket() {}
+
+EntityMessageBatchPacket::EntityMessageBatchPacket(List<PacketPtr> packets)
+  : packets(std::move(packets)) {}
+
+void EntityMessageBatchPacket::read(DataStream& ds) {
+  packets.clear();
+  shared_ptr<EntityMessagePacket> previous;
+  size_t count = ds.readVlqU();
+  for (size_t i = 0; i < count; ++i) {
+    auto type = ds.read<uint8_t>();
+    if (type == 0) {
+      auto response = make_shared<EntityMessageResponsePacket>();
+      ds.read(response->response);
+      ds.read(response->uuid);
+      packets.append(std::move(response));
+    } else {
+      auto message = make_shared<EntityMessagePacket>();
+      ds.read(message->entityId);
+      if (type == 1) {
+        ds.read(message->message);
+        ds.read(message->args);
+      } else if (previous) {
+        message->message = previous->message;
+        message->args = previous->args;
+      } else {
+        throw StarPacketException("EntityMessageBatch repeats a message before any message");
+      }
+      ds.read(message->uuid);
+      ds.read(message->fromConnection);
+      packets.append(message);
+      previous = std::move(message);
+    }
+  }
+}
+
+void EntityMessageBatchPacket::write(DataStream& ds) const {
+  EntityMessagePacket const* previous = nullptr;
+  ds.writeVlqU(packets.size());
+  for (auto const& packet : packets) {
+    if (auto response = as<EntityMessageResponsePacket>(packet)) {
+      ds.write<uint8_t>(0);
+      ds.write(response->response);
+      ds.write(response->uuid);
+    } else {
+      auto message = convert<EntityMessagePacket>(packet);
+      bool repeat = previous && previous->message == message->message && previous->args == message->args;
+      ds.write<uint8_t>(repeat ? 2 : 1);
+      ds.write(message->entityId);
+      if (!repeat) {
+        ds.write(message->message);
+        ds.write(message->args);
+      }
+      ds.write(message->uuid);
+      ds.write(message->fromConnection);
+      previous = message.get();
+    }
+  }
+}
+
+SessionAcknowledgePacket::SessionAcknowledgePacket() {}
+
+SessionAcknowledgePacket::SessionAcknowledgePacket(uint64_t received) : received(received) {}
+
+void SessionAcknowledgePacket::read(DataStream& ds) {
+  ds.readVlqU(received);
+}
+
+void SessionAcknowledgePacket::write(DataStream& ds) const {
+  ds.writeVlqU(received);
+}
+
+SessionResumePacket::SessionResumePacket() {}
+
+SessionResumePacket::SessionResumePacket(uint64_t received) : received(received) {}
+
+void SessionResumePacket::read(DataStream& ds) {
+  ds.readVlqU(received);
+}
+
+void SessionResumePacket::write(DataStream& ds) const {
+  ds.writeVlqU(received);
+}
+
 }
@@ -117,7 +117,11 @@ enum class PacketType : uint8_t {
 
   // OpenStarbound packets
   ReplaceTileList,
-  UpdateWorldTemplate
+  UpdateWorldTemplate,
+  TileUpdateBatch,
+  EntityMessageBatch,
+  SessionAcknowledge,
+  SessionResume
 };
 extern EnumMap<PacketType> const PacketTypeNames;
 
@@ -149,7 +153,21 @@ struct Packet {
   PacketCompressionMode compressionMode() const;
   void setCompressionMode(PacketCompressionMode compressionMode);
 
+  // Marks the packet as sent unchanged to several connections, so that it is
+  // serialized only once for each distinct NetCompatibilityRules among them.
+  // The packet must not be modified afterwards.
+  void setBroadcast();
+  bool isBroadcast() const;
+
+  // Writes the packet as write() does, reusing the data serialized for an
+  // earlier connection with the same rules if the packet is broadcast.
+  void writeCached(DataStream& ds, NetCompatibilityRules netRules) const;
+
   PacketCompressionMode m_compressionMode = PacketCompressionMode::Automatic;
+
+private:
+  struct SerializationCache;
+  shared_ptr<SerializationCache> m_serializationCache;
 };
 
 PacketPtr createPacket(PacketType type);
@@ -421,6 +439,9 @@ struct WorldStartPacket : PacketBase<PacketType::WorldStart> {
   Json worldProperties;
   ConnectionId clientId;
   bool localInterpolationMode;
+  // If not zero, entity updates are acknowledged, and this is the first
+  // snapshot number that can be sent in this world.
+  uint64_t firstEntitySnapshot;
 };
 
 // Sent when a client is leaving a world
@@ -466,6 +487,8 @@ struct CentralStructureUpdatePacket : PacketBase<PacketType::CentralStructureUpd
   Json structureData;
 };
 
+// From stream version 15 the array is sent as a palette of distinct tiles
+// followed by run length encoded palette indexes, in row major order.
 struct TileArrayUpdatePacket : PacketBase<PacketType::TileArrayUpdate> {
   typedef MultiArray<NetTile, 2> TileArray;
 
@@ -753,7 +776,7 @@ struct PingPacket : PacketBase<PacketType::Ping> {
 
 struct EntityCreatePacket : PacketBase<PacketType::EntityCreate> {
   EntityCreatePacket();
-  EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId);
+  EntityCreatePacket(EntityType entityType, ByteArray storeData, ByteArray firstNetState, EntityId entityId, uint64_t netVersion = 0);
 
   void read(DataStream& ds) override;
   void write(DataStream& ds) const override;
@@ -762,19 +785,44 @@ struct EntityCreatePacket : PacketBase<PacketType::EntityCreate> {
   ByteArray storeData;
   ByteArray firstNetState;
   EntityId entityId;
+  // The net version of firstNetState on the server
+  uint64_t netVersion;
 };
 
 // All entity deltas will be sent at the same time for the same connection
 // where they are master, any entities whose master is from that connection can
-// be assumed to have produced a blank delta.
+// be assumed to have produced a blank delta.  Deltas are shared, immutable
+// buffers so that the server can encode an entity delta once and send it to
+// every client that needs it.
 struct EntityUpdateSetPacket : PacketBase<PacketType::EntityUpdateSet> {
   EntityUpdateSetPacket(ConnectionId forConnection = ServerConnectionId);
 
   void read(DataStream& ds) override;
   void write(DataStream& ds) const override;
 
+  // Returns the delta for the given entity, or an empty delta if none was
+  // sent.
+  ByteArray delta(EntityId entityId) const;
+
   ConnectionId forConnection;
-  HashMap<EntityId, ByteArray> deltas;
+  HashMap<EntityId, ByteArrayConstPtr> deltas;
+
+  // Set when the client acknowledges entity updates, in which case the
+  // deltas are relative to the last acknowledged version of each entity
+  // rather than to the last sent one, and the packet may be lost.
+  uint64_t snapshot;
+  // The net version each delta brings its entity to
+  HashMap<EntityId, uint64_t> netVersions;
+
+  // Entities updated at a reduced rate, with the number of updates between
+  // each of theirs.  Such an entity is only updated when updateCount plus its
+  // id is a multiple of its interval, on other updates it should be
+  // extrapolated rather than read as unchanged.
+  uint64_t updateCount;
+  HashMap<EntityId, unsigned> updateIntervals;
+
+  // Returns true if the given entity skips this update
+  bool deferred(EntityId entityId) const;
 };
 
 struct EntityDestroyPacket : PacketBase<PacketType::EntityDestroy> {
@@ -893,6 +941,8 @@ struct StepUpdatePacket : PacketBase<PacketType::StepUpdate> {
   void write(DataStream& ds, NetCompatibilityRules netRules) const override;
 
   double remoteTime;
+  // EntityUpdateSet snapshots received since the last step update
+  List<uint64_t> acknowledgedSnapshots;
 };
 
 struct SystemWorldStartPacket : PacketBase<PacketType::SystemWorldStart> {
@@ -981,4 +1031,81 @@ struct UpdateWorldTemplatePacket : PacketBase<PacketType::UpdateWorldTemplate> {
 
   Json templateData;
 };
+
+// Batched form of TileUpdatePacket, TileLiquidUpdatePacket and
+// TileDamageUpdatePacket.  Tile and liquid updates are grouped into runs of
+// horizontally adjacent positions, and all positions are delta encoded.
+struct TileUpdateBatchPacket : PacketBase<PacketType::TileUpdateBatch> {
+  template <typename T>
+  struct Run {
+    Vec2I position;
+    List<T> values;
+  };
+
+  struct DamageUpdate {
+    Vec2I position;
+    TileLayer layer;
+    TileDamageStatus tileDamage;
+  };
+
+  // Sorts the given positions into rows and returns the start and length of
+  // each run of horizontally adjacent positions.
+  static List<pair<Vec2I, size_t>> positionRuns(List<Vec2I> positions);
+
+  TileUpdateBatchPacket();
+
+  void read(DataStream& ds) override;
+  void write(DataStream& ds) const override;
+
+  List<Run<NetTile>> tiles;
+  List<Run<LiquidNetUpdate>> liquids;
+  List<DamageUpdate> damage;
+};
+
+// A run of consecutive EntityMessagePackets and EntityMessageResponsePackets
+// sent as one packet, in the same order.  A message with the same message
+// name and arguments as the message before it is written without them, so
+// broadcasting one message to many entities costs little more than the ids.
+struct EntityMessageBatchPacket : PacketBase<PacketType::EntityMessageBatch> {
+  // Replaces every run of more than one consecutive entity message or entity
+  // message response packet with a batch packet
+  static void batchPackets(List<PacketPtr>& packets);
+  // Expands any batch packets back into the packets they hold
+  static List<PacketPtr> unbatchPackets(List<PacketPtr> packets);
+
+  EntityMessageBatchPacket();
+  EntityMessageBatchPacket(List<PacketPtr> packets);
+
+  void read(DataStream& ds) override;
+  void write(DataStream& ds) const override;
+
+  // Only EntityMessagePackets and EntityMessageResponsePackets
+  List<PacketPtr> packets;
+};
+
+// Sent periodically by both ends of a SessionPacketSocket, the number of
+// session packets received so far.  Never reaches the game.
+struct SessionAcknowledgePacket : PacketBase<PacketType::SessionAcknowledge> {
+  SessionAcknowledgePacket();
+  SessionAcknowledgePacket(uint64_t received);
+
+  void read(DataStream& ds) override;
+  void write(DataStream& ds) const override;
+
+  uint64_t received = 0;
+};
+
+// Server's reply to a ClientConnect that resumes a lost session, in place of
+// ConnectSuccess.  Tells the client how many session packets the server
+// received, so it can send the rest again.
+struct SessionResumePacket : PacketBase<PacketType::SessionResume> {
+  SessionResumePacket();
+  SessionResumePacket(uint64_t received);
+
+  void read(DataStream& ds) override;
+  void write(DataStream& ds) const override;
+
+  uint64_t received = 0;
+};
+
 }
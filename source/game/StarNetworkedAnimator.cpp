@@ -71,6 +71,8 @@ NetworkedAnimator::NetworkedAnimator() {
   m_flippedRelativeCenterLine.set(0.0f);
   m_animationRate.set(1.0f);
   m_animatorVersion = 0;
+  m_culled = false;
+  m_culledTime = 0.0f;
   setupNetStates();
 }
 
@@ -270,6 +272,8 @@ NetworkedAnimator& NetworkedAnimator::operator=(NetworkedAnimator&& animator) {
   m_partDrawables = std::move(animator.m_partDrawables);
   m_localTags = std::move(animator.m_localTags);
   m_animatorVersion = std::move(animator.m_animatorVersion);
+  m_culled = animator.m_culled;
+  m_culledTime = animator.m_culledTime;
   setupNetStates();
 
   return *this;
@@ -296,6 +300,8 @@ NetworkedAnimator& NetworkedAnimator::operator=(NetworkedAnimator const& animato
   m_partDrawables = animator.m_partDrawables;
   m_localTags = animator.m_localTags;
   m_animatorVersion = animator.m_animatorVersion;
+  m_culled = animator.m_culled;
+  m_culledTime = animator.m_culledTime;
   setupNetStates();
 
   return *this;
@@ -1018,7 +1024,10 @@ List<LightSource> NetworkedAnimator::lightSources(Vec2F const& translate) const
 void NetworkedAnimator::update(float dt, DynamicTarget* dynamicTarget) {
   dt *= m_animationRate.get();
 
-  m_animatedParts.update(dt);
+  if (m_culled)
+    m_culledTime += dt;
+  else
+    m_animatedParts.update(dt + take(m_culledTime));
 
   m_animatedParts.forEachActiveState([&](String const& stateTypeName, AnimatedPartSet::ActiveStateInformation const& activeState) {
       if (dynamicTarget) {
@@ -1100,7 +1109,7 @@ void NetworkedAnimator::update(float dt, DynamicTarget* dynamicTarget) {
 
 
     });
-  if (version() > 0) {
+  if (version() > 0 && !m_culled) {
     auto processTransforms = [](Mat3F mat, JsonArray transforms, JsonObject properties) -> Mat3F {
       for (auto const& v : transforms) {
         auto action = v.getString(0);
@@ -1179,6 +1188,11 @@ void NetworkedAnimator::update(float dt, DynamicTarget* dynamicTarget) {
     };
 
     for (auto& pair : m_particleEmitters) {
+      if (m_culled) {
+        pair.second.burstEvent.ignoreOccurrences();
+        continue;
+      }
+
       Mat3F transformation = Mat3F::identity();
       if (pair.second.anchorPart)
         transformation = partTransformation(*pair.second.anchorPart);
@@ -1278,11 +1292,21 @@ void NetworkedAnimator::update(float dt, DynamicTarget* dynamicTarget) {
   }
 }
 
+void NetworkedAnimator::setCulled(bool culled) {
+  m_culled = culled;
+}
+
+bool NetworkedAnimator::culled() const {
+  return m_culled;
+}
+
 void NetworkedAnimator::finishAnimations() {
   m_animatedParts.finishAnimations();
 }
 
 Mat3F NetworkedAnimator::TransformationGroup::affineTransform() const {
+  if (pendingTransform)
+    return *pendingTransform;
   return Mat3F(
       xScale.get() * cos(xShear.get()), xScale.get() * sin(xShear.get()), xTranslation.get(),
       yScale.get() * sin(yShear.get()), yScale.get() * cos(yShear.get()), yTranslation.get(),
@@ -1291,6 +1315,13 @@ Mat3F NetworkedAnimator::TransformationGroup::affineTransform() const {
 }
 
 void NetworkedAnimator::TransformationGroup::setAffineTransform(Mat3F const& matrix) {
+  pendingTransform = matrix;
+}
+
+void NetworkedAnimator::TransformationGroup::storeAffineTransform() {
+  if (!pendingTransform)
+    return;
+  Mat3F matrix = pendingTransform.take();
   xTranslation.set(matrix[0][2]);
   yTranslation.set(matrix[1][2]);
   xScale.set(sqrt(square(matrix[0][0]) + square(matrix[0][1])));
@@ -1438,6 +1469,9 @@ void NetworkedAnimator::netElementsNeedLoad(bool initial) {
     if (pair.second.netImmediateEvent.pullOccurred() || initial)
       pair.second.currentAngle = pair.second.targetAngle.get();
   }
+
+  for (auto& pair : m_transformationGroups)
+    pair.second.pendingTransform.reset();
 }
 
 void NetworkedAnimator::netElementsNeedStore() {
@@ -1448,6 +1482,9 @@ void NetworkedAnimator::netElementsNeedStore() {
       pair.second.reverse.set(m_animatedParts.activeStateReverse(pair.first));
     }
   }
+
+  for (auto& pair : m_transformationGroups)
+    pair.second.storeAffineTransform();
 }
 
 uint8_t NetworkedAnimator::version() const {
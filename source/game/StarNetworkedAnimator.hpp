@@ -228,6 +228,12 @@ public:
   // will be discarded
   void update(float dt, DynamicTarget* dynamicTarget);
 
+  // A culled animator does not advance its animation frames or emit
+  // particles, it only accumulates the elapsed time and catches up on the
+  // first update after being unculled.  Sounds and lights are still updated.
+  void setCulled(bool culled);
+  bool culled() const;
+
   // Run through the current animations until the final frame, including any
   // transition animations.
   void finishAnimations();
@@ -247,6 +253,10 @@ private:
   struct TransformationGroup {
     Mat3F affineTransform() const;
     void setAffineTransform(Mat3F const& matrix);
+    // Writes the pending transform into the net fields, so that a script
+    // resetting and rebuilding the group every tick only produces a delta
+    // when the end result actually differs.
+    void storeAffineTransform();
 
     Mat3F localAffineTransform() const;
     void setLocalAffineTransform(Mat3F const& matrix);
@@ -257,6 +267,7 @@ private:
 
     bool interpolated;
 
+    Maybe<Mat3F> pendingTransform;
     Mat3F localTransform;
 
     NetElementFloat xTranslation;
@@ -362,6 +373,9 @@ private:
   String m_relativePath;
   uint8_t m_animatorVersion;
 
+  bool m_culled;
+  float m_culledTime;
+
   AnimatedPartSet m_animatedParts;
   OrderedHashMap<String, StateInfo> m_stateInfo;
   OrderedHashMap<String, RotationGroup> m_rotationGroups;
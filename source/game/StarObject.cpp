@@ -2,6 +2,7 @@
 #include "StarDataStreamExtra.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarWorld.hpp"
+#include "StarWorldClient.hpp"
 #include "StarLexicalCast.hpp"
 #include "StarRoot.hpp"
 #include "StarLogging.hpp"
@@ -418,6 +419,8 @@ void Object::update(float dt, uint64_t) {
     m_scriptComponent.update(m_scriptComponent.updateDt(dt));
 
   } else {
+    if (auto worldClient = as<WorldClient>(world()))
+      m_networkedAnimator->setCulled(worldClient->animationCulled(metaBoundBox().translated(position())));
     m_networkedAnimator->update(dt, &m_networkedAnimatorDynamicTarget);
     m_networkedAnimatorDynamicTarget.updatePosition(position() + m_animationPosition);
   }
@@ -844,6 +847,7 @@ void Object::addNodeConnection(WireNode wireNode, WireConnection nodeConnection)
         return true;
       });
   }
+  ++m_connectionsVersion;
   m_scriptComponent.invoke("onNodeConnectionChange");
 }
 
@@ -857,9 +861,14 @@ void Object::removeNodeConnection(WireNode wireNode, WireConnection nodeConnecti
         return list.remove(nodeConnection);
       });
   }
+  ++m_connectionsVersion;
   m_scriptComponent.invoke("onNodeConnectionChange");
 }
 
+uint64_t Object::connectionsVersion() const {
+  return m_connectionsVersion;
+}
+
 void Object::evaluate(WireCoordinator* coordinator) {
   for (size_t i = 0; i < m_inputNodes.size(); ++i) {
     auto& in = m_inputNodes[i];
@@ -132,6 +132,7 @@ public:
 
   virtual void addNodeConnection(WireNode wireNode, WireConnection nodeConnection) override;
   virtual void removeNodeConnection(WireNode wireNode, WireConnection nodeConnection) override;
+  virtual uint64_t connectionsVersion() const override;
 
   virtual void evaluate(WireCoordinator* coordinator) override;
 
@@ -274,6 +275,7 @@ private:
 
   List<InputNode> m_inputNodes;
   List<OutputNode> m_outputNodes;
+  uint64_t m_connectionsVersion = 0;
 
   NetElementData<List<QuestArcDescriptor>> m_offeredQuests;
   NetElementData<StringSet> m_turnInQuests;
@@ -335,12 +335,15 @@ ObjectDatabase::ObjectDatabase() : m_rebuilder(make_shared<Rebuilder>("object"))
 }
 
 void ObjectDatabase::cleanup() {
-  MutexLocker locker(m_cacheMutex);
   m_configCache.cleanup([](String const&, ObjectConfigPtr const& config) {
       return !config.unique();
     });
 }
 
+CacheStatistics ObjectDatabase::configCacheStatistics() const {
+  return m_configCache.statistics();
+}
+
 StringList ObjectDatabase::allObjects() const {
   return m_paths.keys();
 }
@@ -350,15 +353,40 @@ bool ObjectDatabase::isObject(String const& objectName) const {
 }
 
 ObjectConfigPtr ObjectDatabase::getConfig(String const& objectName) const {
-  MutexLocker locker(m_cacheMutex);
   return m_configCache.get(objectName,
       [this](String const& objectName) -> ObjectConfigPtr {
-        if (auto path = m_paths.maybe(objectName))
+        if (auto path = m_paths.maybe(objectName)) {
+          {
+            MutexLocker locker(m_cacheMutex);
+            if (m_recordConfigLoads)
+              m_recordedConfigLoads.add(objectName);
+          }
           return readConfig(*path);
+        }
         throw ObjectException(strf("No such object named '{}'", objectName));
       });
 }
 
+void ObjectDatabase::persistConfig(String const& objectName) const {
+  auto path = m_paths.maybe(objectName);
+  if (!path)
+    throw ObjectException(strf("No such object named '{}'", objectName));
+
+  auto config = m_configCache.insert(objectName, readConfig(*path));
+  MutexLocker locker(m_cacheMutex);
+  m_persistentConfigs.append(std::move(config));
+}
+
+void ObjectDatabase::setRecordConfigLoads(bool recordConfigLoads) const {
+  MutexLocker locker(m_cacheMutex);
+  m_recordConfigLoads = recordConfigLoads;
+}
+
+StringList ObjectDatabase::recordedConfigLoads() const {
+  MutexLocker locker(m_cacheMutex);
+  return m_recordedConfigLoads.values();
+}
+
 List<ObjectOrientationPtr> const& ObjectDatabase::getOrientations(String const& objectName) const {
   return getConfig(objectName)->orientations;
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "StarPeriodicFunction.hpp"
-#include "StarTtlCache.hpp"
+#include "StarShardedTtlCache.hpp"
 #include "StarGameTypes.hpp"
 #include "StarItemDescriptor.hpp"
 #include "StarParticle.hpp"
@@ -191,11 +191,20 @@ public:
   ObjectDatabase();
 
   void cleanup();
+  CacheStatistics configCacheStatistics() const;
 
   StringList allObjects() const;
   bool isObject(String const& name) const;
 
   ObjectConfigPtr getConfig(String const& objectName) const;
+
+  // Loads the given object's config and keeps it loaded.  Unlike getConfig,
+  // any number of these may run in parallel.
+  void persistConfig(String const& objectName) const;
+
+  // While enabled, remembers every object whose config is loaded.
+  void setRecordConfigLoads(bool recordConfigLoads) const;
+  StringList recordedConfigLoads() const;
   List<ObjectOrientationPtr> const& getOrientations(String const& objectName) const;
 
   ObjectPtr createObject(String const& objectName, Json const& objectParameters = JsonObject()) const;
@@ -216,8 +225,12 @@ private:
   static ObjectConfigPtr readConfig(String const& path);
 
   StringMap<String> m_paths;
+  // Guards the persistent configs and recorded config loads
   mutable Mutex m_cacheMutex;
-  mutable HashTtlCache<String, ObjectConfigPtr> m_configCache;
+  mutable ShardedTtlCache<String, ObjectConfigPtr> m_configCache;
+  mutable List<ObjectConfigPtr> m_persistentConfigs;
+  mutable bool m_recordConfigLoads = false;
+  mutable StringSet m_recordedConfigLoads;
 
   RebuilderPtr m_rebuilder;
 };
@@ -0,0 +1,122 @@
+#include "StarPacketCapture.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+static char const* const PacketCaptureMagic = "SBPCAP01";
+static size_t const PacketCaptureMagicSize = 8;
+// Buffered packets are written out once they reach this size
+static size_t const PacketCaptureFlushSize = 65536;
+
+PacketPtr CapturedPacket::packet() const {
+  auto packet = createPacket(type);
+  packet->setCompressionMode(compressionMode);
+  DataStreamBuffer ds(data);
+  packet->read(ds, netRules);
+  return packet;
+}
+
+PacketCaptureWriter::PacketCaptureWriter(String const& path)
+  : m_path(path), m_nextStream(0), m_packetCount(0) {
+  m_file = File::open(path, IOMode::Write | IOMode::Truncate);
+  m_file->writeFull(PacketCaptureMagic, PacketCaptureMagicSize);
+  m_startTime = Time::monotonicTime();
+}
+
+PacketCaptureWriter::~PacketCaptureWriter() {
+  flush();
+}
+
+String const& PacketCaptureWriter::path() const {
+  return m_path;
+}
+
+uint32_t PacketCaptureWriter::openStream() {
+  MutexLocker locker(m_mutex);
+  return m_nextStream++;
+}
+
+void PacketCaptureWriter::record(uint32_t stream, PacketPtr const& packet, NetCompatibilityRules netRules) {
+  MutexLocker locker(m_mutex);
+  writePacket(stream, packet, netRules);
+}
+
+void PacketCaptureWriter::assignClient(ConnectionId clientId, uint32_t stream) {
+  MutexLocker locker(m_mutex);
+  m_clientStreams[clientId] = stream;
+}
+
+void PacketCaptureWriter::removeClient(ConnectionId clientId) {
+  MutexLocker locker(m_mutex);
+  m_clientStreams.remove(clientId);
+}
+
+void PacketCaptureWriter::recordClient(ConnectionId clientId, List<PacketPtr> const& packets, NetCompatibilityRules netRules) {
+  MutexLocker locker(m_mutex);
+  if (auto stream = m_clientStreams.maybe(clientId)) {
+    for (auto const& packet : packets)
+      writePacket(*stream, packet, netRules);
+  }
+}
+
+size_t PacketCaptureWriter::packetCount() const {
+  MutexLocker locker(m_mutex);
+  return m_packetCount;
+}
+
+void PacketCaptureWriter::flush() {
+  MutexLocker locker(m_mutex);
+  flushBuffer();
+}
+
+void PacketCaptureWriter::writePacket(uint32_t stream, PacketPtr const& packet, NetCompatibilityRules netRules) {
+  DataStreamBuffer packetData;
+  packet->write(packetData, netRules);
+
+  m_buffer.write<double>(Time::monotonicTime() - m_startTime);
+  m_buffer.writeVlqU(stream);
+  m_buffer.write<uint8_t>((uint8_t)packet->type());
+  m_buffer.write<uint8_t>((uint8_t)packet->compressionMode());
+  m_buffer.writeVlqU(netRules.version());
+  m_buffer.write<bool>(netRules.isAdmin());
+  m_buffer.write(packetData.data());
+  ++m_packetCount;
+
+  if (m_buffer.size() >= PacketCaptureFlushSize)
+    flushBuffer();
+}
+
+void PacketCaptureWriter::flushBuffer() {
+  if (m_buffer.empty())
+    return;
+  m_file->writeFull(m_buffer.ptr(), m_buffer.size());
+  m_buffer.clear();
+}
+
+List<CapturedPacket> readPacketCapture(String const& path) {
+  DataStreamBuffer ds(File::readFile(path));
+  if (ds.size() < PacketCaptureMagicSize || ds.readBytes(PacketCaptureMagicSize) != ByteArray(PacketCaptureMagic, PacketCaptureMagicSize))
+    throw PacketCaptureException::format("'{}' is not a packet capture", path);
+
+  List<CapturedPacket> packets;
+  try {
+    while (!ds.atEnd()) {
+      CapturedPacket packet;
+      packet.time = ds.read<double>();
+      packet.stream = ds.readVlqU();
+      packet.type = (PacketType)ds.read<uint8_t>();
+      packet.compressionMode = (PacketCompressionMode)ds.read<uint8_t>();
+      packet.netRules = NetCompatibilityRules((VersionNumber)ds.readVlqU());
+      packet.netRules.setIsAdmin(ds.read<bool>());
+      packet.data = ds.read<ByteArray>();
+      packets.append(std::move(packet));
+    }
+  } catch (EofException const&) {
+    // A capture that was not stopped cleanly ends with a partial packet
+  }
+
+  return packets;
+}
+
+}
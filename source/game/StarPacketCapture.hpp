@@ -0,0 +1,71 @@
+#pragma once
+
+#include "StarNetPackets.hpp"
+#include "StarFile.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(PacketCaptureWriter);
+
+STAR_EXCEPTION(PacketCaptureException, IOException);
+
+// A packet received from a client during a packet capture.
+struct CapturedPacket {
+  // Deserializes the packet as it was received
+  PacketPtr packet() const;
+
+  // Seconds since the capture was started
+  double time;
+  // Connections are numbered in the order they connected during the capture
+  uint32_t stream;
+  PacketType type;
+  PacketCompressionMode compressionMode;
+  NetCompatibilityRules netRules;
+  ByteArray data;
+};
+
+// Records every packet a UniverseServer receives from clients, with the time
+// it was received, to a file, so that a session can be replayed against a
+// server offline by server_replay_benchmark.  Thread safe.
+class PacketCaptureWriter {
+public:
+  PacketCaptureWriter(String const& path);
+  ~PacketCaptureWriter();
+
+  String const& path() const;
+
+  // Starts recording a new connection, returning its stream
+  uint32_t openStream();
+  void record(uint32_t stream, PacketPtr const& packet, NetCompatibilityRules netRules);
+
+  // Packets received from a client once it is connected are recorded to the
+  // stream given here.  Clients that connected before the capture started
+  // have no stream and are not recorded.
+  void assignClient(ConnectionId clientId, uint32_t stream);
+  void removeClient(ConnectionId clientId);
+  void recordClient(ConnectionId clientId, List<PacketPtr> const& packets, NetCompatibilityRules netRules);
+
+  size_t packetCount() const;
+
+  // Writes out anything still buffered
+  void flush();
+
+private:
+  void writePacket(uint32_t stream, PacketPtr const& packet, NetCompatibilityRules netRules);
+  void flushBuffer();
+
+  mutable Mutex m_mutex;
+  String m_path;
+  FilePtr m_file;
+  double m_startTime;
+  DataStreamBuffer m_buffer;
+  uint32_t m_nextStream;
+  HashMap<ConnectionId, uint32_t> m_clientStreams;
+  size_t m_packetCount;
+};
+
+// Reads every packet from a capture file, in the order they were received.
+List<CapturedPacket> readPacketCapture(String const& path);
+
+}
@@ -0,0 +1,219 @@
+#include "StarPacketScheduler.hpp"
+#include "StarTime.hpp"
+#include "StarIterator.hpp"
+
+namespace Star {
+
+// The most packets handed to the socket in one go, so that budgets and
+// deadlines are checked often enough while still batching packets of the
+// same type together.
+static size_t const PacketSchedulerMaxRun = 32;
+
+EnumMap<PacketClass> const PacketClassNames {
+  {PacketClass::Interactive, "interactive"},
+  {PacketClass::Entity, "entity"},
+  {PacketClass::Bulk, "bulk"}
+};
+
+Maybe<PacketClass> packetClassForType(PacketType type) {
+  switch (type) {
+    case PacketType::ChatReceive:
+    case PacketType::Pong:
+    case PacketType::EntityInteractResult:
+    case PacketType::HitRequest:
+    case PacketType::DamageRequest:
+    case PacketType::DamageNotification:
+      return PacketClass::Interactive;
+
+    case PacketType::EntityCreate:
+    case PacketType::EntityUpdateSet:
+    case PacketType::EntityDestroy:
+    case PacketType::EntityMessage:
+    case PacketType::EntityMessageResponse:
+    case PacketType::EntityMessageBatch:
+    case PacketType::StepUpdate:
+      return PacketClass::Entity;
+
+    case PacketType::TileArrayUpdate:
+    case PacketType::TileUpdate:
+    case PacketType::TileUpdateBatch:
+    case PacketType::TileLiquidUpdate:
+    case PacketType::TileDamageUpdate:
+      return PacketClass::Bulk;
+
+    default:
+      return {};
+  }
+}
+
+PacketSchedulerConfig::PacketSchedulerConfig()
+  : PacketSchedulerConfig(JsonObject()) {}
+
+PacketSchedulerConfig::PacketSchedulerConfig(Json const& config) {
+  bitrate = config.getFloat("bitrate", 0.0f);
+  burstTime = config.getFloat("burstTime", 0.1f);
+  maxPendingOutput = config.getUInt("maxPendingOutput", 65536);
+
+  Array<float, PacketClassCount> defaultShares = {0.2f, 0.5f, 0.3f};
+  Array<float, PacketClassCount> defaultDeadlines = {0.05f, 0.1f, 1.0f};
+  auto classes = config.get("classes", JsonObject());
+  for (size_t i = 0; i < PacketClassCount; ++i) {
+    auto classConfig = classes.get(PacketClassNames.getRight((PacketClass)i), JsonObject());
+    classShares[i] = classConfig.getFloat("share", defaultShares[i]);
+    classDeadlines[i] = classConfig.getFloat("deadline", defaultDeadlines[i]);
+  }
+}
+
+PacketScheduler::PacketScheduler(PacketSchedulerConfig config)
+  : m_config(std::move(config)), m_queuedPackets(0), m_nextSequence(0), m_tokens(0) {
+  m_epochs.append(Epoch());
+  m_classTokens.fill(0.0f);
+  m_lastRefillTime = Time::monotonicMilliseconds();
+}
+
+void PacketScheduler::push(List<PacketPtr> packets) {
+  int64_t currentTime = Time::monotonicMilliseconds();
+  for (auto& packet : packets) {
+    Entry entry{std::move(packet), currentTime, m_nextSequence++};
+    if (auto packetClass = packetClassForType(entry.packet->type())) {
+      m_epochs.last().queues[(size_t)*packetClass].append(std::move(entry));
+    } else {
+      m_epochs.last().barrier = std::move(entry);
+      m_epochs.append(Epoch());
+    }
+    ++m_queuedPackets;
+  }
+  m_stats.setQueuedPackets(m_queuedPackets);
+}
+
+void PacketScheduler::release(PacketSocket& socket) {
+  int64_t currentTime = Time::monotonicMilliseconds();
+  refill(currentTime);
+
+  bool limited = m_config.bitrate > 0;
+  size_t pendingOutput = socket.sentPacketsPendingSize();
+  while (true) {
+    auto& epoch = m_epochs.first();
+    if (epoch.queuesEmpty()) {
+      if (!epoch.barrier)
+        break;
+      size_t sent = send(socket, {take(*epoch.barrier)}, currentTime);
+      pendingOutput += sent;
+      m_tokens -= sent;
+      m_epochs.removeFirst();
+      continue;
+    }
+
+    if (pendingOutput >= m_config.maxPendingOutput || (limited && m_tokens <= 0))
+      break;
+
+    // Earliest deadline first, but classes still within their share of the
+    // bitrate go before any class that is over it.
+    Maybe<size_t> bestClass;
+    bool bestWithinShare = false;
+    int64_t bestDeadline = 0;
+    for (size_t i = 0; i < PacketClassCount; ++i) {
+      auto const& queue = epoch.queues[i];
+      if (queue.empty())
+        continue;
+      bool withinShare = !limited || m_classTokens[i] > 0;
+      int64_t deadline = queue.first().pushTime + (int64_t)(m_config.classDeadlines[i] * 1000);
+      if (!bestClass || (withinShare && !bestWithinShare) || (withinShare == bestWithinShare && deadline < bestDeadline)) {
+        bestClass = i;
+        bestWithinShare = withinShare;
+        bestDeadline = deadline;
+      }
+    }
+
+    auto& queue = epoch.queues[*bestClass];
+    List<Entry> run;
+    while (!queue.empty() && run.size() < PacketSchedulerMaxRun)
+      run.append(queue.takeFirst());
+
+    size_t sent = send(socket, std::move(run), currentTime);
+    pendingOutput += sent;
+    m_tokens -= sent;
+    m_classTokens[*bestClass] -= sent;
+  }
+
+  m_stats.setQueuedPackets(m_queuedPackets);
+}
+
+bool PacketScheduler::empty() const {
+  return m_queuedPackets == 0;
+}
+
+size_t PacketScheduler::queuedPackets() const {
+  return m_queuedPackets;
+}
+
+List<PacketPtr> PacketScheduler::takeAll() {
+  List<PacketPtr> packets;
+  for (auto& epoch : m_epochs) {
+    List<Entry> entries;
+    for (auto& queue : epoch.queues)
+      entries.appendAll(take(queue));
+    sortByComputedValue(entries, [](Entry const& entry) { return entry.sequence; });
+    for (auto& entry : entries)
+      packets.append(std::move(entry.packet));
+    if (epoch.barrier)
+      packets.append(std::move(epoch.barrier->packet));
+  }
+
+  m_epochs.clear();
+  m_epochs.append(Epoch());
+  m_queuedPackets = 0;
+  m_stats.setQueuedPackets(0);
+  return packets;
+}
+
+PacketStats PacketScheduler::stats() const {
+  return m_stats.stats();
+}
+
+bool PacketScheduler::Epoch::queuesEmpty() const {
+  for (auto const& queue : queues) {
+    if (!queue.empty())
+      return false;
+  }
+  return true;
+}
+
+void PacketScheduler::refill(int64_t currentTime) {
+  float elapsed = (currentTime - m_lastRefillTime) / 1000.0f;
+  m_lastRefillTime = currentTime;
+  if (m_config.bitrate <= 0)
+    return;
+
+  float burst = m_config.bitrate * m_config.burstTime;
+  m_tokens = min(m_tokens + m_config.bitrate * elapsed, burst);
+  for (size_t i = 0; i < PacketClassCount; ++i)
+    m_classTokens[i] = min(m_classTokens[i] + m_config.bitrate * m_config.classShares[i] * elapsed, burst * m_config.classShares[i]);
+}
+
+size_t PacketScheduler::send(PacketSocket& socket, List<Entry> entries, int64_t currentTime) {
+  m_queuedPackets -= entries.size();
+
+  // Sent a type at a time, to know the size added for each type
+  size_t totalSent = 0;
+  auto it = makeSMutableIterator(entries);
+  while (it.hasNext()) {
+    PacketType currentType = it.peekNext().packet->type();
+    List<PacketPtr> packets;
+    while (it.hasNext() && it.peekNext().packet->type() == currentType) {
+      auto& entry = it.next();
+      m_stats.mixQueueLatency((currentTime - entry.pushTime) / 1000.0f);
+      packets.append(std::move(entry.packet));
+    }
+
+    size_t pendingBefore = socket.sentPacketsPendingSize();
+    socket.sendPackets(std::move(packets));
+    size_t pendingAfter = socket.sentPacketsPendingSize();
+    size_t sent = pendingAfter > pendingBefore ? pendingAfter - pendingBefore : 0;
+    m_stats.mix(currentType, sent);
+    totalSent += sent;
+  }
+  return totalSent;
+}
+
+}
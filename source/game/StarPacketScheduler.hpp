@@ -0,0 +1,99 @@
+#pragma once
+
+#include "StarNetPacketSocket.hpp"
+#include "StarArray.hpp"
+
+namespace Star {
+
+STAR_CLASS(PacketScheduler);
+
+enum class PacketClass : uint8_t {
+  Interactive,
+  Entity,
+  Bulk
+};
+size_t const PacketClassCount = 3;
+extern EnumMap<PacketClass> const PacketClassNames;
+
+// The class a packet type is scheduled in, or nothing if packets of the type
+// must stay in order with every other packet.
+Maybe<PacketClass> packetClassForType(PacketType type);
+
+struct PacketSchedulerConfig {
+  PacketSchedulerConfig();
+  explicit PacketSchedulerConfig(Json const& config);
+
+  // Target outgoing bytes per second, 0 for no limit
+  float bitrate;
+  // Seconds of bitrate that may be sent at once after being idle
+  float burstTime;
+  // Packets are held back while the socket has at least this many bytes
+  // waiting to be written, so that they can still be prioritized.
+  size_t maxPendingOutput;
+
+  // The share of the bitrate each class is guaranteed when others are also
+  // waiting, and how long packets of each class should wait at most.
+  Array<float, PacketClassCount> classShares;
+  Array<float, PacketClassCount> classDeadlines;
+};
+
+// Holds outgoing packets for a single connection and releases them to its
+// PacketSocket.  Packets are queued by class, and the class whose oldest
+// packet has the earliest deadline is sent first, preferring classes that
+// have not used up their share of the bitrate.  Packets without a class act
+// as barriers: everything pushed before them is sent before them, and
+// nothing pushed after them is sent before them.
+class PacketScheduler {
+public:
+  PacketScheduler(PacketSchedulerConfig config);
+
+  void push(List<PacketPtr> packets);
+
+  // Hands as many queued packets to the socket as the bitrate budget and the
+  // socket's pending output allow.
+  void release(PacketSocket& socket);
+
+  bool empty() const;
+  size_t queuedPackets() const;
+
+  // Removes every queued packet, in the order they were pushed.
+  List<PacketPtr> takeAll();
+
+  // Bytes released per packet type, with the queue depth and the time
+  // packets waited in the queue.
+  PacketStats stats() const;
+
+private:
+  struct Entry {
+    PacketPtr packet;
+    int64_t pushTime;
+    uint64_t sequence;
+  };
+
+  struct Epoch {
+    Array<Deque<Entry>, PacketClassCount> queues;
+    // The packet ending this epoch, always set except on the last epoch.
+    Maybe<Entry> barrier;
+
+    bool queuesEmpty() const;
+  };
+
+  void refill(int64_t currentTime);
+  // Sends the packets and returns how many bytes they added to the socket's
+  // pending output.
+  size_t send(PacketSocket& socket, List<Entry> entries, int64_t currentTime);
+
+  PacketSchedulerConfig m_config;
+
+  Deque<Epoch> m_epochs;
+  size_t m_queuedPackets;
+  uint64_t m_nextSequence;
+
+  float m_tokens;
+  Array<float, PacketClassCount> m_classTokens;
+  int64_t m_lastRefillTime;
+
+  PacketStatCollector m_stats;
+};
+
+}
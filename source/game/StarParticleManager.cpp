@@ -1,11 +1,15 @@
 #include "StarParticleManager.hpp"
 #include "StarIterator.hpp"
 #include "StarLogging.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
+// Particles are only handed to the worker pool in batches this large
+size_t const ParticleUpdateBatchSize = 4096;
+
 ParticleManager::ParticleManager(WorldGeometry const& worldGeometry, ClientTileSectorArrayPtr const& tileSectorArray)
-  : m_worldGeometry(worldGeometry), m_undergroundLevel(0.0f), m_tileSectorArray(tileSectorArray) {}
+  : m_worldGeometry(worldGeometry), m_undergroundLevel(0.0f), m_tileSectorArray(tileSectorArray), m_workerPool(nullptr) {}
 
 void ParticleManager::add(Particle particle) {
   m_particles.push_back(std::move(particle));
@@ -27,78 +31,150 @@ void ParticleManager::setUndergroundLevel(float undergroundLevel) {
   m_undergroundLevel = undergroundLevel;
 }
 
+void ParticleManager::setWorkerPool(WorkerPool* workerPool) {
+  m_workerPool = workerPool;
+}
+
 void ParticleManager::update(float dt, RectF const& cullRegion, float wind) {
   if (!m_tileSectorArray)
     return;
 
   auto cullRects = m_worldGeometry.splitRect(cullRegion);
 
-  for (auto& particle : m_particles) {
-    bool inRegion = false;
-    Vec2F worldPos = m_worldGeometry.xwrap(particle.position);
-    for (auto cullRect : cullRects) {
-      if (cullRect.contains(worldPos)) {
-        inRegion = true;
-        break;
-      }
+  // Indexes of the particles leaving a trail this update, per batch
+  size_t batchCount = (m_particles.size() + ParticleUpdateBatchSize - 1) / ParticleUpdateBatchSize;
+  List<List<size_t>> batchTrails(batchCount);
+  auto updateBatch = [&](size_t batch) {
+    size_t end = min(m_particles.size(), (batch + 1) * ParticleUpdateBatchSize);
+    for (size_t i = batch * ParticleUpdateBatchSize; i < end; ++i) {
+      if (updateParticle(m_particles[i], dt, cullRects, wind))
+        batchTrails[batch].append(i);
+    }
+  };
+
+  if (m_workerPool && batchCount > 1) {
+    List<WorkerPoolHandle> handles;
+    for (size_t batch = 1; batch < batchCount; ++batch)
+      handles.append(m_workerPool->addWork([&updateBatch, batch]() { updateBatch(batch); }));
+
+    std::exception_ptr error;
+    try {
+      updateBatch(0);
+    } catch (...) {
+      error = std::current_exception();
     }
-    if (!inRegion)
-      continue;
-
-    particle.update(dt, Vec2F(wind, 0));
-    Vec2I pos(particle.position.floor());
-    TileType tiletype;
-    auto const& tile = m_tileSectorArray->tile(pos);
-    if (isSolidColliding(tile.getCollision()))
-      tiletype = TileType::Colliding;
-    else if (tile.liquid.level > 0.5f)
-      tiletype = TileType::Water;
-    else
-      tiletype = TileType::Empty;
-
-    if (particle.collidesForeground && tiletype == TileType::Colliding) {
-      RectF colRect;
-      colRect.setXMax(std::ceil(particle.position[0]));
-      colRect.setXMin(std::floor(particle.position[0]));
-      colRect.setYMax(std::ceil(particle.position[1]));
-      colRect.setYMin(std::floor(particle.position[1]));
-      Line2F colLine(particle.position, particle.position - particle.velocity);
-
-      auto collisionPosition = colRect.edgeIntersection(colLine).point;
-      if (particle.position[0] > colRect.center()[0])
-        collisionPosition[0] += 0.1f;
-      else if (particle.position[0] < colRect.center()[0])
-        collisionPosition[0] -= 0.1f;
-      if (particle.position[1] > colRect.center()[1])
-        collisionPosition[1] += 0.1f;
-      else if (particle.position[1] < colRect.center()[1])
-        collisionPosition[1] -= 0.1f;
-
-      particle.collide(collisionPosition);
+    // Every batch must be done with the particle list before leaving
+    for (auto const& handle : handles) {
+      try {
+        handle.finish();
+      } catch (...) {
+        if (!error)
+          error = std::current_exception();
+      }
     }
+    if (error)
+      std::rethrow_exception(error);
+  } else {
+    for (size_t batch = 0; batch < batchCount; ++batch)
+      updateBatch(batch);
+  }
 
-    if (particle.underwaterOnly && tiletype == TileType::Empty)
-      particle.destroy(false);
+  bool hasTrails = false;
+  for (auto const& trails : batchTrails)
+    hasTrails |= !trails.empty();
+
+  if (!hasTrails) {
+    // Nothing to insert, so the surviving particles can be compacted in place
+    // rather than all being moved to a new list.
+    size_t live = 0;
+    for (size_t i = 0; i < m_particles.size(); ++i) {
+      if (m_particles[i].dead())
+        continue;
+      if (live != i)
+        m_particles[live] = std::move(m_particles[i]);
+      ++live;
+    }
+    m_particles.erase(m_particles.begin() + live, m_particles.end());
+    return;
+  }
 
-    if (particle.collidesLiquid && tiletype == TileType::Water)
-      particle.destroy(false);
+  // Trails go just before the particle leaving them
+  for (size_t batch = 0; batch < batchCount; ++batch) {
+    auto trail = batchTrails[batch].begin();
+    size_t end = min(m_particles.size(), (batch + 1) * ParticleUpdateBatchSize);
+    for (size_t i = batch * ParticleUpdateBatchSize; i < end; ++i) {
+      auto& particle = m_particles[i];
+      if (trail != batchTrails[batch].end() && *trail == i) {
+        auto trailParticle = particle;
+        trailParticle.trail = false;
+        trailParticle.timeToLive = 0;
+        trailParticle.velocity = {};
+        m_nextParticles.append(std::move(trailParticle));
+        ++trail;
+      }
 
-    if (particle.trail && particle.timeToLive >= 0.0f) {
-      auto trail = particle;
-      trail.trail = false;
-      trail.timeToLive = 0;
-      trail.velocity = {};
-      m_nextParticles.append(std::move(trail));
+      if (!particle.dead())
+        m_nextParticles.append(std::move(particle));
     }
-
-    if (!particle.dead())
-      m_nextParticles.append(std::move(particle));
   }
 
   m_particles.clear();
   swap(m_particles, m_nextParticles);
 }
 
+bool ParticleManager::updateParticle(Particle& particle, float dt, StaticList<RectF, 2> const& cullRects, float wind) const {
+  bool inRegion = false;
+  Vec2F worldPos = m_worldGeometry.xwrap(particle.position);
+  for (auto cullRect : cullRects) {
+    if (cullRect.contains(worldPos)) {
+      inRegion = true;
+      break;
+    }
+  }
+  if (!inRegion)
+    return false;
+
+  particle.update(dt, Vec2F(wind, 0));
+  Vec2I pos(particle.position.floor());
+  TileType tiletype;
+  auto const& tile = m_tileSectorArray->tile(pos);
+  if (isSolidColliding(tile.getCollision()))
+    tiletype = TileType::Colliding;
+  else if (tile.liquid.level > 0.5f)
+    tiletype = TileType::Water;
+  else
+    tiletype = TileType::Empty;
+
+  if (particle.collidesForeground && tiletype == TileType::Colliding) {
+    RectF colRect;
+    colRect.setXMax(std::ceil(particle.position[0]));
+    colRect.setXMin(std::floor(particle.position[0]));
+    colRect.setYMax(std::ceil(particle.position[1]));
+    colRect.setYMin(std::floor(particle.position[1]));
+    Line2F colLine(particle.position, particle.position - particle.velocity);
+
+    auto collisionPosition = colRect.edgeIntersection(colLine).point;
+    if (particle.position[0] > colRect.center()[0])
+      collisionPosition[0] += 0.1f;
+    else if (particle.position[0] < colRect.center()[0])
+      collisionPosition[0] -= 0.1f;
+    if (particle.position[1] > colRect.center()[1])
+      collisionPosition[1] += 0.1f;
+    else if (particle.position[1] < colRect.center()[1])
+      collisionPosition[1] -= 0.1f;
+
+    particle.collide(collisionPosition);
+  }
+
+  if (particle.underwaterOnly && tiletype == TileType::Empty)
+    particle.destroy(false);
+
+  if (particle.collidesLiquid && tiletype == TileType::Water)
+    particle.destroy(false);
+
+  return particle.trail && particle.timeToLive >= 0.0f;
+}
+
 List<Particle> const& ParticleManager::particles() const {
   return m_particles;
 }
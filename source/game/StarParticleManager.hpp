@@ -6,6 +6,7 @@
 
 namespace Star {
 
+STAR_CLASS(WorkerPool);
 STAR_CLASS(ParticleManager);
 
 class ParticleManager {
@@ -20,6 +21,10 @@ public:
 
   void setUndergroundLevel(float undergroundLevel);
 
+  // Large numbers of particles are updated in batches on the given pool,
+  // which must not be running other work that touches the tile array.
+  void setWorkerPool(WorkerPool* workerPool);
+
   // Updates current particles and spawns new weather particles
   void update(float dt, RectF const& cullRegion, float wind);
 
@@ -29,12 +34,16 @@ public:
 private:
   enum class TileType { Colliding, Water, Empty };
 
+  // Returns whether the particle leaves a trail particle behind this update
+  bool updateParticle(Particle& particle, float dt, StaticList<RectF, 2> const& cullRects, float wind) const;
+
   List<Particle> m_particles;
   List<Particle> m_nextParticles;
 
   WorldGeometry m_worldGeometry;
   float m_undergroundLevel;
   ClientTileSectorArrayPtr m_tileSectorArray;
+  WorkerPool* m_workerPool;
 };
 
 }
@@ -79,80 +79,57 @@ Plant::Plant(TreeVariant const& config, uint64_t seed) : Plant() {
 
   int segment = 0;
 
-  auto assets = Root::singleton().assets();
+  auto parts = Root::singleton().plantDatabase()->treeParts(config);
+
+  auto addPiece = [&](String const& file, float hueShift, Vec2F offset, bool structural, PlantPieceKind kind,
+      float zLevel, RotationType rotationType, float rotationOffset) {
+    PlantPiece piece;
+    piece.image = strf("{}?hueshift={}", file, hueShift);
+    piece.offset = offset;
+    piece.segmentIdx = segment;
+    piece.structuralSegment = structural;
+    piece.kind = kind;
+    piece.zLevel = zLevel;
+    piece.rotationType = rotationType;
+    piece.rotationOffset = rotationOffset;
+    m_pieces.append(piece);
+  };
+
+  // Leaves on the trunk are each given their own rotation offset, leaves on
+  // branches and crowns sway with the branch they are on.
+  auto addLeaves = [&](TreeParts::Part const& part, Vec2F offset, RotationType rotationType, Maybe<float> rotationOffset) {
+    if (!part.leaves)
+      return;
+
+    Vec2F leavesOffset = offset + part.leaves->offset;
+    if (!part.leaves->image.empty()) {
+      addPiece(part.leaves->image, config.foliageHueShift, leavesOffset, false, PlantPieceKind::Foliage, 3.0f,
+          m_ceiling ? DontRotate : rotationType, rotationOffset ? *rotationOffset : Random::randf() + roffset);
+    }
+    if (!part.leaves->backImage.empty()) {
+      addPiece(part.leaves->backImage, config.foliageHueShift, leavesOffset, false, PlantPieceKind::Foliage, -1.0f,
+          m_ceiling ? DontRotate : rotationType, rotationOffset ? *rotationOffset : Random::randf() + roffset);
+    }
+  };
 
   // base
   {
-    JsonObject bases = config.stemSettings.get("base").toObject();
-    String baseKey = bases.keys()[rnd.randInt(bases.size() - 1)];
-    JsonObject baseSettings = bases[baseKey].toObject();
+    auto const& base = parts->bases.at(rnd.randInt(parts->bases.size() - 1));
 
-    JsonObject attachmentSettings = baseSettings["attachment"].toObject();
+    xOffset += base.baseOffset[0];
+    yOffset += base.baseOffset[1];
 
-    xOffset += attachmentSettings.get("bx").toDouble() / TilePixels;
-    yOffset += attachmentSettings.get("by").toDouble() / TilePixels;
-
-    String baseFile = AssetPath::relativeTo(config.stemDirectory, baseSettings.get("image").toString());
-    float baseImageHeight = assets->image(baseFile)->height();
     if (config.ceiling)
-      yOffset = 1.0 - baseImageHeight / TilePixels;
-
-    {
-      PlantPiece piece;
-      piece.image = strf("{}?hueshift={}", baseFile, config.stemHueShift);
-      piece.offset = Vec2F(xOffset, yOffset);
-      piece.segmentIdx = segment;
-      piece.structuralSegment = true;
-      piece.kind = PlantPieceKind::Stem;
-      piece.zLevel = 0.0f;
-      piece.rotationType = DontRotate;
-      piece.rotationOffset = Random::randf() + roffset;
-      m_pieces.append(piece);
-    }
+      yOffset = 1.0 - base.imageHeight / TilePixels;
 
-    // base leaves
-    JsonObject baseLeaves = config.foliageSettings.getObject("baseLeaves", {});
-    if (baseLeaves.contains(baseKey)) {
-      JsonObject baseLeavesSettings = baseLeaves.get(baseKey).toObject();
-      JsonObject attachmentSettings = baseLeavesSettings["attachment"].toObject();
-
-      float xOf = xOffset + attachmentSettings.get("bx").toDouble() / TilePixels;
-      float yOf = yOffset + attachmentSettings.get("by").toDouble() / TilePixels;
-
-      if (baseLeavesSettings.contains("image") && !baseLeavesSettings.get("image").toString().empty()) {
-        String baseLeavesFile =
-            AssetPath::relativeTo(config.foliageDirectory, baseLeavesSettings.get("image").toString());
-
-        PlantPiece piece;
-        piece.image = strf("{}?hueshift={}", baseLeavesFile, config.foliageHueShift);
-        piece.offset = Vec2F{xOf, yOf};
-        piece.segmentIdx = segment;
-        piece.structuralSegment = false;
-        piece.kind = PlantPieceKind::Foliage;
-        piece.zLevel = 3.0f;
-        piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-        piece.rotationOffset = Random::randf() + roffset;
-        m_pieces.append(piece);
-      }
+    addPiece(base.image, config.stemHueShift, Vec2F(xOffset, yOffset), true, PlantPieceKind::Stem, 0.0f,
+        DontRotate, Random::randf() + roffset);
 
-      if (baseLeavesSettings.contains("backimage") && !baseLeavesSettings.get("backimage").toString().empty()) {
-        String baseLeavesBackFile =
-            AssetPath::relativeTo(config.foliageDirectory, baseLeavesSettings.get("backimage").toString());
-        PlantPiece piece;
-        piece.image = strf("{}?hueshift={}", baseLeavesBackFile, config.foliageHueShift);
-        piece.offset = Vec2F{xOf, yOf};
-        piece.segmentIdx = segment;
-        piece.structuralSegment = false;
-        piece.kind = PlantPieceKind::Foliage;
-        piece.zLevel = -1.0f;
-        piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-        piece.rotationOffset = Random::randf() + roffset;
-        m_pieces.append(piece);
-      }
-    }
+    // base leaves
+    addLeaves(base, Vec2F(xOffset, yOffset), RotateLeaves, {});
 
-    xOffset += attachmentSettings.get("x").toDouble() / TilePixels;
-    yOffset += attachmentSettings.get("y").toDouble() / TilePixels; // trunk height
+    xOffset += base.offset[0];
+    yOffset += base.offset[1]; // trunk height
 
     segment++;
   }
@@ -161,157 +138,46 @@ Plant::Plant(TreeVariant const& config, uint64_t seed) : Plant() {
 
   // trunk
   {
-    JsonObject middles = config.stemSettings.get("middle").toObject();
-
-    int middleHeight = config.stemSettings.getInt("middleMinSize", 1) + rnd.randInt(config.stemSettings.getInt("middleMaxSize", 6) - config.stemSettings.getInt("middleMinSize", 1));
+    int middleHeight = parts->middleMinSize + rnd.randInt(parts->middleMaxSize - parts->middleMinSize);
 
-    bool hasBranches = config.stemSettings.contains("branch");
-    JsonObject branches;
-    if (hasBranches) {
-      branches = config.stemSettings.get("branch").toObject();
-      if (branches.size() == 0)
-        hasBranches = false;
-    }
+    bool hasBranches = !parts->branches.empty();
 
     for (int i = 0; i < middleHeight; i++) {
-      String middleKey = middles.keys()[rnd.randInt(middles.size() - 1)];
-      JsonObject middleSettings = middles[middleKey].toObject();
-      JsonObject attachmentSettings = middleSettings["attachment"].toObject();
-
-      xOffset += attachmentSettings.get("bx").toDouble() / TilePixels;
-      yOffset += attachmentSettings.get("by").toDouble() / TilePixels;
-
-      String middleFile = AssetPath::relativeTo(config.stemDirectory, middleSettings.get("image").toString());
-
-      {
-        PlantPiece piece;
-        piece.image = strf("{}?hueshift={}", middleFile, config.stemHueShift);
-        piece.offset = Vec2F(xOffset, yOffset);
-        piece.segmentIdx = segment;
-        piece.structuralSegment = true;
-        piece.kind = PlantPieceKind::Stem;
-        piece.zLevel = 1.0f;
-        piece.rotationType = DontRotate;
-        piece.rotationOffset = Random::randf() + roffset;
-        m_pieces.append(piece);
-      }
+      auto const& middle = parts->middles.at(rnd.randInt(parts->middles.size() - 1));
 
-      // trunk leaves
-      JsonObject trunkLeaves = config.foliageSettings.getObject("trunkLeaves", {});
-      if (trunkLeaves.contains(middleKey)) {
-        JsonObject trunkLeavesSettings = trunkLeaves.get(middleKey).toObject();
-        JsonObject attachmentSettings = trunkLeavesSettings["attachment"].toObject();
-
-        float xOf = xOffset + attachmentSettings.get("bx").toDouble() / TilePixels;
-        float yOf = yOffset + attachmentSettings.get("by").toDouble() / TilePixels;
-
-        if (trunkLeavesSettings.contains("image") && !trunkLeavesSettings.get("image").toString().empty()) {
-          String trunkLeavesFile =
-              AssetPath::relativeTo(config.foliageDirectory, trunkLeavesSettings.get("image").toString());
-          PlantPiece piece;
-          piece.image = strf("{}?hueshift={}", trunkLeavesFile, config.foliageHueShift);
-          piece.offset = Vec2F{xOf, yOf};
-          piece.segmentIdx = segment;
-          piece.structuralSegment = false;
-          piece.kind = PlantPieceKind::Foliage;
-          piece.zLevel = 3.0f;
-          piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-          piece.rotationOffset = Random::randf() + roffset;
-          m_pieces.append(piece);
-        }
+      xOffset += middle.baseOffset[0];
+      yOffset += middle.baseOffset[1];
 
-        if (trunkLeavesSettings.contains("backimage") && !trunkLeavesSettings.get("backimage").toString().empty()) {
-          String trunkLeavesBackFile =
-              AssetPath::relativeTo(config.foliageDirectory, trunkLeavesSettings.get("backimage").toString());
-          PlantPiece piece;
-          piece.image = strf("{}?hueshift={}", trunkLeavesBackFile, config.foliageHueShift);
-          piece.offset = Vec2F{xOf, yOf};
-          piece.segmentIdx = segment;
-          piece.structuralSegment = false;
-          piece.kind = PlantPieceKind::Foliage;
-          piece.zLevel = -1.0f;
-          piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-          piece.rotationOffset = Random::randf() + roffset;
-          m_pieces.append(piece);
-        }
-      }
+      addPiece(middle.image, config.stemHueShift, Vec2F(xOffset, yOffset), true, PlantPieceKind::Stem, 1.0f,
+          DontRotate, Random::randf() + roffset);
+
+      // trunk leaves
+      addLeaves(middle, Vec2F(xOffset, yOffset), RotateLeaves, {});
 
-      xOffset += attachmentSettings.get("x").toDouble() / TilePixels;
-      yOffset += attachmentSettings.get("y").toDouble() / TilePixels;
+      xOffset += middle.offset[0];
+      yOffset += middle.offset[1];
 
       // branch
       while (hasBranches && (yOffset >= branchYOffset) && ((middleHeight - i) > 0)) {
-        String branchKey = branches.keys()[rnd.randInt(branches.size() - 1)];
-        JsonObject branchSettings = branches[branchKey].toObject();
-        JsonObject attachmentSettings = branchSettings["attachment"].toObject();
+        auto const& branch = parts->branches.at(rnd.randInt(parts->branches.size() - 1));
 
-        float h = attachmentSettings.get("h").toDouble() / TilePixels;
+        float h = branch.height;
         if (yOffset < branchYOffset + (h / 2.0f))
           break;
 
-        float xO = xOffset + attachmentSettings.get("bx").toDouble() / TilePixels;
-        float yO = branchYOffset + attachmentSettings.get("by").toDouble() / TilePixels;
+        float xO = xOffset + branch.baseOffset[0];
+        float yO = branchYOffset + branch.baseOffset[1];
 
-        if (config.stemSettings.getBool("alwaysBranch", false) || rnd.randInt(2 + i) != 0) {
+        if (parts->alwaysBranch || rnd.randInt(2 + i) != 0) {
           float boffset = Random::randf() + roffset;
-          String branchFile = AssetPath::relativeTo(config.stemDirectory, branchSettings.get("image").toString());
-          {
-            PlantPiece piece;
-            piece.image = strf("{}?hueshift={}", branchFile, config.stemHueShift);
-            piece.offset = Vec2F{xO, yO};
-            piece.segmentIdx = segment;
-            piece.structuralSegment = false;
-            piece.kind = PlantPieceKind::Stem;
-            piece.zLevel = 0.0f;
-            piece.rotationType = m_ceiling ? DontRotate : RotateBranch;
-            piece.rotationOffset = boffset;
-            m_pieces.append(piece);
-          }
+          addPiece(branch.image, config.stemHueShift, Vec2F(xO, yO), false, PlantPieceKind::Stem, 0.0f,
+              m_ceiling ? DontRotate : RotateBranch, boffset);
           branchYOffset += h;
 
           // branch leaves
-          JsonObject branchLeaves = config.foliageSettings.getObject("branchLeaves", {});
-          if (branchLeaves.contains(branchKey)) {
-            JsonObject branchLeavesSettings = branchLeaves.get(branchKey).toObject();
-            JsonObject attachmentSettings = branchLeavesSettings["attachment"].toObject();
-
-            float xOf = xO + attachmentSettings.get("bx").toDouble() / TilePixels;
-            float yOf = yO + attachmentSettings.get("by").toDouble() / TilePixels;
-
-            if (branchLeavesSettings.contains("image") && !branchLeavesSettings.get("image").toString().empty()) {
-              String branchLeavesFile =
-                  AssetPath::relativeTo(config.foliageDirectory, branchLeavesSettings.get("image").toString());
-              PlantPiece piece;
-              piece.image = strf("{}?hueshift={}", branchLeavesFile, config.foliageHueShift);
-              piece.offset = Vec2F{xOf, yOf};
-              piece.segmentIdx = segment;
-              piece.structuralSegment = false;
-              piece.kind = PlantPieceKind::Foliage;
-              piece.zLevel = 3.0f;
-              piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-              piece.rotationOffset = boffset;
-              m_pieces.append(piece);
-            }
-
-            if (branchLeavesSettings.contains("backimage")
-                && !branchLeavesSettings.get("backimage").toString().empty()) {
-              String branchLeavesBackFile =
-                  AssetPath::relativeTo(config.foliageDirectory, branchLeavesSettings.get("backimage").toString());
-              PlantPiece piece;
-              piece.image = strf("{}?hueshift={}", branchLeavesBackFile, config.foliageHueShift);
-              piece.offset = Vec2F{xOf, yOf};
-              piece.segmentIdx = segment;
-              piece.structuralSegment = false;
-              piece.kind = PlantPieceKind::Foliage;
-              piece.zLevel = -1.0f;
-              piece.rotationType = m_ceiling ? DontRotate : RotateLeaves;
-              piece.rotationOffset = boffset;
-              m_pieces.append(piece);
-            }
-          }
-
+          addLeaves(branch, Vec2F(xO, yO), RotateLeaves, boffset);
         } else {
-          branchYOffset += (attachmentSettings.get("h").toDouble() / TilePixels) / (float)(1 + rnd.randInt(4));
+          branchYOffset += h / (float)(1 + rnd.randInt(4));
         }
       }
       segment++;
@@ -319,78 +185,20 @@ Plant::Plant(TreeVariant const& config, uint64_t seed) : Plant() {
   }
 
   // crown
-  {
-    JsonObject crowns = config.stemSettings.getObject("crown", {});
-    bool hasCrown = crowns.size() > 0;
-    if (hasCrown) {
-      String crownKey = crowns.keys()[rnd.randInt(crowns.size() - 1)];
-      JsonObject crownSettings = crowns[crownKey].toObject();
-
-      JsonObject attachmentSettings = crownSettings["attachment"].toObject();
-
-      xOffset += attachmentSettings.get("bx").toDouble() / TilePixels;
-      yOffset += attachmentSettings.get("by").toDouble() / TilePixels;
-
-      float coffset = roffset + Random::randf();
-
-      String crownFile = AssetPath::relativeTo(config.stemDirectory, crownSettings.get("image").toString());
-      {
-        PlantPiece piece;
-        piece.image = strf("{}?hueshift={}", crownFile, config.stemHueShift);
-        piece.offset = Vec2F{xOffset, yOffset};
-        piece.segmentIdx = segment;
-        piece.structuralSegment = false;
-        piece.kind = PlantPieceKind::Stem;
-        piece.zLevel = 0.0f;
-        piece.rotationType = m_ceiling ? DontRotate : RotateCrownBranch;
-        piece.rotationOffset = coffset;
-        m_pieces.append(piece);
-      }
-      // crown leaves
-      JsonObject crownLeaves = config.foliageSettings.getObject("crownLeaves", {});
-      if (crownLeaves.contains(crownKey)) {
-        JsonObject crownLeavesSettings = crownLeaves.get(crownKey).toObject();
-
-        JsonObject attachmentSettings = crownLeavesSettings["attachment"].toObject();
-
-        float xO = xOffset + attachmentSettings.get("bx").toDouble() / TilePixels;
-        float yO = yOffset + attachmentSettings.get("by").toDouble() / TilePixels;
-
-        if (crownLeavesSettings.contains("image") && !crownLeavesSettings.get("image").toString().empty()) {
-          String crownLeavesFile =
-              AssetPath::relativeTo(config.foliageDirectory, crownLeavesSettings.get("image").toString());
-
-          PlantPiece piece;
-          piece.image = strf("{}?hueshift={}", crownLeavesFile, config.foliageHueShift);
-          piece.offset = Vec2F{xO, yO};
-          piece.segmentIdx = segment;
-          piece.structuralSegment = false;
-          piece.kind = PlantPieceKind::Foliage;
-          piece.zLevel = 3.0f;
-          piece.rotationType = m_ceiling ? DontRotate : RotateCrownLeaves;
-          piece.rotationOffset = coffset;
-          m_pieces.append(piece);
-        }
+  if (!parts->crowns.empty()) {
+    auto const& crown = parts->crowns.at(rnd.randInt(parts->crowns.size() - 1));
 
-        if (crownLeavesSettings.contains("backimage") && !crownLeavesSettings.get("backimage").toString().empty()) {
-          String crownLeavesBackFile =
-              AssetPath::relativeTo(config.foliageDirectory, crownLeavesSettings.get("backimage").toString());
-
-          PlantPiece piece;
-          piece.image = strf("{}?hueshift={}", crownLeavesBackFile, config.foliageHueShift);
-          piece.offset = Vec2F{xO, yO};
-          piece.segmentIdx = segment;
-          piece.structuralSegment = false;
-          piece.kind = PlantPieceKind::Foliage;
-          piece.zLevel = -1.0f;
-          piece.rotationType = m_ceiling ? DontRotate : RotateCrownLeaves;
-          piece.rotationOffset = coffset;
-          m_pieces.append(piece);
-        }
-      }
-    }
-  }
+    xOffset += crown.baseOffset[0];
+    yOffset += crown.baseOffset[1];
+
+    float coffset = roffset + Random::randf();
+
+    addPiece(crown.image, config.stemHueShift, Vec2F(xOffset, yOffset), false, PlantPieceKind::Stem, 0.0f,
+        m_ceiling ? DontRotate : RotateCrownBranch, coffset);
 
+    // crown leaves
+    addLeaves(crown, Vec2F(xOffset, yOffset), RotateCrownLeaves, coffset);
+  }
   sort(m_pieces, [](PlantPiece const& a, PlantPiece const& b) { return a.zLevel < b.zLevel; });
   validatePieces();
   setupNetStates();
@@ -483,16 +291,16 @@ Plant::Plant(BushVariant const& config, uint64_t seed) : Plant() {
   m_piecesUpdated = true;
 
   RandomSource rand(seed);
-  auto assets = Root::singleton().assets();
 
   auto shape = rand.randValueFrom(config.shapes);
   String shapeImageName = AssetPath::relativeTo(config.directory, shape.image);
-  float shapeImageHeight = assets->image(shapeImageName)->height();
   Vec2F offset = Vec2F();
   // If this is a ceiling plant, offset the image so that the [0, 0] space is
   // at the top
-  if (config.ceiling)
+  if (config.ceiling) {
+    float shapeImageHeight = Root::singleton().imageMetadataDatabase()->imageSize(shapeImageName)[1];
     offset = Vec2F(0.0f, 1.0f - shapeImageHeight / TilePixels);
+  }
 
   {
     PlantPiece piece;
@@ -739,6 +547,17 @@ void Plant::update(float dt, uint64_t) {
   }
 }
 
+bool Plant::independentUpdate() const {
+  // Plants only sample the wind and recover their own tile damage.
+  return true;
+}
+
+bool Plant::independentRender() const {
+  // Drawables come from the plant's own pieces, and damage effects only use
+  // the thread safe databases.
+  return true;
+}
+
 void Plant::render(RenderCallback* renderCallback) {
   float damageXOffset = Random::randf(-0.1f, 0.1f) * m_tileDamageStatus.damageEffectPercentage();
 
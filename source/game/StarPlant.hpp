@@ -96,6 +96,8 @@ public:
   List<Vec2I> roots() const override;
 
   void update(float dt, uint64_t currentStep) override;
+  bool independentUpdate() const override;
+  bool independentRender() const override;
 
   void render(RenderCallback* renderCallback) override;
 
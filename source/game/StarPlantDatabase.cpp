@@ -2,6 +2,7 @@
 #include "StarPlant.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarAssets.hpp"
+#include "StarImageMetadataDatabase.hpp"
 #include "StarRoot.hpp"
 
 namespace Star {
@@ -45,6 +46,56 @@ Json TreeVariant::toJson() const {
   };
 }
 
+TreeParts::TreeParts(TreeVariant const& variant)
+  : stemSettings(variant.stemSettings), foliageSettings(variant.foliageSettings) {
+  auto imageMetadataDatabase = Root::singleton().imageMetadataDatabase();
+
+  auto readParts = [&](String const& partsName, String const& leavesName) {
+    JsonObject partsSettings = stemSettings.getObject(partsName, {});
+    JsonObject leavesSettings = foliageSettings.getObject(leavesName, {});
+
+    List<Part> parts;
+    for (auto const& key : partsSettings.keys()) {
+      JsonObject settings = partsSettings.get(key).toObject();
+      JsonObject attachment = settings.get("attachment").toObject();
+
+      Part part;
+      part.image = AssetPath::relativeTo(variant.stemDirectory, settings.get("image").toString());
+      part.baseOffset = Vec2F(attachment.get("bx").toDouble(), attachment.get("by").toDouble()) / TilePixels;
+      part.offset = Vec2F(attachment.value("x", 0).toDouble(), attachment.value("y", 0).toDouble()) / TilePixels;
+      part.height = partsName == "branch" ? attachment.get("h").toDouble() / TilePixels : 0.0f;
+      part.imageHeight = partsName == "base" ? imageMetadataDatabase->imageSize(part.image)[1] : 0.0f;
+
+      if (leavesSettings.contains(key)) {
+        JsonObject leafSettings = leavesSettings.get(key).toObject();
+        JsonObject leafAttachment = leafSettings.get("attachment").toObject();
+
+        Leaves leaves;
+        leaves.offset = Vec2F(leafAttachment.get("bx").toDouble(), leafAttachment.get("by").toDouble()) / TilePixels;
+        String image = leafSettings.value("image", "").toString();
+        if (!image.empty())
+          leaves.image = AssetPath::relativeTo(variant.foliageDirectory, image);
+        String backImage = leafSettings.value("backimage", "").toString();
+        if (!backImage.empty())
+          leaves.backImage = AssetPath::relativeTo(variant.foliageDirectory, backImage);
+        part.leaves = std::move(leaves);
+      }
+
+      parts.append(std::move(part));
+    }
+    return parts;
+  };
+
+  bases = readParts("base", "baseLeaves");
+  middles = readParts("middle", "trunkLeaves");
+  branches = readParts("branch", "branchLeaves");
+  crowns = readParts("crown", "crownLeaves");
+
+  middleMinSize = stemSettings.getInt("middleMinSize", 1);
+  middleMaxSize = stemSettings.getInt("middleMaxSize", 6);
+  alwaysBranch = stemSettings.getBool("alwaysBranch", false);
+}
+
 GrassVariant::GrassVariant() : hueShift(), ceiling(), ephemeral() {}
 
 GrassVariant::GrassVariant(Json const& variant) {
@@ -338,6 +389,25 @@ BushVariant PlantDatabase::buildBushVariant(String const& bushName, float baseHu
   return bushVariant;
 }
 
+TreePartsConstPtr PlantDatabase::treeParts(TreeVariant const& treeVariant) const {
+  auto key = make_pair(treeVariant.stemSettings.getString("name", ""), treeVariant.foliageSettings.getString("name", ""));
+
+  TreePartsConstPtr parts;
+  {
+    MutexLocker locker(m_treePartsMutex);
+    parts = m_treeParts.value(key);
+  }
+
+  // Variants stored with a world may have been built from older settings
+  if (parts && parts->stemSettings == treeVariant.stemSettings && parts->foliageSettings == treeVariant.foliageSettings)
+    return parts;
+
+  parts = make_shared<TreeParts const>(treeVariant);
+  MutexLocker locker(m_treePartsMutex);
+  m_treeParts[key] = parts;
+  return parts;
+}
+
 PlantPtr PlantDatabase::createPlant(TreeVariant const& treeVariant, uint64_t seed) const {
   try {
     return make_shared<Plant>(treeVariant, seed);
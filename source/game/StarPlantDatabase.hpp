@@ -3,11 +3,13 @@
 #include "StarJson.hpp"
 #include "StarThread.hpp"
 #include "StarTileDamage.hpp"
+#include "StarVector.hpp"
 
 namespace Star {
 
 STAR_CLASS(Plant);
 STAR_CLASS(PlantDatabase);
+STAR_STRUCT(TreeParts);
 
 STAR_EXCEPTION(PlantDatabaseException, StarException);
 
@@ -40,6 +42,45 @@ struct TreeVariant {
   TileDamageParameters tileDamageParameters;
 };
 
+// The stem and foliage parts a tree variant is assembled from, read out of
+// the variant's settings once and shared by every tree built from them.
+struct TreeParts {
+  struct Leaves {
+    // Offset from the stem part, in tiles
+    Vec2F offset;
+    // Empty if the leaves have no such image
+    String image;
+    String backImage;
+  };
+
+  struct Part {
+    String image;
+    // Offset from the attachment point of the previous part, and of the next
+    // part from this one, in tiles
+    Vec2F baseOffset;
+    Vec2F offset;
+    // Vertical space taken up by a branch, in tiles
+    float height;
+    // Image height in pixels, only looked up for bases
+    float imageHeight;
+    Maybe<Leaves> leaves;
+  };
+
+  TreeParts(TreeVariant const& variant);
+
+  Json stemSettings;
+  Json foliageSettings;
+
+  List<Part> bases;
+  List<Part> middles;
+  List<Part> branches;
+  List<Part> crowns;
+
+  int middleMinSize;
+  int middleMaxSize;
+  bool alwaysBranch;
+};
+
 // Configuration for a specific grass variant
 struct GrassVariant {
   GrassVariant();
@@ -113,6 +154,10 @@ public:
   StringList bushMods(String const& bushName) const;
   BushVariant buildBushVariant(String const& bushName, float baseHueShift, String const& modName, float modHueShift) const;
 
+  // Parts of the given tree variant, cached by stem and foliage for as long
+  // as the variant's settings match the cached ones.
+  TreePartsConstPtr treeParts(TreeVariant const& treeVariant) const;
+
   PlantPtr createPlant(TreeVariant const& treeVariant, uint64_t seed) const;
   PlantPtr createPlant(GrassVariant const& grassVariant, uint64_t seed) const;
   PlantPtr createPlant(BushVariant const& bushVariant, uint64_t seed) const;
@@ -133,6 +178,9 @@ private:
   StringMap<Config> m_grassConfigs;
 
   StringMap<Config> m_bushConfigs;
+
+  mutable Mutex m_treePartsMutex;
+  mutable HashMap<pair<String, String>, TreePartsConstPtr> m_treeParts;
 };
 
 }
@@ -292,6 +292,16 @@ void PlantDrop::particleForPlantPart(PlantDropPiece const& piece, String const&
   }
 }
 
+bool PlantDrop::independentUpdate() const {
+  // Falling plant pieces only move against tile collision and spawn item
+  // drops, neither of which touches another entity.
+  return true;
+}
+
+bool PlantDrop::independentRender() const {
+  return true;
+}
+
 void PlantDrop::render(RenderCallback* renderCallback) {
   auto assets = Root::singleton().assets();
 
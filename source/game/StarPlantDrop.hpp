@@ -44,6 +44,8 @@ public:
   RectF collisionRect() const;
 
   void update(float dt, uint64_t currentStep) override;
+  bool independentUpdate() const override;
+  bool independentRender() const override;
 
   void render(RenderCallback* renderCallback) override;
 
@@ -4,6 +4,10 @@
 #include "StarWorld.hpp"
 #include "StarLiquidTypes.hpp"
 #include "StarJsonExtra.hpp"
+#include "StarRoot.hpp"
+#include "StarConfiguration.hpp"
+#include "StarSmallVector.hpp"
+#include "StarTime.hpp"
 
 namespace Star {
 
@@ -40,12 +44,155 @@ namespace PlatformerAStar {
       CollisionKind::Slippery,
       CollisionKind::Block};
 
+  // Tiles beyond the maximum search distance that a search may still read,
+  // for bound boxes and jump arcs of nodes at the edge.
+  int const SnapshotPadding = 8;
+  // Snapshot regions are aligned to this, so nearby searches can share them.
+  int const SnapshotAlignment = 32;
+  size_t const MaxCachedSnapshots = 16;
+
+  CollisionSnapshot::CollisionSnapshot(World const* world, RectI const& region)
+    : m_geometry(world->geometry()),
+      m_region(region),
+      m_collisionGeneration(world->collisionGeneration(region)),
+      m_createdTime(Time::monotonicTime()) {
+    // A region wider than a wrapping world would cover tiles twice
+    if (m_geometry.width() != 0 && (unsigned)m_region.width() > m_geometry.width())
+      m_region.setXMax(m_region.xMin() + m_geometry.width());
+
+    m_outsideTile = Tile{CollisionKind::Null, EmptyLiquidId, 0.0f, world->gravity(Vec2F(m_region.center()))};
+
+    m_tiles.setSize(Vec2S(m_region.size()));
+    for (int x = 0; x < m_region.width(); ++x) {
+      for (int y = 0; y < m_region.height(); ++y) {
+        Vec2I pos = m_region.min() + Vec2I(x, y);
+        auto liquid = world->liquidLevel(pos);
+        m_tiles(x, y) = Tile{world->tileCollisionKind(pos), liquid.liquid, liquid.level, world->gravity(Vec2F(pos))};
+      }
+    }
+
+    world->forEachCollisionBlock(m_region, [this](CollisionBlock const& block) {
+        for (size_t i = 0; i < block.poly.sides(); ++i) {
+          auto sideDir = block.poly.side(i).direction();
+          if (sideDir[0] != 0 && sideDir[1] != 0) {
+            m_slopedBlocks[m_geometry.xwrap(block.space)].append(block);
+            return;
+          }
+        }
+      });
+  }
+
+  WorldGeometry const& CollisionSnapshot::geometry() const {
+    return m_geometry;
+  }
+
+  RectI const& CollisionSnapshot::region() const {
+    return m_region;
+  }
+
+  uint64_t CollisionSnapshot::collisionGeneration() const {
+    return m_collisionGeneration;
+  }
+
+  double CollisionSnapshot::createdTime() const {
+    return m_createdTime;
+  }
+
+  bool CollisionSnapshot::rectTileCollision(RectI const& region, CollisionSet const& collisionSet) const {
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        if (isColliding(tile({x, y}).collision, collisionSet))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  LiquidLevel CollisionSnapshot::liquidLevel(RectF const& region) const {
+    // Same as WorldImpl::liquidLevel
+    if (region.isEmpty())
+      return LiquidLevel();
+
+    RectI sampleRect = RectI::integral(region);
+    float totalSpace = 0;
+    SmallVector<pair<LiquidId, float>, 4> totals;
+    for (int x = sampleRect.xMin(); x < sampleRect.xMax(); ++x) {
+      for (int y = sampleRect.yMin(); y < sampleRect.yMax(); ++y) {
+        float blockIncidence = RectF(x, y, x + 1, y + 1).overlap(region).volume();
+        totalSpace += blockIncidence;
+        auto const& t = tile({x, y});
+        if (t.liquid != EmptyLiquidId) {
+          auto total = std::find_if(totals.begin(), totals.end(), [&t](auto const& p) { return p.first == t.liquid; });
+          if (total == totals.end())
+            totals.push_back({t.liquid, min(1.0f, t.liquidLevel) * blockIncidence});
+          else
+            total->second += min(1.0f, t.liquidLevel) * blockIncidence;
+        }
+      }
+    }
+
+    float totalLiquidLevel = 0.0f;
+    float maximumLiquidLevel = 0.0f;
+    LiquidId maximumLiquidId = EmptyLiquidId;
+    for (auto const& p : totals) {
+      totalLiquidLevel += p.second;
+      // Ties go to the lowest liquid id, as they do when iterating a Map
+      if (p.second > maximumLiquidLevel || (p.second == maximumLiquidLevel && p.first < maximumLiquidId)) {
+        maximumLiquidLevel = p.second;
+        maximumLiquidId = p.first;
+      }
+    }
+    return LiquidLevel(maximumLiquidId, totalLiquidLevel / totalSpace);
+  }
+
+  float CollisionSnapshot::gravity(Vec2F const& pos) const {
+    return tile(Vec2I::round(pos)).gravity;
+  }
+
+  void CollisionSnapshot::forEachSlopedBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
+    if (m_slopedBlocks.empty())
+      return;
+
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        if (auto blocks = m_slopedBlocks.ptr(m_geometry.xwrap(Vec2I(x, y)))) {
+          for (auto const& block : *blocks)
+            iterator(block);
+        }
+      }
+    }
+  }
+
+  CollisionSnapshot::Tile const& CollisionSnapshot::tile(Vec2I const& pos) const {
+    int x = m_geometry.xwrap(pos[0] - m_region.xMin());
+    int y = pos[1] - m_region.yMin();
+    if (x < 0 || y < 0 || x >= m_region.width() || y >= m_region.height())
+      return m_outsideTile;
+    return m_tiles(x, y);
+  }
+
   PathFinder::PathFinder(World* world,
       Vec2F searchFrom,
       Vec2F searchTo,
       ActorMovementParameters movementParameters,
       Parameters searchParameters)
     : m_world(world),
+      m_geometry(world->geometry()),
+      m_searchFrom(searchFrom),
+      m_searchTo(searchTo),
+      m_movementParams(std::move(movementParameters)),
+      m_searchParams(std::move(searchParameters)) {
+    initAStar();
+  }
+
+  PathFinder::PathFinder(CollisionSnapshotConstPtr snapshot,
+      Vec2F searchFrom,
+      Vec2F searchTo,
+      ActorMovementParameters movementParameters,
+      Parameters searchParameters)
+    : m_world(nullptr),
+      m_snapshot(std::move(snapshot)),
+      m_geometry(m_snapshot->geometry()),
       m_searchFrom(searchFrom),
       m_searchTo(searchTo),
       m_movementParams(std::move(movementParameters)),
@@ -59,6 +206,8 @@ namespace PlatformerAStar {
 
   PathFinder& PathFinder::operator=(PathFinder const& rhs) {
     m_world = rhs.m_world;
+    m_snapshot = rhs.m_snapshot;
+    m_geometry = rhs.m_geometry;
     m_searchFrom = rhs.m_searchFrom;
     m_searchTo = rhs.m_searchTo;
     m_movementParams = rhs.m_movementParams;
@@ -117,7 +266,7 @@ namespace PlatformerAStar {
     // more quickly when there is a route to the target.
     // We don't really care all that much about getting the optimal path as long
     // as we get one that looks feasible, so we deliberately overestimate here.
-    Vec2F diff = m_world->geometry().diff(fromPosition, toPosition);
+    Vec2F diff = m_geometry.diff(fromPosition, toPosition);
     // Manhattan distance * 2:
     return 2.0f * (abs(diff[0]) + abs(diff[1]));
   }
@@ -184,7 +333,7 @@ namespace PlatformerAStar {
     bool slopeUp = false;
     Vec2F forwardGroundPos = direction > 0 ? Vec2F(bounds.xMax(), bounds.yMin()) : Vec2F(bounds.xMin(), bounds.yMin());
     Vec2F backGroundPos = direction < 0 ? Vec2F(bounds.xMax(), bounds.yMin()) : Vec2F(bounds.xMin(), bounds.yMin());
-    m_world->forEachCollisionBlock(groundCollisionRect(node.position, BoundBoxKind::Full).padded(1), [&](CollisionBlock const& block) {
+    forEachCollisionBlock(groundCollisionRect(node.position, BoundBoxKind::Full).padded(1), [&](CollisionBlock const& block) {
       if (slopeUp || slopeDown) return;
       for (size_t i = 0; i < block.poly.sides(); ++i) {
         auto side = block.poly.side(i);
@@ -194,9 +343,9 @@ namespace PlatformerAStar {
         auto upper = side.min()[1] > side.max()[1] ? side.min() : side.max();
         if (sideDir[0] != 0 && sideDir[1] != 0 && (lower[1] == round(forwardGroundPos[1]) || upper[1] == round(forwardGroundPos[1]))) {
           float yDir = (sideDir[1] / sideDir[0]) * direction;
-          if (abs(m_world->geometry().diff(forwardGroundPos, lower)[0]) < 0.5 && yDir > 0)
+          if (abs(m_geometry.diff(forwardGroundPos, lower)[0]) < 0.5 && yDir > 0)
             slopeUp = true;
-          else if (abs(m_world->geometry().diff(backGroundPos, upper)[0]) < 0.5 && yDir < 0)
+          else if (abs(m_geometry.diff(backGroundPos, upper)[0]) < 0.5 && yDir < 0)
             slopeDown = true;
 
           if (slopeUp || slopeDown) break;
@@ -265,7 +414,7 @@ namespace PlatformerAStar {
 
     // Also allow jumping out of the water if we're at the surface:
     RectF box = boundBox(node.position);
-    if (acceleration(node.position)[1] != 0.0f && m_world->liquidLevel(box).level < 1.0f)
+    if (acceleration(node.position)[1] != 0.0f && liquidLevel(box).level < 1.0f)
       getJumpingNeighbors(node, neighbors);
 
     neighbors.filter([this](Edge& edge) -> bool {
@@ -330,7 +479,7 @@ namespace PlatformerAStar {
 
   Vec2F PathFinder::acceleration(Vec2F pos) const {
     auto const& parameters = m_movementParams;
-    float gravity = m_world->gravity(pos) * parameters.gravityMultiplier.value(1.0f);
+    float gravity = this->gravity(pos) * parameters.gravityMultiplier.value(1.0f);
     if (!parameters.gravityEnabled.value(true) || parameters.mass.value(0.0f) == 0.0f)
       gravity = 0.0f;
     float buoyancy = parameters.airBuoyancy.value(0.0f);
@@ -452,7 +601,7 @@ namespace PlatformerAStar {
   }
 
   bool PathFinder::validPosition(Vec2F pos, BoundBoxKind boundKind) const {
-    return !m_world->rectTileCollision(RectI::integral(boundBox(pos, boundKind)), CollisionSolid);
+    return !rectTileCollision(RectI::integral(boundBox(pos, boundKind)), CollisionSolid);
   }
 
   bool PathFinder::onGround(Vec2F pos, BoundBoxKind boundKind) const {
@@ -460,23 +609,23 @@ namespace PlatformerAStar {
     // Check there is something under the feet.
     // We allow walking over the tops of objects (e.g. trapdoors) without being
     // able to float inside objects.
-    if (m_world->rectTileCollision(RectI::integral(boundBox(pos, boundKind)), CollisionDynamic))
+    if (rectTileCollision(RectI::integral(boundBox(pos, boundKind)), CollisionDynamic))
       // We're inside an object. Don't collide with object directly below our
       // feet:
-      return m_world->rectTileCollision(groundRect, CollisionFloorOnly);
+      return rectTileCollision(groundRect, CollisionFloorOnly);
     // Not inside an object, allow colliding with objects below our feet:
     // We need to be for sure above platforms, but can be up to a full tile
     // below the top of solid blocks because rounded collision polys
-    return m_world->rectTileCollision(groundRect, CollisionAny) || m_world->rectTileCollision(groundRect.translated(Vec2I(0, 1)), CollisionSolid);
+    return rectTileCollision(groundRect, CollisionAny) || rectTileCollision(groundRect.translated(Vec2I(0, 1)), CollisionSolid);
   }
 
   bool PathFinder::onSolidGround(Vec2F pos) const {
-    return m_world->rectTileCollision(groundCollisionRect(pos, BoundBoxKind::Drop), CollisionSolid);
+    return rectTileCollision(groundCollisionRect(pos, BoundBoxKind::Drop), CollisionSolid);
   }
 
   bool PathFinder::inLiquid(Vec2F pos) const {
     RectF box = boundBox(pos);
-    return m_world->liquidLevel(box).level >= m_movementParams.minimumLiquidPercentage.value(0.5f);
+    return liquidLevel(box).level >= m_movementParams.minimumLiquidPercentage.value(0.5f);
   }
 
   RectF PathFinder::boundBox(Vec2F pos, BoundBoxKind boundKind) const {
@@ -533,7 +682,169 @@ namespace PlatformerAStar {
   }
 
   float PathFinder::distance(Vec2F a, Vec2F b) const {
-    return m_world->geometry().diff(a, b).magnitude();
+    return m_geometry.diff(a, b).magnitude();
+  }
+
+  bool PathFinder::rectTileCollision(RectI const& region, CollisionSet const& collisionSet) const {
+    if (m_snapshot)
+      return m_snapshot->rectTileCollision(region, collisionSet);
+    return m_world->rectTileCollision(region, collisionSet);
+  }
+
+  LiquidLevel PathFinder::liquidLevel(RectF const& region) const {
+    if (m_snapshot)
+      return m_snapshot->liquidLevel(region);
+    return m_world->liquidLevel(region);
+  }
+
+  float PathFinder::gravity(Vec2F const& pos) const {
+    if (m_snapshot)
+      return m_snapshot->gravity(pos);
+    return m_world->gravity(pos);
+  }
+
+  void PathFinder::forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
+    if (m_snapshot)
+      m_snapshot->forEachSlopedBlock(region, iterator);
+    else
+      m_world->forEachCollisionBlock(region, iterator);
+  }
+
+  // Whether two sets of movement parameters search the same way
+  static bool samePathingParameters(ActorMovementParameters const& a, ActorMovementParameters const& b) {
+    return a.mass == b.mass
+      && a.gravityMultiplier == b.gravityMultiplier
+      && a.gravityEnabled == b.gravityEnabled
+      && a.airBuoyancy == b.airBuoyancy
+      && a.walkSpeed == b.walkSpeed
+      && a.runSpeed == b.runSpeed
+      && a.standingPoly == b.standingPoly
+      && a.minimumLiquidPercentage == b.minimumLiquidPercentage
+      && a.airJumpProfile.jumpSpeed == b.airJumpProfile.jumpSpeed;
+  }
+
+  bool PathFinderService::SearchKey::operator==(SearchKey const& rhs) const {
+    return world == rhs.world
+      && searchFrom == rhs.searchFrom
+      && searchTo == rhs.searchTo
+      && searchParameters == rhs.searchParameters
+      && samePathingParameters(movementParameters, rhs.movementParameters);
+  }
+
+  PathFinderService* PathFinderService::singleton() {
+    static unique_ptr<PathFinderService> service = []() -> unique_ptr<PathFinderService> {
+      auto config = Root::singleton().configuration();
+      unsigned workerCount = config->get("pathFinderWorkers").toUInt();
+      if (workerCount == 0)
+        return {};
+      return make_unique<PathFinderService>(workerCount,
+          config->get("pathFinderSnapshotMaxAge").toDouble(),
+          config->get("pathFinderCacheSize").toUInt(),
+          config->get("pathFinderCacheMaxAge").toDouble());
+    }();
+    return service.get();
+  }
+
+  PathFinderService::PathFinderService(unsigned workerCount, double snapshotMaxAge, size_t pathCacheSize, double pathCacheMaxAge)
+    : m_snapshotMaxAge(snapshotMaxAge),
+      m_pathCacheSize(pathCacheSize),
+      m_pathCacheMaxAge(pathCacheMaxAge),
+      m_workers("PathFinderService", workerCount) {}
+
+  WorkerPoolPromise<Maybe<Path>> PathFinderService::findPath(World* world,
+      Vec2F searchFrom,
+      Vec2F searchTo,
+      ActorMovementParameters const& movementParameters,
+      Parameters const& searchParameters) {
+    SearchKey key{world, Vec2I::round(searchFrom), Vec2I::round(searchTo), movementParameters, searchParameters};
+
+    if (auto path = cachedPath(key))
+      return m_workers.addProducer<Maybe<Path>>([path = path.take()]() -> Maybe<Path> { return path; });
+
+    {
+      MutexLocker locker(m_mutex);
+      m_pending.filter([](PendingSearch const& pending) { return !pending.result.done(); });
+      for (auto const& pending : m_pending) {
+        if (pending.key == key)
+          return pending.result;
+      }
+    }
+
+    int reach = (int)ceil(searchParameters.maxDistance.value(DefaultMaxDistance)) + SnapshotPadding;
+    RectI region = RectI::withCenter(key.searchFrom, Vec2I::filled(reach * 2));
+    region = RectI(
+        Vec2I::floor(Vec2F(region.min()) / SnapshotAlignment) * SnapshotAlignment,
+        Vec2I::ceil(Vec2F(region.max()) / SnapshotAlignment) * SnapshotAlignment);
+
+    auto searchSnapshot = snapshot(world, region);
+    auto pathFinder = make_shared<PathFinder>(searchSnapshot, searchFrom, searchTo, movementParameters, searchParameters);
+    auto result = m_workers.addProducer<Maybe<Path>>([this, key, searchSnapshot, pathFinder]() -> Maybe<Path> {
+        if (!pathFinder->explore().value(false))
+          return {};
+        cachePath(key, *searchSnapshot, *pathFinder->result());
+        return pathFinder->result();
+      });
+
+    MutexLocker locker(m_mutex);
+    m_pending.append(PendingSearch{std::move(key), result});
+    return result;
+  }
+
+  Maybe<Path> PathFinderService::cachedPath(SearchKey const& key) {
+    if (m_pathCacheSize == 0)
+      return {};
+
+    double now = Time::monotonicTime();
+    MutexLocker locker(m_mutex);
+    for (size_t i = 0; i < m_paths.size(); ++i) {
+      auto& cached = m_paths[i];
+      if (!(cached.key == key))
+        continue;
+
+      if (now - cached.createdTime > m_pathCacheMaxAge || key.world->collisionGeneration(cached.region) != cached.collisionGeneration) {
+        m_paths.eraseAt(i);
+        return {};
+      }
+
+      m_paths.append(m_paths.takeAt(i));
+      return m_paths.last().path;
+    }
+    return {};
+  }
+
+  void PathFinderService::cachePath(SearchKey key, CollisionSnapshot const& snapshot, Path path) {
+    if (m_pathCacheSize == 0)
+      return;
+
+    MutexLocker locker(m_mutex);
+    m_paths.filter([&key](CachedPath const& cached) { return !(cached.key == key); });
+    if (m_paths.size() >= m_pathCacheSize)
+      m_paths.eraseAt(0);
+    m_paths.append(CachedPath{std::move(key), snapshot.region(), snapshot.collisionGeneration(), snapshot.createdTime(), std::move(path)});
+  }
+
+  CollisionSnapshotConstPtr PathFinderService::snapshot(World* world, RectI const& region) {
+    double now = Time::monotonicTime();
+    uint64_t generation = world->collisionGeneration(region);
+
+    {
+      MutexLocker locker(m_mutex);
+      m_snapshots.filter([this, now](CachedSnapshot const& cached) {
+          return now - cached.snapshot->createdTime() <= m_snapshotMaxAge;
+        });
+      for (auto const& cached : m_snapshots) {
+        if (cached.world == world && cached.region == region && cached.snapshot->collisionGeneration() == generation)
+          return cached.snapshot;
+      }
+    }
+
+    auto snapshot = make_shared<CollisionSnapshot>(world, region);
+
+    MutexLocker locker(m_mutex);
+    if (m_snapshots.size() >= MaxCachedSnapshots)
+      m_snapshots.eraseAt(0);
+    m_snapshots.append(CachedSnapshot{world, region, snapshot});
+    return snapshot;
   }
 }
 
@@ -5,11 +5,55 @@
 #include "StarWorld.hpp"
 #include "StarActorMovementController.hpp"
 #include "StarPlatformerAStarTypes.hpp"
+#include "StarMultiArray.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarThread.hpp"
 
 namespace Star {
 namespace PlatformerAStar {
 
   STAR_CLASS(PathFinder);
+  STAR_CLASS(CollisionSnapshot);
+  STAR_CLASS(PathFinderService);
+
+  // An immutable copy of the tile collision, liquid and gravity of a world
+  // region, everything a PathFinder reads from the world, so that searches
+  // can run off of the world thread.  Tiles outside of the region read as
+  // null collision.
+  class CollisionSnapshot {
+  public:
+    CollisionSnapshot(World const* world, RectI const& region);
+
+    WorldGeometry const& geometry() const;
+    RectI const& region() const;
+    uint64_t collisionGeneration() const;
+    double createdTime() const;
+
+    bool rectTileCollision(RectI const& region, CollisionSet const& collisionSet) const;
+    LiquidLevel liquidLevel(RectF const& region) const;
+    float gravity(Vec2F const& pos) const;
+    // Only visits collision blocks that have sloped sides, the only ones path
+    // finding looks at.
+    void forEachSlopedBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const;
+
+  private:
+    struct Tile {
+      CollisionKind collision;
+      LiquidId liquid;
+      float liquidLevel;
+      float gravity;
+    };
+
+    Tile const& tile(Vec2I const& pos) const;
+
+    WorldGeometry m_geometry;
+    RectI m_region;
+    uint64_t m_collisionGeneration;
+    double m_createdTime;
+    MultiArray<Tile, 2> m_tiles;
+    Tile m_outsideTile;
+    HashMap<Vec2I, List<CollisionBlock>> m_slopedBlocks;
+  };
 
   class PathFinder {
   public:
@@ -18,6 +62,12 @@ namespace PlatformerAStar {
         Vec2F searchTo,
         ActorMovementParameters movementParameters,
         Parameters searchParameters = Parameters());
+    // Searches only the given snapshot, and so is safe to run on any thread
+    PathFinder(CollisionSnapshotConstPtr snapshot,
+        Vec2F searchFrom,
+        Vec2F searchTo,
+        ActorMovementParameters movementParameters,
+        Parameters searchParameters = Parameters());
 
     // Does not preserve current search state.
     PathFinder(PathFinder const& rhs);
@@ -66,12 +116,92 @@ namespace PlatformerAStar {
     Vec2F roundToNode(Vec2F pos) const;
     float distance(Vec2F a, Vec2F b) const;
 
+    bool rectTileCollision(RectI const& region, CollisionSet const& collisionSet) const;
+    LiquidLevel liquidLevel(RectF const& region) const;
+    float gravity(Vec2F const& pos) const;
+    void forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const;
+
+    // Exactly one of these is set
     World* m_world;
+    CollisionSnapshotConstPtr m_snapshot;
+
+    WorldGeometry m_geometry;
     Vec2F m_searchFrom;
     Vec2F m_searchTo;
     ActorMovementParameters m_movementParams;
     Parameters m_searchParams;
     Maybe<AStar::Search<Edge, Node>> m_astar;
   };
+
+  // Runs path searches on worker threads against collision snapshots.
+  // Identical searches that are in flight at the same time share a single
+  // result, and snapshots are reused between searches in the same area until
+  // the collision there changes or they get too old.  Paths found are kept in
+  // a least recently used cache, so that repeating a search for a common
+  // route costs only a lookup as long as the collision along it is unchanged.
+  class PathFinderService {
+  public:
+    // Uses the pathFinder* root configuration, or returns null when
+    // pathFinderWorkers is 0 and searches should run on the world thread.
+    static PathFinderService* singleton();
+
+    PathFinderService(unsigned workerCount, double snapshotMaxAge, size_t pathCacheSize, double pathCacheMaxAge);
+
+    // Must be called from the thread that updates the world.  The result is
+    // the path found, or nothing if the search failed.
+    WorkerPoolPromise<Maybe<Path>> findPath(World* world,
+        Vec2F searchFrom,
+        Vec2F searchTo,
+        ActorMovementParameters const& movementParameters,
+        Parameters const& searchParameters);
+
+  private:
+    struct SearchKey {
+      bool operator==(SearchKey const& rhs) const;
+
+      World* world;
+      Vec2I searchFrom;
+      Vec2I searchTo;
+      ActorMovementParameters movementParameters;
+      Parameters searchParameters;
+    };
+
+    struct PendingSearch {
+      SearchKey key;
+      WorkerPoolPromise<Maybe<Path>> result;
+    };
+
+    struct CachedSnapshot {
+      World* world;
+      RectI region;
+      CollisionSnapshotConstPtr snapshot;
+    };
+
+    struct CachedPath {
+      SearchKey key;
+      // The path stays valid while the collision generation of the region
+      // searched stays the same
+      RectI region;
+      uint64_t collisionGeneration;
+      double createdTime;
+      Path path;
+    };
+
+    CollisionSnapshotConstPtr snapshot(World* world, RectI const& region);
+    Maybe<Path> cachedPath(SearchKey const& key);
+    void cachePath(SearchKey key, CollisionSnapshot const& snapshot, Path path);
+
+    double m_snapshotMaxAge;
+    size_t m_pathCacheSize;
+    double m_pathCacheMaxAge;
+
+    Mutex m_mutex;
+    List<PendingSearch> m_pending;
+    List<CachedSnapshot> m_snapshots;
+    // Most recently used last
+    List<CachedPath> m_paths;
+
+    WorkerPool m_workers;
+  };
 }
 }
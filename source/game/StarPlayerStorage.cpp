@@ -13,6 +13,9 @@
 namespace Star {
 
 PlayerStorage::PlayerStorage(String const& storageDir) {
+  m_stopWriting = false;
+  m_writeThread = Thread::invoke("PlayerStorage::writeLoop", [this]() { writeLoop(); });
+
   m_storageDirectory = storageDir;
   m_backupDirectory = File::relativeTo(m_storageDirectory, "backup");
   if (!File::isDirectory(m_storageDirectory)) {
@@ -96,6 +99,13 @@ PlayerStorage::PlayerStorage(String const& storageDir) {
 }
 
 PlayerStorage::~PlayerStorage() {
+  {
+    MutexLocker locker(m_writeMutex);
+    m_stopWriting = true;
+    m_writeCondition.broadcast();
+  }
+  m_writeThread.finish();
+
   writeMetadata();
 }
 
@@ -157,9 +167,6 @@ List<Uuid> PlayerStorage::playerUuidListByName(String const& name, Maybe<Uuid> e
 
 
 Json PlayerStorage::savePlayer(PlayerPtr const& player) {
-  auto entityFactory = Root::singleton().entityFactory();
-  auto versioningDatabase = Root::singleton().versioningDatabase();
-
   RecursiveMutexLocker locker(m_mutex);
 
   auto uuid = player->uuid();
@@ -170,10 +177,9 @@ Json PlayerStorage::savePlayer(PlayerPtr const& player) {
   auto newPlayerData = player->diskStore();
   if (playerCacheData != newPlayerData) {
     playerCacheData = newPlayerData;
-    VersionedJson versionedJson = entityFactory->storeVersionedJson(EntityType::Player, playerCacheData);
-    auto fileName = strf("{}.player", uuidFileName(uuid));
-    VersionedJson::writeFile(versionedJson, File::relativeTo(m_storageDirectory, fileName));
-    Logger::debug("Saved player {} to {}", Text::stripEscapeCodes(player->name()), fileName);
+    MutexLocker writeLocker(m_writeMutex);
+    queuedWrite(uuid).playerData = newPlayerData;
+    m_writeCondition.broadcast();
   }
   return newPlayerData;
 }
@@ -217,6 +223,12 @@ void PlayerStorage::deletePlayer(Uuid const& uuid) {
 
   m_savedPlayersCache.remove(uuid);
 
+  {
+    MutexLocker writeLocker(m_writeMutex);
+    m_pendingWrites.filter([&](PendingWrite const& write) { return write.uuid != uuid; });
+  }
+  waitForWrites(uuid);
+
   auto uuidHex = uuid.hex();
   auto storagePrefix = File::relativeTo(m_storageDirectory, uuidHex);
   auto backupPrefix = File::relativeTo(m_backupDirectory, uuidHex);
@@ -244,6 +256,8 @@ WorldChunks PlayerStorage::loadShipData(Uuid const& uuid) {
   if (!m_savedPlayersCache.contains(uuid))
     throw PlayerException(strf("No such stored player with uuid '{}'", uuid.hex()));
 
+  waitForWrites(uuid);
+
   String filename = File::relativeTo(m_storageDirectory, strf("{}.shipworld", uuidFileName(uuid)));
   try {
     if (File::exists(filename))
@@ -263,8 +277,12 @@ void PlayerStorage::applyShipUpdates(Uuid const& uuid, WorldChunks const& update
 
   if (updates.empty())
     return;
-  String filePath = File::relativeTo(m_storageDirectory, strf("{}.shipworld", uuidFileName(uuid)));
-  WorldStorage::applyWorldChunksUpdateToFile(filePath, updates);
+
+  MutexLocker writeLocker(m_writeMutex);
+  auto& shipUpdates = queuedWrite(uuid).shipUpdates;
+  for (auto const& pair : updates)
+    shipUpdates[pair.first] = pair.second;
+  m_writeCondition.broadcast();
 }
 
 void PlayerStorage::moveToFront(Uuid const& uuid) {
@@ -274,21 +292,19 @@ void PlayerStorage::moveToFront(Uuid const& uuid) {
 
 void PlayerStorage::backupCycle(Uuid const& uuid) {
   RecursiveMutexLocker locker(m_mutex);
+  String fileName = uuidFileName(uuid);
 
-  auto configuration = Root::singleton().configuration();
-  unsigned playerBackupFileCount = configuration->get("playerBackupFileCount").toUInt();
-  auto& fileName = uuidFileName(uuid);
-
-  auto path = [&](String const& dir, String const& extension) {
-    return File::relativeTo(dir, strf("{}.{}", fileName, extension));
-  };
-
-  if (!File::isDirectory(m_backupDirectory))
-    File::makeDirectory(m_backupDirectory);
+  // The backup copies the files as of every write queued before it, and any
+  // later changes are written after it
+  MutexLocker writeLocker(m_writeMutex);
+  m_pendingWrites.append(PendingWrite{uuid, std::move(fileName), true, {}, {}});
+  m_writeCondition.broadcast();
+}
 
-  File::backupFileInSequence(path(m_storageDirectory, "player"), path(m_backupDirectory, "player"), playerBackupFileCount, ".bak");
-  File::backupFileInSequence(path(m_storageDirectory, "shipworld"), path(m_backupDirectory, "shipworld"), playerBackupFileCount, ".bak");
-  File::backupFileInSequence(path(m_storageDirectory, "metadata"), path(m_backupDirectory, "metadata"), playerBackupFileCount, ".bak");
+void PlayerStorage::flush() {
+  MutexLocker locker(m_writeMutex);
+  while (!m_pendingWrites.empty() || m_writingPlayer)
+    m_writeCondition.wait(m_writeMutex);
 }
 
 void PlayerStorage::setMetadata(String key, Json value) {
@@ -312,6 +328,71 @@ String const& PlayerStorage::uuidFileName(Uuid const& uuid) {
   }
 }
 
+auto PlayerStorage::queuedWrite(Uuid const& uuid) -> PendingWrite& {
+  for (auto i = m_pendingWrites.rbegin(); i != m_pendingWrites.rend(); ++i) {
+    if (i->uuid == uuid)
+      return *i;
+  }
+  m_pendingWrites.append(PendingWrite{uuid, uuidFileName(uuid), false, {}, {}});
+  return m_pendingWrites.last();
+}
+
+void PlayerStorage::waitForWrites(Uuid const& uuid) {
+  MutexLocker locker(m_writeMutex);
+  while (m_writingPlayer == uuid || m_pendingWrites.any([&](PendingWrite const& write) { return write.uuid == uuid; }))
+    m_writeCondition.wait(m_writeMutex);
+}
+
+void PlayerStorage::writeLoop() {
+  MutexLocker locker(m_writeMutex);
+  while (true) {
+    if (m_pendingWrites.empty()) {
+      if (m_stopWriting)
+        break;
+      m_writeCondition.wait(m_writeMutex);
+      continue;
+    }
+
+    PendingWrite write = m_pendingWrites.takeFirst();
+    m_writingPlayer = write.uuid;
+    locker.unlock();
+    try {
+      performWrite(write);
+    } catch (std::exception const& e) {
+      Logger::error("Error writing player files for {}: {}", write.fileName, outputException(e, true));
+    }
+    locker.lock();
+    m_writingPlayer.reset();
+    m_writeCondition.broadcast();
+  }
+}
+
+void PlayerStorage::performWrite(PendingWrite const& write) {
+  auto path = [&](String const& dir, String const& extension) {
+    return File::relativeTo(dir, strf("{}.{}", write.fileName, extension));
+  };
+
+  if (write.backup) {
+    unsigned playerBackupFileCount = Root::singleton().configuration()->get("playerBackupFileCount").toUInt();
+    if (!File::isDirectory(m_backupDirectory))
+      File::makeDirectory(m_backupDirectory);
+
+    File::backupFileInSequence(path(m_storageDirectory, "player"), path(m_backupDirectory, "player"), playerBackupFileCount, ".bak");
+    File::backupFileInSequence(path(m_storageDirectory, "shipworld"), path(m_backupDirectory, "shipworld"), playerBackupFileCount, ".bak");
+    File::backupFileInSequence(path(m_storageDirectory, "metadata"), path(m_backupDirectory, "metadata"), playerBackupFileCount, ".bak");
+  }
+
+  if (write.playerData) {
+    VersionedJson versionedJson = Root::singleton().entityFactory()->storeVersionedJson(EntityType::Player, *write.playerData);
+    bool compact = Root::singleton().assets()->json("/player.config").getBool("compactStorage", false);
+    VersionedJson::writeFile(versionedJson, path(m_storageDirectory, "player"), compact);
+    Logger::debug("Saved player to {}.player", write.fileName);
+  }
+
+  if (!write.shipUpdates.empty())
+    WorldStorage::applyWorldChunksUpdateToFile(path(m_storageDirectory, "shipworld"), write.shipUpdates);
+}
+
 void PlayerStorage::writeMetadata() {
   JsonArray order;
   for (auto const& p : m_savedPlayersCache)
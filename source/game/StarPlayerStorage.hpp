@@ -9,6 +9,11 @@
 
 namespace Star {
 
+// Player and ship files are written by a background thread, so that saving
+// does not stall the caller.  Writes queued for a player before the thread
+// gets to them are coalesced, only the latest player data is written and ship
+// updates are merged.  Reading a player's ship, deleting a player or
+// destroying the storage first waits for the player's queued writes.
 class PlayerStorage {
 public:
   PlayerStorage(String const& storageDir);
@@ -22,7 +27,8 @@ public:
   // Returns nothing if name doesn't match a player.
   List<Uuid> playerUuidListByName(String const& name, Maybe<Uuid> except = {});
 
-  // Also returns the diskStore Json if needed.
+  // Also returns the diskStore Json if needed.  The player is only written if
+  // it has changed since it was last saved.
   Json savePlayer(PlayerPtr const& player);
 
   Maybe<Json> maybeGetPlayerData(Uuid const& uuid);
@@ -40,20 +46,48 @@ public:
   // files for however many backups are configured
   void backupCycle(Uuid const& uuid);
 
+  // Waits until every queued write has been written to disk
+  void flush();
+
   // Get / Set PlayerStorage global metadata
   void setMetadata(String key, Json value);
   Json getMetadata(String const& key);
 
 private:
+  struct PendingWrite {
+    Uuid uuid;
+    String fileName;
+    // Copy the player's files to backups before the rest of the write
+    bool backup;
+    Maybe<Json> playerData;
+    WorldChunks shipUpdates;
+  };
+
   String const& uuidFileName(Uuid const& uuid);
   void writeMetadata();
 
+  // The write that the player's next changes should be coalesced into, must
+  // be called with both m_mutex and m_writeMutex held
+  PendingWrite& queuedWrite(Uuid const& uuid);
+  // Waits until no writes for the given player are queued or running
+  void waitForWrites(Uuid const& uuid);
+  void writeLoop();
+  void performWrite(PendingWrite const& write);
+
   mutable RecursiveMutex m_mutex;
   String m_storageDirectory;
   String m_backupDirectory;
   OrderedHashMap<Uuid, Json> m_savedPlayersCache;
   BiMap<Uuid, String> m_playerFileNames;
   JsonObject m_metadata;
+
+  Mutex m_writeMutex;
+  // Signaled when a write is queued and when one finishes
+  ConditionVariable m_writeCondition;
+  Deque<PendingWrite> m_pendingWrites;
+  Maybe<Uuid> m_writingPlayer;
+  bool m_stopWriting;
+  ThreadFunction<void> m_writeThread;
 };
 
 }
@@ -0,0 +1,81 @@
+#include "StarPreloadManifest.hpp"
+#include "StarJsonExtra.hpp"
+#include "StarRoot.hpp"
+#include "StarAssets.hpp"
+#include "StarObjectDatabase.hpp"
+#include "StarItemDatabase.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+void PreloadManifest::startRecording() {
+  auto& root = Root::singleton();
+  root.assets()->setRecordJsonLoads(true);
+  root.objectDatabase()->setRecordConfigLoads(true);
+  root.itemDatabase()->setRecordConfigLoads(true);
+}
+
+PreloadManifest PreloadManifest::recorded() {
+  auto& root = Root::singleton();
+  PreloadManifest manifest;
+  manifest.jsonAssets = root.assets()->recordedJsonLoads().sorted();
+  manifest.objects = root.objectDatabase()->recordedConfigLoads().sorted();
+  manifest.items = root.itemDatabase()->recordedConfigLoads().sorted();
+  return manifest;
+}
+
+PreloadManifest PreloadManifest::fromJson(Json const& json) {
+  PreloadManifest manifest;
+  manifest.jsonAssets = jsonToStringList(json.get("jsonAssets", JsonArray()));
+  manifest.objects = jsonToStringList(json.get("objects", JsonArray()));
+  manifest.items = jsonToStringList(json.get("items", JsonArray()));
+  return manifest;
+}
+
+Json PreloadManifest::toJson() const {
+  return JsonObject{
+    {"jsonAssets", jsonFromStringList(jsonAssets)},
+    {"objects", jsonFromStringList(objects)},
+    {"items", jsonFromStringList(items)}
+  };
+}
+
+void PreloadManifest::preload(unsigned threadCount) const {
+  auto& root = Root::singleton();
+  auto assets = root.assets();
+  auto objectDatabase = root.objectDatabase();
+  auto itemDatabase = root.itemDatabase();
+
+  auto startTime = Time::monotonicTime();
+  WorkerPool workerPool("PreloadManifest", max(threadCount, 1u));
+
+  // Object configs and item builders load json of their own, so the plain
+  // json assets go first to keep the other jobs from waiting on them.
+  auto preloadAll = [&workerPool](StringList const& names, function<void(String const&)> load) {
+    List<WorkerPoolHandle> handles;
+    for (auto const& name : names) {
+      handles.append(workerPool.addWork([name, load]() {
+          try {
+            load(name);
+          } catch (std::exception const& e) {
+            Logger::debug("Could not preload '{}': {}", name, outputException(e, false));
+          }
+        }));
+    }
+    for (auto const& handle : handles)
+      handle.finish();
+  };
+
+  preloadAll(jsonAssets, [&assets](String const& path) { assets->persistJson(path); });
+  preloadAll(objects, [&objectDatabase](String const& name) { objectDatabase->persistConfig(name); });
+  // Builder scripts are run while holding the item database's lua lock, so
+  // this mostly just compiles each builder once ahead of time.
+  preloadAll(items, [&itemDatabase](String const& name) { itemDatabase->itemConfig(name, JsonObject()); });
+
+  workerPool.finish();
+  Logger::info("Preloaded {} json assets, {} objects and {} items in {:.2f}s",
+      jsonAssets.size(), objects.size(), items.size(), Time::monotonicTime() - startTime);
+}
+
+}
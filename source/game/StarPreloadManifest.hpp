@@ -0,0 +1,31 @@
+#pragma once
+
+#include "StarJson.hpp"
+
+namespace Star {
+
+STAR_STRUCT(PreloadManifest);
+
+// The json assets, objects, and items that a server loaded while it ran.  A
+// later run loads the same ones before accepting connections, instead of
+// loading them inside world threads the first time each one is used.
+struct PreloadManifest {
+  // Starts recording everything loaded by the current Root's assets and
+  // databases from here on.
+  static void startRecording();
+  // Everything recorded since startRecording.
+  static PreloadManifest recorded();
+
+  static PreloadManifest fromJson(Json const& json);
+  Json toJson() const;
+
+  // Loads everything in the manifest using the given number of threads, and
+  // keeps it loaded.  Anything that no longer exists is skipped.
+  void preload(unsigned threadCount) const;
+
+  StringList jsonAssets;
+  StringList objects;
+  StringList items;
+};
+
+}
@@ -949,10 +949,11 @@ void Projectile::setup() {
   m_hydrophobic = m_parameters.getBool("hydrophobic", m_config->hydrophobic);
   m_onlyHitTerrain = m_parameters.getBool("onlyHitTerrain", m_config->onlyHitTerrain);
 
-  auto movementSettings = jsonMerge(m_config->movementSettings, m_parameters.get("movementSettings", Json()));
-  if (!movementSettings.contains("physicsEffectCategories"))
-    movementSettings = movementSettings.set("physicsEffectCategories", JsonArray{"projectile"});
-  m_movementController = make_shared<MovementController>(movementSettings);
+  auto movementSettings = m_parameters.get("movementSettings", Json());
+  if (movementSettings.isNull())
+    m_movementController = make_shared<MovementController>(m_config->movementParameters);
+  else
+    m_movementController = make_shared<MovementController>(MovementParameters(defaultMovementSettings(jsonMerge(m_config->movementSettings, movementSettings))));
 
   m_effectEmitter = make_shared<EffectEmitter>();
 
@@ -994,6 +995,12 @@ void Projectile::setup() {
   m_netGroup.addNetElement(m_effectEmitter.get());
 }
 
+Json Projectile::defaultMovementSettings(Json movementSettings) {
+  if (!movementSettings.contains("physicsEffectCategories"))
+    movementSettings = movementSettings.set("physicsEffectCategories", JsonArray{"projectile"});
+  return movementSettings;
+}
+
 LuaCallbacks Projectile::makeProjectileCallbacks() {
   LuaCallbacks callbacks;
   callbacks.registerCallback("getParameter", [this](String const& name, Json const& def) {
@@ -21,6 +21,9 @@ STAR_CLASS(Projectile);
 
 class Projectile : public virtual Entity, public virtual ScriptedEntity, public virtual PhysicsEntity, public virtual StatusEffectEntity {
 public:
+  // Applies the projectile defaults to merged movement settings.
+  static Json defaultMovementSettings(Json movementSettings);
+
   Projectile(ProjectileConfigPtr const& config, Json const& parameters);
   Projectile(ProjectileConfigPtr const& config, DataStreamBuffer& netState, NetCompatibilityRules rules = {});
 
@@ -83,6 +83,7 @@ ProjectileConfigPtr ProjectileDatabase::readConfig(String const& path) {
   JsonObject movementSettings = config.getObject("movementSettings", JsonObject());
   projectileConfig->movementSettings =
       jsonMerge(assets->json(strf("/projectiles/physics.config:{}", physicsType)), movementSettings);
+  projectileConfig->movementParameters = MovementParameters(Projectile::defaultMovementSettings(projectileConfig->movementSettings));
 
   projectileConfig->initialSpeed = config.getFloat("speed", 50);
   projectileConfig->acceleration = config.getFloat("acceleration", 0);
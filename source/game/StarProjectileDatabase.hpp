@@ -23,6 +23,9 @@ struct ProjectileConfig {
   RectF boundBox;
 
   Json movementSettings;
+  // movementSettings parsed once per projectile type, used by every
+  // projectile that does not override movementSettings in its parameters.
+  MovementParameters movementParameters;
   float timeToLive = 0.0f;
   float initialSpeed = 0.0f;
   float acceleration = 0.0f;
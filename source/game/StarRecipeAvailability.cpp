@@ -0,0 +1,82 @@
+#include "StarRecipeAvailability.hpp"
+#include "StarItemDatabase.hpp"
+
+namespace Star {
+
+RecipeAvailability::RecipeAvailability(HashSet<ItemRecipe> const& recipes, StringSet const& allowedTypes)
+  : m_updated(false) {
+  for (auto const& recipe : recipes) {
+    if (!ItemDatabase::recipeAllowed(recipe, allowedTypes))
+      continue;
+
+    size_t index = m_recipes.size();
+    m_recipes.append(recipe);
+
+    StringSet ingredients;
+    for (auto const& input : recipe.inputs)
+      ingredients.add(input.name());
+    for (auto const& ingredient : ingredients)
+      m_recipesByIngredient[ingredient].append(index);
+    for (auto const& pair : recipe.currencyInputs)
+      m_recipesByCurrency[pair.first].append(index);
+  }
+}
+
+bool RecipeAvailability::update(HashMap<ItemDescriptor, uint64_t> const& normalizedBag, StringMap<uint64_t> const& availableCurrencies) {
+  bool changed = false;
+
+  if (!m_updated) {
+    m_bag = normalizedBag;
+    m_currencies = availableCurrencies;
+    m_updated = true;
+    for (size_t i = 0; i < m_recipes.size(); ++i)
+      check(i, changed);
+    // The first update always reports a change, even when nothing can be made
+    return true;
+  }
+
+  HashSet<size_t> toCheck;
+  auto addRecipes = [&](StringMap<List<size_t>> const& index, String const& name) {
+    if (auto recipes = index.ptr(name))
+      toCheck.addAll(*recipes);
+  };
+
+  for (auto const& pair : normalizedBag) {
+    if (m_bag.value(pair.first) != pair.second)
+      addRecipes(m_recipesByIngredient, pair.first.name());
+  }
+  for (auto const& pair : m_bag) {
+    if (!normalizedBag.contains(pair.first))
+      addRecipes(m_recipesByIngredient, pair.first.name());
+  }
+
+  for (auto const& pair : availableCurrencies) {
+    if (m_currencies.value(pair.first) != pair.second)
+      addRecipes(m_recipesByCurrency, pair.first);
+  }
+  for (auto const& pair : m_currencies) {
+    if (!availableCurrencies.contains(pair.first))
+      addRecipes(m_recipesByCurrency, pair.first);
+  }
+
+  m_bag = normalizedBag;
+  m_currencies = availableCurrencies;
+  for (size_t index : toCheck)
+    check(index, changed);
+
+  return changed;
+}
+
+HashSet<ItemRecipe> const& RecipeAvailability::available() const {
+  return m_available;
+}
+
+void RecipeAvailability::check(size_t recipeIndex, bool& changed) {
+  auto const& recipe = m_recipes[recipeIndex];
+  if (ItemDatabase::canMakeRecipe(recipe, m_bag, m_currencies))
+    changed |= m_available.add(recipe);
+  else
+    changed |= m_available.remove(recipe);
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "StarItemRecipe.hpp"
+
+namespace Star {
+
+// Tracks which of a fixed set of recipes can be made from a bag of items that
+// changes over time.  Each update only rechecks the recipes that use an item
+// or currency whose count changed since the last update, rather than every
+// recipe in the set.
+class RecipeAvailability {
+public:
+  // Only recipes of a kind allowed by the given types are tracked, as with
+  // ItemDatabase::recipesFromSubset
+  RecipeAvailability(HashSet<ItemRecipe> const& recipes, StringSet const& allowedTypes = {});
+
+  // Takes a bag normalized by ItemDatabase::normalizeBag.  Returns true if
+  // the set of recipes that can be made changed.
+  bool update(HashMap<ItemDescriptor, uint64_t> const& normalizedBag, StringMap<uint64_t> const& availableCurrencies);
+
+  HashSet<ItemRecipe> const& available() const;
+
+private:
+  void check(size_t recipeIndex, bool& changed);
+
+  List<ItemRecipe> m_recipes;
+  StringMap<List<size_t>> m_recipesByIngredient;
+  StringMap<List<size_t>> m_recipesByCurrency;
+
+  bool m_updated;
+  HashMap<ItemDescriptor, uint64_t> m_bag;
+  StringMap<uint64_t> m_currencies;
+  HashSet<ItemRecipe> m_available;
+};
+
+}
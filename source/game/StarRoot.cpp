@@ -87,9 +87,16 @@ Root::Root(Settings settings) : RootBase() {
       File::makeDirectory(oldLogDirectory);
 
     File::backupFileInSequence(logFile, File::relativeTo(oldLogDirectory, *m_settings.logFile), m_settings.logFileBackups);
-    Logger::addSink(make_shared<FileLogSink>(logFile, m_settings.logLevel, true));
+    LogSinkPtr fileSink = make_shared<FileLogSink>(logFile, m_settings.logLevel, true);
+    if (m_settings.asyncLogging) {
+      m_asyncLogSink = make_shared<AsyncLogSink>(fileSink);
+      Logger::addSink(m_asyncLogSink);
+    } else {
+      Logger::addSink(fileSink);
+    }
   }
   Logger::stdoutSink()->setLevel(m_settings.logLevel);
+  Logger::setRateLimit(m_settings.logRateLimit);
 
   if (m_settings.quiet)
     Logger::removeStdoutSink();
@@ -104,42 +111,42 @@ Root::Root(Settings settings) : RootBase() {
 
         {
           MutexLocker locker(m_objectDatabaseMutex);
-          if (ObjectDatabasePtr objectDb = m_objectDatabase) {
+          if (ObjectDatabasePtr objectDb = m_objectDatabase.load()) {
             locker.unlock();
             objectDb->cleanup();
           }
         }
         {
           MutexLocker locker(m_itemDatabaseMutex);
-          if (ItemDatabasePtr itemDb = m_itemDatabase) {
+          if (ItemDatabasePtr itemDb = m_itemDatabase.load()) {
             locker.unlock();
             itemDb->cleanup();
           }
         }
         {
           MutexLocker locker(m_monsterDatabaseMutex);
-          if (MonsterDatabasePtr monsterDb = m_monsterDatabase) {
+          if (MonsterDatabasePtr monsterDb = m_monsterDatabase.load()) {
             locker.unlock();
             monsterDb->cleanup();
           }
         }
         {
           MutexLocker locker(m_assetsMutex);
-          if (AssetsPtr assets = m_assets) {
+          if (AssetsPtr assets = m_assets.load()) {
             locker.unlock();
             assets->cleanup();
           }
         }
         {
           MutexLocker locker(m_tenantDatabaseMutex);
-          if (TenantDatabasePtr tenantDb = m_tenantDatabase) {
+          if (TenantDatabasePtr tenantDb = m_tenantDatabase.load()) {
             locker.unlock();
             tenantDb->cleanup();
           }
         }
         {
           MutexLocker locker(m_imageMetadataDatabaseMutex);
-          if (ImageMetadataDatabasePtr imgMetaDb = m_imageMetadataDatabase) {
+          if (ImageMetadataDatabasePtr imgMetaDb = m_imageMetadataDatabase.load()) {
             locker.unlock();
             imgMetaDb->cleanup();
           }
@@ -174,11 +181,78 @@ Root::~Root() {
   writeConfig();
 
   s_singleton.store(nullptr);
+
+  // Write the log file directly again once Root is gone, rather than from a
+  // thread that would otherwise only be stopped during static destruction.
+  if (m_asyncLogSink) {
+    LogSinkPtr fileSink = m_asyncLogSink->target();
+    Logger::removeSink(m_asyncLogSink);
+    m_asyncLogSink.reset();
+    Logger::addSink(fileSink);
+  }
 }
 
 void Root::reload() {
   Logger::info("Root: Reloading from disk");
+  resetMembers([](char const*) { return true; }, {});
+  m_reloadListeners.trigger();
+}
+
+void Root::reloadChanged(StringSet changedPaths) {
+  AssetsPtr oldAssets;
+  {
+    MutexLocker assetsLocker(m_assetsMutex);
+    oldAssets = m_assets.load();
+  }
+  if (!oldAssets)
+    return reload();
+
+  Logger::info("Root: Reloading members affected by changed assets");
+  auto startSeconds = Time::monotonicTime();
+
+  // The new assets are built before anything is reset, so that they can be
+  // compared against the old ones.
+  AssetsPtr newAssets = makeAssets();
+  changedPaths.addAll(newAssets->differingFiles(*oldAssets));
 
+  StringSet affected;
+  {
+    MutexLocker dependenciesLocker(m_memberDependenciesMutex);
+    for (auto const& p : m_memberDependencies) {
+      // Assets and Configuration are not rebuilt this way, and nothing keeps
+      // hold of the Assets, so using them does not make a member affected.
+      if (p.first == "Assets" || p.first == "Configuration")
+        continue;
+      for (auto const& path : changedPaths) {
+        if (p.second.assets.dependsOn(path)) {
+          affected.add(p.first);
+          break;
+        }
+      }
+    }
+
+    // Members that used an affected member while loading may have kept hold
+    // of it, so they are rebuilt as well.
+    bool grew = true;
+    while (grew) {
+      grew = false;
+      for (auto const& p : m_memberDependencies) {
+        if (!affected.contains(p.first) && p.second.members.hasIntersection(affected)) {
+          affected.add(p.first);
+          grew = true;
+        }
+      }
+    }
+  }
+
+  resetMembers([&affected](char const* name) { return affected.contains(name); }, std::move(newAssets));
+  Logger::info("Root: {} changed files affected {} in {} seconds", changedPaths.size(),
+      affected.empty() ? String("nothing") : StringList(affected.values()).sorted().join(", "), Time::monotonicTime() - startSeconds);
+
+  m_reloadListeners.trigger();
+}
+
+void Root::resetMembers(function<bool(char const*)> shouldReset, AssetsPtr newAssets) {
   {
     // We need to lock all the mutexes to reset everything to cause it to be
     // reloaded, but whenever we lock individual members we should always do it
@@ -255,51 +329,105 @@ void Root::reload() {
     MutexLocker configurationLock(m_configurationMutex);
     MutexLocker assetsLock(m_assetsMutex);
 
-    writeConfig();
-
-    m_entityFactory.reset();
-    m_speciesDatabase.reset();
-    m_itemDatabase.reset();
-    m_objectDatabase.reset();
-    m_playerFactory.reset();
-    m_stagehandDatabase.reset();
-    m_vehicleDatabase.reset();
-    m_npcDatabase.reset();
-    m_monsterDatabase.reset();
-    m_plantDatabase.reset();
-    m_projectileDatabase.reset();
-    m_biomeDatabase.reset();
-    m_dungeonDefinitions.reset();
-    m_tilesetDatabase.reset();
-    m_statisticsDatabase.reset();
-    m_liquidsDatabase.reset();
-    m_materialDatabase.reset();
-    m_damageDatabase.reset();
-    m_effectSourceDatabase.reset();
-    m_statusEffectDatabase.reset();
-    m_treasureDatabase.reset();
-    m_codexDatabase.reset();
-    m_behaviorDatabase.reset();
-    m_techDatabase.reset();
-    m_aiDatabase.reset();
-    m_questTemplateDatabase.reset();
-    m_emoteProcessor.reset();
-    m_terrainDatabase.reset();
-    m_particleDatabase.reset();
-    m_versioningDatabase.reset();
-    m_functionDatabase.reset();
-    m_imageMetadataDatabase.reset();
-    m_tenantDatabase.reset();
-    m_nameGenerator.reset();
-    m_danceDatabase.reset();
-    m_spawnTypeDatabase.reset();
-    m_radioMessageDatabase.reset();
-    m_collectionDatabase.reset();
-    m_assets.reset();
-    m_configuration.reset();
+    auto resetMember = [&](auto& member, char const* name) {
+      if (shouldReset(name))
+        member.reset();
+    };
+
+    resetMember(m_entityFactory, "EntityFactory");
+    resetMember(m_speciesDatabase, "SpeciesDatabase");
+    resetMember(m_itemDatabase, "ItemDatabase");
+    resetMember(m_objectDatabase, "ObjectDatabase");
+    resetMember(m_playerFactory, "PlayerFactory");
+    resetMember(m_stagehandDatabase, "StagehandDatabase");
+    resetMember(m_vehicleDatabase, "VehicleDatabase");
+    resetMember(m_npcDatabase, "NpcDatabase");
+    resetMember(m_monsterDatabase, "MonsterDatabase");
+    resetMember(m_plantDatabase, "PlantDatabase");
+    resetMember(m_projectileDatabase, "ProjectileDatabase");
+    resetMember(m_biomeDatabase, "BiomeDatabase");
+    resetMember(m_dungeonDefinitions, "DungeonDefinitions");
+    resetMember(m_tilesetDatabase, "TilesetDatabase");
+    resetMember(m_statisticsDatabase, "StatisticsDatabase");
+    resetMember(m_liquidsDatabase, "LiquidsDatabase");
+    resetMember(m_materialDatabase, "MaterialDatabase");
+    resetMember(m_damageDatabase, "DamageDatabase");
+    resetMember(m_effectSourceDatabase, "EffectSourceDatabase");
+    resetMember(m_statusEffectDatabase, "StatusEffectDatabase");
+    resetMember(m_treasureDatabase, "TreasureDatabase");
+    resetMember(m_codexDatabase, "CodexDatabase");
+    resetMember(m_behaviorDatabase, "BehaviorDatabase");
+    resetMember(m_techDatabase, "TechDatabase");
+    resetMember(m_aiDatabase, "AiDatabase");
+    resetMember(m_questTemplateDatabase, "QuestTemplateDatabase");
+    resetMember(m_emoteProcessor, "EmoteProcessor");
+    resetMember(m_terrainDatabase, "TerrainDatabase");
+    resetMember(m_particleDatabase, "ParticleDatabase");
+    resetMember(m_versioningDatabase, "VersioningDatabase");
+    resetMember(m_functionDatabase, "FunctionDatabase");
+    resetMember(m_imageMetadataDatabase, "ImageMetadataDatabase");
+    resetMember(m_tenantDatabase, "TenantDatabase");
+    resetMember(m_nameGenerator, "NameGenerator");
+    resetMember(m_danceDatabase, "DanceDatabase");
+    resetMember(m_spawnTypeDatabase, "SpawnTypeDatabase");
+    resetMember(m_radioMessageDatabase, "RadioMessageDatabase");
+    resetMember(m_collectionDatabase, "CollectionDatabase");
+
+    if (newAssets) {
+      m_assets = std::move(newAssets);
+    } else {
+      writeConfig();
+      m_assets.reset();
+      m_configuration.reset();
+    }
+
+    MutexLocker dependenciesLocker(m_memberDependenciesMutex);
+    for (auto const& name : m_memberDependencies.keys()) {
+      if (shouldReset(name.utf8Ptr()))
+        m_memberDependencies.remove(name);
+    }
   }
+}
 
-  m_reloadListeners.trigger();
+// Names of the members being loaded on this thread, innermost last
+static thread_local List<char const*> s_loadingMembers;
+
+void Root::noteMemberUsed(char const* name) {
+  if (s_loadingMembers.empty())
+    return;
+  MutexLocker dependenciesLocker(m_memberDependenciesMutex);
+  m_memberDependencies[s_loadingMembers.last()].members.add(name);
+}
+
+void Root::recordMemberLoad(char const* name, function<void()> load) {
+  Assets::Dependencies dependencies;
+  s_loadingMembers.append(name);
+  try {
+    Assets::DependencyRecorder recorder(dependencies);
+    load();
+  } catch (...) {
+    s_loadingMembers.removeLast();
+    throw;
+  }
+  s_loadingMembers.removeLast();
+
+  // Edges to other members have already been noted during the load, so only
+  // the assets are replaced.
+  MutexLocker dependenciesLocker(m_memberDependenciesMutex);
+  m_memberDependencies[name].assets = std::move(dependencies);
+}
+
+AssetsPtr Root::makeAssets() {
+  StringList assetDirectories = m_settings.assetDirectories;
+  {
+    MutexLocker modsLocker(m_modsMutex);
+    assetDirectories.appendAll(m_modDirectories);
+  }
+  StringList assetSources = scanForAssetSources(assetDirectories, m_settings.assetSources);
+
+  auto assets = make_shared<Assets>(m_settings.assetsSettings, assetSources);
+  Logger::info("Assets digest is {}", hexEncode(assets->digest()));
+  return assets;
 }
 
 void Root::loadMods(StringList modDirectories, bool _reload) {
@@ -310,61 +438,128 @@ void Root::loadMods(StringList modDirectories, bool _reload) {
   MutexLocker locker(m_modsMutex);
   m_modDirectories = std::move(modDirectories);
   
+  locker.unlock();
+
   if (_reload)
-    reload();
+    reloadChanged();
 }
 
 void Root::fullyLoad() {
-  auto workerPool = WorkerPool("Root::fullyLoad", RootLoadThreads);
-  List<WorkerPoolHandle> loaders;
-
-  loaders.reserve(40);
-
-  loaders.append(workerPool.addWork(swallow(bind(&Root::assets, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::configuration, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::codexDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::behaviorDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::techDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::aiDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::questTemplateDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::emoteProcessor, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::terrainDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::particleDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::versioningDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::functionDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::imageMetadataDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::tenantDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::nameGenerator, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::danceDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::spawnTypeDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::radioMessageDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::collectionDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::statisticsDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::speciesDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::projectileDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::stagehandDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::damageDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::effectSourceDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::statusEffectDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::treasureDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::materialDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::objectDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::npcDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::plantDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::itemDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::monsterDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::vehicleDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::playerFactory, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::entityFactory, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::biomeDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::liquidsDatabase, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::dungeonDefinitions, this))));
-  loaders.append(workerPool.addWork(swallow(bind(&Root::tilesetDatabase, this))));
-
   auto startSeconds = Time::monotonicTime();
-  for (auto& loader : loaders)
-    loader.finish();
-  Logger::info("Root: Loaded everything in {} seconds", Time::monotonicTime() - startSeconds);
+
+  // Every other member is built from the assets, so they are loaded up front
+  // (their scan is parallel on its own) rather than having every worker wait
+  // on them.
+  assets();
+
+  struct MemberLoad {
+    function<void(Root*)> load;
+    StringList dependencies;
+    StringList dependents;
+    size_t waitingOn;
+    double seconds;
+  };
+  StringMap<MemberLoad> members;
+
+  // Declares each member along with the members its constructor uses, so
+  // that it is only started once those are built.  The graph is only used
+  // for scheduling: anything missing from it still loads correctly on first
+  // use, at the cost of a worker waiting on another member's lock.
+  auto loader = [&members](String name, StringList dependencies, auto getter) {
+    members[name] = MemberLoad{[getter](Root* root) { (root->*getter)(); }, std::move(dependencies), {}, 0, 0.0};
+  };
+
+  loader("Configuration", {}, &Root::configuration);
+  loader("CodexDatabase", {}, &Root::codexDatabase);
+  loader("BehaviorDatabase", {}, &Root::behaviorDatabase);
+  loader("TechDatabase", {}, &Root::techDatabase);
+  loader("AiDatabase", {}, &Root::aiDatabase);
+  loader("QuestTemplateDatabase", {}, &Root::questTemplateDatabase);
+  loader("EmoteProcessor", {}, &Root::emoteProcessor);
+  loader("TerrainDatabase", {}, &Root::terrainDatabase);
+  loader("ParticleDatabase", {}, &Root::particleDatabase);
+  loader("VersioningDatabase", {}, &Root::versioningDatabase);
+  loader("FunctionDatabase", {}, &Root::functionDatabase);
+  loader("ImageMetadataDatabase", {}, &Root::imageMetadataDatabase);
+  loader("TenantDatabase", {}, &Root::tenantDatabase);
+  loader("NameGenerator", {}, &Root::nameGenerator);
+  loader("DanceDatabase", {}, &Root::danceDatabase);
+  loader("SpawnTypeDatabase", {}, &Root::spawnTypeDatabase);
+  loader("RadioMessageDatabase", {}, &Root::radioMessageDatabase);
+  loader("CollectionDatabase", {"ItemDatabase", "MonsterDatabase"}, &Root::collectionDatabase);
+  loader("StatisticsDatabase", {}, &Root::statisticsDatabase);
+  loader("SpeciesDatabase", {}, &Root::speciesDatabase);
+  loader("ProjectileDatabase", {}, &Root::projectileDatabase);
+  loader("StagehandDatabase", {}, &Root::stagehandDatabase);
+  loader("DamageDatabase", {}, &Root::damageDatabase);
+  loader("EffectSourceDatabase", {}, &Root::effectSourceDatabase);
+  loader("StatusEffectDatabase", {}, &Root::statusEffectDatabase);
+  loader("TreasureDatabase", {}, &Root::treasureDatabase);
+  loader("MaterialDatabase", {"ParticleDatabase"}, &Root::materialDatabase);
+  loader("ObjectDatabase", {}, &Root::objectDatabase);
+  loader("NpcDatabase", {}, &Root::npcDatabase);
+  loader("PlantDatabase", {}, &Root::plantDatabase);
+  loader("ItemDatabase", {"ObjectDatabase", "CodexDatabase", "MaterialDatabase", "ImageMetadataDatabase"}, &Root::itemDatabase);
+  loader("MonsterDatabase", {}, &Root::monsterDatabase);
+  loader("VehicleDatabase", {}, &Root::vehicleDatabase);
+  loader("PlayerFactory", {}, &Root::playerFactory);
+  loader("EntityFactory", {"MonsterDatabase", "NpcDatabase", "ObjectDatabase", "PlayerFactory", "ProjectileDatabase", "VehicleDatabase", "VersioningDatabase"}, &Root::entityFactory);
+  loader("BiomeDatabase", {}, &Root::biomeDatabase);
+  loader("LiquidsDatabase", {"MaterialDatabase"}, &Root::liquidsDatabase);
+  loader("DungeonDefinitions", {}, &Root::dungeonDefinitions);
+  loader("TilesetDatabase", {}, &Root::tilesetDatabase);
+
+  for (auto& p : members) {
+    p.second.waitingOn = p.second.dependencies.size();
+    for (auto const& dependency : p.second.dependencies)
+      members.get(dependency).dependents.append(p.first);
+  }
+
+  unsigned threadCount = max<unsigned>(RootLoadThreads, Thread::numberOfProcessors());
+  auto workerPool = WorkerPool("Root::fullyLoad", threadCount);
+  Mutex scheduleMutex;
+  ConditionVariable scheduleCondition;
+  size_t remaining = members.size();
+
+  function<void(String const&)> schedule;
+  schedule = [&](String const& name) {
+    workerPool.addWork([&, name]() {
+        auto& member = members.get(name);
+        auto memberStartSeconds = Time::monotonicTime();
+        try {
+          member.load(this);
+        } catch (std::exception const& e) {
+          Logger::error("Root: Error loading {}: {}", name, outputException(e, true));
+        }
+        member.seconds = Time::monotonicTime() - memberStartSeconds;
+
+        MutexLocker locker(scheduleMutex);
+        for (auto const& dependent : member.dependents) {
+          if (--members.get(dependent).waitingOn == 0)
+            schedule(dependent);
+        }
+        if (--remaining == 0)
+          scheduleCondition.signal();
+      });
+  };
+
+  {
+    MutexLocker locker(scheduleMutex);
+    for (auto const& p : members) {
+      if (p.second.waitingOn == 0)
+        schedule(p.first);
+    }
+    while (remaining != 0)
+      scheduleCondition.wait(scheduleMutex);
+  }
+  workerPool.finish();
+
+  List<pair<double, String>> timings;
+  for (auto const& p : members)
+    timings.append({p.second.seconds, p.first});
+  timings.sort([](auto const& a, auto const& b) { return a.first > b.first; });
+  Logger::info("Root: Loaded everything in {} seconds on {} threads, slowest: {}", Time::monotonicTime() - startSeconds, threadCount,
+      StringList(timings.slice(0, 5).transformed([](auto const& t) { return String(strf("{} {:.3f}s", t.second, t.first)); })).join(", "));
 
   {
     MutexLocker locker(m_assetsMutex);
@@ -387,15 +582,7 @@ String Root::toStoragePath(String const& path) const {
 }
 
 AssetsConstPtr Root::assets() {
-  return loadMemberFunction<Assets>(m_assets, m_assetsMutex, "Assets", [this]() {
-      StringList assetDirectories = m_settings.assetDirectories;
-      assetDirectories.appendAll(m_modDirectories);
-      StringList assetSources = scanForAssetSources(assetDirectories, m_settings.assetSources);
-
-      auto assets = make_shared<Assets>(m_settings.assetsSettings, assetSources);
-      Logger::info("Assets digest is {}", hexEncode(assets->digest()));
-      return assets;
-    });
+  return loadMemberFunction<Assets>(m_assets, m_assetsMutex, "Assets", bind(&Root::makeAssets, this));
 }
 
 ConfigurationPtr Root::configuration() {
@@ -751,21 +938,25 @@ void Root::writeConfig() {
 }
 
 template <typename T, typename... Params>
-shared_ptr<T> Root::loadMember(shared_ptr<T>& ptr, Mutex& mutex, char const* name, Params&&... params) {
+shared_ptr<T> Root::loadMember(AtomicSharedPtr<T>& ptr, Mutex& mutex, char const* name, Params&&... params) {
   return loadMemberFunction<T>(ptr, mutex, name, [&]() {
       return make_shared<T>(forward<Params>(params)...);
     });
 }
 
 template <typename T>
-shared_ptr<T> Root::loadMemberFunction(shared_ptr<T>& ptr, Mutex& mutex, char const* name, function<shared_ptr<T>()> loadFunction) {
+shared_ptr<T> Root::loadMemberFunction(AtomicSharedPtr<T>& ptr, Mutex& mutex, char const* name, function<shared_ptr<T>()> loadFunction) {
+  noteMemberUsed(name);
+  if (auto member = ptr.load())
+    return member;
+
   MutexLocker locker(mutex);
   if (!ptr) {
     auto startSeconds = Time::monotonicTime();
-    ptr = loadFunction();
+    recordMemberLoad(name, [&]() { ptr.store(loadFunction()); });
     Logger::info("Root: Loaded {} in {} seconds", name, Time::monotonicTime() - startSeconds);
   }
-  return ptr;
+  return ptr.load();
 }
 
 }
@@ -5,6 +5,7 @@
 #include "StarLogging.hpp"
 #include "StarListener.hpp"
 #include "StarConfiguration.hpp"
+#include "StarAtomicSharedPtr.hpp"
 
 namespace Star {
 
@@ -84,6 +85,13 @@ public:
     // The minimum log level to write to any log sink
     LogLevel logLevel;
 
+    // If true, the log file is written from its own thread rather than by
+    // whichever thread logs.
+    bool asyncLogging = true;
+
+    // Passed to Logger::setRateLimit
+    unsigned logRateLimit = 0;
+
     // If true, doesn't write any logging to stdout, only to the log file if
     // given.
     bool quiet;
@@ -117,6 +125,12 @@ public:
   // Clears existing Root members, allowing them to be loaded fresh from disk.
   void reload();
 
+  // Rebuilds the assets, then clears only the Root members that used any of
+  // the given asset paths while loading, along with anything that used those
+  // members in turn.  Files that were added, removed, or now come from a
+  // different source are detected without being listed.
+  void reloadChanged(StringSet changedPaths = {});
+
   // Reloads with the given mod sources applied on top of the base mod source
   // specified in the settings.  Mods in the base mod source will override mods
   // in the given mod sources
@@ -189,21 +203,46 @@ public:
 
 private:
   static StringList scanForAssetSources(StringList const& directories, StringList const& manual = {});
+  // Members are read without locking once loaded, the mutex is only taken to
+  // load a member that is missing, and by resetMembers.
   template <typename T, typename... Params>
-  static shared_ptr<T> loadMember(shared_ptr<T>& ptr, Mutex& mutex, char const* name, Params&&... params);
+  shared_ptr<T> loadMember(AtomicSharedPtr<T>& ptr, Mutex& mutex, char const* name, Params&&... params);
   template <typename T>
-  static shared_ptr<T> loadMemberFunction(shared_ptr<T>& ptr, Mutex& mutex, char const* name, function<shared_ptr<T>()> loadFunction);
+  shared_ptr<T> loadMemberFunction(AtomicSharedPtr<T>& ptr, Mutex& mutex, char const* name, function<shared_ptr<T>()> loadFunction);
+
+  // Records that the member currently loading on this thread, if any, uses the
+  // named member.
+  void noteMemberUsed(char const* name);
+  // Runs the load of the named member while recording the asset paths and
+  // other members it uses.
+  void recordMemberLoad(char const* name, function<void()> load);
+
+  AssetsPtr makeAssets();
+
+  // Clears every member for which shouldReset returns true.  With newAssets
+  // given, the assets are replaced by them and the configuration is kept,
+  // otherwise both are cleared as well.
+  void resetMembers(function<bool(char const*)> shouldReset, AssetsPtr newAssets);
 
   // m_configurationMutex must be held when calling
   void writeConfig();
 
   Settings m_settings;
+  AsyncLogSinkPtr m_asyncLogSink;
 
   Mutex m_modsMutex;
   StringList m_modDirectories;
 
   ListenerGroup m_reloadListeners;
 
+  struct MemberDependencies {
+    Assets::Dependencies assets;
+    StringSet members;
+  };
+
+  Mutex m_memberDependenciesMutex;
+  StringMap<MemberDependencies> m_memberDependencies;
+
   Json m_lastRuntimeConfig;
   Maybe<String> m_runtimeConfigFile;
 
@@ -212,124 +251,124 @@ private:
   ConditionVariable m_maintenanceStopCondition;
   bool m_stopMaintenanceThread;
 
-  AssetsPtr m_assets;
+  AtomicSharedPtr<Assets> m_assets;
   Mutex m_assetsMutex;
 
-  ConfigurationPtr m_configuration;
+  AtomicSharedPtr<Configuration> m_configuration;
   Mutex m_configurationMutex;
 
-  ObjectDatabasePtr m_objectDatabase;
+  AtomicSharedPtr<ObjectDatabase> m_objectDatabase;
   Mutex m_objectDatabaseMutex;
 
-  PlantDatabasePtr m_plantDatabase;
+  AtomicSharedPtr<PlantDatabase> m_plantDatabase;
   Mutex m_plantDatabaseMutex;
 
-  ProjectileDatabasePtr m_projectileDatabase;
+  AtomicSharedPtr<ProjectileDatabase> m_projectileDatabase;
   Mutex m_projectileDatabaseMutex;
 
-  MonsterDatabasePtr m_monsterDatabase;
+  AtomicSharedPtr<MonsterDatabase> m_monsterDatabase;
   Mutex m_monsterDatabaseMutex;
 
-  NpcDatabasePtr m_npcDatabase;
+  AtomicSharedPtr<NpcDatabase> m_npcDatabase;
   Mutex m_npcDatabaseMutex;
 
-  StagehandDatabasePtr m_stagehandDatabase;
+  AtomicSharedPtr<StagehandDatabase> m_stagehandDatabase;
   Mutex m_stagehandDatabaseMutex;
 
-  VehicleDatabasePtr m_vehicleDatabase;
+  AtomicSharedPtr<VehicleDatabase> m_vehicleDatabase;
   Mutex m_vehicleDatabaseMutex;
 
-  PlayerFactoryPtr m_playerFactory;
+  AtomicSharedPtr<PlayerFactory> m_playerFactory;
   Mutex m_playerFactoryMutex;
 
-  EntityFactoryPtr m_entityFactory;
+  AtomicSharedPtr<EntityFactory> m_entityFactory;
   Mutex m_entityFactoryMutex;
 
-  PatternedNameGeneratorPtr m_nameGenerator;
+  AtomicSharedPtr<PatternedNameGenerator> m_nameGenerator;
   Mutex m_nameGeneratorMutex;
 
-  ItemDatabasePtr m_itemDatabase;
+  AtomicSharedPtr<ItemDatabase> m_itemDatabase;
   Mutex m_itemDatabaseMutex;
 
-  MaterialDatabasePtr m_materialDatabase;
+  AtomicSharedPtr<MaterialDatabase> m_materialDatabase;
   Mutex m_materialDatabaseMutex;
 
-  TerrainDatabasePtr m_terrainDatabase;
+  AtomicSharedPtr<TerrainDatabase> m_terrainDatabase;
   Mutex m_terrainDatabaseMutex;
 
-  BiomeDatabasePtr m_biomeDatabase;
+  AtomicSharedPtr<BiomeDatabase> m_biomeDatabase;
   Mutex m_biomeDatabaseMutex;
 
-  LiquidsDatabasePtr m_liquidsDatabase;
+  AtomicSharedPtr<LiquidsDatabase> m_liquidsDatabase;
   Mutex m_liquidsDatabaseMutex;
 
-  StatusEffectDatabasePtr m_statusEffectDatabase;
+  AtomicSharedPtr<StatusEffectDatabase> m_statusEffectDatabase;
   Mutex m_statusEffectDatabaseMutex;
 
-  DamageDatabasePtr m_damageDatabase;
+  AtomicSharedPtr<DamageDatabase> m_damageDatabase;
   Mutex m_damageDatabaseMutex;
 
-  ParticleDatabasePtr m_particleDatabase;
+  AtomicSharedPtr<ParticleDatabase> m_particleDatabase;
   Mutex m_particleDatabaseMutex;
 
-  EffectSourceDatabasePtr m_effectSourceDatabase;
+  AtomicSharedPtr<EffectSourceDatabase> m_effectSourceDatabase;
   Mutex m_effectSourceDatabaseMutex;
 
-  FunctionDatabasePtr m_functionDatabase;
+  AtomicSharedPtr<FunctionDatabase> m_functionDatabase;
   Mutex m_functionDatabaseMutex;
 
-  TreasureDatabasePtr m_treasureDatabase;
+  AtomicSharedPtr<TreasureDatabase> m_treasureDatabase;
   Mutex m_treasureDatabaseMutex;
 
-  DungeonDefinitionsPtr m_dungeonDefinitions;
+  AtomicSharedPtr<DungeonDefinitions> m_dungeonDefinitions;
   Mutex m_dungeonDefinitionsMutex;
 
-  TilesetDatabasePtr m_tilesetDatabase;
+  AtomicSharedPtr<TilesetDatabase> m_tilesetDatabase;
   Mutex m_tilesetDatabaseMutex;
 
-  StatisticsDatabasePtr m_statisticsDatabase;
+  AtomicSharedPtr<StatisticsDatabase> m_statisticsDatabase;
   Mutex m_statisticsDatabaseMutex;
 
-  EmoteProcessorPtr m_emoteProcessor;
+  AtomicSharedPtr<EmoteProcessor> m_emoteProcessor;
   Mutex m_emoteProcessorMutex;
 
-  SpeciesDatabasePtr m_speciesDatabase;
+  AtomicSharedPtr<SpeciesDatabase> m_speciesDatabase;
   Mutex m_speciesDatabaseMutex;
 
-  ImageMetadataDatabasePtr m_imageMetadataDatabase;
+  AtomicSharedPtr<ImageMetadataDatabase> m_imageMetadataDatabase;
   Mutex m_imageMetadataDatabaseMutex;
 
-  VersioningDatabasePtr m_versioningDatabase;
+  AtomicSharedPtr<VersioningDatabase> m_versioningDatabase;
   Mutex m_versioningDatabaseMutex;
 
-  QuestTemplateDatabasePtr m_questTemplateDatabase;
+  AtomicSharedPtr<QuestTemplateDatabase> m_questTemplateDatabase;
   Mutex m_questTemplateDatabaseMutex;
 
-  AiDatabasePtr m_aiDatabase;
+  AtomicSharedPtr<AiDatabase> m_aiDatabase;
   Mutex m_aiDatabaseMutex;
 
-  TechDatabasePtr m_techDatabase;
+  AtomicSharedPtr<TechDatabase> m_techDatabase;
   Mutex m_techDatabaseMutex;
 
-  CodexDatabasePtr m_codexDatabase;
+  AtomicSharedPtr<CodexDatabase> m_codexDatabase;
   Mutex m_codexDatabaseMutex;
 
-  BehaviorDatabasePtr m_behaviorDatabase;
+  AtomicSharedPtr<BehaviorDatabase> m_behaviorDatabase;
   Mutex m_behaviorDatabaseMutex;
 
-  TenantDatabasePtr m_tenantDatabase;
+  AtomicSharedPtr<TenantDatabase> m_tenantDatabase;
   Mutex m_tenantDatabaseMutex;
 
-  DanceDatabasePtr m_danceDatabase;
+  AtomicSharedPtr<DanceDatabase> m_danceDatabase;
   Mutex m_danceDatabaseMutex;
 
-  SpawnTypeDatabasePtr m_spawnTypeDatabase;
+  AtomicSharedPtr<SpawnTypeDatabase> m_spawnTypeDatabase;
   Mutex m_spawnTypeDatabaseMutex;
 
-  RadioMessageDatabasePtr m_radioMessageDatabase;
+  AtomicSharedPtr<RadioMessageDatabase> m_radioMessageDatabase;
   Mutex m_radioMessageDatabaseMutex;
 
-  CollectionDatabasePtr m_collectionDatabase;
+  AtomicSharedPtr<CollectionDatabase> m_collectionDatabase;
   Mutex m_collectionDatabaseMutex;
 };
 
@@ -1,6 +1,7 @@
 #include "StarRootLoader.hpp"
 #include "StarLexicalCast.hpp"
 #include "StarJsonExtra.hpp"
+#include "StarFile.hpp"
 
 namespace Star {
 
@@ -8,11 +9,28 @@ Json const BaseAssetsSettings = Json::parseJson(R"JSON(
     {
       "assetTimeToLive" : 30,
 
+      // In megabytes, 0 for no limit.  Unused assets are evicted early to
+      // stay under this.
+      "cacheMemoryLimit" : 0,
+      "evictFirst" : [
+        "^/objects/"
+      ],
+      "neverEvict" : [
+        "^/interface/"
+      ],
+
       // In seconds, audio less than this long will be decompressed in memory.
       "audioDecompressLimit" : 4.0,
 
       "workerPoolSize" : 2,
 
+      // Keeps patched json assets in the storage directory between runs.
+      "patchCache" : true,
+
+      // In megabytes, 0 to disable.  Keeps images produced by directives in
+      // the storage directory between runs, up to this size.
+      "imageCacheSize" : 0,
+
       "pathIgnore" : [
         "/\\.",
         "/~",
@@ -72,13 +90,23 @@ R"JSON(
       "scriptInstructionLimit" : 10000000,
       "scriptProfilingEnabled" : false,
       "scriptInstructionMeasureInterval" : 10000,
+      "scriptBytecodeCache" : false,
+      "sharedScriptModules" : {},
+      "scriptableThreadPoolWorkers" : 2,
+
+      "pathFinderWorkers" : 2,
+      "pathFinderSnapshotMaxAge" : 1.0,
+      "pathFinderCacheSize" : 64,
+      "pathFinderCacheMaxAge" : 10.0,
 
       "allowAdminCommands" : true,
       "allowAdminCommandsFromAnyone" : false,
       "anonymousConnectionsAreAdmin" : false,
       "connectionSettings" : {
-        "compression" : "Zstd"
+        "compression" : "Zstd",
+        "udp" : false
       },
+      "clientUdpTransport" : true,
 
       "clientP2PJoinable" : true,
       "clientIPJoinable" : false,
@@ -172,6 +200,9 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
 
     Root::Settings rootSettings;
     rootSettings.assetsSettings.assetTimeToLive = assetsSettings.getInt("assetTimeToLive");
+    rootSettings.assetsSettings.cacheMemoryLimit = assetsSettings.getUInt("cacheMemoryLimit") * 1024 * 1024;
+    rootSettings.assetsSettings.evictFirst = jsonToStringList(assetsSettings.get("evictFirst"));
+    rootSettings.assetsSettings.neverEvict = jsonToStringList(assetsSettings.get("neverEvict"));
     rootSettings.assetsSettings.audioDecompressLimit = assetsSettings.getFloat("audioDecompressLimit");
     rootSettings.assetsSettings.workerPoolSize = assetsSettings.getUInt("workerPoolSize");
     rootSettings.assetsSettings.missingImage = assetsSettings.optString("missingImage");
@@ -189,9 +220,18 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
       );
 
     rootSettings.storageDirectory = bootConfig.getString("storageDirectory");
+    if (assetsSettings.getBool("patchCache"))
+      rootSettings.assetsSettings.patchCacheFile = File::relativeTo(rootSettings.storageDirectory, "assetpatches.cache");
+    rootSettings.assetsSettings.imageCacheSizeLimit = assetsSettings.getUInt("imageCacheSize") * 1024 * 1024;
+    if (rootSettings.assetsSettings.imageCacheSizeLimit)
+      rootSettings.assetsSettings.imageCacheFile = File::relativeTo(rootSettings.storageDirectory, "processedimages.cache");
+    if (auto traceFile = assetsSettings.optString("traceFile"))
+      rootSettings.assetsSettings.traceFile = File::relativeTo(rootSettings.storageDirectory, *traceFile);
     rootSettings.logDirectory = bootConfig.optString("logDirectory");
     rootSettings.logFile = options.parameters.value("logfile").maybeFirst().orMaybe(m_defaults.logFile);
     rootSettings.logFileBackups = bootConfig.getUInt("logFileBackups", 10);
+    rootSettings.asyncLogging = bootConfig.getBool("asyncLogging", true);
+    rootSettings.logRateLimit = bootConfig.getUInt("logRateLimit", 0);
     rootSettings.includeUGC = bootConfig.getBool("includeUGC", true);
 
     if (auto ll = options.parameters.value("loglevel").maybeFirst())
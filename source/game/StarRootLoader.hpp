@@ -23,6 +23,9 @@ namespace Star {
 // The boot config file can contain the following options:
 // 'assetDirectories' - Asset source search directories
 // 'logFileBackups' - Number of rotated backups of the target log file
+// 'asyncLogging' - Write the log file from a dedicated thread, defaults to true
+// 'logRateLimit' - Messages per second written per log format string and
+// thread, defaults to 0 for no limit
 // 'storageDirectory' - Primary Root storage directory
 // 'assetsSettings' - Merged with base assets settings
 // 'defaultConfiguration' - Merged with base default configuration
@@ -19,6 +19,7 @@ ServerClientContext::ServerClientContext(ConnectionId clientId, Maybe<HostAddres
     m_playerName(playerName),
     m_shipSpecies(shipSpecies),
     m_canBecomeAdmin(canBecomeAdmin),
+    m_acknowledgedEntityUpdates(false),
     m_shipChunks(std::move(initialShipChunks)) {
   m_rpc.registerHandler("ship.applyShipUpgrades", [this](Json const& args) -> Json {
       RecursiveMutexLocker locker(m_mutex);
@@ -101,6 +102,14 @@ NetCompatibilityRules ServerClientContext::netRules() const {
   return m_netRules;
 }
 
+bool ServerClientContext::acknowledgedEntityUpdates() const {
+  return m_acknowledgedEntityUpdates;
+}
+
+void ServerClientContext::setAcknowledgedEntityUpdates(bool acknowledgedEntityUpdates) {
+  m_acknowledgedEntityUpdates = acknowledgedEntityUpdates;
+}
+
 String ServerClientContext::descriptiveName() const {
   RecursiveMutexLocker locker(m_mutex);
   String hostName = m_remoteAddress ? toString(*m_remoteAddress) : "local";
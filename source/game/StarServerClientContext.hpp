@@ -31,6 +31,11 @@ public:
   NetCompatibilityRules netRules() const;
   String descriptiveName() const;
 
+  // Whether the client's transport may lose entity updates, so that the
+  // worlds it joins should send them relative to acknowledged snapshots.
+  bool acknowledgedEntityUpdates() const;
+  void setAcknowledgedEntityUpdates(bool acknowledgedEntityUpdates);
+
   // Register additional rpc methods from other server side services.
   void registerRpcHandlers(JsonRpcHandlers const& rpcHandlers);
 
@@ -96,6 +101,7 @@ private:
   String const m_playerName;
   String m_shipSpecies;
   bool const m_canBecomeAdmin;
+  bool m_acknowledgedEntityUpdates;
 
   mutable RecursiveMutex m_mutex;
 
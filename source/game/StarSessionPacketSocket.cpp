@@ -0,0 +1,137 @@
+#include "StarSessionPacketSocket.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+// Milliseconds between acknowledgements while packets are being received
+static int64_t const SessionAcknowledgeInterval = 250;
+// Past this many unacknowledged packets the other end is assumed to be gone
+// for good, and they are no longer kept.
+static size_t const SessionMaxUnacknowledged = 65536;
+
+SessionPacketSocket::SessionPacketSocket(PacketSocketUPtr socket, List<PacketPtr> received)
+  : m_socket(std::move(socket)), m_resumable(true), m_acknowledged(0),
+    m_receivedBeforeStart(std::move(received)), m_received(m_receivedBeforeStart.size()),
+    m_receivedAcknowledged(0), m_lastAcknowledgeTime(0) {}
+
+bool SessionPacketSocket::isOpen() const {
+  return m_socket->isOpen();
+}
+
+void SessionPacketSocket::close() {
+  m_resumable = false;
+  m_unacknowledged.clear();
+  m_socket->close();
+}
+
+void SessionPacketSocket::sendPackets(List<PacketPtr> packets) {
+  if (m_resumable) {
+    m_unacknowledged.appendAll(packets);
+    if (m_unacknowledged.size() > SessionMaxUnacknowledged) {
+      m_resumable = false;
+      m_unacknowledged.clear();
+    }
+  }
+
+  // Packets sent while the socket is lost are only kept, to go out when the
+  // session is resumed.
+  if (m_socket->isOpen())
+    m_socket->sendPackets(std::move(packets));
+}
+
+List<PacketPtr> SessionPacketSocket::receivePackets() {
+  List<PacketPtr> packets = take(m_receivedBeforeStart);
+  for (auto& packet : m_socket->receivePackets()) {
+    if (auto acknowledgement = as<SessionAcknowledgePacket>(packet)) {
+      acknowledge(acknowledgement->received);
+    } else {
+      ++m_received;
+      packets.append(std::move(packet));
+    }
+  }
+  return packets;
+}
+
+bool SessionPacketSocket::sentPacketsPending() const {
+  return m_socket->sentPacketsPending();
+}
+
+size_t SessionPacketSocket::sentPacketsPendingSize() const {
+  return m_socket->sentPacketsPendingSize();
+}
+
+bool SessionPacketSocket::writeData() {
+  if (m_received != m_receivedAcknowledged && m_socket->isOpen()) {
+    int64_t currentTime = Time::monotonicMilliseconds();
+    if (currentTime - m_lastAcknowledgeTime >= SessionAcknowledgeInterval) {
+      m_socket->sendPackets({make_shared<SessionAcknowledgePacket>(m_received)});
+      m_receivedAcknowledged = m_received;
+      m_lastAcknowledgeTime = currentTime;
+    }
+  }
+  return m_socket->writeData();
+}
+
+bool SessionPacketSocket::readData() {
+  return m_socket->readData();
+}
+
+SocketPtr SessionPacketSocket::pollSocket() const {
+  return m_socket->pollSocket();
+}
+
+Maybe<PacketStats> SessionPacketSocket::incomingStats() const {
+  return m_socket->incomingStats();
+}
+
+Maybe<PacketStats> SessionPacketSocket::outgoingStats() const {
+  return m_socket->outgoingStats();
+}
+
+void SessionPacketSocket::setNetRules(NetCompatibilityRules netRules) {
+  m_socket->setNetRules(netRules);
+}
+
+NetCompatibilityRules SessionPacketSocket::netRules() const {
+  return m_socket->netRules();
+}
+
+uint64_t SessionPacketSocket::received() const {
+  return m_received;
+}
+
+bool SessionPacketSocket::resumable() const {
+  return m_resumable;
+}
+
+bool SessionPacketSocket::canResume(uint64_t peerReceived) const {
+  return m_resumable && peerReceived >= m_acknowledged && peerReceived <= m_acknowledged + m_unacknowledged.size();
+}
+
+bool SessionPacketSocket::resume(PacketSocketUPtr& socket, uint64_t peerReceived, List<PacketPtr> received) {
+  if (!canResume(peerReceived))
+    return false;
+
+  acknowledge(peerReceived);
+  socket->setNetRules(m_socket->netRules());
+  m_socket = take(socket);
+  m_socket->sendPackets(List<PacketPtr>::from(m_unacknowledged));
+
+  m_received += received.size();
+  m_receivedBeforeStart.appendAll(std::move(received));
+  // Let the other end stop keeping what it has just sent again as soon as
+  // possible.
+  m_receivedAcknowledged = 0;
+  m_lastAcknowledgeTime = 0;
+  return true;
+}
+
+void SessionPacketSocket::acknowledge(uint64_t peerReceived) {
+  while (m_acknowledged < peerReceived && !m_unacknowledged.empty()) {
+    m_unacknowledged.removeFirst();
+    ++m_acknowledged;
+  }
+  m_acknowledged = max(m_acknowledged, peerReceived);
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "StarNetPacketSocket.hpp"
+
+namespace Star {
+
+STAR_CLASS(SessionPacketSocket);
+
+// PacketSocket over another PacketSocket, that can be carried over to a new
+// socket when the one underneath is lost without losing or repeating any
+// packets.  Each end counts the packets it receives and periodically
+// acknowledges the count, and keeps every packet it sends until it is
+// acknowledged, so that whatever the other end never got can be sent again
+// once the session is resumed.
+class SessionPacketSocket : public PacketSocket {
+public:
+  // Packets already pulled from the socket before the session started are
+  // counted as received and returned by the first receivePackets.
+  explicit SessionPacketSocket(PacketSocketUPtr socket, List<PacketPtr> received = {});
+
+  // False once the socket underneath is lost, until the session is resumed
+  bool isOpen() const override;
+  void close() override;
+
+  void sendPackets(List<PacketPtr> packets) override;
+  List<PacketPtr> receivePackets() override;
+
+  bool sentPacketsPending() const override;
+  size_t sentPacketsPendingSize() const override;
+
+  bool writeData() override;
+  bool readData() override;
+
+  SocketPtr pollSocket() const override;
+
+  Maybe<PacketStats> incomingStats() const override;
+  Maybe<PacketStats> outgoingStats() const override;
+
+  void setNetRules(NetCompatibilityRules netRules) override;
+  NetCompatibilityRules netRules() const override;
+
+  // Number of session packets received from the other end so far
+  uint64_t received() const;
+
+  // False once the session was closed on purpose, or more packets went
+  // unacknowledged than are kept.
+  bool resumable() const;
+
+  // Whether the session can be resumed by a peer that has received the given
+  // number of session packets.
+  bool canResume(uint64_t peerReceived) const;
+  // Carries the session over to a new socket to the same peer, which has
+  // received the given number of session packets.  Packets it is missing are
+  // sent again first.  Returns false if the session cannot be resumed from
+  // there, leaving the socket unused.
+  bool resume(PacketSocketUPtr& socket, uint64_t peerReceived, List<PacketPtr> received = {});
+
+private:
+  void acknowledge(uint64_t peerReceived);
+
+  PacketSocketUPtr m_socket;
+  bool m_resumable;
+
+  // Packets sent and not yet acknowledged, the first of which is the session
+  // packet numbered m_acknowledged.
+  Deque<PacketPtr> m_unacknowledged;
+  uint64_t m_acknowledged;
+
+  List<PacketPtr> m_receivedBeforeStart;
+  uint64_t m_received;
+  uint64_t m_receivedAcknowledged;
+  int64_t m_lastAcknowledgeTime;
+};
+
+}
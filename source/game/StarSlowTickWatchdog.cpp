@@ -0,0 +1,93 @@
+#include "StarSlowTickWatchdog.hpp"
+#include "StarWorldServerThread.hpp"
+#include "StarLuaRoot.hpp"
+#include "StarStackSampler.hpp"
+#include "StarLogging.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+// How long to wait for the world's thread to reach its next Lua instruction
+// and capture a traceback, if it is running Lua at all.
+static unsigned const TracebackTimeoutMillis = 100;
+
+SlowTickWatchdog::SlowTickWatchdog(Json const& config) : m_stop(false) {
+  m_threshold = config.getDouble("thresholdMs", 500.0) / 1000.0;
+  m_reportInterval = config.getDouble("reportInterval", 60.0);
+  m_checkInterval = config.getDouble("checkInterval", 0.05);
+
+  m_thread = Thread::invoke("SlowTickWatchdog", [this]() { run(); });
+}
+
+SlowTickWatchdog::~SlowTickWatchdog() {
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_stopCondition.broadcast();
+  }
+  m_thread.finish();
+}
+
+void SlowTickWatchdog::watch(WorldServerThreadPtr const& world) {
+  MutexLocker locker(m_mutex);
+  m_worlds.append(WatchedWorld{world, -m_reportInterval, 0});
+}
+
+void SlowTickWatchdog::run() {
+  MutexLocker locker(m_mutex);
+  while (!m_stop) {
+    m_stopCondition.wait(m_mutex, (unsigned)(m_checkInterval * 1000));
+    if (m_stop)
+      break;
+
+    List<tuple<WorldServerThreadPtr, double, uint64_t>> slowWorlds;
+    double now = Time::monotonicTime();
+    m_worlds.filter([&](WatchedWorld& watched) {
+        auto world = watched.world.lock();
+        if (!world)
+          return false;
+
+        auto progress = world->updateProgress();
+        if (progress && now - progress->start >= m_threshold && progress->number != watched.lastReportedUpdate
+            && now - watched.lastReport >= m_reportInterval) {
+          watched.lastReport = now;
+          watched.lastReportedUpdate = progress->number;
+          slowWorlds.append({std::move(world), now - progress->start, progress->number});
+        }
+        return true;
+      });
+
+    // Sampling waits on the world threads, so do it without holding the lock
+    // that watch() needs.
+    locker.unlock();
+    for (auto const& slow : slowWorlds)
+      report(*get<0>(slow), get<1>(slow), get<2>(slow));
+    slowWorlds.clear();
+    locker.lock();
+  }
+}
+
+void SlowTickWatchdog::report(WorldServerThread& world, double elapsed, uint64_t updateNumber) {
+  auto progress = world.updateProgress();
+  if (!progress || progress->number != updateNumber)
+    return;
+
+  Maybe<String> traceback;
+  if (auto luaRoot = world.luaRoot()) {
+    auto& engine = luaRoot->luaEngine();
+    engine.requestTraceback();
+    for (unsigned waited = 0; waited < TracebackTimeoutMillis && !traceback; ++waited) {
+      Thread::sleep(1);
+      traceback = engine.takeRequestedTraceback();
+    }
+  }
+
+  auto stack = StackSampler::sample(progress->thread);
+
+  String entity = progress->entity != NullEntityId ? toString(progress->entity) : String("none");
+  Logger::warn("SlowTickWatchdog: world {} update has run for {:.0f}ms, updating entity {}\nNative stack:\n{}\nLua traceback:\n{}",
+      world.worldId(), elapsed * 1000.0, entity,
+      stack.value("<could not be sampled>"), traceback.value("<not running Lua>"));
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "StarThread.hpp"
+#include "StarJson.hpp"
+
+namespace Star {
+
+STAR_CLASS(WorldServerThread);
+STAR_CLASS(SlowTickWatchdog);
+
+// Watches world updates from its own thread, and when one runs for longer than
+// a threshold logs what the world is doing while it is still stuck: the
+// native stack of the updating thread, a traceback of the Lua running on it
+// and the entity being updated.  Reports for each world are rate limited.
+class SlowTickWatchdog {
+public:
+  // Reads thresholdMs, reportInterval and checkInterval, see
+  // universe_server.config.
+  SlowTickWatchdog(Json const& config);
+  ~SlowTickWatchdog();
+
+  SlowTickWatchdog(SlowTickWatchdog const&) = delete;
+  SlowTickWatchdog& operator=(SlowTickWatchdog const&) = delete;
+
+  // Worlds are held weakly and forgotten once they are destroyed.
+  void watch(WorldServerThreadPtr const& world);
+
+private:
+  struct WatchedWorld {
+    WorldServerThreadWeakPtr world;
+    double lastReport;
+    uint64_t lastReportedUpdate;
+  };
+
+  void run();
+  void report(WorldServerThread& world, double elapsed, uint64_t updateNumber);
+
+  double m_threshold;
+  double m_reportInterval;
+  double m_checkInterval;
+
+  Mutex m_mutex;
+  ConditionVariable m_stopCondition;
+  bool m_stop;
+  List<WatchedWorld> m_worlds;
+
+  ThreadFunction<void> m_thread;
+};
+
+}
@@ -35,6 +35,8 @@ Spawner::Spawner() {
   m_spawnCellLifetime = config.getFloat("spawnCellLifetime");
   m_windowActivationBorder = config.getUInt("windowActivationBorder");
 
+  m_cellTilesCache.setTimeToLive(config.getFloat("spawnCellTileCacheTime", 60.0f) * 1000);
+
   m_active = config.getBool("defaultActive", true);
 
   m_debug = config.getBool("debug", false);
@@ -82,6 +84,8 @@ void Spawner::update(float dt) {
       activateRegion(window.padded(m_windowActivationBorder));
   }
 
+  m_cellTilesCache.cleanup();
+
   eraseWhere(m_activeSpawnCells, [dt](auto& p) {
     return (p.second -= dt) < 0.0f;
   });
@@ -103,6 +107,20 @@ void Spawner::update(float dt) {
     debugShowSpawnCells();
 }
 
+void Spawner::tilesModified(Vec2I const& position) {
+  if (!m_facade || m_cellTilesCache.currentSize() == 0)
+    return;
+
+  // Collision is sampled one tile above the queried position, and every empty
+  // tile looks down and up for surfaces and ceilings, so a change can affect
+  // classification of tiles some distance above and below it.
+  float x = m_facade->geometry().xwrap(position[0]);
+  Vec2I minCell = cellIndexForPosition(Vec2F(x, position[1] - 1 - (int)m_spawnCellNearCeilingDistance));
+  Vec2I maxCell = cellIndexForPosition(Vec2F(x, position[1] + (int)m_spawnCellNearSurfaceDistance));
+  for (int cellY = minCell[1]; cellY <= maxCell[1]; ++cellY)
+    m_cellTilesCache.remove({minCell[0], cellY});
+}
+
 Vec2I Spawner::cellIndexForPosition(Vec2F const& position) const {
   return Vec2I::floor(position / m_spawnCellSize);
 }
@@ -124,26 +142,35 @@ RectF Spawner::cellRegion(Vec2I const& cellIndex) const {
   return RectF::withSize(Vec2F(cellIndex) * m_spawnCellSize, Vec2F::filled(m_spawnCellSize));
 }
 
-Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) const {
-  unsigned emptyCount = 0;
-  unsigned nearSurfaceCount = 0;
-  unsigned nearCeilingCount = 0;
-  unsigned airCount = 0;
-  unsigned liquidCount = 0;
-  unsigned exposedCount = 0;
+auto Spawner::cellTiles(Vec2I const& cellIndex) -> SpawnCellTiles {
+  return m_cellTilesCache.get(cellIndex, [this](Vec2I const& cellIndex) {
+      return classifyCellTiles(cellIndex);
+    });
+}
+
+auto Spawner::classifyCellTiles(Vec2I const& cellIndex) const -> SpawnCellTiles {
+  SpawnCellTiles cellTiles = {};
+  cellTiles.tiles.resize(m_spawnCellSize * m_spawnCellSize, 0);
 
   auto region = RectI::withSize(cellIndex * m_spawnCellSize, Vec2I::filled(m_spawnCellSize));
   for (int x = region.xMin(); x < region.xMax(); ++x) {
     for (int y = region.yMin(); y < region.yMax(); ++y) {
+      uint8_t& flags = cellTiles.tiles[(x - region.xMin()) * m_spawnCellSize + (y - region.yMin())];
+
       // Only empty blocks count towards spawn totals
       if (m_facade->collision({x, y}) == CollisionKind::None) {
-        ++emptyCount;
+        flags |= SpawnTileEmpty;
+        ++cellTiles.emptyCount;
 
-        if (m_facade->liquidLevel({x, y}).level > m_minimumLiquidLevel)
-          ++liquidCount;
+        if (m_facade->liquidLevel({x, y}).level > m_minimumLiquidLevel) {
+          flags |= SpawnTileLiquid;
+          ++cellTiles.liquidCount;
+        }
 
-        if (m_facade->isBackgroundEmpty({x, y}))
-          ++exposedCount;
+        if (m_facade->isBackgroundEmpty({x, y})) {
+          flags |= SpawnTileExposed;
+          ++cellTiles.exposedCount;
+        }
 
         // The empty block will will either count as an air block, a
         // "near-surface" block, or a "near-ceiling" block.  It will count as a
@@ -153,7 +180,7 @@ Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) c
         // within the NearCeilingDistance of a CollisionKind::Block.
         bool nearSurface = false;
         for (unsigned sd = 1; sd <= m_spawnCellNearSurfaceDistance; ++sd) {
-          auto collision = m_facade->collision({x, y - sd});
+          auto collision = m_facade->collision({x, y - (int)sd});
           if (BlockCollisionSet.contains(collision) || collision == CollisionKind::Platform) {
             nearSurface = true;
             break;
@@ -163,7 +190,7 @@ Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) c
         bool nearCeiling = false;
         if (!nearSurface) {
           for (unsigned cd = 1; cd <= m_spawnCellNearCeilingDistance; ++cd) {
-            auto collision = m_facade->collision({x, y + cd});
+            auto collision = m_facade->collision({x, y + (int)cd});
             if (BlockCollisionSet.contains(collision)) {
               nearCeiling = true;
               break;
@@ -171,33 +198,41 @@ Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) c
           }
         }
 
-        if (nearSurface)
-          ++nearSurfaceCount;
-        else if (nearCeiling)
-          ++nearCeilingCount;
-        else
-          ++airCount;
+        if (nearSurface) {
+          flags |= SpawnTileNearSurface;
+          ++cellTiles.nearSurfaceCount;
+        } else if (nearCeiling) {
+          flags |= SpawnTileNearCeiling;
+          ++cellTiles.nearCeilingCount;
+        } else {
+          flags |= SpawnTileAir;
+          ++cellTiles.airCount;
+        }
       }
     }
   }
 
+  return cellTiles;
+}
+
+Maybe<SpawnParameters> Spawner::spawnParametersForCell(SpawnCellTiles const& cellTiles) const {
   Set<SpawnParameters::Area> spawnAreas;
-  if (liquidCount > m_spawnCellMinimumLiquidTiles)
+  if (cellTiles.liquidCount > m_spawnCellMinimumLiquidTiles)
     spawnAreas.add(SpawnParameters::Area::Liquid);
-  if (nearSurfaceCount > m_spawnCellMinimumNearSurfaceTiles)
+  if (cellTiles.nearSurfaceCount > m_spawnCellMinimumNearSurfaceTiles)
     spawnAreas.add(SpawnParameters::Area::Surface);
-  if (nearCeilingCount > m_spawnCellMinimumNearCeilingTiles)
+  if (cellTiles.nearCeilingCount > m_spawnCellMinimumNearCeilingTiles)
     spawnAreas.add(SpawnParameters::Area::Ceiling);
-  if (airCount > m_spawnCellMinimumAirTiles)
+  if (cellTiles.airCount > m_spawnCellMinimumAirTiles)
     spawnAreas.add(SpawnParameters::Area::Air);
-  if (emptyCount < m_spawnCellMinimumEmptyTiles)
+  if (cellTiles.emptyCount < m_spawnCellMinimumEmptyTiles)
     spawnAreas.add(SpawnParameters::Area::Solid);
 
   if (spawnAreas.empty())
     return {};
 
   SpawnParameters::Region spawnRegion = SpawnParameters::Region::Enclosed;
-  if (exposedCount >= m_spawnCellMinimumExposedTiles)
+  if (cellTiles.exposedCount >= m_spawnCellMinimumExposedTiles)
     spawnRegion = SpawnParameters::Region::Exposed;
 
   SpawnParameters::Time spawnTime = SpawnParameters::Time::Night;
@@ -207,7 +242,7 @@ Maybe<SpawnParameters> Spawner::spawnParametersForCell(Vec2I const& cellIndex) c
   return SpawnParameters(spawnAreas, spawnRegion, spawnTime);
 }
 
-Maybe<Vec2F> Spawner::adjustSpawnRegion(RectF const& spawnRegion, RectF const& boundBox, SpawnParameters const& spawnParameters) const {
+Maybe<Vec2F> Spawner::adjustSpawnRegion(RectF const& spawnRegion, SpawnCellTiles const& cellTiles, RectF const& boundBox, SpawnParameters const& spawnParameters) const {
   auto checkPosition = [&](Vec2F const& position) -> bool {
     RectF region = RectF(boundBox).translated(position);
 
@@ -243,14 +278,49 @@ Maybe<Vec2F> Spawner::adjustSpawnRegion(RectF const& spawnRegion, RectF const& b
     return false;
   };
 
-  List<Vec2F> tryPositions;
+  // Every position is still a candidate, but positions whose tile was
+  // classified as matching one of the spawn areas are far more likely to
+  // pass, so try those first.
+  uint8_t preferredFlags = 0;
+  if (spawnParameters.areas.contains(SpawnParameters::Area::Liquid))
+    preferredFlags |= SpawnTileLiquid;
+  if (spawnParameters.areas.contains(SpawnParameters::Area::Surface))
+    preferredFlags |= SpawnTileNearSurface;
+  if (spawnParameters.areas.contains(SpawnParameters::Area::Ceiling))
+    preferredFlags |= SpawnTileNearCeiling;
+  if (spawnParameters.areas.contains(SpawnParameters::Area::Air))
+    preferredFlags |= SpawnTileAir;
+  bool preferSolid = spawnParameters.areas.contains(SpawnParameters::Area::Solid);
+
+  auto isPreferred = [&](Vec2F const& position) {
+    Vec2I tile = Vec2I::floor(position - spawnRegion.min());
+    if (tile[0] < 0 || tile[1] < 0 || tile[0] >= (int)m_spawnCellSize || tile[1] >= (int)m_spawnCellSize)
+      return false;
+    uint8_t flags = cellTiles.tiles[tile[0] * m_spawnCellSize + tile[1]];
+    if (!(flags & SpawnTileEmpty))
+      return preferSolid;
+    return (flags & preferredFlags) != 0;
+  };
+
+  List<Vec2F> preferredPositions;
+  List<Vec2F> otherPositions;
   for (float x = spawnRegion.xMin(); x <= spawnRegion.xMax(); x += m_spawnCheckResolution) {
-    for (float y = spawnRegion.yMin(); y <= spawnRegion.yMax(); y += m_spawnCheckResolution)
-      tryPositions.append({x, y});
+    for (float y = spawnRegion.yMin(); y <= spawnRegion.yMax(); y += m_spawnCheckResolution) {
+      if (isPreferred({x, y}))
+        preferredPositions.append({x, y});
+      else
+        otherPositions.append({x, y});
+    }
+  }
+
+  Random::shuffle(preferredPositions);
+  for (auto const& p : preferredPositions) {
+    if (checkPosition(p))
+      return p;
   }
 
-  Random::shuffle(tryPositions);
-  for (auto const& p : tryPositions) {
+  Random::shuffle(otherPositions);
+  for (auto const& p : otherPositions) {
     if (checkPosition(p))
       return p;
   }
@@ -259,7 +329,8 @@ Maybe<Vec2F> Spawner::adjustSpawnRegion(RectF const& spawnRegion, RectF const& b
 }
 
 void Spawner::spawnInCell(Vec2I const& cell) {
-  auto cellSpawnParameters = spawnParametersForCell(cell);
+  auto tiles = cellTiles(cell);
+  auto cellSpawnParameters = spawnParametersForCell(tiles);
   if (!cellSpawnParameters)
     return;
 
@@ -293,7 +364,7 @@ void Spawner::spawnInCell(Vec2I const& cell) {
         if (m_debug)
           m_debugSpawnInfo[cell].spawnAttempts++;
 
-        if (auto position = adjustSpawnRegion(spawnRegion, monsterBoundBox, spawnType.spawnParameters)) {
+        if (auto position = adjustSpawnRegion(spawnRegion, tiles, monsterBoundBox, spawnType.spawnParameters)) {
           float level = m_facade->threatLevel();
           if (m_facade->dayLevel() >= m_minimumDayLevel)
             level += Random::randf(spawnType.dayLevelAdjustment[0], spawnType.dayLevelAdjustment[1]);
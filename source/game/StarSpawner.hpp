@@ -61,6 +61,10 @@ public:
 
   void update(float dt);
 
+  // Invalidates the cached tile classification of any spawn cell whose
+  // spawn parameters could depend on the tile at the given position.
+  void tilesModified(Vec2I const& position);
+
 private:
   struct SpawnCellDebugInfo {
     SpawnParameters spawnParameters;
@@ -68,16 +72,43 @@ private:
     int spawnAttempts;
   };
 
+  enum SpawnTileFlag : uint8_t {
+    SpawnTileEmpty = 1 << 0,
+    SpawnTileLiquid = 1 << 1,
+    SpawnTileExposed = 1 << 2,
+    SpawnTileNearSurface = 1 << 3,
+    SpawnTileNearCeiling = 1 << 4,
+    SpawnTileAir = 1 << 5
+  };
+
+  // Per-tile classification of a spawn cell, stored column major, along with
+  // the totals of each classification.
+  struct SpawnCellTiles {
+    List<uint8_t> tiles;
+    unsigned emptyCount;
+    unsigned nearSurfaceCount;
+    unsigned nearCeilingCount;
+    unsigned airCount;
+    unsigned liquidCount;
+    unsigned exposedCount;
+  };
+
   Vec2I cellIndexForPosition(Vec2F const& position) const;
   List<Vec2I> cellIndexesForRange(RectF const& range) const;
   RectF cellRegion(Vec2I const& cellIndex) const;
 
+  // Classifies every tile in the cell, or returns the cached classification if
+  // no tile affecting it has changed since it was last computed.
+  SpawnCellTiles cellTiles(Vec2I const& cellIndex);
+  SpawnCellTiles classifyCellTiles(Vec2I const& cellIndex) const;
+
   // Is the cell spawnable, and if so, what are the valid spawn parameters for it?
-  Maybe<SpawnParameters> spawnParametersForCell(Vec2I const& cellIndex) const;
+  Maybe<SpawnParameters> spawnParametersForCell(SpawnCellTiles const& cellTiles) const;
 
   // Finds a position for the given bounding box inside the given spawn cell
-  // which matches the given spawn parameters.
-  Maybe<Vec2F> adjustSpawnRegion(RectF const& spawnRegion, RectF const& boundBox, SpawnParameters const& spawnParameters) const;
+  // which matches the given spawn parameters.  Positions whose tile is
+  // classified as matching the spawn area are tried first.
+  Maybe<Vec2F> adjustSpawnRegion(RectF const& spawnRegion, SpawnCellTiles const& cellTiles, RectF const& boundBox, SpawnParameters const& spawnParameters) const;
 
   // Spawns monsters in a newly active cell
   void spawnInCell(Vec2I const& cell);
@@ -108,6 +139,7 @@ private:
   SpawnerFacadePtr m_facade;
   HashSet<EntityId> m_spawnedEntities;
   HashMap<Vec2I, float> m_activeSpawnCells;
+  HashTtlCache<Vec2I, SpawnCellTiles> m_cellTilesCache;
 
   bool m_debug;
   HashMap<Vec2I, SpawnCellDebugInfo> m_debugSpawnInfo;
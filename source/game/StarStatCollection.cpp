@@ -161,6 +161,10 @@ void StatCollection::tickSlave(float) {
   m_stats.update(0.0f);
 }
 
+uint64_t StatCollection::recalculationCount() const {
+  return m_stats.recalculationCount();
+}
+
 void StatCollection::netElementsNeedLoad(bool) {
   if (m_statModifiersNetState.pullUpdated()) {
     StatModifierGroupMap allModifiers;
@@ -51,6 +51,10 @@ public:
   void tickMaster(float dt);
   void tickSlave(float dt);
 
+  // Number of times the effective stats have been recalculated, for
+  // benchmarking.
+  uint64_t recalculationCount() const;
+
 private:
   void netElementsNeedLoad(bool full) override;
   void netElementsNeedStore() override;
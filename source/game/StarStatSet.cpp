@@ -6,13 +6,13 @@ namespace Star {
 void StatSet::addStat(String statName, float baseValue) {
   if (!m_baseStats.insert(std::move(statName), baseValue).second)
     throw StatusException::format("Added duplicate stat named '{}' in StatSet", statName);
-  update(0.0f);
+  m_statsDirty = true;
 }
 
 void StatSet::removeStat(String const& statName) {
   if (!m_baseStats.remove(statName))
     throw StatusException::format("No such base stat '{}' in StatSet", statName);
-  update(0.0f);
+  m_statsDirty = true;
 }
 
 StringList StatSet::baseStatNames() const {
@@ -33,7 +33,7 @@ void StatSet::setStatBaseValue(String const& statName, float value) {
   if (auto s = m_baseStats.ptr(statName)) {
     if (*s != value) {
       *s = value;
-      update(0.0f);
+      m_statsDirty = true;
     }
   } else {
     throw StatusException::format("No such base stat '{}' in StatSet", statName);
@@ -44,7 +44,7 @@ StatModifierGroupId StatSet::addStatModifierGroup(List<StatModifier> modifiers)
   bool empty = modifiers.empty();
   auto id = m_statModifierGroups.add(std::move(modifiers));
   if (!empty)
-    update(0.0f);
+    m_statsDirty = true;
   return id;
 }
 
@@ -60,14 +60,14 @@ void StatSet::addStatModifierGroup(StatModifierGroupId groupId, List<StatModifie
   bool empty = modifiers.empty();
   m_statModifierGroups.add(groupId, std::move(modifiers));
   if (!empty)
-    update(0.0f);
+    m_statsDirty = true;
 }
 
 bool StatSet::setStatModifierGroup(StatModifierGroupId groupId, List<StatModifier> modifiers) {
   auto& list = m_statModifierGroups.get(groupId);
   if (list != modifiers) {
     list = std::move(modifiers);
-    update(0.0f);
+    m_statsDirty = true;
     return true;
   }
 
@@ -76,7 +76,7 @@ bool StatSet::setStatModifierGroup(StatModifierGroupId groupId, List<StatModifie
 
 bool StatSet::removeStatModifierGroup(StatModifierGroupId modifierSetId) {
   if (m_statModifierGroups.remove(modifierSetId)) {
-    update(0.0f);
+    m_statsDirty = true;
     return true;
   }
   return false;
@@ -85,7 +85,7 @@ bool StatSet::removeStatModifierGroup(StatModifierGroupId modifierSetId) {
 void StatSet::clearStatModifiers() {
   if (!m_statModifierGroups.empty()) {
     m_statModifierGroups.clear();
-    update(0.0f);
+    m_statsDirty = true;
   }
 }
 
@@ -96,19 +96,22 @@ StatModifierGroupMap const& StatSet::allStatModifierGroups() const {
 void StatSet::setAllStatModifierGroups(StatModifierGroupMap map) {
   if (m_statModifierGroups != map) {
     m_statModifierGroups = std::move(map);
-    update(0.0f);
+    m_statsDirty = true;
   }
 }
 
 StringList StatSet::effectiveStatNames() const {
+  resolveStats();
   return m_effectiveStats.keys();
 }
 
 bool StatSet::isEffectiveStat(String const& statName) const {
+  resolveStats();
   return m_effectiveStats.contains(statName);
 }
 
 float StatSet::statEffectiveValue(String const& statName) const {
+  resolveStats();
   // All stat values will be added to m_effectiveStats regardless of whether a
   // modifier is applied for it.
   if (auto modified = m_effectiveStats.ptr(statName))
@@ -121,7 +124,7 @@ void StatSet::addResource(String resourceName, MVariant<String, float> max, MVar
   auto pair = m_resources.insert({std::move(resourceName), Resource{std::move(max), std::move(delta), false, 0.0f, {}}});
   if (!pair.second)
     throw StatusException::format("Added duplicate resource named '{}' in StatSet", resourceName);
-  update(0.0f);
+  m_statsDirty = true;
 }
 
 void StatSet::removeResource(String const& resourceName) {
@@ -146,6 +149,7 @@ bool StatSet::isResource(String const& resourceName) const {
 }
 
 float StatSet::resourceValue(String const& resourceName) const {
+  resolveStats();
   if (auto r = m_resources.ptr(resourceName))
     return r->value;
   return 0.0f;
@@ -161,6 +165,7 @@ float StatSet::modifyResourceValue(String const& resourceName, float amount) {
 }
 
 float StatSet::giveResourceValue(String const& resourceName, float amount) {
+  resolveStats();
   if (auto r = m_resources.ptr(resourceName)) {
     float previousValue = r->value;
     r->setValue(r->value + amount);
@@ -212,6 +217,52 @@ float StatSet::modifyResourcePercentage(String const& resourceName, float resour
 }
 
 void StatSet::update(float dt) {
+  resolveStats();
+
+  if (dt != 0.0f) {
+    for (auto& p : m_resources) {
+      float delta = 0.0f;
+      if (p.second.delta.is<String>())
+        delta = statEffectiveValue(p.second.delta.get<String>());
+      else if (p.second.delta.is<float>())
+        delta = p.second.delta.get<float>();
+      p.second.setValue(p.second.value + delta * dt);
+    }
+  }
+}
+
+uint64_t StatSet::recalculationCount() const {
+  return m_recalculationCount;
+}
+
+float StatSet::Resource::setValue(float v) {
+  if (maxValue)
+    value = clamp(v, 0.0f, *maxValue);
+  else
+    value = Star::max(v, 0.0f);
+  return value;
+}
+
+StatSet::Resource const& StatSet::getResource(String const& resourceName) const {
+  resolveStats();
+  if (auto r = m_resources.ptr(resourceName))
+    return *r;
+  throw StatusException::format("No such resource '{}' in StatSet", resourceName);
+}
+
+StatSet::Resource& StatSet::getResource(String const& resourceName) {
+  resolveStats();
+  if (auto r = m_resources.ptr(resourceName))
+    return *r;
+  throw StatusException::format("No such resource '{}' in StatSet", resourceName);
+}
+
+void StatSet::resolveStats() const {
+  if (!m_statsDirty)
+    return;
+  m_statsDirty = false;
+  ++m_recalculationCount;
+
   // We use two intermediate values for calculating the effective stat value.
   // The baseModifiedValue represents the application of the base percentage
   // modifiers and the value modifiers, which only depend on the baseValue.
@@ -259,8 +310,7 @@ void StatSet::update(float dt) {
     }
   }
 
-  // Then update all the resources due to charging and percentage tracking,
-  // after updating the stats.
+  // Then update the resource maximums, after updating the stats.
 
   for (auto& p : m_resources) {
     Maybe<float> newMaxValue;
@@ -278,42 +328,14 @@ void StatSet::update(float dt) {
     p.second.maxValue = newMaxValue;
     if (p.second.maxValue)
       p.second.value = clamp(p.second.value, 0.0f, *p.second.maxValue);
-
-    if (dt != 0.0f) {
-      float delta = 0.0f;
-      if (p.second.delta.is<String>())
-        delta = statEffectiveValue(p.second.delta.get<String>());
-      else if (p.second.delta.is<float>())
-        delta = p.second.delta.get<float>();
-      p.second.setValue(p.second.value + delta * dt);
-    }
   }
 }
 
-float StatSet::Resource::setValue(float v) {
-  if (maxValue)
-    value = clamp(v, 0.0f, *maxValue);
-  else
-    value = Star::max(v, 0.0f);
-  return value;
-}
-
-StatSet::Resource const& StatSet::getResource(String const& resourceName) const {
-  if (auto r = m_resources.ptr(resourceName))
-    return *r;
-  throw StatusException::format("No such resource '{}' in StatSet", resourceName);
-}
-
-StatSet::Resource& StatSet::getResource(String const& resourceName) {
-  if (auto r = m_resources.ptr(resourceName))
-    return *r;
-  throw StatusException::format("No such resource '{}' in StatSet", resourceName);
-}
-
 bool StatSet::consumeResourceValue(String const& resourceName, float amount, bool allowOverConsume) {
   if (amount < 0.0f)
     throw StatusException::format("StatSet, consumeResource called with negative amount '{}' {}", resourceName, amount);
 
+  resolveStats();
   if (auto r = m_resources.ptr(resourceName)) {
     if (r->locked)
       return false;
@@ -31,6 +31,10 @@ STAR_CLASS(StatSet);
 // if "health" is a stat with a max of 100, and the current health value is 50,
 // and the max health stat is changed to 200 through any means, the health
 // value will automatically update to 100.
+//
+// Changes to base stats, modifiers and resources only mark the effective
+// stats as dirty, they are recalculated at most once, the next time an
+// effective stat or resource is read or on the next update.
 class StatSet {
 public:
   void addStat(String statName, float baseValue = 0.0f);
@@ -114,6 +118,9 @@ public:
 
   void update(float dt);
 
+  // Number of times effective stats have been recalculated.
+  uint64_t recalculationCount() const;
+
 private:
   struct EffectiveStat {
     float baseValue;
@@ -141,10 +148,17 @@ private:
 
   bool consumeResourceValue(String const& resourceName, float amount, bool allowOverConsume);
 
+  // Recalculates the effective stats and resource maximums if anything they
+  // depend on has changed.
+  void resolveStats() const;
+
   StringMap<float> m_baseStats;
-  StringMap<EffectiveStat> m_effectiveStats;
   StatModifierGroupMap m_statModifierGroups;
-  StringMap<Resource> m_resources;
+
+  mutable StringMap<EffectiveStat> m_effectiveStats;
+  mutable StringMap<Resource> m_resources;
+  mutable bool m_statsDirty = false;
+  mutable uint64_t m_recalculationCount = 0;
 };
 
 }
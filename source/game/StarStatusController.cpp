@@ -418,7 +418,7 @@ void StatusController::init(Entity* parentEntity, ActorMovementController* movem
     initPrimaryScript();
     for (auto& p : m_uniqueEffects.keys())
       if (auto effect = m_uniqueEffects.ptr(p))
-        initUniqueEffectScript(*effect);
+        initUniqueEffect(*effect);
   }
 
   m_environmentStatusEffectUpdateTimer.reset();
@@ -430,7 +430,7 @@ void StatusController::uninit() {
 
   for (auto& p : m_uniqueEffects.keys())
     if (auto effect = m_uniqueEffects.ptr(p))
-      uninitUniqueEffectScript(*effect);
+      uninitUniqueEffect(*effect);
   uninitPrimaryScript();
 
   m_recentHitsGiven.reset();
@@ -522,6 +522,7 @@ void StatusController::tickMaster(float dt) {
   m_primaryScript.update(m_primaryScript.updateDt(dt));
   for (auto& p : m_uniqueEffects) {
     p.second.script.update(p.second.script.updateDt(dt));
+    tickNativeEffect(p.second, dt);
     auto metadata = m_uniqueEffectMetadata.getNetElement(p.second.metadataId);
     if (metadata->duration)
       *metadata->duration -= dt;
@@ -737,9 +738,10 @@ bool StatusController::addUniqueEffect(
           m_effectAnimators.addNetElement(make_shared<EffectAnimator>(uniqueEffect.effectConfig.animationConfig));
 
     uniqueEffect.toolUsageSuppressed = false;
+    uniqueEffect.nativeDamageTimer = 0.0f;
 
     if (m_parentEntity)
-      initUniqueEffectScript(uniqueEffect);
+      initUniqueEffect(uniqueEffect);
 
     return true;
   } else {
@@ -753,7 +755,7 @@ void StatusController::removeUniqueEffect(UniqueStatusEffect const& effect) {
 
   uniqueEffect.script.invoke("onExpire");
 
-  uninitUniqueEffectScript(uniqueEffect);
+  uninitUniqueEffect(uniqueEffect);
 
   m_uniqueEffectMetadata.removeNetElement(uniqueEffect.metadataId);
 
@@ -782,7 +784,22 @@ void StatusController::uninitPrimaryScript() {
   m_primaryScript.removeActorMovementCallbacks();
 }
 
-void StatusController::initUniqueEffectScript(UniqueEffectInstance& uniqueEffect) {
+void StatusController::initUniqueEffect(UniqueEffectInstance& uniqueEffect) {
+  if (auto const& native = uniqueEffect.effectConfig.native) {
+    if (!native->statModifiers.empty())
+      uniqueEffect.modifierGroups.add(m_statCollection.addStatModifierGroup(native->statModifiers));
+    if (native->parentDirectives)
+      uniqueEffect.parentDirectives = *native->parentDirectives;
+    if (uniqueEffect.animatorId != EffectAnimatorGroup::NullElementId) {
+      auto animator = m_effectAnimators.getNetElement(uniqueEffect.animatorId);
+      for (auto const& emitter : native->particleEmitters)
+        animator->animator.setParticleEmitterActive(emitter, true);
+    }
+  }
+
+  if (uniqueEffect.effectConfig.scripts.empty())
+    return;
+
   uniqueEffect.script.addCallbacks("effect", makeUniqueEffectCallbacks(uniqueEffect));
   uniqueEffect.script.addCallbacks("status", LuaBindings::makeStatusControllerCallbacks(this));
   uniqueEffect.script.addCallbacks("config", LuaBindings::makeConfigCallbacks([&uniqueEffect](String const& name, Json const& def) {
@@ -797,7 +814,7 @@ void StatusController::initUniqueEffectScript(UniqueEffectInstance& uniqueEffect
   uniqueEffect.script.init(m_parentEntity->world());
 }
 
-void StatusController::uninitUniqueEffectScript(UniqueEffectInstance& uniqueEffect) {
+void StatusController::uninitUniqueEffect(UniqueEffectInstance& uniqueEffect) {
   uniqueEffect.script.uninit();
   uniqueEffect.script.removeCallbacks("effect");
   uniqueEffect.script.removeCallbacks("status");
@@ -811,6 +828,23 @@ void StatusController::uninitUniqueEffectScript(UniqueEffectInstance& uniqueEffe
   uniqueEffect.modifierGroups.clear();
 }
 
+void StatusController::tickNativeEffect(UniqueEffectInstance& uniqueEffect, float dt) {
+  auto const& native = uniqueEffect.effectConfig.native;
+  if (!native || !native->damage || !m_parentEntity)
+    return;
+
+  auto const& damage = *native->damage;
+  uniqueEffect.nativeDamageTimer -= dt;
+  while (uniqueEffect.nativeDamageTimer <= 0.0f) {
+    uniqueEffect.nativeDamageTimer += damage.interval;
+
+    auto metadata = m_uniqueEffectMetadata.getNetElement(uniqueEffect.metadataId);
+    EntityId sourceEntityId = metadata->sourceEntityId.get().value(m_parentEntity->entityId());
+    float amount = damage.amount + damage.maxHealthPercentage * resourceMax("health").value(0.0f);
+    applySelfDamageRequest(DamageRequest(HitType::Hit, damage.damageType, amount, Vec2F(), sourceEntityId, damage.damageSourceKind, {}));
+  }
+}
+
 LuaCallbacks StatusController::makeUniqueEffectCallbacks(UniqueEffectInstance& uniqueEffect) {
   LuaCallbacks callbacks;
 
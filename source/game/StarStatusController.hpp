@@ -187,6 +187,7 @@ private:
     UniqueEffectMetadataGroup::ElementId metadataId;
     EffectAnimatorGroup::ElementId animatorId;
     bool toolUsageSuppressed;
+    float nativeDamageTimer;
   };
 
   void updateAnimators(float dt);
@@ -199,8 +200,11 @@ private:
   void initPrimaryScript();
   void uninitPrimaryScript();
 
-  void initUniqueEffectScript(UniqueEffectInstance& uniqueEffect);
-  void uninitUniqueEffectScript(UniqueEffectInstance& uniqueEffect);
+  // Applies the native behavior of the effect, and only creates a script
+  // context if the effect actually has scripts.
+  void initUniqueEffect(UniqueEffectInstance& uniqueEffect);
+  void uninitUniqueEffect(UniqueEffectInstance& uniqueEffect);
+  void tickNativeEffect(UniqueEffectInstance& uniqueEffect, float dt);
 
   LuaCallbacks makeUniqueEffectCallbacks(UniqueEffectInstance& uniqueEffect);
 
@@ -42,6 +42,8 @@ UniqueStatusEffectConfig StatusEffectDatabase::parseUniqueEffect(Json const& con
         jsonToStringList(config.get("scripts", JsonArray{})).transformed(bind(&AssetPath::relativeTo, path, _1));
     effect.scriptDelta = config.getUInt("scriptDelta", 1);
     effect.animationConfig = config.optString("animationConfig").apply(bind(&AssetPath::relativeTo, path, _1));
+    if (auto native = config.opt("native"))
+      effect.native = parseNativeEffect(*native);
     effect.label = config.getString("label", "");
     effect.description = config.getString("description", "");
     effect.icon = config.optString("icon").apply(bind(&AssetPath::relativeTo, path, _1));
@@ -51,6 +53,43 @@ UniqueStatusEffectConfig StatusEffectDatabase::parseUniqueEffect(Json const& con
   }
 }
 
+NativeStatusEffectConfig StatusEffectDatabase::parseNativeEffect(Json const& config) const {
+  NativeStatusEffectConfig native;
+  native.statModifiers = config.getArray("statModifiers", {}).transformed(jsonToStatModifier);
+  if (auto damage = config.opt("damage")) {
+    native.damage = NativeStatusEffectDamage{
+      damage->getFloat("amount", 0.0f),
+      damage->getFloat("maxHealthPercentage", 0.0f),
+      damage->getFloat("interval", 1.0f),
+      DamageTypeNames.getLeft(damage->getString("damageType", "IgnoresDef")),
+      damage->getString("damageSourceKind", "")
+    };
+    if (native.damage->interval <= 0.0f)
+      throw StatusEffectDatabaseException("Native status effect damage interval must be positive");
+  }
+  native.parentDirectives = config.optString("parentDirectives");
+  native.particleEmitters = jsonToStringList(config.get("particleEmitters", JsonArray()));
+  return native;
+}
+
+Json NativeStatusEffectConfig::toJson() const {
+  JsonObject config = {
+    {"statModifiers", statModifiers.transformed(jsonFromStatModifier)},
+    {"parentDirectives", jsonFromMaybe(parentDirectives)},
+    {"particleEmitters", jsonFromStringList(particleEmitters)}
+  };
+  if (damage) {
+    config["damage"] = JsonObject{
+      {"amount", damage->amount},
+      {"maxHealthPercentage", damage->maxHealthPercentage},
+      {"interval", damage->interval},
+      {"damageType", DamageTypeNames.getRight(damage->damageType)},
+      {"damageSourceKind", damage->damageSourceKind}
+    };
+  }
+  return config;
+}
+
 JsonObject UniqueStatusEffectConfig::toJson() {
   return {
     {"name", name},
@@ -60,6 +99,7 @@ JsonObject UniqueStatusEffectConfig::toJson() {
     {"scripts", jsonFromStringList(scripts)},
     {"scriptDelta", scriptDelta},
     {"animationConfig", animationConfig.isValid() ? animationConfig.value() : Json()},
+    {"native", native.isValid() ? native->toJson() : Json()},
     {"label", label},
     {"description", description},
     {"icon", icon.isValid() ? icon.value() : Json()}
@@ -2,6 +2,7 @@
 
 #include "StarThread.hpp"
 #include "StarStatusTypes.hpp"
+#include "StarDamageTypes.hpp"
 
 namespace Star {
 
@@ -9,7 +10,30 @@ STAR_EXCEPTION(StatusEffectDatabaseException, StarException);
 
 STAR_CLASS(StatusEffectDatabase);
 
-// Named, unique, unstackable scripted effects.
+// Periodic self damage applied by a native effect, every interval seconds
+// deals amount plus maxHealthPercentage of the entity's maximum health.
+struct NativeStatusEffectDamage {
+  float amount;
+  float maxHealthPercentage;
+  float interval;
+  DamageType damageType;
+  String damageSourceKind;
+};
+
+// Declarative effect behavior that StatusController evaluates itself, so that
+// common effects (stat modifiers, damage over time, directives and particle
+// emitters) do not need a Lua context per affected entity.
+struct NativeStatusEffectConfig {
+  List<StatModifier> statModifiers;
+  Maybe<NativeStatusEffectDamage> damage;
+  Maybe<String> parentDirectives;
+  StringList particleEmitters;
+
+  Json toJson() const;
+};
+
+// Named, unique, unstackable effects.  Effects are either scripted, native,
+// or both, in which case the native behavior is applied alongside the scripts.
 struct UniqueStatusEffectConfig {
   String name;
   Maybe<String> blockingStat;
@@ -18,6 +42,7 @@ struct UniqueStatusEffectConfig {
   StringList scripts;
   unsigned scriptDelta;
   Maybe<String> animationConfig;
+  Maybe<NativeStatusEffectConfig> native;
 
   String label;
   String description;
@@ -36,6 +61,7 @@ public:
 
 private:
   UniqueStatusEffectConfig parseUniqueEffect(Json const& config, String const& path) const;
+  NativeStatusEffectConfig parseNativeEffect(Json const& config) const;
 
   HashMap<UniqueStatusEffect, UniqueStatusEffectConfig> m_uniqueEffects;
 };
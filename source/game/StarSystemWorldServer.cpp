@@ -110,9 +110,11 @@ void SystemWorldServer::addClientShip(ConnectionId clientId, Uuid const& uuid, f
   pair<Uuid, SystemLocation> clientShip = {ship->uuid(), ship->systemLocation()};
   m_outgoingPackets[clientId].append(make_shared<SystemWorldStartPacket>(m_location, objectStores, shipStores, clientShip));
 
+  auto shipCreatePacket = make_shared<SystemShipCreatePacket>(ship->netStore());
+  shipCreatePacket->setBroadcast();
   for (ConnectionId otherClient : m_clientShips.keys()) {
     if (otherClient != clientId)
-      m_outgoingPackets[otherClient].append(make_shared<SystemShipCreatePacket>(ship->netStore()));
+      m_outgoingPackets[otherClient].append(shipCreatePacket);
   }
 }
 
@@ -226,17 +228,21 @@ void SystemWorldServer::update(float dt) {
 
   // remove objects and ships after queueing update packets to ensure they're not updated after being removed
   for (auto objectUuid : take(m_objectDestroyQueue)) {
+    auto destroyPacket = make_shared<SystemObjectDestroyPacket>(objectUuid);
+    destroyPacket->setBroadcast();
     for (auto p : m_clientNetVersions) {
       p.second.objects.remove(objectUuid);
-      m_outgoingPackets[p.first].append(make_shared<SystemObjectDestroyPacket>(objectUuid));
+      m_outgoingPackets[p.first].append(destroyPacket);
     }
     m_objects.remove(objectUuid);
     m_triggerStorage = true;
   }
   for (auto shipUuid : take(m_shipDestroyQueue)) {
+    auto destroyPacket = make_shared<SystemShipDestroyPacket>(shipUuid);
+    destroyPacket->setBroadcast();
     for (auto p : m_clientNetVersions) {
       p.second.ships.remove(shipUuid);
-      m_outgoingPackets[p.first].append(make_shared<SystemShipDestroyPacket>(shipUuid));
+      m_outgoingPackets[p.first].append(destroyPacket);
     }
     m_ships.remove(shipUuid);
     m_triggerStorage = true;
@@ -260,28 +266,74 @@ List<ConnectionId> SystemWorldServer::pullShipFlights() {
 }
 
 void SystemWorldServer::queueUpdatePackets() {
-  for (auto clientId : m_clientNetVersions.keys()) {
-    auto versions = m_clientNetVersions.ptr(clientId);
-
-    HashMap<Uuid, ByteArray> shipUpdates;
-    for (auto ship : m_ships.values()) {
-      uint64_t version = versions->ships.maybe(ship->uuid()).value(0);
-      auto shipUpdate = ship->writeNetState(version, {});
-      versions->ships.set(ship->uuid(), shipUpdate.second);
-      if (!shipUpdate.first.empty())
-        shipUpdates.set(ship->uuid(), shipUpdate.first);
-    }
+  auto ships = m_ships.values();
+  auto objects = m_objects.values();
+
+  // Clients that have seen the same version of every ship and object are
+  // sent the same update, so each distinct set of versions is only written
+  // once, and the packet is shared between them.  Every update brings the
+  // client to the same current versions.
+  Map<List<uint64_t>, PacketPtr> updatePackets;
+  List<uint64_t> currentVersions;
+  for (auto& p : m_clientNetVersions) {
+    auto& versions = p.second;
+
+    List<uint64_t> fromVersions;
+    fromVersions.reserve(ships.size() + objects.size());
+    for (auto const& ship : ships)
+      fromVersions.append(versions.ships.value(ship->uuid(), 0));
+    for (auto const& object : objects)
+      fromVersions.append(versions.objects.value(object->uuid(), 0));
+
+    auto updatePacket = updatePackets.find(fromVersions);
+    if (updatePacket == updatePackets.end()) {
+      currentVersions.clear();
+
+      HashMap<Uuid, ByteArray> shipUpdates;
+      for (size_t i = 0; i < ships.size(); ++i) {
+        auto shipUpdate = ships[i]->writeNetState(fromVersions[i], {});
+        currentVersions.append(shipUpdate.second);
+        if (!shipUpdate.first.empty())
+          shipUpdates.set(ships[i]->uuid(), std::move(shipUpdate.first));
+      }
+
+      HashMap<Uuid, ByteArray> objectUpdates;
+      for (size_t i = 0; i < objects.size(); ++i) {
+        auto objectUpdate = objects[i]->writeNetState(fromVersions[ships.size() + i], {});
+        currentVersions.append(objectUpdate.second);
+        if (!objectUpdate.first.empty())
+          objectUpdates.set(objects[i]->uuid(), std::move(objectUpdate.first));
+      }
 
-    HashMap<Uuid, ByteArray> objectUpdates;
-    for (auto object : m_objects.values()) {
-      uint64_t version = versions->objects.maybe(object->uuid()).value(0);
-      auto objectUpdate = object->writeNetState(version, {});
-      versions->objects.set(object->uuid(), objectUpdate.second);
-      if (!objectUpdate.first.empty())
-        objectUpdates.set(object->uuid(), objectUpdate.first);
+      // Clients have nothing to do with an empty update
+      PacketPtr packet;
+      if (!shipUpdates.empty() || !objectUpdates.empty())
+        packet = make_shared<SystemWorldUpdatePacket>(std::move(objectUpdates), std::move(shipUpdates));
+      updatePacket = updatePackets.insert(std::move(fromVersions), std::move(packet)).first;
+    } else if (updatePacket->second) {
+      updatePacket->second->setBroadcast();
     }
-    m_outgoingPackets[clientId].append(make_shared<SystemWorldUpdatePacket>(objectUpdates, shipUpdates));
+
+    for (size_t i = 0; i < ships.size(); ++i)
+      versions.ships.set(ships[i]->uuid(), currentVersions[i]);
+    for (size_t i = 0; i < objects.size(); ++i)
+      versions.objects.set(objects[i]->uuid(), currentVersions[ships.size() + i]);
+
+    if (updatePacket->second)
+      m_outgoingPackets[p.first].append(updatePacket->second);
+  }
+}
+
+bool SystemWorldServer::idle() const {
+  for (auto const& p : m_ships) {
+    if (p.second->flying())
+      return false;
+  }
+  for (auto const& p : m_objects) {
+    if (!p.second->orbit())
+      return false;
   }
+  return m_objectDestroyQueue.empty() && m_shipDestroyQueue.empty();
 }
 
 void SystemWorldServer::handleIncomingPacket(ConnectionId, PacketPtr packet) {
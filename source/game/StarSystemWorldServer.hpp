@@ -37,6 +37,10 @@ public:
   bool addObject(SystemObjectPtr object, bool doRangeCheck = false);
 
   void update(float dt);
+  // True when no ship is flying and every object is in orbit, so that
+  // nothing moves except along orbits, which follow the universe clock and
+  // can be updated rarely.
+  bool idle() const;
 
   List<SystemObjectPtr> objects() const override;
   List<Uuid> objectKeys() const override;
@@ -1,6 +1,7 @@
 #include "StarSystemWorldServerThread.hpp"
 #include "StarTickRateMonitor.hpp"
 #include "StarNetPackets.hpp"
+#include "StarTime.hpp"
 
 namespace Star {
 
@@ -9,11 +10,17 @@ SystemWorldServerThread::SystemWorldServerThread(Vec3I const& location, SystemWo
   , m_systemLocation(location)
   , m_systemWorld(std::move(systemWorld))
   , m_storageFile(storageFile)
+  , m_tickApproacher(1.0 / SystemWorldTimestep, 0.5)
 {
 }
 
 SystemWorldServerThread::~SystemWorldServerThread() {
   m_stop = true;
+  if (m_scheduler && m_scheduled) {
+    m_scheduler->remove(this);
+    m_scheduled = false;
+    store();
+  }
   join();
 }
 
@@ -21,6 +28,20 @@ Vec3I SystemWorldServerThread::location() const {
   return m_systemLocation;
 }
 
+void SystemWorldServerThread::setScheduler(WorldServerSchedulerPtr scheduler, double idleUpdateInterval) {
+  m_scheduler = std::move(scheduler);
+  m_idleUpdateInterval = idleUpdateInterval;
+}
+
+void SystemWorldServerThread::start() {
+  if (m_scheduler) {
+    m_scheduled = true;
+    m_scheduler->add(this);
+  } else {
+    Thread::start();
+  }
+}
+
 List<ConnectionId> SystemWorldServerThread::clients() {
   return m_clients.values();
 }
@@ -35,6 +56,9 @@ void SystemWorldServerThread::addClient(ConnectionId clientId, Uuid const& uuid,
   m_clientShipLocations.set(clientId, {m_systemWorld->clientShipLocation(clientId), m_systemWorld->clientSkyParameters(clientId)});
   if (auto warpAction = m_systemWorld->clientWarpAction(clientId))
     m_clientWarpActions.set(clientId, *warpAction);
+  locker.unlock();
+
+  wakeScheduled();
 }
 
 void SystemWorldServerThread::removeClient(ConnectionId clientId) {
@@ -44,6 +68,9 @@ void SystemWorldServerThread::removeClient(ConnectionId clientId) {
   m_clientShipDestinations.remove(clientId);
   m_clientShipLocations.remove(clientId);
   m_outgoingPacketQueue.remove(clientId);
+  locker.unlock();
+
+  wakeScheduled();
 }
 
 void SystemWorldServerThread::setPause(shared_ptr<const atomic<bool>> pause) {
@@ -51,29 +78,69 @@ void SystemWorldServerThread::setPause(shared_ptr<const atomic<bool>> pause) {
 }
 
 void SystemWorldServerThread::run() {
-  TickRateApproacher tickApproacher(1.0 / SystemWorldTimestep, 0.5);
-
   while (!m_stop) {
-    LogMap::set(strf("system_{}_update_rate", m_systemLocation), strf("{:4.2f}Hz", tickApproacher.rate()));
+    double spareTime = updateLoopStep();
+    if (spareTime > 0)
+      sleepPrecise(floor(spareTime * 1000));
+  }
+
+  store();
+}
 
-    update();
+double SystemWorldServerThread::updateLoopStep() {
+  double now = Time::monotonicTime();
+  // After sleeping while idle, start counting the tick rate afresh rather than
+  // running the missed ticks back to back.
+  if (m_lastUpdate != 0.0 && now - m_lastUpdate > m_tickApproacher.window()) {
+    m_tickApproacher = TickRateApproacher(m_tickApproacher.targetTickRate(), m_tickApproacher.window());
+    m_tickApproacher.tick(m_tickApproacher.targetTickRate() * m_tickApproacher.window());
+  }
 
-    m_periodicStorage -= 1.0 / tickApproacher.rate();
-    if (m_triggerStorage || m_periodicStorage <= 0.0) {
-      m_triggerStorage = false;
-      m_periodicStorage = 300.0; // store every 5 minutes
-      store();
-    }
+  LogMap::set(strf("system_{}_update_rate", m_systemLocation), strf("{:4.2f}Hz", m_tickApproacher.rate()));
 
-    tickApproacher.tick();
+  update();
 
-    double spareTime = tickApproacher.spareTime();
-    uint64_t millis = floor(spareTime * 1000);
-    if (spareTime > 0)
-      sleepPrecise(millis);
+  m_periodicStorage -= m_lastUpdate != 0.0 ? now - m_lastUpdate : 0.0;
+  m_lastUpdate = now;
+  if (m_triggerStorage || m_periodicStorage <= 0.0) {
+    m_triggerStorage = false;
+    m_periodicStorage = 300.0; // store every 5 minutes
+    store();
   }
 
-  store();
+  m_tickApproacher.tick();
+  return m_tickApproacher.spareTime();
+}
+
+Maybe<double> SystemWorldServerThread::scheduledUpdate() {
+  if (m_stop)
+    return {};
+
+  try {
+    return updateLoopStep();
+  } catch (std::exception const& e) {
+    Logger::error("SystemWorldServerThread exception caught: {}", outputException(e, true));
+    m_stop = true;
+    return {};
+  }
+}
+
+bool SystemWorldServerThread::idle() const {
+  ReadLocker queueLocker(m_queueMutex);
+  if (!m_incomingPacketQueue.empty() || !m_clientShipActions.empty() || !m_clientShipDestinations.empty())
+    return false;
+
+  ReadLocker locker(m_mutex);
+  return m_systemWorld->idle();
+}
+
+Maybe<double> SystemWorldServerThread::idleTimeout() const {
+  return m_idleUpdateInterval;
+}
+
+void SystemWorldServerThread::wakeScheduled() {
+  if (m_scheduler)
+    m_scheduler->wake(this);
 }
 
 void SystemWorldServerThread::stop() {
@@ -123,11 +190,17 @@ void SystemWorldServerThread::update() {
 void SystemWorldServerThread::setClientDestination(ConnectionId clientId, SystemLocation const& destination) {
   WriteLocker locker(m_queueMutex);
   m_clientShipDestinations.set(clientId, destination);
+  locker.unlock();
+
+  wakeScheduled();
 }
 
 void SystemWorldServerThread::executeClientShipAction(ConnectionId clientId, ClientShipAction action) {
   WriteLocker locker(m_queueMutex);
   m_clientShipActions.append({clientId, std::move(action)});
+  locker.unlock();
+
+  wakeScheduled();
 }
 
 SystemLocation SystemWorldServerThread::clientShipLocation(ConnectionId clientId) {
@@ -161,6 +234,9 @@ void SystemWorldServerThread::setUpdateAction(function<void(SystemWorldServerThr
 void SystemWorldServerThread::pushIncomingPacket(ConnectionId clientId, PacketPtr packet) {
   WriteLocker locker(m_queueMutex);
   m_incomingPacketQueue.append({std::move(clientId), std::move(packet)});
+  locker.unlock();
+
+  wakeScheduled();
 }
 
 List<PacketPtr> SystemWorldServerThread::pullOutgoingPackets(ConnectionId clientId) {
@@ -3,6 +3,8 @@
 #include "StarSystemWorldServer.hpp"
 #include "StarThread.hpp"
 #include "StarNetPackets.hpp"
+#include "StarTickRateMonitor.hpp"
+#include "StarWorldServerScheduler.hpp"
 
 namespace Star {
 
@@ -10,13 +12,20 @@ STAR_CLASS(SystemWorldServerThread);
 
 typedef function<void(SystemClientShip*)> ClientShipAction;
 
-class SystemWorldServerThread : public Thread {
+class SystemWorldServerThread : public Thread, public WorldServerScheduler::Updatable {
 public:
   SystemWorldServerThread(Vec3I const& location, SystemWorldServerPtr systemWorld, String storageFile);
   ~SystemWorldServerThread();
 
   Vec3I location() const;
 
+  // Run the update loop on the given scheduler instead of on this thread.
+  // While no ship is flying, the system is only updated every idle update
+  // interval, or sooner when a client does something.  Must be called before
+  // start().
+  void setScheduler(WorldServerSchedulerPtr scheduler, double idleUpdateInterval);
+  void start();
+
   List<ConnectionId> clients();
   void addClient(ConnectionId clientId, Uuid const& uuid, float shipSpeed, SystemLocation const& location);
   void removeClient(ConnectionId clientId);
@@ -44,6 +53,15 @@ public:
   void store();
 
 private:
+  // Runs a single iteration of the update loop, returns the time in seconds
+  // until the next iteration should run.
+  double updateLoopStep();
+  Maybe<double> scheduledUpdate() override;
+  // True if the system world is idle and no packets or actions are waiting.
+  bool idle() const override;
+  Maybe<double> idleTimeout() const override;
+  void wakeScheduled();
+
   Vec3I m_systemLocation;
   SystemWorldServerPtr m_systemWorld;
 
@@ -55,8 +73,15 @@ private:
   shared_ptr<const atomic<bool>> m_pause;
   function<void(SystemWorldServerThread*)> m_updateAction;
 
-  ReadersWriterMutex m_mutex;
-  ReadersWriterMutex m_queueMutex;
+  TickRateApproacher m_tickApproacher;
+  double m_lastUpdate{0.0};
+
+  WorldServerSchedulerPtr m_scheduler;
+  double m_idleUpdateInterval{1.0};
+  atomic<bool> m_scheduled{false};
+
+  mutable ReadersWriterMutex m_mutex;
+  mutable ReadersWriterMutex m_queueMutex;
 
   HashSet<ConnectionId> m_clients;
   HashMap<ConnectionId, SystemLocation> m_clientShipDestinations;
@@ -54,6 +54,13 @@ TerrainSelector::TerrainSelector(String type, Json config, TerrainSelectorParame
 
 TerrainSelector::~TerrainSelector() {}
 
+void TerrainSelector::getRegion(RectI const& region, float* out) const {
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x)
+      *out++ = get(x, y);
+  }
+}
+
 TerrainDatabase::TerrainDatabase() {
   auto assets = Root::singleton().assets();
 
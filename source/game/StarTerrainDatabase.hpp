@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarJson.hpp"
+#include "StarRect.hpp"
 #include "StarThread.hpp"
 
 namespace Star {
@@ -33,6 +34,12 @@ struct TerrainSelector {
   // considered solid, < 0.0 should be considered open space.
   virtual float get(int x, int y) const = 0;
 
+  // Evaluates every tile in the given region (max exclusive) at once, writing
+  // the value for (x, y) to
+  // out[(x - region.xMin()) + (y - region.yMin()) * region.width()].
+  // Must give the same values as get, the default simply calls it per tile.
+  virtual void getRegion(RectI const& region, float* out) const;
+
   String type;
   Json config;
   TerrainSelectorParameters parameters;
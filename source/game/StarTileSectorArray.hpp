@@ -73,6 +73,16 @@ public:
   // Will return nullptr if the position is invalid.
   Tile* modifyTile(Vec2I const& pos);
 
+  // Each sector has a revision that is bumped whenever its tiles may have
+  // changed: by modifyTile, tileEval, the non-const sectorArray, or by the
+  // sector being loaded or unloaded.  Revisions come from a single counter for
+  // the whole array and are never reused, so if a sector or region has the
+  // same revision as before then none of its tiles have changed since.
+  // Invalid sectors have revision 0.
+  uint64_t sectorRevision(Sector const& sector) const;
+  // The latest revision of every sector overlapping the given region.
+  uint64_t regionRevision(RectI const& region) const;
+
   // Function signature here is (Vec2I const&, Tile const&).  Will be called
   // for the entire region, valid or not.  If tile positions are not valid,
   // they will be called with the defaultTile.
@@ -103,6 +113,8 @@ public:
   template <typename Function>
   void tileEachColumns(RectI const& region, Function&& function) const;
   template <typename Function>
+  void tileEachColumnsParallel(RectI const& region, Function&& function) const;
+  template <typename Function>
   void tileEvalColumns(RectI const& region, Function&& function);
   template <typename Function>
   void tileEvalColumnsParallel(RectI const& region, Function&& function);
@@ -136,9 +148,50 @@ private:
   // Clamp the rect to entirely within valid tile spaces in y dimension
   RectI yClampRect(RectI const& r) const;
 
+  void bumpSectorRevision(Sector const& sector);
+  void bumpRegionRevision(RectI const& region);
+
   Vec2U m_worldSize;
   Tile m_default;
   SectorArray m_tileSectors;
+
+  uint64_t m_revision = 0;
+  MultiArray<uint64_t, 2> m_sectorRevisions;
+};
+
+// Keeps a single derived field of every tile in a TileSectorArray in its own
+// sector array, so that passes which only need that field stream through a
+// much smaller element than the whole tile.  The tile array itself stays the
+// storage of record, and the column is refreshed lazily per sector from the
+// tile array's sector revisions, so sectors that have not changed since the
+// last refresh are not rebuilt.
+template <typename TileSectorArrayT, typename ElementT>
+class TileSectorColumn {
+public:
+  typedef TileSectorArrayT TileArray;
+  typedef ElementT Element;
+  typedef typename TileArray::Sector Sector;
+  typedef TileSectorArray<Element, TileArray::SectorSize> ElementArray;
+
+  // Forgets every cached sector, must be called when switching to a different
+  // tile array, as revisions are only meaningful within a single array.
+  void clear();
+
+  // Rebuilds every sector overlapping the given region that has changed in
+  // the tile array since it was last refreshed, by calling
+  // function(Tile const&) -> Element for each of its tiles.  Sectors that are
+  // not loaded in the tile array are not loaded in the column either.
+  // Returns the number of sectors rebuilt.
+  template <typename Function>
+  size_t refresh(TileArray const& tiles, RectI const& region, Function&& function);
+
+  // Element storage laid out like the tile array, only valid for the regions
+  // that have been refreshed.
+  ElementArray const& elements() const;
+
+private:
+  ElementArray m_elements;
+  MultiArray<uint64_t, 2> m_sourceRevisions;
 };
 
 template <typename Tile, unsigned SectorSize>
@@ -158,6 +211,9 @@ void TileSectorArray<Tile, SectorSize>::init(Vec2U const& size, Tile defaultTile
   // Initialize to enough sectors to fit world size at least.
   m_tileSectors.init((size[0] + SectorSize - 1) / SectorSize, (size[1] + SectorSize - 1) / SectorSize);
   m_default = std::move(defaultTile);
+  // m_revision keeps counting, so no revision from before is handed out again
+  m_sectorRevisions.setSize((size[0] + SectorSize - 1) / SectorSize, (size[1] + SectorSize - 1) / SectorSize);
+  m_sectorRevisions.forEach([this](Array2S const&, uint64_t& revision) { revision = ++m_revision; });
 }
 
 template <typename Tile, unsigned SectorSize>
@@ -212,14 +268,18 @@ auto TileSectorArray<Tile, SectorSize>::adjacentSector(Sector const& sector, Vec
 
 template <typename Tile, unsigned SectorSize>
 void TileSectorArray<Tile, SectorSize>::loadSector(Sector const& sector, ArrayPtr tile) {
-  if (sectorValid(sector))
+  if (sectorValid(sector)) {
     m_tileSectors.loadSector(sector, std::move(tile));
+    bumpSectorRevision(sector);
+  }
 }
 
 template <typename Tile, unsigned SectorSize>
 void TileSectorArray<Tile, SectorSize>::loadDefaultSector(Sector const& sector) {
-  if (sectorValid(sector))
+  if (sectorValid(sector)) {
     m_tileSectors.loadSector(sector, std::make_unique<Array>(m_default));
+    bumpSectorRevision(sector);
+  }
 }
 
 template <typename Tile, unsigned SectorSize>
@@ -232,10 +292,12 @@ auto TileSectorArray<Tile, SectorSize>::copySector(Sector const& sector) -> Arra
 
 template <typename Tile, unsigned SectorSize>
 auto TileSectorArray<Tile, SectorSize>::unloadSector(Sector const& sector) -> ArrayPtr {
-  if (sectorValid(sector))
+  if (sectorValid(sector)) {
+    bumpSectorRevision(sector);
     return m_tileSectors.takeSector(sector);
-  else
+  } else {
     return {};
+  }
 }
 
 template <typename Tile, unsigned SectorSize>
@@ -266,10 +328,12 @@ auto TileSectorArray<Tile, SectorSize>::sectorArray(Sector sector) const -> Arra
 
 template <typename Tile, unsigned SectorSize>
 auto TileSectorArray<Tile, SectorSize>::sectorArray(Sector sector) -> Array * {
-  if (sectorValid(sector))
+  if (sectorValid(sector)) {
+    bumpSectorRevision(sector);
     return m_tileSectors.sector(sector);
-  else
+  } else {
     return nullptr;
+  }
 }
 
 template <typename Tile, unsigned SectorSize>
@@ -306,7 +370,31 @@ Tile* TileSectorArray<Tile, SectorSize>::modifyTile(Vec2I const& pos) {
   unsigned xind = (unsigned)pmod<int>(pos[0], m_worldSize[0]);
   unsigned yind = (unsigned)pos[1];
 
-  return m_tileSectors.get(xind, yind);
+  Tile* tile = m_tileSectors.get(xind, yind);
+  if (tile)
+    bumpSectorRevision(m_tileSectors.sectorFor(xind, yind));
+  return tile;
+}
+
+template <typename Tile, unsigned SectorSize>
+uint64_t TileSectorArray<Tile, SectorSize>::sectorRevision(Sector const& sector) const {
+  if (sectorValid(sector))
+    return m_sectorRevisions(sector[0], sector[1]);
+  else
+    return 0;
+}
+
+template <typename Tile, unsigned SectorSize>
+uint64_t TileSectorArray<Tile, SectorSize>::regionRevision(RectI const& region) const {
+  uint64_t revision = 0;
+  for (auto const& split : splitRect(yClampRect(region))) {
+    auto sectorRange = m_tileSectors.sectorRange(split.rect.xMin(), split.rect.yMin(), split.rect.width(), split.rect.height());
+    for (size_t x = sectorRange.min[0]; x < sectorRange.max[0]; ++x) {
+      for (size_t y = sectorRange.min[1]; y < sectorRange.max[1]; ++y)
+        revision = max(revision, m_sectorRevisions(x, y));
+    }
+  }
+  return revision;
 }
 
 template <typename Tile, unsigned SectorSize>
@@ -372,6 +460,7 @@ void TileSectorArray<Tile, SectorSize>::tileEachTo(MultiArray& results, RectI co
 template <typename Tile, unsigned SectorSize>
 template <typename Function>
 void TileSectorArray<Tile, SectorSize>::tileEval(RectI const& region, Function&& function) {
+  bumpRegionRevision(region);
   for (auto const& split : splitRect(region)) {
     auto clampedRect = yClampRect(split.rect);
     if (!clampedRect.isEmpty()) {
@@ -389,13 +478,37 @@ void TileSectorArray<Tile, SectorSize>::tileEval(RectI const& region, Function&&
 template <typename Tile, unsigned SectorSize>
 template <typename Function>
 void TileSectorArray<Tile, SectorSize>::tileEachColumns(RectI const& region, Function&& function) const {
-  const_cast<TileSectorArray*>(this)->tileEvalColumns(
-      region, [&](Vec2I const& pos, Tile* tiles, size_t size) { function(pos, (Tile const*)tiles, size); });
+  for (auto const& split : splitRect(region)) {
+    auto clampedRect = yClampRect(split.rect);
+    if (!clampedRect.isEmpty()) {
+      auto fwrapper = [&](size_t x, size_t y, Tile const* column, size_t columnSize) {
+        function(Vec2I((int)x + split.xOffset, (int)y), column, columnSize);
+        return true;
+      };
+      m_tileSectors.evalColumns(clampedRect.xMin(), clampedRect.yMin(), clampedRect.width(), clampedRect.height(), fwrapper, false);
+    }
+  }
+}
+
+template <typename Tile, unsigned SectorSize>
+template <typename Function>
+void TileSectorArray<Tile, SectorSize>::tileEachColumnsParallel(RectI const& region, Function&& function) const {
+  for (auto const& split : splitRect(region)) {
+    auto clampedRect = yClampRect(split.rect);
+    if (!clampedRect.isEmpty()) {
+      auto fwrapper = [&](size_t x, size_t y, Tile const* column, size_t columnSize) {
+        function(Vec2I((int)x + split.xOffset, (int)y), column, columnSize);
+        return true;
+      };
+      m_tileSectors.evalColumnsParallel(clampedRect.xMin(), clampedRect.yMin(), clampedRect.width(), clampedRect.height(), fwrapper, false);
+    }
+  }
 }
 
 template <typename Tile, unsigned SectorSize>
 template <typename Function>
 void TileSectorArray<Tile, SectorSize>::tileEvalColumns(RectI const& region, Function&& function) {
+  bumpRegionRevision(region);
   for (auto const& split : splitRect(region)) {
     auto clampedRect = yClampRect(split.rect);
     if (!clampedRect.isEmpty()) {
@@ -411,6 +524,7 @@ void TileSectorArray<Tile, SectorSize>::tileEvalColumns(RectI const& region, Fun
 template <typename Tile, unsigned SectorSize>
 template <typename Function>
 void TileSectorArray<Tile, SectorSize>::tileEvalColumnsParallel(RectI const& region, Function&& function) {
+  bumpRegionRevision(region);
   for (auto const& split : splitRect(region)) {
     auto clampedRect = yClampRect(split.rect);
     if (!clampedRect.isEmpty()) {
@@ -502,4 +616,63 @@ RectI TileSectorArray<Tile, SectorSize>::yClampRect(RectI const& r) const {
   return RectI(r.xMin(), clamp<int>(r.yMin(), 0, m_worldSize[1]), r.xMax(), clamp<int>(r.yMax(), 0, m_worldSize[1]));
 }
 
+template <typename Tile, unsigned SectorSize>
+void TileSectorArray<Tile, SectorSize>::bumpSectorRevision(Sector const& sector) {
+  m_sectorRevisions(sector[0], sector[1]) = ++m_revision;
+}
+
+template <typename Tile, unsigned SectorSize>
+void TileSectorArray<Tile, SectorSize>::bumpRegionRevision(RectI const& region) {
+  for (auto const& sector : validSectorsFor(region))
+    bumpSectorRevision(sector);
+}
+
+template <typename TileSectorArrayT, typename ElementT>
+void TileSectorColumn<TileSectorArrayT, ElementT>::clear() {
+  m_elements = ElementArray();
+  m_sourceRevisions.clear();
+}
+
+template <typename TileSectorArrayT, typename ElementT>
+template <typename Function>
+size_t TileSectorColumn<TileSectorArrayT, ElementT>::refresh(TileArray const& tiles, RectI const& region, Function&& function) {
+  if (m_elements.size() != tiles.size()) {
+    m_elements.init(tiles.size());
+    m_sourceRevisions.setSize((tiles.size()[0] + TileArray::SectorSize - 1) / TileArray::SectorSize,
+        (tiles.size()[1] + TileArray::SectorSize - 1) / TileArray::SectorSize);
+    m_sourceRevisions.forEach([](auto const&, uint64_t& revision) { revision = 0; });
+  }
+
+  size_t rebuilt = 0;
+  for (auto const& sector : tiles.validSectorsFor(region)) {
+    // Read the revision first, so a sector changed while it is being rebuilt
+    // is seen as stale by the next refresh.
+    uint64_t revision = tiles.sectorRevision(sector);
+    uint64_t& sourceRevision = m_sourceRevisions(sector[0], sector[1]);
+    if (revision == sourceRevision)
+      continue;
+
+    if (auto source = tiles.sectorArray(sector)) {
+      auto target = m_elements.sectorArray(sector);
+      if (!target) {
+        m_elements.loadSector(sector, make_unique<typename ElementArray::Array>());
+        target = m_elements.sectorArray(sector);
+      }
+      for (size_t i = 0; i < TileArray::SectorSize * TileArray::SectorSize; ++i)
+        target->elements[i] = function(source->elements[i]);
+    } else {
+      m_elements.unloadSector(sector);
+    }
+
+    sourceRevision = revision;
+    ++rebuilt;
+  }
+  return rebuilt;
+}
+
+template <typename TileSectorArrayT, typename ElementT>
+auto TileSectorColumn<TileSectorArrayT, ElementT>::elements() const -> ElementArray const& {
+  return m_elements;
+}
+
 }
@@ -19,12 +19,25 @@ TreasureDatabase::TreasureDatabase() {
   assets->queueJsons(treasurePools);
   assets->queueJsons(treasureChests);
 
+  // Pools refer to each other by name, so every pool is added before any are
+  // read and references are resolved to pointers up front rather than looked
+  // up on each roll.  No pools are added after this, so the pointers stay
+  // valid.
   for (auto& file : treasurePools) {
     for (auto const& pair : assets->json(file).iterateObject()) {
       if (m_treasurePools.contains(pair.first))
         throw TreasureException(strf("Duplicate TreasurePool config '{}' from file '{}'", pair.first, file));
+      m_treasurePools[pair.first];
+    }
+  }
+
+  auto poolReference = [this](String const& name) {
+    return PoolReference{name, m_treasurePools.ptr(name)};
+  };
 
-      auto& treasurePool = m_treasurePools[pair.first];
+  for (auto& file : treasurePools) {
+    for (auto const& pair : assets->json(file).iterateObject()) {
+      auto& treasurePool = m_treasurePools.get(pair.first);
       for (auto const& entry : pair.second.iterateArray()) {
         if (entry.size() != 2)
           throw TreasureException("Wrong size for TreasurePool entry, list must be 2");
@@ -36,7 +49,7 @@ TreasureDatabase::TreasureDatabase() {
 
         for (auto const& entry : config.getArray("fill", {}))
           if (entry.contains("pool"))
-            itemPool.fill.append(entry.getString("pool"));
+            itemPool.fill.append(poolReference(entry.getString("pool")));
           else if (entry.contains("item"))
             itemPool.fill.append(ItemDescriptor(entry.get("item")));
           else
@@ -47,7 +60,7 @@ TreasureDatabase::TreasureDatabase() {
             throw TreasureException(strf("TreasurePool entry '{}' did not specify a weight", entry));
 
           if (entry.contains("pool"))
-            itemPool.pool.add(entry.getFloat("weight"), entry.getString("pool"));
+            itemPool.pool.add(entry.getFloat("weight"), poolReference(entry.getString("pool")));
           else if (entry.contains("item"))
             itemPool.pool.add(entry.getFloat("weight"), ItemDescriptor(entry.get("item")));
           else
@@ -117,26 +130,51 @@ List<ItemPtr> TreasureDatabase::createTreasure(String const& treasurePool, float
 }
 
 List<ItemPtr> TreasureDatabase::createTreasure(String const& treasurePool, float level, uint64_t seed) const {
-  return createTreasure(treasurePool, level, seed, StringSet());
+  List<String const*> visitedPools;
+  return createTreasure(treasurePool, this->treasurePool(treasurePool), level, seed, visitedPools);
 }
 
-List<ItemPtr> TreasureDatabase::createTreasure(String const& treasurePool, float level, uint64_t seed, StringSet visitedPools) const {
-  if (!m_treasurePools.contains(treasurePool))
-    throw TreasureException(strf("Unknown treasure pool '{}'", treasurePool));
+List<List<ItemPtr>> TreasureDatabase::createTreasure(String const& treasurePool, float level, List<uint64_t> const& seeds) const {
+  auto const& pool = this->treasurePool(treasurePool);
+  List<String const*> visitedPools;
+  List<List<ItemPtr>> treasure;
+  treasure.reserve(seeds.size());
+  for (uint64_t seed : seeds)
+    treasure.append(createTreasure(treasurePool, pool, level, seed, visitedPools));
+  return treasure;
+}
 
-  if (!visitedPools.add(treasurePool))
-    throw TreasureException(strf("Loop detected in treasure pool generation - set '{}' already contains '{}'", visitedPools, treasurePool));
+TreasureDatabase::TreasurePool const& TreasureDatabase::treasurePool(String const& treasurePool) const {
+  if (auto pool = m_treasurePools.ptr(treasurePool))
+    return *pool;
+  throw TreasureException(strf("Unknown treasure pool '{}'", treasurePool));
+}
+
+List<ItemPtr> TreasureDatabase::createTreasure(String const& poolName, TreasurePool const& treasurePool, float level, uint64_t seed, List<String const*>& visitedPools) const {
+  for (auto visited : visitedPools) {
+    if (*visited == poolName)
+      throw TreasureException(strf("Loop detected in treasure pool generation - set '{}' already contains '{}'",
+          visitedPools.transformed([](String const* name) { return *name; }), poolName));
+  }
+  visitedPools.append(&poolName);
+  auto popVisited = finally([&visitedPools]() { visitedPools.removeLast(); });
 
   auto itemDatabase = Root::singleton().itemDatabase();
 
+  auto createPoolTreasure = [&](PoolReference const& reference, uint64_t poolSeed) {
+    if (!reference.pool)
+      throw TreasureException(strf("Unknown treasure pool '{}'", reference.name));
+    return createTreasure(reference.name, *reference.pool, level, poolSeed, visitedPools);
+  };
+
   List<ItemPtr> treasureItems;
   HashSet<ItemDescriptor> previousDescriptors;
-  auto itemPool = m_treasurePools.get(treasurePool).get(level);
+  auto const& itemPool = treasurePool.get(level);
 
   int mix = 0;
   for (auto const& fillEntry : itemPool.fill) {
-    if (fillEntry.is<String>()) {
-      auto poolContents = createTreasure(fillEntry.get<String>(), level, seed + ++mix, visitedPools);
+    if (auto reference = fillEntry.ptr<PoolReference>()) {
+      auto poolContents = createPoolTreasure(*reference, seed + ++mix);
       for (auto item : poolContents) {
         if (itemPool.allowDuplication || previousDescriptors.add(item->descriptor().singular()))
           treasureItems.append(item);
@@ -153,17 +191,17 @@ List<ItemPtr> TreasureDatabase::createTreasure(String const& treasurePool, float
     int poolRounds = itemPool.poolRounds.select(staticRandomU64(seed, "TreasurePoolRounds"));
 
     for (int i = 0; i < poolRounds; ++i) {
-      auto poolEntry = itemPool.pool.select(staticRandomU64(seed, i, "TreasureItem"));
+      auto const& poolEntry = itemPool.pool.select(staticRandomU64(seed, i, "TreasureItem"));
 
-      if (poolEntry.is<String>()) {
-        auto poolContents = createTreasure(poolEntry.get<String>(), level, staticRandomU64(seed, i, "TreasureSeedRecursion"), visitedPools);
+      if (auto reference = poolEntry.ptr<PoolReference>()) {
+        auto poolContents = createPoolTreasure(*reference, staticRandomU64(seed, i, "TreasureSeedRecursion"));
         for (auto item : poolContents) {
           if (itemPool.allowDuplication || previousDescriptors.add(item->descriptor().singular()))
             treasureItems.append(item);
         }
       } else {
         float itemLevel = level + itemPool.levelVariance[0] + staticRandomFloat(staticRandomU64(seed, i, "TreasureLevelSeedMixer"), "PoolLevelVariance") * (itemPool.levelVariance[1] - itemPool.levelVariance[0]);
-        auto roundItem = poolEntry.get<ItemDescriptor>();
+        auto const& roundItem = poolEntry.get<ItemDescriptor>();
         if (itemPool.allowDuplication || previousDescriptors.add(roundItem.singular()))
           treasureItems.append(itemDatabase->item(roundItem, itemLevel, seed + ++mix));
       }
@@ -28,6 +28,10 @@ public:
 
   List<ItemPtr> createTreasure(String const& treasurePool, float level) const;
   List<ItemPtr> createTreasure(String const& treasurePool, float level, uint64_t seed) const;
+  // Creates treasure from the same pool once for each of the given seeds, for
+  // when many containers are filled at once.  The pool is looked up once, and
+  // items that are not built by a script are copied from shared prototypes.
+  List<List<ItemPtr>> createTreasure(String const& treasurePool, float level, List<uint64_t> const& seeds) const;
 
   // Adds created treasure to the given ItemBags, does not clear the ItemBag
   // first.  Returns overflow items.
@@ -41,12 +45,23 @@ public:
   ContainerObjectPtr createTreasureChest(World* world, String const& treasureChestSet, Vec2I const& position, Direction direction, uint64_t seed) const;
 
 private:
-  List<ItemPtr> createTreasure(String const& treasurePool, float level, uint64_t seed, StringSet visitedPools) const;
+  struct ItemPool;
+  typedef ParametricTable<float, ItemPool> TreasurePool;
+
+  struct PoolReference {
+    String name;
+    // Resolved once every pool is loaded, null if there is no such pool
+    TreasurePool const* pool;
+  };
 
-  // Specifies either an item descriptor or the name of a valid treasurepool to
-  // be
-  // used when an entry is selected in a "fill" or "pool" list
-  typedef MVariant<String, ItemDescriptor> TreasureEntry;
+  // Specifies either an item descriptor or a treasurepool to be used when an
+  // entry is selected in a "fill" or "pool" list
+  typedef MVariant<PoolReference, ItemDescriptor> TreasureEntry;
+
+  TreasurePool const& treasurePool(String const& treasurePool) const;
+
+  // visitedPools holds the pools being generated further up, to catch loops
+  List<ItemPtr> createTreasure(String const& poolName, TreasurePool const& treasurePool, float level, uint64_t seed, List<String const*>& visitedPools) const;
 
   struct ItemPool {
     ItemPool();
@@ -72,7 +87,6 @@ private:
     // Note that this flag does not apply to child pools
     bool allowDuplication;
   };
-  typedef ParametricTable<float, ItemPool> TreasurePool;
 
   struct TreasureChest {
     TreasureChest();
@@ -0,0 +1,556 @@
+#include "StarUdpPacketSocket.hpp"
+#include "StarIterator.hpp"
+#include "StarCompression.hpp"
+#include "StarLogging.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+enum class UdpDatagramType : uint8_t {
+  Hello,
+  HelloAck,
+  Data,
+  Close
+};
+
+enum class UdpChannel : uint8_t {
+  Reliable,
+  Unreliable
+};
+
+// Kept well under common path MTUs so datagrams are not fragmented.
+static size_t const UdpMaxDatagramSize = 1200;
+static size_t const UdpMaxSegmentSize = 1024;
+// Also the receive window, the most reliable segments buffered out of order.
+static float const UdpMaxCongestionWindow = 4096;
+static float const UdpMinCongestionWindow = 2;
+static float const UdpInitialCongestionWindow = 16;
+static int64_t const UdpInitialRetransmitTimeout = 500;
+static int64_t const UdpMinRetransmitTimeout = 100;
+static int64_t const UdpMaxRetransmitTimeout = 5000;
+static int64_t const UdpKeepAliveInterval = 1000;
+static int64_t const UdpConnectionTimeout = 30000;
+static int64_t const UdpHelloInterval = 100;
+static uint64_t const UdpPacketSizeLimit = 64 << 20;
+
+static ByteArray udpHelloDatagram(UdpDatagramType type, uint64_t token) {
+  DataStreamBuffer ds;
+  ds.write(type);
+  ds.write<uint64_t>(token);
+  return ds.takeData();
+}
+
+UdpPacketHostPtr UdpPacketHost::listen(HostAddressWithPort const& address) {
+  auto socket = make_shared<UdpSocket>(address.address().mode());
+  socket->setNonBlocking(true);
+  socket->bind(address);
+  return UdpPacketHostPtr(new UdpPacketHost(std::move(socket)));
+}
+
+UdpPacketHostPtr UdpPacketHost::open(NetworkMode networkMode) {
+  return listen(HostAddressWithPort(HostAddress(networkMode), 0));
+}
+
+void UdpPacketHost::expectConnection(uint64_t token) {
+  MutexLocker locker(m_mutex);
+  m_pendingConnections[token] = PendingConnection();
+}
+
+UdpPacketSocketUPtr UdpPacketHost::acceptConnection(uint64_t token) {
+  receiveDatagrams();
+
+  MutexLocker locker(m_mutex);
+  auto pending = m_pendingConnections.ptr(token);
+  if (!pending || !pending->address)
+    return {};
+
+  auto connection = m_pendingConnections.take(token);
+  return UdpPacketSocketUPtr(new UdpPacketSocket(shared_from_this(), *connection.address, std::move(connection.peer)));
+}
+
+void UdpPacketHost::cancelConnection(uint64_t token) {
+  MutexLocker locker(m_mutex);
+  if (auto connection = m_pendingConnections.maybeTake(token)) {
+    if (connection->address)
+      m_peers.remove(*connection->address);
+  }
+}
+
+UdpPacketSocketUPtr UdpPacketHost::connect(HostAddressWithPort const& address, uint64_t token, unsigned timeout) {
+  auto peer = make_shared<Peer>();
+  {
+    MutexLocker locker(m_mutex);
+    m_peers[address] = peer;
+  }
+
+  auto hello = udpHelloDatagram(UdpDatagramType::Hello, token);
+  auto helloAck = udpHelloDatagram(UdpDatagramType::HelloAck, token);
+  auto timer = Timer::withMilliseconds(timeout);
+  int64_t lastHelloTime = 0;
+  while (!timer.timeUp()) {
+    int64_t currentTime = Time::monotonicMilliseconds();
+    if (currentTime - lastHelloTime >= UdpHelloInterval) {
+      sendDatagram(address, hello);
+      lastHelloTime = currentTime;
+    }
+
+    receiveDatagrams();
+    MutexLocker peerLocker(peer->mutex);
+    for (auto it = peer->datagrams.begin(); it != peer->datagrams.end(); ++it) {
+      if (*it == helloAck) {
+        peer->datagrams.erase(it);
+        peerLocker.unlock();
+        return UdpPacketSocketUPtr(new UdpPacketSocket(shared_from_this(), address, std::move(peer)));
+      }
+    }
+    peerLocker.unlock();
+
+    Thread::sleep(1);
+  }
+
+  removePeer(address);
+  return {};
+}
+
+UdpPacketHost::UdpPacketHost(UdpSocketPtr socket) : m_socket(std::move(socket)) {}
+
+void UdpPacketHost::receiveDatagrams() {
+  MutexLocker locker(m_mutex);
+
+  char buffer[MaxUdpData];
+  while (true) {
+    HostAddressWithPort address;
+    size_t size;
+    try {
+      size = m_socket->receive(&address, buffer, MaxUdpData);
+    } catch (SocketClosedException const&) {
+      break;
+    } catch (NetworkException const& e) {
+      // Errors from earlier sends, like unreachable ports, may be reported
+      // here and should not stop the other connections.
+      Logger::debug("UdpPacketHost: error receiving datagram: {}", outputException(e, false));
+      break;
+    }
+    if (size == 0)
+      break;
+
+    if (size == 9 && buffer[0] == (char)UdpDatagramType::Hello) {
+      uint64_t token = DataStreamExternalBuffer(buffer + 1, 8).read<uint64_t>();
+      if (auto pending = m_pendingConnections.ptr(token)) {
+        if (!pending->address) {
+          pending->address = address;
+          pending->peer = make_shared<Peer>();
+          m_peers[address] = pending->peer;
+        }
+        if (*pending->address == address)
+          sendDatagram(address, udpHelloDatagram(UdpDatagramType::HelloAck, token));
+        continue;
+      }
+    }
+
+    if (auto peer = m_peers.value(address).lock()) {
+      MutexLocker peerLocker(peer->mutex);
+      peer->datagrams.append(ByteArray(buffer, size));
+    }
+  }
+}
+
+void UdpPacketHost::sendDatagram(HostAddressWithPort const& address, ByteArray const& datagram) {
+  try {
+    m_socket->send(address, datagram.ptr(), datagram.size());
+  } catch (SocketClosedException const&) {
+  } catch (NetworkException const& e) {
+    Logger::debug("UdpPacketHost: error sending datagram to {}: {}", address, outputException(e, false));
+  }
+}
+
+void UdpPacketHost::removePeer(HostAddressWithPort const& address) {
+  MutexLocker locker(m_mutex);
+  m_peers.remove(address);
+}
+
+UdpPacketSocket::~UdpPacketSocket() {
+  close();
+}
+
+bool UdpPacketSocket::isOpen() const {
+  return m_open && m_host->m_socket->isOpen();
+}
+
+void UdpPacketSocket::close() {
+  if (!m_open)
+    return;
+
+  DataStreamBuffer ds;
+  ds.write(UdpDatagramType::Close);
+  m_host->sendDatagram(m_address, ds.data());
+  m_host->removePeer(m_address);
+  m_open = false;
+}
+
+void UdpPacketSocket::sendPackets(List<PacketPtr> packets) {
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  auto it = makeSMutableIterator(packets);
+  while (it.hasNext()) {
+    PacketType currentType = it.peekNext()->type();
+    PacketCompressionMode currentCompressionMode = it.peekNext()->compressionMode();
+    bool currentUnreliable = packetIsSuperseded(*it.peekNext());
+
+    DataStreamBuffer packetBuffer;
+    packetBuffer.setStreamCompatibilityVersion(netRules());
+    while (it.hasNext()
+           && it.peekNext()->type() == currentType
+           && it.peekNext()->compressionMode() == currentCompressionMode
+           && packetIsSuperseded(*it.peekNext()) == currentUnreliable) {
+        it.next()->writeCached(packetBuffer, netRules());
+    }
+
+    // Packets must read and write actual data, because this is used to
+    // determine packet count
+    starAssert(!packetBuffer.empty());
+
+    ByteArray compressedPackets;
+    bool mustCompress = currentCompressionMode == PacketCompressionMode::Enabled;
+    bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && packetBuffer.size() > 64;
+    if (mustCompress || perhapsCompress)
+      compressedPackets = compressData(packetBuffer.data());
+
+    DataStreamBuffer outBuffer;
+    outBuffer.write(currentType);
+
+    if (!compressedPackets.empty() && (mustCompress || compressedPackets.size() < packetBuffer.size())) {
+      outBuffer.write<bool>(true);
+      outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
+      m_outgoingStats.mix(currentType, compressedPackets.size(), false);
+    } else {
+      outBuffer.write<bool>(false);
+      outBuffer.writeData(packetBuffer.ptr(), packetBuffer.size());
+      m_outgoingStats.mix(currentType, packetBuffer.size(), false);
+    }
+
+    // Unreliable messages must fit in a single datagram, larger ones are sent
+    // reliably instead.
+    if (currentUnreliable && outBuffer.size() <= UdpMaxSegmentSize) {
+      m_unreliableOutput.append(outBuffer.takeData());
+    } else {
+      DataStreamBuffer sizeBuffer;
+      sizeBuffer.writeVlqU(outBuffer.size());
+      m_reliableOutput.append(sizeBuffer.data());
+      m_reliableOutput.append(outBuffer.data());
+    }
+  }
+}
+
+List<PacketPtr> UdpPacketSocket::receivePackets() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  List<PacketPtr> packets;
+  try {
+    DataStreamExternalBuffer ds(m_reliableInput);
+    size_t trimPos = 0;
+    while (!ds.atEnd()) {
+      uint64_t messageSize;
+      try {
+        messageSize = ds.readVlqU();
+      } catch (EofException const&) {
+        break;
+      }
+
+      if (messageSize > UdpPacketSizeLimit)
+        throw IOException::format("{} byte message exceeds max size!", messageSize);
+
+      if (messageSize > ds.remaining())
+        break;
+
+      readMessage(ds.ptr() + ds.pos(), messageSize, packets);
+      ds.seek(messageSize, IOSeek::Relative);
+      trimPos = ds.pos();
+    }
+    if (trimPos)
+      m_reliableInput.trimLeft(trimPos);
+
+    for (auto const& message : take(m_unreliableInput))
+      readMessage(message.ptr(), message.size(), packets);
+  } catch (IOException const& e) {
+    Logger::warn("I/O error in UdpPacketSocket::receivePackets, closing: {}", outputException(e, false));
+    m_reliableInput.clear();
+    close();
+  }
+  return packets;
+}
+
+bool UdpPacketSocket::sentPacketsPending() const {
+  return !m_reliableOutput.empty() || !m_unacknowledgedSegments.empty() || !m_unreliableOutput.empty();
+}
+
+size_t UdpPacketSocket::sentPacketsPendingSize() const {
+  // Like the kernel buffer of a TCP socket, unacknowledged segments are not
+  // counted.
+  size_t size = m_reliableOutput.size();
+  for (auto const& message : m_unreliableOutput)
+    size += message.size();
+  return size;
+}
+
+bool UdpPacketSocket::writeData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  if (!isOpen())
+    return false;
+
+  // Acknowledgements must be seen even when only writing, to open up the
+  // congestion window and to let sentPacketsPending finish.
+  handleDatagrams();
+  if (!isOpen())
+    return false;
+
+  int64_t currentTime = Time::monotonicMilliseconds();
+  List<pair<UdpChannel, pair<uint64_t, ByteArray const*>>> chunks;
+
+  // Resend timed out segments first, and treat any timeout as congestion.
+  bool lossDetected = false;
+  for (auto& p : m_unacknowledgedSegments) {
+    if (chunks.size() >= (size_t)m_congestionWindow)
+      break;
+    if (currentTime - p.second.sentTime < m_retransmitTimeout)
+      continue;
+    lossDetected = true;
+    p.second.sentTime = currentTime;
+    ++p.second.sendCount;
+    chunks.append({UdpChannel::Reliable, {p.first, &p.second.data}});
+  }
+  if (lossDetected) {
+    m_slowStartThreshold = max(m_congestionWindow / 2, UdpMinCongestionWindow);
+    m_congestionWindow = m_slowStartThreshold;
+    m_retransmitTimeout = min(m_retransmitTimeout * 2, UdpMaxRetransmitTimeout);
+  }
+
+  while (!m_reliableOutput.empty() && m_unacknowledgedSegments.size() < (size_t)m_congestionWindow) {
+    size_t segmentSize = min(m_reliableOutput.size(), UdpMaxSegmentSize);
+    uint64_t sequence = m_nextSendSequence++;
+    auto& segment = m_unacknowledgedSegments[sequence];
+    segment.data = m_reliableOutput.sub(0, segmentSize);
+    segment.sentTime = currentTime;
+    segment.sendCount = 1;
+    m_reliableOutput.trimLeft(segmentSize);
+    chunks.append({UdpChannel::Reliable, {sequence, &segment.data}});
+  }
+
+  for (auto const& message : m_unreliableOutput)
+    chunks.append({UdpChannel::Unreliable, {m_nextUnreliableSequence++, &message}});
+
+  uint32_t sequenceBits = 0;
+  for (uint32_t i = 0; i < 32; ++i) {
+    if (m_outOfOrderSegments.contains(m_nextReceiveSequence + 1 + i))
+      sequenceBits |= 1u << i;
+  }
+
+  bool dataSent = false;
+  DataStreamBuffer datagram;
+  auto startDatagram = [&]() {
+    datagram.clear();
+    datagram.write(UdpDatagramType::Data);
+    datagram.writeVlqU(m_nextReceiveSequence);
+    datagram.write<uint32_t>(sequenceBits);
+  };
+  auto sendDatagram = [&]() {
+    m_host->sendDatagram(m_address, datagram.data());
+    m_outgoingStats.mix(datagram.size());
+    m_lastSendTime = currentTime;
+    m_acknowledgementPending = false;
+    dataSent = true;
+  };
+
+  startDatagram();
+  size_t headerSize = datagram.size();
+  for (auto const& chunk : chunks) {
+    auto const& data = *chunk.second.second;
+    // Channel and worst case sequence and size lengths
+    if (datagram.size() > headerSize && datagram.size() + 21 + data.size() > UdpMaxDatagramSize) {
+      sendDatagram();
+      startDatagram();
+    }
+    datagram.write(chunk.first);
+    datagram.writeVlqU(chunk.second.first);
+    datagram.writeVlqU(data.size());
+    datagram.writeData(data.ptr(), data.size());
+  }
+  if (datagram.size() > headerSize || m_acknowledgementPending || currentTime - m_lastSendTime >= UdpKeepAliveInterval)
+    sendDatagram();
+
+  m_unreliableOutput.clear();
+  return dataSent;
+}
+
+bool UdpPacketSocket::readData() {
+  MemoryTagScope memoryTag(MemoryTag::Network);
+  if (!isOpen())
+    return false;
+  return handleDatagrams();
+}
+
+Maybe<PacketStats> UdpPacketSocket::incomingStats() const {
+  return m_incomingStats.stats();
+}
+
+Maybe<PacketStats> UdpPacketSocket::outgoingStats() const {
+  return m_outgoingStats.stats();
+}
+
+HostAddressWithPort UdpPacketSocket::remoteAddress() const {
+  return m_address;
+}
+
+UdpPacketSocket::UdpPacketSocket(UdpPacketHostPtr host, HostAddressWithPort address, shared_ptr<UdpPacketHost::Peer> peer)
+  : m_host(std::move(host)), m_address(std::move(address)), m_peer(std::move(peer)), m_open(true) {
+  m_lastReceiveTime = Time::monotonicMilliseconds();
+  m_lastSendTime = 0;
+
+  m_nextSendSequence = 0;
+  m_congestionWindow = UdpInitialCongestionWindow;
+  m_slowStartThreshold = UdpMaxCongestionWindow;
+  m_smoothedRoundTrip = 0;
+  m_roundTripVariance = 0;
+  m_retransmitTimeout = UdpInitialRetransmitTimeout;
+
+  m_nextReceiveSequence = 0;
+  m_acknowledgementPending = false;
+
+  m_nextUnreliableSequence = 0;
+}
+
+bool UdpPacketSocket::handleDatagrams() {
+  m_host->receiveDatagrams();
+
+  MutexLocker peerLocker(m_peer->mutex);
+  auto datagrams = take(m_peer->datagrams);
+  peerLocker.unlock();
+
+  int64_t currentTime = Time::monotonicMilliseconds();
+  for (auto const& datagram : datagrams) {
+    m_incomingStats.mix(datagram.size());
+    try {
+      handleDatagram(datagram, currentTime);
+    } catch (IOException const& e) {
+      Logger::debug("UdpPacketSocket: ignoring malformed datagram from {}: {}", m_address, outputException(e, false));
+    }
+  }
+
+  if (!datagrams.empty())
+    m_lastReceiveTime = currentTime;
+  else if (m_open && currentTime - m_lastReceiveTime > UdpConnectionTimeout) {
+    Logger::warn("UdpPacketSocket: connection to {} timed out", m_address);
+    close();
+  }
+
+  return !datagrams.empty();
+}
+
+void UdpPacketSocket::handleDatagram(ByteArray const& datagram, int64_t currentTime) {
+  DataStreamExternalBuffer ds(datagram);
+  auto type = ds.read<UdpDatagramType>();
+  if (type == UdpDatagramType::Hello) {
+    // The connecting side resends its hello until it is acknowledged.
+    m_host->sendDatagram(m_address, udpHelloDatagram(UdpDatagramType::HelloAck, ds.read<uint64_t>()));
+    return;
+  } else if (type == UdpDatagramType::Close) {
+    m_host->removePeer(m_address);
+    m_open = false;
+    return;
+  } else if (type != UdpDatagramType::Data) {
+    return;
+  }
+
+  uint64_t nextSequence = ds.readVlqU();
+  uint32_t sequenceBits = ds.read<uint32_t>();
+  handleAcknowledgement(nextSequence, sequenceBits, currentTime);
+
+  while (!ds.atEnd()) {
+    auto channel = ds.read<UdpChannel>();
+    uint64_t sequence = ds.readVlqU();
+    uint64_t size = ds.readVlqU();
+    if (size > ds.remaining())
+      throw IOException("Truncated datagram chunk");
+
+    if (channel == UdpChannel::Reliable) {
+      m_acknowledgementPending = true;
+      if (sequence == m_nextReceiveSequence) {
+        m_reliableInput.append(ds.ptr() + ds.pos(), size);
+        ++m_nextReceiveSequence;
+        while (auto segment = m_outOfOrderSegments.maybeTake(m_nextReceiveSequence)) {
+          m_reliableInput.append(*segment);
+          ++m_nextReceiveSequence;
+        }
+      } else if (sequence > m_nextReceiveSequence && sequence - m_nextReceiveSequence <= (uint64_t)UdpMaxCongestionWindow) {
+        m_outOfOrderSegments[sequence] = ByteArray(ds.ptr() + ds.pos(), size);
+      }
+    } else if (channel == UdpChannel::Unreliable) {
+      if (!m_lastUnreliableSequence || sequence > *m_lastUnreliableSequence) {
+        m_lastUnreliableSequence = sequence;
+        m_unreliableInput.append(ByteArray(ds.ptr() + ds.pos(), size));
+      }
+    }
+    ds.seek(size, IOSeek::Relative);
+  }
+}
+
+void UdpPacketSocket::handleAcknowledgement(uint64_t nextSequence, uint32_t sequenceBits, int64_t currentTime) {
+  auto acknowledge = [&](Segment const& segment) {
+    // Round trip times are only measured from segments sent once, as it is
+    // not known which send a resent segment's acknowledgement is for.
+    if (segment.sendCount == 1) {
+      float roundTrip = currentTime - segment.sentTime;
+      if (m_smoothedRoundTrip == 0) {
+        m_smoothedRoundTrip = roundTrip;
+        m_roundTripVariance = roundTrip / 2;
+      } else {
+        m_roundTripVariance = 0.75f * m_roundTripVariance + 0.25f * std::fabs(m_smoothedRoundTrip - roundTrip);
+        m_smoothedRoundTrip = 0.875f * m_smoothedRoundTrip + 0.125f * roundTrip;
+      }
+      m_retransmitTimeout = clamp<int64_t>(m_smoothedRoundTrip + 4 * m_roundTripVariance, UdpMinRetransmitTimeout, UdpMaxRetransmitTimeout);
+    }
+
+    if (m_congestionWindow < m_slowStartThreshold)
+      m_congestionWindow += 1;
+    else
+      m_congestionWindow += 1 / m_congestionWindow;
+    m_congestionWindow = min(m_congestionWindow, UdpMaxCongestionWindow);
+  };
+
+  while (!m_unacknowledgedSegments.empty() && m_unacknowledgedSegments.begin()->first < nextSequence) {
+    acknowledge(m_unacknowledgedSegments.begin()->second);
+    m_unacknowledgedSegments.erase(m_unacknowledgedSegments.begin());
+  }
+
+  for (uint32_t i = 0; i < 32; ++i) {
+    if (sequenceBits & (1u << i)) {
+      auto it = m_unacknowledgedSegments.find(nextSequence + 1 + i);
+      if (it != m_unacknowledgedSegments.end()) {
+        acknowledge(it->second);
+        m_unacknowledgedSegments.erase(it);
+      }
+    }
+  }
+}
+
+void UdpPacketSocket::readMessage(char const* data, size_t size, List<PacketPtr>& packets) {
+  DataStreamExternalBuffer ds(data, size);
+  PacketType packetType = ds.read<PacketType>();
+  bool packetCompressed = ds.read<bool>();
+  size_t packetSize = ds.size() - ds.pos();
+
+  ByteArray packetBytes = ds.readBytes(packetSize);
+  if (packetCompressed)
+    packetBytes = uncompressData(packetBytes, UdpPacketSizeLimit);
+
+  m_incomingStats.mix(packetType, packetSize, false);
+
+  DataStreamExternalBuffer packetStream(packetBytes);
+  packetStream.setStreamCompatibilityVersion(netRules());
+  do {
+    PacketPtr packet = createPacket(packetType);
+    packet->setCompressionMode(packetCompressed ? PacketCompressionMode::Enabled : PacketCompressionMode::Disabled);
+    packet->read(packetStream, netRules());
+    packets.append(std::move(packet));
+  } while (!packetStream.atEnd());
+}
+
+}
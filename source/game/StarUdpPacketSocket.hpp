@@ -0,0 +1,139 @@
+#pragma once
+
+#include "StarNetPacketSocket.hpp"
+#include "StarUdp.hpp"
+
+namespace Star {
+
+STAR_CLASS(UdpPacketHost);
+STAR_CLASS(UdpPacketSocket);
+
+// Owns a UDP socket shared by every UdpPacketSocket connected through it, and
+// routes incoming datagrams to the socket for their remote address.
+//
+// Connections are negotiated out of band: the accepting side gives a random
+// token to the connecting side (over the TCP connection, in the protocol
+// response), and the connecting side presents it in its hello datagram.
+class UdpPacketHost : public std::enable_shared_from_this<UdpPacketHost> {
+public:
+  // Binds to the given address to accept connections.
+  static UdpPacketHostPtr listen(HostAddressWithPort const& address);
+  // Binds to any free port to connect to a listening host.
+  static UdpPacketHostPtr open(NetworkMode networkMode);
+
+  // Allows a single connection presenting the given token to be accepted.
+  void expectConnection(uint64_t token);
+  // Returns the connection made with the given token once its hello has been
+  // received, null otherwise.  The token is no longer expected afterwards.
+  UdpPacketSocketUPtr acceptConnection(uint64_t token);
+  void cancelConnection(uint64_t token);
+
+  // Sends hellos with the given token until one is acknowledged, returns null
+  // if none are within the timeout.
+  UdpPacketSocketUPtr connect(HostAddressWithPort const& address, uint64_t token, unsigned timeout);
+
+private:
+  friend class UdpPacketSocket;
+
+  struct Peer {
+    Mutex mutex;
+    Deque<ByteArray> datagrams;
+  };
+
+  struct PendingConnection {
+    Maybe<HostAddressWithPort> address;
+    shared_ptr<Peer> peer;
+  };
+
+  UdpPacketHost(UdpSocketPtr socket);
+
+  // Reads every waiting datagram, answering hellos for expected tokens and
+  // queueing the rest on the peer they came from.
+  void receiveDatagrams();
+  void sendDatagram(HostAddressWithPort const& address, ByteArray const& datagram);
+  void removePeer(HostAddressWithPort const& address);
+
+  UdpSocketPtr m_socket;
+
+  Mutex m_mutex;
+  HashMap<HostAddressWithPort, weak_ptr<Peer>> m_peers;
+  HashMap<uint64_t, PendingConnection> m_pendingConnections;
+};
+
+// PacketSocket over a UdpPacketHost.  Packets are sent on a reliable ordered
+// channel, except for packet types that are superseded by the next packet of
+// the same type, which go on an unreliable sequenced channel where they are
+// never resent and never wait behind lost reliable data.  The reliable
+// channel is limited by an AIMD congestion window, and retransmits on a
+// timeout derived from the measured round trip time.
+class UdpPacketSocket : public PacketSocket {
+public:
+  ~UdpPacketSocket();
+
+  bool isOpen() const override;
+  void close() override;
+
+  void sendPackets(List<PacketPtr> packets) override;
+  List<PacketPtr> receivePackets() override;
+
+  // Includes data that has been sent but not yet acknowledged.
+  bool sentPacketsPending() const override;
+  size_t sentPacketsPendingSize() const override;
+
+  bool writeData() override;
+  bool readData() override;
+
+  Maybe<PacketStats> incomingStats() const override;
+  Maybe<PacketStats> outgoingStats() const override;
+
+  HostAddressWithPort remoteAddress() const;
+
+private:
+  friend class UdpPacketHost;
+
+  struct Segment {
+    ByteArray data;
+    int64_t sentTime;
+    unsigned sendCount;
+  };
+
+  UdpPacketSocket(UdpPacketHostPtr host, HostAddressWithPort address, shared_ptr<UdpPacketHost::Peer> peer);
+
+  // Handles every datagram queued for this socket, returns true if there were
+  // any.
+  bool handleDatagrams();
+  void handleDatagram(ByteArray const& datagram, int64_t currentTime);
+  void handleAcknowledgement(uint64_t nextSequence, uint32_t sequenceBits, int64_t currentTime);
+  void readMessage(char const* data, size_t size, List<PacketPtr>& packets);
+
+  UdpPacketHostPtr m_host;
+  HostAddressWithPort m_address;
+  shared_ptr<UdpPacketHost::Peer> m_peer;
+  bool m_open;
+  int64_t m_lastReceiveTime;
+  int64_t m_lastSendTime;
+
+  PacketStatCollector m_incomingStats;
+  PacketStatCollector m_outgoingStats;
+
+  ByteArray m_reliableOutput;
+  uint64_t m_nextSendSequence;
+  Map<uint64_t, Segment> m_unacknowledgedSegments;
+  float m_congestionWindow;
+  float m_slowStartThreshold;
+  float m_smoothedRoundTrip;
+  float m_roundTripVariance;
+  int64_t m_retransmitTimeout;
+
+  ByteArray m_reliableInput;
+  uint64_t m_nextReceiveSequence;
+  Map<uint64_t, ByteArray> m_outOfOrderSegments;
+  bool m_acknowledgementPending;
+
+  Deque<ByteArray> m_unreliableOutput;
+  uint64_t m_nextUnreliableSequence;
+  Deque<ByteArray> m_unreliableInput;
+  Maybe<uint64_t> m_lastUnreliableSequence;
+};
+
+}
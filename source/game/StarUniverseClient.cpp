@@ -13,6 +13,8 @@
 #include "StarTime.hpp"
 #include "StarNetPackets.hpp"
 #include "StarTcp.hpp"
+#include "StarUdpPacketSocket.hpp"
+#include "StarSessionPacketSocket.hpp"
 #include "StarWorldClient.hpp"
 #include "StarSystemWorldClient.hpp"
 #include "StarClientContext.hpp"
@@ -26,6 +28,9 @@
 
 namespace Star {
 
+// Milliseconds between attempts to reconnect while resuming a session
+static int64_t const SessionResumeAttemptInterval = 1000;
+
 UniverseClient::UniverseClient(PlayerStoragePtr playerStorage, StatisticsPtr statistics) {
   m_storageTriggerDeadline = 0;
   m_playerStorage = std::move(playerStorage);
@@ -66,21 +71,66 @@ PlayerPtr UniverseClient::mainPlayer() const {
 }
 
 Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowAssetsMismatch, String const& account, String const& password, bool const& forceLegacy) {
-  auto& root = Root::singleton();
-  auto assets = root.assets();
-
   reset();
   m_disconnectReason = {};
 
   if (!m_mainPlayer)
     throw StarException("Cannot call UniverseClient::connect with no main player");
 
+  m_connectSettings = ConnectSettings{allowAssetsMismatch, account, password, forceLegacy};
+  auto result = handshake(connection, m_connectSettings, makeClientConnect(true));
+  if (result.isLeft())
+    return result.left();
+  auto& handshake = result.right();
+  auto const& packet = handshake.reply;
+
+  if (auto success = as<ConnectSuccessPacket>(packet)) {
+    m_universeClock = make_shared<Clock>();
+    m_clientContext = make_shared<ClientContext>(success->serverUuid, m_mainPlayer->uuid());
+    m_clientContext->setNetCompatibilityRules(handshake.netRules);
+    m_teamClient = make_shared<TeamClient>(m_mainPlayer, m_clientContext);
+    m_mainPlayer->setClientContext(m_clientContext);
+    m_mainPlayer->setStatistics(m_statistics);
+    m_worldClient = make_shared<WorldClient>(m_mainPlayer, m_luaRoot);
+    m_worldClient->clientState().setNetCompatibilityRules(handshake.netRules);
+    m_worldClient->setAsyncLighting(true);
+
+    auto sessionToken = handshake.serverInfo.optUInt("sessionToken");
+    if (sessionToken && m_reconnect) {
+      // The session starts after ConnectSuccess, on both ends
+      auto received = connection.pull();
+      m_connection = UniverseConnection(make_unique<SessionPacketSocket>(connection.takePacketSocket(), std::move(received)));
+      m_session = Session{*sessionToken, handshake.serverInfo.getFloat("sessionResumeTime"), {}};
+    } else {
+      m_connection = std::move(connection);
+    }
+    m_celestialDatabase = make_shared<CelestialSlaveDatabase>(std::move(success->celestialInformation));
+    m_systemWorldClient = make_shared<SystemWorldClient>(m_universeClock, m_celestialDatabase, m_mainPlayer->universeMap());
+
+    Logger::info("UniverseClient: Joined {} server as client {}", handshake.legacyServer ? "Starbound" : "OpenStarbound", success->clientId);
+    return {};
+  } else if (auto failure = as<ConnectFailurePacket>(packet)) {
+    Logger::error("UniverseClient: Join failed: {}", failure->reason);
+    return failure->reason;
+  } else if (packet) {
+    return String(strf("Join failed! Expected ConnectSuccess/Failure, got {}", PacketTypeNames.getRight(packet->type())));
+  } else {
+    return String("Join failed! Expected ConnectSuccess/Failure, but none received");
+  }
+
+  return {};
+}
+
+Either<String, UniverseClient::Handshake> UniverseClient::handshake(UniverseConnection& connection, ConnectSettings const& settings, shared_ptr<ClientConnectPacket> clientConnect) {
+  auto& root = Root::singleton();
+  auto assets = root.assets();
+
   unsigned timeout = assets->json("/client.config:serverConnectTimeout").toUInt();
   Logger::info("UniverseClient: Connecting to server, packet timeout is {}ms", timeout);
 
   {
     auto protocolRequest = make_shared<ProtocolRequestPacket>(StarProtocolVersion);
-    if (!forceLegacy) {
+    if (!settings.forceLegacy) {
       protocolRequest->setCompressionMode(PacketCompressionMode::Enabled);
       // Signal that we're OpenStarbound. Vanilla Starbound only compresses
       // packets above 64 bytes - by forcing it, we can communicate this.
@@ -93,52 +143,76 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
   auto nextPacket = connection.pullSingle();
   auto protocolResponsePacket = as<ProtocolResponsePacket>(nextPacket);
   if (!nextPacket)
-    return String("Join failed! Expected ProtocolResponse, but none received");
+    return makeLeft(String("Join failed! Expected ProtocolResponse, but none received"));
   else if (!protocolResponsePacket)
-    return String(strf("Join failed! Expected ProtocolResponse, got {}", PacketTypeNames.getRight(nextPacket->type())));
+    return makeLeft(String(strf("Join failed! Expected ProtocolResponse, got {}", PacketTypeNames.getRight(nextPacket->type()))));
   else if (!protocolResponsePacket->allowed)
-    return String(strf("Join failed! Server does not support connections with protocol version {}", StarProtocolVersion));
+    return makeLeft(String(strf("Join failed! Server does not support connections with protocol version {}", StarProtocolVersion)));
 
-  NetCompatibilityRules compatibilityRules;
-  compatibilityRules.setVersion(LegacyVersion);
-  bool legacyServer = forceLegacy || (protocolResponsePacket->compressionMode() != PacketCompressionMode::Enabled);
-  if (!legacyServer) {
+  Handshake handshake;
+  handshake.netRules.setVersion(LegacyVersion);
+  handshake.legacyServer = settings.forceLegacy || (protocolResponsePacket->compressionMode() != PacketCompressionMode::Enabled);
+  if (!handshake.legacyServer) {
     auto compressedSocket = as<CompressedPacketSocket>(&connection.packetSocket());
     if (protocolResponsePacket->info) {
-      compatibilityRules.setVersion(protocolResponsePacket->info.getUInt("openProtocolVersion", 1));
+      handshake.serverInfo = protocolResponsePacket->info;
+      handshake.netRules.setVersion(protocolResponsePacket->info.getUInt("openProtocolVersion", 1));
       auto compressionName = protocolResponsePacket->info.getString("compression", "None");
       if (compressedSocket) {
         auto compressionMode = NetCompressionModeNames.maybeLeft(compressionName);
         if (!compressionMode)
-          return String(strf("Join failed! Unknown net stream connection type '{}'", compressionName));
+          return makeLeft(String(strf("Join failed! Unknown net stream connection type '{}'", compressionName)));
 
         Logger::info("UniverseClient: Using '{}' network stream compression", NetCompressionModeNames.getRight(*compressionMode));
         compressedSocket->setCompressionStreamEnabled(compressionMode == NetCompressionMode::Zstd);
       }
     } else {
-      compatibilityRules.setVersion(1); // A version of 1 is OpenStarbound prior to the NetElement compatibility stuff
+      handshake.netRules.setVersion(1); // A version of 1 is OpenStarbound prior to the NetElement compatibility stuff
       if (compressedSocket) {
         Logger::info("UniverseClient: Defaulting to Zstd network stream compression (older server version)");
         compressedSocket->setCompressionStreamEnabled(true);
       }
     }
   }
-  connection.packetSocket().setNetRules(compatibilityRules);
-  auto clientConnect = make_shared<ClientConnectPacket>(Root::singleton().assets()->digest(), allowAssetsMismatch, m_mainPlayer->uuid(), m_mainPlayer->name(),
-      m_mainPlayer->shipSpecies(), m_playerStorage->loadShipData(m_mainPlayer->uuid()), m_mainPlayer->shipUpgrades(),
-      m_mainPlayer->log()->introComplete(), account);
-  clientConnect->info = JsonObject{
-    {"brand", "OpenStarbound"},
-    {"openProtocolVersion", OpenProtocolVersion }
-  };
+  connection.packetSocket().setNetRules(handshake.netRules);
+
+  // Servers may offer to carry the connection over UDP instead, which is only
+  // taken if the UDP handshake gets through.
+  UdpPacketSocketUPtr udpSocket;
+  if (!handshake.legacyServer && protocolResponsePacket->info && root.configuration()->get("clientUdpTransport").optBool().value(true)) {
+    auto udpPort = protocolResponsePacket->info.optUInt("udpPort");
+    auto udpToken = protocolResponsePacket->info.optUInt("udpToken");
+    auto tcpSocket = as<TcpPacketSocket>(&connection.packetSocket());
+    if (udpPort && udpToken && tcpSocket) {
+      HostAddressWithPort udpAddress(tcpSocket->remoteAddress().address(), *udpPort);
+      unsigned udpTimeout = assets->json("/client.config:udpConnectTimeout").toUInt();
+      try {
+        udpSocket = UdpPacketHost::open(udpAddress.address().mode())->connect(udpAddress, *udpToken, udpTimeout);
+      } catch (StarException const& e) {
+        Logger::warn("UniverseClient: Could not open UDP socket: {}", outputException(e, false));
+      }
+      if (udpSocket)
+        Logger::info("UniverseClient: Using UDP transport to {}", udpAddress);
+      else
+        Logger::info("UniverseClient: UDP transport to {} unavailable, staying on TCP", udpAddress);
+    }
+  }
+
+  clientConnect->info = clientConnect->info.set("udp", (bool)udpSocket);
   connection.pushSingle(std::move(clientConnect));
   connection.sendAll(timeout);
 
+  // Everything after ClientConnect comes over UDP
+  if (udpSocket) {
+    udpSocket->setNetRules(handshake.netRules);
+    connection = UniverseConnection(std::move(udpSocket));
+  }
+
   connection.receiveAny(timeout);
   auto packet = connection.pullSingle();
   if (auto challenge = as<HandshakeChallengePacket>(packet)) {
     Logger::info("UniverseClient: Sending Handshake Response");
-    ByteArray passAccountSalt = (password + account).utf8Bytes();
+    ByteArray passAccountSalt = (settings.password + settings.account).utf8Bytes();
     passAccountSalt.append(challenge->passwordSalt);
     ByteArray passHash = Star::sha256(passAccountSalt);
 
@@ -149,37 +223,110 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
     packet = connection.pullSingle();
   }
 
-  if (auto success = as<ConnectSuccessPacket>(packet)) {
-    m_universeClock = make_shared<Clock>();
-    m_clientContext = make_shared<ClientContext>(success->serverUuid, m_mainPlayer->uuid());
-    m_clientContext->setNetCompatibilityRules(compatibilityRules);
-    m_teamClient = make_shared<TeamClient>(m_mainPlayer, m_clientContext);
-    m_mainPlayer->setClientContext(m_clientContext);
-    m_mainPlayer->setStatistics(m_statistics);
-    m_worldClient = make_shared<WorldClient>(m_mainPlayer, m_luaRoot);
-    m_worldClient->clientState().setNetCompatibilityRules(compatibilityRules);
-    m_worldClient->setAsyncLighting(true);
+  handshake.reply = std::move(packet);
+  return makeRight(std::move(handshake));
+}
 
-    m_connection = std::move(connection);
-    m_celestialDatabase = make_shared<CelestialSlaveDatabase>(std::move(success->celestialInformation));
-    m_systemWorldClient = make_shared<SystemWorldClient>(m_universeClock, m_celestialDatabase, m_mainPlayer->universeMap());
+shared_ptr<ClientConnectPacket> UniverseClient::makeClientConnect(bool includeShipData) const {
+  WorldChunks shipChunks;
+  if (includeShipData)
+    shipChunks = m_playerStorage->loadShipData(m_mainPlayer->uuid());
+  auto clientConnect = make_shared<ClientConnectPacket>(Root::singleton().assets()->digest(), m_connectSettings.allowAssetsMismatch, m_mainPlayer->uuid(), m_mainPlayer->name(),
+      m_mainPlayer->shipSpecies(), std::move(shipChunks), m_mainPlayer->shipUpgrades(),
+      m_mainPlayer->log()->introComplete(), m_connectSettings.account);
+  clientConnect->info = JsonObject{
+    {"brand", "OpenStarbound"},
+    {"openProtocolVersion", OpenProtocolVersion},
+    {"session", (bool)m_reconnect}
+  };
+  return clientConnect;
+}
 
-    Logger::info("UniverseClient: Joined {} server as client {}", legacyServer ? "Starbound" : "OpenStarbound", success->clientId);
-    return {};
-  } else if (auto failure = as<ConnectFailurePacket>(packet)) {
-    Logger::error("UniverseClient: Join failed: {}", failure->reason);
-    return failure->reason;
-  } else if (packet) {
-    return String(strf("Join failed! Expected ConnectSuccess/Failure, got {}", PacketTypeNames.getRight(packet->type())));
-  } else {
-    return String("Join failed! Expected ConnectSuccess/Failure, but none received");
+void UniverseClient::resumeSession() {
+  auto session = as<SessionPacketSocket>(&m_connection->packetSocket());
+  int64_t currentTime = Time::monotonicMilliseconds();
+
+  if (!m_session->lostTime) {
+    Logger::info("UniverseClient: Connection lost, trying to resume session");
+    m_session->lostTime = currentTime;
+    // Anything that arrived before the connection was lost is counted as
+    // received, so has to be handled.
+    m_connection->receive();
+    handlePackets(m_connection->pull());
   }
 
-  return {};
+  if (m_resumeThread.isRunning())
+    return;
+
+  if (m_resumeThread) {
+    auto result = m_resumeThread.finish();
+    if (result.isLeft()) {
+      Logger::warn("UniverseClient: Could not reconnect to resume session: {}", result.left());
+    } else {
+      auto& connection = *result.right().first;
+      auto const& reply = result.right().second.reply;
+      if (auto resumed = as<SessionResumePacket>(reply)) {
+        auto received = connection.pull();
+        auto socket = connection.takePacketSocket();
+        if (session->resume(socket, resumed->received, std::move(received))) {
+          Logger::info("UniverseClient: Resumed session after {} seconds", (currentTime - *m_session->lostTime) / 1000.0);
+          m_session->lostTime.reset();
+          return;
+        }
+      }
+
+      // The server answered but would not resume the session
+      if (auto failure = as<ConnectFailurePacket>(reply))
+        m_disconnectReason = failure->reason;
+      Logger::warn("UniverseClient: Server refused to resume session");
+      m_session.reset();
+      return;
+    }
+  }
+
+  if (!session->resumable() || currentTime - *m_session->lostTime > (int64_t)(m_session->resumeTime * 1000)) {
+    Logger::info("UniverseClient: Could not resume session in time");
+    m_session.reset();
+    return;
+  }
+
+  if (currentTime < m_session->nextAttemptTime)
+    return;
+  m_session->nextAttemptTime = currentTime + SessionResumeAttemptInterval;
+
+  auto clientConnect = makeClientConnect(false);
+  clientConnect->info = clientConnect->info.set("resumeSession", JsonObject{
+      {"token", m_session->token},
+      {"received", session->received()}
+    });
+  m_resumeThread = Thread::invoke("UniverseClient::resumeSession",
+      [reconnect = m_reconnect, settings = m_connectSettings, clientConnect]() -> Either<String, ResumeAttempt> {
+        try {
+          auto connection = make_shared<UniverseConnection>(reconnect());
+          auto result = handshake(*connection, settings, clientConnect);
+          if (result.isLeft())
+            return makeLeft(result.left());
+          return makeRight(ResumeAttempt(std::move(connection), std::move(result.right())));
+        } catch (std::exception const& e) {
+          return makeLeft(strf("{}", outputException(e, false)));
+        }
+      });
 }
 
 bool UniverseClient::isConnected() const {
-  return m_connection && m_connection->isOpen();
+  return m_connection && (m_connection->isOpen() || m_session);
+}
+
+Maybe<PacketStats> UniverseClient::incomingStats() const {
+  if (!m_connection)
+    return {};
+  return m_connection->incomingStats();
+}
+
+Maybe<PacketStats> UniverseClient::outgoingStats() const {
+  if (!m_connection)
+    return {};
+  return m_connection->outgoingStats();
 }
 
 void UniverseClient::disconnect() {
@@ -209,6 +356,14 @@ Maybe<String> UniverseClient::disconnectReason() const {
   return m_disconnectReason;
 }
 
+void UniverseClient::setReconnectFunction(ReconnectFunction reconnect) {
+  m_reconnect = std::move(reconnect);
+}
+
+bool UniverseClient::resumingSession() const {
+  return m_connection && m_session && !m_connection->isOpen();
+}
+
 WorldClientPtr UniverseClient::worldClient() const {
   return m_worldClient;
 }
@@ -223,6 +378,11 @@ void UniverseClient::update(float dt) {
   if (!isConnected())
     return;
 
+  if (resumingSession()) {
+    resumeSession();
+    return;
+  }
+
   if (!m_warping && !m_pendingWarp) {
     if (auto playerWarp = m_mainPlayer->pullPendingWarp())
       warpPlayer(parseWarpAction(playerWarp->action), (bool)playerWarp->animation, playerWarp->animation.value("default"), playerWarp->deploy);
@@ -365,6 +525,8 @@ void UniverseClient::update(float dt) {
   if (auto netStats = m_connection->outgoingStats()) {
     LogMap::set("net_total_outgoing", strf("{:4.3f} kB/s", netStats->bytesPerSecond / 1000.f));
     LogMap::set("net_worst_outgoing", strf("^cyan;{}^reset; ({:4.3f} kB/s)", PacketTypeNames.getRight(netStats->worstPacketType), (float)netStats->worstPacketSize / 1000.f));
+    if (netStats->messagesPerSecond > 0.0f)
+      LogMap::set("net_messages_outgoing", strf("{} msg/s ({} unreliable)", netStats->messagesPerSecond, netStats->unreliableMessagesPerSecond));
   }
 }
 
@@ -800,6 +962,15 @@ void UniverseClient::handlePackets(List<PacketPtr> const& packets) {
 void UniverseClient::reset() {
   stopLua();
 
+  if (m_resumeThread) {
+    try {
+      m_resumeThread.finish();
+    } catch (std::exception const& e) {
+      Logger::error("UniverseClient: Exception caught resuming session: {}", outputException(e, false));
+    }
+  }
+  m_session.reset();
+
   m_universeClock.reset();
   m_worldClient.reset();
   m_celestialDatabase.reset();
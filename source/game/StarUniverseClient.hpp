@@ -42,10 +42,25 @@ public:
 
   // Returns error if connection failed
   Maybe<String> connect(UniverseConnection connection, bool allowAssetsMismatch, String const& account = "", String const& password = "", bool const& forceLegacy = false);
+  // Also true while a lost connection is being resumed
   bool isConnected() const;
   void disconnect();
   Maybe<String> disconnectReason() const;
 
+  // Opens a new socket to the server, to resume the session with if the
+  // connection is lost.  Without one, or if the server offers no session,
+  // losing the connection disconnects.  Applies to the next connect.
+  typedef function<PacketSocketUPtr()> ReconnectFunction;
+  void setReconnectFunction(ReconnectFunction reconnect);
+  // True while the connection is lost and the client is trying to resume its
+  // session, during which the client is not updated.
+  bool resumingSession() const;
+
+  // Packet stats of the connection to the server, if connected over a socket
+  // that tracks them.
+  Maybe<PacketStats> incomingStats() const;
+  Maybe<PacketStats> outgoingStats() const;
+
   // WorldClient may be null if the UniverseClient is not connected.
   WorldClientPtr worldClient() const;
   SystemWorldClientPtr systemWorldClient() const;
@@ -119,6 +134,37 @@ private:
     uint16_t maxPlayers;
   };
 
+  struct ConnectSettings {
+    bool allowAssetsMismatch = false;
+    String account;
+    String password;
+    bool forceLegacy = false;
+  };
+
+  struct Handshake {
+    NetCompatibilityRules netRules;
+    bool legacyServer = false;
+    Json serverInfo;
+    // The server's reply to ClientConnect
+    PacketPtr reply;
+  };
+
+  struct Session {
+    uint64_t token;
+    float resumeTime;
+    // Set while the connection is lost
+    Maybe<int64_t> lostTime;
+    int64_t nextAttemptTime = 0;
+  };
+
+  typedef pair<shared_ptr<UniverseConnection>, Handshake> ResumeAttempt;
+
+  // Runs the handshake up to the server's reply to the given ClientConnect.
+  // Touches no member state, so that sessions can be resumed off thread.
+  static Either<String, Handshake> handshake(UniverseConnection& connection, ConnectSettings const& settings, shared_ptr<ClientConnectPacket> clientConnect);
+  shared_ptr<ClientConnectPacket> makeClientConnect(bool includeShipData) const;
+  void resumeSession();
+
   void setPause(bool pause);
 
   void handlePackets(List<PacketPtr> const& packets);
@@ -133,6 +179,10 @@ private:
   WorldClientPtr m_worldClient;
   SystemWorldClientPtr m_systemWorldClient;
   Maybe<UniverseConnection> m_connection;
+  ConnectSettings m_connectSettings;
+  ReconnectFunction m_reconnect;
+  Maybe<Session> m_session;
+  ThreadFunction<Either<String, ResumeAttempt>> m_resumeThread;
   Maybe<ServerInfo> m_serverInfo;
 
   CelestialSlaveDatabasePtr m_celestialDatabase;
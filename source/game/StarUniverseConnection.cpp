@@ -1,11 +1,13 @@
 #include "StarUniverseConnection.hpp"
 #include "StarFormat.hpp"
 #include "StarLogging.hpp"
+#include "StarSessionPacketSocket.hpp"
 #include <thread>
 
 namespace Star {
 
 static const int PacketSocketPollSleep = 1;
+static const unsigned PacketSocketPollTimeout = 100;
 
 UniverseConnection::UniverseConnection(PacketSocketUPtr packetSocket)
     : m_packetSocket(std::move(packetSocket)) {}
@@ -113,6 +115,11 @@ PacketSocket& UniverseConnection::packetSocket() {
   return *m_packetSocket;
 }
 
+PacketSocketUPtr UniverseConnection::takePacketSocket() {
+  MutexLocker locker(m_mutex);
+  return take(m_packetSocket);
+}
+
 Maybe<PacketStats> UniverseConnection::incomingStats() const {
   MutexLocker locker(m_mutex);
   return m_packetSocket->incomingStats();
@@ -134,9 +141,16 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
 
   m_workerStats.resize(m_numWorkerThreads);
 
+  for (size_t i = 0; i < m_numWorkerThreads; ++i)
+    m_workerPollers.append(make_shared<SocketPoller>());
+
   for (size_t i = 0; i < m_numWorkerThreads; ++i) {
     m_processingThreads.append(Thread::invoke(strf("UniverseConnectionServer::worker_{}", i), [this, i]() {
       RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+      SocketPoller& poller = *m_workerPollers[i];
+      // Sockets currently in the poller, by the connection they belong to
+      HashMap<ConnectionId, SocketPtr> polledSockets;
+      Maybe<SocketPollResult> pollResult;
       try {
         while (!m_shutdown) {
           connectionsLocker.lock();
@@ -144,7 +158,9 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
           connectionsLocker.unlock();
 
           bool dataTransmitted = false;
+          bool needsPolling = false;
           size_t handledCount = 0;
+          HashSet<ConnectionId> handledConnections;
           for (auto& p : connections) {
             if (p.second->workerIndex != i)
               continue;
@@ -154,10 +170,30 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
             if (!p.second->packetSocket || !p.second->packetSocket->isOpen())
               continue;
 
-            p.second->packetSocket->sendPackets(take(p.second->sendQueue));
+            releasePackets(*p.second);
             dataTransmitted |= p.second->packetSocket->writeData();
+            // Packets held back by the scheduler are released as the socket
+            // drains, which is not signalled by the poller.
+            if (p.second->packetScheduler && !p.second->packetScheduler->empty())
+              needsPolling = true;
+
+            // Sockets that can be polled are only read once they are ready,
+            // or when they are first seen in case data arrived before they
+            // were added to the poller.
+            auto socket = p.second->packetSocket->pollSocket();
+            if (socket) {
+              handledConnections.add(p.first);
+              bool firstSeen = !poller.contains(socket);
+              auto ready = pollResult ? pollResult->ptr(socket) : nullptr;
+              if (firstSeen || (ready && (ready->readable || ready->exception)))
+                dataTransmitted |= p.second->packetSocket->readData();
+              poller.set(socket, {true, p.second->packetSocket->sentPacketsPending()});
+              polledSockets[p.first] = std::move(socket);
+            } else {
+              needsPolling = true;
+              dataTransmitted |= p.second->packetSocket->readData();
+            }
 
-            dataTransmitted |= p.second->packetSocket->readData();
             List<PacketPtr> receivePackets = p.second->packetSocket->receivePackets();
             if (!receivePackets.empty()) {
               p.second->lastActivityTime = Time::monotonicMilliseconds();
@@ -181,8 +217,23 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
           }
           m_workerStats[i].connectionsHandled = handledCount;
 
-          if (!dataTransmitted)
-            Thread::sleep(PacketSocketPollSleep);
+          // Stop polling the sockets of connections that were removed or closed
+          eraseWhere(polledSockets, [&](auto const& p) {
+              if (handledConnections.contains(p.first))
+                return false;
+              poller.remove(p.second);
+              return true;
+            });
+
+          // Connections without a socket to poll still have to be checked every
+          // PacketSocketPollSleep, otherwise only wake up when a socket is
+          // ready or when a connection is added or has unsent data.
+          unsigned timeout = PacketSocketPollTimeout;
+          if (dataTransmitted)
+            timeout = 0;
+          else if (needsPolling)
+            timeout = PacketSocketPollSleep;
+          pollResult = poller.wait(timeout);
         }
       } catch (std::exception const& e) {
         Logger::error("Exception caught in UniverseConnectionServer::worker_{}, closing assigned connections: {}", i, e.what());
@@ -197,6 +248,8 @@ UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetR
 
 UniverseConnectionServer::~UniverseConnectionServer() {
   m_shutdown = true;
+  for (auto& poller : m_workerPollers)
+    poller->wake();
   for (auto& thread : m_processingThreads)
     thread.finish();
   removeAllConnections();
@@ -242,23 +295,55 @@ void UniverseConnectionServer::addConnection(ConnectionId clientId, UniverseConn
   connection->packetSocket = std::move(uc.m_packetSocket);
   connection->sendQueue = std::move(uc.m_sendQueue);
   connection->receiveQueue = std::move(uc.m_receiveQueue);
+  if (m_packetSchedulerConfig)
+    connection->packetScheduler.emplace(*m_packetSchedulerConfig);
   connection->lastActivityTime = Time::monotonicMilliseconds();
   connection->workerIndex = clientId % m_numWorkerThreads;
+  m_workerPollers[connection->workerIndex]->wake();
   m_connections.add(clientId, std::move(connection));
 }
 
+bool UniverseConnectionServer::resumeConnection(ConnectionId clientId, UniverseConnection& uc, uint64_t peerReceived) {
+  RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+  auto conn = m_connections.value(clientId);
+  if (!conn)
+    return false;
+  connectionsLocker.unlock();
+
+  MutexLocker connectionLocker(conn->mutex);
+  auto session = as<SessionPacketSocket>(conn->packetSocket.get());
+  if (!session || session->isOpen() || !session->canResume(peerReceived))
+    return false;
+
+  MutexLocker resumedLocker(uc.m_mutex);
+  // Sent outside of the session, ahead of anything resent by it
+  uc.m_sendQueue.append(make_shared<SessionResumePacket>(session->received()));
+  uc.m_packetSocket->sendPackets(take(uc.m_sendQueue));
+  session->resume(uc.m_packetSocket, peerReceived, List<PacketPtr>::from(take(uc.m_receiveQueue)));
+
+  conn->lastActivityTime = Time::monotonicMilliseconds();
+  m_workerPollers[conn->workerIndex]->wake();
+  return true;
+}
+
 UniverseConnection UniverseConnectionServer::removeConnection(ConnectionId clientId) {
   RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
   if (!m_connections.contains(clientId))
     throw UniverseConnectionException::format("Client '{}' does not exist in UniverseConnectionServer::removeConnection", clientId);
 
   auto conn = m_connections.take(clientId);
+  m_workerPollers[conn->workerIndex]->wake();
   connectionsLocker.unlock();
   MutexLocker connectionLocker(conn->mutex);
 
   UniverseConnection uc;
   uc.m_packetSocket = take(conn->packetSocket);
-  uc.m_sendQueue = std::move(conn->sendQueue);
+  if (conn->packetScheduler) {
+    uc.m_sendQueue = conn->packetScheduler->takeAll();
+    uc.m_sendQueue.appendAll(std::move(conn->sendQueue));
+  } else {
+    uc.m_sendQueue = std::move(conn->sendQueue);
+  }
   uc.m_receiveQueue = std::move(conn->receiveQueue);
   return uc;
 }
@@ -279,14 +364,61 @@ void UniverseConnectionServer::sendPackets(ConnectionId clientId, List<PacketPtr
     conn->sendQueue.appendAll(std::move(packets));
 
     if (conn->packetSocket->isOpen()) {
-      conn->packetSocket->sendPackets(take(conn->sendQueue));
+      releasePackets(*conn);
       conn->packetSocket->writeData();
+      // Have the worker finish sending once the socket is writable
+      if (conn->packetSocket->sentPacketsPending() || (conn->packetScheduler && !conn->packetScheduler->empty()))
+        m_workerPollers[conn->workerIndex]->wake();
     }
   } else {
     throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::sendPackets", clientId);
   }
 }
 
+void UniverseConnectionServer::broadcastPackets(List<ConnectionId> const& clientIds, List<PacketPtr> const& packets) {
+  for (auto const& packet : packets)
+    packet->setBroadcast();
+  for (auto clientId : clientIds)
+    sendPackets(clientId, packets);
+}
+
+void UniverseConnectionServer::setPacketSchedulerConfig(Maybe<PacketSchedulerConfig> config) {
+  RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+  m_packetSchedulerConfig = std::move(config);
+}
+
+Maybe<PacketStats> UniverseConnectionServer::packetSchedulerStats(ConnectionId clientId) const {
+  RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+  if (auto conn = m_connections.value(clientId)) {
+    connectionsLocker.unlock();
+    MutexLocker connectionLocker(conn->mutex);
+    if (conn->packetScheduler)
+      return conn->packetScheduler->stats();
+    return {};
+  }
+  throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::packetSchedulerStats", clientId);
+}
+
+Maybe<PacketStats> UniverseConnectionServer::incomingStats(ConnectionId clientId) const {
+  RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+  if (auto conn = m_connections.value(clientId)) {
+    connectionsLocker.unlock();
+    MutexLocker connectionLocker(conn->mutex);
+    return conn->packetSocket->incomingStats();
+  }
+  throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::incomingStats", clientId);
+}
+
+Maybe<PacketStats> UniverseConnectionServer::outgoingStats(ConnectionId clientId) const {
+  RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+  if (auto conn = m_connections.value(clientId)) {
+    connectionsLocker.unlock();
+    MutexLocker connectionLocker(conn->mutex);
+    return conn->packetSocket->outgoingStats();
+  }
+  throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::outgoingStats", clientId);
+}
+
 uint64_t UniverseConnectionServer::totalPacketsProcessed() const {
   uint64_t total = 0;
   for (auto const& stats : m_workerStats)
@@ -298,4 +430,13 @@ size_t UniverseConnectionServer::numWorkerThreads() const {
   return m_numWorkerThreads;
 }
 
+void UniverseConnectionServer::releasePackets(Connection& connection) {
+  if (connection.packetScheduler) {
+    connection.packetScheduler->push(take(connection.sendQueue));
+    connection.packetScheduler->release(*connection.packetSocket);
+  } else {
+    connection.packetSocket->sendPackets(take(connection.sendQueue));
+  }
+}
+
 }// namespace Star
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarNetPacketSocket.hpp"
+#include "StarPacketScheduler.hpp"
 
 namespace Star {
 
@@ -50,6 +51,9 @@ public:
 
   // Returns a reference to the packet socket.
   PacketSocket& packetSocket();
+  // Takes the packet socket out of the connection, e.g. to wrap it in
+  // another PacketSocket.  The connection must not be used afterwards.
+  PacketSocketUPtr takePacketSocket();
 
   // Packet stats for the most recent one second window of activity incoming
   // and outgoing.  Will only return valid stats if the underlying PacketSocket
@@ -88,10 +92,28 @@ public:
   int64_t lastActivityTime(ConnectionId clientId) const;
 
   void addConnection(ConnectionId clientId, UniverseConnection connection);
+  // Carries the connection's SessionPacketSocket over to the socket of the
+  // given new connection, after sending it a SessionResumePacket.  The peer
+  // has received peerReceived packets of the session.  Returns false,
+  // without using the new connection, if the session cannot be resumed.
+  bool resumeConnection(ConnectionId clientId, UniverseConnection& connection, uint64_t peerReceived);
   UniverseConnection removeConnection(ConnectionId clientId);
   List<UniverseConnection> removeAllConnections();
 
   void sendPackets(ConnectionId clientId, List<PacketPtr> packets);
+  // Sends the same packets to each of the given clients, serializing each
+  // packet once per distinct NetCompatibilityRules rather than per client.
+  void broadcastPackets(List<ConnectionId> const& clientIds, List<PacketPtr> const& packets);
+
+  // Outgoing packets of connections added afterwards are held in a
+  // PacketScheduler with the given config, or sent in order if not set.
+  void setPacketSchedulerConfig(Maybe<PacketSchedulerConfig> config);
+  // Queue depth, queueing latency and sent bytes of the connection's
+  // PacketScheduler, if it has one.
+  Maybe<PacketStats> packetSchedulerStats(ConnectionId clientId) const;
+  // Stats of the connection's packet socket
+  Maybe<PacketStats> incomingStats(ConnectionId clientId) const;
+  Maybe<PacketStats> outgoingStats(ConnectionId clientId) const;
 
   // Get total packets processed across all worker threads
   uint64_t totalPacketsProcessed() const;
@@ -104,10 +126,15 @@ private:
     PacketSocketUPtr packetSocket;
     List<PacketPtr> sendQueue;
     Deque<PacketPtr> receiveQueue;
+    Maybe<PacketScheduler> packetScheduler;
     int64_t lastActivityTime;
     size_t workerIndex;
   };
 
+  // Moves the send queue to the packet socket, through the scheduler if the
+  // connection has one.
+  static void releasePackets(Connection& connection);
+
   struct WorkerStats {
     atomic<uint64_t> packetsProcessed{0};
     atomic<uint64_t> bytesReceived{0};
@@ -134,8 +161,11 @@ private:
 
   mutable RecursiveMutex m_connectionsMutex;
   HashMap<ConnectionId, shared_ptr<Connection>> m_connections;
+  Maybe<PacketSchedulerConfig> m_packetSchedulerConfig;
 
   List<ThreadFunction<void>> m_processingThreads;
+  // Each worker waits on its own poller for its connections' sockets
+  List<SocketPollerPtr> m_workerPollers;
   List<WorkerStats> m_workerStats;
   atomic<bool> m_shutdown;
   size_t m_numWorkerThreads;
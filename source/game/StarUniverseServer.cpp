@@ -8,10 +8,14 @@
 #include "StarConfiguration.hpp"
 #include "StarEncode.hpp"
 #include "StarFile.hpp"
+#include "StarItemDatabase.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarLogging.hpp"
+#include "StarMonsterDatabase.hpp"
+#include "StarObjectDatabase.hpp"
 #include "StarRoot.hpp"
 #include "StarSecureRandom.hpp"
+#include "StarSessionPacketSocket.hpp"
 #include "StarSha256.hpp"
 #include "StarSky.hpp"
 #include "StarTcp.hpp"
@@ -19,13 +23,17 @@
 #include "StarUniverseServerLuaBindings.hpp"
 #include "StarVersioningDatabase.hpp"
 #include "StarWorldTemplate.hpp"
+#include "StarMetrics.hpp"
 
 namespace Star {
 
 UniverseServer::UniverseServer(String const& storageDir)
     : Thread("UniverseServer"),
       m_workerPool("UniverseServerWorkerPool"),
-      m_clients(MinClientConnectionId, MaxClientConnectionId) {
+      m_chatWorker("UniverseServerChat"),
+      m_completionQueue(make_shared<CompletionQueue>()),
+      m_clients(MinClientConnectionId, MaxClientConnectionId),
+      m_clientSnapshot(make_shared<ClientSnapshot const>()) {
   String const LockFile = "universe.lock";
 
   m_storageDirectory = storageDir;
@@ -47,7 +55,12 @@ UniverseServer::UniverseServer(String const& storageDir)
 
   startLuaScripts();
 
-  m_commandProcessor = make_shared<CommandProcessor>(this, m_luaRoot);
+  // Commands run on the chat worker, so their scripts get a LuaRoot of their
+  // own rather than sharing an engine with the universe scripts.
+  auto commandLuaRoot = make_shared<LuaRoot>();
+  commandLuaRoot->tuneAutoGarbageCollection(
+      assets->json("/universe_server.config:luaGcPause").toFloat(), assets->json("/universe_server.config:luaGcStepMultiplier").toFloat());
+  m_commandProcessor = make_shared<CommandProcessor>(this, commandLuaRoot);
   m_chatProcessor = make_shared<ChatProcessor>();
   m_chatProcessor->setCommandHandler(bind(&CommandProcessor::userCommand, m_commandProcessor.get(), _1, _2, _3));
 
@@ -85,14 +98,33 @@ UniverseServer::UniverseServer(String const& storageDir)
 
   m_teamManager = make_shared<TeamManager>();
   m_workerPool.start(universeConfig.getUInt("workerPoolThreads"));
+  m_chatWorker.start(1);
 
   size_t networkWorkerThreads = universeConfig.optUInt("networkWorkerThreads").value(0);
   m_connectionServer = make_shared<UniverseConnectionServer>(
     bind(&UniverseServer::packetsReceived, this, _1, _2, _3),
     networkWorkerThreads);
+  auto packetSchedulerConfig = universeConfig.opt("packetScheduler").value(JsonObject());
+  if (packetSchedulerConfig.getBool("enabled", false))
+    m_connectionServer->setPacketSchedulerConfig(PacketSchedulerConfig(packetSchedulerConfig));
+  auto adaptiveCompressionConfig = universeConfig.opt("adaptiveCompression").value(JsonObject());
+  if (adaptiveCompressionConfig.getBool("enabled", false))
+    m_adaptiveCompression = AdaptiveCompressionConfig(adaptiveCompressionConfig);
 
   m_pause = make_shared<atomic<bool>>(false);
 
+  auto schedulerConfig = universeConfig.opt("worldServerScheduler").value(JsonObject());
+  if (schedulerConfig.getBool("enabled", false))
+    m_worldScheduler = make_shared<WorldServerScheduler>(schedulerConfig.getUInt("threads", 0));
+  m_systemIdleUpdateInterval = schedulerConfig.getDouble("systemIdleUpdateInterval", 1.0);
+
+  auto watchdogConfig = universeConfig.opt("slowTickWatchdog").value(JsonObject());
+  if (watchdogConfig.getBool("enabled", false))
+    m_slowTickWatchdog = make_shared<SlowTickWatchdog>(watchdogConfig);
+
+  m_shipWorldHibernationTime = universeConfig.getFloat("shipWorldHibernationTime", 0.0f);
+  m_sessionResumeTime = universeConfig.getFloat("sessionResumeTime", 0.0f);
+
   m_secureWarps = Root::singleton().configuration()->getPath("security.secureWarps").optBool().value(true);
 }
 
@@ -100,17 +132,22 @@ UniverseServer::~UniverseServer() {
   stop();
   stopLua();
   join();
+  m_chatWorker.stop();
   m_workerPool.stop();
+  m_slowTickWatchdog.reset();
 
   RecursiveMutexLocker locker(m_mainLock);
   WriteLocker clientsLocker(m_clientsLock);
 
   m_connectionServer->removeAllConnections();
   m_deadConnections.clear();
+  MutexLocker pendingLocker(m_pendingConnectionsMutex);
+  m_pendingConnections.clear();
 
   // Make sure that all world threads and net sockets (and associated threads)
   // are shutdown before other member destruction.
   m_clients.clear();
+  publishClients();
   m_worlds.clear();
 }
 
@@ -120,12 +157,7 @@ void UniverseServer::setListeningTcp(bool listenTcp) {
 }
 
 void UniverseServer::addClient(UniverseConnection remoteConnection) {
-  RecursiveMutexLocker acceptThreadsLocker(m_connectionAcceptThreadsMutex);
-  // Binding requires us to make the given lambda copy constructible, so the
-  // make_shared is requried here.
-  m_connectionAcceptThreads.append(Thread::invoke("UniverseServer::acceptConnection", [this, conn = make_shared<UniverseConnection>(std::move(remoteConnection))]() {
-    acceptConnection(std::move(*conn), {});
-  }));
+  queueConnection(std::move(remoteConnection), {});
 }
 
 UniverseConnection UniverseServer::addLocalClient() {
@@ -164,15 +196,13 @@ void UniverseServer::setPause(bool pause) {
   }
   locker.unlock();
 
-  for (auto& p : m_clients)
-    m_connectionServer->sendPackets(p.first, {make_shared<PausePacket>(*m_pause, GlobalTimescale)});
+  m_connectionServer->broadcastPackets(m_clients.keys(), {make_shared<PausePacket>(*m_pause, GlobalTimescale)});
 }
 
 void UniverseServer::setTimescale(float timescale) {
   ReadLocker clientsLocker(m_clientsLock);
   GlobalTimescale = timescale;
-  for (auto& p : m_clients)
-    m_connectionServer->sendPackets(p.first, {make_shared<PausePacket>(*m_pause, GlobalTimescale)});
+  m_connectionServer->broadcastPackets(m_clients.keys(), {make_shared<PausePacket>(*m_pause, GlobalTimescale)});
 }
 
 void UniverseServer::setTickRate(float tickRate) {
@@ -190,22 +220,20 @@ bool UniverseServer::isWorldActive(WorldId const& worldId) const {
 }
 
 List<ConnectionId> UniverseServer::clientIds() const {
-  ReadLocker clientsLocker(m_clientsLock);
-  return m_clients.keys();
+  return clientSnapshot()->keys();
 }
 
 List<pair<ConnectionId, int64_t>> UniverseServer::clientIdsAndCreationTime() const {
   List<pair<ConnectionId, int64_t>> result;
-  ReadLocker clientsLocker(m_clientsLock);
-  result.reserve(m_clients.size());
-  for (auto& pair : m_clients)
+  auto clients = clientSnapshot();
+  result.reserve(clients->size());
+  for (auto& pair : *clients)
     result.emplaceAppend(pair.first, pair.second->creationTime());
   return result;
 }
 
 size_t UniverseServer::numberOfClients() const {
-  ReadLocker clientsLocker(m_clientsLock);
-  return m_clients.size();
+  return clientSnapshot()->size();
 }
 
 uint32_t UniverseServer::maxClients() const {
@@ -213,13 +241,11 @@ uint32_t UniverseServer::maxClients() const {
 }
 
 bool UniverseServer::isConnectedClient(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  return m_clients.contains(clientId);
+  return clientSnapshot()->contains(clientId);
 }
 
 String UniverseServer::clientDescriptor(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->descriptiveName();
   else
     return "disconnected_client";
@@ -234,8 +260,7 @@ Maybe<ConnectionId> UniverseServer::findNick(String const& nick) const {
 }
 
 Maybe<Uuid> UniverseServer::uuidForClient(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->playerUuid();
   return {};
 }
@@ -259,35 +284,38 @@ String UniverseServer::adminCommand(String text) {
 }
 
 bool UniverseServer::isAdmin(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->isAdmin();
   return false;
 }
 
 bool UniverseServer::canBecomeAdmin(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->canBecomeAdmin();
   return false;
 }
 
 void UniverseServer::setAdmin(ConnectionId clientId, bool admin) {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     clientContext->setAdmin(admin);
 }
 
 bool UniverseServer::isLocal(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return !clientContext->remoteAddress();
   return false;
 }
 
+Maybe<PacketStats> UniverseServer::clientOutgoingStats(ConnectionId clientId) const {
+  try {
+    return m_connectionServer->outgoingStats(clientId);
+  } catch (UniverseConnectionException const&) {
+    return {};
+  }
+}
+
 bool UniverseServer::isPvp(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->team().type == TeamType::PVP;
   return false;
 }
@@ -349,16 +377,13 @@ void UniverseServer::clientFlyShip(ConnectionId clientId, Vec3I const& system, S
 }
 
 WorldId UniverseServer::clientWorld(ConnectionId clientId) const {
-  RecursiveMutexLocker locker(m_mainLock);
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->playerWorldId();
   return WorldId();
 }
 
 CelestialCoordinate UniverseServer::clientShipCoordinate(ConnectionId clientId) const {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId))
+  if (auto clientContext = connectedClient(clientId))
     return clientContext->shipCoordinate();
   return CelestialCoordinate();
 }
@@ -534,16 +559,28 @@ StringList UniverseServer::weatherList(CelestialCoordinate const& coordinate) {
 }
 
 bool UniverseServer::sendPacket(ConnectionId clientId, PacketPtr packet) {
-  RecursiveMutexLocker locker(m_mainLock);
-  ReadLocker clientsLocker(m_clientsLock);
-  if (m_clients.contains(clientId)) {
-    clientsLocker.unlock();
+  if (clientSnapshot()->contains(clientId)) {
     m_connectionServer->sendPackets(clientId, {packet});
     return true;
   }
   return false;
 }
 
+void UniverseServer::startPacketCapture(String const& path) {
+  m_packetCapture.store(make_shared<PacketCaptureWriter>(path));
+  Logger::info("UniverseServer: Capturing packets from newly connected clients to {}", path);
+}
+
+Maybe<String> UniverseServer::stopPacketCapture() {
+  auto packetCapture = m_packetCapture.load();
+  if (!packetCapture)
+    return {};
+  m_packetCapture.reset();
+  packetCapture->flush();
+  Logger::info("UniverseServer: Captured {} packets to {}", packetCapture->packetCount(), packetCapture->path());
+  return packetCapture->path();
+}
+
 void UniverseServer::run() {
   Logger::info("UniverseServer: Starting UniverseServer with UUID: {}", m_universeSettings->uuid().hex());
 
@@ -564,24 +601,29 @@ void UniverseServer::run() {
       try {
         tcpServer = make_shared<TcpServer>(bindAddress);
         tcpServer->setAcceptCallback([this, maxPendingConnections](TcpSocketPtr socket) {
-          RecursiveMutexLocker acceptThreadsLocker(m_connectionAcceptThreadsMutex);
-          if (m_connectionAcceptThreads.size() < maxPendingConnections) {
+          if (queueConnection(UniverseConnection(TcpPacketSocket::open(socket)), socket->remoteAddress().address(), maxPendingConnections))
             Logger::info("UniverseServer: Connection received from: {}", socket->remoteAddress());
-            m_connectionAcceptThreads.append(Thread::invoke("UniverseServer::acceptConnection", [this, socket]() {
-              acceptConnection(UniverseConnection(TcpPacketSocket::open(socket)), socket->remoteAddress().address());
-            }));
-          } else {
+          else
             Logger::warn("UniverseServer: maximum pending connections, dropping connection from: {}", socket->remoteAddress().address());
-          }
         });
       } catch (StarException const& e) {
         Logger::error("UniverseServer: Error setting up TCP, cannot accept connections: {}", e.what());
         m_tcpState = TcpState::Fuck;
         tcpServer.reset();
       }
+
+      if (tcpServer && configuration->get("connectionSettings").getBool("udp", false)) {
+        Logger::info("UniverseServer: offering UDP transport on {}", bindAddress);
+        try {
+          m_udpPacketHost.store(UdpPacketHost::listen(bindAddress));
+        } catch (StarException const& e) {
+          Logger::error("UniverseServer: Error setting up UDP, clients will use TCP: {}", e.what());
+        }
+      }
     } else if (m_tcpState == TcpState::No && tcpServer) {
       Logger::info("UniverseServer: Not listening for incoming TCP connections");
       tcpServer.reset();
+      m_udpPacketHost.reset();
     }
 
     LogMap::set("universe_time", m_universeClock->time());
@@ -595,6 +637,7 @@ void UniverseServer::run() {
       updateShips();
       sendClockUpdates();
       kickErroredPlayers();
+      processHandshakes();
       reapConnections();
       processPlanetTypeChanges();
       warpPlayers();
@@ -607,6 +650,7 @@ void UniverseServer::run() {
       handleWorldMessages();
       shutdownInactiveWorlds();
       doTriggeredStorage();
+      updateMetrics();
     } catch (std::exception const& e) {
       Logger::error("UniverseServer: exception caught: {}", outputException(e, true));
     }
@@ -617,11 +661,13 @@ void UniverseServer::run() {
   Logger::info("UniverseServer: Stopping UniverseServer");
 
   try {
+    m_chatWorker.stop();
     m_workerPool.stop();
 
     if (tcpServer) {
       Logger::info("UniverseServer: Stopping TCP Server");
       tcpServer.reset();
+      m_udpPacketHost.reset();
     }
 
     ReadLocker clientsLocker(m_clientsLock);
@@ -780,9 +826,7 @@ void UniverseServer::sendClockUpdates() {
 
   int64_t currentTime = Time::monotonicMilliseconds();
   if (currentTime > m_lastClockUpdateSent + Root::singleton().assets()->json("/universe_server.config:clockUpdatePacketInterval").toInt()) {
-    auto timePacket = make_shared<UniverseTimeUpdatePacket>(m_universeClock->time());
-    for (auto clientId : m_clients.keys())
-      m_connectionServer->sendPackets(clientId, {timePacket});
+    m_connectionServer->broadcastPackets(m_clients.keys(), {make_shared<UniverseTimeUpdatePacket>(m_universeClock->time())});
     m_lastClockUpdateSent = currentTime;
   }
 }
@@ -824,20 +868,6 @@ void UniverseServer::kickErroredPlayers() {
 void UniverseServer::reapConnections() {
   int64_t startTime = Time::monotonicMilliseconds();
   int64_t timeout = Root::singleton().assets()->json("/universe_server.config:connectionTimeout").toInt();
-  {
-    RecursiveMutexLocker acceptThreadsLocker(m_connectionAcceptThreadsMutex);
-    eraseWhere(m_connectionAcceptThreads, [&](ThreadFunction<void>& function) {
-      if (!function.isRunning()) {
-        try {
-          function.finish();
-        } catch (std::exception const& e) {
-          Logger::error("UniverseServer: Exception caught accepting new connection: {}", outputException(e, true));
-        }
-      }
-      return function.isFinished();
-    });
-  }
-
   RecursiveMutexLocker locker(m_mainLock);
   auto pendingConnections = take(m_pendingDisconnections);
   locker.unlock();
@@ -849,6 +879,19 @@ void UniverseServer::reapConnections() {
   for (auto clientId : clients) {
     auto clientContext = m_clients.value(clientId);
     if (!m_connectionServer->connectionIsOpen(clientId)) {
+      // Clients with a session stay in their world until it runs out, so
+      // that they can resume it where they left off.
+      MutexLocker sessionsLocker(m_clientSessionsMutex);
+      if (auto session = m_clientSessions.ptr(clientId)) {
+        if (!session->lostTime) {
+          Logger::info("UniverseServer: Client {} connection lost, keeping session for {} seconds", clientContext->descriptiveName(), m_sessionResumeTime);
+          session->lostTime = startTime;
+        }
+        if (startTime - *session->lostTime < (int64_t)(m_sessionResumeTime * 1000))
+          continue;
+      }
+      sessionsLocker.unlock();
+
       Logger::info("UniverseServer: Client {} connection lost", clientContext->descriptiveName());
       clientsLocker.unlock();
       doDisconnection(clientId, String("Disconnected due to connection lost"));
@@ -946,7 +989,7 @@ void UniverseServer::warpPlayers() {
           // Checking the spawn target validity then adding the client is not
           // perfect, it can still become invalid in between, if we fail at
           // adding the client we need to warp them back.
-          bool clientAdded = toWorld && toWorld->addClient(clientId, warpToWorld.target, !clientContext->remoteAddress(), clientContext->canBecomeAdmin(), clientContext->netRules());
+          bool clientAdded = toWorld && toWorld->addClient(clientId, warpToWorld.target, !clientContext->remoteAddress(), clientContext->canBecomeAdmin(), clientContext->netRules(), clientContext->acknowledgedEntityUpdates());
 
           locker.lock();
           if (clientAdded) {
@@ -1145,47 +1188,50 @@ void UniverseServer::respondToCelestialRequests() {
   RecursiveMutexLocker locker(m_mainLock);
   ReadLocker clientsLocker(m_clientsLock);
 
-  for (auto& p : m_pendingCelestialRequests) {
-    List<CelestialResponse> responses;
-    eraseWhere(p.second, [&responses](WorkerPoolPromise<CelestialResponse> const& request) {
-      if (request.poll()) {
-        responses.append(request.get());
-        return true;
-      }
-      return false;
-    });
+  // Finished requests append their responses to m_celestialResponses from
+  // here, which are then sent out together, one packet per client.
+  m_completionQueue->run();
+
+  for (auto& p : m_celestialResponses) {
     if (m_clients.contains(p.first))
-      m_connectionServer->sendPackets(p.first, {make_shared<CelestialResponsePacket>(std::move(responses))});
+      m_connectionServer->sendPackets(p.first, {make_shared<CelestialResponsePacket>(std::move(p.second))});
   }
-  eraseWhere(m_pendingCelestialRequests, [](auto const& p) {
-    return p.second.empty();
-  });
+  m_celestialResponses.clear();
 }
 
 void UniverseServer::processChat() {
   RecursiveMutexLocker locker(m_mainLock);
   ReadLocker clientsLocker(m_clientsLock);
 
-  for (auto const& p : take(m_pendingChat)) {
-    if (auto clientContext = m_clients.get(p.first)) {
-      for (auto const& chat : p.second) {
-        auto& message = get<0>(chat);
-        auto sendMode = get<1>(chat);
-        auto& data = get<2>(chat);
-        if (clientContext->remoteAddress())
-          Logger::info("Chat: <{}> {}", clientContext->playerName(), message);
+  for (auto& p : take(m_pendingChat)) {
+    auto clientContext = m_clients.get(p.first);
+    if (!clientContext)
+      continue;
 
-        auto team = m_teamManager->getTeam(clientContext->playerUuid());
-        locker.unlock();
-        if (sendMode == ChatSendMode::Broadcast)
-          m_chatProcessor->broadcast(p.first, message, std::move(data));
-        else if (sendMode == ChatSendMode::Party && team.isValid())
-          m_chatProcessor->message(p.first, MessageContext::Mode::Party, team.value().hex(), message, std::move(data));
-        else
-          m_chatProcessor->message(p.first, MessageContext::Mode::Local, printWorldId(clientContext->playerWorldId()), message, std::move(data));
-        locker.lock();
-      }
-    }
+    if (clientContext->remoteAddress()) {
+      for (auto const& chat : p.second)
+        Logger::info("Chat: <{}> {}", clientContext->playerName(), get<0>(chat));
+    }
+
+    auto team = m_teamManager->getTeam(clientContext->playerUuid());
+    String worldChannel = printWorldId(clientContext->playerWorldId());
+    m_chatWorker.addWork([chatProcessor = m_chatProcessor, clientId = p.first, chats = std::move(p.second), team, worldChannel]() mutable {
+        for (auto& chat : chats) {
+          auto& message = get<0>(chat);
+          auto sendMode = get<1>(chat);
+          auto& data = get<2>(chat);
+          try {
+            if (sendMode == ChatSendMode::Broadcast)
+              chatProcessor->broadcast(clientId, message, std::move(data));
+            else if (sendMode == ChatSendMode::Party && team.isValid())
+              chatProcessor->message(clientId, MessageContext::Mode::Party, team.value().hex(), message, std::move(data));
+            else
+              chatProcessor->message(clientId, MessageContext::Mode::Local, worldChannel, message, std::move(data));
+          } catch (std::exception const& e) {
+            Logger::error("UniverseServer: exception processing chat: {}", outputException(e, true));
+          }
+        }
+      });
   }
 }
 
@@ -1219,6 +1265,7 @@ void UniverseServer::handleWorldMessages() {
       auto& world = *worldResult;
 
       if (world) {
+        world->resume();
         if (world->isRunning()) {
           world->passMessages(std::move(it->second));
           it = m_pendingWorldMessages.erase(it);
@@ -1237,9 +1284,10 @@ void UniverseServer::shutdownInactiveWorlds() {
   RecursiveMutexLocker locker(m_mainLock);
   ReadLocker clientsLocker(m_clientsLock);
 
-  // Shutdown idle and errored worlds.
+  // Shutdown idle and errored worlds, idle ship worlds hibernate first.
   for (auto const& worldId : m_worlds.keys()) {
     if (auto world = getWorld(worldId)) {
+      bool hibernated = false;
       clientsLocker.unlock();
       locker.unlock();
       if (world->serverErrorOccurred()) {
@@ -1256,13 +1304,24 @@ void UniverseServer::shutdownInactiveWorlds() {
         }
 
         if (!anyPendingWarps && world->shouldExpire()) {
-          Logger::info("UniverseServer: Stopping idle world {}", worldId);
-          world->stop();
+          if (worldId.is<ClientShipWorldId>() && m_shipWorldHibernationTime > 0.0f && !world->hibernating()) {
+            Logger::info("UniverseServer: Hibernating idle ship world {}", worldId);
+            world->hibernate();
+            hibernated = world->hibernating();
+          } else if (!world->hibernating() || world->hibernatedTime() >= m_shipWorldHibernationTime) {
+            Logger::info("UniverseServer: Stopping idle world {}", worldId);
+            world->stop();
+          }
         }
       }
       locker.lock();
       clientsLocker.lock();
-      if (world->isJoined()) {
+      if (hibernated) {
+        // Its sectors were just unloaded, so keep the owner's copy current
+        // in case the world is stopped without being resumed.
+        if (auto clientId = getClientForUuid(worldId.get<ClientShipWorldId>()))
+          m_clients.get(*clientId)->updateShipChunks(world->readChunks());
+      } else if (world->isJoined() && !world->hibernating()) {
         auto kickClients = world->clients();
         if (!kickClients.empty()) {
           Logger::info("UniverseServer: World {} shutdown, kicking {} players to their own ships", worldId, world->clients().size());
@@ -1614,9 +1673,11 @@ void UniverseServer::removeTimedBan() {
 void UniverseServer::addCelestialRequests(ConnectionId clientId, List<CelestialRequest> requests) {
   RecursiveMutexLocker locker(m_mainLock);
   for (auto request : requests) {
-    m_pendingCelestialRequests[clientId].append(m_workerPool.addProducer<CelestialResponse>([this, request]() {
+    m_workerPool.addProducer<CelestialResponse>([this, request]() {
       return m_celestialDatabase->respondToRequest(request);
-    }));
+    }).then(m_completionQueue, [this, clientId](CelestialResponse& response) {
+      m_celestialResponses[clientId].append(std::move(response));
+    });
   }
 }
 
@@ -1635,11 +1696,13 @@ void UniverseServer::systemWorldUpdated(SystemWorldServerThread* systemWorldServ
 }
 
 void UniverseServer::packetsReceived(UniverseConnectionServer*, ConnectionId clientId, List<PacketPtr> packets) {
-  ReadLocker clientsLocker(m_clientsLock);
-  if (auto clientContext = m_clients.value(clientId)) {
-    clientsLocker.unlock();
+  if (auto clientContext = connectedClient(clientId)) {
 
-    for (auto& packet : packets) {
+    if (auto packetCapture = m_packetCapture.load())
+      packetCapture->recordClient(clientId, packets, clientContext->netRules());
+
+    // Entity messages are checked individually below
+    for (auto& packet : EntityMessageBatchPacket::unbatchPackets(std::move(packets))) {
       auto packetType = packet->type();
 
       if (auto warpAction = as<PlayerWarpPacket>(packet)) {
@@ -1703,10 +1766,7 @@ void UniverseServer::packetsReceived(UniverseConnectionServer*, ConnectionId cli
             if (auto targetEntityId = entityMessage->entityId.ptr<EntityId>()) {
               auto targetConnection = connectionForEntity(*targetEntityId);
               if (targetConnection != clientId) {
-                clientsLocker.lock();
-                bool isAdmin = clientContext->isAdmin();
-                clientsLocker.unlock();
-                if (!isAdmin) {
+                if (!clientContext->isAdmin()) {
                   Logger::warn("UniverseServer: Blocked warp entity message from non-admin client {} targeting entity owned by connection {}", clientId, targetConnection);
                   blocked = true;
                 }
@@ -1734,154 +1794,369 @@ void UniverseServer::packetsReceived(UniverseConnectionServer*, ConnectionId cli
   }
 }
 
-void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostAddress> remoteAddress) {
+struct UniverseServer::PendingConnection {
+  enum class State {
+    AwaitingProtocolRequest,
+    SendingProtocolResponse,
+    AwaitingClientConnect,
+    AwaitingUdpConnection,
+    Authenticating,
+    AwaitingHandshakeResponse,
+    Admitting,
+    LoadingClientContext
+  };
+
+  PendingConnection(UniverseConnection connection, Maybe<HostAddress> remoteAddress)
+    : connection(std::move(connection)), remoteAddress(std::move(remoteAddress)) {}
+
+  UniverseConnection connection;
+  Maybe<HostAddress> remoteAddress;
+  String remoteAddressString;
+  State state = State::AwaitingProtocolRequest;
+  // Monotonic milliseconds at which waiting on the client is given up
+  int64_t deadline = 0;
+
+  PacketCaptureWriterPtr packetCapture;
+  uint32_t captureStream = 0;
+
+  bool legacyClient = false;
+  bool useCompressionStream = false;
+  UdpPacketHostPtr udpPacketHost;
+  // Remote clients may switch to UDP by presenting this token to the UDP host
+  // and asking for it in their ClientConnect.
+  Maybe<uint64_t> udpToken;
+  bool udpTransport = false;
+  // Offered to remote clients so that they may resume their session if the
+  // connection is lost
+  Maybe<uint64_t> sessionToken;
+
+  shared_ptr<ClientConnectPacket> clientConnect;
+  String accountString;
+  ByteArray passwordSalt;
+  bool administrator = false;
+
+  // The client's stored context, read and migrated on the worker pool
+  Maybe<WorkerPoolPromise<Maybe<Json>>> clientContextStore;
+};
+
+bool UniverseServer::queueConnection(UniverseConnection connection, Maybe<HostAddress> remoteAddress, Maybe<size_t> maxPending) {
+  auto pending = make_shared<PendingConnection>(std::move(connection), std::move(remoteAddress));
+  pending->remoteAddressString = pending->remoteAddress ? toString(*pending->remoteAddress) : "local";
+  pending->deadline = Time::monotonicMilliseconds() + Root::singleton().assets()->json("/universe_server.config:clientWaitLimit").toInt();
+  pending->packetCapture = m_packetCapture.load();
+  if (pending->packetCapture)
+    pending->captureStream = pending->packetCapture->openStream();
+
+  MutexLocker pendingLocker(m_pendingConnectionsMutex);
+  if (maxPending && m_pendingConnections.size() >= *maxPending)
+    return false;
+  m_pendingConnections.append(std::move(pending));
+  return true;
+}
+
+void UniverseServer::processHandshakes() {
+  MutexLocker pendingLocker(m_pendingConnectionsMutex);
+  auto pendingConnections = m_pendingConnections;
+  pendingLocker.unlock();
+
+  HashSet<PendingConnection*> finished;
+  for (auto const& pending : pendingConnections) {
+    bool done = true;
+    try {
+      done = advanceHandshake(*pending);
+    } catch (std::exception const& e) {
+      Logger::error("UniverseServer: Exception caught accepting new connection: {}", outputException(e, true));
+    }
+
+    if (done) {
+      if (pending->udpToken)
+        pending->udpPacketHost->cancelConnection(*pending->udpToken);
+      finished.add(pending.get());
+    }
+  }
+
+  if (!finished.empty()) {
+    pendingLocker.lock();
+    m_pendingConnections.filter([&](PendingConnectionPtr const& pending) {
+        return !finished.contains(pending.get());
+      });
+  }
+}
+
+bool UniverseServer::advanceHandshake(PendingConnection& pending) {
+  typedef PendingConnection::State State;
+
   auto& root = Root::singleton();
   auto assets = root.assets();
   auto configuration = root.configuration();
-  auto versioningDatabase = root.versioningDatabase();
 
   int clientWaitLimit = assets->json("/universe_server.config:clientWaitLimit").toInt();
-  String serverAssetsMismatchMessage = assets->json("/universe_server.config:serverAssetsMismatchMessage").toString();
-  String clientAssetsMismatchMessage = assets->json("/universe_server.config:clientAssetsMismatchMessage").toString();
   auto connectionSettings = configuration->get("connectionSettings");
 
-  RecursiveMutexLocker mainLocker(m_mainLock, false);
-
-  connection.receiveAny(clientWaitLimit);
-  auto protocolRequest = as<ProtocolRequestPacket>(connection.pullSingle());
-  if (!protocolRequest) {
-    Logger::warn("UniverseServer: client connection aborted, expected ProtocolRequestPacket");
-    return;
-  }
+  int64_t now = Time::monotonicMilliseconds();
+  bool timedOut = now >= pending.deadline || !pending.connection.isOpen();
+  auto& connection = pending.connection;
 
-  bool legacyClient = protocolRequest->compressionMode() != PacketCompressionMode::Enabled;
-  if (legacyClient)
-    connection.packetSocket().setNetRules(LegacyVersion);
+  connection.send();
 
-  auto protocolResponse = make_shared<ProtocolResponsePacket>();
-  protocolResponse->setCompressionMode(PacketCompressionMode::Enabled);// Signal that we're OpenStarbound
-  if (protocolRequest->requestProtocolVersion != StarProtocolVersion) {
-    Logger::warn("UniverseServer: client connection aborted, unsupported protocol version {}, supported version {}",
-                 protocolRequest->requestProtocolVersion, StarProtocolVersion);
-    protocolResponse->allowed = false;
-    connection.pushSingle(protocolResponse);
-    connection.sendAll(clientWaitLimit);
-    mainLocker.lock();
-    m_deadConnections.append({std::move(connection), Time::monotonicMilliseconds()});
-    return;
-  }
+  // Returns the next packet from the client, or null if there is none yet or
+  // the client took too long to send it.
+  auto receivePacket = [&]() -> PacketPtr {
+    connection.receive();
+    auto packet = connection.pullSingle();
+    if (packet && pending.packetCapture)
+      pending.packetCapture->record(pending.captureStream, packet, connection.packetSocket().netRules());
+    return packet;
+  };
 
-  bool useCompressionStream = false;
-  protocolResponse->allowed = true;
-  if (!legacyClient) {
-    auto compressionName = connectionSettings.getString("compression", "None");
-    auto compressionMode = NetCompressionModeNames.maybeLeft(compressionName).value(NetCompressionMode::None);
-    useCompressionStream = compressionMode == NetCompressionMode::Zstd;
-    protocolResponse->info = JsonObject{
-      {"compression", NetCompressionModeNames.getRight(compressionMode)},
-      {"openProtocolVersion", OpenProtocolVersion}};
-  }
-  connection.pushSingle(protocolResponse);
-  connection.sendAll(clientWaitLimit);
-
-  if (auto compressedSocket = as<CompressedPacketSocket>(&connection.packetSocket()))
-    compressedSocket->setCompressionStreamEnabled(useCompressionStream);
-
-  String remoteAddressString = remoteAddress ? toString(*remoteAddress) : "local";
-  Logger::info("UniverseServer: Awaiting connection info from {} ({} client)", remoteAddressString, legacyClient ? "vanilla" : "custom");
-
-  connection.receiveAny(clientWaitLimit);
-  auto clientConnect = as<ClientConnectPacket>(connection.pullSingle());
-  if (!clientConnect) {
-    Logger::warn("UniverseServer: client connection aborted");
-    connection.pushSingle(make_shared<ConnectFailurePacket>("connect timeout"));
-    mainLocker.lock();
+  auto closeConnection = [&]() {
+    RecursiveMutexLocker mainLocker(m_mainLock);
     m_deadConnections.append({std::move(connection), Time::monotonicMilliseconds()});
-    return;
-  }
-
-  bool administrator = false;
-  String accountString = !clientConnect->account.empty() ? strf("'{}'", clientConnect->account) : "<anonymous>";
+    return true;
+  };
 
   auto connectionFail = [&](String message) {
     Logger::warn("UniverseServer: Login attempt failed with account '{}' as player '{}' from address {}, error: {}",
-                 accountString, clientConnect->playerName, remoteAddressString, message);
+                 pending.accountString, pending.clientConnect->playerName, pending.remoteAddressString, message);
     connection.pushSingle(make_shared<ConnectFailurePacket>(std::move(message)));
-    mainLocker.lock();
-    m_deadConnections.append({std::move(connection), Time::monotonicMilliseconds()});
+    return closeConnection();
   };
 
-  if (connectionSettings.getBool("requireLatestVersion", false)
-      && (legacyClient || clientConnect->info.getUInt("openProtocolVersion", 0) < OpenProtocolVersion)) {
-    connectionFail(strf("OpenStarbound v{} or later is required.\nSource ID: {}...", OpenStarVersionString, String(StarSourceIdentifierString, 8)));
-    return;
-  }
+  if (pending.state == State::AwaitingProtocolRequest) {
+    auto packet = receivePacket();
+    if (!packet && !timedOut)
+      return false;
 
-  if (!remoteAddress) {
-    administrator = true;
-    Logger::info("UniverseServer: Logged in player '{}' locally", clientConnect->playerName);
-  } else {
-    if (clientConnect->assetsDigest != m_assetsDigest) {
-      if (!configuration->get("allowAssetsMismatch").toBool()) {
-        connectionFail(serverAssetsMismatchMessage);
-        return;
-      } else if (!clientConnect->allowAssetsMismatch) {
-        connectionFail(clientAssetsMismatchMessage);
-        return;
+    auto protocolRequest = as<ProtocolRequestPacket>(packet);
+    if (!protocolRequest) {
+      Logger::warn("UniverseServer: client connection aborted, expected ProtocolRequestPacket");
+      return true;
+    }
+
+    pending.legacyClient = protocolRequest->compressionMode() != PacketCompressionMode::Enabled;
+    if (pending.legacyClient)
+      connection.packetSocket().setNetRules(LegacyVersion);
+
+    auto protocolResponse = make_shared<ProtocolResponsePacket>();
+    protocolResponse->setCompressionMode(PacketCompressionMode::Enabled);// Signal that we're OpenStarbound
+    if (protocolRequest->requestProtocolVersion != StarProtocolVersion) {
+      Logger::warn("UniverseServer: client connection aborted, unsupported protocol version {}, supported version {}",
+                   protocolRequest->requestProtocolVersion, StarProtocolVersion);
+      protocolResponse->allowed = false;
+      connection.pushSingle(protocolResponse);
+      return closeConnection();
+    }
+
+    protocolResponse->allowed = true;
+    if (!pending.legacyClient) {
+      auto compressionName = connectionSettings.getString("compression", "None");
+      auto compressionMode = NetCompressionModeNames.maybeLeft(compressionName).value(NetCompressionMode::None);
+      pending.useCompressionStream = compressionMode == NetCompressionMode::Zstd;
+      protocolResponse->info = JsonObject{
+        {"compression", NetCompressionModeNames.getRight(compressionMode)},
+        {"openProtocolVersion", OpenProtocolVersion}};
+
+      pending.udpPacketHost = m_udpPacketHost.load();
+      if (pending.udpPacketHost && pending.remoteAddress) {
+        // Kept within the range of Json integers
+        pending.udpToken = DataStreamBuffer::deserialize<uint64_t>(secureRandomBytes(8)) >> 1;
+        pending.udpPacketHost->expectConnection(*pending.udpToken);
+        protocolResponse->info = protocolResponse->info
+          .set("udpPort", configuration->get("gameServerPort").toUInt())
+          .set("udpToken", *pending.udpToken);
+      }
+
+      if (pending.remoteAddress && m_sessionResumeTime > 0.0f) {
+        pending.sessionToken = DataStreamBuffer::deserialize<uint64_t>(secureRandomBytes(8)) >> 1;
+        protocolResponse->info = protocolResponse->info
+          .set("sessionToken", *pending.sessionToken)
+          .set("sessionResumeTime", m_sessionResumeTime);
       }
     }
+    connection.pushSingle(protocolResponse);
+    connection.send();
 
-    if (!m_speciesShips.contains(clientConnect->shipSpecies)) {
-      connectionFail("Unknown ship species");
-      return;
+    pending.state = State::SendingProtocolResponse;
+    pending.deadline = now + clientWaitLimit;
+  }
+
+  if (pending.state == State::SendingProtocolResponse) {
+    // The compression stream may only be switched on once the response has
+    // left uncompressed.
+    if (connection.packetSocket().sentPacketsPending() && !timedOut)
+      return false;
+
+    if (auto compressedSocket = as<CompressedPacketSocket>(&connection.packetSocket())) {
+      compressedSocket->setCompressionStreamEnabled(pending.useCompressionStream);
+      if (pending.useCompressionStream)
+        compressedSocket->setAdaptiveCompression(m_adaptiveCompression);
     }
 
-    if (!clientConnect->account.empty()) {
-      auto passwordSalt = secureRandomBytes(assets->json("/universe_server.config:passwordSaltLength").toUInt());
-      Logger::info("UniverseServer: Sending Handshake Challenge");
-      connection.pushSingle(make_shared<HandshakeChallengePacket>(passwordSalt));
-      connection.sendAll(clientWaitLimit);
-      connection.receiveAny(clientWaitLimit);
-      shared_ptr<HandshakeResponsePacket> handshakeResponsePacket = as<HandshakeResponsePacket>(connection.pullSingle());
-      if (!handshakeResponsePacket) {
-        connectionFail("Expected HandshakeResponsePacket.");
-        return;
-      }
+    Logger::info("UniverseServer: Awaiting connection info from {} ({} client)", pending.remoteAddressString, pending.legacyClient ? "vanilla" : "custom");
+    pending.state = State::AwaitingClientConnect;
+    pending.deadline = now + clientWaitLimit;
+    return false;
+  }
 
-      bool success = false;
-      if (Json account = configuration->get("serverUsers").get(clientConnect->account, {})) {
-        administrator = account.getBool("admin", false);
-        ByteArray passAccountSalt = (account.getString("password") + clientConnect->account).utf8Bytes();
-        passAccountSalt.append(passwordSalt);
-        ByteArray passHash = sha256(passAccountSalt);
-        if (passHash == handshakeResponsePacket->passHash)
-          success = true;
-      }
-      // Give the same message for missing account vs wrong password to
-      // prevent account detection, overkill given the overall level of
-      // security but hey, why not.
-      if (!success) {
-        connectionFail(strf("No such account '{}' or incorrect password", clientConnect->account));
-        return;
-      }
+  if (pending.state == State::AwaitingClientConnect) {
+    auto packet = receivePacket();
+    if (!packet && !timedOut)
+      return false;
+
+    pending.clientConnect = as<ClientConnectPacket>(packet);
+    if (!pending.clientConnect) {
+      Logger::warn("UniverseServer: client connection aborted");
+      connection.pushSingle(make_shared<ConnectFailurePacket>("connect timeout"));
+      return closeConnection();
+    }
+
+    pending.accountString = !pending.clientConnect->account.empty() ? strf("'{}'", pending.clientConnect->account) : "<anonymous>";
+    if (pending.udpToken && pending.clientConnect->info.getBool("udp", false)) {
+      pending.state = State::AwaitingUdpConnection;
+      pending.deadline = now + clientWaitLimit;
+    } else {
+      pending.state = State::Authenticating;
+    }
+  }
+
+  if (pending.state == State::AwaitingUdpConnection) {
+    auto udpSocket = pending.udpPacketHost->acceptConnection(*pending.udpToken);
+    if (!udpSocket) {
+      if (!timedOut)
+        return false;
+      Logger::warn("UniverseServer: client connection aborted, UDP transport requested but never connected");
+      return true;
+    }
+
+    pending.udpToken.reset();
+    Logger::info("UniverseServer: Client {} switched to UDP transport", pending.remoteAddressString);
+    udpSocket->setNetRules(connection.packetSocket().netRules());
+    connection = UniverseConnection(std::move(udpSocket));
+    pending.udpTransport = true;
+    pending.state = State::Authenticating;
+  }
+
+  if (pending.state == State::Authenticating) {
+    auto const& clientConnect = pending.clientConnect;
+    if (connectionSettings.getBool("requireLatestVersion", false)
+        && (pending.legacyClient || clientConnect->info.getUInt("openProtocolVersion", 0) < OpenProtocolVersion))
+      return connectionFail(strf("OpenStarbound v{} or later is required.\nSource ID: {}...", OpenStarVersionString, String(StarSourceIdentifierString, 8)));
+
+    if (!pending.remoteAddress) {
+      pending.administrator = true;
+      Logger::info("UniverseServer: Logged in player '{}' locally", clientConnect->playerName);
     } else {
-      if (!configuration->get("allowAnonymousConnections").toBool()) {
-        connectionFail("Anonymous connections disallowed");
-        return;
+      if (clientConnect->assetsDigest != m_assetsDigest) {
+        if (!configuration->get("allowAssetsMismatch").toBool())
+          return connectionFail(assets->json("/universe_server.config:serverAssetsMismatchMessage").toString());
+        else if (!clientConnect->allowAssetsMismatch)
+          return connectionFail(assets->json("/universe_server.config:clientAssetsMismatchMessage").toString());
       }
-      administrator = configuration->get("anonymousConnectionsAreAdmin").toBool();
+
+      if (!m_speciesShips.contains(clientConnect->shipSpecies))
+        return connectionFail("Unknown ship species");
+
+      if (!clientConnect->account.empty()) {
+        pending.passwordSalt = secureRandomBytes(assets->json("/universe_server.config:passwordSaltLength").toUInt());
+        Logger::info("UniverseServer: Sending Handshake Challenge");
+        connection.pushSingle(make_shared<HandshakeChallengePacket>(pending.passwordSalt));
+        connection.send();
+        pending.state = State::AwaitingHandshakeResponse;
+        pending.deadline = now + clientWaitLimit;
+        return false;
+      }
+
+      if (!configuration->get("allowAnonymousConnections").toBool())
+        return connectionFail("Anonymous connections disallowed");
+      pending.administrator = configuration->get("anonymousConnectionsAreAdmin").toBool();
     }
+    pending.state = State::Admitting;
+  }
 
-    if (auto reason = isBannedUser(remoteAddress, clientConnect->playerUuid)) {
-      connectionFail("You are banned: " + *reason);
-      return;
+  if (pending.state == State::AwaitingHandshakeResponse) {
+    auto packet = receivePacket();
+    if (!packet && !timedOut)
+      return false;
+
+    auto handshakeResponsePacket = as<HandshakeResponsePacket>(packet);
+    if (!handshakeResponsePacket)
+      return connectionFail("Expected HandshakeResponsePacket.");
+
+    auto const& account = pending.clientConnect->account;
+    bool success = false;
+    if (Json accountConfig = configuration->get("serverUsers").get(account, {})) {
+      pending.administrator = accountConfig.getBool("admin", false);
+      ByteArray passAccountSalt = (accountConfig.getString("password") + account).utf8Bytes();
+      passAccountSalt.append(pending.passwordSalt);
+      ByteArray passHash = sha256(passAccountSalt);
+      if (passHash == handshakeResponsePacket->passHash)
+        success = true;
     }
+    // Give the same message for missing account vs wrong password to
+    // prevent account detection, overkill given the overall level of
+    // security but hey, why not.
+    if (!success)
+      return connectionFail(strf("No such account '{}' or incorrect password", account));
+    pending.state = State::Admitting;
   }
 
+  if (pending.state == State::Admitting) {
+    if (pending.remoteAddress) {
+      if (auto reason = isBannedUser(pending.remoteAddress, pending.clientConnect->playerUuid))
+        return connectionFail("You are banned: " + *reason);
+    }
+
+    if (Json resumeInfo = pending.clientConnect->info.get("resumeSession", {})) {
+      resumeSession(pending, resumeInfo);
+      return true;
+    }
+
+    // Reading and migrating the stored client context can take a while for
+    // players with a lot of history, so it is kept off the main loop.
+    String clientContextFile = File::relativeTo(m_storageDirectory, strf("{}.clientcontext", pending.clientConnect->playerUuid.hex()));
+    String playerName = pending.clientConnect->playerName;
+    pending.clientContextStore = m_workerPool.addProducer<Maybe<Json>>([clientContextFile, playerName]() -> Maybe<Json> {
+        if (!File::isFile(clientContextFile))
+          return {};
+        try {
+          return Root::singleton().versioningDatabase()->loadVersionedJson(VersionedJson::readFile(clientContextFile), "ClientContext");
+        } catch (std::exception const& e) {
+          Logger::error("UniverseServer: Could not load client context file for <User: {}>, ignoring! {}",
+                        playerName, outputException(e, false));
+          File::rename(clientContextFile, strf("{}.{}.fail", clientContextFile, Time::millisecondsSinceEpoch()));
+          return {};
+        }
+      });
+    pending.state = State::LoadingClientContext;
+  }
+
+  if (!pending.clientContextStore->poll())
+    return false;
+
+  finishConnection(pending, pending.clientContextStore->get());
+  return true;
+}
+
+void UniverseServer::finishConnection(PendingConnection& pending, Maybe<Json> const& clientContextStore) {
+  auto assets = Root::singleton().assets();
+
+  auto& connection = pending.connection;
+  auto const& clientConnect = pending.clientConnect;
+  auto const& remoteAddress = pending.remoteAddress;
+  bool administrator = pending.administrator;
+
+  auto connectionFail = [&](String message) {
+    Logger::warn("UniverseServer: Login attempt failed with account '{}' as player '{}' from address {}, error: {}",
+                 pending.accountString, clientConnect->playerName, pending.remoteAddressString, message);
+    connection.pushSingle(make_shared<ConnectFailurePacket>(std::move(message)));
+    RecursiveMutexLocker mainLocker(m_mainLock);
+    m_deadConnections.append({std::move(connection), Time::monotonicMilliseconds()});
+  };
+
   String connectionLog = strf("UniverseServer: Logged in account '{}' as player '{}' from address {}",
-                              accountString, clientConnect->playerName, remoteAddressString);
+                              pending.accountString, clientConnect->playerName, pending.remoteAddressString);
 
-  NetCompatibilityRules netRules(legacyClient ? LegacyVersion : 1);
+  NetCompatibilityRules netRules(pending.legacyClient ? LegacyVersion : 1);
   netRules.setIsAdmin(administrator);
   if (Json& info = clientConnect->info) {
     if (auto openProtocolVersion = info.optUInt("openProtocolVersion"))
@@ -1915,13 +2190,14 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
   auto clientContext = make_shared<ServerClientContext>(clientId, remoteAddress, netRules, clientConnect->playerUuid,
                                                         clientConnect->playerName, clientConnect->shipSpecies, administrator, clientConnect->shipChunks);
   clientContext->registerRpcHandlers(m_teamManager->authenticatedRpcHandlers(clientContext->playerUuid()));
+  // Entity updates may be lost over UDP, so they are acknowledged instead
+  clientContext->setAcknowledgedEntityUpdates(pending.udpTransport);
 
-  String clientContextFile = File::relativeTo(m_storageDirectory, strf("{}.clientcontext", clientConnect->playerUuid.hex()));
-  if (File::isFile(clientContextFile)) {
+  if (clientContextStore) {
     try {
-      auto contextStore = versioningDatabase->loadVersionedJson(VersionedJson::readFile(clientContextFile), "ClientContext");
-      clientContext->loadServerData(contextStore);
+      clientContext->loadServerData(*clientContextStore);
     } catch (std::exception const& e) {
+      String clientContextFile = File::relativeTo(m_storageDirectory, strf("{}.clientcontext", clientConnect->playerUuid.hex()));
       Logger::error("UniverseServer: Could not load client context file for <User: {}>, ignoring! {}",
                     clientConnect->playerName, outputException(e, false));
       File::rename(clientContextFile, strf("{}.{}.fail", clientContextFile, Time::millisecondsSinceEpoch()));
@@ -1934,10 +2210,30 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
 
   clientContext->setShipUpgrades(clientConnect->shipUpgrades);
 
+  if (pending.packetCapture)
+    pending.packetCapture->assignClient(clientId, pending.captureStream);
+  auto connectSuccess = make_shared<ConnectSuccessPacket>(clientId, m_universeSettings->uuid(), m_celestialDatabase->baseInformation());
+  if (pending.sessionToken && clientConnect->info.getBool("session", false)) {
+    // The session starts after ConnectSuccess, on both ends
+    connection.pushSingle(connectSuccess);
+    connection.send();
+    auto received = connection.pull();
+    connection = UniverseConnection(make_unique<SessionPacketSocket>(connection.takePacketSocket(), std::move(received)));
+    connectSuccess.reset();
+
+    MutexLocker sessionsLocker(m_clientSessionsMutex);
+    m_clientSessions[clientId] = ClientSession{*pending.sessionToken, {}};
+  }
   m_connectionServer->addConnection(clientId, std::move(connection));
-  m_connectionServer->sendPackets(clientId, {make_shared<ConnectSuccessPacket>(clientId, m_universeSettings->uuid(), m_celestialDatabase->baseInformation()), make_shared<UniverseTimeUpdatePacket>(m_universeClock->time()), make_shared<PausePacket>(*m_pause, GlobalTimescale)});
+  List<PacketPtr> connectPackets;
+  if (connectSuccess)
+    connectPackets.append(connectSuccess);
+  connectPackets.append(make_shared<UniverseTimeUpdatePacket>(m_universeClock->time()));
+  connectPackets.append(make_shared<PausePacket>(*m_pause, GlobalTimescale));
+  m_connectionServer->sendPackets(clientId, std::move(connectPackets));
 
   m_clients.add(clientId, clientContext);
+  publishClients();
   m_chatProcessor->connectClient(clientId, clientConnect->playerName);
   clientsLocker.unlock();
 
@@ -2011,6 +2307,40 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
     p.second->invoke("acceptConnection", clientId);
 }
 
+void UniverseServer::resumeSession(PendingConnection& pending, Json const& resumeInfo) {
+  uint64_t token = resumeInfo.getUInt("token", 0);
+  Maybe<ConnectionId> clientId;
+  {
+    MutexLocker sessionsLocker(m_clientSessionsMutex);
+    for (auto const& p : m_clientSessions) {
+      if (p.second.token == token && p.second.lostTime) {
+        clientId = p.first;
+        break;
+      }
+    }
+  }
+
+  auto clientContext = clientId ? connectedClient(*clientId) : ServerClientContextPtr();
+  if (!clientContext || clientContext->playerUuid() != pending.clientConnect->playerUuid
+      || !m_connectionServer->resumeConnection(*clientId, pending.connection, resumeInfo.getUInt("received", 0))) {
+    Logger::warn("UniverseServer: Could not resume session of player '{}' from address {}",
+                 pending.clientConnect->playerName, pending.remoteAddressString);
+    pending.connection.pushSingle(make_shared<ConnectFailurePacket>("Session expired"));
+    RecursiveMutexLocker mainLocker(m_mainLock);
+    m_deadConnections.append({std::move(pending.connection), Time::monotonicMilliseconds()});
+    return;
+  }
+
+  MutexLocker sessionsLocker(m_clientSessionsMutex);
+  if (auto session = m_clientSessions.ptr(*clientId))
+    session->lostTime.reset();
+  sessionsLocker.unlock();
+
+  if (pending.packetCapture)
+    pending.packetCapture->assignClient(*clientId, pending.captureStream);
+  Logger::info("UniverseServer: Client {} resumed its session from {}", clientContext->descriptiveName(), pending.remoteAddressString);
+}
+
 WarpToWorld UniverseServer::resolveWarpAction(WarpAction warpAction, ConnectionId clientId, bool deploy) const {
   auto clientContext = m_clients.value(clientId);
   if (!clientContext)
@@ -2115,8 +2445,68 @@ bool UniverseServer::canWarpToShip(ConnectionId clientId, Uuid const& targetShip
   return false;
 }
 
+void UniverseServer::updateMetrics() {
+  ReadLocker clientsLocker(m_clientsLock);
+  auto clientIds = m_clients.keys();
+  clientsLocker.unlock();
+
+  Metrics::setGauge("starbound_universe_clients", {}, clientIds.size());
+  {
+    RecursiveMutexLocker locker(m_mainLock);
+    Metrics::setGauge("starbound_universe_worlds", {}, m_worlds.size());
+  }
+
+  if (threadMemoryStatistics().counted) {
+    for (size_t i = 0; i < MemoryTagCount; ++i) {
+      auto tag = (MemoryTag)i;
+      auto stats = memoryTagStatistics(tag);
+      Metrics::Labels labels = {{"tag", memoryTagName(tag)}};
+      Metrics::setGauge("starbound_memory_live_bytes", labels, stats.liveBytes);
+      Metrics::setCounter("starbound_memory_allocations_total", labels, stats.allocations);
+      Metrics::setCounter("starbound_memory_allocated_bytes_total", labels, stats.allocatedBytes);
+    }
+  }
+
+  auto& root = Root::singleton();
+  for (auto const& cache : List<pair<String, CacheStatistics>>{
+      {"items", root.itemDatabase()->itemCacheStatistics()},
+      {"item_prototypes", root.itemDatabase()->itemPrototypeCacheStatistics()},
+      {"objects", root.objectDatabase()->configCacheStatistics()},
+      {"monsters", root.monsterDatabase()->monsterCacheStatistics()}}) {
+    Metrics::Labels labels = {{"cache", cache.first}};
+    Metrics::setCounter("starbound_cache_hits_total", labels, cache.second.hits);
+    Metrics::setCounter("starbound_cache_misses_total", labels, cache.second.misses);
+    Metrics::setGauge("starbound_cache_entries", labels, cache.second.size);
+  }
+
+  for (auto clientId : clientIds) {
+    Metrics::Labels labels = {{"client", toString(clientId)}};
+    try {
+      if (auto stats = m_connectionServer->incomingStats(clientId))
+        Metrics::setGauge("starbound_client_incoming_bytes_per_second", labels, stats->bytesPerSecond);
+      if (auto stats = m_connectionServer->outgoingStats(clientId)) {
+        Metrics::setGauge("starbound_client_outgoing_bytes_per_second", labels, stats->bytesPerSecond);
+        for (auto const& pair : stats->packetBytesPerSecond) {
+          Metrics::setGauge("starbound_client_outgoing_packet_bytes_per_second",
+              {{"client", toString(clientId)}, {"packet_type", PacketTypeNames.getRight(pair.first)}}, pair.second);
+        }
+      }
+      if (auto stats = m_connectionServer->packetSchedulerStats(clientId)) {
+        Metrics::setGauge("starbound_client_queued_packets", labels, stats->queuedPackets);
+        Metrics::setGauge("starbound_client_queue_latency_seconds", labels, stats->averageQueueLatency);
+      }
+    } catch (UniverseConnectionException const&) {
+      // Disconnected since the client list was read
+    }
+  }
+}
+
 void UniverseServer::doDisconnection(ConnectionId clientId, String const& reason) {
   RecursiveMutexLocker locker(m_mainLock);
+  {
+    MutexLocker sessionsLocker(m_clientSessionsMutex);
+    m_clientSessions.remove(clientId);
+  }
   WriteLocker clientsLocker(m_clientsLock);
   if (auto clientContext = m_clients.value(clientId)) {
     m_teamManager->playerDisconnected(clientContext->playerUuid());
@@ -2168,7 +2558,11 @@ void UniverseServer::doDisconnection(ConnectionId clientId, String const& reason
 
     clientsLocker.lock();
     m_clients.remove(clientId);
+    publishClients();
     m_deadConnections.append({m_connectionServer->removeConnection(clientId), Time::monotonicMilliseconds()});
+    Metrics::removeSeries("client", toString(clientId));
+    if (auto packetCapture = m_packetCapture.load())
+      packetCapture->removeClient(clientId);
     Logger::info("UniverseServer: Client {} disconnected for reason: {}", clientContext->descriptiveName(), reason);
 
     auto players = static_cast<uint16_t>(m_clients.size());
@@ -2191,6 +2585,18 @@ Maybe<ConnectionId> UniverseServer::getClientForUuid(Uuid const& uuid) const {
   return {};
 }
 
+void UniverseServer::publishClients() {
+  m_clientSnapshot.store(make_shared<ClientSnapshot const>(m_clients.begin(), m_clients.end()));
+}
+
+auto UniverseServer::clientSnapshot() const -> shared_ptr<ClientSnapshot const> {
+  return m_clientSnapshot.load();
+}
+
+ServerClientContextPtr UniverseServer::connectedClient(ConnectionId clientId) const {
+  return clientSnapshot()->value(clientId);
+}
+
 WorldServerThreadPtr UniverseServer::getWorld(WorldId const& worldId) {
   if (m_worlds.contains(worldId)) {
     auto& maybeWorldPromise = m_worlds.get(worldId);
@@ -2343,9 +2749,12 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::shipWorldPromise(
 
     auto shipWorldThread = make_shared<WorldServerThread>(shipWorld, ClientShipWorldId(clientShipWorldId));
     shipWorldThread->setPause(m_pause);
+    shipWorldThread->setScheduler(m_worldScheduler);
     clientContext->updateShipChunks(shipWorldThread->readChunks());
     shipWorldThread->start();
     shipWorldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
+    if (m_slowTickWatchdog)
+      m_slowTickWatchdog->watch(shipWorldThread);
 
     return shipWorldThread;
   });
@@ -2385,8 +2794,11 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::celestialWorldPro
 
     auto worldThread = make_shared<WorldServerThread>(worldServer, celestialWorldId);
     worldThread->setPause(m_pause);
+    worldThread->setScheduler(m_worldScheduler);
     worldThread->start();
     worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
+    if (m_slowTickWatchdog)
+      m_slowTickWatchdog->watch(worldThread);
 
     return worldThread;
   });
@@ -2506,8 +2918,11 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::instanceWorldProm
 
     auto worldThread = make_shared<WorldServerThread>(worldServer, instanceWorldId);
     worldThread->setPause(m_pause);
+    worldThread->setScheduler(m_worldScheduler);
     worldThread->start();
     worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
+    if (m_slowTickWatchdog)
+      m_slowTickWatchdog->watch(worldThread);
 
     return worldThread;
   });
@@ -2542,6 +2957,8 @@ SystemWorldServerThreadPtr UniverseServer::createSystemWorld(Vec3I const& locati
 
     auto systemThread = make_shared<SystemWorldServerThread>(location, systemWorld, storageFile);
     systemThread->setUpdateAction(bind(&UniverseServer::systemWorldUpdated, this, _1));
+    if (m_worldScheduler)
+      systemThread->setScheduler(m_worldScheduler, m_systemIdleUpdateInterval);
     systemThread->start();
     m_systemWorlds.set(location, systemThread);
   }
@@ -2,13 +2,18 @@
 
 #include "StarLockFile.hpp"
 #include "StarIdMap.hpp"
+#include "StarAtomicSharedPtr.hpp"
 #include "StarWorkerPool.hpp"
 #include "StarGameTypes.hpp"
 #include "StarCelestialCoordinate.hpp"
 #include "StarServerClientContext.hpp"
 #include "StarWorldServerThread.hpp"
+#include "StarWorldServerScheduler.hpp"
+#include "StarSlowTickWatchdog.hpp"
 #include "StarSystemWorldServerThread.hpp"
 #include "StarUniverseConnection.hpp"
+#include "StarUdpPacketSocket.hpp"
+#include "StarPacketCapture.hpp"
 #include "StarUniverseSettings.hpp"
 
 namespace Star {
@@ -77,6 +82,8 @@ public:
   void setAdmin(ConnectionId clientId, bool admin);
 
   bool isLocal(ConnectionId clientId) const;
+  // Bandwidth sent to the client over the last second, by packet type
+  Maybe<PacketStats> clientOutgoingStats(ConnectionId clientId) const;
 
   bool isPvp(ConnectionId clientId) const;
   void setPvp(ConnectionId clientId, bool pvp);
@@ -111,6 +118,13 @@ public:
 
   bool sendPacket(ConnectionId clientId, PacketPtr packet);
 
+  // Records every packet received from clients that connect from now on to
+  // the given file, to be replayed with server_replay_benchmark.  Replaces any
+  // capture already running.
+  void startPacketCapture(String const& path);
+  // Returns the path of the capture that was stopped, if one was running
+  Maybe<String> stopPacketCapture();
+
 protected:
   virtual void run();
 
@@ -138,6 +152,7 @@ private:
   void flyShips();
   void arriveShips();
   void respondToCelestialRequests();
+  // Hands pending chat to m_chatWorker, which parses it and runs any commands
   void processChat();
   void clearBrokenWorlds();
   void handleWorldMessages();
@@ -164,6 +179,7 @@ private:
   void doTempBan(ConnectionId clientId, String const& reason, pair<bool, bool> banType, int timeout);
   void doPermBan(ConnectionId clientId, String const& reason, pair<bool, bool> banType);
   void removeTimedBan();
+  void updateMetrics();
 
   void addCelestialRequests(ConnectionId clientId, List<CelestialRequest> requests);
 
@@ -171,7 +187,21 @@ private:
   void systemWorldUpdated(SystemWorldServerThread* systemWorldServer);
   void packetsReceived(UniverseConnectionServer* connectionServer, ConnectionId clientId, List<PacketPtr> packets);
 
-  void acceptConnection(UniverseConnection connection, Maybe<HostAddress> remoteAddress);
+  struct PendingConnection;
+  typedef shared_ptr<PendingConnection> PendingConnectionPtr;
+
+  // Queues a new connection to go through the login handshake, returns false
+  // if there are already too many pending.
+  bool queueConnection(UniverseConnection connection, Maybe<HostAddress> remoteAddress, Maybe<size_t> maxPending = {});
+  // Advances every pending handshake as far as it can go without blocking.
+  void processHandshakes();
+  // Returns true once the handshake is over, whether or not the client was
+  // let in.
+  bool advanceHandshake(PendingConnection& pending);
+  void finishConnection(PendingConnection& pending, Maybe<Json> const& clientContextStore);
+  // Carries a client whose connection was lost over to the pending
+  // connection, if it presented that client's session token in time.
+  void resumeSession(PendingConnection& pending, Json const& resumeInfo);
 
   // Main lock and clients read lock must be held when calling
   WarpToWorld resolveWarpAction(WarpAction warpAction, ConnectionId clientId, bool deploy) const;
@@ -182,6 +212,13 @@ private:
   // Clients read lock must be held when calling
   Maybe<ConnectionId> getClientForUuid(Uuid const& uuid) const;
 
+  typedef Map<ConnectionId, ServerClientContextPtr> ClientSnapshot;
+
+  void publishClients();
+  shared_ptr<ClientSnapshot const> clientSnapshot() const;
+  // Looks the client up in the latest snapshot, without locking
+  ServerClientContextPtr connectedClient(ConnectionId clientId) const;
+
   // Get the world only if it is already loaded, Main lock must be held when
   // calling.
   WorldServerThreadPtr getWorld(WorldId const& worldId);
@@ -227,6 +264,10 @@ private:
   ClockPtr m_universeClock;
   UniverseSettingsPtr m_universeSettings;
   WorkerPool m_workerPool;
+  // A single thread, so chat is still processed in the order it arrived.
+  // Commands that change a world reach it through executeForClient and
+  // block only this thread while waiting on the world.
+  WorkerPool m_chatWorker;
 
   int64_t m_storageTriggerDeadline;
   int64_t m_clearBrokenWorldsDeadline;
@@ -237,16 +278,49 @@ private:
   mutable ReadersWriterMutex m_clientsLock;
   unsigned m_maxPlayers;
   IdMap<ConnectionId, ServerClientContextPtr> m_clients;
+  // Copy of m_clients that is replaced whenever a client is added or removed,
+  // so that lookups from world and network threads do not wait on
+  // m_clientsLock or m_mainLock.  Only published with m_clientsLock held for
+  // writing.
+  AtomicSharedPtr<ClientSnapshot const> m_clientSnapshot;
 
   shared_ptr<atomic<bool>> m_pause;
+  // If set, worlds and system worlds are updated by this shared pool instead
+  // of each running on a dedicated thread
+  WorldServerSchedulerPtr m_worldScheduler;
+  double m_systemIdleUpdateInterval;
+  SlowTickWatchdogPtr m_slowTickWatchdog;
+  // Seconds an idle ship world stays hibernated before it is stopped, 0
+  // stops idle ship worlds straight away.
+  float m_shipWorldHibernationTime;
+  // Seconds a remote client whose connection was lost is kept around for
+  // it to reconnect and pick up where it left off, 0 disconnects straight
+  // away.
+  float m_sessionResumeTime;
   bool m_secureWarps;
   Map<WorldId, Maybe<WorkerPoolPromise<WorldServerThreadPtr>>> m_worlds;
   Map<InstanceWorldId, pair<int64_t, int64_t>> m_tempWorldIndex;
   Map<Vec3I, SystemWorldServerThreadPtr> m_systemWorlds;
   UniverseConnectionServerPtr m_connectionServer;
-
-  RecursiveMutex m_connectionAcceptThreadsMutex;
-  List<ThreadFunction<void>> m_connectionAcceptThreads;
+  // Compression stream level bounds for clients that use one, if their level
+  // should adapt to the connection.
+  Maybe<AdaptiveCompressionConfig> m_adaptiveCompression;
+
+  // Connections still working through the login handshake, which is
+  // advanced from the main loop a step at a time as their packets arrive.
+  Mutex m_pendingConnectionsMutex;
+  List<PendingConnectionPtr> m_pendingConnections;
+  // Offered to remote clients as an alternative to TCP when enabled
+  AtomicSharedPtr<UdpPacketHost> m_udpPacketHost;
+  AtomicSharedPtr<PacketCaptureWriter> m_packetCapture;
+
+  struct ClientSession {
+    uint64_t token;
+    // Set while the client's connection is lost
+    Maybe<int64_t> lostTime;
+  };
+  Mutex m_clientSessionsMutex;
+  HashMap<ConnectionId, ClientSession> m_clientSessions;
   LinkedList<pair<UniverseConnection, int64_t>> m_deadConnections;
 
   ChatProcessorPtr m_chatProcessor;
@@ -258,7 +332,9 @@ private:
   HashMap<ConnectionId, tuple<Vec3I, SystemLocation, Json>> m_pendingFlights;
   HashMap<ConnectionId, CelestialCoordinate> m_pendingArrivals;
   HashMap<ConnectionId, String> m_pendingDisconnections;
-  HashMap<ConnectionId, List<WorkerPoolPromise<CelestialResponse>>> m_pendingCelestialRequests;
+  // Continuations of background work, run on the main thread
+  CompletionQueuePtr m_completionQueue;
+  HashMap<ConnectionId, List<CelestialResponse>> m_celestialResponses;
   List<pair<WorldId, UniverseFlagAction>> m_pendingFlagActions;
   HashMap<ConnectionId, List<tuple<String, ChatSendMode, JsonObject>>> m_pendingChat;
   Maybe<WorkerPoolPromise<CelestialCoordinate>> m_nextRandomizedStarterWorld;
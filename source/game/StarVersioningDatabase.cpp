@@ -13,6 +13,7 @@
 #include "StarRoot.hpp"
 #include "StarCelestialDatabase.hpp"
 #include "StarJsonExtra.hpp"
+#include "StarCompactJson.hpp"
 
 namespace Star {
 
@@ -32,14 +33,23 @@ VersionedJson VersionedJson::readFile(String const& filename) {
   return versionedJson;
 }
 
-void VersionedJson::writeFile(VersionedJson const& versionedJson, String const& filename) {
+void VersionedJson::writeFile(VersionedJson const& versionedJson, String const& filename, bool compact) {
   DataStreamBuffer ds;
   ds.writeData(Magic, MagicStringSize);
-  ds.write(versionedJson);
+  if (compact)
+    writeCompact(ds, versionedJson);
+  else
+    ds.write(versionedJson);
   writeSubVersioning(ds, versionedJson);
   File::overwriteFileWithRename(ds.takeData(), filename);
 }
 
+void VersionedJson::writeCompact(DataStream& ds, VersionedJson const& versionedJson) {
+  ds.write(versionedJson.identifier);
+  ds.write(Maybe<VersionNumber>(versionedJson.version));
+  writeCompactJson(ds, versionedJson.content);
+}
+
 void VersionedJson::writeSubVersioning(DataStream& ds, VersionedJson const& versionedJson) {
   ds.write(VersionedJson::SubVersioning);
   JsonObject subVersionsOut;
@@ -23,7 +23,10 @@ struct VersionedJson {
   // header marking it as a starbound versioned json file.  Writes using a
   // safe write/flush/swap.
   static VersionedJson readFile(String const& filename);
-  static void writeFile(VersionedJson const& versionedJson, String const& filename);
+  static void writeFile(VersionedJson const& versionedJson, String const& filename, bool compact = false);
+  // Same layout as operator<<, but with the content in the compact binary
+  // Json encoding.  Read back with the normal operator>>.
+  static void writeCompact(DataStream& ds, VersionedJson const& versionedJson);
   static void writeSubVersioning(DataStream& ds, VersionedJson const& versionedJson);
   static void readSubVersioning(DataStream& ds, VersionedJson& versionedJson);
 
@@ -53,6 +53,9 @@ void ServerWeather::setReferenceClock(ClockConstPtr referenceClock) {
 }
 
 void ServerWeather::setClientVisibleRegions(List<RectI> regions) {
+  // Clients that have not sent a window yet see nothing, and would otherwise
+  // have weather spawned around the world origin for them.
+  regions.filter([](RectI const& region) { return !region.isEmpty(); });
   m_clientVisibleRegions = std::move(regions);
 }
 
@@ -264,6 +267,10 @@ void ServerWeather::spawnWeatherProjectiles(float dt) {
           spawnRegion.second,
           spawnRegion.first[1],
           spawnRegion.second + projectileConfig.spawnAboveRegion);
+      // Nothing spawns underground, so there is no need to roll positions for
+      // clients deep below the surface.
+      if (spawnRect.yMax() <= m_undergroundLevel)
+        continue;
 
       // Figure out a good target value based on the rate per x tile, making
       // sure to handle very low count values appropriately on average.
@@ -8,9 +8,70 @@ namespace Star {
 
 WireProcessor::WireProcessor(WorldStoragePtr worldStorage) {
   m_worldStorage = worldStorage;
+  m_networksValid = false;
+}
+
+void WireProcessor::setEvaluationBudget(Maybe<size_t> evaluationBudget) {
+  m_evaluationBudget = evaluationBudget;
 }
 
 void WireProcessor::process() {
+  if (!m_networksValid || !checkCachedNetworks() || !syncNetworkSectors())
+    rebuildNetworks();
+
+  // Any output that changed state since the last call needs the entities on
+  // the other end of its connections to be evaluated again.
+  for (auto& p : m_workingWireEntities) {
+    auto& wes = p.second;
+    for (size_t i = 0; i < wes.outputStates.size(); ++i) {
+      bool state = wes.wireEntity->nodeState({WireDirection::Output, i});
+      if (wes.outputStates[i] != state) {
+        wes.outputStates[i] = state;
+        for (auto const& target : wes.outputTargets[i])
+          m_pendingEvaluation.add(target);
+      }
+    }
+  }
+
+  size_t evaluations = 0;
+  while (!m_pendingEvaluation.empty() && (!m_evaluationBudget || evaluations < *m_evaluationBudget)) {
+    auto position = m_pendingEvaluation.takeFirst();
+    if (auto wes = m_workingWireEntities.ptr(position)) {
+      wes->wireEntity->evaluate(this);
+      ++evaluations;
+    }
+  }
+}
+
+bool WireProcessor::readInputConnection(WireConnection const& connection) {
+  if (auto wes = m_workingWireEntities.ptr(connection.entityLocation))
+    return wes->outputStates.get(connection.nodeIndex);
+  return false;
+}
+
+bool WireProcessor::checkCachedNetworks() {
+  size_t liveCount = 0;
+  bool valid = true;
+  m_worldStorage->entityMap()->forAllEntities([&](EntityPtr const& entity) {
+      if (!valid)
+        return;
+      if (auto wireEntity = as<WireEntity>(entity.get())) {
+        auto wes = m_workingWireEntities.ptr(wireEntity->tilePosition());
+        if (!wes || wes->wireEntity != wireEntity || wes->entityId != wireEntity->entityId()
+            || wes->connectionsVersion != wireEntity->connectionsVersion())
+          valid = false;
+        ++liveCount;
+      }
+    });
+
+  return valid && liveCount == m_workingWireEntities.size();
+}
+
+void WireProcessor::rebuildNetworks() {
+  m_workingWireEntities.clear();
+  m_networkSectors.clear();
+  m_pendingEvaluation.clear();
+
   // First, populate all the working entities that are already live
   m_worldStorage->entityMap()->forAllEntities([&](EntityPtr const& entity) {
     if (auto wireEntity = as<WireEntity>(entity.get()))
@@ -28,26 +89,52 @@ void WireProcessor::process() {
     size_t oldWorkingSize = m_workingWireEntities.size();
     for (auto const& p : m_workingWireEntities.keys()) {
       if (!m_workingWireEntities.get(p).networkLoaded)
-        loadNetwork(p);
+        m_networkSectors.append(loadNetwork(p));
     }
     if (m_workingWireEntities.size() == oldWorkingSize)
       break;
   }
 
-  for (auto const& p : m_workingWireEntities)
-    p.second.wireEntity->evaluate(this);
+  // Loading the networks may have removed dangling connections, so take the
+  // connections only once every network is loaded, and evaluate everything
+  // once against the new networks.
+  for (auto& p : m_workingWireEntities) {
+    auto& wes = p.second;
+    wes.connectionsVersion = wes.wireEntity->connectionsVersion();
+    wes.outputTargets.resize(wes.outputStates.size());
+    for (size_t i = 0; i < wes.outputStates.size(); ++i) {
+      wes.outputTargets[i].clear();
+      for (auto const& connection : wes.wireEntity->connectionsForNode({WireDirection::Output, i}))
+        wes.outputTargets[i].append(connection.entityLocation);
+    }
+    m_pendingEvaluation.add(p.first);
+  }
 
-  m_workingWireEntities.clear();
+  m_networksValid = true;
 }
 
-bool WireProcessor::readInputConnection(WireConnection const& connection) {
-  if (auto wes = m_workingWireEntities.ptr(connection.entityLocation))
-    return wes->outputStates.get(connection.nodeIndex);
-  return false;
+bool WireProcessor::syncNetworkSectors() {
+  // Set the sector ttl for the entire network to be equal to the highest
+  // entry, so that the entire network either lives or dies together, but
+  // without artificially extending the lifetime of the network.
+  for (auto const& sectors : m_networkSectors) {
+    Maybe<float> highestTtl;
+    for (auto const& sector : sectors) {
+      if (m_worldStorage->sectorLoadLevel(sector) != SectorLoadLevel::Loaded)
+        return false;
+      auto ttl = *m_worldStorage->sectorTimeToLive(sector);
+      highestTtl = highestTtl ? max(*highestTtl, ttl) : ttl;
+    }
+    if (highestTtl) {
+      for (auto const& sector : sectors)
+        m_worldStorage->setSectorTimeToLive(sector, *highestTtl);
+    }
+  }
+  return true;
 }
 
 void WireProcessor::populateWorking(WireEntity* wireEntity) {
-  auto p = m_workingWireEntities.insert(wireEntity->tilePosition(), WireEntityState{nullptr, {}, false});
+  auto p = m_workingWireEntities.insert(wireEntity->tilePosition(), WireEntityState{nullptr, NullEntityId, 0, {}, {}, false});
   if (!p.second) {
     if (p.first->second.wireEntity != wireEntity)
       Logger::debug("Multiple wire entities share tile position: {}", wireEntity->position());
@@ -55,13 +142,14 @@ void WireProcessor::populateWorking(WireEntity* wireEntity) {
   }
   auto& wes = p.first->second;
   wes.wireEntity = wireEntity;
+  wes.entityId = wireEntity->entityId();
   size_t outputNodeCount = wes.wireEntity->nodeCount(WireDirection::Output);
   wes.outputStates.resize(outputNodeCount);
   for (size_t i = 0; i < outputNodeCount; ++i)
     wes.outputStates[i] = wes.wireEntity->nodeState({WireDirection::Output, i});
 }
 
-void WireProcessor::loadNetwork(Vec2I tilePosition) {
+HashSet<Vec2S> WireProcessor::loadNetwork(Vec2I tilePosition) {
   HashSet<WorldStorage::Sector> networkSectors;
   Maybe<float> highestTtl;
 
@@ -127,6 +215,8 @@ void WireProcessor::loadNetwork(Vec2I tilePosition) {
     for (auto const& sector : networkSectors)
       m_worldStorage->setSectorTimeToLive(sector, *highestTtl);
   }
+
+  return networkSectors;
 }
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "StarWiring.hpp"
+#include "StarOrderedSet.hpp"
 
 namespace Star {
 
@@ -11,10 +12,20 @@ STAR_CLASS(WireProcessor);
 
 // Propogates WireEntity signals, and keeps networks of WireEntities alive
 // together.
+//
+// The wire networks are cached between calls to process, and are only
+// rescanned when a wire entity is added, removed, or has its connections
+// changed.  Only wire entities with an input connected to an output that
+// changed state are evaluated.
 class WireProcessor : public WireCoordinator {
 public:
   WireProcessor(WorldStoragePtr worldStorage);
 
+  // Limits how many wire entities are evaluated per call to process, any
+  // remaining entities are evaluated on the following calls.  Unlimited if
+  // not set.
+  void setEvaluationBudget(Maybe<size_t> evaluationBudget);
+
   void process();
 
   bool readInputConnection(WireConnection const& connection) override;
@@ -22,20 +33,38 @@ public:
 private:
   struct WireEntityState {
     WireEntity* wireEntity;
+    EntityId entityId;
+    uint64_t connectionsVersion;
     List<bool> outputStates;
+    // Locations of the wire entities connected to each output node
+    List<List<Vec2I>> outputTargets;
     bool networkLoaded;
   };
 
+  // Returns false if the live wire entities or any of their connections no
+  // longer match the cached networks.
+  bool checkCachedNetworks();
+  void rebuildNetworks();
+  // Keeps the sectors of every network alive together, returns false if any
+  // network sector is no longer loaded.
+  bool syncNetworkSectors();
+
   // Add the given WireEntity to the working entities set, populating inbound /
   // outbound nodes and states.
   void populateWorking(WireEntity* wireEntity);
   // Scans a wire network, starting at an entity at the given position, while
   // also loading any unloaded entries in the network and marking each entry as
-  // now having been 'networkLoaded'.
-  void loadNetwork(Vec2I tilePosition);
+  // now having been 'networkLoaded'.  Returns the sectors the network spans.
+  HashSet<Vec2S> loadNetwork(Vec2I tilePosition);
 
   WorldStoragePtr m_worldStorage;
+  Maybe<size_t> m_evaluationBudget;
+
+  bool m_networksValid;
   StableHashMap<Vec2I, WireEntityState> m_workingWireEntities;
+  // World storage sectors spanned by each wire network
+  List<HashSet<Vec2S>> m_networkSectors;
+  OrderedHashSet<Vec2I> m_pendingEvaluation;
 };
 
 }
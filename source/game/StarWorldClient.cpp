@@ -1,6 +1,7 @@
 #include "StarWorldClient.hpp"
 #include "StarIterator.hpp"
 #include "StarLogging.hpp"
+#include "StarArena.hpp"
 #include "StarBiome.hpp"
 #include "StarMaterialRenderProfile.hpp"
 #include "StarLiquidTypes.hpp"
@@ -21,6 +22,7 @@
 #include "StarStoredFunctions.hpp"
 #include "StarInspectableEntity.hpp"
 #include "StarCurve25519.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
@@ -46,7 +48,9 @@ WorldClient::WorldClient(PlayerPtr mainPlayer, LuaRootPtr luaRoot) {
   m_parallaxFadeTimer.setDone();
 
   m_collisionDebug = false;
+  m_collisionGeneration = 0;
   m_inWorld = false;
+  m_firstEntitySnapshot = 0;
 
   m_luaRoot = luaRoot;
 
@@ -78,6 +82,17 @@ WorldClient::WorldClient(PlayerPtr mainPlayer, LuaRootPtr luaRoot) {
 
   m_damageNotificationBatchDuration = m_clientConfig.getFloat("damageNotificationBatchDuration");
 
+  m_animationCullingPadding = m_clientConfig.getInt("animationCullingPadding", -1);
+  m_entityLodPadding = m_clientConfig.getInt("entityLodPadding", -1);
+  m_entityLodInterval = max<unsigned>(m_clientConfig.getUInt("entityLodInterval", 1), 1);
+
+  if (m_clientConfig.getBool("parallelEntityRender", false)) {
+    unsigned threadCount = m_clientConfig.getUInt("parallelEntityRenderThreads", 0);
+    if (threadCount == 0)
+      threadCount = max<unsigned>(std::thread::hardware_concurrency(), 2) - 1;
+    m_entityRenderWorkerPool = make_unique<WorkerPool>("WorldClient::entityRender", threadCount);
+  }
+
   m_ambientSounds.setTrackFadeInTime(assets->json("/interface.config:ambientTrackFadeInTime").toFloat());
   m_ambientSounds.setTrackSwitchGrace(assets->json("/interface.config:ambientTrackSwitchGrace").toFloat());
 
@@ -91,6 +106,7 @@ WorldClient::WorldClient(PlayerPtr mainPlayer, LuaRootPtr luaRoot) {
 
   m_stopLightingThread = false;
   m_pendingLightReady = false;
+  m_rendererLightingSupported = false;
 
   clearWorld();
 }
@@ -194,6 +210,7 @@ void WorldClient::removeEntity(EntityId entityId, bool andDie) {
     m_outgoingPackets.append(make_shared<EntityDestroyPacket>(entity->entityId(), std::move(finalNetState), andDie));
   }
 
+  m_entityLodTime.remove(entityId);
   m_entityMap->removeEntity(entityId);
   entity->uninit();
 }
@@ -276,6 +293,16 @@ CollisionKind WorldClient::tileCollisionKind(Vec2I const& pos) const {
   return WorldImpl::tileCollisionKind(m_tileArray, m_entityMap, pos);
 }
 
+uint64_t WorldClient::collisionGeneration(RectI const& region) const {
+  if (!inWorld())
+    return 0;
+
+  uint64_t generation = 0;
+  for (auto const& sector : m_tileArray->validSectorsFor(region))
+    generation = max(generation, m_sectorCollisionGenerations.value(sector, 0));
+  return generation;
+}
+
 void WorldClient::forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
   if (!inWorld())
     return;
@@ -457,11 +484,25 @@ RectI WorldClient::clientWindow() const {
   return m_clientState.window();
 }
 
+bool WorldClient::animationCulled(RectF const& region) const {
+  return outsideClientWindow(region, m_animationCullingPadding);
+}
+
+bool WorldClient::outsideClientWindow(RectF const& region, int padding) const {
+  if (padding < 0)
+    return false;
+  RectI window = m_clientState.window();
+  if (window.isEmpty())
+    return false;
+  return !m_geometry.rectIntersectsRect(RectF(window.padded(padding)), region);
+}
+
 WorldClientState& WorldClient::clientState() {
   return m_clientState;
 }
 
 void WorldClient::render(WorldRenderData& renderData, unsigned bufferTiles) {
+  STAR_PROFILE_SCOPE("WorldClient::render");
   if (!m_lightingThread && m_asyncLighting)
     m_lightingThread = Thread::invoke("WorldClient::lightingMain", mem_fn(&WorldClient::lightingMain), this);
 
@@ -538,13 +579,68 @@ void WorldClient::render(WorldRenderData& renderData, unsigned bufferTiles) {
       if (auto& globalDirectives = parameters->globalDirectives)
         directives = &globalDirectives.get();
   }
+  int64_t entitiesStart = Time::monotonicMicroseconds();
+  ArenaList<EntityPtr> renderEntities;
   m_entityMap->forAllEntities([&](EntityPtr const& entity) {
-      if (m_startupHiddenEntities.contains(entity->entityId()))
-        return;
+      if (!m_startupHiddenEntities.contains(entity->entityId()))
+        renderEntities.append(entity);
+    }, [](EntityPtr const& a, EntityPtr const& b) {
+      return a->entityId() < b->entityId();
+    });
+
+  // Entities that declare an independent render are rendered in batches on
+  // the worker pool while the rest render here.  Their output is merged
+  // afterwards in entity order, the same as if every entity had rendered
+  // serially.
+  size_t const EntityRenderBatchSize = 32;
+  ArenaList<ClientRenderCallback> renderCallbacks(renderEntities.size());
+  ArenaList<std::exception_ptr> renderExceptions(renderEntities.size());
+  ArenaList<bool> parallelRender(renderEntities.size(), false);
+  auto renderEntity = [&](size_t i) {
+    try {
+      renderEntities[i]->render(&renderCallbacks[i]);
+    } catch (...) {
+      renderExceptions[i] = std::current_exception();
+    }
+  };
+
+  Maybe<WorkerPoolGroup> renderGroup;
+  size_t parallelRenderCount = 0;
+  if (m_entityRenderWorkerPool) {
+    renderGroup.emplace(*m_entityRenderWorkerPool);
+    List<size_t> batch;
+    auto addBatch = [&]() {
+      renderGroup->add([&renderEntity, batch = take(batch)]() {
+          for (size_t i : batch)
+            renderEntity(i);
+        });
+    };
+    for (size_t i = 0; i < renderEntities.size(); ++i) {
+      if (renderEntities[i]->independentRender()) {
+        parallelRender[i] = true;
+        ++parallelRenderCount;
+        batch.append(i);
+        if (batch.size() == EntityRenderBatchSize)
+          addBatch();
+      }
+    }
+    if (!batch.empty())
+      addBatch();
+  }
 
-      ClientRenderCallback renderCallback;
+  for (size_t i = 0; i < renderEntities.size(); ++i) {
+    if (!parallelRender[i])
+      renderEntity(i);
+  }
+  if (renderGroup)
+    renderGroup->wait();
+
+  for (size_t i = 0; i < renderEntities.size(); ++i) {
+    auto const& entity = renderEntities[i];
+    auto& renderCallback = renderCallbacks[i];
 
-      try { entity->render(&renderCallback); }
+    if (renderExceptions[i]) {
+      try { std::rethrow_exception(renderExceptions[i]); }
       catch (StarException const& e) {
         if (entity->isMaster()) // this is YOUR problem!!
           throw e; 
@@ -565,50 +661,50 @@ void WorldClient::render(WorldRenderData& renderData, unsigned bufferTiles) {
           renderCallback.addDrawable(std::move(drawable), RenderLayerMiddleParticle);
         }
       }
-      
+    }
 
-      EntityDrawables ed;
-      for (auto& p : renderCallback.drawables) {
-        if (directives) {
-          int directiveIndex = unsigned(entity->entityId()) % directives->size();
-          for (auto& d : p.second) {
-            if (d.isImage())
-              d.imagePart().addDirectives(directives->at(directiveIndex), true);
-          }
+    EntityDrawables ed;
+    for (auto& p : renderCallback.drawables) {
+      if (directives) {
+        int directiveIndex = unsigned(entity->entityId()) % directives->size();
+        for (auto& d : p.second) {
+          if (d.isImage())
+            d.imagePart().addDirectives(directives->at(directiveIndex), true);
         }
-        ed.layers[p.first] = std::move(p.second);
       }
+      ed.layers[p.first] = std::move(p.second);
+    }
 
-      if (m_interactiveHighlightMode || (!inspecting && entity->entityId() == playerAimInteractive)) {
-        if (auto interactive = as<InteractiveEntity>(entity)) {
-          if (interactive->isInteractive()) {
-            ed.highlightEffect.type = EntityHighlightEffectType::Interactive;
-            ed.highlightEffect.level = pulseLevel;
-          }
-        }
-      } else if (inspecting) {
-        if (auto inspectable = as<InspectableEntity>(entity)) {
-          ed.highlightEffect = m_mainPlayer->inspectionHighlight(inspectable);
-          ed.highlightEffect.level *= inspectionFlickerMultiplier;
+    if (m_interactiveHighlightMode || (!inspecting && entity->entityId() == playerAimInteractive)) {
+      if (auto interactive = as<InteractiveEntity>(entity)) {
+        if (interactive->isInteractive()) {
+          ed.highlightEffect.type = EntityHighlightEffectType::Interactive;
+          ed.highlightEffect.level = pulseLevel;
         }
       }
-      renderData.entityDrawables.append(std::move(ed));
-
-      if (directives) {
-        int directiveIndex = unsigned(entity->entityId()) % directives->size();
-        for (auto& p : renderCallback.particles)
-          p.directives.append(directives->get(directiveIndex));
+    } else if (inspecting) {
+      if (auto inspectable = as<InspectableEntity>(entity)) {
+        ed.highlightEffect = m_mainPlayer->inspectionHighlight(inspectable);
+        ed.highlightEffect.level *= inspectionFlickerMultiplier;
       }
-      
-      m_particles->addParticles(std::move(renderCallback.particles));
-      m_samples.appendAll(std::move(renderCallback.audios));
-      m_previewTiles.appendAll(std::move(renderCallback.previewTiles));
-      renderData.overheadBars.appendAll(std::move(renderCallback.overheadBars));
+    }
+    renderData.entityDrawables.append(std::move(ed));
 
-    }, [](EntityPtr const& a, EntityPtr const& b) {
-      return a->entityId() < b->entityId();
-    });
+    if (directives) {
+      int directiveIndex = unsigned(entity->entityId()) % directives->size();
+      for (auto& p : renderCallback.particles)
+        p.directives.append(directives->get(directiveIndex));
+    }
+
+    m_particles->addParticles(std::move(renderCallback.particles));
+    m_samples.appendAll(std::move(renderCallback.audios));
+    m_previewTiles.appendAll(std::move(renderCallback.previewTiles));
+    renderData.overheadBars.appendAll(std::move(renderCallback.overheadBars));
+  }
+  LogMap::set("client_render_world_entities", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - entitiesStart));
+  LogMap::set("client_render_world_entities_parallel", strf("{} of {}", parallelRenderCount, renderEntities.size()));
 
+  int64_t tilesStart = Time::monotonicMicroseconds();
   m_tileArray->tileEachTo(renderData.tiles, tileRange, [&](RenderTile& renderTile, Vec2I const&, ClientTile const& clientTile) {
       renderTile.foreground = clientTile.foreground;
       renderTile.foregroundMod = clientTile.foregroundMod;
@@ -680,6 +776,26 @@ void WorldClient::render(WorldRenderData& renderData, unsigned bufferTiles) {
     }
   }
 
+  // Tiles overlaid with predictions or previews differ from the tile array,
+  // so regions containing any have no known revision.
+  List<Vec2I> overlaidTiles = m_predictedTiles.keys();
+  for (auto const& previewTile : m_previewTiles)
+    overlaidTiles.append(previewTile.position);
+  renderData.tileRevision = [tileArray = m_tileArray, geometry = m_geometry, overlaidTiles = std::move(overlaidTiles)](RectI const& region) -> uint64_t {
+    for (auto const& pos : overlaidTiles) {
+      Vec2I offset = geometry.diff(pos, region.min());
+      if (offset[0] >= 0 && offset[1] >= 0 && offset[0] < region.width() && offset[1] < region.height())
+        return 0;
+    }
+    return tileArray->regionRevision(region);
+  };
+
+  LogMap::set("client_render_world_tiles", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - tilesStart));
+
+  int64_t cullStart = Time::monotonicMicroseconds();
+  size_t culledLayers = cullOccludedDrawables(renderData);
+  LogMap::set("client_render_world_culled", strf(u8"{} layers, {:05d}\u00b5s", culledLayers, Time::monotonicMicroseconds() - cullStart));
+
   renderData.particles = &m_particles->particles();
   LogMap::set("client_render_particle_count", renderData.particles->size());
 
@@ -811,7 +927,7 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
   auto itemDatabase = root.itemDatabase();
   auto entityFactory = root.entityFactory();
 
-  for (auto const& packet : packets) {
+  for (auto const& packet : EntityMessageBatchPacket::unbatchPackets(packets)) {
     if (!inWorld() && !is<WorldStartPacket>(packet))
       Logger::error("WorldClient received packet type {} while not in world", PacketTypeNames.getRight(packet->type()));
 
@@ -833,6 +949,8 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
       entity->readNetState(entityCreate->firstNetState, 0.0f, netRules);
       entity->init(this, entityCreate->entityId, EntityMode::Slave);
       m_entityMap->addEntity(entity);
+      if (m_firstEntitySnapshot != 0)
+        m_slaveEntitiesNetVersion[entityCreate->entityId] = entityCreate->netVersion;
 
       if (m_interpolationTracker.interpolationEnabled()) {
         entity->enableInterpolation(m_interpolationTracker.extrapolationHint());
@@ -847,15 +965,72 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
 
     } else if (auto entityUpdateSet = as<EntityUpdateSetPacket>(packet)) {
       float interpolationLeadTime = m_interpolationTracker.interpolationLeadTime();
-      m_entityMap->forAllEntities([&](EntityPtr const& entity) {
-          EntityId entityId = entity->entityId();
-          if (connectionForEntity(entityId) == entityUpdateSet->forConnection) {
+      // Returns true if the entity skips this update, which leaves it
+      // extrapolating from its last one instead of reading it as unchanged.
+      auto deferEntityUpdate = [&](EntityPtr const& entity) {
+        EntityId entityId = entity->entityId();
+        unsigned interval = entityUpdateSet->updateIntervals.value(entityId, 1);
+        if (m_slaveEntityUpdateIntervals.value(entityId, 1) != interval) {
+          if (m_interpolationTracker.interpolationEnabled())
+            entity->enableInterpolation(m_interpolationTracker.extrapolationHint() * interval);
+          if (interval > 1)
+            m_slaveEntityUpdateIntervals[entityId] = interval;
+          else
+            m_slaveEntityUpdateIntervals.remove(entityId);
+        }
+        return entityUpdateSet->deferred(entityId);
+      };
+
+      if (entityUpdateSet->snapshot != 0) {
+        // Snapshots from before this world started belong to another world
+        if (m_firstEntitySnapshot == 0 || entityUpdateSet->snapshot < m_firstEntitySnapshot)
+          continue;
+
+        // The snapshot is only acknowledged if every delta in it could be
+        // read, the server treats acknowledged deltas as the client's state.
+        bool complete = true;
+        for (auto const& p : entityUpdateSet->deltas) {
+          auto entity = m_entityMap->entity(p.first);
+          if (!entity || connectionForEntity(p.first) != entityUpdateSet->forConnection)
+            complete = false;
+        }
+
+        m_entityMap->forAllEntities([&](EntityPtr const& entity) {
+            EntityId entityId = entity->entityId();
+            if (connectionForEntity(entityId) != entityUpdateSet->forConnection)
+              return;
             starAssert(entity->isSlave());
-            entity->readNetState(entityUpdateSet->deltas.value(entityId), interpolationLeadTime, m_clientState.netCompatibilityRules());
-          }
-        });
+            if (deferEntityUpdate(entity))
+              return;
+            ByteArray delta;
+            uint64_t netVersion = entityUpdateSet->netVersions.value(entityId);
+            auto& currentVersion = m_slaveEntitiesNetVersion[entityId];
+            // Skip deltas older than the state already read, which arrive
+            // when a lost snapshot is overtaken by a reliable EntityCreate.
+            if (netVersion > currentVersion) {
+              delta = entityUpdateSet->delta(entityId);
+              currentVersion = netVersion;
+            }
+            entity->readNetState(std::move(delta), interpolationLeadTime, m_clientState.netCompatibilityRules());
+          });
+
+        if (complete)
+          m_receivedEntitySnapshots.append(entityUpdateSet->snapshot);
+      } else {
+        m_entityMap->forAllEntities([&](EntityPtr const& entity) {
+            EntityId entityId = entity->entityId();
+            if (connectionForEntity(entityId) == entityUpdateSet->forConnection) {
+              starAssert(entity->isSlave());
+              if (deferEntityUpdate(entity))
+                return;
+              entity->readNetState(entityUpdateSet->delta(entityId), interpolationLeadTime, m_clientState.netCompatibilityRules());
+            }
+          });
+      }
 
     } else if (auto entityDestroy = as<EntityDestroyPacket>(packet)) {
+      m_slaveEntitiesNetVersion.remove(entityDestroy->entityId);
+      m_slaveEntityUpdateIntervals.remove(entityDestroy->entityId);
       if (auto entity = m_entityMap->entity(entityDestroy->entityId)) {
         entity->readNetState(entityDestroy->finalNetState, m_interpolationTracker.interpolationLeadTime(), m_clientState.netCompatibilityRules());
 
@@ -879,6 +1054,7 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
       m_centralStructure = WorldStructure(structurePacket->structureData);
 
     } else if (auto tileArrayUpdate = as<TileArrayUpdatePacket>(packet)) {
+      MemoryTagScope memoryTag(MemoryTag::Tiles);
       RectI tileRegion = RectI::withSize(tileArrayUpdate->min, Vec2I(tileArrayUpdate->array.size()));
 
       // NOTE: We're creating client side sectors on tileArrayUpdate here, and
@@ -897,6 +1073,32 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
     } else if (auto tileUpdate = as<TileUpdatePacket>(packet)) {
       readNetTile(tileUpdate->position, tileUpdate->tile);
 
+    } else if (auto tileUpdateBatch = as<TileUpdateBatchPacket>(packet)) {
+      for (auto const& run : tileUpdateBatch->tiles) {
+        for (size_t i = 0; i < run.values.size(); ++i)
+          readNetTile(run.position + Vec2I(i, 0), run.values[i]);
+      }
+
+      for (auto const& run : tileUpdateBatch->liquids) {
+        for (size_t i = 0; i < run.values.size(); ++i) {
+          Vec2I pos = run.position + Vec2I(i, 0);
+          m_predictedTiles.remove(pos);
+          if (ClientTile* tile = m_tileArray->modifyTile(pos))
+            tile->liquid = run.values[i].liquidLevel();
+        }
+      }
+
+      for (auto const& update : tileUpdateBatch->damage) {
+        if (ClientTile* tile = m_tileArray->modifyTile(update.position)) {
+          if (update.layer == TileLayer::Foreground)
+            tile->foregroundDamage = update.tileDamage;
+          else
+            tile->backgroundDamage = update.tileDamage;
+
+          m_damagedBlocks.add(update.position);
+        }
+      }
+
     } else if (auto tileDamageUpdate = as<TileDamageUpdatePacket>(packet)) {
       if (ClientTile* tile = m_tileArray->modifyTile(tileDamageUpdate->position)) {
         if (tileDamageUpdate->layer == TileLayer::Foreground)
@@ -1131,10 +1333,14 @@ void WorldClient::handleIncomingPackets(List<PacketPtr> const& packets) {
 }
 
 List<PacketPtr> WorldClient::getOutgoingPackets() {
-  return std::move(m_outgoingPackets);
+  auto packets = take(m_outgoingPackets);
+  if (m_clientState.netCompatibilityRules().version() >= 16)
+    EntityMessageBatchPacket::batchPackets(packets);
+  return packets;
 }
 
 void WorldClient::update(float dt) {
+  STAR_PROFILE_SCOPE("WorldClient::update");
   if (!inWorld())
     return;
 
@@ -1182,8 +1388,24 @@ void WorldClient::update(float dt) {
 
   List<EntityId> toRemove;
   List<EntityId> clientPresenceEntities;
+  bool entityLod = m_entityLodPadding >= 0 && m_entityLodInterval > 1;
   m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
-      try { entity->update(dt, m_currentStep); }
+      // Distant slaves run at a reduced rate, catching up on the skipped time
+      // in their next update, and resume full rate once back near the window.
+      float entityDt = dt;
+      if (entityLod && !entity->isMaster()) {
+        if (outsideClientWindow(entity->metaBoundBox().translated(entity->position()), m_entityLodPadding)) {
+          float& pending = m_entityLodTime[entity->entityId()];
+          pending += dt;
+          if ((m_currentStep + (unsigned)entity->entityId()) % m_entityLodInterval != 0)
+            return;
+          entityDt = take(pending);
+        } else if (auto pending = m_entityLodTime.maybeTake(entity->entityId())) {
+          entityDt += *pending;
+        }
+      }
+
+      try { entity->update(entityDt, m_currentStep); }
       catch (StarException const& e) {
         if (entity->isMaster()) // this is YOUR problem!!
           throw e;
@@ -1473,7 +1695,12 @@ void WorldClient::collectLiquid(List<Vec2I> const& tilePositions, LiquidId liqui
 bool WorldClient::waitForLighting(WorldRenderData* renderData) {
   MutexLocker prepLocker(m_lightMapPrepMutex);
   MutexLocker lightMapLocker(m_lightMapMutex);
-  if (renderData && !m_lightMap.empty()) {
+  if (renderData && !m_lightingInput.empty()) {
+    renderData->lightMap = Lightmap();
+    renderData->lightingInput = std::move(m_lightingInput);
+    renderData->lightMinPosition = m_lightMinPosition;
+    return true;
+  } else if (renderData && !m_lightMap.empty()) {
     for (auto& previewTile : m_previewTiles) {
       if (previewTile.updateLight) {
         Vec2I lightArrayPos = m_geometry.diff(previewTile.position, m_lightMinPosition);
@@ -1483,12 +1710,17 @@ bool WorldClient::waitForLighting(WorldRenderData* renderData) {
       }
     }
     renderData->lightMap = std::move(m_lightMap);
+    renderData->lightingInput = CellularLightingInput();
     renderData->lightMinPosition = m_lightMinPosition;
     return true;
   }
   return false;
 }
 
+void WorldClient::setRendererLightingSupported(bool supported) {
+  m_rendererLightingSupported = supported;
+}
+
 WorldClient::BroadcastCallback& WorldClient::broadcastCallback() {
   return m_broadcastCallback;
 }
@@ -1514,7 +1746,9 @@ void WorldClient::queueUpdatePackets(bool sendEntityUpdates) {
   auto assets = root.assets();
   auto entityFactory = root.entityFactory();
 
-  m_outgoingPackets.append(make_shared<StepUpdatePacket>(m_currentTime));
+  auto stepUpdate = make_shared<StepUpdatePacket>(m_currentTime);
+  stepUpdate->acknowledgedSnapshots = take(m_receivedEntitySnapshots);
+  m_outgoingPackets.append(std::move(stepUpdate));
 
   if (m_currentStep % m_clientConfig.getInt("worldClientStateUpdateDelta") == 0)
     m_outgoingPackets.append(make_shared<WorldClientStateUpdatePacket>(m_clientState.writeDelta()));
@@ -1529,7 +1763,7 @@ void WorldClient::queueUpdatePackets(bool sendEntityUpdates) {
         if (auto version = m_masterEntitiesNetVersion.ptr(entity->entityId())) {
           auto updateAndVersion = entity->writeNetState(*version, netRules);
           if (!updateAndVersion.first.empty())
-            entityUpdateSet->deltas[entity->entityId()] = std::move(updateAndVersion.first);
+            entityUpdateSet->deltas[entity->entityId()] = make_shared<ByteArray const>(std::move(updateAndVersion.first));
           *version = updateAndVersion.second;
         }
       });
@@ -1628,7 +1862,10 @@ void WorldClient::sparkDamagedBlocks() {
   auto materialDatabase = Root::singleton().materialDatabase();
 
   for (auto pos : m_damagedBlocks.values()) {
-    if (auto tile = m_tileArray->modifyTile(pos)) {
+    // Only read through the const accessor, so sparking does not bump the
+    // tile revision.
+    if (m_tileArray->tileLoaded(pos)) {
+      ClientTile const* tile = &m_tileArray->tile(pos);
       if (tile->backgroundDamage.healthy() && tile->foregroundDamage.healthy())
         m_damagedBlocks.remove(pos);
 
@@ -1706,27 +1943,36 @@ void WorldClient::lightingTileGather() {
   auto liquidsDatabase = Root::singleton().liquidsDatabase();
   auto materialDatabase = Root::singleton().materialDatabase();
 
-  // Each column in tileEvalColumns is guaranteed to be no larger than the sector size.
+  RectI region = m_lightingCalculator.calculationRegion();
+  size_t rebuiltSectors = m_lightingTiles.refresh(*m_tileArray, region, [&](ClientTile const& tile) {
+    LightingTile lightingTile;
+    if (tile.foreground != EmptyMaterialId || tile.foregroundMod != NoModId)
+      lightingTile.light += materialDatabase->radiantLight(tile.foreground, tile.foregroundMod);
+
+    if (tile.liquid.liquid != EmptyLiquidId && tile.liquid.level != 0.0f)
+      lightingTile.light += liquidsDatabase->radiantLight(tile.liquid);
+    if (tile.foregroundLightTransparent) {
+      if (tile.background != EmptyMaterialId || tile.backgroundMod != NoModId)
+        lightingTile.light += materialDatabase->radiantLight(tile.background, tile.backgroundMod);
+      lightingTile.environmentLit = tile.backgroundLightTransparent;
+    }
+    lightingTile.obstacle = !tile.foregroundLightTransparent;
+    return lightingTile;
+  });
+
+  // Each column in tileEachColumnsParallel is guaranteed to be no larger than the sector size.
 
-  m_tileArray->tileEvalColumnsParallel(m_lightingCalculator.calculationRegion(), [&](Vec2I const& pos, ClientTile const* column, size_t ySize) {
+  m_lightingTiles.elements().tileEachColumnsParallel(region, [&](Vec2I const& pos, LightingTile const* column, size_t ySize) {
     size_t baseIndex = m_lightingCalculator.baseIndexFor(pos);
     for (size_t y = 0; y < ySize; ++y) {
       auto& tile = column[y];
-      Vec3F light;
-      if (tile.foreground != EmptyMaterialId || tile.foregroundMod != NoModId)
-        light += materialDatabase->radiantLight(tile.foreground, tile.foregroundMod);
-
-      if (tile.liquid.liquid != EmptyLiquidId && tile.liquid.level != 0.0f)
-        light += liquidsDatabase->radiantLight(tile.liquid);
-      if (tile.foregroundLightTransparent) {
-        if (tile.background != EmptyMaterialId || tile.backgroundMod != NoModId)
-          light += materialDatabase->radiantLight(tile.background, tile.backgroundMod);
-        if (tile.backgroundLightTransparent && pos[1] + y > undergroundLevel)
-          light += environmentLight;
-      }
-      m_lightingCalculator.setCellIndex(baseIndex + y, light, !tile.foregroundLightTransparent);
+      Vec3F light = tile.light;
+      if (tile.environmentLit && pos[1] + y > undergroundLevel)
+        light += environmentLight;
+      m_lightingCalculator.setCellIndex(baseIndex + y, light, tile.obstacle);
     }
   });
+  LogMap::set("client_render_world_async_light_gather_sectors", rebuiltSectors);
   LogMap::set("client_render_world_async_light_gather", strf(u8"{:05d}\u00b5s", Time::monotonicMicroseconds() - start));
 }
 
@@ -1742,7 +1988,9 @@ void WorldClient::lightingCalc() {
   auto configuration = root.configuration();
   bool newLighting = configuration->get("newLighting").optBool().value(true);
   bool monochrome = configuration->get("monochromeLighting").toBool();
-  m_lightingCalculator.setParameters(root.assets()->json("/lighting.config:lighting").set("pointAdditive", newLighting));
+  Json lightingConfig = root.assets()->json("/lighting.config:lighting");
+  bool rendererLighting = m_rendererLightingSupported && lightingConfig.getBool("rendererCalculation", false);
+  m_lightingCalculator.setParameters(lightingConfig.set("pointAdditive", newLighting));
   m_lightingCalculator.setMonochrome(monochrome);
   m_lightingCalculator.begin(lightRange);
   lightingTileGather();
@@ -1772,11 +2020,20 @@ void WorldClient::lightingCalc() {
     m_lightingCalculator.addSpreadLight(position, lightPair.second);
   }
 
-  m_lightingCalculator.calculate(m_pendingLightMap);
+  if (rendererLighting)
+    m_lightingCalculator.calculate(m_pendingLightingInput);
+  else
+    m_lightingCalculator.calculate(m_pendingLightMap);
   {
     MutexLocker mapLocker(m_lightMapMutex);
     m_lightMinPosition = lightRange.min();
-    m_lightMap = std::move(m_pendingLightMap);
+    if (rendererLighting) {
+      m_lightingInput = std::move(m_pendingLightingInput);
+      m_lightMap = Lightmap();
+    } else {
+      m_lightMap = std::move(m_pendingLightMap);
+      m_lightingInput = CellularLightingInput();
+    }
   }
 }
 
@@ -1806,6 +2063,7 @@ void WorldClient::initWorld(WorldStartPacket const& startPacket) {
   m_entityUpdateTimer = GameTimer(m_interpolationTracker.entityUpdateDelta());
 
   m_clientId = startPacket.clientId;
+  m_firstEntitySnapshot = startPacket.firstEntitySnapshot;
   m_mainPlayer->clientContext()->setConnectionId(startPacket.clientId);
   auto entitySpace = connectionEntitySpace(startPacket.clientId);
   m_worldTemplate = make_shared<WorldTemplate>(startPacket.templateData);
@@ -1840,6 +2098,8 @@ void WorldClient::initWorld(WorldStartPacket const& startPacket) {
 
   m_particles = make_shared<ParticleManager>(m_geometry, m_tileArray);
   m_particles->setUndergroundLevel(m_worldTemplate->undergroundLevel());
+  // Particles update outside of rendering, so they can share its pool
+  m_particles->setWorkerPool(m_entityRenderWorkerPool.get());
 
   setupForceRegions();
 
@@ -1891,6 +2151,11 @@ void WorldClient::clearWorld() {
   m_interpolationTracker = InterpolationTracker();
 
   m_masterEntitiesNetVersion.clear();
+  m_firstEntitySnapshot = 0;
+  m_slaveEntitiesNetVersion.clear();
+  m_receivedEntitySnapshots.clear();
+  m_slaveEntityUpdateIntervals.clear();
+  m_entityLodTime.clear();
   m_outgoingPackets.clear();
 
   m_pingTime.reset();
@@ -1900,6 +2165,8 @@ void WorldClient::clearWorld() {
   m_worldProperties.clear();
 
   m_tileArray.reset();
+  m_lightingTiles.clear();
+  m_sectorCollisionGenerations.clear();
 
   m_damageManager.reset();
 
@@ -2080,6 +2347,9 @@ void WorldClient::dirtyCollision(RectI const& region) {
     return;
 
   auto dirtyRegion = region.padded(CollisionGenerator::BlockInfluenceRadius);
+  ++m_collisionGeneration;
+  for (auto const& sector : m_tileArray->validSectorsFor(dirtyRegion))
+    m_sectorCollisionGenerations[sector] = m_collisionGeneration;
   for (int x = dirtyRegion.xMin(); x < dirtyRegion.xMax(); ++x) {
     for (int y = dirtyRegion.yMin(); y < dirtyRegion.yMax(); ++y) {
       if (auto tile = m_tileArray->modifyTile({x, y}))
@@ -2095,10 +2365,8 @@ void WorldClient::freshenCollision(RectI const& region) {
   RectI freshenRegion = RectI::null();
   for (int x = region.xMin(); x < region.xMax(); ++x) {
     for (int y = region.yMin(); y < region.yMax(); ++y) {
-      if (auto tile = m_tileArray->modifyTile({x, y})) {
-        if (tile->collisionCacheDirty)
-          freshenRegion.combine(RectI(x, y, x + 1, y + 1));
-      }
+      if (m_tileArray->tileLoaded({x, y}) && m_tileArray->tile({x, y}).collisionCacheDirty)
+        freshenRegion.combine(RectI(x, y, x + 1, y + 1));
     }
   }
 
@@ -2372,6 +2640,51 @@ bool WorldClient::DamageNumberKey::operator<(DamageNumberKey const& other) const
       < tie(other.sourceEntityId, other.targetEntityId, other.damageNumberParticleKind);
 }
 
+size_t WorldClient::cullOccludedDrawables(WorldRenderData& renderData) const {
+  auto materialDatabase = Root::singleton().materialDatabase();
+
+  // Summed area table of occluding foreground tiles, so that whether a
+  // region is entirely covered can be answered with four lookups.
+  size_t width = renderData.tiles.size(0);
+  size_t height = renderData.tiles.size(1);
+  MultiArray<uint32_t, 2> occluding(width + 1, height + 1);
+  for (size_t x = 0; x < width; ++x) {
+    for (size_t y = 0; y < height; ++y) {
+      uint32_t occludes = materialDatabase->occludesBehind(renderData.tiles(x, y).foreground) ? 1 : 0;
+      occluding(x + 1, y + 1) = occludes + occluding(x, y + 1) + occluding(x + 1, y) - occluding(x, y);
+    }
+  }
+
+  auto occluded = [&](RectF const& boundBox) {
+    if (boundBox.isNull())
+      return false;
+    Vec2F min = m_geometry.diff(boundBox.min(), Vec2F(renderData.tileMinPosition));
+    Vec2F max = min + boundBox.size();
+    int xMin = floor(min[0]);
+    int yMin = floor(min[1]);
+    int xMax = ceil(max[0]);
+    int yMax = ceil(max[1]);
+    if (xMin < 0 || yMin < 0 || xMax > (int)width || yMax > (int)height || xMin >= xMax || yMin >= yMax)
+      return false;
+    uint32_t count = occluding(xMax, yMax) - occluding(xMin, yMax) - occluding(xMax, yMin) + occluding(xMin, yMin);
+    return count == (uint32_t)((xMax - xMin) * (yMax - yMin));
+  };
+
+  size_t culled = 0;
+  for (auto& entityDrawables : renderData.entityDrawables) {
+    auto it = entityDrawables.layers.begin();
+    while (it != entityDrawables.layers.end()) {
+      if (it->first < RenderLayerForegroundTile && occluded(Drawable::boundBoxAll(it->second, false))) {
+        it = entityDrawables.layers.erase(it);
+        ++culled;
+      } else {
+        ++it;
+      }
+    }
+  }
+  return culled;
+}
+
 void WorldClient::renderCollisionDebug() {
   RectI clientWindow = m_clientState.window();
   if (clientWindow.isEmpty())
@@ -15,6 +15,7 @@
 #include "StarGameTimers.hpp"
 #include "StarLuaRoot.hpp"
 #include "StarTickRateMonitor.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -68,6 +69,7 @@ public:
   bool tileIsOccupied(Vec2I const& pos, TileLayer layer, bool includeEphemeral = false, bool checkCollision = false) const override;
   CollisionKind tileCollisionKind(Vec2I const& pos) const override;
   void forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const override;
+  uint64_t collisionGeneration(RectI const& region) const override;
   bool isTileConnectable(Vec2I const& pos, TileLayer layer, bool tilesOnly = false) const override;
   bool pointTileCollision(Vec2F const& point, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
   bool lineTileCollision(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
@@ -147,6 +149,9 @@ public:
   void centerClientWindowOnPlayer(Vec2U const& windowSize);
   void centerClientWindowOnPlayer();
   RectI clientWindow() const;
+  // Whether client side animation in the given world region is far enough
+  // from the client window to be skipped.
+  bool animationCulled(RectF const& region) const;
   WorldClientState& clientState();
 
   void update(float dt);
@@ -178,6 +183,11 @@ public:
 
   bool waitForLighting(WorldRenderData* renderData = nullptr);
 
+  // Whether the renderer can calculate the lightmap itself.  When it can and
+  // the lighting config asks for it, render data gets the lighting inputs
+  // instead of a calculated lightmap.
+  void setRendererLightingSupported(bool supported);
+
   typedef std::function<bool(PlayerPtr, StringView)> BroadcastCallback;
   BroadcastCallback& broadcastCallback();
 
@@ -227,6 +237,9 @@ private:
   void tryGiveMainPlayerItem(ItemPtr item, bool silent = false);
 
   void notifyEntityCreate(EntityPtr const& entity);
+  // Whether the region lies further than padding tiles outside the client
+  // window, always false for a negative padding.
+  bool outsideClientWindow(RectF const& region, int padding) const;
 
   // Queues pending (step based) updates to server,
   void queueUpdatePackets(bool sendEntityUpdates);
@@ -251,6 +264,9 @@ private:
   void dirtyCollision(RectI const& region);
   void freshenCollision(RectI const& region);
   void renderCollisionDebug();
+  // Removes entity drawable layers drawn beneath the foreground tiles that
+  // are entirely covered by occluding foreground tiles.
+  size_t cullOccludedDrawables(WorldRenderData& renderData) const;
 
   void informTilePrediction(Vec2I const& pos, TileModification const& modification);
 
@@ -259,6 +275,8 @@ private:
   void setupForceRegions();
 
   Json m_clientConfig;
+  // Renders entities that declare an independent render, if enabled
+  unique_ptr<WorkerPool> m_entityRenderWorkerPool;
   WorldTemplatePtr m_worldTemplate;
   WorldStructure m_centralStructure;
   Vec2F m_playerStart;
@@ -272,11 +290,26 @@ private:
   LuaRootPtr m_luaRoot;
 
   WorldGeometry m_geometry;
+  int m_animationCullingPadding;
+  // Slave entities further than this many tiles outside the client window
+  // are only updated every m_entityLodInterval steps, with the skipped time
+  // accumulated in m_entityLodTime.  A negative padding disables this.
+  int m_entityLodPadding;
+  unsigned m_entityLodInterval;
+  HashMap<EntityId, float> m_entityLodTime;
   uint64_t m_currentStep;
   double m_currentTime;
   bool m_fullBright;
   bool m_asyncLighting;
   CellularLightingCalculator m_lightingCalculator;
+  // Only the parts of each tile that the lighting gather reads, with the
+  // radiant light database lookups already done.
+  struct LightingTile {
+    Vec3F light;
+    bool obstacle = false;
+    bool environmentLit = false;
+  };
+  TileSectorColumn<ClientTileSectorArray, LightingTile> m_lightingTiles;
   mutable CellularLightIntensityCalculator m_lightIntensityCalculator;
   ThreadFunction<void> m_lightingThread;
   
@@ -289,6 +322,9 @@ private:
 
   Lightmap m_pendingLightMap;
   Lightmap m_lightMap;
+  CellularLightingInput m_pendingLightingInput;
+  CellularLightingInput m_lightingInput;
+  atomic<bool> m_rendererLightingSupported;
   List<LightSource> m_pendingLights;
   List<std::pair<Vec2F, Vec3F>> m_pendingParticleLights;
   RectI m_pendingLightRange;
@@ -299,6 +335,9 @@ private:
   SkyPtr m_sky;
 
   CollisionGenerator m_collisionGenerator;
+  // The collision generation each sector last changed at
+  HashMap<ClientTileSectorArray::Sector, uint64_t> m_sectorCollisionGenerations;
+  uint64_t m_collisionGeneration;
 
   WorldClientState m_clientState;
   Maybe<ConnectionId> m_clientId;
@@ -332,6 +371,16 @@ private:
 
   HashMap<EntityId, uint64_t> m_masterEntitiesNetVersion;
 
+  // Set when the server sends entity updates relative to acknowledged
+  // snapshots, to the first snapshot sent in this world.
+  uint64_t m_firstEntitySnapshot;
+  // The server's net version of each slave entity's current state
+  HashMap<EntityId, uint64_t> m_slaveEntitiesNetVersion;
+  List<uint64_t> m_receivedEntitySnapshots;
+  // Slave entities the server updates at a reduced rate, with their update
+  // interval, which their extrapolation is extended by.
+  HashMap<EntityId, unsigned> m_slaveEntityUpdateIntervals;
+
   InterpolationTracker m_interpolationTracker;
   GameTimer m_entityUpdateTimer;
 
@@ -164,7 +164,7 @@ FallingBlocksWorld::FallingBlocksWorld(WorldServer* w)
   : m_worldServer(w), m_materialDatabase(Root::singleton().materialDatabase()) {}
 
 FallingBlockType FallingBlocksWorld::blockType(Vec2I const& pos) {
-  auto const& tile =  m_worldServer->getServerTile(pos, true);
+  auto const& tile = m_worldServer->getServerTile(pos, !m_inColumn);
   if (tile.rootSource) {
     return FallingBlockType::Immovable;
   } if (tile.foreground == EmptyMaterialId) {
@@ -182,8 +182,8 @@ FallingBlockType FallingBlocksWorld::blockType(Vec2I const& pos) {
 }
 
 void FallingBlocksWorld::moveBlock(Vec2I const& from, Vec2I const& to) {
-  auto fromTile = m_worldServer->modifyServerTile(from, true);
-  auto toTile = m_worldServer->modifyServerTile(to, true);
+  auto fromTile = m_worldServer->modifyServerTile(from, !m_inColumn);
+  auto toTile = m_worldServer->modifyServerTile(to, !m_inColumn);
   if (!fromTile || !toTile)
     return;
 
@@ -201,10 +201,24 @@ void FallingBlocksWorld::moveBlock(Vec2I const& from, Vec2I const& to) {
     fromTile->foregroundMod = NoModId;
     fromTile->updateCollision(CollisionKind::None);
 
-    m_worldServer->requestGlobalBreakCheck();
+    if (m_inColumn)
+      m_needsBreakCheck = true;
+    else
+      m_worldServer->requestGlobalBreakCheck();
   }
 }
 
+void FallingBlocksWorld::beginColumn(RectI const& region) {
+  m_worldServer->signalRegion(region);
+  m_inColumn = true;
+}
+
+void FallingBlocksWorld::endColumn() {
+  m_inColumn = false;
+  if (take(m_needsBreakCheck))
+    m_worldServer->requestGlobalBreakCheck();
+}
+
 DungeonGeneratorWorld::DungeonGeneratorWorld(WorldServer* worldServer, bool markForActivation)
   : m_worldServer(worldServer), m_markForActivation(markForActivation) {}
 
@@ -541,6 +555,28 @@ DungeonId DungeonGeneratorWorld::getDungeonIdAt(Vec2I const& position) {
   return m_worldServer->getServerTile(position).dungeonId;
 }
 
+void DungeonGeneratorWorld::readTileStates(RectI const& region, DungeonTileState* out) {
+  auto worldTemplate = m_worldServer->worldTemplate();
+  auto isOpen = [](MaterialId material) {
+    return material == EmptyMaterialId || material == NullMaterialId;
+  };
+
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      auto const& tile = m_worldServer->getServerTile(Vec2I(x, y));
+      out->foregroundOpen = isOpen(tile.foreground);
+      out->foregroundSolid = !out->foregroundOpen;
+      out->backgroundOpen = isOpen(tile.background);
+      out->backgroundSolid = !out->backgroundOpen;
+      out->otherDungeon = tile.dungeonId != NoDungeonId;
+
+      auto const& block = worldTemplate->blockInfo(x, y);
+      out->oceanLiquid = block.oceanLiquid != EmptyLiquidId && y < block.oceanLiquidLevel;
+      ++out;
+    }
+  }
+}
+
 void DungeonGeneratorWorld::setDungeonIdAt(Vec2I const& position, DungeonId dungeonId) {
   if (auto tile = m_worldServer->modifyServerTile(position))
     tile->dungeonId = dungeonId;
@@ -692,6 +728,28 @@ void WorldGenerator::sectorLoadLevelChanged(WorldStorage* worldStorage, Sector c
   }
 }
 
+void WorldGenerator::prefetchSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) {
+  if (generationLevel != SectorGenerationLevel::BaseTiles || m_prefetchedBaseTiles.contains(sector))
+    return;
+
+  if (!m_prefetchWorkerPool)
+    m_prefetchWorkerPool = make_unique<WorkerPool>("WorldGenerator::prefetch", worldStorage->generationPrefetchThreads());
+
+  WorldTemplateConstPtr planet = m_worldServer->worldTemplate();
+  RectI sectorRegion = worldStorage->tileArray()->sectorRegion(sector);
+  auto blockInfo = m_prefetchWorkerPool->addProducer<List<WorldTemplate::BlockInfo>>([planet, sectorRegion]() {
+      List<WorldTemplate::BlockInfo> blockInfo;
+      blockInfo.reserve(sectorRegion.volume());
+      for (int x = sectorRegion.xMin(); x < sectorRegion.xMax(); ++x) {
+        for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y)
+          blockInfo.append(planet->blockInfo(x, y));
+      }
+      return blockInfo;
+    });
+
+  m_prefetchedBaseTiles.add(sector, PrefetchedBaseTiles{planet, planet->blockInfoVersion(), std::move(blockInfo)});
+}
+
 void WorldGenerator::terraformSector(WorldStorage* worldStorage, Sector const& sector) {
   // Logger::info("terraforming sector {}...", sector);
   reapplyBiome(worldStorage, sector);
@@ -787,6 +845,15 @@ void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorAr
   // Generate sector.
   auto tileArray = worldStorage->tileArray();
   RectI sectorRegion = tileArray->sectorRegion(sector);
+
+  // Use block info calculated ahead of time, unless the template has changed
+  // since it was started
+  Maybe<List<WorldTemplate::BlockInfo>> prefetchedBlockInfo;
+  if (auto prefetched = m_prefetchedBaseTiles.maybeTake(sector)) {
+    if (prefetched->worldTemplate == planet && prefetched->blockInfoVersion == planet->blockInfoVersion())
+      prefetchedBlockInfo = std::move(prefetched->blockInfo.get());
+  }
+
   for (int x = sectorRegion.xMin(); x < sectorRegion.xMax(); ++x) {
     for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y) {
       Vec2I pos(x, y);
@@ -795,7 +862,9 @@ void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorAr
       if (!tile)
         continue;
 
-      auto blockInfo = planet->blockInfo(pos[0], pos[1]);
+      auto blockInfo = prefetchedBlockInfo
+          ? prefetchedBlockInfo->at((x - sectorRegion.xMin()) * sectorRegion.height() + (y - sectorRegion.yMin()))
+          : planet->blockInfo(pos[0], pos[1]);
 
       tile->blockBiomeIndex = blockInfo.blockBiomeIndex;
       tile->environmentBiomeIndex = blockInfo.environmentBiomeIndex;
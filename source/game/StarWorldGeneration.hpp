@@ -7,6 +7,7 @@
 #include "StarMicroDungeon.hpp"
 #include "StarCellularLiquid.hpp"
 #include "StarBiomePlacement.hpp"
+#include "StarWorldTemplate.hpp"
 
 namespace Star {
 
@@ -42,9 +43,15 @@ public:
   FallingBlockType blockType(Vec2I const& pos) override;
   void moveBlock(Vec2I const& from, Vec2I const& to) override;
 
+  void beginColumn(RectI const& region) override;
+  void endColumn() override;
+
 private:
   WorldServer* m_worldServer;
   MaterialDatabaseConstPtr m_materialDatabase;
+  // Set while a column is processed, whose region has already been signalled
+  bool m_inColumn = false;
+  bool m_needsBreakCheck = false;
 };
 
 class DungeonGeneratorWorld : public DungeonGeneratorWorldFacade {
@@ -75,6 +82,7 @@ public:
   bool checkOpen(Vec2I const& position, TileLayer open) override;
   bool checkOceanLiquid(Vec2I const& position) override;
   DungeonId getDungeonIdAt(Vec2I const& position) override;
+  void readTileStates(RectI const& region, DungeonTileState* out) override;
   void setDungeonIdAt(Vec2I const& position, DungeonId dungeonId) override;
   void clearTileEntities(RectI const& bounds, Set<Vec2I> const& positions, bool clearAnchoredObjects) override;
 
@@ -118,6 +126,7 @@ public:
 
   void generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) override;
   void sectorLoadLevelChanged(WorldStorage* worldStorage, Sector const& sector, SectorLoadLevel loadLevel) override;
+  void prefetchSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) override;
   void terraformSector(WorldStorage* worldStorage, Sector const& sector) override;
   void initEntity(WorldStorage* worldStorage, EntityId entityId, EntityPtr const& entity) override;
   void destructEntity(WorldStorage* worldStorage, EntityPtr const& entity) override;
@@ -135,6 +144,13 @@ private:
     bool fulfilled;
   };
 
+  // Template block info for a sector's base tiles, calculated in the background
+  struct PrefetchedBaseTiles {
+    WorldTemplateConstPtr worldTemplate;
+    uint64_t blockInfoVersion;
+    WorkerPoolPromise<List<WorldTemplate::BlockInfo>> blockInfo;
+  };
+
   void prepareTiles(WorldStorage* worldStorage, Sector const& sector);
   void generateMicroDungeons(WorldStorage* worldStorage, Sector const& sector);
   void generateCaveLiquid(WorldStorage* worldStorage, Sector const& sector);
@@ -156,6 +172,9 @@ private:
   WorldServer* m_worldServer;
   MicroDungeonFactoryPtr m_microDungeonFactory;
   List<QueuedPlacement> m_queuedPlacements;
+
+  HashMap<Sector, PrefetchedBaseTiles> m_prefetchedBaseTiles;
+  unique_ptr<WorkerPool> m_prefetchWorkerPool;
 };
 
 }
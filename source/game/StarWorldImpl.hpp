@@ -77,6 +77,11 @@ namespace WorldImpl {
   template <typename TileSectorArray>
   float lightLevel(shared_ptr<TileSectorArray> const& tileSectorArray, EntityMapPtr const& entityMap, WorldGeometry const& worldGeometry,
       WorldTemplateConstPtr const& worldTemplate, SkyConstPtr const& sky, CellularLightIntensityCalculator& lighting, Vec2F pos);
+  // Fills the cells and lights of a lighting calculation that has already
+  // begun, for calculating several light levels at once
+  template <typename TileSectorArray>
+  void setLightIntensityInputs(shared_ptr<TileSectorArray> const& tileSectorArray, EntityMapPtr const& entityMap, WorldGeometry const& worldGeometry,
+      WorldTemplateConstPtr const& worldTemplate, SkyConstPtr const& sky, CellularLightIntensityCalculator& lighting);
 
   InteractiveEntityPtr getInteractiveInRange(WorldGeometry const& geometry, EntityMapPtr const& entityMap,
       Vec2F const& targetPosition, Vec2F const& sourcePosition, float maxRange);
@@ -454,25 +459,17 @@ namespace WorldImpl {
   }
 
   template <typename TileSectorArray>
-  float lightLevel(shared_ptr<TileSectorArray> const& tileSectorArray, EntityMapPtr const& entityMap, WorldGeometry const& worldGeometry,
-      WorldTemplateConstPtr const& worldTemplate, SkyConstPtr const& sky, CellularLightIntensityCalculator& lighting, Vec2F pos) {
-    if (pos[1] < 0 || pos[1] >= worldGeometry.height())
-      return 0;
-
-    // tileEach can't handle rects that are WAY out of range.
-    pos = worldGeometry.xwrap(pos);
-
+  void setLightIntensityInputs(shared_ptr<TileSectorArray> const& tileSectorArray, EntityMapPtr const& entityMap, WorldGeometry const& worldGeometry,
+      WorldTemplateConstPtr const& worldTemplate, SkyConstPtr const& sky, CellularLightIntensityCalculator& lighting) {
     Vec3F environmentLight = sky->environmentLight().toRgbF();
     float undergroundLevel = worldTemplate->undergroundLevel();
     auto materialDatabase = Root::singleton().materialDatabase();
     auto liquidsDatabase = Root::singleton().liquidsDatabase();
 
-    lighting.begin(pos);
-
-    // Each column in tileEvalColumns is guaranteed to be no larger than the
+    // Each column in tileEachColumns is guaranteed to be no larger than the
     // sector size.
     CellularLightIntensityCalculator::Cell lightingCellColumn[WorldSectorSize];
-    tileSectorArray->tileEvalColumns(lighting.calculationRegion(), [&](Vec2I const& pos, typename TileSectorArray::Tile const* column, size_t ySize) {
+    tileSectorArray->tileEachColumns(lighting.calculationRegion(), [&](Vec2I const& pos, typename TileSectorArray::Tile const* column, size_t ySize) {
         for (size_t y = 0; y < ySize; ++y) {
           auto& tile = column[y];
           auto& cell = lightingCellColumn[y];
@@ -501,6 +498,19 @@ namespace WorldImpl {
           lighting.addPointLight(position, light.color.sum() / 3.0f, light.pointBeam, light.beamAngle, light.beamAmbience);
       }
     }
+  }
+
+  template <typename TileSectorArray>
+  float lightLevel(shared_ptr<TileSectorArray> const& tileSectorArray, EntityMapPtr const& entityMap, WorldGeometry const& worldGeometry,
+      WorldTemplateConstPtr const& worldTemplate, SkyConstPtr const& sky, CellularLightIntensityCalculator& lighting, Vec2F pos) {
+    if (pos[1] < 0 || pos[1] >= worldGeometry.height())
+      return 0;
+
+    // tileEach can't handle rects that are WAY out of range.
+    pos = worldGeometry.xwrap(pos);
+
+    lighting.begin(pos);
+    setLightIntensityInputs(tileSectorArray, entityMap, worldGeometry, worldTemplate, sky, lighting);
 
     return lighting.calculate();
   }
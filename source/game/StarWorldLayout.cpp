@@ -350,6 +350,21 @@ WorldLayout::WorldLayout(Json const& store) : WorldLayout() {
   m_playerStartSearchRegions = store.getArray("playerStartSearchRegions").transformed(jsonToRectI);
 }
 
+WorldLayout WorldLayout::clone() const {
+  WorldLayout layout = *this;
+  // A region may appear in more than one cell, keep them aliased in the copy
+  HashMap<WorldRegion const*, WorldRegionPtr> regionCopies;
+  for (auto& layer : layout.m_layers) {
+    for (auto& cell : layer.cells) {
+      auto& copy = regionCopies[cell.get()];
+      if (!copy)
+        copy = make_shared<WorldRegion>(*cell);
+      cell = copy;
+    }
+  }
+  return layout;
+}
+
 Json WorldLayout::toJson() const {
   auto terrainDatabase = Root::singleton().terrainDatabase();
 
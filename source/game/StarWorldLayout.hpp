@@ -85,6 +85,11 @@ public:
 
   Json toJson() const;
 
+  // Copies the layout with its own copy of every region, so that the copy can
+  // be changed without changing this layout.  Biomes and terrain selectors
+  // are immutable and stay shared.
+  WorldLayout clone() const;
+
   Maybe<BlockNoise> const& blockNoise() const;
   Maybe<PerlinF> const& blendNoise() const;
 
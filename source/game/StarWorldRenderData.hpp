@@ -26,8 +26,13 @@ struct WorldRenderData {
 
   Vec2I tileMinPosition;
   RenderTileArray tiles;
+  // Returns a revision of the tiles in a world region that changes whenever
+  // any of them may have, or 0 if that is not known.
+  function<uint64_t(RectI const&)> tileRevision;
   Vec2I lightMinPosition;
   Lightmap lightMap;
+  // Set instead of the lightMap when the renderer calculates it
+  CellularLightingInput lightingInput;
 
   List<EntityDrawables> entityDrawables;
   List<Particle> const* particles;
@@ -49,6 +54,7 @@ struct WorldRenderData {
 
 inline void WorldRenderData::clear() {
   tiles.resize({0, 0}); // keep reserved
+  tileRevision = {};
 
   entityDrawables.clear();
   particles = nullptr;
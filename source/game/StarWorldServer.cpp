@@ -2,6 +2,7 @@
 #include "StarLogging.hpp"
 #include "StarIterator.hpp"
 #include "StarDataStreamExtra.hpp"
+#include "StarArena.hpp"
 #include "StarBiome.hpp"
 #include "StarWireProcessor.hpp"
 #include "StarWireEntity.hpp"
@@ -24,9 +25,22 @@
 #include "StarWarpTargetEntity.hpp"
 #include "StarUniverseSettings.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
+#include "StarLuaScriptProfiler.hpp"
+#include "StarTraceProfiler.hpp"
+#include "StarMetrics.hpp"
 
 namespace Star {
 
+// Set on entity update worker threads while they update entities with an
+// independent update.  World mutations made from those threads are queued and
+// applied on the world thread once every entity has been updated.
+static thread_local bool s_deferWorldActions = false;
+
+// Numbers the entity update snapshots of clients that acknowledge them.  It is
+// shared by every world, so a client's snapshot numbers only ever increase.
+static atomic<uint64_t> s_nextEntitySnapshot{1};
+static size_t const MaxPendingEntitySnapshots = 256;
+
 EnumMap<WorldServerFidelity> const WorldServerFidelityNames{
   {WorldServerFidelity::Minimum, "minimum"},
   {WorldServerFidelity::Low, "low"},
@@ -83,6 +97,7 @@ WorldServer::~WorldServer() {
 
 void WorldServer::setWorldId(String worldId) {
   m_worldId = std::move(worldId);
+  registerLogValues();
 }
 
 String const& WorldServer::worldId() const {
@@ -223,7 +238,8 @@ bool WorldServer::spawnTargetValid(SpawnTarget const& spawnTarget) const {
   return true;
 }
 
-bool WorldServer::addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin, NetCompatibilityRules netRules) {
+bool WorldServer::addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin,
+    NetCompatibilityRules netRules, bool acknowledgedEntityUpdates) {
   if (m_clientInfo.contains(clientId))
     return false;
 
@@ -261,6 +277,10 @@ bool WorldServer::addClient(ConnectionId clientId, SpawnTarget const& spawnTarge
   clientInfo->local = isLocal;
   clientInfo->admin = isAdmin;
   clientInfo->clientState.setNetCompatibilityRules(netRules);
+  // Snapshot numbers are shared by every world, so that snapshots from the
+  // world a client was in before are all older than the first one here.
+  if (acknowledgedEntityUpdates && netRules.version() >= 18)
+    clientInfo->firstEntitySnapshot = s_nextEntitySnapshot.load();
 
   auto worldStartPacket = make_shared<WorldStartPacket>();
   auto& templateData = worldStartPacket->templateData = m_worldTemplate->store();
@@ -280,6 +300,7 @@ bool WorldServer::addClient(ConnectionId clientId, SpawnTarget const& spawnTarge
   worldStartPacket->protectedDungeonIds = m_protectedDungeonIds;
   worldStartPacket->clientId = clientId;
   worldStartPacket->localInterpolationMode = isLocal;
+  worldStartPacket->firstEntitySnapshot = clientInfo->firstEntitySnapshot;
   clientInfo->outgoingPackets.append(worldStartPacket);
 
   clientInfo->outgoingPackets.append(make_shared<CentralStructureUpdatePacket>(m_centralStructure.store()));
@@ -359,7 +380,7 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
   auto entityFactory = root.entityFactory();
   auto itemDatabase = root.itemDatabase();
 
-  for (auto const& packet : packets) {
+  for (auto const& packet : EntityMessageBatchPacket::unbatchPackets(packets)) {
     if (auto worldStartAcknowledge = as<WorldStartAcknowledgePacket>(packet)) {
       clientInfo->started = true;
 
@@ -369,6 +390,8 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
 
     } else if (auto heartbeat = as<StepUpdatePacket>(packet)) {
       clientInfo->interpolationTracker.receiveTimeUpdate(heartbeat->remoteTime);
+      if (!heartbeat->acknowledgedSnapshots.empty())
+        acknowledgeEntitySnapshots(*clientInfo, heartbeat->acknowledgedSnapshots);
 
     } else if (auto wcsPacket = as<WorldClientStateUpdatePacket>(packet)) {
       clientInfo->clientState.readDelta(wcsPacket->worldClientStateDelta);
@@ -469,7 +492,7 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
           EntityId entityId = entity->entityId();
           if (connectionForEntity(entityId) == clientId) {
             starAssert(entity->isSlave());
-            entity->readNetState(entityUpdateSet->deltas.value(entityId), interpolationLeadTime, clientInfo->clientState.netCompatibilityRules());
+            entity->readNetState(entityUpdateSet->delta(entityId), interpolationLeadTime, clientInfo->clientState.netCompatibilityRules());
           }
         });
       clientInfo->pendingForward = true;
@@ -573,7 +596,10 @@ void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> c
 
 List<PacketPtr> WorldServer::getOutgoingPackets(ConnectionId clientId) {
   auto const& clientInfo = m_clientInfo.get(clientId);
-  return std::move(clientInfo->outgoingPackets);
+  auto packets = take(clientInfo->outgoingPackets);
+  if (clientInfo->clientState.netCompatibilityRules().version() >= 16)
+    EntityMessageBatchPacket::batchPackets(packets);
+  return packets;
 }
 
 bool WorldServer::sendPacket(ConnectionId clientId, PacketPtr const& packet) {
@@ -621,12 +647,14 @@ float WorldServer::expiryTime() {
 }
 
 void WorldServer::update(float dt) {
+  STAR_PROFILE_SCOPE("WorldServer::update");
   m_currentTime += dt;
   ++m_currentStep;
+  double stageStart = Time::monotonicTime();
   for (auto const& pair : m_clientInfo)
     pair.second->interpolationTracker.update(m_currentTime);
 
-  List<WorldAction> triggeredActions;
+  ArenaList<WorldAction> triggeredActions;
   eraseWhere(m_timers, [&triggeredActions, dt](pair<float, WorldAction>& timer) {
       if ((timer.first -= dt) <= 0) {
         triggeredActions.append(timer.second);
@@ -639,12 +667,19 @@ void WorldServer::update(float dt) {
 
   m_spawner.update(dt);
 
+  // Regenerated up front so that entities updating in parallel find their
+  // collision fresh rather than taking turns freshening it.
+  freshenDirtyCollision();
+
   bool doBreakChecks = m_tileEntityBreakCheckTimer.wrapTick(m_currentTime) && m_needsGlobalBreakCheck;
   if (doBreakChecks)
     m_needsGlobalBreakCheck = false;
 
   List<EntityId> toRemove;
-  m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
+  Mutex toRemoveMutex;
+  auto updateEntity = [&](EntityPtr const& entity) {
+      LuaScriptProfiler::CategoryScope profileScope(EntityTypeNames.getRight(entity->entityType()));
+      m_updatingEntity.store(entity->entityId(), std::memory_order_relaxed);
       entity->update(dt, m_currentStep);
 
       if (auto tileEntity = as<TileEntity>(entity)) {
@@ -656,21 +691,50 @@ void WorldServer::update(float dt) {
         updateTileEntityTiles(tileEntity);
       }
 
-      if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master)
+      if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master) {
+        MutexLocker locker(toRemoveMutex);
         toRemove.append(entity->entityId());
-    }, [](EntityPtr const& a, EntityPtr const& b) {
+      }
+    };
+  auto entityTypeOrder = [](EntityPtr const& a, EntityPtr const& b) {
       return a->entityType() < b->entityType();
-    });
+    };
+
+  if (m_entityUpdateWorkerPool) {
+    m_entityMap->updateAllEntitiesParallel(*m_entityUpdateWorkerPool, [](EntityPtr const& entity) {
+        return entity->entityMode() == EntityMode::Master && entity->independentUpdate();
+      }, [&](EntityPtr const& entity) {
+        s_deferWorldActions = true;
+        auto guard = finally([]() { s_deferWorldActions = false; });
+        updateEntity(entity);
+      }, updateEntity, entityTypeOrder);
+
+    for (auto const& action : take(m_deferredWorldActions))
+      action(this);
+  } else {
+    m_entityMap->updateAllEntities(updateEntity, entityTypeOrder);
+  }
+
+  m_updatingEntity.store(NullEntityId, std::memory_order_relaxed);
+
+  updateDamage(dt);
+  finishUpdateStage("entities", stageStart);
 
   for (auto& pair : m_scriptContexts)
     pair.second->update(pair.second->updateDt(dt));
+  finishUpdateStage("scripts", stageStart);
 
-  updateDamage(dt);
-  if (shouldRunThisStep("wiringUpdate"))
+  if (auto delta = shouldRunThisStep("wiringUpdate")) {
     m_wireProcessor->process();
+    finishUpdateStage("wiringUpdate", stageStart, *delta);
+  }
 
   m_sky->update(dt);
 
+  eraseWhere(m_lightLevelCache, [this](auto const& p) {
+      return m_currentTime - p.second.calculatedTime > m_lightLevelCacheTime;
+    });
+
   List<RectI> clientWindows;
   List<RectI> clientMonitoringRegions;
   for (auto const& pair : m_clientInfo) {
@@ -683,24 +747,37 @@ void WorldServer::update(float dt) {
   m_weather.update(dt);
   for (auto projectile : m_weather.pullNewProjectiles())
     addEntity(std::move(projectile));
+  finishUpdateStage("environment", stageStart);
 
-  if (shouldRunThisStep("liquidUpdate")) {
+  if (auto delta = shouldRunThisStep("liquidUpdate")) {
     m_liquidEngine->setProcessingLimit(m_fidelityConfig.optUInt("liquidEngineBackgroundProcessingLimit"));
     m_liquidEngine->setNoProcessingLimitRegions(clientMonitoringRegions);
     m_liquidEngine->update();
+    finishUpdateStage("liquidUpdate", stageStart, *delta);
   }
 
-  if (shouldRunThisStep("fallingBlocksUpdate"))
+  if (auto delta = shouldRunThisStep("fallingBlocksUpdate")) {
     m_fallingBlocksAgent->update();
+    finishUpdateStage("fallingBlocksUpdate", stageStart, *delta);
+  }
 
-  if (auto delta = shouldRunThisStep("blockDamageUpdate"))
+  if (auto delta = shouldRunThisStep("blockDamageUpdate")) {
     updateDamagedBlocks(*delta * dt);
+    finishUpdateStage("blockDamageUpdate", stageStart, *delta);
+  }
 
-  if (auto delta = shouldRunThisStep("worldStorageTick"))
+  if (auto delta = shouldRunThisStep("worldStorageTick")) {
     m_worldStorage->tick(*delta * GlobalTimestep, &m_worldId);
+    finishUpdateStage("worldStorageTick", stageStart, *delta);
+  }
 
   if (auto delta = shouldRunThisStep("worldStorageGenerate")) {
     m_worldStorage->generateQueue(m_fidelityConfig.optUInt("worldStorageGenerationLevelLimit"), [this](WorldStorage::Sector a, WorldStorage::Sector b) {
+        bool aPredicted = m_predictedSectors.contains(a);
+        bool bPredicted = m_predictedSectors.contains(b);
+        if (aPredicted != bPredicted)
+          return bPredicted;
+
         auto distanceToClosestPlayer = [this](WorldStorage::Sector sector) {
           Vec2F sectorCenter = RectF(*m_worldStorage->regionForSector(sector)).center();
           float distance = highest<float>();
@@ -713,28 +790,79 @@ void WorldServer::update(float dt) {
 
         return distanceToClosestPlayer(a) < distanceToClosestPlayer(b);
       });
+    finishUpdateStage("worldStorageGenerate", stageStart, *delta);
   }
 
   for (EntityId entityId : toRemove)
     removeEntity(entityId, true);
 
   bool sendRemoteUpdates = m_entityUpdateTimer.wrapTick(dt);
+  if (sendRemoteUpdates)
+    ++m_entityUpdateCount;
+  bool predictSectors = m_serverConfig.getFloat("playerPredictiveRegionTime", 0.0f) > 0.0f;
+  m_predictedSectors.clear();
+  HashSet<WorldStorage::Sector> signalledSectors;
   for (auto const& pair : m_clientInfo) {
-    for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap))
-      signalRegion(monitoredRegion.padded(jsonToVec2I(m_serverConfig.get("playerActiveRegionPad"))));
+    for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap)) {
+      RectI activeRegion = monitoredRegion.padded(jsonToVec2I(m_serverConfig.get("playerActiveRegionPad")));
+      signalRegion(activeRegion);
+      if (predictSectors)
+        signalledSectors.addAll(m_worldStorage->sectorsForRegion(activeRegion));
+    }
+    if (predictSectors)
+      queuePredictedSectors(*pair.second, signalledSectors);
     queueUpdatePackets(pair.first, sendRemoteUpdates);
   }
+  // Another client may have since signalled a sector predicted for an earlier one
+  if (!m_predictedSectors.empty())
+    m_predictedSectors = m_predictedSectors.difference(signalledSectors);
   m_netStateCache.clear();
 
+  m_netStateCacheLog.set(m_netStateCacheHits, m_netStateCacheMisses);
+  m_netStateCacheHits = 0;
+  m_netStateCacheMisses = 0;
+
+  m_updateStages.clear();
+  m_updateStageBudgets.clear();
+  for (auto const& pair : m_serverConfig.getObject("updateStageBudgets", JsonObject()))
+    m_updateStageBudgets[pair.first] = pair.second.toDouble();
+  m_updateStageMaxDeferral = max<unsigned>(m_serverConfig.getUInt("updateStageMaxDeferral", 8), 1);
+
   for (auto& pair : m_clientInfo)
     pair.second->pendingForward = false;
+  finishUpdateStage("packets", stageStart);
 
   m_expiryTimer.tick(dt);
 
-  LogMap::set(strf("server_{}_entities", m_worldId), strf("{} in {} sectors", m_entityMap->size(), m_tileArray->loadedSectorCount()));
-  LogMap::set(strf("server_{}_time", m_worldId), strf("age = {:4.2f}, day = {:4.2f}/{:4.2f}s", epochTime(), timeOfDay(), dayLength()));
-  LogMap::set(strf("server_{}_active_liquid", m_worldId), m_liquidEngine->activeCells());
-  LogMap::set(strf("server_{}_lua_mem", m_worldId), m_luaRoot->luaMemoryUsage());
+  m_entitiesLog.set(m_entityMap->size(), m_tileArray->loadedSectorCount());
+  m_timeLog.set(epochTime(), timeOfDay(), dayLength());
+  m_activeLiquidLog.set(m_liquidEngine->activeCells());
+  m_luaMemoryLog.set(m_luaRoot->luaMemoryUsage());
+
+  Metrics::Labels metricLabels = {{"world", m_worldId}};
+  Metrics::setGauge("starbound_world_clients", metricLabels, m_clientInfo.size());
+  Metrics::setGauge("starbound_world_entities", metricLabels, m_entityMap->size());
+  Metrics::setGauge("starbound_world_sectors", metricLabels, m_tileArray->loadedSectorCount());
+  Metrics::setGauge("starbound_world_active_liquid_cells", metricLabels, m_liquidEngine->activeCells());
+  Metrics::setGauge("starbound_world_lua_memory_bytes", metricLabels, m_luaRoot->luaMemoryUsage());
+  for (size_t i = 0; i < EntityTypeCount; ++i) {
+    auto const& cost = m_entityNetCosts[i];
+    if (cost.updates == 0 && cost.creates == 0)
+      continue;
+    Metrics::Labels typeLabels = {{"world", m_worldId}, {"entity_type", EntityTypeNames.getRight((EntityType)i)}};
+    Metrics::setCounter("starbound_world_entity_update_bytes_total", typeLabels, cost.updateBytes);
+    Metrics::setCounter("starbound_world_entity_create_bytes_total", typeLabels, cost.createBytes);
+  }
+
+  String stageTimes;
+  for (auto const& pair : m_updateStages) {
+    if (!stageTimes.empty())
+      stageTimes += ", ";
+    stageTimes += strf("{} {:4.2f}ms", pair.first, pair.second.averageCost * 1000.0);
+    if (pair.second.deferral > 1)
+      stageTimes += strf(" (x{})", pair.second.deferral);
+  }
+  LogMap::set(strf("server_{}_stages", m_worldId), stageTimes);
 }
 
 WorldGeometry WorldServer::geometry() const {
@@ -776,6 +904,14 @@ void WorldServer::addEntity(EntityPtr const& entity, EntityId entityId) {
   if (!entity)
     return;
 
+  if (s_deferWorldActions) {
+    MutexLocker locker(m_deferredWorldActionsMutex);
+    m_deferredWorldActions.append([entity, entityId](World* world) {
+        world->addEntity(entity, entityId);
+      });
+    return;
+  }
+
   entity->init(this, m_entityMap->reserveEntityId(entityId), EntityMode::Master);
   m_entityMap->addEntity(entity);
 
@@ -825,6 +961,9 @@ CollisionKind WorldServer::tileCollisionKind(Vec2I const& pos) const {
 
 
 void WorldServer::forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
+  // Freshening collision lazily writes to the tile array, so concurrent
+  // independent entity updates must take turns.
+  MutexLocker locker(m_parallelReadMutex, s_deferWorldActions);
   const_cast<WorldServer*>(this)->freshenCollision(region);
   m_tileArray->tileEach(region, [iterator](Vec2I const& pos, ServerTile const& tile) {
       if (tile.getCollision() == CollisionKind::Null) {
@@ -837,6 +976,13 @@ void WorldServer::forEachCollisionBlock(RectI const& region, function<void(Colli
     });
 }
 
+uint64_t WorldServer::collisionGeneration(RectI const& region) const {
+  uint64_t generation = 0;
+  for (auto const& sector : m_tileArray->validSectorsFor(region))
+    generation = max(generation, m_sectorCollisionGenerations.value(sector, 0));
+  return generation;
+}
+
 bool WorldServer::isTileConnectable(Vec2I const& pos, TileLayer layer, bool tilesOnly) const {
   return m_tileArray->tile(pos).isConnectable(layer, tilesOnly);
 }
@@ -998,31 +1144,69 @@ TileDamageResult WorldServer::damageTiles(List<Vec2I> const& positions, TileLaye
   for (auto const& pos : positions)
     positionSet.add(m_geometry.xwrap(pos));
 
+  // Explosions and area tools damage hundreds of tiles at once, so positions
+  // are grouped by sector to find the clients watching each sector once, and
+  // protection and tile entity lookups are shared across the whole batch.
+  Map<ServerTileSectorArray::Sector, List<Vec2I>> sectorPositions;
+  for (auto const& pos : positionSet)
+    sectorPositions[m_tileArray->sectorFor(pos)].append(pos);
+
+  HashMap<DungeonId, bool> dungeonProtection;
+  auto dungeonProtected = [&](DungeonId dungeonId) {
+    if (!m_tileProtectionEnabled)
+      return false;
+    if (auto isProtected = dungeonProtection.ptr(dungeonId))
+      return *isProtected;
+    return dungeonProtection[dungeonId] = m_protectedDungeonIds.contains(dungeonId);
+  };
+
+  HashMap<Vec2I, List<TileEntityPtr>> tileEntities;
+  auto entitiesAtTile = [&](Vec2I const& pos) -> List<TileEntityPtr> const& {
+    if (auto entities = tileEntities.ptr(pos))
+      return *entities;
+    return tileEntities[pos] = m_entityMap->entitiesAtTile(pos);
+  };
+
   Set<EntityPtr> damagedEntities;
   auto res = TileDamageResult::None;
 
-  for (auto const& pos : positionSet) {
-    if (auto tile = m_tileArray->modifyTile(pos)) {
+  List<ClientInfo*> watchingClients;
+  for (auto const& sectorPair : sectorPositions) {
+    watchingClients.clear();
+    for (auto const& pair : m_clientInfo) {
+      if (pair.second->activeSectors.contains(sectorPair.first))
+        watchingClients.append(pair.second.get());
+    }
+    auto queueDamageUpdate = [&](Vec2I const& pos, TileLayer layer) {
+      for (auto clientInfo : watchingClients)
+        clientInfo->pendingTileDamageUpdates.add({pos, layer});
+    };
+
+    for (auto const& pos : sectorPair.second) {
+      auto tile = m_tileArray->modifyTile(pos);
+      if (!tile)
+        continue;
+
       auto tileDamage = damage;
-      if (isTileProtected(pos))
+      if (dungeonProtected(tile->dungeonId))
         tileDamage.type = TileDamageType::Protected;
 
       auto tileRes = TileDamageResult::None;
       if (layer == TileLayer::Foreground) {
-        Vec2I entityDamagePos = pos;
-        Set<Vec2I> damagePositionSet = Set<Vec2I>(positionSet);
-        if (tile->rootSource) {
-          entityDamagePos = tile->rootSource.value();
-          damagePositionSet.add(entityDamagePos);
-        }
+        Vec2I entityDamagePos = tile->rootSource.value(pos);
 
-        for (auto entity : m_entityMap->entitiesAtTile(entityDamagePos)) {
+        for (auto const& entity : entitiesAtTile(entityDamagePos)) {
           if (!damagedEntities.contains(entity)) {
-            Set<Vec2I> entitySpacesSet;
-            for (auto const& space : entity->spaces())
-              entitySpacesSet.add(m_geometry.xwrap(entity->tilePosition() + space));
+            // The entity's spaces being damaged, including its root if this
+            // tile is only a part of it
+            Set<Vec2I> entityDamageSpaces;
+            for (auto const& space : entity->spaces()) {
+              Vec2I entitySpace = m_geometry.xwrap(entity->tilePosition() + space);
+              if (entitySpace == entityDamagePos || positionSet.contains(entitySpace))
+                entityDamageSpaces.add(entitySpace);
+            }
 
-            bool broken = entity->damageTiles(entitySpacesSet.intersection(damagePositionSet).values(), sourcePosition, tileDamage);
+            bool broken = entity->damageTiles(entityDamageSpaces.values(), sourcePosition, tileDamage);
             if (sourceEntity.isValid() && broken) {
               Maybe<String> name;
               if (auto object = as<Object>(entity))
@@ -1064,7 +1248,7 @@ TileDamageResult WorldServer::damageTiles(List<Vec2I> const& positions, TileLaye
                 });
             }
 
-            queueTileDamageUpdates(pos, TileLayer::Foreground);
+            queueDamageUpdate(pos, TileLayer::Foreground);
             m_damagedBlocks.add(pos);
 
             if (tileDamage.type == TileDamageType::Protected)
@@ -1074,19 +1258,19 @@ TileDamageResult WorldServer::damageTiles(List<Vec2I> const& positions, TileLaye
           }
         } else if (layer == TileLayer::Background && isRealMaterial(tile->background)) {
           tile->backgroundDamage.damage(damageParameters, sourcePosition, tileDamage);
-          
+
           // if the tile is broken, send a message back to the source entity with position and whether the tile was harvested
-            if (sourceEntity.isValid() && tile->backgroundDamage.dead()) {
-              sendEntityMessage(*sourceEntity, "tileBroken", {
-                  jsonFromVec2I(pos),
-                  TileLayerNames.getRight(TileLayer::Background),
-                  tile->background,
-                  tile->dungeonId,
-                  tile->backgroundDamage.harvested(),
-                });
-            }
+          if (sourceEntity.isValid() && tile->backgroundDamage.dead()) {
+            sendEntityMessage(*sourceEntity, "tileBroken", {
+                jsonFromVec2I(pos),
+                TileLayerNames.getRight(TileLayer::Background),
+                tile->background,
+                tile->dungeonId,
+                tile->backgroundDamage.harvested(),
+              });
+          }
 
-          queueTileDamageUpdates(pos, TileLayer::Background);
+          queueDamageUpdate(pos, TileLayer::Background);
           m_damagedBlocks.add(pos);
 
           if (tileDamage.type == TileDamageType::Protected)
@@ -1235,7 +1419,7 @@ bool WorldServer::pregenerateExpandBiome(Vec2I const& position, int newWidth) {
 }
 
 void WorldServer::setLayerEnvironmentBiome(Vec2I const& position) {
-  auto biomeName = m_worldTemplate->worldLayout()->setLayerEnvironmentBiome(position);
+  auto biomeName = m_worldTemplate->setLayerEnvironmentBiome(position);
 
   auto layoutJson = m_worldTemplate->worldLayout()->toJson();
   for (auto const& pair : m_clientInfo)
@@ -1392,6 +1576,14 @@ bool WorldServer::isFloatingDungeonWorld() const {
       && m_worldTemplate->worldParameters()->type() == WorldParametersType::FloatingDungeonWorldParameters;
 }
 
+void WorldServer::registerLogValues() {
+  m_netStateCacheLog = LogMap::Value(strf("server_{}_net_state_cache", m_worldId), "{} hits, {} misses");
+  m_entitiesLog = LogMap::Value(strf("server_{}_entities", m_worldId), "{} in {} sectors");
+  m_timeLog = LogMap::Value(strf("server_{}_time", m_worldId), "age = {:4.2f}, day = {:4.2f}/{:4.2f}s");
+  m_activeLiquidLog = LogMap::Value(strf("server_{}_active_liquid", m_worldId));
+  m_luaMemoryLog = LogMap::Value(strf("server_{}_lua_mem", m_worldId));
+}
+
 void WorldServer::init(bool firstTime) {
   auto& root = Root::singleton();
   auto assets = root.assets();
@@ -1399,11 +1591,21 @@ void WorldServer::init(bool firstTime) {
 
   m_serverConfig = assets->json("/worldserver.config");
   setFidelity(WorldServerFidelity::Medium);
+  registerLogValues();
 
   m_worldStorage->setFloatingDungeonWorld(isFloatingDungeonWorld());
 
   m_currentTime = 0;
   m_currentStep = 0;
+  m_updatingEntity = NullEntityId;
+  m_entityNetCosts.fill(EntityNetCost());
+  m_entityNetCostsTaken.fill(EntityNetCost());
+  m_entityNetFieldBytes.clear();
+  m_entityNetStatsTime = Time::monotonicTime();
+  m_netFieldAccounting = false;
+  m_collisionGeneration = 0;
+  m_sectorCollisionGenerations.clear();
+  m_dirtyCollisionCells.clear();
   m_generatingDungeon = false;
   m_geometry = WorldGeometry(m_worldTemplate->size());
   m_entityMap = m_worldStorage->entityMap();
@@ -1411,13 +1613,22 @@ void WorldServer::init(bool firstTime) {
   m_tileGetterFunction = [&](Vec2I pos) -> ServerTile const& { return m_tileArray->tile(pos); };
   m_damageManager = make_shared<DamageManager>(this, ServerConnectionId);
   m_wireProcessor = make_shared<WireProcessor>(m_worldStorage);
+  if (auto wireEvaluationBudget = m_serverConfig.getUInt("wireEvaluationBudget", 0))
+    m_wireProcessor->setEvaluationBudget(wireEvaluationBudget);
   m_luaRoot = make_shared<LuaRoot>();
   m_luaRoot->luaEngine().setNullTerminated(false);
   m_luaRoot->tuneAutoGarbageCollection(m_serverConfig.getFloat("luaGcPause"), m_serverConfig.getFloat("luaGcStepMultiplier"));
+  auto gcSchedulerConfig = m_serverConfig.get("luaGcScheduler", JsonObject());
+  if (gcSchedulerConfig.getBool("enabled", false))
+    m_luaGcScheduler = make_shared<LuaGcScheduler>(m_luaRoot, gcSchedulerConfig);
+  else
+    m_luaGcScheduler.reset();
 
   m_sky = make_shared<Sky>(m_worldTemplate->skyParameters(), false);
 
   m_lightIntensityCalculator.setParameters(assets->json("/lighting.config:intensity"));
+  m_lightLevelCacheTime = m_serverConfig.getFloat("lightLevelCacheTime", 0.0f);
+  m_lightLevelCache.clear();
 
   m_entityMessageResponses = {};
 
@@ -1425,14 +1636,38 @@ void WorldServer::init(bool firstTime) {
       return m_tileArray->tile({x, y}).getCollision();
     });
 
+  m_netStateCacheHits = 0;
+  m_netStateCacheMisses = 0;
+
   m_entityUpdateTimer = GameTimer(m_serverConfig.query("interpolationSettings.normal").getFloat("entityUpdateDelta") / 60.f);
+  m_entityUpdateCount = 0;
+  auto relevanceConfig = m_serverConfig.get("entityUpdateRelevance", JsonObject());
+  m_entityUpdateIntervals.clear();
+  for (auto const& p : relevanceConfig.getArray("distanceIntervals", JsonArray()))
+    m_entityUpdateIntervals.append({p.getFloat(0), max<unsigned>(p.getUInt(1), 1)});
+  sortByComputedValue(m_entityUpdateIntervals, [](pair<float, unsigned> const& p) { return p.first; });
+  m_fullRateEntityTypes.clear();
+  for (auto const& type : relevanceConfig.getArray("fullRateEntityTypes", JsonArray()))
+    m_fullRateEntityTypes.add(EntityTypeNames.getLeft(type.toString()));
   m_tileEntityBreakCheckTimer = GameTimer(m_serverConfig.getFloat("tileEntityBreakCheckInterval"));
 
   m_liquidEngine = make_shared<LiquidCellEngine<LiquidId>>(liquidsDatabase->liquidEngineParameters(), make_shared<LiquidWorld>(this));
   for (auto liquidSettings : liquidsDatabase->allLiquidSettings())
     m_liquidEngine->setLiquidTickDelta(liquidSettings->id, liquidSettings->tickDelta);
+  m_liquidEngine->setThreadCount(m_serverConfig.getUInt("liquidEngineThreads", 0));
 
   m_fallingBlocksAgent = make_shared<FallingBlocksAgent>(make_shared<FallingBlocksWorld>(this));
+  if (auto fallingBlocksBudget = m_serverConfig.getUInt("fallingBlocksProcessingBudget", 0))
+    m_fallingBlocksAgent->setProcessingBudget(fallingBlocksBudget);
+
+  if (m_serverConfig.getBool("parallelEntityUpdate", false)) {
+    unsigned threadCount = m_serverConfig.getUInt("parallelEntityUpdateThreads", 0);
+    if (threadCount == 0)
+      threadCount = max<unsigned>(std::thread::hardware_concurrency(), 2) - 1;
+    m_entityUpdateWorkerPool = make_unique<WorkerPool>(strf("WorldServer({})::entityUpdate", m_worldId), threadCount);
+  } else {
+    m_entityUpdateWorkerPool.reset();
+  }
 
   setupForceRegions();
 
@@ -1502,11 +1737,38 @@ void WorldServer::init(bool firstTime) {
 
 Maybe<unsigned> WorldServer::shouldRunThisStep(String const& timingConfiguration) {
   Vec2U timing = jsonToVec2U(m_fidelityConfig.get(timingConfiguration));
+  if (auto stage = m_updateStages.ptr(timingConfiguration))
+    timing[0] *= stage->deferral;
   if ((m_currentStep + timing[1]) % timing[0] == 0)
     return timing[0];
   return {};
 }
 
+void WorldServer::finishUpdateStage(char const* stage, double& stageStart, unsigned ticks) {
+  double now = Time::monotonicTime();
+  TraceProfiler::record(stage, stageStart, now);
+  double cost = (now - stageStart) / max(ticks, 1u);
+  stageStart = now;
+
+  auto& updateStage = m_updateStages.insert(stage, UpdateStage{cost, 1}).first->second;
+  updateStage.averageCost = updateStage.averageCost * 0.9 + cost * 0.1;
+
+  auto budget = m_updateStageBudgets.maybe(stage);
+  if (!budget)
+    return;
+
+  // Deferring a stage spreads the same work over more ticks, so the expected
+  // cost per tick is scaled along with the deferral to avoid overshooting.
+  double budgetSeconds = *budget / 1000.0;
+  if (updateStage.averageCost > budgetSeconds && updateStage.deferral < m_updateStageMaxDeferral) {
+    updateStage.deferral *= 2;
+    updateStage.averageCost /= 2;
+  } else if (updateStage.averageCost * 2 < budgetSeconds && updateStage.deferral > 1) {
+    updateStage.deferral /= 2;
+    updateStage.averageCost *= 2;
+  }
+}
+
 TileModificationList WorldServer::doApplyTileModifications(TileModificationList const& modificationList, bool allowEntityOverlap, bool ignoreTileProtection, bool updateNeighbors) {
   auto materialDatabase = Root::singleton().materialDatabase();
 
@@ -1747,6 +2009,30 @@ ConnectionId WorldServer::connection() const {
   return ServerConnectionId;
 }
 
+void WorldServer::queuePredictedSectors(ClientInfo const& clientInfo, HashSet<WorldStorage::Sector> const& signalledSectors) {
+  if (m_generatingDungeon)
+    return;
+
+  auto player = get<Player>(clientInfo.clientState.playerId());
+  if (!player)
+    return;
+
+  // Only bother when the player would move at least a sector in the lookahead
+  // time, slower players are already covered by the active region padding.
+  Vec2F offset = player->velocity() * m_serverConfig.getFloat("playerPredictiveRegionTime");
+  if (vmagSquared(offset) < square<float>(WorldSectorSize))
+    return;
+
+  RectI window = clientInfo.clientState.window().padded(jsonToVec2I(m_serverConfig.get("playerActiveRegionPad")));
+  RectI predictedRegion = window.translated(Vec2I::round(offset)).combined(window);
+  for (auto const& sector : m_worldStorage->sectorsForRegion(predictedRegion)) {
+    if (signalledSectors.contains(sector) || m_worldStorage->sectorActive(sector))
+      continue;
+    m_worldStorage->queueSectorActivation(sector, false);
+    m_predictedSectors.add(sector);
+  }
+}
+
 bool WorldServer::signalRegion(RectI const& region) {
   auto sectors = m_worldStorage->sectorsForRegion(region);
   if (m_generatingDungeon) {
@@ -1760,6 +2046,7 @@ bool WorldServer::signalRegion(RectI const& region) {
       m_worldStorage->queueSectorActivation(sector);
   }
   for (auto const& sector : sectors) {
+    m_worldStorage->materializeSector(sector);
     if (!m_worldStorage->sectorActive(sector))
       return false;
   }
@@ -1767,7 +2054,9 @@ bool WorldServer::signalRegion(RectI const& region) {
 }
 
 void WorldServer::generateRegion(RectI const& region) {
-  for (auto sector : m_worldStorage->sectorsForRegion(region))
+  auto sectors = m_worldStorage->sectorsForRegion(region);
+  m_worldStorage->prefetchSectors(sectors);
+  for (auto sector : sectors)
     m_worldStorage->activateSector(sector);
 }
 
@@ -1930,6 +2219,7 @@ List<ItemDescriptor> WorldServer::destroyBlock(TileLayer layer, Vec2I const& pos
 }
 
 void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdates) {
+  STAR_PROFILE_SCOPE("WorldServer::queueUpdatePackets");
   auto const& clientInfo = m_clientInfo.get(clientId);
   clientInfo->outgoingPackets.append(make_shared<StepUpdatePacket>(m_currentTime));
 
@@ -1961,6 +2251,31 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdat
     clientInfo->pendingSectors.remove(sector);
   }
 
+  if (clientInfo->clientState.netCompatibilityRules().version() >= 15) {
+    // Newer clients receive all pending tile changes in a single packet
+    auto batch = make_shared<TileUpdateBatchPacket>();
+    for (auto const& run : TileUpdateBatchPacket::positionRuns(take(clientInfo->pendingTileUpdates).values())) {
+      auto& tileRun = batch->tiles.emplaceAppend(TileUpdateBatchPacket::Run<NetTile>{run.first, {}});
+      tileRun.values.resize(run.second);
+      for (size_t i = 0; i < run.second; ++i)
+        writeNetTile(run.first + Vec2I(i, 0), tileRun.values[i]);
+    }
+
+    for (auto const& run : TileUpdateBatchPacket::positionRuns(take(clientInfo->pendingLiquidUpdates).values())) {
+      auto& liquidRun = batch->liquids.emplaceAppend(TileUpdateBatchPacket::Run<LiquidNetUpdate>{run.first, {}});
+      for (size_t i = 0; i < run.second; ++i)
+        liquidRun.values.append(m_tileArray->tile(run.first + Vec2I(i, 0)).liquid.netUpdate());
+    }
+
+    for (auto const& pair : take(clientInfo->pendingTileDamageUpdates)) {
+      auto const& tile = m_tileArray->tile(pair.first);
+      batch->damage.append({pair.first, pair.second, pair.second == TileLayer::Foreground ? tile.foregroundDamage : tile.backgroundDamage});
+    }
+
+    if (!batch->tiles.empty() || !batch->liquids.empty() || !batch->damage.empty())
+      clientInfo->outgoingPackets.append(batch);
+  }
+
   for (auto pos : clientInfo->pendingTileUpdates) {
     auto tileUpdate = make_shared<TileUpdatePacket>();
     tileUpdate->position = pos;
@@ -1987,56 +2302,153 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdat
   }
   clientInfo->pendingLiquidUpdates.clear();
 
-  HashSet<EntityPtr> monitoredEntities;
-  for (auto const& monitoredRegion : clientInfo->monitoringRegions(m_entityMap))
-    monitoredEntities.addAll(m_entityMap->entityQuery(RectF(monitoredRegion)));
-
-  auto entityFactory = Root::singleton().entityFactory();
-  auto outOfMonitoredRegionsEntities = HashSet<EntityId>::from(clientInfo->clientSlavesNetVersion.keys());
-  for (auto const& monitoredEntity : monitoredEntities)
-    outOfMonitoredRegionsEntities.remove(monitoredEntity->entityId());
-  for (auto entityId : outOfMonitoredRegionsEntities) {
-    clientInfo->outgoingPackets.append(make_shared<EntityDestroyPacket>(entityId, ByteArray(), false));
-    clientInfo->clientSlavesNetVersion.remove(entityId);
-  }
-
   HashMap<ConnectionId, shared_ptr<EntityUpdateSetPacket>> updateSetPackets;
-  if (sendRemoteUpdates || clientInfo->local)
-    updateSetPackets.add(ServerConnectionId, make_shared<EntityUpdateSetPacket>(ServerConnectionId));
+  if (sendRemoteUpdates || clientInfo->local) {
+    auto updateSetPacket = make_shared<EntityUpdateSetPacket>(ServerConnectionId);
+    // Entities sharing an interval are spread over its updates by their id
+    updateSetPacket->updateCount = m_entityUpdateCount;
+    updateSetPackets.add(ServerConnectionId, std::move(updateSetPacket));
+  }
   for (auto const& p : m_clientInfo) {
     if (p.first != clientId && p.second->pendingForward)
       updateSetPackets.add(p.first, make_shared<EntityUpdateSetPacket>(p.first));
   }
 
-  for (auto const& monitoredEntity : monitoredEntities) {
-    EntityId entityId = monitoredEntity->entityId();
-    ConnectionId connectionId = connectionForEntity(entityId);
-    if (connectionId != clientId) {
-      auto netRules = clientInfo->clientState.netCompatibilityRules();
-      if (auto version = clientInfo->clientSlavesNetVersion.ptr(entityId)) {
-        if (auto updateSetPacket = updateSetPackets.value(connectionId)) {
-          auto pair = make_pair(entityId, *version);
-          auto& cache = m_netStateCache[netRules];
-          auto i = cache.find(pair);
-          if (i == cache.end())
-            i = cache.insert(pair, monitoredEntity->writeNetState(*version, netRules)).first;
-          const auto& netState = i->second;
-          if (!netState.first.empty())
-            updateSetPacket->deltas[entityId] = netState.first;
-          *version = netState.second;
+  // Rather than rebuilding the set of monitored entities every tick, every
+  // entity the client knows about is stamped with the last step it was seen in
+  // a monitoring region.  Unknown entities found in the regions are entering
+  // the client's interest, and known entities that were not stamped this step
+  // have left it.
+  auto entityFactory = Root::singleton().entityFactory();
+  auto netRules = clientInfo->clientState.netCompatibilityRules();
+  auto& netStateCache = m_netStateCache[netRules];
+  // Older clients cannot tell a deferred update from an entity that did not
+  // change, and local clients are sent every update.
+  bool relevanceScaling = !m_entityUpdateIntervals.empty() && !clientInfo->local && netRules.version() >= 19;
+  m_entityMap->forEachEntity(clientInfo->monitoringRegions(m_entityMap).transformed([](RectI const& region) { return RectF(region); }),
+      [&](EntityPtr const& monitoredEntity) {
+        EntityId entityId = monitoredEntity->entityId();
+        ConnectionId connectionId = connectionForEntity(entityId);
+        if (connectionId == clientId)
+          return;
+
+        if (auto slave = clientInfo->clientSlaves.ptr(entityId)) {
+          slave->monitoredStep = m_currentStep;
+          if (auto updateSetPacket = updateSetPackets.value(connectionId)) {
+            if (connectionId == ServerConnectionId && relevanceScaling) {
+              unsigned interval = entityUpdateInterval(*clientInfo, monitoredEntity);
+              if (interval > 1) {
+                updateSetPacket->updateIntervals[entityId] = interval;
+                if (updateSetPacket->deferred(entityId))
+                  return;
+              }
+            }
+
+            auto const& netState = cachedNetState(netStateCache, monitoredEntity, slave->netVersion, netRules);
+            if (clientInfo->firstEntitySnapshot != 0) {
+              if (!netState.delta->empty()) {
+                updateSetPacket->deltas[entityId] = netState.delta;
+                updateSetPacket->netVersions[entityId] = netState.version;
+              }
+            } else {
+              if (!netState.delta->empty())
+                updateSetPacket->deltas[entityId] = netState.delta;
+              slave->netVersion = netState.version;
+            }
+            if (!netState.delta->empty())
+              countEntityUpdate(monitoredEntity->entityType(), netState);
+          }
+        } else if (!monitoredEntity->masterOnly()) {
+          // Client was unaware of this entity until now
+          auto const& firstUpdate = cachedNetState(netStateCache, monitoredEntity, 0, netRules);
+          clientInfo->clientSlaves.add(entityId, {firstUpdate.version, m_currentStep});
+          auto storeData = entityFactory->netStoreEntity(monitoredEntity, netRules);
+          auto& cost = m_entityNetCosts[(size_t)monitoredEntity->entityType()];
+          ++cost.creates;
+          cost.createBytes += storeData.size() + firstUpdate.delta->size();
+          clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(monitoredEntity->entityType(),
+                std::move(storeData), *firstUpdate.delta, entityId, firstUpdate.version));
         }
-      } else if (!monitoredEntity->masterOnly()) {
-        // Client was unaware of this entity until now
-        auto firstUpdate = monitoredEntity->writeNetState(0, netRules);
-        clientInfo->clientSlavesNetVersion.add(entityId, firstUpdate.second);
-        clientInfo->outgoingPackets.append(make_shared<EntityCreatePacket>(monitoredEntity->entityType(),
-              entityFactory->netStoreEntity(monitoredEntity, netRules), std::move(firstUpdate.first), entityId));
-      }
+      });
+
+  eraseWhere(clientInfo->clientSlaves, [&](auto const& p) {
+      if (p.second.monitoredStep == m_currentStep)
+        return false;
+      clientInfo->outgoingPackets.append(make_shared<EntityDestroyPacket>(p.first, ByteArray(), false));
+      return true;
+    });
+
+  for (auto& p : updateSetPackets) {
+    if (clientInfo->firstEntitySnapshot != 0) {
+      p.second->snapshot = s_nextEntitySnapshot++;
+      if (!p.second->netVersions.empty())
+        clientInfo->pendingEntitySnapshots.append({p.second->snapshot, p.second->netVersions});
     }
+    clientInfo->outgoingPackets.append(std::move(p.second));
   }
 
-  for (auto& p : updateSetPackets)
-    clientInfo->outgoingPackets.append(std::move(p.second));
+  // A client that stops acknowledging only keeps getting deltas from older
+  // versions, so the oldest snapshots can be dropped.
+  while (clientInfo->pendingEntitySnapshots.size() > MaxPendingEntitySnapshots)
+    clientInfo->pendingEntitySnapshots.removeFirst();
+}
+
+unsigned WorldServer::entityUpdateInterval(ClientInfo const& clientInfo, EntityPtr const& entity) const {
+  if (m_fullRateEntityTypes.contains(entity->entityType()))
+    return 1;
+
+  float distance = vmag(m_geometry.diffToNearestCoordInBox(RectF(clientInfo.clientState.window()), entity->position()));
+  unsigned interval = 1;
+  for (auto const& p : m_entityUpdateIntervals) {
+    if (distance >= p.first)
+      interval = p.second;
+  }
+  return interval;
+}
+
+void WorldServer::acknowledgeEntitySnapshots(ClientInfo& clientInfo, List<uint64_t> const& snapshots) {
+  uint64_t lastAcknowledged = 0;
+  for (auto const& p : clientInfo.pendingEntitySnapshots) {
+    if (!snapshots.contains(p.first))
+      continue;
+    for (auto const& netVersion : p.second) {
+      if (auto slave = clientInfo.clientSlaves.ptr(netVersion.first))
+        slave->netVersion = max(slave->netVersion, netVersion.second);
+    }
+    lastAcknowledged = p.first;
+  }
+
+  // Unacknowledged snapshots older than an acknowledged one were lost, or
+  // arrived after it and were superseded.
+  while (!clientInfo.pendingEntitySnapshots.empty() && clientInfo.pendingEntitySnapshots.first().first <= lastAcknowledged)
+    clientInfo.pendingEntitySnapshots.removeFirst();
+}
+
+WorldServer::NetStateCacheEntry const& WorldServer::cachedNetState(NetStateCache& cache, EntityPtr const& entity, uint64_t fromVersion, NetCompatibilityRules rules) {
+  auto key = make_pair(entity->entityId(), fromVersion);
+  auto i = cache.find(key);
+  if (i != cache.end()) {
+    ++m_netStateCacheHits;
+    return i->second;
+  }
+
+  ++m_netStateCacheMisses;
+  List<size_t> fieldBytes;
+  if (m_netFieldAccounting)
+    NetElementGroup::setThreadFieldBytes(&fieldBytes);
+  auto netState = entity->writeNetState(fromVersion, rules);
+  NetElementGroup::setThreadFieldBytes(nullptr);
+  return cache.insert(key, {make_shared<ByteArray const>(std::move(netState.first)), netState.second, std::move(fieldBytes)}).first->second;
+}
+
+void WorldServer::countEntityUpdate(EntityType type, NetStateCacheEntry const& netState) {
+  auto& cost = m_entityNetCosts[(size_t)type];
+  ++cost.updates;
+  cost.updateBytes += netState.delta->size();
+  for (size_t field = 0; field < netState.fieldBytes.size(); ++field) {
+    if (netState.fieldBytes[field] != 0)
+      m_entityNetFieldBytes[{type, field}] += netState.fieldBytes[field];
+  }
 }
 
 void WorldServer::updateDamage(float dt) {
@@ -2061,6 +2473,53 @@ void WorldServer::updateDamage(float dt) {
   }
 }
 
+void WorldServer::collectLuaGarbage(double spareTime) {
+  if (!m_luaGcScheduler)
+    return;
+
+  m_luaGcScheduler->update(spareTime);
+  LogMap::set(strf("server_{}_lua_gc", m_worldId), m_luaGcScheduler->describe());
+}
+
+EntityId WorldServer::updatingEntity() const {
+  return m_updatingEntity.load(std::memory_order_relaxed);
+}
+
+void WorldServer::setNetFieldAccounting(bool enabled) {
+  m_netFieldAccounting = enabled;
+  if (!enabled)
+    m_entityNetFieldBytes.clear();
+}
+
+bool WorldServer::netFieldAccounting() const {
+  return m_netFieldAccounting;
+}
+
+auto WorldServer::takeEntityNetStats() -> EntityNetStats {
+  double now = Time::monotonicTime();
+  EntityNetStats stats;
+  stats.duration = now - m_entityNetStatsTime;
+  m_entityNetStatsTime = now;
+
+  for (size_t i = 0; i < EntityTypeCount; ++i) {
+    auto const& total = m_entityNetCosts[i];
+    auto& taken = m_entityNetCostsTaken[i];
+    EntityNetCost cost;
+    cost.updates = total.updates - taken.updates;
+    cost.updateBytes = total.updateBytes - taken.updateBytes;
+    cost.creates = total.creates - taken.creates;
+    cost.createBytes = total.createBytes - taken.createBytes;
+    if (cost.updates != 0 || cost.creates != 0)
+      stats.types[(EntityType)i] = cost;
+    taken = total;
+  }
+
+  for (auto& pair : take(m_entityNetFieldBytes))
+    stats.fieldBytes[pair.first] = pair.second;
+
+  return stats;
+}
+
 void WorldServer::sync() {
   writeMetadata();
   m_worldStorage->sync();
@@ -2078,6 +2537,9 @@ WorldChunks WorldServer::readChunks() {
 void WorldServer::updateDamagedBlocks(float dt) {
   auto materialDatabase = Root::singleton().materialDatabase();
 
+  // Neighbors of the blocks broken this tick are updated together after, so
+  // a tile entity resting on many of them is only checked once.
+  List<Vec2I> destroyedBlocks;
   for (auto pos : m_damagedBlocks.values()) {
     auto tile = m_tileArray->modifyTile(pos);
     if (!tile) {
@@ -2088,8 +2550,9 @@ void WorldServer::updateDamagedBlocks(float dt) {
     Vec2F dropPosition = centerOfTile(pos);
     if (tile->foregroundDamage.dead()) {
       bool harvested = tile->foregroundDamage.harvested();
-      for (auto drop : destroyBlock(TileLayer::Foreground, pos, harvested, !tileDamageIsPenetrating(tile->foregroundDamage.damageType())))
+      for (auto drop : destroyBlock(TileLayer::Foreground, pos, harvested, !tileDamageIsPenetrating(tile->foregroundDamage.damageType()), false))
         addEntity(ItemDrop::createRandomizedDrop(drop, dropPosition));
+      destroyedBlocks.append(pos);
 
     } else if (tile->foregroundDamage.damaged()) {
       if (isRealMaterial(tile->foreground)) {
@@ -2110,8 +2573,10 @@ void WorldServer::updateDamagedBlocks(float dt) {
 
     if (tile->backgroundDamage.dead()) {
       bool harvested = tile->backgroundDamage.harvested();
-      for (auto drop : destroyBlock(TileLayer::Background, pos, harvested, !tileDamageIsPenetrating(tile->backgroundDamage.damageType())))
+      for (auto drop : destroyBlock(TileLayer::Background, pos, harvested, !tileDamageIsPenetrating(tile->backgroundDamage.damageType()), false))
         addEntity(ItemDrop::createRandomizedDrop(drop, dropPosition));
+      if (destroyedBlocks.empty() || destroyedBlocks.last() != pos)
+        destroyedBlocks.append(pos);
 
     } else if (tile->backgroundDamage.damaged()) {
       if (isRealMaterial(tile->background)) {
@@ -2135,6 +2600,19 @@ void WorldServer::updateDamagedBlocks(float dt) {
     if (tile->backgroundDamage.healthy() && tile->foregroundDamage.healthy())
       m_damagedBlocks.remove(pos);
   }
+
+  HashSet<EntityId> checkedEntities;
+  List<TileEntityPtr> tileEntities;
+  for (auto const& pos : destroyedBlocks) {
+    for (auto const& tileEntity : m_entityMap->query<TileEntity>(RectF::withSize(Vec2F(pos), Vec2F(1, 1)))) {
+      if (checkedEntities.add(tileEntity->entityId()))
+        tileEntities.append(tileEntity);
+    }
+    m_liquidEngine->visitLocation(pos);
+    m_fallingBlocksAgent->visitLocation(pos);
+  }
+  for (auto const& tileEntity : tileEntities)
+    tileEntity->checkBroken();
 }
 
 void WorldServer::checkEntityBreaks(RectF const& rect) {
@@ -2143,12 +2621,40 @@ void WorldServer::checkEntityBreaks(RectF const& rect) {
 }
 
 void WorldServer::queueTileUpdates(Vec2I const& pos) {
+  dirtyLightLevels(pos);
+  m_spawner.tilesModified(pos);
+
   for (auto const& pair : m_clientInfo) {
     if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
       pair.second->pendingTileUpdates.add(pos);
   }
 }
 
+float WorldServer::cachedCellLightLevel(Vec2I const& pos) const {
+  auto sector = m_tileArray->sectorFor(pos);
+  RectI sectorRegion = m_tileArray->sectorRegion(sector);
+
+  auto& cached = m_lightLevelCache[sector];
+  if (cached.levels.empty() || m_currentTime - cached.calculatedTime > m_lightLevelCacheTime) {
+    m_lightIntensityCalculator.begin(sectorRegion);
+    WorldImpl::setLightIntensityInputs(m_tileArray, m_entityMap, m_geometry, m_worldTemplate, m_sky, m_lightIntensityCalculator);
+    m_lightIntensityCalculator.calculate(cached.levels);
+    cached.calculatedTime = m_currentTime;
+  }
+
+  Vec2I offset = Vec2I(m_geometry.xwrap(pos[0]), pos[1]) - sectorRegion.min();
+  return cached.levels[offset[0] * sectorRegion.height() + offset[1]];
+}
+
+void WorldServer::dirtyLightLevels(Vec2I const& pos) {
+  if (m_lightLevelCache.empty())
+    return;
+
+  RectI affected = RectI::withSize(pos, {1, 1}).padded((int)m_lightIntensityCalculator.borderCells());
+  for (auto const& sector : m_tileArray->validSectorsFor(affected))
+    m_lightLevelCache.remove(sector);
+}
+
 void WorldServer::queueTileDamageUpdates(Vec2I const& pos, TileLayer layer) {
   for (auto const& pair : m_clientInfo) {
     if (pair.second->activeSectors.contains(m_tileArray->sectorFor(pos)))
@@ -2175,28 +2681,59 @@ void WorldServer::writeNetTile(Vec2I const& pos, NetTile& netTile) const {
   netTile.dungeonId = tile.dungeonId;
 }
 
+void WorldServer::markCollisionTile(CollisionCellMasks& cells, Vec2I const& pos) {
+  Vec2I offset(pmod(pos[0], CollisionCellSize), pmod(pos[1], CollisionCellSize));
+  cells[(pos - offset) / CollisionCellSize] |= (uint64_t)1 << (offset[0] * CollisionCellSize + offset[1]);
+}
+
 void WorldServer::dirtyCollision(RectI const& region) {
   auto dirtyRegion = region.padded(CollisionGenerator::BlockInfluenceRadius);
+  ++m_collisionGeneration;
+  for (auto const& sector : m_tileArray->validSectorsFor(dirtyRegion))
+    m_sectorCollisionGenerations[sector] = m_collisionGeneration;
   for (int x = dirtyRegion.xMin(); x < dirtyRegion.xMax(); ++x) {
     for (int y = dirtyRegion.yMin(); y < dirtyRegion.yMax(); ++y) {
-      if (auto tile = m_tileArray->modifyTile({x, y}))
+      if (auto tile = m_tileArray->modifyTile({x, y})) {
         tile->collisionCacheDirty = true;
+        markCollisionTile(m_dirtyCollisionCells, {m_geometry.xwrap(x), y});
+      }
     }
   }
 }
 
 void WorldServer::freshenCollision(RectI const& region) {
-  RectI freshenRegion = RectI::null();
-  for (int x = region.xMin(); x < region.xMax(); ++x) {
-    for (int y = region.yMin(); y < region.yMax(); ++y) {
-      if (auto tile = m_tileArray->modifyTile({x, y})) {
-        if (tile->collisionCacheDirty)
-          freshenRegion.combine(RectI(x, y, x + 1, y + 1));
+  CollisionCellMasks dirtyCells;
+  m_tileArray->tileEachColumns(region, [&](Vec2I const& pos, ServerTile const* column, size_t columnSize) {
+      for (size_t i = 0; i < columnSize; ++i) {
+        if (column[i].collisionCacheDirty)
+          markCollisionTile(dirtyCells, pos + Vec2I(0, i));
       }
+    });
+  regenerateCollision(dirtyCells);
+}
+
+void WorldServer::freshenDirtyCollision() {
+  CollisionCellMasks dirtyCells;
+  for (auto const& pair : take(m_dirtyCollisionCells)) {
+    for (int i = 0; i < CollisionCellSize * CollisionCellSize; ++i) {
+      if (!(pair.second & ((uint64_t)1 << i)))
+        continue;
+      Vec2I pos = pair.first * CollisionCellSize + Vec2I(i / CollisionCellSize, i % CollisionCellSize);
+      if (m_tileArray->tileLoaded(pos) && m_tileArray->tile(pos).collisionCacheDirty)
+        markCollisionTile(dirtyCells, pos);
     }
   }
+  regenerateCollision(dirtyCells);
+}
+
+void WorldServer::regenerateCollision(CollisionCellMasks const& cells) {
+  for (auto const& pair : cells) {
+    RectI freshenRegion = RectI::null();
+    for (int i = 0; i < CollisionCellSize * CollisionCellSize; ++i) {
+      if (pair.second & ((uint64_t)1 << i))
+        freshenRegion.combine(RectI::withSize(pair.first * CollisionCellSize + Vec2I(i / CollisionCellSize, i % CollisionCellSize), {1, 1}));
+    }
 
-  if (!freshenRegion.isNull()) {
     for (int x = freshenRegion.xMin(); x < freshenRegion.xMax(); ++x) {
       for (int y = freshenRegion.yMin(); y < freshenRegion.yMax(); ++y) {
         if (auto tile = m_tileArray->modifyTile({x, y})) {
@@ -2226,9 +2763,9 @@ void WorldServer::removeEntity(EntityId entityId, bool andDie) {
 
   for (auto const& pair : m_clientInfo) {
     auto& clientInfo = pair.second;
-    if (auto version = clientInfo->clientSlavesNetVersion.maybeTake(entity->entityId())) {
+    if (auto slave = clientInfo->clientSlaves.maybeTake(entity->entityId())) {
       auto netRules = clientInfo->clientState.netCompatibilityRules();
-      ByteArray finalDelta = entity->writeNetState(*version, netRules).first;
+      ByteArray finalDelta = entity->writeNetState(slave->netVersion, netRules).first;
       clientInfo->outgoingPackets.append(make_shared<EntityDestroyPacket>(entity->entityId(), std::move(finalDelta), andDie));
     }
   }
@@ -2242,7 +2779,28 @@ float WorldServer::windLevel(Vec2F const& pos) const {
 }
 
 float WorldServer::lightLevel(Vec2F const& pos) const {
-  return WorldImpl::lightLevel(m_tileArray, m_entityMap, m_geometry, m_worldTemplate, m_sky, m_lightIntensityCalculator, pos);
+  MutexLocker locker(m_parallelReadMutex, s_deferWorldActions);
+  if (m_lightLevelCacheTime <= 0.0f)
+    return WorldImpl::lightLevel(m_tileArray, m_entityMap, m_geometry, m_worldTemplate, m_sky, m_lightIntensityCalculator, pos);
+
+  if (pos[1] < 0 || pos[1] >= m_geometry.height())
+    return 0;
+
+  // Interpolates between the four cells around the position, the same as the
+  // uncached calculation.
+  Vec2F wrappedPos = m_geometry.xwrap(pos);
+  Vec2I cell = Vec2I::floor(wrappedPos - Vec2F::filled(0.5f));
+  if (cell[1] < 0 || cell[1] + 1 >= (int)m_geometry.height())
+    return WorldImpl::lightLevel(m_tileArray, m_entityMap, m_geometry, m_worldTemplate, m_sky, m_lightIntensityCalculator, pos);
+
+  float ll = cachedCellLightLevel(cell);
+  float lr = cachedCellLightLevel(cell + Vec2I(1, 0));
+  float ul = cachedCellLightLevel(cell + Vec2I(0, 1));
+  float ur = cachedCellLightLevel(cell + Vec2I(1, 1));
+
+  float xl = wrappedPos[0] - 0.5f - cell[0];
+  float yl = wrappedPos[1] - 0.5f - cell[1];
+  return lerp(yl, lerp(xl, ll, lr), lerp(xl, ul, ur));
 }
 
 void WorldServer::setDungeonBreathable(DungeonId dungeonId, Maybe<bool> breathable) {
@@ -2333,6 +2891,14 @@ void WorldServer::setProperty(String const& propertyName, Json const& property)
 }
 
 void WorldServer::timer(float delay, WorldAction worldAction) {
+  if (s_deferWorldActions) {
+    MutexLocker locker(m_deferredWorldActionsMutex);
+    m_deferredWorldActions.append([delay, worldAction](World* world) {
+        world->timer(delay, worldAction);
+      });
+    return;
+  }
+
   m_timers.append({delay, worldAction});
 }
 
@@ -2543,7 +3109,8 @@ bool WorldServer::isVisibleToPlayer(RectF const& region) const {
 }
 
 WorldServer::ClientInfo::ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit)
-  : clientId(clientId), skyNetVersion(0), weatherNetVersion(0), pendingForward(false), started(false), local(false), admin(false), interpolationTracker(trackerInit) {}
+  : clientId(clientId), skyNetVersion(0), weatherNetVersion(0), pendingForward(false), started(false), local(false), admin(false),
+    firstEntitySnapshot(0), interpolationTracker(trackerInit) {}
 
 List<RectI> WorldServer::ClientInfo::monitoringRegions(EntityMapPtr const& entityMap) const {
   return clientState.monitoringRegions([entityMap](EntityId entityId) -> Maybe<RectI> {
@@ -2557,7 +3124,7 @@ bool WorldServer::ClientInfo::needsDamageNotification(RemoteDamageNotification c
   if (clientId == connectionForEntity(rdn.sourceEntityId) || clientId == connectionForEntity(rdn.damageNotification.targetEntityId))
     return true;
 
-  if (clientSlavesNetVersion.contains(rdn.damageNotification.targetEntityId))
+  if (clientSlaves.contains(rdn.damageNotification.targetEntityId))
     return true;
 
   if (clientState.window().contains(Vec2I::floor(rdn.damageNotification.position)))
@@ -2637,11 +3204,12 @@ void WorldServer::setTemplate(WorldTemplatePtr newTemplate) {
     bool local = info->local;
     bool isAdmin = info->admin;
     auto netRules = info->clientState.netCompatibilityRules();
+    bool acknowledgedEntityUpdates = info->firstEntitySnapshot != 0;
     SpawnTarget spawnTarget;
     if (auto player = clientPlayer(client))
       spawnTarget = SpawnTargetPosition(player->position() + player->feetOffset());
     removeClient(client);
-    addClient(client, spawnTarget, local, isAdmin, netRules);
+    addClient(client, spawnTarget, local, isAdmin, netRules, acknowledgedEntityUpdates);
   }
 }
 
@@ -15,6 +15,8 @@
 #include "StarWorldRenderData.hpp"
 #include "StarWarping.hpp"
 #include "StarRpcThreadPromise.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarLuaGcScheduler.hpp"
 
 namespace Star {
 
@@ -89,7 +91,10 @@ public:
 
   // Returns false if the client id already exists, or the spawn target is
   // invalid.
-  bool addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin = false, NetCompatibilityRules netRules = {});
+  // If acknowledgedEntityUpdates is set, entity deltas sent to the client are
+  // relative to the snapshots it acknowledges, so that they may be lost.
+  bool addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin = false,
+      NetCompatibilityRules netRules = {}, bool acknowledgedEntityUpdates = false);
 
   // Removes client, sends the WorldStopPacket, and returns any pending packets
   // for that client
@@ -123,6 +128,38 @@ public:
   float expiryTime();
 
   void update(float dt);
+  // Gives the lua garbage collector a chance to run in the time left over
+  // after an update, if "luaGcScheduler" is enabled.
+  void collectLuaGarbage(double spareTime);
+
+  // The entity being updated, or NullEntityId outside of entity updates.  May
+  // be read from any thread, for diagnosing slow updates.
+  EntityId updatingEntity() const;
+
+  struct EntityNetCost {
+    uint64_t updates = 0;
+    uint64_t updateBytes = 0;
+    uint64_t creates = 0;
+    uint64_t createBytes = 0;
+  };
+
+  struct EntityNetStats {
+    // Seconds the stats were counted over
+    double duration;
+    Map<EntityType, EntityNetCost> types;
+    // Update bytes by entity type and the index of the field in the entity's
+    // net group that wrote them, only counted while net field accounting is
+    // enabled.
+    Map<pair<EntityType, size_t>, uint64_t> fieldBytes;
+  };
+
+  // Counts the entity updates sent to clients by the field that wrote them,
+  // at the cost of copying every delta as it is encoded.
+  void setNetFieldAccounting(bool enabled);
+  bool netFieldAccounting() const;
+  // Returns the entity net state sent to clients since the last call, or
+  // since the world was created.
+  EntityNetStats takeEntityNetStats();
 
   ConnectionId connection() const override;
   WorldGeometry geometry() const override;
@@ -153,6 +190,7 @@ public:
   bool tileIsOccupied(Vec2I const& pos, TileLayer layer, bool includeEphemeral = false, bool checkCollision = false) const override;
   CollisionKind tileCollisionKind(Vec2I const& pos) const override;
   void forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const override;
+  uint64_t collisionGeneration(RectI const& region) const override;
   bool isTileConnectable(Vec2I const& pos, TileLayer layer, bool tilesOnly = false) const override;
   bool pointTileCollision(Vec2F const& point, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
   bool lineTileCollision(Vec2F const& begin, Vec2F const& end, CollisionSet const& collisionSet = DefaultCollisionSet) const override;
@@ -305,8 +343,23 @@ private:
 
     List<PacketPtr> outgoingPackets;
 
+    struct SlaveEntity {
+      uint64_t netVersion;
+      // Last step on which the entity was inside a monitoring region
+      uint64_t monitoredStep;
+    };
+
     // All slave entities for which the player should be knowledgable about.
-    HashMap<EntityId, uint64_t> clientSlavesNetVersion;
+    // With acknowledged entity updates, netVersion is the version of the last
+    // acknowledged delta rather than the last sent one.
+    HashMap<EntityId, SlaveEntity> clientSlaves;
+
+    // Non-zero if entity updates are acknowledged, the first snapshot number
+    // sent in this world.
+    uint64_t firstEntitySnapshot;
+    // Snapshots sent but not yet acknowledged, with the net version each
+    // entity in it was brought to.
+    Deque<pair<uint64_t, HashMap<EntityId, uint64_t>>> pendingEntitySnapshots;
 
     // Batch send tile updates
     HashSet<Vec2I> pendingTileUpdates;
@@ -325,17 +378,56 @@ private:
 
   typedef function<ServerTile const& (Vec2I)> ServerTileGetter;
 
+  struct LightLevelSector {
+    double calculatedTime;
+    // Light of each cell in the sector, in column major order
+    List<float> levels;
+  };
+
+  // Entity net state deltas encoded this tick, keyed by entity id and the
+  // version the delta starts from.  Each delta is encoded once and the buffer
+  // is shared by every client that needs it.
+  struct NetStateCacheEntry {
+    ByteArrayConstPtr delta;
+    uint64_t version;
+    // Bytes written by each field of the entity's net group, only counted
+    // while net field accounting is enabled
+    List<size_t> fieldBytes;
+  };
+  typedef HashMap<pair<EntityId, uint64_t>, NetStateCacheEntry> NetStateCache;
+
   void init(bool firstTime);
+  // Registers the LogMap values under the current world id
+  void registerLogValues();
+
+  // Queues activation of the sectors the client's player is heading towards,
+  // by extrapolating its window along the player's velocity.  Sectors in the
+  // given set, already signalled this tick, are skipped.
+  void queuePredictedSectors(ClientInfo const& clientInfo, HashSet<WorldStorage::Sector> const& signalledSectors);
 
   // Returns nothing if the processing defined by the given configuration entry
   // should not run this tick, if it should run this tick, returns the number
   // of ticks since the last run.
   Maybe<unsigned> shouldRunThisStep(String const& timingConfiguration);
 
+  // Records the time spent in the named update stage since stageStart, which
+  // covered the given number of ticks, and resets stageStart.  Stages with a
+  // configured budget have their timing period deferred while they overrun.
+  // Stage names are also used as trace profiler zone names, so must be literals
+  void finishUpdateStage(char const* stage, double& stageStart, unsigned ticks = 1);
+
   TileModificationList doApplyTileModifications(TileModificationList const& modificationList, bool allowEntityOverlap, bool ignoreTileProtection = false, bool updateNeighbors = true);
 
   // Queues pending (step based) updates to the given player
   void queueUpdatePackets(ConnectionId clientId, bool sendRemoteUpdates);
+  // Moves the baseline of every slave entity in the acknowledged snapshots to
+  // the version the snapshot brought it to.
+  void acknowledgeEntitySnapshots(ClientInfo& clientInfo, List<uint64_t> const& snapshots);
+  NetStateCacheEntry const& cachedNetState(NetStateCache& cache, EntityPtr const& entity, uint64_t fromVersion, NetCompatibilityRules rules);
+  void countEntityUpdate(EntityType type, NetStateCacheEntry const& netState);
+  // How many remote entity updates the client gets per update of the given
+  // entity, from the entity's distance outside of the client's window.
+  unsigned entityUpdateInterval(ClientInfo const& clientInfo, EntityPtr const& entity) const;
   void updateDamage(float dt);
 
   void updateDamagedBlocks(float dt);
@@ -347,8 +439,29 @@ private:
   void queueTileDamageUpdates(Vec2I const& pos, TileLayer layer);
   void writeNetTile(Vec2I const& pos, NetTile& netTile) const;
 
+  // Collision is regenerated in square cells of this many tiles, each with a
+  // bitmask of its tiles that need regenerating, indexed x * size + y.
+  static int const CollisionCellSize = 8;
+  typedef HashMap<Vec2I, uint64_t> CollisionCellMasks;
+
+  static void markCollisionTile(CollisionCellMasks& cells, Vec2I const& pos);
+
   void dirtyCollision(RectI const& region);
+  // Regenerates any dirty collision within the region
   void freshenCollision(RectI const& region);
+  // Regenerates the collision dirtied since the last call that has not been
+  // lazily freshened already, so each edited cell is regenerated once per
+  // tick however many times it was edited.
+  void freshenDirtyCollision();
+  // Regenerates the bounding box of the marked tiles in each cell
+  void regenerateCollision(CollisionCellMasks const& cells);
+
+  // Light of a single cell from the light level cache, calculating its
+  // sector if it is missing or expired
+  float cachedCellLightLevel(Vec2I const& pos) const;
+  // Drops cached light levels that tile changes at the given position can
+  // affect
+  void dirtyLightLevels(Vec2I const& pos);
 
   Vec2F findPlayerStart(Maybe<Vec2F> firstTry = {});
   Vec2F findPlayerSpaceStart(float targetX);
@@ -385,13 +498,20 @@ private:
   DamageManagerPtr m_damageManager;
   WireProcessorPtr m_wireProcessor;
   LuaRootPtr m_luaRoot;
+  LuaGcSchedulerPtr m_luaGcScheduler;
 
   StringMap<ScriptComponentPtr> m_scriptContexts;
 
   WorldGeometry m_geometry;
   double m_currentTime;
   uint64_t m_currentStep;
+  atomic<EntityId> m_updatingEntity;
   mutable CellularLightIntensityCalculator m_lightIntensityCalculator;
+  // Only used when "lightLevelCacheTime" is positive, light levels of whole
+  // sectors calculated by lightLevel queries, dropped after the cache time
+  // passes or when nearby tiles change.
+  mutable HashMap<ServerTileSectorArray::Sector, LightLevelSector> m_lightLevelCache;
+  float m_lightLevelCacheTime;
   SkyPtr m_sky;
 
   ServerWeather m_weather;
@@ -399,12 +519,49 @@ private:
   ClockPtr m_referenceClock;
 
   CollisionGenerator m_collisionGenerator;
+  // The collision generation each sector last changed at
+  HashMap<ServerTileSectorArray::Sector, uint64_t> m_sectorCollisionGenerations;
+  uint64_t m_collisionGeneration;
+  // Wrapped tiles dirtied since the last freshenDirtyCollision
+  CollisionCellMasks m_dirtyCollisionCells;
   List<CollisionBlock> m_workingCollisionBlocks;
 
-  HashMap<NetCompatibilityRules, HashMap<pair<EntityId, uint64_t>, pair<ByteArray, uint64_t>>> m_netStateCache;
+  HashMap<NetCompatibilityRules, NetStateCache> m_netStateCache;
+  uint64_t m_netStateCacheHits;
+  uint64_t m_netStateCacheMisses;
+
+  static size_t const EntityTypeCount = (size_t)EntityType::Player + 1;
+  // Entity net state sent since the world was created, and the totals as of
+  // when the stats were last taken
+  Array<EntityNetCost, EntityTypeCount> m_entityNetCosts;
+  Array<EntityNetCost, EntityTypeCount> m_entityNetCostsTaken;
+  HashMap<pair<EntityType, size_t>, uint64_t> m_entityNetFieldBytes;
+  double m_entityNetStatsTime;
+  bool m_netFieldAccounting;
+
+  struct UpdateStage {
+    // Smoothed time spent in the stage, in seconds per tick
+    double averageCost;
+    // Multiplier applied to the stage's timing period
+    unsigned deferral;
+  };
+  OrderedHashMap<String, UpdateStage> m_updateStages;
+  StringMap<double> m_updateStageBudgets;
+  unsigned m_updateStageMaxDeferral;
   OrderedHashMap<ConnectionId, shared_ptr<ClientInfo>> m_clientInfo;
 
+  // Sectors queued only because a player is predicted to reach them soon,
+  // these are generated after every sector players can already see.
+  HashSet<WorldStorage::Sector> m_predictedSectors;
+
   GameTimer m_entityUpdateTimer;
+  // Remote entity updates sent so far, an entity with a reduced update rate
+  // is sent on one update out of its interval.
+  uint64_t m_entityUpdateCount;
+  // Update interval past each distance outside of a client's window, in
+  // increasing order of distance.  Empty if every entity is always updated.
+  List<pair<float, unsigned>> m_entityUpdateIntervals;
+  HashSet<EntityType> m_fullRateEntityTypes;
   GameTimer m_tileEntityBreakCheckTimer;
 
   shared_ptr<LiquidCellEngine<LiquidId>> m_liquidEngine;
@@ -418,6 +575,15 @@ private:
 
   List<pair<float, WorldAction>> m_timers;
 
+  // Only present when "parallelEntityUpdate" is enabled in the server config,
+  // runs the updates of entities that declare an independent update.
+  unique_ptr<WorkerPool> m_entityUpdateWorkerPool;
+  Mutex m_deferredWorldActionsMutex;
+  List<WorldAction> m_deferredWorldActions;
+  // Serializes the const queries that lazily write internal caches while
+  // entities are updated in parallel.
+  mutable Mutex m_parallelReadMutex;
+
   bool m_needsGlobalBreakCheck;
 
   bool m_generatingDungeon;
@@ -432,6 +598,12 @@ private:
 
   String m_worldId;
 
+  LogMap::Value m_netStateCacheLog;
+  LogMap::Value m_entitiesLog;
+  LogMap::Value m_timeLog;
+  LogMap::Value m_activeLiquidLog;
+  LogMap::Value m_luaMemoryLog;
+
   GameTimer m_expiryTimer;
 };
 
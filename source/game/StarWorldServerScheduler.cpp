@@ -0,0 +1,149 @@
+#include "StarWorldServerScheduler.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+Maybe<double> WorldServerScheduler::Updatable::idleTimeout() const {
+  return {};
+}
+
+WorldServerScheduler::WorldServerScheduler(unsigned threadCount) : m_stop(false) {
+  if (threadCount == 0)
+    threadCount = max(Thread::numberOfProcessors(), 1u);
+
+  for (unsigned i = 0; i < threadCount; ++i)
+    m_threads.append(Thread::invoke(strf("WorldServerScheduler {}", i), [this]() { work(); }));
+}
+
+WorldServerScheduler::~WorldServerScheduler() {
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_workCondition.broadcast();
+  }
+
+  for (auto& thread : m_threads)
+    thread.finish();
+}
+
+void WorldServerScheduler::add(Updatable* world) {
+  MutexLocker locker(m_mutex);
+  if (find(world))
+    return;
+
+  m_worlds.append(ScheduledWorld{world, Time::monotonicTime(), false, false, false, false});
+  m_workCondition.signal();
+}
+
+void WorldServerScheduler::remove(Updatable* world) {
+  MutexLocker locker(m_mutex);
+  while (true) {
+    auto scheduled = find(world);
+    if (!scheduled)
+      return;
+
+    if (!scheduled->updating) {
+      m_worlds.eraseAt(scheduled - m_worlds.ptr());
+      return;
+    }
+
+    m_updatedCondition.wait(m_mutex);
+  }
+}
+
+bool WorldServerScheduler::contains(Updatable* world) const {
+  MutexLocker locker(m_mutex);
+  return find(world) != nullptr;
+}
+
+void WorldServerScheduler::wake(Updatable* world) {
+  MutexLocker locker(m_mutex);
+  if (auto scheduled = find(world)) {
+    if (scheduled->updating) {
+      scheduled->woken = true;
+    } else if (scheduled->parked) {
+      scheduled->parked = false;
+      scheduled->timedPark = false;
+      scheduled->nextUpdate = Time::monotonicTime();
+      m_workCondition.signal();
+    }
+  }
+}
+
+size_t WorldServerScheduler::threadCount() const {
+  return m_threads.size();
+}
+
+size_t WorldServerScheduler::worldCount() const {
+  MutexLocker locker(m_mutex);
+  return m_worlds.size();
+}
+
+size_t WorldServerScheduler::parkedWorldCount() const {
+  MutexLocker locker(m_mutex);
+  size_t parked = 0;
+  for (auto const& scheduled : m_worlds) {
+    if (scheduled.parked)
+      ++parked;
+  }
+  return parked;
+}
+
+void WorldServerScheduler::work() {
+  MutexLocker locker(m_mutex);
+  while (!m_stop) {
+    ScheduledWorld* next = nullptr;
+    for (auto& scheduled : m_worlds) {
+      if (!scheduled.updating && (!scheduled.parked || scheduled.timedPark) && (!next || scheduled.nextUpdate < next->nextUpdate))
+        next = &scheduled;
+    }
+
+    if (!next) {
+      m_workCondition.wait(m_mutex);
+      continue;
+    }
+
+    unsigned millisUntilDue = max<double>(floor((next->nextUpdate - Time::monotonicTime()) * 1000), 0);
+    if (millisUntilDue > 0) {
+      m_workCondition.wait(m_mutex, millisUntilDue);
+      continue;
+    }
+
+    Updatable* world = next->world;
+    next->updating = true;
+    locker.unlock();
+
+    // The world guards its own exceptions and reports nothing once it has
+    // stopped or errored, in which case it is parked until it is removed.
+    Maybe<double> spareTime = world->scheduledUpdate();
+    bool idle = spareTime && world->idle();
+    Maybe<double> idleTimeout = idle ? world->idleTimeout() : Maybe<double>();
+
+    locker.lock();
+    if (auto scheduled = find(world)) {
+      scheduled->updating = false;
+      scheduled->parked = !spareTime || (idle && !scheduled->woken);
+      scheduled->timedPark = scheduled->parked && spareTime && idleTimeout;
+      scheduled->woken = false;
+      if (scheduled->timedPark)
+        scheduled->nextUpdate = Time::monotonicTime() + max(*idleTimeout, *spareTime);
+      else
+        scheduled->nextUpdate = Time::monotonicTime() + max(spareTime.value(0.0), 0.0);
+    }
+    m_updatedCondition.broadcast();
+  }
+}
+
+WorldServerScheduler::ScheduledWorld* WorldServerScheduler::find(Updatable* world) {
+  for (auto& scheduled : m_worlds) {
+    if (scheduled.world == world)
+      return &scheduled;
+  }
+  return nullptr;
+}
+
+WorldServerScheduler::ScheduledWorld const* WorldServerScheduler::find(Updatable* world) const {
+  return const_cast<WorldServerScheduler*>(this)->find(world);
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "StarThread.hpp"
+#include "StarList.hpp"
+#include "StarMaybe.hpp"
+
+namespace Star {
+
+STAR_CLASS(WorldServerScheduler);
+
+// Runs the update loops of many WorldServerThreads and SystemWorldServerThreads
+// on a fixed set of worker threads, rather than each world running on its own
+// thread.  Every world keeps its own tick rate and fidelity accounting, and is
+// updated by whichever worker is free once its next update is due.  Worlds
+// that report themselves as idle after an update are parked, and are not
+// considered again until they are woken or their idle timeout passes.
+class WorldServerScheduler {
+public:
+  class Updatable {
+  public:
+    virtual ~Updatable() = default;
+
+    // Runs a single update, returning the time in seconds until the next one
+    // is due, or nothing if the world has stopped or an error occurred.
+    virtual Maybe<double> scheduledUpdate() = 0;
+    // True if there is nothing to do until the world is woken by new work.
+    virtual bool idle() const = 0;
+    // How long an idle world may stay parked before it is updated anyway,
+    // nothing to stay parked until woken.
+    virtual Maybe<double> idleTimeout() const;
+  };
+
+  // A thread count of 0 uses one thread per processor.
+  WorldServerScheduler(unsigned threadCount = 0);
+  ~WorldServerScheduler();
+
+  WorldServerScheduler(WorldServerScheduler const&) = delete;
+  WorldServerScheduler& operator=(WorldServerScheduler const&) = delete;
+
+  // Begin scheduling updates for the given world.  The world must be removed
+  // before it is destroyed.
+  void add(Updatable* world);
+  // Stop scheduling updates for the given world, waits for any update of this
+  // world that is currently in progress to finish.  Must not be called from
+  // within the world's own update.
+  void remove(Updatable* world);
+  bool contains(Updatable* world) const;
+
+  // Unpark the given world if it is parked, and schedule it to update as soon
+  // as possible.
+  void wake(Updatable* world);
+
+  size_t threadCount() const;
+  size_t worldCount() const;
+  size_t parkedWorldCount() const;
+
+private:
+  struct ScheduledWorld {
+    Updatable* world;
+    double nextUpdate;
+    bool updating;
+    bool parked;
+    // Parked only until nextUpdate rather than until woken
+    bool timedPark;
+    // Set when woken during an update, so the world is not parked afterwards
+    bool woken;
+  };
+
+  void work();
+
+  ScheduledWorld* find(Updatable* world);
+  ScheduledWorld const* find(Updatable* world) const;
+
+  mutable Mutex m_mutex;
+  // Signaled when there may be a new world for an idle worker to update
+  ConditionVariable m_workCondition;
+  // Broadcast whenever a worker finishes updating a world
+  ConditionVariable m_updatedCondition;
+  List<ScheduledWorld> m_worlds;
+  bool m_stop;
+
+  List<ThreadFunction<void>> m_threads;
+};
+
+}
@@ -3,50 +3,168 @@
 #include "StarNpc.hpp"
 #include "StarRoot.hpp"
 #include "StarLogging.hpp"
+#include "StarArena.hpp"
 #include "StarAssets.hpp"
 #include "StarPlayer.hpp"
+#include "StarWorldServerScheduler.hpp"
+#include "StarTime.hpp"
+#include "StarMetrics.hpp"
 
 namespace Star {
 
+struct WorldServerThread::UpdateLoop {
+  UpdateLoop();
+
+  double fidelityDecrementScore;
+  double fidelityIncrementScore;
+  Maybe<WorldServerFidelity> lockedFidelity;
+
+  double storageInterval;
+  Timer storageTimer;
+
+  TickRateApproacher tickApproacher;
+  double fidelityScore;
+  WorldServerFidelity automaticFidelity;
+
+  String fidelityLogKey;
+  LogMap::Value updateRateLog;
+  Metrics::Labels metricLabels;
+};
+
+WorldServerThread::UpdateLoop::UpdateLoop()
+  : tickApproacher(1.0f / ServerGlobalTimestep, Root::singleton().assets()->json("/universe_server.config:updateMeasureWindow").toDouble()) {
+  auto& root = Root::singleton();
+  fidelityDecrementScore = root.assets()->json("/universe_server.config:fidelityDecrementScore").toDouble();
+  fidelityIncrementScore = root.assets()->json("/universe_server.config:fidelityIncrementScore").toDouble();
+
+  String serverFidelityMode = root.configuration()->get("serverFidelity").toString();
+  if (!serverFidelityMode.equalsIgnoreCase("automatic"))
+    lockedFidelity = WorldServerFidelityNames.getLeft(serverFidelityMode);
+
+  storageInterval = root.assets()->json("/universe_server.config:worldStorageInterval").toDouble() / 1000.0;
+  storageTimer = Timer::withTime(storageInterval);
+
+  fidelityScore = 0.0;
+  automaticFidelity = WorldServerFidelity::Medium;
+}
+
 WorldServerThread::WorldServerThread(WorldServerPtr server, WorldId worldId)
   : Thread("WorldServerThread: " + printWorldId(worldId)),
     m_worldServer(std::move(server)),
     m_worldId(std::move(worldId)),
+    m_packetQueues(make_shared<ClientPacketQueueMap const>()),
+    m_scheduled(false),
     m_stop(false),
+    m_hibernating(false),
+    m_hibernatedAt(0),
     m_errorOccurred(false),
-    m_shouldExpire(true) {
+    m_shouldExpire(true),
+    m_updateStart(0.0),
+    m_updateNumber(0),
+    m_updateThread(0) {
   if (m_worldServer)
     m_worldServer->setWorldId(printWorldId(m_worldId));
+
+  Metrics::describe("starbound_world_update_seconds", Metrics::Type::Histogram, "Time taken by each world update",
+      {0.001, 0.0025, 0.005, 0.01, 0.0166, 0.025, 0.05, 0.1, 0.25});
+  Metrics::describe("starbound_world_tick_overruns_total", Metrics::Type::Counter, "World updates that ran past their tick");
 }
 
 WorldServerThread::~WorldServerThread() {
   m_stop = true;
-  join();
+  if (m_scheduler)
+    m_scheduler->remove(this);
+  Thread::join();
 
   RecursiveMutexLocker locker(m_mutex);
   for (auto clientId : m_worldServer->clientIds())
     removeClient(clientId);
+
+  Metrics::removeSeries("world", printWorldId(m_worldId));
 }
 
 WorldId WorldServerThread::worldId() const {
   return m_worldId;
 }
 
+void WorldServerThread::setScheduler(WorldServerSchedulerPtr scheduler) {
+  m_scheduler = std::move(scheduler);
+}
+
 void WorldServerThread::start() {
   m_stop = false;
   m_errorOccurred = false;
-  Thread::start();
+  if (m_scheduler) {
+    m_scheduled = true;
+    m_scheduler->add(this);
+  } else {
+    Thread::start();
+  }
 }
 
 void WorldServerThread::stop() {
   m_stop = true;
-  Thread::join();
+  m_hibernating = false;
+  if (m_scheduler) {
+    m_scheduler->remove(this);
+    m_scheduled = false;
+  } else {
+    Thread::join();
+  }
+}
+
+void WorldServerThread::hibernate() {
+  if (m_hibernating || m_errorOccurred)
+    return;
+
+  stop();
+  try {
+    RecursiveMutexLocker locker(m_mutex);
+    m_worldServer->unloadAll(true);
+  } catch (std::exception const& e) {
+    Logger::error("WorldServerThread exception caught: {}", outputException(e, true));
+    m_errorOccurred = true;
+    return;
+  }
+  // Restart the tick rate and storage timers on resume rather than trying to
+  // catch up on the time spent hibernating.
+  m_updateLoop.reset();
+
+  m_hibernatedAt = Time::monotonicMilliseconds();
+  m_hibernating = true;
+}
+
+void WorldServerThread::resume() {
+  if (m_hibernating.exchange(false))
+    start();
+}
+
+bool WorldServerThread::hibernating() const {
+  return m_hibernating;
+}
+
+double WorldServerThread::hibernatedTime() const {
+  if (!m_hibernating)
+    return 0.0;
+  return (Time::monotonicMilliseconds() - m_hibernatedAt) / 1000.0;
 }
 
 void WorldServerThread::setPause(shared_ptr<const atomic<bool>> pause) {
   m_pause = pause;
 }
 
+bool WorldServerThread::isRunning() const {
+  if (m_scheduler)
+    return m_scheduled && !m_stop && !m_errorOccurred;
+  return Thread::isRunning();
+}
+
+bool WorldServerThread::isJoined() const {
+  if (m_scheduler)
+    return !m_scheduled;
+  return Thread::isJoined();
+}
+
 bool WorldServerThread::serverErrorOccurred() {
   return m_errorOccurred;
 }
@@ -66,11 +184,17 @@ bool WorldServerThread::spawnTargetValid(SpawnTarget const& spawnTarget) {
   }
 }
 
-bool WorldServerThread::addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin, NetCompatibilityRules netRules) {
+bool WorldServerThread::addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin,
+    NetCompatibilityRules netRules, bool acknowledgedEntityUpdates) {
+  resume();
   try {
     RecursiveMutexLocker locker(m_mutex);
-    if (m_worldServer->addClient(clientId, spawnTarget, isLocal, isAdmin, netRules)) {
+    if (m_worldServer->addClient(clientId, spawnTarget, isLocal, isAdmin, netRules, acknowledgedEntityUpdates)) {
       m_clients.add(clientId);
+      auto packetQueues = make_shared<ClientPacketQueueMap>(*m_packetQueues.load());
+      packetQueues->set(clientId, make_shared<ClientPacketQueues>());
+      m_packetQueues.store(std::move(packetQueues));
+      wakeScheduled();
       return true;
     }
 
@@ -87,15 +211,18 @@ List<PacketPtr> WorldServerThread::removeClient(ConnectionId clientId) {
   if (!m_clients.contains(clientId))
     return {};
 
-  RecursiveMutexLocker queueLocker(m_queueMutex);
+  auto queues = clientPacketQueues(clientId);
+  auto packetQueues = make_shared<ClientPacketQueueMap>(*m_packetQueues.load());
+  packetQueues->remove(clientId);
+  m_packetQueues.store(std::move(packetQueues));
 
   List<PacketPtr> outgoingPackets;
   try {
-    auto incomingPackets = take(m_incomingPacketQueue[clientId]);
+    auto incomingPackets = queues->incoming.takeAll();
     if (m_worldServer->hasClient(clientId))
       m_worldServer->handleIncomingPackets(clientId, std::move(incomingPackets));
 
-    outgoingPackets = take(m_outgoingPacketQueue[clientId]);
+    outgoingPackets = queues->outgoing.takeAll();
     if (m_worldServer->hasClient(clientId))
       outgoingPackets.appendAll(m_worldServer->removeClient(clientId));
 
@@ -105,8 +232,6 @@ List<PacketPtr> WorldServerThread::removeClient(ConnectionId clientId) {
   }
 
   m_clients.remove(clientId);
-  m_incomingPacketQueue.remove(clientId);
-  m_outgoingPacketQueue.remove(clientId);
   return outgoingPackets;
 }
 
@@ -133,13 +258,17 @@ List<ConnectionId> WorldServerThread::erroredClients() const {
 }
 
 void WorldServerThread::pushIncomingPackets(ConnectionId clientId, List<PacketPtr> packets) {
-  RecursiveMutexLocker queueLocker(m_queueMutex);
-  m_incomingPacketQueue[clientId].appendAll(std::move(packets));
+  // Packets for clients not in this world are dropped
+  if (auto queues = clientPacketQueues(clientId)) {
+    queues->incoming.pushAll(std::move(packets));
+    wakeScheduled();
+  }
 }
 
 List<PacketPtr> WorldServerThread::pullOutgoingPackets(ConnectionId clientId) {
-  RecursiveMutexLocker queueLocker(m_queueMutex);
-  return take(m_outgoingPacketQueue[clientId]);
+  if (auto queues = clientPacketQueues(clientId))
+    return queues->outgoing.takeAll();
+  return {};
 }
 
 Maybe<Vec2F> WorldServerThread::playerRevivePosition(ConnectionId clientId) const {
@@ -169,6 +298,8 @@ Maybe<pair<String, String>> WorldServerThread::pullNewPlanetType() {
 void WorldServerThread::executeAction(WorldServerAction action) {
   RecursiveMutexLocker locker(m_mutex);
   action(this, m_worldServer.get());
+  locker.unlock();
+  wakeScheduled();
 }
 
 void WorldServerThread::setUpdateAction(WorldServerAction updateAction) {
@@ -179,6 +310,8 @@ void WorldServerThread::setUpdateAction(WorldServerAction updateAction) {
 void WorldServerThread::passMessages(List<Message>&& messages) {
   RecursiveMutexLocker locker(m_messageMutex);
   m_messages.appendAll(std::move(messages));
+  locker.unlock();
+  wakeScheduled();
 }
 
 void WorldServerThread::unloadAll(bool force) {
@@ -204,53 +337,8 @@ WorldChunks WorldServerThread::readChunks() {
 
 void WorldServerThread::run() {
   try {
-    auto& root = Root::singleton();
-    double updateMeasureWindow = root.assets()->json("/universe_server.config:updateMeasureWindow").toDouble();
-    double fidelityDecrementScore = root.assets()->json("/universe_server.config:fidelityDecrementScore").toDouble();
-    double fidelityIncrementScore = root.assets()->json("/universe_server.config:fidelityIncrementScore").toDouble();
-
-    String serverFidelityMode = root.configuration()->get("serverFidelity").toString();
-    Maybe<WorldServerFidelity> lockedFidelity;
-    if (!serverFidelityMode.equalsIgnoreCase("automatic"))
-      lockedFidelity = WorldServerFidelityNames.getLeft(serverFidelityMode);
-
-    double storageInterval = root.assets()->json("/universe_server.config:worldStorageInterval").toDouble() / 1000.0;
-    Timer storageTimer = Timer::withTime(storageInterval);
-
-    TickRateApproacher tickApproacher(1.0f / ServerGlobalTimestep, updateMeasureWindow);
-    double fidelityScore = 0.0;
-    WorldServerFidelity automaticFidelity = WorldServerFidelity::Medium;
-
     while (!m_stop && !m_errorOccurred) {
-      auto fidelity = lockedFidelity.value(automaticFidelity);
-      LogMap::set(strf("server_{}_fidelity", m_worldId), WorldServerFidelityNames.getRight(fidelity));
-      LogMap::set(strf("server_{}_update", m_worldId), strf("{:4.2f}Hz", tickApproacher.rate()));
-
-      update(fidelity);
-      tickApproacher.setTargetTickRate(1.0f / ServerGlobalTimestep);
-      tickApproacher.tick();
-
-      if (storageTimer.timeUp()) {
-        sync();
-        storageTimer.restart(storageInterval);
-      }
-
-      double spareTime = tickApproacher.spareTime();
-      fidelityScore += spareTime;
-
-      if (fidelityScore <= fidelityDecrementScore) {
-        if (automaticFidelity > WorldServerFidelity::Minimum)
-          automaticFidelity = (WorldServerFidelity)((int)automaticFidelity - 1);
-        fidelityScore = 0.0;
-      }
-
-      if (fidelityScore >= fidelityIncrementScore) {
-        if (automaticFidelity < WorldServerFidelity::High)
-          automaticFidelity = (WorldServerFidelity)((int)automaticFidelity + 1);
-        fidelityScore = 0.0;
-      }
-
-      int64_t spareMilliseconds = floor(spareTime * 1000);
+      int64_t spareMilliseconds = floor(updateLoopStep() * 1000);
       if (spareMilliseconds > 0)
         Thread::sleepPrecise(spareMilliseconds);
     }
@@ -260,20 +348,115 @@ void WorldServerThread::run() {
   }
 }
 
+double WorldServerThread::updateLoopStep() {
+  if (!m_updateLoop) {
+    m_updateLoop = make_unique<UpdateLoop>();
+    String worldId = printWorldId(m_worldId);
+    m_updateLoop->fidelityLogKey = strf("server_{}_fidelity", worldId);
+    m_updateLoop->updateRateLog = LogMap::Value(strf("server_{}_update", worldId), "{:4.2f}Hz");
+    m_updateLoop->metricLabels = {{"world", worldId}};
+  }
+  auto& loop = *m_updateLoop;
+
+  auto fidelity = loop.lockedFidelity.value(loop.automaticFidelity);
+  LogMap::setValue(loop.fidelityLogKey, WorldServerFidelityNames.getRight(fidelity));
+  loop.updateRateLog.set(loop.tickApproacher.rate());
+
+  auto const& labels = loop.metricLabels;
+  Metrics::setGauge("starbound_world_fidelity", labels, (int)fidelity);
+  Metrics::setGauge("starbound_world_tick_rate", labels, loop.tickApproacher.rate());
+
+  double updateStart = Time::monotonicTime();
+  update(fidelity);
+  Metrics::observe("starbound_world_update_seconds", labels, Time::monotonicTime() - updateStart);
+  loop.tickApproacher.setTargetTickRate(1.0f / ServerGlobalTimestep);
+  loop.tickApproacher.tick();
+
+  if (loop.storageTimer.timeUp()) {
+    sync();
+    loop.storageTimer.restart(loop.storageInterval);
+  }
+
+  double spareTime = loop.tickApproacher.spareTime();
+  loop.fidelityScore += spareTime;
+  if (spareTime < 0.0)
+    Metrics::addCounter("starbound_world_tick_overruns_total", labels);
+
+  // Outgoing packets are already queued by now, so collecting here does not
+  // delay them.  Fidelity is judged on the spare time before collection.
+  {
+    RecursiveMutexLocker locker(m_mutex);
+    m_worldServer->collectLuaGarbage(spareTime);
+  }
+  spareTime = loop.tickApproacher.spareTime();
+
+  if (loop.fidelityScore <= loop.fidelityDecrementScore) {
+    if (loop.automaticFidelity > WorldServerFidelity::Minimum)
+      loop.automaticFidelity = (WorldServerFidelity)((int)loop.automaticFidelity - 1);
+    loop.fidelityScore = 0.0;
+  }
+
+  if (loop.fidelityScore >= loop.fidelityIncrementScore) {
+    if (loop.automaticFidelity < WorldServerFidelity::High)
+      loop.automaticFidelity = (WorldServerFidelity)((int)loop.automaticFidelity + 1);
+    loop.fidelityScore = 0.0;
+  }
+
+  return spareTime;
+}
+
+Maybe<double> WorldServerThread::scheduledUpdate() {
+  if (m_stop || m_errorOccurred)
+    return {};
+
+  try {
+    return updateLoopStep();
+  } catch (std::exception const& e) {
+    Logger::error("WorldServerThread exception caught: {}", outputException(e, true));
+    m_errorOccurred = true;
+    return {};
+  }
+}
+
+bool WorldServerThread::idle() const {
+  if (!m_pause || !*m_pause)
+    return false;
+
+  for (auto const& p : *m_packetQueues.load()) {
+    if (!p.second->incoming.empty())
+      return false;
+  }
+
+  RecursiveMutexLocker messageLocker(m_messageMutex);
+  return m_messages.empty();
+}
+
+void WorldServerThread::wakeScheduled() {
+  if (m_scheduler)
+    m_scheduler->wake(this);
+}
+
 void WorldServerThread::update(WorldServerFidelity fidelity) {
   RecursiveMutexLocker locker(m_mutex);
+  m_updateThread = StackSampler::currentThread();
+  ++m_updateNumber;
+  m_updateStart = Time::monotonicTime();
+  auto updateFinished = finally([this]() { m_updateStart = 0.0; });
+
+  // Scratch allocations made on this thread only live for one tick
+  Arena::threadArena().reset();
   auto unerroredClientIds = m_worldServer->clientIds();
+  auto packetQueues = m_packetQueues.load();
   for (auto clientId : unerroredClientIds) {
-    RecursiveMutexLocker queueLocker(m_queueMutex);
-    auto incomingPackets = take(m_incomingPacketQueue[clientId]);
-    queueLocker.unlock();
+    auto queues = packetQueues->value(clientId);
+    if (!queues)
+      continue;
     try {
-      m_worldServer->handleIncomingPackets(clientId, std::move(incomingPackets));
+      m_worldServer->handleIncomingPackets(clientId, queues->incoming.takeAll());
     } catch (std::exception const& e) {
       Logger::error("WorldServerThread exception caught handling incoming packets for client {}: {}",
           clientId, outputException(e, true));
-      RecursiveMutexLocker queueLocker(m_queueMutex);
-      m_outgoingPacketQueue[clientId].appendAll(m_worldServer->removeClient(clientId));
+      queues->outgoing.pushAll(m_worldServer->removeClient(clientId));
       unerroredClientIds.remove(clientId);
     }
   }
@@ -297,8 +480,8 @@ void WorldServerThread::update(WorldServerFidelity fidelity) {
 
   for (auto& clientId : unerroredClientIds) {
     auto outgoingPackets = m_worldServer->getOutgoingPackets(clientId);
-    RecursiveMutexLocker queueLocker(m_queueMutex);
-    m_outgoingPacketQueue[clientId].appendAll(std::move(outgoingPackets));
+    if (auto queues = packetQueues->value(clientId))
+      queues->outgoing.pushAll(std::move(outgoingPackets));
   }
 
   m_shouldExpire = m_worldServer->shouldExpire();
@@ -307,6 +490,21 @@ void WorldServerThread::update(WorldServerFidelity fidelity) {
     m_updateAction(this, m_worldServer.get());
 }
 
+auto WorldServerThread::updateProgress() const -> Maybe<UpdateProgress> {
+  double start = m_updateStart;
+  if (start == 0.0)
+    return {};
+  return UpdateProgress{start, m_updateNumber, m_updateThread, m_worldServer->updatingEntity()};
+}
+
+LuaRootPtr WorldServerThread::luaRoot() const {
+  return m_worldServer->luaRoot();
+}
+
+auto WorldServerThread::clientPacketQueues(ConnectionId clientId) const -> shared_ptr<ClientPacketQueues> {
+  return m_packetQueues.load()->value(clientId);
+}
+
 void WorldServerThread::sync() {
   RecursiveMutexLocker locker(m_mutex);
   Logger::debug("WorldServer: periodic sync to disk of world {}", m_worldId);
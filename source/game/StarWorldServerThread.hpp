@@ -3,6 +3,10 @@
 #include "StarWorldServer.hpp"
 #include "StarThread.hpp"
 #include "StarRpcThreadPromise.hpp"
+#include "StarSpscQueue.hpp"
+#include "StarAtomicSharedPtr.hpp"
+#include "StarStackSampler.hpp"
+#include "StarWorldServerScheduler.hpp"
 
 namespace Star {
 
@@ -11,7 +15,7 @@ STAR_CLASS(WorldServerThread);
 // Runs a WorldServer in a separate thread and guards exceptions that occur in
 // it.  All methods are designed to not throw exceptions, but will instead log
 // the error and trigger the WorldServerThread error state.
-class WorldServerThread : public Thread {
+class WorldServerThread : public Thread, public WorldServerScheduler::Updatable {
 public:
   struct Message {
     String message;
@@ -26,11 +30,30 @@ public:
 
   WorldId worldId() const;
 
+  // Run the update loop on the given scheduler instead of on this thread.
+  // Must be called before start().
+  void setScheduler(WorldServerSchedulerPtr scheduler);
+
   void start();
   // Signals the WorldServerThread to stop and then joins it
   void stop();
+
+  // Stops updating the world, releasing its thread or scheduler slot, and
+  // unloads every sector into storage, but keeps the WorldServer and its
+  // scripts alive so that resume() continues it without reloading anything.
+  // Adding a client resumes a hibernating world.  stop() ends hibernation.
+  void hibernate();
+  void resume();
+  bool hibernating() const;
+  // Seconds since the world was hibernated, 0 if it is not hibernating.
+  double hibernatedTime() const;
   void setPause(shared_ptr<const atomic<bool>> pause);
 
+  // Hide the Thread versions, when running on a scheduler these report
+  // whether the world is scheduled rather than the unused thread state.
+  bool isRunning() const;
+  bool isJoined() const;
+
   // An exception occurred from the actual WorldServer itself and the
   // WorldServerThread has stopped running.
   bool serverErrorOccurred();
@@ -38,7 +61,8 @@ public:
 
   bool spawnTargetValid(SpawnTarget const& spawnTarget);
 
-  bool addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin = false, NetCompatibilityRules netRules = {});
+  bool addClient(ConnectionId clientId, SpawnTarget const& spawnTarget, bool isLocal, bool isAdmin = false,
+      NetCompatibilityRules netRules = {}, bool acknowledgedEntityUpdates = false);
   // Returns final outgoing packets
   List<PacketPtr> removeClient(ConnectionId clientId);
 
@@ -78,10 +102,38 @@ public:
   // into memory, useful for the ship.
   WorldChunks readChunks();
 
+  struct UpdateProgress {
+    // Time::monotonicTime() the update started at
+    double start;
+    // Counts every update of this world, to tell apart two updates that are
+    // both found running
+    uint64_t number;
+    StackSampler::ThreadId thread;
+    EntityId entity;
+  };
+
+  // The update currently running on this world, if any.  May be called from
+  // any thread, for watching for updates that take too long.
+  Maybe<UpdateProgress> updateProgress() const;
+  LuaRootPtr luaRoot() const;
+
 protected:
   virtual void run();
 
 private:
+  struct UpdateLoop;
+
+  // Runs a single iteration of the update loop, returns the time in seconds
+  // until the next iteration should run.
+  double updateLoopStep();
+  // Guarded version of updateLoopStep for the scheduler, returns nothing if
+  // the world has stopped or an error occurred.
+  Maybe<double> scheduledUpdate() override;
+  // True if the world is paused and no packets or messages are waiting, so
+  // there is nothing to do until it is woken by new work.
+  bool idle() const override;
+  void wakeScheduled();
+
   void update(WorldServerFidelity fidelity);
   void sync();
 
@@ -93,17 +145,38 @@ private:
   WorldId m_worldId;
   WorldServerAction m_updateAction;
 
-  mutable RecursiveMutex m_queueMutex;
-  Map<ConnectionId, List<PacketPtr>> m_incomingPacketQueue;
-  Map<ConnectionId, List<PacketPtr>> m_outgoingPacketQueue;
+  // Incoming packets are pushed by the client's network thread and taken by
+  // the world, outgoing ones are pushed and taken by the world, so neither
+  // side of either queue waits on a lock.  The set of clients is replaced
+  // rather than modified, under m_mutex.
+  struct ClientPacketQueues {
+    SpscQueue<PacketPtr> incoming;
+    SpscQueue<PacketPtr> outgoing;
+  };
+  typedef HashMap<ConnectionId, shared_ptr<ClientPacketQueues>> ClientPacketQueueMap;
+
+  shared_ptr<ClientPacketQueues> clientPacketQueues(ConnectionId clientId) const;
+
+  AtomicSharedPtr<ClientPacketQueueMap const> m_packetQueues;
 
   mutable RecursiveMutex m_messageMutex;
   List<Message> m_messages;
 
+  unique_ptr<UpdateLoop> m_updateLoop;
+  WorldServerSchedulerPtr m_scheduler;
+  atomic<bool> m_scheduled;
+
   atomic<bool> m_stop;
+  atomic<bool> m_hibernating;
+  atomic<int64_t> m_hibernatedAt;
   shared_ptr<const atomic<bool>> m_pause;
   mutable atomic<bool> m_errorOccurred;
   mutable atomic<bool> m_shouldExpire;
+
+  // Zero when no update is running
+  atomic<double> m_updateStart;
+  atomic<uint64_t> m_updateNumber;
+  atomic<StackSampler::ThreadId> m_updateThread;
 };
 
 }
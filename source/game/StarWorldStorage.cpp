@@ -1,6 +1,7 @@
 #include "StarWorldStorage.hpp"
 #include "StarFile.hpp"
 #include "StarCompression.hpp"
+#include "StarZSTDCompression.hpp"
 #include "StarJsonExtra.hpp"
 #include "StarDataStreamExtra.hpp"
 #include "StarIterator.hpp"
@@ -11,9 +12,63 @@
 #include "StarAssets.hpp"
 #include "StarMaterialDatabase.hpp"
 #include "StarLiquidsDatabase.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
+namespace {
+  struct SectorCompression {
+    bool zstd = false;
+    int level = 3;
+    ZstdDictionaryConstPtr tileDictionary;
+    ZstdDictionaryConstPtr entityDictionary;
+    HashMap<unsigned, ZstdDictionaryConstPtr> dictionaries;
+    bool compactEntityJson = false;
+  };
+
+  // Dictionaries are loaded once per Assets instance and shared between every
+  // world, including background sync threads.
+  shared_ptr<SectorCompression const> sectorCompression() {
+    static Mutex s_mutex;
+    static Assets const* s_assets = nullptr;
+    static shared_ptr<SectorCompression const> s_compression;
+
+    auto assets = Root::singleton().assets();
+    MutexLocker locker(s_mutex);
+    if (s_compression && s_assets == assets.get())
+      return s_compression;
+
+    auto config = assets->json("/worldstorage.config").getObject("sectorCompression", JsonObject());
+    auto compression = make_shared<SectorCompression>();
+    compression->zstd = config.value("zstd", false).toBool();
+    compression->level = config.value("level", 3).toInt();
+    compression->compactEntityJson = config.value("compactEntityJson", false).toBool();
+
+    auto loadDictionary = [&](Json const& path) -> ZstdDictionaryConstPtr {
+      if (path.isNull())
+        return {};
+      auto dictionary = make_shared<ZstdDictionary const>(*assets->bytes(path.toString()), compression->level);
+      compression->dictionaries[dictionary->id()] = dictionary;
+      return dictionary;
+    };
+    for (auto const& path : config.value("legacyDictionaries", JsonArray()).iterateArray())
+      loadDictionary(path);
+    compression->tileDictionary = loadDictionary(config.value("tileSectorDictionary"));
+    compression->entityDictionary = loadDictionary(config.value("entitySectorDictionary"));
+
+    s_assets = assets.get();
+    s_compression = compression;
+    return s_compression;
+  }
+
+  // Shared by every world, sector stores are only ever encoded here once the
+  // world thread has taken them.
+  WorkerPool& sectorWorkerPool() {
+    static WorkerPool pool("WorldStorage", max(1u, std::thread::hardware_concurrency()));
+    return pool;
+  }
+}
+
 WorldChunks WorldStorage::getWorldChunksUpdate(WorldChunks const& oldChunks, WorldChunks const& newChunks) {
   WorldChunks update;
   for (auto const& p : oldChunks) {
@@ -32,12 +87,14 @@ void WorldStorage::applyWorldChunksUpdateToFile(String const& file, WorldChunks
   BTreeDatabase db;
   openDatabase(db, File::open(file, IOMode::ReadWrite));
 
+  BTreeDatabase::WriteBatch batch;
   for (auto const& p : update) {
     if (p.second)
-      db.insert(p.first, *p.second);
+      batch.insert(p.first, *p.second);
     else
-      db.remove(p.first);
+      batch.remove(p.first);
   }
+  db.writeBatch(std::move(batch));
 }
 
 WorldChunks WorldStorage::getWorldChunksFromFile(String const& file) {
@@ -45,7 +102,9 @@ WorldChunks WorldStorage::getWorldChunksFromFile(String const& file) {
   openDatabase(db, File::open(file, IOMode::Read));
 
   WorldChunks chunks;
-  db.forAll([&chunks](ByteArray key, ByteArray value) { chunks.add(std::move(key), std::move(value)); });
+  auto cursor = db.scanAll(true);
+  while (cursor.next())
+    chunks.add(cursor.key(), cursor.value());
   return chunks;
 }
 
@@ -93,6 +152,13 @@ WorldStorage::WorldStorage(WorldChunks const& chunks, WorldGeneratorFacadePtr co
 }
 
 WorldStorage::~WorldStorage() {
+  try {
+    finishBackgroundSync();
+  } catch (std::exception const& e) {
+    // Anything the failed sync did not commit is stored again below
+    Logger::error("WorldStorage background sync failed: {}", outputException(e, true));
+  }
+
   if (m_db.isOpen()) {
     unloadAll(true);
     m_db.close();
@@ -172,7 +238,7 @@ void WorldStorage::activateSector(Sector sector) {
   }
 }
 
-void WorldStorage::queueSectorActivation(Sector sector) {
+void WorldStorage::queueSectorActivation(Sector sector, bool prioritized) {
   if (auto p = m_sectorMetadata.ptr(sector)) {
     p->timeToLive = randomizedSectorTTL();
     // Don't bother queueing the sector if it is already fully loaded
@@ -181,7 +247,36 @@ void WorldStorage::queueSectorActivation(Sector sector) {
   }
 
   auto p = m_generationQueue.insert(sector, m_generationQueueTimeToLive);
-  m_generationQueue.toFront(p.first);
+  if (prioritized)
+    m_generationQueue.toFront(p.first);
+}
+
+void WorldStorage::materializeSector(Sector sector) {
+  if (m_dormantEntities.empty())
+    return;
+
+  try {
+    auto dormant = m_dormantEntities.maybeTake(sector);
+    if (!dormant)
+      return;
+
+    auto entityFactory = Root::singleton().entityFactory();
+    for (auto const& entityStore : *dormant) {
+      EntityPtr entity;
+      try {
+        entity = entityFactory->loadVersionedEntity(entityStore);
+      } catch (std::exception const& e) {
+        Logger::warn("Failed to deserialize entity '{}'. {}", entityStore.toJson(), outputException(e, true));
+        continue;
+      }
+      m_generatorFacade->initEntity(this, m_entityMap->reserveEntityId(), entity);
+      m_entityMap->addEntity(entity);
+    }
+  } catch (std::exception const& e) {
+    m_db.rollback();
+    m_db.close();
+    throw WorldStorageException(strf("Failed to materialize sector {}", sector), e);
+  }
 }
 
 void WorldStorage::triggerTerraformSector(Sector sector) {
@@ -249,6 +344,7 @@ EntityId WorldStorage::loadUniqueEntity(String const& uniqueId) {
 }
 
 void WorldStorage::generateQueue(Maybe<size_t> sectorGenerationLevelLimit, function<bool(Sector, Sector)> sectorOrdering) {
+  STAR_PROFILE_SCOPE("WorldStorage::generateQueue");
   try {
     if (sectorOrdering) {
       m_generationQueue.sort([&sectorOrdering](auto const& a, auto const& b) {
@@ -256,6 +352,9 @@ void WorldStorage::generateQueue(Maybe<size_t> sectorGenerationLevelLimit, funct
         });
     }
 
+    if (m_generationPrefetchSectors > 0)
+      prefetchSectors(m_generationQueue.keys());
+
     while (!m_generationQueue.empty()) {
       if (sectorGenerationLevelLimit && *sectorGenerationLevelLimit == 0)
         break;
@@ -274,6 +373,7 @@ void WorldStorage::generateQueue(Maybe<size_t> sectorGenerationLevelLimit, funct
 }
 
 void WorldStorage::tick(float dt, String const* worldId) {
+  STAR_PROFILE_SCOPE("WorldStorage::tick");
   try {
     // Tick down generation queue entries, and erase any that are expired.
     eraseWhere(m_generationQueue, [dt](auto& p) {
@@ -334,6 +434,7 @@ void WorldStorage::tick(float dt, String const* worldId) {
 
         if (!zombiesToStore.empty()) {
           EntitySectorStore sectorStore;
+          flushSectorWrite(entitySectorKey(sector));
           if (auto res = m_db.find(entitySectorKey(sector)))
             sectorStore = readEntitySector(*res);
 
@@ -345,14 +446,16 @@ void WorldStorage::tick(float dt, String const* worldId) {
               storedUniques.add(*uniqueId, {sector, entity->position()});
             sectorStore.append(entityFactory->storeVersionedEntity(entity));
           }
-          m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+          queueSectorWrite(entitySectorKey(sector), [sectorStore = std::move(sectorStore)]() { return writeEntitySector(sectorStore); });
           mergeSectorUniques(sector, storedUniques);
         }
       }
     }
+    flushSectorWrites();
+
     if (worldId) {
       LogMap::set(strf("server_{}_storage", *worldId),
-        strf("{} active, {}/{} unloaded ({} held)", m_sectorMetadata.size(), unloaded, skipped + unloaded, skipped));
+        strf("{} active, {}/{} unloaded ({} held), {} dormant", m_sectorMetadata.size(), unloaded, skipped + unloaded, skipped, m_dormantEntities.size()));
     }
   } catch (std::exception const& e) {
     m_db.rollback();
@@ -363,6 +466,8 @@ void WorldStorage::tick(float dt, String const* worldId) {
 
 void WorldStorage::unloadAll(bool force) {
   try {
+    finishBackgroundSync();
+
     auto storageConfig = Root::singleton().assets()->json("/worldstorage.config");
     auto sectors = m_sectorMetadata.keys();
 
@@ -383,6 +488,7 @@ void WorldStorage::unloadAll(bool force) {
     }
     for (auto& sector : sectors)
       unloadSectorToLevel(sector, SectorLoadLevel::None, force);
+    flushSectorWrites();
 
   } catch (std::exception const& e) {
     m_db.rollback();
@@ -392,10 +498,37 @@ void WorldStorage::unloadAll(bool force) {
 }
 
 void WorldStorage::sync() {
+  STAR_PROFILE_SCOPE("WorldStorage::sync");
   try {
-    for (auto const& pair : m_sectorMetadata)
-      syncSector(pair.first);
-    m_db.commit();
+    finishBackgroundSync();
+    flushSectorWrites();
+
+    // Growing a List would try to copy the move only snapshots
+    auto snapshots = make_shared<Deque<SectorSnapshot>>();
+    for (auto const& pair : m_sectorMetadata) {
+      if (auto snapshot = snapshotSector(pair.first))
+        snapshots->append(std::move(*snapshot));
+    }
+
+    if (!m_backgroundSync) {
+      BTreeDatabase::WriteBatch batch;
+      writeSectorSnapshots(*snapshots, batch);
+      m_db.writeBatch(std::move(batch));
+      m_db.commit();
+      compactDatabase();
+      return;
+    }
+
+    for (auto const& snapshot : *snapshots)
+      m_backgroundSyncSectors.add(snapshot.sector);
+
+    m_backgroundSyncThread = Thread::invoke("WorldStorage::sync", [this, snapshots]() {
+        BTreeDatabase::WriteBatch batch;
+        writeSectorSnapshots(*snapshots, batch);
+        m_db.writeBatch(std::move(batch));
+        m_db.commit();
+        compactDatabase();
+      });
   } catch (std::exception const& e) {
     m_db.rollback();
     m_db.close();
@@ -405,15 +538,24 @@ void WorldStorage::sync() {
 
 WorldChunks WorldStorage::readChunks() {
   try {
-    for (auto const& pair : m_sectorMetadata)
-      syncSector(pair.first);
+    finishBackgroundSync();
+    flushSectorWrites();
+
+    Deque<SectorSnapshot> snapshots;
+    for (auto const& pair : m_sectorMetadata) {
+      if (auto snapshot = snapshotSector(pair.first))
+        snapshots.append(std::move(*snapshot));
+    }
+    BTreeDatabase::WriteBatch batch;
+    writeSectorSnapshots(snapshots, batch);
+    m_db.writeBatch(std::move(batch));
 
     WorldChunks chunks;
-    m_db.forAll([&chunks](ByteArray k, ByteArray v) {
-        chunks.add(std::move(k), std::move(v));
-      });
+    auto cursor = m_db.scanAll(true);
+    while (cursor.next())
+      chunks.add(cursor.key(), cursor.value());
 
-    return WorldChunks(chunks);
+    return chunks;
 
   } catch (std::exception const& e) {
     m_db.rollback();
@@ -470,7 +612,7 @@ ByteArray WorldStorage::entitySectorKey(Sector const& sector) {
 }
 
 WorldStorage::EntitySectorStore WorldStorage::readEntitySector(ByteArray const& data) {
-  DataStreamBuffer ds(uncompressData(data));
+  DataStreamBuffer ds(uncompressSector(data));
   auto store = ds.read<EntitySectorStore>();
   for (auto& entity : store) {
     VersionedJson::readSubVersioning(ds, entity);
@@ -480,11 +622,17 @@ WorldStorage::EntitySectorStore WorldStorage::readEntitySector(ByteArray const&
 
 ByteArray WorldStorage::writeEntitySector(EntitySectorStore const& store) {
   DataStreamBuffer ds;
-  ds.write(store);
+  if (sectorCompression()->compactEntityJson) {
+    ds.writeVlqU(store.size());
+    for (auto const& entity : store)
+      VersionedJson::writeCompact(ds, entity);
+  } else {
+    ds.write(store);
+  }
   for (auto& entity : store) {
     VersionedJson::writeSubVersioning(ds, entity);
   }
-  return compressData(ds.data());
+  return compressSector(StoreType::EntitySector, ds.data());
 }
 
 ByteArray WorldStorage::tileSectorKey(Sector const& sector) {
@@ -501,7 +649,7 @@ WorldStorage::TileSectorStore WorldStorage::readTileSector(ByteArray const& data
   auto liqDatabase = root.liquidsDatabase();
   auto storageConfig = root.assets()->json("/worldstorage.config");
 
-  DataStreamBuffer ds(uncompressData(data));
+  DataStreamBuffer ds(uncompressSector(data));
   TileSectorStore store;
   ds.vuread(store.generationLevel);
   ds.vuread(store.tileSerializationVersion);
@@ -544,7 +692,31 @@ ByteArray WorldStorage::writeTileSector(TileSectorStore const& store) {
     for (size_t x = 0; x < WorldSectorSize; ++x)
       (*store.tiles)(x, y).write(ds);
   }
-  return compressData(ds.takeData());
+  return compressSector(StoreType::TileSector, ds.takeData());
+}
+
+ByteArray WorldStorage::compressSector(StoreType type, ByteArray const& data) {
+  auto compression = sectorCompression();
+  if (!compression->zstd)
+    return compressData(data);
+
+  auto const& dictionary = type == StoreType::TileSector ? compression->tileDictionary : compression->entityDictionary;
+  if (dictionary)
+    return dictionary->compress(data);
+  return ZstdCompression::compress(data, compression->level);
+}
+
+ByteArray WorldStorage::uncompressSector(ByteArray const& data) {
+  if (!ZstdCompression::isFrame(data))
+    return uncompressData(data);
+
+  unsigned dictionaryId = ZstdCompression::frameDictionaryId(data);
+  if (dictionaryId == 0)
+    return ZstdCompression::decompress(data);
+
+  if (auto dictionary = sectorCompression()->dictionaries.value(dictionaryId))
+    return dictionary->decompress(data);
+  throw WorldStorageException::format("Sector was compressed with unknown zstd dictionary {}", dictionaryId);
 }
 
 ByteArray WorldStorage::uniqueIndexKey(String const& uniqueId) {
@@ -595,6 +767,10 @@ void WorldStorage::openDatabase(BTreeDatabase& db, IODevicePtr device) {
   db.setKeySize(5);
   db.setIODevice(std::move(device));
   db.setBlockSize(2048);
+  auto storageConfig = Root::singleton().assets()->json("/worldstorage.config");
+  db.setMemoryMapped(storageConfig.getBool("memoryMappedReads", false));
+  db.setLeafCacheSize(storageConfig.getUInt("leafCacheSize", 0));
+  db.setBloomFilter(storageConfig.getBool("bloomFilter", false));
   db.setAutoCommit(false);
   db.open();
 
@@ -606,6 +782,19 @@ WorldStorage::WorldStorage() {
   auto storageConfig = Root::singleton().assets()->json("/worldstorage.config");
   m_sectorTimeToLive = jsonToVec2F(storageConfig.get("sectorTimeToLive"));
   m_generationQueueTimeToLive = storageConfig.getFloat("generationQueueTimeToLive");
+  m_generationPrefetchSectors = storageConfig.getUInt("generationPrefetchSectors", 0);
+  m_generationPrefetchThreads = storageConfig.getUInt("generationPrefetchThreads", 1);
+  if (m_generationPrefetchThreads == 0)
+    m_generationPrefetchThreads = max<unsigned>(Thread::numberOfProcessors(), 2) - 1;
+  m_backgroundSync = storageConfig.getBool("backgroundSync", false);
+  m_compactionFreeRatio = storageConfig.getFloat("compactionFreeRatio", 0.0f);
+  m_compactionBlockBudget = storageConfig.getUInt("compactionBlockBudget", 256);
+
+  auto dormantConfig = storageConfig.get("dormantEntities", JsonObject());
+  if (dormantConfig.getBool("enabled", false)) {
+    for (auto const& type : dormantConfig.getArray("entityTypes", {}))
+      m_dormantEntityTypes.add(EntityTypeNames.getLeft(type.toString()));
+  }
 }
 
 bool WorldStorage::belongsInSector(Sector const& sector, Vec2F const& position) const {
@@ -626,6 +815,7 @@ pair<bool, size_t> WorldStorage::generateSectorToLevel(Sector const& sector, Sec
   auto& metadata = m_sectorMetadata[sector];
 
   if (targetGenerationLevel == SectorGenerationLevel::Complete && metadata.generationLevel == SectorGenerationLevel::Terraform) {
+    materializeSector(sector);
     m_generatorFacade->terraformSector(this, sector);
     metadata.generationLevel = SectorGenerationLevel::Complete;
     metadata.timeToLive = randomizedSectorTTL();
@@ -636,6 +826,8 @@ pair<bool, size_t> WorldStorage::generateSectorToLevel(Sector const& sector, Sec
     return {true, 0};
 
   metadata.timeToLive = randomizedSectorTTL();
+  // Generation places things against whatever is already in the sector
+  materializeSector(sector);
 
   size_t totalGeneratedLevels = 0;
   for (uint8_t i = (uint8_t)metadata.generationLevel + 1; i <= (uint8_t)targetGenerationLevel; ++i) {
@@ -662,6 +854,31 @@ pair<bool, size_t> WorldStorage::generateSectorToLevel(Sector const& sector, Sec
   return {true, totalGeneratedLevels};
 }
 
+void WorldStorage::prefetchSectors(List<Sector> const& sectors) {
+  size_t prefetched = 0;
+  for (auto const& queuedSector : sectors) {
+    if (prefetched++ >= m_generationPrefetchSectors)
+      break;
+
+    // Generating a sector first generates the sectors around it to the
+    // previous level, so they need their base tiles as well.
+    auto prefetchSectors = adjacentSectors(queuedSector);
+    prefetchSectors.append(queuedSector);
+    for (auto const& sector : prefetchSectors) {
+      if (!m_tileArray->sectorValid(sector))
+        continue;
+
+      loadSectorToLevel(sector, SectorLoadLevel::Tiles);
+      if (m_sectorMetadata.value(sector).generationLevel < SectorGenerationLevel::BaseTiles)
+        m_generatorFacade->prefetchSectorLevel(this, sector, SectorGenerationLevel::BaseTiles);
+    }
+  }
+}
+
+unsigned WorldStorage::generationPrefetchThreads() const {
+  return m_generationPrefetchThreads;
+}
+
 void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targetLoadLevel) {
   if (!m_tileArray->sectorValid(sector))
     return;
@@ -684,6 +901,8 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
     }
 
     if (currentLoad == SectorLoadLevel::Tiles) {
+      MemoryTagScope memoryTag(MemoryTag::Tiles);
+      flushSectorWrite(tileSectorKey(sector));
       if (auto res = m_db.find(tileSectorKey(sector))) {
         TileSectorStore sectorStore = readTileSector(*res);
 
@@ -700,9 +919,21 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
 
     } else if (currentLoad == SectorLoadLevel::Entities) {
       List<EntityPtr> addedEntities;
+      List<VersionedJson> dormantEntities;
+      flushSectorWrite(entitySectorKey(sector));
       if (auto res = m_db.find(entitySectorKey(sector))) {
         EntitySectorStore sectorStore = readEntitySector(*res);
         for (auto const& entityStore : sectorStore) {
+          // Unique entities are always constructed, as they can be looked up
+          // from anywhere by their id.
+          if (!m_dormantEntityTypes.empty()) {
+            auto type = entityFactory->versionedEntityType(entityStore);
+            if (type && m_dormantEntityTypes.contains(*type) && !entityStore.content.optString("uniqueId")) {
+              dormantEntities.append(entityStore);
+              continue;
+            }
+          }
+
           try {
             addedEntities.append(entityFactory->loadVersionedEntity(entityStore));
           } catch (std::exception const& e) {
@@ -723,6 +954,9 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
       // and there are stale entries in the index.
       updateSectorUniques(sector, readUniques);
 
+      if (!dormantEntities.empty())
+        m_dormantEntities[sector] = std::move(dormantEntities);
+
       metadata.loadLevel = currentLoad;
       m_generatorFacade->sectorLoadLevelChanged(this, sector, currentLoad);
     }
@@ -733,6 +967,8 @@ bool WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
   if (!m_tileArray->sectorValid(sector) || targetLoadLevel == SectorLoadLevel::Loaded)
     return true;
 
+  waitForBackgroundSync(sector);
+
   auto& metadata = m_sectorMetadata[sector];
   bool entitiesOverlap = false;
   if (m_entityMap) {
@@ -775,8 +1011,11 @@ bool WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
       // not loaded, we need to load and merge with them, otherwise we should be
       // overwriting them.
       if (metadata.loadLevel < SectorLoadLevel::Entities) {
+        flushSectorWrite(entitySectorKey(sector));
         if (auto res = m_db.find(entitySectorKey(sector)))
           sectorStore = readEntitySector(*res);
+      } else if (auto dormant = m_dormantEntities.maybeTake(sector)) {
+        sectorStore = dormant.take();
       }
 
       UniqueIndexStore storedUniques;
@@ -788,7 +1027,7 @@ bool WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
           storedUniques.add(*uniqueId, {sector, position});
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
-      m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+      queueSectorWrite(entitySectorKey(sector), [sectorStore = std::move(sectorStore)]() { return writeEntitySector(sectorStore); });
       if (metadata.loadLevel < SectorLoadLevel::Entities)
         mergeSectorUniques(sector, storedUniques);
       else
@@ -806,7 +1045,10 @@ bool WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
       TileSectorStore sectorStore;
       sectorStore.tiles = m_tileArray->unloadSector(sector);
       sectorStore.generationLevel = metadata.generationLevel;
-      m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
+      // The tile store is move only, but the encoder must be copyable
+      queueSectorWrite(tileSectorKey(sector), [sectorStore = make_shared<TileSectorStore>(std::move(sectorStore))]() {
+          return writeTileSector(*sectorStore);
+        });
       m_sectorMetadata.remove(sector);
       m_generatorFacade->sectorLoadLevelChanged(this, sector, SectorLoadLevel::None);
       return true;
@@ -817,11 +1059,24 @@ bool WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
 }
 
 void WorldStorage::syncSector(Sector const& sector) {
+  waitForBackgroundSync(sector);
+  if (auto snapshot = snapshotSector(sector)) {
+    Deque<SectorSnapshot> snapshots;
+    snapshots.append(std::move(*snapshot));
+    BTreeDatabase::WriteBatch batch;
+    writeSectorSnapshots(snapshots, batch);
+    m_db.writeBatch(std::move(batch));
+  }
+}
+
+Maybe<WorldStorage::SectorSnapshot> WorldStorage::snapshotSector(Sector const& sector) {
   if (!m_tileArray->sectorValid(sector))
-    return;
+    return {};
 
   auto entityFactory = Root::singleton().entityFactory();
   auto& metadata = m_sectorMetadata[sector];
+  SectorSnapshot snapshot;
+  snapshot.sector = sector;
 
   // Only sync the levels that we know are loaded.  It is possible that this
   // sector is at load level < Entities but has zombie entities in it,  but
@@ -829,7 +1084,7 @@ void WorldStorage::syncSector(Sector const& sector) {
   // entities will be unloaded in update eventually anyway.
 
   if (metadata.loadLevel >= SectorLoadLevel::Entities) {
-    EntitySectorStore sectorStore;
+    EntitySectorStore sectorStore = m_dormantEntities.value(sector);
     UniqueIndexStore storedUniques;
     for (auto const& entity : m_entityMap->entityQuery(RectF(m_tileArray->sectorRegion(sector)))) {
       if (!belongsInSector(sector, entity->position()))
@@ -841,7 +1096,7 @@ void WorldStorage::syncSector(Sector const& sector) {
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
     }
-    m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
+    snapshot.entities = std::move(sectorStore);
     updateSectorUniques(sector, storedUniques);
   }
 
@@ -849,8 +1104,74 @@ void WorldStorage::syncSector(Sector const& sector) {
     TileSectorStore sectorStore;
     sectorStore.tiles = m_tileArray->copySector(sector);
     sectorStore.generationLevel = metadata.generationLevel;
-    m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
+    snapshot.tiles = std::move(sectorStore);
   }
+
+  return snapshot;
+}
+
+void WorldStorage::writeSectorSnapshots(Deque<SectorSnapshot> const& snapshots, BTreeDatabase::WriteBatch& batch) {
+  List<pair<Maybe<ByteArray>, Maybe<ByteArray>>> encoded(snapshots.size());
+  sectorWorkerPool().parallelFor(0, snapshots.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        auto const& snapshot = snapshots[i];
+        if (snapshot.entities)
+          encoded[i].first = writeEntitySector(*snapshot.entities);
+        if (snapshot.tiles)
+          encoded[i].second = writeTileSector(*snapshot.tiles);
+      }
+    });
+
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    if (encoded[i].first)
+      batch.insert(entitySectorKey(snapshots[i].sector), encoded[i].first.take());
+    if (encoded[i].second)
+      batch.insert(tileSectorKey(snapshots[i].sector), encoded[i].second.take());
+  }
+}
+
+void WorldStorage::queueSectorWrite(ByteArray key, function<ByteArray()> encode) {
+  m_sectorWriteKeys.add(key);
+  m_sectorWrites.append({std::move(key), sectorWorkerPool().addProducer<ByteArray>(std::move(encode))});
+}
+
+void WorldStorage::flushSectorWrites() {
+  auto writes = take(m_sectorWrites);
+  m_sectorWriteKeys.clear();
+  // Anything queued before a failure is lost with the rest of the rolled back
+  // changes.
+  if (!m_db.isOpen())
+    return;
+  for (auto& write : writes)
+    m_db.insert(write.first, write.second.get());
+}
+
+void WorldStorage::flushSectorWrite(ByteArray const& key) {
+  if (m_sectorWriteKeys.contains(key))
+    flushSectorWrites();
+}
+
+void WorldStorage::finishBackgroundSync() {
+  m_backgroundSyncSectors.clear();
+  auto thread = take(m_backgroundSyncThread);
+  thread.finish();
+}
+
+void WorldStorage::waitForBackgroundSync(Sector const& sector) {
+  if (m_backgroundSyncSectors.contains(sector))
+    finishBackgroundSync();
+}
+
+void WorldStorage::compactDatabase() {
+  if (m_compactionFreeRatio <= 0.0f)
+    return;
+
+  uint32_t totalBlocks = m_db.totalBlockCount();
+  if (totalBlocks == 0 || m_db.freeBlockCount() < totalBlocks * m_compactionFreeRatio)
+    return;
+
+  if (uint32_t relocated = m_db.compact(m_compactionBlockBudget))
+    Logger::debug("WorldStorage: compacted world database, relocated {} blocks", relocated);
 }
 
 List<WorldStorage::Sector> WorldStorage::adjacentSectors(Sector const& sector) const {
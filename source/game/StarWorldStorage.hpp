@@ -7,6 +7,8 @@
 #include "StarWorldTiles.hpp"
 #include "StarRpcPromise.hpp"
 #include "StarBiomePlacement.hpp"
+#include "StarThread.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -49,6 +51,11 @@ struct WorldGeneratorFacade {
 
   virtual void sectorLoadLevelChanged(WorldStorage* storage, Sector const& sector, SectorLoadLevel loadLevel) = 0;
 
+  // Called for sectors that will soon be brought to the given generation
+  // level, so any part of that work which does not need the world can be
+  // started in the background.  May be called repeatedly for the same sector.
+  virtual void prefetchSectorLevel(WorldStorage*, Sector const&, SectorGenerationLevel) {}
+
   // Perform terraforming operations (biome reapplication) on the given sector
   virtual void terraformSector(WorldStorage* storage, Sector const& sector) = 0;
 
@@ -126,8 +133,13 @@ public:
   // sector.
   void activateSector(Sector sector);
   // Queue the given sector for activation, if it is not already active.  If
-  // the sector is loaded at all, also resets the TTL.
-  void queueSectorActivation(Sector sector);
+  // the sector is loaded at all, also resets the TTL.  Unless prioritized is
+  // false, the sector is moved to the front of the queue.
+  void queueSectorActivation(Sector sector, bool prioritized = true);
+  // Construct and add to the world any entities in this sector that were
+  // left dormant when the sector was loaded.  Does nothing if the sector has
+  // no dormant entities.
+  void materializeSector(Sector sector);
 
   // Immediately (synchronously) fully generates the sector, then flags it as requiring
   // terraforming (biome reapplication) which will be handled by the normal generation process
@@ -158,6 +170,13 @@ public:
   // given.  If sectorOrdering is given, then it will be used to prioritize the
   // queued sectors.
   void generateQueue(Maybe<size_t> sectorGenerationLevelLimit, function<bool(Sector, Sector)> sectorOrdering = {});
+  // Lets the generator facade begin base tile generation in the background
+  // for up to generationPrefetchSectors of the given sectors and the sectors
+  // around them, ahead of generating them.  Does nothing if prefetching is
+  // disabled.
+  void prefetchSectors(List<Sector> const& sectors);
+  // Number of threads the generator facade should prefetch with.
+  unsigned generationPrefetchThreads() const;
   // Ticks down the TTL on sectors and generation queue entries, stores old
   // sectors, expires old generation queue entries, and unloads any zombie
   // entities.
@@ -168,7 +187,9 @@ public:
   void unloadAll(bool force = false);
 
   // Sync all active sectors without unloading them, and commits the underlying
-  // database.
+  // database.  If background sync is enabled, this only takes a snapshot of
+  // the active sectors, and they are written and committed on another thread.
+  // Any previous background sync is finished first.
   void sync();
 
   // Syncs all active sectors to disk and stores the full content of the world
@@ -213,6 +234,14 @@ private:
     TileArrayPtr tiles;
   };
 
+  // Everything syncSector stores for a sector, taken on the world thread so
+  // the store can be written elsewhere
+  struct SectorSnapshot {
+    Sector sector;
+    Maybe<EntitySectorStore> entities;
+    Maybe<TileSectorStore> tiles;
+  };
+
   struct SectorMetadata {
     SectorMetadata();
 
@@ -233,6 +262,11 @@ private:
   static TileSectorStore readTileSector(ByteArray const& data);
   static ByteArray writeTileSector(TileSectorStore const& store);
 
+  // Entity and tile sectors are compressed with zstd when configured in
+  // worldstorage.config, and read back as either zstd or legacy zlib data.
+  static ByteArray compressSector(StoreType type, ByteArray const& data);
+  static ByteArray uncompressSector(ByteArray const& data);
+
   static ByteArray uniqueIndexKey(String const& uniqueId);
   static UniqueIndexStore readUniqueIndexStore(ByteArray const& data);
   static ByteArray writeUniqueIndexStore(UniqueIndexStore const& store);
@@ -270,6 +304,30 @@ private:
   // Sync this sector to disk without unloading it.
   void syncSector(Sector const& sector);
 
+  // Collects the stores for a sector and updates its unique index entries
+  Maybe<SectorSnapshot> snapshotSector(Sector const& sector);
+  // Writes snapshots to the database, encoding and compressing them in
+  // parallel on the sector worker pool.  Does not touch any world state so is
+  // safe to call from the background sync thread.
+  void writeSectorSnapshots(Deque<SectorSnapshot> const& snapshots, BTreeDatabase::WriteBatch& batch);
+
+  // Stores written when unloading sectors are encoded and compressed on the
+  // sector worker pool, and only written to the database by
+  // flushSectorWrites, in the order they were queued.
+  void queueSectorWrite(ByteArray key, function<ByteArray()> encode);
+  void flushSectorWrites();
+  // Flushes first if a store for this key is still queued, must be called
+  // before reading a sector store back.
+  void flushSectorWrite(ByteArray const& key);
+
+  // Waits for the background sync to complete, rethrowing its failure
+  void finishBackgroundSync();
+  // Runs one compaction step on the committed database once enough of it is
+  // free.
+  void compactDatabase();
+  // Finishes the background sync first if it is going to write this sector
+  void waitForBackgroundSync(Sector const& sector);
+
   // Returns the sectors within WorldSectorSize of the given sector.  This is
   // *not exactly the same* as the surrounding 9 sectors in a square pattern,
   // because first this does not return invalid sectors, and second, If a world
@@ -290,6 +348,23 @@ private:
 
   Vec2F m_sectorTimeToLive;
   float m_generationQueueTimeToLive;
+  size_t m_generationPrefetchSectors;
+  unsigned m_generationPrefetchThreads;
+
+  bool m_backgroundSync;
+  ThreadFunction<void> m_backgroundSyncThread;
+  HashSet<Sector> m_backgroundSyncSectors;
+
+  List<pair<ByteArray, WorkerPoolPromise<ByteArray>>> m_sectorWrites;
+  HashSet<ByteArray> m_sectorWriteKeys;
+
+  float m_compactionFreeRatio;
+  unsigned m_compactionBlockBudget;
+
+  // Stored entities of these types are kept in their serialized form when
+  // their sector loads, until the sector is materialized.
+  HashSet<EntityType> m_dormantEntityTypes;
+  HashMap<Sector, List<VersionedJson>> m_dormantEntities;
 
   ServerTileSectorArrayPtr m_tileArray;
   EntityMapPtr m_entityMap;
@@ -31,12 +31,8 @@ WorldTemplate::WorldTemplate(CelestialCoordinate const& celestialCoordinate, Cel
   m_seed = m_celestialParameters->seed();
   m_geometry = WorldGeometry(m_worldParameters->worldSize);
 
-  if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildTerrestrialLayout(*terrestrialParameters, m_seed));
-  else if (auto asteroidsParameters = as<AsteroidsWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildAsteroidsLayout(*asteroidsParameters, m_seed));
-  else if (auto floatingDungeonParameters = as<FloatingDungeonWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildFloatingDungeonLayout(*floatingDungeonParameters, m_seed));
+  m_layout = sharedLayout(m_worldParameters, m_seed);
+  m_layoutShared = true;
 
   determineWorldName();
 }
@@ -51,12 +47,8 @@ WorldTemplate::WorldTemplate(VisitableWorldParametersConstPtr const& worldParame
   m_seed = seed;
   m_geometry = WorldGeometry(m_worldParameters->worldSize);
 
-  if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildTerrestrialLayout(*terrestrialParameters, seed));
-  else if (auto asteroidsParameters = as<AsteroidsWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildAsteroidsLayout(*asteroidsParameters, seed));
-  else if (auto floatingDungeonParameters = as<FloatingDungeonWorldParameters>(m_worldParameters))
-    m_layout = make_shared<WorldLayout>(WorldLayout::buildFloatingDungeonLayout(*floatingDungeonParameters, m_seed));
+  m_layout = sharedLayout(m_worldParameters, m_seed);
+  m_layoutShared = true;
 
   determineWorldName();
 }
@@ -115,8 +107,10 @@ void WorldTemplate::setWorldParameters(VisitableWorldParametersPtr newParameters
 }
 
 void WorldTemplate::setWorldLayout(WorldLayoutPtr newLayout) {
+  WriteLocker locker(m_blockInfoLock);
   m_layout = take(newLayout);
-  m_blockCache.clear();
+  m_layoutShared = false;
+  invalidateBlockInfo();
 }
 
 void WorldTemplate::setSkyParameters(SkyParameters newParameters) {
@@ -186,18 +180,21 @@ Maybe<Vec2I> WorldTemplate::findSensiblePlayerStart() const {
 }
 
 void WorldTemplate::addCustomTerrainRegion(PolyF poly) {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.append({poly, poly.boundBox(), true});
-  m_blockCache.clear();
+  invalidateBlockInfo();
 }
 
 void WorldTemplate::addCustomSpaceRegion(PolyF poly) {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.append({poly, poly.boundBox(), false});
-  m_blockCache.clear();
+  invalidateBlockInfo();
 }
 
 void WorldTemplate::clearCustomTerrains() {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.clear();
-  m_blockCache.clear();
+  invalidateBlockInfo();
 }
 
 List<RectI> WorldTemplate::previewAddBiomeRegion(Vec2I const& position, int width) {
@@ -230,8 +227,10 @@ List<RectI> WorldTemplate::previewExpandBiomeRegion(Vec2I const& position, int n
 
 void WorldTemplate::addBiomeRegion(Vec2I const& position, String const& biomeName, String const& subBlockSelector, int width) {
   if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters)) {
+    WriteLocker locker(m_blockInfoLock);
+    unshareLayout();
     m_layout->addBiomeRegion(*terrestrialParameters, m_seed, position, biomeName, subBlockSelector, width);
-    m_blockCache.clear();
+    invalidateBlockInfo();
   } else {
     Logger::error("Cannot add biome region to non-terrestrial world!");
     // throw StarException("Cannot add biome region to non-terrestrial world!");
@@ -240,14 +239,24 @@ void WorldTemplate::addBiomeRegion(Vec2I const& position, String const& biomeNam
 
 void WorldTemplate::expandBiomeRegion(Vec2I const& position, int newWidth) {
   if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters)) {
+    WriteLocker locker(m_blockInfoLock);
+    unshareLayout();
     m_layout->expandBiomeRegion(position, newWidth);
-    m_blockCache.clear();
+    invalidateBlockInfo();
   } else {
     Logger::error("Cannot expand biome region on non-terrestrial world!");
     // throw StarException("Cannot expand biome region on non-terrestrial world!");
   }
 }
 
+String WorldTemplate::setLayerEnvironmentBiome(Vec2I const& position) {
+  WriteLocker locker(m_blockInfoLock);
+  unshareLayout();
+  auto biomeName = m_layout->setLayerEnvironmentBiome(position);
+  invalidateBlockInfo();
+  return biomeName;
+}
+
 List<WorldTemplate::Dungeon> WorldTemplate::dungeons() const {
   List<Dungeon> dungeonList;
 
@@ -282,6 +291,7 @@ WorldTemplate::BlockInfo WorldTemplate::blockInfo(int x, int y) const {
 }
 
 WorldTemplate::BlockInfo WorldTemplate::blockBiomeInfo(int x, int y) const {
+  ReadLocker locker(m_blockInfoLock);
   BlockInfo blockInfo;
 
   if (!m_layout)
@@ -577,11 +587,49 @@ WorldTemplate::WorldTemplate() {
   m_customTerrainBlendSize = m_templateConfig.getFloat("customTerrainBlendSize");
   m_customTerrainBlendWeight = m_templateConfig.getFloat("customTerrainBlendWeight");
 
-  m_blockCache.setMaxSize(m_templateConfig.getInt("blockCacheSize"));
+  // blockCacheSize is the older per tile limit, kept for configs that only
+  // set that.
+  m_blockCache.setMemoryBudget(m_templateConfig.optUInt("blockCacheMemory")
+      .value(m_templateConfig.getUInt("blockCacheSize", 0) * sizeof(BlockInfo)));
   m_geometry = Vec2U(2048, 2048);
   m_seed = Random::randu64();
 }
 
+WorldLayoutPtr WorldTemplate::sharedLayout(VisitableWorldParametersConstPtr const& worldParameters, uint64_t seed) {
+  // Held weakly, a layout is only shared while some template still uses it.
+  static Mutex layoutsMutex;
+  static HashMap<pair<uint64_t, Json>, weak_ptr<WorldLayout>> layouts;
+
+  auto key = make_pair(seed, worldParameters->store());
+  {
+    MutexLocker locker(layoutsMutex);
+    if (auto layout = layouts.value(key).lock())
+      return layout;
+  }
+
+  WorldLayoutPtr layout;
+  if (auto terrestrialParameters = as<TerrestrialWorldParameters>(worldParameters))
+    layout = make_shared<WorldLayout>(WorldLayout::buildTerrestrialLayout(*terrestrialParameters, seed));
+  else if (auto asteroidsParameters = as<AsteroidsWorldParameters>(worldParameters))
+    layout = make_shared<WorldLayout>(WorldLayout::buildAsteroidsLayout(*asteroidsParameters, seed));
+  else if (auto floatingDungeonParameters = as<FloatingDungeonWorldParameters>(worldParameters))
+    layout = make_shared<WorldLayout>(WorldLayout::buildFloatingDungeonLayout(*floatingDungeonParameters, seed));
+  else
+    return {};
+
+  MutexLocker locker(layoutsMutex);
+  eraseWhere(layouts, [](auto const& p) { return p.second.expired(); });
+  layouts[key] = layout;
+  return layout;
+}
+
+void WorldTemplate::unshareLayout() {
+  if (m_layoutShared && m_layout) {
+    m_layout = make_shared<WorldLayout>(m_layout->clone());
+  }
+  m_layoutShared = false;
+}
+
 void WorldTemplate::determineWorldName() {
   if (m_celestialParameters)
     m_worldName = m_celestialParameters->name();
@@ -623,162 +671,188 @@ pair<float, float> WorldTemplate::customTerrainWeighting(int x, int y) const {
   return {finalSolidWeight * m_customTerrainBlendWeight, 1.0f - minimumDistance / m_customTerrainBlendSize};
 }
 
+uint64_t WorldTemplate::blockInfoVersion() const {
+  return m_blockInfoVersion;
+}
+
 WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) const {
-  return m_blockCache.get(Vector<uint32_t, 2>(x, y), [this, x, y](Vector<uint32_t, 2>) {
-      BlockInfo blockInfo;
-
-      if (!m_layout)
-        return blockInfo;
-
-      // The environment biome is calculated with weighting based on the flat coordinates.
-      List<WorldLayout::RegionWeighting> flatWeighting = m_layout->getWeighting(x, y);
-
-      // The block biome is calculated optionally with higher frequency noise
-      // added to prevent straight lines appearing on the boundaries of
-      // regions.
-
-      int blendNoiseOffset = 0;
-      if (auto const& blendNoise = m_layout->blendNoise())
-        blendNoiseOffset = (int)blendNoise->get(x, y);
-
-      Vec2I blockPos;
-      List<WorldLayout::RegionWeighting> blockWeighting;
-      List<WorldLayout::RegionWeighting> transitionWeighting;
-      if (auto const& blockNoise = m_layout->blockNoise()) {
-        blockPos = blockNoise->apply(Vec2I(x, y), m_geometry.size());
-        blockWeighting = m_layout->getWeighting(blockPos[0] + blendNoiseOffset, blockPos[1]);
-        transitionWeighting = m_layout->getWeighting(blockPos[0], blockPos[1]);
-      } else {
-        blockPos = Vec2I(x, y);
-        blockWeighting = flatWeighting;
-        transitionWeighting = flatWeighting;
-      }
+  Vec2I key(x, y);
+  {
+    MutexLocker cacheLocker(m_blockCacheMutex);
+    if (auto blockInfo = m_blockCache.ptr(key))
+      return *blockInfo;
+  }
 
-      if (flatWeighting.empty() || blockWeighting.empty())
-        return blockInfo;
+  // Calculated outside of the cache lock so that other threads can calculate
+  // their own tiles at the same time, but still inside the read lock so that
+  // nothing calculated against an old layout is cached after it changes.
+  ReadLocker locker(m_blockInfoLock);
+  BlockInfo blockInfo = calculateBlockInfo(x, y);
+  MutexLocker cacheLocker(m_blockCacheMutex);
+  m_blockCache.set(key, blockInfo);
+  return blockInfo;
+}
 
-      auto const& primaryFlatWeighting = flatWeighting.first();
-      auto const& primaryBlockWeighting = blockWeighting.first();
+WorldTemplate::BlockInfo WorldTemplate::calculateBlockInfo(uint32_t x, uint32_t y) const {
+  BlockInfo blockInfo;
 
-      blockInfo.blockBiomeIndex = primaryBlockWeighting.region->blockBiomeIndex;
-      blockInfo.environmentBiomeIndex = primaryFlatWeighting.region->environmentBiomeIndex;
+  if (!m_layout)
+    return blockInfo;
 
-      blockInfo.biomeTransition = transitionWeighting.first().weight < m_templateConfig.getFloat("biomeTransitionThreshold", 0);
+  // The environment biome is calculated with weighting based on the flat coordinates.
+  List<WorldLayout::RegionWeighting> flatWeighting = m_layout->getWeighting(x, y);
 
-      float terrainSelect = 0.0f;
-      float foregroundCaveSelect = 0.0f;
-      float backgroundCaveSelect = 0.0f;
+  // The block biome is calculated optionally with higher frequency noise
+  // added to prevent straight lines appearing on the boundaries of
+  // regions.
 
-      // Terrain weighting uses the flat weighting, and weights each selector
-      // to blend among them.
-      for (auto const& weighting : flatWeighting) {
-        if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex) {
-          auto const& terrainSelector = m_layout->getTerrainSelector(weighting.region->terrainSelectorIndex);
-          float select = terrainSelector->get(weighting.xValue, y) * weighting.weight;
-          terrainSelect += select;
-        }
-      }
+  int blendNoiseOffset = 0;
+  if (auto const& blendNoise = m_layout->blendNoise())
+    blendNoiseOffset = (int)blendNoise->get(x, y);
 
-      // This is a bit of a cheat. Since customTerrainWeighting is always flat,
-      // there are some odd effects that come from linearly interpolating from
-      // the generally non-flat terrain sources to flat regions of space.  By
-      // using an interpolator that has an exaggerated S curve between the
-      // points, this hides some of these effects.
-      auto ctweighting = customTerrainWeighting(x, y);
-      terrainSelect = quintic2(ctweighting.second, terrainSelect, ctweighting.first);
-
-      if (terrainSelect > 0.0f) {
-        blockInfo.terrain = true;
-
-        for (auto const& weighting : flatWeighting) {
-          if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-            auto const& foregroundCaveSelector = m_layout->getTerrainSelector(weighting.region->foregroundCaveSelectorIndex);
-            foregroundCaveSelect += foregroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-          }
+  Vec2I blockPos;
+  List<WorldLayout::RegionWeighting> blockWeighting;
+  List<WorldLayout::RegionWeighting> transitionWeighting;
+  if (auto const& blockNoise = m_layout->blockNoise()) {
+    blockPos = blockNoise->apply(Vec2I(x, y), m_geometry.size());
+    blockWeighting = m_layout->getWeighting(blockPos[0] + blendNoiseOffset, blockPos[1]);
+    transitionWeighting = m_layout->getWeighting(blockPos[0], blockPos[1]);
+  } else {
+    blockPos = Vec2I(x, y);
+    blockWeighting = flatWeighting;
+    transitionWeighting = flatWeighting;
+  }
 
-          if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-            auto const& backgroundCaveSelector = m_layout->getTerrainSelector(weighting.region->backgroundCaveSelectorIndex);
-            backgroundCaveSelect += backgroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-          }
-        }
+  if (flatWeighting.empty() || blockWeighting.empty())
+    return blockInfo;
 
-        auto surfaceCaveAttenuationDist = m_templateConfig.getFloat("surfaceCaveAttenuationDist", 0);
-        if (terrainSelect < surfaceCaveAttenuationDist) {
-          auto surfaceCaveAttenuationFactor = m_templateConfig.getFloat("surfaceCaveAttenuationFactor", 1);
-          foregroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
-          backgroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
-        }
-      }
+  auto const& primaryFlatWeighting = flatWeighting.first();
+  auto const& primaryBlockWeighting = blockWeighting.first();
 
-      blockInfo.foregroundCave = foregroundCaveSelect > 0.0f;
-      blockInfo.backgroundCave = backgroundCaveSelect > 0.0f;
+  blockInfo.blockBiomeIndex = primaryBlockWeighting.region->blockBiomeIndex;
+  blockInfo.environmentBiomeIndex = primaryFlatWeighting.region->environmentBiomeIndex;
+
+  blockInfo.biomeTransition = transitionWeighting.first().weight < m_templateConfig.getFloat("biomeTransitionThreshold", 0);
 
-      auto const& regionLiquids = primaryFlatWeighting.region->regionLiquids;
-      blockInfo.caveLiquid = regionLiquids.caveLiquid;
-      blockInfo.caveLiquidSeedDensity = regionLiquids.caveLiquidSeedDensity;
-      blockInfo.oceanLiquid = regionLiquids.oceanLiquid;
-      blockInfo.oceanLiquidLevel = regionLiquids.oceanLiquidLevel;
-      blockInfo.encloseLiquids = regionLiquids.encloseLiquids;
-      blockInfo.fillMicrodungeons = regionLiquids.fillMicrodungeons;
+  float terrainSelect = 0.0f;
+  float foregroundCaveSelect = 0.0f;
+  float backgroundCaveSelect = 0.0f;
+
+  // Terrain weighting uses the flat weighting, and weights each selector
+  // to blend among them.
+  for (auto const& weighting : flatWeighting) {
+    if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex) {
+      auto const& terrainSelector = m_layout->getTerrainSelector(weighting.region->terrainSelectorIndex);
+      float select = terrainSelector->get(weighting.xValue, y) * weighting.weight;
+      terrainSelect += select;
+    }
+  }
 
-      if (!blockInfo.terrain && blockInfo.encloseLiquids && (int)y < blockInfo.oceanLiquidLevel) {
-        blockInfo.terrain = true;
-        blockInfo.foregroundCave = true;
+  // This is a bit of a cheat. Since customTerrainWeighting is always flat,
+  // there are some odd effects that come from linearly interpolating from
+  // the generally non-flat terrain sources to flat regions of space.  By
+  // using an interpolator that has an exaggerated S curve between the
+  // points, this hides some of these effects.
+  auto ctweighting = customTerrainWeighting(x, y);
+  terrainSelect = quintic2(ctweighting.second, terrainSelect, ctweighting.first);
+
+  if (terrainSelect > 0.0f) {
+    blockInfo.terrain = true;
+
+    for (auto const& weighting : flatWeighting) {
+      if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex) {
+        auto const& foregroundCaveSelector = m_layout->getTerrainSelector(weighting.region->foregroundCaveSelectorIndex);
+        foregroundCaveSelect += foregroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
       }
 
-      if (blockInfo.terrain) {
-        if (auto blockBiome = biome(blockInfo.blockBiomeIndex)) {
-          if (!blockInfo.foregroundCave) {
-            blockInfo.foreground = blockBiome->mainBlock;
-            blockInfo.background = blockInfo.foreground;
-          } else if (!blockInfo.backgroundCave) {
-            blockInfo.background = blockBiome->mainBlock;
-          }
+      if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex) {
+        auto const& backgroundCaveSelector = m_layout->getTerrainSelector(weighting.region->backgroundCaveSelectorIndex);
+        backgroundCaveSelect += backgroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
+      }
+    }
 
-          // subBlock, foregroundOre, and backgroundOre selectors can be empty
-          // if they are not enabled, otherwise they will always have the
-          // correct count
-
-          if (!primaryBlockWeighting.region->subBlockSelectorIndexes.empty()) {
-            for (size_t i = 0; i < blockBiome->subBlocks.size(); ++i) {
-              auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->subBlockSelectorIndexes.at(i));
-              if (selector->get(primaryBlockWeighting.xValue - blendNoiseOffset, blockPos[1]) > 0.0f) {
-                if (!blockInfo.foregroundCave) {
-                  blockInfo.foreground = blockBiome->subBlocks.at(i);
-                  blockInfo.background = blockInfo.foreground;
-                } else if (!blockInfo.backgroundCave) {
-                  blockInfo.background = blockBiome->subBlocks.at(i);
-                }
-
-                break;
-              }
+    auto surfaceCaveAttenuationDist = m_templateConfig.getFloat("surfaceCaveAttenuationDist", 0);
+    if (terrainSelect < surfaceCaveAttenuationDist) {
+      auto surfaceCaveAttenuationFactor = m_templateConfig.getFloat("surfaceCaveAttenuationFactor", 1);
+      foregroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
+      backgroundCaveSelect -= (surfaceCaveAttenuationDist - terrainSelect) * surfaceCaveAttenuationFactor;
+    }
+  }
+
+  blockInfo.foregroundCave = foregroundCaveSelect > 0.0f;
+  blockInfo.backgroundCave = backgroundCaveSelect > 0.0f;
+
+  auto const& regionLiquids = primaryFlatWeighting.region->regionLiquids;
+  blockInfo.caveLiquid = regionLiquids.caveLiquid;
+  blockInfo.caveLiquidSeedDensity = regionLiquids.caveLiquidSeedDensity;
+  blockInfo.oceanLiquid = regionLiquids.oceanLiquid;
+  blockInfo.oceanLiquidLevel = regionLiquids.oceanLiquidLevel;
+  blockInfo.encloseLiquids = regionLiquids.encloseLiquids;
+  blockInfo.fillMicrodungeons = regionLiquids.fillMicrodungeons;
+
+  if (!blockInfo.terrain && blockInfo.encloseLiquids && (int)y < blockInfo.oceanLiquidLevel) {
+    blockInfo.terrain = true;
+    blockInfo.foregroundCave = true;
+  }
+
+  if (blockInfo.terrain) {
+    if (auto blockBiome = biome(blockInfo.blockBiomeIndex)) {
+      if (!blockInfo.foregroundCave) {
+        blockInfo.foreground = blockBiome->mainBlock;
+        blockInfo.background = blockInfo.foreground;
+      } else if (!blockInfo.backgroundCave) {
+        blockInfo.background = blockBiome->mainBlock;
+      }
+
+      // subBlock, foregroundOre, and backgroundOre selectors can be empty
+      // if they are not enabled, otherwise they will always have the
+      // correct count
+
+      if (!primaryBlockWeighting.region->subBlockSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->subBlocks.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->subBlockSelectorIndexes.at(i));
+          if (selector->get(primaryBlockWeighting.xValue - blendNoiseOffset, blockPos[1]) > 0.0f) {
+            if (!blockInfo.foregroundCave) {
+              blockInfo.foreground = blockBiome->subBlocks.at(i);
+              blockInfo.background = blockInfo.foreground;
+            } else if (!blockInfo.backgroundCave) {
+              blockInfo.background = blockBiome->subBlocks.at(i);
             }
+
+            break;
           }
+        }
+      }
 
-          if (!blockInfo.foregroundCave && !primaryBlockWeighting.region->foregroundOreSelectorIndexes.empty()) {
-            for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
-              auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->foregroundOreSelectorIndexes.at(i));
-              if (selector->get(x, y) > 0.0f) {
-                blockInfo.foregroundMod = blockBiome->ores.at(i).first;
-                break;
-              }
-            }
+      if (!blockInfo.foregroundCave && !primaryBlockWeighting.region->foregroundOreSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->foregroundOreSelectorIndexes.at(i));
+          if (selector->get(x, y) > 0.0f) {
+            blockInfo.foregroundMod = blockBiome->ores.at(i).first;
+            break;
           }
+        }
+      }
 
-          if (!blockInfo.backgroundCave && !primaryBlockWeighting.region->backgroundOreSelectorIndexes.empty()) {
-            for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
-              auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->backgroundOreSelectorIndexes.at(i));
-              if (selector->get(x, y) > 0.0f) {
-                blockInfo.backgroundMod = blockBiome->ores.at(i).first;
-                break;
-              }
-            }
+      if (!blockInfo.backgroundCave && !primaryBlockWeighting.region->backgroundOreSelectorIndexes.empty()) {
+        for (size_t i = 0; i < blockBiome->ores.size(); ++i) {
+          auto const& selector = m_layout->getTerrainSelector(primaryBlockWeighting.region->backgroundOreSelectorIndexes.at(i));
+          if (selector->get(x, y) > 0.0f) {
+            blockInfo.backgroundMod = blockBiome->ores.at(i).first;
+            break;
           }
         }
       }
+    }
+  }
 
-      return blockInfo;
-    });
+  return blockInfo;
+}
+
+void WorldTemplate::invalidateBlockInfo() {
+  MutexLocker cacheLocker(m_blockCacheMutex);
+  m_blockCache.clear();
+  ++m_blockInfoVersion;
 }
 
 Json WorldTemplate::BlockInfo::toJson() const {
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "StarOrderedMap.hpp"
-#include "StarLruCache.hpp"
+#include "StarSectorLruCache.hpp"
+#include "StarThread.hpp"
 #include "StarWorldLayout.hpp"
 #include "StarBiomePlacement.hpp"
 #include "StarCelestialDatabase.hpp"
@@ -122,6 +123,8 @@ public:
 
   void addBiomeRegion(Vec2I const& position, String const& biomeName, String const& subBlockSelector, int width);
   void expandBiomeRegion(Vec2I const& position, int newWidth);
+  // Returns the name of the environment biome that was set
+  String setLayerEnvironmentBiome(Vec2I const& position);
 
   List<Dungeon> dungeons() const;
 
@@ -130,11 +133,16 @@ public:
   // Is this integral region of blocks outside the terrain?
   bool isOutside(RectI const& region) const;
 
+  // Block info may be queried from any thread, but changes to the layout or
+  // custom terrain must still be made from the owning thread.
   BlockInfo blockInfo(int x, int y) const;
 
   // partial blockinfo that doesn't use terrain selectors
   BlockInfo blockBiomeInfo(int x, int y) const;
 
+  // Changes whenever block info previously returned may have become stale
+  uint64_t blockInfoVersion() const;
+
   BiomeIndex blockBiomeIndex(int x, int y) const;
   BiomeIndex environmentBiomeIndex(int x, int y) const;
   BiomeConstPtr biome(BiomeIndex biomeIndex) const;
@@ -179,12 +187,27 @@ private:
 
   WorldTemplate();
 
+  // Builds the layout for the given parameters, or returns the layout already
+  // built for identical parameters and seed by another live template, so
+  // that instance worlds of the same type share their biomes and terrain
+  // selectors.
+  static WorldLayoutPtr sharedLayout(VisitableWorldParametersConstPtr const& worldParameters, uint64_t seed);
+
+  // Copies the layout before it is first changed, if it is shared.  Must be
+  // called with m_blockInfoLock held for writing.
+  void unshareLayout();
+
   void determineWorldName();
 
   pair<float, float> customTerrainWeighting(int x, int y) const;
 
-  // Calculates block info and adds to cache
+  // Returns cached block info, or calculates block info and adds to cache
   BlockInfo getBlockInfo(uint32_t x, uint32_t y) const;
+  // Must be called with m_blockInfoLock held for reading
+  BlockInfo calculateBlockInfo(uint32_t x, uint32_t y) const;
+
+  // Must be called with m_blockInfoLock held for writing
+  void invalidateBlockInfo();
 
   Json m_templateConfig;
   float m_customTerrainBlendSize;
@@ -196,11 +219,18 @@ private:
   uint64_t m_seed;
   WorldGeometry m_geometry;
   WorldLayoutPtr m_layout;
+  bool m_layoutShared = false;
   String m_worldName;
 
   List<CustomTerrainRegion> m_customTerrainRegions;
 
-  mutable HashLruCache<Vector<uint32_t, 2>, BlockInfo> m_blockCache;
+  // Held for reading while calculating block info and for writing while
+  // changing the layout or custom terrain, the terrain selectors guard their
+  // own caches.
+  mutable ReadersWriterMutex m_blockInfoLock;
+  mutable Mutex m_blockCacheMutex;
+  mutable SectorLruCache<BlockInfo> m_blockCache;
+  uint64_t m_blockInfoVersion = 0;
 };
 
 }
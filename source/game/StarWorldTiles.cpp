@@ -148,6 +148,20 @@ PredictedTile::operator bool() const {
   || collision;
 }
 
+bool NetTile::operator==(NetTile const& rhs) const {
+  return tie(background, backgroundHueShift, backgroundColorVariant, backgroundMod, backgroundModHueShift,
+             foreground, foregroundHueShift, foregroundColorVariant, foregroundMod, foregroundModHueShift,
+             collision, blockBiomeIndex, environmentBiomeIndex, liquid.liquid, liquid.level, dungeonId)
+      == tie(rhs.background, rhs.backgroundHueShift, rhs.backgroundColorVariant, rhs.backgroundMod, rhs.backgroundModHueShift,
+             rhs.foreground, rhs.foregroundHueShift, rhs.foregroundColorVariant, rhs.foregroundMod, rhs.foregroundModHueShift,
+             rhs.collision, rhs.blockBiomeIndex, rhs.environmentBiomeIndex, rhs.liquid.liquid, rhs.liquid.level, rhs.dungeonId);
+}
+
+size_t hash<NetTile>::operator()(NetTile const& tile) const {
+  return hashOf(tile.background, tile.backgroundMod, tile.foreground, tile.foregroundMod, tile.collision,
+      tile.blockBiomeIndex, tile.environmentBiomeIndex, tile.liquid.liquid, tile.liquid.level, tile.dungeonId);
+}
+
 DataStream& operator>>(DataStream& ds, NetTile& tile) {
   ds.read(tile.background);
   if (tile.background == 0) {
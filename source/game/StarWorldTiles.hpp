@@ -110,6 +110,8 @@ typedef shared_ptr<ClientTileSectorArray> ClientTileSectorArrayPtr;
 struct NetTile {
   NetTile();
 
+  bool operator==(NetTile const& rhs) const;
+
   MaterialId background;
   MaterialHue backgroundHueShift;
   MaterialColorVariant backgroundColorVariant;
@@ -129,6 +131,11 @@ struct NetTile {
 DataStream& operator>>(DataStream& ds, NetTile& tile);
 DataStream& operator<<(DataStream& ds, NetTile const& tile);
 
+template <>
+struct hash<NetTile> {
+  size_t operator()(NetTile const& tile) const;
+};
+
 // For storing predicted tile state.
 struct PredictedTile {
   int64_t time;
@@ -118,8 +118,16 @@ Maybe<Json> Entity::receiveMessage(ConnectionId, String const&, JsonArray const&
 
 void Entity::update(float, uint64_t) {}
 
+bool Entity::independentUpdate() const {
+  return false;
+}
+
 void Entity::render(RenderCallback*) {}
 
+bool Entity::independentRender() const {
+  return false;
+}
+
 void Entity::renderLightSources(RenderCallback*) {}
 
 EntityId Entity::entityId() const {
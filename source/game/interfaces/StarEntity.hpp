@@ -152,8 +152,21 @@ public:
 
   virtual void update(float dt, uint64_t currentStep);
 
+  // Returning true here declares that update() only reads world state and
+  // never touches any other entity, so the server may update this entity
+  // concurrently with other independent entities of the same type.  Entities
+  // and timers added to the world from such an update are applied once all
+  // entities have been updated.  Defaults to false.
+  virtual bool independentUpdate() const;
+
   virtual void render(RenderCallback* renderer);
 
+  // Returning true here declares that render() only reads this entity's own
+  // state and thread safe systems such as Assets, and runs no scripts, so
+  // the client may render it concurrently with other independent entities.
+  // Defaults to false.
+  virtual bool independentRender() const;
+
   virtual void renderLightSources(RenderCallback* renderer);
 
   EntityId entityId() const;
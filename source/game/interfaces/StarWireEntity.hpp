@@ -22,6 +22,10 @@ public:
   virtual void addNodeConnection(WireNode wireNode, WireConnection nodeConnection) = 0;
   virtual void removeNodeConnection(WireNode wireNode, WireConnection nodeConnection) = 0;
 
+  // Changes whenever a node connection is added or removed, so that cached
+  // wire networks know to be rebuilt.
+  virtual uint64_t connectionsVersion() const = 0;
+
   virtual void evaluate(WireCoordinator* coordinator) = 0;
 };
 
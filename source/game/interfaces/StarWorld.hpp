@@ -90,6 +90,11 @@ public:
   // tile bounds.
   virtual void forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const = 0;
 
+  // Returns a value that changes whenever the collision of any tile in the
+  // region may have changed.  Changes are tracked per sector, so unrelated
+  // changes nearby can change it as well.
+  virtual uint64_t collisionGeneration(RectI const& region) const = 0;
+
   // Is there some connectable tile / tile based entity in this position?  If
   // tilesOnly is true, only checks to see whether that tile is a connectable
   // material.
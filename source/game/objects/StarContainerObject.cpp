@@ -53,7 +53,7 @@ void ContainerObject::init(World* world, EntityId entityId, EntityMode mode) {
       if (!configValue("initialItems").isNull()) {
         List<ItemDescriptor> items;
         for (auto const& spec : configValue("initialItems").iterateArray())
-          m_items->addItems({Root::singleton().itemDatabase()->item(ItemDescriptor(spec), level, ++seed)});
+          loadedItems()->addItems({Root::singleton().itemDatabase()->item(ItemDescriptor(spec), level, ++seed)});
       }
       if (!configValue("treasurePools").isNull()) {
         String treasurePool = Random::randValueFrom(configValue("treasurePools").toArray()).toString();
@@ -88,9 +88,11 @@ void ContainerObject::update(float dt, uint64_t currentStep) {
     }
 
     m_ageItemsTimer.update(world()->epochTime());
-    if (m_ageItemsTimer.elapsedTime() > configValue("ageItemsEvery", 10).toDouble()) {
+    // Items that are still stored keep accumulating age, and are aged all at
+    // once when they are loaded
+    if (!m_storedItems && m_ageItemsTimer.elapsedTime() > configValue("ageItemsEvery", 10).toDouble()) {
       double elapsedTime = m_ageItemsTimer.elapsedTime() * configValue("itemAgeMultiplier", 1.0f).toDouble();
-      for (auto& item : m_items->items()) {
+      for (auto& item : loadedItems()->items()) {
         if (Root::singleton().itemDatabase()->ageItem(item, elapsedTime))
           itemsUpdated();
       }
@@ -148,7 +150,7 @@ void ContainerObject::render(RenderCallback* renderCallback) {
 void ContainerObject::destroy(RenderCallback* renderCallback) {
   Object::destroy(renderCallback);
   if (isMaster()) {
-    for (auto const& drop : m_items->items())
+    for (auto const& drop : loadedItems()->items())
       world()->addEntity(ItemDrop::createRandomizedDrop(drop, position()));
   }
 }
@@ -204,7 +206,7 @@ InteractAction ContainerObject::interact(InteractRequest const&) {
 }
 
 Json ContainerObject::containerGuiConfig() const {
-  return Root::singleton().assets()->json(configValue("uiConfig").toString().replace("<slots>", toString(m_items->size())));
+  return Root::singleton().assets()->json(configValue("uiConfig").toString().replace("<slots>", toString(loadedItems()->size())));
 }
 
 String ContainerObject::containerDescription() const {
@@ -223,7 +225,7 @@ ItemDescriptor ContainerObject::iconItem() const {
 }
 
 ItemBagConstPtr ContainerObject::itemBag() const {
-  return m_items;
+  return loadedItems();
 }
 
 void ContainerObject::containerOpen() {
@@ -333,7 +335,7 @@ void ContainerObject::startCrafting() {
   } else {
     if (m_crafting.get())
       return;
-    auto inputItems = m_items->items();
+    auto inputItems = loadedItems()->items();
     inputItems.removeLast();
     m_goalRecipe = recipeForMaterials(inputItems);
     m_crafting.set(true);
@@ -367,7 +369,7 @@ void ContainerObject::burnContainerContents() {
     stopCrafting();
     auto level = world()->getProperty("ship.fuel", 0).toUInt();
     auto maxLevel = world()->getProperty("ship.maxFuel", 0).toUInt();
-    for (auto& item : m_items->items()) {
+    for (auto& item : loadedItems()->items()) {
       if (level > maxLevel)
         level = maxLevel;
       if (maxLevel == level)
@@ -395,7 +397,7 @@ void ContainerObject::getNetStates(bool initial) {
   Object::getNetStates(initial);
   if (m_itemsNetState.pullUpdated()) {
     DataStreamBuffer ds(m_itemsNetState.get());
-    m_items->read(ds);
+    loadedItems()->read(ds);
     itemsUpdated();
   }
 }
@@ -404,7 +406,20 @@ void ContainerObject::setNetStates() {
   Object::setNetStates();
   if (take(m_itemsUpdated)) {
     DataStreamBuffer ds;
-    m_items->write(ds);
+    if (m_storedItems) {
+      // Written the same way as ItemBag::write, without loading the items
+      size_t setItemsSize = 0;
+      for (size_t i = 0; i < m_storedItems->size(); ++i) {
+        if (m_storedItems->at(i))
+          setItemsSize = i + 1;
+      }
+      ds.writeVlqU(configValue("slotCount").toUInt());
+      ds.writeVlqU(setItemsSize);
+      for (size_t i = 0; i < setItemsSize; ++i)
+        ds.write(m_storedItems->at(i));
+    } else {
+      m_items->write(ds);
+    }
     m_itemsNetState.set(ds.takeData());
   }
 }
@@ -417,10 +432,21 @@ void ContainerObject::readStoredData(Json const& diskStore) {
   m_crafting.set(diskStore.getBool("crafting"));
   m_craftingProgress.set(diskStore.getFloat("craftingProgress"));
   m_initialized = diskStore.getBool("initialized");
-  m_items = make_shared<ItemBag>(ItemBag::loadStore(diskStore.get("items")));
   m_ageItemsTimer = EpochTimer(diskStore.get("ageItemsTimer"));
 
-  m_lostItems.appendAll(m_items->resize(configValue("slotCount").toUInt()));
+  // Most containers are never opened while loaded, so their items are only
+  // kept as descriptors until something first needs them.
+  auto storedItems = diskStore.getArray("items").transformed([](Json const& store) {
+      return store ? ItemDescriptor::loadStore(store) : ItemDescriptor();
+    });
+  size_t slotCount = configValue("slotCount").toUInt();
+  if (storedItems.size() <= slotCount) {
+    m_storedItems = std::move(storedItems);
+  } else {
+    m_storedItems.reset();
+    m_items = make_shared<ItemBag>(ItemBag::loadStore(diskStore.get("items")));
+    m_lostItems.appendAll(m_items->resize(slotCount));
+  }
 }
 
 Json ContainerObject::writeStoredData() const {
@@ -430,7 +456,7 @@ Json ContainerObject::writeStoredData() const {
       {"crafting", m_crafting.get()},
       {"craftingProgress", m_craftingProgress.get()},
       {"initialized", m_initialized},
-      {"items", m_items->diskStore()},
+      {"items", m_storedItems ? storedItemsDiskStore() : m_items->diskStore()},
       {"ageItemsTimer", m_ageItemsTimer.toJson()}
     });
 }
@@ -457,13 +483,13 @@ void ContainerObject::tickCrafting(float dt) {
   if (!m_crafting.get())
     return;
 
-  auto inputItems = m_items->items();
+  auto inputItems = loadedItems()->items();
   inputItems.removeLast();
   auto recipe = recipeForMaterials(inputItems);
   bool craftingFail = false;
   if (recipe.isNull() || m_goalRecipe != recipe)
     craftingFail = true;
-  ItemPtr targetItem = m_items->at(m_items->size() - 1);
+  ItemPtr targetItem = loadedItems()->at(loadedItems()->size() - 1);
   if (targetItem) {
     if (!targetItem->matches(m_goalRecipe.output, true))
       craftingFail = true;
@@ -483,12 +509,12 @@ void ContainerObject::tickCrafting(float dt) {
   if (m_craftingProgress.get() >= 1.0f) {
     m_craftingProgress.set(0);
     for (auto const& input : m_goalRecipe.inputs) {
-      bool consumed = m_items->consumeItems(input);
+      bool consumed = loadedItems()->consumeItems(input);
       _unused(consumed);
       starAssert(consumed);
     }
     ItemPtr overflow =
-        m_items->putItems(m_items->size() - 1, Root::singleton().itemDatabase()->item(m_goalRecipe.output));
+        loadedItems()->putItems(loadedItems()->size() - 1, Root::singleton().itemDatabase()->item(m_goalRecipe.output));
     if (overflow)
       world()->addEntity(ItemDrop::createRandomizedDrop(overflow, position()));
     itemsUpdated();
@@ -497,34 +523,34 @@ void ContainerObject::tickCrafting(float dt) {
 
 ItemPtr ContainerObject::doAddItems(ItemPtr const& items) {
   itemsUpdated();
-  return m_items->addItems(items);
+  return loadedItems()->addItems(items);
 }
 
 ItemPtr ContainerObject::doPutItems(size_t slot, ItemPtr const& items) {
   itemsUpdated();
-  return m_items->putItems(slot, items);
+  return loadedItems()->putItems(slot, items);
 }
 
 ItemPtr ContainerObject::doTakeItems(size_t slot, size_t count) {
   itemsUpdated();
-  return m_items->takeItems(slot, count);
+  return loadedItems()->takeItems(slot, count);
 }
 
 ItemPtr ContainerObject::doSwapItems(size_t slot, ItemPtr const& items, bool tryCombine) {
   itemsUpdated();
-  return m_items->swapItems(slot, items, tryCombine);
+  return loadedItems()->swapItems(slot, items, tryCombine);
 }
 
 ItemPtr ContainerObject::doApplyAugment(size_t slot, ItemPtr const& item) {
   itemsUpdated();
   if (auto augment = as<AugmentItem>(item))
-    if (auto slotItem = m_items->at(slot))
-      m_items->setItem(slot, augment->applyTo(slotItem));
+    if (auto slotItem = loadedItems()->at(slot))
+      loadedItems()->setItem(slot, augment->applyTo(slotItem));
   return item;
 }
 
 bool ContainerObject::doConsumeItems(ItemDescriptor const& descriptor) {
-  if (m_items->consumeItems(descriptor)) {
+  if (loadedItems()->consumeItems(descriptor)) {
     itemsUpdated();
     return true;
   }
@@ -533,7 +559,7 @@ bool ContainerObject::doConsumeItems(ItemDescriptor const& descriptor) {
 }
 
 bool ContainerObject::doConsumeItems(size_t slot, size_t count) {
-  if (m_items->consumeItems(slot, count)) {
+  if (loadedItems()->consumeItems(slot, count)) {
     itemsUpdated();
     return true;
   }
@@ -543,12 +569,30 @@ bool ContainerObject::doConsumeItems(size_t slot, size_t count) {
 
 List<ItemPtr> ContainerObject::doClearContainer() {
   stopCrafting();
-  List<ItemPtr> result = m_items->takeAll();
-  m_items->clearItems();
+  List<ItemPtr> result = loadedItems()->takeAll();
+  loadedItems()->clearItems();
   itemsUpdated();
   return result;
 }
 
+Json ContainerObject::storedItemsDiskStore() const {
+  return jsonFromList(*m_storedItems, [](ItemDescriptor const& descriptor) {
+      return descriptor ? descriptor.diskStore() : Json();
+    });
+}
+
+ItemBagPtr const& ContainerObject::loadedItems() const {
+  if (m_storedItems) {
+    auto itemDatabase = Root::singleton().itemDatabase();
+    auto items = make_shared<ItemBag>(configValue("slotCount").toUInt());
+    for (size_t i = 0; i < m_storedItems->size(); ++i)
+      items->setItem(i, itemDatabase->item(m_storedItems->at(i)));
+    m_items = std::move(items);
+    m_storedItems.reset();
+  }
+  return m_items;
+}
+
 void ContainerObject::itemsUpdated() {
   m_itemsUpdated = true;
   m_runUpdatedCallback = true;
@@ -76,6 +76,9 @@ private:
   template<typename T>
   RpcPromise<T> addSlavePromise(String const& message, JsonArray const& args, function<T(Json)> converter);
 
+  // Loads the stored items on first use
+  ItemBagPtr const& loadedItems() const;
+  Json storedItemsDiskStore() const;
   void itemsUpdated();
 
   NetElementInt m_opened;
@@ -83,7 +86,9 @@ private:
   NetElementBool m_crafting;
   NetElementFloat m_craftingProgress;
 
-  ItemBagPtr m_items;
+  mutable ItemBagPtr m_items;
+  // Descriptors of the items read from disk, until they are first used
+  mutable Maybe<List<ItemDescriptor>> m_storedItems;
   NetElementBytes m_itemsNetState;
 
   // master only
@@ -5,6 +5,9 @@
 #include "StarListener.hpp"
 #include "StarWorld.hpp"
 #include "StarWorldLuaBindings.hpp"
+#include "StarLuaScriptProfiler.hpp"
+#include "StarLuaConverters.hpp"
+#include "StarRpcThreadPromise.hpp"
 
 namespace Star {
 
@@ -129,6 +132,12 @@ private:
 // rate.  Every call to 'update' here will only call the internal script
 // 'update' at the configured delta.  Adds a update tick controls under the
 // 'script' callback table.
+//
+// Also adds 'script.spawn', which runs a function as a coroutine.  When the
+// coroutine yields a promise it is resumed with the promise's result and
+// error once the promise finishes, checked on every call to 'update'
+// regardless of the update delta.  Yielding anything else resumes it on the
+// next call.
 template <typename Base>
 class LuaUpdatableComponent : public Base {
 public:
@@ -142,13 +151,30 @@ public:
   // Returns true if the next update will call the internal script update
   // method.
   bool updateReady() const;
+  // The number of calls to update until one either calls the internal script
+  // update method or resumes a waiting coroutine, or nothing if that will
+  // never happen.
+  Maybe<unsigned> updatesUntilReady() const;
 
   template <typename Ret = LuaValue, typename... V>
   Maybe<Ret> update(V&&... args);
 
+protected:
+  virtual void contextShutdown() override;
+
 private:
+  struct ScriptTask {
+    LuaThread thread;
+    LuaValue awaiting;
+  };
+
+  // The values to resume a task with, or nothing if it is still waiting
+  static Maybe<LuaVariadic<LuaValue>> awaitedResults(LuaValue const& awaiting);
+  void resumeTasks();
+
   Periodic m_updatePeriodic;
   mutable float m_lastDt;
+  List<ScriptTask> m_tasks;
 };
 
 // Wraps a basic lua component so that world callbacks are added on init, and
@@ -197,6 +223,7 @@ Maybe<Ret> LuaBaseComponent::invoke(String const& name, V&&... args) {
     auto method = m_context->getPath(name);
     if (method == LuaNil)
       return {};
+    LuaScriptProfiler::Call profileCall(m_scripts, m_context->engine());
     return m_context->luaTo<LuaFunction>(std::move(method)).invoke<Ret>(std::forward<V>(args)...);
   } catch (LuaException const& e) {
     Logger::error("Exception while invoking lua function '{}'. {}", name, outputException(e, true));
@@ -257,6 +284,12 @@ LuaUpdatableComponent<Base>::LuaUpdatableComponent() {
   scriptCallbacks.registerCallback("setUpdateDelta", [this](unsigned d) {
       setUpdateDelta(d);
     });
+  scriptCallbacks.registerCallback("spawn", [this](LuaEngine& engine, LuaFunction const& function, LuaVariadic<LuaValue> const& args) {
+      auto thread = engine.createThread();
+      thread.pushFunction(function);
+      if (auto awaiting = thread.resume(args))
+        m_tasks.append({std::move(thread), awaiting.take()});
+    });
 
   m_lastDt = GlobalTimestep * GlobalTimescale;
   Base::addCallbacks("script", std::move(scriptCallbacks));
@@ -289,15 +322,80 @@ bool LuaUpdatableComponent<Base>::updateReady() const {
   return m_updatePeriodic.ready();
 }
 
+template <typename Base>
+Maybe<unsigned> LuaUpdatableComponent<Base>::updatesUntilReady() const {
+  if (!m_tasks.empty())
+    return 1;
+  if (m_updatePeriodic.stepCount() == 0)
+    return {};
+  return m_updatePeriodic.stepsUntilReady() + 1;
+}
+
 template <typename Base>
 template <typename Ret, typename... V>
 Maybe<Ret> LuaUpdatableComponent<Base>::update(V&&... args) {
+  resumeTasks();
+
   if (!m_updatePeriodic.tick())
     return {};
 
   return Base::template invoke<Ret>("update", std::forward<V>(args)...);
 }
 
+template <typename Base>
+void LuaUpdatableComponent<Base>::contextShutdown() {
+  m_tasks.clear();
+  Base::contextShutdown();
+}
+
+template <typename Base>
+Maybe<LuaVariadic<LuaValue>> LuaUpdatableComponent<Base>::awaitedResults(LuaValue const& awaiting) {
+  auto userData = awaiting.ptr<LuaUserData>();
+  if (!userData)
+    return LuaVariadic<LuaValue>();
+
+  auto& engine = userData->engine();
+  auto results = [&engine](auto const& promise) -> Maybe<LuaVariadic<LuaValue>> {
+    if (!promise.finished())
+      return {};
+    return LuaVariadic<LuaValue>{engine.luaFrom(promise.result()), engine.luaFrom(promise.error())};
+  };
+
+  if (userData->is<RpcPromise<Json>>())
+    return results(userData->get<RpcPromise<Json>>());
+  if (userData->is<RpcPromise<Vec2F>>())
+    return results(userData->get<RpcPromise<Vec2F>>());
+  if (userData->is<RpcThreadPromise<Json>>())
+    return results(userData->get<RpcThreadPromise<Json>>());
+  return LuaVariadic<LuaValue>();
+}
+
+template <typename Base>
+void LuaUpdatableComponent<Base>::resumeTasks() {
+  if (m_tasks.empty() || !Base::initialized() || Base::error())
+    return;
+
+  // Tasks spawned while resuming are appended to m_tasks and wait for the
+  // next update.
+  for (auto& task : take(m_tasks)) {
+    auto results = awaitedResults(task.awaiting);
+    if (!results) {
+      m_tasks.append(std::move(task));
+      continue;
+    }
+
+    try {
+      if (auto awaiting = task.thread.resume(*results))
+        m_tasks.append({std::move(task.thread), awaiting.take()});
+    } catch (LuaException const& e) {
+      Logger::error("Exception while resuming script coroutine: {}", outputException(e, true));
+      Base::setError(printException(e, false));
+      m_tasks.clear();
+      return;
+    }
+  }
+}
+
 template <typename Base>
 void LuaWorldComponent<Base>::init(World* world) {
   if (Base::initialized())
@@ -349,6 +447,7 @@ Maybe<Json> LuaMessageHandlingComponent<Base>::handleMessage(
 
   if (auto handler = m_messageHandlers.ptr(message)) {
     try {
+      LuaScriptProfiler::Call profileCall(Base::scripts(), handler->function->engine());
       if (handler->localOnly) {
         if (!localMessage)
           return {};
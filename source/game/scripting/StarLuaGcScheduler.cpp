@@ -0,0 +1,89 @@
+#include "StarLuaGcScheduler.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+Array<double, 5> const LuaGcScheduler::PauseBuckets = {0.25, 0.5, 1.0, 2.0, 4.0};
+
+LuaGcScheduler::LuaGcScheduler(LuaRootPtr luaRoot, Json const& config) : m_luaRoot(std::move(luaRoot)) {
+  m_spareTimeFraction = config.getDouble("spareTimeFraction", 0.5);
+  m_maxStepTime = config.getDouble("maxStepTime", 0.004);
+  m_pause = config.getFloat("pause", 1.2f);
+  m_stepMultiplier = config.getFloat("stepMultiplier", 2.0f);
+  m_forceMultiplier = config.getFloat("forceMultiplier", 2.0f);
+  m_minStepSize = config.getUInt("minStepSize", 16);
+  m_maxStepSize = config.getUInt("maxStepSize", 4096);
+
+  m_cycleActive = true;
+  m_nextCycleMemory = 0;
+  m_lastMemory = 0;
+  m_pauseHistogram.fill(0);
+  m_cyclesCompleted = 0;
+}
+
+void LuaGcScheduler::update(double spareTime) {
+  // The engine is replaced when the LuaRoot restarts, so this is applied
+  // every time rather than once.
+  m_luaRoot->setAutoGarbageCollection(false);
+
+  size_t memory = m_luaRoot->luaMemoryUsage();
+  if (!m_cycleActive) {
+    if (memory < m_nextCycleMemory) {
+      m_lastMemory = memory;
+      return;
+    }
+    m_cycleActive = true;
+  }
+
+  size_t allocated = memory > m_lastMemory ? memory - m_lastMemory : 0;
+  unsigned stepSize = clamp<size_t>(allocated / 1024 * m_stepMultiplier, m_minStepSize, m_maxStepSize);
+
+  double budget = min(spareTime * m_spareTimeFraction, m_maxStepTime);
+  if (m_nextCycleMemory != 0 && memory > m_nextCycleMemory * m_forceMultiplier)
+    budget = m_maxStepTime;
+
+  if (budget > 0.0) {
+    // Starts with a zero sized step, which resets the collector's own debt
+    // so that it neither waits on lua's pause threshold nor pays off
+    // everything allocated since the last update in one step.
+    double startTime = Time::monotonicTime();
+    double elapsed = 0.0;
+    unsigned size = 0;
+    do {
+      if (m_luaRoot->collectGarbage(size)) {
+        m_cycleActive = false;
+        m_nextCycleMemory = m_luaRoot->luaMemoryUsage() * m_pause;
+        ++m_cyclesCompleted;
+        break;
+      }
+      size = stepSize;
+      elapsed = Time::monotonicTime() - startTime;
+    } while (elapsed < budget);
+    elapsed = Time::monotonicTime() - startTime;
+
+    size_t bucket = 0;
+    while (bucket < PauseBuckets.size() && elapsed * 1000.0 > PauseBuckets[bucket])
+      ++bucket;
+    ++m_pauseHistogram[bucket];
+  }
+
+  m_lastMemory = m_luaRoot->luaMemoryUsage();
+}
+
+Array<uint64_t, 6> const& LuaGcScheduler::pauseHistogram() const {
+  return m_pauseHistogram;
+}
+
+uint64_t LuaGcScheduler::cyclesCompleted() const {
+  return m_cyclesCompleted;
+}
+
+String LuaGcScheduler::describe() const {
+  String res = strf("{} cycles, pauses", m_cyclesCompleted);
+  for (size_t i = 0; i < PauseBuckets.size(); ++i)
+    res += strf(" <{}ms: {}", PauseBuckets[i], m_pauseHistogram[i]);
+  res += strf(" >{}ms: {}", PauseBuckets[PauseBuckets.size() - 1], m_pauseHistogram[PauseBuckets.size()]);
+  return res;
+}
+
+}
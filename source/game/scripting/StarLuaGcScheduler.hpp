@@ -0,0 +1,55 @@
+#pragma once
+
+#include "StarLuaRoot.hpp"
+#include "StarJson.hpp"
+
+namespace Star {
+
+STAR_CLASS(LuaGcScheduler);
+
+// Runs the garbage collector of a LuaRoot in bounded incremental steps
+// instead of letting lua collect whenever it allocates, so that collection
+// happens in the spare time at the end of a tick rather than in the middle of
+// script updates.  Like lua's own collector, a new cycle starts only once
+// memory use has grown by the pause factor since the last cycle ended, and
+// the work done per update follows the memory allocated since the previous
+// update.
+class LuaGcScheduler {
+public:
+  // Upper bounds in milliseconds of the pause histogram buckets, the last
+  // bucket holds every longer pause.
+  static Array<double, 5> const PauseBuckets;
+
+  LuaGcScheduler(LuaRootPtr luaRoot, Json const& config);
+
+  // Collects for at most the configured fraction of the given spare time.  If
+  // memory has grown well past the point where a cycle should have finished,
+  // collects for the maximum step time even without spare time.
+  void update(double spareTime);
+
+  // Counts of collection pauses for each of the PauseBuckets, plus one for
+  // longer pauses.
+  Array<uint64_t, 6> const& pauseHistogram() const;
+  uint64_t cyclesCompleted() const;
+  String describe() const;
+
+private:
+  LuaRootPtr m_luaRoot;
+
+  double m_spareTimeFraction;
+  double m_maxStepTime;
+  float m_pause;
+  float m_stepMultiplier;
+  float m_forceMultiplier;
+  unsigned m_minStepSize;
+  unsigned m_maxStepSize;
+
+  bool m_cycleActive;
+  size_t m_nextCycleMemory;
+  size_t m_lastMemory;
+
+  Array<uint64_t, 6> m_pauseHistogram;
+  uint64_t m_cyclesCompleted;
+};
+
+}
@@ -7,6 +7,7 @@
 #include "StarLuaGameConverters.hpp"
 #include "StarRoot.hpp"
 #include "StarRpcPromise.hpp"
+#include "StarWorkerPool.hpp"
 namespace Star {
 
 struct LuaHttpResponse {
@@ -35,18 +36,9 @@ struct PendingHttpRequest {
 Mutex s_pendingRequestsMutex;
 List<shared_ptr<PendingHttpRequest>> s_pendingRequests;
 
-// Structure to hold async HTTP request state
-struct AsyncHttpRequest {
-  shared_ptr<WorkerPoolPromise<HttpResponse>> workerPromise;
-  RpcPromiseKeeper<LuaHttpResponse> rpcKeeper;
-  bool checked = false;
-};
-
-// Global map to track pending async requests
-// We use a simple incremental ID system
-Mutex s_asyncRequestsMutex;
-uint64_t s_nextRequestId = 1;
-HashMap<uint64_t, shared_ptr<AsyncHttpRequest>> s_asyncRequests;
+// Responses are handed over from the HttpClient threads and fulfill their
+// promises on the thread using them, the next time any promise is checked.
+CompletionQueue s_completions;
 
 // Check if a domain is in the trusted list
 bool isTrustedDomain(String const& domain) {
@@ -80,77 +72,24 @@ bool isTrustedDomain(String const& domain) {
 //   config->setPath("safe.luaHttp.trustedSites", trustedSites);
 // }
 
-String extractDomain(String const& url) {
-  const size_t end = url.find("://");
-  if (end == NPos)
-    return url;
-
-  const size_t domainStart = end + 3;
-  const size_t pathStart = url.find('/', domainStart);
-  const size_t portStart = url.find(':', domainStart);
-
-  size_t domainEnd = NPos;
-  if (pathStart != NPos && portStart != NPos)
-    domainEnd = std::min(pathStart, portStart);
-  else if (pathStart != NPos)
-    domainEnd = pathStart;
-  else if (portStart != NPos)
-    domainEnd = portStart;
-
-  if (domainEnd == NPos)
-    return url.substr(domainStart);
-  return url.substr(domainStart, domainEnd - domainStart);
-}
-
 void pollAsyncRequests() {
-  MutexLocker locker(s_asyncRequestsMutex);
-
-  List<uint64_t> completedIds;
-
-  for (auto& [fst, snd] : s_asyncRequests) {
-
-    if (const auto& asyncReq = snd; !asyncReq->checked && asyncReq->workerPromise->poll()) {
-      asyncReq->checked = true;
-
-      try {
-
-        if (const auto httpResp = asyncReq->workerPromise->get(); !httpResp.error.empty()) {
-          asyncReq->rpcKeeper.fail(strf("HTTP request failed: {}", httpResp.error));
-        } else {
-          LuaHttpResponse luaResp;
-          luaResp.statusCode = httpResp.statusCode;
-          luaResp.body = httpResp.body;
-          asyncReq->rpcKeeper.fulfill(std::move(luaResp));
-        }
-      } catch (std::exception const& e) {
-        asyncReq->rpcKeeper.fail(strf("HTTP request exception: {}", e.what()));
-      }
-
-      completedIds.append(fst);
-    }
-  }
-
-  for (auto id : completedIds) {
-    s_asyncRequests.remove(id);
-  }
+  s_completions.run();
 }
 
 void executeHttpRequest(HttpRequest const& httpReq, RpcPromiseKeeper<LuaHttpResponse> rpcKeeper) {
-  try {
-    const auto workerPromise = make_shared<WorkerPoolPromise<HttpResponse>>(HttpClient::requestAsync(httpReq));
-
-    const auto asyncReq = make_shared<AsyncHttpRequest>();
-    asyncReq->workerPromise = workerPromise;
-    asyncReq->rpcKeeper = std::move(rpcKeeper);
-
-    {
-      MutexLocker locker(s_asyncRequestsMutex);
-      const uint64_t requestId = s_nextRequestId++;
-      s_asyncRequests[requestId] = asyncReq;
-    }
-  } catch (std::exception const& e) {
-    rpcKeeper.fail(strf("HTTP request failed: {}", e.what()));
-  }
+  auto keeper = make_shared<RpcPromiseKeeper<LuaHttpResponse>>(std::move(rpcKeeper));
+  HttpClient::requestAsync(httpReq, [keeper](HttpResponse httpResp) {
+    s_completions.post([keeper, httpResp = std::move(httpResp)]() {
+      if (!httpResp.error.empty()) {
+        keeper->fail(strf("HTTP request failed: {}", httpResp.error));
+      } else {
+        LuaHttpResponse luaResp;
+        luaResp.statusCode = httpResp.statusCode;
+        luaResp.body = httpResp.body;
+        keeper->fulfill(std::move(luaResp));
+      }
+    });
+  });
 }
 
 // Handle usrs reply to trust dialog
@@ -248,7 +187,7 @@ LuaCallbacks LuaBindings::makeHttpCallbacks(bool enabled) {
     if (!enabled)
       return RpcPromise<LuaHttpResponse>::createFailed("luaHttp disabled by configuration");
 
-    const String domain = extractDomain(url);
+    const String domain = HttpClient::urlDomain(url);
 
     try {
       HttpRequest httpReq;
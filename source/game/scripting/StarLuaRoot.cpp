@@ -1,16 +1,21 @@
 #include "StarLuaRoot.hpp"
 #include "StarAssets.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarXXHash.hpp"
+#include "StarJsonExtra.hpp"
 
 namespace Star {
 
 LuaRoot::LuaRoot() {
   auto& root = Root::singleton();
   m_scriptCache = make_shared<ScriptCache>();
+  m_sharedModules = make_shared<SharedModules>();
 
   restart();
 
-  m_rootReloadListener = make_shared<CallbackListener>([cache = m_scriptCache]() {
+  m_rootReloadListener = make_shared<CallbackListener>([cache = m_scriptCache, sharedModules = m_sharedModules]() {
       cache->clear();
+      sharedModules->loaded.clear();
     });
   root.registerReloadListener(m_rootReloadListener);
 
@@ -44,10 +49,20 @@ void LuaRoot::restart() {
   m_luaEngine->setInstructionLimit(root.configuration()->get("scriptInstructionLimit").toUInt());
   m_luaEngine->setProfilingEnabled(root.configuration()->get("scriptProfilingEnabled").toBool());
   m_luaEngine->setInstructionMeasureInterval(root.configuration()->get("scriptInstructionMeasureInterval").toUInt());
+
+  m_sharedModules->exports.clear();
+  for (auto const& p : root.configuration()->get("sharedScriptModules").optObject().value())
+    m_sharedModules->exports[p.first] = jsonToStringList(p.second);
+
+  if (root.configuration()->get("scriptBytecodeCache").optBool().value(false))
+    m_scriptCache->setBytecodeDirectory(File::relativeTo(root.toStoragePath("lua"), "bytecode"));
+  else
+    m_scriptCache->setBytecodeDirectory({});
 }
 
 void LuaRoot::shutdown() {
   clearScriptCache();
+  m_sharedModules->loaded.clear();
 
   if (!m_luaEngine)
     return;
@@ -96,15 +111,7 @@ LuaContext LuaRoot::createContext(StringList const& scriptPaths) {
   auto newContext = m_luaEngine->createContext();
 
   auto cache = m_scriptCache;
-  newContext.setRequireFunction([cache](LuaContext& context, LuaString const& module) {
-    if (!context.get("_SBLOADED").is<LuaTable>())
-      context.set("_SBLOADED", context.createTable());
-    auto t = context.get<LuaTable>("_SBLOADED");
-    if (!t.contains(module)) {
-      t.set(module, true);
-      cache->loadContextScript(context, module.toString());
-    }
-  });
+  newContext.setRequireFunction(makeRequireFunction(cache, m_sharedModules));
 
   auto assets = Root::singleton().assets();
 
@@ -121,9 +128,8 @@ LuaContext LuaRoot::createContext(StringList const& scriptPaths) {
   return newContext;
 }
 
-void LuaRoot::collectGarbage(Maybe<unsigned> steps) {
-  if (m_luaEngine)
-    m_luaEngine->collectGarbage(steps);
+bool LuaRoot::collectGarbage(Maybe<unsigned> steps) {
+  return m_luaEngine && m_luaEngine->collectGarbage(steps);
 }
 
 void LuaRoot::setAutoGarbageCollection(bool autoGarbageColleciton) {
@@ -152,6 +158,57 @@ void LuaRoot::addCallbacks(String const& groupName, LuaCallbacks const& callback
   m_luaCallbacks[groupName] = callbacks;
 }
 
+LuaContext::RequireFunction LuaRoot::makeRequireFunction(shared_ptr<ScriptCache> cache, shared_ptr<SharedModules> sharedModules) {
+  return [cache, sharedModules](LuaContext& context, LuaString const& module) {
+    if (!context.get("_SBLOADED").is<LuaTable>())
+      context.set("_SBLOADED", context.createTable());
+    auto t = context.get<LuaTable>("_SBLOADED");
+    if (!t.contains(module)) {
+      t.set(module, true);
+      String path = module.toString();
+      if (sharedModules->exports.contains(path))
+        requireSharedModule(context, path, cache, sharedModules);
+      else
+        cache->loadContextScript(context, path);
+    }
+  };
+}
+
+void LuaRoot::requireSharedModule(LuaContext& context, String const& path,
+    shared_ptr<ScriptCache> const& cache, shared_ptr<SharedModules> const& sharedModules) {
+  auto& engine = context.engine();
+
+  auto globals = sharedModules->loaded.ptr(path);
+  if (!globals) {
+    auto moduleContext = engine.createContext();
+    moduleContext.setRequireFunction(makeRequireFunction(cache, sharedModules));
+    cache->loadContextScript(moduleContext, path);
+
+    List<SharedGlobal> moduleGlobals;
+    for (auto const& name : sharedModules->exports.get(path)) {
+      SharedGlobal global = {name, moduleContext.get(name), false};
+      if (auto table = global.value.ptr<LuaTable>()) {
+        auto metatable = engine.createTable();
+        metatable.rawSet("__index", *table);
+        global.value = metatable;
+        global.readThrough = true;
+      }
+      moduleGlobals.append(std::move(global));
+    }
+    globals = &sharedModules->loaded.add(path, std::move(moduleGlobals));
+  }
+
+  for (auto const& global : *globals) {
+    if (global.readThrough) {
+      auto table = engine.createTable();
+      table.setMetatable(global.value.get<LuaTable>());
+      context.set(global.name, table);
+    } else {
+      context.set(global.name, global.value);
+    }
+  }
+}
+
 LuaEngine& LuaRoot::luaEngine() const {
   return *m_luaEngine;
 }
@@ -159,7 +216,18 @@ LuaEngine& LuaRoot::luaEngine() const {
 void LuaRoot::ScriptCache::loadScript(LuaEngine& engine, String const& assetPath) {
   auto assets = Root::singleton().assets();
   RecursiveMutexLocker locker(mutex);
-  scripts[assetPath] = engine.compile(*assets->bytes(assetPath), assetPath);
+  auto source = assets->bytes(assetPath);
+  if (!bytecodeDirectory) {
+    scripts[assetPath] = engine.compile(*source, assetPath);
+    return;
+  }
+
+  if (auto bytecode = readBytecode(assetPath, *source)) {
+    scripts[assetPath] = bytecode.take();
+  } else {
+    auto& compiled = scripts[assetPath] = engine.compile(*source, assetPath);
+    writeBytecode(assetPath, *source, compiled);
+  }
 }
 
 bool LuaRoot::ScriptCache::scriptLoaded(String const& assetPath) const {
@@ -184,6 +252,49 @@ void LuaRoot::ScriptCache::loadContextScript(LuaContext& context, String const&
   context.load(scripts.get(assetPath));
 }
 
+void LuaRoot::ScriptCache::setBytecodeDirectory(Maybe<String> directory) {
+  RecursiveMutexLocker locker(mutex);
+  bytecodeDirectory = std::move(directory);
+}
+
+Maybe<ByteArray> LuaRoot::ScriptCache::readBytecode(String const& assetPath, ByteArray const& source) const {
+  String file = bytecodeFile(assetPath);
+  if (!File::isFile(file))
+    return {};
+
+  try {
+    DataStreamBuffer ds(File::readFile(file));
+    if (ds.read<String>() != assetPath
+        || ds.read<ByteArray>() != Root::singleton().assets()->digest()
+        || ds.read<uint64_t>() != xxHash64(source))
+      return {};
+    return ds.read<ByteArray>();
+  } catch (std::exception const& e) {
+    Logger::warn("Ignoring unreadable cached bytecode for '{}': {}", assetPath, outputException(e, false));
+    return {};
+  }
+}
+
+void LuaRoot::ScriptCache::writeBytecode(String const& assetPath, ByteArray const& source, ByteArray const& bytecode) const {
+  try {
+    if (!File::isDirectory(*bytecodeDirectory))
+      File::makeDirectoryRecursive(*bytecodeDirectory);
+
+    DataStreamBuffer ds;
+    ds.write(assetPath);
+    ds.write(Root::singleton().assets()->digest());
+    ds.write(xxHash64(source));
+    ds.write(bytecode);
+    File::overwriteFileWithRename(ds.takeData(), bytecodeFile(assetPath));
+  } catch (std::exception const& e) {
+    Logger::warn("Could not cache bytecode for '{}': {}", assetPath, outputException(e, false));
+  }
+}
+
+String LuaRoot::ScriptCache::bytecodeFile(String const& assetPath) const {
+  return File::relativeTo(*bytecodeDirectory, strf("{:016x}.luabytecode", xxHash64(assetPath)));
+}
+
 size_t LuaRoot::ScriptCache::memoryUsage() const {
   RecursiveMutexLocker locker(mutex);
   size_t total = 0;
@@ -29,11 +29,16 @@ public:
   //
   // The LuaContext that is returned will have its 'require' function
   // overloaded to take absolute asset paths and load that asset path as a lua
-  // module, with protection from duplicate loading.
+  // module, with protection from duplicate loading.  Modules listed in the
+  // "sharedScriptModules" configuration are instead run only once per engine,
+  // in a context of their own, and only the globals listed for them are set
+  // in the requiring context.  Shared tables are given to each context as an
+  // empty table that reads through to the shared one, so assignments stay
+  // local to the context.
   LuaContext createContext(String const& script);
   LuaContext createContext(StringList const& scriptPaths = {});
 
-  void collectGarbage(Maybe<unsigned> steps = {});
+  bool collectGarbage(Maybe<unsigned> steps = {});
   void setAutoGarbageCollection(bool autoGarbageColleciton);
   void tuneAutoGarbageCollection(float pause, float stepMultiplier);
   size_t luaMemoryUsage() const;
@@ -54,14 +59,41 @@ private:
     void loadContextScript(LuaContext& context, String const& assetPath);
     size_t memoryUsage() const;
 
+    // Compiled scripts are also stored in this directory, and read back
+    // instead of compiling them again as long as the assets digest and the
+    // script source are unchanged.
+    void setBytecodeDirectory(Maybe<String> directory);
+
   private:
+    Maybe<ByteArray> readBytecode(String const& assetPath, ByteArray const& source) const;
+    void writeBytecode(String const& assetPath, ByteArray const& source, ByteArray const& bytecode) const;
+    String bytecodeFile(String const& assetPath) const;
+
     mutable RecursiveMutex mutex;
     StringMap<ByteArray> scripts;
+    Maybe<String> bytecodeDirectory;
+  };
+
+  struct SharedGlobal {
+    String name;
+    // For tables, the metatable of every context's read through table
+    LuaValue value;
+    bool readThrough;
   };
 
+  struct SharedModules {
+    StringMap<StringList> exports;
+    StringMap<List<SharedGlobal>> loaded;
+  };
+
+  static LuaContext::RequireFunction makeRequireFunction(shared_ptr<ScriptCache> cache, shared_ptr<SharedModules> sharedModules);
+  static void requireSharedModule(LuaContext& context, String const& path,
+      shared_ptr<ScriptCache> const& cache, shared_ptr<SharedModules> const& sharedModules);
+
   LuaEnginePtr m_luaEngine;
   StringMap<LuaCallbacks> m_luaCallbacks;
   shared_ptr<ScriptCache> m_scriptCache;
+  shared_ptr<SharedModules> m_sharedModules;
 
   ListenerPtr m_rootReloadListener;
 
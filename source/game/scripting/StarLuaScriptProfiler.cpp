@@ -0,0 +1,152 @@
+#include "StarLuaScriptProfiler.hpp"
+#include "StarTime.hpp"
+#include "StarTraceProfiler.hpp"
+
+namespace Star {
+
+atomic<bool> LuaScriptProfiler::s_enabled(false);
+Mutex LuaScriptProfiler::s_mutex;
+double LuaScriptProfiler::s_windowTime = 10.0;
+double LuaScriptProfiler::s_windowStart = 0.0;
+LuaScriptProfiler::Samples LuaScriptProfiler::s_current;
+LuaScriptProfiler::Samples LuaScriptProfiler::s_previous;
+bool LuaScriptProfiler::s_hasPrevious = false;
+thread_local String const* LuaScriptProfiler::s_category = nullptr;
+
+LuaScriptProfiler::Call::Call(StringList const& scripts, LuaEngine const& engine) {
+  m_active = LuaScriptProfiler::enabled();
+  m_traced = TraceProfiler::capturing();
+  if (!m_active && !m_traced)
+    return;
+
+  m_name = scripts.join(", ");
+  m_engine = &engine;
+  m_startInstructions = engine.instructionsExecuted();
+  m_startTime = Time::monotonicTime();
+}
+
+LuaScriptProfiler::Call::~Call() {
+  if (!m_active && !m_traced)
+    return;
+
+  double endTime = Time::monotonicTime();
+  if (m_active)
+    LuaScriptProfiler::record(m_name, m_engine->instructionsExecuted() - m_startInstructions, endTime - m_startTime);
+  if (m_traced)
+    TraceProfiler::record(TraceProfiler::internName(m_name), m_startTime, endTime);
+}
+
+LuaScriptProfiler::CategoryScope::CategoryScope(String const& category) {
+  m_active = LuaScriptProfiler::enabled();
+  if (m_active) {
+    m_previous = s_category;
+    s_category = &category;
+  }
+}
+
+LuaScriptProfiler::CategoryScope::~CategoryScope() {
+  if (m_active)
+    s_category = m_previous;
+}
+
+void LuaScriptProfiler::setEnabled(bool enabled) {
+  MutexLocker locker(s_mutex);
+  if (enabled && !s_enabled) {
+    s_current = {};
+    s_previous = {};
+    s_hasPrevious = false;
+    s_windowStart = Time::monotonicTime();
+  }
+  s_enabled = enabled;
+}
+
+bool LuaScriptProfiler::enabled() {
+  return s_enabled.load(std::memory_order_relaxed);
+}
+
+void LuaScriptProfiler::setWindowTime(double windowTime) {
+  MutexLocker locker(s_mutex);
+  s_windowTime = max(windowTime, 0.1);
+}
+
+double LuaScriptProfiler::sampleTime() {
+  MutexLocker locker(s_mutex);
+  double currentTime = Time::monotonicTime();
+  rotate(currentTime);
+  return currentTime - s_windowStart + (s_hasPrevious ? s_windowTime : 0.0);
+}
+
+List<LuaScriptProfiler::Entry> LuaScriptProfiler::topScripts(size_t count) {
+  return top(&Samples::scripts, count);
+}
+
+List<LuaScriptProfiler::Entry> LuaScriptProfiler::topCategories(size_t count) {
+  return top(&Samples::categories, count);
+}
+
+void LuaScriptProfiler::clear() {
+  MutexLocker locker(s_mutex);
+  s_current = {};
+  s_previous = {};
+  s_hasPrevious = false;
+  s_windowStart = Time::monotonicTime();
+}
+
+void LuaScriptProfiler::record(String const& name, uint64_t instructions, double time) {
+  MutexLocker locker(s_mutex);
+  rotate(Time::monotonicTime());
+
+  auto add = [&](StringMap<Entry>& entries, String const& key) {
+    auto& entry = entries[key];
+    if (entry.name.empty())
+      entry.name = key;
+    entry.calls += 1;
+    entry.instructions += instructions;
+    entry.time += time;
+  };
+
+  static String const UncategorizedName = "other";
+  add(s_current.scripts, name);
+  add(s_current.categories, s_category ? *s_category : UncategorizedName);
+}
+
+void LuaScriptProfiler::rotate(double currentTime) {
+  double elapsed = currentTime - s_windowStart;
+  if (elapsed < s_windowTime)
+    return;
+
+  if (elapsed < s_windowTime * 2) {
+    s_previous = take(s_current);
+    s_hasPrevious = true;
+  } else {
+    // Nothing was recorded during the last full window
+    s_current = {};
+    s_previous = {};
+    s_hasPrevious = false;
+  }
+  s_windowStart = currentTime;
+}
+
+List<LuaScriptProfiler::Entry> LuaScriptProfiler::top(StringMap<Entry> Samples::*entries, size_t count) {
+  MutexLocker locker(s_mutex);
+  rotate(Time::monotonicTime());
+
+  StringMap<Entry> combined = s_previous.*entries;
+  for (auto const& p : s_current.*entries) {
+    auto& entry = combined[p.first];
+    entry.name = p.first;
+    entry.calls += p.second.calls;
+    entry.instructions += p.second.instructions;
+    entry.time += p.second.time;
+  }
+
+  auto result = combined.values();
+  sort(result, [](Entry const& a, Entry const& b) {
+      return a.time > b.time;
+    });
+  if (result.size() > count)
+    result.resize(count);
+  return result;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "StarThread.hpp"
+#include "StarLua.hpp"
+
+namespace Star {
+
+// Process wide accounting of the instructions and wall time spent in script
+// calls, for finding which scripts and which kinds of entities are taking up
+// the tick.  Calls are aggregated by their script paths and by the category
+// set on the calling thread (e.g. the entity type being updated).  Samples
+// are kept for a rolling window, older samples are dropped.
+//
+// Disabled by default, when disabled recording a call costs only a check of
+// the enabled flag.
+class LuaScriptProfiler {
+public:
+  struct Entry {
+    String name;
+    uint64_t calls = 0;
+    // Only counted while the engine has its instruction count hook enabled,
+    // in steps of the engine's instruction measure interval.
+    uint64_t instructions = 0;
+    double time = 0.0;
+  };
+
+  // Timer for a single script call, records the call on destruction.  Calls
+  // made from inside the call are included in it as well.  While a
+  // TraceProfiler capture is running the call is also recorded as a zone.
+  class Call {
+  public:
+    Call(StringList const& scripts, LuaEngine const& engine);
+    ~Call();
+
+    Call(Call const&) = delete;
+    Call& operator=(Call const&) = delete;
+
+  private:
+    bool m_active;
+    bool m_traced;
+    String m_name;
+    LuaEngine const* m_engine;
+    uint64_t m_startInstructions;
+    double m_startTime;
+  };
+
+  // Attributes every call made on this thread while this is alive to the
+  // given category, the previous category is restored afterwards.
+  class CategoryScope {
+  public:
+    CategoryScope(String const& category);
+    ~CategoryScope();
+
+    CategoryScope(CategoryScope const&) = delete;
+    CategoryScope& operator=(CategoryScope const&) = delete;
+
+  private:
+    bool m_active;
+    String const* m_previous;
+  };
+
+  static void setEnabled(bool enabled);
+  static bool enabled();
+
+  // Samples are kept for between one and two windows.  Defaults to 10
+  // seconds.
+  static void setWindowTime(double windowTime);
+  // Length of time the current samples cover
+  static double sampleTime();
+
+  // The entries with the most time spent, highest first
+  static List<Entry> topScripts(size_t count);
+  static List<Entry> topCategories(size_t count);
+
+  static void clear();
+
+private:
+  struct Samples {
+    StringMap<Entry> scripts;
+    StringMap<Entry> categories;
+  };
+
+  static void record(String const& name, uint64_t instructions, double time);
+  static void rotate(double currentTime);
+  static List<Entry> top(StringMap<Entry> Samples::*entries, size_t count);
+
+  static atomic<bool> s_enabled;
+  static Mutex s_mutex;
+  static double s_windowTime;
+  static double s_windowStart;
+  static Samples s_current;
+  static Samples s_previous;
+  static bool s_hasPrevious;
+  static thread_local String const* s_category;
+};
+
+}
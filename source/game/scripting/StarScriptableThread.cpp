@@ -8,12 +8,141 @@
 #include "StarJsonExtra.hpp"
 #include "StarLogging.hpp"
 #include "StarAssets.hpp"
+#include "StarWorkerPool.hpp"
+#include "StarTime.hpp"
 
 namespace Star {
 
+// Schedules pooled ScriptableThreads.  Steps of a thread are dispatched to
+// the worker pool when the thread is due, a single thread never has more
+// than one step running at once.
+class ScriptableThreadPool : public Thread {
+public:
+  static ScriptableThreadPool& singleton();
+
+  ScriptableThreadPool(unsigned workerCount);
+  ~ScriptableThreadPool();
+
+  void add(ScriptableThread* thread);
+  // Waits for any running step of the thread to finish
+  void remove(ScriptableThread* thread);
+  // Marks the thread as due to run now
+  void wake(ScriptableThread* thread);
+
+protected:
+  void run() override;
+
+private:
+  struct Entry {
+    double nextStep;
+    bool running;
+    bool woken;
+  };
+
+  void finishStep(ScriptableThread* thread, Maybe<double> nextStep);
+
+  Mutex m_mutex;
+  ConditionVariable m_condition;
+  HashMap<ScriptableThread*, Entry> m_entries;
+  WorkerPool m_workers;
+  bool m_stop;
+};
+
+ScriptableThreadPool& ScriptableThreadPool::singleton() {
+  static ScriptableThreadPool pool(Root::singleton().configuration()->get("scriptableThreadPoolWorkers").toUInt());
+  return pool;
+}
+
+ScriptableThreadPool::ScriptableThreadPool(unsigned workerCount)
+  : Thread("ScriptableThreadPool"), m_workers("ScriptableThreadPool", max(workerCount, 1u)), m_stop(false) {
+  start();
+}
+
+ScriptableThreadPool::~ScriptableThreadPool() {
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_condition.broadcast();
+  }
+  join();
+  m_workers.finish();
+}
+
+void ScriptableThreadPool::add(ScriptableThread* thread) {
+  MutexLocker locker(m_mutex);
+  m_entries[thread] = Entry{0.0, false, false};
+  m_condition.broadcast();
+}
+
+void ScriptableThreadPool::remove(ScriptableThread* thread) {
+  MutexLocker locker(m_mutex);
+  while (true) {
+    auto i = m_entries.find(thread);
+    if (i == m_entries.end())
+      return;
+    if (!i->second.running) {
+      m_entries.erase(i);
+      return;
+    }
+    m_condition.wait(m_mutex);
+  }
+}
+
+void ScriptableThreadPool::wake(ScriptableThread* thread) {
+  MutexLocker locker(m_mutex);
+  if (auto entry = m_entries.ptr(thread)) {
+    entry->nextStep = 0.0;
+    entry->woken = true;
+    m_condition.broadcast();
+  }
+}
+
+void ScriptableThreadPool::run() {
+  MutexLocker locker(m_mutex);
+  while (!m_stop) {
+    double now = Time::monotonicTime();
+    double nextStep = highest<double>();
+    for (auto& p : m_entries) {
+      auto& entry = p.second;
+      if (entry.running)
+        continue;
+      if (entry.nextStep <= now) {
+        ScriptableThread* thread = p.first;
+        entry.running = true;
+        entry.woken = false;
+        m_workers.addWork([this, thread]() {
+            finishStep(thread, thread->poolStep());
+          });
+      } else {
+        nextStep = min(nextStep, entry.nextStep);
+      }
+    }
+
+    if (nextStep == highest<double>())
+      m_condition.wait(m_mutex);
+    else
+      m_condition.wait(m_mutex, (unsigned)ceil(max(nextStep - now, 0.0) * 1000));
+  }
+}
+
+void ScriptableThreadPool::finishStep(ScriptableThread* thread, Maybe<double> nextStep) {
+  MutexLocker locker(m_mutex);
+  if (auto entry = m_entries.ptr(thread)) {
+    if (!nextStep) {
+      m_entries.remove(thread);
+    } else {
+      entry->running = false;
+      entry->nextStep = entry->woken ? 0.0 : *nextStep;
+    }
+  }
+  m_condition.broadcast();
+}
+
 ScriptableThread::ScriptableThread(Json parameters)
   : Thread("ScriptableThread: " + parameters.getString("name")),
     m_parameters(std::move(parameters)),
+    m_poolStarted(false),
+    m_lastTickTime(0.0),
     m_stop(false),
     m_errorOccurred(false),
     m_shouldExpire(true) {
@@ -23,6 +152,7 @@ ScriptableThread::ScriptableThread(Json parameters)
       m_name = m_parameters.getString("name");
       
       m_timestep = 1.0f / m_parameters.getFloat("tickRate",60.0f);
+      m_pooled = m_parameters.getBool("pooled", false);
       
       // since thread's not blocking anything important, allow modifying the instruction limit
       if (auto instructionLimit = m_parameters.optUInt("instructionLimit"))
@@ -44,6 +174,8 @@ ScriptableThread::ScriptableThread(Json parameters)
 
 ScriptableThread::~ScriptableThread() {
   m_stop = true;
+  if (m_poolStarted)
+    ScriptableThreadPool::singleton().remove(this);
 
   m_scriptContexts.clear();
   
@@ -53,16 +185,30 @@ ScriptableThread::~ScriptableThread() {
 void ScriptableThread::start() {
   m_stop = false;
   m_errorOccurred = false;
-  Thread::start();
+  if (m_pooled) {
+    m_lastTickTime = Time::monotonicTime();
+    m_poolStarted = true;
+    ScriptableThreadPool::singleton().add(this);
+  } else {
+    Thread::start();
+  }
 }
 
 void ScriptableThread::stop() {
   m_stop = true;
-  Thread::join();
+  if (m_poolStarted) {
+    ScriptableThreadPool::singleton().remove(this);
+    m_poolStarted = false;
+    uninitContexts();
+  } else {
+    Thread::join();
+  }
 }
 
 void ScriptableThread::setPause(bool pause) {
   m_pause = pause;
+  if (m_poolStarted)
+    ScriptableThreadPool::singleton().wake(this);
 }
 
 bool ScriptableThread::errorOccurred() {
@@ -74,8 +220,12 @@ bool ScriptableThread::shouldExpire() {
 }
 
 void ScriptableThread::passMessage(Message&& message) {
-  RecursiveMutexLocker locker(m_messageMutex);
-  m_messages.append(std::move(message));
+  {
+    RecursiveMutexLocker locker(m_messageMutex);
+    m_messages.append(std::move(message));
+  }
+  if (m_poolStarted)
+    ScriptableThreadPool::singleton().wake(this);
 }
 
 void ScriptableThread::run() {
@@ -100,8 +250,7 @@ void ScriptableThread::run() {
     Logger::error("ScriptableThread exception caught: {}", outputException(e, true));
     m_errorOccurred = true;
   }
-  for (auto& p : m_scriptContexts)
-    p.second->uninit();
+  uninitContexts();
 }
 
 Maybe<Json> ScriptableThread::receiveMessage(String const& message, JsonArray const& args) {
@@ -115,6 +264,12 @@ Maybe<Json> ScriptableThread::receiveMessage(String const& message, JsonArray co
 }
 
 void ScriptableThread::update() {
+  updateContexts();
+  handleMessages();
+  LogMap::set(strf("lua_{}_lua_mem", m_name), m_luaRoot->luaMemoryUsage());
+}
+
+void ScriptableThread::updateContexts() {
   float dt = m_timestep;
   
   if (dt > 0.0f && !m_pause) {
@@ -122,7 +277,9 @@ void ScriptableThread::update() {
       p.second->update(p.second->updateDt(dt));
     }
   }
-  
+}
+
+void ScriptableThread::handleMessages() {
   List<Message> messages;
   {
     RecursiveMutexLocker locker(m_messageMutex);
@@ -134,7 +291,55 @@ void ScriptableThread::update() {
     else
       message.promise.fail("Message not handled by thread");
   }
-  LogMap::set(strf("lua_{}_lua_mem", m_name), m_luaRoot->luaMemoryUsage());
+}
+
+Maybe<double> ScriptableThread::poolStep() {
+  try {
+    if (m_timestep > 0.0f) {
+      double now = Time::monotonicTime();
+      auto ticks = (uint64_t)max((now - m_lastTickTime) / m_timestep, 0.0);
+      // Rather than catching up on more than a second of missed ticks, start
+      // over from now
+      if (ticks * m_timestep > 1.0) {
+        ticks = 1;
+        m_lastTickTime = now;
+      } else {
+        m_lastTickTime += ticks * m_timestep;
+      }
+
+      for (uint64_t i = 0; i < ticks && !m_stop; ++i)
+        updateContexts();
+      if (ticks > 0)
+        LogMap::set(strf("lua_{}_lua_mem", m_name), m_luaRoot->luaMemoryUsage());
+    }
+    handleMessages();
+  } catch (std::exception const& e) {
+    Logger::error("ScriptableThread exception caught: {}", outputException(e, true));
+    m_errorOccurred = true;
+  }
+
+  if (m_stop || m_errorOccurred) {
+    uninitContexts();
+    return {};
+  }
+
+  // Until woken by a message, sleep until the first context has something to
+  // do; contexts with an update delta of 0 and no waiting coroutines never do
+  Maybe<unsigned> updates;
+  if (m_timestep > 0.0f && !m_pause) {
+    for (auto& p : m_scriptContexts) {
+      if (auto contextUpdates = p.second->updatesUntilReady())
+        updates = min(updates.value(*contextUpdates), *contextUpdates);
+    }
+  }
+  if (!updates)
+    return highest<double>();
+  return m_lastTickTime + *updates * m_timestep;
+}
+
+void ScriptableThread::uninitContexts() {
+  for (auto& p : m_scriptContexts)
+    p.second->uninit();
 }
 
 LuaCallbacks ScriptableThread::makeThreadCallbacks() {
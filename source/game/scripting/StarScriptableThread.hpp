@@ -12,6 +12,11 @@ STAR_CLASS(ScriptableThread);
 // Runs a Lua in a separate thread and guards exceptions that occur in
 // it.  All methods are designed to not throw exceptions, but will instead log
 // the error and trigger the ScriptableThread error state.
+//
+// With the "pooled" parameter set, the thread is run on a shared worker pool
+// instead of its own thread, concurrently with other pooled threads.  A
+// pooled thread is only scheduled when it has a message or when one of its
+// contexts is due for an update, so idle threads cost nothing.
 class ScriptableThread : public Thread {
 public:
   struct Message {
@@ -36,14 +41,24 @@ public:
   bool errorOccurred();
   bool shouldExpire();
 
-  // 
+  // Queues a message to be handled on the thread's next update, waking the
+  // thread if it is pooled and idle.
   void passMessage(Message&& message);
 
 protected:
   virtual void run();
 
 private:
+  friend class ScriptableThreadPool;
+
   void update();
+  void updateContexts();
+  void handleMessages();
+  // Runs any ticks that are due and handles queued messages, for pooled
+  // threads.  Returns the time the thread next needs to run at, or nothing
+  // if it has stopped.
+  Maybe<double> poolStep();
+  void uninitContexts();
   Maybe<Json> receiveMessage(String const& message, JsonArray const& args);
 
   mutable RecursiveMutex m_mutex;
@@ -55,6 +70,9 @@ private:
   String m_name;
   
   float m_timestep;
+  bool m_pooled;
+  bool m_poolStarted;
+  double m_lastTickTime;
 
   mutable RecursiveMutex m_messageMutex;
   List<Message> m_messages;
@@ -46,6 +46,36 @@ namespace LuaBindings {
   template <typename EntityT>
   using Selector = function<bool(shared_ptr<EntityT> const&)>;
 
+  // Entity lists reused between queries on the same thread.  Queries can
+  // nest through callScript, so each query takes its own list from the pool
+  // and returns it cleared, keeping the capacity.
+  template <typename EntityT>
+  class EntityQueryBuffer {
+  public:
+    EntityQueryBuffer() {
+      auto& pool = freeLists();
+      if (!pool.empty())
+        m_list = pool.takeLast();
+    }
+
+    ~EntityQueryBuffer() {
+      m_list.clear();
+      freeLists().append(std::move(m_list));
+    }
+
+    List<shared_ptr<EntityT>>& list() {
+      return m_list;
+    }
+
+  private:
+    static List<List<shared_ptr<EntityT>>>& freeLists() {
+      static thread_local List<List<shared_ptr<EntityT>>> lists;
+      return lists;
+    }
+
+    List<shared_ptr<EntityT>> m_list;
+  };
+
   template <typename EntityT>
   LuaTable entityQueryImpl(World* world, LuaEngine& engine, LuaTable const& options, Selector<EntityT> selector) {
     Maybe<EntityId> withoutEntityId = options.get<Maybe<EntityId>>("withoutEntityId");
@@ -83,6 +113,7 @@ namespace LuaBindings {
 
     EntityBoundMode boundMode = EntityBoundModeNames.getLeft(options.get<Maybe<String>>("boundMode").value("CollisionArea"));
     Maybe<LuaString> order = options.get<Maybe<LuaString>>("order");
+    Maybe<size_t> maxResults = options.get<Maybe<size_t>>("maxResults");
 
     auto geometry = world->geometry();
 
@@ -143,20 +174,31 @@ namespace LuaBindings {
       return true;
     };
 
-    List<shared_ptr<EntityT>> entities;
+    EntityQueryBuffer<EntityT> buffer;
+    auto& entities = buffer.list();
+    auto collect = [&](EntityPtr const& entity) {
+      if (auto e = as<EntityT>(entity)) {
+        if (innerSelector(e))
+          entities.append(std::move(e));
+      }
+    };
 
     if (lineQuery) {
-      entities = world->lineQuery<EntityT>(lineQuery->min(), lineQuery->max(), innerSelector);
+      world->forEachEntityLine(lineQuery->min(), lineQuery->max(), collect);
     } else if (polyQuery) {
-      entities = world->query<EntityT>(polyQuery->boundBox(), innerSelector);
+      world->forEachEntity(polyQuery->boundBox(), collect);
     } else if (rectQuery) {
-      entities = world->query<EntityT>(*rectQuery, innerSelector);
+      world->forEachEntity(*rectQuery, collect);
     } else if (radiusQuery) {
       RectF region(radiusQuery->first - Vec2F::filled(radiusQuery->second),
           radiusQuery->first + Vec2F::filled(radiusQuery->second));
-      entities = world->query<EntityT>(region, innerSelector);
+      world->forEachEntity(region, collect);
     }
 
+    size_t resultCount = entities.size();
+    if (maxResults)
+      resultCount = min(resultCount, *maxResults);
+
     if (order) {
       if (*order == "nearest") {
         Vec2F nearestPosition;
@@ -168,9 +210,11 @@ namespace LuaBindings {
           nearestPosition = rectQuery->center();
         else if (radiusQuery)
           nearestPosition = radiusQuery->first;
-        sortByComputedValue(entities,
-            [world, nearestPosition](shared_ptr<EntityT> const& entity) {
-              return world->geometry().diff(entity->position(), nearestPosition).magnitude();
+        // Only the returned entities need to end up in order
+        std::partial_sort(entities.begin(), entities.begin() + resultCount, entities.end(),
+            [&geometry, nearestPosition](shared_ptr<EntityT> const& a, shared_ptr<EntityT> const& b) {
+              return vmagSquared(geometry.diff(a->position(), nearestPosition))
+                  < vmagSquared(geometry.diff(b->position(), nearestPosition));
             });
       } else if (*order == "random") {
         Random::shuffle(entities);
@@ -179,10 +223,9 @@ namespace LuaBindings {
       }
     }
 
-    LuaTable entityIds = engine.createTable();
-    int entityIdsIndex = 1;
-    for (auto entity : entities)
-      entityIds.set(entityIdsIndex++, entity->entityId());
+    LuaTable entityIds = engine.createTable(resultCount, 0);
+    for (size_t i = 0; i < resultCount; ++i)
+      entityIds.rawSet(i + 1, entities[i]->entityId());
 
     return entityIds;
   }
@@ -591,6 +634,7 @@ namespace LuaBindings {
     callbacks.registerCallbackWithSignature<Maybe<LuaValue>, EntityId, String, LuaVariadic<LuaValue>>("callScriptedEntity", bind(WorldEntityCallbacks::callScriptedEntity, world, _1, _2, _3));
     callbacks.registerCallbackWithSignature<RpcPromise<Vec2F>, String>("findUniqueEntity", bind(WorldEntityCallbacks::findUniqueEntity, world, _1));
     callbacks.registerCallbackWithSignature<RpcPromise<Json>, LuaEngine&, LuaValue, String, LuaVariadic<Json>>("sendEntityMessage", bind(WorldEntityCallbacks::sendEntityMessage, world, _1, _2, _3, _4));
+    callbacks.registerCallbackWithSignature<RpcPromise<Json>, LuaEngine&, List<LuaValue>, String, LuaVariadic<Json>>("sendEntityMessages", bind(WorldEntityCallbacks::sendEntityMessages, world, _1, _2, _3, _4));
     callbacks.registerCallbackWithSignature<Maybe<List<EntityId>>, EntityId, Maybe<size_t>>("loungingEntities", bind(WorldEntityCallbacks::loungingEntities, world, _1, _2));
     callbacks.registerCallbackWithSignature<Maybe<bool>, EntityId, Maybe<size_t>>("loungeableOccupied", bind(WorldEntityCallbacks::loungeableOccupied, world, _1, _2));
     callbacks.registerCallbackWithSignature<Maybe<size_t>, EntityId>("loungeableAnchorCount", bind(WorldEntityCallbacks::loungeableAnchorCount, world, _1));
@@ -1843,6 +1887,26 @@ namespace LuaBindings {
       return world->sendEntityMessage(engine.luaTo<EntityId>(entityId), message, JsonArray::from(std::move(args)));
   }
 
+  RpcPromise<Json> WorldEntityCallbacks::sendEntityMessages(World* world, LuaEngine& engine, List<LuaValue> const& entityIds, String const& message, LuaVariadic<Json> args) {
+    JsonArray messageArgs = JsonArray::from(std::move(args));
+    List<RpcPromise<Json>> promises;
+    promises.reserve(entityIds.size());
+    for (auto const& entityId : entityIds) {
+      if (entityId.is<LuaString>())
+        promises.append(world->sendEntityMessage(engine.luaTo<String>(entityId), message, messageArgs));
+      else
+        promises.append(world->sendEntityMessage(engine.luaTo<EntityId>(entityId), message, messageArgs));
+    }
+
+    return RpcPromise<Json>::all(std::move(promises)).wrap([](List<Maybe<Json>> const& results) -> Json {
+        JsonArray array;
+        array.reserve(results.size());
+        for (auto const& result : results)
+          array.append(result.value());
+        return array;
+      });
+  }
+
   Maybe<List<EntityId>> WorldEntityCallbacks::loungingEntities(World* world, EntityId entityId, Maybe<size_t> anchorIndex) {
     if (auto entity = world->get<LoungeableEntity>(entityId))
       return entity->entitiesLoungingIn(anchorIndex.value()).values();
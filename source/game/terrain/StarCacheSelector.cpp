@@ -14,13 +14,21 @@ CacheSelector::CacheSelector(
   sourceParameters.seed += seedBias;
   m_source = database->createSelectorType(type, sourceConfig, sourceParameters);
 
-  m_cache.setMaxSize(config.getUInt("lruCacheSize", 20000));
+  m_cache.setMemoryBudget(config.optUInt("cacheMemory").value(config.getUInt("lruCacheSize", 20000) * sizeof(float)));
 }
 
 float CacheSelector::get(int x, int y) const {
-  return m_cache.get(Vec2I(x, y), [this](Vec2I const& key) {
-      return m_source->get(key[0], key[1]);
-    });
+  Vec2I key(x, y);
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto value = m_cache.ptr(key))
+      return *value;
+  }
+
+  float value = m_source->get(x, y);
+  MutexLocker locker(m_cacheMutex);
+  m_cache.set(key, value);
+  return value;
 }
 
 }
@@ -1,8 +1,7 @@
 #pragma once
 
 #include "StarTerrainDatabase.hpp"
-#include "StarLruCache.hpp"
-#include "StarVector.hpp"
+#include "StarSectorLruCache.hpp"
 
 namespace Star {
 
@@ -14,7 +13,8 @@ struct CacheSelector : TerrainSelector {
   float get(int x, int y) const override;
 
   TerrainSelectorConstPtr m_source;
-  mutable HashLruCache<Vec2I, float> m_cache;
+  mutable Mutex m_cacheMutex;
+  mutable SectorLruCache<float> m_cache;
 };
 
 }
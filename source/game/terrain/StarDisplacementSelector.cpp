@@ -53,6 +53,36 @@ float DisplacementSelector::get(int x, int y) const {
   return m_source->get(x_, y_);
 }
 
+void DisplacementSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  List<float> noiseXs(width);
+  List<float> noiseYs(width);
+  List<float> xDisplacement(width);
+  List<float> yDisplacement(width);
+
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    for (int i = 0; i < width; ++i) {
+      noiseXs[i] = (region.xMin() + i) * xXInfluence;
+      noiseYs[i] = y * xYInfluence;
+    }
+    xDisplacementFunction.get(noiseXs.ptr(), noiseYs.ptr(), xDisplacement.ptr(), width);
+
+    for (int i = 0; i < width; ++i) {
+      noiseXs[i] = (region.xMin() + i) * yXInfluence;
+      noiseYs[i] = y * yYInfluence;
+    }
+    yDisplacementFunction.get(noiseXs.ptr(), noiseYs.ptr(), yDisplacement.ptr(), width);
+
+    // The displaced positions are scattered, so the source is still sampled
+    // per tile.
+    for (int i = 0; i < width; ++i) {
+      auto x_ = region.xMin() + i + xDisplacement[i];
+      auto y_ = y + clampY(yDisplacement[i]);
+      *out++ = m_source->get(x_, y_);
+    }
+  }
+}
+
 float DisplacementSelector::clampY(float v) const {
   if (!yClamp)
     return v;
@@ -15,4 +15,12 @@ float FlatSurfaceSelector::get(int, int y) const {
   return flip * (surfaceLevel - (y - adjustment));
 }
 
+void FlatSurfaceSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    std::fill_n(out, width, flip * (surfaceLevel - (y - adjustment)));
+    out += width;
+  }
+}
+
 }
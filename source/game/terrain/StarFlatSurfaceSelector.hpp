@@ -10,6 +10,7 @@ struct FlatSurfaceSelector : TerrainSelector {
   FlatSurfaceSelector(Json const& config, TerrainSelectorParameters const& parameters);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   float surfaceLevel;
   float adjustment;
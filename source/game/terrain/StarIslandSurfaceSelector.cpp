@@ -39,12 +39,36 @@ IslandColumn IslandSurfaceSelector::generateColumn(int x) const {
   return newCol;
 }
 
+IslandColumn IslandSurfaceSelector::column(int x) const {
+  {
+    MutexLocker locker(columnCacheMutex);
+    if (auto col = columnCache.ptr(x))
+      return *col;
+  }
+
+  IslandColumn col = generateColumn(x);
+  MutexLocker locker(columnCacheMutex);
+  columnCache.set(x, col);
+  return col;
+}
+
 float IslandSurfaceSelector::get(int x, int y) const {
-  auto col = columnCache.get(x, [=](int x) {
-      return IslandSurfaceSelector::generateColumn(x);
-    });
+  auto col = column(x);
 
   return (col.topLevel - col.bottomLevel) / 2 - abs((col.topLevel + col.bottomLevel) / 2 - y);
 }
 
+void IslandSurfaceSelector::getRegion(RectI const& region, float* out) const {
+  // Look each column up once rather than once per tile
+  int width = region.width();
+  for (int x = region.xMin(); x < region.xMax(); ++x) {
+    auto col = column(x);
+    float* column = out + (x - region.xMin());
+    for (int y = region.yMin(); y < region.yMax(); ++y) {
+      *column = (col.topLevel - col.bottomLevel) / 2 - abs((col.topLevel + col.bottomLevel) / 2 - y);
+      column += width;
+    }
+  }
+}
+
 }
@@ -17,9 +17,13 @@ struct IslandSurfaceSelector : TerrainSelector {
   IslandSurfaceSelector(Json const& config, TerrainSelectorParameters const& parameters);
 
   float get(int x, int y) const override;
+  void getRegion(RectI const& region, float* out) const override;
 
   IslandColumn generateColumn(int x) const;
+  // Cached generateColumn
+  IslandColumn column(int x) const;
 
+  mutable Mutex columnCacheMutex;
   mutable HashLruCache<int, IslandColumn> columnCache;
 
   PerlinF islandHeight;
@@ -31,9 +31,17 @@ KarstCaveSelector::KarstCaveSelector(Json const& config, TerrainSelectorParamete
 
 float KarstCaveSelector::get(int x, int y) const {
   Vec2I key = Vec2I(x - pmod(x, m_sectorSize), y - pmod(y, m_sectorSize));
-  return m_sectorCache.get(key, [=](Vec2I const& key) {
-      return Sector(this, key);
-    }).get(x, y);
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto sector = m_sectorCache.ptr(key))
+      return sector->get(x, y);
+  }
+
+  Sector sector(this, key);
+  float value = sector.get(x, y);
+  MutexLocker locker(m_cacheMutex);
+  m_sectorCache.set(key, std::move(sector));
+  return value;
 }
 
 KarstCaveSelector::Sector::Sector(KarstCaveSelector const* parent, Vec2I sector)
@@ -41,21 +49,33 @@ KarstCaveSelector::Sector::Sector(KarstCaveSelector const* parent, Vec2I sector)
 
   m_maxValue = 0;
 
+  // The wrapping noise coordinates only depend on x, so they are the same for
+  // every layer in the sector.
+  List<float> noiseXs(parent->m_sectorSize);
+  List<float> noiseYs(parent->m_sectorSize);
+  for (int i = 0; i < parent->m_sectorSize; ++i) {
+    float noiseAngle = 2 * Constants::pi * (sector[0] + i) / parent->m_worldWidth;
+    noiseXs[i] = (std::cos(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
+    noiseYs[i] = (std::sin(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
+  }
+  List<float> caveDecisions(parent->m_sectorSize);
+
   for (int y = sector[1] - parent->m_bufferHeight; y < sector[1] + parent->m_sectorSize + parent->m_bufferHeight; y++) {
     float layerChance = parent->m_layerDensity * parent->m_layerResolution;
     // determine whether this layer has caves
     if (y % parent->m_layerResolution == 0 && staticRandomFloat(parent->m_seed, y) <= layerChance) {
-      LayerPerlins const& layerPerlins = parent->layerPerlins(y);
+      auto layerPerlinsPtr = parent->layerPerlins(y);
+      LayerPerlins const& layerPerlins = *layerPerlinsPtr;
+
+      // determine where caves be at
+      layerPerlins.caveDecision.get(noiseXs.ptr(), noiseYs.ptr(), caveDecisions.ptr(), caveDecisions.size());
 
       // carve out cave layer
       for (int x = sector[0]; x < sector[0] + parent->m_sectorSize; x++) {
-        // use wrapping noise
-        float noiseAngle = 2 * Constants::pi * x / parent->m_worldWidth;
-        float noiseX = (std::cos(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
-        float noiseY = (std::sin(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
+        float noiseX = noiseXs[x - sector[0]];
+        float noiseY = noiseYs[x - sector[0]];
 
-        // determine where caves be at
-        float isThereACaveHere = layerPerlins.caveDecision.get(noiseX, noiseY);
+        float isThereACaveHere = caveDecisions[x - sector[0]];
         if (isThereACaveHere > 0) {
           float taperFactor = isThereACaveHere < parent->m_caveTaperPoint
               ? std::sin((0.5 * Constants::pi * isThereACaveHere) / parent->m_caveTaperPoint)
@@ -100,14 +120,15 @@ void KarstCaveSelector::Sector::set(int x, int y, float value) {
   values[(x - sector[0]) + parent->m_sectorSize * (y - sector[1])] = value;
 }
 
-KarstCaveSelector::LayerPerlins const& KarstCaveSelector::layerPerlins(int y) const {
+auto KarstCaveSelector::layerPerlins(int y) const -> shared_ptr<LayerPerlins const> {
+  MutexLocker locker(m_cacheMutex);
   return m_layerPerlinsCache.get(y, [this](int y) {
-      return LayerPerlins{
+      return make_shared<LayerPerlins const>(LayerPerlins{
         PerlinF(m_caveDecisionPerlinConfig, staticRandomU64(y, m_seed, "CaveDecision")),
         PerlinF(m_layerHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "LayerHeightVariation")),
         PerlinF(m_caveHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveHeightVariation")),
         PerlinF(m_caveFloorVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveFloorVariation"))
-      };
+      });
     });
 }
 
@@ -38,7 +38,7 @@ private:
     float m_maxValue;
   };
 
-  LayerPerlins const& layerPerlins(int y) const;
+  shared_ptr<LayerPerlins const> layerPerlins(int y) const;
 
   int m_sectorSize;
   int m_layerResolution;
@@ -54,7 +54,10 @@ private:
   int m_worldWidth;
   uint64_t m_seed;
 
-  mutable HashLruCache<int, LayerPerlins> m_layerPerlinsCache;
+  // Selectors may be evaluated from several threads at once, sectors are
+  // generated outside of the lock and may rarely be generated twice.
+  mutable Mutex m_cacheMutex;
+  mutable HashLruCache<int, shared_ptr<LayerPerlins const>> m_layerPerlinsCache;
   mutable HashLruCache<Vec2I, Sector> m_sectorCache;
 };
 
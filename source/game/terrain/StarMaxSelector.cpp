@@ -24,4 +24,16 @@ float MaxSelector::get(int x, int y) const {
   return value;
 }
 
+void MaxSelector::getRegion(RectI const& region, float* out) const {
+  size_t count = region.width() * region.height();
+  std::fill_n(out, count, lowest<float>());
+
+  List<float> values(count);
+  for (auto const& source : m_sources) {
+    source->getRegion(region, values.ptr());
+    for (size_t i = 0; i < count; ++i)
+      out[i] = max(out[i], values[i]);
+  }
+}
+
 }
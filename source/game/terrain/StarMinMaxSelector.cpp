@@ -29,4 +29,20 @@ float MinMaxSelector::get(int x, int y) const {
   return value;
 }
 
+void MinMaxSelector::getRegion(RectI const& region, float* out) const {
+  size_t count = region.width() * region.height();
+  std::fill_n(out, count, 0.0f);
+
+  List<float> values(count);
+  for (auto const& source : m_sources) {
+    source->getRegion(region, values.ptr());
+    for (size_t i = 0; i < count; ++i) {
+      if (out[i] > 0 || values[i] > 0)
+        out[i] = max(out[i], values[i]);
+      else
+        out[i] = min(out[i], values[i]);
+    }
+  }
+}
+
 }
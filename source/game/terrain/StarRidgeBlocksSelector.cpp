@@ -32,4 +32,42 @@ float RidgeBlocksSelector::get(int x, int y) const {
   }
 }
 
+void RidgeBlocksSelector::getRegion(RectI const& region, float* out) const {
+  int width = region.width();
+  if (commonality <= 0.0f) {
+    std::fill_n(out, width * region.height(), 0.0f);
+    return;
+  }
+
+  List<float> xs(width);
+  List<float> ys(width);
+  List<float> noise(width);
+  List<float> ridge(width);
+  for (int y = region.yMin(); y < region.yMax(); ++y) {
+    // Same steps as get, including the truncation of the noisy position back
+    // to whole tiles, just a row at a time.
+    for (int i = 0; i < width; ++i) {
+      xs[i] = region.xMin() + i;
+      ys[i] = y;
+    }
+    noisePerlin.get(xs.ptr(), ys.ptr(), noise.ptr(), width);
+    for (int i = 0; i < width; ++i)
+      ys[i] = (int)(region.xMin() + i + noise[i]);
+
+    for (int i = 0; i < width; ++i)
+      xs[i] = y;
+    noisePerlin.get(xs.ptr(), ys.ptr(), noise.ptr(), width);
+    for (int i = 0; i < width; ++i) {
+      xs[i] = ys[i];
+      ys[i] = (int)(y + noise[i]);
+    }
+
+    ridgePerlin1.get(xs.ptr(), ys.ptr(), out, width);
+    ridgePerlin2.get(xs.ptr(), ys.ptr(), ridge.ptr(), width);
+    for (int i = 0; i < width; ++i)
+      out[i] = (out[i] - ridge[i]) * commonality + bias;
+    out += width;
+  }
+}
+
 }
@@ -149,9 +149,17 @@ WormCaveSelector::WormCaveSelector(Json const& config, TerrainSelectorParameters
 
 float WormCaveSelector::get(int x, int y) const {
   Vec2I sector = Vec2I(x - pmod(x, m_sectorSize), y - pmod(y, m_sectorSize));
-  return m_cache.get(sector, [=](Vec2I const& sector) {
-      return WormCaveSector(m_sectorSize, sector, config, parameters.seed, parameters.commonality);
-    }).get(x, y);
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto cached = m_cache.ptr(sector))
+      return cached->get(x, y);
+  }
+
+  WormCaveSector generated(m_sectorSize, sector, config, parameters.seed, parameters.commonality);
+  float value = generated.get(x, y);
+  MutexLocker locker(m_cacheMutex);
+  m_cache.set(sector, std::move(generated));
+  return value;
 }
 
 }
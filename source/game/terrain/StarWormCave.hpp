@@ -33,6 +33,9 @@ public:
 
 private:
   int m_sectorSize;
+  // Sectors are generated outside of the lock, so that other threads may still
+  // read the cache meanwhile.
+  mutable Mutex m_cacheMutex;
   mutable HashLruCache<Vec2I, WormCaveSector> m_cache;
 };
 
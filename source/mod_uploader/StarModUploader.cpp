@@ -326,7 +326,9 @@ void ModUploader::uploadToSteam() {
   };
 
   String packedPath = File::relativeTo(steamUploadDir, "contents.pak");
-  PackedAssetSource::build(*m_assetSource, packedPath, {}, progressCallback);
+  PackedAssetSource::BuildSettings buildSettings;
+  buildSettings.progressCallback = progressCallback;
+  PackedAssetSource::build(*m_assetSource, packedPath, buildSettings);
 
   PublishedFileId_t modId = lexicalCast<PublishedFileId_t>(modIdString);
 
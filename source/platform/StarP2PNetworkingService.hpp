@@ -16,8 +16,10 @@ enum class P2PJoinRequestReply {
   Ignore,
 };
 
-// P2P networking is assumed to be guaranteed in order delivery of arbitrarily
-// sized messages.  Neither the P2PSocket or the P2PNetworkingService are
+// P2P networking is assumed to be guaranteed in order delivery of reliable
+// messages up to maxMessageSize(true) in size.  Unreliable messages may be
+// lost or arrive out of order, and are only supported if
+// maxMessageSize(false) is non-zero.  Neither the P2PSocket or the P2PNetworkingService are
 // assumed to be thread safe interfaces, but access to independent P2PSockets
 // from different threads or access to a P2PSocket and the P2PNetworkingService
 // from different threads is assumed to be safe.
@@ -26,8 +28,9 @@ public:
   virtual ~P2PSocket() = default;
 
   virtual bool isOpen() = 0;
-  virtual bool sendMessage(ByteArray const& message) = 0;
+  virtual bool sendMessage(ByteArray const& message, bool reliable) = 0;
   virtual Maybe<ByteArray> receiveMessage() = 0;
+  virtual size_t maxMessageSize(bool reliable) = 0;
 };
 
 strong_typedef(String, P2PNetworkingPeerId);
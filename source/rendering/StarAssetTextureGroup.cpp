@@ -74,6 +74,9 @@ TexturePtr AssetTextureGroup::loadTexture(AssetPath const& imagePath, bool tryTe
   if (auto existingTexture = m_textureDeduplicationMap.value(image)) {
     m_textureMap.add(imagePath, {existingTexture, Time::monotonicMilliseconds()});
     return existingTexture;
+  } else if (tryTexture && !m_textureGroup->uploadBudgetAvailable()) {
+    // The decoded image stays in the Assets cache until the next frame.
+    return {};
   } else {
     auto texture = m_textureGroup->create(*image);
     m_textureMap.add(imagePath, {texture, Time::monotonicMilliseconds()});
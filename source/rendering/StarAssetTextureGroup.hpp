@@ -23,7 +23,9 @@ public:
   TexturePtr loadTexture(AssetPath const& imagePath);
 
   // If the texture is loaded and ready, returns the texture pointer, otherwise
-  // queues the texture using Assets::tryImage and returns nullptr.
+  // queues the texture using Assets::tryImage and returns nullptr.  Images
+  // that are decoded but not yet uploaded also wait for a later frame once
+  // the renderer's upload budget for this frame is spent.
   TexturePtr tryTexture(AssetPath const& imagePath);
 
   // Has the texture been loaded?
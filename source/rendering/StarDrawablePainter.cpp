@@ -1,7 +1,82 @@
 #include "StarDrawablePainter.hpp"
+#include "StarTime.hpp"
 
 namespace Star {
 
+// Splits off the longest run of operations at the end of the directives that
+// RenderColorOperations can express in its fixed order, combining repeated
+// color replacements and hue shifts.
+static Maybe<pair<AssetPath, RenderColorOperations>> splitColorOperations(AssetPath const& path) {
+  for (auto& directives : path.directives.list())
+    directives.loadOperations();
+
+  List<pair<Directives::Entry const*, Directives const*>> entries;
+  path.directives.forEach([&](auto const& entry, Directives const& directives) {
+      entries.append({&entry, &directives});
+    });
+
+  // 0 allows only color replacements, 1 hue, saturation and brightness
+  // changes too, and 2 a fade as well.
+  int stage = 2;
+  bool fade = false, saturation = false, brightness = false;
+  size_t split = entries.size();
+  while (split > 0) {
+    ImageOperation const& operation = entries[split - 1].first->operation;
+    if (operation.is<FadeToColorImageOperation>() && stage == 2 && !fade) {
+      fade = true;
+    } else if (operation.is<HueShiftImageOperation>() && stage >= 1) {
+      stage = 1;
+    } else if (operation.is<SaturationShiftImageOperation>() && stage >= 1 && !saturation) {
+      stage = 1;
+      saturation = true;
+    } else if (operation.is<BrightnessMultiplyImageOperation>() && stage >= 1 && !brightness) {
+      stage = 1;
+      brightness = true;
+    } else if (operation.is<ColorReplaceImageOperation>()) {
+      stage = 0;
+    } else {
+      break;
+    }
+    --split;
+  }
+
+  if (split == entries.size())
+    return {};
+
+  String baseDirectives;
+  for (size_t i = 0; i < split; ++i) {
+    baseDirectives += "?";
+    baseDirectives += entries[i].first->string(**entries[i].second);
+  }
+
+  RenderColorOperations operations;
+  for (size_t i = split; i < entries.size(); ++i) {
+    ImageOperation const& operation = entries[i].first->operation;
+    if (auto op = operation.ptr<ColorReplaceImageOperation>()) {
+      // Later replacements apply to the results of earlier ones
+      for (auto& p : operations.colorReplace) {
+        if (auto replaced = op->colorReplaceMap.maybe(p.second))
+          p.second = *replaced;
+      }
+      for (auto const& p : op->colorReplaceMap) {
+        if (!operations.colorReplace.contains(p.first))
+          operations.colorReplace.add(p.first, p.second);
+      }
+    } else if (auto op = operation.ptr<HueShiftImageOperation>()) {
+      operations.hueShift += op->hueShiftAmount;
+    } else if (auto op = operation.ptr<SaturationShiftImageOperation>()) {
+      operations.saturationShift = op->saturationShiftAmount;
+    } else if (auto op = operation.ptr<BrightnessMultiplyImageOperation>()) {
+      operations.brightnessMultiply = op->brightnessMultiply;
+    } else if (auto op = operation.ptr<FadeToColorImageOperation>()) {
+      operations.fadeColor = op->color;
+      operations.fadeAmount = op->amount;
+    }
+  }
+
+  return make_pair(AssetPath{path.basePath, path.subPath, std::move(baseDirectives)}, std::move(operations));
+}
+
 DrawablePainter::DrawablePainter(RendererPtr renderer, AssetTextureGroupPtr textureGroup) {
   m_renderer = std::move(renderer);
   m_textureGroup = std::move(textureGroup);
@@ -34,7 +109,15 @@ void DrawablePainter::drawDrawable(Drawable const& drawable) {
     primitives.emplace_back(std::in_place_type_t<RenderPoly>(), poly.vertexes(), color, 0.0f);
 
   } else if (auto imagePart = drawable.part.ptr<Drawable::ImagePart>()) {
-    TexturePtr texture = m_textureGroup->loadTexture(imagePart->image);
+    TexturePtr texture;
+    RenderColorTransformPtr colorTransform;
+    if (m_renderer->colorTransformsSupported() && !imagePart->image.directives.empty()) {
+      auto const& transformed = colorTransformedImage(imagePart->image);
+      texture = m_textureGroup->loadTexture(transformed.texturePath);
+      colorTransform = transformed.colorTransform;
+    } else {
+      texture = m_textureGroup->loadTexture(imagePart->image);
+    }
 
     Vec2F position = drawable.position;
     Vec2F textureSize(texture->size());
@@ -46,17 +129,40 @@ void DrawablePainter::drawDrawable(Drawable const& drawable) {
 
     float param1 = drawable.fullbright ? 0.0f : 1.0f;
 
-    primitives.emplace_back(std::in_place_type_t<RenderQuad>(), std::move(texture),
+    auto& primitive = primitives.emplace_back(std::in_place_type_t<RenderQuad>(), std::move(texture),
         lowerLeft,  Vec2F{0, 0},
         lowerRight, Vec2F{textureSize[0], 0},
         upperRight, Vec2F{textureSize[0], textureSize[1]},
         upperLeft,  Vec2F{0, textureSize[1]},
       color, param1);
+    primitive.get<RenderQuad>().colorTransform = std::move(colorTransform);
   }
 }
 
 void DrawablePainter::cleanup(int64_t textureTimeout) {
+  int64_t time = Time::monotonicMilliseconds();
+  eraseWhere(m_colorTransformedImages, [&](auto const& p) {
+      return time - p.second.lastUsed >= textureTimeout;
+    });
   m_textureGroup->cleanup(textureTimeout);
 }
 
+auto DrawablePainter::colorTransformedImage(AssetPath const& imagePath) -> ColorTransformedImage const& {
+  int64_t time = Time::monotonicMilliseconds();
+  if (auto p = m_colorTransformedImages.ptr(imagePath)) {
+    p->lastUsed = time;
+    return *p;
+  }
+
+  ColorTransformedImage transformed{imagePath, {}, time};
+  if (auto split = splitColorOperations(imagePath)) {
+    // Without a transform, the full path is processed on the CPU as usual
+    if (auto colorTransform = m_renderer->createColorTransform(split->second)) {
+      transformed.texturePath = std::move(split->first);
+      transformed.colorTransform = std::move(colorTransform);
+    }
+  }
+  return m_colorTransformedImages.add(imagePath, std::move(transformed));
+}
+
 }
@@ -17,8 +17,20 @@ public:
   void cleanup(int64_t textureTimeout);
 
 private:
+  // An image drawn with the color operations at the end of its directives
+  // applied by the renderer, so that its texture is shared with every other
+  // coloring of the same image.
+  struct ColorTransformedImage {
+    AssetPath texturePath;
+    RenderColorTransformPtr colorTransform;
+    int64_t lastUsed;
+  };
+
+  ColorTransformedImage const& colorTransformedImage(AssetPath const& imagePath);
+
   RendererPtr m_renderer;
   AssetTextureGroupPtr m_textureGroup;
+  HashMap<AssetPath, ColorTransformedImage> m_colorTransformedImages;
 };
 
 }
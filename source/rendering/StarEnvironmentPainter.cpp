@@ -24,6 +24,7 @@ float const EnvironmentPainter::RayColorDependenceScale = 0.00625f;
 float const EnvironmentPainter::RayUnscaledAlphaVariance = 2.0943f;
 float const EnvironmentPainter::RayMinUnscaledAlpha = 1;
 Vec3B const EnvironmentPainter::RayColor = Vec3B(255, 255, 200);
+float const EnvironmentPainter::StarBakeRate = 8.0f;
 
 EnvironmentPainter::EnvironmentPainter(RendererPtr renderer) {
   m_renderer = std::move(renderer);
@@ -46,51 +47,29 @@ void EnvironmentPainter::renderStars(float pixelRatio, Vec2F const& screenSize,
   Vec4B color(255, 255, 255, 255 * nightSkyAlpha);
 
   Vec2F viewSize = screenSize / pixelRatio;
-  Vec2F viewCenter = viewSize / 2;
-  Vec2F viewMin = sky.starOffset - viewCenter;
 
   auto newStarsHash = starsHash(sky, viewSize);
   if (newStarsHash != m_starsHash || !m_starGenerator) {
     m_starsHash = newStarsHash;
     setupStars(sky);
+    m_starBakeStep = -1;
   }
 
   if (!m_starGenerator || !sky.settings || sky.starFrames == 0 || sky.starTypes().empty())
     return;
 
+  // The baked stars stay on screen for as long as neither moving nor
+  // rotating the view has brought its edge further than the padding.
   float screenBuffer = sky.settings.queryFloat("stars.screenBuffer");
+  float drift = vmag(sky.starOffset - m_starBakeOffset)
+      + std::abs(angleDiff(m_starBakeRotation, sky.starRotation)) * vmag(viewSize) / 2;
 
-  PolyF field = PolyF(RectF::withSize(viewMin, Vec2F(viewSize)).padded(screenBuffer));
-  field.rotate(-sky.starRotation, Vec2F(sky.starOffset));
-
-  Mat3F transform = Mat3F::identity();
-  transform.translate(-viewMin);
-  transform.rotate(sky.starRotation, viewCenter);
-
-  int starTwinkleMin = sky.settings.queryInt("stars.twinkleMin");
-  int starTwinkleMax = sky.settings.queryInt("stars.twinkleMax");
-  size_t starTypesSize = sky.starTypes().size();
-
-  auto stars = m_starGenerator->generate(field, [&](RandomSource& rand) {
-      size_t starType = rand.randu32() % starTypesSize;
-      float frameOffset = rand.randu32() % sky.starFrames + rand.randf(starTwinkleMin, starTwinkleMax);
-      return pair<size_t, float>(starType, frameOffset);
-    });
-
-  RectF viewRect = RectF::withSize(Vec2F(), viewSize).padded(screenBuffer);
-
-  auto& primitives = m_renderer->immediatePrimitives();
-
-  for (auto& star : stars) {
-    Vec2F screenPos = transform.transformVec2(star.first);
-    if (viewRect.contains(screenPos)) {
-      size_t starFrame = (size_t)(sky.epochTime + star.second.second) % sky.starFrames;
-      if (auto const& texture = m_starTextures[star.second.first * sky.starFrames + starFrame])
-        primitives.emplace_back(std::in_place_type_t<RenderQuad>(), texture, screenPos * pixelRatio - Vec2F(texture->size()) / 2, 1.0, color, 0.0f);
-    }
-  }
+  int64_t step = std::floor(sky.epochTime * StarBakeRate);
+  if (step != m_starBakeStep || pixelRatio != m_starBakePixelRatio || color[3] != m_starBakeAlpha || drift >= screenBuffer)
+    bakeStars(pixelRatio, viewSize, sky, step / (double)StarBakeRate, color);
 
-  m_renderer->flush();
+  Mat3F transform = starTransform(pixelRatio, viewSize, sky.starOffset, sky.starRotation);
+  m_renderer->renderBuffer(m_starBuffer, transform * m_starBakeTransform.inverse());
 }
 
 void EnvironmentPainter::renderDebrisFields(float pixelRatio, Vec2F const& screenSize, SkyRenderData const& sky) {  
@@ -467,6 +446,57 @@ uint64_t EnvironmentPainter::starsHash(SkyRenderData const& sky, Vec2F const& vi
   return hasher.digest();
 }
 
+void EnvironmentPainter::bakeStars(float pixelRatio, Vec2F const& viewSize, SkyRenderData const& sky, double epochTime, Vec4B const& color) {
+  float screenBuffer = sky.settings.queryFloat("stars.screenBuffer");
+
+  PolyF field = PolyF(RectF::withSize(sky.starOffset - viewSize / 2, viewSize).padded(screenBuffer));
+  field.rotate(-sky.starRotation, Vec2F(sky.starOffset));
+
+  Mat3F transform = starTransform(pixelRatio, viewSize, sky.starOffset, sky.starRotation);
+
+  int starTwinkleMin = sky.settings.queryInt("stars.twinkleMin");
+  int starTwinkleMax = sky.settings.queryInt("stars.twinkleMax");
+  size_t starTypesSize = sky.starTypes().size();
+
+  auto stars = m_starGenerator->generate(field, [&](RandomSource& rand) {
+      size_t starType = rand.randu32() % starTypesSize;
+      float frameOffset = rand.randu32() % sky.starFrames + rand.randf(starTwinkleMin, starTwinkleMax);
+      return pair<size_t, float>(starType, frameOffset);
+    });
+
+  RectF viewRect = RectF::withSize(Vec2F(), viewSize).padded(screenBuffer).scaled(pixelRatio);
+
+  m_starPrimitives.clear();
+  for (auto& star : stars) {
+    Vec2F screenPos = transform.transformVec2(star.first);
+    if (viewRect.contains(screenPos)) {
+      size_t starFrame = (size_t)(epochTime + star.second.second) % sky.starFrames;
+      if (auto const& texture = m_starTextures[star.second.first * sky.starFrames + starFrame])
+        m_starPrimitives.emplace_back(std::in_place_type_t<RenderQuad>(), texture, screenPos - Vec2F(texture->size()) / 2, 1.0, color, 0.0f);
+    }
+  }
+
+  if (!m_starBuffer)
+    m_starBuffer = m_renderer->createRenderBuffer();
+  m_starBuffer->set(m_starPrimitives);
+
+  m_starBakeStep = std::floor(epochTime * StarBakeRate);
+  m_starBakePixelRatio = pixelRatio;
+  m_starBakeAlpha = color[3];
+  m_starBakeOffset = sky.starOffset;
+  m_starBakeRotation = sky.starRotation;
+  m_starBakeTransform = transform;
+}
+
+Mat3F EnvironmentPainter::starTransform(float pixelRatio, Vec2F const& viewSize, Vec2F const& starOffset, float starRotation) {
+  Vec2F viewCenter = viewSize / 2;
+  Mat3F transform = Mat3F::identity();
+  transform.translate(viewCenter - starOffset);
+  transform.rotate(starRotation, viewCenter);
+  transform.scale(pixelRatio);
+  return transform;
+}
+
 void EnvironmentPainter::setupStars(SkyRenderData const& sky) {
   if (!sky.settings)
     return;
@@ -46,6 +46,9 @@ private:
   static float const RayUnscaledAlphaVariance;
   static float const RayMinUnscaledAlpha;
   static Vec3B const RayColor;
+  // How many times a second the star field is rebuilt to advance its
+  // twinkling, between rebuilds it is only moved.
+  static float const StarBakeRate;
 
   void drawRays(float pixelRatio, SkyRenderData const& sky, Vec2F start, float length, double time, float alpha);
   void drawRay(float pixelRatio,
@@ -61,6 +64,9 @@ private:
 
   uint64_t starsHash(SkyRenderData const& sky, Vec2F const& viewSize) const;
   void setupStars(SkyRenderData const& sky);
+  void bakeStars(float pixelRatio, Vec2F const& viewSize, SkyRenderData const& sky, double epochTime, Vec4B const& color);
+  // Transforms a point in star space to screen pixels
+  static Mat3F starTransform(float pixelRatio, Vec2F const& viewSize, Vec2F const& starOffset, float starRotation);
 
   RendererPtr m_renderer;
   AssetTextureGroupPtr m_textureGroup;
@@ -70,6 +76,18 @@ private:
 
   uint64_t m_starsHash{};
   List<TexturePtr> m_starTextures;
+
+  // Every visible star, along with screenBuffer pixels of padding around the
+  // view, is kept in a render buffer and moved with a transformation until
+  // the view moves past that padding or the stars next twinkle.
+  RenderBufferPtr m_starBuffer;
+  List<RenderPrimitive> m_starPrimitives;
+  int64_t m_starBakeStep = -1;
+  float m_starBakePixelRatio = 0.0f;
+  uint8_t m_starBakeAlpha = 0;
+  Vec2F m_starBakeOffset;
+  float m_starBakeRotation = 0.0f;
+  Mat3F m_starBakeTransform;
   shared_ptr<Random2dPointGenerator<pair<size_t, float>>> m_starGenerator;
   List<shared_ptr<Random2dPointGenerator<pair<String, float>, double>>> m_debrisGenerators;
 };
@@ -5,6 +5,46 @@
 
 namespace Star {
 
+// Pixel size distance field glyphs are rendered at
+unsigned const DistanceFieldGlyphSize = 64;
+// How far from the glyph's edge the distance field reaches, in pixels at
+// DistanceFieldGlyphSize
+unsigned const DistanceFieldSpread = 8;
+
+// Converts the glyph's coverage into a distance field in the alpha channel,
+// padded by the spread on every side
+static Image glyphDistanceField(Image const& glyph) {
+  int spread = DistanceFieldSpread;
+  int width = glyph.width() + spread * 2;
+  int height = glyph.height() + spread * 2;
+
+  List<uint8_t> inside(width * height, 0);
+  for (unsigned y = 0; y < glyph.height(); ++y) {
+    for (unsigned x = 0; x < glyph.width(); ++x)
+      inside[(y + spread) * width + x + spread] = glyph.get(x, y)[3] >= 128;
+  }
+
+  Image distanceField(width, height, PixelFormat::RGBA32);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t in = inside[y * width + x];
+      float closestSquared = spread * spread;
+      for (int dy = max(-spread, -y); dy <= min(spread, height - 1 - y); ++dy) {
+        for (int dx = max(-spread, -x); dx <= min(spread, width - 1 - x); ++dx) {
+          if (inside[(y + dy) * width + x + dx] != in)
+            closestSquared = min<float>(closestSquared, dx * dx + dy * dy);
+        }
+      }
+      // The edge lies half way between the two pixel centers
+      float distance = std::sqrt(closestSquared) - 0.5f;
+      float value = 0.5f + (in ? distance : -distance) / (2.0f * spread);
+      distanceField.set(x, y, Vec4B(255, 255, 255, floatToByte(clamp(value, 0.0f, 1.0f))));
+    }
+  }
+
+  return distanceField;
+}
+
 FontTextureGroup::FontTextureGroup(TextureGroupPtr textureGroup)
   : m_textureGroup(std::move(textureGroup)) {}
 
@@ -29,12 +69,19 @@ String const& FontTextureGroup::activeFont() {
   return m_fontName;
 }
 
-void FontTextureGroup::addFont(FontPtr const& font, String const& name) {
+void FontTextureGroup::addFont(FontPtr const& font, String const& name, bool distanceField) {
   m_fonts[name] = font;
+  if (distanceField)
+    m_distanceFieldFonts.add(font.get());
+}
+
+void FontTextureGroup::setDistanceFieldTextureGroup(TextureGroupPtr textureGroup) {
+  m_distanceFieldTextureGroup = std::move(textureGroup);
 }
 
 void FontTextureGroup::clearFonts() {
   m_fonts.clear();
+  m_distanceFieldFonts.clear();
   m_activeFont = m_defaultFont;
 }
 
@@ -52,12 +99,27 @@ const FontTextureGroup::GlyphTexture& FontTextureGroup::glyphTexture(String::Cha
   Font* font = getFontForCharacter(c);
   if (font == m_emojiFont.get())
     processingDirectives = nullptr;
+  bool distanceField = m_distanceFieldTextureGroup && !processingDirectives && m_distanceFieldFonts.contains(font);
+  if (distanceField)
+    size = DistanceFieldGlyphSize;
   auto res = m_glyphs.insert(GlyphDescriptor{c, size, processingDirectives ? processingDirectives->hash() : 0, font}, GlyphTexture());
   auto& glyphTexture = res.first->second;
   if (res.second) {
     font->setPixelSize(size);
     auto renderResult = font->render(c);
     Image& image = get<0>(renderResult);
+    if (distanceField) {
+      glyphTexture.renderSize = size;
+      // Colored glyphs have no single shape to make a distance field of
+      if (!get<2>(renderResult) && !image.empty()) {
+        image = glyphDistanceField(image);
+        glyphTexture.offset = Vec2F(get<1>(renderResult)) - Vec2F::filled(DistanceFieldSpread);
+        glyphTexture.texture = m_distanceFieldTextureGroup->create(image);
+        glyphTexture.time = Time::monotonicMilliseconds();
+        return glyphTexture;
+      }
+    }
+
     if (processingDirectives) {
       Directives const& directives = *processingDirectives;
       Vec2F preSize = Vec2F(image.size());
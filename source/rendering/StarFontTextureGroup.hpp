@@ -19,6 +19,9 @@ public:
     bool colored = false;
     int64_t time = 0;
     Vec2F offset;
+    // If non-zero, the pixel size the glyph was rendered at for every size,
+    // which it is scaled from when drawn.  Usually as a distance field.
+    unsigned renderSize = 0;
   };
 
   FontTextureGroup(TextureGroupPtr textureGroup);
@@ -36,7 +39,10 @@ public:
   // Switches the current font
   void switchFont(String const& font);
   String const& activeFont();
-  void addFont(FontPtr const& font, String const& name);
+  // Glyphs of distance field fonts are rendered once for every size, into
+  // the distance field texture group, unless they are processed by directives
+  void addFont(FontPtr const& font, String const& name, bool distanceField = false);
+  void setDistanceFieldTextureGroup(TextureGroupPtr textureGroup);
   void clearFonts();
   void setFixedFonts(String const& defaultFontName, String const& fallbackFontName, String const& emojiFontName);
 private:
@@ -50,6 +56,8 @@ private:
   FontPtr m_emojiFont;
 
   TextureGroupPtr m_textureGroup;
+  TextureGroupPtr m_distanceFieldTextureGroup;
+  HashSet<Font*> m_distanceFieldFonts;
   HashMap<GlyphDescriptor, GlyphTexture> m_glyphs;
 };
 
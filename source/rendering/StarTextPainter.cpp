@@ -37,6 +37,7 @@ TextPositioning TextPositioning::translated(Vec2F translation) const {
 TextPainter::TextPainter(RendererPtr renderer, TextureGroupPtr textureGroup)
   : m_renderer(renderer),
     m_fontTextureGroup(textureGroup),
+    m_hasDistanceFieldTextureGroup(false),
     m_defaultRenderSettings(),
     m_renderSettings(),
     m_savedRenderSettings() {
@@ -46,15 +47,7 @@ TextPainter::TextPainter(RendererPtr renderer, TextureGroupPtr textureGroup)
 }
 
 RectF TextPainter::renderText(StringView s, TextPositioning const& position) {
-  RectF rect;
-  if (position.charLimit) {
-    unsigned charLimit = *position.charLimit;
-    rect = doRenderText(s, position, true, &charLimit);
-  } else {
-    rect = doRenderText(s, position, true, nullptr);
-  }
-  renderPrimitives();
-  return rect;
+  return cachedRenderText(s, position, true);
 }
 
 RectF TextPainter::renderLine(StringView s, TextPositioning const& position) {
@@ -76,7 +69,7 @@ RectF TextPainter::renderGlyph(String::Char c, TextPositioning const& position)
 }
 
 RectF TextPainter::determineTextSize(StringView s, TextPositioning const& position) {
-  return doRenderText(s, position, false, nullptr);
+  return cachedRenderText(s, position, false);
 }
 
 RectF TextPainter::determineLineSize(StringView s, TextPositioning const& position) {
@@ -310,11 +303,16 @@ void TextPainter::clearTextStyle() {
   m_fontTextureGroup.switchFont(m_renderSettings.font);
 }
 
-void TextPainter::addFont(FontPtr const& font, String const& name) {
-  m_fontTextureGroup.addFont(font, name);
+void TextPainter::addFont(FontPtr const& font, String const& name, bool distanceField) {
+  if (distanceField && !m_hasDistanceFieldTextureGroup) {
+    m_fontTextureGroup.setDistanceFieldTextureGroup(m_renderer->createTextureGroup(TextureGroupSize::Medium, TextureFiltering::DistanceField));
+    m_hasDistanceFieldTextureGroup = true;
+  }
+  m_fontTextureGroup.addFont(font, name, distanceField);
 }
 
 void TextPainter::reloadFonts() {
+  m_textRunCache.clear();
   m_fontTextureGroup.clearFonts();
   m_fontTextureGroup.cleanup(0);
   auto assets = Root::singleton().assets();
@@ -323,7 +321,10 @@ void TextPainter::reloadFonts() {
       auto font = assets->font(fontPath);
       auto name = AssetPath::filename(fontPath);
       name = name.substr(0, name.findLast("."));
-      addFont(loadFont(fontPath, name), name);
+      bool distanceField = assets->json("/interface.config:font").opt(name).apply([](Json const& config) {
+          return config.getBool("distanceField", false);
+        }).value(false);
+      addFont(loadFont(fontPath, name), name, distanceField);
     }
   };
   loadFontsByExtension("ttf");
@@ -335,6 +336,7 @@ void TextPainter::reloadFonts() {
 }
 
 void TextPainter::cleanup(int64_t timeout) {
+  m_textRunCache.cleanup();
   m_fontTextureGroup.cleanup(timeout);
 }
 
@@ -381,6 +383,58 @@ void TextPainter::modifyDirectives(Directives& directives) {
   }
 }
 
+RectF TextPainter::cachedRenderText(StringView s, TextPositioning const& position, bool reallyRender) {
+  if (s.empty())
+    return RectF(position.pos, position.pos);
+
+  if (m_reloadTracker->pullTriggered())
+    reloadFonts();
+
+  // Glyphs are rounded to whole pixels, so a run can only be moved by whole
+  // pixels without changing how it looks
+  Vec2F origin = Vec2F(std::floor(position.pos[0]), std::floor(position.pos[1]));
+  TextRunKey key{String(s), m_renderSettings.font, m_renderSettings.fontSize, m_renderSettings.lineSpacing,
+      m_renderSettings.color, m_renderSettings.shadow, m_renderSettings.directives.hash(), m_renderSettings.backDirectives.hash(),
+      position.hAnchor, position.vAnchor, position.wrapWidth, position.charLimit, position.pos - origin, reallyRender};
+
+  auto& run = m_textRunCache.get(key, [&](TextRunKey const&) {
+    TextRun run;
+    TextPositioning runPosition = position.translated(-origin);
+    auto& immediatePrimitives = m_renderer->immediatePrimitives();
+    size_t start = immediatePrimitives.size();
+    if (position.charLimit) {
+      unsigned charLimit = *position.charLimit;
+      run.bounds = doRenderText(s, runPosition, reallyRender, &charLimit);
+    } else {
+      run.bounds = doRenderText(s, runPosition, reallyRender, nullptr);
+    }
+    if (reallyRender) {
+      renderPrimitives();
+      for (size_t i = start; i < immediatePrimitives.size(); ++i)
+        run.primitives.append(std::move(immediatePrimitives[i]));
+      immediatePrimitives.resize(start);
+    }
+    run.savedRenderSettings = m_savedRenderSettings;
+    return run;
+  });
+
+  m_savedRenderSettings = run.savedRenderSettings;
+  m_fontTextureGroup.switchFont(m_renderSettings.font);
+
+  auto& immediatePrimitives = m_renderer->immediatePrimitives();
+  for (auto const& primitive : run.primitives) {
+    auto& copy = immediatePrimitives.emplace_back(primitive);
+    if (auto quad = copy.ptr<RenderQuad>()) {
+      quad->a.screenCoordinate += origin;
+      quad->b.screenCoordinate += origin;
+      quad->c.screenCoordinate += origin;
+      quad->d.screenCoordinate += origin;
+    }
+  }
+
+  return run.bounds.translated(origin);
+}
+
 RectF TextPainter::doRenderText(StringView s, TextPositioning const& position, bool reallyRender, unsigned* charLimit) {
   Vec2F pos = position.pos;
   if (s.empty())
@@ -518,6 +572,8 @@ void TextPainter::renderGlyph(String::Char c, Vec2F const& screenPos, List<Rende
     return;
 
   const FontTextureGroup::GlyphTexture& glyphTexture = m_fontTextureGroup.glyphTexture(c, fontSize, processingDirectives);
+  if (glyphTexture.renderSize)
+    scale *= (float)fontSize / glyphTexture.renderSize;
   if (glyphTexture.colored)
     color[0] = color[1] = color[2] = 255;
   out.emplace_back(std::in_place_type_t<RenderQuad>(),
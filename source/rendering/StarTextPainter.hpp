@@ -5,6 +5,7 @@
 #include "StarRoot.hpp"
 #include "StarStringView.hpp"
 #include "StarText.hpp"
+#include "StarTtlCache.hpp"
 
 namespace Star {
 
@@ -74,12 +75,26 @@ public:
   void setFont(String const& font);
   TextStyle& setTextStyle(TextStyle const& textStyle);
   void clearTextStyle();
-  void addFont(FontPtr const& font, String const& name);
+  void addFont(FontPtr const& font, String const& name, bool distanceField = false);
   void reloadFonts();
 
   void cleanup(int64_t textureTimeout);
   void applyCommands(StringView unsplitCommands);
 private:
+  // Everything that decides how renderText or determineTextSize lays out a
+  // string, besides the whole pixel part of its position.
+  typedef tuple<String, String, unsigned, float, Vec4B, Vec4B, size_t, size_t,
+      HorizontalAnchor, VerticalAnchor, Maybe<unsigned>, Maybe<unsigned>, Vec2F, bool> TextRunKey;
+
+  // A laid out string, with its primitives if it was rendered, as though it
+  // were positioned at the sub-pixel offset in its key.
+  struct TextRun {
+    RectF bounds;
+    List<RenderPrimitive> primitives;
+    TextStyle savedRenderSettings;
+  };
+
+  RectF cachedRenderText(StringView s, TextPositioning const& position, bool reallyRender);
   void modifyDirectives(Directives& directives);
   RectF doRenderText(StringView s, TextPositioning const& position, bool reallyRender, unsigned* charLimit);
   RectF doRenderLine(StringView s, TextPositioning const& position, bool reallyRender, unsigned* charLimit);
@@ -94,6 +109,7 @@ private:
   List<RenderPrimitive> m_backPrimitives;
   List<RenderPrimitive> m_frontPrimitives;
   FontTextureGroup m_fontTextureGroup;
+  bool m_hasDistanceFieldTextureGroup;
 
   TextStyle m_defaultRenderSettings;
   TextStyle m_renderSettings;
@@ -101,6 +117,8 @@ private:
 
   String m_nonRenderedCharacters;
   TrackerListenerPtr m_reloadTracker;
+
+  HashTtlCache<TextRunKey, TextRun> m_textRunCache;
 };
 
 }
@@ -7,6 +7,7 @@
 #include "StarAssets.hpp"
 #include "StarRoot.hpp"
 #include "StarTileDrawer.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
@@ -54,7 +55,25 @@ void TilePainter::adjustLighting(WorldRenderData& renderData) const {
     });
 }
 
+List<Vec4F> TilePainter::liquidLightMix(WorldRenderData const& renderData, Vec2U const& lightMapSize) const {
+  List<Vec4F> lightMix;
+  RectI lightRange = RectI::withSize(renderData.lightMinPosition, Vec2I(lightMapSize));
+  forEachRenderTile(renderData, lightRange, [&](Vec2I const& pos, RenderTile const& tile) {
+      float drawLevel = liquidDrawLevel(byteToFloat(tile.liquidLevel));
+      if (drawLevel == 0.0f)
+        return;
+
+      if (lightMix.empty())
+        lightMix.resize(lightMapSize[0] * lightMapSize[1], Vec4F());
+      auto lightIndex = Vec2U(pos - renderData.lightMinPosition);
+      auto const& liquid = m_liquids[tile.liquidId];
+      lightMix[lightIndex[1] * lightMapSize[0] + lightIndex[0]] = Vec4F(liquid.bottomLightMix[0], liquid.bottomLightMix[1], liquid.bottomLightMix[2], drawLevel);
+    });
+  return lightMix;
+}
+
 void TilePainter::setup(WorldCamera const& camera, WorldRenderData& renderData) {
+  STAR_PROFILE_SCOPE("TilePainter::setup");
   auto cameraCenter = camera.centerWorldPosition();
   if (m_lastCameraCenter)
     m_cameraPan = renderData.geometry.diff(cameraCenter, *m_lastCameraCenter);
@@ -86,6 +105,7 @@ void TilePainter::renderMidground(WorldCamera const& camera) {
 }
 
 void TilePainter::renderLiquid(WorldCamera const& camera) {
+  STAR_PROFILE_SCOPE("TilePainter::renderLiquid");
   Mat3F transformation = Mat3F::identity();
   transformation.translate(-Vec2F(camera.worldTileRect().min()));
   transformation.scale(TilePixels * camera.pixelRatio());
@@ -119,18 +139,22 @@ size_t TilePainter::TextureKeyHash::operator()(TextureKey const& key) const {
     return hashOf(key.typeIndex(), key.get<AssetTextureKey>());
 }
 
-TilePainter::ChunkHash TilePainter::terrainChunkHash(WorldRenderData& renderData, Vec2I chunkIndex) {
-  //XXHash3 hasher;
-  static ByteArray buffer;
-  buffer.clear();
-  RectI tileRange = RectI::withSize(chunkIndex * RenderChunkSize, Vec2I::filled(RenderChunkSize)).padded(MaterialRenderProfileMaxNeighborDistance);
-  forEachRenderTile(renderData, tileRange, [&](Vec2I const&, RenderTile const& renderTile) {
-    //renderTile.hashPushTerrain(hasher);
-    buffer.append((char*)&renderTile, offsetof(RenderTile, liquidId));
-  });
-
-  //return hasher.digest();
-  return XXH3_64bits(buffer.ptr(), buffer.size());
+ByteArray TilePainter::terrainChunkTileData(WorldRenderData& renderData, Vec2I chunkIndex) {
+  // Laid out x major over the padded chunk, tiles outside of the render data
+  // are stored as the default tile so every tile has a fixed offset.
+  size_t const TerrainSize = offsetof(RenderTile, liquidId);
+  int const paddedSize = RenderChunkSize + MaterialRenderProfileMaxNeighborDistance * 2;
+  Vec2I min = chunkIndex * RenderChunkSize - Vec2I::filled(MaterialRenderProfileMaxNeighborDistance);
+
+  ByteArray tileData(paddedSize * paddedSize * TerrainSize, 0);
+  char* out = tileData.ptr();
+  for (int x = 0; x < paddedSize; ++x) {
+    for (int y = 0; y < paddedSize; ++y) {
+      memcpy(out, &getRenderTile(renderData, min + Vec2I(x, y)), TerrainSize);
+      out += TerrainSize;
+    }
+  }
+  return tileData;
 }
 
 TilePainter::ChunkHash TilePainter::liquidChunkHash(WorldRenderData& renderData, Vec2I chunkIndex) {
@@ -149,6 +173,7 @@ TilePainter::ChunkHash TilePainter::liquidChunkHash(WorldRenderData& renderData,
 }
 
 void TilePainter::renderTerrainChunks(WorldCamera const& camera, TerrainLayer terrainLayer) {
+  STAR_PROFILE_SCOPE("TilePainter::renderTerrain");
   Map<QuadZLevel, List<RenderBufferPtr>> zOrderBuffers;
   for (auto const& chunk : m_pendingTerrainChunks) {
     for (auto const& pair : chunk->value(terrainLayer))
@@ -169,32 +194,102 @@ void TilePainter::renderTerrainChunks(WorldCamera const& camera, TerrainLayer te
 }
 
 shared_ptr<TilePainter::TerrainChunk const> TilePainter::getTerrainChunk(WorldRenderData& renderData, Vec2I chunkIndex) {
-  pair<Vec2I, ChunkHash> chunkKey = {chunkIndex, terrainChunkHash(renderData, chunkIndex)};
-  return m_terrainChunkCache.get(chunkKey, [&](auto const&) {
-      HashMap<TerrainLayer, HashMap<QuadZLevel, List<RenderPrimitive>>> terrainPrimitives;
-
-      RectI tileRange = RectI::withSize(chunkIndex * RenderChunkSize, Vec2I::filled(RenderChunkSize));
-      for (int x = tileRange.xMin(); x < tileRange.xMax(); ++x) {
-        for (int y = tileRange.yMin(); y < tileRange.yMax(); ++y) {
-          bool occluded = this->produceTerrainPrimitives(terrainPrimitives[TerrainLayer::Foreground], TerrainLayer::Foreground, {x, y}, renderData);
-          occluded = this->produceTerrainPrimitives(terrainPrimitives[TerrainLayer::Midground], TerrainLayer::Midground, {x, y}, renderData) || occluded;
-          if (!occluded)
-            this->produceTerrainPrimitives(terrainPrimitives[TerrainLayer::Background], TerrainLayer::Background, {x, y}, renderData);
+  auto mesh = m_terrainChunkCache.get(chunkIndex, [](auto const&) { return make_shared<TerrainChunkMesh>(); });
+
+  // If every tile the chunk is built from is within the render data, its
+  // revision says whether any of them changed without reading them.
+  uint64_t tileRevision = 0;
+  RectI paddedRegion = RectI::withSize(chunkIndex * RenderChunkSize, Vec2I::filled(RenderChunkSize)).padded(MaterialRenderProfileMaxNeighborDistance);
+  Vec2I paddedOffset = renderData.geometry.diff(paddedRegion.min(), renderData.tileMinPosition);
+  if (renderData.tileRevision && paddedOffset[0] >= 0 && paddedOffset[1] >= 0
+      && paddedOffset[0] + paddedRegion.width() <= (int)renderData.tiles.size(0)
+      && paddedOffset[1] + paddedRegion.height() <= (int)renderData.tiles.size(1))
+    tileRevision = renderData.tileRevision(paddedRegion);
+  if (mesh->chunk && tileRevision != 0 && mesh->tileRevision == tileRevision)
+    return mesh->chunk;
+
+  ByteArray tileData = terrainChunkTileData(renderData, chunkIndex);
+  mesh->tileRevision = tileRevision;
+  if (mesh->chunk && mesh->tileData == tileData)
+    return mesh->chunk;
+
+  // A tile is rebuilt if anything within neighbor distance of it changed,
+  // or every tile is if the chunk has not been built before.
+  int const neighborDistance = MaterialRenderProfileMaxNeighborDistance;
+  int const chunkSize = RenderChunkSize;
+  List<bool> dirtyTiles(chunkSize * chunkSize, !mesh->chunk);
+  if (mesh->chunk) {
+    size_t const TerrainSize = offsetof(RenderTile, liquidId);
+    int const paddedSize = chunkSize + neighborDistance * 2;
+    for (int x = 0; x < paddedSize; ++x) {
+      for (int y = 0; y < paddedSize; ++y) {
+        size_t offset = (x * paddedSize + y) * TerrainSize;
+        if (memcmp(tileData.ptr() + offset, mesh->tileData.ptr() + offset, TerrainSize) == 0)
+          continue;
+        // Padded position x is chunk tile x - neighborDistance
+        for (int tx = max(x - neighborDistance * 2, 0); tx <= min(x, chunkSize - 1); ++tx) {
+          for (int ty = max(y - neighborDistance * 2, 0); ty <= min(y, chunkSize - 1); ++ty)
+            dirtyTiles[tx * chunkSize + ty] = true;
         }
       }
-
-      auto chunk = make_shared<TerrainChunk>();
-
-      for (auto& layerPair : terrainPrimitives) {
+    }
+  }
+  mesh->tileData = std::move(tileData);
+  mesh->tilePrimitives.resize(chunkSize * chunkSize);
+
+  Vec2I chunkMin = chunkIndex * RenderChunkSize;
+  HashMap<TerrainLayer, HashMap<QuadZLevel, List<RenderPrimitive>>> tileTerrainPrimitives;
+  for (int x = 0; x < chunkSize; ++x) {
+    for (int y = 0; y < chunkSize; ++y) {
+      size_t index = x * chunkSize + y;
+      if (!dirtyTiles[index])
+        continue;
+
+      Vec2I pos = chunkMin + Vec2I(x, y);
+      bool occluded = produceTerrainPrimitives(tileTerrainPrimitives[TerrainLayer::Foreground], TerrainLayer::Foreground, pos, renderData);
+      occluded = produceTerrainPrimitives(tileTerrainPrimitives[TerrainLayer::Midground], TerrainLayer::Midground, pos, renderData) || occluded;
+      if (!occluded)
+        produceTerrainPrimitives(tileTerrainPrimitives[TerrainLayer::Background], TerrainLayer::Background, pos, renderData);
+
+      auto& tilePrimitives = mesh->tilePrimitives[index];
+      tilePrimitives.clear();
+      for (auto& layerPair : tileTerrainPrimitives) {
         for (auto& zLevelPair : layerPair.second) {
-          auto rb = m_renderer->createRenderBuffer();
-          rb->set(zLevelPair.second);
-          (*chunk)[layerPair.first][zLevelPair.first] = std::move(rb);
+          for (auto& primitive : zLevelPair.second)
+            tilePrimitives.append({layerPair.first, zLevelPair.first, std::move(primitive)});
         }
       }
+      tileTerrainPrimitives.clear();
+    }
+  }
 
-      return chunk;
-    });
+  HashMap<TerrainLayer, HashMap<QuadZLevel, List<RenderPrimitive>>> terrainPrimitives;
+  for (auto const& tilePrimitives : mesh->tilePrimitives) {
+    for (auto const& terrainPrimitive : tilePrimitives)
+      terrainPrimitives[terrainPrimitive.layer][terrainPrimitive.zLevel].append(terrainPrimitive.primitive);
+  }
+
+  // Buffers are kept for the layers and z levels the chunk still has, and
+  // only upload what changed.
+  auto chunk = make_shared<TerrainChunk>();
+  for (auto& layerPair : terrainPrimitives) {
+    for (auto& zLevelPair : layerPair.second) {
+      RenderBufferPtr rb;
+      if (mesh->chunk) {
+        if (auto layer = mesh->chunk->ptr(layerPair.first))
+          rb = layer->value(zLevelPair.first);
+      }
+      if (!rb) {
+        rb = m_renderer->createRenderBuffer();
+        rb->setRetainVertexData(true);
+      }
+      rb->set(zLevelPair.second);
+      (*chunk)[layerPair.first][zLevelPair.first] = std::move(rb);
+    }
+  }
+
+  mesh->chunk = chunk;
+  return chunk;
 }
 
 shared_ptr<TilePainter::LiquidChunk const> TilePainter::getLiquidChunk(WorldRenderData& renderData, Vec2I chunkIndex) {
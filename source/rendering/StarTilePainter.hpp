@@ -31,6 +31,10 @@ public:
 
   // Adjusts lighting levels for liquids.
   void adjustLighting(WorldRenderData& renderData) const;
+  // The same adjustment as inputs for a renderer calculated lightmap of the
+  // given size, the bottom light mix in rgb and the liquid draw level in
+  // alpha, or empty if there is no liquid.
+  List<Vec4F> liquidLightMix(WorldRenderData const& renderData, Vec2U const& lightMapSize) const;
 
   // Sets up chunk data for every chunk that intersects the rendering region
   // and prepares it for rendering.  Do not call cleanup in between calling
@@ -62,6 +66,25 @@ private:
   typedef HashMap<TerrainLayer, HashMap<QuadZLevel, RenderBufferPtr>> TerrainChunk;
   typedef HashMap<LiquidId, RenderBufferPtr> LiquidChunk;
 
+  struct TerrainPrimitive {
+    TerrainLayer layer;
+    QuadZLevel zLevel;
+    RenderPrimitive primitive;
+  };
+
+  // Everything a terrain chunk was last built from, so that when a few tiles
+  // change only the tiles within neighbor distance of them are rebuilt, and
+  // the chunk's render buffers are updated in place.
+  struct TerrainChunkMesh {
+    // Terrain data of the chunk's tiles and of their neighbors
+    ByteArray tileData;
+    // Revision of the tiles tileData was taken from, 0 if unknown
+    uint64_t tileRevision = 0;
+    // The primitives of each tile in the chunk, indexed by x * RenderChunkSize + y
+    List<List<TerrainPrimitive>> tilePrimitives;
+    shared_ptr<TerrainChunk const> chunk;
+  };
+
   typedef tuple<MaterialId, MaterialRenderPieceIndex, MaterialHue, bool> MaterialPieceTextureKey;
   typedef String AssetTextureKey;
   typedef Variant<MaterialPieceTextureKey, AssetTextureKey> TextureKey;
@@ -74,7 +97,7 @@ private:
   // RenderChunkSize results in the coordinate of the lower left most tile in
   // the render chunk.
 
-  static ChunkHash terrainChunkHash(WorldRenderData& renderData, Vec2I chunkIndex);
+  static ByteArray terrainChunkTileData(WorldRenderData& renderData, Vec2I chunkIndex);
   static ChunkHash liquidChunkHash(WorldRenderData& renderData, Vec2I chunkIndex);
 
   void renderTerrainChunks(WorldCamera const& camera, TerrainLayer terrainLayer);
@@ -94,7 +117,7 @@ private:
   TextureGroupPtr m_textureGroup;
 
   HashTtlCache<TextureKey, TexturePtr, TextureKeyHash> m_textureCache;
-  HashTtlCache<pair<Vec2I, ChunkHash>, shared_ptr<TerrainChunk const>> m_terrainChunkCache;
+  HashTtlCache<Vec2I, shared_ptr<TerrainChunkMesh>> m_terrainChunkCache;
   HashTtlCache<pair<Vec2I, ChunkHash>, shared_ptr<LiquidChunk const>> m_liquidChunkCache;
 
   List<shared_ptr<TerrainChunk const>> m_pendingTerrainChunks;
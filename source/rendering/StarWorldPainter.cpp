@@ -4,6 +4,7 @@
 #include "StarConfiguration.hpp"
 #include "StarAssets.hpp"
 #include "StarJsonExtra.hpp"
+#include "StarTraceProfiler.hpp"
 
 namespace Star {
 
@@ -50,6 +51,7 @@ void WorldPainter::update(float dt) {
 }
 
 void WorldPainter::render(WorldRenderData& renderData, function<bool()> lightWaiter) {
+  STAR_PROFILE_SCOPE("WorldPainter::render");
   m_camera.setScreenSize(m_renderer->screenSize());
   m_camera.setTargetPixelRatio(Root::singleton().configuration()->get("zoomLevel").toFloat());
 
@@ -59,37 +61,56 @@ void WorldPainter::render(WorldRenderData& renderData, function<bool()> lightWai
 
   // Stars, Debris Fields, Sky, and Orbiters
 
-  // Use a fixed pixel ratio for certain things.
-  float pixelRatioBasis = m_camera.screenSize()[1] / 1080.0f;
-  float starAndDebrisRatio = lerp(0.0625f, pixelRatioBasis * 2.0f, m_camera.pixelRatio());
-  float orbiterAndPlanetRatio = lerp(0.125f, pixelRatioBasis * 3.0f, m_camera.pixelRatio());
-
-  m_environmentPainter->renderStars(starAndDebrisRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  m_environmentPainter->renderDebrisFields(starAndDebrisRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  if (renderData.skyRenderData.type != SkyType::Atmosphereless)
-    m_environmentPainter->renderBackOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  m_environmentPainter->renderPlanetHorizon(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  m_environmentPainter->renderSky(Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  m_environmentPainter->renderFrontOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
-  if (renderData.skyRenderData.type == SkyType::Atmosphereless)
-    m_environmentPainter->renderBackOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+  {
+    STAR_PROFILE_SCOPE("WorldPainter::sky");
+    // Use a fixed pixel ratio for certain things.
+    float pixelRatioBasis = m_camera.screenSize()[1] / 1080.0f;
+    float starAndDebrisRatio = lerp(0.0625f, pixelRatioBasis * 2.0f, m_camera.pixelRatio());
+    float orbiterAndPlanetRatio = lerp(0.125f, pixelRatioBasis * 3.0f, m_camera.pixelRatio());
+
+    m_environmentPainter->renderStars(starAndDebrisRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    m_environmentPainter->renderDebrisFields(starAndDebrisRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    if (renderData.skyRenderData.type != SkyType::Atmosphereless)
+      m_environmentPainter->renderBackOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    m_environmentPainter->renderPlanetHorizon(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    m_environmentPainter->renderSky(Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    m_environmentPainter->renderFrontOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
+    if (renderData.skyRenderData.type == SkyType::Atmosphereless)
+      m_environmentPainter->renderBackOrbiters(orbiterAndPlanetRatio, Vec2F(m_camera.screenSize()), renderData.skyRenderData);
 
-  m_renderer->flush();
+    m_renderer->flush();
+  }
 
   bool lightMapUpdated = lightWaiter ? lightWaiter() : false;
 
-  m_renderer->setEffectParameter("lightMapEnabled", !renderData.isFullbright);
-  if (renderData.isFullbright) {
-    m_renderer->setEffectTexture("lightMap", Image::filled(Vec2U(1, 1), { 255, 255, 255, 255 }, PixelFormat::RGB24));
-    m_renderer->setEffectParameter("lightMapMultiplier", 1.0f);
-  } else {
-    if (lightMapUpdated) {
-      adjustLighting(renderData);
-      m_renderer->setEffectTexture("lightMap", renderData.lightMap);
+  {
+    STAR_PROFILE_SCOPE("WorldPainter::lighting");
+    m_renderer->setEffectParameter("lightMapEnabled", !renderData.isFullbright);
+    if (renderData.isFullbright) {
+      m_renderer->setEffectTexture("lightMap", Image::filled(Vec2U(1, 1), { 255, 255, 255, 255 }, PixelFormat::RGB24));
+      m_renderer->setEffectParameter("lightMapMultiplier", 1.0f);
+    } else {
+      if (lightMapUpdated && !renderData.lightingInput.empty()) {
+        auto& input = renderData.lightingInput;
+        RenderLightmap lightmap;
+        lightmap.size = input.size;
+        lightmap.cells = std::move(input.cells);
+        lightmap.region = input.queryRegion;
+        for (auto const& light : input.pointLights)
+          lightmap.pointLights.append({light.position, light.value, light.beam, light.beamAngle, light.beamAmbience, light.asSpread});
+        lightmap.spreadSteps = input.spreadSteps;
+        lightmap.parameters = input.parameters;
+        lightmap.liquidLightMix = m_tilePainter->liquidLightMix(renderData, input.queryRegion.size());
+        m_renderer->setEffectLightmap("lightMap", lightmap);
+        input = CellularLightingInput();
+      } else if (lightMapUpdated) {
+        adjustLighting(renderData);
+        m_renderer->setEffectTexture("lightMap", renderData.lightMap);
+      }
+      m_renderer->setEffectParameter("lightMapMultiplier", m_assets->json("/rendering.config:lightMapMultiplier").toFloat());
+      m_renderer->setEffectParameter("lightMapScale", Vec2F::filled(TilePixels * m_camera.pixelRatio()));
+      m_renderer->setEffectParameter("lightMapOffset", m_camera.worldToScreen(Vec2F(renderData.lightMinPosition)));
     }
-    m_renderer->setEffectParameter("lightMapMultiplier", m_assets->json("/rendering.config:lightMapMultiplier").toFloat());
-    m_renderer->setEffectParameter("lightMapScale", Vec2F::filled(TilePixels * m_camera.pixelRatio()));
-    m_renderer->setEffectParameter("lightMapOffset", m_camera.worldToScreen(Vec2F(renderData.lightMinPosition)));
   }
 
   // Parallax layers
@@ -102,8 +123,10 @@ void WorldPainter::render(WorldRenderData& renderData, function<bool()> lightWai
   m_previousCameraCenter = m_camera.centerWorldPosition();
   m_parallaxWorldPosition[1] = m_camera.centerWorldPosition()[1];
 
-  if (!renderData.parallaxLayers.empty())
+  if (!renderData.parallaxLayers.empty()) {
+    STAR_PROFILE_SCOPE("WorldPainter::parallax");
     m_environmentPainter->renderParallaxLayers(m_parallaxWorldPosition, m_camera, renderData.parallaxLayers, renderData.skyRenderData);
+  }
 
   // Main world layers
 
@@ -167,6 +190,7 @@ void WorldPainter::adjustLighting(WorldRenderData& renderData) {
 }
 
 void WorldPainter::renderParticles(WorldRenderData& renderData, Particle::Layer layer) {
+  STAR_PROFILE_SCOPE("WorldPainter::particles");
   const int textParticleFontSize = m_assets->json("/rendering.config:textParticleFontSize").toInt();
   const RectF particleRenderWindow = RectF::withSize(Vec2F(), Vec2F(m_camera.screenSize())).padded(m_assets->json("/rendering.config:particleRenderWindowPadding").toInt());
 
@@ -264,6 +288,7 @@ void WorldPainter::renderBars(WorldRenderData& renderData) {
 }
 
 void WorldPainter::drawEntityLayer(List<Drawable> drawables, EntityHighlightEffect highlightEffect) {
+  STAR_PROFILE_SCOPE("WorldPainter::entities");
   highlightEffect.level *= m_highlightConfig.getFloat("maxHighlightLevel", 1.0);
   if (m_highlightDirectives.contains(highlightEffect.type) && highlightEffect.level > 0) {
     // first pass, draw underlay
@@ -0,0 +1,77 @@
+#include "StarServerMetricsThread.hpp"
+#include "StarLogging.hpp"
+#include "StarMetrics.hpp"
+#include "StarRoot.hpp"
+#include "StarConfiguration.hpp"
+
+namespace Star {
+
+ServerMetricsThread::ServerMetricsThread(HostAddressWithPort const& address)
+  : Thread("MetricsServer"), m_metricsServer(address), m_stop(true) {}
+
+ServerMetricsThread::~ServerMetricsThread() {
+  stop();
+  join();
+}
+
+void ServerMetricsThread::start() {
+  m_stop = false;
+  Thread::start();
+}
+
+void ServerMetricsThread::stop() {
+  m_stop = true;
+  m_metricsServer.stop();
+}
+
+void ServerMetricsThread::run() {
+  auto timeout = Root::singleton().configuration()->get("metricsServerTimeout").toInt();
+  while (!m_stop) {
+    try {
+      if (auto socket = m_metricsServer.accept(100)) {
+        socket->setTimeout(timeout);
+        handleRequest(socket);
+      }
+    } catch (SocketClosedException const&) {
+      break;
+    } catch (std::exception const& e) {
+      Logger::warn("ServerMetricsThread failed to answer request: {}", outputException(e, false));
+    }
+  }
+}
+
+void ServerMetricsThread::handleRequest(TcpSocketPtr socket) {
+  String request;
+  char buffer[1024];
+  while (!request.contains("\r\n\r\n") && request.utf8Size() < MaxRequestSize) {
+    size_t read = socket->receive(buffer, sizeof(buffer));
+    if (read == 0)
+      break;
+    request.append(buffer, read);
+  }
+
+  StringList requestLine = request.split("\r\n", 1).maybeFirst().value().splitAny(" ");
+  String status;
+  String body;
+  if (requestLine.size() < 2 || requestLine[0] != "GET") {
+    status = "405 Method Not Allowed";
+  } else if (requestLine[1] != "/metrics" && !requestLine[1].beginsWith("/metrics?")) {
+    status = "404 Not Found";
+  } else {
+    status = "200 OK";
+    body = Metrics::exposition();
+  }
+
+  String response = strf("HTTP/1.0 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+      status, body.utf8Size(), body);
+  char const* data = response.utf8Ptr();
+  size_t remaining = response.utf8Size();
+  while (remaining > 0) {
+    size_t sent = socket->send(data, remaining);
+    data += sent;
+    remaining -= sent;
+  }
+  socket->close();
+}
+
+}
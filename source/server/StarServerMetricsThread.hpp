@@ -0,0 +1,33 @@
+#pragma once
+
+#include "StarThread.hpp"
+#include "StarTcp.hpp"
+
+namespace Star {
+
+STAR_CLASS(ServerMetricsThread);
+
+// Serves the Metrics registry over HTTP at /metrics, for Prometheus to
+// scrape.  Requests are answered one at a time, the thread only ever has to
+// deal with the occasional scraper.
+class ServerMetricsThread : public Thread {
+public:
+  ServerMetricsThread(HostAddressWithPort const& address);
+  ~ServerMetricsThread();
+
+  void start();
+  void stop();
+
+protected:
+  virtual void run();
+
+private:
+  static size_t const MaxRequestSize = 8192;
+
+  void handleRequest(TcpSocketPtr socket);
+
+  TcpServer m_metricsServer;
+  atomic<bool> m_stop;
+};
+
+}
@@ -8,7 +8,9 @@
 #include "StarVersion.hpp"
 #include "StarServerQueryThread.hpp"
 #include "StarServerRconThread.hpp"
+#include "StarServerMetricsThread.hpp"
 #include "StarSignalHandler.hpp"
+#include "StarPreloadManifest.hpp"
 
 using namespace Star;
 
@@ -32,8 +34,18 @@ Json const AdditionalDefaultConfiguration = Json::parseJson(R"JSON(
       "rconServerPassword" : "",
       "rconServerTimeout" : 1000,
 
+      // Serves Prometheus metrics over HTTP at /metrics
+      "runMetricsServer" : false,
+      "metricsServerPort" : 21027,
+      "metricsServerBind" : "::",
+      "metricsServerTimeout" : 1000,
+
       "allowAssetsMismatch" : true,
-      "serverOverrideAssetsDigest" : null
+      "serverOverrideAssetsDigest" : null,
+
+      // Records the assets loaded while running, and loads them all before
+      // accepting connections on the next run.
+      "preloadManifest" : false
     }
   )JSON");
 
@@ -62,6 +74,20 @@ int main(int argc, char** argv) {
         Logger::info("Configured tick rate is {:4.2f}hz", updateRate);
       }
 
+      bool usePreloadManifest = configuration->get("preloadManifest").toBool();
+      String preloadManifestFile = root->toStoragePath("preload.manifest");
+      if (usePreloadManifest) {
+        PreloadManifest::startRecording();
+        if (File::isFile(preloadManifestFile)) {
+          try {
+            auto manifest = PreloadManifest::fromJson(Json::parseJson(File::readFileString(preloadManifestFile)));
+            manifest.preload(Thread::numberOfProcessors());
+          } catch (std::exception const& e) {
+            Logger::warn("Could not use preload manifest '{}': {}", preloadManifestFile, outputException(e, false));
+          }
+        }
+      }
+
       UniverseServerUPtr server = make_unique<UniverseServer>(root->toStoragePath("universe"));
       server->setListeningTcp(true);
       server->start();
@@ -78,6 +104,12 @@ int main(int argc, char** argv) {
         rconServer->start();
       }
 
+      ServerMetricsThreadUPtr metricsServer;
+      if (configuration->get("runMetricsServer").toBool()) {
+        metricsServer = make_unique<ServerMetricsThread>(HostAddressWithPort(configuration->get("metricsServerBind").toString(), configuration->get("metricsServerPort").toInt()));
+        metricsServer->start();
+      }
+
       while (server->isRunning()) {
         if (signalHandler.interruptCaught()) {
           Logger::info("Interrupt caught!");
@@ -89,6 +121,14 @@ int main(int argc, char** argv) {
 
       server->join();
 
+      if (usePreloadManifest) {
+        try {
+          File::overwriteFileWithRename(PreloadManifest::recorded().toJson().printJson(1), preloadManifestFile);
+        } catch (std::exception const& e) {
+          Logger::warn("Could not write preload manifest '{}': {}", preloadManifestFile, outputException(e, false));
+        }
+      }
+
       if (queryServer) {
         queryServer->stop();
         queryServer->join();
@@ -98,6 +138,11 @@ int main(int argc, char** argv) {
         rconServer->stop();
         rconServer->join();
       }
+
+      if (metricsServer) {
+        metricsServer->stop();
+        metricsServer->join();
+      }
     }
 
     Logger::info("Server shutdown gracefully");
@@ -0,0 +1,38 @@
+#include "StarArena.hpp"
+#include "StarMap.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(ArenaTest, Containers) {
+  Arena& arena = Arena::threadArena();
+  arena.reset();
+
+  ArenaList<int> testList;
+  for (int i = 0; i < 4096; ++i)
+    testList.append(i);
+  for (int i = 0; i < 4096; ++i)
+    EXPECT_EQ(testList[i], i);
+
+  HashMap<int, int, std::hash<int>, std::equal_to<int>, ArenaAllocator<pair<int const, int>>> testMap;
+  for (int i = 0; i < 4096; ++i)
+    testMap[i] = i;
+  for (auto const& p : testMap)
+    EXPECT_EQ(p.first, p.second);
+
+  EXPECT_GT(arena.bytesUsed(), 4096 * sizeof(int));
+}
+
+TEST(ArenaTest, Reset) {
+  Arena arena(256);
+  void* first = arena.allocate(16, 16);
+  EXPECT_EQ((size_t)first % 16, 0u);
+  void* large = arena.allocate(1000, 8);
+  EXPECT_NE(large, nullptr);
+  EXPECT_EQ(arena.bytesUsed(), 1016u);
+
+  arena.reset();
+  EXPECT_EQ(arena.bytesUsed(), 0u);
+  EXPECT_EQ(arena.allocate(16, 16), first);
+}
@@ -0,0 +1,73 @@
+#include "StarAtomicSharedPtr.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(AtomicSharedPtrTest, Basic) {
+  AtomicSharedPtr<int> ptr;
+  EXPECT_FALSE(ptr);
+  EXPECT_EQ(ptr.load(), nullptr);
+
+  auto value = make_shared<int>(5);
+  ptr.store(value);
+  EXPECT_TRUE(ptr);
+  EXPECT_EQ(ptr.load(), value);
+  EXPECT_FALSE(ptr.unique());
+
+  AtomicSharedPtr<int> copy = ptr;
+  EXPECT_EQ(copy.load(), value);
+
+  auto weak = ptr.weak();
+  value.reset();
+  ptr.reset();
+  EXPECT_FALSE(weak.expired());
+  copy = AtomicSharedPtr<int>();
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(AtomicSharedPtrTest, ConcurrentReadCopyUpdate) {
+  struct Counted {
+    Counted(atomic<int>& live, int value) : live(live), value(value) { ++live; }
+    ~Counted() { --live; }
+    atomic<int>& live;
+    int value;
+  };
+
+  atomic<int> live(0);
+  {
+    AtomicSharedPtr<Counted> ptr(make_shared<Counted>(live, 0));
+    atomic<bool> stop(false);
+    atomic<bool> failed(false);
+
+    List<ThreadFunction<void>> readers;
+    for (size_t i = 0; i < 4; ++i) {
+      readers.append(Thread::invoke("AtomicSharedPtrTest reader", [&]() {
+          int last = 0;
+          while (!stop) {
+            auto p = ptr.load();
+            if (!p || p->value < last)
+              failed = true;
+            else
+              last = p->value;
+          }
+        }));
+    }
+
+    for (int i = 1; i <= 20000; ++i)
+      ptr.store(make_shared<Counted>(live, i));
+
+    stop = true;
+    for (auto& reader : readers)
+      reader.finish();
+
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(ptr.load()->value, 20000);
+  }
+
+  // The last holder is only retired, another retire may be needed to reclaim
+  // it if a reader was still protecting it at the time.
+  HazardPointer::retire(new int(0));
+  EXPECT_EQ(live, 0);
+}
@@ -78,7 +78,7 @@ namespace {
     return totalRemoved;
   }
 
-  void testBTreeDatabase(size_t testCount, size_t writeRepeat, size_t randCount, size_t rollbackCount, size_t blockSize) {
+  void testBTreeDatabase(size_t testCount, size_t writeRepeat, size_t randCount, size_t rollbackCount, size_t blockSize, bool memoryMapped = false, size_t leafCacheSize = 0) {
     auto tmpFile = File::temporaryFile();
     auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
 
@@ -96,6 +96,8 @@ namespace {
     }
 
     db.setIndexCacheSize(0);
+    db.setMemoryMapped(memoryMapped);
+    db.setLeafCacheSize(leafCacheSize);
     db.setBlockSize(blockSize);
     db.setIODevice(tmpFile);
     db.open();
@@ -174,6 +176,292 @@ TEST(BTreeDatabaseTest, Consistency) {
     testBTreeDatabase(30, 2, 2, 2, 200 + i);
 }
 
+TEST(BTreeDatabaseTest, MemoryMapped) {
+  testBTreeDatabase(500, 3, 5, 5, 512, true);
+  for (size_t i = 0; i < 4; ++i)
+    testBTreeDatabase(30, 2, 2, 2, 200 + i, true);
+}
+
+TEST(BTreeDatabaseTest, LeafCache) {
+  // Small enough to constantly evict, and large enough to hold everything
+  testBTreeDatabase(500, 3, 5, 5, 512, false, 4096);
+  testBTreeDatabase(500, 3, 5, 5, 512, false, 1 << 24);
+  for (size_t i = 0; i < 4; ++i)
+    testBTreeDatabase(30, 2, 2, 2, 200 + i, true, 1024);
+}
+
+TEST(BTreeDatabaseTest, WriteBatch) {
+  for (bool autoCommit : {false, true}) {
+    auto tmpFile = File::temporaryFile();
+    auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+    BTreeDatabase db("TestDB", 4);
+    db.setAutoCommit(autoCommit);
+    db.setBlockSize(512);
+    db.setIODevice(tmpFile);
+    db.open();
+
+    Set<uint32_t> keySet;
+    while (keySet.size() < 500)
+      keySet.add(Random::randUInt(0, MaxKey));
+    List<uint32_t> keys = keySet.values();
+    Random::shuffle(keys);
+
+    BTreeDatabase::WriteBatch batch;
+    for (uint32_t k : keys)
+      batch.insert(toByteArray(k), genBlock(k));
+    // Replaced by the later insert
+    batch.remove(toByteArray(keys[0]));
+    batch.insert(toByteArray(keys[0]), genBlock(keys[0]));
+    EXPECT_EQ(batch.size(), keys.size());
+
+    db.writeBatch(std::move(batch));
+    EXPECT_EQ(db.recordCount(), keys.size());
+    checkAll(db, keys);
+
+    batch.clear();
+    List<uint32_t> removed(keys.begin(), keys.begin() + keys.size() / 2);
+    List<uint32_t> kept(keys.begin() + keys.size() / 2, keys.end());
+    for (uint32_t k : removed)
+      batch.remove(toByteArray(k));
+    db.writeBatch(std::move(batch));
+    checkAll(db, kept);
+
+    BTreeDatabase::WriteBatch badBatch;
+    badBatch.insert(toByteArray(removed[0]), genBlock(removed[0]));
+    badBatch.insert(ByteArray(3, 0), ByteArray());
+    EXPECT_THROW(db.writeBatch(std::move(badBatch)), DBException);
+    checkAll(db, kept);
+
+    db.commit();
+    db.close();
+    db.open();
+    checkAll(db, kept);
+    EXPECT_EQ(db.totalBlockCount(), db.freeBlockCount() + db.indexBlockCount() + db.leafBlockCount());
+    db.close();
+  }
+}
+
+TEST(BTreeDatabaseTest, BloomFilter) {
+  auto tmpFile = File::temporaryFile();
+  auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+  BTreeDatabase db("TestDB", 4);
+  db.setAutoCommit(false);
+  db.setBlockSize(512);
+  db.setIODevice(tmpFile);
+  db.open();
+
+  Set<uint32_t> keySet;
+  while (keySet.size() < 3000)
+    keySet.add(Random::randUInt(0, MaxKey));
+  List<uint32_t> keys = keySet.values();
+  List<uint32_t> firstKeys(keys.begin(), keys.begin() + 200);
+  putAll(db, firstKeys);
+  db.commit();
+
+  // Enabling while open builds from the existing keys
+  db.setBloomFilter(true);
+  checkAll(db, firstKeys);
+
+  // Enough inserts to force the filter to grow at least once
+  List<uint32_t> laterKeys(keys.begin() + 200, keys.end());
+  putAll(db, laterKeys);
+  checkAll(db, keys);
+
+  for (uint32_t k = 0; k < 1000; ++k) {
+    if (!keySet.contains(k)) {
+      EXPECT_FALSE(db.contains(toByteArray(k)));
+      EXPECT_FALSE(db.find(toByteArray(k)));
+    }
+  }
+
+  // Removed keys are still in the filter, but must not be found
+  EXPECT_TRUE(db.remove(toByteArray(keys[0])));
+  EXPECT_FALSE(db.contains(toByteArray(keys[0])));
+
+  db.commit();
+  db.close();
+  db.open();
+  EXPECT_TRUE(db.bloomFilter());
+  checkAll(db, List<uint32_t>(keys.begin() + 1, keys.end()));
+
+  db.setBloomFilter(false);
+  checkAll(db, List<uint32_t>(keys.begin() + 1, keys.end()));
+  db.close();
+}
+
+TEST(BTreeDatabaseTest, Cursor) {
+  auto tmpFile = File::temporaryFile();
+  auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+  BTreeDatabase db("TestDB", 4);
+  db.setAutoCommit(false);
+  db.setBlockSize(512);
+  db.setIODevice(tmpFile);
+  db.open();
+
+  {
+    auto cursor = db.scanAll();
+    EXPECT_FALSE(cursor.next());
+    EXPECT_FALSE(cursor.next());
+  }
+
+  Set<uint32_t> keySet;
+  while (keySet.size() < 2000)
+    keySet.add(Random::randUInt(0, MaxKey));
+  List<uint32_t> keys = keySet.values();
+  Random::shuffle(keys);
+  putAll(db, keys);
+  EXPECT_GT(db.indexLevels(), 0u);
+
+  for (bool prefetch : {false, true}) {
+    List<pair<ByteArray, ByteArray>> all;
+    db.forAll([&](ByteArray key, ByteArray value) { all.append({std::move(key), std::move(value)}); });
+    EXPECT_EQ(all.size(), keySet.size());
+
+    {
+      auto cursor = db.scanAll(prefetch);
+      for (auto const& p : all) {
+        ASSERT_TRUE(cursor.next());
+        EXPECT_EQ(cursor.key(), p.first);
+        EXPECT_EQ(cursor.value(), p.second);
+      }
+      EXPECT_FALSE(cursor.next());
+    }
+
+    for (size_t i = 0; i < 20; ++i) {
+      uint32_t lower = Random::randUInt(0, MaxKey);
+      uint32_t upper = lower + Random::randUInt(0, MaxKey / 10);
+      auto range = db.find(toByteArray(lower), toByteArray(upper));
+      auto rangeCursor = db.scan(toByteArray(lower), toByteArray(upper), prefetch);
+      for (auto const& p : range) {
+        ASSERT_TRUE(rangeCursor.next());
+        EXPECT_EQ(rangeCursor.key(), p.first);
+        EXPECT_EQ(rangeCursor.value(), p.second);
+      }
+      EXPECT_FALSE(rangeCursor.next());
+    }
+
+    // Abandoning a cursor part way must release the read lock
+    {
+      auto partial = db.scanAll(prefetch);
+      EXPECT_TRUE(partial.next());
+    }
+    uint32_t removed = keys.takeLast();
+    EXPECT_TRUE(db.remove(toByteArray(removed)));
+    keySet.remove(removed);
+  }
+
+  db.close();
+}
+
+TEST(BTreeDatabaseTest, ParallelRecovery) {
+  auto tmpFile = File::temporaryFile();
+  auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+  uint32_t const BlockSize = 512;
+  BTreeDatabase db("TestDB", 4);
+  db.setAutoCommit(false);
+  db.setBlockSize(BlockSize);
+  db.setIODevice(tmpFile);
+  db.open();
+
+  Set<uint32_t> keySet;
+  while (keySet.size() < 3000)
+    keySet.add(Random::randUInt(0, MaxKey));
+  List<uint32_t> keys = keySet.values();
+  Random::shuffle(keys);
+  putAll(db, keys);
+  db.commit();
+  EXPECT_GT(db.indexLevels(), 0u);
+
+  auto recover = [&db](unsigned threadCount) {
+    List<pair<ByteArray, ByteArray>> records;
+    size_t errors = 0;
+    db.recoverAll([&](ByteArray key, ByteArray data) { records.append({std::move(key), std::move(data)}); },
+        [&](String const&, std::exception const&) { ++errors; }, threadCount);
+    return make_pair(records, errors);
+  };
+
+  auto sequential = recover(1);
+  EXPECT_EQ(sequential.first.size(), keys.size());
+  EXPECT_EQ(sequential.second, 0u);
+  EXPECT_EQ(recover(4), sequential);
+  db.close();
+
+  // Break the magic of every third leaf block, both modes should lose and
+  // report exactly the same leaves.
+  size_t blockCount = (tmpFile->size() - 512) / BlockSize;
+  size_t leafBlocks = 0;
+  for (size_t i = 0; i < blockCount; ++i) {
+    StreamOffset offset = 512 + (StreamOffset)i * BlockSize;
+    char magic[2];
+    tmpFile->readFullAbsolute(offset, magic, 2);
+    if (magic[0] == 'L' && magic[1] == 'L' && leafBlocks++ % 3 == 0)
+      tmpFile->writeFullAbsolute(offset, "XX", 2);
+  }
+
+  db.open();
+  auto damaged = recover(1);
+  EXPECT_LT(damaged.first.size(), keys.size());
+  EXPECT_GT(damaged.second, 0u);
+  for (unsigned threadCount : {2, 3, 8})
+    EXPECT_EQ(recover(threadCount), damaged);
+  db.close();
+}
+
+TEST(BTreeDatabaseTest, Compaction) {
+  for (uint32_t blockBudget : {8, 64, 100000}) {
+    auto tmpFile = File::temporaryFile();
+    auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+    BTreeDatabase db("TestDB", 4);
+    db.setAutoCommit(false);
+    db.setBlockSize(256);
+    db.setIODevice(tmpFile);
+    db.open();
+
+    Set<uint32_t> keySet;
+    while (keySet.size() < 2000)
+      keySet.add(Random::randUInt(0, MaxKey));
+    List<uint32_t> keys = keySet.values();
+    putAll(db, keys);
+    db.commit();
+
+    // Removing a random 80% leaves free blocks scattered through the file
+    Random::shuffle(keys);
+    List<uint32_t> removed(keys.begin(), keys.begin() + keys.size() * 4 / 5);
+    List<uint32_t> kept(keys.begin() + keys.size() * 4 / 5, keys.end());
+    removeAll(db, removed);
+    db.commit();
+
+    StreamOffset sizeBefore = tmpFile->size();
+    uint32_t freeBefore = db.freeBlockCount();
+
+    size_t steps = 0;
+    while (db.compact(blockBudget) != 0) {
+      EXPECT_EQ(db.totalBlockCount(), db.freeBlockCount() + db.indexBlockCount() + db.leafBlockCount());
+      ASSERT_LT(++steps, 10000u);
+    }
+    checkAll(db, kept);
+
+    EXPECT_LT(tmpFile->size(), sizeBefore);
+    EXPECT_LT(db.freeBlockCount(), freeBefore);
+    EXPECT_EQ(db.totalBlockCount(), db.freeBlockCount() + db.indexBlockCount() + db.leafBlockCount());
+
+    // Nothing more to do, and the compacted database survives a reopen.
+    EXPECT_EQ(db.compact(blockBudget), 0u);
+    db.close();
+    db.open();
+    checkAll(db, kept);
+    putAll(db, removed);
+    db.commit();
+    checkAll(db, keys);
+    db.close();
+  }
+}
+
 TEST(BTreeDatabaseTest, Threading) {
   auto tmpFile = File::temporaryFile();
   auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
@@ -0,0 +1,129 @@
+#include "StarCellularLiquid.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  // A walled box that wraps horizontally, partly flooded on one side.
+  struct TestLiquidWorld : CellularLiquidWorld<int> {
+    TestLiquidWorld(int width, int height) : width(width), height(height), cells(width * height) {
+      for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+          auto& c = cells[x + y * width];
+          c.level = 0.0f;
+          c.pressure = 0.0f;
+          if (x < width / 3 && y > 0 && y < height * 2 / 3) {
+            c.liquid = 1;
+            c.level = 1.0f;
+          }
+        }
+      }
+    }
+
+    Vec2I uniqueLocation(Vec2I const& location) const override {
+      return Vec2I(pmod(location[0], width), location[1]);
+    }
+
+    CellularLiquidCell<int> cell(Vec2I const& location) const override {
+      if (location[1] <= 0 || location[1] >= height - 1)
+        return CellularLiquidCollisionCell();
+      // A wall with a gap at the bottom, the wrap keeps the other side open
+      if (location[0] == width / 2 && location[1] > 3)
+        return CellularLiquidCollisionCell();
+      return cells[location[0] + location[1] * width];
+    }
+
+    void setFlow(Vec2I const& location, CellularLiquidFlowCell<int> const& flow) override {
+      cells[location[0] + location[1] * width] = flow;
+    }
+
+    float totalLevel() const {
+      float total = 0.0f;
+      for (auto const& c : cells)
+        total += c.level;
+      return total;
+    }
+
+    int width;
+    int height;
+    List<CellularLiquidFlowCell<int>> cells;
+  };
+
+  LiquidCellEngineParameters testParameters() {
+    LiquidCellEngineParameters parameters;
+    parameters.lateralMoveFactor = 0.5f;
+    parameters.spreadOverfillUpFactor = 0.25f;
+    parameters.spreadOverfillLateralFactor = 0.75f;
+    parameters.spreadOverfillDownFactor = 0.25f;
+    parameters.pressureEqualizeFactor = 0.5f;
+    parameters.pressureMoveFactor = 0.5f;
+    parameters.maximumPressureLevelImbalance = 0.05f;
+    parameters.minimumLivenPressureChange = 0.0001f;
+    parameters.minimumLivenLevelChange = 0.0001f;
+    parameters.minimumLiquidLevel = 0.0f;
+    parameters.interactTransformationLevel = 0.1f;
+    parameters.equilibriumChangeThreshold = 0.0f;
+    parameters.equilibriumTicks = 0;
+    return parameters;
+  }
+
+  shared_ptr<TestLiquidWorld> simulate(unsigned threadCount, unsigned steps) {
+    auto world = make_shared<TestLiquidWorld>(150, 70);
+    LiquidCellEngine<int> engine(testParameters(), world);
+    engine.setThreadCount(threadCount);
+    engine.visitRegion(RectI(0, 0, world->width, world->height));
+    for (unsigned i = 0; i < steps; ++i)
+      engine.update();
+    return world;
+  }
+}
+
+TEST(CellularLiquidTest, TiledThreadCountsMatch) {
+  auto serial = simulate(1, 40);
+  auto parallel = simulate(4, 40);
+
+  EXPECT_NEAR(serial->totalLevel(), TestLiquidWorld(150, 70).totalLevel(), 0.5f);
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < serial->cells.size(); ++i) {
+    auto const& a = serial->cells[i];
+    auto const& b = parallel->cells[i];
+    if (a.liquid != b.liquid || a.level != b.level || a.pressure != b.pressure)
+      ++mismatches;
+  }
+  EXPECT_EQ(mismatches, 0u);
+}
+
+TEST(CellularLiquidTest, SettledLiquidSleeps) {
+  // Without liven thresholds the liquid never settles by itself
+  auto parameters = testParameters();
+  parameters.minimumLivenPressureChange = 0.0f;
+  parameters.minimumLivenLevelChange = 0.0f;
+  parameters.equilibriumChangeThreshold = 0.001f;
+  parameters.equilibriumTicks = 10;
+
+  auto world = make_shared<TestLiquidWorld>(60, 30);
+  LiquidCellEngine<int> engine(parameters, world);
+  engine.visitRegion(RectI(0, 0, world->width, world->height));
+  engine.update();
+  size_t initiallyActive = engine.activeCells();
+
+  for (unsigned i = 0; i < 2000 && engine.activeCells() > 0; ++i)
+    engine.update();
+  EXPECT_GT(initiallyActive, 0u);
+  EXPECT_EQ(engine.activeCells(), 0u);
+  EXPECT_NEAR(world->totalLevel(), TestLiquidWorld(60, 30).totalLevel(), 0.5f);
+
+  Vec2I bottom(10, 1);
+  EXPECT_TRUE(engine.isAsleep(bottom));
+  engine.visitLocation(bottom);
+  engine.update();
+  EXPECT_FALSE(engine.isAsleep(bottom));
+  EXPECT_GT(engine.activeCells(), 0u);
+}
+
+TEST(CellularLiquidTest, UntiledConservesLevel) {
+  auto world = simulate(0, 40);
+  EXPECT_NEAR(world->totalLevel(), TestLiquidWorld(150, 70).totalLevel(), 0.5f);
+}
@@ -220,3 +220,40 @@ TEST(FlatHashMap, Iterator) {
   std::advance(i, values.size());
   ASSERT_EQ(i, values.end());
 }
+
+TEST(FlatHashMap, MatchesUnorderedMap) {
+  RandomSource rand(1234);
+  FlatHashMap<int, int> testMap;
+  std::unordered_map<int, int> referenceMap;
+
+  for (unsigned i = 0; i < 200000; ++i) {
+    int key = (int)rand.randInt(0, 20000);
+    switch (rand.randInt(0, 3)) {
+      case 0:
+      case 1:
+        ASSERT_EQ(testMap.insert({key, (int)i}).second, referenceMap.insert({key, (int)i}).second);
+        break;
+      case 2:
+        ASSERT_EQ(testMap.erase(key), referenceMap.erase(key));
+        break;
+      case 3:
+        if (i % 1000 == 0)
+          testMap.reserve(testMap.size() + rand.randInt(0, 10000));
+        break;
+    }
+
+    auto found = testMap.find(key);
+    auto expected = referenceMap.find(key);
+    ASSERT_EQ(found == testMap.end(), expected == referenceMap.end());
+    if (expected != referenceMap.end())
+      ASSERT_EQ(found->second, expected->second);
+  }
+
+  ASSERT_EQ(testMap.size(), referenceMap.size());
+  size_t count = 0;
+  for (auto const& p : testMap) {
+    ASSERT_EQ(referenceMap.at(p.first), p.second);
+    ++count;
+  }
+  ASSERT_EQ(count, referenceMap.size());
+}
@@ -0,0 +1,84 @@
+#include "StarImageProcessing.hpp"
+#include "StarImage.hpp"
+#include "StarImageScaling.hpp"
+#include "StarRandom.hpp"
+#include "StarStringView.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+// A sprite sized image drawn from a small palette, with some fully
+// transparent pixels mixed in.
+Image paletteImage(size_t paletteSize) {
+  RandomSource random(31);
+  List<Vec4B> palette;
+  for (size_t i = 0; i < paletteSize; ++i)
+    palette.append(Vec4B(random.randu32() % 256, random.randu32() % 256, random.randu32() % 256, i % 5 == 0 ? 0 : random.randu32() % 256));
+
+  Image image(43, 37, PixelFormat::RGBA32);
+  image.forEachPixel([&](unsigned, unsigned, Vec4B& pixel) {
+      pixel = palette[random.randu32() % palette.size()];
+    });
+  return image;
+}
+
+void checkKernelsMatch(String const& directives, Image const& image) {
+  auto operations = parseImageOperations(directives);
+  setImageOperationKernelsEnabled(false);
+  Image expected = processImageOperations(operations, image);
+  setImageOperationKernelsEnabled(true);
+  Image result = processImageOperations(operations, image);
+
+  EXPECT_EQ(result.size(), expected.size()) << directives.utf8();
+  expected.forEachPixel([&](unsigned x, unsigned y, Vec4B const& pixel) {
+      EXPECT_EQ(result.get(x, y), pixel) << directives.utf8() << " at " << x << ", " << y;
+    });
+}
+
+TEST(ImageProcessingTest, KernelsMatchGenericPath) {
+  Image image = paletteImage(200);
+  checkKernelsMatch("?hueshift=73", image);
+  checkKernelsMatch("?saturation=-40", image);
+  checkKernelsMatch("?brightness=35", image);
+  checkKernelsMatch("?fade=3366ff=0.4", image);
+  checkKernelsMatch("?multiply=80c0ff80", image);
+  checkKernelsMatch("?hueshift=-20?saturation=15?brightness=-10", image);
+}
+
+TEST(ImageProcessingTest, ColorReplaceKernels) {
+  Image image = paletteImage(20);
+  auto replaceFirst = [&](size_t count) {
+    String directives = "?replace";
+    RandomSource random(7);
+    for (size_t i = 0; i < count; ++i) {
+      Vec4B from = image.get(i, 0);
+      directives += strf(";{:02x}{:02x}{:02x}{:02x}={:06x}", from[0], from[1], from[2], from[3], random.randu32() % 0x1000000);
+    }
+    return directives;
+  };
+
+  // Small palettes take the linear scan, larger ones the hash map.
+  checkKernelsMatch(replaceFirst(4), image);
+  checkKernelsMatch(replaceFirst(30), image);
+}
+
+TEST(ImageProcessingTest, ScaleHalf) {
+  Image image(3, 2, PixelFormat::RGBA32);
+  image.set(0, 0, Vec4B(200, 0, 0, 255));
+  image.set(1, 0, Vec4B(0, 0, 0, 0));
+  image.set(0, 1, Vec4B(100, 0, 0, 255));
+  image.set(1, 1, Vec4B(0, 0, 0, 0));
+  image.set(2, 0, Vec4B(0, 0, 0, 0));
+  image.set(2, 1, Vec4B(0, 0, 0, 0));
+
+  Image half = scaleHalf(image);
+  EXPECT_EQ(half.size(), Vec2U(2, 1));
+  // Transparent pixels only lower the alpha, not the color
+  EXPECT_EQ(half.get(0, 0), Vec4B(150, 0, 0, 128));
+  EXPECT_EQ(half.get(1, 0), Vec4B());
+
+  Image paletted = paletteImage(16);
+  Image quarter = scaleHalf(scaleHalf(paletted));
+  EXPECT_EQ(quarter.size(), Vec2U(11, 10));
+}
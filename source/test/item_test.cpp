@@ -1,4 +1,5 @@
 #include "StarItemDatabase.hpp"
+#include "StarRecipeAvailability.hpp"
 
 #include <list>
 
@@ -117,3 +118,48 @@ TEST(ItemTest, ConstructItems) {
   for (auto itemName : itemDatabase->allItems())
     ItemPtr item = itemDatabase->item(ItemDescriptor(itemName, 1));
 }
+
+TEST(ItemTest, RecipeAvailability) {
+  auto makeRecipe = [](List<ItemDescriptor> inputs, StringMap<uint64_t> currencies, String output) {
+    ItemRecipe recipe;
+    recipe.inputs = std::move(inputs);
+    recipe.currencyInputs = std::move(currencies);
+    recipe.output = ItemDescriptor(std::move(output), 1);
+    recipe.duration = 0.0f;
+    recipe.outputRarity = Rarity::Common;
+    recipe.matchInputParameters = false;
+    return recipe;
+  };
+
+  HashSet<ItemRecipe> recipes;
+  recipes.add(makeRecipe({ItemDescriptor("ironbar", 2)}, {}, "ironpickaxe"));
+  recipes.add(makeRecipe({ItemDescriptor("ironbar", 1), ItemDescriptor("plantfibre", 3)}, {}, "rope"));
+  recipes.add(makeRecipe({}, {{"money", 100}}, "ticket"));
+
+  RecipeAvailability availability(recipes);
+  auto checkMatchesSubset = [&](HashMap<ItemDescriptor, uint64_t> const& bag, StringMap<uint64_t> const& currencies) {
+    availability.update(bag, currencies);
+    EXPECT_EQ(availability.available(), ItemDatabase::recipesFromSubset(bag, currencies, recipes));
+  };
+
+  HashMap<ItemDescriptor, uint64_t> bag;
+  StringMap<uint64_t> currencies;
+  checkMatchesSubset(bag, currencies);
+  EXPECT_TRUE(availability.available().empty());
+
+  bag[ItemDescriptor("ironbar", 1)] = 2;
+  checkMatchesSubset(bag, currencies);
+  EXPECT_EQ(availability.available().size(), 1u);
+
+  bag[ItemDescriptor("plantfibre", 1)] = 3;
+  currencies["money"] = 150;
+  checkMatchesSubset(bag, currencies);
+  EXPECT_EQ(availability.available().size(), 3u);
+
+  EXPECT_FALSE(availability.update(bag, currencies));
+
+  bag.remove(ItemDescriptor("ironbar", 1));
+  currencies.remove("money");
+  checkMatchesSubset(bag, currencies);
+  EXPECT_TRUE(availability.available().empty());
+}
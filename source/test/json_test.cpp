@@ -2,6 +2,8 @@
 #include "StarFile.hpp"
 #include "StarJsonPatch.hpp"
 #include "StarJsonPath.hpp"
+#include "StarCompactJson.hpp"
+#include "StarDataStreamDevices.hpp"
 
 #include "gtest/gtest.h"
 
@@ -701,3 +703,44 @@ TEST(JsonTest, MergeQuery) {
   testIdentical("fiz");
   testIdentical("nothing");
 }
+
+TEST(JsonTest, CompactEncoding) {
+  Json json = Json::parseJson(R"JSON(
+      {
+        "name" : "npc",
+        "position" : [12.5, -3.25],
+        "velocity" : [0.1, 1e300],
+        "tiles" : [1, -2, 300000, 0],
+        "mixed" : [1, 2.0, "three", null, true, false, [], {}],
+        "children" : [
+          {"name" : "a", "position" : [1, 2], "nested" : {"name" : "b"}},
+          {"name" : "c", "position" : [3.0, 4.0]}
+        ],
+        "big" : -9223372036854775807,
+        "empty" : ""
+      }
+    )JSON");
+
+  auto encoded = compactJsonEncode(json);
+  Json decoded = compactJsonDecode(encoded);
+  EXPECT_EQ(decoded, json);
+  // Printing distinguishes between ints and floats
+  EXPECT_EQ(decoded.repr(0, true), json.repr(0, true));
+  EXPECT_LT(encoded.size(), DataStreamBuffer::serialize(json).size());
+
+  for (Json scalar : {Json(), Json(true), Json(-5), Json(0.3), Json("s"), Json(JsonArray()), Json(JsonObject())})
+    EXPECT_EQ(compactJsonDecode(compactJsonEncode(scalar)).repr(0, true), scalar.repr(0, true));
+
+  // Compact Json is readable through the regular Json DataStream operator
+  DataStreamBuffer ds;
+  ds.write<Json>(1);
+  writeCompactJson(ds, json);
+  ds.write<Json>("after");
+  ds.seek(0);
+  EXPECT_EQ(ds.read<Json>(), 1);
+  EXPECT_EQ(ds.read<Json>().repr(0, true), json.repr(0, true));
+  EXPECT_EQ(ds.read<Json>(), "after");
+
+  encoded[0] = 99;
+  EXPECT_THROW(compactJsonDecode(encoded), JsonException);
+}
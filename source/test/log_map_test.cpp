@@ -0,0 +1,37 @@
+#include "StarLogging.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(LogMapTest, Values) {
+  LogMap::clear();
+  {
+    LogMap::Value entities("test_entities", "{} in {} sectors");
+    LogMap::Value rate("test_rate", "{:4.2f}Hz");
+    EXPECT_FALSE(LogMap::getValues().contains("test_entities"));
+
+    entities.set(12, 3);
+    rate.set(59.5);
+    EXPECT_EQ(LogMap::getValue("test_entities"), "12 in 3 sectors");
+    EXPECT_EQ(LogMap::getValues().get("test_rate"), "59.50Hz");
+
+    LogMap::clear();
+    EXPECT_FALSE(LogMap::getValues().contains("test_rate"));
+    rate.set(60);
+    EXPECT_EQ(LogMap::getValue("test_rate"), "60.00Hz");
+
+    LogMap::Value moved = std::move(rate);
+    moved.set(30);
+    EXPECT_EQ(LogMap::getValue("test_rate"), "30.00Hz");
+  }
+  EXPECT_TRUE(LogMap::getValues().empty());
+
+  LogMap::Value replaced("test_key");
+  {
+    LogMap::Value replacing("test_key");
+    replacing.set(1);
+  }
+  replaced.set(2);
+  EXPECT_EQ(LogMap::getValue("test_key"), "");
+}
@@ -0,0 +1,122 @@
+#include "StarLogging.hpp"
+#include "StarLexicalCast.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+
+class RecordingLogSink : public LogSink {
+public:
+  RecordingLogSink() {
+    setLevel(LogLevel::Debug);
+  }
+
+  virtual void log(char const* msg, LogLevel) {
+    MutexLocker locker(mutex);
+    while (blocked)
+      unblocked.wait(mutex);
+    messages.append(msg);
+  }
+
+  void setBlocked(bool block) {
+    MutexLocker locker(mutex);
+    blocked = block;
+    unblocked.broadcast();
+  }
+
+  StringList takeMessages() {
+    MutexLocker locker(mutex);
+    return take(messages);
+  }
+
+  Mutex mutex;
+  ConditionVariable unblocked;
+  bool blocked = false;
+  StringList messages;
+};
+
+}
+
+TEST(AsyncLogSinkTest, Ordering) {
+  auto target = make_shared<RecordingLogSink>();
+  auto sink = make_shared<AsyncLogSink>(target, 16);
+  EXPECT_EQ(sink->level(), LogLevel::Debug);
+
+  StringList expected;
+  for (int i = 0; i < 1000; ++i) {
+    String message = strf("message {}", i);
+    sink->log(message.utf8Ptr(), LogLevel::Info);
+    expected.append(message);
+    // Keep well within the queue so that none are dropped
+    if (i % 8 == 7)
+      sink->flush();
+  }
+  sink->flush();
+  EXPECT_EQ(target->takeMessages(), expected);
+  EXPECT_EQ(sink->dropped(), 0u);
+}
+
+TEST(AsyncLogSinkTest, ManyThreads) {
+  auto target = make_shared<RecordingLogSink>();
+  size_t const ThreadCount = 4;
+  size_t const PerThread = 2000;
+  {
+    AsyncLogSink sink(target, 1 << 14);
+    List<ThreadFunction<void>> threads;
+    for (size_t t = 0; t < ThreadCount; ++t) {
+      threads.append(Thread::invoke("AsyncLogSinkTest", [&sink, t]() {
+          for (size_t i = 0; i < PerThread; ++i)
+            sink.log(strf("{} {}", t, i).c_str(), LogLevel::Info);
+        }));
+    }
+    for (auto& thread : threads)
+      thread.finish();
+    EXPECT_EQ(sink.dropped(), 0u);
+  }
+
+  // Destroying the sink writes everything out, in order for each thread
+  auto messages = target->takeMessages();
+  EXPECT_EQ(messages.size(), ThreadCount * PerThread);
+  List<size_t> next(ThreadCount, 0);
+  for (auto const& message : messages) {
+    auto parts = message.split(' ');
+    size_t thread = lexicalCast<size_t>(parts[0]);
+    EXPECT_EQ(lexicalCast<size_t>(parts[1]), next[thread]++);
+  }
+}
+
+TEST(AsyncLogSinkTest, Overflow) {
+  auto target = make_shared<RecordingLogSink>();
+  auto sink = make_shared<AsyncLogSink>(target, 4);
+
+  target->setBlocked(true);
+  for (int i = 0; i < 20; ++i)
+    sink->log("message", LogLevel::Info);
+  target->setBlocked(false);
+  sink->flush();
+
+  // Up to one message may already have been taken by the writer as it blocked
+  uint64_t dropped = sink->dropped();
+  EXPECT_GE(dropped, 15u);
+  EXPECT_LE(dropped, 16u);
+  auto messages = target->takeMessages();
+  EXPECT_EQ(messages.size(), 20 - dropped + 1);
+  EXPECT_EQ(messages.last(), strf("Log queue full, dropped {} messages", dropped));
+}
+
+TEST(LoggerTest, RateLimit) {
+  auto target = make_shared<RecordingLogSink>();
+  Logger::addSink(target);
+  Logger::setRateLimit(3);
+
+  for (int i = 0; i < 10; ++i)
+    Logger::debug("LoggerTest {}", i);
+  Logger::debug("LoggerTest other");
+
+  Logger::setRateLimit(0);
+  Logger::removeSink(target);
+
+  EXPECT_EQ(target->takeMessages(), StringList({"LoggerTest 0", "LoggerTest 1", "LoggerTest 2", "LoggerTest other"}));
+}
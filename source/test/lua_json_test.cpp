@@ -412,3 +412,32 @@ TEST(LuaJsonTest, IntFloat) {
   EXPECT_EQ(context.invokePath<String>("printNumber", 1.0), "1.0");
   EXPECT_EQ(context.invokePath<String>("printNumber", 1), "1");
 }
+
+TEST(LuaJsonTest, NestedContainers) {
+  auto engine = LuaEngine::create();
+  auto context = engine->createContext();
+
+  context.load(
+      R"SCRIPT(
+        function identity(arg)
+          return arg
+        end
+
+        function addNil(arg)
+          arg.inner.added = nil
+          arg.list[3] = nil
+          return arg
+        end
+      )SCRIPT");
+
+  Json nested = JsonObject{
+    {"inner", JsonObject{{"a", 1}, {"b", Json()}, {"c", JsonArray{Json(), 2.5, "three"}}}},
+    {"list", JsonArray{JsonObject(), JsonArray()}},
+    {"nothing", Json()}
+  };
+  EXPECT_EQ(context.invokePath<Json>("identity", nested), nested);
+
+  Json withoutNils = JsonObject{{"inner", JsonObject{{"a", 1}}}, {"list", JsonArray{1, 2}}};
+  Json comp = JsonObject{{"inner", JsonObject{{"a", 1}, {"added", Json()}}}, {"list", JsonArray{1, 2, Json()}}};
+  EXPECT_EQ(context.invokePath<Json>("addNil", withoutNils), comp);
+}
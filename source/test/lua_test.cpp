@@ -730,6 +730,24 @@ TEST(LuaTest, Limits) {
   EXPECT_EQ(context.eval<int>("1 + 1"), 2);
 }
 
+TEST(LuaTest, SafeLibraries) {
+  auto luaEngine = LuaEngine::create();
+  luaEngine->setInstructionLimit(500000);
+  auto context = luaEngine->createContext();
+
+  // Only whitelisted functions and libraries are reachable from a safe engine,
+  // whichever Lua engine the build links.
+  for (auto name : {"io", "debug", "package", "dofile", "loadfile", "load", "require", "collectgarbage"})
+    EXPECT_EQ(context.eval(strf("return {}", name)), LuaNil) << name;
+  for (auto name : {"execute", "exit", "getenv", "remove", "rename", "tmpname"})
+    EXPECT_EQ(context.eval(strf("return os.{}", name)), LuaNil) << name;
+  EXPECT_TRUE(context.eval("return getmetatable(string)").is<LuaBoolean>());
+
+  // Hot loops an engine might compile must still run the instruction hook.
+  EXPECT_THROW(context.eval("local x = 0 while true do x = x + 1 end"), LuaInstructionLimitReached);
+  EXPECT_EQ(context.eval<int>("1 + 1"), 2);
+}
+
 TEST(LuaTest, Errors) {
   auto luaEngine = LuaEngine::create();
   auto context = luaEngine->createContext();
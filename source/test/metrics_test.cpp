@@ -0,0 +1,38 @@
+#include "StarMetrics.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(MetricsTest, Exposition) {
+  Metrics::clear();
+  Metrics::describe("test_ticks_total", Metrics::Type::Counter, "Ticks run");
+  Metrics::describe("test_tick_seconds", Metrics::Type::Histogram, "Tick time", {0.01, 0.1});
+
+  Metrics::addCounter("test_ticks_total", {{"world", "a"}});
+  Metrics::addCounter("test_ticks_total", {{"world", "a"}}, 2);
+  Metrics::setGauge("test_entities", {{"world", "a\"b"}}, 5);
+  Metrics::observe("test_tick_seconds", {}, 0.005);
+  Metrics::observe("test_tick_seconds", {}, 0.05);
+  Metrics::observe("test_tick_seconds", {}, 1.0);
+
+  EXPECT_EQ(Metrics::exposition(),
+      "# TYPE test_entities gauge\n"
+      "test_entities{world=\"a\\\"b\"} 5\n"
+      "# HELP test_tick_seconds Tick time\n"
+      "# TYPE test_tick_seconds histogram\n"
+      "test_tick_seconds_bucket{le=\"0.01\"} 1\n"
+      "test_tick_seconds_bucket{le=\"0.1\"} 2\n"
+      "test_tick_seconds_bucket{le=\"+Inf\"} 3\n"
+      "test_tick_seconds_sum 1.055\n"
+      "test_tick_seconds_count 3\n"
+      "# HELP test_ticks_total Ticks run\n"
+      "# TYPE test_ticks_total counter\n"
+      "test_ticks_total{world=\"a\"} 3\n");
+
+  EXPECT_THROW(Metrics::setGauge("test_ticks_total", {}, 1), MetricsException);
+
+  Metrics::removeSeries("world", "a");
+  EXPECT_FALSE(Metrics::exposition().contains("test_ticks_total"));
+  Metrics::clear();
+}
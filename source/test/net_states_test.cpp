@@ -167,12 +167,23 @@ TEST(NetElements, DeltaSize) {
   auto masterUpdate2 = master.writeNetState(masterUpdate1.second);
 
   // Second delta should be not include any other data than the single 1 byte
-  // changed state, so make sure that it is 1 byte for header, 1 byte for field
-  // number, 1 byte for state, 1 byte for end marker.
-  EXPECT_EQ(masterUpdate2.first.size(), 4u);
+  // changed state, so make sure that it is 1 byte for header, 1 byte for the
+  // changed field mask, 1 byte for state.
+  EXPECT_EQ(masterUpdate2.first.size(), 3u);
 
   slave.readNetState(masterUpdate2.first);
   EXPECT_EQ(slaveField1.get(), 50);
+
+  // Older protocol versions get 1 byte for field number and 1 byte for end
+  // marker instead of the mask.
+  NetCompatibilityRules oldRules((VersionNumber)16);
+  masterField3.set(60);
+  auto masterUpdate3 = master.writeNetState(masterUpdate2.second, oldRules);
+  EXPECT_EQ(masterUpdate3.first.size(), 4u);
+
+  slave.readNetState(masterUpdate3.first, 0.0f, oldRules);
+  EXPECT_EQ(slaveField1.get(), 50);
+  EXPECT_EQ(slaveField3.get(), 60u);
 }
 
 TEST(NetElements, Forwarding) {
@@ -644,6 +655,57 @@ TEST(NetElements, Interpolation) {
   EXPECT_EQ(slaveField2.get(), "no");
 }
 
+TEST(NetElements, DeadReckoning) {
+  NetElementFloat masterPosition;
+  NetElementFloat masterVelocity;
+  NetElementTop<NetElementGroup> master;
+  master.addNetElement(&masterPosition);
+  master.addNetElement(&masterVelocity);
+
+  NetElementFloat slavePosition;
+  NetElementFloat slaveVelocity;
+  NetElementTop<NetElementGroup> slave;
+  slave.addNetElement(&slavePosition);
+  slave.addNetElement(&slaveVelocity);
+
+  slavePosition.setInterpolator(lerp<float, float>);
+  slavePosition.setExtrapolationRate(&slaveVelocity);
+  slavePosition.setCorrectionSmoothing(0.5f, 10.0f);
+  slave.enableNetInterpolation(2.0f);
+
+  masterVelocity.set(1.0f);
+  auto update1 = master.writeNetState();
+  slave.readNetState(update1.first);
+
+  masterPosition.set(0.5f);
+  auto update2 = master.writeNetState(update1.second);
+  slave.readNetState(update2.first, 0.5f);
+
+  slave.tickNetInterpolation(0.5f);
+  EXPECT_NEAR(slavePosition.get(), 0.5f, 0.001f);
+
+  // Past the last update, moved along by the velocity
+  slave.tickNetInterpolation(0.5f);
+  EXPECT_NEAR(slavePosition.get(), 1.0f, 0.001f);
+
+  // No further than twice the time between the last two updates
+  slave.tickNetInterpolation(1.0f);
+  EXPECT_NEAR(slavePosition.get(), 1.5f, 0.001f);
+
+  // An update behind the extrapolated position is eased back to
+  masterPosition.set(1.2f);
+  auto update3 = master.writeNetState(update2.second);
+  slave.readNetState(update3.first, 0.0f);
+  EXPECT_NEAR(slavePosition.get(), 1.5f, 0.001f);
+
+  slave.tickNetInterpolation(0.5f);
+  EXPECT_NEAR(slavePosition.get(), 1.7f + 0.3f * std::exp(-1.0f), 0.001f);
+
+  // Setting the value directly drops any correction
+  slavePosition.set(5.0f);
+  EXPECT_EQ(slavePosition.get(), 5.0f);
+}
+
 enum class TestEnum {
   Value1,
   Value2,
@@ -1056,3 +1118,28 @@ TEST(NetElements, NetElementSignal) {
   EXPECT_EQ(slaveSignal1.receive(), List<int>({}));
   EXPECT_EQ(slaveSignal2.receive(), List<int>({}));
 }
+
+TEST(NetElements, NetElementSignalRepeatedDelta) {
+  NetElementSignal<int> masterSignal;
+  NetElementTopGroup masterGroup;
+  masterGroup.addNetElement(&masterSignal);
+
+  NetElementSignal<int> slaveSignal;
+  NetElementTopGroup slaveGroup;
+  slaveGroup.addNetElement(&slaveSignal);
+
+  auto masterUpdate1 = masterGroup.writeNetState();
+  slaveGroup.readNetState(masterUpdate1.first);
+
+  masterSignal.send(101);
+  auto masterUpdate2 = masterGroup.writeNetState(masterUpdate1.second);
+  slaveGroup.readNetState(masterUpdate2.first);
+  EXPECT_EQ(slaveSignal.receive(), List<int>({101}));
+
+  // A delta written again from an older version, as when the newer version
+  // was never acknowledged, must not repeat signals that were already read.
+  masterSignal.send(102);
+  auto masterUpdate3 = masterGroup.writeNetState(masterUpdate1.second);
+  slaveGroup.readNetState(masterUpdate3.first);
+  EXPECT_EQ(slaveSignal.receive(), List<int>({102}));
+}
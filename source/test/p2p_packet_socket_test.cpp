@@ -0,0 +1,151 @@
+#include "StarNetPacketSocket.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+
+struct TestP2PMessage {
+  ByteArray data;
+  bool reliable;
+};
+
+// Delivers every message sent on one end to the other, in order.
+struct TestP2PSocket : P2PSocket {
+  bool isOpen() override {
+    return true;
+  }
+
+  bool sendMessage(ByteArray const& message, bool reliable) override {
+    EXPECT_LE(message.size(), maxMessageSize(reliable));
+    sent.append({message, reliable});
+    outgoing->append(message);
+    return true;
+  }
+
+  Maybe<ByteArray> receiveMessage() override {
+    if (incoming->empty())
+      return {};
+    return incoming->takeFirst();
+  }
+
+  size_t maxMessageSize(bool reliable) override {
+    return reliable ? maxReliableSize : maxUnreliableSize;
+  }
+
+  shared_ptr<Deque<ByteArray>> outgoing;
+  shared_ptr<Deque<ByteArray>> incoming;
+  size_t maxReliableSize = 1024 * 1024;
+  size_t maxUnreliableSize = 1200;
+  List<TestP2PMessage> sent;
+};
+
+struct TestP2PPair {
+  P2PPacketSocketUPtr first;
+  P2PPacketSocketUPtr second;
+  TestP2PSocket* firstSocket;
+};
+
+}
+
+static TestP2PPair openTestPair(size_t maxReliableSize) {
+  auto firstToSecond = make_shared<Deque<ByteArray>>();
+  auto secondToFirst = make_shared<Deque<ByteArray>>();
+
+  auto first = make_unique<TestP2PSocket>();
+  first->outgoing = firstToSecond;
+  first->incoming = secondToFirst;
+  first->maxReliableSize = maxReliableSize;
+  auto firstSocket = first.get();
+
+  auto second = make_unique<TestP2PSocket>();
+  second->outgoing = secondToFirst;
+  second->incoming = firstToSecond;
+  return {P2PPacketSocket::open(std::move(first)), P2PPacketSocket::open(std::move(second)), firstSocket};
+}
+
+static List<PacketPtr> mixedPackets(size_t count) {
+  List<PacketPtr> packets;
+  for (size_t i = 0; i < count; ++i) {
+    packets.append(make_shared<UniverseTimeUpdatePacket>((double)i));
+    packets.append(make_shared<PausePacket>(i % 2 == 0));
+  }
+  return packets;
+}
+
+static List<PacketPtr> transfer(TestP2PPair& pair, List<PacketPtr> packets) {
+  pair.first->sendPackets(std::move(packets));
+  pair.first->writeData();
+  pair.second->readData();
+  return pair.second->receivePackets();
+}
+
+static void expectTimes(List<PacketPtr> const& received, size_t count) {
+  ASSERT_EQ(received.size(), count * 2);
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(convert<UniverseTimeUpdatePacket>(received[i * 2])->universeTime, (double)i);
+    EXPECT_EQ(convert<PausePacket>(received[i * 2 + 1])->pause, i % 2 == 0);
+  }
+}
+
+TEST(P2PPacketSocketTest, BatchesPacketGroups) {
+  auto pair = openTestPair(1024 * 1024);
+  expectTimes(transfer(pair, mixedPackets(50)), 50);
+  EXPECT_EQ(pair.firstSocket->sent.size(), 1u);
+
+  // Older peers are sent one packet group per message
+  pair.first->setNetRules(NetCompatibilityRules(VersionNumber(20)));
+  pair.second->setNetRules(NetCompatibilityRules(VersionNumber(20)));
+  pair.firstSocket->sent.clear();
+  expectTimes(transfer(pair, mixedPackets(50)), 50);
+  EXPECT_EQ(pair.firstSocket->sent.size(), 100u);
+}
+
+TEST(P2PPacketSocketTest, FragmentsLargeMessages) {
+  for (bool compressionStream : {false, true}) {
+    auto pair = openTestPair(256);
+    pair.first->setCompressionStreamEnabled(compressionStream);
+    pair.second->setCompressionStreamEnabled(compressionStream);
+
+    List<PacketPtr> packets;
+    for (size_t i = 0; i < 500; ++i)
+      packets.append(make_shared<UniverseTimeUpdatePacket>((double)(i * 7919 % 10007)));
+    auto received = transfer(pair, std::move(packets));
+    EXPECT_GT(pair.firstSocket->sent.size(), 1u);
+    ASSERT_EQ(received.size(), 500u);
+    for (size_t i = 0; i < 500; ++i)
+      EXPECT_EQ(convert<UniverseTimeUpdatePacket>(received[i])->universeTime, (double)(i * 7919 % 10007));
+  }
+}
+
+TEST(P2PPacketSocketTest, SendsSupersededPacketsUnreliably) {
+  auto pair = openTestPair(1024 * 1024);
+  pair.first->sendPackets({make_shared<StepUpdatePacket>(1.0)});
+  pair.first->sendPackets({make_shared<StepUpdatePacket>(2.0), make_shared<UniverseTimeUpdatePacket>(3.0)});
+  pair.first->writeData();
+
+  auto const& sent = pair.firstSocket->sent;
+  ASSERT_EQ(sent.size(), 3u);
+  EXPECT_FALSE(sent[0].reliable);
+  EXPECT_FALSE(sent[1].reliable);
+  EXPECT_TRUE(sent[2].reliable);
+
+  // The first step update arrives after the second, and is dropped as stale
+  auto& incoming = *pair.firstSocket->outgoing;
+  swap(incoming[0], incoming[1]);
+  pair.second->readData();
+  auto received = pair.second->receivePackets();
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(convert<StepUpdatePacket>(received[0])->remoteTime, 2.0);
+  EXPECT_EQ(convert<UniverseTimeUpdatePacket>(received[1])->universeTime, 3.0);
+
+  // Everything is reliable through the compression stream
+  pair.first->setCompressionStreamEnabled(true);
+  pair.second->setCompressionStreamEnabled(true);
+  pair.firstSocket->sent.clear();
+  pair.first->sendPackets({make_shared<StepUpdatePacket>(4.0)});
+  pair.first->writeData();
+  ASSERT_EQ(sent.size(), 1u);
+  EXPECT_TRUE(sent[0].reliable);
+}
@@ -0,0 +1,46 @@
+#include "StarPacketCapture.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(PacketCaptureTest, RoundTrip) {
+  String path = File::temporaryFileName();
+  {
+    PacketCaptureWriter writer(path);
+    uint32_t first = writer.openStream();
+    uint32_t second = writer.openStream();
+
+    auto protocolRequest = make_shared<ProtocolRequestPacket>(StarProtocolVersion);
+    protocolRequest->setCompressionMode(PacketCompressionMode::Enabled);
+    writer.record(first, protocolRequest, NetCompatibilityRules());
+    writer.record(second, make_shared<ProtocolRequestPacket>(StarProtocolVersion), NetCompatibilityRules(LegacyVersion));
+
+    writer.assignClient(1, first);
+    writer.recordClient(1, {make_shared<ChatSendPacket>("hello", ChatSendMode::Broadcast)}, NetCompatibilityRules());
+    // Clients without a stream are not recorded
+    writer.recordClient(2, {make_shared<ChatSendPacket>("unseen", ChatSendMode::Broadcast)}, NetCompatibilityRules());
+    writer.removeClient(1);
+    writer.recordClient(1, {make_shared<ChatSendPacket>("unseen", ChatSendMode::Broadcast)}, NetCompatibilityRules());
+    EXPECT_EQ(writer.packetCount(), 3u);
+  }
+
+  auto packets = readPacketCapture(path);
+  File::remove(path);
+
+  ASSERT_EQ(packets.size(), 3u);
+  EXPECT_EQ(packets[0].stream, 0u);
+  EXPECT_EQ(packets[0].compressionMode, PacketCompressionMode::Enabled);
+  EXPECT_EQ(packets[1].stream, 1u);
+  EXPECT_TRUE(packets[1].netRules.isLegacy());
+  EXPECT_LE(packets[0].time, packets[2].time);
+
+  auto protocolRequest = as<ProtocolRequestPacket>(packets[0].packet());
+  ASSERT_TRUE(protocolRequest);
+  EXPECT_EQ(protocolRequest->requestProtocolVersion, StarProtocolVersion);
+  EXPECT_EQ(protocolRequest->compressionMode(), PacketCompressionMode::Enabled);
+
+  auto chatSend = as<ChatSendPacket>(packets[2].packet());
+  ASSERT_TRUE(chatSend);
+  EXPECT_EQ(chatSend->text, "hello");
+}
@@ -0,0 +1,56 @@
+#include "StarPacketScheduler.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(PacketSchedulerTest, ClassOrderAndBarriers) {
+  auto sockets = LocalPacketSocket::openPair();
+  PacketScheduler scheduler{PacketSchedulerConfig()};
+
+  scheduler.push({
+      make_shared<TileUpdatePacket>(),
+      make_shared<EntityDestroyPacket>(),
+      make_shared<ChatReceivePacket>(),
+      make_shared<WorldStopPacket>(),
+      make_shared<TileUpdatePacket>(),
+      make_shared<ChatReceivePacket>()
+    });
+  EXPECT_EQ(scheduler.queuedPackets(), 6u);
+
+  scheduler.release(*sockets.first);
+  EXPECT_TRUE(scheduler.empty());
+
+  // Classes are reordered by deadline, but never across the WorldStop
+  List<PacketType> expected = {
+      PacketType::ChatReceive,
+      PacketType::EntityDestroy,
+      PacketType::TileUpdate,
+      PacketType::WorldStop,
+      PacketType::ChatReceive,
+      PacketType::TileUpdate
+    };
+  EXPECT_EQ(sockets.second->receivePackets().transformed([](PacketPtr const& packet) { return packet->type(); }), expected);
+}
+
+TEST(PacketSchedulerTest, TakeAllKeepsPushOrder) {
+  PacketSchedulerConfig config;
+  config.maxPendingOutput = 0;
+  PacketScheduler scheduler(config);
+
+  scheduler.push({
+      make_shared<TileUpdatePacket>(),
+      make_shared<ChatReceivePacket>(),
+      make_shared<WorldStopPacket>(),
+      make_shared<EntityDestroyPacket>()
+    });
+
+  List<PacketType> expected = {
+      PacketType::TileUpdate,
+      PacketType::ChatReceive,
+      PacketType::WorldStop,
+      PacketType::EntityDestroy
+    };
+  EXPECT_EQ(scheduler.takeAll().transformed([](PacketPtr const& packet) { return packet->type(); }), expected);
+  EXPECT_TRUE(scheduler.empty());
+}
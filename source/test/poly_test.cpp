@@ -49,3 +49,25 @@ TEST(PolyTest, Clipping) {
   EXPECT_TRUE(overlap.sides() == 4);
   EXPECT_TRUE(overlap.convexArea() - 2 < 0.0001f);
 }
+
+TEST(PolyTest, PrecalculatedSatIntersection) {
+  RandomSource random(5);
+  PolyF square = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+  PolyF slope = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}};
+  auto squareNormals = square.sideNormals();
+  auto slopeNormals = slope.sideNormals();
+  EXPECT_EQ(squareNormals.size(), 4u);
+
+  for (unsigned i = 0; i < 1000; ++i) {
+    PolyF body = {{-0.4f, -0.8f}, {0.4f, -0.8f}, {0.5f, 0.0f}, {0.4f, 0.8f}, {-0.4f, 0.8f}, {-0.5f, 0.0f}};
+    body.translate(Vec2F(random.randf(-1.0f, 2.0f), random.randf(-1.0f, 2.0f)));
+    auto bodyNormals = body.sideNormals();
+
+    for (auto const& pair : {make_pair(square, squareNormals), make_pair(slope, slopeNormals)}) {
+      auto expected = body.satIntersection(pair.first);
+      auto result = body.satIntersection(pair.first, bodyNormals, pair.second);
+      EXPECT_EQ(result.intersects, expected.intersects);
+      EXPECT_EQ(result.overlap, expected.overlap);
+    }
+  }
+}
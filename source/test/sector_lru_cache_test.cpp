@@ -0,0 +1,39 @@
+#include "StarSectorLruCache.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(SectorLruCacheTest, Sectors) {
+  typedef SectorLruCache<int, 4> Cache;
+  Cache cache(Cache::SectorBytes * 2);
+
+  cache.set(Vec2I(0, 0), 1);
+  cache.set(Vec2I(-1, -1), 2);
+  EXPECT_EQ(*cache.ptr(Vec2I(0, 0)), 1);
+  EXPECT_EQ(*cache.ptr(Vec2I(-1, -1)), 2);
+  // Same sector as a cached value, but never set itself
+  EXPECT_EQ(cache.ptr(Vec2I(3, 3)), nullptr);
+  EXPECT_EQ(cache.memoryUsage(), Cache::SectorBytes * 2);
+
+  // Touch the first sector so that the one at (-4, -4) is evicted
+  cache.ptr(Vec2I(1, 2));
+  cache.set(Vec2I(4, 0), 3);
+  EXPECT_EQ(*cache.ptr(Vec2I(0, 0)), 1);
+  EXPECT_EQ(cache.ptr(Vec2I(-1, -1)), nullptr);
+  EXPECT_EQ(*cache.ptr(Vec2I(4, 0)), 3);
+  EXPECT_EQ(cache.memoryUsage(), Cache::SectorBytes * 2);
+
+  int produced = 0;
+  auto producer = [&](Vec2I const& position) {
+    ++produced;
+    return position[0] * 10 + position[1];
+  };
+  EXPECT_EQ(cache.get(Vec2I(5, 2), producer), 52);
+  EXPECT_EQ(cache.get(Vec2I(5, 2), producer), 52);
+  EXPECT_EQ(produced, 1);
+
+  cache.clear();
+  EXPECT_EQ(cache.ptr(Vec2I(0, 0)), nullptr);
+  EXPECT_EQ(cache.memoryUsage(), 0u);
+}
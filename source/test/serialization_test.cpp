@@ -1,4 +1,5 @@
 #include "StarDataStreamDevices.hpp"
+#include "StarDataStreamExtra.hpp"
 
 #include "gtest/gtest.h"
 
@@ -26,3 +27,70 @@ TEST(DataStreamTest, All) {
   testMap(map2);
   testMap(map3);
 }
+
+TEST(DataStreamTest, BulkContainers) {
+  static_assert(DataStreamBulkContainer<List<int32_t>>::value, "");
+  static_assert(DataStreamBulkContainer<List<Vec2F>>::value, "");
+  static_assert(!DataStreamBulkContainer<List<bool>>::value, "");
+  static_assert(!DataStreamBulkContainer<List<String>>::value, "");
+
+  List<int32_t> ints = {0, -1, 1, 123456789, -987654321};
+  List<Vec2F> vecs = {{1.5f, -2.0f}, {0.0f, 1e10f}};
+  List<uint8_t> bytes = {1, 2, 255};
+
+  for (auto byteOrder : {ByteOrder::BigEndian, ByteOrder::LittleEndian}) {
+    // Bulk writes must match writing each element in turn
+    DataStreamBuffer bulk;
+    bulk.setByteOrder(byteOrder);
+    bulk.writeContainer(ints);
+    bulk.writeContainer(vecs);
+    bulk.writeContainer(bytes);
+
+    DataStreamBuffer elements;
+    elements.setByteOrder(byteOrder);
+    elements.writeContainer(ints, [](DataStream& ds, int32_t i) { ds << i; });
+    elements.writeContainer(vecs, [](DataStream& ds, Vec2F const& v) { ds << v[0] << v[1]; });
+    elements.writeContainer(bytes, [](DataStream& ds, uint8_t b) { ds << b; });
+    EXPECT_EQ(bulk.data(), elements.data());
+
+    bulk.seek(0);
+    List<int32_t> intsOut;
+    List<Vec2F> vecsOut;
+    List<uint8_t> bytesOut = {7};
+    bulk.readContainer(intsOut);
+    bulk.readContainer(vecsOut);
+    bulk.readContainer(bytesOut);
+    EXPECT_EQ(intsOut, ints);
+    EXPECT_EQ(vecsOut, vecs);
+    EXPECT_EQ(bytesOut, bytes);
+    EXPECT_TRUE(bulk.atEnd());
+  }
+
+  // Larger than a single swap buffer
+  List<uint64_t> large;
+  for (uint64_t i = 0; i < 3000; ++i)
+    large.append(i * 0x0102030405060708ull);
+  EXPECT_EQ(DataStreamBuffer::deserializeContainer<List<uint64_t>>(DataStreamBuffer::serializeContainer(large)), large);
+
+  // A size far larger than the data fails to read rather than allocating it
+  DataStreamBuffer corrupt;
+  corrupt.writeVlqU(1ull << 40);
+  corrupt.write<int32_t>(1);
+  corrupt.seek(0);
+  List<int32_t> corruptOut;
+  EXPECT_THROW(corrupt.readContainer(corruptOut), EofException);
+}
+
+TEST(DataStreamTest, BulkMultiArray) {
+  MultiArray<int16_t, 2> array(3, 4);
+  for (size_t i = 0; i < array.count(); ++i)
+    array.atIndex(i) = (int16_t)(i * 1000 - 5000);
+
+  auto data = DataStreamBuffer::serialize(array);
+  EXPECT_EQ(data.size(), 2u + 12u * 2u);
+  EXPECT_EQ(data[2], (char)(uint8_t)((-5000 >> 8) & 0xff));
+  auto arrayOut = DataStreamBuffer::deserialize<decltype(array)>(data);
+  EXPECT_EQ(arrayOut.size(), array.size());
+  for (size_t i = 0; i < array.count(); ++i)
+    EXPECT_EQ(arrayOut.atIndex(i), array.atIndex(i));
+}
@@ -0,0 +1,71 @@
+#include "StarSessionPacketSocket.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+static List<int64_t> receiveTimes(SessionPacketSocket& socket) {
+  return socket.receivePackets().transformed([](PacketPtr const& packet) { return (int64_t)convert<UniverseTimeUpdatePacket>(packet)->universeTime; });
+}
+
+static List<int64_t> timeRange(int64_t first, int64_t last) {
+  List<int64_t> times;
+  for (int64_t i = first; i <= last; ++i)
+    times.append(i);
+  return times;
+}
+
+static void sendTimes(SessionPacketSocket& socket, int64_t first, int64_t last) {
+  socket.sendPackets(timeRange(first, last).transformed([](int64_t time) -> PacketPtr { return make_shared<UniverseTimeUpdatePacket>(time); }));
+}
+
+TEST(SessionPacketSocketTest, ResumeResendsLostPackets) {
+  auto sockets = LocalPacketSocket::openPair();
+  auto firstInner = sockets.first.get();
+  auto secondInner = sockets.second.get();
+  SessionPacketSocket first(std::move(sockets.first));
+  SessionPacketSocket second(std::move(sockets.second));
+
+  sendTimes(first, 1, 10);
+  EXPECT_EQ(receiveTimes(second), timeRange(1, 10));
+  // Acknowledges the ten packets
+  second.writeData();
+  EXPECT_TRUE(receiveTimes(first).empty());
+
+  // Lost along with the connection
+  sendTimes(first, 11, 15);
+  sendTimes(second, 1, 3);
+  firstInner->close();
+  secondInner->close();
+  EXPECT_FALSE(first.isOpen());
+  EXPECT_FALSE(second.isOpen());
+
+  // Kept until the session is resumed
+  sendTimes(first, 16, 20);
+
+  auto newSockets = LocalPacketSocket::openPair();
+  PacketSocketUPtr firstSocket = std::move(newSockets.first);
+  PacketSocketUPtr secondSocket = std::move(newSockets.second);
+  EXPECT_FALSE(first.canResume(first.received() + 1));
+  EXPECT_TRUE(first.resume(firstSocket, second.received()));
+  EXPECT_TRUE(second.resume(secondSocket, first.received()));
+  EXPECT_TRUE(first.isOpen());
+  EXPECT_TRUE(second.isOpen());
+
+  EXPECT_EQ(receiveTimes(second), timeRange(11, 20));
+  EXPECT_EQ(receiveTimes(first), List<int64_t>({1, 2, 3}));
+  EXPECT_EQ(second.received(), 20u);
+  EXPECT_EQ(first.received(), 3u);
+}
+
+TEST(SessionPacketSocketTest, ClosedSessionsCannotResume) {
+  auto sockets = LocalPacketSocket::openPair();
+  SessionPacketSocket session(std::move(sockets.first));
+  sendTimes(session, 1, 5);
+  session.close();
+  EXPECT_FALSE(session.resumable());
+
+  PacketSocketUPtr socket = std::move(LocalPacketSocket::openPair().first);
+  EXPECT_FALSE(session.resume(socket, 0));
+  EXPECT_TRUE(socket);
+}
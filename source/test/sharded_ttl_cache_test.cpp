@@ -0,0 +1,61 @@
+#include "StarShardedTtlCache.hpp"
+#include "StarWorkerPool.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(ShardedTtlCacheTest, Basic) {
+  ShardedTtlCache<String, int> cache;
+
+  int produced = 0;
+  auto producer = [&](String const& key) {
+    ++produced;
+    return (int)key.size();
+  };
+
+  EXPECT_EQ(cache.get("a", producer), 1);
+  EXPECT_EQ(cache.get("abc", producer), 3);
+  EXPECT_EQ(cache.get("a", producer), 1);
+  EXPECT_EQ(produced, 2);
+
+  EXPECT_EQ(cache.value("abc"), Maybe<int>(3));
+  EXPECT_EQ(cache.value("ab"), Maybe<int>());
+
+  // An already cached value wins over an inserted one
+  EXPECT_EQ(cache.insert("a", 5), 1);
+  EXPECT_EQ(cache.insert("ab", 2), 2);
+
+  auto statistics = cache.statistics();
+  EXPECT_EQ(statistics.hits, 2u);
+  EXPECT_EQ(statistics.misses, 3u);
+  EXPECT_EQ(statistics.size, 3u);
+
+  cache.clear();
+  EXPECT_EQ(cache.statistics().size, 0u);
+  EXPECT_EQ(cache.value("a"), Maybe<int>());
+}
+
+TEST(ShardedTtlCacheTest, Threads) {
+  ShardedTtlCache<int, int> cache;
+
+  WorkerPool pool("ShardedTtlCacheTest", 8);
+  List<WorkerPoolPromise<bool>> results;
+  for (int t = 0; t < 8; ++t) {
+    results.append(pool.addProducer<bool>([&cache]() {
+      bool correct = true;
+      for (int i = 0; i < 10000; ++i) {
+        int key = i % 500;
+        correct &= cache.get(key, [](int key) { return key * 2; }) == key * 2;
+      }
+      return correct;
+    }));
+  }
+
+  for (auto& result : results)
+    EXPECT_TRUE(result.get());
+
+  auto statistics = cache.statistics();
+  EXPECT_EQ(statistics.size, 500u);
+  EXPECT_EQ(statistics.hits + statistics.misses, 80000u);
+}
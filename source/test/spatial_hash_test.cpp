@@ -0,0 +1,94 @@
+#include "StarSpatialHash2D.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+typedef SpatialHash2D<int, float, int> TestSpatialHash;
+
+static List<int> sortedQuery(TestSpatialHash const& spatialHash, RectF const& rect) {
+  auto values = spatialHash.queryValues(rect);
+  sort(values);
+  return values;
+}
+
+TEST(SpatialHash2DTest, Query) {
+  TestSpatialHash spatialHash(16.0f);
+  spatialHash.set(1, RectF(0, 0, 4, 4), 1);
+  spatialHash.set(2, RectF(20, 20, 24, 24), 2);
+  spatialHash.set(3, Vec2F(50, 5), 3);
+
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(-10, -10, 100, 100)), List<int>({1, 2, 3}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(2, 2, 22, 22)), List<int>({1, 2}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(5, 5, 19, 19)), List<int>());
+
+  spatialHash.set(1, RectF(40, 0, 60, 10));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(2, 2, 22, 22)), List<int>({2}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(45, 0, 55, 10)), List<int>({1, 3}));
+
+  EXPECT_EQ(spatialHash.remove(3), Maybe<int>(3));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(45, 0, 55, 10)), List<int>({1}));
+}
+
+TEST(SpatialHash2DTest, CoarseEntries) {
+  TestSpatialHash spatialHash(16.0f);
+  // Spans far more than CoarseSectorSpan sectors
+  spatialHash.set(1, RectF(-1000, -10, 1000, 10), 1);
+  spatialHash.set(2, RectF(0, 0, 4, 4), 2);
+  // An entry with both a small and a huge rect must be found only once
+  spatialHash.set(3, List<RectF>{RectF(100, 0, 104, 4), RectF(0, 500, 2000, 600)}, 3);
+
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(990, 0, 995, 5)), List<int>({1}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(1, 1, 2, 2)), List<int>({1, 2}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(0, 0, 2000, 1000)), List<int>({1, 2, 3}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(-1000, 20, 90, 400)), List<int>());
+
+  // Moving between levels
+  spatialHash.set(1, RectF(990, 0, 995, 5));
+  spatialHash.set(2, RectF(-500, -500, 500, 500));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(-600, -5, -590, 5)), List<int>());
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(-400, -5, -390, 5)), List<int>({2}));
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(991, 1, 992, 2)), List<int>({1}));
+
+  spatialHash.remove(2);
+  spatialHash.remove(3);
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(-1000, -1000, 2000, 1000)), List<int>({1}));
+
+  spatialHash.setSectorSize(8.0f);
+  EXPECT_EQ(sortedQuery(spatialHash, RectF(991, 1, 992, 2)), List<int>({1}));
+}
+
+TEST(SpatialHash2DTest, MatchesBruteForce) {
+  RandomSource rand(4242);
+  TestSpatialHash spatialHash(16.0f);
+  Map<int, RectF> rects;
+
+  auto randomRect = [&]() {
+    Vec2F pos(rand.randf() * 2000.0f - 1000.0f, rand.randf() * 2000.0f - 1000.0f);
+    float size = rand.randb() ? rand.randf() * 10.0f : rand.randf() * 400.0f;
+    return RectF::withSize(pos, Vec2F(size, rand.randf() * size));
+  };
+
+  for (int i = 0; i < 2000; ++i) {
+    int key = rand.randInt(300);
+    if (rand.randInt(4) == 0) {
+      spatialHash.remove(key);
+      rects.remove(key);
+    } else {
+      RectF rect = randomRect();
+      spatialHash.set(key, rect, key);
+      rects[key] = rect;
+    }
+
+    if (i % 20 == 0) {
+      RectF query = rand.randb() ? randomRect() : RectF(-3000, -3000, 3000, 3000);
+      List<int> expected;
+      for (auto const& pair : rects) {
+        if (pair.second.intersects(query))
+          expected.append(pair.first);
+      }
+      EXPECT_EQ(sortedQuery(spatialHash, query), expected);
+    }
+  }
+}
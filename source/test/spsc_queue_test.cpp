@@ -0,0 +1,42 @@
+#include "StarSpscQueue.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(SpscQueue, PushPop) {
+  SpscQueue<int, 4> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop());
+
+  for (int i = 0; i < 10; ++i)
+    queue.push(i);
+  EXPECT_EQ(queue.size(), 10u);
+  EXPECT_EQ(queue.pop(), 0);
+  EXPECT_EQ(queue.takeAll(), List<int>({1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  EXPECT_TRUE(queue.empty());
+
+  queue.pushAll({10, 11});
+  EXPECT_EQ(queue.takeAll(), List<int>({10, 11}));
+}
+
+TEST(SpscQueue, Threaded) {
+  SpscQueue<int, 16> queue;
+  int const count = 100000;
+
+  auto producer = Thread::invoke("SpscQueue producer", [&]() {
+      for (int i = 0; i < count; ++i)
+        queue.push(i);
+    });
+
+  int expected = 0;
+  while (expected < count) {
+    if (auto value = queue.pop()) {
+      EXPECT_EQ(*value, expected);
+      ++expected;
+    }
+  }
+  producer.finish();
+  EXPECT_TRUE(queue.empty());
+}
@@ -81,3 +81,35 @@ TEST(StatTest, Set) {
   EXPECT_TRUE(withinAmount(stats.statEffectiveValue("TempStat"), 0.0f, 0.0001f));
   EXPECT_FALSE(stats.isEffectiveStat("TempStat"));
 }
+
+TEST(StatTest, CoalescedRecalculation) {
+  StatSet stats;
+
+  stats.addStat("MaxHealth", 100.0f);
+  stats.addStat("Protection", 0.0f);
+  stats.addResource("Health", String("MaxHealth"));
+  stats.setResourcePercentage("Health", 0.5f);
+
+  uint64_t recalculations = stats.recalculationCount();
+  List<StatModifierGroupId> groups;
+  for (int i = 0; i < 10; ++i)
+    groups.append(stats.addStatModifierGroup({StatValueModifier{"Protection", 1.0f}, StatValueModifier{"MaxHealth", 10.0f}}));
+  stats.setStatBaseValue("MaxHealth", 200.0f);
+  EXPECT_EQ(stats.recalculationCount(), recalculations);
+
+  EXPECT_TRUE(withinAmount(stats.statEffectiveValue("Protection"), 10.0f, 0.0001f));
+  EXPECT_TRUE(withinAmount(stats.statEffectiveValue("MaxHealth"), 300.0f, 0.0001f));
+  EXPECT_TRUE(withinAmount(stats.resourceValue("Health"), 150.0f, 0.0001f));
+  EXPECT_EQ(stats.recalculationCount(), recalculations + 1);
+
+  stats.update(1.0f);
+  stats.update(1.0f);
+  EXPECT_EQ(stats.recalculationCount(), recalculations + 1);
+
+  for (auto id : groups)
+    stats.removeStatModifierGroup(id);
+  stats.update(1.0f);
+  EXPECT_EQ(stats.recalculationCount(), recalculations + 2);
+  EXPECT_TRUE(withinAmount(stats.statEffectiveValue("Protection"), 0.0f, 0.0001f));
+  EXPECT_TRUE(withinAmount(stats.resourceValue("Health"), 100.0f, 0.0001f));
+}
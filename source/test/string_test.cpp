@@ -8,6 +8,11 @@ using namespace Star;
 TEST(StringTest, substr) {
   EXPECT_EQ(String("barbazbaffoo").substr(4, 4), String("azba"));
   EXPECT_EQ(String("\0asdf", 5).substr(1, 2), String("as"));
+  EXPECT_EQ(String("日本語abc").substr(2, 3), String("語ab"));
+  EXPECT_EQ(String("abc日本語").substr(2, 2), String("c日"));
+  EXPECT_EQ(String("abc日本語")[1], String::Char('b'));
+  EXPECT_EQ(String("abc日本語")[4], String::Char(U'本'));
+  EXPECT_EQ(String("abc日本語").size(), 6u);
 }
 
 TEST(StringTest, find) {
@@ -17,6 +22,12 @@ TEST(StringTest, find) {
   EXPECT_EQ(String("xxFooxx").find("bar", 0, String::CaseInsensitive), NPos);
   EXPECT_EQ(String("BAR baz baf BAR").find("bar", 1, String::CaseInsensitive), 12u);
   EXPECT_EQ(String("\0asdf", 5).find("df"), 3u);
+  EXPECT_EQ(String("日本語Foo").find("Foo"), 3u);
+  EXPECT_EQ(String("日本語Foo").find('o'), 4u);
+  EXPECT_EQ(String("xxFooxxFoo").findLast("Foo"), 7u);
+  EXPECT_EQ(String("日xFooxxFoo").findLast('F'), 7u);
+  EXPECT_EQ(String("xxFooxx").find('o', 4), 4u);
+  EXPECT_EQ(String("xxFooxx").find('o', 10), NPos);
 }
 
 TEST(StringTest, split_join) {
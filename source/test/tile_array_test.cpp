@@ -97,3 +97,72 @@ TEST(TileSectorArrayTest, All) {
   EXPECT_TRUE(res3.size() == res3comp.size());
   res3.forEach([](Array2S const&, int elem) { EXPECT_TRUE(elem == 1); });
 }
+
+TEST(TileSectorArrayTest, Revisions) {
+  typedef TileSectorArray<int, 32> TileArray;
+  TileArray tileSectorArray({100, 100}, -1);
+
+  EXPECT_EQ(0u, tileSectorArray.sectorRevision({4, 4}));
+
+  tileSectorArray.loadDefaultSector({0, 0});
+  tileSectorArray.loadDefaultSector({1, 0});
+  uint64_t first = tileSectorArray.sectorRevision({0, 0});
+  uint64_t second = tileSectorArray.sectorRevision({1, 0});
+  EXPECT_LT(first, second);
+  EXPECT_EQ(second, tileSectorArray.regionRevision(RectI(0, 0, 64, 32)));
+
+  // Reading tiles does not change any revision
+  tileSectorArray.tile({5, 5});
+  tileSectorArray.tileEachColumns(RectI(0, 0, 64, 32), [](Vec2I const&, int const*, size_t) {});
+  EXPECT_EQ(first, tileSectorArray.sectorRevision({0, 0}));
+
+  *tileSectorArray.modifyTile({5, 5}) = 3;
+  EXPECT_GT(tileSectorArray.sectorRevision({0, 0}), second);
+  EXPECT_EQ(second, tileSectorArray.sectorRevision({1, 0}));
+  EXPECT_EQ(tileSectorArray.sectorRevision({0, 0}), tileSectorArray.regionRevision(RectI(0, 0, 64, 32)));
+
+  // Regions wrap around the world like everything else
+  uint64_t wrapped = tileSectorArray.regionRevision(RectI(-10, 0, 10, 10));
+  tileSectorArray.tileEval(RectI(-10, 0, -5, 10), [](Vec2I const&, int& tile) { tile = 4; });
+  EXPECT_GT(tileSectorArray.regionRevision(RectI(-10, 0, 10, 10)), wrapped);
+
+  // Unloading and reloading a sector never restores an earlier revision
+  uint64_t loaded = tileSectorArray.sectorRevision({1, 0});
+  tileSectorArray.loadSector({1, 0}, tileSectorArray.unloadSector({1, 0}));
+  EXPECT_GT(tileSectorArray.sectorRevision({1, 0}), loaded);
+}
+
+TEST(TileSectorArrayTest, Column) {
+  typedef TileSectorArray<int, 32> TileArray;
+  TileArray tileSectorArray({100, 100}, -1);
+  tileSectorArray.loadDefaultSector({0, 0});
+  tileSectorArray.loadDefaultSector({1, 0});
+  *tileSectorArray.modifyTile({40, 5}) = 7;
+
+  TileSectorColumn<TileArray, bool> column;
+  auto positive = [](int tile) { return tile > 0; };
+  EXPECT_EQ(2u, column.refresh(tileSectorArray, RectI(0, 0, 64, 32), positive));
+  EXPECT_TRUE(column.elements().tile({40, 5}));
+  EXPECT_FALSE(column.elements().tile({5, 5}));
+
+  // Only sectors changed since the last refresh are rebuilt
+  EXPECT_EQ(0u, column.refresh(tileSectorArray, RectI(0, 0, 64, 32), positive));
+  *tileSectorArray.modifyTile({5, 5}) = 2;
+  EXPECT_EQ(1u, column.refresh(tileSectorArray, RectI(0, 0, 64, 32), positive));
+  EXPECT_TRUE(column.elements().tile({5, 5}));
+
+  // Columns are iterated like the tile array, wrapping around the world
+  size_t count = 0;
+  column.elements().tileEachColumns(RectI(-10, 0, 64, 32), [&](Vec2I const&, bool const* elements, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+      count += elements[i];
+  });
+  EXPECT_EQ(2u, count);
+
+  tileSectorArray.unloadSector({1, 0});
+  EXPECT_EQ(1u, column.refresh(tileSectorArray, RectI(0, 0, 64, 32), positive));
+  EXPECT_FALSE(column.elements().sectorLoaded({1, 0}));
+
+  column.clear();
+  EXPECT_EQ(2u, column.refresh(tileSectorArray, RectI(0, 0, 64, 32), positive));
+}
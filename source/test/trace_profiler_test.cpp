@@ -0,0 +1,36 @@
+#include "StarTraceProfiler.hpp"
+#include "StarThread.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(TraceProfilerTest, Capture) {
+  { STAR_PROFILE_SCOPE("before"); }
+
+  TraceProfiler::startCapture();
+  {
+    STAR_PROFILE_SCOPE("outer");
+    { STAR_PROFILE_SCOPE("inner"); }
+  }
+  auto thread = Thread::invoke("TraceProfilerTest", []() {
+      STAR_PROFILE_SCOPE(TraceProfiler::internName("worker"));
+    });
+  thread.finish();
+  Json trace = TraceProfiler::stopCapture();
+
+  { STAR_PROFILE_SCOPE("after"); }
+  EXPECT_FALSE(TraceProfiler::capturing());
+
+  StringMap<Json> zones;
+  for (auto const& event : trace.getArray("traceEvents")) {
+    if (event.getString("ph") == "X")
+      zones[event.getString("name")] = event;
+  }
+
+  EXPECT_EQ(zones.keys().sorted(), StringList({"inner", "outer", "worker"}));
+  EXPECT_EQ(zones.get("inner").getUInt("tid"), zones.get("outer").getUInt("tid"));
+  EXPECT_NE(zones.get("worker").getUInt("tid"), zones.get("outer").getUInt("tid"));
+  EXPECT_LE(zones.get("outer").getDouble("ts"), zones.get("inner").getDouble("ts"));
+  EXPECT_GE(zones.get("outer").getDouble("dur"), zones.get("inner").getDouble("dur"));
+}
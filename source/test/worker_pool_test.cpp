@@ -32,3 +32,72 @@ TEST(WorkerPoolTest, All) {
 
   EXPECT_EQ(counter, 100);
 }
+
+TEST(WorkerPoolTest, ParallelFor) {
+  WorkerPool workerPool("WorkerPoolTest", 4);
+
+  List<int> values(10000, 0);
+  workerPool.parallelFor(0, values.size(), 64, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        values[i] += (int)i;
+    });
+
+  for (size_t i = 0; i < values.size(); ++i)
+    EXPECT_EQ(values[i], (int)i);
+
+  EXPECT_THROW(workerPool.parallelFor(0, 100, 1, [](size_t begin, size_t) {
+      if (begin == 50)
+        throw StarException("parallelFor failure");
+    }), StarException);
+}
+
+TEST(WorkerPoolTest, NestedGroups) {
+  WorkerPool workerPool("WorkerPoolTest", 2);
+
+  // Far more nested waits than there are worker threads, each of which must
+  // help rather than block to avoid deadlocking the pool.
+  atomic<int> counter(0);
+  WorkerPoolGroup outer(workerPool);
+  for (size_t i = 0; i < 16; ++i) {
+    outer.add([&]() {
+        WorkerPoolGroup inner(workerPool);
+        for (size_t j = 0; j < 16; ++j)
+          inner.add([&]() { ++counter; });
+        inner.wait();
+      });
+  }
+  outer.wait();
+
+  EXPECT_EQ(counter, 256);
+
+  // A stopped pool runs group work on the waiting thread.
+  WorkerPool stoppedPool("WorkerPoolTest");
+  WorkerPoolGroup group(stoppedPool);
+  group.add([&]() { ++counter; });
+  group.wait();
+  EXPECT_EQ(counter, 257);
+}
+
+TEST(WorkerPoolTest, Continuations) {
+  WorkerPool workerPool("WorkerPoolTest", 2);
+  auto completionQueue = make_shared<CompletionQueue>();
+
+  List<int> results;
+  for (int i = 0; i < 10; ++i) {
+    workerPool.addProducer<int>([i]() { return i; }).then(completionQueue, [&results](int& result) {
+        results.append(result);
+      });
+  }
+
+  // Continuations only ever run on the thread running the queue.
+  while (results.size() < 10)
+    completionQueue->run();
+  results.sort();
+  EXPECT_EQ(results, List<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+  auto failing = workerPool.addProducer<int>([]() -> int { throw StarException("producer failure"); });
+  failing.then(completionQueue, [](int&) {});
+  while (!failing.done())
+    Thread::yield();
+  EXPECT_THROW(completionQueue->run(), StarException);
+}
@@ -3,6 +3,10 @@
 #include "StarJsonExtra.hpp"
 #include "StarFile.hpp"
 #include "StarVersionOptionParser.hpp"
+#include "StarAssetTrace.hpp"
+#include "StarAssetPath.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarOrderedSet.hpp"
 
 using namespace Star;
 
@@ -15,6 +19,9 @@ int main(int argc, char** argv) {
     optParse.addParameter("c", "configFile", OptionParser::Optional, "JSON file with ignore lists and ordering info");
     optParse.addSwitch("s", "Enable server mode");
     optParse.addSwitch("v", "Verbose, list each file added");
+    optParse.addParameter("t", "traceFile", OptionParser::Optional, "Asset trace recorded by the game, files are packed in the order it first requested them");
+    optParse.addSwitch("d", "Store files with identical contents only once");
+    optParse.addParameter("j", "threads", OptionParser::Optional, "Number of threads reading files, defaults to one per processor");
     optParse.addArgument("assets folder path", OptionParser::Required, "Path to the assets to be packed");
     optParse.addArgument("output filename", OptionParser::Required, "Output pak file");
 
@@ -57,17 +64,36 @@ int main(int argc, char** argv) {
       }
     }
 
-    bool verbose = opts.switches.contains("v");
+    PackedAssetSource::BuildSettings buildSettings;
+    buildSettings.extensionSorting = extensionOrdering;
+    buildSettings.includeImageMetadata = true;
+    buildSettings.deduplicate = opts.switches.contains("d");
+    if (opts.parameters.contains("j"))
+      buildSettings.threads = lexicalCast<unsigned>(opts.parameters.get("j").first());
+
+    if (opts.parameters.contains("t")) {
+      String traceFile = opts.parameters.get("t").first();
+      try {
+        OrderedHashSet<String> accessed;
+        for (auto const& event : readAssetTrace(File::open(traceFile, IOMode::Read)))
+          accessed.add(AssetPath::split(event.path).basePath);
+        buildSettings.accessOrder = StringList::from(accessed);
+      } catch (StarException const& e) {
+        cerrf("Could not read the specified traceFile: {}\n", traceFile);
+        cerrf("For the following reason: {}\n", outputException(e, false));
+        return 1;
+      }
+    }
 
-    function<void(size_t, size_t, String, String, bool)> BuildProgressCallback;
-    auto progressCallback = [verbose](size_t, size_t, String filePath, String assetPath) {
+    bool verbose = opts.switches.contains("v");
+    buildSettings.progressCallback = [verbose](size_t, size_t, String filePath, String assetPath) {
       if (verbose)
         coutf("Adding file '{}' to the target pak as '{}'\n", filePath, assetPath);
     };
 
     outputFilename = File::relativeTo(File::fullPath(File::dirName(outputFilename)), File::baseName(outputFilename));
     DirectoryAssetSource directorySource(assetsFolderPath, ignoreFiles);
-    PackedAssetSource::build(directorySource, outputFilename, extensionOrdering, progressCallback);
+    PackedAssetSource::build(directorySource, outputFilename, buildSettings);
 
     coutf("Output packed assets to {} in {}s\n", outputFilename, Time::monotonicTime() - startTime);
     return 0;
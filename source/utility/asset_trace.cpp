@@ -0,0 +1,92 @@
+#include "StarAssetTrace.hpp"
+#include "StarAssetPath.hpp"
+#include "StarJsonExtra.hpp"
+#include "StarFile.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+int main(int argc, char** argv) {
+  try {
+    VersionOptionParser optParse;
+    optParse.setSummary("Summarizes an asset trace written by the assets \"traceFile\" setting");
+    optParse.addParameter("m", "manifest", OptionParser::Optional, "Write the json assets loaded as a server preload manifest");
+    optParse.addParameter("f", "flamechart", OptionParser::Optional, "Write every request in Chrome trace event format");
+    optParse.addArgument("trace file", OptionParser::Required, "Path to the asset trace");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    auto events = readAssetTrace(File::open(opts.arguments.at(0), IOMode::Read));
+
+    struct TypeSummary {
+      size_t loads = 0;
+      size_t hits = 0;
+      int64_t loadTime = 0;
+      uint64_t fileSize = 0;
+      uint64_t loadedSize = 0;
+    };
+    StringMap<TypeSummary> summaries;
+    unsigned threadCount = 0;
+    for (auto const& event : events) {
+      auto& summary = summaries[event.type];
+      if (event.cacheHit) {
+        ++summary.hits;
+      } else {
+        ++summary.loads;
+        summary.loadTime += event.latency;
+        summary.fileSize += event.fileSize;
+        summary.loadedSize += event.loadedSize;
+      }
+      threadCount = max(threadCount, event.thread + 1);
+    }
+
+    coutf("{} requests from {} threads over {:.2f}s\n", events.size(), threadCount, events.empty() ? 0.0 : events.last().time / 1000000.0);
+    for (auto const& p : summaries) {
+      coutf("{:>6}: {} loads taking {:.2f}s, {} cache hits, {} bytes read, {} bytes loaded\n",
+          p.first, p.second.loads, p.second.loadTime / 1000000.0, p.second.hits, p.second.fileSize, p.second.loadedSize);
+    }
+
+    auto slowest = events.filtered([](AssetTraceEvent const& event) { return !event.cacheHit; });
+    sortByComputedValue(slowest, [](AssetTraceEvent const& event) { return -event.latency; });
+    coutf("Slowest loads:\n");
+    for (size_t i = 0; i < min<size_t>(slowest.size(), 20); ++i)
+      coutf("  {:>8.2f}ms {} {}\n", slowest[i].latency / 1000.0, slowest[i].type, slowest[i].path);
+
+    // Same layout as the server's preload.manifest, in the order the files
+    // were first loaded.
+    if (auto manifestFile = opts.parameters.maybe("m")) {
+      OrderedHashSet<String> jsonAssets;
+      for (auto const& event : events) {
+        if (!event.cacheHit && event.type == "json")
+          jsonAssets.add(AssetPath::split(event.path).basePath);
+      }
+      JsonObject manifest{{"jsonAssets", jsonFromStringList(jsonAssets.values())}};
+      File::writeFile(Json(manifest).printJson(1), manifestFile->first());
+    }
+
+    if (auto flamechartFile = opts.parameters.maybe("f")) {
+      JsonArray traceEvents;
+      for (auto const& event : events) {
+        traceEvents.append(JsonObject{
+            {"name", event.path},
+            {"cat", event.cacheHit ? strf("{} hit", event.type) : event.type},
+            {"ph", "X"},
+            {"ts", event.time},
+            {"dur", event.latency},
+            {"pid", 0},
+            {"tid", event.thread},
+            {"args", JsonObject{
+              {"fileSize", event.fileSize},
+              {"loadedSize", event.loadedSize}
+            }}
+          });
+      }
+      File::writeFile(Json(JsonObject{{"traceEvents", traceEvents}}).printJson(0), flamechartFile->first());
+    }
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
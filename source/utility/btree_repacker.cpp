@@ -1,6 +1,7 @@
 #include "StarBTreeDatabase.hpp"
 #include "StarTime.hpp"
 #include "StarFile.hpp"
+#include "StarLexicalCast.hpp"
 #include "StarVersionOptionParser.hpp"
 
 using namespace Star;
@@ -11,6 +12,7 @@ int main(int argc, char** argv) {
 
     VersionOptionParser optParse;
     optParse.setSummary("Repacks a Starbound BTree file to shrink its file size");
+    optParse.addParameter("threads", "count", OptionParser::Optional, "Threads to recover leaves with, defaults to the number of processors");
     optParse.addArgument("input file path", OptionParser::Required, "Path to the BTree to be repacked");
     optParse.addArgument("output filename", OptionParser::Optional, "Output BTree file");
 
@@ -18,6 +20,9 @@ int main(int argc, char** argv) {
 
     String bTreePath = opts.arguments.at(0);
     String outputFilename = opts.arguments.get(1, bTreePath + ".repack");
+    unsigned threadCount = Thread::numberOfProcessors();
+    if (auto threads = opts.parameters.maybe("threads"))
+      threadCount = lexicalCast<unsigned>(threads->first());
 
     outputFilename = File::relativeTo(File::fullPath(File::dirName(outputFilename)), File::baseName(outputFilename));
     //open the old db
@@ -36,16 +41,19 @@ int main(int argc, char** argv) {
     newDb.open();
     coutf("Repacking {}...\n", bTreePath);
     //copy the data over
-    unsigned count = 0, overwritten = 0;
+    unsigned count = 0;
+    BTreeDatabase::WriteBatch batch;
     auto visitor = [&](ByteArray key, ByteArray data) {
-      if (newDb.insert(key, data))
-        ++overwritten;
+      batch.insert(std::move(key), std::move(data));
+      if (batch.size() >= 4096)
+        newDb.writeBatch(take(batch));
       ++count;
     };
     auto errorHandler = [&](String const& error, std::exception const& e) {
       coutf("{}: {}\n", error, e.what());
     };
-    db.recoverAll(visitor, errorHandler);
+    db.recoverAll(visitor, errorHandler, threadCount);
+    newDb.writeBatch(take(batch));
 
     //close the old db
     db.close();
@@ -53,7 +61,7 @@ int main(int argc, char** argv) {
     newDb.commit();
     newDb.close();
 
-    coutf("Repacked BTree to {} in {:.6f}s\n({} inserts, {} overwritten)\n", outputFilename, Time::monotonicTime() - startTime, count, overwritten);
+    coutf("Repacked BTree to {} in {:.6f}s\n({} inserts)\n", outputFilename, Time::monotonicTime() - startTime, count);
     return 0;
 
   } catch (std::exception const& e) {
@@ -2,6 +2,8 @@
 #include "StarCelestialDatabase.hpp"
 #include "StarWorldTemplate.hpp"
 #include "StarWorldServer.hpp"
+#include "StarXXHash.hpp"
+#include "StarDataStreamDevices.hpp"
 
 using namespace Star;
 
@@ -12,6 +14,7 @@ int main(int argc, char** argv) {
     rootLoader.addParameter("regions", "regions", OptionParser::Optional, "number of regions to generate, default 1000");
     rootLoader.addParameter("regionsize", "size", OptionParser::Optional, "width / height of each generation region, default 10");
     rootLoader.addParameter("reportevery", "report regions", OptionParser::Optional, "number of generation regions before each progress report, default 20");
+    rootLoader.addSwitch("checksum", "print a checksum of the generated tiles, to compare generation settings");
 
     RootUPtr root;
     OptionParser::Options options;
@@ -44,6 +47,8 @@ int main(int argc, char** argv) {
     if (auto reportEveryOption = options.parameters.maybe("reportevery"))
       reportEvery = lexicalCast<unsigned>(reportEveryOption->first());
 
+    bool checksum = options.switches.contains("checksum");
+
     coutf("testing generation on coordinate {}\n", coordinate);
 
     auto worldParameters = celestialDatabase.parameters(coordinate).take();
@@ -59,6 +64,7 @@ int main(int argc, char** argv) {
 
     coutf("Starting world generation for {} regions\n", regionsToGenerate);
 
+    List<RectI> generatedRegions;
     for (unsigned i = 0; i < regionsToGenerate; ++i) {
       if (i != 0 && i % reportEvery == 0) {
         float gps = reportEvery / (Time::monotonicTime() - lastReport);
@@ -68,10 +74,29 @@ int main(int argc, char** argv) {
 
       RectI region = RectI::withCenter(Vec2I(rand.randInt(0, worldSize[0]), rand.randInt(0, worldSize[1])), Vec2I::filled(regionSize));
       worldServer.generateRegion(region);
+      if (checksum)
+        generatedRegions.append(region);
     }
 
     coutf("Finished generating {} regions with size {}x{} in world '{}' in {} seconds", regionsToGenerate, regionSize, regionSize, coordinate, Time::monotonicTime() - start);
 
+    if (checksum) {
+      // Tiles are only read back once everything is generated, as generating
+      // a region may still change the tiles of earlier ones nearby.
+      XXHash64 hasher;
+      DataStreamBuffer tileData;
+      for (auto const& region : generatedRegions) {
+        for (int x = region.xMin(); x < region.xMax(); ++x) {
+          for (int y = region.yMin(); y < region.yMax(); ++y) {
+            tileData.clear();
+            worldServer.getServerTile(Vec2I(x, y)).write(tileData);
+            hasher.push(tileData.ptr(), tileData.size());
+          }
+        }
+      }
+      coutf("\nGenerated tile checksum: {:016x}\n", hasher.digest());
+    }
+
     return 0;
 
   } catch (std::exception const& e) {
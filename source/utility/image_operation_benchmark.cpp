@@ -0,0 +1,71 @@
+#include "StarImageProcessing.hpp"
+#include "StarImage.hpp"
+#include "StarRandom.hpp"
+#include "StarStringView.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+// A sprite sheet drawn from a handful of colors, the way most game art is.
+Image spriteSheet(unsigned width, unsigned height, unsigned colors) {
+  RandomSource random(23);
+  List<Vec4B> palette;
+  for (unsigned i = 0; i < colors; ++i)
+    palette.append(Vec4B(random.randu32() % 256, random.randu32() % 256, random.randu32() % 256, i == 0 ? 0 : 255));
+
+  Image image(width, height, PixelFormat::RGBA32);
+  image.forEachPixel([&](unsigned, unsigned, Vec4B& pixel) {
+      pixel = palette[random.randu32() % palette.size()];
+    });
+  return image;
+}
+
+int main(int argc, char** argv) {
+  try {
+    VersionOptionParser optParse;
+    optParse.setSummary("Times the common color directives with the generic per pixel path and the direct RGBA kernels");
+    optParse.addParameter("size", "size", OptionParser::Optional, "sprite sheet width and height, default 512");
+    optParse.addParameter("colors", "colors", OptionParser::Optional, "distinct colors in the sheet, default 24");
+    optParse.addParameter("runs", "runs", OptionParser::Optional, "times to apply each directive each way, default 20");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+    auto parameter = [&](String const& name, unsigned def) {
+      if (auto p = opts.parameters.maybe(name))
+        return lexicalCast<unsigned>(p->first());
+      return def;
+    };
+
+    unsigned size = parameter("size", 512);
+    unsigned colors = parameter("colors", 24);
+    unsigned runs = parameter("runs", 20);
+
+    Image image = spriteSheet(size, size, colors);
+    String replace = "?replace";
+    for (unsigned i = 0; i < 8; ++i) {
+      Vec4B color = image.get(i, 0);
+      replace += strf(";{:02x}{:02x}{:02x}{:02x}=ff00ff", color[0], color[1], color[2], color[3]);
+    }
+
+    StringList directives = {"?hueshift=45", "?saturation=-30", "?brightness=20", "?fade=ffffff=0.3", "?multiply=c0c0ff", replace};
+    for (auto const& directive : directives) {
+      auto operations = parseImageOperations(directive);
+      double times[2];
+      for (bool kernels : {false, true}) {
+        setImageOperationKernelsEnabled(kernels);
+        double startTime = Time::monotonicTime();
+        for (unsigned i = 0; i < runs; ++i)
+          processImageOperations(operations, image);
+        times[kernels] = Time::monotonicTime() - startTime;
+      }
+      coutf("{}: {:.3f}ms generic, {:.3f}ms kernels, {:.2f}x speedup\n", directive.split('=').first().split(';').first(),
+          times[0] * 1000.0 / runs, times[1] * 1000.0 / runs, times[0] / times[1]);
+    }
+    setImageOperationKernelsEnabled(true);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
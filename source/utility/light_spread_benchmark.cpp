@@ -0,0 +1,65 @@
+#include "StarCellularLightArray.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+// A cave of scattered obstacles with colored lights all over it, about what
+// a busy underground screen looks like.
+void setupLightArray(ColoredCellularLightArray& lightArray, size_t width, size_t height) {
+  RandomSource random(17);
+  lightArray.setParameters(3, 8.0f, 1.5f, 12.0f, 2.0f, 0.5f, true);
+  lightArray.begin(width, height);
+  for (size_t x = 0; x < width; ++x) {
+    for (size_t y = 0; y < height; ++y)
+      lightArray.setObstacle(x, y, random.randu32() % 3 == 0);
+  }
+  for (size_t i = 0; i < width * height / 400; ++i) {
+    Vec2F position(random.randf() * width, random.randf() * height);
+    lightArray.addSpreadLight({position, Vec3F(random.randf(), random.randf(), random.randf())});
+  }
+}
+
+int main(int argc, char** argv) {
+  try {
+    VersionOptionParser optParse;
+    optParse.setSummary("Times colored spread lighting with the per cell and the vectorized sweeps");
+    optParse.addParameter("width", "width", OptionParser::Optional, "light array width, default 400");
+    optParse.addParameter("height", "height", OptionParser::Optional, "light array height, default 250");
+    optParse.addParameter("runs", "runs", OptionParser::Optional, "calculations to time each way, default 50");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+    auto parameter = [&](String const& name, unsigned def) {
+      if (auto p = opts.parameters.maybe(name))
+        return lexicalCast<unsigned>(p->first());
+      return def;
+    };
+
+    size_t width = parameter("width", 400);
+    size_t height = parameter("height", 250);
+    unsigned runs = parameter("runs", 50);
+
+    ColoredCellularLightArray lightArray;
+    size_t border = 20;
+    double times[2];
+    for (bool vectorized : {false, true}) {
+      lightArray.setVectorizedSpread(vectorized);
+      double elapsed = 0.0;
+      for (unsigned i = 0; i < runs; ++i) {
+        setupLightArray(lightArray, width, height);
+        double startTime = Time::monotonicTime();
+        lightArray.calculate(border, border, width - border, height - border);
+        elapsed += Time::monotonicTime() - startTime;
+      }
+      times[vectorized] = elapsed;
+      coutf("{} sweeps: {:.3f}ms per calculation\n", vectorized ? "vectorized" : "per cell", elapsed * 1000.0 / runs);
+    }
+    coutf("{:.2f}x speedup\n", times[0] / times[1]);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
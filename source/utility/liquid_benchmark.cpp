@@ -0,0 +1,105 @@
+#include "StarCellularLiquid.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+// A large cave, wrapping horizontally, with scattered rock and the upper
+// half of the left side flooded, which keeps nearly every liquid cell active.
+struct CaveLiquidWorld : CellularLiquidWorld<uint8_t> {
+  CaveLiquidWorld(int width, int height) : width(width), height(height) {
+    cells.resize(width * height);
+    solid.resize(width * height);
+    for (int x = 0; x < width; ++x) {
+      for (int y = 0; y < height; ++y) {
+        size_t i = x + y * width;
+        solid[i] = y == 0 || y == height - 1 || staticRandomU32(x / 3, y / 3, "rock") % 9 == 0;
+        cells[i] = CellularLiquidFlowCell<uint8_t>{{}, 0.0f, 0.0f};
+        if (!solid[i] && x < width / 2 && y > height / 2)
+          cells[i] = CellularLiquidFlowCell<uint8_t>{uint8_t(1), 1.0f, 0.0f};
+      }
+    }
+  }
+
+  Vec2I uniqueLocation(Vec2I const& location) const override {
+    return Vec2I(pmod(location[0], width), location[1]);
+  }
+
+  CellularLiquidCell<uint8_t> cell(Vec2I const& location) const override {
+    if (location[1] < 0 || location[1] >= height)
+      return CellularLiquidCollisionCell();
+    size_t i = location[0] + location[1] * width;
+    if (solid[i])
+      return CellularLiquidCollisionCell();
+    return cells[i];
+  }
+
+  void setFlow(Vec2I const& location, CellularLiquidFlowCell<uint8_t> const& flow) override {
+    cells[location[0] + location[1] * width] = flow;
+  }
+
+  int width;
+  int height;
+  List<CellularLiquidFlowCell<uint8_t>> cells;
+  List<bool> solid;
+};
+
+int main(int argc, char** argv) {
+  try {
+    VersionOptionParser optParse;
+    optParse.setSummary("Times liquid simulation steps on a large flooded cave");
+    optParse.addParameter("width", "width", OptionParser::Optional, "cave width, default 1000");
+    optParse.addParameter("height", "height", OptionParser::Optional, "cave height, default 500");
+    optParse.addParameter("steps", "steps", OptionParser::Optional, "liquid updates to run, default 100");
+    optParse.addParameter("threads", "count", OptionParser::Optional, "engine thread count, 0 is untiled, default 0");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+    auto parameter = [&](String const& name, unsigned def) {
+      if (auto p = opts.parameters.maybe(name))
+        return lexicalCast<unsigned>(p->first());
+      return def;
+    };
+
+    int width = parameter("width", 1000);
+    int height = parameter("height", 500);
+    unsigned steps = parameter("steps", 100);
+    unsigned threads = parameter("threads", 0);
+
+    LiquidCellEngineParameters parameters;
+    parameters.lateralMoveFactor = 0.5f;
+    parameters.spreadOverfillUpFactor = 0.25f;
+    parameters.spreadOverfillLateralFactor = 0.75f;
+    parameters.spreadOverfillDownFactor = 0.25f;
+    parameters.pressureEqualizeFactor = 0.5f;
+    parameters.pressureMoveFactor = 0.5f;
+    parameters.maximumPressureLevelImbalance = 0.05f;
+    parameters.minimumLivenPressureChange = 0.0001f;
+    parameters.minimumLivenLevelChange = 0.0001f;
+    parameters.minimumLiquidLevel = 0.0f;
+    parameters.interactTransformationLevel = 0.1f;
+    parameters.equilibriumChangeThreshold = 0.0f;
+    parameters.equilibriumTicks = 0;
+
+    auto world = make_shared<CaveLiquidWorld>(width, height);
+    LiquidCellEngine<uint8_t> engine(parameters, world);
+    engine.setThreadCount(threads);
+    engine.visitRegion(RectI(0, 0, width, height));
+
+    size_t processedCells = 0;
+    double startTime = Time::monotonicTime();
+    for (unsigned i = 0; i < steps; ++i) {
+      processedCells += engine.activeCells();
+      engine.update();
+    }
+    double elapsed = Time::monotonicTime() - startTime;
+
+    coutf("{} updates of a {}x{} cave with {} threads in {:.3f}s\n", steps, width, height, threads, elapsed);
+    coutf("{:.3f}ms per update, {:.1f}ns per active cell\n",
+        elapsed * 1000.0 / steps, processedCells ? elapsed * 1e9 / processedCells : 0.0);
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,516 @@
+#include "StarMainApplication.hpp"
+#include "StarRootLoader.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarLogging.hpp"
+#include "StarRandom.hpp"
+#include "StarFile.hpp"
+#include "StarJsonExtra.hpp"
+#include "StarTraceProfiler.hpp"
+#include "StarWorldServer.hpp"
+#include "StarWorldTemplate.hpp"
+#include "StarWorldPainter.hpp"
+#include "StarAssets.hpp"
+#include "StarConfiguration.hpp"
+#include "StarMaterialDatabase.hpp"
+#include "StarLiquidsDatabase.hpp"
+#include "StarStoredFunctions.hpp"
+#include "StarBiome.hpp"
+#include "StarSky.hpp"
+
+using namespace Star;
+
+// Target update rate while benchmarking, high enough that the application
+// never sleeps between frames.
+static float const UncappedUpdateRate = 100000.0f;
+
+// Frames between collecting stage times from the trace profiler, well within
+// the time it takes the render thread to fill its trace buffer.
+static uint64_t const ZoneCollectFrames = 500;
+
+// A tile of the benchmarked region, converted once for rendering and lighting
+struct BenchmarkTile {
+  RenderTile render;
+  Vec3F light;
+  bool obstacle = false;
+  bool environmentLit = false;
+};
+
+static BenchmarkTile makeBenchmarkTile(ServerTile const& tile) {
+  auto materialDatabase = Root::singleton().materialDatabase();
+  auto liquidsDatabase = Root::singleton().liquidsDatabase();
+
+  BenchmarkTile benchmarkTile;
+  RenderTile& renderTile = benchmarkTile.render;
+  renderTile.foreground = tile.foreground;
+  renderTile.foregroundMod = tile.foregroundMod;
+
+  renderTile.background = tile.background;
+  renderTile.backgroundMod = tile.backgroundMod;
+
+  renderTile.foregroundHueShift = tile.foregroundHueShift;
+  renderTile.foregroundModHueShift = tile.foregroundModHueShift;
+  renderTile.foregroundColorVariant = tile.foregroundColorVariant;
+  renderTile.foregroundDamageType = tile.foregroundDamage.damageType();
+  renderTile.foregroundDamageLevel = floatToByte(tile.foregroundDamage.damageEffectPercentage());
+
+  renderTile.backgroundHueShift = tile.backgroundHueShift;
+  renderTile.backgroundModHueShift = tile.backgroundModHueShift;
+  renderTile.backgroundColorVariant = tile.backgroundColorVariant;
+  renderTile.backgroundDamageType = tile.backgroundDamage.damageType();
+  renderTile.backgroundDamageLevel = floatToByte(tile.backgroundDamage.damageEffectPercentage());
+
+  renderTile.liquidId = tile.liquid.liquid;
+  renderTile.liquidLevel = floatToByte(tile.liquid.level);
+
+  bool foregroundTransparent = materialDatabase->foregroundLightTransparent(tile.foreground);
+  if (tile.foreground != EmptyMaterialId || tile.foregroundMod != NoModId)
+    benchmarkTile.light += materialDatabase->radiantLight(tile.foreground, tile.foregroundMod);
+  if (tile.liquid.liquid != EmptyLiquidId && tile.liquid.level != 0.0f)
+    benchmarkTile.light += liquidsDatabase->radiantLight(tile.liquid);
+  if (foregroundTransparent) {
+    if (tile.background != EmptyMaterialId || tile.backgroundMod != NoModId)
+      benchmarkTile.light += materialDatabase->radiantLight(tile.background, tile.backgroundMod);
+    benchmarkTile.environmentLit = materialDatabase->backgroundLightTransparent(tile.background);
+  }
+  benchmarkTile.obstacle = !foregroundTransparent;
+
+  return benchmarkTile;
+}
+
+static Json durationStats(List<double> durations) {
+  if (durations.empty())
+    return Json();
+
+  sort(durations);
+  auto percentile = [&](double p) {
+    return durations[min<size_t>(durations.size() - 1, (size_t)(p * durations.size()))] * 1000.0;
+  };
+  double total = 0.0;
+  for (double duration : durations)
+    total += duration;
+
+  return JsonObject{
+      {"meanMs", total / durations.size() * 1000.0},
+      {"p50Ms", percentile(0.5)},
+      {"p90Ms", percentile(0.9)},
+      {"p99Ms", percentile(0.99)},
+      {"maxMs", durations.last() * 1000.0}
+    };
+}
+
+static Json countStats(List<size_t> const& counts) {
+  if (counts.empty())
+    return Json();
+
+  size_t total = 0;
+  size_t maximum = 0;
+  for (size_t count : counts) {
+    total += count;
+    maximum = max(maximum, count);
+  }
+  return JsonObject{{"perFrame", (double)total / counts.size()}, {"max", maximum}};
+}
+
+// Renders a region of a saved or generated world through the WorldPainter,
+// without a client or any entities, for a fixed number of frames.  Reports
+// how long each frame and each stage of it took, and what every frame sent to
+// the GPU.
+class RenderBenchmarkApplication : public Application {
+protected:
+  void startup(StringList const& cmdLineArgs) override;
+  void applicationInit(ApplicationControllerPtr appController) override;
+  void renderInit(RendererPtr renderer) override;
+  void update() override;
+  void render() override;
+  void shutdown() override;
+
+private:
+  void loadWorld();
+  void gatherRenderData();
+  BenchmarkTile const& tileAt(Vec2I const& position) const;
+  void collectZoneTimes();
+  void finish();
+
+  RootUPtr m_root;
+
+  Maybe<String> m_worldFile;
+  Maybe<String> m_dungeon;
+  uint64_t m_worldSeed = 0;
+  Maybe<Vec2F> m_startPosition;
+  Vec2U m_resolution = Vec2U(1920, 1080);
+  float m_zoom = 2.0f;
+  float m_pan = 0.0f;
+  uint64_t m_warmupFrames = 60;
+  uint64_t m_frames = 600;
+  bool m_fullbright = false;
+  Maybe<String> m_jsonFile;
+
+  WorldServerPtr m_worldServer;
+  WorldGeometry m_geometry;
+  Vec2F m_cameraPosition;
+  Vec2I m_tilesMin;
+  MultiArray<BenchmarkTile, 2> m_tiles;
+  BenchmarkTile m_emptyTile;
+
+  WorldPainterPtr m_worldPainter;
+  WorldRenderData m_renderData;
+  CellularLightingCalculator m_lightingCalculator;
+
+  uint64_t m_frame = 0;
+  Maybe<double> m_lastFrameStart;
+  double m_collectTime = 0.0;
+
+  List<double> m_frameTimes;
+  List<double> m_renderTimes;
+  List<double> m_gatherTimes;
+  List<RenderStatistics> m_frameStatistics;
+  StringMap<List<double>> m_zoneTimes;
+};
+
+void RenderBenchmarkApplication::startup(StringList const& cmdLineArgs) {
+  RootLoader rootLoader({{}, JsonObject{{"zoomLevel", m_zoom}}, {}, LogLevel::Error, false, {}});
+  rootLoader.addParameter("world", "file", OptionParser::Optional, "saved world file to render, it is not modified");
+  rootLoader.addParameter("dungeon", "name", OptionParser::Optional, "dungeon to generate a world from and render instead of a saved world");
+  rootLoader.addParameter("seed", "seed", OptionParser::Optional, "world seed used to create the dungeon world");
+  rootLoader.addParameter("position", "x,y", OptionParser::Optional, "world position to center the camera on, defaults to the player start");
+  rootLoader.addParameter("resolution", "WxH", OptionParser::Optional, "window resolution to render at, default 1920x1080");
+  rootLoader.addParameter("zoom", "zoom", OptionParser::Optional, "zoom level to render at, default 2");
+  rootLoader.addParameter("pan", "tiles", OptionParser::Optional, "tiles the camera moves right every frame, default 0");
+  rootLoader.addParameter("warmup", "frames", OptionParser::Optional, "frames to render before measuring, default 60");
+  rootLoader.addParameter("frames", "frames", OptionParser::Optional, "frames to measure, default 600");
+  rootLoader.addParameter("json", "file", OptionParser::Optional, "file to write the results to as json");
+  rootLoader.addSwitch("fullbright", "render without calculating lighting");
+
+  RootLoader::Options options;
+  tie(m_root, options) = rootLoader.initOrDie(cmdLineArgs);
+
+  auto parameter = [&](String const& name) -> Maybe<String> {
+    return options.parameters.maybe(name).apply([](StringList p) { return p.maybeFirst(); }).value({});
+  };
+
+  m_worldFile = parameter("world");
+  m_dungeon = parameter("dungeon");
+  if (!m_worldFile == !m_dungeon)
+    throw StarException("Exactly one of -world or -dungeon must be given");
+
+  m_worldSeed = Random::randu64();
+  if (auto seed = parameter("seed"))
+    m_worldSeed = lexicalCast<uint64_t>(*seed);
+  if (auto position = parameter("position")) {
+    auto parts = position->split(',');
+    if (parts.size() != 2)
+      throw StarException::format("Position '{}' is not of the form x,y", *position);
+    m_startPosition = Vec2F(lexicalCast<float>(parts[0]), lexicalCast<float>(parts[1]));
+  }
+  if (auto resolution = parameter("resolution")) {
+    auto parts = resolution->split('x');
+    if (parts.size() != 2)
+      throw StarException::format("Resolution '{}' is not of the form WxH", *resolution);
+    m_resolution = Vec2U(lexicalCast<unsigned>(parts[0]), lexicalCast<unsigned>(parts[1]));
+  }
+  if (auto zoom = parameter("zoom"))
+    m_zoom = lexicalCast<float>(*zoom);
+  if (auto pan = parameter("pan"))
+    m_pan = lexicalCast<float>(*pan);
+  if (auto warmup = parameter("warmup"))
+    m_warmupFrames = lexicalCast<uint64_t>(*warmup);
+  if (auto frames = parameter("frames"))
+    m_frames = max<uint64_t>(1, lexicalCast<uint64_t>(*frames));
+  m_fullbright = options.switches.contains("fullbright");
+  m_jsonFile = parameter("json");
+
+  m_root->configuration()->set("zoomLevel", m_zoom);
+
+  loadWorld();
+}
+
+void RenderBenchmarkApplication::applicationInit(ApplicationControllerPtr appController) {
+  Application::applicationInit(appController);
+
+  appController->setApplicationTitle("Render Benchmark");
+  appController->setNormalWindow(m_resolution);
+  appController->setVSyncEnabled(false);
+  appController->setTargetUpdateRate(UncappedUpdateRate);
+  appController->setMaxFrameSkip(0);
+}
+
+void RenderBenchmarkApplication::renderInit(RendererPtr renderer) {
+  Application::renderInit(renderer);
+
+  auto assets = m_root->assets();
+  renderer->loadConfig(assets->json("/rendering/opengl.config"));
+
+  String path = "/rendering/effects/world.config";
+  StringMap<String> shaders;
+  auto config = assets->json(path);
+  for (auto& entry : config.getObject("effectShaders")) {
+    if (entry.second.isType(Json::Type::String)) {
+      String shader = entry.second.toString();
+      if (!shader.hasChar('\n')) {
+        auto shaderBytes = assets->bytes(AssetPath::relativeTo(path, shader));
+        shader = std::string(shaderBytes->ptr(), shaderBytes->size());
+      }
+      shaders[entry.first] = shader;
+    }
+  }
+  renderer->loadEffectConfig("world", config, shaders);
+
+  m_worldPainter = make_shared<WorldPainter>();
+  m_worldPainter->renderInit(renderer);
+}
+
+void RenderBenchmarkApplication::update() {
+  if (m_worldPainter)
+    m_worldPainter->update(appController()->updateRate() > 0 ? 1.0f / appController()->updateRate() : 0.0f);
+}
+
+void RenderBenchmarkApplication::render() {
+  if (m_frame > m_warmupFrames + m_frames)
+    return;
+
+  double frameStart = Time::monotonicTime();
+  // Frames up to this one have been finished, so the statistics of the
+  // previous frame are complete
+  if (m_frame > m_warmupFrames) {
+    m_frameTimes.append(frameStart - *m_lastFrameStart - m_collectTime);
+    m_frameStatistics.append(renderer()->lastFrameStatistics());
+  }
+  m_collectTime = 0.0;
+
+  if (m_frame == m_warmupFrames) {
+    TraceProfiler::startCapture();
+  } else if (m_frame == m_warmupFrames + m_frames) {
+    finish();
+    ++m_frame;
+    return;
+  }
+  m_lastFrameStart = frameStart;
+
+  m_cameraPosition += Vec2F(m_pan, 0.0f);
+  m_worldPainter->setCameraPosition(m_geometry, m_cameraPosition);
+  WorldCamera& camera = m_worldPainter->camera();
+  camera.setScreenSize(renderer()->screenSize());
+  camera.setPixelRatio(m_zoom);
+
+  double gatherStart = Time::monotonicTime();
+  gatherRenderData();
+  double gatherTime = Time::monotonicTime() - gatherStart;
+
+  renderer()->switchEffectConfig("world");
+  m_worldPainter->render(m_renderData, []() { return true; });
+  renderer()->switchEffectConfig("interface");
+
+  if (m_frame >= m_warmupFrames) {
+    m_gatherTimes.append(gatherTime);
+    m_renderTimes.append(Time::monotonicTime() - frameStart);
+    if ((m_frame - m_warmupFrames + 1) % ZoneCollectFrames == 0) {
+      double collectStart = Time::monotonicTime();
+      collectZoneTimes();
+      TraceProfiler::startCapture();
+      m_collectTime = Time::monotonicTime() - collectStart;
+    }
+  }
+
+  ++m_frame;
+}
+
+void RenderBenchmarkApplication::shutdown() {
+  m_worldPainter.reset();
+  m_worldServer.reset();
+}
+
+void RenderBenchmarkApplication::loadWorld() {
+  if (m_worldFile) {
+    // Rendered from a copy so the saved world is left as it was
+    auto storage = File::ephemeralFile();
+    storage->writeBytes(File::readFile(*m_worldFile));
+    m_worldServer = make_shared<WorldServer>(storage);
+  } else {
+    auto worldTemplate = make_shared<WorldTemplate>(generateFloatingDungeonWorldParameters(*m_dungeon), SkyParameters(), m_worldSeed);
+    m_worldServer = make_shared<WorldServer>(worldTemplate, File::ephemeralFile());
+  }
+  m_geometry = m_worldServer->geometry();
+
+  if (m_startPosition) {
+    m_cameraPosition = *m_startPosition;
+  } else {
+    ConnectionId clientId = 1;
+    m_worldServer->addClient(clientId, SpawnTarget(), false);
+    for (auto const& packet : m_worldServer->getOutgoingPackets(clientId)) {
+      if (auto worldStart = as<WorldStartPacket>(packet))
+        m_cameraPosition = worldStart->playerStart;
+    }
+    m_worldServer->removeClient(clientId);
+  }
+
+  // Every tile the camera can see over the whole run, with enough room for
+  // any resolution and zoom plus lighting spread, capped to the world width
+  Vec2I screenTiles = Vec2I::ceil(Vec2F(m_resolution) / (TilePixels * m_zoom));
+  int padding = TilePainter::BorderTileSize + m_root->assets()->json("/lighting.config:lighting.spreadMaxRange").optInt().value(40);
+  Vec2I regionSize = screenTiles + Vec2I::filled(padding * 2);
+  regionSize[0] = min<int>(regionSize[0] + ceil(m_pan * (m_warmupFrames + m_frames + 1)), m_geometry.width());
+  RectI region = RectI::withSize(Vec2I::floor(m_cameraPosition) - screenTiles / 2 - Vec2I::filled(padding), regionSize);
+
+  coutf("Generating {} tiles around {}\n", region.volume(), m_cameraPosition);
+  m_worldServer->generateRegion(region);
+
+  m_tilesMin = region.min();
+  m_tiles.resize(Vec2S(region.size()));
+  for (int x = 0; x < region.width(); ++x) {
+    for (int y = 0; y < region.height(); ++y)
+      m_tiles(x, y) = makeBenchmarkTile(m_worldServer->getServerTile(m_tilesMin + Vec2I(x, y)));
+  }
+  m_emptyTile = makeBenchmarkTile(ServerTile());
+
+  m_renderData.geometry = m_geometry;
+  m_renderData.isFullbright = m_fullbright;
+  m_renderData.particles = nullptr;
+  m_renderData.skyRenderData = m_worldServer->sky()->renderData();
+  // Nothing in the region ever changes, the same as a client standing still
+  // in a quiet world, so the tile painter keeps every chunk it builds
+  m_renderData.tileRevision = [](RectI const&) -> uint64_t { return 1; };
+}
+
+void RenderBenchmarkApplication::gatherRenderData() {
+  STAR_PROFILE_SCOPE("RenderBenchmark::gather");
+  WorldCamera const& camera = m_worldPainter->camera();
+  RectI window = camera.worldTileRect();
+  RectI tileRange = window.padded(TilePainter::BorderTileSize);
+
+  m_renderData.tileMinPosition = tileRange.min();
+  m_renderData.tiles.resize(Vec2S(tileRange.size()));
+  for (int x = 0; x < tileRange.width(); ++x) {
+    for (int y = 0; y < tileRange.height(); ++y)
+      m_renderData.tiles(x, y) = tileAt(tileRange.min() + Vec2I(x, y)).render;
+  }
+
+  if (!m_fullbright) {
+    STAR_PROFILE_SCOPE("RenderBenchmark::lighting");
+    auto configuration = m_root->configuration();
+    Json lightingConfig = m_root->assets()->json("/lighting.config:lighting");
+    bool rendererLighting = renderer()->lightmapCalculationSupported() && lightingConfig.getBool("rendererCalculation", false);
+    m_lightingCalculator.setParameters(lightingConfig.set("pointAdditive", configuration->get("newLighting").optBool().value(true)));
+    m_lightingCalculator.setMonochrome(configuration->get("monochromeLighting").optBool().value(false));
+
+    RectI lightRange = window.padded(1);
+    m_lightingCalculator.begin(lightRange);
+    Vec3F environmentLight = m_worldServer->sky()->environmentLight().toRgbF();
+    float undergroundLevel = m_worldServer->worldTemplate()->undergroundLevel();
+    RectI region = m_lightingCalculator.calculationRegion();
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      size_t baseIndex = m_lightingCalculator.baseIndexFor(Vec2I(x, region.yMin()));
+      for (int y = region.yMin(); y < region.yMax(); ++y) {
+        auto const& tile = tileAt(Vec2I(x, y));
+        Vec3F light = tile.light;
+        if (tile.environmentLit && y > undergroundLevel)
+          light += environmentLight;
+        m_lightingCalculator.setCellIndex(baseIndex + (y - region.yMin()), light, tile.obstacle);
+      }
+    }
+
+    m_renderData.lightMinPosition = lightRange.min();
+    if (rendererLighting)
+      m_lightingCalculator.calculate(m_renderData.lightingInput);
+    else
+      m_lightingCalculator.calculate(m_renderData.lightMap);
+  }
+
+  m_renderData.parallaxLayers.clear();
+  Vec2I center = Vec2I::floor(camera.centerWorldPosition());
+  if (auto biome = m_worldServer->worldTemplate()->environmentBiome(center[0], center[1])) {
+    if (biome->parallax)
+      m_renderData.parallaxLayers.appendAll(biome->parallax->layers());
+  }
+
+  auto functionDatabase = m_root->functionDatabase();
+  auto sky = m_worldServer->sky();
+  for (auto& layer : m_renderData.parallaxLayers) {
+    if (!layer.timeOfDayCorrelation.empty())
+      layer.alpha *= clamp((float)functionDatabase->function(layer.timeOfDayCorrelation)->evaluate(sky->timeOfDay() / sky->dayLength()), 0.0f, 1.0f);
+  }
+  stableSort(m_renderData.parallaxLayers, [](ParallaxLayer const& a, ParallaxLayer const& b) {
+      return tie(a.zLevel, a.verticalOrigin) > tie(b.zLevel, b.verticalOrigin);
+    });
+}
+
+BenchmarkTile const& RenderBenchmarkApplication::tileAt(Vec2I const& position) const {
+  Vec2I index = {m_geometry.xwrap(position[0] - m_tilesMin[0]), position[1] - m_tilesMin[1]};
+  if (index[0] < (int)m_tiles.size(0) && index[1] >= 0 && index[1] < (int)m_tiles.size(1))
+    return m_tiles(index[0], index[1]);
+  return m_emptyTile;
+}
+
+void RenderBenchmarkApplication::collectZoneTimes() {
+  Json trace = TraceProfiler::stopCapture();
+  for (auto const& event : trace.getArray("traceEvents")) {
+    if (event.getString("ph") == "X")
+      m_zoneTimes[event.getString("name")].append(event.getDouble("dur") / 1000000.0);
+  }
+}
+
+void RenderBenchmarkApplication::finish() {
+  collectZoneTimes();
+
+  JsonObject zones;
+  for (auto const& pair : m_zoneTimes) {
+    double total = 0.0;
+    for (double duration : pair.second)
+      total += duration;
+    zones[pair.first] = JsonObject{
+        {"msPerFrame", total / m_frames * 1000.0},
+        {"calls", pair.second.size()},
+        {"p99Ms", durationStats(pair.second).getDouble("p99Ms")}
+      };
+  }
+
+  auto statistic = [&](size_t RenderStatistics::*member) {
+    return countStats(m_frameStatistics.transformed([member](RenderStatistics const& statistics) { return statistics.*member; }));
+  };
+
+  Json results = JsonObject{
+      {"world", jsonFromMaybe(m_worldFile.orMaybe(m_dungeon))},
+      {"position", jsonFromVec2F(m_cameraPosition)},
+      {"resolution", jsonFromVec2U(m_resolution)},
+      {"zoom", m_zoom},
+      {"pan", m_pan},
+      {"fullbright", m_fullbright},
+      {"frames", m_frames},
+      {"frame", durationStats(m_frameTimes)},
+      {"render", durationStats(m_renderTimes)},
+      {"gather", durationStats(m_gatherTimes)},
+      {"zones", zones},
+      {"drawCalls", statistic(&RenderStatistics::drawCalls)},
+      {"triangles", statistic(&RenderStatistics::triangles)},
+      {"textureUploads", statistic(&RenderStatistics::textureUploads)},
+      {"textureUploadBytes", statistic(&RenderStatistics::textureUploadBytes)}
+    };
+
+  coutf("{} frames at {}x{}, zoom {}\n", m_frames, m_resolution[0], m_resolution[1], m_zoom);
+  auto printDurations = [](String const& name, Json const& stats) {
+    coutf("{:<16} mean {:.3f}ms, p50 {:.3f}ms, p90 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms\n", name,
+        stats.getDouble("meanMs"), stats.getDouble("p50Ms"), stats.getDouble("p90Ms"), stats.getDouble("p99Ms"), stats.getDouble("maxMs"));
+  };
+  printDurations("Frames:", results.get("frame"));
+  printDurations("Render CPU:", results.get("render"));
+  printDurations("Data gather:", results.get("gather"));
+
+  auto sortedZones = zones.pairs();
+  sort(sortedZones, [](auto const& a, auto const& b) { return a.second.getDouble("msPerFrame") > b.second.getDouble("msPerFrame"); });
+  coutf("Render stages:\n");
+  for (auto const& zone : sortedZones) {
+    coutf("  {:<32} {:>10.4f}ms per frame {:>10} calls {:>10.4f}ms p99\n",
+        zone.first, zone.second.getDouble("msPerFrame"), zone.second.getUInt("calls"), zone.second.getDouble("p99Ms"));
+  }
+
+  for (auto const& name : {"drawCalls", "triangles", "textureUploads", "textureUploadBytes"}) {
+    auto stats = results.get(name);
+    coutf("{:<20} {:>12.1f} per frame {:>12} max\n", name, stats.getDouble("perFrame"), stats.getUInt("max"));
+  }
+
+  if (m_jsonFile)
+    File::writeFile(results.printJson(2, true), *m_jsonFile);
+
+  appController()->quit();
+}
+
+STAR_MAIN_APPLICATION(RenderBenchmarkApplication);
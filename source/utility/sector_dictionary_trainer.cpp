@@ -0,0 +1,87 @@
+#include "StarBTreeDatabase.hpp"
+#include "StarCompression.hpp"
+#include "StarZSTDCompression.hpp"
+#include "StarFile.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarTime.hpp"
+#include "StarVersionOptionParser.hpp"
+
+using namespace Star;
+
+// Matches WorldStorage::StoreType
+uint8_t const TileSectorStoreType = 1;
+uint8_t const EntitySectorStoreType = 2;
+
+int main(int argc, char** argv) {
+  try {
+    double startTime = Time::monotonicTime();
+
+    VersionOptionParser optParse;
+    optParse.setSummary("Trains a zstd dictionary for world storage sector compression from existing .world files");
+    optParse.addParameter("type", "tile|entity", OptionParser::Optional, "Which sector store to sample, defaults to tile");
+    optParse.addParameter("size", "bytes", OptionParser::Optional, "Maximum dictionary size, defaults to 112640");
+    optParse.addArgument("output file", OptionParser::Required, "Path to write the trained dictionary to");
+    optParse.addArgument("world files", OptionParser::Multiple, "World files to sample sectors from");
+
+    auto opts = optParse.commandParseOrDie(argc, argv);
+
+    String type = opts.parameters.value("type", {"tile"}).first();
+    uint8_t storeType;
+    if (type == "tile")
+      storeType = TileSectorStoreType;
+    else if (type == "entity")
+      storeType = EntitySectorStoreType;
+    else
+      throw StarException::format("Unknown sector type '{}'", type);
+    size_t dictionarySize = lexicalCast<size_t>(opts.parameters.value("size", {"112640"}).first());
+
+    String outputFilename = opts.arguments.at(0);
+    List<ByteArray> samples;
+    size_t sampleBytes = 0;
+    for (auto const& worldFile : opts.arguments.slice(1)) {
+      BTreeDatabase db;
+      db.setIODevice(File::open(worldFile, IOMode::Read));
+      db.open();
+
+      size_t worldSamples = 0;
+      // World keys are the store type byte followed by 4 bytes of sector
+      // coordinates, so the whole store is one contiguous range.
+      ByteArray lower(db.keySize(), 0);
+      lower[0] = storeType;
+      ByteArray upper(db.keySize(), 0);
+      upper[0] = storeType + 1;
+      {
+        auto cursor = db.scan(lower, upper, true);
+        while (cursor.next()) {
+          ByteArray const& data = cursor.value();
+          ByteArray sample;
+          if (ZstdCompression::isFrame(data)) {
+            // Sectors compressed with an existing dictionary can't be sampled
+            if (ZstdCompression::frameDictionaryId(data) != 0)
+              continue;
+            sample = ZstdCompression::decompress(data);
+          } else {
+            sample = uncompressData(data);
+          }
+          sampleBytes += sample.size();
+          samples.append(std::move(sample));
+          ++worldSamples;
+        }
+      }
+      db.close();
+
+      coutf("Sampled {} sectors from {}\n", worldSamples, worldFile);
+    }
+
+    auto dictionary = ZstdDictionary::train(samples, dictionarySize);
+    File::writeFile(dictionary, outputFilename);
+
+    coutf("Trained {} byte dictionary {} from {} samples ({} bytes) in {:.6f}s\n",
+        dictionary.size(), ZstdDictionary(dictionary).id(), samples.size(), sampleBytes, Time::monotonicTime() - startTime);
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,197 @@
+#include "StarLexicalCast.hpp"
+#include "StarLogging.hpp"
+#include "StarRootLoader.hpp"
+#include "StarUniverseServer.hpp"
+#include "StarPacketCapture.hpp"
+#include "StarTraceProfiler.hpp"
+#include "StarDataStreamDevices.hpp"
+
+using namespace Star;
+
+// Seconds between collecting world update times from the trace profiler,
+// well within the time it takes a world thread to fill its trace buffer.
+static double const TickCollectInterval = 5.0;
+
+struct ReplayStream {
+  List<CapturedPacket> packets;
+  size_t next = 0;
+  UniverseConnectionUPtr connection;
+  // Seconds the rest of the stream is delayed by, as the server may take a
+  // different time to accept the connection than it did when captured.
+  double delay = 0.0;
+  bool awaitingConnect = false;
+  bool finished = false;
+};
+
+struct PacketTypeTraffic {
+  size_t count = 0;
+  size_t bytes = 0;
+};
+
+static void collectTickTimes(List<double>& tickTimes) {
+  Json trace = TraceProfiler::stopCapture();
+  TraceProfiler::startCapture();
+  for (auto const& event : trace.getArray("traceEvents")) {
+    if (event.getString("name") == "WorldServer::update")
+      tickTimes.append(event.getDouble("dur") / 1000000.0);
+  }
+}
+
+static void printTraffic(String const& title, Map<PacketType, PacketTypeTraffic> const& traffic, double duration) {
+  auto sorted = traffic.pairs();
+  sort(sorted, [](auto const& a, auto const& b) { return a.second.bytes > b.second.bytes; });
+
+  size_t totalBytes = 0;
+  for (auto const& pair : sorted)
+    totalBytes += pair.second.bytes;
+
+  coutf("{}: {} bytes, {:.1f} bytes/s\n", title, totalBytes, totalBytes / duration);
+  for (auto const& pair : sorted)
+    coutf("  {:<32} {:>8} packets {:>12} bytes {:>12.1f} bytes/s\n",
+        PacketTypeNames.getRight(pair.first), pair.second.count, pair.second.bytes, pair.second.bytes / duration);
+}
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addArgument("capture", OptionParser::Required, "packet capture recorded with /packetcapture to replay");
+    rootLoader.addParameter("universe", "universe", OptionParser::Optional, "universe storage directory to copy and replay against, defaults to a new universe");
+    rootLoader.addParameter("speed", "speed", OptionParser::Optional, "how many times faster than captured to replay the packets, defaults to 1");
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    coutf("Fully loading root...");
+    root->fullyLoad();
+    coutf(" done\n");
+
+    double speed = 1.0;
+    if (options.parameters.contains("speed"))
+      speed = lexicalCast<double>(options.parameters.get("speed").first());
+
+    Map<uint32_t, ReplayStream> streams;
+    size_t packetCount = 0;
+    for (auto& packet : readPacketCapture(options.arguments.first())) {
+      streams[packet.stream].packets.append(std::move(packet));
+      ++packetCount;
+    }
+    coutf("Replaying {} packets from {} connections\n", packetCount, streams.size());
+
+    String storageDirectory = File::temporaryDirectory();
+    if (options.parameters.contains("universe")) {
+      String universeDirectory = options.parameters.get("universe").first();
+      for (auto const& entry : File::dirList(universeDirectory)) {
+        if (!entry.second)
+          File::copy(File::relativeTo(universeDirectory, entry.first), File::relativeTo(storageDirectory, entry.first));
+      }
+    }
+
+    auto server = make_shared<UniverseServer>(storageDirectory);
+    server->start();
+
+    Map<PacketType, PacketTypeTraffic> incoming;
+    Map<PacketType, PacketTypeTraffic> outgoing;
+    List<double> tickTimes;
+
+    TraceProfiler::startCapture();
+    double start = Time::monotonicTime();
+    double lastCollect = start;
+    size_t unfinished = streams.size();
+    while (unfinished != 0) {
+      double time = (Time::monotonicTime() - start) * speed;
+
+      for (auto& pair : streams) {
+        auto& stream = pair.second;
+        if (stream.finished)
+          continue;
+
+        if (!stream.connection) {
+          if (stream.packets.first().time > time)
+            continue;
+          stream.connection = make_unique<UniverseConnection>(server->addLocalClient());
+        }
+
+        auto& connection = *stream.connection;
+        NetCompatibilityRules netRules = stream.packets.at(stream.next > 0 ? stream.next - 1 : 0).netRules;
+
+        connection.receive();
+        for (auto const& packet : connection.pull()) {
+          DataStreamBuffer ds;
+          packet->write(ds, netRules);
+          auto& traffic = outgoing[packet->type()];
+          ++traffic.count;
+          traffic.bytes += ds.size();
+
+          if (packet->type() == PacketType::ConnectSuccess) {
+            stream.awaitingConnect = false;
+            stream.delay = max(stream.delay, time - stream.packets.at(stream.next - 1).time);
+          } else if (auto failure = as<ConnectFailurePacket>(packet)) {
+            coutf("Connection {} failed to connect: {}\n", pair.first, failure->reason);
+            stream.finished = true;
+            break;
+          }
+        }
+
+        while (!stream.finished && !stream.awaitingConnect && stream.next < stream.packets.size()
+            && stream.packets[stream.next].time + stream.delay <= time) {
+          auto const& captured = stream.packets[stream.next++];
+          // Local clients are never sent a handshake challenge
+          if (captured.type == PacketType::HandshakeResponse)
+            continue;
+
+          connection.pushSingle(captured.packet());
+          auto& traffic = incoming[captured.type];
+          ++traffic.count;
+          traffic.bytes += captured.data.size();
+
+          if (captured.type == PacketType::ClientConnect)
+            stream.awaitingConnect = true;
+        }
+        connection.send();
+
+        if (stream.next == stream.packets.size() && !stream.awaitingConnect)
+          stream.finished = true;
+        if (stream.finished) {
+          connection.close();
+          --unfinished;
+        }
+      }
+
+      if (Time::monotonicTime() - lastCollect >= TickCollectInterval) {
+        collectTickTimes(tickTimes);
+        lastCollect = Time::monotonicTime();
+      }
+
+      Thread::sleep(1);
+    }
+    collectTickTimes(tickTimes);
+    TraceProfiler::stopCapture();
+    double duration = Time::monotonicTime() - start;
+
+    server->stop();
+    server->join();
+    server.reset();
+    File::removeDirectoryRecursive(storageDirectory);
+
+    coutf("Replay finished in {:.2f} seconds\n", duration);
+
+    sort(tickTimes);
+    auto percentile = [&](double p) {
+      return tickTimes[min<size_t>(tickTimes.size() - 1, (size_t)(p * tickTimes.size()))] * 1000.0;
+    };
+    if (tickTimes.empty()) {
+      coutf("No world updates were run\n");
+    } else {
+      coutf("World updates: {}, p50 {:.3f}ms, p90 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms\n",
+          tickTimes.size(), percentile(0.5), percentile(0.9), percentile(0.99), tickTimes.last() * 1000.0);
+    }
+
+    printTraffic("Client to server", incoming, duration);
+    printTraffic("Server to client", outgoing, duration);
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
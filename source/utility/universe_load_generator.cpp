@@ -0,0 +1,356 @@
+#include "StarLexicalCast.hpp"
+#include "StarLogging.hpp"
+#include "StarRootLoader.hpp"
+#include "StarUniverseClient.hpp"
+#include "StarWorldClient.hpp"
+#include "StarPlayer.hpp"
+#include "StarPlayerFactory.hpp"
+#include "StarPlayerStorage.hpp"
+#include "StarStatistics.hpp"
+#include "StarMaterialDatabase.hpp"
+#include "StarProjectileDatabase.hpp"
+#include "StarProjectile.hpp"
+#include "StarTcp.hpp"
+#include "StarWeightedPool.hpp"
+
+using namespace Star;
+
+// Behavior used when no behavior file is given.  Each bot repeatedly picks one
+// of the actions by weight and performs it for a random duration in the given
+// range of seconds.
+static char const* const DefaultBehavior = R"JSON(
+  {
+    "actions" : {
+      "idle" : { "weight" : 1, "duration" : [0.5, 2.0] },
+      "walk" : { "weight" : 4, "duration" : [1.0, 4.0] },
+      "jump" : { "weight" : 2, "duration" : [0.5, 2.0] },
+      "mine" : { "weight" : 2, "duration" : [1.0, 3.0] },
+      "place" : { "weight" : 2, "duration" : [1.0, 3.0] },
+      "shoot" : { "weight" : 2, "duration" : [0.5, 2.0] }
+    },
+
+    // Seconds between each tile mined, block placed or shot fired
+    "actionInterval" : 0.25,
+    // Tiles from the bot that it mines and places blocks within
+    "reach" : 4,
+    "mineDamage" : 2.0,
+    "material" : "dirt",
+    "projectile" : "standardbullet",
+    "projectileSpeed" : 60.0
+  }
+)JSON";
+
+enum class BotAction {
+  Idle,
+  Walk,
+  Jump,
+  Mine,
+  Place,
+  Shoot
+};
+
+EnumMap<BotAction> const BotActionNames{
+  {BotAction::Idle, "idle"},
+  {BotAction::Walk, "walk"},
+  {BotAction::Jump, "jump"},
+  {BotAction::Mine, "mine"},
+  {BotAction::Place, "place"},
+  {BotAction::Shoot, "shoot"}
+};
+
+struct BotBehavior {
+  BotBehavior(Json const& config);
+
+  WeightedPool<BotAction> actions;
+  Map<BotAction, Vec2F> actionDurations;
+  float actionInterval;
+  int reach;
+  float mineDamage;
+  MaterialId material;
+  String projectile;
+  float projectileSpeed;
+};
+
+BotBehavior::BotBehavior(Json const& config) {
+  for (auto const& pair : config.getObject("actions")) {
+    auto action = BotActionNames.getLeft(pair.first);
+    actions.add(pair.second.getDouble("weight"), action);
+    actionDurations[action] = jsonToVec2F(pair.second.get("duration"));
+  }
+  actionInterval = config.getFloat("actionInterval");
+  reach = config.getInt("reach");
+  mineDamage = config.getFloat("mineDamage");
+  material = Root::singleton().materialDatabase()->materialId(config.getString("material"));
+  projectile = config.getString("projectile");
+  projectileSpeed = config.getFloat("projectileSpeed");
+}
+
+struct Bot {
+  String name;
+  UniverseClientPtr client;
+  PlayerPtr player;
+
+  BotAction action = BotAction::Idle;
+  float actionTimer = 0.0f;
+  float intervalTimer = 0.0f;
+  bool facingLeft = false;
+  bool warped = false;
+};
+
+struct LoadStats {
+  List<double> latencies;
+  List<double> incomingBytesPerSecond;
+  List<double> outgoingBytesPerSecond;
+  Map<PacketType, double> incomingPacketBytes;
+  size_t samples = 0;
+  size_t disconnects = 0;
+};
+
+static void updateBot(Bot& bot, BotBehavior const& behavior, RandomSource& random, float dt) {
+  auto world = bot.client->worldClient();
+  if (!world || !world->inWorld() || bot.player->isTeleporting())
+    return;
+
+  bot.actionTimer -= dt;
+  if (bot.actionTimer <= 0.0f) {
+    bot.action = behavior.actions.select(random);
+    Vec2F duration = behavior.actionDurations.get(bot.action);
+    bot.actionTimer = random.randf(duration[0], duration[1]);
+    bot.facingLeft = random.randb();
+  }
+
+  if (bot.action == BotAction::Walk || bot.action == BotAction::Jump) {
+    if (bot.facingLeft)
+      bot.player->moveLeft();
+    else
+      bot.player->moveRight();
+    if (bot.action == BotAction::Jump)
+      bot.player->jump();
+    return;
+  }
+
+  bot.intervalTimer -= dt;
+  if (bot.action == BotAction::Idle || bot.intervalTimer > 0.0f)
+    return;
+  bot.intervalTimer = behavior.actionInterval;
+
+  Vec2F position = bot.player->position();
+  Vec2I tile = Vec2I::floor(position) + Vec2I(random.randInt(-behavior.reach, behavior.reach), random.randInt(-behavior.reach, behavior.reach));
+  if (bot.action == BotAction::Mine) {
+    TileLayer layer = random.randb() ? TileLayer::Foreground : TileLayer::Background;
+    world->damageTiles({tile}, layer, position, TileDamage(TileDamageType::Blockish, behavior.mineDamage), bot.player->entityId());
+  } else if (bot.action == BotAction::Place) {
+    world->applyTileModifications({{tile, PlaceMaterial{TileLayer::Foreground, behavior.material, {}}}}, false);
+  } else if (bot.action == BotAction::Shoot) {
+    auto projectile = Root::singleton().projectileDatabase()->createProjectile(behavior.projectile);
+    Vec2F direction = Vec2F::withAngle(random.randf(0.0f, 2.0f * Constants::pi));
+    projectile->setInitialPosition(position);
+    projectile->setInitialDirection(direction);
+    projectile->setInitialSpeed(behavior.projectileSpeed);
+    projectile->setSourceEntity(bot.player->entityId(), false);
+    world->addEntity(projectile);
+  }
+}
+
+static void sampleBots(List<Bot> const& bots, LoadStats& stats) {
+  for (auto const& bot : bots) {
+    if (!bot.client->isConnected())
+      continue;
+
+    if (auto world = bot.client->worldClient()) {
+      if (world->inWorld())
+        stats.latencies.append(world->latency());
+    }
+    if (auto incoming = bot.client->incomingStats()) {
+      stats.incomingBytesPerSecond.append(incoming->bytesPerSecond);
+      for (auto const& pair : incoming->packetBytesPerSecond)
+        stats.incomingPacketBytes[pair.first] += pair.second;
+    }
+    if (auto outgoing = bot.client->outgoingStats())
+      stats.outgoingBytesPerSecond.append(outgoing->bytesPerSecond);
+  }
+  ++stats.samples;
+}
+
+static String describeDistribution(List<double> values, String const& unit) {
+  if (values.empty())
+    return "no samples";
+  sort(values);
+  auto percentile = [&](double p) {
+    return values[min<size_t>(values.size() - 1, (size_t)(p * values.size()))];
+  };
+  double sum = 0.0;
+  for (double value : values)
+    sum += value;
+  return strf("mean {:.1f}{}, p50 {:.1f}{}, p90 {:.1f}{}, p99 {:.1f}{}, max {:.1f}{}",
+      sum / values.size(), unit, percentile(0.5), unit, percentile(0.9), unit, percentile(0.99), unit, values.last(), unit);
+}
+
+// Fetches the metrics served by a dedicated server with runMetricsServer on
+static String fetchServerMetrics(HostAddressWithPort const& address) {
+  auto socket = TcpSocket::connectTo(address);
+  String request = "GET /metrics HTTP/1.0\r\n\r\n";
+  socket->send(request.utf8Ptr(), request.utf8Size());
+
+  String response;
+  char buffer[4096];
+  while (true) {
+    size_t read = socket->receive(buffer, sizeof(buffer));
+    if (read == 0)
+      break;
+    response.append(buffer, read);
+  }
+  socket->close();
+  return response.split("\r\n\r\n", 1).get(1);
+}
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addArgument("server", OptionParser::Required, "address of the server to connect to, as host:port");
+    rootLoader.addParameter("bots", "bots", OptionParser::Optional, "number of bot players to connect, defaults to 10");
+    rootLoader.addParameter("duration", "seconds", OptionParser::Optional, "seconds to run for once every bot has connected, defaults to 60");
+    rootLoader.addParameter("warp", "warp action", OptionParser::Optional, "where bots warp to once connected, defaults to InstanceWorld:outpost, 'none' stays on their ships");
+    rootLoader.addParameter("behavior", "behavior file", OptionParser::Optional, "Json file describing bot behavior, see DefaultBehavior for the format");
+    rootLoader.addParameter("account", "account", OptionParser::Optional, "account to connect bots with");
+    rootLoader.addParameter("password", "password", OptionParser::Optional, "password of the account");
+    rootLoader.addParameter("metrics", "metrics address", OptionParser::Optional, "address of the server metrics endpoint, as host:port, to report server side statistics from");
+    rootLoader.addParameter("reportevery", "seconds", OptionParser::Optional, "seconds between each progress report, defaults to 5");
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    coutf("Fully loading root...");
+    root->fullyLoad();
+    coutf(" done\n");
+
+    auto parameter = [&](String const& name, String const& def) {
+      return options.parameters.contains(name) ? options.parameters.get(name).first() : def;
+    };
+
+    auto address = HostAddressWithPort::lookupWithPort(options.arguments.first()).rightPtr();
+    if (!address)
+      throw StarException::format("Could not resolve server address '{}'", options.arguments.first());
+
+    size_t botCount = lexicalCast<size_t>(parameter("bots", "10"));
+    double duration = lexicalCast<double>(parameter("duration", "60"));
+    double reportEvery = lexicalCast<double>(parameter("reportevery", "5"));
+    String warp = parameter("warp", "InstanceWorld:outpost");
+    String account = parameter("account", "");
+    String password = parameter("password", "");
+
+    Json behaviorConfig = options.parameters.contains("behavior")
+      ? Json::parseJson(File::readFileString(options.parameters.get("behavior").first()))
+      : Json::parseJson(DefaultBehavior);
+    BotBehavior behavior(behaviorConfig);
+
+    String storageDirectory = File::temporaryDirectory();
+    RandomSource random;
+    List<Bot> bots;
+    LoadStats stats;
+
+    double start = Time::monotonicTime();
+    double lastUpdate = start;
+    double lastSample = start;
+    double lastReport = start;
+    Maybe<double> allConnectedTime;
+    double worstFrame = 0.0;
+    while (!allConnectedTime || Time::monotonicTime() - *allConnectedTime < duration) {
+      // Connecting blocks, so bots join one per frame
+      if (bots.size() < botCount) {
+        Bot bot;
+        bot.name = strf("bot{}", bots.size());
+        String botStorage = File::relativeTo(storageDirectory, bot.name);
+        bot.client = make_shared<UniverseClient>(make_shared<PlayerStorage>(File::relativeTo(botStorage, "player")),
+            make_shared<Statistics>(File::relativeTo(botStorage, "statistics")));
+        bot.player = root->playerFactory()->create();
+        bot.player->finalizeCreation();
+        bot.player->setName(bot.name);
+        bot.client->setMainPlayer(bot.player);
+
+        auto connection = UniverseConnection(TcpPacketSocket::open(TcpSocket::connectTo(*address)));
+        if (auto error = bot.client->connect(std::move(connection), true, account, password))
+          throw StarException::format("{} failed to connect: {}", bot.name, *error);
+        bots.append(std::move(bot));
+
+        if (bots.size() == botCount) {
+          allConnectedTime = Time::monotonicTime();
+          coutf("All {} bots connected after {:.1f}s\n", botCount, *allConnectedTime - start);
+        }
+      }
+
+      double now = Time::monotonicTime();
+      float dt = now - lastUpdate;
+      lastUpdate = now;
+
+      double frameStart = Time::monotonicTime();
+      for (auto& bot : bots) {
+        if (!bot.client->isConnected())
+          continue;
+
+        bot.client->update(dt);
+        if (!bot.client->isConnected()) {
+          coutf("{} disconnected: {}\n", bot.name, bot.client->disconnectReason().value("unknown reason"));
+          ++stats.disconnects;
+          continue;
+        }
+
+        if (!bot.warped && bot.client->worldClient() && bot.client->worldClient()->inWorld()) {
+          if (warp != "none")
+            bot.client->warpPlayer(parseWarpAction(warp), false);
+          bot.warped = true;
+        }
+        updateBot(bot, behavior, random, dt);
+      }
+      worstFrame = max(worstFrame, Time::monotonicTime() - frameStart);
+
+      if (now - lastSample >= 1.0) {
+        sampleBots(bots, stats);
+        lastSample = now;
+      }
+
+      if (now - lastReport >= reportEvery) {
+        size_t connected = bots.filtered([](Bot const& bot) { return bot.client->isConnected(); }).size();
+        coutf("[{:.0f}s] {}/{} bots connected, latency {}, worst frame {:.1f}ms\n",
+            now - start, connected, botCount, describeDistribution(stats.latencies, "ms"), worstFrame * 1000.0);
+        lastReport = now;
+        worstFrame = 0.0;
+      }
+
+      Thread::sleep(1000 * ServerGlobalTimestep);
+    }
+
+    coutf("Finished, {} bots ran for {:.1f}s with {} disconnects\n", botCount, duration, stats.disconnects);
+    coutf("Client latency: {}\n", describeDistribution(stats.latencies, "ms"));
+    coutf("Per bot incoming: {}\n", describeDistribution(stats.incomingBytesPerSecond, "B/s"));
+    coutf("Per bot outgoing: {}\n", describeDistribution(stats.outgoingBytesPerSecond, "B/s"));
+
+    auto packetBytes = stats.incomingPacketBytes.pairs();
+    sort(packetBytes, [](auto const& a, auto const& b) { return a.second > b.second; });
+    coutf("Incoming bytes per second per bot by packet type:\n");
+    for (auto const& pair : packetBytes)
+      coutf("  {:<32} {:>12.1f}\n", PacketTypeNames.getRight(pair.first), pair.second / max<size_t>(stats.samples * botCount, 1));
+
+    if (options.parameters.contains("metrics")) {
+      auto metricsAddress = HostAddressWithPort::lookupWithPort(options.parameters.get("metrics").first()).rightPtr();
+      if (!metricsAddress)
+        throw StarException::format("Could not resolve metrics address '{}'", options.parameters.get("metrics").first());
+      coutf("Server metrics:\n");
+      for (auto const& line : fetchServerMetrics(*metricsAddress).splitLines()) {
+        // Histogram buckets are too verbose to be worth printing
+        if (!line.beginsWith("#") && !line.contains("_bucket{"))
+          coutf("  {}\n", line);
+      }
+    }
+
+    for (auto& bot : bots)
+      bot.client->disconnect();
+    bots.clear();
+    File::removeDirectoryRecursive(storageDirectory);
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
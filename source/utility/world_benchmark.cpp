@@ -3,25 +3,288 @@
 #include "StarRootLoader.hpp"
 #include "StarWorldServer.hpp"
 #include "StarWorldTemplate.hpp"
+#include "StarTraceProfiler.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarLuaRoot.hpp"
+#include "StarMemory.hpp"
 
 using namespace Star;
 
+// Seconds between collecting update stage times from the trace profiler,
+// well within the time it takes a world thread to fill its trace buffer.
+static double const ZoneCollectInterval = 5.0;
+
+// Tiles visible on a simulated player's screen
+static Vec2I const PlayerWindowSize = Vec2I(120, 70);
+// Steps between a simulated player telling the server where its window is
+static uint64_t const PlayerStateUpdateEvery = 6;
+// Tiles per second a simulated player walks, about as fast as running
+static float const PlayerWalkSpeed = 14.0f;
+
+struct BenchmarkSettings {
+  uint64_t steps;
+  uint64_t signalEvery;
+  uint64_t reportEvery;
+  size_t players;
+};
+
+// A client that walks back and forth through the world without a player
+// entity, so the server streams it sectors and entities as it goes.
+struct SimulatedPlayer {
+  ConnectionId clientId;
+  WorldClientState clientState;
+  Maybe<Vec2F> position;
+  float direction;
+};
+
+struct WorldRunResult {
+  double seconds = 0.0;
+  size_t luaMemoryStart = 0;
+  size_t luaMemoryPeak = 0;
+  size_t luaMemoryEnd = 0;
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t packets = 0;
+  uint64_t packetBytes = 0;
+};
+
+static void collectZoneTimes(StringMap<List<double>>& zoneTimes) {
+  Json trace = TraceProfiler::stopCapture();
+  TraceProfiler::startCapture();
+  for (auto const& event : trace.getArray("traceEvents")) {
+    if (event.getString("ph") == "X")
+      zoneTimes[event.getString("name")].append(event.getDouble("dur") / 1000000.0);
+  }
+}
+
+static void updatePlayer(WorldServer& worldServer, SimulatedPlayer& player, uint64_t step, float dt, WorldRunResult& result) {
+  if (player.position) {
+    *player.position += Vec2F(player.direction * PlayerWalkSpeed * dt, 0.0f);
+    if (step % PlayerStateUpdateEvery == 0) {
+      // Turn around every so often so players stay near the generated area
+      if (step % (PlayerStateUpdateEvery * 200) == 0)
+        player.direction = -player.direction;
+      Vec2I center = Vec2I::round(worldServer.geometry().limit(*player.position));
+      player.clientState.setWindow(RectI::withCenter(center, PlayerWindowSize));
+      worldServer.handleIncomingPackets(player.clientId, {make_shared<WorldClientStateUpdatePacket>(player.clientState.writeDelta())});
+    }
+  }
+
+  for (auto const& packet : worldServer.getOutgoingPackets(player.clientId)) {
+    if (auto worldStart = as<WorldStartPacket>(packet)) {
+      player.position = worldStart->playerStart;
+      worldServer.handleIncomingPackets(player.clientId, {make_shared<WorldStartAcknowledgePacket>()});
+    }
+    DataStreamBuffer ds;
+    packet->write(ds, player.clientState.netCompatibilityRules());
+    ++result.packets;
+    result.packetBytes += ds.size();
+  }
+}
+
+static WorldRunResult runWorld(WorldTemplatePtr worldTemplate, BenchmarkSettings const& settings, String const& name) {
+  WorldRunResult result;
+  WorldServer worldServer(std::move(worldTemplate), File::ephemeralFile());
+  float dt = ServerGlobalTimestep * GlobalTimescale;
+
+  List<unique_ptr<SimulatedPlayer>> players;
+  for (size_t i = 0; i < settings.players; ++i) {
+    auto player = make_unique<SimulatedPlayer>();
+    player->clientId = ConnectionId(i + 1);
+    player->direction = i % 2 == 0 ? 1.0f : -1.0f;
+    worldServer.addClient(player->clientId, SpawnTarget(), false);
+    players.append(std::move(player));
+  }
+
+  result.luaMemoryStart = result.luaMemoryPeak = worldServer.luaRoot()->luaMemoryUsage();
+  MemoryStatistics memoryStart = threadMemoryStatistics();
+
+  double start = Time::monotonicTime();
+  double lastReport = start;
+  uint64_t entityCount = 0;
+  for (uint64_t j = 0; j < settings.steps; ++j) {
+    if (j % settings.signalEvery == 0) {
+      entityCount = 0;
+      worldServer.forEachEntity(RectF(Vec2F(), Vec2F(worldServer.geometry().size())), [&](auto const& entity) {
+          ++entityCount;
+          worldServer.signalRegion(RectI::integral(entity->metaBoundBox().translated(entity->position())));
+        });
+      result.luaMemoryPeak = max(result.luaMemoryPeak, worldServer.luaRoot()->luaMemoryUsage());
+    }
+
+    if (settings.reportEvery != 0 && j % settings.reportEvery == 0) {
+      float fps = settings.reportEvery / (Time::monotonicTime() - lastReport);
+      lastReport = Time::monotonicTime();
+      coutf("{}[{}] {}s | FPS: {} | Entities: {}\n", name, j, Time::monotonicTime() - start, fps, entityCount);
+    }
+
+    worldServer.update(dt);
+    for (auto& player : players)
+      updatePlayer(worldServer, *player, j, dt, result);
+  }
+  result.seconds = Time::monotonicTime() - start;
+
+  MemoryStatistics memoryEnd = threadMemoryStatistics();
+  result.allocations = memoryEnd.allocations - memoryStart.allocations;
+  result.allocatedBytes = memoryEnd.allocatedBytes - memoryStart.allocatedBytes;
+  result.luaMemoryEnd = worldServer.luaRoot()->luaMemoryUsage();
+  result.luaMemoryPeak = max(result.luaMemoryPeak, result.luaMemoryEnd);
+
+  for (auto const& player : players)
+    worldServer.removeClient(player->clientId);
+
+  return result;
+}
+
+static Json durationStats(List<double> durations) {
+  if (durations.empty())
+    return Json();
+
+  sort(durations);
+  auto percentile = [&](double p) {
+    return durations[min<size_t>(durations.size() - 1, (size_t)(p * durations.size()))] * 1000.0;
+  };
+  double total = 0.0;
+  for (double duration : durations)
+    total += duration;
+
+  return JsonObject{
+      {"meanMs", total / durations.size() * 1000.0},
+      {"p50Ms", percentile(0.5)},
+      {"p90Ms", percentile(0.9)},
+      {"p99Ms", percentile(0.99)},
+      {"maxMs", durations.last() * 1000.0}
+    };
+}
+
+static void printResults(Json const& results) {
+  coutf("{} worlds x {} runs of {} steps with {} players each, {:.1f} steps per second per world\n",
+      results.getUInt("worlds"), results.getUInt("runs"), results.getUInt("steps"), results.getUInt("players"),
+      results.getDouble("stepsPerSecond"));
+
+  if (auto tick = results.get("tick"); !tick.isNull()) {
+    coutf("World updates: mean {:.3f}ms, p50 {:.3f}ms, p90 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms\n",
+        tick.getDouble("meanMs"), tick.getDouble("p50Ms"), tick.getDouble("p90Ms"), tick.getDouble("p99Ms"), tick.getDouble("maxMs"));
+  }
+
+  auto zones = results.getObject("zones").pairs();
+  sort(zones, [](auto const& a, auto const& b) { return a.second.getDouble("msPerStep") > b.second.getDouble("msPerStep"); });
+  coutf("Update stages:\n");
+  for (auto const& zone : zones) {
+    coutf("  {:<32} {:>10.4f}ms per step {:>10} calls {:>10.4f}ms p99\n",
+        zone.first, zone.second.getDouble("msPerStep"), zone.second.getUInt("calls"), zone.second.getDouble("p99Ms"));
+  }
+
+  auto lua = results.get("lua");
+  coutf("Lua memory: start {} bytes, peak {} bytes, end {} bytes\n",
+      lua.getUInt("memoryStart"), lua.getUInt("memoryPeak"), lua.getUInt("memoryEnd"));
+
+  if (auto allocations = results.get("allocations"); !allocations.isNull()) {
+    coutf("Allocations: {:.1f} per step, {:.1f} bytes per step\n",
+        allocations.getDouble("perStep"), allocations.getDouble("bytesPerStep"));
+  } else {
+    coutf("Allocations: not counted, build with STAR_MEMORY_STATISTICS to count them\n");
+  }
+
+  if (results.getUInt("players") != 0) {
+    auto network = results.get("network");
+    coutf("Sent to players: {:.1f} packets per step, {:.1f} bytes per step\n",
+        network.getDouble("packetsPerStep"), network.getDouble("bytesPerStep"));
+  }
+}
+
+// Prints every metric of the two results side by side, and returns how many
+// got worse by more than the threshold.
+static size_t compareResults(Json const& baseline, Json const& current, double threshold) {
+  size_t regressions = 0;
+  auto compare = [&](String const& name, Json const& before, Json const& after, bool higherIsBetter) {
+    if (!before.isType(Json::Type::Float) && !before.isType(Json::Type::Int))
+      return;
+    if (!after.isType(Json::Type::Float) && !after.isType(Json::Type::Int)) {
+      coutf("  {:<48} {:>14.4f} {:>14} {:>9}\n", name, before.toDouble(), "-", "");
+      return;
+    }
+
+    double b = before.toDouble();
+    double a = after.toDouble();
+    double change = b != 0.0 ? (a - b) / b * 100.0 : 0.0;
+    double worse = higherIsBetter ? -change : change;
+    String flag;
+    if (worse > threshold) {
+      flag = "REGRESSION";
+      ++regressions;
+    } else if (worse < -threshold) {
+      flag = "improved";
+    }
+    coutf("  {:<48} {:>14.4f} {:>14.4f} {:>+8.1f}% {}\n", name, b, a, change, flag);
+  };
+
+  coutf("  {:<48} {:>14} {:>14} {:>9}\n", "metric", "baseline", "current", "change");
+  compare("stepsPerSecond", baseline.get("stepsPerSecond"), current.get("stepsPerSecond"), true);
+  for (auto const& stat : {"meanMs", "p50Ms", "p90Ms", "p99Ms"})
+    compare(strf("tick.{}", stat), baseline.query(strf("tick.{}", stat), {}), current.query(strf("tick.{}", stat), {}), false);
+
+  auto currentZones = current.getObject("zones");
+  for (auto const& zone : baseline.getObject("zones")) {
+    // Stages too quick to time reliably would only add noise
+    if (zone.second.getDouble("msPerStep") < 0.001)
+      continue;
+    Json after;
+    if (auto currentZone = currentZones.ptr(zone.first))
+      after = currentZone->get("msPerStep");
+    compare(strf("zones.{}.msPerStep", zone.first), zone.second.get("msPerStep"), after, false);
+  }
+
+  compare("lua.memoryPeak", baseline.query("lua.memoryPeak", {}), current.query("lua.memoryPeak", {}), false);
+  compare("allocations.perStep", baseline.query("allocations.perStep", {}), current.query("allocations.perStep", {}), false);
+  compare("allocations.bytesPerStep", baseline.query("allocations.bytesPerStep", {}), current.query("allocations.bytesPerStep", {}), false);
+  compare("network.bytesPerStep", baseline.query("network.bytesPerStep", {}), current.query("network.bytesPerStep", {}), false);
+
+  if (regressions != 0)
+    coutf("{} metrics regressed by more than {}%\n", regressions, threshold);
+  else
+    coutf("No metrics regressed by more than {}%\n", threshold);
+  return regressions;
+}
+
 int main(int argc, char** argv) {
   try {
     RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
-    rootLoader.addArgument("dungeon", OptionParser::Required, "name of the dungeon to spawn in the world to benchmark");
+    rootLoader.addArgument("dungeon", OptionParser::Optional, "name of the dungeon to spawn in the world to benchmark, required unless comparing two saved results");
     rootLoader.addParameter("seed", "seed", OptionParser::Optional, "world seed used to create the WorldTemplate");
     rootLoader.addParameter("steps", "steps", OptionParser::Optional, "number of steps to run the world for, defaults to 5,000");
     rootLoader.addParameter("times", "times", OptionParser::Optional, "how many times to perform the run, defaults to once");
+    rootLoader.addParameter("worlds", "worlds", OptionParser::Optional, "how many copies of the world to run at once, each on its own thread, defaults to 1");
+    rootLoader.addParameter("players", "players", OptionParser::Optional, "number of simulated player clients walking around each world, defaults to 0");
     rootLoader.addParameter("signalevery", "signal steps", OptionParser::Optional, "number of steps to wait between scanning and signaling all entities to stay alive, default 120");
     rootLoader.addParameter("reportevery", "report steps", OptionParser::Optional, "number of steps between each progress report, default 0 (do not report progress)");
     rootLoader.addParameter("fidelity", "server fidelity", OptionParser::Optional, "fidelity to run the server with, default high");
+    rootLoader.addParameter("json", "file", OptionParser::Optional, "file to write the results to as json");
+    rootLoader.addParameter("compare", "results", OptionParser::Multiple, "json results of an earlier run to compare this run against, or two to compare with each other without running");
+    rootLoader.addParameter("threshold", "percent", OptionParser::Optional, "change from the baseline reported as a regression when comparing, default 10");
     rootLoader.addSwitch("profiling", "whether to use lua profiling, prints the profile with info logging");
     rootLoader.addSwitch("unsafe", "enables unsafe lua libraries");
-    RootUPtr root;
+    Root::Settings rootSettings;
     OptionParser::Options options;
-    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+    tie(rootSettings, options) = rootLoader.commandParseOrDie(argc, argv);
+
+    double threshold = 10.0;
+    if (options.parameters.contains("threshold"))
+      threshold = lexicalCast<double>(options.parameters.get("threshold").first());
+
+    StringList compare = options.parameters.value("compare");
+    if (compare.size() > 2)
+      throw StarException("At most two results can be compared");
+    if (compare.size() == 2) {
+      Json baseline = Json::parseJson(File::readFileString(compare[0]));
+      Json current = Json::parseJson(File::readFileString(compare[1]));
+      return compareResults(baseline, current, threshold) == 0 ? 0 : 1;
+    }
+
+    if (options.arguments.empty())
+      throw StarException("A dungeon to benchmark is required unless comparing two results");
 
+    auto root = make_unique<Root>(rootSettings);
     coutf("Fully loading root...");
     root->fullyLoad();
     coutf(" done\n");
@@ -31,7 +294,6 @@ int main(int argc, char** argv) {
     uint64_t worldSeed = Random::randu64();
     if (options.parameters.contains("seed"))
       worldSeed = lexicalCast<uint64_t>(options.parameters.get("seed").first());
-    auto worldTemplate = make_shared<WorldTemplate>(worldParameters, SkyParameters(), worldSeed);
 
     auto fidelity = options.parameters.maybe("fidelity").apply([](StringList p) { return p.maybeFirst(); }).value({});
     root->configuration()->set("serverFidelity", fidelity.value("high"));
@@ -47,50 +309,128 @@ int main(int argc, char** argv) {
     if (options.parameters.contains("times"))
       times = lexicalCast<uint64_t>(options.parameters.get("times").first());
 
-    uint64_t steps = 5000;
-    if (options.parameters.contains("steps"))
-      steps = lexicalCast<uint64_t>(options.parameters.get("steps").first());
+    size_t worlds = 1;
+    if (options.parameters.contains("worlds"))
+      worlds = lexicalCast<size_t>(options.parameters.get("worlds").first());
 
-    uint64_t signalEvery = 120;
+    BenchmarkSettings settings{5000, 120, 0, 0};
+    if (options.parameters.contains("steps"))
+      settings.steps = lexicalCast<uint64_t>(options.parameters.get("steps").first());
     if (options.parameters.contains("signalevery"))
-      signalEvery = lexicalCast<uint64_t>(options.parameters.get("signalevery").first());
-
-    uint64_t reportEvery = 0;
+      settings.signalEvery = lexicalCast<uint64_t>(options.parameters.get("signalevery").first());
     if (options.parameters.contains("reportevery"))
-      reportEvery = lexicalCast<uint64_t>(options.parameters.get("reportevery").first());
+      settings.reportEvery = lexicalCast<uint64_t>(options.parameters.get("reportevery").first());
+    if (options.parameters.contains("players"))
+      settings.players = lexicalCast<size_t>(options.parameters.get("players").first());
 
+    StringMap<List<double>> zoneTimes;
+    List<WorldRunResult> worldResults;
     double sumTime = 0.0;
     for (uint64_t i = 0; i < times; ++i) {
-      WorldServer worldServer(worldTemplate, File::ephemeralFile());
+      coutf("Starting simulation of {} worlds for {} steps\n", worlds, settings.steps);
 
-      coutf("Starting world simulation for {} steps\n", steps);
-      double start = Time::monotonicTime();
-      double lastReport = Time::monotonicTime();
-      uint64_t entityCount = 0;
-      for (uint64_t j = 0; j < steps; ++j) {
-        if (j % signalEvery == 0) {
-          entityCount = 0;
-          worldServer.forEachEntity(RectF(Vec2F(), Vec2F(worldServer.geometry().size())), [&](auto const& entity) {
-              ++entityCount;
-              worldServer.signalRegion(RectI::integral(entity->metaBoundBox().translated(entity->position())));
-            });
-        }
+      // Each world gets its own template, they are not safe to share between
+      // threads.
+      List<ThreadFunction<WorldRunResult>> worldThreads;
+      for (size_t w = 0; w < worlds; ++w) {
+        auto worldTemplate = make_shared<WorldTemplate>(worldParameters, SkyParameters(), worldSeed);
+        String name = worlds == 1 ? String() : strf("World {} ", w);
+        worldThreads.append(Thread::invoke(strf("WorldBenchmark::runWorld {}", w), runWorld, std::move(worldTemplate), settings, name));
+      }
 
-        if (reportEvery != 0 && j % reportEvery == 0) {
-          float fps = reportEvery / (Time::monotonicTime() - lastReport);
-          lastReport = Time::monotonicTime();
-          coutf("[{}] {}s | FPS: {} | Entities: {}\n", j, Time::monotonicTime() - start, fps, entityCount);
+      TraceProfiler::startCapture();
+      double start = Time::monotonicTime();
+      double lastCollect = start;
+      while (worldThreads.any([](auto const& thread) { return thread.isRunning(); })) {
+        if (Time::monotonicTime() - lastCollect >= ZoneCollectInterval) {
+          collectZoneTimes(zoneTimes);
+          lastCollect = Time::monotonicTime();
         }
-        worldServer.update(ServerGlobalTimestep * GlobalTimescale);
+        Thread::sleep(10);
       }
+      collectZoneTimes(zoneTimes);
+      TraceProfiler::stopCapture();
       double totalTime = Time::monotonicTime() - start;
-      coutf("Finished run of running dungeon world '{}' with seed {} for {} steps in {} seconds, average FPS: {}\n",
-            dungeon, worldSeed, steps, totalTime, steps / totalTime);
+
+      for (auto& thread : worldThreads)
+        worldResults.append(thread.finish());
+
+      coutf("Finished run of running {} dungeon worlds '{}' with seed {} for {} steps in {} seconds, average FPS: {}\n",
+            worlds, dungeon, worldSeed, settings.steps, totalTime, settings.steps / totalTime);
       sumTime += totalTime;
     }
 
     if (times != 1) {
-      coutf("Average of all runs - time: {}, FPS: {}\n", sumTime / times, steps / (sumTime / times));
+      coutf("Average of all runs - time: {}, FPS: {}\n", sumTime / times, settings.steps / (sumTime / times));
+    }
+
+    double worldSteps = (double)settings.steps * worldResults.size();
+    double worldSeconds = 0.0;
+    WorldRunResult totals;
+    for (auto const& result : worldResults) {
+      worldSeconds += result.seconds;
+      totals.luaMemoryStart += result.luaMemoryStart;
+      totals.luaMemoryPeak += result.luaMemoryPeak;
+      totals.luaMemoryEnd += result.luaMemoryEnd;
+      totals.allocations += result.allocations;
+      totals.allocatedBytes += result.allocatedBytes;
+      totals.packets += result.packets;
+      totals.packetBytes += result.packetBytes;
+    }
+
+    JsonObject zones;
+    for (auto& pair : zoneTimes) {
+      if (pair.first == "WorldServer::update")
+        continue;
+      double total = 0.0;
+      for (double duration : pair.second)
+        total += duration;
+      zones[pair.first] = jsonMerge(durationStats(pair.second), JsonObject{
+          {"calls", pair.second.size()},
+          {"msPerStep", total / worldSteps * 1000.0}
+        });
+    }
+
+    // Lua memory is summed over the worlds, then averaged over the runs
+    JsonObject results{
+        {"dungeon", dungeon},
+        {"seed", worldSeed},
+        {"steps", settings.steps},
+        {"runs", times},
+        {"worlds", worlds},
+        {"players", settings.players},
+        {"fidelity", root->configuration()->get("serverFidelity")},
+        {"seconds", sumTime / times},
+        {"stepsPerSecond", worldSteps / worldSeconds},
+        {"tick", durationStats(zoneTimes.value("WorldServer::update"))},
+        {"zones", zones},
+        {"lua", JsonObject{
+            {"memoryStart", totals.luaMemoryStart / times},
+            {"memoryPeak", totals.luaMemoryPeak / times},
+            {"memoryEnd", totals.luaMemoryEnd / times}
+          }},
+        {"allocations", threadMemoryStatistics().counted ? Json(JsonObject{
+            {"perStep", totals.allocations / worldSteps},
+            {"bytesPerStep", totals.allocatedBytes / worldSteps}
+          }) : Json()},
+        {"network", JsonObject{
+            {"packetsPerStep", totals.packets / worldSteps},
+            {"bytesPerStep", totals.packetBytes / worldSteps}
+          }}
+      };
+
+    printResults(results);
+
+    if (auto jsonFile = options.parameters.maybe("json")) {
+      File::writeFile(Json(results).printJson(2), jsonFile->first());
+      coutf("Wrote results to '{}'\n", jsonFile->first());
+    }
+
+    if (compare.size() == 1) {
+      Json baseline = Json::parseJson(File::readFileString(compare[0]));
+      coutf("Compared to '{}':\n", compare[0]);
+      if (compareResults(baseline, results, threshold) != 0)
+        return 1;
     }
 
     return 0;
@@ -10,6 +10,7 @@ ImageWidget::ImageWidget(String const& image) {
   m_maxSize = Vec2I{4096, 4096};
   m_minSize = Vec2I{0, 0};
   m_offset = Vec2I{0, 0};
+  setRetained(true);
   setImage(image);
 }
 
@@ -59,6 +60,7 @@ Vec2I ImageWidget::offset() {
 
 void ImageWidget::setOffset(Vec2I const& offset) {
   m_offset = offset;
+  markDirty();
 }
 
 bool ImageWidget::centered() {
@@ -99,6 +101,7 @@ RectI ImageWidget::screenBoundRect() const {
 }
 
 void ImageWidget::transformDrawables() {
+  markDirty();
   m_drawables.clear();
   for (auto drawable : m_baseDrawables)
     m_drawables.append(Drawable(drawable));
@@ -18,6 +18,7 @@ LabelWidget::LabelWidget(String text,
   m_style.color = color.toRgba();
   if (lineSpacing)
     m_style.lineSpacing = *lineSpacing;
+  setRetained(true);
   setText(std::move(text));
 }
 
@@ -41,10 +42,12 @@ void LabelWidget::setFontSize(int fontSize) {
 
 void LabelWidget::setFontMode(FontMode fontMode) {
   m_style.shadow = fontModeToColor(fontMode).toRgba();
+  markDirty();
 }
 
 void LabelWidget::setColor(Color newColor) {
   m_style.color = newColor.toRgba();
+  markDirty();
 }
 
 void LabelWidget::setFont(String const& font) {
@@ -98,6 +101,7 @@ void LabelWidget::renderImpl() {
 }
 
 void LabelWidget::updateTextRegion() {
+  markDirty();
   context()->setTextStyle(m_style);
   m_textRegion = RectI(context()->determineInterfaceTextSize(m_text, {Vec2F(), m_hAnchor, m_vAnchor, m_wrapWidth, m_textCharLimit}));
   setSize(m_textRegion.size());
@@ -36,8 +36,12 @@ bool ListWidget::sendEvent(InputEvent const& event) {
   if (!m_visible)
     return false;
 
+  Vec2I screenPos = screenPosition();
   for (size_t i = m_members.size(); i != 0; --i) {
     auto child = m_members[i - 1];
+    // Rows scrolled out of view can neither be clicked nor hovered
+    if (!itemVisible(child, screenPos))
+      continue;
     if (child->sendEvent(event)
         || (event.is<MouseButtonDownEvent>() && child->inMember(*context()->mousePosition(event))
               && event.get<MouseButtonDownEvent>().mouseButton == MouseButton::Left)) {
@@ -94,6 +98,15 @@ WidgetPtr ListWidget::addItem(WidgetPtr existingItem) {
   return existingItem;
 }
 
+void ListWidget::setItems(List<WidgetPtr> const& items) {
+  setSelected(NPos);
+  removeAllChildren();
+  m_presentedItems.clear();
+  for (auto const& item : items)
+    addChild(toString(Random::randu64()), item);
+  updateSizeAndPosition();
+}
+
 WidgetPtr ListWidget::constructWidget() {
   WidgetPtr newItem = make_shared<Widget>();
   m_reader.construct(m_schema.get("listTemplate"), newItem.get());
@@ -124,6 +137,10 @@ void ListWidget::updateSizeAndPosition() {
   }
 }
 
+bool ListWidget::itemVisible(WidgetPtr const& item, Vec2I const& screenPosition) const {
+  return m_drawingArea.intersects(RectI::withSize(screenPosition + item->position(), item->size()));
+}
+
 void ListWidget::setEnabled(size_t pos, bool enabled) {
   if (pos != NPos && pos < listSize()) {
     if (enabled) {
@@ -190,6 +207,26 @@ void ListWidget::registerMemberCallback(String const& name, WidgetCallbackFunc c
   m_reader.registerCallback(name, callback);
 }
 
+void ListWidget::setItemPresenter(ItemPresenter presenter) {
+  m_presenter = std::move(presenter);
+  m_presentedItems.clear();
+}
+
+void ListWidget::invalidateItems() {
+  m_presentedItems.clear();
+}
+
+void ListWidget::drawChildren() {
+  Vec2I screenPos = screenPosition();
+  for (auto const& child : m_members) {
+    if (!itemVisible(child, screenPos))
+      continue;
+    if (m_presenter && m_presentedItems.add(child.get()))
+      m_presenter(child);
+    child->render(m_drawingArea);
+  }
+}
+
 void ListWidget::setFillDown(bool fillDown) {
   m_fillDown = fillDown;
 }
@@ -199,6 +236,8 @@ void ListWidget::setColumns(uint64_t columns) {
 }
 
 void ListWidget::removeItem(size_t at) {
+  if (auto item = itemAt(at))
+    m_presentedItems.remove(item.get());
   removeChildAt(at);
   if (m_selectedItem == at)
     setSelected(NPos);
@@ -221,6 +260,7 @@ void ListWidget::removeItem(WidgetPtr item) {
 void ListWidget::clear() {
   setSelected(NPos);
   removeAllChildren();
+  m_presentedItems.clear();
   updateSizeAndPosition();
 }
 
@@ -9,6 +9,8 @@ STAR_CLASS(ListWidget);
 
 class ListWidget : public Widget {
 public:
+  typedef function<void(WidgetPtr const&)> ItemPresenter;
+
   ListWidget(Json const& schema);
   ListWidget();
 
@@ -23,6 +25,8 @@ public:
   WidgetPtr addItem();
   WidgetPtr addItem(size_t at);
   WidgetPtr addItem(WidgetPtr existingItem);
+  // Replaces the contents of the list, laying out all items at once
+  void setItems(List<WidgetPtr> const& items);
   void removeItem(size_t at);
   void removeItem(WidgetPtr item);
   void clear();
@@ -40,11 +44,21 @@ public:
 
   void registerMemberCallback(String const& name, WidgetCallbackFunc const& callback);
 
+  // When set, the presenter is called for an item only once it scrolls into
+  // view, rather than having every row configured up front. Invalidating
+  // re-presents items lazily as they are next drawn.
+  void setItemPresenter(ItemPresenter presenter);
+  void invalidateItems();
+
   void setFillDown(bool fillDown);
   void setColumns(uint64_t columns);
 
+protected:
+  void drawChildren() override;
+
 private:
   void updateSizeAndPosition();
+  bool itemVisible(WidgetPtr const& item, Vec2I const& screenPosition) const;
 
   Json m_schema;
   GuiReader m_reader;
@@ -52,6 +66,8 @@ private:
   Set<size_t> m_disabledItems;
   size_t m_selectedItem;
   WidgetCallbackFunc m_callback;
+  ItemPresenter m_presenter;
+  HashSet<Widget*> m_presentedItems;
 
   String m_selectedBG;
   String m_unselectedBG;
@@ -14,6 +14,8 @@ Widget::Widget() {
   m_doScissor = true;
   m_container = false;
   m_mouseTransparent = false;
+  m_retained = false;
+  m_renderDirty = true;
 }
 
 Widget::~Widget() {
@@ -36,12 +38,46 @@ void Widget::render(RectI const& region) {
   if (!setupDrawRegion(region))
     return;
 
-  renderImpl();
+  if (m_retained)
+    renderRetained();
+  else
+    renderImpl();
   drawChildren();
 }
 
 void Widget::renderImpl() {}
 
+void Widget::setRetained(bool retained) {
+  m_retained = retained;
+  markDirty();
+}
+
+void Widget::markDirty() {
+  m_renderDirty = true;
+  m_retainedPrimitives.clear();
+}
+
+void Widget::renderRetained() {
+  auto& primitives = m_context->renderer()->immediatePrimitives();
+  auto key = make_tuple(m_context->renderer().get(), screenPosition(), m_drawingArea, m_context->interfaceScale());
+  if (!m_renderDirty && m_retainedKey == key) {
+    primitives.appendAll(m_retainedPrimitives);
+    return;
+  }
+
+  size_t start = primitives.size();
+  renderImpl();
+  // If rendering flushed the primitive list, the output can't be captured
+  if (primitives.size() < start) {
+    markDirty();
+    return;
+  }
+
+  m_retainedPrimitives = List<RenderPrimitive>(primitives.begin() + start, primitives.end());
+  m_retainedKey = key;
+  m_renderDirty = false;
+}
+
 void Widget::drawChildren() {
   for (auto child : m_members)
     child->render(m_drawingArea);
@@ -133,6 +133,13 @@ protected:
   virtual void renderImpl();
   virtual void drawChildren();
   bool setupDrawRegion(RectI const& region);
+
+  // A retained widget keeps the primitives produced by its last renderImpl
+  // and replays them until it moves, its scissor changes, or markDirty is
+  // called.  Only widgets whose renderImpl depends solely on their own state
+  // (and which call markDirty whenever that changes) should opt in.
+  void setRetained(bool retained);
+  void markDirty();
   virtual RectI getScissorRect() const;
   virtual RectI noScissor() const;
 
@@ -157,6 +164,14 @@ protected:
   bool m_mouseTransparent;
 
   Json m_data;
+
+private:
+  void renderRetained();
+
+  bool m_retained;
+  bool m_renderDirty;
+  tuple<Renderer*, Vec2I, RectI, float> m_retainedKey;
+  List<RenderPrimitive> m_retainedPrimitives;
 };
 
 std::ostream& operator<<(std::ostream& os, Widget const& widget);